@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/util.h>
+#include <nuttx/greybus/greybus.h>
+
+#include <errno.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GB_BENCH_TYPE_ECHO      0x02
+#define GB_BENCH_TYPE_SINK      0x03
+
+#define GB_BENCH_CLIENT_CPORT   CONFIG_ARA_GB_BENCH_CPORT
+#define GB_BENCH_SERVER_CPORT   (CONFIG_ARA_GB_BENCH_CPORT + 1)
+
+#define GB_BENCH_DEFAULT_COUNT  1000
+
+static const size_t g_sizes[] = { 0, 64, 256, 1024, GB_MAX_PAYLOAD_SIZE };
+
+#define GB_BENCH_NSIZES (sizeof(g_sizes) / sizeof(g_sizes[0]))
+
+static sem_t g_sink_done;
+static volatile unsigned int g_sink_left;
+static bool g_initialized;
+
+static uint8_t gb_bench_echo(struct gb_operation *operation)
+{
+    size_t size = gb_operation_get_request_payload_size(operation);
+    void *response;
+
+    response = gb_operation_alloc_response(operation, size);
+    if (!response)
+        return GB_OP_NO_MEMORY;
+
+    memcpy(response, gb_operation_get_request_payload(operation), size);
+    return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_bench_sink(struct gb_operation *operation)
+{
+    if (g_sink_left && !--g_sink_left)
+        sem_post(&g_sink_done);
+
+    return GB_OP_SUCCESS;
+}
+
+static struct gb_operation_handler gb_bench_server_handlers[] = {
+    GB_HANDLER(GB_BENCH_TYPE_ECHO, gb_bench_echo),
+    GB_HANDLER(GB_BENCH_TYPE_SINK, gb_bench_sink),
+};
+
+static struct gb_driver gb_bench_server = {
+    .op_handlers = gb_bench_server_handlers,
+    .op_handlers_count = ARRAY_SIZE(gb_bench_server_handlers),
+};
+
+/* The client only receives responses, but needs handlers to get them */
+static struct gb_operation_handler gb_bench_client_handlers[] = {
+    GB_HANDLER(GB_BENCH_TYPE_SINK, gb_bench_sink),
+};
+
+static struct gb_driver gb_bench_client = {
+    .op_handlers = gb_bench_client_handlers,
+    .op_handlers_count = ARRAY_SIZE(gb_bench_client_handlers),
+};
+
+static int gb_bench_start_cport(unsigned int cport, struct gb_driver *driver)
+{
+    int retval;
+
+    retval = gb_register_driver(cport, -1, driver);
+    if (retval)
+        return retval;
+
+    retval = gb_listen(cport);
+    if (retval)
+        return retval;
+
+    return gb_notify(cport, GB_EVT_CONNECTED);
+}
+
+static int gb_bench_init(void)
+{
+    int retval;
+
+    if (g_initialized)
+        return 0;
+
+    sem_init(&g_sink_done, 0, 0);
+
+    retval = gb_memloop_init();
+    if (retval) {
+        fprintf(stderr, "cannot start the Greybus core: %d\n", retval);
+        return retval;
+    }
+
+    retval = gb_memloop_connect(GB_BENCH_CLIENT_CPORT, GB_BENCH_SERVER_CPORT);
+    if (!retval)
+        retval = gb_bench_start_cport(GB_BENCH_SERVER_CPORT,
+                                      &gb_bench_server);
+    if (!retval)
+        retval = gb_bench_start_cport(GB_BENCH_CLIENT_CPORT,
+                                      &gb_bench_client);
+    if (retval) {
+        fprintf(stderr, "cannot set up CP%u and CP%u: %d\n",
+                GB_BENCH_CLIENT_CPORT, GB_BENCH_SERVER_CPORT, retval);
+        gb_deinit();
+        return retval;
+    }
+
+    g_initialized = true;
+    return 0;
+}
+
+static void gb_bench_print(const char *name, size_t size, unsigned int count,
+                           uint32_t min, uint64_t total, uint32_t max,
+                           uint64_t bytes)
+{
+    printf("%-5s %6u %7u %7u %7u %7u %8u\n", name, size, count, min,
+           (uint32_t) (total / count), max,
+           total ? (uint32_t) (bytes * 1000 / total) : 0);
+}
+
+/* Time echo requests one after the other, each waiting for its response */
+static int gb_bench_echo_run(size_t size, unsigned int count)
+{
+    struct gb_operation *operation;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    uint32_t start;
+    uint32_t usec;
+    unsigned int i;
+    int retval;
+
+    for (i = 0; i < count; i++) {
+        operation = gb_operation_create(GB_BENCH_CLIENT_CPORT,
+                                        GB_BENCH_TYPE_ECHO, size);
+        if (!operation)
+            return -ENOMEM;
+
+        start = hrt_getusec();
+        retval = gb_operation_send_request_sync(operation);
+        usec = hrt_getusec() - start;
+
+        if (!retval &&
+            gb_operation_get_request_result(operation) != GB_OP_SUCCESS)
+            retval = -EIO;
+
+        gb_operation_destroy(operation);
+        if (retval)
+            return retval;
+
+        min = MIN(min, usec);
+        max = MAX(max, usec);
+        total += usec;
+    }
+
+    /* the payload goes both ways */
+    gb_bench_print("echo", size, count, min, total, max,
+                   (uint64_t) size * count * 2);
+    return 0;
+}
+
+/* Time a stream of requests without response, until all are handled */
+static int gb_bench_sink_run(size_t size, unsigned int count)
+{
+    struct gb_operation *operation;
+    uint32_t start;
+    uint32_t usec;
+    unsigned int i;
+    int retval;
+
+    g_sink_left = count;
+    start = hrt_getusec();
+
+    for (i = 0; i < count; i++) {
+        operation = gb_operation_create(GB_BENCH_CLIENT_CPORT,
+                                        GB_BENCH_TYPE_SINK, size);
+        if (!operation) {
+            retval = -ENOMEM;
+            break;
+        }
+
+        while ((retval = gb_operation_send_request_nowait(operation, NULL,
+                                                          false)) == -EAGAIN)
+            usleep(1000);
+
+        gb_operation_destroy(operation);
+        if (retval)
+            break;
+    }
+
+    if (i < count) {
+        g_sink_left = 0;
+        return retval;
+    }
+
+    while (sem_wait(&g_sink_done) < 0 && errno == EINTR);
+    usec = hrt_getusec() - start;
+
+    /* only the total time is known, spread it evenly */
+    gb_bench_print("sink", size, count, usec / count, usec, usec / count,
+                   (uint64_t) size * count);
+    return 0;
+}
+
+static int gb_bench_run(size_t size, unsigned int count)
+{
+    int retval;
+
+    retval = gb_bench_echo_run(size, count);
+    if (!retval)
+        retval = gb_bench_sink_run(size, count);
+    if (retval)
+        fprintf(stderr, "%u bytes test failed: %d\n", size, retval);
+
+    return retval;
+}
+
+static void gb_bench_usage(const char *name)
+{
+    printf("Usage: %s [-n count] [-s size]\n", name);
+    printf("    -n count: number of operations per test (default %u)\n",
+           GB_BENCH_DEFAULT_COUNT);
+    printf("    -s size: only test this payload size (max %u)\n",
+           GB_MAX_PAYLOAD_SIZE);
+}
+
+int gb_bench_main(int argc, char **argv)
+{
+    unsigned int count = GB_BENCH_DEFAULT_COUNT;
+    long size = -1;
+    int retval = 0;
+    int opt;
+    int i;
+
+    optind = -1;
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            size = strtol(optarg, NULL, 0);
+            break;
+        default:
+            gb_bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!count || size > (long) GB_MAX_PAYLOAD_SIZE) {
+        gb_bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (gb_bench_init())
+        return EXIT_FAILURE;
+
+    printf("%-5s %6s %7s %7s %7s %7s %8s\n", "TEST", "SIZE", "COUNT",
+           "MIN_US", "AVG_US", "MAX_US", "KB/S");
+
+    for (i = 0; i < GB_BENCH_NSIZES; i++) {
+        retval = gb_bench_run(size >= 0 ? size : g_sizes[i], count);
+        if (retval || size >= 0)
+            break;
+    }
+
+    return retval ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -82,10 +82,17 @@ struct loopback_context {
     unsigned wait;
     unsigned left_to_wait;
     int count; /* -1 = infinite */
+    int depth; /* max requests in flight, 0 = no limit */
     int err;
     unsigned sent;
 };
 
+/* Largest number of cports given to -c */
+#define LOOPBACK_MAX_CPORTS 16
+
+/* Longest wait for a response when all commands have their requests out */
+#define LOOPBACK_COMPLETION_WAIT_US 10000
+
 static void loopback_ctx_lock(struct loopback_context *ctx)
 {
     pthread_mutex_lock(&ctx->lock);
@@ -172,6 +179,8 @@ int gb_loopback_service(void)
     struct list_head *iter;
     unsigned wait_min;
     int all_down;
+    int blocked;
+    int sent;
     size_t size;
     int status;
 
@@ -179,6 +188,8 @@ int gb_loopback_service(void)
 
     while (1) {
         all_down = 1;
+        blocked = 0;
+        sent = 0;
         wait_min = 0;
 
         loopback_ctx_list_lock();
@@ -194,6 +205,14 @@ int gb_loopback_service(void)
 
             /* At least one loopback command is active in this iteration. */
             all_down = 0;
+
+            if (ctx->depth > 0 &&
+                gb_loopback_inflight(ctx->cport) >= ctx->depth) {
+                blocked = 1;
+                loopback_ctx_unlock(ctx);
+                continue;
+            }
+
             size = ctx->type == GB_LOOPBACK_TYPE_PING ? 1 : ctx->size;
 
             status = gb_loopback_send_req(ctx->cport, size, ctx->type);
@@ -211,14 +230,17 @@ int gb_loopback_service(void)
                      * So, if we are running out of memory, sleep to let
                      * the UniPro thread send and free operations.
                      */
+                    loopback_ctx_unlock(ctx);
                     usleep(1);
                     continue;
                 } else {
                     ctx->err++;
                 }
+                loopback_ctx_unlock(ctx);
                 continue;
             }
             ctx->sent++;
+            sent = 1;
 
             if (ctx->count > 0)
                 ctx->count--;
@@ -248,6 +270,13 @@ int gb_loopback_service(void)
         if (all_down) {
             loopback_ctx_list_unlock();
             loopback_sleep();
+        } else if (blocked && !sent) {
+            /*
+             * Every command has as many requests in flight as allowed,
+             * there is nothing to send before a response comes in.
+             */
+            loopback_ctx_list_unlock();
+            gb_loopback_wait_completion(LOOPBACK_COMPLETION_WAIT_US);
         } else {
             /*
              * We have to update the wait period of all the loopbacks and
@@ -256,7 +285,7 @@ int gb_loopback_service(void)
             list_foreach(&loopback_ctx_list, iter) {
                 ctx = list_entry(iter, struct loopback_context, list);
                 loopback_ctx_lock(ctx);
-                ctx->left_to_wait -= wait_min;
+                ctx->left_to_wait -= MIN(ctx->left_to_wait, wait_min);
                 loopback_ctx_unlock(ctx);
             }
             loopback_ctx_list_unlock();
@@ -303,13 +332,13 @@ static void print_status_normal(void)
     loopback_ctx_list_lock();
     if (loopback_running_late)
         printf("  Running late\n  %d\n", loopback_running_late);
-    printf("  CPORT    ACTIVE    RECV ERR    SEND ERR    SENT    RECV    THROUGHPUT   LATENCY   REQ_PER_SEC\n");
+    printf("  CPORT    ACTIVE    RECV ERR    SEND ERR    SENT    RECV    THROUGHPUT   LATENCY   REQ_PER_SEC       P50       P90       P99       MAX\n");
     list_foreach(&loopback_ctx_list, iter) {
         ctx = list_entry(iter, struct loopback_context, list);
 
         loopback_ctx_lock(ctx);
         gb_loopback_get_stats(ctx->cport, &stats);
-        printf("%7d %9s %11d %11d %7u %7u %13u %9u %13u\n",
+        printf("%7d %9s %11d %11d %7u %7u %13u %9u %13u %9u %9u %9u %9u\n",
                ctx->cport,
                ctx->active ? "yes" : "no",
                stats.recv_err,
@@ -318,7 +347,11 @@ static void print_status_normal(void)
                stats.recv,
                stats.throughput_avg,
                stats.latency_avg,
-               stats.reqs_per_sec_avg);
+               stats.reqs_per_sec_avg,
+               stats.latency_p50,
+               stats.latency_p90,
+               stats.latency_p99,
+               stats.latency_peak);
         loopback_ctx_unlock(ctx);
     }
     loopback_ctx_list_unlock();
@@ -331,14 +364,14 @@ static void print_status_csv(void)
     struct list_head *iter;
 
     printf("; generated by gbl\n");
-    printf("; iterations, errors, requests per second (min, max, avg, jitter), latency (min, max, avg, jitter), throughput (min, max, avg, jitter)\n");
+    printf("; iterations, errors, requests per second (min, max, avg, jitter), latency (min, max, avg, jitter), throughput (min, max, avg, jitter), latency percentiles (50, 90, 99, max)\n");
     loopback_ctx_list_lock();
     list_foreach(&loopback_ctx_list, iter) {
         ctx = list_entry(iter, struct loopback_context, list);
 
         loopback_ctx_lock(ctx);
         gb_loopback_get_stats(ctx->cport, &stats);
-        printf("%d,%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+        printf("%d,%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
                stats.recv,
                stats.recv_err,
                stats.reqs_per_sec_min,
@@ -352,19 +385,58 @@ static void print_status_csv(void)
                stats.throughput_min,
                stats.throughput_max,
                stats.throughput_avg,
-               stats.throughput_max - stats.throughput_min);
+               stats.throughput_max - stats.throughput_min,
+               stats.latency_p50,
+               stats.latency_p90,
+               stats.latency_p99,
+               stats.latency_peak);
         loopback_ctx_unlock(ctx);
     }
     loopback_ctx_list_unlock();
 }
 
+/*
+ * Parse a comma separated list of cports. Returns the number of cports, or
+ * -1 if the list is invalid.
+ */
+static int parse_cports(char *str, int *cports)
+{
+    char *tok, *save;
+    int count = 0;
+
+    for (tok = strtok_r(str, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        if (count == LOOPBACK_MAX_CPORTS)
+            return -1;
+        if (sscanf(tok, "%d", &cports[count]) != 1 || cports[count] < 0)
+            return -1;
+        count++;
+    }
+
+    return count ? count : -1;
+}
+
+/* No cport given means all of them */
+static int cport_selected(int cport, const int *cports, int num_cports)
+{
+    int i;
+
+    for (i = 0; i < num_cports; i++) {
+        if (cports[i] == cport)
+            return 1;
+    }
+
+    return num_cports == 0;
+}
+
 #ifdef CONFIG_BUILD_KERNEL
 int main(int argc, FAR char *argv[])
 #else
 int gbl_main(int argc, char *argv[])
 #endif
 {
-    int opt, rv = EXIT_SUCCESS, st, cport = -1, type = 0, count = -1;
+    int opt, rv = EXIT_SUCCESS, st, type = 0, count = -1, depth = 0;
+    int cports[LOOPBACK_MAX_CPORTS], num_cports = 0, i;
     struct loopback_context *ctx;
     const char *cmd, *fmt = NULL;
     struct list_head *iter;
@@ -374,11 +446,11 @@ int gbl_main(int argc, char *argv[])
     pthread_once(&loopback_init_once, loopback_init);
 
     optind = -1;
-    while ((opt = getopt (argc, argv, "c:s:t:w:n:f:")) != -1) {
+    while ((opt = getopt (argc, argv, "c:s:t:w:n:i:f:")) != -1) {
         switch (opt) {
         case 'c':
-            st = sscanf(optarg, "%d", &cport);
-            if (st != 1)
+            num_cports = parse_cports(optarg, cports);
+            if (num_cports < 0)
                 goto help;
             break;
         case 's':
@@ -401,6 +473,11 @@ int gbl_main(int argc, char *argv[])
             if (st != 1)
                 goto help;
             break;
+        case 'i':
+            st = sscanf(optarg, "%d", &depth);
+            if (st != 1 || depth < 0)
+                goto help;
+            break;
         case 'f':
             fmt = optarg;
             break;
@@ -414,11 +491,14 @@ int gbl_main(int argc, char *argv[])
         goto help;
     cmd = argv[argc - 1];
 
-    /* Bail-out if the cport is invalid since we would do nothing anyway. */
-    if (cport >= 0 && !gb_loopback_cport_valid(cport)) {
-        fprintf(stderr, "cport %d not registered for gb_loopback\n", cport);
-        rv = EXIT_FAILURE;
-        goto out;
+    /* Bail-out if a cport is invalid since we would do nothing anyway. */
+    for (i = 0; i < num_cports; i++) {
+        if (!gb_loopback_cport_valid(cports[i])) {
+            fprintf(stderr, "cport %d not registered for gb_loopback\n",
+                    cports[i]);
+            rv = EXIT_FAILURE;
+            goto out;
+        }
     }
 
     if (strcmp(cmd, "start") == 0) {
@@ -430,11 +510,16 @@ int gbl_main(int argc, char *argv[])
 
         loopback_ctx_list_lock();
 
+        /*
+         * All the cports are started under the list lock, so that the
+         * service sends their first requests in the same iteration and
+         * keeps them in step.
+         */
         loopback_running_late = 0;
         list_foreach(&loopback_ctx_list, iter) {
             ctx = list_entry(iter, struct loopback_context, list);
 
-            if (cport < 0 || cport == ctx->cport) {
+            if (cport_selected(ctx->cport, cports, num_cports)) {
                 loopback_ctx_lock(ctx);
                 gb_loopback_reset(ctx->cport);
                 ctx->active = 1;
@@ -442,7 +527,9 @@ int gbl_main(int argc, char *argv[])
                 ctx->size = size;
                 ctx->wait = msec_to_usec(wait);
                 ctx->count = count;
+                ctx->depth = depth;
                 ctx->sent = 0;
+                ctx->err = 0;
                 loopback_ctx_unlock(ctx);
             }
         }
@@ -455,7 +542,7 @@ int gbl_main(int argc, char *argv[])
         list_foreach(&loopback_ctx_list, iter) {
             ctx = list_entry(iter, struct loopback_context, list);
 
-            if (cport < 0 || cport == ctx->cport) {
+            if (cport_selected(ctx->cport, cports, num_cports)) {
                 loopback_ctx_lock(ctx);
                 ctx->active = 0;
                 loopback_ctx_unlock(ctx);
@@ -465,7 +552,7 @@ int gbl_main(int argc, char *argv[])
         loopback_ctx_list_unlock();
         loopback_wakeup();
     } else if (strcmp(cmd, "status") == 0) {
-        if (strcmp(fmt, "csv") == 0)
+        if (fmt && strcmp(fmt, "csv") == 0)
             print_status_csv();
         else
             print_status_normal();
@@ -480,18 +567,22 @@ help:
     printf(
         "Greybus loopback tool\n\n"
         "Usage:\n"
-        "\tgbl [-c CPORT] [-s SIZE] [-t ping|xfer|sink] "
-                        "[-w MS] [-n COUNT] [-f csv] start|stop|status\n\n"
+        "\tgbl [-c CPORT[,CPORT...]] [-s SIZE] [-t ping|xfer|sink] "
+                        "[-w MS] [-n COUNT] [-i DEPTH] [-f csv] "
+                        "start|stop|status\n\n"
         "\tCommands:\n"
         "\t\tstart:\t\tstart a loopback command on a cport\n"
         "\t\tstop:\t\tstop the command on given cport\n"
         "\t\tstatus:\t\tshow current status\n\n"
         "\tOptions:\n"
-        "\t\t-c CPORT:\tcport number (all cports if not given)\n"
+        "\t\t-c CPORTS:\tcomma separated cport numbers, loaded together\n"
+        "\t\t\t\t(all cports if not given)\n"
         "\t\t-s SIZE:\tdata size in bytes\n"
         "\t\t-t TYPE:\tloopback operation type\n"
         "\t\t-w MS:\t\ttime to wait before sending next request (in ms)\n"
         "\t\t-n COUNT:\tnumber of requests to send before stopping\n"
+        "\t\t-i DEPTH:\tmaximum requests in flight per cport\n"
+        "\t\t\t\t(no limit if not given)\n"
         "\t\t-f FORMAT:\tspecify a different output format\n"
     );
 
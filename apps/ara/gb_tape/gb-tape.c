@@ -29,25 +29,80 @@
  */
 
 #include <getopt.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <nuttx/greybus/greybus.h>
 #include <nuttx/greybus/tape.h>
 
 static void show_usage(const char *appname)
 {
-    printf("%s [-r filepath] [-p filepath]\n", appname);
+    printf("%s [-r filepath] [-s] [-f] [-x speed] [-p filepath]\n",
+           appname);
     printf("\t-r: tape greybus communication into 'filepath'\n");
     printf("\t-s: stop current taping\n");
+    printf("\t-f: replay as fast as possible instead of in real time\n");
+    printf("\t-x: replay 'speed' times faster than real time\n");
     printf("\t-p: replay greybus tape from 'filepath'\n");
 }
 
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+static void show_handler_stats(void)
+{
+    struct gb_handler_stats stats;
+    const char *name;
+    unsigned int cport;
+    unsigned int i;
+    uint8_t type;
+
+    printf("CPORT TYPE    COUNT      MIN      AVG      MAX HANDLER\n");
+
+    for (cport = 0; cport < gb_cport_count(); cport++) {
+        for (i = 0; !gb_cport_get_handler_stats(cport, i, &type, &name,
+                                                &stats); i++) {
+            if (!stats.count)
+                continue;
+
+            printf("%5u 0x%02x %8u %8u %8u %8u %s\n", cport, type,
+                   stats.count, stats.min,
+                   (uint32_t) (stats.total / stats.count), stats.max, name);
+        }
+    }
+}
+#else
+static void show_handler_stats(void) { }
+#endif
+
+static void show_replay_stats(const struct gb_tape_replay_stats *stats)
+{
+    uint32_t rate = 0;
+
+    if (stats->duration)
+        rate = (uint64_t) stats->messages * 1000000 / stats->duration;
+
+    printf("%u messages, %u bytes in %u us: %u msg/s\n", stats->messages,
+           stats->bytes, stats->duration, rate);
+
+    if (stats->responses) {
+        printf("response latency: min %u us, avg %u us, max %u us\n",
+               stats->latency_min,
+               (uint32_t) (stats->latency_total / stats->responses),
+               stats->latency_max);
+    }
+
+    show_handler_stats();
+}
+
 #ifdef CONFIG_BUILD_KERNEL
 int main(int argc, FAR char *argv[])
 #else
 int gb_tape_main(int argc, char *argv[])
 #endif
 {
+    struct gb_tape_replay_stats stats;
+    unsigned int speed = 1;
     int c;
     int retval;
 
@@ -60,7 +115,7 @@ int gb_tape_main(int argc, char *argv[])
 
     gb_tape_arm_semihosting_register();
 
-    while ((c = getopt(argc, argv, "r:p:s")) != -1) {
+    while ((c = getopt(argc, argv, "r:p:sfx:")) != -1) {
         switch (c) {
         case 'r':
             retval = gb_tape_communication(optarg);
@@ -78,11 +133,21 @@ int gb_tape_main(int argc, char *argv[])
             }
             break;
 
+        case 'f':
+            speed = GB_TAPE_REPLAY_FAST;
+            break;
+
+        case 'x':
+            speed = strtoul(optarg, NULL, 0);
+            break;
+
         case 'p':
-            retval = gb_tape_replay(optarg);
+            retval = gb_tape_replay(optarg, speed, &stats);
             if (retval) {
                 fprintf(stderr, "gb_tape: tape replay error: %s\n",
                         strerror(retval));
+            } else {
+                show_replay_stats(&stats);
             }
             break;
 
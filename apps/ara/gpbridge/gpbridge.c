@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <errno.h>
 
+#include <nuttx/device.h>
 #include <nuttx/greybus/tsb_unipro.h>
 #include <apps/greybus-utils/utils.h>
 #include <apps/ara/service_mgr.h>
@@ -79,6 +80,11 @@ int bridge_main(int argc, char *argv[])
     tsb_unipro_mbox_send(TSB_MAIL_READY_OTHER);
     sem_destroy(&linkup_sem);
 
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+    /* The CPorts are up, probe what the manifest did not need */
+    device_probe_deferred();
+#endif
+
 #ifdef CONFIG_EXAMPLES_NSH
     printf("Calling NSH\n");
     return nsh_main(argc, argv);
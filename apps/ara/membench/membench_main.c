@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/hires_tmr.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMBENCH_BUFSIZE    4096
+#define MEMBENCH_ITERATIONS 200
+
+#ifndef CONFIG_ARA_MEMBENCH_CPU_MHZ
+#define CONFIG_ARA_MEMBENCH_CPU_MHZ 96
+#endif
+
+static uint8_t g_src[MEMBENCH_BUFSIZE + 8];
+static uint8_t g_dst[MEMBENCH_BUFSIZE + 8];
+static uint8_t g_ref[MEMBENCH_BUFSIZE + 8];
+
+static const size_t g_sizes[] = { 4, 16, 64, 256, 1024, 4096 };
+
+#define MEMBENCH_NSIZES (sizeof(g_sizes) / sizeof(g_sizes[0]))
+
+enum membench_op {
+    MEMBENCH_MEMCPY,
+    MEMBENCH_MEMSET,
+    MEMBENCH_MEMMOVE_UP,
+    MEMBENCH_MEMMOVE_DOWN,
+    MEMBENCH_MEMCMP,
+    MEMBENCH_STRLEN,
+    MEMBENCH_STRCMP,
+    MEMBENCH_NMEMOPS,
+
+    /* Formatting, size and alignment do not apply */
+    MEMBENCH_PRINTF_LITERAL = MEMBENCH_NMEMOPS,
+    MEMBENCH_PRINTF_INT,
+    MEMBENCH_PRINTF_HEX,
+    MEMBENCH_PRINTF_STR,
+    MEMBENCH_NOPS,
+};
+
+static const char *g_names[MEMBENCH_NOPS] = {
+    "memcpy", "memset", "memmove+", "memmove-", "memcmp", "strlen",
+    "strcmp", "printf-lit", "printf-%d", "printf-%x", "printf-%s",
+};
+
+static const char g_text[] = "The quick brown fox jumps over the lazy dog";
+
+static void membench_fill(void)
+{
+    int i;
+
+    for (i = 0; i < sizeof(g_src); i++) {
+        g_src[i] = i * 7 + 1;
+        g_dst[i] = i * 13 + 5;
+    }
+}
+
+/* Make identical strings of size - 1 characters at align in both buffers */
+static void membench_fill_str(size_t size, int align)
+{
+    memset(g_src, 0, sizeof(g_src));
+    memset(g_src + align, 'a', size - 1);
+    memcpy(g_dst, g_src, sizeof(g_dst));
+}
+
+/* Run the operation once; overlapping moves work within g_dst */
+static int membench_run(enum membench_op op, size_t size, int align)
+{
+    char *dst = (char *)g_dst;
+
+    switch (op) {
+    case MEMBENCH_MEMCPY:
+        memcpy(g_dst + align, g_src, size);
+        break;
+    case MEMBENCH_MEMSET:
+        memset(g_dst + align, 0xa5, size);
+        break;
+    case MEMBENCH_MEMMOVE_UP:
+        memmove(g_dst + align + 4, g_dst, size);
+        break;
+    case MEMBENCH_MEMMOVE_DOWN:
+        memmove(g_dst, g_dst + align + 4, size);
+        break;
+    case MEMBENCH_MEMCMP:
+        return memcmp(g_dst + align, g_src + align, size);
+    case MEMBENCH_STRLEN:
+        return strlen((char *)g_src + align);
+    case MEMBENCH_STRCMP:
+        return strcmp(dst + align, (char *)g_src + align);
+    case MEMBENCH_PRINTF_LITERAL:
+        return snprintf(dst, MEMBENCH_BUFSIZE,
+                        "The quick brown fox jumps over the lazy dog\n");
+    case MEMBENCH_PRINTF_INT:
+        return snprintf(dst, MEMBENCH_BUFSIZE, "%d %d %d %d\n",
+                        12345, -678, 2147483647, 0);
+    case MEMBENCH_PRINTF_HEX:
+        return snprintf(dst, MEMBENCH_BUFSIZE, "%08x %08x %x %x\n",
+                        0xdeadbeef, 0x1234, 0xcafe, 0);
+    case MEMBENCH_PRINTF_STR:
+        return snprintf(dst, MEMBENCH_BUFSIZE, "%s: %s\n", "fox", g_text);
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/* Byte by byte reference of membench_run() on g_ref */
+static int membench_reference(enum membench_op op, size_t size, int align)
+{
+    size_t i;
+
+    switch (op) {
+    case MEMBENCH_MEMCPY:
+        for (i = 0; i < size; i++)
+            g_ref[align + i] = g_src[i];
+        break;
+    case MEMBENCH_MEMSET:
+        for (i = 0; i < size; i++)
+            g_ref[align + i] = 0xa5;
+        break;
+    case MEMBENCH_MEMMOVE_UP:
+        for (i = size; i > 0; i--)
+            g_ref[align + 4 + i - 1] = g_ref[i - 1];
+        break;
+    case MEMBENCH_MEMMOVE_DOWN:
+        for (i = 0; i < size; i++)
+            g_ref[i] = g_ref[align + 4 + i];
+        break;
+    case MEMBENCH_MEMCMP:
+    case MEMBENCH_STRCMP:
+        for (i = 0; i < size; i++) {
+            if (g_ref[align + i] != g_src[align + i])
+                return g_ref[align + i] - g_src[align + i];
+        }
+        break;
+    case MEMBENCH_STRLEN:
+        for (i = 0; g_src[align + i]; i++)
+            ;
+        return i;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int sign(int v)
+{
+    return v < 0 ? -1 : v > 0;
+}
+
+static int membench_check(enum membench_op op, size_t size, int align)
+{
+    int ret;
+    int ref;
+
+    if (op == MEMBENCH_STRLEN || op == MEMBENCH_STRCMP) {
+        membench_fill_str(size, align);
+    } else {
+        membench_fill();
+    }
+
+    /* Make memcmp() and strcmp() stop on the last character */
+    if (op == MEMBENCH_MEMCMP) {
+        memcpy(g_dst, g_src, sizeof(g_dst));
+        g_dst[align + size - 1]++;
+    } else if (op == MEMBENCH_STRCMP) {
+        g_dst[align + size - 2]++;
+    }
+
+    memcpy(g_ref, g_dst, sizeof(g_ref));
+
+    ret = membench_run(op, size, align);
+    ref = membench_reference(op, size, align);
+
+    if ((op == MEMBENCH_STRLEN ? ret != ref : sign(ret) != sign(ref)) ||
+        memcmp(g_dst, g_ref, sizeof(g_dst))) {
+        printf("%s: size %u align %d: FAILED\n", g_names[op], size, align);
+        return -1;
+    }
+
+    return 0;
+}
+
+static uint32_t membench_time(enum membench_op op, size_t size, int align)
+{
+    uint32_t start;
+    int i;
+
+    if (op == MEMBENCH_STRLEN || op == MEMBENCH_STRCMP) {
+        membench_fill_str(size, align);
+    } else {
+        membench_fill();
+        if (op == MEMBENCH_MEMCMP)
+            memcpy(g_dst, g_src, sizeof(g_dst));
+    }
+
+    start = hrt_getusec();
+    for (i = 0; i < MEMBENCH_ITERATIONS; i++)
+        membench_run(op, size, align);
+
+    return hrt_getusec() - start;
+}
+
+static void membench_print(enum membench_op op, size_t size, int align,
+                           uint32_t usec)
+{
+    uint64_t cycles = (uint64_t)usec * CONFIG_ARA_MEMBENCH_CPU_MHZ;
+    uint32_t cpb = cycles * 100 / ((uint64_t)size * MEMBENCH_ITERATIONS);
+
+    printf("%-10s %6u %5d %10u %4u.%02u %8u\n", g_names[op], size, align,
+           usec * (1000 / MEMBENCH_ITERATIONS), cpb / 100, cpb % 100,
+           usec ? size * MEMBENCH_ITERATIONS / usec : 0);
+}
+
+int membench_main(int argc, char **argv)
+{
+    enum membench_op op;
+    size_t size;
+    int failed = 0;
+    int align;
+    int i;
+
+    /* Check first, a broken routine makes the numbers meaningless */
+    for (op = 0; op < MEMBENCH_NMEMOPS; op++) {
+        for (i = 0; i < MEMBENCH_NSIZES; i++) {
+            for (align = 0; align < 4; align++) {
+                if (membench_check(op, g_sizes[i] - (align & 1), align))
+                    failed++;
+            }
+        }
+    }
+
+    if (failed) {
+        printf("%d checks failed\n", failed);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %6s %5s %10s %7s %8s\n", "OP", "SIZE", "ALIGN",
+           "NSEC/CALL", "CYC/B", "MB/S");
+
+    for (op = 0; op < MEMBENCH_NMEMOPS; op++) {
+        for (i = 0; i < MEMBENCH_NSIZES; i++) {
+            for (align = 0; align < 2; align++) {
+                size = g_sizes[i];
+                membench_print(op, size, align,
+                               membench_time(op, size, align));
+            }
+        }
+    }
+
+    /* For formatting, the size is that of the output */
+    for (op = MEMBENCH_NMEMOPS; op < MEMBENCH_NOPS; op++) {
+        size = membench_run(op, 0, 0);
+        membench_print(op, size, 0, membench_time(op, 0, 0));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -42,6 +42,7 @@
 #include "ara_board.h"
 #include "interface.h"
 #include "attr_names.h"
+#include "link_pm.h"
 
 /* These are the largest possible values -- not necessarily the
  * largest supported values. */
@@ -61,6 +62,7 @@ enum {
     QOS,
     RELEASE,
     IDMOD,
+    LINKPM,
     MAX_CMD,
 };
 
@@ -83,6 +85,7 @@ static const struct command commands[] = {
     [IDMOD] = {'m', "idmod", "Identify module and boot status"},
     [QOS] = {'q', "qos", "Quality of Service control"},
     [RELEASE] = {'x', "release", "Pulse module release signals"},
+    [LINKPM] = {'p', "linkpm", "print UniPro link power mode statistics"},
 };
 
 static char *seltostr(uint16_t sel, char *buf) {
@@ -133,6 +136,15 @@ static void link_test_usage(int exit_status) {
            "               various mode, gear, and \"auto\" mode settings.\n"
            "               The output details the test parameters.\n"
            "               If set, other options are ignored.\n");
+    printf("\n");
+    printf("Options for benchmarking a pair of ports:\n");
+    printf("    -b <interface>: Benchmark the link between the -i interface\n"
+           "                    and this one with the switch test traffic, for\n"
+           "                    every mode, gear, series, \"auto\" variant and\n"
+           "                    lane count up to -l. Prints one CSV line per\n"
+           "                    setting with the throughput and link errors.\n");
+    printf("    -D <ms>     : Test traffic duration per setting. Default is 1000.\n");
+    printf("    -z <size>   : Test traffic message size. Default is 272.\n");
     exit(exit_status);
 }
 
@@ -382,6 +394,166 @@ static int link_test_torture(unsigned int nlanes) {
     return rc;
 }
 
+struct link_bench_setting {
+    int hs;
+    unsigned int gear;
+    unsigned int flags;
+    enum unipro_hs_series series;
+};
+
+static uint32_t link_bench_errors(struct tsb_switch *sw, uint8_t port) {
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < SWITCH_PORT_ERR_MAX; i++) {
+        sum += sw->port_errors[port][i];
+    }
+
+    return sum;
+}
+
+/*
+ * Assign device IDs for test interfaces. Device ID 0 is reserved by the
+ * switch.
+ */
+static int test_feature_set_dev_ids(struct tsb_switch *sw,
+                                    struct interface *src_iface,
+                                    struct interface *dst_iface) {
+    struct interface *ifaces[] = { src_iface, dst_iface };
+    unsigned int devid;
+    int i, rc;
+
+    for (i = 0; i < ARRAY_SIZE(ifaces); i++) {
+        devid = ifaces[i]->switch_portid + 1;
+        rc = switch_if_dev_id_set(sw, ifaces[i]->switch_portid, devid);
+        if (rc) {
+            printf("svc testfeature: Failed to assign device id: %u to interface %s: %d\n",
+                   devid, ifaces[i]->name, rc);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Sweep the link settings of two ports and measure, for each of them, the
+ * throughput of the switch test traffic between the ports and the error
+ * indications of both links. The output is a CSV matrix.
+ */
+static int link_test_bench(struct interface *src_iface,
+                           struct interface *dst_iface,
+                           unsigned int nlanes, unsigned int duration_ms,
+                           uint16_t msgsize) {
+    static struct link_bench_setting settings[(PWM_GEAR_MAX + 2 * HS_GEAR_MAX) * 2];
+    const int hs_maxgear = 3;   /* max HS gear to _test_. */
+    const int pwm_maxgear = 4;  /* max PWM gear to _test_. */
+    struct tsb_switch *sw = svc->sw;
+    struct unipro_test_feature_cfg cfg = {
+        .tf_src_inc = 1,
+        .tf_src_size = msgsize,
+        .tf_src_count = 0,
+        .tf_dst_error_detection_enable = true,
+    };
+    uint8_t src = src_iface->switch_portid;
+    uint8_t dst = dst_iface->switch_portid;
+    unsigned int nsettings = 0;
+    unsigned int lanes;
+    unsigned int i;
+    int a, g, s;
+    int rc;
+
+    if (!sw) {
+        return -ENODEV;
+    }
+
+    for (g = 1; g <= pwm_maxgear; g++) {
+        for (a = 0; a <= 1; a++) {
+            settings[nsettings++] = (struct link_bench_setting) {
+                0, g, a ? UNIPRO_LINK_CFGF_AUTO : 0,
+                UNIPRO_HS_SERIES_UNCHANGED,
+            };
+        }
+    }
+    for (g = 1; g <= hs_maxgear; g++) {
+        for (a = 0; a <= 1; a++) {
+            for (s = 0; s <= 1; s++) {
+                settings[nsettings++] = (struct link_bench_setting) {
+                    1, g, a ? UNIPRO_LINK_CFGF_AUTO : 0,
+                    s ? UNIPRO_HS_SERIES_B : UNIPRO_HS_SERIES_A,
+                };
+            }
+        }
+    }
+
+    rc = test_feature_set_dev_ids(sw, src_iface, dst_iface);
+    if (rc) {
+        return rc;
+    }
+
+    rc = svc_connect_interfaces(src_iface, cfg.tf_src_cportid, dst_iface,
+                                cfg.tf_dst_cportid, CPORT_TC0,
+                                CPORT_FLAGS_CSD_N | CPORT_FLAGS_CSV_N);
+    if (rc) {
+        printf("Couldn't connect %s to %s: %d\n", src_iface->name,
+               dst_iface->name, rc);
+        return rc;
+    }
+
+    printf("src,dst,mode,gear,series,auto,lanes,status,messages,kBps,"
+           "src_errors,dst_errors,dst_error_code\n");
+
+    for (lanes = 1; lanes <= nlanes; lanes++) {
+        for (i = 0; i < nsettings; i++) {
+            struct link_bench_setting *set = &settings[i];
+            uint32_t src_errors, dst_errors;
+            uint32_t count = 0, error_code = 0;
+            const char *status = "ok";
+
+            printf("%s,%s,%s,%u,%s,%u,%u,", src_iface->name, dst_iface->name,
+                   set->hs ? "hs" : "pwm", set->gear,
+                   set->series == UNIPRO_HS_SERIES_A ? "A" :
+                   set->series == UNIPRO_HS_SERIES_B ? "B" : "-",
+                   !!(set->flags & UNIPRO_LINK_CFGF_AUTO), lanes);
+
+            if (link_test_port(src, set->hs, set->gear, lanes, set->flags,
+                               set->series) ||
+                link_test_port(dst, set->hs, set->gear, lanes, set->flags,
+                               set->series)) {
+                printf("config_failed,,,,,\n");
+                continue;
+            }
+
+            src_errors = link_bench_errors(sw, src);
+            dst_errors = link_bench_errors(sw, dst);
+
+            rc = switch_enable_test_traffic(sw, src, dst, &cfg);
+            if (rc) {
+                printf("traffic_failed,,,,,\n");
+                continue;
+            }
+
+            usleep(duration_ms * 1000);
+
+            if (switch_get_test_traffic_stats(sw, dst, &cfg, &count,
+                                              &error_code)) {
+                status = "stats_failed";
+            } else if (error_code) {
+                status = "data_error";
+            }
+
+            switch_disable_test_traffic(sw, src, dst, &cfg);
+
+            printf("%s,%u,%u,%u,%u,0x%x\n", status, count,
+                   (uint32_t)((uint64_t)count * msgsize / duration_ms),
+                   link_bench_errors(sw, src) - src_errors,
+                   link_bench_errors(sw, dst) - dst_errors, error_code);
+        }
+    }
+
+    return 0;
+}
+
 static int link_test(int argc, char *argv[]) {
     char **args = argv + 1;
     int c;
@@ -397,8 +569,12 @@ static int link_test(int argc, char *argv[]) {
     enum unipro_hs_series series = UNIPRO_HS_SERIES_UNCHANGED;
     /* Whether or not to torture test. */
     int torture = 0;
+    /* Benchmark peer interface, duration and message size. */
+    const char *bench_iface_name = NULL;
+    int duration_ms = 1000;
+    int msgsize = 272;
 
-    const char opts[] = "hi:p:m:g:l:ats:";
+    const char opts[] = "hi:p:m:g:l:ats:b:D:z:";
 
     argc--;
     optind = -1; /* Force NuttX's getopt() to reinitialize. */
@@ -436,6 +612,15 @@ static int link_test(int argc, char *argv[]) {
         case 't':
             torture = 1;
             break;
+        case 'b':
+            bench_iface_name = optarg;
+            break;
+        case 'D':
+            duration_ms = strtol(optarg, NULL, 10);
+            break;
+        case 'z':
+            msgsize = strtol(optarg, NULL, 10);
+            break;
         case 's':
             if (!strcmp(optarg, "A") || !strcmp(optarg, "a")) {
                 series = UNIPRO_HS_SERIES_A;
@@ -454,6 +639,30 @@ static int link_test(int argc, char *argv[]) {
         }
     }
 
+    if (bench_iface_name) {
+        struct interface *src_iface = NULL, *dst_iface;
+
+        if (iface_name) {
+            src_iface = interface_get_by_name(iface_name);
+        }
+        dst_iface = interface_get_by_name(bench_iface_name);
+        if (!src_iface || !dst_iface || src_iface == dst_iface ||
+            src_iface->switch_portid == INVALID_PORT ||
+            dst_iface->switch_portid == INVALID_PORT) {
+            printf("-b needs two different interfaces with a port, the "
+                   "other one given by -i.\n");
+            link_test_usage(EXIT_FAILURE);
+        }
+        if (nlanes <= 0 || nlanes > PA_CONN_RX_DATA_LANES_NR ||
+            duration_ms <= 0 || msgsize <= 0 || msgsize > UINT16_MAX) {
+            printf("Invalid number of lanes, duration or message size.\n");
+            link_test_usage(EXIT_FAILURE);
+        }
+
+        return link_test_bench(src_iface, dst_iface, (unsigned int)nlanes,
+                               (unsigned int)duration_ms, (uint16_t)msgsize);
+    }
+
     if (iface_name) {
         struct interface *iface = interface_get_by_name(iface_name);
         if (iface) {
@@ -526,6 +735,39 @@ static int link_status(int argc, char *argv[]) {
     return rc;
 }
 
+static int link_pm_status(int argc, char *argv[])
+{
+#ifdef CONFIG_ARA_SVC_LINK_PM
+    struct link_pm_stats stats;
+    uint8_t port;
+    int i;
+
+    if (!svc->sw) {
+        return -ENODEV;
+    }
+
+    for (port = 0; port < SWITCH_UNIPORT_MAX; port++) {
+        if (link_pm_get_stats(port, &stats) ||
+            (!stats.managed && !stats.mode_changes)) {
+            continue;
+        }
+
+        printf("Port %u: %s, %s (max %s), %u mode changes\n", port,
+               stats.managed ? "managed" : "not managed",
+               link_pm_mode_name(stats.mode),
+               link_pm_mode_name(stats.max_mode), stats.mode_changes);
+        for (i = 0; i < LINK_PM_NR_MODES; i++) {
+            printf("    %-10s %u ms\n", link_pm_mode_name(i), stats.time_ms[i]);
+        }
+    }
+
+    return 0;
+#else
+    printf("Link power policy not supported (see CONFIG_ARA_SVC_LINK_PM)\n");
+    return -EOPNOTSUPP;
+#endif
+}
+
 static int dump_routing_table(int argc, char *argv[])
 {
     struct tsb_switch *sw = svc->sw;
@@ -1089,7 +1331,6 @@ static int test_feature(int argc, char* argv[]) {
     char** args;
     int rc, c;
     struct unipro_test_feature_cfg cfg;
-    unsigned int src_devid, dst_devid;
 
     if (!sw) {
         return -ENODEV;
@@ -1179,23 +1420,8 @@ static int test_feature(int argc, char* argv[]) {
         test_feature_usage(EXIT_FAILURE);
     }
 
-    /*
-     * Assign device IDs for test interfaces. Device ID 0 is reserved
-     * by the switch.
-     */
-    src_devid = src_iface->switch_portid + 1;
-    rc = switch_if_dev_id_set(sw, src_iface->switch_portid, src_devid);
-    if (rc) {
-        printf("svc testfeature: Failed to assign device id: %u to interface %s: %d\n",
-               src_devid, src_iface_name, rc);
-        test_feature_usage(EXIT_FAILURE);
-    }
-
-    dst_devid = dst_iface->switch_portid + 1;
-    rc = switch_if_dev_id_set(sw, dst_iface->switch_portid, dst_devid);
+    rc = test_feature_set_dev_ids(sw, src_iface, dst_iface);
     if (rc) {
-        printf("svc testfeature: Failed to assign device id: %u to interface %s: %d\n",
-               dst_devid, dst_iface_name, rc);
         test_feature_usage(EXIT_FAILURE);
     }
 
@@ -2095,6 +2321,9 @@ int svc_main(int argc, char *argv[])
     case IDMOD:
         rc = idmod(argc, argv);
         break;
+    case LINKPM:
+        rc = link_pm_status(argc, argv);
+        break;
     default:
         usage(EXIT_FAILURE);
     }
@@ -0,0 +1,504 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Raw UniPro CPort benchmark, bypassing Greybus.
+ *
+ * One bridge runs "unipro bench tx" and sends messages on a range of CPorts,
+ * keeping a fixed number of them in flight per CPort, while the bridge on the
+ * other end of the connections runs "unipro bench peer" and either drops or
+ * echoes them. Without echo, a message completes when the TX path is done
+ * with it, which measures the local link and DMA throughput. With echo, it
+ * completes when it comes back from the peer, which measures round trips.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/unipro/unipro.h>
+#include <arch/irq.h>
+
+#include <errno.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "unipro_bench.h"
+
+#define BENCH_MAX_SLOTS         64
+#define BENCH_MAX_SAMPLES       2048
+#define BENCH_ECHO_QUEUE        16
+
+#define BENCH_DEFAULT_CPORT     4
+#define BENCH_DEFAULT_SIZE      CPORT_BUF_SIZE
+#define BENCH_DEFAULT_DEPTH     4
+#define BENCH_DEFAULT_COUNT     1000
+#define BENCH_DEFAULT_TIMEOUT   5
+
+struct bench_slot {
+    unsigned int cport;
+    uint32_t start;
+    bool busy;
+    uint8_t *buf;
+};
+
+struct bench_echo {
+    unsigned int cport;
+    void *data;
+    size_t len;
+};
+
+static struct {
+    sem_t sem;
+    bool echo;
+    size_t size;
+
+    struct bench_slot slots[BENCH_MAX_SLOTS];
+    unsigned int free_slots[BENCH_MAX_SLOTS];
+    unsigned int free_count;
+    unsigned int completed;
+    unsigned int errors;
+
+    uint32_t samples[BENCH_MAX_SAMPLES];
+    unsigned int sample_count;
+
+    struct bench_echo echo_queue[BENCH_ECHO_QUEUE];
+    unsigned int echo_head;
+    unsigned int echo_tail;
+    unsigned int rx_msgs;
+    uint64_t rx_bytes;
+    uint32_t rx_first;
+    uint32_t rx_last;
+} bench;
+
+static void bench_usage(const char *name)
+{
+    printf("Usage: %s bench tx [-c cport] [-n cports] [-s size] [-q depth]"
+           " [-m count] [-e] [-t timeout]\n", name);
+    printf("       %s bench peer [-c cport] [-n cports] [-e] [-t timeout]\n",
+           name);
+    printf("\t-c\t First CPort (default %u)\n", BENCH_DEFAULT_CPORT);
+    printf("\t-n\t Number of CPorts (default 1)\n");
+    printf("\t-s\t Message size in bytes (default %u)\n", BENCH_DEFAULT_SIZE);
+    printf("\t-q\t Messages in flight per CPort (default %u)\n",
+           BENCH_DEFAULT_DEPTH);
+    printf("\t-m\t Messages to send (default %u)\n", BENCH_DEFAULT_COUNT);
+    printf("\t-e\t Messages are echoed by the peer\n");
+    printf("\t-t\t Seconds without traffic before giving up (default %u)\n",
+           BENCH_DEFAULT_TIMEOUT);
+}
+
+static int bench_wait(unsigned int timeout)
+{
+    struct timespec abstime;
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += timeout;
+
+    while (sem_timedwait(&bench.sem, &abstime) < 0) {
+        if (errno != EINTR)
+            return -errno;
+    }
+
+    return 0;
+}
+
+/*
+ * Called in irq context, or from the UniPro TX worker
+ */
+static void bench_complete(unsigned int slot)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    if (!bench.slots[slot].busy) {
+        irqrestore(flags);
+        return;
+    }
+
+    bench.slots[slot].busy = false;
+    if (bench.sample_count < BENCH_MAX_SAMPLES) {
+        bench.samples[bench.sample_count++] =
+            hrt_getusec() - bench.slots[slot].start;
+    }
+    bench.completed++;
+    bench.free_slots[bench.free_count++] = slot;
+    irqrestore(flags);
+
+    sem_post(&bench.sem);
+}
+
+static int bench_tx_done(int status, const void *buf, void *priv)
+{
+    unsigned int slot = (uintptr_t) priv;
+
+    if (status)
+        bench.errors++;
+
+    if (!bench.echo || status)
+        bench_complete(slot);
+
+    return 0;
+}
+
+/*
+ * Called in irq context
+ */
+static int bench_tx_rx_handler(unsigned int cportid, void *data, size_t len)
+{
+    uint32_t slot;
+
+    if (len >= sizeof(slot)) {
+        memcpy(&slot, data, sizeof(slot));
+        if (slot < BENCH_MAX_SLOTS)
+            bench_complete(slot);
+    }
+
+    unipro_rxbuf_free(cportid, data);
+    return 0;
+}
+
+/*
+ * Called in irq context
+ */
+static int bench_peer_rx_handler(unsigned int cportid, void *data, size_t len)
+{
+    struct bench_echo *echo;
+    uint32_t now = hrt_getusec();
+
+    if (!bench.rx_msgs)
+        bench.rx_first = now;
+    bench.rx_last = now;
+    bench.rx_msgs++;
+    bench.rx_bytes += len;
+
+    if (!bench.echo ||
+        bench.echo_head - bench.echo_tail >= BENCH_ECHO_QUEUE) {
+        unipro_rxbuf_free(cportid, data);
+        sem_post(&bench.sem);
+        return 0;
+    }
+
+    echo = &bench.echo_queue[bench.echo_head++ % BENCH_ECHO_QUEUE];
+    echo->cport = cportid;
+    echo->data = data;
+    echo->len = len;
+
+    sem_post(&bench.sem);
+    return 0;
+}
+
+static struct unipro_driver bench_tx_driver = {
+    .name = "unipro-bench-tx",
+    .rx_handler = bench_tx_rx_handler,
+};
+
+static struct unipro_driver bench_peer_driver = {
+    .name = "unipro-bench-peer",
+    .rx_handler = bench_peer_rx_handler,
+};
+
+static int bench_register(struct unipro_driver *driver, unsigned int cport,
+                          unsigned int count)
+{
+    unsigned int i;
+    int retval;
+
+    for (i = 0; i < count; i++) {
+        retval = unipro_driver_register(driver, cport + i);
+        if (retval) {
+            printf("Cannot register on CP%u: %d\n", cport + i, retval);
+            while (i--)
+                unipro_driver_unregister(cport + i);
+            return retval;
+        }
+    }
+
+    return 0;
+}
+
+static void bench_unregister(unsigned int cport, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        unipro_driver_unregister(cport + i);
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void bench_print_rate(unsigned int msgs, uint64_t bytes,
+                             uint32_t elapsed)
+{
+    uint32_t rate;
+
+    if (!elapsed)
+        elapsed = 1;
+
+    /* bytes per microsecond are MB/s */
+    rate = (bytes * 100) / elapsed;
+    printf("%u messages, %llu bytes in %u us: %u.%02u MB/s, %llu msgs/s\n",
+           msgs, bytes, elapsed, rate / 100, rate % 100,
+           ((uint64_t) msgs * 1000000) / elapsed);
+}
+
+static void bench_print_latency(void)
+{
+    unsigned int n = bench.sample_count;
+
+    if (!n)
+        return;
+
+    qsort(bench.samples, n, sizeof(bench.samples[0]), bench_compare);
+    printf("latency (us): min %u p50 %u p90 %u p99 %u max %u\n",
+           bench.samples[0], bench.samples[n * 50 / 100],
+           bench.samples[n * 90 / 100], bench.samples[n * 99 / 100],
+           bench.samples[n - 1]);
+}
+
+static int bench_tx(unsigned int cport, unsigned int cports, size_t size,
+                    unsigned int depth, unsigned int count,
+                    unsigned int timeout)
+{
+    struct bench_slot *slot;
+    irqstate_t flags;
+    unsigned int sent = 0;
+    unsigned int index;
+    unsigned int nslots = cports * depth;
+    uint32_t start;
+    uint32_t elapsed;
+    int retval = 0;
+
+    if (!nslots || nslots > BENCH_MAX_SLOTS) {
+        printf("CPorts * depth must be between 1 and %u\n", BENCH_MAX_SLOTS);
+        return -EINVAL;
+    }
+
+    if (size < sizeof(uint32_t) || size > CPORT_BUF_SIZE) {
+        printf("Message size must be between %u and %u\n", sizeof(uint32_t),
+               CPORT_BUF_SIZE);
+        return -EINVAL;
+    }
+
+    if (bench.echo) {
+        retval = bench_register(&bench_tx_driver, cport, cports);
+        if (retval)
+            return retval;
+    }
+
+    for (index = 0; index < nslots; index++) {
+        slot = &bench.slots[index];
+        slot->cport = cport + index % cports;
+        slot->buf = malloc(size);
+        if (!slot->buf) {
+            retval = -ENOMEM;
+            goto out;
+        }
+
+        memset(slot->buf, index, size);
+        memcpy(slot->buf, &index, sizeof(uint32_t));
+        bench.free_slots[nslots - index - 1] = index;
+    }
+    bench.free_count = nslots;
+
+    start = hrt_getusec();
+
+    while (bench.completed < count) {
+        flags = irqsave();
+        while (sent < count && bench.free_count) {
+            index = bench.free_slots[--bench.free_count];
+            irqrestore(flags);
+
+            slot = &bench.slots[index];
+            slot->start = hrt_getusec();
+            slot->busy = true;
+            retval = unipro_send_async(slot->cport, slot->buf, size,
+                                       bench_tx_done,
+                                       (void *)(uintptr_t) index);
+            if (retval) {
+                flags = irqsave();
+                slot->busy = false;
+                bench.free_slots[bench.free_count++] = index;
+                irqrestore(flags);
+                printf("Cannot send on CP%u: %d\n", slot->cport, retval);
+                goto wait_inflight;
+            }
+            sent++;
+
+            flags = irqsave();
+        }
+        irqrestore(flags);
+
+        if (bench.completed >= count)
+            break;
+
+        retval = bench_wait(timeout);
+        if (retval) {
+            printf("Timeout, %u messages completed\n", bench.completed);
+            goto wait_inflight;
+        }
+    }
+
+    elapsed = hrt_getusec() - start;
+    bench_print_rate(bench.completed, (uint64_t) bench.completed * size,
+                     elapsed);
+    bench_print_latency();
+    if (bench.errors)
+        printf("%u messages failed\n", bench.errors);
+
+wait_inflight:
+    /* let the messages in flight complete before freeing their buffers */
+    while (bench.free_count < nslots && !bench_wait(timeout));
+
+out:
+    if (bench.echo)
+        bench_unregister(cport, cports);
+
+    for (index = 0; index < nslots; index++) {
+        free(bench.slots[index].buf);
+        bench.slots[index].buf = NULL;
+    }
+
+    return retval;
+}
+
+static int bench_peer(unsigned int cport, unsigned int cports,
+                      unsigned int timeout)
+{
+    struct bench_echo *echo;
+    int retval;
+
+    retval = bench_register(&bench_peer_driver, cport, cports);
+    if (retval)
+        return retval;
+
+    printf("Waiting for messages on CP%u-CP%u\n", cport, cport + cports - 1);
+
+    while (!bench_wait(timeout) || !bench.rx_msgs) {
+        while (bench.echo_tail != bench.echo_head) {
+            echo = &bench.echo_queue[bench.echo_tail % BENCH_ECHO_QUEUE];
+
+            retval = unipro_send(echo->cport, echo->data, echo->len);
+            if (retval)
+                bench.errors++;
+
+            unipro_rxbuf_free(echo->cport, echo->data);
+            bench.echo_tail++;
+        }
+    }
+
+    bench_unregister(cport, cports);
+
+    bench_print_rate(bench.rx_msgs, bench.rx_bytes,
+                     bench.rx_last - bench.rx_first);
+    if (bench.errors)
+        printf("%u echoes failed\n", bench.errors);
+
+    return 0;
+}
+
+int unipro_bench(int argc, char **argv)
+{
+    unsigned int cport = BENCH_DEFAULT_CPORT;
+    unsigned int cports = 1;
+    unsigned int depth = BENCH_DEFAULT_DEPTH;
+    unsigned int count = BENCH_DEFAULT_COUNT;
+    unsigned int timeout = BENCH_DEFAULT_TIMEOUT;
+    size_t size = BENCH_DEFAULT_SIZE;
+    const char *mode;
+    int retval;
+    int c;
+
+    if (argc < 3) {
+        bench_usage(argv[0]);
+        return -EINVAL;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    mode = argv[2];
+
+    optind = -1; /* Force NuttX's getopt() to re-initialize. */
+    while ((c = getopt(argc - 2, argv + 2, "c:n:s:q:m:et:")) != -1) {
+        switch (c) {
+        case 'c':
+            cport = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            cports = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            size = strtoul(optarg, NULL, 10);
+            break;
+        case 'q':
+            depth = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            count = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            bench.echo = true;
+            break;
+        case 't':
+            timeout = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            bench_usage(argv[0]);
+            return -EINVAL;
+        }
+    }
+
+    if (!cports || !timeout) {
+        bench_usage(argv[0]);
+        return -EINVAL;
+    }
+
+    sem_init(&bench.sem, 0, 0);
+
+    if (!strcmp(mode, "tx")) {
+        retval = bench_tx(cport, cports, size, depth, count, timeout);
+    } else if (!strcmp(mode, "peer")) {
+        retval = bench_peer(cport, cports, timeout);
+    } else {
+        bench_usage(argv[0]);
+        retval = -EINVAL;
+    }
+
+    sem_destroy(&bench.sem);
+
+    return retval;
+}
@@ -34,6 +34,10 @@
 #include <string.h>
 #include <unistd.h>
 
+#ifdef CONFIG_ARA_UNIPRO_MAIN_BENCH
+#include "unipro_bench.h"
+#endif
+
 #define NUM_CPORTS   (4)
 
 #define xstr(s) str(s)
@@ -100,7 +104,14 @@ static int attr_read(int argc, char **argv) {
 
 static void print_usage(char **argv) {
     printf("Usage: %s -r attr | -w attr [-s <selector>] [-p] | "
-           "cport_reset <cport_id>\n", argv[0]);
+           "cport_reset <cport_id> | tx_weight <cport_id> <weight> | rx_stats"
+#ifdef CONFIG_ARA_UNIPRO_MAIN_BENCH
+           " | bench <tx|peer> [options]"
+#endif
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+           " | dma"
+#endif
+           "\n", argv[0]);
     printf("\tOptions:\n");
     printf("\t-r\t Read an attribute\n");
     printf("\t-w\t Write an attribute\n");
@@ -171,6 +182,37 @@ int unipro_main(int argc, char **argv) {
             rc = -1;
         }
         exit((rc == 0) ? 0 : 1);
+    } else if (!strcmp(op, "tx_weight") && argc == 4) {
+        rc = unipro_set_tx_weight(strtoul(argv[2], NULL, 10),
+                                  strtoul(argv[3], NULL, 10));
+        if (rc) {
+            printf("Failed to set TX weight. rc: %d\n", rc);
+            exit(1);
+        }
+        return 0;
+#ifdef CONFIG_ARA_UNIPRO_MAIN_BENCH
+    } else if (!strcmp(op, "bench")) {
+        return unipro_bench(argc, argv);
+#endif
+    } else if (!strcmp(op, "rx_stats")) {
+        struct unipro_rx_stats stats;
+
+        unipro_get_rx_stats(&stats);
+        printf("RX EOM interrupts: %u\n", stats.eom_irqs);
+        printf("RX messages:       %u\n", stats.eom_msgs);
+        return 0;
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+    } else if (!strcmp(op, "dma")) {
+        struct unipro_tx_dma_stats stats;
+        unsigned int chan;
+
+        printf("CHAN      XFERS      BYTES   BUSY(us)\n");
+        for (chan = 0; !unipro_tx_dma_get_stats(chan, &stats); chan++) {
+            printf("%4u %10u %10u %10u\n", chan, stats.xfers, stats.bytes,
+                   stats.busy_usec);
+        }
+        return 0;
+#endif
     }
 
     if (!strcmp(op, "read") || !strcmp(op, "r")) {
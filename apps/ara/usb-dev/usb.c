@@ -35,6 +35,9 @@
 #include <nuttx/config.h>
 #include <nuttx/unipro/unipro.h>
 #include <arch/board/apbridgea_debug.h>
+#ifdef CONFIG_APBRIDGE_BENCH
+#include <arch/board/apbridgea_bench.h>
+#endif
 
 #include "dwc_otg_pcd_debug.h"
 
@@ -54,6 +57,9 @@ enum {
     LOG,
 #endif
     DEBUG,
+#ifdef CONFIG_APBRIDGE_BENCH
+    BENCH,
+#endif
     MAX_CMD,
 };
 
@@ -65,7 +71,10 @@ static const struct command commands[] = {
 #ifdef CONFIG_USB_LOG
     [LOG] = {'l', "log", "set dwc otg driver log level"},
 #endif
-    [DEBUG] = {'D', "debug", "debug commands"}
+    [DEBUG] = {'D', "debug", "debug commands"},
+#ifdef CONFIG_APBRIDGE_BENCH
+    [BENCH] = {'b', "bench", "benchmark a cport"},
+#endif
 };
 
 static void usage(int exit_status) {
@@ -280,6 +289,186 @@ static int usb_debug(int argc, char *argv[])
     return rc;
 }
 
+#ifdef CONFIG_APBRIDGE_BENCH
+#define BENCH_DEFAULT_SIZE      CPORT_BUF_SIZE
+#define BENCH_DEFAULT_DEPTH     4
+#define BENCH_DEFAULT_COUNT     1000
+#define BENCH_DEFAULT_TIMEOUT   10
+#define BENCH_POLL_US           100000
+
+static const char *bench_modes[] = {
+    [APBRIDGEA_BENCH_SINK] = "sink",
+    [APBRIDGEA_BENCH_SOURCE] = "source",
+    [APBRIDGEA_BENCH_LOOP] = "loop",
+};
+
+static void usb_bench_usage(int exit_status)
+{
+    printf("usb %s: usage:\n", commands[BENCH].longc);
+    printf("    -h: print this message and exit\n");
+    printf("\n");
+    printf("    -c <cport_id>: cport to benchmark\n");
+    printf("    -m <mode>: sink, source or loop (default sink)\n");
+    printf("        sink: drop the messages sent by the host\n");
+    printf("        source: send messages to the host\n");
+    printf("        loop: time the messages echoed through UniPro\n");
+    printf("    -s <size>: message size in source mode (default %u)\n",
+           BENCH_DEFAULT_SIZE);
+    printf("    -q <depth>: messages in flight in source mode (default %u)\n",
+           BENCH_DEFAULT_DEPTH);
+    printf("    -n <count>: messages to transfer, 0 for no limit"
+           " (default %u)\n",
+           BENCH_DEFAULT_COUNT);
+    printf("    -t <seconds>: stop after this time (default %u)\n",
+           BENCH_DEFAULT_TIMEOUT);
+    exit(exit_status);
+}
+
+static void usb_bench_report(struct apbridgea_bench_stats *stats)
+{
+    unsigned int rate = 0;
+    int i;
+
+    /* bytes per microsecond are MB/s */
+    if (stats->elapsed) {
+        rate = (unsigned int)(stats->bytes * 100 / stats->elapsed);
+    }
+    printf("%u messages, %llu bytes in %u us: %u.%02u MB/s\n",
+           stats->transfers, stats->bytes, stats->elapsed,
+           rate / 100, rate % 100);
+    if (stats->errors) {
+        printf("%u messages failed\n", stats->errors);
+    }
+    if (!stats->transfers) {
+        return;
+    }
+
+    printf("latency (us): min %u avg %u max %u\n", stats->lat_min,
+           (unsigned int)(stats->lat_sum / stats->transfers), stats->lat_max);
+    for (i = 0; i < APBRIDGEA_BENCH_HIST_BUCKETS; i++) {
+        if (!stats->hist[i]) {
+            continue;
+        }
+        if (i == APBRIDGEA_BENCH_HIST_BUCKETS - 1) {
+            printf("    >= %6u: %u\n", 1 << i, stats->hist[i]);
+        } else {
+            printf("    %6u-%6u: %u\n", i ? 1 << i : 0,
+                   (1 << (i + 1)) - 1, stats->hist[i]);
+        }
+    }
+}
+
+static int usb_bench(int argc, char *argv[])
+{
+    char **args = argv + 1;
+    int c;
+    int i;
+    int rc = 0;
+
+    struct apbridgea_bench_stats stats;
+    enum apbridgea_bench_mode mode = APBRIDGEA_BENCH_SINK;
+    unsigned int cport_id = -1;
+    unsigned int size = BENCH_DEFAULT_SIZE;
+    unsigned int depth = BENCH_DEFAULT_DEPTH;
+    unsigned int count = BENCH_DEFAULT_COUNT;
+    unsigned int timeout = BENCH_DEFAULT_TIMEOUT;
+    unsigned int elapsed;
+
+    const char opts[] = "hc:m:s:q:n:t:";
+
+    argc--;
+    optind = -1; /* Force NuttX's getopt() to reinitialize. */
+
+    if (argc < 2) {
+        usb_bench_usage(EXIT_SUCCESS);
+    }
+
+    while ((c = getopt(argc, args, opts)) != -1) {
+        switch (c) {
+        case 'h':
+            usb_bench_usage(EXIT_SUCCESS);
+            break;
+        case 'c':
+            rc = sscanf(optarg, "%u", &cport_id);
+            if (rc != 1 || cport_id >= unipro_cport_count()) {
+                printf("A valid cport id is expected\n");
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            break;
+        case 'm':
+            for (i = 0; i < ARRAY_SIZE(bench_modes); i++) {
+                if (!strcmp(optarg, bench_modes[i])) {
+                    break;
+                }
+            }
+            if (i == ARRAY_SIZE(bench_modes)) {
+                printf("A valid mode is expected\n");
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            mode = i;
+            break;
+        case 's':
+            rc = sscanf(optarg, "%u", &size);
+            if (rc != 1) {
+                printf("A valid size is expected\n");
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            break;
+        case 'q':
+            rc = sscanf(optarg, "%u", &depth);
+            if (rc != 1 || !depth || depth > APBRIDGEA_BENCH_MAX_DEPTH) {
+                printf("A depth between 1 and %u is expected\n",
+                       APBRIDGEA_BENCH_MAX_DEPTH);
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            break;
+        case 'n':
+            rc = sscanf(optarg, "%u", &count);
+            if (rc != 1) {
+                printf("A valid count is expected\n");
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            break;
+        case 't':
+            rc = sscanf(optarg, "%u", &timeout);
+            if (rc != 1) {
+                printf("A valid timeout is expected\n");
+                usb_bench_usage(EXIT_FAILURE);
+            }
+            break;
+        default:
+            printf("Unrecognized argument '%c'.\n", (char)c);
+            usb_bench_usage(EXIT_FAILURE);
+        }
+    }
+
+    if (cport_id == -1) {
+        printf("A cport id is expected\n");
+        usb_bench_usage(EXIT_FAILURE);
+    }
+
+    rc = apbridgea_bench_start(cport_id, mode, size, depth, count);
+    if (rc) {
+        printf("Cannot start the benchmark: %d\n", rc);
+        return rc;
+    }
+
+    printf("Running %s benchmark on cport %u\n", bench_modes[mode], cport_id);
+    for (elapsed = 0; elapsed < timeout * 1000000; elapsed += BENCH_POLL_US) {
+        if (apbridgea_bench_done()) {
+            break;
+        }
+        usleep(BENCH_POLL_US);
+    }
+
+    apbridgea_bench_stop();
+    apbridgea_bench_get_stats(&stats);
+    usb_bench_report(&stats);
+
+    return 0;
+}
+#endif /* CONFIG_APBRIDGE_BENCH */
+
 #ifdef CONFIG_BUILD_KERNEL
 int main(int argc, FAR char *argv[])
 #else
@@ -327,6 +516,11 @@ int usb_main(int argc, char *argv[])
     case DEBUG:
         rc = usb_debug(argc, argv);
         break;
+#ifdef CONFIG_APBRIDGE_BENCH
+    case BENCH:
+        rc = usb_bench(argc, argv);
+        break;
+#endif
     default:
         usage(EXIT_FAILURE);
     }
@@ -54,6 +54,7 @@ extern void gb_sdio_register(int cport, int bundle);
 extern void gb_camera_register(int cport, int bundle);
 extern void gb_audio_mgmt_register(int cport, int bundle);
 extern void gb_audio_data_register(int cport, int bundle);
+extern void gb_vendor_debug_register(int cport, int bundle);
 
 struct greybus {
     struct list_head cports;
@@ -95,6 +96,11 @@ static void free_cport(int cportid)
 }
 
 #ifdef CONFIG_GREYBUS
+/*
+ * Register the drivers of the CPorts found in the manifest. With
+ * CONFIG_GREYBUS_LAZY_INIT, their initialization waits until the CPorts
+ * are connected.
+ */
 void enable_cports(void)
 {
     struct list_head *iter;
@@ -217,6 +223,13 @@ void enable_cports(void)
             gb_audio_data_register(cport_id, bundle_id);
         }
 #endif
+
+#ifdef CONFIG_GREYBUS_VENDOR_DEBUG
+        if (protocol == GREYBUS_PROTOCOL_VENDOR) {
+            gb_info("Registering vendor debug greybus driver.\n");
+            gb_vendor_debug_register(cport_id, bundle_id);
+        }
+#endif
     }
 }
 #endif
@@ -675,6 +675,11 @@ struct nsh_parser_s
 
 #ifndef CONFIG_NSH_DISABLESCRIPT
   FILE    *np_stream;   /* Stream of current script */
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+  FAR char *np_script;  /* Memory copy of the current script, or NULL */
+  long     np_slen;     /* Size of np_script */
+  long     np_soffs;    /* Offset of the next line in np_script */
+#endif
 #ifndef CONFIG_NSH_DISABLE_LOOPS
   long     np_foffs;    /* File offset to the beginning of a line */
 #ifndef NSH_DISABLE_SEMICOLON
@@ -841,6 +846,9 @@ void nsh_usbtrace(void);
 #ifndef CONFIG_NSH_DISABLE_FREE
   int cmd_free(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #endif
+#if defined(CONFIG_MM_PROFILE) && !defined(CONFIG_NSH_DISABLE_HEAPPROF)
+  int cmd_heapprof(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#endif
 #ifndef CONFIG_NSH_DISABLE_PS
   int cmd_ps(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #endif
@@ -848,6 +856,22 @@ void nsh_usbtrace(void);
   int cmd_perf_track(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #endif
 
+#if defined(CONFIG_SCHED_TRACE)
+  int cmd_trace(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#endif
+
+#if defined(CONFIG_ARCH_PROFILER)
+  int cmd_prof(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#endif
+
+#if defined(CONFIG_SCHED_IRQMONITOR)
+  int cmd_irqmon(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#endif
+
+#if defined(CONFIG_SCHED_CPUACCT) && !defined(CONFIG_NSH_DISABLE_TOP)
+  int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
+#endif
+
 #ifndef CONFIG_NSH_DISABLE_XD
   int cmd_xd(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #endif
@@ -880,7 +904,8 @@ void nsh_usbtrace(void);
 #  ifndef CONFIG_NSH_DISABLE_LS
       int cmd_ls(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #  endif
-#  if defined(CONFIG_SYSLOG) && defined(CONFIG_RAMLOG_SYSLOG) && !defined(CONFIG_NSH_DISABLE_DMESG)
+#  if defined(CONFIG_SYSLOG) && (defined(CONFIG_RAMLOG_SYSLOG) || defined(CONFIG_BINLOG)) && \
+      !defined(CONFIG_NSH_DISABLE_DMESG)
       int cmd_dmesg(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv);
 #  endif
 #  if CONFIG_NFILE_STREAMS > 0 && !defined(CONFIG_NSH_DISABLESCRIPT)
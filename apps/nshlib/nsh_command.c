@@ -124,16 +124,20 @@ static int  cmd_unrecognized(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
  * Private Data
  ****************************************************************************/
 
+/* The commands must be kept sorted in strcmp() order: they are looked up
+ * with a binary search.
+ */
+
 static const struct cmdmap_s g_cmdmap[] =
 {
-#if !defined(CONFIG_NSH_DISABLESCRIPT) && !defined(CONFIG_NSH_DISABLE_TEST)
-  { "[",        cmd_lbracket, 4, CONFIG_NSH_MAXARGUMENTS, "<expression> ]" },
-#endif
-
 #ifndef CONFIG_NSH_DISABLE_HELP
   { "?",        cmd_help,     1, 1, NULL },
 #endif
 
+#if !defined(CONFIG_NSH_DISABLESCRIPT) && !defined(CONFIG_NSH_DISABLE_TEST)
+  { "[",        cmd_lbracket, 4, CONFIG_NSH_MAXARGUMENTS, "<expression> ]" },
+#endif
+
 #if defined(CONFIG_NET) && defined(CONFIG_NET_ROUTE) && !defined(CONFIG_NSH_DISABLE_ADDROUTE)
   { "addroute", cmd_addroute, 4, 4, "<target> <netmask> <router>" },
 #endif
@@ -160,12 +164,12 @@ static const struct cmdmap_s g_cmdmap[] =
   { "cd",       cmd_cd,       1, 2, "[<dir-path>|-|~|..]" },
 # endif
 #endif
-# ifndef CONFIG_NSH_DISABLE_CP
-  { "cp",       cmd_cp,       3, 3, "<source-path> <dest-path>" },
-# endif
 # ifndef CONFIG_NSH_DISABLE_CMP
   { "cmp",      cmd_cmp,      3, 3, "<path1> <path2>" },
 # endif
+# ifndef CONFIG_NSH_DISABLE_CP
+  { "cp",       cmd_cp,       3, 3, "<source-path> <dest-path>" },
+# endif
 #endif
 
 #if defined (CONFIG_RTC) && !defined(CONFIG_NSH_DISABLE_DATE)
@@ -190,7 +194,8 @@ static const struct cmdmap_s g_cmdmap[] =
 #endif
 
 #if CONFIG_NFILE_DESCRIPTORS > 0 && defined(CONFIG_SYSLOG) && \
-    defined(CONFIG_RAMLOG_SYSLOG) && !defined(CONFIG_NSH_DISABLE_DMESG)
+    (defined(CONFIG_RAMLOG_SYSLOG) || defined(CONFIG_BINLOG)) && \
+    !defined(CONFIG_NSH_DISABLE_DMESG)
   { "dmesg",    cmd_dmesg,    1, 1, NULL },
 #endif
 
@@ -224,6 +229,10 @@ static const struct cmdmap_s g_cmdmap[] =
 # endif
 #endif
 
+#if defined(CONFIG_MM_PROFILE) && !defined(CONFIG_NSH_DISABLE_HEAPPROF)
+  { "heapprof", cmd_heapprof, 1, 1, NULL },
+#endif
+
 #ifndef CONFIG_NSH_DISABLE_HELP
 # ifdef CONFIG_NSH_HELP_TERSE
   { "help",     cmd_help,     1, 2, "[<cmd>]" },
@@ -252,6 +261,10 @@ static const struct cmdmap_s g_cmdmap[] =
 # endif
 #endif
 
+#if defined(CONFIG_SCHED_IRQMONITOR)
+  { "irqmon",   cmd_irqmon,   1, 2, "[-reset]" },
+#endif
+
 #ifndef CONFIG_DISABLE_SIGNALS
 # ifndef CONFIG_NSH_DISABLE_KILL
   { "kill",     cmd_kill,     3, 3, "-<signal> <pid>" },
@@ -280,6 +293,10 @@ static const struct cmdmap_s g_cmdmap[] =
 #  endif
 #endif
 
+#ifndef CONFIG_NSH_DISABLE_MH
+  { "mh",       cmd_mh,       2, 3, "<hex-address>[=<hex-value>][ <hex-byte-count>]" },
+#endif
+
 #ifdef NSH_HAVE_DIROPTS
 # ifndef CONFIG_NSH_DISABLE_MKDIR
   { "mkdir",    cmd_mkdir,    2, 2, "<path>" },
@@ -314,10 +331,6 @@ static const struct cmdmap_s g_cmdmap[] =
 # endif
 #endif
 
-#ifndef CONFIG_NSH_DISABLE_MH
-  { "mh",       cmd_mh,       2, 3, "<hex-address>[=<hex-value>][ <hex-byte-count>]" },
-#endif
-
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && CONFIG_NFILE_DESCRIPTORS > 0 && defined(CONFIG_FS_READABLE)
 # ifndef CONFIG_NSH_DISABLE_MOUNT
 #if defined(CONFIG_BUILD_PROTECTED) || defined(CONFIG_BUILD_KERNEL)
@@ -351,6 +364,10 @@ static const struct cmdmap_s g_cmdmap[] =
 # endif
 #endif
 
+#if defined(CONFIG_ARCH_PROFILER)
+  { "prof",     cmd_prof,     2, 2, "-start|-stop|-dump" },
+#endif
+
 #ifndef CONFIG_NSH_DISABLE_PS
   { "ps",       cmd_ps,       1, 1, NULL },
 #endif
@@ -405,6 +422,14 @@ static const struct cmdmap_s g_cmdmap[] =
   { "test",     cmd_test,     3, CONFIG_NSH_MAXARGUMENTS, "<expression>" },
 #endif
 
+#if defined(CONFIG_SCHED_CPUACCT) && !defined(CONFIG_NSH_DISABLE_TOP)
+  { "top",      cmd_top,      1, 6, "[-b] [-d <secs>] [-n <count>]" },
+#endif
+
+#if defined(CONFIG_SCHED_TRACE)
+  { "trace",    cmd_trace,    2, 2, "-start|-stop|-dump" },
+#endif
+
 #ifndef CONFIG_NSH_DISABLESCRIPT
   { "true",     cmd_true,    1, 1, NULL },
 #endif
@@ -457,6 +482,45 @@ static const struct cmdmap_s g_cmdmap[] =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nsh_findcmd
+ *
+ * Description:
+ *   Find a command in the sorted command table.
+ *
+ * Returned Value:
+ *   The command table entry, NULL if the command is not in the table.
+ *
+ ****************************************************************************/
+
+static FAR const struct cmdmap_s *nsh_findcmd(FAR const char *cmd)
+{
+  int low  = 0;
+  int high = NUM_CMDS - 1;
+  int mid;
+  int cmp;
+
+  while (low <= high)
+    {
+      mid = (low + high) >> 1;
+      cmp = strcmp(cmd, g_cmdmap[mid].cmd);
+      if (cmp == 0)
+        {
+          return &g_cmdmap[mid];
+        }
+      else if (cmp < 0)
+        {
+          high = mid - 1;
+        }
+      else
+        {
+          low = mid + 1;
+        }
+    }
+
+  return NULL;
+}
+
 /****************************************************************************
  * Name: help_cmdlist
  ****************************************************************************/
@@ -558,18 +622,14 @@ static int help_cmd(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd)
 
   /* Find the command in the command table */
 
-  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+  cmdmap = nsh_findcmd(cmd);
+  if (cmdmap)
     {
-      /* Is this the one we are looking for? */
+      /* Yes... show it */
 
-      if (strcmp(cmdmap->cmd, cmd) == 0)
-        {
-          /* Yes... show it */
-
-          nsh_output(vtbl, "%s usage:", cmd);
-          help_showcmd(vtbl, cmdmap);
-          return OK;
-        }
+      nsh_output(vtbl, "%s usage:", cmd);
+      help_showcmd(vtbl, cmdmap);
+      return OK;
     }
 
   nsh_output(vtbl, g_fmtcmdnotfound, cmd);
@@ -781,39 +841,34 @@ int nsh_command(FAR struct nsh_vtbl_s *vtbl, int argc, char *argv[])
 
   /* See if the command is one that we understand */
 
-  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+  cmdmap = nsh_findcmd(cmd);
+  if (cmdmap)
     {
-      if (strcmp(cmdmap->cmd, cmd) == 0)
+      /* Check if a valid number of arguments was provided.  We
+       * do this simple, imperfect checking here so that it does
+       * not have to be performed in each command.
+       */
+
+      if (argc < cmdmap->minargs)
+        {
+          /* Fewer than the minimum number were provided */
+
+          nsh_output(vtbl, g_fmtargrequired, cmd);
+          return ERROR;
+        }
+      else if (argc > cmdmap->maxargs)
         {
-          /* Check if a valid number of arguments was provided.  We
-           * do this simple, imperfect checking here so that it does
-           * not have to be performed in each command.
-           */
-
-          if (argc < cmdmap->minargs)
-            {
-              /* Fewer than the minimum number were provided */
-
-              nsh_output(vtbl, g_fmtargrequired, cmd);
-              return ERROR;
-            }
-          else if (argc > cmdmap->maxargs)
-            {
-              /* More than the maximum number were provided */
-
-              nsh_output(vtbl, g_fmttoomanyargs, cmd);
-              return ERROR;
-            }
-          else
-            {
-              /* A valid number of arguments were provided (this does
-               * not mean they are right).
-               */
-
-              handler = cmdmap->handler;
-              break;
-            }
+          /* More than the maximum number were provided */
+
+          nsh_output(vtbl, g_fmttoomanyargs, cmd);
+          return ERROR;
         }
+
+      /* A valid number of arguments were provided (this does
+       * not mean they are right).
+       */
+
+      handler = cmdmap->handler;
     }
 
    ret = handler(vtbl, argc, argv);
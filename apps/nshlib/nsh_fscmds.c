@@ -60,6 +60,9 @@
 #   ifdef CONFIG_RAMLOG_SYSLOG
 #     include <nuttx/syslog/ramlog.h>
 #   endif
+#   ifdef CONFIG_BINLOG
+#     include <nuttx/syslog/binlog.h>
+#   endif
 #endif
 #endif
 
@@ -572,7 +575,8 @@ int cmd_cat(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
  ****************************************************************************/
 
 #if CONFIG_NFILE_DESCRIPTORS > 0 && defined(CONFIG_SYSLOG) && \
-    defined(CONFIG_RAMLOG_SYSLOG) && !defined(CONFIG_NSH_DISABLE_DMESG)
+    (defined(CONFIG_RAMLOG_SYSLOG) || defined(CONFIG_BINLOG)) && \
+    !defined(CONFIG_NSH_DISABLE_DMESG)
 int cmd_dmesg(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
 {
   return cat_common(vtbl, argv[0], CONFIG_SYSLOG_DEVPATH);
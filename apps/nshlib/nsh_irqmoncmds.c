@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016 Google, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/irqmon.h>
+
+#include "nsh.h"
+#include "nsh_console.h"
+
+#if defined(CONFIG_SCHED_IRQMONITOR)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void irqmon_print_windows(FAR struct nsh_vtbl_s *vtbl)
+{
+    struct irqmon_window_s windows[CONFIG_SCHED_IRQMONITOR_NWINDOWS];
+    int nwindows;
+    int i;
+
+    nwindows = irqmon_windows(windows, CONFIG_SCHED_IRQMONITOR_NWINDOWS);
+
+    nsh_output(vtbl, "%8s %10s %10s %5s\n", "USEC", "SAVE", "RESTORE",
+               "PID");
+    for (i = 0; i < nwindows; i++) {
+        nsh_output(vtbl, "%8u 0x%08x 0x%08x %5d\n", windows[i].usec,
+                   windows[i].savepc, windows[i].restorepc, windows[i].pid);
+    }
+}
+
+static void irqmon_print_irqs(FAR struct nsh_vtbl_s *vtbl)
+{
+    struct irqmon_irq_s info;
+    uint32_t delayed;
+    int irq;
+    int i;
+
+    /* Latency bucket n counts the waits of less than 2^n usec */
+    nsh_output(vtbl, "\n%4s %8s %8s  %s\n", "IRQ", "COUNT", "MAXUSEC",
+               "PENDING <1 <2 <4 <8 <16 <32 <64 >=64 USEC");
+
+    for (irq = 0; irq < NR_IRQS; irq++) {
+        if (irqmon_irq(irq, &info) < 0)
+            continue;
+
+        for (delayed = 0, i = 0; i < IRQMON_NBUCKETS; i++)
+            delayed += info.latency[i];
+
+        if (info.count == 0 && delayed == 0)
+            continue;
+
+        nsh_output(vtbl, "%4d %8u %8u ", irq, info.count, info.maxusec);
+        for (i = 0; i < IRQMON_NBUCKETS; i++)
+            nsh_output(vtbl, " %u", info.latency[i]);
+        nsh_output(vtbl, "\n");
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cmd_irqmon
+ ****************************************************************************/
+
+int cmd_irqmon(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+    if (argc == 1) {
+        irqmon_print_windows(vtbl);
+        irqmon_print_irqs(vtbl);
+    } else if (strcmp(argv[1], "-reset") == 0) {
+        irqmon_reset();
+    } else {
+        nsh_output(vtbl, g_fmtarginvalid, argv[0]);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+#endif /* CONFIG_SCHED_IRQMONITOR */
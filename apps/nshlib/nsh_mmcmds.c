@@ -41,6 +41,10 @@
 
 #include <stdlib.h>
 
+#ifdef CONFIG_MM_PROFILE
+#  include <nuttx/mm/mm.h>
+#endif
+
 #include "nsh.h"
 #include "nsh_console.h"
 
@@ -100,3 +104,71 @@ int cmd_free(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
   return OK;
 }
 #endif /* !CONFIG_NSH_DISABLE_FREE */
+
+/****************************************************************************
+ * Name: cmd_heapprof
+ ****************************************************************************/
+
+#if defined(CONFIG_MM_PROFILE) && !defined(CONFIG_NSH_DISABLE_HEAPPROF)
+int cmd_heapprof(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+  FAR struct mm_profile_s *prof;
+  struct mallinfo mem;
+  int frag = 0;
+  int i;
+
+  /* The profile is too large for the stack of the shell */
+
+  prof = (FAR struct mm_profile_s *)malloc(sizeof(struct mm_profile_s));
+  if (!prof)
+    {
+      nsh_output(vtbl, g_fmtcmdoutofmemory, argv[0]);
+      return ERROR;
+    }
+
+  umm_profile(prof);
+#ifdef CONFIG_CAN_PASS_STRUCTS
+  mem = mallinfo();
+#else
+  (void)mallinfo(&mem);
+#endif
+
+  /* The fragmentation is the part of the free memory which cannot be
+   * allocated at once.
+   */
+
+  if (mem.fordblks > 0)
+    {
+      frag = 100 - (mem.mxordblk * 100) / mem.fordblks;
+    }
+
+  nsh_output(vtbl, "used: %u bytes, peak: %u bytes at %u ticks\n",
+             prof->mp_inuse, prof->mp_peak, prof->mp_peaktime);
+  nsh_output(vtbl, "free: %d bytes, largest: %d bytes, "
+             "fragmentation: %d%%\n", mem.fordblks, mem.mxordblk, frag);
+
+  nsh_output(vtbl, "\nCHUNK        ALLOCS    LIVE\n");
+  for (i = 0; i < MM_NFL; i++)
+    {
+      if (prof->mp_allocs[i] > 0)
+        {
+          nsh_output(vtbl, ">=%-8u %8u %7u\n", 1 << (i + MM_MIN_SHIFT),
+                     prof->mp_allocs[i], prof->mp_live[i]);
+        }
+    }
+
+  nsh_output(vtbl, "\nCALLER        BYTES  CHUNKS\n");
+  for (i = 0; i < CONFIG_MM_PROFILE_NCALLERS; i++)
+    {
+      if (prof->mp_callers[i].mc_nchunks > 0)
+        {
+          nsh_output(vtbl, "%p %9u %7u\n", prof->mp_callers[i].mc_caller,
+                     prof->mp_callers[i].mc_inuse,
+                     prof->mp_callers[i].mc_nchunks);
+        }
+    }
+
+  free(prof);
+  return OK;
+}
+#endif /* CONFIG_MM_PROFILE && !CONFIG_NSH_DISABLE_HEAPPROF */
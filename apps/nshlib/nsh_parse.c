@@ -193,7 +193,6 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline);
  * Private Data
  ****************************************************************************/
 
-static const char g_token_separator[] = " \t\n";
 #ifndef NSH_DISABLE_SEMICOLON
 static const char g_line_separator[]  = "\"#;\n";
 #endif
@@ -1237,6 +1236,35 @@ static FAR char *nsh_argexpand(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
 }
 #endif
 
+/****************************************************************************
+ * Name: nsh_istoksep
+ *
+ * Description:
+ *   Return true if ch separates the arguments of a command.  This is called
+ *   for every character of the command lines, so the separators are not
+ *   looked up in a string.
+ *
+ ****************************************************************************/
+
+static inline bool nsh_istoksep(char ch)
+{
+  return ch == ' ' || ch == '\t' || ch == '\n';
+}
+
+/****************************************************************************
+ * Name: nsh_isterm
+ *
+ * Description:
+ *   Return true if ch ends the current argument: only a quotation mark ends
+ *   a quoted string, the usual separators end the other arguments.
+ *
+ ****************************************************************************/
+
+static inline bool nsh_isterm(char ch, bool quoted)
+{
+  return quoted ? ch == '"' : nsh_istoksep(ch);
+}
+
 /****************************************************************************
  * Name: nsh_argument
  ****************************************************************************/
@@ -1248,16 +1276,14 @@ static FAR char *nsh_argument(FAR struct nsh_vtbl_s *vtbl, FAR char **saveptr,
   FAR char *pend       = NULL;
   FAR char *allocation = NULL;
   FAR char *argument   = NULL;
-  FAR const char *term;
+  bool quoted;
 #ifdef CONFIG_NSH_CMDPARMS
   bool backquote;
 #endif
 
   /* Find the beginning of the next token */
 
-  for (;
-       *pbegin && strchr(g_token_separator, *pbegin) != NULL;
-       pbegin++);
+  for (; *pbegin && nsh_istoksep(*pbegin); pbegin++);
 
   /* If we are at the end of the string with nothing but delimiters found,
    * then return NULL, meaning that there are no further arguments on the line.
@@ -1313,13 +1339,13 @@ static FAR char *nsh_argument(FAR struct nsh_vtbl_s *vtbl, FAR char **saveptr,
            */
 
           pbegin++;
-          term = "\"";
+          quoted = true;
         }
       else
         {
           /* No, then any of the usual separators will terminate the argument */
 
-          term = g_token_separator;
+          quoted = false;
         }
 
       /* Find the end of the string */
@@ -1343,7 +1369,7 @@ static FAR char *nsh_argument(FAR struct nsh_vtbl_s *vtbl, FAR char **saveptr,
            * backquoted sub-string.
            */
 
-          else if (!backquote && strchr(term, *pend) != NULL)
+          else if (!backquote && nsh_isterm(*pend, quoted))
             {
               /* We found a delimiter outside of anybackqouted substring.
                * Now we can break out of the loop.
@@ -1353,7 +1379,7 @@ static FAR char *nsh_argument(FAR struct nsh_vtbl_s *vtbl, FAR char **saveptr,
             }
         }
 #else
-      for (pend = pbegin + 1; *pend && strchr(term, *pend) == NULL; pend++);
+      for (pend = pbegin + 1; *pend && !nsh_isterm(*pend, quoted); pend++);
 #endif
 
       /* pend either points to the end of the string or to the first
@@ -1601,12 +1627,22 @@ static int nsh_loop(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
             {
                /* Set the new file position to the top of the loop offset */
 
-               ret = fseek(np->np_stream,
-                           np->np_lpstate[np->np_lpndx].lp_topoffs,
-                           SEEK_SET);
-               if (ret <  0)
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+               if (np->np_script)
                 {
-                  nsh_output(vtbl, g_fmtcmdfailed, "done", "fseek", NSH_ERRNO);
+                  np->np_soffs = np->np_lpstate[np->np_lpndx].lp_topoffs;
+                }
+               else
+#endif
+                {
+                  ret = fseek(np->np_stream,
+                              np->np_lpstate[np->np_lpndx].lp_topoffs,
+                              SEEK_SET);
+                  if (ret <  0)
+                    {
+                      nsh_output(vtbl, g_fmtcmdfailed, "done", "fseek",
+                                 NSH_ERRNO);
+                    }
                 }
 
 #ifndef NSH_DISABLE_SEMICOLON
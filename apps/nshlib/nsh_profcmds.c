@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016 Google, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <sched.h>
+#include <errno.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/profiler.h>
+
+#include "nsh.h"
+#include "nsh_console.h"
+
+#if defined(CONFIG_ARCH_PROFILER)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct prof_dump_s
+{
+  FAR struct nsh_vtbl_s *vtbl;
+  uint32_t samples;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/*
+ * Like the trace dump, the profile is line based: tools/profile.py picks the
+ * "T" (task) and "S" (sample) lines out of a console or USB log capture.
+ */
+static void prof_print_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+    FAR struct prof_dump_s *dump = arg;
+
+#if CONFIG_TASK_NAME_SIZE > 0
+    nsh_output(dump->vtbl, "T %d %s\n", tcb->pid, tcb->name);
+#else
+    nsh_output(dump->vtbl, "T %d <noname>\n", tcb->pid);
+#endif
+}
+
+static void prof_print_sample(FAR const struct profiler_sample_s *sample,
+                              FAR void *arg)
+{
+    FAR struct prof_dump_s *dump = arg;
+
+    nsh_output(dump->vtbl, "S %08x %u %u\n", sample->pc, sample->pid,
+               sample->count);
+    dump->samples += sample->count;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cmd_prof
+ ****************************************************************************/
+
+int cmd_prof(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+    struct prof_dump_s dump;
+    int dropped;
+    int ret;
+
+    if (strcmp(argv[1], "-start") == 0) {
+        ret = profiler_start();
+        if (ret < 0) {
+            nsh_output(vtbl, g_fmtcmdfailed, argv[0], "profiler_start",
+                       NSH_ERRNO_OF(-ret));
+            return ERROR;
+        }
+    } else if (strcmp(argv[1], "-stop") == 0) {
+        profiler_stop();
+    } else if (strcmp(argv[1], "-dump") == 0) {
+        /* Sampling the dump itself would only skew the profile */
+        profiler_stop();
+
+        dump.vtbl = vtbl;
+        dump.samples = 0;
+
+        nsh_output(vtbl, "# profile begin, %d Hz\n",
+                   CONFIG_ARCH_PROFILER_RATE);
+        sched_foreach(prof_print_task, &dump);
+        dropped = profiler_foreach(prof_print_sample, &dump);
+        nsh_output(vtbl, "# profile end, %u samples, %d dropped\n",
+                   dump.samples, dropped);
+    } else {
+        nsh_output(vtbl, g_fmtarginvalid, argv[0]);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+#endif /* CONFIG_ARCH_PROFILER */
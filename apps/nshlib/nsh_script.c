@@ -39,6 +39,9 @@
 
 #include <nuttx/config.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "nsh.h"
 #include "nsh_console.h"
 
@@ -68,6 +71,93 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nsh_script_load
+ *
+ * Description:
+ *   Read the whole script into memory.  Returns NULL if the script is too
+ *   large or on any failure, the script is then read line by line.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+static FAR char *nsh_script_load(FAR FILE *stream, FAR long *size)
+{
+  FAR char *script;
+  long len;
+
+  if (fseek(stream, 0, SEEK_END) < 0)
+    {
+      return NULL;
+    }
+
+  len = ftell(stream);
+  if (fseek(stream, 0, SEEK_SET) < 0 ||
+      len < 0 || len > CONFIG_NSH_SCRIPT_PRELOAD_MAX)
+    {
+      return NULL;
+    }
+
+  script = (FAR char *)malloc(len + 1);
+  if (!script)
+    {
+      return NULL;
+    }
+
+  if (fread(script, 1, len, stream) != len)
+    {
+      free(script);
+      (void)fseek(stream, 0, SEEK_SET);
+      return NULL;
+    }
+
+  script[len] = '\0';
+  *size = len;
+  return script;
+}
+
+/****************************************************************************
+ * Name: nsh_script_gets
+ *
+ * Description:
+ *   The fgets() of a preloaded script: copy its next line into buffer.  The
+ *   line is copied because the parser modifies it.
+ *
+ ****************************************************************************/
+
+static FAR char *nsh_script_gets(FAR struct nsh_parser_s *np,
+                                 FAR char *buffer)
+{
+  FAR const char *line = np->np_script + np->np_soffs;
+  FAR const char *eol;
+  size_t len;
+
+  if (np->np_soffs >= np->np_slen)
+    {
+      return NULL;
+    }
+
+  /* Same as fgets(), the newline is kept and long lines are split */
+
+  len = np->np_slen - np->np_soffs;
+  eol = memchr(line, '\n', len);
+  if (eol)
+    {
+      len = eol - line + 1;
+    }
+
+  if (len > CONFIG_NSH_LINELEN - 1)
+    {
+      len = CONFIG_NSH_LINELEN - 1;
+    }
+
+  memcpy(buffer, line, len);
+  buffer[len] = '\0';
+  np->np_soffs += len;
+  return buffer;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -85,6 +175,11 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
 {
   FAR char *fullpath;
   FAR FILE *savestream;
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+  FAR char *savescript;
+  long saveslen;
+  long savesoffs;
+#endif
   FAR char *buffer;
   FAR char *pret;
   int ret = ERROR;
@@ -105,6 +200,11 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
       /* Save the parent stream in case of nested script processing */
 
       savestream = vtbl->np.np_stream;
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+      savescript = vtbl->np.np_script;
+      saveslen   = vtbl->np.np_slen;
+      savesoffs  = vtbl->np.np_soffs;
+#endif
 
       /* Open the file containing the script */
 
@@ -123,6 +223,14 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
           return ERROR;
         }
 
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+      /* Read the script once, the lines are then taken from memory */
+
+      vtbl->np.np_script = nsh_script_load(vtbl->np.np_stream,
+                                           &vtbl->np.np_slen);
+      vtbl->np.np_soffs  = 0;
+#endif
+
       /* Loop, processing each command line in the script file (or
        * until an error occurs)
        */
@@ -140,7 +248,17 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
            * script file.  Note that ftell will return -1 on failure.
            */
 
-          vtbl->np.np_foffs = ftell(vtbl->np.np_stream);
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+          if (vtbl->np.np_script)
+            {
+              vtbl->np.np_foffs = vtbl->np.np_soffs;
+            }
+          else
+#endif
+            {
+              vtbl->np.np_foffs = ftell(vtbl->np.np_stream);
+            }
+
           vtbl->np.np_loffs = 0;
 
           if (vtbl->np.np_foffs < 0)
@@ -151,7 +269,17 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
 
           /* Now read the next line from the script file */
 
-          pret = fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+          if (vtbl->np.np_script)
+            {
+              pret = nsh_script_gets(&vtbl->np, buffer);
+            }
+          else
+#endif
+            {
+              pret = fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
+            }
+
           if (pret)
             {
               /* Parse process the command.  NOTE:  this is recursive...
@@ -167,10 +295,18 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
       /* Close the script file */
 
       fclose(vtbl->np.np_stream);
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+      free(vtbl->np.np_script);
+#endif
 
       /* Restore the parent script stream */
 
       vtbl->np.np_stream = savestream;
+#ifdef CONFIG_NSH_SCRIPT_PRELOAD
+      vtbl->np.np_script = savescript;
+      vtbl->np.np_slen   = saveslen;
+      vtbl->np.np_soffs  = savesoffs;
+#endif
     }
 
   /* Free the allocated path */
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/hires_tmr.h>
+
+#include "nsh.h"
+#include "nsh_console.h"
+
+#if defined(CONFIG_SCHED_CPUACCT) && !defined(CONFIG_NSH_DISABLE_TOP)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_NSH_PROC_MOUNTPOUNT
+#  define CONFIG_NSH_PROC_MOUNTPOUNT "/proc"
+#endif
+
+#undef HAVE_CPORTS
+#if defined(CONFIG_GREYBUS_STATS) && defined(CONFIG_FS_PROCFS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_GREYBUS) && CONFIG_NFILE_STREAMS > 0
+#  define HAVE_CPORTS 1
+#  define TOP_CPORT_LINELEN 160
+#endif
+
+/* Without poll() on the console, top cannot stop on a key press: it then
+ * only refreshes a given number of times.
+ */
+
+#undef HAVE_KEYSTOP
+#if !defined(CONFIG_DISABLE_POLL) && CONFIG_NFILE_STREAMS > 0
+#  define HAVE_KEYSTOP 1
+#  define TOP_DEFAULT_COUNT 0
+#else
+#  define TOP_DEFAULT_COUNT 10
+#endif
+
+#if CONFIG_TASK_NAME_SIZE > 0
+#  define TOP_NAMELEN (CONFIG_TASK_NAME_SIZE + 1)
+#else
+#  define TOP_NAMELEN 1
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct top_task_s {
+    pid_t pid;
+    uint8_t priority;
+    char name[TOP_NAMELEN];
+    uint64_t run_usec;
+    uint64_t irq_usec;
+    uint32_t nvcsw;
+    uint32_t nivcsw;
+
+    /* Over the last interval: the CPU use, interrupts taken included, and
+     * the part of it spent in interrupts, in tenths of a percent, and the
+     * context switches per second.
+     */
+    uint32_t load;
+    uint32_t irqload;
+    uint32_t csw;
+};
+
+#ifdef HAVE_CPORTS
+struct top_cport_s {
+    unsigned int cport;
+    unsigned int messages;
+    unsigned int bytes_in;
+    unsigned int bytes_out;
+};
+#endif
+
+struct top_s {
+    FAR struct nsh_vtbl_s *vtbl;
+
+    /* Two samples of the tasks, the current one and the previous one */
+    struct top_task_s tasks[2][CONFIG_MAX_TASKS];
+    int ntasks[2];
+    int cur;
+
+    uint32_t sample_usec;
+    uint32_t elapsed;
+
+#ifdef CONFIG_USEC_MEASURE_PERF
+    uint32_t perf_usec;
+#endif
+
+#ifdef HAVE_CPORTS
+    struct top_cport_s cports[CONFIG_NSH_TOP_NCPORTS];
+    int ncports;
+#endif
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void top_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+    FAR struct top_s *top = arg;
+    FAR struct top_task_s *task;
+    struct cpuacct_s acct;
+
+    if (top->ntasks[top->cur] >= CONFIG_MAX_TASKS ||
+        sched_cpuacct(tcb->pid, &acct) < 0)
+        return;
+
+    task = &top->tasks[top->cur][top->ntasks[top->cur]++];
+    task->pid = tcb->pid;
+    task->priority = tcb->sched_priority;
+#if CONFIG_TASK_NAME_SIZE > 0
+    strncpy(task->name, tcb->name, TOP_NAMELEN - 1);
+#endif
+    task->name[TOP_NAMELEN - 1] = '\0';
+    task->run_usec = acct.run_usec;
+    task->irq_usec = acct.irq_usec;
+    task->nvcsw = acct.nvcsw;
+    task->nivcsw = acct.nivcsw;
+}
+
+static int top_compare(FAR const void *a, FAR const void *b)
+{
+    FAR const struct top_task_s *ta = a;
+    FAR const struct top_task_s *tb = b;
+
+    if (ta->load != tb->load)
+        return ta->load < tb->load ? 1 : -1;
+
+    return ta->pid - tb->pid;
+}
+
+/**
+ * Sample the CPU accounting of all the tasks, and compute their load since
+ * the previous sample.  A task created meanwhile is accounted from zero.
+ */
+static void top_sample_tasks(FAR struct top_s *top)
+{
+    FAR struct top_task_s *prev;
+    FAR struct top_task_s *task;
+    uint64_t run_usec;
+    uint64_t irq_usec;
+    uint32_t csw;
+    uint32_t now;
+    int nprev;
+    int i;
+    int j;
+
+    prev = top->tasks[top->cur];
+    nprev = top->ntasks[top->cur];
+
+    top->cur ^= 1;
+    top->ntasks[top->cur] = 0;
+
+    now = hrt_getusec();
+    sched_foreach(top_task, top);
+
+    top->elapsed = now - top->sample_usec;
+    top->sample_usec = now;
+    if (top->elapsed == 0)
+        top->elapsed = 1;
+
+    for (i = 0; i < top->ntasks[top->cur]; i++) {
+        task = &top->tasks[top->cur][i];
+        run_usec = task->run_usec;
+        irq_usec = task->irq_usec;
+        csw = task->nvcsw + task->nivcsw;
+
+        for (j = 0; j < nprev; j++) {
+            if (prev[j].pid == task->pid) {
+                run_usec -= prev[j].run_usec;
+                irq_usec -= prev[j].irq_usec;
+                csw -= prev[j].nvcsw + prev[j].nivcsw;
+                break;
+            }
+        }
+
+        task->load = (uint32_t)(((run_usec + irq_usec) * 1000) /
+                                top->elapsed);
+        task->irqload = (uint32_t)((irq_usec * 1000) / top->elapsed);
+        task->csw = (uint32_t)(((uint64_t)csw * USEC_PER_SEC) /
+                               top->elapsed);
+    }
+}
+
+static void top_print_tasks(FAR struct top_s *top)
+{
+    FAR struct top_task_s *tasks = top->tasks[top->cur];
+    int ntasks = top->ntasks[top->cur];
+    uint32_t busy = 0;
+    uint32_t irq = 0;
+    uint32_t csw = 0;
+    int i;
+
+    /* The time in interrupts is charged to the task each interrupt was
+     * taken from, the idle task included.
+     */
+    for (i = 0; i < ntasks; i++) {
+        busy += tasks[i].pid == 0 ? tasks[i].irqload : tasks[i].load;
+        irq += tasks[i].irqload;
+        csw += tasks[i].csw;
+    }
+
+    nsh_output(top->vtbl, "CPU: %u.%u%% busy, %u.%u%% in interrupts, "
+               "%u switches/s\n", busy / 10, busy % 10, irq / 10, irq % 10,
+               csw);
+
+    qsort(tasks, ntasks, sizeof(*tasks), top_compare);
+
+    nsh_output(top->vtbl, "\n%5s %3s %6s %6s %7s %s\n", "PID", "PRI", "CPU%",
+               "IRQ%", "CSW/S", "NAME");
+    for (i = 0; i < ntasks; i++) {
+        nsh_output(top->vtbl, "%5d %3d %4u.%u %4u.%u %7u %s\n",
+                   tasks[i].pid, tasks[i].priority,
+                   tasks[i].load / 10, tasks[i].load % 10,
+                   tasks[i].irqload / 10, tasks[i].irqload % 10,
+                   tasks[i].csw, tasks[i].name);
+    }
+}
+
+#ifdef CONFIG_USEC_MEASURE_PERF
+static void top_irq(int irq, FAR const char *name, uint32_t time,
+                    FAR void *arg)
+{
+    FAR struct top_s *top = arg;
+    uint32_t load;
+
+    /* 0xffffffff marks a timer rollover */
+    if (time == 0 || time == 0xffffffff)
+        return;
+
+    load = (uint32_t)(((uint64_t)time * 1000) / top->perf_usec);
+    nsh_output(top->vtbl, "%4d %8u %4u.%u %s\n", irq, time, load / 10,
+               load % 10, name);
+}
+
+/**
+ * Show the time spent per interrupt vector, from the "pt" performance
+ * counters, and restart them for the next interval.
+ */
+static void top_print_irqs(FAR struct top_s *top)
+{
+    top->perf_usec = get_total_perf_time();
+    if (top->perf_usec == 0)
+        top->perf_usec = 1;
+
+    nsh_output(top->vtbl, "\n%4s %8s %6s %s\n", "IRQ", "USEC", "CPU%",
+               "NAME");
+    irq_perf_foreach(top_irq, top);
+
+    start_perf_track();
+}
+#endif
+
+#ifdef HAVE_CPORTS
+static FAR struct top_cport_s *top_cport(FAR struct top_s *top,
+                                         unsigned int cport, bool *found)
+{
+    int i;
+
+    *found = false;
+    for (i = 0; i < top->ncports; i++) {
+        if (top->cports[i].cport == cport) {
+            *found = true;
+            return &top->cports[i];
+        }
+    }
+
+    if (top->ncports >= CONFIG_NSH_TOP_NCPORTS)
+        return NULL;
+
+    top->cports[top->ncports].cport = cport;
+    return &top->cports[top->ncports++];
+}
+
+/**
+ * Sample the counters of /proc/greybus/cports and, if show is set, print
+ * the message and byte rates of the CPorts that were active since the
+ * previous sample.
+ */
+static void top_sample_cports(FAR struct top_s *top, bool show)
+{
+    FAR struct top_cport_s *entry;
+    FAR FILE *stream;
+    char line[TOP_CPORT_LINELEN];
+    char driver[16];
+    unsigned int cport;
+    unsigned int req_in;
+    unsigned int req_out;
+    unsigned int rsp_in;
+    unsigned int rsp_out;
+    unsigned int timeouts;
+    unsigned int oom;
+    unsigned int drops;
+    unsigned int hwm;
+    unsigned int bytes_in;
+    unsigned int bytes_out;
+    unsigned int messages;
+    bool found;
+
+    stream = fopen(CONFIG_NSH_PROC_MOUNTPOUNT "/greybus/cports", "r");
+    if (!stream)
+        return;
+
+    if (show)
+        nsh_output(top->vtbl, "\n%5s %7s %9s %9s %s\n", "CPORT", "MSG/S",
+                   "IN_B/S", "OUT_B/S", "DRIVER");
+
+    /* The heading and the latency histogram lines do not scan */
+    while (fgets(line, sizeof(line), stream)) {
+        if (sscanf(line, "%u %u %u %u %u %u %u %u %u %u %u %15s", &cport,
+                   &req_in, &req_out, &rsp_in, &rsp_out, &timeouts, &oom,
+                   &drops, &hwm, &bytes_in, &bytes_out, driver) != 12)
+            continue;
+
+        entry = top_cport(top, cport, &found);
+        if (!entry)
+            continue;
+
+        messages = req_in + req_out + rsp_in + rsp_out;
+        if (show && found && messages != entry->messages) {
+            nsh_output(top->vtbl, "%5u %7u %9u %9u %s\n", cport,
+                (unsigned int)(((uint64_t)(messages - entry->messages) *
+                                USEC_PER_SEC) / top->elapsed),
+                (unsigned int)(((uint64_t)(bytes_in - entry->bytes_in) *
+                                USEC_PER_SEC) / top->elapsed),
+                (unsigned int)(((uint64_t)(bytes_out - entry->bytes_out) *
+                                USEC_PER_SEC) / top->elapsed),
+                driver);
+        }
+
+        entry->messages = messages;
+        entry->bytes_in = bytes_in;
+        entry->bytes_out = bytes_out;
+    }
+
+    fclose(stream);
+}
+#endif
+
+static void top_print_heap(FAR struct top_s *top)
+{
+    struct mallinfo mem;
+
+#ifdef CONFIG_CAN_PASS_STRUCTS
+    mem = mallinfo();
+#else
+    (void)mallinfo(&mem);
+#endif
+
+    nsh_output(top->vtbl, "Mem: %d total, %d used, %d free, %d largest\n",
+               mem.arena, mem.uordblks, mem.fordblks, mem.mxordblk);
+}
+
+/**
+ * Wait for the refresh delay
+ *
+ * @return true if a key was pressed meanwhile
+ */
+static bool top_wait(FAR struct nsh_vtbl_s *vtbl, unsigned int delay)
+{
+#ifdef HAVE_KEYSTOP
+    struct pollfd fds;
+    char ch;
+
+    fds.fd = INFD((FAR struct console_stdio_s *)vtbl);
+    fds.events = POLLIN;
+    fds.revents = 0;
+
+    if (poll(&fds, 1, delay * MSEC_PER_SEC) > 0) {
+        (void)read(fds.fd, &ch, 1);
+        return true;
+    }
+#else
+    sleep(delay);
+#endif
+
+    return false;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cmd_top
+ ****************************************************************************/
+
+int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+    FAR struct top_s *top;
+    unsigned int delay = 1;
+    unsigned int count = TOP_DEFAULT_COUNT;
+    unsigned int i;
+    bool batch = false;
+    int argn;
+
+    for (argn = 1; argn < argc; argn++) {
+        if (strcmp(argv[argn], "-b") == 0) {
+            batch = true;
+        } else if (strcmp(argv[argn], "-d") == 0 && argn + 1 < argc) {
+            delay = strtoul(argv[++argn], NULL, 10);
+        } else if (strcmp(argv[argn], "-n") == 0 && argn + 1 < argc) {
+            count = strtoul(argv[++argn], NULL, 10);
+        } else {
+            nsh_output(vtbl, g_fmtarginvalid, argv[0]);
+            return ERROR;
+        }
+    }
+
+    if (delay == 0) {
+        nsh_output(vtbl, g_fmtargrange, argv[0]);
+        return ERROR;
+    }
+
+    top = zalloc(sizeof(*top));
+    if (!top) {
+        nsh_output(vtbl, g_fmtcmdoutofmemory, argv[0]);
+        return ERROR;
+    }
+
+    top->vtbl = vtbl;
+
+    /* Take the first samples that the first refresh is relative to */
+    top_sample_tasks(top);
+#ifdef CONFIG_USEC_MEASURE_PERF
+    start_perf_track();
+#endif
+#ifdef HAVE_CPORTS
+    top_sample_cports(top, false);
+#endif
+
+    for (i = 0; count == 0 || i < count; i++) {
+        if (top_wait(vtbl, delay))
+            break;
+
+        top_sample_tasks(top);
+
+        /* Home the cursor and clear the screen, unless in batch mode */
+        if (!batch)
+            nsh_output(vtbl, "\033[H\033[J");
+        else if (i > 0)
+            nsh_output(vtbl, "\n");
+
+        top_print_heap(top);
+        top_print_tasks(top);
+#ifdef CONFIG_USEC_MEASURE_PERF
+        top_print_irqs(top);
+#endif
+#ifdef HAVE_CPORTS
+        top_sample_cports(top, true);
+#endif
+    }
+
+#ifdef CONFIG_USEC_MEASURE_PERF
+    (void)stop_perf_track();
+#endif
+
+    free(top);
+    return OK;
+}
+
+#endif /* CONFIG_SCHED_CPUACCT && !CONFIG_NSH_DISABLE_TOP */
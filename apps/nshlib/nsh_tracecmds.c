@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016 Google, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <sched.h>
+#include <errno.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/sched_trace.h>
+
+#include "nsh.h"
+#include "nsh_console.h"
+
+#if defined(CONFIG_SCHED_TRACE)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/*
+ * The dump is line based, so that it survives being captured from a console
+ * or a USB log among other output: tools/sched_trace.py picks the "T" (task)
+ * and "E" (event) lines out of the capture.
+ */
+static void trace_print_task(FAR struct tcb_s *tcb, FAR void *arg)
+{
+    FAR struct nsh_vtbl_s *vtbl = arg;
+
+#if CONFIG_TASK_NAME_SIZE > 0
+    nsh_output(vtbl, "T %d %s\n", tcb->pid, tcb->name);
+#else
+    nsh_output(vtbl, "T %d <noname>\n", tcb->pid);
+#endif
+}
+
+static void trace_print_event(FAR const struct sched_trace_event_s *event,
+                              FAR void *arg)
+{
+    FAR struct nsh_vtbl_s *vtbl = arg;
+
+    nsh_output(vtbl, "E %u %u %u %08x\n", event->usec, event->type,
+               event->arg1, event->arg2);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cmd_trace
+ ****************************************************************************/
+
+int cmd_trace(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
+{
+    int lost;
+
+    if (strcmp(argv[1], "-start") == 0) {
+        sched_trace_start();
+    } else if (strcmp(argv[1], "-stop") == 0) {
+        sched_trace_stop();
+    } else if (strcmp(argv[1], "-dump") == 0) {
+        /* Tracing the dump itself would only fill the ring */
+        sched_trace_stop();
+
+        nsh_output(vtbl, "# sched_trace begin\n");
+        sched_foreach(trace_print_task, vtbl);
+        lost = sched_trace_foreach(trace_print_event, vtbl);
+        nsh_output(vtbl, "# sched_trace end, %d events lost\n", lost);
+    } else {
+        nsh_output(vtbl, g_fmtarginvalid, argv[0]);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+#endif /* CONFIG_SCHED_TRACE */
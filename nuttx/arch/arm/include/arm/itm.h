@@ -31,10 +31,39 @@
 #ifndef __ARCH_ARM_ITM_H__
 #define __ARCH_ARM_ITM_H__
 
+#include <stdint.h>
+#include <sys/types.h>
+
+#define ITM_STIMULUS_PORT(n)    (0xe0000000 + sizeof(uint32_t) * (n))
+
 void itm_init(void);
+void itm_trace_init(void);
 void itm_enable_port(int port);
 void itm_disable_port(int port);
 void itm_putc(int port, char c);
 ssize_t itm_write(int port, const char *buffer, size_t buflen);
 
+/*
+ * Binary trace: write a 16 or 32-bit payload to a stimulus port, the size
+ * of the write is kept in the ITM packet. Reading a stimulus port tells if
+ * its FIFO has room: rather than waiting, the payload is dropped when it
+ * has not, so that tracing costs only a load and a store. The SWO decoder
+ * sees the drops as overflow packets.
+ */
+static inline void itm_trace16(int port, uint16_t payload)
+{
+    volatile uint32_t *stim = (volatile uint32_t *) ITM_STIMULUS_PORT(port);
+
+    if (*stim)
+        *(volatile uint16_t *) stim = payload;
+}
+
+static inline void itm_trace32(int port, uint32_t payload)
+{
+    volatile uint32_t *stim = (volatile uint32_t *) ITM_STIMULUS_PORT(port);
+
+    if (*stim)
+        *stim = payload;
+}
+
 #endif /* __ARCH_ARM_ITM_H__ */
@@ -176,6 +176,28 @@ struct xcptcontext
 
 #ifndef __ASSEMBLY__
 
+#ifdef CONFIG_SCHED_IRQMONITOR
+/* Critical section monitor hooks, see <nuttx/irqmon.h> */
+
+void irqmon_maskstart(uintptr_t pc);
+void irqmon_maskend(uintptr_t pc);
+
+/* Get the PC, to tell the critical sections apart */
+
+static inline uintptr_t getpc(void) inline_function;
+static inline uintptr_t getpc(void)
+{
+  uintptr_t pc;
+
+  __asm__ __volatile__
+    (
+     "\tmov  %0, pc\n"
+     : "=r" (pc));
+
+  return pc;
+}
+#endif
+
 /* Get/set the PRIMASK register */
 
 static inline uint8_t getprimask(void) inline_function;
@@ -256,6 +278,14 @@ static inline irqstate_t irqsave(void)
 
   uint8_t basepri = getbasepri();
   setbasepri(NVIC_SYSH_DISABLE_PRIORITY);
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+  if (basepri != NVIC_SYSH_DISABLE_PRIORITY)
+    {
+      irqmon_maskstart(getpc());
+    }
+#endif
+
   return (irqstate_t)basepri;
 
 #else
@@ -274,6 +304,13 @@ static inline irqstate_t irqsave(void)
      :
      : "memory");
 
+#ifdef CONFIG_SCHED_IRQMONITOR
+  if ((primask & 1) == 0)
+    {
+      irqmon_maskstart(getpc());
+    }
+#endif
+
   return primask;
 #endif
 }
@@ -293,8 +330,22 @@ static inline void irqrestore(irqstate_t flags) inline_function;
 static inline void irqrestore(irqstate_t flags)
 {
 #ifdef CONFIG_ARMV7M_USEBASEPRI
+#ifdef CONFIG_SCHED_IRQMONITOR
+  if (flags != NVIC_SYSH_DISABLE_PRIORITY)
+    {
+      irqmon_maskend(getpc());
+    }
+#endif
+
   setbasepri((uint32_t)flags);
 #else
+#ifdef CONFIG_SCHED_IRQMONITOR
+  if ((flags & 1) == 0)
+    {
+      irqmon_maskend(getpc());
+    }
+#endif
+
   /* If bit 0 of the primask is 0, then we need to restore
    * interrupts.
    */
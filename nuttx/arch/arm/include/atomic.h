@@ -41,9 +41,26 @@ static inline void atomic_init(atomic_t *atomic, uint32_t val)
     *atomic = (atomic_t) val;
 }
 
+static inline void atomic_barrier(void)
+{
+    __asm__ __volatile__ ("dmb" : : : "memory");
+}
+
 uint32_t atomic_add(atomic_t *atomic, int n);
 uint32_t atomic_inc(atomic_t *atomic);
 uint32_t atomic_dec(atomic_t *atomic);
 
+/*
+ * Set *atomic to newval if it is equal to old.
+ * Return the value of *atomic before the operation, which is old on success.
+ */
+uint32_t atomic_cmpxchg(atomic_t *atomic, uint32_t old, uint32_t newval);
+
+/*
+ * Same as atomic_cmpxchg() on a signed halfword.
+ */
+int16_t atomic_cmpxchg16(volatile int16_t *atomic, int16_t old,
+                         int16_t newval);
+
 #endif /* __ATOMIC_H__ */
 
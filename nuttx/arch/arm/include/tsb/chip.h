@@ -45,4 +45,33 @@
 #define BUFRAM_BANK_COUNT   4
 #define BUFRAM_SIZE         (BUFRAM_BANK_SIZE * BUFRAM_BANK_COUNT)
 
+/* NVIC priority levels */
+
+#define NVIC_SYSH_PRIORITY_MIN     0xf0 /* All bits[7:4] set is minimum priority */
+#define NVIC_SYSH_PRIORITY_DEFAULT 0x80 /* Midpoint is the default */
+#define NVIC_SYSH_PRIORITY_MAX     0x00 /* Zero is maximum priority */
+#define NVIC_SYSH_PRIORITY_STEP    0x10 /* Steps between supported priority values */
+
+/*
+ * With CONFIG_ARMV7M_USEBASEPRI, irqsave() sets BASEPRI to
+ * NVIC_SYSH_DISABLE_PRIORITY instead of masking all interrupts, and SVCall
+ * stays above it.  With CONFIG_ARCH_HIPRI_INTERRUPT, interrupts at
+ * NVIC_SYSH_HIGH_PRIORITY are "zero-latency": unless
+ * CONFIG_ARCH_INT_DISABLEALL is set, neither critical sections nor the
+ * other interrupts delay them, so they must not call any OS service.
+ * See tsb_irq_attach_zerolatency().
+ */
+
+#if defined(CONFIG_ARCH_HIPRI_INTERRUPT) && defined(CONFIG_ARCH_INT_DISABLEALL)
+#  define NVIC_SYSH_MAXNORMAL_PRIORITY  (NVIC_SYSH_PRIORITY_MAX + 2*NVIC_SYSH_PRIORITY_STEP)
+#  define NVIC_SYSH_HIGH_PRIORITY       (NVIC_SYSH_PRIORITY_MAX + NVIC_SYSH_PRIORITY_STEP)
+#  define NVIC_SYSH_DISABLE_PRIORITY    NVIC_SYSH_HIGH_PRIORITY
+#  define NVIC_SYSH_SVCALL_PRIORITY     NVIC_SYSH_PRIORITY_MAX
+#else
+#  define NVIC_SYSH_MAXNORMAL_PRIORITY  (NVIC_SYSH_PRIORITY_MAX + NVIC_SYSH_PRIORITY_STEP)
+#  define NVIC_SYSH_HIGH_PRIORITY       NVIC_SYSH_PRIORITY_MAX
+#  define NVIC_SYSH_DISABLE_PRIORITY    NVIC_SYSH_MAXNORMAL_PRIORITY
+#  define NVIC_SYSH_SVCALL_PRIORITY     NVIC_SYSH_PRIORITY_MAX
+#endif
+
 #endif  /* __ARCH_ARM_INCLUDE_TSB_CHIP_H */
@@ -55,9 +55,36 @@
 #define CSI_TX_FLAG_CLOCK_CONTINUOUS  BIT(0)
 
 /* CSI RX */
+
+/**
+ * Events reported by the CSI receiver while it forwards a stream
+ */
+enum csi_rx_event {
+    /** frame start short packet received */
+    CSI_RX_EVENT_FRAME_START,
+    /** frame end short packet received */
+    CSI_RX_EVENT_FRAME_END,
+    /** the RX bridge FIFO overflowed, data has been lost */
+    CSI_RX_EVENT_OVERFLOW,
+};
+
+/**
+ * Event callback, called in interrupt context
+ *
+ * @param event The event
+ * @param frame Number of the frame, counted from csi_rx_start()
+ * @param priv The priv pointer of the configuration
+ */
+typedef void (*csi_rx_event_cb)(enum csi_rx_event event, uint32_t frame,
+                                void *priv);
+
 struct csi_rx_config {
+    /** virtual channel of the stream, the other ones are dropped */
     unsigned int vchan;
     unsigned int num_lanes;
+    /** frame boundaries and overflow events, may be NULL */
+    csi_rx_event_cb event_cb;
+    void *priv;
 };
 
 struct cdsi_dev *csi_rx_open(unsigned int cdsi);
@@ -87,6 +114,41 @@ struct csi_tx_config {
     uint32_t lines_per_second;
 };
 
+/**
+ * Stream carried on a CSI link, used to compute the link configuration
+ */
+struct csi_tx_stream {
+    /** virtual channel of the stream */
+    uint8_t vchan;
+    /** bits per pixel of the stream data type */
+    uint8_t bpp;
+    /** line length in pixels */
+    uint16_t width;
+    /** lines per frame including blankings */
+    uint16_t lines;
+    /** frames per second */
+    uint16_t fps;
+};
+
+/**
+ * @brief Compute the CSI configuration needed to carry a set of streams
+ *
+ * The aggregate bit rate of the streams, packet overhead included, is spread
+ * over the smallest number of data lanes (1, 2 or 4, up to max_lanes) that
+ * the transmitter supports at that rate, and the bus frequency is set to the
+ * lowest one carrying it. Each stream may use its own virtual channel.
+ *
+ * @param streams Streams sent concurrently on the link
+ * @param num_streams Number of streams
+ * @param max_lanes Number of data lanes wired to the receiver
+ * @param flags Flags for the CSI transmitter configuration
+ * @param cfg Pointer to structure filled with the CSI configuration
+ * @return 0 on success, -EINVAL if the streams can't be carried
+ */
+int csi_tx_compute_config(const struct csi_tx_stream *streams,
+                          unsigned int num_streams, unsigned int max_lanes,
+                          uint8_t flags, struct csi_tx_config *cfg);
+
 /**
  * @brief Validate settings provided to CSI interface
  *
@@ -183,6 +183,10 @@ extern "C" {
 void tsb_dumpnvic(void);
 void tsb_irq_clear_pending(int);
 
+#if defined(CONFIG_ARCH_HIPRI_INTERRUPT) && defined(CONFIG_ARCH_RAMVECTORS)
+int tsb_irq_attach_zerolatency(int irq, void (*vector)(void));
+#endif
+
 FAR const char* tsb_irq_name(int irq);
 
 #undef EXTERN
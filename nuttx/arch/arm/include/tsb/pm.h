@@ -44,12 +44,27 @@
 #define TSB_PWM_ACTIVITY        9
 #define TSB_I2S_ACTIVITY        9
 #define TSB_CODEC_ACTIVITY      9
+#define TSB_PM_WAKEUP_ACTIVITY  9
+
+/*
+ * Activity domains for pm_domain_activity(): the PM governor learns the
+ * bursts of each of them separately (see CONFIG_PM_PREDICT).
+ */
+#define TSB_UNIPRO_PM_DOMAIN    0
+#define TSB_UART_PM_DOMAIN      1
+#define TSB_SPI_PM_DOMAIN       2
+#define TSB_SDIO_PM_DOMAIN      3
+#define TSB_GPIO_PM_DOMAIN      4
+#define TSB_I2C_PM_DOMAIN       5
+#define TSB_PWM_PM_DOMAIN       6
+#define TSB_I2S_PM_DOMAIN       7
 
 #ifdef CONFIG_PM
 int tsb_pm_getstate(void);
 void tsb_pm_disable(void);
 void tsb_pm_enable(void);
 int tsb_pm_wait_for_wakeup(void);
+int tsb_pm_wakeup(void);
 int tsb_pm_driver_state_change(int pmstate);
 int tsb_pm_register(pm_prepare_cb prepare, pm_notify_cb notify, void *priv);
 #else
@@ -73,6 +88,11 @@ static int tsb_pm_wait_for_wakeup(void)
     return 0;
 }
 
+static int tsb_pm_wakeup(void)
+{
+    return 0;
+}
+
 static int tsb_pm_driver_state_change(int pmstate)
 {
     return 0;
@@ -148,6 +148,8 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
 
   if (switch_needed)
     {
+      sched_cpuacct_switch(rtcb, true);
+
       /* Are we in an interrupt handler? */
 
       if (current_regs)
@@ -182,6 +184,7 @@ void up_block_task(struct tcb_s *tcb, tstate_t task_state)
           /* only track non IRQ context switch */
           sched_track_switch(nexttcb);
 #endif
+          sched_trace(SCHED_TRACE_SWITCH, nexttcb->pid, 0);
           up_switchcontext(rtcb->xcp.regs, nexttcb->xcp.regs);
 
           /* up_switchcontext forces a context switch to the task at the
@@ -46,6 +46,7 @@
 #include <nuttx/arch.h>
 #include <arch/board/board.h>
 
+#include "nvic.h"
 #include "up_arch.h"
 #include "up_internal.h"
 
@@ -53,6 +54,10 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* The NVIC interrupts follow the 16 processor exceptions */
+
+#define NVIC_IRQ_FIRST 16
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -69,7 +74,7 @@
  * Public Functions
  ****************************************************************************/
 
-uint32_t *up_doirq(int irq, uint32_t *regs)
+hot_function uint32_t *up_doirq(int irq, uint32_t *regs)
 {
   board_led_on(LED_INIRQ);
 #ifdef CONFIG_SUPPRESS_INTERRUPTS
@@ -118,3 +123,35 @@ uint32_t *up_doirq(int irq, uint32_t *regs)
   board_led_off(LED_INIRQ);
   return regs;
 }
+
+/****************************************************************************
+ * Name: up_nextpending_irq
+ *
+ * Description:
+ *   Return the lowest numbered IRQ, at or above irq, that is pending in the
+ *   NVIC, or -1 if there is none.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+int up_nextpending_irq(int irq)
+{
+  uint32_t pending;
+  int nvic;
+
+  nvic = irq < NVIC_IRQ_FIRST ? 0 : irq - NVIC_IRQ_FIRST;
+  while (nvic + NVIC_IRQ_FIRST < NR_IRQS)
+    {
+      pending = getreg32(NVIC_IRQ_PEND(nvic)) >> (nvic & 31);
+      if (pending != 0)
+        {
+          nvic += __builtin_ctz(pending);
+          return nvic + NVIC_IRQ_FIRST < NR_IRQS ? nvic + NVIC_IRQ_FIRST : -1;
+        }
+
+      nvic = (nvic | 31) + 1;
+    }
+
+  return -1;
+}
+#endif
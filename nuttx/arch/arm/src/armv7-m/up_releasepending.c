@@ -112,6 +112,8 @@ void up_release_pending(void)
   /* sched_lock(); */
   if (sched_mergepending())
     {
+      sched_cpuacct_switch(rtcb, false);
+
       /* The currently active task has changed!  We will need to switch
        * contexts.  First check if we are operating in interrupt context.
        */
@@ -149,6 +151,7 @@ void up_release_pending(void)
           /* only track non IRQ context switch */
           sched_track_switch(nexttcb);
 #endif
+          sched_trace(SCHED_TRACE_SWITCH, nexttcb->pid, 0);
           up_switchcontext(rtcb->xcp.regs, nexttcb->xcp.regs);
 
           /* up_switchcontext forces a context switch to the task at the
@@ -171,6 +171,10 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
               sched_mergepending();
             }
 
+          /* Lowering its own priority, or yielding, is voluntary */
+
+          sched_cpuacct_switch(rtcb, rtcb == tcb);
+
          /* Are we in an interrupt handler? */
 
           if (current_regs)
@@ -206,6 +210,7 @@ void up_reprioritize_rtr(struct tcb_s *tcb, uint8_t priority)
           /* only track non IRQ context switch */
           sched_track_switch(nexttcb);
 #endif
+          sched_trace(SCHED_TRACE_SWITCH, nexttcb->pid, 0);
               up_switchcontext(rtcb->xcp.regs, nexttcb->xcp.regs);
 
               /* up_switchcontext forces a context switch to the task at the
@@ -134,6 +134,8 @@ void up_unblock_task(struct tcb_s *tcb)
 
   if (sched_addreadytorun(tcb))
     {
+      sched_cpuacct_switch(rtcb, false);
+
       /* The currently active task has changed! We need to do
        * a context switch to the new task.
        *
@@ -172,6 +174,7 @@ void up_unblock_task(struct tcb_s *tcb)
           /* only track non IRQ context switch */
           sched_track_switch(nexttcb);
 #endif
+          sched_trace(SCHED_TRACE_SWITCH, nexttcb->pid, 0);
           up_switchcontext(rtcb->xcp.regs, nexttcb->xcp.regs);
 
           /* up_switchcontext forces a context switch to the task at the
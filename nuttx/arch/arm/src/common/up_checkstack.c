@@ -53,11 +53,7 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#if !defined(CONFIG_DEBUG)
-#  undef CONFIG_DEBUG_STACK
-#endif
-
-#if defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
 
 /****************************************************************************
  * Public Data
@@ -202,4 +198,4 @@ size_t up_check_intstack_remain(void)
 }
 #endif
 
-#endif /* CONFIG_DEBUG_STACK */
+#endif /* CONFIG_STACK_USAGE */
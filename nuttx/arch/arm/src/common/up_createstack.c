@@ -162,7 +162,7 @@ int up_create_stack(FAR struct tcb_s *tcb, size_t stack_size, uint8_t ttype)
 
       if (ttype == TCB_FLAG_TTYPE_KERNEL)
         {
-#if defined(CONFIG_DEBUG) && !defined(CONFIG_DEBUG_STACK)
+#if defined(CONFIG_DEBUG) && !defined(CONFIG_STACK_USAGE)
           tcb->stack_alloc_ptr = (uint32_t *)kmm_zalloc(stack_size);
 #else
           tcb->stack_alloc_ptr = (uint32_t *)kmm_malloc(stack_size);
@@ -173,7 +173,7 @@ int up_create_stack(FAR struct tcb_s *tcb, size_t stack_size, uint8_t ttype)
         {
           /* Use the user-space allocator if this is a task or pthread */
 
-#if defined(CONFIG_DEBUG) && !defined(CONFIG_DEBUG_STACK)
+#if defined(CONFIG_DEBUG) && !defined(CONFIG_STACK_USAGE)
           tcb->stack_alloc_ptr = (uint32_t *)kumm_zalloc(stack_size);
 #else
           tcb->stack_alloc_ptr = (uint32_t *)kumm_malloc(stack_size);
@@ -225,12 +225,12 @@ int up_create_stack(FAR struct tcb_s *tcb, size_t stack_size, uint8_t ttype)
       tcb->adj_stack_ptr  = (uint32_t*)top_of_stack;
       tcb->adj_stack_size = size_of_stack;
 
-      /* If stack debug is enabled, then fill the stack with a
+      /* If stack usage is tracked, then fill the stack with a
        * recognizable value that we can use later to test for high
        * water marks.
        */
 
-#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
       up_stack_color(tcb->stack_alloc_ptr, tcb->adj_stack_size);
 #endif
 
@@ -249,7 +249,7 @@ int up_create_stack(FAR struct tcb_s *tcb, size_t stack_size, uint8_t ttype)
  *
  ****************************************************************************/
 
-#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
 void up_stack_color(FAR void *stackbase, size_t nbytes)
 {
   /* Take extra care that we do not write outsize the stack boundaries */
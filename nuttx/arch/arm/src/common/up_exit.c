@@ -118,10 +118,11 @@ static void _up_dumponexit(FAR struct tcb_s *tcb, FAR void *arg)
   sdbg("    priority=%d state=%d\n", tcb->sched_priority, tcb->task_state);
 
 #if CONFIG_NFILE_DESCRIPTORS > 0
-  filelist = tcb->group->tg_filelist;
+  filelist = &tcb->group->tg_filelist;
   for (i = 0; i < CONFIG_NFILE_DESCRIPTORS; i++)
     {
-      struct inode *inode = filelist->fl_files[i].f_inode;
+      struct file *filep = files_fdfile(filelist, i);
+      struct inode *inode = filep ? filep->f_inode : NULL;
       if (inode)
         {
           sdbg("      fd=%d refcount=%d\n",
@@ -181,6 +182,8 @@ void _exit(int status)
   sched_track_pre_exit((struct tcb_s*) g_readytorun.head);
 #endif
 
+  sched_cpuacct_switch((struct tcb_s*)g_readytorun.head, true);
+
 #if defined(CONFIG_DUMP_ON_EXIT) && defined(CONFIG_DEBUG)
   slldbg("Other tasks:\n");
   sched_foreach(_up_dumponexit, NULL);
@@ -71,6 +71,7 @@
 #include <nuttx/arch.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/syslog/ramlog.h>
+#include <nuttx/syslog/binlog.h>
 
 #include <arch/board/board.h>
 
@@ -123,7 +124,7 @@ static void up_calibratedelay(void)
  *
  ****************************************************************************/
 
-#if defined(CONFIG_DEBUG_STACK) && CONFIG_ARCH_INTERRUPTSTACK > 3
+#if defined(CONFIG_STACK_USAGE) && CONFIG_ARCH_INTERRUPTSTACK > 3
 static inline void up_color_intstack(void)
 {
   uint32_t *ptr = (uint32_t *)&g_intstackalloc;
@@ -271,6 +272,9 @@ void up_initialize(void)
 #ifdef CONFIG_RAMLOG_SYSLOG
   ramlog_sysloginit();
 #endif
+#ifdef CONFIG_BINLOG
+  binlog_sysloginit();
+#endif
 
   /* Initialize the network */
 
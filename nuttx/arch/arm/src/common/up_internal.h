@@ -277,8 +277,13 @@ extern uint32_t _ebss;            /* End+1 of .bss */
  */
 
 #ifdef CONFIG_ARCH_RAMFUNCS
-
 #  define __ramfunc__ __attribute__ ((section(".ramfunc"),long_call))
+#else
+#  define __ramfunc__
+#endif
+
+#if defined(CONFIG_ARCH_RAMFUNCS) || defined(CONFIG_ARCH_HOTPATH)
+#  define HAVE_RAMFUNCS 1
 
 /* Functions declared in the .ramfunc section will be packaged together
  * by the linker script and stored in FLASH.  During boot-up, the start
@@ -292,15 +297,7 @@ extern const uint32_t _framfuncs; /* Copy source address in FLASH */
 extern uint32_t _sramfuncs;       /* Copy destination start address in RAM */
 extern uint32_t _eramfuncs;       /* Copy destination end address in RAM */
 
-#else /* CONFIG_ARCH_RAMFUNCS */
-
-/* Otherwise, a null definition is provided so that condition compilation is
- * not necessary in code that may operate with or without RAM functions.
- */
-
-#  define __ramfunc__
-
-#endif /* CONFIG_ARCH_RAMFUNCS */
+#endif /* CONFIG_ARCH_RAMFUNCS || CONFIG_ARCH_HOTPATH */
 #endif /* __ASSEMBLY__ */
 
 /****************************************************************************
@@ -543,7 +540,7 @@ void up_rnginitialize(void);
 
 /* Debug ********************************************************************/
 
-#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
 void up_stack_color(FAR void *stackbase, size_t nbytes);
 #endif
 
@@ -51,6 +51,9 @@
 
 #define ITM_ACCESS_CODE         0xc5acce55
 #define ITM_TRACE_CTL_ITMENA    (1 << 0)
+#define ITM_TRACE_CTL_TSENA     (1 << 1)
+#define ITM_TRACE_CTL_SYNCENA   (1 << 2)
+#define ITM_TRACE_CTL_BUSID(id) ((id) << 16)
 
 void itm_putc(int port_id, char c)
 {
@@ -75,14 +78,14 @@ static inline void itm_end_configure(void)
 void itm_enable_port(int port)
 {
     itm_start_configure();
-    modifyreg32(ITM_TRACE_CTL, 0, 1 << port);
+    modifyreg32(ITM_TRACE_ENABLE, 0, 1 << port);
     itm_end_configure();
 }
 
 void itm_disable_port(int port)
 {
     itm_start_configure();
-    modifyreg32(ITM_TRACE_CTL, 1 << port, 0);
+    modifyreg32(ITM_TRACE_ENABLE, 1 << port, 0);
     itm_end_configure();
 }
 
@@ -95,6 +98,24 @@ void itm_init(void)
     itm_end_configure();
 }
 
+/**
+ * @brief Enable the ITM for binary tracing
+ *
+ * On top of itm_init(), emit local timestamps so that the decoder can date
+ * the trace packets, and synchronization packets so that it can start
+ * decoding anywhere in the stream. The TPIU and the SWO pin are set up by
+ * the debug probe.
+ */
+void itm_trace_init(void)
+{
+    itm_init();
+
+    itm_start_configure();
+    modifyreg32(ITM_TRACE_CTL, 0, ITM_TRACE_CTL_TSENA |
+                ITM_TRACE_CTL_SYNCENA | ITM_TRACE_CTL_BUSID(1));
+    itm_end_configure();
+}
+
 ssize_t itm_write(int port, const char *buffer, size_t buflen)
 {
     int i = 0;
@@ -60,7 +60,7 @@
  *      - 1 x 10 bit addresses + 1 x 7 bit address (?)
  *      - plus the broadcast address (general call)
  *  - Multi-master support
- *  - DMA (to get rid of too many CPU wake-ups and interventions)
+ *  - DMA on the F1, F2 and L1 (the F4 has CONFIG_STM32_I2C_DMA)
  *  - Be ready for IPMI
  */
 
@@ -93,6 +93,10 @@
 #include "stm32_i2c.h"
 #include "stm32_waste.h"
 
+#ifdef CONFIG_STM32_I2C_DMA
+#  include "stm32_dma.h"
+#endif
+
 /* At least one I2C peripheral must be enabled */
 
 #if defined(CONFIG_STM32_I2C1) || defined(CONFIG_STM32_I2C2) || \
@@ -159,6 +163,45 @@
 
 #define MKI2C_OUTPUT(p) (((p) & (GPIO_PORT_MASK | GPIO_PIN_MASK)) | I2C_OUTPUT)
 
+/* DMA.  Message data of CONFIG_STM32_I2C_DMATHRESHOLD bytes or more is moved by
+ * DMA, the rest one byte per interrupt.  Receive needs at least two bytes so that
+ * the LAST bit can NACK the final one.
+ */
+
+#ifdef CONFIG_STM32_I2C_DMA
+#  ifndef CONFIG_STM32_STM32F40XX
+#    error "I2C DMA is only supported on the STM32 F4"
+#  endif
+
+#  ifndef CONFIG_STM32_I2C_DMATHRESHOLD
+#    define CONFIG_STM32_I2C_DMATHRESHOLD 8
+#  endif
+
+#  if CONFIG_STM32_I2C_DMATHRESHOLD < 2
+#    define I2C_DMA_MINBYTES 2
+#  else
+#    define I2C_DMA_MINBYTES CONFIG_STM32_I2C_DMATHRESHOLD
+#  endif
+
+#  if defined(CONFIG_STM32_I2C1) && \
+      (!defined(DMACHAN_I2C1_RX) || !defined(DMACHAN_I2C1_TX))
+#    error "I2C1 DMA requires DMACHAN_I2C1_RX and DMACHAN_I2C1_TX in board.h"
+#  endif
+#  if defined(CONFIG_STM32_I2C2) && \
+      (!defined(DMACHAN_I2C2_RX) || !defined(DMACHAN_I2C2_TX))
+#    error "I2C2 DMA requires DMACHAN_I2C2_RX and DMACHAN_I2C2_TX in board.h"
+#  endif
+#  if defined(CONFIG_STM32_I2C3) && \
+      (!defined(DMACHAN_I2C3_RX) || !defined(DMACHAN_I2C3_TX))
+#    error "I2C3 DMA requires DMACHAN_I2C3_RX and DMACHAN_I2C3_TX in board.h"
+#  endif
+
+#  define I2C_RXDMA_CONFIG (DMA_SCR_PRIMED|DMA_SCR_MSIZE_8BITS|DMA_SCR_PSIZE_8BITS|\
+                            DMA_SCR_MINC|DMA_SCR_DIR_P2M)
+#  define I2C_TXDMA_CONFIG (DMA_SCR_PRIMED|DMA_SCR_MSIZE_8BITS|DMA_SCR_PSIZE_8BITS|\
+                            DMA_SCR_MINC|DMA_SCR_DIR_M2P)
+#endif
+
 /* Debug ****************************************************************************/
 /* CONFIG_DEBUG_I2C + CONFIG_DEBUG enables general I2C debug output. */
 
@@ -240,6 +283,10 @@ struct stm32_i2c_config_s
   uint32_t ev_irq;            /* Event IRQ */
   uint32_t er_irq;            /* Error IRQ */
 #endif
+#ifdef CONFIG_STM32_I2C_DMA
+  uint32_t rxch;              /* RX DMA channel */
+  uint32_t txch;              /* TX DMA channel */
+#endif
 };
 
 /* I2C Device Private Data */
@@ -260,6 +307,12 @@ struct stm32_i2c_priv_s
   int dcnt;                    /* Current message length */
   uint16_t flags;              /* Current message flags */
 
+#ifdef CONFIG_STM32_I2C_DMA
+  DMA_HANDLE rxdma;            /* RX DMA stream */
+  DMA_HANDLE txdma;            /* TX DMA stream */
+  volatile bool dmaxfer;       /* Current message data is moved by DMA */
+#endif
+
   /* I2C trace support */
 
 #ifdef CONFIG_I2C_TRACE
@@ -329,6 +382,12 @@ static inline uint32_t stm32_i2c_disablefsmc(FAR struct stm32_i2c_priv_s *priv);
 static inline void stm32_i2c_enablefsmc(uint32_t ahbenr);
 #endif /* I2C1_FSMC_CONFLICT */
 
+static void stm32_i2c_endmsg(FAR struct stm32_i2c_priv_s *priv);
+#ifdef CONFIG_STM32_I2C_DMA
+static bool stm32_i2c_dmastart(FAR struct stm32_i2c_priv_s *priv);
+static void stm32_i2c_dmastop(FAR struct stm32_i2c_priv_s *priv);
+static void stm32_i2c_dmarxcallback(DMA_HANDLE handle, uint8_t status, void *arg);
+#endif
 static int stm32_i2c_isr(struct stm32_i2c_priv_s * priv);
 
 #ifndef CONFIG_I2C_POLLED
@@ -380,7 +439,11 @@ static const struct stm32_i2c_config_s stm32_i2c1_config =
 #ifndef CONFIG_I2C_POLLED
   .isr        = stm32_i2c1_isr,
   .ev_irq     = STM32_IRQ_I2C1EV,
-  .er_irq     = STM32_IRQ_I2C1ER
+  .er_irq     = STM32_IRQ_I2C1ER,
+#endif
+#ifdef CONFIG_STM32_I2C_DMA
+  .rxch       = DMACHAN_I2C1_RX,
+  .txch       = DMACHAN_I2C1_TX,
 #endif
 };
 
@@ -409,7 +472,11 @@ static const struct stm32_i2c_config_s stm32_i2c2_config =
 #ifndef CONFIG_I2C_POLLED
   .isr        = stm32_i2c2_isr,
   .ev_irq     = STM32_IRQ_I2C2EV,
-  .er_irq     = STM32_IRQ_I2C2ER
+  .er_irq     = STM32_IRQ_I2C2ER,
+#endif
+#ifdef CONFIG_STM32_I2C_DMA
+  .rxch       = DMACHAN_I2C2_RX,
+  .txch       = DMACHAN_I2C2_TX,
 #endif
 };
 
@@ -438,7 +505,11 @@ static const struct stm32_i2c_config_s stm32_i2c3_config =
 #ifndef CONFIG_I2C_POLLED
   .isr        = stm32_i2c3_isr,
   .ev_irq     = STM32_IRQ_I2C3EV,
-  .er_irq     = STM32_IRQ_I2C3ER
+  .er_irq     = STM32_IRQ_I2C3ER,
+#endif
+#ifdef CONFIG_STM32_I2C_DMA
+  .rxch       = DMACHAN_I2C3_RX,
+  .txch       = DMACHAN_I2C3_TX,
 #endif
 };
 
@@ -1168,6 +1239,199 @@ static inline void stm32_i2c_enablefsmc(uint32_t ahbenr)
 #  define stm32_i2c_enablefsmc(ahbenr)
 #endif /* I2C1_FSMC_CONFLICT */
 
+/************************************************************************************
+ * Name: stm32_i2c_endmsg
+ *
+ * Description:
+ *  The data of the current message is done: continue with the next message
+ *  without a restart, send a repeated start, or send the stop and wake up the
+ *  waiting thread.
+ *
+ ************************************************************************************/
+
+static void stm32_i2c_endmsg(FAR struct stm32_i2c_priv_s *priv)
+{
+  stm32_i2c_getreg(priv, STM32_I2C_DR_OFFSET);    /* ACK ISR */
+
+  /* Do we need to terminate or restart after this byte?
+   * If there are more messages to send, then we may:
+   *
+   *  - continue with repeated start
+   *  - or just continue sending writeable part
+   *  - or we close down by sending the stop bit
+   */
+
+  if (priv->msgc > 0)
+    {
+      if (priv->msgv->flags & I2C_M_NORESTART)
+        {
+          stm32_i2c_traceevent(priv, I2CEVENT_BTFNOSTART, priv->msgc);
+          priv->ptr   = priv->msgv->buffer;
+          priv->dcnt  = priv->msgv->length;
+          priv->flags = priv->msgv->flags;
+          priv->msgv++;
+          priv->msgc--;
+
+          /* Restart this ISR! */
+
+#ifndef CONFIG_I2C_POLLED
+          stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0, I2C_CR2_ITBUFEN);
+#endif
+        }
+      else
+        {
+          stm32_i2c_traceevent(priv, I2CEVENT_BTFRESTART, priv->msgc);
+          stm32_i2c_sendstart(priv);
+        }
+    }
+  else if (priv->msgv)
+    {
+      stm32_i2c_traceevent(priv, I2CEVENT_BTFSTOP, 0);
+      stm32_i2c_sendstop(priv);
+
+      /* Is there a thread waiting for this event (there should be) */
+
+#ifndef CONFIG_I2C_POLLED
+      if (priv->intstate == INTSTATE_WAITING)
+        {
+          /* Yes.. inform the thread that the transfer is complete
+           * and wake it up.
+           */
+
+          sem_post(&priv->sem_isr);
+          priv->intstate = INTSTATE_DONE;
+        }
+#else
+      priv->intstate = INTSTATE_DONE;
+#endif
+
+      /* Mark that we have stopped with this transaction */
+
+      priv->msgv = NULL;
+    }
+}
+
+/************************************************************************************
+ * Name: stm32_i2c_dmastart
+ *
+ * Description:
+ *  Called on the start condition of a message.  If the message is long enough,
+ *  hand its data to the DMA and return true; the interrupt handler then only
+ *  sees the address phase and, for writes, the final BTF.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_STM32_I2C_DMA
+static bool stm32_i2c_dmastart(FAR struct stm32_i2c_priv_s *priv)
+{
+  uint32_t paddr = priv->config->base + STM32_I2C_DR_OFFSET;
+
+  if (priv->dcnt < I2C_DMA_MINBYTES)
+    {
+      return false;
+    }
+
+  if ((priv->flags & I2C_M_READ) != 0)
+    {
+#ifdef CONFIG_STM32_DMACAPABLE
+      if (!stm32_dmacapable((uint32_t)priv->ptr, priv->dcnt, I2C_RXDMA_CONFIG))
+        {
+          return false;
+        }
+#endif
+
+      /* LAST makes the peripheral NACK the byte that ends the DMA transfer */
+
+      stm32_dmasetup(priv->rxdma, paddr, (uint32_t)priv->ptr, priv->dcnt,
+                     I2C_RXDMA_CONFIG);
+      stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0,
+                          I2C_CR2_DMAEN | I2C_CR2_LAST);
+      stm32_dmastart(priv->rxdma, stm32_i2c_dmarxcallback, priv, false);
+    }
+  else
+    {
+#ifdef CONFIG_STM32_DMACAPABLE
+      if (!stm32_dmacapable((uint32_t)priv->ptr, priv->dcnt, I2C_TXDMA_CONFIG))
+        {
+          return false;
+        }
+#endif
+
+      /* Completion is the BTF after the last byte, seen by the ISR */
+
+      stm32_dmasetup(priv->txdma, paddr, (uint32_t)priv->ptr, priv->dcnt,
+                     I2C_TXDMA_CONFIG);
+      stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0, I2C_CR2_DMAEN);
+      stm32_dmastart(priv->txdma, NULL, NULL, false);
+    }
+
+  /* The bytes now belong to the DMA */
+
+  priv->ptr    += priv->dcnt;
+  priv->dcnt    = 0;
+  priv->dmaxfer = true;
+  return true;
+}
+
+/************************************************************************************
+ * Name: stm32_i2c_dmastop
+ *
+ * Description:
+ *  Stop the DMA of the current message, if any, and return the peripheral to
+ *  interrupt-per-byte operation.
+ *
+ ************************************************************************************/
+
+static void stm32_i2c_dmastop(FAR struct stm32_i2c_priv_s *priv)
+{
+  if (priv->dmaxfer)
+    {
+      if ((priv->flags & I2C_M_READ) != 0)
+        {
+          stm32_dmastop(priv->rxdma);
+          stm32_i2c_modifyreg(priv, STM32_I2C_CR1_OFFSET, I2C_CR1_ACK, 0);
+        }
+      else
+        {
+          stm32_dmastop(priv->txdma);
+        }
+
+      stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET,
+                          I2C_CR2_DMAEN | I2C_CR2_LAST, 0);
+      priv->dmaxfer = false;
+    }
+}
+
+/************************************************************************************
+ * Name: stm32_i2c_dmarxcallback
+ *
+ * Description:
+ *  The receive DMA has read the last byte.  No further I2C event will follow,
+ *  so finish the message from here.  A DMA error is reported as an overrun.
+ *
+ ************************************************************************************/
+
+static void stm32_i2c_dmarxcallback(DMA_HANDLE handle, uint8_t status, void *arg)
+{
+  FAR struct stm32_i2c_priv_s *priv = (FAR struct stm32_i2c_priv_s *)arg;
+
+  if (!priv->dmaxfer)
+    {
+      return;
+    }
+
+  stm32_i2c_dmastop(priv);
+
+  if ((status & DMA_STATUS_ERROR) != 0)
+    {
+      priv->status |= I2C_SR1_OVR;
+      priv->msgc    = 0;
+    }
+
+  stm32_i2c_endmsg(priv);
+}
+#endif /* CONFIG_STM32_I2C_DMA */
+
 /************************************************************************************
  * Name: stm32_i2c_isr
  *
@@ -1196,6 +1460,10 @@ static int stm32_i2c_isr(struct stm32_i2c_priv_s *priv)
       priv->dcnt  = priv->msgv->length;
       priv->flags = priv->msgv->flags;
 
+#ifdef CONFIG_STM32_I2C_DMA
+      (void)stm32_i2c_dmastart(priv);
+#endif
+
       /* Send address byte and define addressing mode */
 
       stm32_i2c_putreg(priv, STM32_I2C_DR_OFFSET,
@@ -1204,7 +1472,7 @@ static int stm32_i2c_isr(struct stm32_i2c_priv_s *priv)
 
       /* Set ACK for receive mode */
 
-      if (priv->dcnt > 1 && (priv->flags & I2C_M_READ) != 0)
+      if (priv->msgv->length > 1 && (priv->flags & I2C_M_READ) != 0)
         {
           stm32_i2c_modifyreg(priv, STM32_I2C_CR1_OFFSET, 0, I2C_CR1_ACK);
         }
@@ -1241,8 +1509,13 @@ static int stm32_i2c_isr(struct stm32_i2c_priv_s *priv)
       /* Enable RxNE and TxE buffers in order to receive one or multiple bytes */
 
 #ifndef CONFIG_I2C_POLLED
-      stm32_i2c_traceevent(priv, I2CEVENT_ITBUFEN, 0);
-      stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0, I2C_CR2_ITBUFEN);
+#ifdef CONFIG_STM32_I2C_DMA
+      if (!priv->dmaxfer)
+#endif
+        {
+          stm32_i2c_traceevent(priv, I2CEVENT_ITBUFEN, 0);
+          stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0, I2C_CR2_ITBUFEN);
+        }
 #endif
     }
 
@@ -1300,9 +1573,22 @@ static int stm32_i2c_isr(struct stm32_i2c_priv_s *priv)
 #endif
 
   /* Was last byte received or sent?  Hmmm... the F2 and F4 seems to differ from
-   * the F1 in that BTF is not set after data is received (only RXNE).
+   * the F1 in that BTF is not set after data is received (only RXNE).  With DMA,
+   * a read is finished by the DMA callback and a write by the BTF of its last
+   * byte.
    */
 
+#ifdef CONFIG_STM32_I2C_DMA
+  if (priv->dmaxfer)
+    {
+      if ((priv->flags & I2C_M_READ) == 0 && (status & I2C_SR1_BTF) != 0)
+        {
+          stm32_i2c_dmastop(priv);
+          stm32_i2c_endmsg(priv);
+        }
+    }
+  else
+#endif
 #if defined(CONFIG_STM32_STM32F20XX) || defined(CONFIG_STM32_STM32F40XX) || \
     defined(CONFIG_STM32_STM32L15XX)
   if (priv->dcnt <= 0 && (status & (I2C_SR1_BTF|I2C_SR1_RXNE)) != 0)
@@ -1310,64 +1596,7 @@ static int stm32_i2c_isr(struct stm32_i2c_priv_s *priv)
   if (priv->dcnt <= 0 && (status & I2C_SR1_BTF) != 0)
 #endif
     {
-      stm32_i2c_getreg(priv, STM32_I2C_DR_OFFSET);    /* ACK ISR */
-
-      /* Do we need to terminate or restart after this byte?
-       * If there are more messages to send, then we may:
-       *
-       *  - continue with repeated start
-       *  - or just continue sending writeable part
-       *  - or we close down by sending the stop bit
-       */
-
-      if (priv->msgc > 0)
-        {
-          if (priv->msgv->flags & I2C_M_NORESTART)
-            {
-              stm32_i2c_traceevent(priv, I2CEVENT_BTFNOSTART, priv->msgc);
-              priv->ptr   = priv->msgv->buffer;
-              priv->dcnt  = priv->msgv->length;
-              priv->flags = priv->msgv->flags;
-              priv->msgv++;
-              priv->msgc--;
-
-              /* Restart this ISR! */
-
-#ifndef CONFIG_I2C_POLLED
-              stm32_i2c_modifyreg(priv, STM32_I2C_CR2_OFFSET, 0, I2C_CR2_ITBUFEN);
-#endif
-            }
-          else
-            {
-              stm32_i2c_traceevent(priv, I2CEVENT_BTFRESTART, priv->msgc);
-              stm32_i2c_sendstart(priv);
-            }
-        }
-      else if (priv->msgv)
-        {
-          stm32_i2c_traceevent(priv, I2CEVENT_BTFSTOP, 0);
-          stm32_i2c_sendstop(priv);
-
-          /* Is there a thread waiting for this event (there should be) */
-
-#ifndef CONFIG_I2C_POLLED
-          if (priv->intstate == INTSTATE_WAITING)
-            {
-              /* Yes.. inform the thread that the transfer is complete
-               * and wake it up.
-               */
-
-              sem_post(&priv->sem_isr);
-              priv->intstate = INTSTATE_DONE;
-            }
-#else
-          priv->intstate = INTSTATE_DONE;
-#endif
-
-          /* Mark that we have stopped with this transaction */
-
-          priv->msgv = NULL;
-        }
+      stm32_i2c_endmsg(priv);
     }
 
   /* Check for errors, in which case, stop the transfer and return
@@ -1495,6 +1724,15 @@ static int stm32_i2c_init(FAR struct stm32_i2c_priv_s *priv)
   up_enable_irq(priv->config->er_irq);
 #endif
 
+#ifdef CONFIG_STM32_I2C_DMA
+  /* Reserve the DMA streams for as long as the port is in use */
+
+  priv->rxdma = stm32_dmachannel(priv->config->rxch);
+  priv->txdma = stm32_dmachannel(priv->config->txch);
+  DEBUGASSERT(priv->rxdma && priv->txdma);
+  priv->dmaxfer = false;
+#endif
+
   /* Set peripheral frequency, where it must be at least 2 MHz  for 100 kHz
    * or 4 MHz for 400 kHz.  This also disables all I2C interrupts.
    */
@@ -1536,6 +1774,13 @@ static int stm32_i2c_deinit(FAR struct stm32_i2c_priv_s *priv)
   irq_detach(priv->config->er_irq);
 #endif
 
+#ifdef CONFIG_STM32_I2C_DMA
+  stm32_dmafree(priv->rxdma);
+  stm32_dmafree(priv->txdma);
+  priv->rxdma = NULL;
+  priv->txdma = NULL;
+#endif
+
   /* Disable clocking */
 
   modifyreg32(STM32_RCC_APB1ENR, priv->config->clk_bit, 0);
@@ -1605,6 +1850,10 @@ static int stm32_i2c_process(FAR struct i2c_dev_s *dev, FAR struct i2c_msg_s *ms
   uint32_t    ahbenr;
 #endif
   int         errval = 0;
+  int         ret;
+#ifdef CONFIG_STM32_I2C_DMA
+  irqstate_t  flags;
+#endif
 
   ASSERT(count);
 
@@ -1659,7 +1908,17 @@ static int stm32_i2c_process(FAR struct i2c_dev_s *dev, FAR struct i2c_msg_s *ms
    * the BUSY flag.
    */
 
-  if (stm32_i2c_sem_waitdone(priv) < 0)
+  ret = stm32_i2c_sem_waitdone(priv);
+
+#ifdef CONFIG_STM32_I2C_DMA
+  /* An error or a timeout can leave the DMA of the last message running */
+
+  flags = irqsave();
+  stm32_i2c_dmastop(priv);
+  irqrestore(flags);
+#endif
+
+  if (ret < 0)
     {
       status = stm32_i2c_getstatus(priv);
       errval = ETIMEDOUT;
@@ -182,6 +182,18 @@
 
 #  define RXDMA_BUFFER_SIZE   32
 
+/* With CONFIG_SERIAL_DMARX, the DMA instead runs over the RX buffer of the
+ * serial upper half.
+ */
+
+#  ifdef CONFIG_SERIAL_DMARX
+#    define RXDMA_BUFFER(p)   ((p)->dev.recv.buffer)
+#    define RXDMA_SIZE(p)     ((p)->dev.recv.size)
+#  else
+#    define RXDMA_BUFFER(p)   ((p)->rxfifo)
+#    define RXDMA_SIZE(p)     RXDMA_BUFFER_SIZE
+#  endif
+
 /* DMA priority */
 
 #  ifndef CONFIG_USART_DMAPRIO
@@ -339,6 +351,7 @@ static void up_dma_shutdown(struct uart_dev_s *dev);
 static int  up_dma_receive(struct uart_dev_s *dev, uint32_t *status);
 static void up_dma_rxint(struct uart_dev_s *dev, bool enable);
 static bool up_dma_rxavailable(struct uart_dev_s *dev);
+static void up_dma_rxstart(struct uart_dev_s *dev);
 
 static void up_dma_rxcallback(DMA_HANDLE handle, uint8_t status, void *arg);
 #endif
@@ -413,6 +426,9 @@ static const struct uart_ops_s g_uart_dma_ops =
   .txint          = up_txint,
   .txready        = up_txready,
   .txempty        = up_txready,
+#ifdef CONFIG_SERIAL_DMARX
+  .dmarxstart     = up_dma_rxstart,
+#endif
 };
 #endif
 
@@ -1129,10 +1145,14 @@ static inline void up_disableusartint(struct up_dev_s *priv, uint16_t *ie)
 static int up_dma_nextrx(struct up_dev_s *priv)
 {
   size_t dmaresidual;
+  int nextrx;
 
   dmaresidual = stm32_dmaresidual(priv->rxdma);
 
-  return (RXDMA_BUFFER_SIZE - (int)dmaresidual);
+  /* The counter reloads when it reaches zero, but may be read just then */
+
+  nextrx = RXDMA_SIZE(priv) - (int)dmaresidual;
+  return nextrx >= RXDMA_SIZE(priv) ? 0 : nextrx;
 }
 #endif
 
@@ -1531,10 +1551,39 @@ static int up_dma_setup(struct uart_dev_s *dev)
 
   /* Configure for circular DMA reception into the RX fifo */
 
+  up_dma_rxstart(dev);
+
+  /* Enable receive DMA for the UART */
+
+  regval  = up_serialin(priv, STM32_USART_CR3_OFFSET);
+  regval |= USART_CR3_DMAR;
+  up_serialout(priv, STM32_USART_CR3_OFFSET, regval);
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: up_dma_rxstart
+ *
+ * Description:
+ *   (Re)start circular DMA reception at the beginning of the RX FIFO.  With
+ *   CONFIG_SERIAL_DMARX, this is also the dmarxstart method, called when
+ *   the serial driver empties its RX buffer.
+ *
+ ****************************************************************************/
+
+#ifdef SERIAL_HAVE_DMA
+static void up_dma_rxstart(struct uart_dev_s *dev)
+{
+  struct up_dev_s *priv = (struct up_dev_s *)dev->priv;
+
+  stm32_dmastop(priv->rxdma);
+
   stm32_dmasetup(priv->rxdma,
                  priv->usartbase + STM32_USART_RDR_OFFSET,
-                 (uint32_t)priv->rxfifo,
-                 RXDMA_BUFFER_SIZE,
+                 (uint32_t)RXDMA_BUFFER(priv),
+                 RXDMA_SIZE(priv),
                  SERIAL_DMA_CONTROL_WORD);
 
   /* Reset our DMA shadow pointer to match the address just
@@ -1543,20 +1592,12 @@ static int up_dma_setup(struct uart_dev_s *dev)
 
   priv->rxdmanext = 0;
 
-  /* Enable receive DMA for the UART */
-
-  regval  = up_serialin(priv, STM32_USART_CR3_OFFSET);
-  regval |= USART_CR3_DMAR;
-  up_serialout(priv, STM32_USART_CR3_OFFSET, regval);
-
   /* Start the DMA channel, and arrange for callbacks at the half and
    * full points in the FIFO.  This ensures that we have half a FIFO
    * worth of time to claim bytes before they are overwritten.
    */
 
   stm32_dmastart(priv->rxdma, up_dma_rxcallback, (void *)priv, true);
-
-  return OK;
 }
 #endif
 
@@ -2417,10 +2458,19 @@ static void up_dma_rxcallback(DMA_HANDLE handle, uint8_t status, void *arg)
 {
   struct up_dev_s *priv = (struct up_dev_s *)arg;
 
+#ifdef CONFIG_SERIAL_DMARX
+  /* The data is already in the serial driver's buffer */
+
+  if (priv->rxenable)
+    {
+      uart_recvdma(&priv->dev, up_dma_nextrx(priv));
+    }
+#else
   if (priv->rxenable && up_dma_rxavailable(&priv->dev))
     {
       uart_recvchars(&priv->dev);
     }
+#endif
 }
 #endif
 
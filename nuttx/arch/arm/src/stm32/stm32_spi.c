@@ -127,6 +127,14 @@
 #    error "Unknown STM32 DMA"
 #  endif
 
+/* Exchanges of this many bytes or fewer are cheaper to do by polling than to
+ * set up two DMA streams and wait for their completion interrupts.
+ */
+
+#  ifndef CONFIG_STM32_SPI_DMATHRESHOLD
+#    define CONFIG_STM32_SPI_DMATHRESHOLD 0
+#  endif
+
 #endif
 
 /* DMA channel configuration */
@@ -1251,7 +1259,8 @@ static uint16_t spi_send(FAR struct spi_dev_s *dev, uint16_t wd)
  *
  ************************************************************************************/
 
-#if !defined(CONFIG_STM32_SPI_DMA) || defined(CONFIG_STM32_DMACAPABLE)
+#if !defined(CONFIG_STM32_SPI_DMA) || defined(CONFIG_STM32_DMACAPABLE) || \
+    CONFIG_STM32_SPI_DMATHRESHOLD > 0
 #if !defined(CONFIG_STM32_SPI_DMA)
 static void spi_exchange(FAR struct spi_dev_s *dev, FAR const void *txbuffer,
                          FAR void *rxbuffer, size_t nwords)
@@ -1334,7 +1343,7 @@ static void spi_exchange_nodma(FAR struct spi_dev_s *dev, FAR const void *txbuff
         }
     }
 }
-#endif /* !CONFIG_STM32_SPI_DMA || CONFIG_STM32_DMACAPABLE */
+#endif /* !CONFIG_STM32_SPI_DMA || CONFIG_STM32_DMACAPABLE || CONFIG_STM32_SPI_DMATHRESHOLD */
 
 /*************************************************************************
  * Name: spi_exchange (with DMA capability)
@@ -1362,6 +1371,17 @@ static void spi_exchange(FAR struct spi_dev_s *dev, FAR const void *txbuffer,
 {
   FAR struct stm32_spidev_s *priv = (FAR struct stm32_spidev_s *)dev;
 
+#if CONFIG_STM32_SPI_DMATHRESHOLD > 0
+  size_t nbytes = spi_16bitmode(priv) ? (nwords << 1) : nwords;
+
+  if (nbytes <= CONFIG_STM32_SPI_DMATHRESHOLD)
+    {
+      /* Too short to be worth the DMA setup, just poll */
+
+      spi_exchange_nodma(dev, txbuffer, rxbuffer, nwords);
+    }
+  else
+#endif
 #ifdef CONFIG_STM32_DMACAPABLE
   if ((txbuffer && !stm32_dmacapable((uint32_t)txbuffer, nwords, priv->txccr)) ||
       (rxbuffer && !stm32_dmacapable((uint32_t)rxbuffer, nwords, priv->rxccr)))
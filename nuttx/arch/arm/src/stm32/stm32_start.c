@@ -65,7 +65,7 @@
 #ifdef CONFIG_ARCH_FPU
 static inline void stm32_fpuconfig(void);
 #endif
-#ifdef CONFIG_DEBUG_STACK
+#ifdef CONFIG_STACK_USAGE
 static void go_os_start(void *pv, unsigned int nbytes)
   __attribute__ ((naked,no_instrument_function,noreturn));
 #endif
@@ -186,7 +186,7 @@ static inline void stm32_fpuconfig(void)
  *
  ****************************************************************************/
 
-#ifdef CONFIG_DEBUG_STACK
+#ifdef CONFIG_STACK_USAGE
 static void go_os_start(void *pv, unsigned int nbytes)
 {
   /* Set the IDLE stack to the stack coloration value then jump to
@@ -267,6 +267,17 @@ void __start(void)
 
   showprogress('C');
 
+#ifdef HAVE_RAMFUNCS
+  /* Copy the functions that execute from RAM from their holding spot in
+   * FLASH into SRAM.
+   */
+
+  for (src = &_framfuncs, dest = &_sramfuncs; dest < &_eramfuncs; )
+    {
+      *dest++ = *src++;
+    }
+#endif
+
   /* Perform early serial initialization */
 
 #ifdef USE_EARLYSERIALINIT
@@ -295,7 +306,7 @@ void __start(void)
   showprogress('\r');
   showprogress('\n');
 
-#ifdef CONFIG_DEBUG_STACK
+#ifdef CONFIG_STACK_USAGE
   /* Set the IDLE stack to the coloration value and jump into os_start() */
 
   go_os_start((FAR void *)&_ebss, CONFIG_IDLETHREAD_STACKSIZE);
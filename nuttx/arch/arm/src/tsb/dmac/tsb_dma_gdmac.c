@@ -52,7 +52,8 @@
 #define INCLUDE_MEM2UNIPRO_SUPPORT
 #endif
 
-#if defined(CONFIG_ARCH_I2S_USE_DMA) || defined(CONFIG_ARCH_UART_USE_DMA)
+#if defined(CONFIG_ARCH_I2S_USE_DMA) || defined(CONFIG_ARCH_UART_USE_DMA) || \
+    defined(CONFIG_ARCH_SPI_USE_DMA) || defined(CONFIG_ARCH_I2C_USE_DMA)
 #define INCLUDE_MEM2IO_SUPPORT
 #define INCLUDE_IO2MEM_SUPPORT
 #endif
@@ -2274,6 +2275,45 @@ int gdmac_chan_check_op_params(struct device *dev,
     return retval;
 }
 
+/* Work out how far a running op got from the address the channel is at. */
+int gdmac_get_transferred(struct device *dev, struct tsb_dma_chan *tsb_chan,
+        struct device_dma_op *op, size_t *count)
+{
+    struct tsb_dma_gdmac_channel_regs *channel_regs =
+            (struct tsb_dma_gdmac_channel_regs*) GDMAC_CHANNEL_REGS_ADDRESS;
+    struct tsb_dma_gdmac_channel_control_regs *control_regs =
+            &channel_regs->channel_control_regs[tsb_chan->chan_id];
+    bool use_dst =
+            (tsb_chan->chan_params.dst_inc_options == DEVICE_DMA_INC_AUTO);
+    uint32_t addr;
+    size_t done = 0;
+    uint32_t index;
+
+    /*
+     * The address register of the incrementing side only moves after a
+     * store (or load) completed, so it never counts data sitting in the
+     * MFIFO of the channel.
+     */
+    addr = getreg32(use_dst ? &control_regs->dar : &control_regs->sar);
+
+    for (index = 0; index < op->sg_count; index++) {
+        struct device_dma_sg *sg = &op->sg[index];
+        uint32_t start = (uint32_t)(use_dst ? sg->dst_addr : sg->src_addr);
+
+        if ((addr >= start) && (addr <= start + sg->len)) {
+            *count = done + (addr - start);
+            return OK;
+        }
+
+        done += sg->len;
+    }
+
+    /* The channel hasn't loaded the first descriptor yet. */
+    *count = 0;
+
+    return OK;
+}
+
 int gdmac_chan_free(struct device *dev, struct tsb_dma_chan *tsb_chan)
 {
     struct tsb_dma_gdmac_control_regs *control_regs =
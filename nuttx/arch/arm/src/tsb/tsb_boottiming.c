@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+
+#include <stdint.h>
+
+#include "up_arch.h"
+#include "nvic.h"
+
+#include "tsb_boottiming.h"
+
+/* The DWT cycle counter runs off the CPU clock from the first instruction,
+ * unlike the timers which are only set up by up_initialize().
+ */
+
+#define DWT_CTRL                0xe0001000
+#define DWT_CYCCNT              0xe0001004
+#define DWT_CTRL_CYCCNTENA      (1 << 0)
+
+#define CPU_CYCLES_PER_USEC     96
+
+void tsb_boot_timing_init(void)
+{
+    modifyreg32(NVIC_DEMCR, 0, NVIC_DEMCR_TRCENA);
+    putreg32(0, DWT_CYCCNT);
+    modifyreg32(DWT_CTRL, 0, DWT_CTRL_CYCCNTENA);
+}
+
+/*
+ * Microseconds since tsb_start(). The counter wraps after about 44s, which
+ * is far beyond the boot.
+ */
+uint32_t up_boot_timestamp(void)
+{
+    return getreg32(DWT_CYCCNT) / CPU_CYCLES_PER_USEC;
+}
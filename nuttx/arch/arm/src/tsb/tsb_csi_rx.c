@@ -36,11 +36,81 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
 #include <arch/tsb/cdsi.h>
 #include <arch/tsb/cdsi0_offs_def.h>
 #include <arch/tsb/cdsi0_reg_def.h>
 #include <arch/tsb/csi.h>
 
+#include "chip.h"
+
+#define CSI_RX_NUM_VCHAN                4
+
+#define CSI_RX_CSI2_VC_SH_INT_STAT(vc) \
+    (CDSI0_CDSIRX_CSI2_VC0_SH_INT_STAT_OFFS + (vc) * 8)
+#define CSI_RX_CSI2_VC_SH_INT_MASK(vc) \
+    (CDSI0_CDSIRX_CSI2_VC0_SH_INT_MASK_OFFS + (vc) * 8)
+
+/* The VCn bits of the CSI2 short packet registers are at the same place. */
+#define CSI_RX_SH_INT_FS    CDSI0_CDSIRX_CSI2_VC0_SH_INT_STAT_VC0_FS_MASK
+#define CSI_RX_SH_INT_FE    CDSI0_CDSIRX_CSI2_VC0_SH_INT_STAT_VC0_FE_MASK
+#define CSI_RX_SH_INT_ALL   0xffff
+
+/*
+ * The RX bridge encapsulates the CSI-2 packets into UniPro segments by
+ * itself, the CPU never touches the frame data. It only gets the frame
+ * boundaries and the bridge overflows, if the user asked for them.
+ */
+struct csi_rx_events {
+    struct cdsi_dev *dev;
+    csi_rx_event_cb cb;
+    void *priv;
+    unsigned int vchan;
+    uint32_t frame;
+    int shtpkt_irq;
+    int overflow_irq;
+};
+
+static struct csi_rx_events csi_rx_events[2];
+
+static struct csi_rx_events *csi_rx_get_events(struct cdsi_dev *dev)
+{
+    return &csi_rx_events[dev->base == CDSI0_BASE ? TSB_CDSI0 : TSB_CDSI1];
+}
+
+static int csi_rx_shtpkt_irq(int irq, void *context, void *priv)
+{
+    struct csi_rx_events *events = priv;
+    uint32_t offset = CSI_RX_CSI2_VC_SH_INT_STAT(events->vchan);
+    uint32_t val;
+
+    val = cdsi_read(events->dev, offset);
+    cdsi_write(events->dev, offset, val);
+
+    /*
+     * When both are pending the handler ran late, and the end of a frame
+     * comes before the start of the next one.
+     */
+    if (val & CSI_RX_SH_INT_FE)
+        events->cb(CSI_RX_EVENT_FRAME_END, events->frame++, events->priv);
+    if (val & CSI_RX_SH_INT_FS)
+        events->cb(CSI_RX_EVENT_FRAME_START, events->frame, events->priv);
+
+    return 0;
+}
+
+static int csi_rx_overflow_irq(int irq, void *context, void *priv)
+{
+    struct csi_rx_events *events = priv;
+
+    cdsi_write(events->dev, CDSI0_AL_RX_BRG_INT_STAT_OFFS,
+               CDSI0_AL_RX_BRG_INT_STAT_OVERFLOW_MASK);
+    events->cb(CSI_RX_EVENT_OVERFLOW, events->frame, events->priv);
+
+    return 0;
+}
+
 /**
  * @brief Initialize the CSI receiver
  * @param dev dev pointer to structure of cdsi_dev device data
@@ -54,12 +124,31 @@
  * in that state, even if not started yet. To uninitialize the CSI receiver and
  * put it back to sleep call csi_rx_uninit().
  *
- * This function is stateless and must only be called when the CSI receiver is
- * unintialized.
+ * Only the virtual channel cfg->vchan is forwarded. When cfg->event_cb is set
+ * it is called on the frame start and end short packets of that virtual
+ * channel and on RX bridge overflows, from csi_rx_start() to csi_rx_stop().
+ *
+ * This function must only be called when the CSI receiver is unintialized.
  */
 int csi_rx_init(struct cdsi_dev *dev, const struct csi_rx_config *cfg)
 {
+    struct csi_rx_events *events = csi_rx_get_events(dev);
+    uint32_t func_enable;
     unsigned int timeout;
+    unsigned int vc;
+
+    if (cfg->vchan >= CSI_RX_NUM_VCHAN)
+        return -EINVAL;
+
+    events->dev = dev;
+    events->cb = cfg->event_cb;
+    events->priv = cfg->priv;
+    events->vchan = cfg->vchan;
+    events->shtpkt_irq = dev->base == CDSI0_BASE ? TSB_IRQ_CDSI0_RX_SHTPKT
+                                                 : TSB_IRQ_CDSI1_RX_SHTPKT;
+    events->overflow_irq = dev->base == CDSI0_BASE ?
+                           TSB_IRQ_CDSI0_AL_RX_FIFO_OVF :
+                           TSB_IRQ_CDSI1_AL_RX_FIFO_OVF;
 
     cdsi_enable(dev);
 
@@ -72,19 +161,24 @@ int csi_rx_init(struct cdsi_dev *dev, const struct csi_rx_config *cfg)
     cdsi_write(dev, CDSI0_AL_RX_BRG_CSI_DT1_OFFS, 0);
     cdsi_write(dev, CDSI0_AL_RX_BRG_CSI_DT2_OFFS, 0);
     cdsi_write(dev, CDSI0_AL_RX_BRG_CSI_DT3_OFFS, 0);
+    cdsi_write(dev, CDSI0_AL_RX_BRG_INT_MASK_OFFS,
+               events->cb ? 0 : CDSI0_AL_RX_BRG_INT_MASK_MASKOVERFLOW_MASK);
 
     /* Enable CDSIRX */
     cdsi_write(dev, CDSI0_CDSIRX_CLKEN_OFFS, CDSI0_CDSIRX_CLKEN_CDSIRXEN_MASK);
 
     /* Set CDSIRX functions enable */
-    cdsi_write(dev, CDSI0_CDSIRX_FUNC_ENABLE_OFFS,
-               CDSI0_CDSIRX_FUNC_ENABLE_RXERRINTEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_DSIRXTRGINTEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_LPRXSTATEEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_RXERRINTSTATEEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_DSIRXTRIGINTSTATEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_LPRXSTATEINTSTATEEN_MASK |
-               CDSI0_CDSIRX_FUNC_ENABLE_HSTOCNTEN_MASK);
+    func_enable = CDSI0_CDSIRX_FUNC_ENABLE_RXERRINTEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_DSIRXTRGINTEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_LPRXSTATEEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_RXERRINTSTATEEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_DSIRXTRIGINTSTATEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_LPRXSTATEINTSTATEEN_MASK |
+                  CDSI0_CDSIRX_FUNC_ENABLE_HSTOCNTEN_MASK;
+    if (events->cb)
+        func_enable |= CDSI0_CDSIRX_FUNC_ENABLE_SHTPKTINTSTATEEN_MASK |
+                       CDSI0_CDSIRX_FUNC_ENABLE_SHTPKTINTEN_MASK;
+    cdsi_write(dev, CDSI0_CDSIRX_FUNC_ENABLE_OFFS, func_enable);
     cdsi_write(dev, CDSI0_CDSIRX_ADDRESS_CONFIG_OFFS, 0);
 
     /* Set LPRX calibration */
@@ -114,10 +208,7 @@ int csi_rx_init(struct cdsi_dev *dev, const struct csi_rx_config *cfg)
                CDSI0_CDSIRX_LANE_ENABLE_CLANEEN_MASK |
                (cfg->num_lanes << CDSI0_CDSIRX_LANE_ENABLE_DTLANEEN_SHIFT));
     cdsi_write(dev, CDSI0_CDSIRX_VC_ENABLE_OFFS,
-               CDSI0_CDSIRX_VC_ENABLE_VC3EN_MASK |
-               CDSI0_CDSIRX_VC_ENABLE_VC2EN_MASK |
-               CDSI0_CDSIRX_VC_ENABLE_VC1EN_MASK |
-               CDSI0_CDSIRX_VC_ENABLE_VC0EN_MASK);
+               CDSI0_CDSIRX_VC_ENABLE_VC0EN_MASK << cfg->vchan);
     cdsi_write(dev, CDSI0_CDSIRX_LINE_INIT_COUNT_OFFS, 4800);
     cdsi_write(dev, CDSI0_CDSIRX_HSRXTO_COUNT_OFFS, 0xffffffff);
     cdsi_write(dev, CDSI0_CDSIRX_FUNC_MODE_OFFS, 0);
@@ -175,10 +266,14 @@ int csi_rx_init(struct cdsi_dev *dev, const struct csi_rx_config *cfg)
     cdsi_write(dev, CDSI0_CDSIRX_DSI_VC1_LN_INT_MASK_OFFS, 0);
     cdsi_write(dev, CDSI0_CDSIRX_DSI_VC2_LN_INT_MASK_OFFS, 0);
     cdsi_write(dev, CDSI0_CDSIRX_DSI_VC3_LN_INT_MASK_OFFS, 0);
-    cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC0_SH_INT_MASK_OFFS, 0);
-    cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC1_SH_INT_MASK_OFFS, 0);
-    cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC2_SH_INT_MASK_OFFS, 0);
-    cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC3_SH_INT_MASK_OFFS, 0);
+    for (vc = 0; vc < CSI_RX_NUM_VCHAN; vc++) {
+        if (events->cb && vc == cfg->vchan)
+            cdsi_write(dev, CSI_RX_CSI2_VC_SH_INT_MASK(vc),
+                       CSI_RX_SH_INT_ALL &
+                       ~(CSI_RX_SH_INT_FS | CSI_RX_SH_INT_FE));
+        else
+            cdsi_write(dev, CSI_RX_CSI2_VC_SH_INT_MASK(vc), 0);
+    }
     cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC0_LN0_INT_MASK_OFFS, 0);
     cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC0_LN1_INT_MASK_OFFS, 0);
     cdsi_write(dev, CDSI0_CDSIRX_CSI2_VC1_LN0_INT_MASK_OFFS, 0);
@@ -258,15 +353,30 @@ int csi_rx_uninit(struct cdsi_dev *dev)
  * the stopped state (LP-11). The caller must thus start the CSI input after the
  * CSI receiver.
  *
- * This function is stateless and must only be called when the CSI receiver is
- * initialized and not started.
+ * This function must only be called when the CSI receiver is initialized and
+ * not started.
  *
  * To stop the CSI receiver call csi_rx_stop().
  */
 int csi_rx_start(struct cdsi_dev *dev)
 {
+    struct csi_rx_events *events = csi_rx_get_events(dev);
     unsigned int timeout;
 
+    if (events->cb) {
+        events->frame = 0;
+
+        cdsi_write(dev, CSI_RX_CSI2_VC_SH_INT_STAT(events->vchan),
+                   CSI_RX_SH_INT_ALL);
+        cdsi_write(dev, CDSI0_AL_RX_BRG_INT_STAT_OFFS,
+                   CDSI0_AL_RX_BRG_INT_STAT_OVERFLOW_MASK);
+
+        irq_attach(events->shtpkt_irq, csi_rx_shtpkt_irq, events);
+        irq_attach(events->overflow_irq, csi_rx_overflow_irq, events);
+        up_enable_irq(events->shtpkt_irq);
+        up_enable_irq(events->overflow_irq);
+    }
+
     /* Clear the line initialization done status. */
     cdsi_write(dev, CDSI0_CDSIRX_LPRX_STATE_INT_STAT_OFFS,
                CDSI0_CDSIRX_LPRX_STATE_INT_STAT_LINEINITDONE_MASK);
@@ -310,11 +420,11 @@ int csi_rx_start(struct cdsi_dev *dev)
  * the stopped state (LP-11). The caller must thus stop the CSI input before the
  * CSI receiver.
  *
- * This function is stateless and must only be called when the CSI receiver is
- * started.
+ * This function must only be called when the CSI receiver is started.
  */
 int csi_rx_stop(struct cdsi_dev *dev)
 {
+    struct csi_rx_events *events = csi_rx_get_events(dev);
     const uint32_t hs_mask = CDSI0_CDSIRX_LANE_STATUS_HS_CLRXACTIVEHS_MASK
                            | CDSI0_CDSIRX_LANE_STATUS_HS_D3RXACTIVEHS_MASK
                            | CDSI0_CDSIRX_LANE_STATUS_HS_D2RXACTIVEHS_MASK
@@ -372,6 +482,13 @@ int csi_rx_stop(struct cdsi_dev *dev)
     else
         printf("cdsi: CDSIRX became idle (%u us)\n", timeout * 10);
 
+    if (events->cb) {
+        up_disable_irq(events->shtpkt_irq);
+        up_disable_irq(events->overflow_irq);
+        irq_detach(events->shtpkt_irq);
+        irq_detach(events->overflow_irq);
+    }
+
     /* Stop CDSIRX and clear its internal state. */
     cdsi_write(dev, CDSI0_CDSIRX_START_OFFS, 0);
     cdsi_write(dev, CDSI0_CDSIRX_SYSTEM_INIT_OFFS,
@@ -46,6 +46,11 @@
 #define CDSITX_PLL_HSCK_MIN_FREQ_HZ     62500000
 #define CDSITX_PLL_HSCK_MAX_FREQ_HZ     1000000000
 
+/* CSI-2 long packet header and footer, and margin for the LP/HS transitions */
+#define CSI_TX_PACKET_OVERHEAD          6
+#define CSI_TX_BW_MARGIN_PERCENT        20
+#define CSI_TX_MAX_VCHAN                4
+
 /* Timing parameters for csi transmitter */
 /**
  * @brief Associates clocks configuration values to
@@ -598,6 +603,73 @@ static void csi_tx_set_timings(struct cdsi_dev *dev, struct csi_tx_config *cfg)
     cdsi_write(dev, CDSI0_CDSITX_GLOBAL_TIMING_PARAM_10_OFFS, val);
 }
 
+/**
+ * @brief Compute the CSI configuration needed to carry a set of streams
+ *
+ * Every enabled lane brings its own HS driver and LP to HS transitions on
+ * each line, while the PLL VCO runs between 1 and 2 GHz whatever the bus
+ * frequency is, so the fewest lanes able to carry the aggregate bit rate are
+ * used, at the lowest bus frequency.
+ *
+ * @param streams Streams sent concurrently on the link
+ * @param num_streams Number of streams
+ * @param max_lanes Number of data lanes wired to the receiver
+ * @param flags Flags for the CSI transmitter configuration
+ * @param cfg Pointer to structure filled with the CSI configuration
+ *
+ * @return 0 on success, -EINVAL if the streams can't be carried
+ */
+int csi_tx_compute_config(const struct csi_tx_stream *streams,
+                          unsigned int num_streams, unsigned int max_lanes,
+                          uint8_t flags, struct csi_tx_config *cfg)
+{
+    uint64_t bit_rate = 0;
+    uint32_t lines_per_second = 0;
+    uint64_t bus_freq;
+    unsigned int lanes;
+    unsigned int i;
+
+    if (!num_streams || max_lanes < 1)
+        return -EINVAL;
+
+    for (i = 0; i < num_streams; i++) {
+        const struct csi_tx_stream *stream = &streams[i];
+        uint32_t line_bytes;
+
+        if (stream->vchan >= CSI_TX_MAX_VCHAN || !stream->bpp) {
+            lldbg("CDSI: Invalid stream %u\n", i);
+            return -EINVAL;
+        }
+
+        line_bytes = (stream->width * stream->bpp + 7) / 8 +
+                     CSI_TX_PACKET_OVERHEAD;
+        bit_rate += (uint64_t)line_bytes * 8 * stream->lines * stream->fps;
+        lines_per_second += stream->lines * stream->fps;
+    }
+
+    bit_rate += bit_rate * CSI_TX_BW_MARGIN_PERCENT / 100;
+
+    for (lanes = 1; lanes <= MIN(max_lanes, 4); lanes <<= 1) {
+        /* Data is sent on both edges of the clock */
+        bus_freq = (bit_rate + lanes * 2 - 1) / (lanes * 2);
+        if (bus_freq <= CDSITX_PLL_HSCK_MAX_FREQ_HZ)
+            break;
+    }
+
+    if (lanes > MIN(max_lanes, 4)) {
+        lldbg("CDSI: %u kbps exceed the link capacity\n",
+              (uint32_t)(bit_rate / 1000));
+        return -EINVAL;
+    }
+
+    cfg->flags = flags;
+    cfg->num_lanes = lanes;
+    cfg->bus_freq = MAX(bus_freq, CDSITX_PLL_HSCK_MIN_FREQ_HZ);
+    cfg->lines_per_second = lines_per_second;
+
+    return csi_tx_validate_config(cfg);
+}
+
 /**
  * @brief Validate the supplied configuration values for the CSI interface
  *
@@ -29,6 +29,7 @@
  * @brief Pseudo DMA driver that uses memcpy instead of real DMA
  */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <semaphore.h>
@@ -38,6 +39,7 @@
 #include <nuttx/device.h>
 #include <nuttx/device_dma.h>
 #include <nuttx/list.h>
+#include <nuttx/hires_tmr.h>
 
 #include "debug.h"
 #include "up_arch.h"
@@ -48,6 +50,9 @@
 
 #define TSM_DMA_DEQUEUE_WAIT_TIMEOUT_MS 20
 
+/* keep the sg entries of the ops of a pool 64-bit aligned */
+#define TSB_DMA_OP_POOL_ALIGN(size)     (((size) + 7) & ~7)
+
 enum tsb_dma_op_state {
     TSB_DMA_OP_STATE_IDLE,
     TSB_DMA_OP_STATE_QUEUED,
@@ -65,9 +70,35 @@ struct tsb_dma_op {
     enum tsb_dma_op_state state;
     enum device_dma_error error;
     unsigned int events;
+    /* the pool the op comes from, if any */
+    struct tsb_dma_op_pool *pool;
+#ifdef CONFIG_ARCH_DMA_STATS
+    uint32_t enqueue_usec;
+    uint32_t start_usec;
+#endif
     struct device_dma_op op;
 };
 
+/*
+ * Ops preallocated for a channel. They are checked against the channel
+ * parameters when the pool is created, and sit on free_ops while they are
+ * not in use.
+ */
+struct tsb_dma_op_pool {
+    struct list_head free_ops;
+    unsigned int count;
+    unsigned int avail;
+    unsigned int sg_max;
+    size_t stride;
+    /* the channel was freed while some ops were still in use */
+    bool orphan;
+};
+
+#define tsb_dma_op_pool_op(pool, index) \
+    ((struct tsb_dma_op *) ((char *) (pool) + \
+        TSB_DMA_OP_POOL_ALIGN(sizeof(struct tsb_dma_op_pool)) + \
+        (index) * (pool)->stride))
+
 /* structure for GDMAC device driver's private info. */
 struct tsb_dma_info {
     pthread_mutex_t lock;
@@ -82,6 +113,107 @@ struct tsb_dma_info {
     struct tsb_dma_chan *chans[0];
 };
 
+#ifdef CONFIG_ARCH_DMA_STATS
+/* the controller tsb_dma_get_chan_stats() reads from */
+static struct tsb_dma_info *tsb_dma_stats_info;
+
+#define tsb_dma_stats_inc(dma_chan, field)  ((dma_chan)->stats.field++)
+
+/* The following must be called with interrupts disabled. */
+static void tsb_dma_stats_enqueue(struct tsb_dma_chan *dma_chan,
+        struct tsb_dma_op *dma_op)
+{
+    uint32_t depth = list_count(&dma_chan->queue);
+
+    dma_op->enqueue_usec = hrt_getusec();
+    dma_chan->stats.queued++;
+    if (depth > dma_chan->stats.max_depth) {
+        dma_chan->stats.max_depth = depth;
+    }
+}
+
+static void tsb_dma_stats_start(struct tsb_dma_op *dma_op)
+{
+    dma_op->start_usec = hrt_getusec();
+}
+
+static void tsb_dma_stats_complete(struct tsb_dma_chan *dma_chan,
+        struct tsb_dma_op *dma_op)
+{
+    struct tsb_dma_chan_stats *stats = &dma_chan->stats;
+    uint32_t now = hrt_getusec();
+    uint32_t latency = (now - dma_op->enqueue_usec) >>
+                       TSB_DMA_LATENCY_MIN_SHIFT;
+    unsigned int bucket = 0;
+    unsigned int index;
+
+    stats->completed++;
+    stats->busy_usec += now - dma_op->start_usec;
+    for (index = 0; index < dma_op->op.sg_count; index++) {
+        stats->bytes += dma_op->op.sg[index].len;
+    }
+
+    while (latency != 0 && bucket < TSB_DMA_LATENCY_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+    stats->latency[bucket]++;
+}
+
+int tsb_dma_get_chan_stats(unsigned int chan_id,
+        struct tsb_dma_chan_stats *stats)
+{
+    struct tsb_dma_info *info;
+    irqstate_t flags;
+    int retval = OK;
+
+    flags = irqsave();
+
+    info = tsb_dma_stats_info;
+    if (info == NULL) {
+        retval = -ENODEV;
+    } else if (chan_id >= info->max_chan) {
+        retval = -ERANGE;
+    } else if (info->chans[chan_id] == NULL) {
+        retval = -ENOENT;
+    } else {
+        memcpy(stats, &info->chans[chan_id]->stats, sizeof(*stats));
+    }
+
+    irqrestore(flags);
+
+    return retval;
+}
+
+void tsb_dma_reset_stats(void)
+{
+    struct tsb_dma_chan_stats *stats;
+    struct tsb_dma_info *info;
+    irqstate_t flags;
+    unsigned int chan_id;
+
+    flags = irqsave();
+
+    info = tsb_dma_stats_info;
+    for (chan_id = 0; info && chan_id < info->max_chan; chan_id++) {
+        if (info->chans[chan_id] == NULL)
+            continue;
+
+        /* keep the devices, they describe the channel */
+        stats = &info->chans[chan_id]->stats;
+        memset(&stats->queued, 0,
+               sizeof(*stats) - offsetof(struct tsb_dma_chan_stats, queued));
+    }
+
+    irqrestore(flags);
+}
+#else
+#define tsb_dma_stats_inc(dma_chan, field)
+#define tsb_dma_stats_enqueue(dma_chan, dma_op)
+#define tsb_dma_stats_start(dma_op)
+#define tsb_dma_stats_complete(dma_chan, dma_op)
+#endif
+
 static int tsb_dma_restart_chan(struct device *dev,
         struct tsb_dma_chan *dma_chan)
 {
@@ -129,6 +261,7 @@ static int tsb_dma_restart_chan(struct device *dev,
              */
             if ((retval == OK) &&
                 (dma_op->state == TSB_DMA_OP_STATE_STARTING)) {
+                tsb_dma_stats_start(dma_op);
                 retval = gdmac_start_op(dev, dma_chan, &dma_op->op);
                 if (retval == OK) {
                     dma_op->state = TSB_DMA_OP_STATE_RUNNING;
@@ -155,6 +288,40 @@ static int tsb_dma_restart_chan(struct device *dev,
     return retval;
 }
 
+/*
+ * Have the driver thread start the next op queued on the channel. Used from
+ * interrupt context, where tsb_dma_restart_chan() cannot be called.
+ */
+static void tsb_dma_request_restart(struct tsb_dma_info *info,
+        struct tsb_dma_chan *dma_chan)
+{
+    dma_chan->restart_pending = true;
+    sem_post(&info->op_completed_sem);
+}
+
+static void tsb_dma_restart_pending_chans(struct device *dev,
+        struct tsb_dma_info *info)
+{
+    struct tsb_dma_chan *dma_chan;
+    irqstate_t flags;
+    unsigned int chan;
+    bool pending;
+
+    for (chan = 0; chan < info->max_chan; chan++) {
+        flags = irqsave();
+        dma_chan = info->chans[chan];
+        pending = dma_chan != NULL && dma_chan->restart_pending;
+        if (pending) {
+            dma_chan->restart_pending = false;
+        }
+        irqrestore(flags);
+
+        if (pending) {
+            tsb_dma_restart_chan(dev, dma_chan);
+        }
+    }
+}
+
 static void *tsb_dma_process_completed_op(void *arg)
 {
     struct device *dev = arg;
@@ -165,6 +332,8 @@ static void *tsb_dma_process_completed_op(void *arg)
 
         sem_wait(&dma_info->op_completed_sem);
 
+        tsb_dma_restart_pending_chans(dev, dma_info);
+
         list_foreach_safe(&dma_info->completed_queue, node, next_node) {
             struct tsb_dma_op* dma_op;
             int chan_id;
@@ -173,6 +342,13 @@ static void *tsb_dma_process_completed_op(void *arg)
             dma_op = list_entry(node, struct tsb_dma_op, list_node);
             chan_id = dma_op->chan_id;
 
+            /*
+             * Start the next op queued on the channel before running the
+             * callback, so that clients keeping several ops queued ahead
+             * don't see the channel idle for the duration of the callback.
+             */
+            tsb_dma_restart_chan(dev, dma_info->chans[chan_id]);
+
             if (dma_op->op.callback == NULL) {
                 lldbg("gdmac: gdmac: Invalid callback\n");
             } else {
@@ -200,8 +376,6 @@ static void *tsb_dma_process_completed_op(void *arg)
                     break;
                 }
             }
-
-            tsb_dma_restart_chan(dev, dma_info->chans[chan_id]);
         }
     }
 
@@ -250,6 +424,9 @@ static int tsb_dma_open(struct device *dev)
         retval = -retval;
     } else {
         pthread_mutex_unlock(&info->lock);
+#ifdef CONFIG_ARCH_DMA_STATS
+        tsb_dma_stats_info = info;
+#endif
     }
 
     return retval;
@@ -258,12 +435,21 @@ static int tsb_dma_open(struct device *dev)
 static void tsb_dma_close(struct device *dev)
 {
     struct tsb_dma_info *info = device_get_private(dev);
+#ifdef CONFIG_ARCH_DMA_STATS
+    irqstate_t flags;
+#endif
     unsigned int chan;
 
     if (!info) {
         return;
     }
 
+#ifdef CONFIG_ARCH_DMA_STATS
+    flags = irqsave();
+    tsb_dma_stats_info = NULL;
+    irqrestore(flags);
+#endif
+
     info->driver_closed = true;
     sem_post(&info->op_completed_sem);
 
@@ -337,6 +523,10 @@ static int tsb_dma_check_chan_params(struct device_dma_params *params)
         return DEVICE_DMA_ERROR_BAD_SWAP;
     }
 
+    if (params->flags & ~DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK) {
+        return DEVICE_DMA_ERROR_BAD_FLAG;
+    }
+
     return DEVICE_DMA_ERROR_NONE;
 }
 
@@ -375,6 +565,8 @@ static int tsb_dma_chan_alloc(struct device *dev,
 
             if (retval == OK) {
                 dma_chan->chan_id = index;
+                dma_chan->restart_pending = false;
+                dma_chan->op_pool = NULL;
                 pthread_mutex_init(&dma_chan->chan_mutex, NULL);
 
                 list_init(&dma_chan->queue);
@@ -384,6 +576,12 @@ static int tsb_dma_chan_alloc(struct device *dev,
                  */
                 memcpy(&dma_chan->chan_params, params, sizeof(*params));
 
+#ifdef CONFIG_ARCH_DMA_STATS
+                memset(&dma_chan->stats, 0, sizeof(dma_chan->stats));
+                dma_chan->stats.src_dev = params->src_dev;
+                dma_chan->stats.dst_dev = params->dst_dev;
+#endif
+
                 info->chans[index] = dma_chan;
 
                 *chan = dma_chan;
@@ -433,6 +631,32 @@ static void tsb_dma_wait_for_all_op_dequeued(struct tsb_dma_info *info,
 
 }
 
+/*
+ * Detach the op pool from a channel being freed. The pool is freed right
+ * away unless the client still holds some of its ops, in which case the
+ * last one given back frees it.
+ */
+static void tsb_dma_op_pool_release(struct tsb_dma_chan *dma_chan)
+{
+    struct tsb_dma_op_pool *pool = dma_chan->op_pool;
+    irqstate_t flags;
+    bool in_use;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    flags = irqsave();
+    dma_chan->op_pool = NULL;
+    in_use = pool->avail != pool->count;
+    pool->orphan = in_use;
+    irqrestore(flags);
+
+    if (!in_use) {
+        free(pool);
+    }
+}
+
 static int tsb_dma_chan_free(struct device *dev, void *chan)
 {
     struct tsb_dma_info *info;
@@ -466,6 +690,7 @@ static int tsb_dma_chan_free(struct device *dev, void *chan)
             switch (dma_op->state) {
             case TSB_DMA_OP_STATE_QUEUED:
                 list_del(node);
+                tsb_dma_stats_inc(dma_chan, dequeued);
 
                 dma_op->state = TSB_DMA_OP_STATE_DEQUEUED;
                 if ((dev_op->callback != NULL) &&
@@ -500,6 +725,8 @@ static int tsb_dma_chan_free(struct device *dev, void *chan)
 
             pthread_mutex_destroy(&dma_chan->chan_mutex);
 
+            tsb_dma_op_pool_release(dma_chan);
+
             info->chans[dma_chan->chan_id] = NULL;
             info->avail_chan++;
             retval = gdmac_chan_free(dev, dma_chan);
@@ -542,6 +769,147 @@ static int tsb_dma_op_alloc(struct device *dev, unsigned int sg_count,
     return OK;
 }
 
+static int tsb_dma_op_pool_create(struct device *dev, void *chan,
+        unsigned int count, unsigned int sg_count, unsigned int extra,
+        const struct device_dma_op *template)
+{
+    struct tsb_dma_info *info;
+    struct tsb_dma_chan *dma_chan = chan;
+    struct tsb_dma_op_pool *pool;
+    struct tsb_dma_op *dma_op;
+    irqstate_t flags;
+    unsigned int index;
+    size_t stride;
+    int retval;
+
+    if ((dev == NULL) || (chan == NULL) || (template == NULL) ||
+        (count == 0) || (template->sg_count > sg_count)) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+    if (!info) {
+        return -EIO;
+    }
+
+    if (dma_chan->op_pool != NULL) {
+        return -EBUSY;
+    }
+
+    /* This is the only time the ops of the pool get checked */
+    retval = gdmac_chan_check_op_params(dev, dma_chan,
+                                        (struct device_dma_op *) template);
+    if (retval != DEVICE_DMA_ERROR_NONE) {
+        lldbg("gdmac: Failed in parameters check.\n");
+        return -EINVAL;
+    }
+
+    stride = TSB_DMA_OP_POOL_ALIGN(sizeof(struct tsb_dma_op) +
+                                   sizeof(struct device_dma_sg) * sg_count +
+                                   extra);
+
+    pool = zalloc(TSB_DMA_OP_POOL_ALIGN(sizeof(struct tsb_dma_op_pool)) +
+                  stride * count);
+    if (pool == NULL) {
+        return -ENOMEM;
+    }
+
+    list_init(&pool->free_ops);
+    pool->count = count;
+    pool->avail = count;
+    pool->sg_max = sg_count;
+    pool->stride = stride;
+    pool->orphan = false;
+
+    for (index = 0; index < count; index++) {
+        dma_op = tsb_dma_op_pool_op(pool, index);
+
+        dma_op->state = TSB_DMA_OP_STATE_IDLE;
+        dma_op->error = DEVICE_DMA_ERROR_NONE;
+        dma_op->pool = pool;
+        memcpy(&dma_op->op, template, sizeof(*template) +
+               sizeof(struct device_dma_sg) * template->sg_count);
+
+        list_add(&pool->free_ops, &dma_op->list_node);
+    }
+
+    flags = irqsave();
+    dma_chan->op_pool = pool;
+    irqrestore(flags);
+
+    return OK;
+}
+
+static int tsb_dma_op_pool_alloc(struct device *dev, void *chan,
+        struct device_dma_op **op)
+{
+    struct tsb_dma_chan *dma_chan = chan;
+    struct tsb_dma_op_pool *pool;
+    struct tsb_dma_op *dma_op;
+    irqstate_t flags;
+    int retval = OK;
+
+    if ((dev == NULL) || (chan == NULL) || (op == NULL)) {
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+
+    pool = dma_chan->op_pool;
+    if (pool == NULL) {
+        retval = -EINVAL;
+    } else if (list_is_empty(&pool->free_ops)) {
+        retval = -ENOMEM;
+    } else {
+        dma_op = list_entry(pool->free_ops.next, struct tsb_dma_op,
+                            list_node);
+        list_del(&dma_op->list_node);
+        pool->avail--;
+
+        dma_op->state = TSB_DMA_OP_STATE_IDLE;
+        dma_op->error = DEVICE_DMA_ERROR_NONE;
+
+        *op = &dma_op->op;
+    }
+
+    irqrestore(flags);
+
+    return retval;
+}
+
+/* Give an op back to its pool, from a thread or a DMA callback. */
+static int tsb_dma_op_pool_put(struct tsb_dma_op *dma_op)
+{
+    struct tsb_dma_op_pool *pool = dma_op->pool;
+    irqstate_t flags;
+    bool release;
+
+    flags = irqsave();
+
+    /* still queued on the channel, or already back in the pool */
+    if (!list_is_empty(&dma_op->list_node)) {
+        irqrestore(flags);
+        return -EINVAL;
+    }
+
+    list_add(&pool->free_ops, &dma_op->list_node);
+    pool->avail++;
+
+    release = pool->orphan && (pool->avail == pool->count);
+
+    irqrestore(flags);
+
+    /*
+     * The channel is gone, so this is not one of its callbacks: the op is
+     * given back from a thread.
+     */
+    if (release) {
+        free(pool);
+    }
+
+    return OK;
+}
+
 static int tsb_dma_op_free(struct device *dev, struct device_dma_op *op)
 {
     struct tsb_dma_info *info;
@@ -557,6 +925,10 @@ static int tsb_dma_op_free(struct device *dev, struct device_dma_op *op)
     }
 
     dma_op = containerof(op, struct tsb_dma_op, op);
+    if (dma_op->pool != NULL) {
+        return tsb_dma_op_pool_put(dma_op);
+    }
+
     if ((list_is_empty(&dma_op->list_node) == 0) &&
         ((dma_op->state != TSB_DMA_OP_STATE_IDLE) ||
          (dma_op->state != TSB_DMA_OP_STATE_COMPLETED))) {
@@ -641,12 +1013,20 @@ static int tsb_dma_enqueue(struct device *dev, void *chan,
         return -EIO;
     }
 
-    /* Check the op if there is any alignment issue */
-    retval = gdmac_chan_check_op_params(dev, dma_chan, op);
-    if (retval != DEVICE_DMA_ERROR_NONE) {
-        lldbg("gdmac: Failed in parameters check.\n");
-        dma_op->error = retval;
+    /*
+     * Check the op if there is any alignment issue. The ops of the channel
+     * pool were checked when the pool was created.
+     */
+    if ((dma_op->pool == NULL) || (dma_op->pool != dma_chan->op_pool)) {
+        retval = gdmac_chan_check_op_params(dev, dma_chan, op);
+        if (retval != DEVICE_DMA_ERROR_NONE) {
+            lldbg("gdmac: Failed in parameters check.\n");
+            dma_op->error = retval;
 
+            return -EINVAL;
+        }
+    } else if (op->sg_count > dma_op->pool->sg_max) {
+        dma_op->error = DEVICE_DMA_ERROR_INVALID;
         return -EINVAL;
     }
 
@@ -654,16 +1034,35 @@ static int tsb_dma_enqueue(struct device *dev, void *chan,
 
     flags = irqsave();
 
-    /* Add the op to the queue on the channel */
-    if (dma_op->state == TSB_DMA_OP_STATE_IDLE) {
-        list_add(&dma_chan->queue, &dma_op->list_node);
-        dma_op->state = TSB_DMA_OP_STATE_QUEUED;
-        retval = OK;
+    /*
+     * Add the op to the queue on the channel. An op that completed or was
+     * dequeued can be enqueued again as is.
+     */
+    switch (dma_op->state) {
+    case TSB_DMA_OP_STATE_IDLE:
+    case TSB_DMA_OP_STATE_COMPLETED:
+    case TSB_DMA_OP_STATE_DEQUEUED:
+        if (list_is_empty(&dma_op->list_node)) {
+            list_add(&dma_chan->queue, &dma_op->list_node);
+            dma_op->state = TSB_DMA_OP_STATE_QUEUED;
+            dma_op->error = DEVICE_DMA_ERROR_NONE;
+            tsb_dma_stats_enqueue(dma_chan, dma_op);
+        } else {
+            retval = -EBUSY;
+        }
+        break;
+    default:
+        break;
     }
 
     irqrestore(flags);
 
-    tsb_dma_restart_chan(dev, dma_chan);
+    /* The op can be enqueued from an IRQ callback of the same channel */
+    if (up_interrupt_context()) {
+        tsb_dma_request_restart(info, dma_chan);
+    } else {
+        tsb_dma_restart_chan(dev, dma_chan);
+    }
 
     return retval;
 }
@@ -704,6 +1103,7 @@ static int tsb_dma_dequeue(struct device *dev, void *chan,
         */
 
         list_del(&dma_op->list_node);
+        tsb_dma_stats_inc(dma_chan, dequeued);
 
         dma_op->state = DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
         if ((dev_op->callback != NULL) &&
@@ -734,6 +1134,44 @@ static int tsb_dma_dequeue(struct device *dev, void *chan,
     return retval;
 }
 
+static int tsb_dma_op_get_transferred(struct device *dev, void *chan,
+        struct device_dma_op *op, size_t *count)
+{
+    struct tsb_dma_op *dma_op;
+    struct tsb_dma_chan *dma_chan = (struct tsb_dma_chan *) chan;
+    irqstate_t flags;
+    unsigned int index;
+    int retval = OK;
+
+    if ((dev == NULL) || (chan == NULL) || (op == NULL) || (count == NULL)) {
+        return -EINVAL;
+    }
+
+    dma_op = containerof(op, struct tsb_dma_op, op);
+
+    flags = irqsave();
+
+    switch (dma_op->state) {
+    case TSB_DMA_OP_STATE_RUNNING:
+        retval = gdmac_get_transferred(dev, dma_chan, op, count);
+        break;
+    case TSB_DMA_OP_STATE_COMPLETED:
+        *count = 0;
+        for (index = 0; index < op->sg_count; index++) {
+            *count += op->sg[index].len;
+        }
+        break;
+    default:
+        /* Not started yet, or stopped an unknown amount into the transfer. */
+        *count = 0;
+        break;
+    }
+
+    irqrestore(flags);
+
+    return retval;
+}
+
 int tsb_dma_callback(struct device *dev, struct tsb_dma_chan *dma_chan,
         int event)
 {
@@ -757,14 +1195,45 @@ int tsb_dma_callback(struct device *dev, struct tsb_dma_chan *dma_chan,
             switch (event) {
                 case DEVICE_DMA_CALLBACK_EVENT_COMPLETE:
                     dma_op->state = TSB_DMA_OP_STATE_COMPLETED;
+                    tsb_dma_stats_complete(dma_chan, dma_op);
 
                     list_del(next_op);
+
+                    if (dma_chan->chan_params.flags &
+                        DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK) {
+                        /*
+                         * Only the start of the next op is left to the
+                         * thread: the callback runs right now.
+                         */
+                        list_init(next_op);
+                        if (!list_is_empty(&dma_chan->queue)) {
+                            tsb_dma_request_restart(info, dma_chan);
+                        }
+
+                        if ((dma_op->op.callback_events &
+                             DEVICE_DMA_CALLBACK_EVENT_COMPLETE) &&
+                            (dma_op->op.callback != NULL)) {
+                            dma_op->op.callback(dev,
+                                    &info->chans[dma_chan->chan_id],
+                                    &dma_op->op,
+                                    DEVICE_DMA_CALLBACK_EVENT_COMPLETE,
+                                    dma_op->op.callback_arg);
+                        }
+                        break;
+                    }
+
                     list_add(&info->completed_queue, next_op);
 
                     sem_post(&info->op_completed_sem);
                     break;
                 case DEVICE_DMA_CALLBACK_EVENT_ERROR:
                 case DEVICE_DMA_CALLBACK_EVENT_RECOVERED:
+                    if (event == DEVICE_DMA_CALLBACK_EVENT_ERROR) {
+                        tsb_dma_stats_inc(dma_chan, errors);
+                    } else {
+                        tsb_dma_stats_inc(dma_chan, recoveries);
+                    }
+
                     if ((dma_op->op.callback_events & event) &&
                         (dma_op->op.callback != NULL)) {
                         retval = dma_op->op.callback(dev,
@@ -776,6 +1245,7 @@ int tsb_dma_callback(struct device *dev, struct tsb_dma_chan *dma_chan,
                     break;
                 case DEVICE_DMA_CALLBACK_EVENT_DEQUEUED:
                     dma_op->state = TSB_DMA_OP_STATE_DEQUEUED;
+                    tsb_dma_stats_inc(dma_chan, dequeued);
 
                     list_del(next_op);
                     list_add(&info->completed_queue, next_op);
@@ -821,10 +1291,13 @@ static struct device_dma_type_ops tsb_dma_type_ops = {
         .chan_free = tsb_dma_chan_free,
         .op_alloc = tsb_dma_op_alloc,
         .op_free = tsb_dma_op_free,
+        .op_pool_create = tsb_dma_op_pool_create,
+        .op_pool_alloc = tsb_dma_op_pool_alloc,
         .op_is_complete = tsb_dma_op_is_complete,
         .op_get_error = tsb_dma_op_get_error,
         .enqueue = tsb_dma_enqueue,
-        .dequeue = tsb_dma_dequeue
+        .dequeue = tsb_dma_dequeue,
+        .op_get_transferred = tsb_dma_op_get_transferred
 };
 
 static struct device_driver_ops tsb_dma_driver_ops = {
@@ -38,7 +38,28 @@
 
 #define TSB_DMA_SG_MAX				2
 
+/* enqueue to completion latency buckets: < 16us, < 32us, ..., >= 4ms */
+#define TSB_DMA_LATENCY_BUCKETS     10
+#define TSB_DMA_LATENCY_MIN_SHIFT   4
+
 struct gdmac_chan;
+struct tsb_dma_op_pool;
+
+struct tsb_dma_chan_stats {
+    enum device_dma_dev src_dev;
+    enum device_dma_dev dst_dev;
+    uint32_t queued;
+    uint32_t completed;
+    uint32_t dequeued;
+    uint32_t errors;
+    uint32_t recoveries;
+    /* most ops queued on the channel at once, including the running one */
+    uint32_t max_depth;
+    uint64_t bytes;
+    /* time spent running ops, from the start to the completion */
+    uint64_t busy_usec;
+    uint32_t latency[TSB_DMA_LATENCY_BUCKETS];
+};
 
 /* structure for GDMAC channel information. */
 struct tsb_dma_chan {
@@ -46,6 +67,13 @@ struct tsb_dma_chan {
     pthread_mutex_t chan_mutex;
     struct list_head queue;
     struct device_dma_params chan_params;
+    /* the driver thread must start the next op queued on the channel */
+    bool restart_pending;
+    /* preallocated ops, see device_dma_op_pool_create() */
+    struct tsb_dma_op_pool *op_pool;
+#ifdef CONFIG_ARCH_DMA_STATS
+    struct tsb_dma_chan_stats stats;
+#endif
 };
 
 extern int gdmac_max_number_of_channels(void);
@@ -65,7 +93,22 @@ extern int gdmac_recover_from_op_error(struct device *dev,
         struct tsb_dma_chan *tsb_chan);
 extern int gdmac_chan_check_op_params(struct device *dev,
         struct tsb_dma_chan *tsb_chan, struct device_dma_op *op);
+extern int gdmac_get_transferred(struct device *dev,
+        struct tsb_dma_chan *tsb_chan, struct device_dma_op *op,
+        size_t *count);
 
 extern int tsb_dma_callback(struct device *dev, struct tsb_dma_chan *tsb_chan,
         int event);
+
+#ifdef CONFIG_ARCH_DMA_STATS
+/*
+ * Copy the statistics of a channel. Returns -ENOENT for a channel that is
+ * not allocated, and -ERANGE past the last channel of the controller.
+ */
+extern int tsb_dma_get_chan_stats(unsigned int chan_id,
+        struct tsb_dma_chan_stats *stats);
+
+/* Clear the counters of all the allocated channels. */
+extern void tsb_dma_reset_stats(void);
+#endif
 #endif /* __TSB_DMA_GDMAC_H */
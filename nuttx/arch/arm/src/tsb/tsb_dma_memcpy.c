@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @brief Memory to memory copies offloaded to the GDMAC
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <semaphore.h>
+#include <debug.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/list.h>
+#include <nuttx/device.h>
+#include <nuttx/device_dma.h>
+#include <nuttx/dma_memcpy.h>
+
+#include "tsb_dma_share.h"
+
+#ifndef CONFIG_ARCH_DMA_MEMCPY_THRESHOLD
+#define CONFIG_ARCH_DMA_MEMCPY_THRESHOLD    256
+#endif
+
+#ifndef CONFIG_ARCH_DMA_MEMCPY_DEPTH
+#define CONFIG_ARCH_DMA_MEMCPY_DEPTH        4
+#endif
+
+/*
+ * All the copies go through a single channel, which completes them in the
+ * order they were queued. The copies that don't get an op from the channel
+ * pool wait on the pending list.
+ */
+static struct {
+    struct device *dev;
+    void *chan;
+    struct list_head pending;
+    unsigned int inflight;
+} dma_memcpy_info = {
+    .pending = LIST_INIT(dma_memcpy_info.pending),
+};
+
+static sem_t dma_memcpy_lock = SEM_INITIALIZER(1);
+
+/*
+ * Hand the pending copies to the channel. Must be called with interrupts
+ * disabled.
+ */
+static void dma_memcpy_start(void)
+{
+    struct dma_memcpy_req *req;
+    struct device_dma_op *op;
+
+    while (!list_is_empty(&dma_memcpy_info.pending)) {
+        if (device_dma_op_pool_alloc(dma_memcpy_info.dev, dma_memcpy_info.chan,
+                                     &op)) {
+            break;
+        }
+
+        req = list_entry(dma_memcpy_info.pending.next, struct dma_memcpy_req,
+                         list);
+        list_del(&req->list);
+
+        op->callback_arg = req;
+        op->sg[0].src_addr = (off_t) req->src;
+        op->sg[0].dst_addr = (off_t) req->dst;
+        op->sg[0].len = req->len;
+
+        if (device_dma_enqueue(dma_memcpy_info.dev, dma_memcpy_info.chan,
+                               op)) {
+            /* The ops of the pool were checked already: this is unlikely */
+            device_dma_op_free(dma_memcpy_info.dev, op);
+            memcpy(req->dst, req->src, req->len);
+            req->callback(req, 0);
+            continue;
+        }
+
+        dma_memcpy_info.inflight++;
+    }
+}
+
+/* Runs in the DMA interrupt, see DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK */
+static int dma_memcpy_done(struct device *dev, void *chan,
+                           struct device_dma_op *op, unsigned int event,
+                           void *arg)
+{
+    struct dma_memcpy_req *req = arg;
+    irqstate_t flags;
+
+    device_dma_op_free(dev, op);
+
+    flags = irqsave();
+    dma_memcpy_info.inflight--;
+    dma_memcpy_start();
+    irqrestore(flags);
+
+    req->callback(req, event == DEVICE_DMA_CALLBACK_EVENT_COMPLETE ?
+                       0 : -EIO);
+
+    return OK;
+}
+
+int dma_memcpy_init(void)
+{
+    struct device_dma_params params = {
+        .src_dev = DEVICE_DMA_DEV_MEM,
+        .src_devid = 0,
+        .src_inc_options = DEVICE_DMA_INC_AUTO,
+        .dst_dev = DEVICE_DMA_DEV_MEM,
+        .dst_devid = 0,
+        .dst_inc_options = DEVICE_DMA_INC_AUTO,
+        .transfer_size = DEVICE_DMA_TRANSFER_SIZE_64,
+        .burst_len = DEVICE_DMA_BURST_LEN_16,
+        .swap = DEVICE_DMA_SWAP_SIZE_NONE,
+        .flags = DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK,
+    };
+    struct {
+        struct device_dma_op op;
+        struct device_dma_sg sg[1];
+    } template = {
+        .op = {
+            .callback = dma_memcpy_done,
+            .callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                               DEVICE_DMA_CALLBACK_EVENT_DEQUEUED,
+            .sg_count = 1,
+        },
+    };
+    struct device *dev;
+    void *chan = NULL;
+    irqstate_t flags;
+    int retval = 0;
+
+    while (sem_wait(&dma_memcpy_lock) < 0);
+
+    if (dma_memcpy_info.chan) {
+        goto out;
+    }
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    dev = tsb_dma_share_open();
+#else
+    dev = device_open(DEVICE_TYPE_DMA_HW, 0);
+#endif
+    if (!dev) {
+        lldbg("dma_memcpy: no DMA device, using the CPU\n");
+        retval = -ENODEV;
+        goto out;
+    }
+
+    device_dma_chan_alloc(dev, &params, &chan);
+    if (!chan) {
+        lldbg("dma_memcpy: couldn't allocate a channel\n");
+        retval = -ENOMEM;
+        goto err_close;
+    }
+
+    retval = device_dma_op_pool_create(dev, chan, CONFIG_ARCH_DMA_MEMCPY_DEPTH,
+                                       1, 0, &template.op);
+    if (retval) {
+        lldbg("dma_memcpy: couldn't allocate the DMA ops\n");
+        goto err_chan_free;
+    }
+
+    flags = irqsave();
+    dma_memcpy_info.dev = dev;
+    dma_memcpy_info.chan = chan;
+    irqrestore(flags);
+
+    sem_post(&dma_memcpy_lock);
+
+    return 0;
+
+err_chan_free:
+    device_dma_chan_free(dev, chan);
+err_close:
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(dev);
+#endif
+out:
+    sem_post(&dma_memcpy_lock);
+
+    return retval;
+}
+
+int dma_memcpy(struct dma_memcpy_req *req)
+{
+    irqstate_t flags;
+
+    if (!req || !req->callback) {
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+
+    /*
+     * The CPU makes the copy right away only when that keeps the copies in
+     * order: when none is pending.
+     */
+    if (!dma_memcpy_info.chan ||
+        (req->len < CONFIG_ARCH_DMA_MEMCPY_THRESHOLD &&
+         !dma_memcpy_info.inflight &&
+         list_is_empty(&dma_memcpy_info.pending))) {
+        irqrestore(flags);
+
+        memcpy(req->dst, req->src, req->len);
+        req->callback(req, 0);
+
+        return 0;
+    }
+
+    list_add(&dma_memcpy_info.pending, &req->list);
+    dma_memcpy_start();
+
+    irqrestore(flags);
+
+    return 0;
+}
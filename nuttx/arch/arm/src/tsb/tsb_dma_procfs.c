@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "tsb_dma.h"
+
+#define DMA_PROCFS_LINELEN  128
+
+struct dma_procfs_file {
+    struct procfs_file_s base;
+    char line[DMA_PROCFS_LINELEN];
+};
+
+static const char *dma_procfs_dev_name(enum device_dma_dev dev)
+{
+    switch (dev) {
+    case DEVICE_DMA_DEV_MEM:
+        return "mem";
+    case DEVICE_DMA_DEV_IO:
+        return "io";
+    case DEVICE_DMA_DEV_UNIPRO:
+        return "unipro";
+    default:
+        return "?";
+    }
+}
+
+static bool dma_procfs_copy(char *line, size_t linesize, char **buffer,
+                            size_t *remaining, off_t *offset, size_t *total)
+{
+    size_t copysize;
+
+    if (linesize >= DMA_PROCFS_LINELEN)
+        linesize = DMA_PROCFS_LINELEN - 1;
+
+    copysize = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+    *buffer += copysize;
+    *remaining -= copysize;
+    *total += copysize;
+
+    return *remaining > 0;
+}
+
+static int dma_procfs_open(struct file *filep, const char *relpath,
+                           int oflags, mode_t mode)
+{
+    struct dma_procfs_file *priv;
+
+    if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+        return -EACCES;
+
+    if (strcmp(relpath, "dma") != 0)
+        return -ENOENT;
+
+    priv = kmm_zalloc(sizeof(*priv));
+    if (!priv)
+        return -ENOMEM;
+
+    filep->f_priv = priv;
+    return 0;
+}
+
+static int dma_procfs_close(struct file *filep)
+{
+    DEBUGASSERT(filep->f_priv);
+
+    kmm_free(filep->f_priv);
+    filep->f_priv = NULL;
+    return 0;
+}
+
+static ssize_t dma_procfs_read(struct file *filep, char *buffer,
+                               size_t buflen)
+{
+    struct dma_procfs_file *priv = filep->f_priv;
+    struct tsb_dma_chan_stats stats;
+    off_t offset = filep->f_pos;
+    size_t remaining = buflen;
+    size_t total = 0;
+    size_t linesize;
+    unsigned int chan;
+    int bucket;
+    int ret;
+
+    DEBUGASSERT(priv);
+
+    linesize = snprintf(priv->line, DMA_PROCFS_LINELEN,
+                        "CHAN SRC    DST       QUEUED  COMPLETED DEQUEUED "
+                        "ERRORS RECOV MAXQ          BYTES  BUSY(us)\n");
+    if (!dma_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                         &offset, &total))
+        goto out;
+
+    for (chan = 0; ; chan++) {
+        ret = tsb_dma_get_chan_stats(chan, &stats);
+        if (ret == -ENOENT)
+            continue;
+        if (ret)
+            break;
+
+        linesize = snprintf(priv->line, DMA_PROCFS_LINELEN,
+                            "%4u %-6s %-6s %9u %10u %8u %6u %5u %4u %14llu "
+                            "%9llu\n", chan,
+                            dma_procfs_dev_name(stats.src_dev),
+                            dma_procfs_dev_name(stats.dst_dev),
+                            stats.queued, stats.completed, stats.dequeued,
+                            stats.errors, stats.recoveries, stats.max_depth,
+                            (unsigned long long) stats.bytes,
+                            (unsigned long long) stats.busy_usec);
+        if (!dma_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                             &offset, &total))
+            goto out;
+    }
+
+    /* Enqueue to completion latency, one column per power of two */
+    linesize = snprintf(priv->line, DMA_PROCFS_LINELEN,
+                        "\nCHAN  <16us  <32us  <64us <128us <256us <512us "
+                        "  <1ms   <2ms   <4ms  >=4ms\n");
+    if (!dma_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                         &offset, &total))
+        goto out;
+
+    for (chan = 0; ; chan++) {
+        ret = tsb_dma_get_chan_stats(chan, &stats);
+        if (ret == -ENOENT)
+            continue;
+        if (ret)
+            break;
+
+        linesize = snprintf(priv->line, DMA_PROCFS_LINELEN, "%4u", chan);
+        for (bucket = 0; bucket < TSB_DMA_LATENCY_BUCKETS; bucket++) {
+            linesize += snprintf(priv->line + linesize,
+                                 DMA_PROCFS_LINELEN - linesize, " %6u",
+                                 stats.latency[bucket]);
+        }
+        linesize += snprintf(priv->line + linesize,
+                             DMA_PROCFS_LINELEN - linesize, "\n");
+        if (!dma_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                             &offset, &total))
+            goto out;
+    }
+
+out:
+    filep->f_pos += total;
+    return total;
+}
+
+static int dma_procfs_dup(const struct file *oldp, struct file *newp)
+{
+    struct dma_procfs_file *newpriv;
+
+    DEBUGASSERT(oldp->f_priv);
+
+    newpriv = kmm_zalloc(sizeof(*newpriv));
+    if (!newpriv)
+        return -ENOMEM;
+
+    memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+    newp->f_priv = newpriv;
+    return 0;
+}
+
+static int dma_procfs_stat(const char *relpath, struct stat *buf)
+{
+    if (strcmp(relpath, "dma") != 0)
+        return -ENOENT;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+    return 0;
+}
+
+const struct procfs_operations dma_procfsoperations = {
+    .open = dma_procfs_open,
+    .close = dma_procfs_close,
+    .read = dma_procfs_read,
+    .dup = dma_procfs_dup,
+    .stat = dma_procfs_stat,
+};
@@ -28,7 +28,11 @@
  * @author Mark Greer
  */
 
+#include <stddef.h>
+
+#include <nuttx/util.h>
 #include <nuttx/device.h>
+#include <nuttx/boot_timing.h>
 
 extern struct device_driver tsb_i2c_driver;
 #ifdef CONFIG_ARCH_CHIP_DEVICE_GDMAC
@@ -46,48 +50,57 @@ extern struct device_driver tsb_spi_driver;
 extern struct device_driver tsb_uart_driver;
 extern struct device_driver tsb_sdio_driver;
 
-void tsb_driver_register(void)
-{
+/*
+ * None of the chip drivers touches another device when probed, except the
+ * ATABL which needs the DMA driver to be there.
+ */
+static const struct device_probe_entry tsb_drivers[] = {
 #ifdef CONFIG_ARCH_CHIP_DEVICE_I2C
-    device_register_driver(&tsb_i2c_driver);
+    { &tsb_i2c_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_DEVICE_GDMAC
-    device_register_driver(&tsb_dma_driver);
+    { &tsb_dma_driver, NULL },
 #ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
-    device_register_driver(&tsb_atabl_driver);
+    { &tsb_atabl_driver, &tsb_dma_driver },
 #endif
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_USB_HCD
-    device_register_driver(&tsb_usb_hcd_driver);
+    { &tsb_usb_hcd_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_USB_PCD
-    device_register_driver(&tsb_usb_pcd_driver);
+    { &tsb_usb_pcd_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_TSB_PLL
-    device_register_driver(&tsb_pll_driver);
+    { &tsb_pll_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_TSB_I2S
-    device_register_driver(&tsb_i2s_driver);
+    { &tsb_i2s_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_DEVICE_PWM
-    device_register_driver(&tsb_pwm_driver);
+    { &tsb_pwm_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_DEVICE_SPI
-    device_register_driver(&tsb_spi_driver);
+    { &tsb_spi_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_DEVICE_UART
-    device_register_driver(&tsb_uart_driver);
+    { &tsb_uart_driver, NULL },
 #endif
 
 #ifdef CONFIG_ARCH_CHIP_DEVICE_SDIO
-    device_register_driver(&tsb_sdio_driver);
+    { &tsb_sdio_driver, NULL },
 #endif
+};
+
+void tsb_driver_register(void)
+{
+    device_register_drivers(tsb_drivers, ARRAY_SIZE(tsb_drivers));
+    boot_timing_mark("tsb drivers");
 }
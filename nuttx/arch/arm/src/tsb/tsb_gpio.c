@@ -104,26 +104,46 @@ static uint8_t tsb_gpio_get_value(void *driver_data, uint8_t which)
 
 static void tsb_gpio_set_value(void *driver_data, uint8_t which, uint8_t value)
 {
-    pm_activity(TSB_GPIO_ACTIVITY);
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
     putreg32(1 << which, value ? GPIO_ODATASET : GPIO_ODATACLR);
 }
 
+static int tsb_gpio_get_values(void *driver_data, uint8_t which,
+                               uint32_t mask, uint32_t *values)
+{
+    uint32_t dir = getreg32(GPIO_DIR);
+
+    /* Inputs read the pin, outputs the output register */
+    *values = (((getreg32(GPIO_DATA) & ~dir) |
+                (getreg32(GPIO_ODATA) & dir)) >> which) & mask;
+    return 0;
+}
+
+static int tsb_gpio_set_values(void *driver_data, uint8_t which,
+                               uint32_t mask, uint32_t values)
+{
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
+    putreg32((values & mask) << which, GPIO_ODATASET);
+    putreg32((~values & mask) << which, GPIO_ODATACLR);
+    return 0;
+}
+
 static int tsb_gpio_get_direction(void *driver_data, uint8_t which)
 {
     uint32_t dir = getreg32(GPIO_DIR);
-    pm_activity(TSB_GPIO_ACTIVITY);
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
     return !(dir & (1 << which));
 }
 
 static void tsb_gpio_direction_in(void *driver_data, uint8_t which)
 {
-    pm_activity(TSB_GPIO_ACTIVITY);
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
     putreg32(1 << which, GPIO_DIRIN);
 }
 
 static void tsb_gpio_direction_out(void *driver_data, uint8_t which, uint8_t value)
 {
-    pm_activity(TSB_GPIO_ACTIVITY);
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
     tsb_gpio_set_value(NULL, which, value);
     putreg32(1 << which, GPIO_DIROUT);
 }
@@ -354,7 +374,7 @@ static int tsb_gpio_irq_handler(int irq, void *context, void *priv)
     int pin;
     size_t nr_gpio = tsb_nr_gpio();
 
-    pm_activity(TSB_GPIO_ACTIVITY);
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
 
     /*
      * Clear all GPIO interrupts that we are going to process. "The GPIO_RAWINTSTAT
@@ -580,6 +600,8 @@ static struct gpio_ops_s tsb_gpio_ops = {
     .set_pull = tsb_gpio_set_pull,
     .get_pull = tsb_gpio_get_pull,
     .set_debounce = tsb_gpio_set_debounce,
+    .get_values = tsb_gpio_get_values,
+    .set_values = tsb_gpio_set_values,
 };
 
 int tsb_gpio_register(void *driver_data)
@@ -34,9 +34,14 @@
 
 #include <nuttx/arch.h>
 #include <nuttx/wdog.h>
+#include <nuttx/mutex.h>
 #include <nuttx/device.h>
 #include <nuttx/device_i2c.h>
 #include <nuttx/power/pm.h>
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+#include <nuttx/clock.h>
+#include <nuttx/device_dma.h>
+#endif
 
 #include <arch/irq.h>
 #include <arch/tsb/pm.h>
@@ -47,6 +52,9 @@
 #include "tsb_scm.h"
 #include "tsb_pinshare.h"
 #include "tsb_i2c.h"
+#if defined(CONFIG_ARCH_I2C_USE_DMA) && defined(CONFIG_ARCH_SHARE_DMA)
+#include "tsb_dma_share.h"
+#endif
 
 #define TSB_I2C_FLAG_OPENED     BIT(0)
 
@@ -82,6 +90,11 @@
 /** Timeout for waiting on a transfer */
 #define TSB_I2C_TRANSFER_TIMEOUT ((1000 * CLK_TCK) / 1000) /* 1000 ms (100Hz tick) */
 
+/** Shortest session moved by DMA */
+#define TSB_I2C_DMA_MIN_LEN     TSB_I2C_TX_FIFO_DEPTH
+/** Time left to the RX channel after the STOP condition */
+#define TSB_I2C_DMA_DRAIN_TIMEOUT_NSEC  (10 * NSEC_PER_MSEC)
+
 /**
  * struct tsb_i2c_info - The driver internal information
  */
@@ -92,7 +105,7 @@ struct tsb_i2c_info {
     uint32_t i2c_irq;           /**< IRQ number */
 
     sem_t wait;                 /**< Transfer mutex */
-    sem_t mutex;                /**< Exclusive resource access */
+    mutex_t mutex;              /**< Exclusive resource access */
     WDOG_ID timeout;            /**< Watchdog for transfer timeout */
 
     struct device_i2c_request *requests;    /**< List of requests */
@@ -111,6 +124,17 @@ struct tsb_i2c_info {
     uint32_t status;            /**< Status of the transfer */
     uint32_t abort_source;      /**< Source of a transmission abort */
     uint32_t rx_outstanding;    /**< Reception outstanding */
+
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    struct device *dma_dev;     /**< DMA device, NULL without DMA */
+    void *dma_tx_chan;          /**< Channel writing the data commands */
+    void *dma_rx_chan;          /**< Channel collecting the read bytes */
+    struct device_dma_op *dma_tx_op;    /**< Pending TX operation */
+    struct device_dma_op *dma_rx_op;    /**< Pending RX operation */
+    sem_t dma_done;             /**< Both operations are done */
+    uint32_t *dma_cmds;         /**< Data commands of the session */
+    uint32_t *dma_rx;           /**< Read bytes of the session */
+#endif
 };
 
 /** device structure for interrupt handler */
@@ -216,7 +240,8 @@ static int tsb_i2c_wait_bus_ready(struct tsb_i2c_info *info)
 }
 
 /** Start an I2C transfer */
-static void tsb_i2c_start_transfer(struct tsb_i2c_info *info)
+static void tsb_i2c_start_transfer(struct tsb_i2c_info *info,
+                                   uint32_t intr_mask)
 {
     llvdbg("\n");
 
@@ -236,7 +261,7 @@ static void tsb_i2c_start_transfer(struct tsb_i2c_info *info)
     tsb_i2c_clear_int(info);
 
     /* Enable interrupts */
-    i2c_write(info->reg_base, TSB_I2C_INTR_MASK, TSB_I2C_INTR_DEFAULT_MASK);
+    i2c_write(info->reg_base, TSB_I2C_INTR_MASK, intr_mask);
 }
 
 /**
@@ -278,7 +303,8 @@ static void tsb_i2c_transfer_request(struct tsb_i2c_info *info)
             length = info->requests[info->tx_index].length;
 
             /* force a restart between messages */
-            if (info->tx_index > 0)
+            if (info->tx_index > 0 &&
+                !(info->requests[info->tx_index].flags & I2C_FLAG_NORESTART))
                 need_restart = true;
         }
 
@@ -428,45 +454,353 @@ static int tsb_i2c_handle_tx_abort(struct tsb_i2c_info *info)
         return -EIO;
 }
 
-/** Perform a sequence of I2C requests */
-static int tsb_i2c_transfer(struct device *dev,
-        struct device_i2c_request *requests, uint32_t count)
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+/** DMA operation callback, wakes up the session once both are done */
+static int tsb_i2c_dma_callback(struct device *dev, void *chan,
+                                struct device_dma_op *op,
+                                unsigned int event, void *arg)
 {
-#ifdef CONFIG_PM
-    irqstate_t flags;
-#endif
+    struct tsb_i2c_info *info = arg;
+
+    /* An error is always followed by the dequeue of the operation */
+    if (event & (DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                 DEVICE_DMA_CALLBACK_EVENT_DEQUEUED)) {
+        if (op == info->dma_rx_op) {
+            info->dma_rx_op = NULL;
+        } else {
+            info->dma_tx_op = NULL;
+        }
+        device_dma_op_free(dev, op);
+
+        if (!info->dma_rx_op && !info->dma_tx_op) {
+            sem_post(&info->dma_done);
+        }
+    }
+
+    return 0;
+}
+
+/** Allocate a single buffer DMA operation */
+static struct device_dma_op *tsb_i2c_dma_op(struct tsb_i2c_info *info,
+                                            off_t src, off_t dst, size_t len)
+{
+    struct device_dma_op *op;
+
+    if (device_dma_op_alloc(info->dma_dev, 1, 0, &op)) {
+        return NULL;
+    }
+
+    op->callback = tsb_i2c_dma_callback;
+    op->callback_arg = info;
+    op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                          DEVICE_DMA_CALLBACK_EVENT_ERROR |
+                          DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
+    op->sg_count = 1;
+    op->sg[0].src_addr = src;
+    op->sg[0].dst_addr = dst;
+    op->sg[0].len = len;
+
+    return op;
+}
+
+/**
+ * Prepare the DMA operations of the current session
+ *
+ * The whole session is turned into a list of data commands that the TX
+ * channel writes to the controller, and the RX channel collects the read
+ * bytes. Returns -ENOSYS when the session has to go through the FIFO
+ * interrupts instead.
+ */
+static int tsb_i2c_dma_prepare(struct tsb_i2c_info *info)
+{
+    struct device_i2c_request *req;
+    uint32_t *cmd = info->dma_cmds;
+    uint32_t total = 0, nreads = 0;
+    off_t data_cmd = info->reg_base + TSB_I2C_DATA_CMD;
+    uint32_t i;
+    int j;
+
+    if (!info->dma_dev) {
+        return -ENOSYS;
+    }
+
+    for (i = 0; i < info->request_count; i++) {
+        req = &info->requests[i];
+        if (req->length <= 0) {
+            return -ENOSYS;
+        }
+        total += req->length;
+        if (req->flags & I2C_FLAG_READ) {
+            nreads += req->length;
+        }
+    }
+
+    if (total < TSB_I2C_DMA_MIN_LEN || total > CONFIG_ARCH_I2C_DMA_MAX_LEN) {
+        return -ENOSYS;
+    }
+
+    for (i = 0; i < info->request_count; i++) {
+        req = &info->requests[i];
+
+        for (j = 0; j < req->length; j++) {
+            if (req->flags & I2C_FLAG_READ) {
+                *cmd = TSB_I2C_DATA_CMD_READ;
+            } else {
+                *cmd = req->buffer[j];
+            }
+
+            /* force a restart between messages */
+            if (i > 0 && j == 0 && !(req->flags & I2C_FLAG_NORESTART)) {
+                *cmd |= TSB_I2C_DATA_CMD_RESTART;
+            }
+
+            /* Last msg, issue a STOP */
+            if (i == info->request_count - 1 && j == req->length - 1) {
+                *cmd |= TSB_I2C_DATA_CMD_STOP;
+            }
+
+            cmd++;
+        }
+    }
+
+    info->dma_rx_op = NULL;
+    if (nreads) {
+        info->dma_rx_op = tsb_i2c_dma_op(info, data_cmd,
+                                         (off_t)info->dma_rx,
+                                         nreads * sizeof(uint32_t));
+        if (!info->dma_rx_op) {
+            return -ENOSYS;
+        }
+    }
+
+    info->dma_tx_op = tsb_i2c_dma_op(info, (off_t)info->dma_cmds, data_cmd,
+                                     total * sizeof(uint32_t));
+    if (!info->dma_tx_op) {
+        if (info->dma_rx_op) {
+            device_dma_op_free(info->dma_dev, info->dma_rx_op);
+            info->dma_rx_op = NULL;
+        }
+        return -ENOSYS;
+    }
+
+    return 0;
+}
+
+/**
+ * Hand the prepared operations to the DMA channels
+ *
+ * The controller flushes its FIFOs while it is disabled, so the DMA
+ * requests are only enabled once the transfer has been started.
+ */
+static int tsb_i2c_dma_start(struct tsb_i2c_info *info, uint32_t *dma_cr)
+{
+    struct device_dma_op *rx_op = info->dma_rx_op;
+    struct device_dma_op *tx_op = info->dma_tx_op;
     int ret;
-    struct tsb_i2c_info *info = NULL;
 
-    if (!dev || !device_get_private(dev)) {
-        return -EINVAL;
+    *dma_cr = TSB_I2C_DMA_CR_TDMAE;
+    i2c_write(info->reg_base, TSB_I2C_DMA_TDLR, TSB_I2C_TX_FIFO_DEPTH / 2);
+    i2c_write(info->reg_base, TSB_I2C_DMA_RDLR, 0);
+
+    /* The receive channel must be waiting before the first read goes out */
+    if (rx_op) {
+        ret = device_dma_enqueue(info->dma_dev, info->dma_rx_chan, rx_op);
+        if (ret) {
+            info->dma_rx_op = NULL;
+            info->dma_tx_op = NULL;
+            device_dma_op_free(info->dma_dev, rx_op);
+            device_dma_op_free(info->dma_dev, tx_op);
+            return ret;
+        }
+        *dma_cr |= TSB_I2C_DMA_CR_RDMAE;
     }
 
-    info = device_get_private(dev);
+    ret = device_dma_enqueue(info->dma_dev, info->dma_tx_chan, tx_op);
+    if (ret) {
+        info->dma_tx_op = NULL;
+        device_dma_op_free(info->dma_dev, tx_op);
+        if (rx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_rx_chan, rx_op);
+        }
+        while (sem_trywait(&info->dma_done) == 0);
+        return ret;
+    }
 
-#ifdef CONFIG_PM
-    flags = irqsave();
-    /*
-     * We're going to get stuck on sem_wait(&g_wait) if we're sleeping because
-     * the i2c interrupts are disabled, so bail-out immediately. The user
-     * trying to send data over a sleeping bridge should see it as an
-     * input-output error.
-     */
-    if (tsb_pm_getstate() == PM_SLEEP) {
-        irqrestore(flags);
-        return -EIO;
+    return 0;
+}
+
+/**
+ * Wait for the DMA operations of a session that ended on the bus and copy
+ * the read bytes to the requests
+ */
+static void tsb_i2c_dma_finish(struct tsb_i2c_info *info)
+{
+    struct device_i2c_request *req;
+    struct timespec abstime;
+    uint32_t *rx = info->dma_rx;
+    uint32_t i;
+    int j, ret = -EIO;
+
+    if (info->status != TSB_I2C_STATUS_TIMEOUT && !info->cmd_err &&
+        !info->msg_err) {
+        /* the last bytes may still be on their way out of the RX FIFO */
+        (void)clock_gettime(CLOCK_REALTIME, &abstime);
+        abstime.tv_nsec += TSB_I2C_DMA_DRAIN_TIMEOUT_NSEC;
+        if (abstime.tv_nsec >= NSEC_PER_SEC) {
+            abstime.tv_sec++;
+            abstime.tv_nsec -= NSEC_PER_SEC;
+        }
+        ret = sem_timedwait(&info->dma_done, &abstime);
     }
 
-    /*
-     * Call pm_activity() with interrupts disabled to make sure the pm
-     * framework won't enter the sleep state between it and the above check.
-     */
-    pm_activity(TSB_I2C_ACTIVITY);
-    irqrestore(flags);
+    if (ret) {
+        if (info->dma_rx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_rx_chan,
+                               info->dma_rx_op);
+        }
+        if (info->dma_tx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_tx_chan,
+                               info->dma_tx_op);
+        }
+
+        if (info->status != TSB_I2C_STATUS_TIMEOUT && !info->cmd_err &&
+            !info->msg_err) {
+            lldbg("DMA drain timeout\n");
+            info->msg_err = -EIO;
+        }
+    }
+
+    /* drop the completion posted by the dequeued operations */
+    while (sem_trywait(&info->dma_done) == 0);
+
+    i2c_write(info->reg_base, TSB_I2C_DMA_CR, 0);
+
+    if (info->status != TSB_I2C_STATUS_TIMEOUT) {
+        info->status = TSB_I2C_STATUS_IDLE;
+    }
+
+    if (ret) {
+        return;
+    }
+
+    for (i = 0; i < info->request_count; i++) {
+        req = &info->requests[i];
+        if (!(req->flags & I2C_FLAG_READ))
+            continue;
+
+        for (j = 0; j < req->length; j++)
+            req->buffer[j] = *rx++;
+    }
+}
+
+/** Open the DMA device and channels, the driver uses the FIFO interrupts
+ * when they are not available */
+static void tsb_i2c_dma_open(struct tsb_i2c_info *info)
+{
+    struct device_dma_params params = {
+        .transfer_size = DEVICE_DMA_TRANSFER_SIZE_32,
+        .burst_len = DEVICE_DMA_BURST_LEN_1,
+        .swap = DEVICE_DMA_SWAP_SIZE_NONE,
+    };
+
+    info->dma_cmds = malloc(CONFIG_ARCH_I2C_DMA_MAX_LEN * sizeof(uint32_t));
+    info->dma_rx = malloc(CONFIG_ARCH_I2C_DMA_MAX_LEN * sizeof(uint32_t));
+    if (!info->dma_cmds || !info->dma_rx) {
+        goto err_free;
+    }
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    info->dma_dev = tsb_dma_share_open();
+#else
+    info->dma_dev = device_open(DEVICE_TYPE_DMA_HW, 0);
 #endif
+    if (!info->dma_dev) {
+        goto err_free;
+    }
 
-    sem_wait(&info->mutex);
-    llvdbg("requests: %d\n", count);
+    params.src_dev = DEVICE_DMA_DEV_MEM;
+    params.src_devid = 0;
+    params.src_inc_options = DEVICE_DMA_INC_AUTO;
+    params.dst_dev = DEVICE_DMA_DEV_IO;
+    params.dst_devid = CONFIG_ARCH_I2C_DMA_TX_REQ;
+    params.dst_inc_options = DEVICE_DMA_INC_NOAUTO;
+    device_dma_chan_alloc(info->dma_dev, &params, &info->dma_tx_chan);
+    if (!info->dma_tx_chan) {
+        goto err_close;
+    }
+
+    params.src_dev = DEVICE_DMA_DEV_IO;
+    params.src_devid = CONFIG_ARCH_I2C_DMA_RX_REQ;
+    params.src_inc_options = DEVICE_DMA_INC_NOAUTO;
+    params.dst_dev = DEVICE_DMA_DEV_MEM;
+    params.dst_devid = 0;
+    params.dst_inc_options = DEVICE_DMA_INC_AUTO;
+    device_dma_chan_alloc(info->dma_dev, &params, &info->dma_rx_chan);
+    if (!info->dma_rx_chan) {
+        goto err_free_chan;
+    }
+
+    return;
+
+err_free_chan:
+    device_dma_chan_free(info->dma_dev, info->dma_tx_chan);
+    info->dma_tx_chan = NULL;
+err_close:
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(info->dma_dev);
+#endif
+    info->dma_dev = NULL;
+err_free:
+    free(info->dma_cmds);
+    free(info->dma_rx);
+    info->dma_cmds = NULL;
+    info->dma_rx = NULL;
+    lldbg("no DMA, using FIFO interrupts\n");
+}
+
+/** Release the DMA channels and device */
+static void tsb_i2c_dma_close(struct tsb_i2c_info *info)
+{
+    if (!info->dma_dev) {
+        return;
+    }
+
+    device_dma_chan_free(info->dma_dev, info->dma_tx_chan);
+    device_dma_chan_free(info->dma_dev, info->dma_rx_chan);
+    info->dma_tx_chan = NULL;
+    info->dma_rx_chan = NULL;
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(info->dma_dev);
+#endif
+    info->dma_dev = NULL;
+
+    free(info->dma_cmds);
+    free(info->dma_rx);
+    info->dma_cmds = NULL;
+    info->dma_rx = NULL;
+}
+#endif
+
+/**
+ * Perform the requests of one bus session
+ *
+ * All the requests of a session go to the same target, separated by
+ * repeated starts, and the last one ends with a STOP.
+ */
+static int tsb_i2c_session(struct tsb_i2c_info *info,
+        struct device_i2c_request *requests, uint32_t count)
+{
+    uint32_t intr_mask = TSB_I2C_INTR_DEFAULT_MASK;
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    uint32_t dma_cr = 0;
+    bool dma;
+#endif
+    int ret;
 
     /* initialize new requests */
     info->requests = requests;
@@ -482,13 +816,38 @@ static int tsb_i2c_transfer(struct device *dev,
 
     ret = tsb_i2c_wait_bus_ready(info);
     if (ret < 0)
-        goto done;
+        return ret;
+
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    dma = !tsb_i2c_dma_prepare(info);
+    if (dma) {
+        /* the controller only reports the end of the session */
+        intr_mask = TSB_I2C_INTR_TX_ABRT | TSB_I2C_INTR_STOP_DET;
+        info->status = TSB_I2C_STATUS_WRITE_IN_PROGRESS;
+    }
+#endif
 
     /* start a watchdog to timeout the transfer if the bus is locked up... */
     wd_start(info->timeout, TSB_I2C_TRANSFER_TIMEOUT, tsb_i2c_timeout, 1, info);
 
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    if (dma) {
+        ret = tsb_i2c_dma_start(info, &dma_cr);
+        if (ret) {
+            wd_cancel(info->timeout);
+            info->status = TSB_I2C_STATUS_IDLE;
+            return ret;
+        }
+    }
+#endif
+
     /* start the transfers */
-    tsb_i2c_start_transfer(info);
+    tsb_i2c_start_transfer(info, intr_mask);
+
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    if (dma)
+        i2c_write(info->reg_base, TSB_I2C_DMA_CR, dma_cr);
+#endif
 
     /* wait for completion */
     sem_wait(&info->wait);
@@ -496,42 +855,104 @@ static int tsb_i2c_transfer(struct device *dev,
     /* cancel the watchdog */
     wd_cancel(info->timeout);
 
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    if (dma)
+        tsb_i2c_dma_finish(info);
+#endif
+
     /* check the result of the transfers */
     if (info->status == TSB_I2C_STATUS_TIMEOUT) {
         lldbg("controller timed out\n");
 
         /* Re-init the adapter */
         tsb_i2c_init(info);
-        ret = -ETIMEDOUT;
-        goto done;
+        return -ETIMEDOUT;
     }
 
     tsb_i2c_disable(info);
 
     if (info->msg_err) {
-        ret = info->msg_err;
         lldbg("error msg_err %x\n", info->msg_err);
-        goto done;
+        return info->msg_err;
     }
 
     if (!info->cmd_err) {
-        ret = 0;
         llvdbg("no error %d\n", count);
-        goto done;
+        return 0;
     }
 
     /* Handle abort errors */
     if (info->cmd_err == TSB_I2C_ERR_TX_ABRT) {
-        ret = tsb_i2c_handle_tx_abort(info);
-        goto done;
+        return tsb_i2c_handle_tx_abort(info);
     }
 
     /* default error code */
     ret = -EIO;
     lldbg("unknown error %x\n", ret);
 
-done:
-    sem_post(&info->mutex);
+    return ret;
+}
+
+/**
+ * Perform a sequence of I2C requests
+ *
+ * Consecutive requests to the same target are combined into one bus
+ * session. The controller can only change its target address while it is
+ * disabled, so a request to another target ends the session with a STOP
+ * and starts a new one.
+ */
+static int tsb_i2c_transfer(struct device *dev,
+        struct device_i2c_request *requests, uint32_t count)
+{
+#ifdef CONFIG_PM
+    irqstate_t flags;
+#endif
+    int ret = 0;
+    uint32_t start, end;
+    struct tsb_i2c_info *info = NULL;
+
+    if (!dev || !device_get_private(dev)) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+
+#ifdef CONFIG_PM
+    flags = irqsave();
+    /*
+     * We're going to get stuck on sem_wait(&g_wait) if we're sleeping because
+     * the i2c interrupts are disabled, so bail-out immediately. The user
+     * trying to send data over a sleeping bridge should see it as an
+     * input-output error.
+     */
+    if (tsb_pm_getstate() == PM_SLEEP) {
+        irqrestore(flags);
+        return -EIO;
+    }
+
+    /*
+     * Call pm_activity() with interrupts disabled to make sure the pm
+     * framework won't enter the sleep state between it and the above check.
+     */
+    pm_domain_activity(TSB_I2C_PM_DOMAIN, TSB_I2C_ACTIVITY);
+    irqrestore(flags);
+#endif
+
+    mutex_lock(&info->mutex);
+    llvdbg("requests: %d\n", count);
+
+    for (start = 0; start < count; start = end) {
+        for (end = start + 1; end < count; end++) {
+            if (requests[end].addr != requests[start].addr)
+                break;
+        }
+
+        ret = tsb_i2c_session(info, &requests[start], end - start);
+        if (ret)
+            break;
+    }
+
+    mutex_unlock(&info->mutex);
 
     return ret;
 }
@@ -633,7 +1054,7 @@ static int tsb_i2c_dev_open(struct device *dev)
 
     info = device_get_private(dev);
 
-    sem_wait(&info->mutex);
+    mutex_lock(&info->mutex);
 
     if (tsb_i2c_device_is_open(info)) {
         lldbg("i2c device is alreay open!\n");
@@ -643,10 +1064,14 @@ static int tsb_i2c_dev_open(struct device *dev)
 
     up_enable_irq(info->i2c_irq);
 
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    tsb_i2c_dma_open(info);
+#endif
+
     info->flags = TSB_I2C_FLAG_OPENED;
 
 err_open:
-    sem_post(&info->mutex);
+    mutex_unlock(&info->mutex);
 
     return ret;
 }
@@ -662,7 +1087,7 @@ static void tsb_i2c_dev_close(struct device *dev)
 
     info = device_get_private(dev);
 
-    sem_wait(&info->mutex);
+    mutex_lock(&info->mutex);
 
     if (!tsb_i2c_device_is_open(info)) {
         goto err_close;
@@ -670,10 +1095,14 @@ static void tsb_i2c_dev_close(struct device *dev)
 
     up_disable_irq(info->i2c_irq);
 
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    tsb_i2c_dma_close(info);
+#endif
+
     info->flags = 0;
 
 err_close:
-    sem_post(&info->mutex);
+    mutex_unlock(&info->mutex);
 }
 
 static int tsb_i2c_suspend(struct device *dev)
@@ -682,17 +1111,17 @@ static int tsb_i2c_suspend(struct device *dev)
 
     info = device_get_private(dev);
 
-    sem_wait(&info->mutex);
+    mutex_lock(&info->mutex);
 
     if (info->status != TSB_I2C_STATUS_IDLE) {
-        sem_post(&info->mutex);
+        mutex_unlock(&info->mutex);
         return -EBUSY;
     }
 
     tsb_clk_disable(TSB_CLK_I2CP);
     tsb_clk_disable(TSB_CLK_I2CS);
 
-    sem_post(&info->mutex);
+    mutex_unlock(&info->mutex);
 
     return 0;
 }
@@ -828,8 +1257,11 @@ static int tsb_i2c_dev_probe(struct device *dev)
     device_set_private(dev, info);
     saved_dev = dev;
 
-    sem_init(&info->mutex, 0, 1);
+    mutex_init(&info->mutex);
     sem_init(&info->wait, 0, 0);
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    sem_init(&info->dma_done, 0, 0);
+#endif
 
     ret = tsb_pm_register(tsb_i2c_pm_prepare, tsb_i2c_pm_notify, &dev);
     if (ret < 0) {
@@ -843,7 +1275,7 @@ err_pm:
     tsb_pin_release(PIN_I2C);
     wd_delete(info->timeout);
     device_set_private(dev, NULL);
-    sem_destroy(&info->mutex);
+    mutex_destroy(&info->mutex);
     sem_destroy(&info->wait);
 err_irq_detach:
     irq_detach(info->i2c_irq);
@@ -872,8 +1304,11 @@ static void tsb_i2c_dev_remove(struct device *dev)
 
     tsb_pin_release(PIN_I2C);
 
-    sem_destroy(&info->mutex);
+    mutex_destroy(&info->mutex);
     sem_destroy(&info->wait);
+#if defined(CONFIG_ARCH_I2C_USE_DMA)
+    sem_destroy(&info->dma_done);
+#endif
 
     /* Detach Interrupt Handler */
     irq_detach(info->i2c_irq);
@@ -59,6 +59,9 @@
 #define TSB_I2C_RXFLR             0x78
 #define TSB_I2C_SDA_HOLD          0x7c
 #define TSB_I2C_TX_ABRT_SOURCE    0x80
+#define TSB_I2C_DMA_CR            0x88
+#define TSB_I2C_DMA_TDLR          0x8c
+#define TSB_I2C_DMA_RDLR          0x90
 #define TSB_I2C_ENABLE_STATUS     0x9c
 
 /* Interrupts bits */
@@ -75,6 +78,14 @@
 #define TSB_I2C_INTR_START_DET    0x0400
 #define TSB_I2C_INTR_GEN_CALL     0x0800
 
+/* Data command bits */
+#define TSB_I2C_DATA_CMD_READ     0x0100
+#define TSB_I2C_DATA_CMD_STOP     0x0200
+#define TSB_I2C_DATA_CMD_RESTART  0x0400
+
+/* DMA control bits */
+#define TSB_I2C_DMA_CR_RDMAE      0x1
+#define TSB_I2C_DMA_CR_TDMAE      0x2
 
 #define TSB_I2C_STATUS_ACTIVITY       0x1
 #define TSB_I2C_ERR_TX_ABRT           0x1
@@ -496,7 +496,7 @@ static void tsb_i2s_disable(struct tsb_i2s_info *info)
 #ifdef CONFIG_PM
 static int i2s_pm_activity(struct device *dev)
 {
-    pm_activity(TSB_I2S_ACTIVITY);
+    pm_domain_activity(TSB_I2S_PM_DOMAIN, TSB_I2S_ACTIVITY);
 
     return tsb_pm_wait_for_wakeup();
 }
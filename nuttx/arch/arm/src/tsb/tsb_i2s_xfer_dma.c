@@ -52,19 +52,77 @@
 #define DBG_I2S_DMA(fmt, ...) ((void)0)
 #endif
 
+#ifndef CONFIG_ARCH_I2S_DMA_DEPTH
+#define CONFIG_ARCH_I2S_DMA_DEPTH   2
+#endif
+
+/*
+ * The channels refill themselves from the DMA callback before the op that
+ * completed is freed, hence one op more than the entries in flight.
+ */
+#define TSB_I2S_DMA_POOL_SIZE       (CONFIG_ARCH_I2S_DMA_DEPTH + 1)
+
+/*
+ * Up to CONFIG_ARCH_I2S_DMA_DEPTH ring buffer entries are handed to each DMA
+ * channel. info->rx_rb/info->tx_rb is the oldest entry in flight, the one
+ * the next completion is for, and rx_dma_rb/tx_dma_rb the next entry to be
+ * queued. Since the entries in flight are still owned by the I2S driver,
+ * they are the ones between those two pointers.
+ */
 static struct {
     struct device *dev;
     void   *tx_chan;
     void   *rx_chan;
     sem_t  dma_chan_lock;
-    bool   tx_dma_running;
-    bool   rx_dma_running;
+    struct ring_buf *tx_dma_rb;
+    struct ring_buf *rx_dma_rb;
+    unsigned int tx_inflight;
+    unsigned int rx_inflight;
 } i2s_dma;
 
 static int tsb_i2s_rx_enqueue_rb(struct tsb_i2s_info *info,
-                                 enum device_i2s_event *event);
+                                 struct ring_buf *rb);
 static int tsb_i2s_tx_enqueue_rb(struct tsb_i2s_info *info,
-                                 enum device_i2s_event *event);
+                                 struct ring_buf *rb);
+
+/*
+ * Queue as many empty entries as the DMA depth allows. Must be called with
+ * interrupts disabled.
+ */
+static int tsb_i2s_rx_fill(struct tsb_i2s_info *info,
+                           enum device_i2s_event *event)
+{
+    struct ring_buf *rb;
+    int retval = 0;
+
+    while (i2s_dma.rx_inflight < CONFIG_ARCH_I2S_DMA_DEPTH) {
+        rb = i2s_dma.rx_dma_rb;
+
+        if (i2s_dma.rx_inflight && rb == info->rx_rb)
+            break;
+
+        if (!ring_buf_is_producers(rb))
+            break;
+
+        ring_buf_reset(rb);
+        if (ring_buf_space(rb) % 4) {
+            *event = DEVICE_I2S_EVENT_DATA_LEN;
+            DBG_I2S_DMA("Error %x\n", ring_buf_space(rb));
+            return -EINVAL;
+        }
+
+        retval = tsb_i2s_rx_enqueue_rb(info, rb);
+        if (retval) {
+            DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
+            break;
+        }
+
+        i2s_dma.rx_inflight++;
+        i2s_dma.rx_dma_rb = ring_buf_get_next(rb);
+    }
+
+    return retval;
+}
 
 static int i2s_dma_rx_callback(struct device *dev, void *chan,
                                struct device_dma_op *op,
@@ -72,27 +130,22 @@ static int i2s_dma_rx_callback(struct device *dev, void *chan,
 {
     struct tsb_i2s_info *info = arg;
     enum device_i2s_event event = DEVICE_I2S_EVENT_NONE;
-    int retval = 0;
+    irqstate_t flags;
 
     if (callback_event & DEVICE_DMA_CALLBACK_EVENT_COMPLETE) {
-        struct ring_buf *rx_rb = info->rx_rb;
-
-        info->rx_rb = ring_buf_get_next(info->rx_rb);
-
-        i2s_dma.rx_dma_running = false;
-
-        if (ring_buf_is_producers(info->rx_rb)) {
-            ring_buf_reset(info->rx_rb);
-            if (ring_buf_space(info->rx_rb) % 4) {
-                event = DEVICE_I2S_EVENT_DATA_LEN;
-                DBG_I2S_DMA("Error %x\n", ring_buf_len(info->rx_rb));
-            } else {
-                retval = tsb_i2s_rx_enqueue_rb(info, &event);
-                if (retval) {
-                    DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
-                }
-            }
-        }
+        struct ring_buf *rx_rb;
+
+        flags = irqsave();
+
+        rx_rb = info->rx_rb;
+        info->rx_rb = ring_buf_get_next(rx_rb);
+
+        if (i2s_dma.rx_inflight)
+            i2s_dma.rx_inflight--;
+
+        tsb_i2s_rx_fill(info, &event);
+
+        irqrestore(flags);
 
         ring_buf_put(rx_rb, op->sg[0].len);
         ring_buf_pass(rx_rb);
@@ -108,38 +161,30 @@ static int i2s_dma_rx_callback(struct device *dev, void *chan,
 }
 
 static int tsb_i2s_rx_enqueue_rb(struct tsb_i2s_info *info,
-                                 enum device_i2s_event *event)
+                                 struct ring_buf *rb)
 {
     int retval = 0;
     struct device_dma_op *dma_op = NULL;
-    uint32_t base;
     uint32_t *dp;
 
-    dp = (uint32_t *)ring_buf_get_head(info->rx_rb);
+    dp = (uint32_t *)ring_buf_get_head(rb);
 
-    retval = device_dma_op_alloc(i2s_dma.dev, 1, 0, &dma_op);
+    /* the rest of the op was set up by tsb_i2s_xfer_prepare_receiver() */
+    retval = device_dma_op_pool_alloc(i2s_dma.dev, i2s_dma.rx_chan, &dma_op);
     if (retval) {
         DBG_I2S_DMA("tsb_i2s_rx_enqueue_rb: failed allocate a DMA op, retval \
                     = %d.\n", retval);
         return retval;
     }
 
-    dma_op->callback = i2s_dma_rx_callback;
-    dma_op->callback_arg = info;
-    dma_op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE;
-    dma_op->sg_count = 1;
-
-    base = tsb_i2s_get_block_base(info, TSB_I2S_BLOCK_SI);
-    base += TSB_I2S_REG_LMEM00;
-    dma_op->sg[0].src_addr = (off_t) base;
     dma_op->sg[0].dst_addr = (off_t) dp;
-    dma_op->sg[0].len = (size_t)ring_buf_space(info->rx_rb);
+    dma_op->sg[0].len = (size_t)ring_buf_space(rb);
 
     retval = device_dma_enqueue(i2s_dma.dev, i2s_dma.rx_chan, dma_op);
     if (retval) {
         DBG_I2S_DMA("failed to start DMA transfer: %d\n", retval);
-    } else
-        i2s_dma.rx_dma_running = true;
+        device_dma_op_free(i2s_dma.dev, dma_op);
+    }
 
     return retval;
 }
@@ -147,23 +192,9 @@ static int tsb_i2s_rx_enqueue_rb(struct tsb_i2s_info *info,
 int tsb_i2s_rx_data(struct tsb_i2s_info *info)
 {
     enum device_i2s_event event = DEVICE_I2S_EVENT_NONE;
-    int retval = 0;
-
-    if (ring_buf_is_producers(info->rx_rb)) {
-        ring_buf_reset(info->rx_rb);
-        if (ring_buf_space(info->rx_rb) % 4) {
-            event = DEVICE_I2S_EVENT_DATA_LEN;
-            retval = -EINVAL;
-        } else {
-            if (!i2s_dma.rx_dma_running) {
-                retval = tsb_i2s_rx_enqueue_rb(info, &event);
-                if (retval) {
-                    DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
-                }
-            }
-        }
-    }
+    int retval;
 
+    retval = tsb_i2s_rx_fill(info, &event);
     if (retval) {
         tsb_i2s_stop_receiver(info, 1);
 
@@ -180,38 +211,78 @@ int tsb_i2s_rx_data(struct tsb_i2s_info *info)
     return retval;
 }
 
+/*
+ * Queue as many filled entries as the DMA depth allows. Must be called with
+ * interrupts disabled.
+ */
+static int tsb_i2s_tx_fill(struct tsb_i2s_info *info,
+                           enum device_i2s_event *event)
+{
+    struct ring_buf *rb;
+    int retval = 0;
+
+    while (i2s_dma.tx_inflight < CONFIG_ARCH_I2S_DMA_DEPTH) {
+        rb = i2s_dma.tx_dma_rb;
+
+        if (i2s_dma.tx_inflight && rb == info->tx_rb)
+            break;
+
+        if (!ring_buf_is_consumers(rb))
+            break;
+
+        if (ring_buf_len(rb) % 4) {
+            *event = DEVICE_I2S_EVENT_DATA_LEN;
+            DBG_I2S_DMA("Error: %x\n", ring_buf_len(rb));
+            return -EINVAL;
+        }
+
+        retval = tsb_i2s_tx_enqueue_rb(info, rb);
+        if (retval) {
+            DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
+            break;
+        }
+
+        i2s_dma.tx_inflight++;
+        i2s_dma.tx_dma_rb = ring_buf_get_next(rb);
+    }
+
+    return retval;
+}
+
 static int i2s_dma_tx_callback(struct device *dev, void *chan,
                                struct device_dma_op *op,
                                unsigned int callback_event, void *arg)
 {
     struct tsb_i2s_info *info = arg;
     enum device_i2s_event event = DEVICE_I2S_EVENT_NONE;
+    struct ring_buf *tx_rb;
+    irqstate_t flags;
     int retval = 0;
 
     if (callback_event & DEVICE_DMA_CALLBACK_EVENT_COMPLETE) {
-        ring_buf_reset(info->tx_rb);
-        ring_buf_pass(info->tx_rb);
+        flags = irqsave();
+
+        tx_rb = info->tx_rb;
+        info->tx_rb = ring_buf_get_next(tx_rb);
+
+        if (i2s_dma.tx_inflight)
+            i2s_dma.tx_inflight--;
+
+        irqrestore(flags);
+
+        ring_buf_reset(tx_rb);
+        ring_buf_pass(tx_rb);
         if (info->tx_callback)
-            info->tx_callback(info->tx_rb, DEVICE_I2S_EVENT_TX_COMPLETE,
+            info->tx_callback(tx_rb, DEVICE_I2S_EVENT_TX_COMPLETE,
                               info->tx_arg);
 
-        i2s_dma.tx_dma_running = false;
-
-        info->tx_rb = ring_buf_get_next(info->tx_rb);
-
-        if (tsb_i2s_tx_is_active(info)) {
-            if (ring_buf_is_consumers(info->tx_rb)) {
-                if (ring_buf_len(info->tx_rb) % 4) {
-                    event = DEVICE_I2S_EVENT_DATA_LEN;
-                    DBG_I2S_DMA("Error: %x\n", ring_buf_len(info->tx_rb));
-                } else {
-                    retval = tsb_i2s_tx_enqueue_rb(info, &event);
-                    if (retval) {
-                        DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
-                    }
-                }
-            }
-        }
+        flags = irqsave();
+
+        if (tsb_i2s_tx_is_active(info))
+            retval = tsb_i2s_tx_fill(info, &event);
+
+        irqrestore(flags);
+
         device_dma_op_free(i2s_dma.dev, op);
     }
 
@@ -219,39 +290,30 @@ static int i2s_dma_tx_callback(struct device *dev, void *chan,
 }
 
 static int tsb_i2s_tx_enqueue_rb(struct tsb_i2s_info *info,
-                                 enum device_i2s_event *event)
+                                 struct ring_buf *rb)
 {
     int retval = 0;
     struct device_dma_op *dma_op = NULL;
-    uint32_t base;
     uint32_t *dp;
 
-    dp = (uint32_t *)ring_buf_get_head(info->tx_rb);
+    dp = (uint32_t *)ring_buf_get_head(rb);
 
-    retval = device_dma_op_alloc(i2s_dma.dev, 1, 0, &dma_op);
+    /* the rest of the op was set up by tsb_i2s_xfer_prepare_transmitter() */
+    retval = device_dma_op_pool_alloc(i2s_dma.dev, i2s_dma.tx_chan, &dma_op);
     if (retval != OK) {
         DBG_I2S_DMA("tsb_i2s_tx_enqueue_rb: failed allocate a DMA op, retval \
                     = %d.\n", retval);
         return retval;
     }
 
-    dma_op->callback = i2s_dma_tx_callback;
-    dma_op->callback_arg = info;
-    dma_op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE;
-    dma_op->sg_count = 1;
-
-    base = tsb_i2s_get_block_base(info, TSB_I2S_BLOCK_SO);
-    base += TSB_I2S_REG_LMEM00;
-
     dma_op->sg[0].src_addr = (off_t) dp;
-    dma_op->sg[0].dst_addr = (off_t) base;
-    dma_op->sg[0].len = ring_buf_len(info->tx_rb);
+    dma_op->sg[0].len = ring_buf_len(rb);
 
     retval = device_dma_enqueue(i2s_dma.dev, i2s_dma.tx_chan, dma_op);
     if (retval) {
         DBG_I2S_DMA("failed to start DMA transfer: %d\n", retval);
-    } else
-        i2s_dma.tx_dma_running = true;
+        device_dma_op_free(i2s_dma.dev, dma_op);
+    }
 
     return retval;
 }
@@ -259,22 +321,9 @@ static int tsb_i2s_tx_enqueue_rb(struct tsb_i2s_info *info,
 int tsb_i2s_tx_data(struct tsb_i2s_info *info)
 {
     enum device_i2s_event event = DEVICE_I2S_EVENT_NONE;
-    int retval = 0;
-
-    if (ring_buf_is_consumers(info->tx_rb)) {
-        if (ring_buf_len(info->tx_rb) % 4) {
-            event = DEVICE_I2S_EVENT_DATA_LEN;
-            retval = -EINVAL;
-        } else {
-            if (!i2s_dma.tx_dma_running) {
-                retval = tsb_i2s_tx_enqueue_rb(info, &event);
-                if (retval) {
-                    DBG_I2S_DMA("Failed to enqueue I2S buffer.\n");
-                }
-            }
-        }
-    }
+    int retval;
 
+    retval = tsb_i2s_tx_fill(info, &event);
     if (retval) {
         tsb_i2s_stop_transmitter(info, 1);
 
@@ -428,8 +477,39 @@ void tsb_i2s_xfer_close(struct tsb_i2s_info *info)
     }
 }
 
+/*
+ * Preallocate the ops of a channel, with everything but the ring buffer
+ * entry already filled in.
+ */
+static int tsb_i2s_dma_pool_create(void *chan,
+                                   device_dma_op_callback callback,
+                                   struct tsb_i2s_info *info,
+                                   off_t src_addr, off_t dst_addr)
+{
+    struct {
+        struct device_dma_op op;
+        struct device_dma_sg sg[1];
+    } template = {
+        .op = {
+            .callback = callback,
+            .callback_arg = info,
+            .callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE,
+            .sg_count = 1,
+        },
+        .sg = {
+            { .src_addr = src_addr, .dst_addr = dst_addr, },
+        },
+    };
+
+    return device_dma_op_pool_create(i2s_dma.dev, chan,
+                                     TSB_I2S_DMA_POOL_SIZE, 1, 0,
+                                     &template.op);
+}
+
 int tsb_i2s_xfer_prepare_receiver(struct tsb_i2s_info *info)
 {
+    uint32_t base;
+    int retval;
     struct device_dma_params chan_params = {
             .src_dev = DEVICE_DMA_DEV_IO,
             .src_devid = 1,
@@ -450,11 +530,28 @@ int tsb_i2s_xfer_prepare_receiver(struct tsb_i2s_info *info)
         return -ENOMEM;
     }
 
+    base = tsb_i2s_get_block_base(info, TSB_I2S_BLOCK_SI);
+    base += TSB_I2S_REG_LMEM00;
+
+    retval = tsb_i2s_dma_pool_create(i2s_dma.rx_chan, i2s_dma_rx_callback,
+                                     info, base, 0);
+    if (retval) {
+        DBG_I2S_DMA("i2s: couldn't allocate rx DMA ops\n");
+        device_dma_chan_free(i2s_dma.dev, i2s_dma.rx_chan);
+        i2s_dma.rx_chan = NULL;
+        return retval;
+    }
+
+    i2s_dma.rx_dma_rb = info->rx_rb;
+    i2s_dma.rx_inflight = 0;
+
     return 0;
 }
 
 int tsb_i2s_xfer_prepare_transmitter(struct tsb_i2s_info *info)
 {
+    uint32_t base;
+    int retval;
     struct device_dma_params chan_params = {
             .src_dev = DEVICE_DMA_DEV_MEM,
             .src_devid = 0,
@@ -475,5 +572,20 @@ int tsb_i2s_xfer_prepare_transmitter(struct tsb_i2s_info *info)
         return -ENOMEM;
     }
 
+    base = tsb_i2s_get_block_base(info, TSB_I2S_BLOCK_SO);
+    base += TSB_I2S_REG_LMEM00;
+
+    retval = tsb_i2s_dma_pool_create(i2s_dma.tx_chan, i2s_dma_tx_callback,
+                                     info, 0, base);
+    if (retval) {
+        DBG_I2S_DMA("i2s: couldn't allocate tx DMA ops\n");
+        device_dma_chan_free(i2s_dma.dev, i2s_dma.tx_chan);
+        i2s_dma.tx_chan = NULL;
+        return retval;
+    }
+
+    i2s_dma.tx_dma_rb = info->tx_rb;
+    i2s_dma.tx_inflight = 0;
+
     return 0;
 }
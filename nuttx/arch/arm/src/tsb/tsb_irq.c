@@ -29,30 +29,32 @@
 #include <nuttx/config.h>
 
 #include <stdint.h>
+#include <assert.h>
 #include <debug.h>
 
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
 #include <arch/irq.h>
 
+#include "chip.h"
 #include "nvic.h"
+#include "ram_vectors.h"
 #include "up_arch.h"
 #include "up_internal.h"
 
 extern uint32_t _vectors;
 volatile uint32_t *current_regs;
 
-#define NVIC_SYSH_PRIORITY_MIN     0xf0 /* All bits[7:4] set is minimum priority */
-#define NVIC_SYSH_PRIORITY_DEFAULT 0x80 /* Midpoint is the default */
-#define NVIC_SYSH_PRIORITY_MAX     0x00 /* Zero is maximum priority */
-#define NVIC_SYSH_PRIORITY_STEP    0x10 /* Steps between supported priority values */
-
 #define DEFPRIORITY32 \
   (NVIC_SYSH_PRIORITY_DEFAULT << 24 |\
    NVIC_SYSH_PRIORITY_DEFAULT << 16 |\
    NVIC_SYSH_PRIORITY_DEFAULT << 8  |\
    NVIC_SYSH_PRIORITY_DEFAULT)
 
+/* Priority of the audio and UniPro interrupts, above the other normal ones */
+#define TSB_IRQ_STREAMING_PRIORITY \
+  (NVIC_SYSH_PRIORITY_DEFAULT - NVIC_SYSH_PRIORITY_STEP)
+
 #define irqn_to_nvic(irqn) \
         ((irqn) - TSB_IRQ_EXT_BASE)
 
@@ -191,9 +193,24 @@ const char *irq_names[] = {
     IRQ_NAME(TSB_IRQ_UNIPRO_RX_EOM31),
 };
 
+#ifdef CONFIG_ARMV7M_USEBASEPRI
+static void tsb_prioritize_syscall(int priority) {
+    uint32_t regval;
+
+    /* SVCALL is system handler 11 */
+    regval  = getreg32(NVIC_SYSH8_11_PRIORITY);
+    regval &= ~NVIC_SYSH_PRIORITY_PR11_MASK;
+    regval |= (priority << NVIC_SYSH_PRIORITY_PR11_SHIFT);
+    putreg32(regval, NVIC_SYSH8_11_PRIORITY);
+}
+#endif
+
 void up_irqinitialize(void) {
     uint32_t reg;
     int num_priority_registers;
+#ifdef CONFIG_ARCH_IRQPRIO
+    int irq;
+#endif
 
     /* Disable all interrupts */
     num_priority_registers = getreg32(NVIC_ICTR) + 1;
@@ -216,6 +233,11 @@ void up_irqinitialize(void) {
         reg += 4;
     }
 
+#ifdef CONFIG_ARCH_RAMVECTORS
+    /* Zero-latency interrupts are vectored directly from the RAM table */
+    up_ramvec_initialize();
+#endif
+
     /* current_regs is non-NULL only while processing an interrupt */
     current_regs = NULL;
 
@@ -228,6 +250,24 @@ void up_irqinitialize(void) {
     irq_attach(TSB_IRQ_SVCALL, up_svcall, NULL);
     irq_attach(TSB_IRQ_HARDFAULT, up_hardfault, NULL);
 
+#ifdef CONFIG_ARMV7M_USEBASEPRI
+    /* SVCall must still be taken while irqsave() masks the interrupts */
+    tsb_prioritize_syscall(NVIC_SYSH_SVCALL_PRIORITY);
+#endif
+
+#ifdef CONFIG_ARCH_IRQPRIO
+    /*
+     * The audio and UniPro handlers use OS services, so they stay in the
+     * normal band, but are served first when several interrupts are pending.
+     */
+    for (irq = TSB_IRQ_I2SOERR; irq <= TSB_IRQ_I2SI; irq++) {
+        up_prioritize_irq(irq, TSB_IRQ_STREAMING_PRIORITY);
+    }
+    for (irq = TSB_IRQ_UNIPRO; irq <= TSB_IRQ_UNIPRO_RX_EOM31; irq++) {
+        up_prioritize_irq(irq, TSB_IRQ_STREAMING_PRIORITY);
+    }
+#endif
+
     irqenable();
 }
 
@@ -251,6 +291,60 @@ void up_ack_irq(int irq) {
     (void)irq;
 }
 
+#ifdef CONFIG_ARCH_IRQPRIO
+int up_prioritize_irq(int irq, int priority) {
+    uint32_t regaddr;
+    uint32_t regval;
+    int shift;
+
+    DEBUGASSERT(irq >= TSB_IRQ_MEMFAULT && irq < NR_IRQS &&
+                (unsigned)priority <= NVIC_SYSH_PRIORITY_MIN);
+
+    if (irq < TSB_IRQ_EXT_BASE) {
+        /* NVIC_SYSH_PRIORITY() maps {0..15} to one of three registers */
+        regaddr = NVIC_SYSH_PRIORITY(irq);
+        irq -= 4;
+    } else {
+        irq = irqn_to_nvic(irq);
+        regaddr = NVIC_IRQ_PRIORITY(irq);
+    }
+
+    shift = (irq & 3) << 3;
+    regval = getreg32(regaddr);
+    regval &= ~(0xff << shift);
+    regval |= priority << shift;
+    putreg32(regval, regaddr);
+
+    return OK;
+}
+#endif
+
+#if defined(CONFIG_ARCH_HIPRI_INTERRUPT) && defined(CONFIG_ARCH_RAMVECTORS)
+/**
+ * @brief Attach a zero-latency interrupt handler
+ *
+ * The handler is vectored directly by the NVIC, bypassing up_doirq(), and
+ * runs at NVIC_SYSH_HIGH_PRIORITY, above the BASEPRI level of the kernel
+ * critical sections. It must not call any OS service: it can only hand
+ * its work over through memory, or pend a normal interrupt that will.
+ *
+ * @param irq IRQ number to attach
+ * @param vector handler, or NULL to give the IRQ back to the kernel
+ * @return 0 on success, -errno otherwise
+ */
+int tsb_irq_attach_zerolatency(int irq, void (*vector)(void)) {
+    int ret;
+
+    ret = up_ramvec_attach(irq, vector);
+    if (ret) {
+        return ret;
+    }
+
+    return up_prioritize_irq(irq, vector ? NVIC_SYSH_HIGH_PRIORITY :
+                                           NVIC_SYSH_PRIORITY_DEFAULT);
+}
+#endif
+
 /*
  * Print human-readable strings for enabled bits in peripheral NVIC space
  */
@@ -34,12 +34,22 @@
 #include <nuttx/power/pm.h>
 #include <nuttx/clock.h>
 
+#include <arch/tsb/pm.h>
+
 #define WAIT_FOR_WAKEUP_INTERVAL    10000 /* 10ms */
 #define WAIT_FOR_WAKEUP_MAX_RETRY   10
 
+#ifndef CONFIG_TSB_PM_WAKEUP_HOLD_MS
+#define CONFIG_TSB_PM_WAKEUP_HOLD_MS CONFIG_PM_SLICEMS
+#endif
+
 static volatile int tsb_pm_curr_state = PM_NORMAL;
 static volatile int tsb_pm_enabled = 1;
 
+/* No lower power state is entered before this time after a wakeup */
+static volatile uint32_t tsb_pm_hold_until;
+static volatile int tsb_pm_hold;
+
 /*
  * Called from up_idle(). Checks the power state suggested by the power
  * management algorithm, then tries to change the power state of all
@@ -56,6 +66,18 @@ void up_idlepm(void)
     }
 
     newstate = pm_checkstate();
+
+    /*
+     * After tsb_pm_wakeup(), the recommended state only catches up with the
+     * activity at the end of the time slice: don't go back down before.
+     */
+    if (tsb_pm_hold && newstate > tsb_pm_curr_state) {
+        if ((int32_t)(clock_systimer() - tsb_pm_hold_until) < 0) {
+            return;
+        }
+        tsb_pm_hold = 0;
+    }
+
     if (newstate != tsb_pm_curr_state) {
         flags = irqsave();
 
@@ -138,6 +160,45 @@ void tsb_pm_enable(void)
     irqrestore(flags);
 }
 
+/**
+ * @brief Bring the drivers back to PM_NORMAL now.
+ * @return OK (0) on success, negative error number on failure.
+ *
+ * Rather than waiting for the PM algorithm to notice the activity at the end
+ * of the current time slice and for the IDLE loop to run, change the state
+ * from the calling thread. The drivers then stay in PM_NORMAL for at least
+ * CONFIG_TSB_PM_WAKEUP_HOLD_MS. From the retained-state PM_STANDBY this only
+ * ungates the clocks and restores a few registers.
+ */
+int tsb_pm_wakeup(void)
+{
+    irqstate_t flags;
+    int ret = OK;
+
+    pm_activity(TSB_PM_WAKEUP_ACTIVITY);
+
+    flags = irqsave();
+
+    if (tsb_pm_enabled) {
+        tsb_pm_hold_until = clock_systimer() +
+                            MSEC2TICK(CONFIG_TSB_PM_WAKEUP_HOLD_MS);
+        tsb_pm_hold = 1;
+
+        if (tsb_pm_curr_state != PM_NORMAL) {
+            ret = pm_changestate(PM_NORMAL);
+            if (ret < 0) {
+                (void)pm_changestate(tsb_pm_curr_state);
+            } else {
+                tsb_pm_curr_state = PM_NORMAL;
+            }
+        }
+    }
+
+    irqrestore(flags);
+
+    return ret;
+}
+
 /**
  * @brief Wait for tsb power-management wakeup.
  * @return OK (0) on success, negative error number on failure.
@@ -146,6 +207,10 @@ int tsb_pm_wait_for_wakeup(void)
 {
     int retry = 0;
 
+    if (tsb_pm_getstate() != PM_NORMAL) {
+        (void)tsb_pm_wakeup();
+    }
+
     while (tsb_pm_getstate() == PM_SLEEP) {
         usleep(WAIT_FOR_WAKEUP_INTERVAL);
         if (++retry > WAIT_FOR_WAKEUP_MAX_RETRY) {
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/irq.h>
+#include <nuttx/sched.h>
+#include <nuttx/profiler.h>
+
+#include <arch/irq.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "tsb_tmr.h"
+
+/*
+ * Statistical profiler: a periodic interrupt from TMR4 records the program
+ * counter and the task it interrupted in a histogram. The histogram is a
+ * hash table with linear probing, so that long runs take a fixed amount of
+ * memory as long as the number of distinct locations stays small. Code
+ * running with the interrupts disabled is accounted to the point where they
+ * get enabled again.
+ */
+
+#define PROFILER_PROBES     8
+
+static struct profiler_sample_s g_profiler_hist[CONFIG_ARCH_PROFILER_NENTRIES];
+static struct tsb_tmr_ctx *g_profiler_tmr;
+static uint32_t g_profiler_dropped;
+static bool g_profiler_active;
+
+static void profiler_record(uint32_t pc, uint16_t pid)
+{
+    struct profiler_sample_s *sample;
+    unsigned int i;
+    uint32_t hash;
+
+    /* the low bit of a Thumb pc is always 0 */
+    hash = ((pc >> 1) ^ (pid * 2654435761U)) % CONFIG_ARCH_PROFILER_NENTRIES;
+
+    for (i = 0; i < PROFILER_PROBES; i++) {
+        sample = &g_profiler_hist[(hash + i) % CONFIG_ARCH_PROFILER_NENTRIES];
+
+        if (!sample->count) {
+            sample->pc = pc;
+            sample->pid = pid;
+        } else if (sample->pc != pc || sample->pid != pid) {
+            continue;
+        }
+
+        sample->count++;
+        return;
+    }
+
+    g_profiler_dropped++;
+}
+
+static int profiler_isr(int irq, void *context, void *priv)
+{
+    uint32_t *regs = context;
+
+    tsb_tmr_ack_irq(g_profiler_tmr);
+
+    if (g_profiler_active && regs)
+        profiler_record(regs[REG_PC], sched_self()->pid);
+
+    return 0;
+}
+
+int profiler_start(void)
+{
+    irqstate_t flags;
+
+    if (!g_profiler_tmr) {
+        g_profiler_tmr = tsb_tmr_get(TSB_TMR_TMR4);
+        if (!g_profiler_tmr)
+            return -ENODEV;
+
+        tsb_tmr_configure(g_profiler_tmr, TSB_TMR_MODE_PERIODIC,
+                          profiler_isr);
+        tsb_tmr_set_time(g_profiler_tmr,
+                         USEC_PER_SEC / CONFIG_ARCH_PROFILER_RATE);
+    }
+
+    flags = irqsave();
+    memset(g_profiler_hist, 0, sizeof(g_profiler_hist));
+    g_profiler_dropped = 0;
+    g_profiler_active = true;
+    irqrestore(flags);
+
+    tsb_tmr_start(g_profiler_tmr);
+    return 0;
+}
+
+void profiler_stop(void)
+{
+    if (!g_profiler_tmr)
+        return;
+
+    g_profiler_active = false;
+    tsb_tmr_cancel(g_profiler_tmr);
+}
+
+int profiler_foreach(profiler_foreach_t handler, void *arg)
+{
+    unsigned int i;
+
+    if (g_profiler_active)
+        return -EBUSY;
+
+    for (i = 0; i < CONFIG_ARCH_PROFILER_NENTRIES; i++) {
+        if (g_profiler_hist[i].count)
+            handler(&g_profiler_hist[i], arg);
+    }
+
+    return g_profiler_dropped;
+}
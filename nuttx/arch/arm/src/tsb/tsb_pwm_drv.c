@@ -40,11 +40,20 @@
 #include <nuttx/power/pm.h>
 #include <arch/tsb/pm.h>
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+#include <semaphore.h>
+#include <nuttx/device_dma.h>
+#endif
+
 #include "up_arch.h"
 #include "tsb_scm.h"
 #include "tsb_pinshare.h"
 #include "tsb_pwm.h"
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA) && defined(CONFIG_ARCH_SHARE_DMA)
+#include "tsb_dma_share.h"
+#endif
+
 #define TSB_GENERATOR_COUNTS    2
 
 #define TSB_PWM_STATUS_MASK         0x3
@@ -62,6 +71,12 @@ static uint8_t pwm_pin[TSB_GENERATOR_COUNTS] = {
     PIN_PWM0, PIN_PWM1,
 };
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+static uint8_t pwm_dma_req[TSB_GENERATOR_COUNTS] = {
+    CONFIG_ARCH_PWM0_DMA_REQ, CONFIG_ARCH_PWM1_DMA_REQ,
+};
+#endif
+
 /**
  * Data struct for a generator.
  *
@@ -85,6 +100,24 @@ struct generator_info {
 
     /** The value for pulse of iteration output. */
     uint16_t pulse_count;
+
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    /** DMA channel loading the duty cycles, allocated by the first stream */
+    void *dma_chan;
+
+    /** Operation of the running stream, NULL when no stream runs. */
+    struct device_dma_op *dma_op;
+
+    /** DUTY register values of the running stream. */
+    uint32_t *dma_buf;
+
+    /** Posted when the running stream ends. */
+    sem_t dma_done;
+
+    /** Completion callback of the running stream and its argument. */
+    pwm_stream_callback stream_cb;
+    void *stream_arg;
+#endif
 };
 
 /**
@@ -125,6 +158,11 @@ struct pwm_ctlr_info {
 
     /** Only one thread can access controller of power at a time */
     sem_t pwr_mutex;
+
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    /** DMA device, NULL without DMA. */
+    struct device *dma_dev;
+#endif
 };
 
 /** A struct pointer for interrupt routine using. */
@@ -224,7 +262,7 @@ static struct generator_info *get_gntr_info(struct pwm_ctlr_info *info,
 */
 static int pwm_pm_activity(struct device *dev)
 {
-    pm_activity(TSB_PWM_ACTIVITY);
+    pm_domain_activity(TSB_PWM_PM_DOMAIN, TSB_PWM_ACTIVITY);
 
     return tsb_pm_wait_for_wakeup();
 }
@@ -235,6 +273,350 @@ static int pwm_pm_activity(struct device *dev)
 }
 #endif
 
+/**
+ * @brief Convert a duty and a period to register values.
+ *
+ * @param dev_info Pointer to the generator_info structure.
+ * @param duty Active time in nanoseconds.
+ * @param period Period in nanoseconds.
+ * @param set_duty Filled out with the DUTY register value.
+ * @param set_freq Filled out with the FREQ register value.
+ *
+ * @return 0: Success, -EINVAL if the generator clock can't produce them.
+ */
+static int tsb_pwm_calc_config(struct generator_info *dev_info, uint32_t duty,
+                               uint32_t period, uint32_t *set_duty,
+                               uint32_t *set_freq)
+{
+    uint32_t cur_pclk_period;
+
+    /* Calculate internal clock timing.
+     * Because input period and duty is nanosecond, so 1000000000 divided by
+     * PCLK will get the minimum unit in nanosecond.
+     */
+    cur_pclk_period = (1000000000 / dev_info->pclk);
+
+    /* Calculate frequency setting value */
+    *set_freq = period / cur_pclk_period;
+    if (*set_freq <= 1) {
+        return -EINVAL;
+    }
+
+    /* Because Controller of internal clock timing depend on maximum clock/DIV,
+     * if input of duty_cycle value < internal clock timing and > 0, the duty
+     * setting is not support, so need to fail the setting.
+     */
+    if (duty > 0 && duty < cur_pclk_period) {
+        return -EINVAL;
+    }
+
+    /* Calculate duty setting value */
+    *set_duty = duty / cur_pclk_period;
+    if (*set_duty > *set_freq) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+/**
+ * @brief DMA operation callback, ends the stream of a generator.
+ *
+ * An error is always followed by the dequeue of the operation.
+ */
+static int tsb_pwm_dma_callback(struct device *dev, void *chan,
+                                struct device_dma_op *op, unsigned int event,
+                                void *arg)
+{
+    struct generator_info *dev_info = arg;
+    pwm_stream_callback callback;
+    void *callback_arg;
+
+    if (!(event & (DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                   DEVICE_DMA_CALLBACK_EVENT_DEQUEUED))) {
+        return 0;
+    }
+
+    device_dma_op_free(dev, op);
+    free(dev_info->dma_buf);
+
+    callback = dev_info->stream_cb;
+    callback_arg = dev_info->stream_arg;
+    dev_info->dma_buf = NULL;
+    dev_info->stream_cb = NULL;
+    dev_info->dma_op = NULL;
+
+    sem_post(&dev_info->dma_done);
+
+    if (callback) {
+        callback(saved_dev, dev_info->which,
+                 event & DEVICE_DMA_CALLBACK_EVENT_COMPLETE ? 0 : -EINTR,
+                 callback_arg);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Stop the stream of a generator and wait for its end.
+ *
+ * Called with op_mutex held.
+ */
+static void tsb_pwm_dma_stop(struct pwm_ctlr_info *info,
+                             struct generator_info *dev_info)
+{
+    if (!dev_info->dma_op) {
+        return;
+    }
+
+    device_dma_dequeue(info->dma_dev, dev_info->dma_chan, dev_info->dma_op);
+    while (sem_wait(&dev_info->dma_done) < 0);
+}
+
+/**
+ * @brief Stop the stream of a generator and release its DMA channel.
+ *
+ * Called with op_mutex held, before the generator is freed.
+ */
+static void tsb_pwm_dma_release(struct pwm_ctlr_info *info,
+                                struct generator_info *dev_info)
+{
+    tsb_pwm_dma_stop(info, dev_info);
+
+    if (dev_info->dma_chan) {
+        device_dma_chan_free(info->dma_dev, dev_info->dma_chan);
+        dev_info->dma_chan = NULL;
+    }
+
+    sem_destroy(&dev_info->dma_done);
+}
+
+/**
+ * @brief Open the DMA device used by the streams.
+ *
+ * Without DMA, the streams are not supported.
+ */
+static void tsb_pwm_dma_open(struct pwm_ctlr_info *info)
+{
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    info->dma_dev = tsb_dma_share_open();
+#else
+    info->dma_dev = device_open(DEVICE_TYPE_DMA_HW, 0);
+#endif
+    if (!info->dma_dev) {
+        lldbg("no DMA, PWM streams not supported\n");
+    }
+}
+
+static void tsb_pwm_dma_close(struct pwm_ctlr_info *info)
+{
+    if (!info->dma_dev) {
+        return;
+    }
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(info->dma_dev);
+#endif
+    info->dma_dev = NULL;
+}
+
+/**
+ * @brief Load a sequence of duty cycles into a generator, one per period.
+ *
+ * The first duty cycle is written by the CPU. With PWM_CR_UPD set, the
+ * generator latches DUTY at the end of every period and raises its GDMAC
+ * request, which writes the next duty cycle into the shadow register.
+ *
+ * @param dev Pointer to the device structure for PWM controller.
+ * @param which Specific PWM generator device number.
+ * @param duty Duty cycles in nanoseconds.
+ * @param count Number of entries in duty.
+ * @param period Period in nanoseconds.
+ * @param callback Called when the stream ends, may be NULL.
+ * @param arg Argument of callback.
+ *
+ * @return 0: Success, error code on failure.
+ */
+static int tsb_pwm_op_stream(struct device *dev, uint16_t which,
+                             const uint32_t *duty, uint32_t count,
+                             uint32_t period, pwm_stream_callback callback,
+                             void *arg)
+{
+    struct pwm_ctlr_info *info = NULL;
+    struct generator_info *dev_info = NULL;
+    struct device_dma_params params = {
+        .src_dev = DEVICE_DMA_DEV_MEM,
+        .src_devid = 0,
+        .src_inc_options = DEVICE_DMA_INC_AUTO,
+        .dst_dev = DEVICE_DMA_DEV_IO,
+        .dst_inc_options = DEVICE_DMA_INC_NOAUTO,
+        .transfer_size = DEVICE_DMA_TRANSFER_SIZE_32,
+        .burst_len = DEVICE_DMA_BURST_LEN_1,
+        .swap = DEVICE_DMA_SWAP_SIZE_NONE,
+    };
+    struct device_dma_op *op = NULL;
+    uint32_t *buf = NULL;
+    uint32_t set_freq;
+    uint32_t reg_cr;
+    uint32_t i;
+    int ret = 0;
+
+    if (valid_param(dev, which) || !duty || !count) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+    if (!info->dma_dev) {
+        return -ENOSYS;
+    }
+
+    sem_wait(&info->op_mutex);
+
+    dev_info = get_gntr_info(info, which);
+    if (!dev_info) {
+        ret = -EIO;
+        goto err_stream;
+    }
+
+    if (dev_info->dma_op) {
+        ret = -EBUSY;
+        goto err_stream;
+    }
+
+    buf = malloc(count * sizeof(*buf));
+    if (!buf) {
+        ret = -ENOMEM;
+        goto err_stream;
+    }
+
+    for (i = 0; i < count; i++) {
+        ret = tsb_pwm_calc_config(dev_info, duty[i], period, &buf[i],
+                                  &set_freq);
+        if (ret) {
+            goto err_free_buf;
+        }
+    }
+
+    if (!dev_info->dma_chan) {
+        params.dst_devid = pwm_dma_req[which];
+        device_dma_chan_alloc(info->dma_dev, &params, &dev_info->dma_chan);
+        if (!dev_info->dma_chan) {
+            ret = -EBUSY;
+            goto err_free_buf;
+        }
+    }
+
+    if (count > 1) {
+        ret = device_dma_op_alloc(info->dma_dev, 1, 0, &op);
+        if (ret) {
+            goto err_free_buf;
+        }
+
+        op->callback = tsb_pwm_dma_callback;
+        op->callback_arg = dev_info;
+        op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                              DEVICE_DMA_CALLBACK_EVENT_ERROR |
+                              DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
+        op->sg_count = 1;
+        op->sg[0].src_addr = (off_t)&buf[1];
+        op->sg[0].dst_addr = (off_t)(dev_info->gntr_base + TSB_PWM_DUTY);
+        op->sg[0].len = (count - 1) * sizeof(*buf);
+    }
+
+    if ((ret = pwm_pm_activity(dev))) {
+        goto err_free_op;
+    }
+
+    tsb_pwm_write(dev_info->gntr_base, TSB_PWM_FREQ, set_freq);
+    tsb_pwm_write(dev_info->gntr_base, TSB_PWM_DUTY, buf[0]);
+    tsb_pwm_write(dev_info->gntr_base, TSB_PWM_ITERATION, 0);
+
+    if (op) {
+        dev_info->dma_op = op;
+        dev_info->dma_buf = buf;
+        dev_info->stream_cb = callback;
+        dev_info->stream_arg = arg;
+
+        ret = device_dma_enqueue(info->dma_dev, dev_info->dma_chan, op);
+        if (ret) {
+            dev_info->dma_op = NULL;
+            dev_info->dma_buf = NULL;
+            dev_info->stream_cb = NULL;
+            goto err_free_op;
+        }
+    }
+
+    reg_cr = tsb_pwm_read(dev_info->gntr_base, TSB_PWM_CR);
+    tsb_pwm_write(dev_info->gntr_base, TSB_PWM_CR,
+                  reg_cr | PWM_CR_UPD | PWM_CR_ENB);
+
+    dev_info->gntr_flag |= TSB_PWM_FLAG_CONFIGURED | TSB_PWM_FLAG_ENABLED;
+
+    sem_post(&info->op_mutex);
+
+    /* A single duty cycle is done as soon as it is loaded */
+    if (!op) {
+        free(buf);
+        if (callback) {
+            callback(dev, which, 0, arg);
+        }
+    }
+
+    return 0;
+
+err_free_op:
+    if (op) {
+        device_dma_op_free(info->dma_dev, op);
+    }
+err_free_buf:
+    free(buf);
+err_stream:
+    sem_post(&info->op_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief Stop the stream of a generator.
+ *
+ * The generator keeps running with the last duty cycle loaded, the callback
+ * of the stream is called with -EINTR.
+ *
+ * @param dev Pointer to the device structure for PWM controller.
+ * @param which Specific PWM generator device number.
+ *
+ * @return 0: Success, error code on failure.
+ */
+static int tsb_pwm_op_stream_stop(struct device *dev, uint16_t which)
+{
+    struct pwm_ctlr_info *info = NULL;
+    struct generator_info *dev_info = NULL;
+    int ret = 0;
+
+    if (valid_param(dev, which)) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+
+    sem_wait(&info->op_mutex);
+
+    dev_info = get_gntr_info(info, which);
+    if (!dev_info) {
+        ret = -EIO;
+    } else if (info->dma_dev) {
+        tsb_pwm_dma_stop(info, dev_info);
+    }
+
+    sem_post(&info->op_mutex);
+
+    return ret;
+}
+#endif
+
 /**
  * @brief Stops a specific generator of toggling.
  *
@@ -494,6 +876,10 @@ static int tsb_pwm_op_activate(struct device *dev, uint16_t which)
     dev_info->which = which;
     dev_info->gntr_flag |= TSB_PWM_FLAG_ACTIVED;
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    sem_init(&dev_info->dma_done, 0, 0);
+#endif
+
     list_add(&info->pwm_list, &dev_info->list);
 
     sem_post(&info->op_mutex);
@@ -543,6 +929,12 @@ static int tsb_pwm_op_deactivate(struct device *dev, uint16_t which)
 
     tsb_pin_release(pwm_pin[which]);
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    if (info->dma_dev) {
+        tsb_pwm_dma_release(info, dev_info);
+    }
+#endif
+
     if ((ret = pwm_pm_activity(dev))) {
         goto no_deactivated;
     }
@@ -586,7 +978,6 @@ static int tsb_pwm_op_config(struct device *dev, uint16_t which, uint32_t duty,
     uint32_t reg_cr;
     uint32_t set_freq;
     uint32_t set_duty;
-    uint32_t cur_pclk_period;
     int ret = 0;
 
     if (valid_param(dev, which)) {
@@ -607,32 +998,8 @@ static int tsb_pwm_op_config(struct device *dev, uint16_t which, uint32_t duty,
         goto err_config;
     }
 
-    /* Calculate internal clock timing.
-     * Because input period and duty is nanosecond, so 1000000000 divided by
-     * PCLK will get the minimum unit in nanosecond.
-     */
-    cur_pclk_period = (1000000000 / dev_info->pclk);
-
-    /* Calculate frequency setting value */
-    set_freq = period / cur_pclk_period;
-    if (set_freq <= 1) {
-        ret = -EINVAL;
-        goto err_config;
-    }
-
-    /* Because Controller of internal clock timing depend on maximum clock/DIV,
-     * if input of duty_cycle value < internal clock timing and > 0, the duty
-     * setting is not support, so need to fail the setting.
-     */
-    if (duty > 0 && duty < cur_pclk_period) {
-        ret = -EINVAL;
-        goto err_config;
-    }
-
-    /* Calculate duty setting value */
-    set_duty = duty / cur_pclk_period;
-    if (set_duty > set_freq) {
-        ret = -EINVAL;
+    ret = tsb_pwm_calc_config(dev_info, duty, period, &set_duty, &set_freq);
+    if (ret) {
         goto err_config;
     }
 
@@ -812,6 +1179,131 @@ err_pm_activity:
     return ret;
 }
 
+/**
+ * @brief Apply the settings of several generators at once.
+ *
+ * All the settings are checked before any register is written, so that an
+ * invalid one changes nothing. FREQ and DUTY are shadow registers, latched
+ * by the generator at the end of its current period once PWM_CR_UPD is
+ * set: the new values are loaded first, then the update bits of all the
+ * generators are set back to back, instead of stopping the generators as
+ * config() does. Generators started in sync mode then switch on the same
+ * period boundary.
+ *
+ * @param dev Pointer to the device structure for PWM controller.
+ * @param updates Settings to apply.
+ * @param count Number of entries in updates.
+ *
+ * @return 0: Success, error code on failure.
+ */
+static int tsb_pwm_op_update(struct device *dev,
+                             const struct pwm_update *updates, uint16_t count)
+{
+    struct pwm_ctlr_info *info = NULL;
+    struct generator_info *dev_info[TSB_GENERATOR_COUNTS];
+    uint32_t set_freq[TSB_GENERATOR_COUNTS];
+    uint32_t set_duty[TSB_GENERATOR_COUNTS];
+    uint32_t reg_cr;
+    irqstate_t flags;
+    uint8_t mode;
+    int ret = 0;
+    int i;
+
+    if (!dev || !device_get_private(dev) || !updates ||
+        count > TSB_GENERATOR_COUNTS) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+
+    sem_wait(&info->op_mutex);
+
+    for (i = 0; i < count; i++) {
+        mode = updates[i].flags;
+
+        if (valid_param(dev, updates[i].which) ||
+            ((mode & PWM_UPDATE_ENABLE) && (mode & PWM_UPDATE_DISABLE))) {
+            ret = -EINVAL;
+            goto err_update;
+        }
+
+        dev_info[i] = get_gntr_info(info, updates[i].which);
+        if (!dev_info[i]) {
+            ret = -EIO;
+            goto err_update;
+        }
+
+        if (mode & PWM_UPDATE_CONFIG) {
+            ret = tsb_pwm_calc_config(dev_info[i], updates[i].duty,
+                                      updates[i].period, &set_duty[i],
+                                      &set_freq[i]);
+            if (ret) {
+                goto err_update;
+            }
+        } else if ((mode & PWM_UPDATE_ENABLE) &&
+                   !(dev_info[i]->gntr_flag & TSB_PWM_FLAG_CONFIGURED)) {
+            ret = -EIO;
+            goto err_update;
+        }
+    }
+
+    if ((ret = pwm_pm_activity(dev))) {
+        goto err_update;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (updates[i].flags & PWM_UPDATE_CONFIG) {
+            tsb_pwm_write(dev_info[i]->gntr_base, TSB_PWM_FREQ, set_freq[i]);
+            tsb_pwm_write(dev_info[i]->gntr_base, TSB_PWM_DUTY, set_duty[i]);
+            tsb_pwm_write(dev_info[i]->gntr_base, TSB_PWM_ITERATION, 0);
+        }
+    }
+
+    flags = irqsave();
+    for (i = 0; i < count; i++) {
+        mode = updates[i].flags;
+        reg_cr = tsb_pwm_read(dev_info[i]->gntr_base, TSB_PWM_CR);
+
+        if (mode & PWM_UPDATE_POLARITY) {
+            if (mode & PWM_UPDATE_INVERTED) {
+                reg_cr |= PWM_CR_POL;
+            } else {
+                reg_cr &= ~PWM_CR_POL;
+            }
+        }
+
+        if (mode & PWM_UPDATE_DISABLE) {
+            reg_cr &= ~PWM_CR_ENB;
+        } else if (mode & PWM_UPDATE_ENABLE) {
+            reg_cr |= PWM_CR_UPD | PWM_CR_ENB;
+        } else if (mode & PWM_UPDATE_CONFIG) {
+            reg_cr |= PWM_CR_UPD;
+        }
+
+        tsb_pwm_write(dev_info[i]->gntr_base, TSB_PWM_CR, reg_cr);
+    }
+    irqrestore(flags);
+
+    for (i = 0; i < count; i++) {
+        mode = updates[i].flags;
+
+        if (mode & PWM_UPDATE_CONFIG) {
+            dev_info[i]->gntr_flag |= TSB_PWM_FLAG_CONFIGURED;
+        }
+
+        if (mode & PWM_UPDATE_DISABLE) {
+            dev_info[i]->gntr_flag &= ~TSB_PWM_FLAG_ENABLED;
+        } else if (mode & PWM_UPDATE_ENABLE) {
+            dev_info[i]->gntr_flag |= TSB_PWM_FLAG_ENABLED;
+        }
+    }
+
+err_update:
+    sem_post(&info->op_mutex);
+
+    return ret;
+}
+
 /**
  * @brief Set generator to output specific waveform mode.
  *
@@ -1054,6 +1546,10 @@ static int tsb_pwm_dev_open(struct device *dev)
 
     info->flags = TSB_PWM_FLAG_OPENED;
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    tsb_pwm_dma_open(info);
+#endif
+
 err_open:
     sem_post(&info->op_mutex);
 
@@ -1093,6 +1589,12 @@ static void tsb_pwm_dev_close(struct device *dev)
         if (!dev_info) {
             continue;
         } else {
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+            if (info->dma_dev) {
+                tsb_pwm_dma_release(info, dev_info);
+            }
+#endif
+
             /* If any of the generator was enabled, stop its output. */
             if (dev_info->gntr_flag & TSB_PWM_FLAG_ENABLED) {
                 reg_cr = tsb_pwm_read(dev_info->gntr_base, TSB_PWM_CR);
@@ -1109,6 +1611,10 @@ static void tsb_pwm_dev_close(struct device *dev)
         }
     }
 
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    tsb_pwm_dma_close(info);
+#endif
+
     /* Finally, shutdown power and clock. */
     tsb_pwm_op_shutdown(dev, true);
 
@@ -1395,6 +1901,17 @@ static struct device_pwm_type_ops tsb_pwm_type_ops = {
     /** Start generators of pulse concurrently */
     .sync_output        = tsb_pwm_op_sync,
 
+    /** Apply settings of several generators at once */
+    .update             = tsb_pwm_op_update,
+
+#if defined(CONFIG_ARCH_PWM_USE_DMA)
+    /** Load duty cycles from a buffer, one per period */
+    .stream             = tsb_pwm_op_stream,
+
+    /** Stop loading duty cycles */
+    .stream_stop        = tsb_pwm_op_stream_stop,
+#endif
+
     /**
      * Provide the caller to register interrupt callback handler or mask bit
      * to disable interrupt.
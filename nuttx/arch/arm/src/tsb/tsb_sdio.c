@@ -33,6 +33,7 @@
 
 #include <nuttx/lib.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/mm/dma_heap.h>
 #include <nuttx/device.h>
 #include <nuttx/device_sdio.h>
 #include <nuttx/device_sdio_board.h>
@@ -44,6 +45,8 @@
 #include "tsb_scm.h"
 #include "tsb_pinshare.h"
 
+#include <arch/irq.h>
+
 /* SDIO flags */
 #define SDIO_FLAG_OPEN  BIT(0)
 #define SDIO_FLAG_WRITE BIT(1)
@@ -107,6 +110,7 @@
 #define SLOTINTSTATUS_HSTCTRLVERSION 0xFC
 
 /* CMD_TRANSFERMODE bit field details */
+#define DMA_ENABLE                BIT(0)
 #define BLOCK_COUNT_ENABLE        BIT(1)
 #define TRANSFER_DIRECTION_SELECT BIT(4)
 #define MULTI_SINGLE_BLOCK_SELECT BIT(5)
@@ -136,6 +140,7 @@
 
 /* HOST_PWR_BLKGAP_WAKEUP_CNTRL bit field details */
 #define DATA_TRASFER_WIDTH BIT(1)
+#define DMA_SELECT_MASK    0x00000018
 #define SD_BUS_POWER       BIT(8)
 
 /* HOST_PWR_BLKGAP_WAKEUP_CNTRL bit mask definition */
@@ -143,6 +148,11 @@
 
 /* HOST_PWR_BLKGAP_WAKEUP_CNTRL bit shift definition */
 #define SD_BUS_VOLTAGE_SELECT_SHIFT 9
+#define DMA_SELECT_SHIFT            3
+
+/* DMA select values */
+#define DMA_SELECT_SDMA   0x0
+#define DMA_SELECT_ADMA2  0x2
 
 /* HOST_PWR_BLKGAP_WAKEUP_CNTRL SD_BUS_VOLTAGE_SELECT definition */
 #define SUPPORT_1_8V 0x5
@@ -209,6 +219,7 @@
 #define DATA_TIMEOUT_ERR_STAT_EN   BIT(20)
 #define DATA_CRC_ERR_STAT_EN       BIT(21)
 #define DATA_END_BIT_ERR_STAT_EN   BIT(22)
+#define ADMA_ERR_STAT_EN           BIT(25)
 
 /* INT_ERR_SIGNAL_EN bit field details */
 #define CMD_COMPLETE_EN       BIT(0)
@@ -223,6 +234,7 @@
 #define DATA_TIMEOUT_ERR_EN   BIT(20)
 #define DATA_CRC_ERR_EN       BIT(21)
 #define DATA_END_BIT_ERR_EN   BIT(22)
+#define ADMA_ERR_EN           BIT(25)
 
 /* AUTOCMD12ERST_HOST_CTRL2 bit mask definition */
 #define UHS_MODE_SEL_MASK 0x00070000
@@ -238,6 +250,7 @@
 #define DDR50  0x4
 
 /* CAPABILITIES_LOW bit field details */
+#define ADMA2_SUPPORT        BIT(19)
 #define VOLTAGE_SUPPORT_3_3V BIT(24)
 #define VOLTAGE_SUPPORT_3_0V BIT(25)
 #define VOLTAGE_SUPPORT_1_8V BIT(26)
@@ -441,6 +454,27 @@
 /* Card detect timeout definition */
 #define MAX_CARD_STABLE_COUNT 400
 
+/* ADMA2 descriptor attributes */
+#define ADMA2_VALID     BIT(0)
+#define ADMA2_END       BIT(1)
+#define ADMA2_INT       BIT(2)
+#define ADMA2_ACT_TRAN  (0x2 << 4)
+
+/* Longest transfer of an ADMA2 descriptor, a length of 0 stands for it */
+#define ADMA2_MAX_LEN   65536
+
+#ifdef CONFIG_TSB_SDIO_DMA
+#define SDIO_ADMA2_DESC_COUNT \
+    ((CONFIG_TSB_SDIO_DMA_BUF_SIZE + ADMA2_MAX_LEN - 1) / ADMA2_MAX_LEN)
+
+/* ADMA2 32-bit address descriptor */
+struct sdio_adma2_desc {
+    uint16_t attr;
+    uint16_t len;
+    uint32_t addr;
+} __attribute__((packed));
+#endif
+
 /* SDIO buffer structure */
 struct sdio_buffer
 {
@@ -517,6 +551,32 @@ struct tsb_sdio_info {
     sdio_transfer_callback read_callback;
     /** Event callback function */
     sdio_event_callback callback;
+#ifdef CONFIG_TSB_SDIO_DMA
+    /** ADMA2 descriptor table */
+    struct sdio_adma2_desc *adma2_desc;
+    /** Buffer the ADMA2 engine stores read data in */
+    uint8_t *dma_buf;
+    /** Length of the DMA transfer in progress */
+    uint32_t dma_len;
+    /** Data of the DMA transfer already handed to the caller */
+    uint32_t dma_offset;
+    /** Result of the last DMA transfer */
+    int dma_status;
+    /** DMA completion semaphore */
+    sem_t dma_sem;
+    /** Controller supports ADMA2 */
+    bool dma_capable;
+    /** The data command in progress uses DMA */
+    bool dma_cmd;
+    /** The DMA transfer is still running */
+    bool dma_active;
+    /** The completion handler finishes a non-blocking read */
+    bool dma_deferred;
+#endif
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+    /** Clocks gated by the retained-state standby */
+    bool standby;
+#endif
 };
 
 static struct device *sdio_dev = NULL;
@@ -1066,6 +1126,12 @@ static void sdio_set_transfer_mode(struct device *dev, struct sdio_cmd *cmd)
         mode |= TRANSFER_DIRECTION_SELECT;
     }
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    if (info->dma_cmd) {
+        mode |= DMA_ENABLE;
+    }
+#endif
+
     sdio_putreg16(info->sdio_reg_base, CMD_TRANSFERMODE, mode);
 }
 
@@ -1193,6 +1259,260 @@ static int sdio_software_reset(struct tsb_sdio_info *info)
     return 0;
 }
 
+#ifdef CONFIG_TSB_SDIO_DMA
+/**
+ * @brief Allocate the ADMA2 descriptor table and data buffer.
+ *
+ * DMA is left disabled if the controller doesn't report ADMA2 support.
+ *
+ * @param info The SDIO driver information.
+ * @return 0 on success, negative errno on error.
+ */
+static int sdio_dma_init(struct tsb_sdio_info *info)
+{
+    int ret;
+
+    info->dma_capable = !!(sdio_getreg(info->sdio_reg_base, CAPABILITIES_LOW) &
+                           ADMA2_SUPPORT);
+    if (!info->dma_capable) {
+        lowsyslog("SDIO: no ADMA2 support, using the FIFO\n");
+        return 0;
+    }
+
+    ret = sem_init(&info->dma_sem, 0, 0);
+    if (ret) {
+        return -errno;
+    }
+
+    /* ADMA2 descriptors and data addresses must be 32-bit aligned */
+    info->adma2_desc = dma_alloc(SDIO_ADMA2_DESC_COUNT *
+                                 sizeof(*info->adma2_desc), 4);
+    info->dma_buf = dma_alloc(CONFIG_TSB_SDIO_DMA_BUF_SIZE, 4);
+    if (!info->adma2_desc || !info->dma_buf) {
+        dma_free(info->adma2_desc);
+        dma_free(info->dma_buf);
+        sem_destroy(&info->dma_sem);
+        info->dma_capable = false;
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Free the ADMA2 resources.
+ *
+ * @param info The SDIO driver information.
+ * @return None.
+ */
+static void sdio_dma_deinit(struct tsb_sdio_info *info)
+{
+    if (!info->dma_capable) {
+        return;
+    }
+
+    dma_free(info->adma2_desc);
+    dma_free(info->dma_buf);
+    sem_destroy(&info->dma_sem);
+    info->dma_capable = false;
+}
+
+/**
+ * @brief Prepare the ADMA2 engine for the data command about to be issued.
+ *
+ * The greybus transfer carrying the data buffer only arrives after the
+ * command, while the DMA engine must be programmed before it, so the data is
+ * read to a driver buffer the caller's buffer is filled from on completion.
+ * Only reads are moved by DMA: write data isn't available yet when issuing
+ * the command.
+ *
+ * @param info The SDIO driver information.
+ * @return None.
+ */
+static void sdio_dma_prepare(struct tsb_sdio_info *info)
+{
+    uint32_t len = info->blocks * info->blksz;
+    uint32_t addr = (uint32_t)info->dma_buf;
+    uint32_t chunk;
+    int i;
+
+    info->dma_cmd = false;
+
+    if (!info->dma_capable || !(info->data_flags & HC_GB_SDIO_DATA_READ) ||
+        !len || len > CONFIG_TSB_SDIO_DMA_BUF_SIZE) {
+        return;
+    }
+
+    for (i = 0; len; i++) {
+        chunk = len > ADMA2_MAX_LEN ? ADMA2_MAX_LEN : len;
+        info->adma2_desc[i].attr = ADMA2_VALID | ADMA2_ACT_TRAN;
+        info->adma2_desc[i].len = chunk == ADMA2_MAX_LEN ? 0 : chunk;
+        info->adma2_desc[i].addr = addr;
+        addr += chunk;
+        len -= chunk;
+    }
+    info->adma2_desc[i - 1].attr |= ADMA2_END;
+
+    /* Drop the completion of a transfer nobody read */
+    while (sem_trywait(&info->dma_sem) == OK);
+
+    info->dma_len = info->blocks * info->blksz;
+    info->dma_offset = 0;
+    info->dma_status = 0;
+    info->dma_deferred = false;
+    info->dma_active = true;
+    info->dma_cmd = true;
+
+    sdio_putreg(info->sdio_reg_base, ADMASYSADDR32,
+                (uint32_t)info->adma2_desc);
+    sdio_reg_field_set(info->sdio_reg_base, HOST_PWR_BLKGAP_WAKEUP_CNTRL,
+                       DMA_SELECT_MASK, DMA_SELECT_ADMA2 << DMA_SELECT_SHIFT);
+
+    /* One interrupt at the end of the transfer, or on error */
+    sdio_reg_bit_set(info->sdio_reg_base, INT_ERR_STATUS_EN,
+                     TRANSFER_COMPLETE_STAT_EN | ADMA_ERR_STAT_EN |
+                     DATA_TIMEOUT_ERR_STAT_EN);
+    sdio_reg_bit_set(info->sdio_reg_base, INT_ERR_SIGNAL_EN,
+                     TRANSFER_COMPLETE_EN | ADMA_ERR_EN | DATA_TIMEOUT_ERR_EN);
+}
+
+/**
+ * @brief Stop waiting for the DMA transfer of a failed data command.
+ *
+ * @param info The SDIO driver information.
+ * @return None.
+ */
+static void sdio_dma_cancel(struct tsb_sdio_info *info)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    if (info->dma_active) {
+        sdio_reg_bit_clr(info->sdio_reg_base, INT_ERR_SIGNAL_EN,
+                         TRANSFER_COMPLETE_EN | ADMA_ERR_EN |
+                         DATA_TIMEOUT_ERR_EN);
+        sdio_reg_bit_clr(info->sdio_reg_base, INT_ERR_STATUS_EN,
+                         TRANSFER_COMPLETE_STAT_EN | ADMA_ERR_STAT_EN);
+        info->dma_active = false;
+    }
+    info->dma_cmd = false;
+    irqrestore(flags);
+}
+
+/**
+ * @brief Hand the data of a completed DMA read to the caller.
+ *
+ * The data of one command may be read in several chunks, each read
+ * continues where the previous one stopped.
+ *
+ * @param info The SDIO driver information.
+ * @return 0 on success, negative errno on error.
+ */
+static int sdio_dma_finish_read(struct tsb_sdio_info *info)
+{
+    uint32_t len = info->blocks * info->blksz;
+    int ret = info->dma_status;
+
+    if (ret) {
+        /* Recover error interrupt, the remaining chunks are lost */
+        sdio_error_interrupt_recovery(info);
+        info->dma_cmd = false;
+    } else {
+        memcpy(info->read_buf.buffer, info->dma_buf + info->dma_offset, len);
+        info->read_buf.head = len;
+        info->dma_offset += len;
+        if (info->dma_offset == info->dma_len) {
+            info->dma_cmd = false;
+        }
+    }
+
+    info->flags &= ~SDIO_FLAG_READ;
+
+    if (info->read_callback) { /* Non-blocking */
+        info->read_callback(info->blocks, info->blksz, info->read_buf.buffer,
+                            ret);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Complete the DMA transfer in progress.
+ *
+ * Called from the interrupt handler on transfer complete, ADMA error or data
+ * timeout.
+ *
+ * @param info The SDIO driver information.
+ * @param int_err_status The interrupt status.
+ * @return None.
+ */
+static void sdio_dma_complete(struct tsb_sdio_info *info,
+                              uint32_t int_err_status)
+{
+    sdio_reg_bit_clr(info->sdio_reg_base, INT_ERR_SIGNAL_EN,
+                     TRANSFER_COMPLETE_EN | ADMA_ERR_EN | DATA_TIMEOUT_ERR_EN);
+    sdio_reg_bit_clr(info->sdio_reg_base, INT_ERR_STATUS_EN,
+                     TRANSFER_COMPLETE_STAT_EN | ADMA_ERR_STAT_EN);
+    sdio_putreg(info->sdio_reg_base, INT_ERR_STATUS,
+                int_err_status & (TRANSFER_COMPLETE | ADMA_ERROR));
+
+    if (int_err_status & ADMA_ERROR) {
+        info->dma_status = -EIO;
+    } else if (int_err_status & DATA_TIMEOUT_ERROR) {
+        info->dma_status = -ETIMEDOUT;
+    } else if (int_err_status & ERROR_INTERRUPT) {
+        info->dma_status = -EIO;
+    }
+
+    info->data_timeout = false;
+    info->dma_active = false;
+
+    if (info->dma_deferred) {
+        sdio_dma_finish_read(info);
+    } else {
+        sem_post(&info->dma_sem);
+    }
+}
+
+/**
+ * @brief Read data moved by the ADMA2 engine.
+ *
+ * @param info The SDIO driver information.
+ * @param transfer Pointer to structure of transfer.
+ * @return 0 on success, negative errno on error.
+ */
+static int sdio_dma_read(struct tsb_sdio_info *info,
+                         struct sdio_transfer *transfer)
+{
+    uint32_t len = transfer->blocks * transfer->blksz;
+    irqstate_t flags;
+
+    if (!len || len > info->dma_len - info->dma_offset) {
+        info->flags &= ~SDIO_FLAG_READ;
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+    if (info->dma_active && info->read_callback) {
+        /* Non-blocking: the completion handler finishes the read */
+        info->dma_deferred = true;
+        irqrestore(flags);
+        return 0;
+    }
+    irqrestore(flags);
+
+    /* Only the first chunk has to wait for the end of the transfer */
+    while (!info->dma_offset && sem_wait(&info->dma_sem) != OK) {
+        if (errno != EINTR) {
+            info->flags &= ~SDIO_FLAG_READ;
+            return -errno;
+        }
+    }
+
+    return sdio_dma_finish_read(info);
+}
+#endif
+
 /**
  * @brief SDIO device interrupt routing
  *
@@ -1209,7 +1529,7 @@ int sdio_irq_event(int irq, void *context, void *priv)
 {
     struct tsb_sdio_info *info = device_get_private(sdio_dev);
 
-    pm_activity(TSB_SDIO_ACTIVITY);
+    pm_domain_activity(TSB_SDIO_PM_DOMAIN, TSB_SDIO_ACTIVITY);
 
     gpio_irq_mask(irq);
     sem_post(&info->card_detect_sem);
@@ -1267,6 +1587,14 @@ static int sdio_irq_handler(int irq, void *context, void *priv)
         }
     }
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    if (info->dma_active && (int_err_status & (TRANSFER_COMPLETE |
+                                               ADMA_ERROR |
+                                               DATA_TIMEOUT_ERROR))) {
+        sdio_dma_complete(info, int_err_status);
+    }
+#endif
+
     if (int_err_status & CARD_INTERRUPT) {
         /* Disable Card Interrupt in Host */
         sdio_reg_bit_clr(info->sdio_reg_base, INT_ERR_STATUS_EN,
@@ -1647,6 +1975,41 @@ static int tsb_sdio_resume(struct device *dev)
     return 0;
 }
 
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+/**
+ * @brief Gate the SDIO clocks, keeping the controller state
+ *
+ * The register contents are retained while the clocks are gated, nothing
+ * needs to be saved.
+ *
+ * @param info Pointer to structure of SDIO device data.
+ * @return None.
+ */
+static void tsb_sdio_standby_enter(struct tsb_sdio_info *info)
+{
+    if (!info->standby) {
+        tsb_clk_disable(TSB_CLK_SDIOSYS);
+        tsb_clk_disable(TSB_CLK_SDIOSD);
+        info->standby = true;
+    }
+}
+
+/**
+ * @brief Ungate the SDIO clocks after the retained-state standby
+ *
+ * @param info Pointer to structure of SDIO device data.
+ * @return None.
+ */
+static void tsb_sdio_standby_exit(struct tsb_sdio_info *info)
+{
+    if (info->standby) {
+        tsb_clk_enable(TSB_CLK_SDIOSYS);
+        tsb_clk_enable(TSB_CLK_SDIOSD);
+        info->standby = false;
+    }
+}
+#endif
+
 #ifdef CONFIG_PM
 /**
  * @brief Notify SDIO device driver to new power state
@@ -1671,10 +2034,19 @@ static void tsb_sdio_pm_notify(struct pm_callback_s *cb,
     switch (pmstate) {
     case PM_NORMAL:
         tsb_sdio_resume(dev);
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_sdio_standby_exit(device_get_private(dev));
+#endif
         break;
     case PM_IDLE:
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_sdio_standby_exit(device_get_private(dev));
+#endif
+        break;
     case PM_STANDBY:
-        /* Nothing to do in idle or standby. */
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_sdio_standby_enter(device_get_private(dev));
+#endif
         break;
     case PM_SLEEP:
         tsb_sdio_suspend(dev);
@@ -1713,11 +2085,16 @@ static int tsb_sdio_pm_prepare(struct pm_callback_s *cb,
     switch (pmstate) {
     case PM_NORMAL:
     case PM_IDLE:
+        /* Nothing to do in normal or idle. */
+        break;
     case PM_STANDBY:
-        /* Nothing to do in normal, idle or standby. */
+#ifndef CONFIG_TSB_PM_RETAINED_STANDBY
+        /* Nothing to do in standby. */
         break;
+#endif
     case PM_SLEEP:
         if (info->flags & (SDIO_FLAG_WRITE | SDIO_FLAG_READ)) {
+            irqrestore(flags);
             return -EBUSY;
         }
         break;
@@ -1803,6 +2180,27 @@ static int tsb_sdio_get_capability(struct device *dev, struct sdio_cap *cap)
     return 0;
 }
 
+/**
+ * @brief Report SDIO activity to the power management
+ *
+ * The controller is about to be accessed: leave the retained-state standby
+ * right away instead of waiting for the PM algorithm.
+ *
+ * @param info Pointer to structure of SDIO device data.
+ * @return None.
+ */
+static void tsb_sdio_pm_activity(struct tsb_sdio_info *info)
+{
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+    if (info->standby) {
+        (void)tsb_pm_wakeup();
+        return;
+    }
+#endif
+
+    pm_domain_activity(TSB_SDIO_PM_DOMAIN, TSB_SDIO_ACTIVITY);
+}
+
 /**
  * @brief Set ios of SD host controller
  *
@@ -1827,7 +2225,7 @@ static int tsb_sdio_set_ios(struct device *dev, struct sdio_ios *ios)
 
     uint32_t uhs_mode_sel = 0;
 
-    pm_activity(TSB_SDIO_ACTIVITY);
+    tsb_sdio_pm_activity(info);
 
     /* Set clock */
     if (sdio_clock_supply(ios, info)) {
@@ -1941,7 +2339,7 @@ static int tsb_sdio_send_cmd(struct device *dev, struct sdio_cmd *cmd)
     uint8_t cmd_flags = 0;
     uint8_t retry = 0;
 
-    pm_activity(TSB_SDIO_ACTIVITY);
+    tsb_sdio_pm_activity(info);
 
     /*
      * It needs to disable transfer complete interrupt in host for masking
@@ -2016,6 +2414,12 @@ static int tsb_sdio_send_cmd(struct device *dev, struct sdio_cmd *cmd)
     /* Set Argument 1 Reg register */
     sdio_putreg(info->sdio_reg_base, ARGUMENT1, cmd->cmd_arg);
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    if (info->data_cmd) {
+        sdio_dma_prepare(info);
+    }
+#endif
+
     /* Set Transfer Mode Reg register */
     sdio_set_transfer_mode(dev, cmd);
 
@@ -2067,6 +2471,13 @@ static int tsb_sdio_send_cmd(struct device *dev, struct sdio_cmd *cmd)
     cmd->resp[2] = info->resp[2];
     cmd->resp[3] = info->resp[3];
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    if (info->sdio_int_err_status) {
+        /* No data follows a failed command */
+        sdio_dma_cancel(info);
+    }
+#endif
+
     if (cmd->cmd == HC_MMC_STOP_TRANSMISSION) {
         info->sdio_int_err_status = sdio_software_reset(info);
     }
@@ -2144,6 +2555,12 @@ static int tsb_sdio_read(struct device *dev, struct sdio_transfer *transfer)
     info->blksz = transfer->blksz;
     info->read_callback = transfer->callback;
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    if (info->dma_cmd) {
+        return sdio_dma_read(info, transfer);
+    }
+#endif
+
     if (!info->read_callback) { /* Blocking */
         sdio_read_fifo_data(info);
         info->flags &= ~SDIO_FLAG_READ;
@@ -2425,11 +2842,18 @@ static int tsb_sdio_dev_probe(struct device *dev)
         goto err_destroy_read_sem;
     }
 
+#ifdef CONFIG_TSB_SDIO_DMA
+    ret = sdio_dma_init(info);
+    if (ret) {
+        goto err_destroy_card_detect_sem;
+    }
+#endif
+
     flags = irqsave();
 
     ret = irq_attach(info->sdio_irq, sdio_irq_handler, NULL);
     if (ret) {
-        goto err_destroy_card_detect_sem;
+        goto err_dma_deinit;
     }
 
     up_enable_irq(info->sdio_irq);
@@ -2451,6 +2875,10 @@ err_disable_irq:
     irqrestore(flags);
     up_disable_irq(info->sdio_irq);
     irq_detach(info->sdio_irq);
+err_dma_deinit:
+#ifdef CONFIG_TSB_SDIO_DMA
+    sdio_dma_deinit(info);
+#endif
 err_destroy_card_detect_sem:
     sem_destroy(&info->card_detect_sem);
 err_destroy_read_sem:
@@ -2497,6 +2925,9 @@ static void tsb_sdio_dev_remove(struct device *dev)
     flags = irqsave();
     up_disable_irq(info->sdio_irq);
     irq_detach(info->sdio_irq);
+#ifdef CONFIG_TSB_SDIO_DMA
+    sdio_dma_deinit(info);
+#endif
     sem_destroy(&info->card_detect_sem);
     sem_destroy(&info->read_sem);
     sem_destroy(&info->write_sem);
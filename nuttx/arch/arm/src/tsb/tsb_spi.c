@@ -42,9 +42,16 @@
 #include <nuttx/power/pm.h>
 #include <arch/tsb/pm.h>
 
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
+#include <nuttx/device_dma.h>
+#endif
+
 #include "up_arch.h"
 #include "tsb_scm.h"
 #include "tsb_pinshare.h"
+#if defined(CONFIG_ARCH_SPI_USE_DMA) && defined(CONFIG_ARCH_SHARE_DMA)
+#include "tsb_dma_share.h"
+#endif
 
 /* minimum speed 15 kHz, one data timing is 66 usec */
 #define ONE_DATA_TIME_USEC      66
@@ -80,6 +87,7 @@
 #define SPI_CTRLR0_SCPOL        BIT(7)
 #define SPI_CTRLR0_SRL          BIT(11)
 #define SPI_CTRL0_TMOD_MASK     (0x03 << 8)
+#define SPI_CTRL0_TMOD_TX       (0x01 << 8)
 #define SPI_CTRLR0_DFS32_OFFSET 16
 #define SPI_CTRLR0_DFS32_MASK   (0x1f << SPI_CTRLR0_DFS32_OFFSET)
 
@@ -92,6 +100,10 @@
 #define SPI_SR_TXE_MASK     BIT(5)
 #define SPI_SR_DCOL_MASK    BIT(6)
 
+/** bit for DW_SPI_DMACR */
+#define SPI_DMACR_RDMAE     BIT(0)
+#define SPI_DMACR_TDMAE     BIT(1)
+
 /** bit for DW_SPI_IMR */
 #define SPI_IMR_TXEIM_MASK  BIT(0)
 #define SPI_IMR_TXOIM_MASK  BIT(1)
@@ -116,6 +128,7 @@
 #define SPI_BPW_MASK        0xFFFFFFF8  /* Minimum of 4 bits-per-word */
 #define SPI_TX_FIFO_DEPTH   16          /* TX FIFO depth */
 #define SPI_RX_FIFO_DEPTH   16          /* RX FIFO depth */
+#define SPI_DMA_MIN_WORDS   SPI_TX_FIFO_DEPTH   /* Shortest DMA transfer */
 #define _SPI_BASE_MODE      (SPI_MODE_CPHA | SPI_MODE_CPOL | SPI_MODE_LOOP)
 #if defined(CONFIG_TSB_SPI_GPIO)
 # define SPI_MAX_SLAVES      16
@@ -193,6 +206,22 @@ struct tsb_spi_dev_info {
 
     /** SPI device state */
     enum tsb_spi_state state;
+
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
+    /** DMA device, NULL when transfers use the FIFO interrupts */
+    struct device *dma_dev;
+
+    /** DMA channels feeding and draining the FIFOs */
+    void *dma_tx_chan;
+    void *dma_rx_chan;
+
+    /** data register access width of the channels, in bytes */
+    unsigned int dma_width;
+
+    /** DMA operations of the current transfer still pending */
+    struct device_dma_op *dma_tx_op;
+    struct device_dma_op *dma_rx_op;
+#endif
 };
 
 /**
@@ -250,11 +279,16 @@ static int tsb_spi_lock(struct device *dev)
 
     info = device_get_private(dev);
 
-    if (info->spi_pmstate == PM_SLEEP) {
-        pm_activity(TSB_SPI_ACTIVITY);
+    pm_domain_activity(TSB_SPI_PM_DOMAIN, TSB_SPI_ACTIVITY);
+
+    if (info->spi_pmstate != PM_NORMAL) {
+        /* Bring the drivers back to PM_NORMAL without waiting for the PM
+         * algorithm, then check the SPI did resume.
+         */
+        tsb_pm_wakeup();
 
         /* SPI not powered, fail any accessing */;
-        while (info->spi_pmstate == PM_SLEEP) {
+        while (info->spi_pmstate != PM_NORMAL) {
             usleep(1000);
             if (++loop > 10) {
                 return -EIO;
@@ -296,6 +330,49 @@ static int tsb_spi_unlock(struct device *dev)
     return 0;
 }
 
+/**
+ * @brief Assert the chip select of a slave
+ *
+ * info->lock must be held.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param devid identifier of a selected SPI slave device
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_cs_select(struct tsb_spi_dev_info *info, uint8_t devid)
+{
+#if defined(CONFIG_TSB_SPI_GPIO)
+    /* from the SPI master's point of view, we fake that we're always talking to
+     * slave #1. The trick is that by default, CS1 doesn't belong to the SPI
+     * master, so the transaction will still be initiated and meanwhile we can
+     * manually set up the devid with GPIOs the way we want. */
+    tsb_spi_write(info->reg_base, DW_SPI_SER, 0x2);
+#else
+    /* otherwise we really select the slave through the SPI master */
+    tsb_spi_write(info->reg_base, DW_SPI_SER, (1 << devid));
+#endif
+
+    return device_spi_board_cs_select(info->dev_spi_board[devid],
+                                      info->curr_xfer.cs_high);
+}
+
+/**
+ * @brief Deassert the chip select of a slave
+ *
+ * info->lock must be held.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param devid identifier of a selected SPI slave device
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_cs_deselect(struct tsb_spi_dev_info *info, uint8_t devid)
+{
+    tsb_spi_write(info->reg_base, DW_SPI_SER, 0);
+
+    return device_spi_board_cs_select(info->dev_spi_board[devid],
+                                      !info->curr_xfer.cs_high);
+}
+
 /**
  * @brief Enable the SPI chip select pin
  *
@@ -332,19 +409,8 @@ static int tsb_spi_select(struct device *dev, uint8_t devid)
         ret = -EINVAL;
         goto err_select;
     }
-#if defined(CONFIG_TSB_SPI_GPIO)
-    /* from the SPI master's point of view, we fake that we're always talking to
-     * slave #1. The trick is that by default, CS1 doesn't belong to the SPI
-     * master, so the transaction will still be initiated and meanwhile we can
-     * manually set up the devid with GPIOs the way we want. */
-    tsb_spi_write(info->reg_base, DW_SPI_SER, 0x2);
-#else
-    /* otherwise we really select the slave through the SPI master */
-    tsb_spi_write(info->reg_base, DW_SPI_SER, (1 << devid));
-#endif
 
-    ret = device_spi_board_cs_select(info->dev_spi_board[devid],
-            info->curr_xfer.cs_high);
+    ret = tsb_spi_cs_select(info, devid);
 
 err_select:
     sem_post(&info->lock);
@@ -383,10 +449,7 @@ static int tsb_spi_deselect(struct device *dev, uint8_t devid)
         goto err_deselect;
     }
 
-    tsb_spi_write(info->reg_base, DW_SPI_SER, 0);
-
-    ret = device_spi_board_cs_select(info->dev_spi_board[devid],
-            !info->curr_xfer.cs_high);
+    ret = tsb_spi_cs_deselect(info, devid);
 
 err_deselect:
     sem_post(&info->lock);
@@ -578,57 +641,335 @@ static int tsb_spi_setbpw(struct device *dev, uint8_t devid, uint8_t bpw)
     return ret;
 }
 
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
 /**
- * @brief Exchange a block of data from SPI
+ * @brief SPI DMA operation callback
  *
- * Device driver uses this function to transfer and receive data from SPI bus.
- * This function should be called after lock(); if the driver is not in lock
- * state, it returns -EPERM error code.
- * The transfer structure consists of the read/write buffer, transfer
- * length, transfer flags and callback function.
+ * The transfer is complete once all its DMA operations are.
+ */
+static int tsb_spi_dma_callback(struct device *dev, void *chan,
+                                struct device_dma_op *op,
+                                unsigned int event, void *arg)
+{
+    struct tsb_spi_dev_info *info = arg;
+
+    if (event & DEVICE_DMA_CALLBACK_EVENT_ERROR) {
+        info->curr_xfer.status = -EIO;
+    }
+
+    /* An error is always followed by the dequeue of the operation */
+    if (event & (DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                 DEVICE_DMA_CALLBACK_EVENT_DEQUEUED)) {
+        if (op == info->dma_rx_op) {
+            info->dma_rx_op = NULL;
+        } else {
+            info->dma_tx_op = NULL;
+        }
+        device_dma_op_free(dev, op);
+
+        if (!info->dma_rx_op && !info->dma_tx_op) {
+            sem_post(&info->xfer_completed);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate the DMA channels for a data register access width
  *
- * @param dev pointer to structure of device data
- * @param transfer pointer to the spi transfer request
- * @param devid the specific chip number
- * @param config pointer to the device_spi_device_config structure to set
- * the configuration for the chip. If config is NULL, the configuration
- * associated with devid will be used.
+ * The channels are kept between transfers and only reallocated when the
+ * number of bits per word needs another access width.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param width access width in bytes (1, 2 or 4)
  * @return 0 on success, negative errno on error
  */
-static int tsb_spi_exchange(struct device *dev,
-                            struct device_spi_transfer *transfer,
-                            uint8_t devid,
-                            struct device_spi_device_config *config)
+static int tsb_spi_dma_chan_setup(struct tsb_spi_dev_info *info,
+                                  unsigned int width)
 {
-    struct tsb_spi_dev_info *info = NULL;
-    uint32_t imr_reg, delay_time;
-    int ret = 0;
-    struct timespec abstime;
-    uint8_t bpw;
-    uint16_t mode;
-    uint32_t frequency;
+    struct device_dma_params params = {
+        .burst_len = DEVICE_DMA_BURST_LEN_1,
+        .swap = DEVICE_DMA_SWAP_SIZE_NONE,
+    };
 
-    /* check input parameters */
-    if (!dev || !device_get_private(dev) || !transfer) {
-        return -EINVAL;
+    if (info->dma_width == width) {
+        return 0;
     }
 
-    /* check transfer buffer */
-    if (!transfer->txbuffer && !transfer->rxbuffer) {
-        return -EINVAL;
+    if (info->dma_tx_chan) {
+        device_dma_chan_free(info->dma_dev, info->dma_tx_chan);
+        info->dma_tx_chan = NULL;
+    }
+    if (info->dma_rx_chan) {
+        device_dma_chan_free(info->dma_dev, info->dma_rx_chan);
+        info->dma_rx_chan = NULL;
+    }
+    info->dma_width = 0;
+
+    params.transfer_size = width == 1 ? DEVICE_DMA_TRANSFER_SIZE_8 :
+                           width == 2 ? DEVICE_DMA_TRANSFER_SIZE_16 :
+                                        DEVICE_DMA_TRANSFER_SIZE_32;
+
+    params.src_dev = DEVICE_DMA_DEV_MEM;
+    params.src_devid = 0;
+    params.src_inc_options = DEVICE_DMA_INC_AUTO;
+    params.dst_dev = DEVICE_DMA_DEV_IO;
+    params.dst_devid = CONFIG_ARCH_SPI_DMA_TX_REQ;
+    params.dst_inc_options = DEVICE_DMA_INC_NOAUTO;
+    device_dma_chan_alloc(info->dma_dev, &params, &info->dma_tx_chan);
+    if (!info->dma_tx_chan) {
+        return -ENOMEM;
     }
 
-    info = device_get_private(dev);
+    params.src_dev = DEVICE_DMA_DEV_IO;
+    params.src_devid = CONFIG_ARCH_SPI_DMA_RX_REQ;
+    params.src_inc_options = DEVICE_DMA_INC_NOAUTO;
+    params.dst_dev = DEVICE_DMA_DEV_MEM;
+    params.dst_devid = 0;
+    params.dst_inc_options = DEVICE_DMA_INC_AUTO;
+    device_dma_chan_alloc(info->dma_dev, &params, &info->dma_rx_chan);
+    if (!info->dma_rx_chan) {
+        device_dma_chan_free(info->dma_dev, info->dma_tx_chan);
+        info->dma_tx_chan = NULL;
+        return -ENOMEM;
+    }
 
-    if (devid >= info->num_boards)
-        return -EINVAL;
+    info->dma_width = width;
 
-    sem_wait(&info->lock);
+    return 0;
+}
 
-    if (info->state != TSB_SPI_STATE_LOCKED) {
-        ret = -EPERM;
-        goto err_unlock;
+/**
+ * @brief Prepare a DMA operation between memory and the data register
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param src source address
+ * @param dst destination address
+ * @param len length in bytes
+ * @param opp pointer filled with the operation
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_dma_op(struct tsb_spi_dev_info *info, off_t src, off_t dst,
+                          size_t len, struct device_dma_op **opp)
+{
+    struct device_dma_op *op;
+    int ret;
+
+    ret = device_dma_op_alloc(info->dma_dev, 1, 0, &op);
+    if (ret) {
+        return ret;
+    }
+
+    op->callback = tsb_spi_dma_callback;
+    op->callback_arg = info;
+    op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                          DEVICE_DMA_CALLBACK_EVENT_ERROR |
+                          DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
+    op->sg_count = 1;
+    op->sg[0].src_addr = src;
+    op->sg[0].dst_addr = dst;
+    op->sg[0].len = len;
+
+    *opp = op;
+
+    return 0;
+}
+
+/**
+ * @brief Move the data of a transfer with the GDMAC
+ *
+ * The FIFOs are fed and drained by the DMA request lines of the controller
+ * instead of the FIFO level interrupts. A transfer without receive buffer
+ * runs in transmit only mode so that the RX FIFO doesn't overflow.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param transfer pointer to the spi transfer request
+ * @param abstime timeout of the transfer
+ * @return 0 on success, -ENOSYS if the transfer must use the FIFO
+ * interrupts, negative errno on error
+ */
+static int tsb_spi_dma_exchange(struct tsb_spi_dev_info *info,
+                                struct device_spi_transfer *transfer,
+                                struct timespec *abstime)
+{
+    struct xfer_info *xfer = &info->curr_xfer;
+    off_t dr = info->reg_base + DW_SPI_DR;
+    uint32_t ctrl0, dmacr = SPI_DMACR_TDMAE;
+    struct device_dma_op *rx_op = NULL, *tx_op = NULL;
+    unsigned int width;
+    size_t len;
+    int ret;
+
+    if (!info->dma_dev || !transfer->txbuffer ||
+        transfer->nwords < SPI_DMA_MIN_WORDS) {
+        return -ENOSYS;
+    }
+
+    width = xfer->bpw <= 8 ? 1 : xfer->bpw <= 16 ? 2 : 4;
+    len = transfer->nwords * width;
+
+    ret = tsb_spi_dma_chan_setup(info, width);
+    if (ret) {
+        return -ENOSYS;
+    }
+
+    if (transfer->rxbuffer) {
+        ret = tsb_spi_dma_op(info, dr, (off_t)transfer->rxbuffer, len, &rx_op);
+        if (ret) {
+            return ret;
+        }
+        dmacr |= SPI_DMACR_RDMAE;
+    }
+
+    ret = tsb_spi_dma_op(info, (off_t)transfer->txbuffer, dr, len, &tx_op);
+    if (ret) {
+        if (rx_op) {
+            device_dma_op_free(info->dma_dev, rx_op);
+        }
+        return ret;
+    }
+
+    ctrl0 = tsb_spi_read(info->reg_base, DW_SPI_CTRLR0);
+    if (!rx_op) {
+        tsb_spi_write(info->reg_base, DW_SPI_CTRLR0,
+                      (ctrl0 & ~SPI_CTRL0_TMOD_MASK) | SPI_CTRL0_TMOD_TX);
+    }
+
+    tsb_spi_write(info->reg_base, DW_SPI_DMATDLR, SPI_TX_FIFO_DEPTH / 2);
+    tsb_spi_write(info->reg_base, DW_SPI_DMARDLR, 0);
+    tsb_spi_write(info->reg_base, DW_SPI_DMACR, dmacr);
+
+    info->dma_rx_op = rx_op;
+    info->dma_tx_op = tx_op;
+
+    /* The receive channel must be waiting before the first word goes out */
+    if (rx_op) {
+        ret = device_dma_enqueue(info->dma_dev, info->dma_rx_chan, rx_op);
+        if (ret) {
+            info->dma_rx_op = NULL;
+            info->dma_tx_op = NULL;
+            device_dma_op_free(info->dma_dev, rx_op);
+            device_dma_op_free(info->dma_dev, tx_op);
+            goto out;
+        }
+    }
+
+    ret = device_dma_enqueue(info->dma_dev, info->dma_tx_chan, tx_op);
+    if (ret) {
+        info->dma_tx_op = NULL;
+        device_dma_op_free(info->dma_dev, tx_op);
+        if (rx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_rx_chan, rx_op);
+        }
+        goto out;
+    }
+
+    tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 1);
+
+    ret = sem_timedwait(&info->xfer_completed, abstime);
+    if (ret) {
+        lldbg("(): wait DMA data exchange timeout\n");
+        ret = -ETIMEDOUT;
+        if (info->dma_rx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_rx_chan,
+                               info->dma_rx_op);
+        }
+        if (info->dma_tx_op) {
+            device_dma_dequeue(info->dma_dev, info->dma_tx_chan,
+                               info->dma_tx_op);
+        }
+    } else if (!rx_op) {
+        /* The last words are still being shifted out */
+        while ((tsb_spi_read(info->reg_base, DW_SPI_SR) &
+                (SPI_SR_TFE_MASK | SPI_SR_BUSY_MASK)) != SPI_SR_TFE_MASK);
+    }
+
+    if (xfer->status) {
+        ret = xfer->status;
+    }
+
+out:
+    /* drop the completion posted by the dequeued operations */
+    while (sem_trywait(&info->xfer_completed) == 0);
+
+    tsb_spi_write(info->reg_base, DW_SPI_DMACR, 0);
+    tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 0);
+    tsb_spi_write(info->reg_base, DW_SPI_CTRLR0, ctrl0);
+
+    return ret;
+}
+
+/**
+ * @brief Open the DMA device used for the transfers
+ *
+ * Transfers fall back to the FIFO interrupts when no DMA device is
+ * available.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ */
+static void tsb_spi_dma_open(struct tsb_spi_dev_info *info)
+{
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    info->dma_dev = tsb_dma_share_open();
+#else
+    info->dma_dev = device_open(DEVICE_TYPE_DMA_HW, 0);
+#endif
+    if (!info->dma_dev) {
+        lldbg("SPI: no DMA device, using FIFO interrupts\n");
+    }
+
+    info->dma_tx_chan = NULL;
+    info->dma_rx_chan = NULL;
+    info->dma_width = 0;
+}
+
+/**
+ * @brief Release the DMA channels and device
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ */
+static void tsb_spi_dma_close(struct tsb_spi_dev_info *info)
+{
+    if (!info->dma_dev) {
+        return;
+    }
+
+    if (info->dma_tx_chan) {
+        device_dma_chan_free(info->dma_dev, info->dma_tx_chan);
+        info->dma_tx_chan = NULL;
+    }
+    if (info->dma_rx_chan) {
+        device_dma_chan_free(info->dma_dev, info->dma_rx_chan);
+        info->dma_rx_chan = NULL;
     }
+    info->dma_width = 0;
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(info->dma_dev);
+#endif
+    info->dma_dev = NULL;
+}
+#endif
+
+/**
+ * @brief Apply the configuration of a transfer
+ *
+ * @param dev pointer to structure of device data
+ * @param devid the specific chip number
+ * @param config configuration to apply, NULL for the one of devid
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_configure(struct device *dev, uint8_t devid,
+                             struct device_spi_device_config *config)
+{
+    struct tsb_spi_dev_info *info = device_get_private(dev);
+    uint8_t bpw;
+    uint16_t mode;
+    uint32_t frequency;
+    int ret;
 
     if (config == NULL) {
         /* get master config values from devid */
@@ -646,17 +987,32 @@ static int tsb_spi_exchange(struct device *dev,
     /* set master frequency */
     ret = tsb_spi_setfrequency(dev, devid, &frequency);
     if (ret)
-       goto err_unlock;
+       return ret;
 
     /* set master bits per word */
     ret = tsb_spi_setbpw(dev, devid, bpw);
     if (ret)
-        goto err_unlock;
+        return ret;
 
     /* set master mode */
-    ret = tsb_spi_setmode(dev, devid, mode);
-    if (ret)
-        goto err_unlock;
+    return tsb_spi_setmode(dev, devid, mode);
+}
+
+/**
+ * @brief Run one transfer with the current configuration
+ *
+ * info->lock must be held.
+ *
+ * @param info pointer to the tsb_spi_dev_info struct.
+ * @param transfer pointer to the spi transfer request
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_run_xfer(struct tsb_spi_dev_info *info,
+                            struct device_spi_transfer *transfer)
+{
+    uint32_t imr_reg, delay_time;
+    struct timespec abstime;
+    int ret = 0;
 
     info->curr_xfer.status = 0;
     info->curr_xfer.tx = transfer->txbuffer;
@@ -667,11 +1023,6 @@ static int tsb_spi_exchange(struct device *dev,
     info->curr_xfer.tx_remaining = transfer->nwords;
     info->curr_xfer.rx_remaining = transfer->nwords;
 
-    /* enable interrupt */
-    imr_reg = SPI_IMR_TXEIM_MASK | SPI_IMR_RXOIM_MASK | SPI_IMR_RXUIM_MASK;
-    tsb_spi_write(info->reg_base, DW_SPI_IMR,
-                  (tsb_spi_read(info->reg_base, DW_SPI_IMR) | imr_reg));
-
     (void)clock_gettime(CLOCK_MONOTONIC, &abstime);
 
     /* Calculate the timeout value:
@@ -685,6 +1036,19 @@ static int tsb_spi_exchange(struct device *dev,
         abstime.tv_nsec += delay_time;
     }
 
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
+    ret = tsb_spi_dma_exchange(info, transfer, &abstime);
+    if (ret != -ENOSYS) {
+        return ret;
+    }
+    ret = 0;
+#endif
+
+    /* enable interrupt */
+    imr_reg = SPI_IMR_TXEIM_MASK | SPI_IMR_RXOIM_MASK | SPI_IMR_RXUIM_MASK;
+    tsb_spi_write(info->reg_base, DW_SPI_IMR,
+                  (tsb_spi_read(info->reg_base, DW_SPI_IMR) | imr_reg));
+
     /* Enable SPI controller */
     tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 1);
     ret = sem_timedwait(&info->xfer_completed, &abstime);
@@ -697,6 +1061,163 @@ static int tsb_spi_exchange(struct device *dev,
         ret = info->curr_xfer.status;
     }
 
+    /* Disable SPI controller */
+    tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 0);
+
+    return ret;
+}
+
+/**
+ * @brief Exchange a block of data from SPI
+ *
+ * Device driver uses this function to transfer and receive data from SPI bus.
+ * This function should be called after lock(); if the driver is not in lock
+ * state, it returns -EPERM error code.
+ * The transfer structure consists of the read/write buffer, transfer
+ * length, transfer flags and callback function.
+ *
+ * @param dev pointer to structure of device data
+ * @param transfer pointer to the spi transfer request
+ * @param devid the specific chip number
+ * @param config pointer to the device_spi_device_config structure to set
+ * the configuration for the chip. If config is NULL, the configuration
+ * associated with devid will be used.
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_exchange(struct device *dev,
+                            struct device_spi_transfer *transfer,
+                            uint8_t devid,
+                            struct device_spi_device_config *config)
+{
+    struct tsb_spi_dev_info *info = NULL;
+    int ret = 0;
+
+    /* check input parameters */
+    if (!dev || !device_get_private(dev) || !transfer) {
+        return -EINVAL;
+    }
+
+    /* check transfer buffer */
+    if (!transfer->txbuffer && !transfer->rxbuffer) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+
+    if (devid >= info->num_boards)
+        return -EINVAL;
+
+    sem_wait(&info->lock);
+
+    if (info->state != TSB_SPI_STATE_LOCKED) {
+        ret = -EPERM;
+        goto err_unlock;
+    }
+
+    ret = tsb_spi_configure(dev, devid, config);
+    if (ret)
+        goto err_unlock;
+
+    ret = tsb_spi_run_xfer(info, transfer);
+
+err_unlock:
+    /* Disable SPI controller */
+    tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 0);
+    sem_post(&info->lock);
+    return ret;
+}
+
+/**
+ * @brief Exchange a sequence of blocks of data from SPI
+ *
+ * Runs all the transfers under one hold of the driver lock. The chip
+ * configuration is only programmed again when it differs from the previous
+ * transfer, and short delays between transfers are busy-waited rather than
+ * rounded up to a system tick. This function should be called after lock().
+ *
+ * @param dev pointer to structure of device data
+ * @param xfers array of transfers
+ * @param count number of transfers
+ * @param devid the specific chip number
+ * @return 0 on success, negative errno on error
+ */
+static int tsb_spi_exchange_batch(struct device *dev,
+                                  struct device_spi_batch_transfer *xfers,
+                                  unsigned int count, uint8_t devid)
+{
+    struct tsb_spi_dev_info *info = NULL;
+    struct device_spi_device_config *prev = NULL;
+    struct device_spi_batch_transfer *xfer;
+    bool selected = false;
+    unsigned int i;
+    int ret = 0, err;
+
+    /* check input parameters */
+    if (!dev || !device_get_private(dev) || !xfers) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+
+    if (devid >= info->num_boards)
+        return -EINVAL;
+
+    sem_wait(&info->lock);
+
+    if (info->state != TSB_SPI_STATE_LOCKED) {
+        ret = -EPERM;
+        goto err_unlock;
+    }
+
+    for (i = 0; i < count; i++) {
+        xfer = &xfers[i];
+
+        if (!xfer->transfer.txbuffer && !xfer->transfer.rxbuffer) {
+            ret = -EINVAL;
+            break;
+        }
+
+        if (!prev || prev->max_speed_hz != xfer->config.max_speed_hz ||
+            prev->mode != xfer->config.mode || prev->bpw != xfer->config.bpw) {
+            ret = tsb_spi_configure(dev, devid, &xfer->config);
+            if (ret)
+                break;
+            prev = &xfer->config;
+        }
+
+        /* assert chip-select pin */
+        if (!selected) {
+            ret = tsb_spi_cs_select(info, devid);
+            if (ret)
+                break;
+            selected = true;
+        }
+
+        ret = tsb_spi_run_xfer(info, &xfer->transfer);
+        if (ret)
+            break;
+
+        if (xfer->delay_usecs >= USEC_PER_TICK) {
+            usleep(xfer->delay_usecs);
+        } else if (xfer->delay_usecs) {
+            up_udelay(xfer->delay_usecs);
+        }
+
+        /* if cs_change enable, change the chip-select pin signal */
+        if (xfer->cs_change) {
+            ret = tsb_spi_cs_deselect(info, devid);
+            if (ret)
+                break;
+            selected = false;
+        }
+    }
+
+    if (selected) {
+        err = tsb_spi_cs_deselect(info, devid);
+        if (!ret)
+            ret = err;
+    }
+
 err_unlock:
     /* Disable SPI controller */
     tsb_spi_write(info->reg_base, DW_SPI_SSIENR, 0);
@@ -1065,6 +1586,10 @@ static int tsb_spi_dev_open(struct device *dev)
 
     up_enable_irq(TSB_IRQ_SPI);
 
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
+    tsb_spi_dma_open(info);
+#endif
+
     info->state = TSB_SPI_STATE_OPEN;
     sem_post(&info->lock);
     return ret;
@@ -1108,6 +1633,10 @@ static void tsb_spi_dev_close(struct device *dev)
     up_disable_irq(TSB_IRQ_SPI);
     irq_detach(TSB_IRQ_SPI);
 
+#if defined(CONFIG_ARCH_SPI_USE_DMA)
+    tsb_spi_dma_close(info);
+#endif
+
     tsb_spi_hw_deinit(info);
 
     for (i = 0; i < info->num_boards; i++) {
@@ -1163,6 +1692,9 @@ static int tsb_spi_resume(struct device *dev)
 static void tsb_spi_pm_notify(struct pm_callback_s *cb,
                               enum pm_state_e pmstate)
 {
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+    struct tsb_spi_dev_info *info;
+#endif
     struct device *dev;
     irqstate_t flags;
 
@@ -1175,8 +1707,26 @@ static void tsb_spi_pm_notify(struct pm_callback_s *cb,
         tsb_spi_resume(dev);
         break;
     case PM_IDLE:
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        info = device_get_private(dev);
+        if (info->spi_pmstate == PM_STANDBY) {
+            tsb_spi_resume(dev);
+        }
+#endif
+        break;
     case PM_STANDBY:
-        /* Nothing to do in idle or standby. */
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        /*
+         * Only gate the clocks: the controller keeps its configuration and
+         * resuming is as cheap as tsb_spi_resume().
+         */
+        info = device_get_private(dev);
+        if (info->spi_pmstate == PM_NORMAL) {
+            tsb_clk_disable(TSB_CLK_SPIP);
+            tsb_clk_disable(TSB_CLK_SPIS);
+            info->spi_pmstate = PM_STANDBY;
+        }
+#endif
         break;
     case PM_SLEEP:
         tsb_spi_suspend(dev);
@@ -1204,9 +1754,13 @@ static int tsb_spi_pm_prepare(struct pm_callback_s *cb,
     switch (pmstate) {
     case PM_NORMAL:
     case PM_IDLE:
+        /* Nothing to do in normal or idle. */
+        break;
     case PM_STANDBY:
-        /* Nothing to do in idle or standby. */
+#ifndef CONFIG_TSB_PM_RETAINED_STANDBY
+        /* Nothing to do in standby. */
         break;
+#endif
     case PM_SLEEP:
         if (info->curr_xfer.rx_remaining) {
             /* return not ready to SLEEP because exchange not complete yet */
@@ -1335,6 +1889,7 @@ static struct device_spi_type_ops tsb_spi_type_ops = {
     .select             = tsb_spi_select,
     .deselect           = tsb_spi_deselect,
     .exchange           = tsb_spi_exchange,
+    .exchange_batch     = tsb_spi_exchange_batch,
     .get_master_config  = tsb_spi_get_master_config,
     .get_device_config  = tsb_spi_get_device_config,
 };
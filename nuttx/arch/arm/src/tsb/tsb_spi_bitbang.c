@@ -37,10 +37,15 @@
 #include <nuttx/device.h>
 #include <nuttx/device_spi.h>
 #include <nuttx/gpio.h>
+#include <nuttx/power/pm.h>
 
 #include <arch/tsb/chip.h>
+#include <arch/tsb/pm.h>
 #include <tsb_scm.h>
 
+#include "chip.h"
+#include "up_arch.h"
+
 /**
  * Since the Toshiba bridge chip doesn't support SPI master feature on ES1/ES2
  * chip, we implemented the SPI bitbang driver to simulate SPI signal. The
@@ -59,6 +64,18 @@
 
 #define NUMOFCS             1
 
+/*
+ * The SPI pins are TSB GPIOs, so the optimized transfers toggle them with
+ * direct accesses to the GPIO controller registers, see tsb_gpio.c.
+ */
+#define GPIO_DATA           (GPIO_BASE)
+#define GPIO_ODATA          (GPIO_BASE + 0x4)
+#define GPIO_ODATASET       (GPIO_BASE + 0x8)
+#define GPIO_ODATACLR       (GPIO_BASE + 0xc)
+
+#define SPI_SDO_MASK        BIT(SPI_SDO)
+#define SPI_SCK_MASK        BIT(SPI_SCK)
+
 /* Because we use a simple delay loop mechanism to simulate the SPI signal,
  * any extra operation will impact the SPI timing. We need to eliminate such
  * factors, and to do so I minused out the bit transfer overhead, using an
@@ -105,6 +122,12 @@ struct tsb_spi_info {
     int chipselect[NUMOFCS];
     /** simulate SPI one bit transaction function */
     uint8_t (*bitexchange)(uint32_t outdata, uint32_t holdtime, bool loopback);
+    /** optimized transfer of 8, 16 or 32 bit words in the current mode */
+    void (*fast_transfer)(struct tsb_spi_info *info,
+                          struct device_spi_transfer *transfer);
+    /** register and mask the input bits are read from */
+    uint32_t in_reg;
+    uint32_t in_mask;
 
     /** Exclusive access for SPI bus */
     sem_t bus;
@@ -275,6 +298,187 @@ static uint8_t tsb_spi_bitexchange3(uint32_t outdata, uint32_t holdtime, bool lo
     return indata;
 }
 
+/**
+ * @brief Exchange one bit with direct GPIO register accesses
+ *
+ * SCK goes to its active level on the leading edge and back to its idle level
+ * on the trailing edge. In modes 0 and 2 (CPHA = 0), SDO is set before the
+ * leading edge and SDI is sampled on it. In modes 1 and 3 (CPHA = 1), SDO is
+ * set on the leading edge and SDI is sampled on the trailing edge.
+ *
+ * cpol and cpha are constant in each caller, so that the branches on them
+ * are resolved at compile time.
+ *
+ * @param info pointer to the data of tsb_spi_info
+ * @param outdata data for SPI output
+ * @param holdtime SPI hold time timing
+ * @param cpol clock polarity
+ * @param cpha clock phase
+ * @return input bit, 0 or 1
+ */
+static inline inline_function uint32_t
+tsb_spi_fast_bit(struct tsb_spi_info *info, uint32_t outdata,
+                 uint32_t holdtime, const bool cpol, const bool cpha)
+{
+    const uint32_t lead = cpol ? GPIO_ODATACLR : GPIO_ODATASET;
+    const uint32_t trail = cpol ? GPIO_ODATASET : GPIO_ODATACLR;
+    uint32_t indata;
+
+    if (cpha)
+        putreg32(SPI_SCK_MASK, lead);
+    putreg32(SPI_SDO_MASK, outdata ? GPIO_ODATASET : GPIO_ODATACLR);
+    if (holdtime)
+        up_udelay(holdtime);
+    putreg32(SPI_SCK_MASK, cpha ? trail : lead);
+    indata = getreg32(info->in_reg) & info->in_mask;
+    if (holdtime)
+        up_udelay(holdtime);
+    if (!cpha)
+        putreg32(SPI_SCK_MASK, trail);
+
+    return !!indata;
+}
+
+/**
+ * @brief Exchange one byte, MSB first, with direct GPIO register accesses
+ *
+ * @param info pointer to the data of tsb_spi_info
+ * @param outdata data for SPI output
+ * @param holdtime SPI hold time timing
+ * @param cpol clock polarity
+ * @param cpha clock phase
+ * @return input byte
+ */
+static inline inline_function uint32_t
+tsb_spi_fast_byte(struct tsb_spi_info *info, uint32_t outdata,
+                  uint32_t holdtime, const bool cpol, const bool cpha)
+{
+    uint32_t indata;
+
+    indata  = tsb_spi_fast_bit(info, outdata & 0x80, holdtime, cpol, cpha) << 7;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x40, holdtime, cpol, cpha) << 6;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x20, holdtime, cpol, cpha) << 5;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x10, holdtime, cpol, cpha) << 4;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x08, holdtime, cpol, cpha) << 3;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x04, holdtime, cpol, cpha) << 2;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x02, holdtime, cpol, cpha) << 1;
+    indata |= tsb_spi_fast_bit(info, outdata & 0x01, holdtime, cpol, cpha);
+
+    return indata;
+}
+
+/**
+ * @brief Reverse the bit order of a word
+ *
+ * @param data word to reverse
+ * @param nbits number of bits of the word
+ * @return reversed word
+ */
+static inline uint32_t tsb_spi_bitrev(uint32_t data, unsigned int nbits)
+{
+    __asm__ ("rbit %0, %1" : "=r" (data) : "r" (data));
+    return data >> (32 - nbits);
+}
+
+/**
+ * @brief Optimized SPI data transfer
+ *
+ * The words are exchanged one byte at a time, most significant byte first,
+ * with the bit loops unrolled. LSB first words are bit reversed before and
+ * after the exchange.
+ *
+ * @param info pointer to the data of tsb_spi_info
+ * @param transfer pointer to the spi transfer request
+ * @param cpol clock polarity
+ * @param cpha clock phase
+ */
+static inline inline_function void
+tsb_spi_fast_transfer(struct tsb_spi_info *info,
+                      struct device_spi_transfer *transfer,
+                      const bool cpol, const bool cpha)
+{
+    uint32_t holdtime = info->holdtime;
+    bool lsb_first = info->modes & SPI_MODE_LSB_FIRST;
+    uint32_t dataout, datain;
+    int i;
+
+    pm_domain_activity(TSB_GPIO_PM_DOMAIN, TSB_GPIO_ACTIVITY);
+
+    switch (info->bpw) {
+    case 8: {
+        uint8_t *txbuf = transfer->txbuffer, *rxbuf = transfer->rxbuffer;
+
+        for (i = 0; i < transfer->nwords; i++) {
+            dataout = txbuf ? txbuf[i] : 0;
+            if (lsb_first)
+                dataout = tsb_spi_bitrev(dataout, 8);
+            datain = tsb_spi_fast_byte(info, dataout, holdtime, cpol, cpha);
+            if (rxbuf)
+                rxbuf[i] = lsb_first ? tsb_spi_bitrev(datain, 8) : datain;
+        }
+        break;
+    }
+    case 16: {
+        uint16_t *txbuf = transfer->txbuffer, *rxbuf = transfer->rxbuffer;
+
+        for (i = 0; i < transfer->nwords; i++) {
+            dataout = txbuf ? txbuf[i] : 0;
+            if (lsb_first)
+                dataout = tsb_spi_bitrev(dataout, 16);
+            datain = tsb_spi_fast_byte(info, dataout >> 8, holdtime,
+                                       cpol, cpha) << 8;
+            datain |= tsb_spi_fast_byte(info, dataout, holdtime, cpol, cpha);
+            if (rxbuf)
+                rxbuf[i] = lsb_first ? tsb_spi_bitrev(datain, 16) : datain;
+        }
+        break;
+    }
+    case 32: {
+        uint32_t *txbuf = transfer->txbuffer, *rxbuf = transfer->rxbuffer;
+
+        for (i = 0; i < transfer->nwords; i++) {
+            dataout = txbuf ? txbuf[i] : 0;
+            if (lsb_first)
+                dataout = tsb_spi_bitrev(dataout, 32);
+            datain = tsb_spi_fast_byte(info, dataout >> 24, holdtime,
+                                       cpol, cpha) << 24;
+            datain |= tsb_spi_fast_byte(info, dataout >> 16, holdtime,
+                                        cpol, cpha) << 16;
+            datain |= tsb_spi_fast_byte(info, dataout >> 8, holdtime,
+                                        cpol, cpha) << 8;
+            datain |= tsb_spi_fast_byte(info, dataout, holdtime, cpol, cpha);
+            if (rxbuf)
+                rxbuf[i] = lsb_first ? tsb_spi_bitrev(datain, 32) : datain;
+        }
+        break;
+    }
+    }
+}
+
+static void tsb_spi_fast_transfer0(struct tsb_spi_info *info,
+                                   struct device_spi_transfer *transfer)
+{
+    tsb_spi_fast_transfer(info, transfer, false, false);
+}
+
+static void tsb_spi_fast_transfer1(struct tsb_spi_info *info,
+                                   struct device_spi_transfer *transfer)
+{
+    tsb_spi_fast_transfer(info, transfer, false, true);
+}
+
+static void tsb_spi_fast_transfer2(struct tsb_spi_info *info,
+                                   struct device_spi_transfer *transfer)
+{
+    tsb_spi_fast_transfer(info, transfer, true, false);
+}
+
+static void tsb_spi_fast_transfer3(struct tsb_spi_info *info,
+                                   struct device_spi_transfer *transfer)
+{
+    tsb_spi_fast_transfer(info, transfer, true, true);
+}
+
 /**
  * @brief 8-bits SPI data transfer
  *
@@ -687,17 +891,30 @@ static int tsb_spi_setmode(struct device *dev, uint16_t mode)
     switch (mode & (SPI_MODE_CPHA | SPI_MODE_CPOL)) {
         case SPI_MODE_0:
             info->bitexchange = tsb_spi_bitexchange0;
+            info->fast_transfer = tsb_spi_fast_transfer0;
             break;
         case SPI_MODE_1:
             info->bitexchange = tsb_spi_bitexchange1;
+            info->fast_transfer = tsb_spi_fast_transfer1;
             break;
         case SPI_MODE_2:
             info->bitexchange = tsb_spi_bitexchange2;
+            info->fast_transfer = tsb_spi_fast_transfer2;
             break;
         case SPI_MODE_3:
             info->bitexchange = tsb_spi_bitexchange3;
+            info->fast_transfer = tsb_spi_fast_transfer3;
             break;
     }
+
+    /* In loopback mode, the data read back is the SDO output */
+    if (mode & SPI_MODE_LOOP) {
+        info->in_reg = GPIO_ODATA;
+        info->in_mask = BIT(SPI_SDO);
+    } else {
+        info->in_reg = GPIO_DATA;
+        info->in_mask = BIT(SPI_SDI);
+    }
     /* After changed SPI mode, we need to change the SCK default output level */
     gpio_set_value(SPI_SCK, (mode & SPI_MODE_CPOL)? 1 : 0);
 
@@ -829,7 +1046,9 @@ static int tsb_spi_exchange(struct device *dev,
     if (ret)
         goto err_unlock;
 
-    if (info->bpw <= 8) {
+    if (info->bpw == 8 || info->bpw == 16 || info->bpw == 32) {
+        info->fast_transfer(info, transfer);
+    } else if (info->bpw <= 8) {
         tsb_spi_transfer_8(info, transfer);
     } else if (info->bpw <= 16) {
         tsb_spi_transfer_16(info, transfer);
@@ -972,6 +1191,9 @@ static int tsb_spi_dev_probe(struct device *dev)
     info->chipselect[0] = SPI_CS;
     info->selected = -1; /* select none */
     info->bitexchange = tsb_spi_bitexchange0;
+    info->fast_transfer = tsb_spi_fast_transfer0;
+    info->in_reg = GPIO_DATA;
+    info->in_mask = BIT(SPI_SDI);
 
     /* initialize gpio pins */
     tsb_spi_hw_init(dev);
@@ -28,6 +28,7 @@
 
 #include <nuttx/config.h>
 #include <nuttx/init.h>
+#include <nuttx/boot_timing.h>
 #include <arch/board/board.h>
 #include "up_arch.h"
 #include "up_internal.h"
@@ -37,6 +38,7 @@
 #include "tsb_scm.h"
 #include "tsb_lowputc.h"
 #include "tsb_pinshare.h"
+#include "tsb_boottiming.h"
 
 #ifdef DEBUG_EARLY_BOOT
 #define dbg(x) up_lowputc(x)
@@ -75,11 +77,15 @@ void tsb_start(void) {
     uint32_t *dst;
     __attribute__((unused)) int retval;
 
+    tsb_boot_timing_init();
+
     /* Zero .bss */
     for (dst = &_sbss; dst < &_ebss;) {
         *dst++ = 0;
     }
 
+    boot_timing_mark("bss");
+
     /* Relocate vector table (eg from bootrom) */
     extern uint32_t _vectors;
     putreg32((uint32_t)&_vectors, NVIC_VECTAB);
@@ -134,6 +140,7 @@ void tsb_start(void) {
     dbg('D');
 
     tsb_boardinitialize();
+    boot_timing_mark("tsb_start");
 
     os_start();
 }
@@ -198,3 +198,18 @@ uint32_t hrt_getusec(void)
 
     return usec;
 }
+
+/*
+ * Return the nanoseconds since the last reboot of the CPU, on 64 bits so
+ * that it only wraps with the 32-bit tick count, after 497 days. This
+ * function is interrupt context safe.
+ */
+uint64_t hrt_getnsec(void)
+{
+    uint32_t clock_value, tick_count;
+
+    timer_snapshot(&tick_count, &clock_value);
+
+    return (uint64_t)tick_count * NANOSEC_PER_SYSTICK +
+           CLOCK_COUNT2NSEC(clock_value);
+}
@@ -38,9 +38,17 @@
 #include <nuttx/power/pm.h>
 #include <arch/tsb/pm.h>
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+#include <nuttx/arch.h>
+#include <nuttx/device_dma.h>
+#endif
+
 #include "up_arch.h"
 #include "tsb_scm.h"
 #include "tsb_pinshare.h"
+#if defined(CONFIG_ARCH_UART_USE_DMA) && defined(CONFIG_ARCH_SHARE_DMA)
+#include "tsb_dma_share.h"
+#endif
 
 #define UART_CLOCK  48000000
 
@@ -108,6 +116,7 @@
 #define UA_FIFO_ENABLE              BIT(0)
 #define UA_RX_FIFO_RESET            BIT(1)
 #define UA_TX_FIFO_RESET            BIT(2)
+#define UA_DMA_MODE                 BIT(3)  /* DMA mode 1, multi-character */
 
 /*
  * UA_LCR
@@ -176,6 +185,9 @@
 /* uart FIFO trigger size */
 #define FIFO_TRIGGER_SIZE           8
 
+/* shorter transfers are handled by the FIFO interrupts */
+#define UA_DMA_MIN_LEN              (2 * FIFO_TRIGGER_SIZE)
+
 /* uart driver status flag */
 #define TSB_UART_FLAG_OPEN          BIT(0)
 #define TSB_UART_FLAG_XMIT          BIT(1)
@@ -225,6 +237,27 @@ struct tsb_uart_info {
     void *event_data;
     /** Whether RTS is currently enabled **/
     bool rts_enabled;
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    /** GDMAC device, NULL when the FIFO interrupts move the data */
+    struct device *dma_dev;
+    /** Memory to THR channel */
+    void *dma_tx_chan;
+    /** RBR to memory channel */
+    void *dma_rx_chan;
+    /** Transmit in progress on the GDMAC */
+    struct device_dma_op *dma_tx_op;
+    /** Receive in progress on the GDMAC */
+    struct device_dma_op *dma_rx_op;
+    /** Ops allocated ahead, for transfers started from interrupt context */
+    struct device_dma_op *dma_tx_spare;
+    struct device_dma_op *dma_rx_spare;
+#endif
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+    /** Clocks gated by the retained-state standby */
+    bool standby;
+    /** Interrupt enables, masked while in standby */
+    uint8_t ier;
+#endif
 };
 
 /** device structure for interrupt handler */
@@ -403,6 +436,33 @@ static void ua_xmitchars(struct tsb_uart_info *uart_info)
     }
 }
 
+/**
+ * @brief Complete the current receive.
+ *
+ * Disables the receive interrupts and hands the buffer back to the upper
+ * layer, either through the callback or by waking up the blocked receiver.
+ *
+ * @param uart_info The UART driver info structure.
+ * @return None.
+ */
+static void ua_recv_complete(struct tsb_uart_info *uart_info)
+{
+    /* Disable receive interrupt */
+    ua_reg_bit_clr(uart_info->reg_base, UA_IER_DLH,
+                   UA_IER_ERBFI | UA_IER_ELSI);
+    uart_info->flags &= ~TSB_UART_FLAG_RECV;
+    if (uart_info->rx_callback) {
+        uart_info->rx_callback(uart_info->dev,
+                               uart_info->event_data,
+                               uart_info->recv.buffer,
+                               uart_info->recv.head,
+                               uart_info->line_err);
+    }
+    else {
+        sem_post(&uart_info->rx_sem);
+    }
+}
+
 /**
  * @brief Receive characters from FIFO to buffer.
  *
@@ -442,25 +502,352 @@ static void ua_recvchars(struct tsb_uart_info *uart_info, uint8_t int_id)
 
         if (ua_is_rx_fifo_empty(uart_info->reg_base) || /* FIFO timeout */
             uart_info->recv.head == uart_info->recv.tail) { /* buffer full */
-            /* Disable receive interrupt */
-            ua_reg_bit_clr(uart_info->reg_base, UA_IER_DLH,
-                           UA_IER_ERBFI | UA_IER_ELSI);
-            uart_info->flags &= ~TSB_UART_FLAG_RECV;
-            if (uart_info->rx_callback) {
-                uart_info->rx_callback(uart_info->dev,
-                                       uart_info->event_data,
-                                       uart_info->recv.buffer,
-                                       uart_info->recv.head,
-                                       uart_info->line_err);
-            }
-            else {
-                sem_post(&uart_info->rx_sem);
-            }
+            ua_recv_complete(uart_info);
             break;
         }
     }
 }
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+/**
+ * @brief Complete the current transmit.
+ *
+ * @param uart_info The UART driver info structure.
+ * @return None.
+ */
+static void ua_xmit_complete(struct tsb_uart_info *uart_info)
+{
+    if (uart_info->tx_callback) {
+        uart_info->flags &= ~TSB_UART_FLAG_XMIT;
+        uart_info->tx_callback(uart_info->dev, uart_info->event_data,
+                               uart_info->xmit.buffer, uart_info->xmit.head,
+                               0);
+    } else {
+        sem_post(&uart_info->tx_sem);
+    }
+}
+
+/**
+ * @brief Receive interrupt while the GDMAC moves the data.
+ *
+ * The GDMAC drains the FIFO whenever it reaches the trigger level, so the
+ * received data available interrupt goes away by itself. What is left below
+ * the trigger level raises the character timeout once the line went idle:
+ * the DMA is stopped at the position it reached and the remaining characters
+ * are read from the FIFO, which ends the receive with a short buffer.
+ *
+ * @param uart_info The UART driver info structure.
+ * @param int_id The interrupt ID from register.
+ * @return None.
+ */
+static void ua_dma_recvchars(struct tsb_uart_info *uart_info, uint8_t int_id)
+{
+    struct device_dma_op *op = uart_info->dma_rx_op;
+    size_t count = 0;
+
+    /* A running channel waits for the FIFO, so its position is stable here */
+    device_dma_op_get_transferred(uart_info->dma_dev, uart_info->dma_rx_chan,
+                                  op, &count);
+
+    if (int_id != UA_INTERRUPT_ID_TO && count < uart_info->recv.tail) {
+        return;
+    }
+
+    /*
+     * Take the receive back from the GDMAC, the dequeue of a complete op is
+     * a no-op and its completion is then ignored by ua_dma_callback().
+     */
+    uart_info->dma_rx_op = NULL;
+    device_dma_dequeue(uart_info->dma_dev, uart_info->dma_rx_chan, op);
+
+    uart_info->recv.head = count;
+    if (uart_info->recv.head == uart_info->recv.tail ||
+        ua_is_rx_fifo_empty(uart_info->reg_base)) {
+        ua_recv_complete(uart_info);
+    } else {
+        ua_recvchars(uart_info, int_id);
+    }
+}
+
+/**
+ * @brief GDMAC operation callback
+ *
+ * Runs from the GDMAC completion thread. An op the interrupt handler or a
+ * stop already took back is only released. Each released op is replaced by
+ * a spare one, since a transfer started from interrupt context, such as the
+ * next receive queued by the rx callback, can't allocate it.
+ */
+static int ua_dma_callback(struct device *dev, void *chan,
+                           struct device_dma_op *op, unsigned int event,
+                           void *arg)
+{
+    struct tsb_uart_info *uart_info = arg;
+    struct device_dma_op **spare;
+    struct device_dma_op *new_op;
+    irqstate_t flags;
+
+    if (!(event & (DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                   DEVICE_DMA_CALLBACK_EVENT_DEQUEUED))) {
+        return 0;
+    }
+
+    if (op->sg[0].dst_addr == uart_info->reg_base + UA_RBR_THR_DLL) {
+        spare = &uart_info->dma_tx_spare;
+    } else {
+        spare = &uart_info->dma_rx_spare;
+    }
+
+    flags = irqsave();
+
+    if (event & DEVICE_DMA_CALLBACK_EVENT_COMPLETE) {
+        if (op == uart_info->dma_tx_op) {
+            uart_info->dma_tx_op = NULL;
+            uart_info->xmit.head = uart_info->xmit.tail;
+            ua_xmit_complete(uart_info);
+        } else if (op == uart_info->dma_rx_op) {
+            uart_info->dma_rx_op = NULL;
+            uart_info->recv.head = uart_info->recv.tail;
+            ua_recv_complete(uart_info);
+        }
+    }
+
+    irqrestore(flags);
+
+    device_dma_op_free(dev, op);
+
+    if (*spare || device_dma_op_alloc(dev, 1, 0, &new_op)) {
+        return 0;
+    }
+
+    flags = irqsave();
+    if (!*spare) {
+        *spare = new_op;
+        new_op = NULL;
+    }
+    irqrestore(flags);
+
+    if (new_op) {
+        device_dma_op_free(dev, new_op);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Queue a single buffer transfer on a GDMAC channel.
+ *
+ * @param uart_info The UART driver info structure.
+ * @param chan The GDMAC channel.
+ * @param spare The op allocated ahead for the channel.
+ * @param src The source address.
+ * @param dst The destination address.
+ * @param len The length in bytes.
+ * @return The queued op, NULL when the FIFO interrupts must be used.
+ */
+static struct device_dma_op *ua_dma_start(struct tsb_uart_info *uart_info,
+                                          void *chan,
+                                          struct device_dma_op **spare,
+                                          off_t src, off_t dst, size_t len)
+{
+    struct device_dma_op *op;
+    irqstate_t flags;
+
+    flags = irqsave();
+    op = *spare;
+    *spare = NULL;
+    irqrestore(flags);
+
+    if (!op) {
+        if (up_interrupt_context() ||
+            device_dma_op_alloc(uart_info->dma_dev, 1, 0, &op)) {
+            return NULL;
+        }
+    }
+
+    op->callback = ua_dma_callback;
+    op->callback_arg = uart_info;
+    op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE |
+                          DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
+    op->sg_count = 1;
+    op->sg[0].src_addr = src;
+    op->sg[0].dst_addr = dst;
+    op->sg[0].len = len;
+
+    if (device_dma_enqueue(uart_info->dma_dev, chan, op)) {
+        *spare = op;
+        return NULL;
+    }
+
+    return op;
+}
+
+/**
+ * @brief Stop a transfer running on a GDMAC channel.
+ *
+ * Must be called with the interrupts disabled.
+ *
+ * @param uart_info The UART driver info structure.
+ * @param chan The GDMAC channel.
+ * @param opp The op of the transfer, cleared on return.
+ * @return The number of bytes the GDMAC moved.
+ */
+static int ua_dma_stop(struct tsb_uart_info *uart_info, void *chan,
+                       struct device_dma_op **opp)
+{
+    size_t count = 0;
+
+    device_dma_op_get_transferred(uart_info->dma_dev, chan, *opp, &count);
+    device_dma_dequeue(uart_info->dma_dev, chan, *opp);
+    *opp = NULL;
+
+    return count;
+}
+
+/**
+ * @brief Open the GDMAC and allocate the UART channels.
+ *
+ * The driver keeps using the FIFO interrupts when this fails.
+ *
+ * @param uart_info The UART driver info structure.
+ * @return None.
+ */
+static void ua_dma_open(struct tsb_uart_info *uart_info)
+{
+    struct device_dma_params params = {
+        .transfer_size = DEVICE_DMA_TRANSFER_SIZE_8,
+        .burst_len = DEVICE_DMA_BURST_LEN_1,
+        .swap = DEVICE_DMA_SWAP_SIZE_NONE,
+    };
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    uart_info->dma_dev = tsb_dma_share_open();
+#else
+    uart_info->dma_dev = device_open(DEVICE_TYPE_DMA_HW, 0);
+#endif
+    if (!uart_info->dma_dev) {
+        lldbg("UART: no DMA device, using FIFO interrupts\n");
+        return;
+    }
+
+    params.src_dev = DEVICE_DMA_DEV_MEM;
+    params.src_devid = 0;
+    params.src_inc_options = DEVICE_DMA_INC_AUTO;
+    params.dst_dev = DEVICE_DMA_DEV_IO;
+    params.dst_devid = CONFIG_ARCH_UART_DMA_TX_REQ;
+    params.dst_inc_options = DEVICE_DMA_INC_NOAUTO;
+    device_dma_chan_alloc(uart_info->dma_dev, &params, &uart_info->dma_tx_chan);
+
+    params.src_dev = DEVICE_DMA_DEV_IO;
+    params.src_devid = CONFIG_ARCH_UART_DMA_RX_REQ;
+    params.src_inc_options = DEVICE_DMA_INC_NOAUTO;
+    params.dst_dev = DEVICE_DMA_DEV_MEM;
+    params.dst_devid = 0;
+    params.dst_inc_options = DEVICE_DMA_INC_AUTO;
+    device_dma_chan_alloc(uart_info->dma_dev, &params, &uart_info->dma_rx_chan);
+
+    device_dma_op_alloc(uart_info->dma_dev, 1, 0, &uart_info->dma_tx_spare);
+    device_dma_op_alloc(uart_info->dma_dev, 1, 0, &uart_info->dma_rx_spare);
+}
+
+/**
+ * @brief Release the UART channels and the GDMAC.
+ *
+ * @param uart_info The UART driver info structure.
+ * @return None.
+ */
+static void ua_dma_close(struct tsb_uart_info *uart_info)
+{
+    if (!uart_info->dma_dev) {
+        return;
+    }
+
+    if (uart_info->dma_tx_chan) {
+        device_dma_chan_free(uart_info->dma_dev, uart_info->dma_tx_chan);
+        uart_info->dma_tx_chan = NULL;
+    }
+    if (uart_info->dma_rx_chan) {
+        device_dma_chan_free(uart_info->dma_dev, uart_info->dma_rx_chan);
+        uart_info->dma_rx_chan = NULL;
+    }
+    if (uart_info->dma_tx_spare) {
+        device_dma_op_free(uart_info->dma_dev, uart_info->dma_tx_spare);
+        uart_info->dma_tx_spare = NULL;
+    }
+    if (uart_info->dma_rx_spare) {
+        device_dma_op_free(uart_info->dma_dev, uart_info->dma_rx_spare);
+        uart_info->dma_rx_spare = NULL;
+    }
+
+#if defined(CONFIG_ARCH_SHARE_DMA)
+    tsb_dma_share_close();
+#else
+    device_close(uart_info->dma_dev);
+#endif
+    uart_info->dma_dev = NULL;
+}
+#endif
+
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+/**
+ * @brief Gate the UART clocks, keeping the controller state.
+ *
+ * The registers are retained while the clocks are gated; only the interrupt
+ * enables are saved, and masked until the clocks come back.
+ *
+ * @param uart_info The UART driver information.
+ * @return None.
+ */
+static void tsb_uart_standby_enter(struct tsb_uart_info *uart_info)
+{
+    if (uart_info->standby) {
+        return;
+    }
+
+    uart_info->ier = ua_getreg(uart_info->reg_base, UA_IER_DLH);
+    ua_putreg(uart_info->reg_base, UA_IER_DLH, 0);
+
+    tsb_clk_disable(TSB_CLK_UARTP);
+    tsb_clk_disable(TSB_CLK_UARTS);
+    uart_info->standby = true;
+}
+
+/**
+ * @brief Ungate the UART clocks and restore the interrupt enables.
+ *
+ * @param uart_info The UART driver information.
+ * @return None.
+ */
+static void tsb_uart_standby_exit(struct tsb_uart_info *uart_info)
+{
+    if (!uart_info->standby) {
+        return;
+    }
+
+    tsb_clk_enable(TSB_CLK_UARTP);
+    tsb_clk_enable(TSB_CLK_UARTS);
+
+    ua_putreg(uart_info->reg_base, UA_IER_DLH, uart_info->ier);
+    uart_info->standby = false;
+}
+
+/**
+ * @brief Leave the retained-state standby before a transfer.
+ *
+ * @param uart_info The UART driver information.
+ * @return None.
+ */
+static void tsb_uart_pm_wakeup(struct tsb_uart_info *uart_info)
+{
+    if (uart_info->standby) {
+        (void)tsb_pm_wakeup();
+    }
+}
+#else
+static void tsb_uart_pm_wakeup(struct tsb_uart_info *uart_info)
+{
+}
+#endif
+
 /**
  * @brief The UART interrupt handler.
  *
@@ -477,7 +864,7 @@ static int ua_irq_handler(int irq, void *context, void *priv)
     uint8_t interrupt_id = 0;
     uint8_t status = 0;
 
-    pm_activity(TSB_UART_ACTIVITY);
+    pm_domain_activity(TSB_UART_PM_DOMAIN, TSB_UART_ACTIVITY);
 
     while (1) {
         interrupt_id = ua_get_interrupt_id(uart_info->reg_base);
@@ -506,6 +893,12 @@ static int ua_irq_handler(int irq, void *context, void *priv)
             break;
         case UA_INTERRUPT_ID_TO:
         case UA_INTERRUPT_ID_RX:
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+            if (uart_info->dma_rx_op) {
+                ua_dma_recvchars(uart_info, interrupt_id);
+                break;
+            }
+#endif
             ua_recvchars(uart_info, interrupt_id);
             break;
         }
@@ -700,6 +1093,12 @@ static int tsb_uart_set_configuration(struct device *dev, unsigned int baud,
 
     /* Enable TX and RX FIFO */
     uart_info->fcr |= UA_FIFO_ENABLE;
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    /* Keep the DMA requests asserted until the FIFO level is serviced */
+    if (uart_info->dma_dev) {
+        uart_info->fcr |= UA_DMA_MODE;
+    }
+#endif
     ua_putreg(uart_info->reg_base, UA_FCR_IIR, uart_info->fcr);
     /* Programmable THRE interrupt mode enable */
     ua_reg_bit_set(uart_info->reg_base, UA_IER_DLH, UA_IER_PTIME);
@@ -975,6 +1374,8 @@ static int tsb_uart_start_transmitter(struct device *dev, uint8_t *buffer,
         return -EBUSY;
     }
 
+    tsb_uart_pm_wakeup(uart_info);
+
     uart_info->flags |= TSB_UART_FLAG_XMIT;
 
     uart_info->xmit.buffer = buffer;
@@ -982,8 +1383,21 @@ static int tsb_uart_start_transmitter(struct device *dev, uint8_t *buffer,
     uart_info->xmit.tail = length;
     uart_info->tx_callback = callback;
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    if (uart_info->dma_tx_chan && length >= UA_DMA_MIN_LEN) {
+        uart_info->dma_tx_op = ua_dma_start(uart_info, uart_info->dma_tx_chan,
+                                &uart_info->dma_tx_spare, (off_t)buffer,
+                                uart_info->reg_base + UA_RBR_THR_DLL, length);
+    }
+
+    if (!uart_info->dma_tx_op) {
+        /* Enable transmit interrupt */
+        ua_reg_bit_set(uart_info->reg_base, UA_IER_DLH, UA_IER_ETBEI);
+    }
+#else
     /* Enable transmit interrupt */
     ua_reg_bit_set(uart_info->reg_base, UA_IER_DLH, UA_IER_ETBEI);
+#endif
 
     if (!uart_info->tx_callback) {
         sem_wait(&uart_info->tx_sem);
@@ -1021,6 +1435,13 @@ static int tsb_uart_stop_transmitter(struct device *dev)
 
     flags = irqsave();
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    if (uart_info->dma_tx_op) {
+        uart_info->xmit.head = ua_dma_stop(uart_info, uart_info->dma_tx_chan,
+                                           &uart_info->dma_tx_op);
+    }
+#endif
+
     /* Disable transmit interrupt. */
     ua_reg_bit_clr(uart_info->reg_base, UA_IER_DLH, UA_IER_ETBEI);
     /* Clean FIFO */
@@ -1073,6 +1494,8 @@ static int tsb_uart_start_receiver(struct device *dev, uint8_t *buffer,
         return -EBUSY;
     }
 
+    tsb_uart_pm_wakeup(uart_info);
+
     uart_info->flags |= TSB_UART_FLAG_RECV;
 
     uart_info->recv.buffer = buffer;
@@ -1081,6 +1504,19 @@ static int tsb_uart_start_receiver(struct device *dev, uint8_t *buffer,
     uart_info->rx_callback = callback;
     uart_info->line_err = 0;
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    /*
+     * The receive interrupts stay enabled with DMA, the character timeout
+     * tells when the line went idle before the buffer filled up.
+     */
+    if (uart_info->dma_rx_chan && length >= UA_DMA_MIN_LEN) {
+        uart_info->dma_rx_op = ua_dma_start(uart_info, uart_info->dma_rx_chan,
+                                &uart_info->dma_rx_spare,
+                                uart_info->reg_base + UA_RBR_THR_DLL,
+                                (off_t)buffer, length);
+    }
+#endif
+
     /* Enable receive interrupt */
     ua_reg_bit_set(uart_info->reg_base, UA_IER_DLH, UA_IER_ERBFI | UA_IER_ELSI);
 
@@ -1120,6 +1556,23 @@ static int tsb_uart_stop_receiver(struct device *dev)
 
     flags = irqsave();
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    if (uart_info->dma_rx_op) {
+        uart_info->recv.head = ua_dma_stop(uart_info, uart_info->dma_rx_chan,
+                                           &uart_info->dma_rx_op);
+    }
+#endif
+
+    /*
+     * Hand what is already in the FIFO over with the buffer, a stop used to
+     * flush a partially filled buffer must not lose it.
+     */
+    while (uart_info->recv.head < uart_info->recv.tail &&
+           !ua_is_rx_fifo_empty(uart_info->reg_base)) {
+        uart_info->recv.buffer[uart_info->recv.head++] =
+                        ua_getreg(uart_info->reg_base, UA_RBR_THR_DLL);
+    }
+
     /* Disable receive interrupt. */
     ua_reg_bit_clr(uart_info->reg_base, UA_IER_DLH, UA_IER_ERBFI | UA_IER_ELSI);
     /* Clean FIFO */
@@ -1171,6 +1624,12 @@ static int tsb_uart_dev_open(struct device *dev)
 err_irqrestore:
     irqrestore(flags);
 
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    if (!ret) {
+        ua_dma_open(uart_info);
+    }
+#endif
+
     return ret;
 }
 
@@ -1206,6 +1665,10 @@ static void tsb_uart_dev_close(struct device *dev)
 
 err_irqrestore:
     irqrestore(flags);
+
+#if defined(CONFIG_ARCH_UART_USE_DMA)
+    ua_dma_close(uart_info);
+#endif
 }
 
 #ifdef CONFIG_PM
@@ -1225,10 +1688,19 @@ static void tsb_uart_pm_notify(struct pm_callback_s *cb,
     case PM_NORMAL:
         tsb_clk_enable(TSB_CLK_UARTP);
         tsb_clk_enable(TSB_CLK_UARTS);
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_uart_standby_exit(uart_info);
+#endif
         break;
     case PM_IDLE:
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_uart_standby_exit(uart_info);
+#endif
+        break;
     case PM_STANDBY:
-        /* Nothing to do in idle or standby. */
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+        tsb_uart_standby_enter(uart_info);
+#endif
         break;
     case PM_SLEEP:
         if (uart_info->flags & TSB_UART_FLAG_XMIT) {
@@ -1257,6 +1729,16 @@ static void tsb_uart_pm_notify(struct pm_callback_s *cb,
 static int tsb_uart_pm_prepare(struct pm_callback_s *cb,
                                enum pm_state_e pmstate)
 {
+#ifdef CONFIG_TSB_PM_RETAINED_STANDBY
+    struct tsb_uart_info *uart_info = device_get_private(cb->priv);
+
+    /* Don't gate the clocks in the middle of a transfer */
+    if (pmstate == PM_STANDBY &&
+        (uart_info->flags & (TSB_UART_FLAG_XMIT | TSB_UART_FLAG_RECV))) {
+        return -EBUSY;
+    }
+#endif
+
     return OK;
 }
 
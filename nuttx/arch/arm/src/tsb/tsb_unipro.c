@@ -33,6 +33,7 @@
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
 #include <nuttx/list.h>
+#include <nuttx/hires_tmr.h>
 
 #include <nuttx/unipro/unipro.h>
 #include <nuttx/greybus/tsb_unipro.h>
@@ -40,6 +41,8 @@
 #include <arch/tsb/pm.h>
 #include <arch/tsb/irq.h>
 #include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include "debug.h"
 #include "up_arch.h"
@@ -73,6 +76,14 @@
 
 static struct cport *cporttable;
 static unipro_event_handler_t evt_handler;
+static struct unipro_rx_stats rx_stats;
+
+#ifdef CONFIG_TSB_UNIPRO_RX_COALESCE
+static struct {
+    pthread_t thread;
+    sem_t sem;
+} rx_eom_worker;
+#endif
 
 #define MAX_CPORT_COUNT        CONFIG_ARCH_UNIPRO_MAX_CPORT_COUNT
 
@@ -151,6 +162,25 @@ int unipro_send_async(unsigned int cportid, const void *buf, size_t len,
         -EINVAL;
 }
 
+/**
+ * @brief Send a message made of several buffers asynchronously
+ *
+ * The buffers are sent back to back as a single UniPro message. The callback
+ * is given the first buffer. The iovec array itself does not need to remain
+ * valid once this function returns.
+ */
+int unipro_send_async_iov(unsigned int cportid, const struct unipro_iovec *iov,
+                          unsigned int iovcnt,
+                          unipro_send_completion_t callback, void *priv) {
+    if (!iov || !iovcnt || iovcnt > UNIPRO_IOV_MAX) {
+        return -EINVAL;
+    }
+
+    return (tx_calltable && tx_calltable->send_async_iov) ?
+        tx_calltable->send_async_iov(cportid, iov, iovcnt, callback, priv) :
+        -EINVAL;
+}
+
 void unipro_reset_notify(unsigned int cportid) {
     if (tx_calltable && tx_calltable->reset_notify) {
         tx_calltable->reset_notify(cportid);
@@ -259,6 +289,8 @@ static int unipro_init_cport(unsigned int cportid)
 #endif
     cport->switch_buf_on_free = false;
 
+    unipro_rxbuf_slab_fill(cport);
+
     cport->rx_buf = unipro_rxbuf_alloc(cportid);
     if (!cport->rx_buf) {
         lowsyslog("unipro: couldn't allocate initial buffer for CP%u\n",
@@ -355,22 +387,19 @@ static inline void enable_rx_interrupt(struct cport *cport) {
 }
 
 /**
- * @brief RX EOM interrupt handler
- * @param irq irq number
- * @param context register context (unused)
- * @param priv Attached private data
+ * @brief Handle the message received on a CPort
+ * @param cport cport
+ *
+ * @note This function should be called from an atomic context
  */
-static int irq_rx_eom(int irq, void *context, void *priv) {
-    struct cport *cport = irqn_to_cport(irq);
+static int unipro_rx_eom(struct cport *cport) {
     void *data = cport->rx_buf;
     uint32_t transferred_size;
-    (void)context;
     void *newbuf;
     int ret = 0;
 
-    pm_activity(TSB_UNIPRO_ACTIVITY);
-
     clear_rx_interrupt(cport);
+    rx_stats.eom_msgs++;
 
     if (!cport->driver) {
         lldbg("dropping message on cport %hu where no driver is registered\n",
@@ -386,7 +415,9 @@ static int irq_rx_eom(int irq, void *context, void *priv) {
                 data);
 
     if (cport->driver->rx_handler) {
-        newbuf = unipro_rxbuf_alloc(cport->cportid);
+        newbuf = unipro_rxbuf_next(cport->cportid, data, transferred_size);
+        if (!newbuf)
+            newbuf = unipro_rxbuf_alloc(cport->cportid);
         if (newbuf) {
             unipro_switch_rxbuf(cport->cportid, newbuf);
             unipro_unpause_rx(cport->cportid);
@@ -407,6 +438,139 @@ static int irq_rx_eom(int irq, void *context, void *priv) {
     return 0;
 }
 
+#ifdef CONFIG_TSB_UNIPRO_RX_COALESCE
+static bool rx_eom_is_pending(struct cport *cport) {
+    unsigned int cportid = cport->cportid;
+
+    return unipro_read(AHM_RX_EOM_INT_BEF_REG(cportid)) &
+           AHM_RX_EOM_INT_BEF(cportid);
+}
+
+/**
+ * @brief RX EOM bottom half
+ *
+ * Handle the messages pending on all the CPorts, then unmask the EOM
+ * interrupts masked by irq_rx_eom().
+ */
+static void *unipro_rx_eom_worker(void *data) {
+    struct cport *cport;
+    irqstate_t flags;
+    unsigned int budget;
+    unsigned int i;
+    bool found;
+
+    while (1) {
+        while (sem_wait(&rx_eom_worker.sem) < 0 && errno == EINTR);
+
+        budget = CONFIG_TSB_UNIPRO_RX_COALESCE_BUDGET;
+
+        do {
+            found = false;
+
+            for (i = 0; i < cport_count && budget; i++) {
+                cport = cport_handle(i);
+                if (!cport || !cport->driver) {
+                    continue;
+                }
+
+                flags = irqsave();
+                if (rx_eom_is_pending(cport)) {
+                    unipro_rx_eom(cport);
+                    tsb_irq_clear_pending(cportid_to_irqn(i));
+                    found = true;
+                    budget--;
+                }
+                irqrestore(flags);
+            }
+        } while (found && budget);
+
+        flags = irqsave();
+        for (i = 0; i < cport_count; i++) {
+            cport = cport_handle(i);
+            if (cport && cport->rx_eom_masked) {
+                cport->rx_eom_masked = false;
+                up_enable_irq(cportid_to_irqn(i));
+            }
+        }
+        irqrestore(flags);
+    }
+
+    return NULL;
+}
+
+static int unipro_rx_eom_worker_init(void) {
+    struct sched_param param;
+    pthread_attr_t attr;
+    int retval;
+
+    sem_init(&rx_eom_worker.sem, 0, 0);
+
+    retval = pthread_attr_init(&attr);
+    if (retval) {
+        return -retval;
+    }
+
+    param.sched_priority = CONFIG_TSB_UNIPRO_RX_COALESCE_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    retval = pthread_create(&rx_eom_worker.thread, &attr,
+                            unipro_rx_eom_worker, NULL);
+    pthread_attr_destroy(&attr);
+
+    return -retval;
+}
+#endif
+
+/**
+ * @brief RX EOM interrupt handler
+ * @param irq irq number
+ * @param context register context (unused)
+ * @param priv Attached private data
+ */
+hot_function static int irq_rx_eom(int irq, void *context, void *priv) {
+    struct cport *cport = irqn_to_cport(irq);
+#ifdef CONFIG_TSB_UNIPRO_RX_COALESCE
+    int semcount;
+#endif
+    (void)context;
+
+    pm_domain_activity(TSB_UNIPRO_PM_DOMAIN, TSB_UNIPRO_ACTIVITY);
+
+    rx_stats.eom_irqs++;
+
+#ifdef CONFIG_TSB_UNIPRO_RX_COALESCE
+    /* leave the EOM masked until the bottom half handled the message */
+    up_disable_irq(irq);
+    cport->rx_eom_masked = true;
+
+    if (!sem_getvalue(&rx_eom_worker.sem, &semcount) && semcount <= 0) {
+        sem_post(&rx_eom_worker.sem);
+    }
+
+    return 0;
+#else
+    return unipro_rx_eom(cport);
+#endif
+}
+
+void unipro_get_rx_stats(struct unipro_rx_stats *stats)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    memcpy(stats, &rx_stats, sizeof(*stats));
+    irqrestore(flags);
+}
+
+void unipro_reset_rx_stats(void)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    memset(&rx_stats, 0, sizeof(rx_stats));
+    irqrestore(flags);
+}
+
 static int tsb_unipro_mbox_ack(uint16_t val);
 
 static int mailbox_evt(void)
@@ -488,7 +652,7 @@ static int irq_unipro(int irq, void *context, void *priv) {
     int rc;
     uint32_t val;
 
-    pm_activity(TSB_UNIPRO_ACTIVITY);
+    pm_domain_activity(TSB_UNIPRO_PM_DOMAIN, TSB_UNIPRO_ACTIVITY);
 
     tsb_irq_clear_pending(TSB_IRQ_UNIPRO);
 
@@ -763,10 +927,21 @@ void unipro_init(void)
         return;
     }
 
+#ifdef CONFIG_TSB_UNIPRO_RX_COALESCE
+    retval = unipro_rx_eom_worker_init();
+    if (retval) {
+        lowsyslog("unipro: cannot start the RX EOM thread: %d\n", retval);
+        free(cporttable);
+        cporttable = NULL;
+        return;
+    }
+#endif
+
     for (i = 0; i < cport_count; i++) {
         cport = &cporttable[i];
         cport->tx_buf = CPORT_TX_BUF(i);
         cport->cportid = i;
+        cport->tx_weight = UNIPRO_TX_WEIGHT_DEFAULT;
         list_init(&cport->tx_fifo);
 
         _unipro_reset_cport(i);
@@ -902,26 +1077,38 @@ int unipro_attr_write(uint16_t attr,
     return unipro_attr_access(attr, &val, selector, peer, 1);
 }
 
+static bool unipro_cport_tx_empty(unsigned int cportid)
+{
+    uint32_t tx_queue_empty_offset;
+    unsigned tx_queue_empty_bit;
+
+    tx_queue_empty_offset = CPB_TXQUEUEEMPTY_0 + ((cportid / 32) << 2);
+    tx_queue_empty_bit = (1 << (cportid % 32));
+
+    return getreg32(AIO_UNIPRO_BASE + tx_queue_empty_offset) &
+           tx_queue_empty_bit;
+}
+
+/**
+ * @brief Reset the hardware state of a CPort
+ *
+ * Whatever is still in the CPort TX queue is discarded: the TX workers give
+ * the queue a chance to drain first, see unipro_reset_cport_complete().
+ *
+ * @param cportid CPort to reset
+ * @return 0 on success, <0 on error
+ */
 int _unipro_reset_cport(unsigned int cportid)
 {
     int rc;
     int retval = 0;
     uint32_t tx_reset_offset;
     uint32_t rx_reset_offset;
-    uint32_t tx_queue_empty_offset;
-    unsigned tx_queue_empty_bit;
 
     if (cportid >= cport_count) {
         return -EINVAL;
     }
 
-    tx_queue_empty_offset = CPB_TXQUEUEEMPTY_0 + ((cportid / 32) << 2);
-    tx_queue_empty_bit = (1 << (cportid % 32));
-
-    while (!(getreg32(AIO_UNIPRO_BASE + tx_queue_empty_offset) &
-                tx_queue_empty_bit)) {
-    }
-
     tx_reset_offset = TX_SW_RESET_00 + (cportid << 2);
     rx_reset_offset = RX_SW_RESET_00 + (cportid << 2);
 
@@ -958,6 +1145,59 @@ int _unipro_reset_cport(unsigned int cportid)
     return retval;
 }
 
+/**
+ * @brief Complete a pending CPort reset from a TX worker
+ *
+ * The TX worker calls this once it has flushed the TX fifo of the CPort.
+ * Rather than spinning until the CPort TX queue has drained, which never
+ * happens when the peer is gone, this returns -EBUSY and the worker comes
+ * back later, serving the other CPorts meanwhile. After
+ * CONFIG_TSB_UNIPRO_RESET_DRAIN_TIMEOUT microseconds, the CPort is reset
+ * regardless of the data left in its TX queue.
+ *
+ * @param cport CPort with a pending reset
+ * @return 0 when the CPort has been reset and the completion callback
+ *         called, -EBUSY while its TX queue is draining
+ */
+int unipro_reset_cport_complete(struct cport *cport)
+{
+    if (!unipro_cport_tx_empty(cport->cportid) &&
+        hrt_getusec() - cport->reset_start <
+            CONFIG_TSB_UNIPRO_RESET_DRAIN_TIMEOUT) {
+        return -EBUSY;
+    }
+
+    _unipro_reset_cport(cport->cportid);
+    cport->reset_flushed = false;
+    cport->pending_reset = false;
+    if (cport->reset_completion_cb) {
+        cport->reset_completion_cb(cport->cportid,
+                                   cport->reset_completion_cb_priv);
+    }
+    cport->reset_completion_cb = cport->reset_completion_cb_priv = NULL;
+
+    return 0;
+}
+
+/**
+ * @brief Check whether any CPort reset is still in progress
+ * @return true if a TX worker has CPort resets to complete
+ */
+bool unipro_reset_cport_pending(void)
+{
+    struct cport *cport;
+    unsigned int i;
+
+    for (i = 0; i < cport_count; i++) {
+        cport = cport_handle(i);
+        if (cport && cport->pending_reset) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 int unipro_reset_cport(unsigned int cportid, cport_reset_completion_cb_t cb,
                        void *priv)
 {
@@ -974,6 +1214,7 @@ int unipro_reset_cport(unsigned int cportid, cport_reset_completion_cb_t cb,
 
     cport->reset_completion_cb_priv = priv;
     cport->reset_completion_cb = cb;
+    cport->reset_start = hrt_getusec();
     cport->pending_reset = true;
 
     unipro_reset_notify(cportid);
@@ -981,6 +1222,142 @@ int unipro_reset_cport(unsigned int cportid, cport_reset_completion_cb_t cb,
     return 0;
 }
 
+/**
+ * @brief Set the TX priority of a CPort
+ *
+ * The TX workers service the pending buffers of the CPorts with the highest
+ * priority first.
+ *
+ * @param cportid CPort to configure
+ * @param priority priority, from 0 (lowest) to UNIPRO_TX_PRIORITY_MAX
+ * @return 0 on success, <0 on error
+ */
+int unipro_set_tx_priority(unsigned int cportid, unsigned int priority)
+{
+    struct cport *cport;
+
+    cport = cport_handle(cportid);
+    if (!cport)
+        return -EINVAL;
+
+    if (priority > UNIPRO_TX_PRIORITY_MAX)
+        return -EINVAL;
+
+    cport->tx_priority = priority;
+
+    return 0;
+}
+
+/**
+ * @brief Set the share of the TX bandwidth of a CPort
+ *
+ * CPorts of the same TX priority share the DMA channels in proportion to
+ * their weight.
+ */
+int unipro_set_tx_weight(unsigned int cportid, unsigned int weight)
+{
+    struct cport *cport;
+
+    cport = cport_handle(cportid);
+    if (!cport)
+        return -EINVAL;
+
+    if (!weight || weight > UNIPRO_TX_WEIGHT_MAX)
+        return -EINVAL;
+
+    cport->tx_weight = weight;
+
+    return 0;
+}
+
+/**
+ * @brief Account for a message queued for transmission
+ * @param cport cport the message is queued on
+ * @param len size of the message
+ *
+ * @note This function should be called with the interrupts disabled
+ */
+void unipro_tx_queued_add(struct cport *cport, size_t len)
+{
+    cport->tx_queued += len;
+}
+
+/**
+ * @brief Account for a message that left the TX queue of a CPort
+ *
+ * Call the TX space callback of the CPort if this makes the number of queued
+ * bytes drop to its threshold.
+ *
+ * @param cport cport the message was queued on
+ * @param len size of the message
+ */
+void unipro_tx_queued_sub(struct cport *cport, size_t len)
+{
+    unipro_tx_space_cb_t callback = NULL;
+    irqstate_t flags;
+    size_t queued;
+
+    flags = irqsave();
+    queued = cport->tx_queued;
+    cport->tx_queued = queued > len ? queued - len : 0;
+    if (queued > cport->tx_space_threshold &&
+        cport->tx_queued <= cport->tx_space_threshold) {
+        callback = cport->tx_space_cb;
+    }
+    irqrestore(flags);
+
+    if (callback) {
+        callback(cport->cportid, cport->tx_space_priv);
+    }
+}
+
+/**
+ * @brief Get the number of bytes waiting to be sent on a CPort
+ * @param cportid cport id
+ * @return the number of queued bytes, <0 on error
+ */
+ssize_t unipro_get_tx_queued_bytes(unsigned int cportid)
+{
+    struct cport *cport;
+
+    cport = cport_handle(cportid);
+    if (!cport)
+        return -EINVAL;
+
+    return cport->tx_queued;
+}
+
+/**
+ * @brief Register a callback notifying that TX queue space is available
+ *
+ * The callback is called, from the TX path, each time the number of bytes
+ * queued on the CPort drops from above the threshold to the threshold or
+ * below it.
+ *
+ * @param cportid cport id
+ * @param threshold number of queued bytes
+ * @param callback function to call, NULL to unregister the callback
+ * @param priv argument passed to the callback
+ */
+int unipro_set_tx_space_cb(unsigned int cportid, size_t threshold,
+                           unipro_tx_space_cb_t callback, void *priv)
+{
+    struct cport *cport;
+    irqstate_t flags;
+
+    cport = cport_handle(cportid);
+    if (!cport)
+        return -EINVAL;
+
+    flags = irqsave();
+    cport->tx_space_threshold = threshold;
+    cport->tx_space_cb = callback;
+    cport->tx_space_priv = priv;
+    irqrestore(flags);
+
+    return 0;
+}
+
 /**
  * @brief Register a driver with the unipro core
  * @param drv unipro driver to register
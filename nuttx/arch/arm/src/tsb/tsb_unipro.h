@@ -53,6 +53,8 @@ struct cport {
     unsigned int cportid;
 
     volatile bool pending_reset;
+    bool reset_flushed;             // TX fifo flushed, TX queue draining
+    uint32_t reset_start;           // hrt_getusec() at the reset request
     cport_reset_completion_cb_t reset_completion_cb;
     void *reset_completion_cb_priv;
 
@@ -60,7 +62,22 @@ struct cport {
     size_t max_inflight_buf_count;
     bool switch_buf_on_free;
 
+    void *rxbuf_slab;               // free RX buffers, linked through
+                                    // their first word
+    unsigned int rxbuf_slab_count;
+    unsigned int rxbuf_slab_size;
+
+    bool rx_eom_masked;
+
+    unsigned int tx_priority;
+    unsigned int tx_weight;
+    size_t tx_deficit;
     struct list_head tx_fifo;
+
+    size_t tx_queued;               // bytes queued and not yet sent
+    size_t tx_space_threshold;
+    unipro_tx_space_cb_t tx_space_cb;
+    void *tx_space_priv;
 };
 
 struct unipro_tx_calltable {
@@ -68,6 +85,9 @@ struct unipro_tx_calltable {
     int  (*send)(unsigned int cportid, const void *buf, size_t len);
     int  (*send_async)(unsigned int cportid, const void *buf, size_t len,
                        unipro_send_completion_t callback, void *priv);
+    int  (*send_async_iov)(unsigned int cportid,
+                           const struct unipro_iovec *iov, unsigned int iovcnt,
+                           unipro_send_completion_t callback, void *priv);
 };
 
 struct cport *cport_handle(unsigned int cportid);
@@ -75,10 +95,16 @@ uint16_t unipro_get_tx_free_buffer_space(struct cport *cport);
 int unipro_tx_init_memcpy(struct unipro_tx_calltable **table);
 int unipro_tx_init_dma(struct unipro_tx_calltable **table);
 int _unipro_reset_cport(unsigned int cportid);
+int unipro_reset_cport_complete(struct cport *cport);
+bool unipro_reset_cport_pending(void);
 void unipro_reset_notify(unsigned int cportid);
 void unipro_switch_rxbuf(unsigned int cportid, void *buffer);
+void unipro_rxbuf_slab_fill(struct cport *cport);
+void *unipro_rxbuf_next(unsigned int cportid, void *data, size_t size);
 int unipro_unpause_rx(unsigned int cportid);
 bool cport_is_connected(unsigned int cportid);
+void unipro_tx_queued_add(struct cport *cport, size_t len);
+void unipro_tx_queued_sub(struct cport *cport, size_t len);
 
 #endif /* __TSB_UNIPRO_H__ */
 
@@ -37,6 +37,168 @@
 #include <nuttx/unipro/unipro.h>
 #include <nuttx/arch.h>
 
+#ifdef CONFIG_TSB_UNIPRO_RX_PACK
+/*
+ * A packed RX buffer starts with a reference count, and each message in it
+ * is preceded by a header pointing back to the start of the buffer. The
+ * hardware always gets a slot with room for a CPORT_BUF_SIZE message, and
+ * each message received or slot given to the hardware holds a reference.
+ */
+#define RXBUF_SIZE       CONFIG_TSB_UNIPRO_RX_PACK_SIZE
+#define RXBUF_ALIGN(x)   (((uintptr_t) (x) + 7) & ~7)
+
+struct rxbuf_pack {
+    atomic_t refcount;
+    uint32_t pad;
+};
+
+struct rxbuf_slot {
+    struct rxbuf_pack *pack;
+    uint32_t pad;
+};
+#else
+#define RXBUF_SIZE       CPORT_BUF_SIZE
+#endif
+
+#define RXBUF_PAGE_COUNT bufram_size_to_page_count(RXBUF_SIZE)
+
+static inline void *rxbuf_page_alloc(void)
+{
+    return bufram_page_alloc_owner(RXBUF_PAGE_COUNT, BUFRAM_OWNER_CPORT);
+}
+
+static inline void rxbuf_page_free(void *buf)
+{
+    bufram_page_free_owner(buf, RXBUF_PAGE_COUNT, BUFRAM_OWNER_CPORT);
+}
+
+static void *rxbuf_slab_get(struct cport *cport)
+{
+    void **buf;
+    irqstate_t flags;
+
+    flags = irqsave();
+    buf = cport->rxbuf_slab;
+    if (buf) {
+        cport->rxbuf_slab = *buf;
+        cport->rxbuf_slab_count--;
+    }
+    irqrestore(flags);
+
+    return buf;
+}
+
+static bool rxbuf_slab_put(struct cport *cport, void *ptr)
+{
+    void **buf = ptr;
+    irqstate_t flags;
+
+    flags = irqsave();
+    if (cport->rxbuf_slab_count >= cport->rxbuf_slab_size) {
+        irqrestore(flags);
+        return false;
+    }
+
+    *buf = cport->rxbuf_slab;
+    cport->rxbuf_slab = buf;
+    cport->rxbuf_slab_count++;
+    irqrestore(flags);
+
+    return true;
+}
+
+#ifdef CONFIG_TSB_UNIPRO_RX_PACK
+static void *rxbuf_pack_slot(struct rxbuf_pack *pack, uintptr_t addr)
+{
+    struct rxbuf_slot *slot = (struct rxbuf_slot *) addr;
+
+    slot->pack = pack;
+    return slot + 1;
+}
+
+static void *rxbuf_pack_init(void *buf)
+{
+    struct rxbuf_pack *pack = buf;
+
+    atomic_init(&pack->refcount, 1);
+    return rxbuf_pack_slot(pack, (uintptr_t) (pack + 1));
+}
+
+static struct rxbuf_pack *rxbuf_pack_of(void *ptr)
+{
+    return ((struct rxbuf_slot *) ptr - 1)->pack;
+}
+
+/**
+ * @brief Get the next RX slot of a packed buffer
+ *
+ * @param cportid CPort that received the message
+ * @param data message just received by the CPort
+ * @param size size of the message
+ * @return the slot following the message, referenced for the hardware, or
+ *         NULL if a CPORT_BUF_SIZE message would not fit in the buffer.
+ */
+void *unipro_rxbuf_next(unsigned int cportid, void *data, size_t size)
+{
+    struct rxbuf_pack *pack = rxbuf_pack_of(data);
+    uintptr_t next = RXBUF_ALIGN((uintptr_t) data + size);
+
+    if (next + sizeof(struct rxbuf_slot) + CPORT_BUF_SIZE >
+        (uintptr_t) pack + RXBUF_SIZE)
+        return NULL;
+
+    atomic_inc(&pack->refcount);
+    return rxbuf_pack_slot(pack, next);
+}
+#else
+void *unipro_rxbuf_next(unsigned int cportid, void *data, size_t size)
+{
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Resize the RX buffer slab of a CPort and preallocate its buffers
+ *
+ * The slab holds at most CONFIG_TSB_UNIPRO_RXBUF_SLAB_SIZE buffers, and never
+ * more than the maximum number of inflight buffers of the CPort. Buffers in
+ * excess are given back to bufram.
+ *
+ * @param cport CPort whose slab needs to be refilled
+ */
+void unipro_rxbuf_slab_fill(struct cport *cport)
+{
+    unsigned int size = CONFIG_TSB_UNIPRO_RXBUF_SLAB_SIZE;
+    void *buf;
+
+    if (cport->max_inflight_buf_count != INFINITE_MAX_INFLIGHT_BUFCOUNT &&
+        cport->max_inflight_buf_count < size) {
+        size = cport->max_inflight_buf_count;
+    }
+
+    cport->rxbuf_slab_size = size;
+
+    while (cport->rxbuf_slab_count > size) {
+        buf = rxbuf_slab_get(cport);
+        if (buf)
+            rxbuf_page_free(buf);
+    }
+
+    while (cport->rxbuf_slab_count < size) {
+        buf = rxbuf_page_alloc();
+        if (!buf) {
+            DBG_UNIPRO("Couldn't fill rx buf slab for CP%u\n",
+                       cport->cportid);
+            break;
+        }
+
+        if (!rxbuf_slab_put(cport, buf)) {
+            rxbuf_page_free(buf);
+            break;
+        }
+    }
+}
+
 int unipro_set_max_inflight_rxbuf_count(unsigned int cportid,
                                         size_t max_inflight_buf)
 {
@@ -45,9 +207,35 @@ int unipro_set_max_inflight_rxbuf_count(unsigned int cportid,
         return -EINVAL;
 
     cport->max_inflight_buf_count = max_inflight_buf;
+    unipro_rxbuf_slab_fill(cport);
     return 0;
 }
 
+/**
+ * @brief Check if a CPort ran out of RX buffers
+ *
+ * @param cportid CPort to check
+ * @return true if no RX buffer can be allocated for this CPort without
+ *         exceeding its maximum inflight buffer count, or if the CPort RX is
+ *         paused waiting for a buffer to be released.
+ */
+bool unipro_rxbuf_is_exhausted(unsigned int cportid)
+{
+    struct cport *cport = cport_handle(cportid);
+
+    if (!cport)
+        return true;
+
+    if (cport->switch_buf_on_free)
+        return true;
+
+    if (cport->max_inflight_buf_count == INFINITE_MAX_INFLIGHT_BUFCOUNT)
+        return false;
+
+    return atomic_get(&cport->inflight_buf_count) >=
+           cport->max_inflight_buf_count;
+}
+
 void *unipro_rxbuf_alloc(unsigned int cportid)
 {
     struct cport *cport = cport_handle(cportid);
@@ -65,13 +253,18 @@ void *unipro_rxbuf_alloc(unsigned int cportid)
         return NULL;
     }
 
-    buf = bufram_page_alloc(bufram_size_to_page_count(CPORT_BUF_SIZE));
+    buf = rxbuf_slab_get(cport);
+    if (!buf)
+        buf = rxbuf_page_alloc();
     if (!buf) {
         DBG_UNIPRO("Couldn't allocate rx buf for CP%u: no bufram\n", cportid);
         return NULL;
     }
 
     atomic_inc(&cport->inflight_buf_count);
+#ifdef CONFIG_TSB_UNIPRO_RX_PACK
+    buf = rxbuf_pack_init(buf);
+#endif
     return buf;
 }
 
@@ -84,12 +277,22 @@ void unipro_rxbuf_free(unsigned int cportid, void *ptr)
     if (!cport || !ptr)
         return;
 
+#ifdef CONFIG_TSB_UNIPRO_RX_PACK
+    /* The buffer is released with its last message */
+    ptr = rxbuf_pack_of(ptr);
+    if (atomic_dec(&((struct rxbuf_pack *) ptr)->refcount))
+        return;
+#endif
+
     flags = irqsave();
 
     if (cport->switch_buf_on_free) {
         cport->switch_buf_on_free = false;
         irqrestore(flags);
 
+#ifdef CONFIG_TSB_UNIPRO_RX_PACK
+        ptr = rxbuf_pack_init(ptr);
+#endif
         unipro_switch_rxbuf(cportid, ptr);
         unipro_unpause_rx(cportid);
         return;
@@ -98,5 +301,6 @@ void unipro_rxbuf_free(unsigned int cportid, void *ptr)
     irqrestore(flags);
 
     atomic_dec(&cport->inflight_buf_count);
-    bufram_page_free(ptr, bufram_size_to_page_count(CPORT_BUF_SIZE));
+    if (!rxbuf_slab_put(cport, ptr))
+        rxbuf_page_free(ptr);
 }
@@ -55,6 +55,8 @@ struct unipro_buffer {
     int byte_sent;
     int len;
     const void *data;
+    struct unipro_iovec iov[UNIPRO_IOV_MAX];
+    unsigned int iovcnt;
 };
 
 static int unipro_send_sync(unsigned int cportid,
@@ -69,7 +71,8 @@ static inline void unipro_set_eom_flag(struct cport *cport)
     putreg8(1, CPORT_EOM_BIT(cport));
 }
 
-static void unipro_dequeue_tx_buffer(struct unipro_buffer *buffer, int status)
+static void unipro_dequeue_tx_buffer(struct cport *cport,
+                                     struct unipro_buffer *buffer, int status)
 {
     irqstate_t flags;
 
@@ -79,6 +82,8 @@ static void unipro_dequeue_tx_buffer(struct unipro_buffer *buffer, int status)
     list_del(&buffer->list);
     irqrestore(flags);
 
+    unipro_tx_queued_sub(cport, buffer->len);
+
     if (buffer->callback) {
         buffer->callback(status, buffer->data, buffer->priv);
     }
@@ -86,11 +91,18 @@ static void unipro_dequeue_tx_buffer(struct unipro_buffer *buffer, int status)
     free(buffer);
 }
 
-static void unipro_flush_cport(struct cport *cport)
+/**
+ * @brief           Flush the TX fifo of a CPort being reset
+ * @return          0 once the CPort is reset, -EBUSY while its TX queue is
+ *                  still draining (unipro_flush_cport() shall be called
+ *                  again).
+ * @param[in]       cport: CPort handle
+ */
+static int unipro_flush_cport(struct cport *cport)
 {
     struct unipro_buffer *buffer;
 
-    if (list_is_empty(&cport->tx_fifo)) {
+    if (cport->reset_flushed || list_is_empty(&cport->tx_fifo)) {
         goto reset;
     }
 
@@ -102,17 +114,12 @@ static void unipro_flush_cport(struct cport *cport)
 
     while (!list_is_empty(&cport->tx_fifo)) {
         buffer = list_entry(cport->tx_fifo.next, struct unipro_buffer, list);
-        unipro_dequeue_tx_buffer(buffer, -ECONNRESET);
+        unipro_dequeue_tx_buffer(cport, buffer, -ECONNRESET);
     }
 
 reset:
-    _unipro_reset_cport(cport->cportid);
-    cport->pending_reset = false;
-    if (cport->reset_completion_cb) {
-        cport->reset_completion_cb(cport->cportid,
-                                   cport->reset_completion_cb_priv);
-    }
-    cport->reset_completion_cb = cport->reset_completion_cb_priv = NULL;
+    cport->reset_flushed = true;
+    return unipro_reset_cport_complete(cport);
 }
 
 
@@ -121,25 +128,29 @@ reset:
  * @return          0 on success, -EINVAL on invalid parameter,
  *                  -EBUSY when buffer could not be completely transferred
  *                  (unipro_send_tx_buffer() shall be called again until
- *                  buffer is entirely sent (return value == 0)).
+ *                  buffer is entirely sent (return value == 0)), or
+ *                  while a reset of the CPort is in progress.
  * @param[in]       operation: greybus loopback operation
  */
 static int unipro_send_tx_buffer(struct cport *cport)
 {
     irqstate_t flags;
     struct unipro_buffer *buffer;
+    size_t offset;
     int retval;
+    int i;
 
     if (!cport) {
         return -EINVAL;
     }
 
+    if (cport->pending_reset) {
+        return unipro_flush_cport(cport);
+    }
+
     flags = irqsave();
 
     if (list_is_empty(&cport->tx_fifo)) {
-        if (cport->pending_reset) {
-            unipro_flush_cport(cport);
-        }
         irqrestore(flags);
         return 0;
     }
@@ -148,28 +159,39 @@ static int unipro_send_tx_buffer(struct cport *cport)
 
     irqrestore(flags);
 
-    if (cport->pending_reset) {
-        unipro_flush_cport(cport);
-    }
+    /* Fill the CPort TX FIFO with the buffers, one after the other */
+    for (i = 0, offset = 0; i < buffer->iovcnt; offset += buffer->iov[i++].len) {
+        const struct unipro_iovec *iov = &buffer->iov[i];
+        size_t iov_sent;
 
-    retval = unipro_send_sync(cport->cportid,
-                              buffer->data + buffer->byte_sent,
-                              buffer->len - buffer->byte_sent, buffer->som);
-    if (retval < 0) {
-        unipro_dequeue_tx_buffer(buffer, retval);
-        lldbg("unipro_send_sync failed. Dropping message...\n");
-        return -EINVAL;
-    }
+        if (buffer->byte_sent >= offset + iov->len) {
+            continue;
+        }
+
+        iov_sent = buffer->byte_sent - offset;
+        retval = unipro_send_sync(cport->cportid,
+                                  (const char *) iov->base + iov_sent,
+                                  iov->len - iov_sent, buffer->som);
+        if (retval < 0) {
+            unipro_dequeue_tx_buffer(cport, buffer, retval);
+            lldbg("unipro_send_sync failed. Dropping message...\n");
+            return -EINVAL;
+        }
 
-    /* Only update state if the CPort TX FIFO was able to accept any data */
-    if (retval > 0) {
-        buffer->som = false;
-        buffer->byte_sent += retval;
+        /* Only update state if the CPort TX FIFO was able to accept any data */
+        if (retval > 0) {
+            buffer->som = false;
+            buffer->byte_sent += retval;
+        }
+
+        if (retval < iov->len - iov_sent) {
+            break;
+        }
     }
 
     if (buffer->byte_sent >= buffer->len) {
         unipro_set_eom_flag(cport);
-        unipro_dequeue_tx_buffer(buffer, 0);
+        unipro_dequeue_tx_buffer(cport, buffer, 0);
         return 0;
     }
 
@@ -182,11 +204,13 @@ static int unipro_send_tx_buffer(struct cport *cport)
  *                  all CPorts have no work available.
  *                  Then suspend again until new data is available.
  */
-static void *unipro_tx_worker(void *data)
+hot_function static void *unipro_tx_worker(void *data)
 {
     int i;
+    int prio;
     bool is_busy;
     int retval;
+    struct cport *cport;
     unsigned int cport_count = unipro_cport_count();
 
     while (1) {
@@ -196,15 +220,23 @@ static void *unipro_tx_worker(void *data)
         do {
             is_busy = false;
 
-            for (i = 0; i < cport_count; i++) {
-                /* Browse all CPorts sending any pending buffers */
-                retval = unipro_send_tx_buffer(cport_handle(i));
-                if (retval == -EBUSY) {
-                    /*
-                     * Buffer only partially sent, have to try again for
-                     * remaining part.
-                     */
-                    is_busy = true;
+            /* Browse all CPorts, highest priority first */
+            for (prio = UNIPRO_TX_PRIORITY_MAX; prio >= 0; prio--) {
+                for (i = 0; i < cport_count; i++) {
+                    cport = cport_handle(i);
+                    if (!cport || cport->tx_priority != prio) {
+                        continue;
+                    }
+
+                    /* Send any pending buffers */
+                    retval = unipro_send_tx_buffer(cport);
+                    if (retval == -EBUSY) {
+                        /*
+                         * Buffer only partially sent, have to try again for
+                         * remaining part.
+                         */
+                        is_busy = true;
+                    }
                 }
             }
         } while (is_busy); /* exit when CPort(s) current pending buffer sent */
@@ -223,20 +255,29 @@ static void unipro_reset_notify_memcpy(unsigned int cportid)
 }
 
 /**
- * @brief           send data over UniPro asynchronously (not blocking)
+ * @brief           send buffers over UniPro asynchronously, as one message
  * @return          0 on success, <0 otherwise
  * @param[in]       cportid: target CPort ID
- * @param[in]       buf: data buffer
- * @param[in]       len: data buffer length (in bytes)
+ * @param[in]       iov: data buffers
+ * @param[in]       iovcnt: number of data buffers
  * @param[in]       callback: function called upon Tx completion
  * @param[in]       priv: optional argument passed to callback
  */
-static int unipro_send_async_memcpy(unsigned int cportid, const void *buf, size_t len,
-                                    unipro_send_completion_t callback, void *priv)
+static int unipro_send_async_iov_memcpy(unsigned int cportid,
+                                        const struct unipro_iovec *iov,
+                                        unsigned int iovcnt,
+                                        unipro_send_completion_t callback,
+                                        void *priv)
 {
     struct cport *cport;
     struct unipro_buffer *buffer;
     irqstate_t flags;
+    size_t len = 0;
+    int i;
+
+    for (i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
 
     if (len > CPORT_BUF_SIZE) {
         return -EINVAL;
@@ -267,16 +308,39 @@ static int unipro_send_async_memcpy(unsigned int cportid, const void *buf, size_
     buffer->len = len;
     buffer->callback = callback;
     buffer->priv = priv;
-    buffer->data = buf;
+    buffer->data = iov[0].base;
+    memcpy(buffer->iov, iov, iovcnt * sizeof(*iov));
+    buffer->iovcnt = iovcnt;
 
     flags = irqsave();
     list_add(&cport->tx_fifo, &buffer->list);
+    unipro_tx_queued_add(cport, len);
     irqrestore(flags);
 
     sem_post(&worker.tx_fifo_lock);
     return 0;
 }
 
+/**
+ * @brief           send data over UniPro asynchronously (not blocking)
+ * @return          0 on success, <0 otherwise
+ * @param[in]       cportid: target CPort ID
+ * @param[in]       buf: data buffer
+ * @param[in]       len: data buffer length (in bytes)
+ * @param[in]       callback: function called upon Tx completion
+ * @param[in]       priv: optional argument passed to callback
+ */
+static int unipro_send_async_memcpy(unsigned int cportid, const void *buf, size_t len,
+                                    unipro_send_completion_t callback, void *priv)
+{
+    struct unipro_iovec iov = {
+        .base = buf,
+        .len = len,
+    };
+
+    return unipro_send_async_iov_memcpy(cportid, &iov, 1, callback, priv);
+}
+
 struct unipro_send_data {
     sem_t sem;
     int status;
@@ -379,7 +443,8 @@ static int unipro_send_sync(unsigned int cportid,
 static struct unipro_tx_calltable calltable = {
     unipro_reset_notify_memcpy,
     unipro_send_memcpy,
-    unipro_send_async_memcpy
+    unipro_send_async_memcpy,
+    unipro_send_async_iov_memcpy,
 };
 
 int unipro_tx_init_memcpy(struct unipro_tx_calltable **table)
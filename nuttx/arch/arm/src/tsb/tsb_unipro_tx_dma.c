@@ -31,15 +31,19 @@
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
+#include <time.h>
 
 #include <nuttx/util.h>
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
+#include <nuttx/clock.h>
 #include <nuttx/list.h>
 #include <nuttx/unipro/unipro.h>
 #include <nuttx/device_dma.h>
 #include "nuttx/device_atabl.h"
 
+#include <nuttx/hires_tmr.h>
+
 #include "debug.h"
 #include "up_arch.h"
 #include "tsb_scm.h"
@@ -56,6 +60,15 @@
 
 #define UNIPRO_DMA_CHANNEL_COUNT CONFIG_ARCH_UNIPROTX_DMA_NUM_CHANNELS
 
+/* Bytes a CPort of weight 1 may send per deficit round robin round */
+#define UNIPRO_TX_QUANTUM       256
+
+#define UNIPRO_DMA_CALLBACK_EVENTS  (DEVICE_DMA_CALLBACK_EVENT_COMPLETE | \
+                                     DEVICE_DMA_CALLBACK_EVENT_START | \
+                                     DEVICE_DMA_CALLBACK_EVENT_ERROR | \
+                                     DEVICE_DMA_CALLBACK_EVENT_RECOVERED | \
+                                     DEVICE_DMA_CALLBACK_EVENT_DEQUEUED)
+
 /*
  * With ES3 or later chip, Toshiba implemented ATABL as HW flow control for
  * Unipro TX FIFO. The following strucure is used to store the info associated
@@ -70,6 +83,10 @@ struct dma_channel {
     void *req;
     unsigned int cportid;
     uint32_t saved_tx_water_mark;
+
+    volatile bool busy;
+    uint32_t start_usec;
+    struct unipro_tx_dma_stats stats;
 };
 
 struct unipro_xfer_descriptor {
@@ -77,6 +94,9 @@ struct unipro_xfer_descriptor {
     const void *data;
     size_t len;
 
+    struct unipro_iovec iov[UNIPRO_IOV_MAX];
+    unsigned int iovcnt;
+
     void *priv;
     unipro_send_completion_t callback;
 
@@ -115,32 +135,71 @@ static void unipro_write(uint32_t offset, uint32_t v) {
     putreg32(v, (volatile unsigned int*)(AIO_UNIPRO_BASE + offset));
 }
 
+/* Largest message sent with a CPU copy instead of a DMA transfer */
+static size_t memcpy_threshold = CONFIG_ARCH_UNIPROTX_DMA_MEMCPY_THRESHOLD;
+
+/* Deficit round robin position, and whether that CPort got its quantum */
+static unsigned int drr_next_cport;
+static bool drr_credited;
+
+/*
+ * Pick an idle DMA channel for a CPort, or NULL if none is available.
+ *
+ * GDMAC channel 0 is reserved for CPort 0 to avoid control data operations
+ * on CPort 0 be blocked by other CPort operations. The other CPorts share all
+ * the remaining channels, and a channel still connected to the CPort is
+ * preferred to save an ATABL reconnection.
+ */
 static struct dma_channel *pick_dma_channel(struct cport *cport)
 {
     struct dma_channel *chan;
-    uint32_t chan_index;
+    struct dma_channel *best = NULL;
+    int i;
 
-    /*
-     * Reserve GDMAC channel 0 for CPort 0 to avoid control data operations on
-     * CPort 0 be blocked by other CPort operations.
-     */
-    chan_index = (cport->cportid == 0) ?
-            0 : (((cport->cportid - 1) % (unipro_dma.max_channel - 1)) + 1);
+    if (cport->cportid == 0 || unipro_dma.max_channel == 1) {
+        chan = &unipro_dma.dma_channels[0];
+        return chan->busy ? NULL : chan;
+    }
 
-    DEBUGASSERT(chan_index < unipro_dma.max_channel);
+    for (i = 1; i < unipro_dma.max_channel; i++) {
+        chan = &unipro_dma.dma_channels[i];
+        if (chan->busy)
+            continue;
+
+        if (chan->cportid == cport->cportid)
+            return chan;
 
-    chan = &unipro_dma.dma_channels[chan_index];
+        if (!best)
+            best = chan;
+    }
 
-    return chan;
+    return best;
 }
 
-static void unipro_flush_cport(struct cport *cport)
+static void unipro_dma_channel_release(struct dma_channel *chan, bool done,
+                                       size_t len)
+{
+    if (done) {
+        chan->stats.xfers++;
+        chan->stats.bytes += len;
+    }
+    chan->stats.busy_usec += hrt_getusec() - chan->start_usec;
+    chan->busy = false;
+}
+
+/*
+ * Flush the TX fifo of a CPort being reset. The descriptors in flight are
+ * dequeued from their DMA channel, and the reset completes once their
+ * DEQUEUED events have removed them from the fifo and the CPort TX queue
+ * has drained. Returns -EBUSY until then.
+ */
+static int unipro_flush_cport(struct cport *cport)
 {
     struct unipro_xfer_descriptor *desc;
     struct list_head *iterator = NULL, *next = NULL;
     irqstate_t flags;
 
-    if (list_is_empty(&cport->tx_fifo)) {
+    if (cport->reset_flushed || list_is_empty(&cport->tx_fifo)) {
         goto reset;
     }
 
@@ -156,6 +215,7 @@ static void unipro_flush_cport(struct cport *cport)
                 desc->callback(-ECONNRESET, desc->data, desc->priv);
             }
 
+           unipro_tx_queued_sub(cport, desc->len);
            free(desc);
            flags = irqsave();
         } else {
@@ -172,50 +232,90 @@ static void unipro_flush_cport(struct cport *cport)
     irqrestore(flags);
 
 reset:
-    _unipro_reset_cport(cport->cportid);
-    cport->pending_reset = false;
-    if (cport->reset_completion_cb) {
-        cport->reset_completion_cb(cport->cportid,
-                                   cport->reset_completion_cb_priv);
+    cport->reset_flushed = true;
+    if (!list_is_empty(&cport->tx_fifo)) {
+        return -EBUSY;
     }
-    cport->reset_completion_cb = cport->reset_completion_cb_priv = NULL;
+
+    return unipro_reset_cport_complete(cport);
 }
 
-static struct unipro_xfer_descriptor *pick_tx_descriptor(unsigned int cportid)
+/*
+ * Get the descriptor a CPort could transfer now: the head of its TX fifo,
+ * provided that it is not in flight already and that a DMA channel is
+ * available for it.
+ */
+static struct unipro_xfer_descriptor *cport_tx_descriptor(struct cport *cport)
 {
     struct unipro_xfer_descriptor *desc;
-    unsigned int cport_count = unipro_cport_count();
-    int i;
 
-    for (i = 0; i < cport_count; i++, cportid++) {
-        struct cport *cport;
+    if (cport->pending_reset && unipro_flush_cport(cport)) {
+        return NULL;
+    }
 
-        cportid = cportid % cport_count;
-        cport = cport_handle(cportid);
-        if (!cport)
-            continue;
+    if (list_is_empty(&cport->tx_fifo)) {
+        /* an idle CPort does not accumulate credit */
+        cport->tx_deficit = 0;
+        return NULL;
+    }
 
-        if (list_is_empty(&cport->tx_fifo)) {
-            if (cport->pending_reset) {
-                unipro_flush_cport(cport);
-            }
+    desc = containerof(cport->tx_fifo.next, struct unipro_xfer_descriptor,
+            list);
+    if (desc->channel || !pick_dma_channel(cport))
+        return NULL;
 
-            continue;
-        }
+    return desc;
+}
 
-        if (cport->pending_reset) {
-            unipro_flush_cport(cport);
-        }
+/*
+ * Pick the next descriptor to transfer. Only the CPorts of the highest TX
+ * priority with a descriptor ready are considered, and they share the DMA
+ * channels with a deficit round robin: every round, a CPort is credited
+ * UNIPRO_TX_QUANTUM bytes per unit of weight and sends its descriptors as
+ * long as its credit covers them.
+ */
+static struct unipro_xfer_descriptor *pick_tx_descriptor(void)
+{
+    struct unipro_xfer_descriptor *desc;
+    unsigned int cport_count = unipro_cport_count();
+    struct cport *cport;
+    int priority = -1;
+    int i;
 
-        desc = containerof(cport->tx_fifo.next, struct unipro_xfer_descriptor,
-                list);
-        if (desc->channel)
+    for (i = 0; i < cport_count; i++) {
+        cport = cport_handle(i);
+        if (!cport || !cport_tx_descriptor(cport))
             continue;
 
-        return desc;
+        if ((int) cport->tx_priority > priority)
+            priority = cport->tx_priority;
     }
 
-    return NULL;
+    if (priority < 0)
+        return NULL;
+
+    /* every round credits all the candidates, so this terminates */
+    while (1) {
+        cport = cport_handle(drr_next_cport);
+        desc = cport && cport->tx_priority == priority ?
+               cport_tx_descriptor(cport) : NULL;
+
+        if (desc) {
+            if (!drr_credited) {
+                cport->tx_deficit += UNIPRO_TX_QUANTUM * cport->tx_weight;
+                drr_credited = true;
+            }
+
+            /* keep serving this CPort while its credit lasts */
+            if (desc->len <= cport->tx_deficit) {
+                cport->tx_deficit -= desc->len;
+                return desc;
+            }
+        }
+
+        drr_next_cport = (drr_next_cport + 1) % cport_count;
+        drr_credited = false;
+    }
 }
 
 static inline void unipro_dma_tx_set_eom_flag(struct cport *cport)
@@ -231,6 +331,8 @@ static void unipro_xfer_dequeue_descriptor(struct unipro_xfer_descriptor *desc)
     list_del(&desc->list);
     irqrestore(flags);
 
+    unipro_tx_queued_sub(desc->cport, desc->len);
+
     free(desc);
 }
 
@@ -293,6 +395,7 @@ static int unipro_dma_tx_callback(struct device *dev, void *chan,
 
             device_atabl_transfer_completed(unipro_dma.atabl_dev,
                                             desc_chan->req);
+            unipro_dma_channel_release(desc_chan, true, desc->len);
 
             unipro_xfer_dequeue_descriptor(desc);
 
@@ -301,6 +404,7 @@ static int unipro_dma_tx_callback(struct device *dev, void *chan,
                 goto event_complete_finally;
             }
         } else {
+            unipro_dma_channel_release(desc->channel, false, 0);
             desc->channel = NULL;
             retval = device_dma_op_free(unipro_dma.dev, op);
             if (retval != OK) {
@@ -364,6 +468,7 @@ static int unipro_dma_tx_callback(struct device *dev, void *chan,
     }
 
     if (event & DEVICE_DMA_CALLBACK_EVENT_DEQUEUED) {
+        unipro_dma_channel_release(desc->channel, false, 0);
         device_dma_op_free(unipro_dma.dev, op);
 
         if (desc->callback != NULL) {
@@ -384,52 +489,57 @@ static int unipro_dma_xfer(struct unipro_xfer_descriptor *desc,
     int retval;
     size_t xfer_len;
     void *cport_buf;
-    void *xfer_buf;
     struct device_dma_op *dma_op = NULL;
+    int i;
 
     DEBUGASSERT(desc->data_offset == 0);
 
     xfer_len = desc->len;
 
-    retval = device_dma_op_alloc(unipro_dma.dev, 1, 0, &dma_op);
+    /*
+     * one chained DMA descriptor per buffer, from the ops preallocated for
+     * the channel if there are some left
+     */
+    retval = device_dma_op_pool_alloc(unipro_dma.dev, channel->chan, &dma_op);
     if (retval != OK) {
-        lowsyslog("unipro: failed allocate a DMA op, retval = %d.\n", retval);
-        return retval;
+        retval = device_dma_op_alloc(unipro_dma.dev, desc->iovcnt, 0,
+                                     &dma_op);
+        if (retval != OK) {
+            lowsyslog("unipro: failed allocate a DMA op, retval = %d.\n",
+                      retval);
+            return retval;
+        }
+
+        dma_op->callback = (void *) unipro_dma_tx_callback;
+        dma_op->callback_events = UNIPRO_DMA_CALLBACK_EVENTS;
     }
     desc->channel = channel;
+    channel->busy = true;
+    channel->start_usec = hrt_getusec();
 
-    dma_op->callback = (void *) unipro_dma_tx_callback;
     dma_op->callback_arg = desc;
-    dma_op->callback_events = DEVICE_DMA_CALLBACK_EVENT_COMPLETE;
-    dma_op->callback_events |=  DEVICE_DMA_CALLBACK_EVENT_START;
-    dma_op->callback_events |=  DEVICE_DMA_CALLBACK_EVENT_ERROR;
-    dma_op->callback_events |=  DEVICE_DMA_CALLBACK_EVENT_RECOVERED;
-    dma_op->callback_events |=  DEVICE_DMA_CALLBACK_EVENT_DEQUEUED;
-    dma_op->sg_count = 1;
-    dma_op->sg[0].len = xfer_len;
+    dma_op->sg_count = desc->iovcnt;
 
     desc->dma_op = dma_op;
 
     DBG_UNIPRO("xfer: chan=%u, len=%u\n", channel->cportid, xfer_len);
 
     cport_buf = desc->cport->tx_buf;
-    xfer_buf = (void*) desc->data;
 
-    /* resuming a paused xfer */
-    if (desc->data_offset != 0) {
-        cport_buf = (char*) cport_buf + sizeof(uint64_t); /* skip the first DWORD */
+    for (i = 0; i < desc->iovcnt; i++) {
+        dma_op->sg[i].len = desc->iov[i].len;
+        dma_op->sg[i].src_addr = (off_t) desc->iov[i].base;
+        dma_op->sg[i].dst_addr = (off_t) cport_buf;
 
-        /* move buffer offset to the beginning of the remaning bytes to xfer */
-        xfer_buf = (char*) xfer_buf + desc->data_offset;
+        /* the next buffers continue the message: skip the first DWORD */
+        cport_buf = (char*) desc->cport->tx_buf + sizeof(uint64_t);
     }
 
-    dma_op->sg[0].src_addr = (off_t) xfer_buf;
-    dma_op->sg[0].dst_addr = (off_t) cport_buf;
-
     desc->data_offset += xfer_len;
 
     retval = device_dma_enqueue(unipro_dma.dev, channel->chan, dma_op);
     if (retval) {
+        unipro_dma_channel_release(channel, false, 0);
         desc->channel = NULL;
         device_dma_op_free(unipro_dma.dev, dma_op);
         lowsyslog("unipro: failed to start DMA transfer: %d\n", retval);
@@ -439,20 +549,89 @@ static int unipro_dma_xfer(struct unipro_xfer_descriptor *desc,
     return 0;
 }
 
-static void *unipro_tx_worker(void *data)
+/*
+ * Copy a small message into the CPort TX buffer with the CPU, which is
+ * cheaper than a DMA transfer. The copy is only done if the CPort TX buffer
+ * has room for the whole message, otherwise the DMA and its hardware flow
+ * control are used to wait for the room.
+ */
+static bool unipro_memcpy_xfer(struct unipro_xfer_descriptor *desc)
+{
+    struct cport *cport = desc->cport;
+    uint8_t *tx_buf = cport->tx_buf;
+    int i;
+
+    if (desc->len > memcpy_threshold ||
+        unipro_get_tx_free_buffer_space(cport) < desc->len) {
+        return false;
+    }
+
+    for (i = 0; i < desc->iovcnt; i++) {
+        memcpy(tx_buf, desc->iov[i].base, desc->iov[i].len);
+
+        /* the next buffers continue the message */
+        tx_buf = (uint8_t *) cport->tx_buf + sizeof(uint32_t);
+    }
+
+    unipro_dma_tx_set_eom_flag(cport);
+
+    if (desc->callback != NULL) {
+        desc->callback(0, desc->data, desc->priv);
+    }
+
+    unipro_xfer_dequeue_descriptor(desc);
+
+    return true;
+}
+
+void unipro_set_tx_memcpy_threshold(size_t threshold)
+{
+    memcpy_threshold = threshold;
+}
+
+/*
+ * Block until the worker has something to do. A CPort TX queue draining
+ * raises no event, so while CPort resets are pending, come back every tick
+ * to check on them.
+ */
+static void unipro_tx_worker_wait(void)
+{
+    struct timespec abstime;
+
+    if (!unipro_reset_cport_pending()) {
+        sem_wait(&worker.tx_fifo_lock);
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_nsec += NSEC_PER_TICK;
+    if (abstime.tv_nsec >= NSEC_PER_SEC) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= NSEC_PER_SEC;
+    }
+
+    sem_timedwait(&worker.tx_fifo_lock, &abstime);
+}
+
+hot_function static void *unipro_tx_worker(void *data)
 {
     struct dma_channel *channel;
     struct unipro_xfer_descriptor *desc;
-    unsigned int next_cport;
     int rc = 0;
 
     while (1) {
-        /* Block until a buffer is pending on any CPort */
-        sem_wait(&worker.tx_fifo_lock);
+        /*
+         * Block until a buffer is pending on any CPort or a DMA channel
+         * completed a transfer
+         */
+        unipro_tx_worker_wait();
+
+        /* Feed all the idle DMA channels */
+        while ((desc = pick_tx_descriptor()) != NULL) {
+            if (unipro_memcpy_xfer(desc)) {
+                continue;
+            }
 
-        next_cport = 0;
-        while ((desc = pick_tx_descriptor(next_cport)) != NULL) {
-            next_cport = desc->cport->cportid + 1;
             channel = pick_dma_channel(desc->cport);
 
             rc = unipro_dma_xfer(desc, channel);
@@ -465,6 +644,10 @@ static void *unipro_tx_worker(void *data)
                         lowsyslog("unipro: DMA transfer failed: %d\n", rc);
                         break;
                 }
+
+                /* give the credit back and retry on the next event */
+                desc->cport->tx_deficit += desc->len;
+                break;
             }
         }
     }
@@ -481,12 +664,15 @@ static void unipro_reset_notify_dma(unsigned int cportid)
     sem_post(&worker.tx_fifo_lock);
 }
 
-static int unipro_send_async_dma(unsigned int cportid, const void *buf, size_t len,
+static int unipro_send_async_iov_dma(unsigned int cportid,
+        const struct unipro_iovec *iov, unsigned int iovcnt,
         unipro_send_completion_t callback, void *priv)
 {
     struct cport *cport;
     struct unipro_xfer_descriptor *desc;
     irqstate_t flags;
+    size_t len = 0;
+    int i;
 
     cport = cport_handle(cportid);
     if (!cport) {
@@ -503,8 +689,14 @@ static int unipro_send_async_dma(unsigned int cportid, const void *buf, size_t l
     if (!desc)
         return -ENOMEM;
 
-    desc->data = buf;
+    for (i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+
+    desc->data = iov[0].base;
     desc->len = len;
+    memcpy(desc->iov, iov, iovcnt * sizeof(*iov));
+    desc->iovcnt = iovcnt;
     desc->data_offset = 0;
     desc->callback = callback;
     desc->priv = priv;
@@ -514,6 +706,7 @@ static int unipro_send_async_dma(unsigned int cportid, const void *buf, size_t l
 
     flags = irqsave();
     list_add(&cport->tx_fifo, &desc->list);
+    unipro_tx_queued_add(cport, len);
     irqrestore(flags);
 
     sem_post(&worker.tx_fifo_lock);
@@ -521,6 +714,17 @@ static int unipro_send_async_dma(unsigned int cportid, const void *buf, size_t l
     return 0;
 }
 
+static int unipro_send_async_dma(unsigned int cportid, const void *buf, size_t len,
+        unipro_send_completion_t callback, void *priv)
+{
+    struct unipro_iovec iov = {
+        .base = buf,
+        .len = len,
+    };
+
+    return unipro_send_async_iov_dma(cportid, &iov, 1, callback, priv);
+}
+
 static int unipro_send_cb(int status, const void *buf, void *priv)
 {
     struct unipro_xfer_descriptor_sync *desc = priv;
@@ -555,10 +759,49 @@ out:
     return retval;
 }
 
+/**
+ * @brief Get the utilization statistics of a UniPro TX DMA channel
+ * @param channel DMA channel index
+ * @param stats where to copy the statistics
+ * @return 0 on success, -EINVAL if the channel does not exist
+ */
+int unipro_tx_dma_get_stats(unsigned int channel,
+                            struct unipro_tx_dma_stats *stats)
+{
+    irqstate_t flags;
+
+    if (channel >= unipro_dma.max_channel || !stats) {
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+    memcpy(stats, &unipro_dma.dma_channels[channel].stats, sizeof(*stats));
+    irqrestore(flags);
+
+    return 0;
+}
+
+/**
+ * @brief Clear the utilization statistics of all the UniPro TX DMA channels
+ */
+void unipro_tx_dma_reset_stats(void)
+{
+    irqstate_t flags;
+    int i;
+
+    flags = irqsave();
+    for (i = 0; i < unipro_dma.max_channel; i++) {
+        memset(&unipro_dma.dma_channels[i].stats, 0,
+               sizeof(unipro_dma.dma_channels[i].stats));
+    }
+    irqrestore(flags);
+}
+
 static struct unipro_tx_calltable calltable = {
     unipro_reset_notify_dma,
     unipro_send_dma,
-    unipro_send_async_dma
+    unipro_send_async_dma,
+    unipro_send_async_iov_dma,
 };
 
 int unipro_tx_init_dma(struct unipro_tx_calltable **table)
@@ -567,6 +810,10 @@ int unipro_tx_init_dma(struct unipro_tx_calltable **table)
     int retval;
     int avail_chan = 0;
     enum device_dma_dev dst_device = DEVICE_DMA_DEV_MEM;
+    const struct device_dma_op op_template = {
+        .callback = (void *) unipro_dma_tx_callback,
+        .callback_events = UNIPRO_DMA_CALLBACK_EVENTS,
+    };
 
     sem_init(&worker.tx_fifo_lock, 0, 0);
     sem_init(&unipro_dma.dma_channel_lock, 0, 0);
@@ -662,6 +909,14 @@ int unipro_tx_init_dma(struct unipro_tx_calltable **table)
             break;
         }
 
+        /*
+         * A channel runs one op at a time, which is freed before the channel
+         * is released. Without the pool, unipro_dma_xfer() allocates them.
+         */
+        device_dma_op_pool_create(unipro_dma.dev,
+                                  unipro_dma.dma_channels[i].chan, 1,
+                                  UNIPRO_IOV_MAX, 0, &op_template);
+
         unipro_dma.dma_channels[i].cportid = 0xFFFF;
         unipro_dma.max_channel++;
     }
@@ -33,7 +33,9 @@
 #include <nuttx/mm/mm.h>
 
 #include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "tsb_scm.h"
 #include "up_arch.h"
@@ -48,8 +50,24 @@
 #define TSB_HSIC_DPPULLDOWN             (1 << 0)
 #define TSB_HSIC_DMPULLDOWN             (1 << 1)
 
+/* Number of URB completions that can be deferred to the end of the IRQ */
+#define URB_COMPLETE_BATCH_SIZE         16
+/* Number of URBs prepared on the stack by urb_enqueue_batch() */
+#define URB_ENQUEUE_BATCH_SIZE          8
+
 static dwc_otg_device_t *g_dev;
 
+/*
+ * While the HSIC IRQ is being handled, URB completions are stored here
+ * and the complete callbacks are called once the HCD is done with its
+ * interrupts, instead of releasing the HCD lock for each URB.
+ */
+static struct {
+    bool deferred;
+    int count;
+    struct urb *urbs[URB_COMPLETE_BATCH_SIZE];
+} g_complete;
+
 static int _hub_info(dwc_otg_hcd_t *hcd, void *urb_handle, uint32_t *hub_addr,
                      uint32_t *port_addr)
 {
@@ -82,6 +100,30 @@ static int _speed(dwc_otg_hcd_t *hcd, void *urb_handle)
     return urb->dev_speed;
 }
 
+/*
+ * Call the complete callback of the deferred URBs.
+ * Must be called without the HCD lock held.
+ */
+static void urb_complete_flush(void)
+{
+    int i;
+    int count;
+    irqstate_t flags;
+    struct urb *urbs[URB_COMPLETE_BATCH_SIZE];
+
+    flags = irqsave();
+    count = g_complete.count;
+    memcpy(urbs, g_complete.urbs, count * sizeof(*urbs));
+    g_complete.count = 0;
+    irqrestore(flags);
+
+    for (i = 0; i < count; i++) {
+        if (urbs[i]->complete) {
+            urbs[i]->complete(urbs[i]);
+        }
+    }
+}
+
 static int _complete(dwc_otg_hcd_t *hcd, void *urb_handle,
              dwc_otg_hcd_urb_t *dwc_urb, int32_t status)
 {
@@ -97,13 +139,22 @@ static int _complete(dwc_otg_hcd_t *hcd, void *urb_handle,
     free(dwc_urb);
     urb->hcpriv = NULL;
 
+    if (g_complete.deferred) {
+        g_complete.urbs[g_complete.count++] = urb;
+        if (g_complete.count < URB_COMPLETE_BATCH_SIZE) {
+            return 0;
+        }
+    }
+
     /*
      * spinlock is held by hcd driver, release it before calling
      * the complete callback and reacquire it afterward.
      */
     DWC_SPINUNLOCK(hcd->lock);
 
-    if (urb->complete) {
+    if (g_complete.deferred) {
+        urb_complete_flush();
+    } else if (urb->complete) {
         urb->complete(urb);
     }
 
@@ -128,11 +179,19 @@ static struct dwc_otg_hcd_function_ops hcd_fops = {
  */
 static int hsic_irq_handler(int irq, void *context, void *priv)
 {
+    int retval;
+
     DEBUGASSERT(g_dev);
     DEBUGASSERT(g_dev->hcd);
 
+    g_complete.deferred = true;
     dwc_otg_handle_common_intr(g_dev);
-    return dwc_otg_hcd_handle_intr(g_dev->hcd);
+    retval = dwc_otg_hcd_handle_intr(g_dev->hcd);
+    g_complete.deferred = false;
+
+    urb_complete_flush();
+
+    return retval;
 }
 
 /**
@@ -394,15 +453,14 @@ static int hub_control(struct device *dev, uint16_t typeReq, uint16_t wValue,
  * @param urb urb to send
  * @return 0 if successfully enqueued.
  */
-static int urb_enqueue(struct device *dev, struct urb *urb)
+static dwc_otg_hcd_urb_t *urb_prepare(struct urb *urb)
 {
-    int retval;
     uint8_t ep_type;
     int number_of_packets = 0;
     dwc_otg_hcd_urb_t *dwc_urb;
 
     if (!urb->complete) {
-        return -EINVAL;
+        return NULL;
     }
 
     switch (urb->pipe.type) {
@@ -423,12 +481,12 @@ static int urb_enqueue(struct device *dev, struct urb *urb)
         break;
 
     default:
-        return -EINVAL;
+        return NULL;
     }
 
     dwc_urb = dwc_otg_hcd_urb_alloc(g_dev->hcd, number_of_packets, 0);
     if (!dwc_urb) {
-        return -ENOMEM;
+        return NULL;
     }
 
     urb->hcpriv = dwc_urb;
@@ -445,6 +503,19 @@ static int urb_enqueue(struct device *dev, struct urb *urb)
                                (dwc_dma_t) &urb->setup_packet,
                                urb->flags, urb->interval);
 
+    return dwc_urb;
+}
+
+static int urb_enqueue(struct device *dev, struct urb *urb)
+{
+    int retval;
+    dwc_otg_hcd_urb_t *dwc_urb;
+
+    dwc_urb = urb_prepare(urb);
+    if (!dwc_urb) {
+        return urb->complete ? -ENOMEM : -EINVAL;
+    }
+
     retval = dwc_otg_hcd_urb_enqueue(g_dev->hcd, dwc_urb, &urb->hcpriv_ep, 0);
     if (retval) {
         goto error_enqueue;
@@ -453,11 +524,77 @@ static int urb_enqueue(struct device *dev, struct urb *urb)
     return 0;
 
 error_enqueue:
+    urb->hcpriv = NULL;
     free(dwc_urb);
 
     return retval;
 }
 
+/**
+ * Enqueue several URBs, selecting the transactions once per batch
+ *
+ * @param dev usb host device
+ * @param urbs urbs to send
+ * @param count number of urbs
+ * @return number of urbs enqueued, or the error of the first urb if none
+ *         could be enqueued.
+ */
+static int urb_enqueue_batch(struct device *dev, struct urb **urbs,
+                             size_t count)
+{
+    int i;
+    int n;
+    int done;
+    int prepared;
+    int retval = 0;
+    int queued = 0;
+    dwc_otg_hcd_urb_t *dwc_urbs[URB_ENQUEUE_BATCH_SIZE];
+    void **ep_handles[URB_ENQUEUE_BATCH_SIZE];
+
+    while (queued < count) {
+        n = count - queued;
+        if (n > URB_ENQUEUE_BATCH_SIZE) {
+            n = URB_ENQUEUE_BATCH_SIZE;
+        }
+
+        for (i = 0; i < n; i++) {
+            dwc_urbs[i] = urb_prepare(urbs[queued + i]);
+            if (!dwc_urbs[i]) {
+                retval = urbs[queued + i]->complete ? -ENOMEM : -EINVAL;
+                break;
+            }
+            ep_handles[i] = &urbs[queued + i]->hcpriv_ep;
+        }
+        prepared = i;
+
+        if (prepared) {
+            done = dwc_otg_hcd_urb_enqueue_batch(g_dev->hcd, dwc_urbs,
+                                                 ep_handles, prepared, 0);
+            if (done < 0) {
+                retval = done;
+                done = 0;
+            }
+
+            /* Release the URBs that couldn't be enqueued */
+            for (i = done; i < prepared; i++) {
+                urbs[queued + i]->hcpriv = NULL;
+                free(dwc_urbs[i]);
+            }
+
+            queued += done;
+            if (done < prepared) {
+                break;
+            }
+        }
+
+        if (prepared < n) {
+            break;
+        }
+    }
+
+    return queued ? queued : retval;
+}
+
 static int urb_dequeue(struct device *dev, struct urb *urb)
 {
     int retval;
@@ -487,6 +624,7 @@ static struct device_usb_hcd_type_ops tsb_usb_hcd_type_ops = {
     .start = hcd_start,
     .stop = hcd_stop,
     .urb_enqueue = urb_enqueue,
+    .urb_enqueue_batch = urb_enqueue_batch,
     .urb_dequeue = urb_dequeue,
     .hub_control = hub_control,
 };
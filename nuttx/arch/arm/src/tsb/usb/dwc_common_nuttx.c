@@ -39,6 +39,7 @@
 #include <nuttx/bufram.h>
 #include <nuttx/arch.h>
 #include <nuttx/mm/mm.h>
+#include <nuttx/mm/dma_heap.h>
 #include <nuttx/wqueue.h>
 #include <arch/byteorder.h>
 
@@ -236,9 +237,25 @@ void __DWC_DEBUG(char *format, ...)
 
 /* dwc_mem.h */
 
+#ifdef CONFIG_MM_DMA_HEAP
+/* The descriptors and buffers of the core DMA are accessed as 32-bit words */
+#define DWC_DMA_ALIGN 4
+
+#define dwc_dma_buf_alloc(size) dma_alloc(size, DWC_DMA_ALIGN)
+#define dwc_dma_buf_free(buf)   dma_free(buf)
+#else
+#define dwc_dma_buf_alloc(size) bufram_alloc(size)
+#define dwc_dma_buf_free(buf)   bufram_free(buf)
+#endif
+
 void *__DWC_DMA_ALLOC(void *dma_ctx, uint32_t size, dwc_dma_t *dma_addr)
 {
-    void *buf = bufram_alloc(size);
+    void *buf = dwc_dma_buf_alloc(size);
+    if (!buf) {
+        *dma_addr = 0;
+        return NULL;
+    }
+
     memset(buf, 0, size); /* TODO check if it is necessary */
     *dma_addr = (dwc_dma_t) buf;
     return buf;
@@ -247,7 +264,7 @@ void *__DWC_DMA_ALLOC(void *dma_ctx, uint32_t size, dwc_dma_t *dma_addr)
 void __DWC_DMA_FREE(void *dma_ctx, uint32_t size, void *virt_addr,
                     dwc_dma_t dma_addr)
 {
-    bufram_free(virt_addr);
+    dwc_dma_buf_free(virt_addr);
 }
 
 void *__DWC_ALLOC(void *mem_ctx, uint32_t size)
@@ -484,11 +484,15 @@ void dwc_otg_hcd_stop(dwc_otg_hcd_t * hcd)
 	dwc_mdelay(1);
 }
 
-int dwc_otg_hcd_urb_enqueue(dwc_otg_hcd_t * hcd,
-			    dwc_otg_hcd_urb_t * dwc_otg_urb, void **ep_handle,
-			    int atomic_alloc)
+/**
+ * Add the URB to its QH, without scheduling it.
+ * Returns 1 if transactions must be scheduled, 0 if the URB will be picked
+ * up later (SOF interrupt or SG bulk transfer), or a negative error code.
+ */
+static int hcd_urb_add(dwc_otg_hcd_t * hcd,
+		       dwc_otg_hcd_urb_t * dwc_otg_urb, void **ep_handle,
+		       int atomic_alloc)
 {
-	dwc_irqflags_t flags;
 	int retval = 0;
 	dwc_otg_qtd_t *qtd;
 	gintmsk_data_t intr_mask = {.d32 = 0 };
@@ -514,23 +518,73 @@ int dwc_otg_hcd_urb_enqueue(dwc_otg_hcd_t * hcd,
 	} else {
 		qtd->qh = *ep_handle;
 	}
+	if (retval < 0)
+		return retval;
+
 	intr_mask.d32 = DWC_READ_REG32(&hcd->core_if->core_global_regs->gintmsk);
-	if (!intr_mask.b.sofintr && retval == 0) {
-		dwc_otg_transaction_type_e tr_type;
+	if (!intr_mask.b.sofintr) {
 		if ((qtd->qh->ep_type == UE_BULK)
 		    && !(qtd->urb->flags & URB_GIVEBACK_ASAP)) {
 			/* Do not schedule SG transactions until qtd has URB_GIVEBACK_ASAP set */
 			return 0;
 		}
-		DWC_SPINLOCK_IRQSAVE(hcd->lock, &flags);
-		tr_type = dwc_otg_hcd_select_transactions(hcd);
-		if (tr_type != DWC_OTG_TRANSACTION_NONE) {
-			dwc_otg_hcd_queue_transactions(hcd, tr_type);
-		}
-		DWC_SPINUNLOCK_IRQRESTORE(hcd->lock, flags);
+		return 1;
 	}
 
-	return retval;
+	return 0;
+}
+
+static void hcd_urb_schedule(dwc_otg_hcd_t * hcd)
+{
+	dwc_irqflags_t flags;
+	dwc_otg_transaction_type_e tr_type;
+
+	DWC_SPINLOCK_IRQSAVE(hcd->lock, &flags);
+	tr_type = dwc_otg_hcd_select_transactions(hcd);
+	if (tr_type != DWC_OTG_TRANSACTION_NONE) {
+		dwc_otg_hcd_queue_transactions(hcd, tr_type);
+	}
+	DWC_SPINUNLOCK_IRQRESTORE(hcd->lock, flags);
+}
+
+int dwc_otg_hcd_urb_enqueue(dwc_otg_hcd_t * hcd,
+			    dwc_otg_hcd_urb_t * dwc_otg_urb, void **ep_handle,
+			    int atomic_alloc)
+{
+	int retval;
+
+	retval = hcd_urb_add(hcd, dwc_otg_urb, ep_handle, atomic_alloc);
+	if (retval < 0)
+		return retval;
+
+	if (retval)
+		hcd_urb_schedule(hcd);
+
+	return 0;
+}
+
+int dwc_otg_hcd_urb_enqueue_batch(dwc_otg_hcd_t * hcd,
+				  dwc_otg_hcd_urb_t ** dwc_otg_urbs,
+				  void ***ep_handles, int count,
+				  int atomic_alloc)
+{
+	int i;
+	int retval = 0;
+	int schedule = 0;
+
+	for (i = 0; i < count; i++) {
+		retval = hcd_urb_add(hcd, dwc_otg_urbs[i], ep_handles[i],
+				     atomic_alloc);
+		if (retval < 0)
+			break;
+		schedule |= retval;
+	}
+
+	/* Select the transactions once for the whole batch */
+	if (schedule)
+		hcd_urb_schedule(hcd);
+
+	return i ? i : retval;
 }
 
 int dwc_otg_hcd_urb_dequeue(dwc_otg_hcd_t * hcd,
@@ -342,6 +342,23 @@ extern int dwc_otg_hcd_urb_enqueue(dwc_otg_hcd_t * dwc_otg_hcd,
 				   dwc_otg_hcd_urb_t * dwc_otg_urb,
 				   void **ep_handle, int atomic_alloc);
 
+/** Queue several URBs, and select the transactions only once.
+ * URBs are queued in order, and queuing stops at the first failure.
+ *
+ * @param dwc_otg_hcd The HCD
+ * @param dwc_otg_urbs DWC_OTG URBs
+ * @param ep_handles Out parameters for returning endpoint handles
+ * @param count Number of URBs
+ * @param atomic_alloc Flag to do atomic allocation if needed
+ *
+ * Returns the number of URBs queued, or the error code of the first URB if
+ * none could be queued.
+ */
+extern int dwc_otg_hcd_urb_enqueue_batch(dwc_otg_hcd_t * dwc_otg_hcd,
+					 dwc_otg_hcd_urb_t ** dwc_otg_urbs,
+					 void ***ep_handles, int count,
+					 int atomic_alloc);
+
 /** De-queue the specified URB
  *
  * @param dwc_otg_hcd The HCD
@@ -145,6 +145,9 @@ void dwc_otg_request_nuke(dwc_otg_pcd_ep_t * ep)
 	dwc_otg_pcd_request_t *req;
 
 	ep->stopped = 1;
+#ifdef DWC_SG_DMA_IN_BATCH
+	ep->in_batch_last = NULL;
+#endif
 
 	/* called with irqs blocked?? */
 	while (!DWC_CIRCLEQ_EMPTY(&ep->queue)) {
@@ -284,7 +287,7 @@ dwc_otg_dev_dma_desc_t *dwc_otg_ep_alloc_desc_chain(dwc_dma_t * dma_desc_addr,
 
     size = count * sizeof(dwc_otg_dev_dma_desc_t);
     page_count = bufram_size_to_page_count(size);
-    ptr = bufram_page_alloc(page_count);
+    ptr = bufram_page_alloc_owner(page_count, BUFRAM_OWNER_USB);
     memset(ptr, 0, size);
 
     if (dma_desc_addr) {
@@ -308,7 +311,7 @@ void dwc_otg_ep_free_desc_chain(dwc_otg_dev_dma_desc_t * desc_addr,
     size_t page_count =
         bufram_size_to_page_count(count * sizeof(dwc_otg_dev_dma_desc_t));
 
-    bufram_page_free(desc_addr, page_count);
+    bufram_page_free_owner(desc_addr, page_count, BUFRAM_OWNER_USB);
 #else
     DWC_DMA_FREE(count * sizeof(dwc_otg_dev_dma_desc_t), desc_addr,
                  dma_desc_addr);
@@ -2708,6 +2711,58 @@ void init_fifo_dma_desc_chain(dwc_otg_core_if_t * core_if,
 }
 #endif /* DWC_ENHANCED_SG_DMA_IN */
 
+#ifdef DWC_SG_DMA_IN_BATCH
+/*
+ * Program one descriptor per request queued on a bulk IN endpoint.
+ * Only the last descriptor raises an interrupt: complete_ep() completes
+ * all the requests of the chain at once.
+ * If the first request needs more than one descriptor, leave desc_cnt to 0
+ * to let dwc_otg_ep_start_transfer() build a regular chain.
+ */
+void init_fifo_dma_desc_batch(dwc_otg_core_if_t * core_if,
+			      dwc_otg_pcd_ep_t *ep)
+{
+	int i = 0;
+	dwc_otg_pcd_request_t *req;
+	dwc_otg_pcd_request_t *last = NULL;
+	dwc_otg_dev_dma_desc_t *dma_desc;
+	dwc_ep_t *dwc_ep = &ep->dwc_ep;
+
+	dwc_ep->desc_cnt = 0;
+	ep->in_batch_last = NULL;
+	DWC_CIRCLEQ_FOREACH(req, &ep->queue, queue_entry) {
+		if (i == MAX_DMA_DESC_CNT || req->length > DDMA_MAX_TRANSFER_SIZE)
+			break;
+
+		dma_desc = dwc_ep->desc_addr + i;
+		dma_desc->status.b.bs = BS_HOST_BUSY;
+		dma_desc->status.b.l = 0;
+		dma_desc->status.b.ioc = 0;
+		dma_desc->status.b.sp = (req->length % dwc_ep->maxpacket) ?
+					1 : (req->sent_zlp ? 1 : 0);
+		dma_desc->status.b.bytes = req->length;
+		dma_desc->buf = req->dma;
+		dma_desc->status.b.sts = 0;
+		last = req;
+		i++;
+	}
+
+	if (!last)
+		return;
+
+	dma_desc = dwc_ep->desc_addr + i - 1;
+	dma_desc->status.b.l = 1;
+	dma_desc->status.b.ioc = 1;
+
+	/* Hand the descriptors to the DMA only once the chain is complete */
+	for (dma_desc = dwc_ep->desc_addr; i; i--, dma_desc++) {
+		dma_desc->status.b.bs = BS_HOST_READY;
+		dwc_ep->desc_cnt++;
+	}
+	ep->in_batch_last = last;
+}
+#endif /* DWC_SG_DMA_IN_BATCH */
+
 int dwc_otg_pcd_ep_queue(dwc_otg_pcd_t * pcd, void *ep_handle,
 			 uint8_t * buf, dwc_dma_t dma_buf, uint32_t buflen,
 			 int zero, void *req_handle, int atomic_alloc)
@@ -178,6 +178,10 @@ typedef struct dwc_otg_pcd_ep {
 #ifdef DWC_ENHANCED_SG_DMA_OUT
 	unsigned bna:1;
 #endif
+#ifdef DWC_SG_DMA_IN_BATCH
+	/** Last request of the IN descriptor chain being processed */
+	struct dwc_otg_pcd_request *in_batch_last;
+#endif
 
 #ifdef DWC_EN_ISOC
 	/** ISOC req handle passed */
@@ -283,6 +287,10 @@ extern void update_ring_dma_desc_chain(dwc_otg_core_if_t * core_if,
 				       dwc_otg_pcd_ep_t *ep);
 extern void init_fifo_dma_desc_chain(dwc_otg_core_if_t * core_if,
 				     dwc_otg_pcd_ep_t *ep);
+#ifdef DWC_SG_DMA_IN_BATCH
+extern void init_fifo_dma_desc_batch(dwc_otg_core_if_t * core_if,
+				     dwc_otg_pcd_ep_t *ep);
+#endif
 #endif
 
 #if defined(DWC_ENHANCED_SG_DMA_OUT) && defined(CONFIG_ARA_USB_DEV)
@@ -312,7 +312,12 @@ void start_pending_requests(dwc_otg_pcd_ep_t * ep, int one_requests)
 #ifdef DWC_UTE_CFI
 		}
 #endif
-#ifdef DWC_ENHANCED_SG_DMA_IN
+#ifdef DWC_SG_DMA_IN_BATCH
+		if (one_requests != 1 && ep->dwc_ep.is_in &&
+		    ep->dwc_ep.type == DWC_OTG_EP_TYPE_BULK) {
+			init_fifo_dma_desc_batch(GET_CORE_IF(ep->pcd), ep);
+		}
+#elif defined(DWC_ENHANCED_SG_DMA_IN)
 		if (one_requests != 1) {
 			init_fifo_dma_desc_chain(GET_CORE_IF(ep->pcd), ep);
 		}
@@ -2231,6 +2236,42 @@ static inline int cfi_calc_desc_residue(dwc_otg_pcd_ep_t * ep)
  * This function completes the request for the EP. If there are
  * additional requests for the EP in the queue they will be started.
  */
+#ifdef DWC_SG_DMA_IN_BATCH
+/**
+ * This function completes all the requests of a bulk IN descriptor chain
+ * built by init_fifo_dma_desc_batch(), then starts the requests queued
+ * meanwhile.
+ */
+static void complete_ep_in_batch(dwc_otg_pcd_ep_t * ep)
+{
+	dwc_otg_pcd_request_t *req;
+	dwc_otg_pcd_request_t *last = ep->in_batch_last;
+	dwc_otg_dev_dma_desc_t *dma_desc = ep->dwc_ep.desc_addr;
+	dev_dma_desc_sts_t desc_sts;
+	int done = 0;
+
+	ep->in_batch_last = NULL;
+	while (!done && !DWC_CIRCLEQ_EMPTY(&ep->queue)) {
+		req = DWC_CIRCLEQ_FIRST(&ep->queue);
+		done = req == last;
+
+		desc_sts = dma_desc->status;
+		if (desc_sts.b.bs != BS_DMA_DONE || desc_sts.b.bytes)
+			DWC_WARN("Incomplete transfer\n");
+		req->actual = req->length - desc_sts.b.bytes;
+		dwc_otg_request_done(ep, req, 0);
+		dma_desc++;
+	}
+
+	ep->dwc_ep.start_xfer_buff = 0;
+	ep->dwc_ep.xfer_buff = 0;
+	ep->dwc_ep.xfer_len = 0;
+	ep->dwc_ep.desc_cnt = 0;
+
+	start_pending_requests(ep, 0);
+}
+#endif
+
 static void complete_ep(dwc_otg_pcd_ep_t * ep)
 {
 	dwc_otg_core_if_t *core_if = GET_CORE_IF(ep->pcd);
@@ -2263,6 +2304,13 @@ static void complete_ep(dwc_otg_pcd_ep_t * ep)
 
 	DWC_DEBUGPL(DBG_PCD, "Requests %d\n", ep->pcd->request_pending);
 
+#ifdef DWC_SG_DMA_IN_BATCH
+	if (ep->dwc_ep.is_in && ep->in_batch_last) {
+		complete_ep_in_batch(ep);
+		return;
+	}
+#endif
+
 	if (ep->dwc_ep.is_in) {
 		deptsiz.d32 = DWC_READ_REG32(&in_ep_regs->dieptsiz);
 		depctl.d32 = DWC_READ_REG32(&in_ep_regs->diepctl);
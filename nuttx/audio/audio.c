@@ -58,6 +58,10 @@
 #include <nuttx/audio/audio.h>
 #include <mqueue.h>
 
+#ifdef CONFIG_AUDIO_RING
+#  include <nuttx/wqueue.h>
+#endif
+
 #include <arch/irq.h>
 
 #ifdef CONFIG_AUDIO
@@ -89,6 +93,11 @@ struct audio_upperhalf_s
   sem_t             exclsem;  /* Supports mutual exclusion */
   FAR struct audio_lowerhalf_s *dev;  /* lower-half state */
   mqd_t             usermq;   /* User mode app's message queue */
+#ifdef CONFIG_AUDIO_RING
+  FAR struct audio_ring_s *ring; /* Buffer ring shared with the app, if any */
+  sem_t             ringsem;  /* Posted when a buffer of the ring is played */
+  struct work_s     ringwork; /* Hands the written ring buffers to the lower half */
+#endif
 };
 
 /****************************************************************************
@@ -109,6 +118,15 @@ static int      audio_start(FAR struct audio_upperhalf_s *upper);
 static void     audio_callback(FAR void *priv, uint16_t reason,
                     FAR struct ap_buffer_s *apb, uint16_t status);
 #endif /* CONFIG_AUDIO_MULTI_SESSION */
+#ifdef CONFIG_AUDIO_RING
+static void     audio_ringenqueue(FAR struct audio_upperhalf_s *upper);
+static void     audio_ringwakeup(FAR struct audio_upperhalf_s *upper);
+static void     audio_ringworker(FAR void *arg);
+static int      audio_ringsetup(FAR struct audio_upperhalf_s *upper,
+                    FAR struct audio_ring_desc_s *desc);
+static int      audio_ringrelease(FAR struct audio_upperhalf_s *upper);
+static int      audio_ringwait(FAR struct audio_upperhalf_s *upper);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -231,6 +249,13 @@ static int audio_close(FAR struct file *filep)
       audvdbg("calling shutdown: %d\n");
 
       lower->ops->shutdown(lower);
+
+#ifdef CONFIG_AUDIO_RING
+      /* The lower half no longer holds any buffer of the ring */
+
+      upper->started = false;
+      (void)audio_ringrelease(upper);
+#endif
     }
   ret = OK;
 
@@ -339,6 +364,255 @@ static int audio_start(FAR struct audio_upperhalf_s *upper)
   return ret;
 }
 
+/************************************************************************************
+ * Name: audio_ringenqueue
+ *
+ * Description:
+ *   Hand the buffers of the ring that the application has written to the lower
+ *   half, until it does not take more.  Called with exclsem held.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_AUDIO_RING
+static void audio_ringenqueue(FAR struct audio_upperhalf_s *upper)
+{
+  FAR struct audio_lowerhalf_s *lower = upper->dev;
+  FAR struct audio_ring_s *ring = upper->ring;
+  FAR struct ap_buffer_s *apb;
+
+  if (ring == NULL)
+    {
+      return;
+    }
+
+  while (ring->queued != ring->head)
+    {
+      apb = ring->apb[ring->queued % ring->nbuffers];
+      apb->curbyte = 0;
+      apb->flags  &= ~AUDIO_APB_DEQUEUED;
+
+      if (lower->ops->enqueuebuffer(lower, apb) < 0)
+        {
+          /* The lower half queue is full: retry when a buffer is played */
+
+          break;
+        }
+
+      ring->queued++;
+    }
+}
+
+/************************************************************************************
+ * Name: audio_ringwakeup
+ *
+ * Description:
+ *   Wake up the writer waiting in AUDIOIOC_RINGWAIT, if any.
+ *
+ ************************************************************************************/
+
+static void audio_ringwakeup(FAR struct audio_upperhalf_s *upper)
+{
+  int semcount;
+
+  (void)sem_getvalue(&upper->ringsem, &semcount);
+  if (semcount < 0)
+    {
+      sem_post(&upper->ringsem);
+    }
+}
+
+/************************************************************************************
+ * Name: audio_ringworker
+ *
+ * Description:
+ *   Work queue entry point scheduled when a buffer of the ring is played.
+ *   Nothing is handed over once the stream is stopped.
+ *
+ ************************************************************************************/
+
+static void audio_ringworker(FAR void *arg)
+{
+  FAR struct audio_upperhalf_s *upper = (FAR struct audio_upperhalf_s *)arg;
+
+  while (sem_wait(&upper->exclsem) < 0)
+    {
+      DEBUGASSERT(errno == EINTR);
+    }
+
+  if (upper->started)
+    {
+      audio_ringenqueue(upper);
+    }
+
+  sem_post(&upper->exclsem);
+}
+
+/************************************************************************************
+ * Name: audio_ringsetup
+ *
+ * Description:
+ *   Handle the AUDIOIOC_RINGSETUP ioctl command.  Called with exclsem held.
+ *
+ ************************************************************************************/
+
+static int audio_ringsetup(FAR struct audio_upperhalf_s *upper,
+                           FAR struct audio_ring_desc_s *desc)
+{
+  FAR struct audio_lowerhalf_s *lower = upper->dev;
+  FAR struct audio_ring_s *ring;
+  struct audio_buf_desc_s bufdesc;
+  int ret;
+  int i;
+
+  if (upper->ring != NULL)
+    {
+      return -EBUSY;
+    }
+
+  if (desc->nbuffers == 0 || desc->nbuffers > CONFIG_AUDIO_RING_MAXBUFFERS)
+    {
+      return -EINVAL;
+    }
+
+  /* The ring is accessed by the application */
+
+  ring = (FAR struct audio_ring_s *)kumm_zalloc(sizeof(struct audio_ring_s));
+  if (ring == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ring->nbuffers = desc->nbuffers;
+  upper->ring    = ring;
+
+  for (i = 0; i < desc->nbuffers; i++)
+    {
+#ifdef CONFIG_AUDIO_MULTI_SESSION
+      bufdesc.session    = desc->session;
+#endif
+      bufdesc.numbytes   = desc->numbytes;
+      bufdesc.u.ppBuffer = &ring->apb[i];
+
+      if (lower->ops->allocbuffer)
+        {
+          ret = lower->ops->allocbuffer(lower, &bufdesc);
+        }
+      else
+        {
+          ret = apb_alloc(&bufdesc);
+        }
+
+      if (ret < 0 || ring->apb[i] == NULL)
+        {
+          ring->apb[i] = NULL;
+          (void)audio_ringrelease(upper);
+          return ret < 0 ? ret : -ENOMEM;
+        }
+
+      ring->apb[i]->flags |= AUDIO_APB_RING;
+    }
+
+  *desc->ppRing = ring;
+  return OK;
+}
+
+/************************************************************************************
+ * Name: audio_ringrelease
+ *
+ * Description:
+ *   Free the ring and its buffers, which the lower half must no longer hold.
+ *   Called with exclsem held, or on the last close.
+ *
+ ************************************************************************************/
+
+static int audio_ringrelease(FAR struct audio_upperhalf_s *upper)
+{
+  FAR struct audio_lowerhalf_s *lower = upper->dev;
+  FAR struct audio_ring_s *ring = upper->ring;
+  struct audio_buf_desc_s bufdesc;
+  int i;
+
+  if (ring == NULL)
+    {
+      return OK;
+    }
+
+  if (upper->started)
+    {
+      return -EBUSY;
+    }
+
+  (void)work_cancel(HPWORK, &upper->ringwork);
+  upper->ring = NULL;
+
+  for (i = 0; i < ring->nbuffers; i++)
+    {
+      if (ring->apb[i] == NULL)
+        {
+          continue;
+        }
+
+      ring->apb[i]->flags &= ~AUDIO_APB_RING;
+      if (lower->ops->freebuffer)
+        {
+          bufdesc.u.pBuffer = ring->apb[i];
+          (void)lower->ops->freebuffer(lower, &bufdesc);
+        }
+      else
+        {
+          apb_free(ring->apb[i]);
+        }
+    }
+
+  kumm_free(ring);
+  return OK;
+}
+
+/************************************************************************************
+ * Name: audio_ringwait
+ *
+ * Description:
+ *   Handle the AUDIOIOC_RINGWAIT ioctl command: wait until a buffer of the ring
+ *   can be written.  Called without exclsem, which the dequeues need.
+ *
+ ************************************************************************************/
+
+static int audio_ringwait(FAR struct audio_upperhalf_s *upper)
+{
+  FAR struct audio_ring_s *ring = upper->ring;
+  irqstate_t flags;
+  int ret = OK;
+
+  if (ring == NULL)
+    {
+      return -EINVAL;
+    }
+
+  /* The played buffers are accounted in the dequeue callback, which may run
+   * in an interrupt handler.
+   */
+
+  flags = irqsave();
+  while (ring->head - ring->tail >= ring->nbuffers)
+    {
+      if (!upper->started)
+        {
+          ret = -EAGAIN;
+          break;
+        }
+
+      if (sem_wait(&upper->ringsem) < 0)
+        {
+          ret = -errno;
+          break;
+        }
+    }
+
+  irqrestore(flags);
+  return ret;
+}
+#endif /* CONFIG_AUDIO_RING */
+
 /************************************************************************************
  * Name: audio_ioctl
  *
@@ -360,6 +634,17 @@ static int audio_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
   audvdbg("cmd: %d arg: %ld\n", cmd, arg);
 
+#ifdef CONFIG_AUDIO_RING
+  /* AUDIOIOC_RINGWAIT blocks until buffers are dequeued, which needs the
+   * exclusive access.
+   */
+
+  if (cmd == AUDIOIOC_RINGWAIT)
+    {
+      return audio_ringwait(upper);
+    }
+#endif
+
   /* Get exclusive access to the device structures */
 
   ret = sem_wait(&upper->exclsem);
@@ -461,6 +746,13 @@ static int audio_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
               ret = lower->ops->stop(lower);
 #endif
               upper->started = false;
+
+#ifdef CONFIG_AUDIO_RING
+              if (upper->ring != NULL)
+                {
+                  audio_ringwakeup(upper);
+                }
+#endif
             }
         }
         break;
@@ -578,6 +870,57 @@ static int audio_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
         }
         break;
 
+#ifdef CONFIG_AUDIO_RING
+      /* AUDIOIOC_RINGSETUP - Allocate a buffer ring shared with the
+       *   application
+       *
+       *   ioctl argument:  pointer to an audio_ring_desc_s structure
+       */
+
+      case AUDIOIOC_RINGSETUP:
+        {
+          audvdbg("AUDIOIOC_RINGSETUP\n");
+
+          ret = audio_ringsetup(upper, (FAR struct audio_ring_desc_s *)arg);
+        }
+        break;
+
+      /* AUDIOIOC_RINGKICK - Hand the buffers written to the ring to the
+       *   lower half
+       *
+       *   ioctl argument:  None
+       */
+
+      case AUDIOIOC_RINGKICK:
+        {
+          audvdbg("AUDIOIOC_RINGKICK\n");
+          DEBUGASSERT(lower->ops->enqueuebuffer != NULL);
+
+          if (upper->ring == NULL)
+            {
+              ret = -EINVAL;
+              break;
+            }
+
+          audio_ringenqueue(upper);
+          ret = OK;
+        }
+        break;
+
+      /* AUDIOIOC_RINGRELEASE - Free the buffer ring
+       *
+       *   ioctl argument:  None
+       */
+
+      case AUDIOIOC_RINGRELEASE:
+        {
+          audvdbg("AUDIOIOC_RINGRELEASE\n");
+
+          ret = audio_ringrelease(upper);
+        }
+        break;
+#endif
+
       /* AUDIOIOC_REGISTERMQ - Register a client Message Queue
        *
        * TODO:  This needs to have multi session support.
@@ -703,9 +1046,29 @@ static inline void audio_dequeuebuffer(FAR struct audio_upperhalf_s *upper,
 #endif
 {
   struct audio_msg_s    msg;
-
   audllvdbg("Entry\n");
 
+#ifdef CONFIG_AUDIO_RING
+  /* A buffer of the ring is not reported: account it, wake up a writer
+   * waiting for room, and have the next written buffers handed over.
+   */
+
+  if ((apb->flags & AUDIO_APB_RING) != 0 && upper->ring != NULL)
+    {
+      apb->flags |= AUDIO_APB_DEQUEUED;
+      upper->ring->tail++;
+      audio_ringwakeup(upper);
+
+      if (work_available(&upper->ringwork))
+        {
+          (void)work_queue(HPWORK, &upper->ringwork, audio_ringworker,
+                           upper, 0);
+        }
+
+      return;
+    }
+#endif
+
   /* Send a dequeue message to the user if a message queue is registered */
 
   if (upper->usermq != NULL)
@@ -747,6 +1110,16 @@ static inline void audio_complete(FAR struct audio_upperhalf_s *upper,
   /* Send a dequeue message to the user if a message queue is registered */
 
   upper->started = false;
+
+#ifdef CONFIG_AUDIO_RING
+  /* Wake up a writer waiting for room in the ring: there will be none */
+
+  if (upper->ring != NULL)
+    {
+      audio_ringwakeup(upper);
+    }
+#endif
+
   if (upper->usermq != NULL)
     {
       msg.msgId = AUDIO_MSG_COMPLETE;
@@ -892,6 +1265,9 @@ int audio_register(FAR const char *name, FAR struct audio_lowerhalf_s *dev)
   /* Initialize the Audio device structure (it was already zeroed by kmm_zalloc()) */
 
   sem_init(&upper->exclsem, 0, 1);
+#ifdef CONFIG_AUDIO_RING
+  sem_init(&upper->ringsem, 0, 0);
+#endif
   upper->dev = dev;
 
 #ifdef CONFIG_AUDIO_CUSTOM_DEV_PATH
@@ -151,6 +151,12 @@ void exec_setsymtab(FAR const struct symtab_s *symtab, int nsymbols)
   g_exec_symtab   = symtab;
   g_exec_nsymbols = nsymbols;
   irqrestore(flags);
+
+#ifdef CONFIG_SYMTAB_HASH
+  /* Index the new table now rather than on the first module load */
+
+  (void)symtab_hashinit(symtab, nsymbols);
+#endif
 }
 
 #endif /* CONFIG_LIBC_EXECFUNCS */
\ No newline at end of file
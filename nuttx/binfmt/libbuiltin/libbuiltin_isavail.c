@@ -68,6 +68,12 @@
  * Private Data
  ****************************************************************************/
 
+/* Number of applications if their table is sorted by name, 0 if it is not,
+ * -1 until the table is checked.
+ */
+
+static int g_builtin_nsorted = -1;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -83,13 +89,64 @@
  *   Return the index into the table of applications for the application with
  *   the name 'appname'.
  *
+ *   When the table is sorted by name, which is how apps/builtin generates
+ *   it, the application is found with a binary search.
+ *
  ****************************************************************************/
 
 int builtin_isavail(FAR const char *appname)
 {
   FAR const char *name;
+  int low;
+  int high;
+  int mid;
+  int cmp;
   int i;
 
+  /* The first call counts the applications and checks their order */
+
+  if (g_builtin_nsorted < 0)
+    {
+      for (i = 0; (name = builtin_getname(i)); i++)
+        {
+          if (i > 0 && strncmp(builtin_getname(i - 1), name, NAME_MAX) >= 0)
+            {
+              break;
+            }
+        }
+
+      g_builtin_nsorted = name ? 0 : i;
+    }
+
+  /* Binary search of a sorted table */
+
+  if (g_builtin_nsorted > 0)
+    {
+      low  = 0;
+      high = g_builtin_nsorted - 1;
+
+      while (low <= high)
+        {
+          mid = (low + high) >> 1;
+          cmp = strncmp(appname, builtin_getname(mid), NAME_MAX);
+          if (cmp == 0)
+            {
+              return mid;
+            }
+          else if (cmp < 0)
+            {
+              high = mid - 1;
+            }
+          else
+            {
+              low = mid + 1;
+            }
+        }
+
+      set_errno(ENOENT);
+      return ERROR;
+    }
+
   for (i = 0; (name = builtin_getname(i)); i++)
     {
       if (!strncmp(name, appname, NAME_MAX))
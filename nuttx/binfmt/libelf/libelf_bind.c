@@ -46,6 +46,7 @@
 #include <assert.h>
 #include <debug.h>
 
+#include <nuttx/kmalloc.h>
 #include <nuttx/binfmt/elf.h>
 #include <nuttx/binfmt/symtab.h>
 
@@ -67,16 +68,48 @@
 #  define CONFIG_ELF_BUFFERSIZE 128
 #endif
 
+#ifndef CONFIG_ELF_RELOCATION_BUFFERCOUNT
+#  define CONFIG_ELF_RELOCATION_BUFFERCOUNT 32
+#endif
+
+#ifndef CONFIG_ELF_SYMBOL_CACHECOUNT
+#  define CONFIG_ELF_SYMBOL_CACHECOUNT 32
+#endif
+
 #ifdef CONFIG_ELF_DUMPBUFFER
 # define elf_dumpbuffer(m,b,n) bvdbgdumpbuffer(m,b,n)
 #else
 # define elf_dumpbuffer(m,b,n)
 #endif
 
+#ifndef MIN
+#  define MIN(x,y) ((x) < (y) ? (x) : (y))
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+/* Symbols are bound lazily, the first time a relocation refers to them,
+ * and the resolved value is kept in a small direct-mapped cache indexed by
+ * the symbol table index: most relocations refer to a few symbols, which
+ * then need not be read, named and looked up again.
+ */
+
+struct elf_symcache_s
+{
+  int       idx;                 /* Symbol table index, -1 if unused */
+  Elf32_Sym sym;                 /* Symbol with its resolved st_value */
+};
+
+/* Working buffers shared by the relocation of all sections */
+
+struct elf_bindstate_s
+{
+  FAR Elf32_Rel *rels;           /* Batch of relocation entries */
+  FAR struct elf_symcache_s *cache;
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -85,37 +118,6 @@
  * Private Functions
  ****************************************************************************/
 
-/****************************************************************************
- * Name: elf_readrel
- *
- * Description:
- *   Read the ELF32_Rel structure into memory.
- *
- ****************************************************************************/
-
-static inline int elf_readrel(FAR struct elf_loadinfo_s *loadinfo,
-                              FAR const Elf32_Shdr *relsec,
-                              int index, FAR Elf32_Rel *rel)
-{
-  off_t offset;
-
-  /* Verify that the symbol table index lies within symbol table */
-
-  if (index < 0 || index > (relsec->sh_size / sizeof(Elf32_Rel)))
-    {
-      bdbg("Bad relocation symbol index: %d\n", index);
-      return -EINVAL;
-    }
-
-  /* Get the file offset to the symbol table entry */
-
-  offset = relsec->sh_offset + sizeof(Elf32_Rel) * index;
-
-  /* And, finally, read the symbol table entry into memory */
-
-  return elf_read(loadinfo, (FAR uint8_t*)rel, sizeof(Elf32_Rel), offset);
-}
-
 /****************************************************************************
  * Name: elf_relocate and elf_relocateadd
  *
@@ -129,97 +131,126 @@ static inline int elf_readrel(FAR struct elf_loadinfo_s *loadinfo,
  ****************************************************************************/
 
 static int elf_relocate(FAR struct elf_loadinfo_s *loadinfo, int relidx,
-                        FAR const struct symtab_s *exports, int nexports)
+                        FAR const struct symtab_s *exports, int nexports,
+                        FAR struct elf_bindstate_s *state)
 
 {
   FAR Elf32_Shdr *relsec = &loadinfo->shdr[relidx];
   FAR Elf32_Shdr *dstsec = &loadinfo->shdr[relsec->sh_info];
-  Elf32_Rel       rel;
+  FAR struct elf_symcache_s *cached;
+  FAR Elf32_Rel  *rel;
   Elf32_Sym       sym;
   FAR Elf32_Sym  *psym;
   uintptr_t       addr;
+  int             nrels;
   int             symidx;
   int             ret;
   int             i;
+  int             j;
 
   /* Examine each relocation in the section.  'relsec' is the section
    * containing the relations.  'dstsec' is the section containing the data
    * to be relocated.
    */
 
-  for (i = 0; i < relsec->sh_size / sizeof(Elf32_Rel); i++)
+  nrels = relsec->sh_size / sizeof(Elf32_Rel);
+  for (i = 0; i < nrels; i++)
     {
       psym = &sym;
 
-      /* Read the relocation entry into memory */
+      /* Read the relocation entries into memory, a batch at a time */
 
-      ret = elf_readrel(loadinfo, relsec, i, &rel);
-      if (ret < 0)
+      j = i % CONFIG_ELF_RELOCATION_BUFFERCOUNT;
+      if (j == 0)
         {
-          bdbg("Section %d reloc %d: Failed to read relocation entry: %d\n",
-               relidx, i, ret);
-          return ret;
+          ret = elf_read(loadinfo, (FAR uint8_t *)state->rels,
+                         MIN(nrels - i, CONFIG_ELF_RELOCATION_BUFFERCOUNT) *
+                         sizeof(Elf32_Rel),
+                         relsec->sh_offset + i * sizeof(Elf32_Rel));
+          if (ret < 0)
+            {
+              bdbg("Section %d reloc %d: Failed to read relocation entries: %d\n",
+                   relidx, i, ret);
+              return ret;
+            }
         }
 
+      rel = &state->rels[j];
+
       /* Get the symbol table index for the relocation.  This is contained
        * in a bit-field within the r_info element.
        */
 
-      symidx = ELF32_R_SYM(rel.r_info);
+      symidx = ELF32_R_SYM(rel->r_info);
 
-      /* Read the symbol table entry into memory */
+      /* Use the cached value of the symbol if it was already bound */
 
-      ret = elf_readsym(loadinfo, symidx, &sym);
-      if (ret < 0)
+      cached = &state->cache[symidx % CONFIG_ELF_SYMBOL_CACHECOUNT];
+      if (cached->idx == symidx)
         {
-          bdbg("Section %d reloc %d: Failed to read symbol[%d]: %d\n",
-               relidx, i, symidx, ret);
-          return ret;
+          sym = cached->sym;
         }
+      else
+        {
+          /* Read the symbol table entry into memory */
 
-      /* Get the value of the symbol (in sym.st_value) */
+          ret = elf_readsym(loadinfo, symidx, &sym);
+          if (ret < 0)
+            {
+              bdbg("Section %d reloc %d: Failed to read symbol[%d]: %d\n",
+                   relidx, i, symidx, ret);
+              return ret;
+            }
 
-      ret = elf_symvalue(loadinfo, &sym, exports, nexports);
-      if (ret < 0)
-        {
-          /* The special error -ESRCH is returned only in one condition:  The
-           * symbol has no name.
-           *
-           * There are a few relocations for a few architectures that do
-           * no depend upon a named symbol.  We don't know if that is the
-           * case here, but we will use a NULL symbol pointer to indicate
-           * that case to up_relocate().  That function can then do what
-           * is best.
-           */
-
-          if (ret == -ESRCH)
+          /* Get the value of the symbol (in sym.st_value) */
+
+          ret = elf_symvalue(loadinfo, &sym, exports, nexports);
+          if (ret == OK)
             {
-              bdbg("Section %d reloc %d: Undefined symbol[%d] has no name: %d\n",
-                  relidx, i, symidx, ret);
-              psym = NULL;
+              cached->idx = symidx;
+              cached->sym = sym;
             }
           else
             {
-              bdbg("Section %d reloc %d: Failed to get value of symbol[%d]: %d\n",
-                  relidx, i, symidx, ret);
-              return ret;
+              /* The special error -ESRCH is returned only in one condition:
+               * The symbol has no name.
+               *
+               * There are a few relocations for a few architectures that do
+               * no depend upon a named symbol.  We don't know if that is the
+               * case here, but we will use a NULL symbol pointer to indicate
+               * that case to up_relocate().  That function can then do what
+               * is best.
+               */
+
+              if (ret == -ESRCH)
+                {
+                  bdbg("Section %d reloc %d: Undefined symbol[%d] has no name: %d\n",
+                      relidx, i, symidx, ret);
+                  psym = NULL;
+                }
+              else
+                {
+                  bdbg("Section %d reloc %d: Failed to get value of symbol[%d]: %d\n",
+                      relidx, i, symidx, ret);
+                  return ret;
+                }
             }
         }
 
       /* Calculate the relocation address. */
 
-      if (rel.r_offset < 0 || rel.r_offset > dstsec->sh_size - sizeof(uint32_t))
+      if (rel->r_offset < 0 || rel->r_offset > dstsec->sh_size - sizeof(uint32_t))
         {
           bdbg("Section %d reloc %d: Relocation address out of range, offset %d size %d\n",
-               relidx, i, rel.r_offset, dstsec->sh_size);
+               relidx, i, rel->r_offset, dstsec->sh_size);
           return -EINVAL;
         }
 
-      addr = dstsec->sh_addr + rel.r_offset;
+      addr = dstsec->sh_addr + rel->r_offset;
 
       /* Now perform the architecture-specific relocation */
 
-      ret = up_relocate(&rel, psym, addr);
+      ret = up_relocate(rel, psym, addr);
       if (ret < 0)
         {
           bdbg("ERROR: Section %d reloc %d: Relocation failed: %d\n", ret);
@@ -231,7 +262,8 @@ static int elf_relocate(FAR struct elf_loadinfo_s *loadinfo, int relidx,
 }
 
 static int elf_relocateadd(FAR struct elf_loadinfo_s *loadinfo, int relidx,
-                           FAR const struct symtab_s *exports, int nexports)
+                           FAR const struct symtab_s *exports, int nexports,
+                           FAR struct elf_bindstate_s *state)
 {
   bdbg("Not implemented\n");
   return -ENOSYS;
@@ -257,6 +289,7 @@ static int elf_relocateadd(FAR struct elf_loadinfo_s *loadinfo, int relidx,
 int elf_bind(FAR struct elf_loadinfo_s *loadinfo,
              FAR const struct symtab_s *exports, int nexports)
 {
+  struct elf_bindstate_s state;
 #ifdef CONFIG_ARCH_ADDRENV
   int status;
 #endif
@@ -282,6 +315,25 @@ int elf_bind(FAR struct elf_loadinfo_s *loadinfo,
       return -ENOMEM;
     }
 
+  /* Allocate the relocation batch buffer and the symbol cache */
+
+  state.rels  = (FAR Elf32_Rel *)
+    kmm_malloc(CONFIG_ELF_RELOCATION_BUFFERCOUNT * sizeof(Elf32_Rel));
+  state.cache = (FAR struct elf_symcache_s *)
+    kmm_malloc(CONFIG_ELF_SYMBOL_CACHECOUNT * sizeof(struct elf_symcache_s));
+
+  if (state.rels == NULL || state.cache == NULL)
+    {
+      bdbg("Failed to allocate relocation buffers\n");
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  for (i = 0; i < CONFIG_ELF_SYMBOL_CACHECOUNT; i++)
+    {
+      state.cache[i].idx = -1;
+    }
+
 #ifdef CONFIG_ARCH_ADDRENV
   /* If CONFIG_ARCH_ADDRENV=y, then the loaded ELF lies in a virtual address
    * space that may not be in place now.  elf_addrenv_select() will
@@ -292,7 +344,7 @@ int elf_bind(FAR struct elf_loadinfo_s *loadinfo,
   if (ret < 0)
     {
       bdbg("ERROR: elf_addrenv_select() failed: %d\n", ret);
-      return ret;
+      goto errout;
     }
 #endif
 
@@ -321,11 +373,11 @@ int elf_bind(FAR struct elf_loadinfo_s *loadinfo,
 
       if (loadinfo->shdr[i].sh_type == SHT_REL)
         {
-          ret = elf_relocate(loadinfo, i, exports, nexports);
+          ret = elf_relocate(loadinfo, i, exports, nexports, &state);
         }
       else if (loadinfo->shdr[i].sh_type == SHT_RELA)
         {
-          ret = elf_relocateadd(loadinfo, i, exports, nexports);
+          ret = elf_relocateadd(loadinfo, i, exports, nexports, &state);
         }
 
       if (ret < 0)
@@ -370,5 +422,16 @@ int elf_bind(FAR struct elf_loadinfo_s *loadinfo,
 
 #endif
 
+errout:
+  if (state.cache != NULL)
+    {
+      kmm_free(state.cache);
+    }
+
+  if (state.rels != NULL)
+    {
+      kmm_free(state.rels);
+    }
+
   return ret;
 }
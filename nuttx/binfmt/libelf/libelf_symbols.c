@@ -309,7 +309,9 @@ int elf_symvalue(FAR struct elf_loadinfo_s *loadinfo, FAR Elf32_Sym *sym,
 
         /* Check if the base code exports a symbol of this name */
 
-#ifdef CONFIG_SYMTAB_ORDEREDBYNAME
+#if defined(CONFIG_SYMTAB_HASH)
+        symbol = symtab_findbyhash(exports, (FAR char *)loadinfo->iobuffer, nexports);
+#elif defined(CONFIG_SYMTAB_ORDEREDBYNAME)
         symbol = symtab_findorderedbyname(exports, (FAR char *)loadinfo->iobuffer, nexports);
 #else
         symbol = symtab_findbyname(exports, (FAR char *)loadinfo->iobuffer, nexports);
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <semaphore.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/binfmt/symtab.h>
+
+#ifdef CONFIG_SYMTAB_HASH
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Empty bucket marker: symbol tables indexed by uint16_t cannot have more
+ * than 0xfffe entries, larger ones are searched linearly.
+ */
+
+#define SYMHASH_EMPTY   0xffff
+#define SYMHASH_MAXSYMS 0xfffe
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Open addressing index over one symbol table.  The bucket count is a
+ * power of two at least twice the number of symbols so that probe
+ * sequences stay short.
+ */
+
+struct symhash_s
+{
+  FAR const struct symtab_s *symtab; /* The indexed table */
+  int nsyms;                         /* Its number of entries */
+  uint32_t mask;                     /* Number of buckets - 1 */
+  FAR uint16_t *buckets;             /* Symbol table index or SYMHASH_EMPTY */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct symhash_s g_symhash;
+static sem_t g_symhash_sem = SEM_INITIALIZER(1);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* FNV-1a */
+
+static uint32_t symtab_hash(FAR const char *name)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*name != '\0')
+    {
+      hash ^= (uint8_t)*name++;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+static void symtab_takesem(void)
+{
+  while (sem_wait(&g_symhash_sem) < 0)
+    {
+      DEBUGASSERT(get_errno() == EINTR);
+    }
+}
+
+/****************************************************************************
+ * Name: symtab_buildhash
+ *
+ * Description:
+ *   (Re)build the index for symtab.  Called with g_symhash_sem held.
+ *
+ ****************************************************************************/
+
+static int symtab_buildhash(FAR const struct symtab_s *symtab, int nsyms)
+{
+  FAR uint16_t *buckets;
+  uint32_t nbuckets;
+  uint32_t slot;
+  int i;
+
+  if (nsyms <= 0 || nsyms > SYMHASH_MAXSYMS)
+    {
+      return -EINVAL;
+    }
+
+  for (nbuckets = 16; nbuckets < 2 * (uint32_t)nsyms; nbuckets <<= 1);
+
+  buckets = (FAR uint16_t *)kmm_malloc(nbuckets * sizeof(uint16_t));
+  if (buckets == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memset(buckets, 0xff, nbuckets * sizeof(uint16_t));
+
+  /* On duplicate names, keep the first entry like the linear search */
+
+  for (i = 0; i < nsyms; i++)
+    {
+      slot = symtab_hash(symtab[i].sym_name) & (nbuckets - 1);
+      while (buckets[slot] != SYMHASH_EMPTY &&
+             strcmp(symtab[buckets[slot]].sym_name, symtab[i].sym_name) != 0)
+        {
+          slot = (slot + 1) & (nbuckets - 1);
+        }
+
+      if (buckets[slot] == SYMHASH_EMPTY)
+        {
+          buckets[slot] = (uint16_t)i;
+        }
+    }
+
+  if (g_symhash.buckets != NULL)
+    {
+      kmm_free(g_symhash.buckets);
+    }
+
+  g_symhash.symtab  = symtab;
+  g_symhash.nsyms   = nsyms;
+  g_symhash.mask    = nbuckets - 1;
+  g_symhash.buckets = buckets;
+
+  bvdbg("Indexed %d symbols in %lu buckets\n", nsyms, (unsigned long)nbuckets);
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: symtab_hashinit
+ *
+ * Description:
+ *   Build the hash index for a symbol table ahead of the first lookup.
+ *
+ ****************************************************************************/
+
+int symtab_hashinit(FAR const struct symtab_s *symtab, int nsyms)
+{
+  int ret = OK;
+
+  DEBUGASSERT(symtab != NULL);
+
+  symtab_takesem();
+  if (g_symhash.symtab != symtab || g_symhash.nsyms != nsyms)
+    {
+      ret = symtab_buildhash(symtab, nsyms);
+    }
+
+  sem_post(&g_symhash_sem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: symtab_findbyhash
+ *
+ * Description:
+ *   Find the symbol in the symbol table with the matching name using the
+ *   hash index, which is (re)built if it does not cover this table.
+ *
+ ****************************************************************************/
+
+FAR const struct symtab_s *
+symtab_findbyhash(FAR const struct symtab_s *symtab,
+                  FAR const char *name, int nsyms)
+{
+  FAR const struct symtab_s *symbol = NULL;
+  uint32_t slot;
+  uint16_t index;
+
+  DEBUGASSERT(symtab != NULL && name != NULL);
+
+  symtab_takesem();
+  if ((g_symhash.symtab != symtab || g_symhash.nsyms != nsyms) &&
+      symtab_buildhash(symtab, nsyms) < 0)
+    {
+      /* No index (too large or out of memory), search linearly */
+
+      sem_post(&g_symhash_sem);
+#ifdef CONFIG_SYMTAB_ORDEREDBYNAME
+      return symtab_findorderedbyname(symtab, name, nsyms);
+#else
+      return symtab_findbyname(symtab, name, nsyms);
+#endif
+    }
+
+  slot = symtab_hash(name) & g_symhash.mask;
+  while ((index = g_symhash.buckets[slot]) != SYMHASH_EMPTY)
+    {
+      if (strcmp(symtab[index].sym_name, name) == 0)
+        {
+          symbol = &symtab[index];
+          break;
+        }
+
+      slot = (slot + 1) & g_symhash.mask;
+    }
+
+  sem_post(&g_symhash_sem);
+  return symbol;
+}
+
+#endif /* CONFIG_SYMTAB_HASH */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _APBRIDGEA_BENCH_H_
+#define _APBRIDGEA_BENCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define APBRIDGEA_BENCH_MAX_DEPTH       16
+#define APBRIDGEA_BENCH_HIST_BUCKETS    16
+
+enum apbridgea_bench_mode {
+    /* Drop everything the host sends on the cport, UniPro is not used */
+    APBRIDGEA_BENCH_SINK,
+    /* Send messages to the host on the cport, UniPro is not used */
+    APBRIDGEA_BENCH_SOURCE,
+    /* Forward messages as usual and time their round trip through UniPro */
+    APBRIDGEA_BENCH_LOOP,
+};
+
+/*
+ * Latencies are in microseconds. hist[i] counts the latencies between
+ * 2^i and 2^(i+1) - 1, the last bucket holds everything above.
+ * In sink mode, the latency is the interval between two messages from the
+ * host. In source mode, it is the time between the submission of a message
+ * and its completion on the bulk in endpoint. In loop mode, it is the time
+ * between a message received from the host and the next message received
+ * from UniPro on the same cport.
+ */
+struct apbridgea_bench_stats {
+    uint32_t transfers;
+    uint32_t errors;
+    uint64_t bytes;
+    uint32_t elapsed;
+    uint32_t lat_min;
+    uint32_t lat_max;
+    uint64_t lat_sum;
+    uint32_t hist[APBRIDGEA_BENCH_HIST_BUCKETS];
+};
+
+int apbridgea_bench_start(unsigned int cportid, enum apbridgea_bench_mode mode,
+                          size_t size, unsigned int depth, unsigned int count);
+int apbridgea_bench_stop(void);
+bool apbridgea_bench_done(void);
+void apbridgea_bench_get_stats(struct apbridgea_bench_stats *stats);
+bool apbridgea_bench_in_complete(unsigned int cportid, void *buf);
+
+#endif /* _APBRIDGEA_BENCH_H_ */
@@ -49,6 +49,20 @@
 #define APBRIDGE_WOREQUEST_TIMESYNC_DISABLE         (0x0e)
 #define APBRIDGE_WOREQUEST_TIMESYNC_AUTHORITATIVE   (0x0f)
 #define APBRIDGE_ROREQUEST_TIMESYNC_GET_LAST_EVENT  (0x10)
+/*
+ * Once enabled, each transfer of the multiplexed bulk in endpoint carries
+ * one or more messages, each one preceded by its size and cport id
+ * (two __le16) and padded to 4 bytes.
+ */
+#define APBRIDGE_WOREQUEST_BULKIN_AGGREGATION       (0x11)
+/* in/out bytes and messages (four __le32) for each bulk endpoint pair */
+#define APBRIDGE_ROREQUEST_EP_STATS                 (0x12)
+/*
+ * Let the bridge move the busiest cports to the free dedicated bulk in
+ * endpoints. Messages of every bulk in endpoint are then tagged with
+ * their cport id, as on the multiplexed one.
+ */
+#define APBRIDGE_WOREQUEST_AUTO_EP_MAPPING          (0x13)
 
 struct apbridge_dev_s;
 
@@ -68,6 +82,7 @@ void usb_wait(struct apbridge_dev_s *dev);
 int usbdev_apbinitialize(struct device *dev);
 
 int usb_release_buffer(struct apbridge_dev_s *priv, const void *buf);
+int usb_release_request(struct usbdev_req_s *req);
 
 static inline
 struct apbridge_dev_s *usbdev_to_apbridge(struct usbdev_s *dev)
@@ -82,7 +97,11 @@ struct apbridge_dev_s *usbdev_to_apbridge(struct usbdev_s *dev)
  * be redirected to callbacks.
  */
 
-/* Offloaded cport callback definition */
+/*
+ * Offloaded cport callback definition. For data coming from USB, priv is the
+ * USB request holding the data, which can be released faster with
+ * usb_release_request() than with usb_release_buffer().
+ */
 typedef int (*transfer_cb)(unsigned int cportid,
                            void *payload, size_t len, void *priv);
 
@@ -44,6 +44,26 @@ int csi_tx_srv_init(void);
  */
 int csi_tx_srv_start(uint8_t csi_id, struct csi_tx_config *cfg);
 
+/**
+ * @brief Start the CSI for a set of concurrent streams
+ *
+ * The lane count and bus frequency are computed from the aggregate bandwidth
+ * of the streams, see csi_tx_compute_config().
+ *
+ * @param csi_id The CDSI transmitter (0 or 1)
+ * @param streams Streams sent on the link, one virtual channel each
+ * @param num_streams Number of streams
+ * @param max_lanes Number of data lanes wired to the receiver
+ * @param flags Flags for the CSI transmitter configuration
+ * @param cfg Filled with the configuration used, can be NULL
+ *
+ * @return 0 on success, negative errno on error.
+ */
+int csi_tx_srv_start_streams(uint8_t csi_id,
+                             const struct csi_tx_stream *streams,
+                             unsigned int num_streams, unsigned int max_lanes,
+                             uint8_t flags, struct csi_tx_config *cfg);
+
 /**
  * @brief Stop the CSI for data streaming
  * @param csi_id The CDSI transmitter (0 or 1)
@@ -83,6 +83,7 @@ struct apbridgea_audio_info {
     unsigned int        rx_data_size;
     uint8_t             *rx_dummy_data;
     uint16_t            rx_data_cportid;
+    uint16_t            rx_buf_cportid; /* Owner of the buffers in rx_rb */
     unsigned int        rx_rb_count;
 
     struct list_head    cport_list;
@@ -110,8 +111,8 @@ struct apbridga_audio_rb_hdr {
     uint8_t                     pad[4];
 };
 
-static void apbridgea_audio_i2s_tx(struct apbridgea_audio_info *info,
-                                   uint8_t *data);
+static int apbridgea_audio_i2s_tx(struct apbridgea_audio_info *info,
+                                  uint8_t *data, void *rxbuf);
 
 static pthread_t apbridgea_audio_demux_thread;
 static sem_t apbridgea_audio_demux_sem;
@@ -119,6 +120,9 @@ static sem_t apbridgea_audio_demux_sem;
 static LIST_DECLARE(apbridgea_audio_info_list);
 static LIST_DECLARE(apbridgea_audio_demux_list);
 
+/* Info struct receiving the audio data of each cport, indexed by cport id */
+static struct apbridgea_audio_info **apbridgea_audio_rx_map;
+
 static struct apbridgea_audio_info *apbridgea_audio_find_info(uint16_t i2s_port)
 {
     struct apbridgea_audio_info *info;
@@ -138,22 +142,29 @@ static struct apbridgea_audio_info *apbridgea_audio_find_info(uint16_t i2s_port)
 static struct apbridgea_audio_info *apbridgea_audio_find_rx_info(
                                                       uint16_t rx_data_cportid)
 {
-    struct apbridgea_audio_info *info;
-    struct list_head *iter;
-
-    if (!rx_data_cportid) {
+    if (!rx_data_cportid || rx_data_cportid >= unipro_cport_count()) {
         return NULL;
     }
 
-    list_foreach(&apbridgea_audio_info_list, iter) {
-        info = list_entry(iter, struct apbridgea_audio_info, list);
+    return apbridgea_audio_rx_map[rx_data_cportid];
+}
 
-        if (info->rx_data_cportid == rx_data_cportid) {
-            return info;
-        }
+static void apbridgea_audio_set_rx_info(struct apbridgea_audio_info *info,
+                                        uint16_t rx_data_cportid)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+
+    if (info->rx_data_cportid) {
+        apbridgea_audio_rx_map[info->rx_data_cportid] = NULL;
+    }
+    if (rx_data_cportid) {
+        apbridgea_audio_rx_map[rx_data_cportid] = info;
     }
+    info->rx_data_cportid = rx_data_cportid;
 
-    return NULL;
+    irqrestore(flags);
 }
 
 static struct apbridgea_audio_cport *apbridgea_audio_find_cport(
@@ -406,7 +417,10 @@ static int apbridgea_audio_from_unipro(unsigned int cportid, void *buf,
                    sizeof(struct gb_audio_send_data_request);
 
         if (len == (hdr_size + info->rx_data_size)) {
-            apbridgea_audio_i2s_tx(info, buf + hdr_size);
+            /* The I2S controller reads the audio data from the UniPro buffer */
+            if (!apbridgea_audio_i2s_tx(info, buf + hdr_size, buf)) {
+                return 0;
+            }
         } else {
             dbg_error("%s: bad rx message from unipro, cport %u, len %u\n",
                       __func__, cportid, len);
@@ -474,7 +488,7 @@ static int apbridgea_audio_register_cport(struct apbridgea_audio_info *info,
     if (!info->rx_data_cportid &&
         (req->direction & AUDIO_APBRIDGEA_DIRECTION_RX)) {
 
-        info->rx_data_cportid = data_cportid;
+        apbridgea_audio_set_rx_info(info, data_cportid);
     }
 
     cport->direction |= req->direction;
@@ -512,7 +526,7 @@ static int apbridgea_audio_unregister_cport(struct apbridgea_audio_info *info,
     if ((data_cportid == info->rx_data_cportid) &&
         (req->direction & AUDIO_APBRIDGEA_DIRECTION_RX)) {
 
-        info->rx_data_cportid = 0;
+        apbridgea_audio_set_rx_info(info, 0);
     }
 
     cport->direction &= ~req->direction;
@@ -678,9 +692,9 @@ static void apbridgea_audio_i2s_rx_cb(struct ring_buf *rb,
  * The private area (ring_buf_get_priv()/ring_buf_set_priv()) is
  * used to point to the Greybus Audio Data Message.
  *
- * The data area will be allocated from BUFRAM to make it safe for the
- * UniPro subsystem to DMA the Greybus message.  Another requirement for
- * DMA is that the Greybus message be 8-byte aligned.
+ * The whole ring is allocated as a single BUFRAM block to make it safe
+ * for the UniPro subsystem to DMA the Greybus message.  Another requirement
+ * for DMA is that the Greybus message be 8-byte aligned.
  */
 static int apbridgea_audio_rb_alloc(struct ring_buf *rb, void *arg)
 {
@@ -690,19 +704,7 @@ static int apbridgea_audio_rb_alloc(struct ring_buf *rb, void *arg)
     void *buf;
     int ret;
 
-    buf = bufram_page_alloc(bufram_size_to_page_count(info->tx_rb_total_size));
-    if (!buf) {
-        dbg_error("%s: can't alloc from bufram\n", __func__);
-        return -ENOMEM;
-    }
-
-    if ((int)buf % APBRIDGEA_AUDIO_UNIPRO_ALIGNMENT) {
-        dbg_error("%s: bad buf alignment 0x%p\n", __func__, buf);
-        ret = -EIO;
-        goto err_free_bufram;
-    }
-
-    memset(buf, 0, info->tx_rb_headroom);
+    buf = ring_buf_get_buf(rb);
 
     rb_hdr = buf;
     rb_hdr->info = info;
@@ -710,28 +712,20 @@ static int apbridgea_audio_rb_alloc(struct ring_buf *rb, void *arg)
     ret = sem_init(&rb_hdr->complete, 0, 0);
     if (ret) {
         dbg_error("%s: can't init rb semaphore %d\n", __func__, ret);
-        ret = -EIO;
-        goto err_free_bufram;
+        return -EIO;
     }
 
     gb_hdr = buf + sizeof(*rb_hdr);
     gb_hdr->size = cpu_to_le16(info->tx_rb_total_size - sizeof(*rb_hdr));
     gb_hdr->type = GB_AUDIO_TYPE_SEND_DATA;
 
-    ring_buf_init(rb, buf, info->tx_rb_headroom, info->tx_data_size);
     ring_buf_set_priv(rb, gb_hdr);
 
     return 0;
-
-err_free_bufram:
-    bufram_page_free(buf, bufram_size_to_page_count(info->tx_rb_total_size));
-
-    return ret;
 }
 
 static void apbridgea_audio_rb_free(struct ring_buf *rb, void *arg)
 {
-    struct apbridgea_audio_info *info = arg;
     struct apbridga_audio_rb_hdr *rb_hdr;
 
     rb_hdr = ring_buf_get_buf(rb);
@@ -749,9 +743,6 @@ static void apbridgea_audio_rb_free(struct ring_buf *rb, void *arg)
     }
 
     sem_destroy(&rb_hdr->complete);
-
-    bufram_page_free(ring_buf_get_buf(rb),
-                     bufram_size_to_page_count(info->tx_rb_total_size));
 }
 
 /* "Transmitting" means receiving from I2S and transmitting over UniPro */
@@ -771,9 +762,13 @@ static int apbridgea_audio_prepare_tx(struct apbridgea_audio_info *info)
                            sizeof(struct gb_audio_send_data_request);
     info->tx_rb_total_size = info->tx_rb_headroom + info->tx_data_size;
 
-    info->tx_rb = ring_buf_alloc_ring(APBRIDGEA_AUDIO_RING_ENTRIES_TX, 0, 0, 0,
-                                      apbridgea_audio_rb_alloc,
-                                      apbridgea_audio_rb_free, info);
+    info->tx_rb = ring_buf_alloc_contiguous(APBRIDGEA_AUDIO_RING_ENTRIES_TX,
+                                            info->tx_rb_headroom,
+                                            info->tx_data_size, 0,
+                                            APBRIDGEA_AUDIO_UNIPRO_ALIGNMENT,
+                                            BUFRAM_OWNER_I2S,
+                                            apbridgea_audio_rb_alloc,
+                                            apbridgea_audio_rb_free, info);
     if (!info->tx_rb) {
         dbg_error("%s: can't alloc ring\n", __func__);
         return -ENOMEM;
@@ -795,7 +790,7 @@ static int apbridgea_audio_prepare_tx(struct apbridgea_audio_info *info)
     return 0;
 
 err_free_ring:
-    ring_buf_free_ring(info->tx_rb, apbridgea_audio_rb_free, info);
+    ring_buf_free_contiguous(info->tx_rb, apbridgea_audio_rb_free, info);
     info->tx_rb = NULL;
     info->tx_rb_headroom = 0;
     info->tx_rb_total_size = 0;
@@ -876,7 +871,7 @@ static int apbridgea_audio_shutdown_tx(struct apbridgea_audio_info *info)
 
     info->flags &= ~APBRIDGEA_AUDIO_FLAG_TX_PREPARED;
 
-    ring_buf_free_ring(info->tx_rb, apbridgea_audio_rb_free, info);
+    ring_buf_free_contiguous(info->tx_rb, apbridgea_audio_rb_free, info);
     info->tx_rb = NULL;
     info->tx_rb_headroom = 0;
     info->tx_rb_total_size = 0;
@@ -919,19 +914,53 @@ static int apbridgea_audio_set_rx_data_size(struct apbridgea_audio_info *info,
     return 0;
 }
 
-static void apbridgea_audio_i2s_tx(struct apbridgea_audio_info *info,
-                                   uint8_t *data)
+/*
+ * The rx ring entries have no buffer of their own: each one points directly
+ * to the audio data in the UniPro buffer it was received in, or to the dummy
+ * data. The UniPro buffer is kept in the entry's private area until the I2S
+ * controller is done with it.
+ */
+static void apbridgea_audio_rx_rb_release(struct ring_buf *rb, void *arg)
+{
+    struct apbridgea_audio_info *info = arg;
+    void *rxbuf = ring_buf_get_priv(rb);
+
+    if (rxbuf) {
+        unipro_rxbuf_free(info->rx_buf_cportid, rxbuf);
+        ring_buf_set_priv(rb, NULL);
+    }
+}
+
+static int apbridgea_audio_i2s_tx(struct apbridgea_audio_info *info,
+                                  uint8_t *data, void *rxbuf)
 {
-    ring_buf_reset(info->rx_rb);
+    struct ring_buf *rb = info->rx_rb;
+    irqstate_t flags;
+
+    flags = irqsave();
+
+    if (!ring_buf_is_producers(rb)) {
+        irqrestore(flags);
+        dbg_error("%s: RX overrun\n", __func__);
+        return -ENOSPC;
+    }
 
-    memcpy(ring_buf_get_tail(info->rx_rb), data, info->rx_data_size);
+    ring_buf_init(rb, data, 0, info->rx_data_size);
+    ring_buf_set_priv(rb, rxbuf);
+    if (rxbuf) {
+        info->rx_buf_cportid = info->rx_data_cportid;
+    }
 
-    ring_buf_put(info->rx_rb, info->rx_data_size);
-    ring_buf_pass(info->rx_rb);
+    ring_buf_put(rb, info->rx_data_size);
+    ring_buf_pass(rb);
 
-    info->rx_rb = ring_buf_get_next(info->rx_rb);
+    info->rx_rb = ring_buf_get_next(rb);
 
     info->rx_rb_count++;
+
+    irqrestore(flags);
+
+    return 0;
 }
 
 static void apbridgea_audio_i2s_tx_cb(struct ring_buf *rb,
@@ -940,11 +969,12 @@ static void apbridgea_audio_i2s_tx_cb(struct ring_buf *rb,
     struct apbridgea_audio_info *info = arg;
 
     if (event == DEVICE_I2S_EVENT_TX_COMPLETE) {
+        apbridgea_audio_rx_rb_release(rb, info);
         info->rx_rb_count--;
 
         /* Prevent underrun by adding an entry with dummy data */
         if (!info->rx_rb_count) {
-            apbridgea_audio_i2s_tx(info, info->rx_dummy_data);
+            apbridgea_audio_i2s_tx(info, info->rx_dummy_data, NULL);
             dbg_error("%s: RX underrun\n", __func__);
         }
     } else if (event != DEVICE_I2S_EVENT_NONE) {
@@ -965,8 +995,8 @@ static int apbridgea_audio_prepare_rx(struct apbridgea_audio_info *info)
         return -EPROTO;
     }
 
-    info->rx_rb = ring_buf_alloc_ring(APBRIDGEA_AUDIO_RING_ENTRIES_RX, 0,
-                                      info->rx_data_size, 0, NULL, NULL, NULL);
+    info->rx_rb = ring_buf_alloc_ring(APBRIDGEA_AUDIO_RING_ENTRIES_RX, 0, 0, 0,
+                                      NULL, NULL, NULL);
     if (!info->rx_rb) {
         dbg_error("%s: can't alloc ring\n", __func__);
         return -ENOMEM;
@@ -990,7 +1020,7 @@ static int apbridgea_audio_prepare_rx(struct apbridgea_audio_info *info)
     info->flags |= APBRIDGEA_AUDIO_FLAG_RX_PREPARED;
 
     /* Prime the ring with one empty entry */
-    apbridgea_audio_i2s_tx(info, info->rx_dummy_data);
+    apbridgea_audio_i2s_tx(info, info->rx_dummy_data, NULL);
 
     dbg_verbose("%s: RX prepared (I2S TX), flags 0x%x\n", __func__,
                 info->flags);
@@ -1001,7 +1031,7 @@ err_free_dummy:
     free(info->rx_dummy_data);
     info->rx_dummy_data = NULL;
 err_free_ring:
-    ring_buf_free_ring(info->rx_rb, apbridgea_audio_rb_free, info);
+    ring_buf_free_ring(info->rx_rb, NULL, NULL);
     info->rx_rb = NULL;
 
     return ret;
@@ -1077,7 +1107,7 @@ static int apbridgea_audio_shutdown_rx(struct apbridgea_audio_info *info)
     free(info->rx_dummy_data);
     info->rx_dummy_data = NULL;
 
-    ring_buf_free_ring(info->rx_rb, NULL, NULL);
+    ring_buf_free_ring(info->rx_rb, apbridgea_audio_rx_rb_release, info);
     info->rx_rb = NULL;
 
     dbg_verbose("%s: RX shutdown (I2S TX), flags 0x%x\n", __func__,
@@ -1231,10 +1261,18 @@ int apbridgea_audio_init(void)
         return -EIO;
     }
 
+    apbridgea_audio_rx_map = zalloc(sizeof(*apbridgea_audio_rx_map) *
+                                    unipro_cport_count());
+    if (!apbridgea_audio_rx_map) {
+        dbg_error("%s: can't alloc rx map\n", __func__);
+        return -ENOMEM;
+    }
+
     info = zalloc(sizeof(*info));
     if (!info) {
         dbg_error("%s: can't alloc info struct\n", __func__);
-        return -ENOMEM;
+        ret = -ENOMEM;
+        goto err_free_map;
     }
 
     info->i2s_port = 0; /* TODO: Get from init_data */
@@ -1274,6 +1312,9 @@ err_close_i2s:
     device_close(info->i2s_dev);
 err_free_info:
     free(info);
+err_free_map:
+    free(apbridgea_audio_rx_map);
+    apbridgea_audio_rx_map = NULL;
 
     return ret;
 }
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * USB gadget benchmark.
+ *
+ * The sink and source modes replace the callbacks of one cport so that
+ * the messages from the host are dropped as soon as they are received and
+ * the messages to the host are generated locally, which measures the USB
+ * controller and the gadget class without UniPro. The loop mode keeps the
+ * regular data path and expects the module on the other end of the cport
+ * to echo the messages back, which adds UniPro to the measurement.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <arch/irq.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/greybus/greybus.h>
+#include <nuttx/unipro/unipro.h>
+#include <arch/board/apbridgea_gadget.h>
+#include <arch/board/apbridgea_unipro.h>
+#include <arch/board/apbridgea_bench.h>
+
+struct bench_slot {
+    void *buf;
+    uint32_t start;
+};
+
+static struct {
+    bool running;
+    enum apbridgea_bench_mode mode;
+    unsigned int cportid;
+    size_t size;
+    unsigned int depth;
+    unsigned int count;
+    unsigned int submitted;
+    unsigned int inflight;
+    uint32_t first;
+    uint32_t last;
+    struct bench_slot slots[APBRIDGEA_BENCH_MAX_DEPTH];
+    /* Loop mode: arrival time of the messages not yet echoed */
+    uint32_t ts[APBRIDGEA_BENCH_MAX_DEPTH];
+    unsigned int ts_head;
+    unsigned int ts_count;
+    struct apbridgea_bench_stats stats;
+} bench;
+
+static void bench_record(size_t len, uint32_t now, uint32_t latency)
+{
+    struct apbridgea_bench_stats *stats = &bench.stats;
+    unsigned int bucket = 0;
+
+    if (!stats->transfers) {
+        stats->lat_min = latency;
+    }
+    stats->transfers++;
+    stats->bytes += len;
+    stats->lat_sum += latency;
+    if (latency < stats->lat_min) {
+        stats->lat_min = latency;
+    }
+    if (latency > stats->lat_max) {
+        stats->lat_max = latency;
+    }
+
+    while ((latency >> 1) && bucket < APBRIDGEA_BENCH_HIST_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+    stats->hist[bucket]++;
+
+    bench.last = now;
+}
+
+static int bench_sink_tx(unsigned int cportid, void *buf, size_t len,
+                         void *priv)
+{
+    uint32_t now = hrt_getusec();
+
+    if (!bench.first) {
+        bench.first = now;
+        bench.last = now;
+    }
+    bench_record(len, now, now - bench.last);
+
+    return usb_release_request(priv);
+}
+
+static int bench_drop_tx(unsigned int cportid, void *buf, size_t len,
+                         void *priv)
+{
+    return usb_release_request(priv);
+}
+
+static int bench_sink_rx(unsigned int cportid, void *buf, size_t len,
+                         void *priv)
+{
+    unipro_rxbuf_free(cportid, buf);
+    return 0;
+}
+
+static int bench_loop_tx(unsigned int cportid, void *buf, size_t len,
+                         void *priv)
+{
+    uint32_t now = hrt_getusec();
+    irqstate_t flags;
+    int ret;
+
+    flags = irqsave();
+    if (!bench.first) {
+        bench.first = now;
+    }
+    if (bench.ts_count < APBRIDGEA_BENCH_MAX_DEPTH) {
+        bench.ts[(bench.ts_head + bench.ts_count) %
+                 APBRIDGEA_BENCH_MAX_DEPTH] = now;
+        bench.ts_count++;
+    }
+    irqrestore(flags);
+
+    ret = unipro_tx_transfer(cportid, buf, len, priv);
+    if (ret) {
+        flags = irqsave();
+        bench.stats.errors++;
+        if (bench.ts_count) {
+            bench.ts_count--;
+        }
+        irqrestore(flags);
+    }
+
+    return ret;
+}
+
+static int bench_loop_rx(unsigned int cportid, void *buf, size_t len,
+                         void *priv)
+{
+    uint32_t now = hrt_getusec();
+    irqstate_t flags;
+
+    flags = irqsave();
+    if (bench.ts_count) {
+        bench_record(len, now, now - bench.ts[bench.ts_head]);
+        bench.ts_head = (bench.ts_head + 1) % APBRIDGEA_BENCH_MAX_DEPTH;
+        bench.ts_count--;
+    }
+    irqrestore(flags);
+
+    return usb_rx_transfer(cportid, buf, len, priv);
+}
+
+static int bench_source_submit(struct bench_slot *slot)
+{
+    struct apbridge_dev_s *priv = get_apbridge_dev();
+    int ret;
+
+    bench.submitted++;
+    slot->start = hrt_getusec();
+    ret = usb_rx_transfer(bench.cportid, slot->buf, bench.size, priv);
+    if (ret) {
+        bench.submitted--;
+        bench.stats.errors++;
+    }
+
+    return ret;
+}
+
+/*
+ * Called by the gadget when a message has been sent on a bulk in endpoint.
+ * Return true if the buffer is sent again by the benchmark, in which case
+ * the gadget must not free it.
+ */
+bool apbridgea_bench_in_complete(unsigned int cportid, void *buf)
+{
+    struct bench_slot *slot = NULL;
+    uint32_t now;
+    irqstate_t flags;
+    int i;
+
+    if (!bench.running || bench.mode != APBRIDGEA_BENCH_SOURCE ||
+        cportid != bench.cportid) {
+        return false;
+    }
+
+    for (i = 0; i < bench.depth; i++) {
+        if (bench.slots[i].buf == buf) {
+            slot = &bench.slots[i];
+            break;
+        }
+    }
+    if (!slot) {
+        return false;
+    }
+
+    now = hrt_getusec();
+    flags = irqsave();
+    bench_record(bench.size, now, now - slot->start);
+    if (!bench.count || bench.submitted < bench.count) {
+        if (!bench_source_submit(slot)) {
+            irqrestore(flags);
+            return true;
+        }
+    }
+    slot->buf = NULL;
+    bench.inflight--;
+    irqrestore(flags);
+
+    return false;
+}
+
+static void bench_free_slots(unsigned int first)
+{
+    int i;
+
+    for (i = first; i < APBRIDGEA_BENCH_MAX_DEPTH; i++) {
+        if (bench.slots[i].buf) {
+            unipro_rxbuf_free(bench.cportid, bench.slots[i].buf);
+            bench.slots[i].buf = NULL;
+        }
+    }
+}
+
+static int bench_source_start(void)
+{
+    struct gb_operation_hdr *hdr;
+    irqstate_t flags;
+    int i;
+
+    for (i = 0; i < bench.depth; i++) {
+        bench.slots[i].buf = unipro_rxbuf_alloc(bench.cportid);
+        if (!bench.slots[i].buf) {
+            bench_free_slots(0);
+            return -ENOMEM;
+        }
+
+        /* Make the messages look like Greybus requests to the host */
+        memset(bench.slots[i].buf, 0, bench.size);
+        hdr = bench.slots[i].buf;
+        hdr->size = cpu_to_le16(bench.size);
+    }
+
+    flags = irqsave();
+    bench.running = true;
+    bench.first = hrt_getusec();
+    for (i = 0; i < bench.depth; i++) {
+        if (bench.count && bench.submitted >= bench.count) {
+            break;
+        }
+        if (bench_source_submit(&bench.slots[i])) {
+            break;
+        }
+        bench.inflight++;
+    }
+    bench_free_slots(bench.inflight);
+    irqrestore(flags);
+
+    return bench.inflight ? 0 : -EIO;
+}
+
+int apbridgea_bench_start(unsigned int cportid, enum apbridgea_bench_mode mode,
+                          size_t size, unsigned int depth, unsigned int count)
+{
+    struct apbridge_dev_s *priv = get_apbridge_dev();
+    int ret;
+
+    if (bench.running) {
+        return -EBUSY;
+    }
+
+    if (cportid >= unipro_cport_count()) {
+        return -EINVAL;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.mode = mode;
+    bench.cportid = cportid;
+    bench.count = count;
+
+    switch (mode) {
+    case APBRIDGEA_BENCH_SINK:
+        ret = register_cport_callback(priv, cportid,
+                                      bench_sink_rx, bench_sink_tx);
+        break;
+    case APBRIDGEA_BENCH_LOOP:
+        ret = register_cport_callback(priv, cportid,
+                                      bench_loop_rx, bench_loop_tx);
+        break;
+    case APBRIDGEA_BENCH_SOURCE:
+        if (size < sizeof(struct gb_operation_hdr) || size > CPORT_BUF_SIZE ||
+            !depth || depth > APBRIDGEA_BENCH_MAX_DEPTH) {
+            return -EINVAL;
+        }
+        bench.size = size;
+        bench.depth = depth;
+        ret = register_cport_callback(priv, cportid,
+                                      bench_sink_rx, bench_drop_tx);
+        if (!ret) {
+            ret = bench_source_start();
+        }
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    if (ret) {
+        unregister_cport_callback(priv, cportid);
+        bench.running = false;
+        return ret;
+    }
+
+    bench.running = true;
+    lldbg("Start benchmark on cport %d\n", cportid);
+
+    return 0;
+}
+
+bool apbridgea_bench_done(void)
+{
+    if (!bench.running) {
+        return true;
+    }
+
+    if (bench.mode == APBRIDGEA_BENCH_SOURCE) {
+        return !bench.inflight;
+    }
+
+    return bench.count && bench.stats.transfers >= bench.count;
+}
+
+void apbridgea_bench_get_stats(struct apbridgea_bench_stats *stats)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    memcpy(stats, &bench.stats, sizeof(*stats));
+    stats->elapsed = bench.last - bench.first;
+    irqrestore(flags);
+}
+
+/*
+ * In source mode, the buffers still in flight are freed by the gadget
+ * when they complete, once the benchmark is no longer running.
+ */
+int apbridgea_bench_stop(void)
+{
+    struct apbridge_dev_s *priv = get_apbridge_dev();
+
+    if (!bench.running) {
+        return -EINVAL;
+    }
+
+    bench.running = false;
+
+    lldbg("Stop benchmark on cport %d\n", bench.cportid);
+
+    return unregister_cport_callback(priv, bench.cportid);
+}
@@ -55,20 +55,26 @@
 #include <nuttx/list.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/wdog.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/serial/serial.h>
 #include <nuttx/usb_device.h>
 #include <nuttx/usb/usb.h>
 #include <nuttx/usb/usbdev.h>
 #include <nuttx/usb/usbdev_trace.h>
 #include <nuttx/logbuffer.h>
+#include <nuttx/syslog/binlog.h>
 #include <nuttx/gpio.h>
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/unipro/unipro.h>
+#include <arch/atomic.h>
 #include <arch/byteorder.h>
 #include <arch/board/csi_tx_service.h>
 #include <arch/board/common_gadget.h>
 #include <arch/board/apbridgea_gadget.h>
 #include <arch/board/apbridgea_audio.h>
+#include <arch/board/apbridgea_bench.h>
  #include <arch/board/apbridgea_unipro.h>
 #include <nuttx/greybus/timesync.h>
 #include <greybus/control-gb.h>
@@ -117,10 +123,21 @@
 
 #define APBRIDGE_INTERFACEID         (0)
 #define APBRIDGE_ALTINTERFACEID      (0)
-#define APBRIDGE_NINTERFACES         (1)        /* Number of interfaces in the configuration */
 /* Number of endpoints in the interface  */
 #define APBRIDGE_NENDPOINTS          (APBRIDGE_NBULKS << 1)
 
+#ifdef CONFIG_APBRIDGE_LOG_EP
+/* The log interface takes the last endpoint left by the Greybus one */
+#define APBRIDGE_LOG_INTERFACEID     (1)
+#define APBRIDGE_LOG_EPNO            (APBRIDGE_NENDPOINTS + 1)
+#define APBRIDGE_NINTERFACES         (2)        /* Number of interfaces in the configuration */
+/* Interface and endpoint descriptors of the log interface */
+#define APBRIDGE_LOG_NDESCS          (2)
+#else
+#define APBRIDGE_NINTERFACES         (1)        /* Number of interfaces in the configuration */
+#define APBRIDGE_LOG_NDESCS          (0)
+#endif
+
 #define BULKEPNO_TO_N(epno) \
   ((epno - CONFIG_APBRIDGE_EPBULKOUT) >> 1)
 #define BULKEP_TO_N(ep) \
@@ -177,6 +194,19 @@
 /* Total number of endpoints (included setup endpoint) */
 #define APBRIDGE_MAX_ENDPOINTS (APBRIDGE_NENDPOINTS + 1)
 
+#if CONFIG_APBRIDGE_MSG_QUEUE_SIZE & (CONFIG_APBRIDGE_MSG_QUEUE_SIZE - 1)
+#  error "CONFIG_APBRIDGE_MSG_QUEUE_SIZE must be a power of two"
+#endif
+#define APBRIDGE_MSG_QUEUE_MASK      (CONFIG_APBRIDGE_MSG_QUEUE_SIZE - 1)
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+/* Number of aggregated transfers that can be in flight at the same time */
+#define APBRIDGE_AGG_NREQS           (2)
+#define APBRIDGE_AGG_ALIGN(len)      (((len) + 3) & ~3)
+#define APBRIDGE_AGG_TIMEOUT \
+  max(USEC2TICK(CONFIG_APBRIDGE_BULKIN_AGGREGATION_TIMEOUT_US), 1)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -189,6 +219,43 @@ struct apbridge_msg_s {
     void *priv;
 };
 
+/*
+ * Messages waiting for a free bulk in request.
+ * Any context may queue a message but only the bulk in completion
+ * dequeues them. Each slot has a sequence number telling if the slot
+ * is free for the producer at this position (seq == pos), or holds
+ * a message for the consumer (seq == pos + 1).
+ */
+struct apbridge_msg_slot {
+    atomic_t seq;
+    struct apbridge_msg_s msg;
+};
+
+struct apbridge_msg_ring {
+    atomic_t tail;
+    unsigned int head;
+    struct apbridge_msg_slot slots[CONFIG_APBRIDGE_MSG_QUEUE_SIZE];
+};
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+struct apbridge_agg_s {
+    size_t max_len;             /* Transfer size, 0 if disabled */
+    struct usbdev_req_s *req;   /* Transfer being filled */
+    int inflight;               /* Number of transfer submitted */
+    struct list_head pending;   /* Messages waiting for a free transfer */
+    struct wdog_s flush_wd;
+};
+#endif
+
+#ifdef CONFIG_APBRIDGE_EP_STATS
+struct apbridge_ep_stats {
+    uint32_t in_bytes;
+    uint32_t in_msgs;
+    uint32_t out_bytes;
+    uint32_t out_msgs;
+};
+#endif
+
 /* This structure describes the internal state of the driver */
 
 struct apbridge_dev_s {
@@ -200,7 +267,7 @@ struct apbridge_dev_s {
 
     struct usbdev_ep_s *ep[APBRIDGE_MAX_ENDPOINTS];
 
-    struct list_head msg_queue;
+    struct apbridge_msg_ring msg_queue;
 
     int *cport_to_epin_n;
     int epout_to_cport_n[APBRIDGE_NBULKS];
@@ -209,10 +276,52 @@ struct apbridge_dev_s {
 
     struct gadget_descriptor *g_desc;
 
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    struct apbridge_agg_s agg;
+#endif
+
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    /* Traffic per bulk endpoint pair */
+    struct apbridge_ep_stats ep_stats[APBRIDGE_NBULKS];
+    /* Bytes sent to the AP per cport */
+    uint32_t *cport_in_bytes;
+#endif
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    bool auto_map;
+    struct work_s auto_map_work;
+    /* cport_in_bytes when the policy last ran */
+    uint32_t *cport_in_last;
+    /* Cport moved by the policy to each bulk in endpoint, or -1 */
+    int ep_auto_cport[APBRIDGE_NBULKS];
+    /* Bulk in endpoint used by a mapping requested by the host */
+    bool ep_host_mapped[APBRIDGE_NBULKS];
+#endif
+
     /* Number of request per bulk out endpoints */
     uint8_t req_count[APBRIDGE_NBULKS];
     /* Number of request to reach */
     uint8_t req_new_count[APBRIDGE_NBULKS];
+#ifdef CONFIG_APBRIDGE_LOG_EP
+    struct usbdev_ep_s *log_ep;
+    /* Position of the log endpoint in the USB log buffer */
+    struct log_buffer_reader log_reader;
+    struct work_s log_work;
+    int log_inflight;
+    bool log_enabled;
+#endif
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+    /* Number of request owned by UniPro (i.e. not queued to USB) */
+    uint8_t req_busy[APBRIDGE_NBULKS];
+    /* Highest req_busy seen during the current sampling window */
+    uint8_t req_busy_max[APBRIDGE_NBULKS];
+    /* Number of transfer completed during the current sampling window */
+    uint16_t req_window[APBRIDGE_NBULKS];
+    /* Set to false once the host has set the request count itself */
+    bool req_auto[APBRIDGE_NBULKS];
+    /* Maximum number of request shared by all the bulk out endpoints */
+    int req_budget;
+#endif
 };
 
 typedef uint16_t __le16;
@@ -224,6 +333,22 @@ struct cport_to_ep {
     __u8 endpoint_out;
 };
 
+/*
+ * Header preceding each message in an aggregated bulk in transfer.
+ * The next header starts at the next 4 bytes boundary.
+ */
+struct apbridge_agg_hdr {
+    __le16 size;
+    __le16 cport_id;
+};
+
+struct ep_stats_response {
+    __le32 in_bytes;
+    __le32 in_msgs;
+    __le32 out_bytes;
+    __le32 out_msgs;
+};
+
 struct csi_tx_control {
     __u8 csi_id;
     __u8 flags;
@@ -252,6 +377,19 @@ static void bulk_out_complete(struct usbdev_ep_s *ep,
                               struct usbdev_req_s *req);
 static void bulk_in_complete(struct usbdev_ep_s *ep,
                              struct usbdev_req_s *req);
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+static void agg_complete(struct usbdev_ep_s *ep,
+                         struct usbdev_req_s *req);
+#endif
+
+/* Log endpoint ************************************************************/
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+static int usb_log_ep_bind(struct apbridge_dev_s *priv);
+static void usb_log_ep_unbind(struct apbridge_dev_s *priv);
+static int usb_log_ep_enable(struct apbridge_dev_s *priv);
+static void usb_log_ep_disable(struct apbridge_dev_s *priv);
+#endif
 
 /* USB class device ********************************************************/
 
@@ -348,7 +486,32 @@ static const struct usb_epdesc_s g_epbulkindesc = {
     0                           /* interval */
 };
 
-static const struct usb_desc_s *g_usb_desc[APBRIDGE_MAX_ENDPOINTS + 2] = {
+#ifdef CONFIG_APBRIDGE_LOG_EP
+static const struct usb_ifdesc_s g_logifdesc = {
+    USB_SIZEOF_IFDESC,          /* len */
+    USB_DESC_TYPE_INTERFACE,    /* type */
+    APBRIDGE_LOG_INTERFACEID,   /* ifno */
+    0,                          /* alt */
+    1,                          /* neps */
+    USB_CLASS_VENDOR_SPEC,      /* classid */
+    0,                          /* subclass */
+    0,                          /* protocol */
+    0                           /* iif */
+};
+
+static const struct usb_epdesc_s g_eplogindesc = {
+    USB_SIZEOF_EPDESC,          /* len */
+    USB_DESC_TYPE_ENDPOINT,     /* type */
+    USB_DIR_IN | APBRIDGE_LOG_EPNO,     /* addr */
+    USB_EP_ATTR_XFER_BULK,      /* attr */
+    {LSBYTE(APBRIDGE_BULK_MXPACKET),
+     MSBYTE(APBRIDGE_BULK_MXPACKET)},   /* maxpacket */
+    0                           /* interval */
+};
+#endif
+
+static const struct usb_desc_s *g_usb_desc[APBRIDGE_MAX_ENDPOINTS + 2 +
+                                           APBRIDGE_LOG_NDESCS] = {
     (struct usb_desc_s *) &g_ifdesc,
     NULL,
 };
@@ -457,15 +620,19 @@ int rx_transfer(struct apbridge_dev_s *priv,
     return cb(cportid, (void *)payload, len, priv);
 }
 
-/* Call the offloaded method registered for a particular cportid (AP to APBridge) */
+/*
+ * Call the offloaded method registered for a particular cportid (AP to
+ * APBridge). The request is given as private data so that it can be released
+ * without being looked up.
+ */
 static int tx_transfer(struct apbridge_dev_s *priv,
                        unsigned int cportid,
-                       const void *payload, size_t len)
+                       struct usbdev_req_s *req)
 {
     transfer_cb cb;
 
     cb = priv->tx_transfer[cportid];
-    return cb(cportid, (void *)payload, len, priv);
+    return cb(cportid, req->buf, req->xfrd, req);
 }
 
 int register_cport_callback(struct apbridge_dev_s *priv, unsigned int cportid,
@@ -582,11 +749,45 @@ static int map_table_init(struct apbridge_dev_s *priv)
         priv->cport_to_epin_n[i] = CONFIG_APBRIDGE_EPBULKIN;
     }
 
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    priv->cport_in_bytes = kmm_zalloc(sizeof(uint32_t) * cport_count);
+    if (!priv->cport_in_bytes) {
+        goto errout_with_epin;
+    }
+#endif
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    priv->cport_in_last = kmm_zalloc(sizeof(uint32_t) * cport_count);
+    if (!priv->cport_in_last) {
+        goto errout_with_stats;
+    }
+
+    for (i = 0; i < APBRIDGE_NBULKS; i++) {
+        priv->ep_auto_cport[i] = -1;
+    }
+#endif
+
     return 0;
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+errout_with_stats:
+#endif
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    kmm_free(priv->cport_in_bytes);
+errout_with_epin:
+    kmm_free(priv->cport_to_epin_n);
+    return -ENOMEM;
+#endif
 }
 
 static void map_table_free(struct apbridge_dev_s *priv)
 {
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    kmm_free(priv->cport_in_last);
+#endif
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    kmm_free(priv->cport_in_bytes);
+#endif
     kmm_free(priv->cport_to_epin_n);
 }
 
@@ -639,6 +840,9 @@ static int ep_add_requests(struct apbridge_dev_s *priv,
     for (i = 0; i < n; i++) {
         req = get_request(ep, bulk_out_complete,
                           APBRIDGE_REQ_SIZE, NULL);
+        if (!req) {
+            return -ENOMEM;
+        }
         request_set_priv(req, req->buf);
         ret = EP_SUBMIT(ep, req);
 
@@ -673,6 +877,82 @@ static int ep_set_requests_count(struct apbridge_dev_s *priv,
     return 0;
 }
 
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+static void ep_auto_reset(struct apbridge_dev_s *priv)
+{
+    int i;
+
+    for (i = 0; i < APBRIDGE_NBULKS; i++) {
+        priv->req_busy[i] = 0;
+        priv->req_busy_max[i] = 0;
+        priv->req_window[i] = 0;
+        priv->req_auto[i] = true;
+    }
+}
+
+/*
+ * Return the number of bulk out requests allocated, or going to be,
+ * by all the endpoints.
+ */
+static int ep_auto_total(struct apbridge_dev_s *priv)
+{
+    int i;
+    int total = 0;
+
+    for (i = 0; i < APBRIDGE_NBULKS; i++)
+        total += max(priv->req_count[i], priv->req_new_count[i]);
+
+    return total;
+}
+
+/*
+ * Called from bulk_out_complete, once the completed request has been
+ * accounted as busy.
+ * If there is no more request queued to USB, the host is being NAKed
+ * until UniPro gives one back: add a request, within the budget.
+ * If the endpoint never used all its requests during the last
+ * sampling window, drop one. The request will be deleted by
+ * usb_release_request().
+ */
+static void ep_auto_tune(struct apbridge_dev_s *priv, struct usbdev_ep_s *ep)
+{
+    int n = BULKEP_TO_N(ep);
+    uint8_t busy = priv->req_busy[n];
+
+    if (!priv->req_auto[n]) {
+        return;
+    }
+
+    if (busy > priv->req_busy_max[n]) {
+        priv->req_busy_max[n] = busy;
+    }
+
+    if (busy >= priv->req_count[n] &&
+        request_count_changed(priv, ep) == 0 &&
+        priv->req_new_count[n] < CONFIG_APBRIDGE_AUTO_REQ_MAX &&
+        ep_auto_total(priv) < priv->req_budget) {
+        priv->req_new_count[n]++;
+        priv->req_window[n] = 0;
+        priv->req_busy_max[n] = 0;
+        if (ep_add_requests(priv, ep)) {
+            priv->req_new_count[n] = priv->req_count[n];
+        }
+        return;
+    }
+
+    if (++priv->req_window[n] < CONFIG_APBRIDGE_AUTO_REQ_WINDOW) {
+        return;
+    }
+
+    if (priv->req_busy_max[n] + 1 < priv->req_new_count[n] &&
+        priv->req_new_count[n] > CONFIG_APBRIDGE_AUTO_REQ_MIN) {
+        priv->req_new_count[n]--;
+    }
+    priv->req_window[n] = 0;
+    priv->req_busy_max[n] = 0;
+}
+#endif
+
 static int set_request_count_vendor_request_out(struct usbdev_s *dev,
                                                 uint8_t req,
                                                 uint16_t index, uint16_t value,
@@ -687,47 +967,85 @@ static int set_request_count_vendor_request_out(struct usbdev_s *dev,
     priv = usbdev_to_apbridge(dev);
     ep = priv->ep[CONFIG_APBRIDGE_EPBULKOUT + index * 2];
 
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+    /* The host knows better: stop tuning this endpoint */
+    priv->req_auto[BULKEP_TO_N(ep)] = false;
+#endif
+
     return ep_set_requests_count(priv, ep, value);
 }
 
+static void apbridge_queue_init(struct apbridge_dev_s *priv)
+{
+    struct apbridge_msg_ring *ring = &priv->msg_queue;
+    int i;
+
+    atomic_init(&ring->tail, 0);
+    ring->head = 0;
+    for (i = 0; i < CONFIG_APBRIDGE_MSG_QUEUE_SIZE; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+}
+
 static int apbridge_queue(struct apbridge_dev_s *priv, struct usbdev_ep_s *ep,
                           const void *payload, size_t len, void *data)
 {
-    irqstate_t flags;
-    struct apbridge_msg_s *info;
+    struct apbridge_msg_ring *ring = &priv->msg_queue;
+    struct apbridge_msg_slot *slot;
+    uint32_t pos;
+    int diff;
+
+    pos = atomic_get(&ring->tail);
+    for (;;) {
+        slot = &ring->slots[pos & APBRIDGE_MSG_QUEUE_MASK];
+        diff = (int) (atomic_get(&slot->seq) - pos);
+        if (diff < 0) {
+            /* The consumer has not released this slot yet */
+            return -ENOMEM;
+        }
 
-    info = malloc(sizeof(*info));
-    if (!info) {
-        return -ENOMEM;
+        if (diff == 0) {
+            uint32_t prev = atomic_cmpxchg(&ring->tail, pos, pos + 1);
+            if (prev == pos) {
+                break;
+            }
+            pos = prev;
+        } else {
+            pos = atomic_get(&ring->tail);
+        }
     }
 
-    info->ep = ep;
-    info->buf = payload;
-    info->len = len;
-    info->priv = data;
+    slot->msg.ep = ep;
+    slot->msg.buf = payload;
+    slot->msg.len = len;
+    slot->msg.priv = data;
 
-    flags = irqsave();
-    list_add(&priv->msg_queue, &info->list);
-    irqrestore(flags);
+    atomic_barrier();
+    atomic_init(&slot->seq, pos + 1);
 
     return OK;
 }
 
-static struct apbridge_msg_s *apbridge_dequeue(struct apbridge_dev_s *priv)
+static bool apbridge_dequeue(struct apbridge_dev_s *priv,
+                             struct apbridge_msg_s *msg)
 {
-    irqstate_t flags;
-    struct list_head *list;
+    struct apbridge_msg_ring *ring = &priv->msg_queue;
+    struct apbridge_msg_slot *slot;
+    uint32_t pos = ring->head;
 
-    flags = irqsave();
-    if (list_is_empty(&priv->msg_queue)) {
-        irqrestore(flags);
-        return NULL;
+    slot = &ring->slots[pos & APBRIDGE_MSG_QUEUE_MASK];
+    if (atomic_get(&slot->seq) != pos + 1) {
+        return false;
     }
 
-    list = priv->msg_queue.next;
-    list_del(list);
-    irqrestore(flags);
-    return list_entry(list, struct apbridge_msg_s, list);
+    atomic_barrier();
+    *msg = slot->msg;
+    atomic_barrier();
+
+    atomic_init(&slot->seq, pos + CONFIG_APBRIDGE_MSG_QUEUE_SIZE);
+    ring->head = pos + 1;
+
+    return true;
 }
 
 void set_cport_id(struct usbdev_ep_s *ep, struct usbdev_req_s *req,
@@ -736,6 +1054,16 @@ void set_cport_id(struct usbdev_ep_s *ep, struct usbdev_req_s *req,
     struct gb_operation_hdr *hdr;
     uint8_t epno = USB_EPNO(ep->eplog);
 
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    /*
+     * The host doesn't know which cport the policy moved to a dedicated
+     * endpoint, so always tag the messages.
+     */
+    if (ep_to_apbridge(ep)->auto_map) {
+        epno = CONFIG_APBRIDGE_EPBULKIN;
+    }
+#endif
+
     if (epno == CONFIG_APBRIDGE_EPBULKIN) {
         hdr = (struct gb_operation_hdr *)req->buf;
         hdr->pad[0] = cportid & 0xff;
@@ -772,14 +1100,362 @@ static int _to_usb_submit(struct usbdev_ep_s *ep, struct usbdev_req_s *req,
 
     /* Then submit the request to the endpoint */
 
-    ret = EP_SUBMIT(ep, req);
-    if (ret != OK) {
-        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_SUBMITFAIL), (uint16_t) - ret);
-        return ret;
+    ret = EP_SUBMIT(ep, req);
+    if (ret != OK) {
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_SUBMITFAIL), (uint16_t) - ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_APBRIDGE_EP_STATS
+static void ep_stats_in(void *priv, struct usbdev_ep_s *ep,
+                        unsigned int cportid, size_t len)
+{
+    struct apbridge_dev_s *dev = priv;
+    irqstate_t flags;
+
+    flags = irqsave();
+    dev->ep_stats[BULKEP_TO_N(ep)].in_bytes += len;
+    dev->ep_stats[BULKEP_TO_N(ep)].in_msgs++;
+    dev->cport_in_bytes[cportid] += len;
+    irqrestore(flags);
+}
+#endif
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+/* Only change the APBridge to AP direction, the host chooses the other one */
+static void ep_auto_map_cport(struct apbridge_dev_s *priv,
+                              unsigned int cportid, int n)
+{
+    uint8_t epno = CONFIG_APBRIDGE_EPBULKIN + n * 2;
+
+    cportid_set_epno(priv, epno, cportid);
+    unipro_cport_mapping(cportid, n == APBRIDGE_MUXED_BULK_EP ?
+                                  MULTIPLEXED_EP : DIRECT_EP);
+}
+
+static void ep_auto_unmap_all(struct apbridge_dev_s *priv)
+{
+    int i;
+
+    for (i = 0; i < APBRIDGE_NBULKS; i++) {
+        if (priv->ep_auto_cport[i] >= 0) {
+            ep_auto_map_cport(priv, priv->ep_auto_cport[i],
+                              APBRIDGE_MUXED_BULK_EP);
+            priv->ep_auto_cport[i] = -1;
+        }
+    }
+}
+
+/*
+ * A mapping requested by the host overrides the policy: give back the
+ * endpoint if the policy was using it, and forget the cport.
+ */
+static void ep_auto_host_mapping(struct apbridge_dev_s *priv,
+                                 unsigned int cportid, uint8_t epno)
+{
+    int i;
+    int n = BULKEPNO_TO_N(epno);
+    int old = BULKEPNO_TO_N(priv->cport_to_epin_n[cportid] & USB_EPNO_MASK);
+
+    for (i = 1; i < APBRIDGE_NBULKS; i++) {
+        if (priv->ep_auto_cport[i] == cportid) {
+            priv->ep_auto_cport[i] = -1;
+            old = APBRIDGE_MUXED_BULK_EP;
+        }
+    }
+
+    /* The endpoint previously given to this cport by the host is free */
+    if (old != APBRIDGE_MUXED_BULK_EP && old < APBRIDGE_NBULKS) {
+        priv->ep_host_mapped[old] = false;
+    }
+
+    if (n == APBRIDGE_MUXED_BULK_EP || n >= APBRIDGE_NBULKS) {
+        return;
+    }
+
+    if (priv->ep_auto_cport[n] >= 0) {
+        ep_auto_map_cport(priv, priv->ep_auto_cport[n],
+                          APBRIDGE_MUXED_BULK_EP);
+        priv->ep_auto_cport[n] = -1;
+    }
+    priv->ep_host_mapped[n] = true;
+}
+
+/*
+ * Give the free dedicated bulk in endpoints to the cports sending the most
+ * data to the AP. A cport keeps its endpoint as long as its rate stays
+ * above half the threshold, to avoid moving cports back and forth.
+ */
+static void ep_auto_map_worker(void *arg)
+{
+    struct apbridge_dev_s *priv = arg;
+    unsigned int cport_count = unipro_cport_count();
+    uint32_t threshold;
+    uint32_t best_rate;
+    uint32_t *rate;
+    struct usbdev_ep_s *ep;
+    irqstate_t flags;
+    int best;
+    int i, j;
+
+    if (!priv->auto_map) {
+        ep_auto_unmap_all(priv);
+        return;
+    }
+
+    rate = kmm_malloc(sizeof(uint32_t) * cport_count);
+    if (!rate) {
+        goto requeue;
+    }
+
+    flags = irqsave();
+    for (i = 0; i < cport_count; i++) {
+        rate[i] = (uint64_t) (priv->cport_in_bytes[i] -
+                              priv->cport_in_last[i]) * 1000 /
+                  CONFIG_APBRIDGE_AUTO_EP_MAPPING_PERIOD_MS;
+        priv->cport_in_last[i] = priv->cport_in_bytes[i];
+    }
+    irqrestore(flags);
+
+    /* Release the endpoints of the cports that calmed down */
+    threshold = CONFIG_APBRIDGE_AUTO_EP_MAPPING_THRESHOLD / 2;
+    for (i = 1; i < APBRIDGE_NBULKS; i++) {
+        if (priv->ep_auto_cport[i] >= 0 &&
+            rate[priv->ep_auto_cport[i]] < threshold) {
+            ep_auto_map_cport(priv, priv->ep_auto_cport[i],
+                              APBRIDGE_MUXED_BULK_EP);
+            priv->ep_auto_cport[i] = -1;
+        }
+    }
+
+    /* Then give the free ones to the heaviest multiplexed cports */
+    threshold = CONFIG_APBRIDGE_AUTO_EP_MAPPING_THRESHOLD;
+    for (i = 1; i < APBRIDGE_NBULKS; i++) {
+        if (priv->ep_host_mapped[i] || priv->ep_auto_cport[i] >= 0) {
+            continue;
+        }
+
+        best = -1;
+        best_rate = threshold;
+        for (j = 0; j < cport_count; j++) {
+            ep = cportid_to_ep(priv, j);
+            if (ep == OFFLOADED_EP ||
+                USB_EPNO(ep->eplog) != CONFIG_APBRIDGE_EPBULKIN) {
+                continue;
+            }
+            if (rate[j] >= best_rate) {
+                best = j;
+                best_rate = rate[j];
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        ep_auto_map_cport(priv, best, i);
+        priv->ep_auto_cport[i] = best;
+    }
+
+    kmm_free(rate);
+
+requeue:
+    work_queue(LPWORK, &priv->auto_map_work, ep_auto_map_worker, priv,
+               MSEC2TICK(CONFIG_APBRIDGE_AUTO_EP_MAPPING_PERIOD_MS));
+}
+#endif
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+/*
+ * Submit the transfer being filled, if any.
+ * Must be called with interrupts disabled.
+ */
+static void agg_flush(struct apbridge_dev_s *priv)
+{
+    int ret;
+    struct apbridge_agg_s *agg = &priv->agg;
+    struct usbdev_req_s *req = agg->req;
+
+    if (!req) {
+        return;
+    }
+
+    wd_cancel(&agg->flush_wd);
+    agg->req = NULL;
+    agg->inflight++;
+
+    req->flags = USBDEV_REQFLAGS_NULLPKT;
+    ret = EP_SUBMIT(priv->ep[CONFIG_APBRIDGE_EPBULKIN], req);
+    if (ret != OK) {
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_SUBMITFAIL), (uint16_t) - ret);
+        agg->inflight--;
+        put_request(req);
+    }
+}
+
+static void agg_timeout(int argc, uint32_t data, ...)
+{
+    irqstate_t flags;
+    struct apbridge_dev_s *priv = (struct apbridge_dev_s *) data;
+
+    flags = irqsave();
+    agg_flush(priv);
+    irqrestore(flags);
+}
+
+/*
+ * Copy a message to the transfer being filled, and release the UniPro
+ * buffer. Return -EAGAIN if all the transfers are in flight.
+ * Must be called with interrupts disabled.
+ */
+static int agg_append(struct apbridge_dev_s *priv, unsigned int cportid,
+                      void *payload, size_t len)
+{
+    struct apbridge_agg_s *agg = &priv->agg;
+    struct apbridge_agg_hdr *hdr;
+    struct usbdev_req_s *req;
+    size_t size = APBRIDGE_AGG_ALIGN(sizeof(*hdr) + len);
+
+    if (agg->req && agg->req->len + size > agg->max_len) {
+        agg_flush(priv);
+    }
+
+    if (!agg->req) {
+        if (agg->inflight >= APBRIDGE_AGG_NREQS) {
+            return -EAGAIN;
+        }
+
+        req = get_request(priv->ep[CONFIG_APBRIDGE_EPBULKIN], agg_complete,
+                          CONFIG_APBRIDGE_BULKIN_AGGREGATION_SIZE, NULL);
+        if (!req) {
+            return -ENOMEM;
+        }
+        req->len = 0;
+        agg->req = req;
+        wd_start(&agg->flush_wd, APBRIDGE_AGG_TIMEOUT, agg_timeout, 1, priv);
+    }
+
+    req = agg->req;
+    hdr = (struct apbridge_agg_hdr *) (req->buf + req->len);
+    hdr->size = cpu_to_le16(len);
+    hdr->cport_id = cpu_to_le16(cportid);
+    memcpy(hdr + 1, payload, len);
+    req->len += size;
+
+    unipro_rxbuf_free(cportid, payload);
+
+    /* Don't wait for the timeout if there is no room for another message */
+    if (agg->max_len - req->len <
+        sizeof(*hdr) + sizeof(struct gb_operation_hdr)) {
+        agg_flush(priv);
+    }
+
+    return 0;
+}
+
+static int agg_rx_transfer(struct apbridge_dev_s *priv, unsigned int cportid,
+                           void *payload, size_t len)
+{
+    int ret = -EAGAIN;
+    irqstate_t flags;
+    struct apbridge_msg_s *info;
+
+    flags = irqsave();
+    /* Keep the messages ordered if some of them are already waiting */
+    if (list_is_empty(&priv->agg.pending)) {
+        ret = agg_append(priv, cportid, payload, len);
+    }
+
+    if (ret == -EAGAIN) {
+        info = malloc(sizeof(*info));
+        if (!info) {
+            irqrestore(flags);
+            return -ENOMEM;
+        }
+
+        info->ep = priv->ep[CONFIG_APBRIDGE_EPBULKIN];
+        info->buf = payload;
+        info->len = len;
+        info->priv = (void *) cportid;
+        list_add(&priv->agg.pending, &info->list);
+        ret = 0;
+    }
+    irqrestore(flags);
+
+    return ret;
+}
+
+static void agg_complete(struct usbdev_ep_s *ep,
+                         struct usbdev_req_s *req)
+{
+    irqstate_t flags;
+    struct apbridge_dev_s *priv;
+    struct apbridge_msg_s *info;
+
+    priv = ep_to_apbridge(ep);
+
+    switch (req->result) {
+    case OK:                   /* Normal completion */
+        usbtrace(TRACE_CLASSWRCOMPLETE, 0);
+        break;
+
+    case -ESHUTDOWN:           /* Disconnection */
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_WRSHUTDOWN), 0);
+        break;
+
+    default:                   /* Some other error occurred */
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_WRUNEXPECTED),
+                 (uint16_t) - req->result);
+        break;
+    }
+
+    flags = irqsave();
+    priv->agg.inflight--;
+    put_request(req);
+
+    while (!list_is_empty(&priv->agg.pending)) {
+        info = list_entry(priv->agg.pending.next, struct apbridge_msg_s, list);
+        if (agg_append(priv, (unsigned int) info->priv,
+                       (void *) info->buf, info->len)) {
+            break;
+        }
+        list_del(&info->list);
+        free(info);
+    }
+    irqrestore(flags);
+}
+
+/*
+ * Drop the transfer being filled and the pending messages.
+ * Called when the configuration is reset.
+ */
+static void agg_reset(struct apbridge_dev_s *priv)
+{
+    irqstate_t flags;
+    struct list_head *iter, *iter_next;
+    struct apbridge_msg_s *info;
+    struct apbridge_agg_s *agg = &priv->agg;
+
+    flags = irqsave();
+    wd_cancel(&agg->flush_wd);
+    agg->max_len = 0;
+    if (agg->req) {
+        put_request(agg->req);
+        agg->req = NULL;
     }
 
-    return 0;
+    list_foreach_safe(&agg->pending, iter, iter_next) {
+        info = list_entry(iter, struct apbridge_msg_s, list);
+        list_del(iter);
+        unipro_rxbuf_free((unsigned int) info->priv, (void *) info->buf);
+        free(info);
+    }
+    irqrestore(flags);
 }
+#endif
 
 /**
  * @brief Send incoming data from unipro to AP module
@@ -800,6 +1476,17 @@ int usb_rx_transfer(unsigned int cportid,
 
     ep = cportid_to_ep(priv, cportid);
 
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    ep_stats_in(priv, ep, cportid, len);
+#endif
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    if (ep == get_apbridge_ep(priv, CONFIG_APBRIDGE_EPBULKIN) &&
+        ((struct apbridge_dev_s *) priv)->agg.max_len) {
+        return agg_rx_transfer(priv, cportid, payload, len);
+    }
+#endif
+
     /* Bulk in request use UniPro buffer so only get a request without buffer */
     req = get_request(ep, bulk_in_complete, 0,
                       (void*) cportid);
@@ -810,19 +1497,23 @@ int usb_rx_transfer(unsigned int cportid,
     return _to_usb_submit(ep, req, cportid, payload, len);
 }
 
-int usb_release_buffer(struct apbridge_dev_s *priv, const void *buf)
+int usb_release_request(struct usbdev_req_s *req)
 {
+    struct apbridge_dev_s *priv;
     struct usbdev_ep_s *ep;
-    struct usbdev_req_s *req;
     int ret = 0;
 
-
-    req = find_request_by_priv(buf);
     if (!req) {
         return -EINVAL;
     }
 
     ep = request_to_ep(req);
+    priv = ep_to_apbridge(ep);
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+    if (priv->req_busy[BULKEP_TO_N(ep)]) {
+        priv->req_busy[BULKEP_TO_N(ep)]--;
+    }
+#endif
     ret = EP_SUBMIT(ep, req);
     if (ret != OK) {
         usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_RDSUBMIT),
@@ -841,6 +1532,11 @@ int usb_release_buffer(struct apbridge_dev_s *priv, const void *buf)
     return ret;
 }
 
+int usb_release_buffer(struct apbridge_dev_s *priv, const void *buf)
+{
+    return usb_release_request(find_request_by_priv(buf));
+}
+
 void map_cport_to_ep(struct apbridge_dev_s *priv,
                      struct cport_to_ep *cport_to_ep)
 {
@@ -904,7 +1600,25 @@ static void usbclass_resetconfig(struct apbridge_dev_s *priv)
 
         for (i = 1; i < APBRIDGE_MAX_ENDPOINTS; i++)
             EP_DISABLE(priv->ep[i]);
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+        usb_log_ep_disable(priv);
+#endif
+    }
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    /* The host has to enable aggregation again */
+    agg_reset(priv);
+#endif
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    /* Same thing for the mapping policy */
+    if (priv->auto_map) {
+        priv->auto_map = false;
+        work_cancel(LPWORK, &priv->auto_map_work);
+        work_queue(LPWORK, &priv->auto_map_work, ep_auto_map_worker, priv, 0);
     }
+#endif
 }
 
 /****************************************************************************
@@ -969,6 +1683,10 @@ static int usbclass_setconfig(struct apbridge_dev_s *priv, uint8_t config)
         }
     }
 
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+    ep_auto_reset(priv);
+#endif
+
     /* Queue read requests in the bulk OUT endpoint */
     for (i = 0; i < APBRIDGE_NBULKS; i++) {
         int count;
@@ -987,6 +1705,13 @@ static int usbclass_setconfig(struct apbridge_dev_s *priv, uint8_t config)
         }
     }
 
+#ifdef CONFIG_APBRIDGE_LOG_EP
+    ret = usb_log_ep_enable(priv);
+    if (ret) {
+        goto errout;
+    }
+#endif
+
     /* We are successfully configured */
 
     priv->config = config;
@@ -1053,8 +1778,19 @@ static void bulk_out_complete(struct usbdev_ep_s *ep,
     case OK:                    /* Normal completion */
         usbtrace(TRACE_CLASSRDCOMPLETE, 0);
         cportid = get_cport_id(priv, ep, req);
-        if (!tx_transfer(priv, cportid, req->buf, req->xfrd))
+#ifdef CONFIG_APBRIDGE_EP_STATS
+        priv->ep_stats[BULKEP_TO_N(ep)].out_bytes += req->xfrd;
+        priv->ep_stats[BULKEP_TO_N(ep)].out_msgs++;
+#endif
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+        priv->req_busy[BULKEP_TO_N(ep)]++;
+        ep_auto_tune(priv, ep);
+#endif
+        if (!tx_transfer(priv, cportid, req))
             return;
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+        priv->req_busy[BULKEP_TO_N(ep)]--;
+#endif
 
     case -ESHUTDOWN:           /* Disconnection */
         usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_RDSHUTDOWN), 0);
@@ -1076,7 +1812,7 @@ static void bulk_out_complete(struct usbdev_ep_s *ep,
 static void bulk_in_complete(struct usbdev_ep_s *ep,
                              struct usbdev_req_s *req)
 {
-    struct apbridge_msg_s *info;
+    struct apbridge_msg_s info;
     struct apbridge_dev_s *priv;
 
     /* Sanity check */
@@ -1087,15 +1823,19 @@ static void bulk_in_complete(struct usbdev_ep_s *ep,
     }
 #endif
 
+#ifdef CONFIG_APBRIDGE_BENCH
+    if (!apbridgea_bench_in_complete((unsigned int) request_get_priv(req),
+                                     req->buf))
+        unipro_rxbuf_free((unsigned int) request_get_priv(req), req->buf);
+#else
     unipro_rxbuf_free((unsigned int) request_get_priv(req), req->buf);
+#endif
 
     priv = ep_to_apbridge(ep);
-    info = apbridge_dequeue(priv);
-    if (info) {
-        request_set_priv(req, info->priv);
-        _to_usb_submit(info->ep, req,
-                       (unsigned int)info->priv, info->buf, info->len);
-        free(info);
+    if (apbridge_dequeue(priv, &info)) {
+        request_set_priv(req, info.priv);
+        _to_usb_submit(info.ep, req,
+                       (unsigned int)info.priv, info.buf, info.len);
     } else {
         put_request(req);
     }
@@ -1176,6 +1916,11 @@ static void g_usbdesc_init(void) {
         usbdesc->addr += i * 2;
         g_usb_desc[i * 2 + CONFIG_APBRIDGE_EPBULKIN] = (struct usb_desc_s *)usbdesc;
     }
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+    g_usb_desc[APBRIDGE_NENDPOINTS + 1] = (struct usb_desc_s *)&g_logifdesc;
+    g_usb_desc[APBRIDGE_NENDPOINTS + 2] = (struct usb_desc_s *)&g_eplogindesc;
+#endif
 }
 
 /****************************************************************************
@@ -1209,8 +1954,12 @@ static int usbclass_bind(struct usbdevclass_driver_s *driver,
     gadget_set_strings(priv->g_desc, g_strings_table);
     /* Allocate endpoints */
 
-    for (i = 0; i < APBRIDGE_MAX_ENDPOINTS; i++) {
-        ret = allocep(priv, (struct usb_epdesc_s *)g_usb_desc[i + 1]);
+    ret = allocep(priv, NULL);
+    if (ret < 0)
+        goto error;
+
+    for (i = 1; i <= APBRIDGE_NENDPOINTS; i++) {
+        ret = allocep(priv, (struct usb_epdesc_s *)g_usb_desc[i]);
         if (ret < 0)
             goto error;
     }
@@ -1222,11 +1971,31 @@ static int usbclass_bind(struct usbdevclass_driver_s *driver,
      * logic where kmm_malloc calls will fail.
      */
     n = unipro_cport_count() + APBRIDGE_NREQS_DEDICATED * (APBRIDGE_NBULKS - 1);
+#ifdef CONFIG_APBRIDGE_AUTO_REQ_COUNT
+    /*
+     * Requests are added from bulk_out_complete, where kmm_malloc can't be
+     * used, so the whole budget has to be preallocated.
+     */
+    priv->req_budget = max(n, CONFIG_APBRIDGE_AUTO_REQ_BUDGET);
+    n = priv->req_budget;
+#endif
     request_pool_prealloc(priv->ep[0], APBRIDGE_MXDESCLEN, 1);
     request_pool_prealloc(priv->ep[CONFIG_APBRIDGE_EPBULKOUT],
                           APBRIDGE_REQ_SIZE, n);
     /* Bulk in request use UniPro buffer so only get a request without buffer */
     request_pool_prealloc(priv->ep[CONFIG_APBRIDGE_EPBULKIN], 0, n);
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    /* Aggregated transfers need their own buffer */
+    request_pool_prealloc(priv->ep[CONFIG_APBRIDGE_EPBULKIN],
+                          CONFIG_APBRIDGE_BULKIN_AGGREGATION_SIZE,
+                          APBRIDGE_AGG_NREQS);
+#endif
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+    ret = usb_log_ep_bind(priv);
+    if (ret < 0)
+        goto error;
+#endif
 
     /* TODO test result of prealloc */
 
@@ -1299,6 +2068,9 @@ static void usbclass_unbind(struct usbdevclass_driver_s *driver,
         for (i = 0; i < APBRIDGE_MAX_ENDPOINTS; i++) {
             freeep(priv, i);
         }
+#ifdef CONFIG_APBRIDGE_LOG_EP
+        usb_log_ep_unbind(priv);
+#endif
 
         gadget_descriptor_free(priv->g_desc);
     }
@@ -1307,6 +2079,10 @@ static void usbclass_unbind(struct usbdevclass_driver_s *driver,
 #if defined(CONFIG_APB_USB_LOG)
 static struct log_buffer *g_lb;
 
+#ifdef CONFIG_APBRIDGE_LOG_EP
+static void usb_log_ep_kick(struct apbridge_dev_s *priv);
+#endif
+
 static ssize_t usb_log_read(struct file *filep, char *buffer, size_t buflen)
 {
     return 0;
@@ -1315,7 +2091,21 @@ static ssize_t usb_log_read(struct file *filep, char *buffer, size_t buflen)
 static ssize_t usb_log_write(struct file *filep, const char *buffer,
                                  size_t buflen)
 {
-    return log_buffer_write(g_lb, buffer, buflen);
+    irqstate_t flags;
+    size_t ret;
+
+    /* usb_putc() may be called from any context, keep a single writer */
+    flags = irqsave();
+    ret = log_buffer_write(g_lb, buffer, buflen);
+    irqrestore(flags);
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+    /* The endpoint only sends whole lines, wait for the end of one */
+    if (memchr(buffer, '\n', buflen))
+        usb_log_ep_kick(g_apbridge_dev);
+#endif
+
+    return ret;
 }
 
 static const struct file_operations usb_log_ops = {
@@ -1323,36 +2113,245 @@ static const struct file_operations usb_log_ops = {
     .write = usb_log_write,
 };
 
+/*
+ * /dev/usblog gives each open its own cursor in the USB log buffer, so it
+ * can be read (e.g. with "cat" from NSH) without taking the data away from
+ * the log vendor request.
+ */
+static int usb_log_reader_open(struct file *filep)
+{
+    struct log_buffer_reader *rd;
+
+    rd = kmm_malloc(sizeof(*rd));
+    if (!rd)
+        return -ENOMEM;
+
+    log_buffer_reader_init(g_lb, rd);
+    filep->f_priv = rd;
+    return 0;
+}
+
+static int usb_log_reader_close(struct file *filep)
+{
+    kmm_free(filep->f_priv);
+    return 0;
+}
+
+static ssize_t usb_log_reader_read(struct file *filep, char *buffer,
+                                   size_t buflen)
+{
+    return log_buffer_reader_readlines(filep->f_priv, buffer, buflen);
+}
+
+static const struct file_operations usb_log_reader_ops = {
+    .open = usb_log_reader_open,
+    .close = usb_log_reader_close,
+    .read = usb_log_reader_read,
+};
+
 void usb_log_init(void)
 {
     g_lb = log_buffer_alloc(CONFIG_USB_LOG_BUFFER_SIZE);
-    if (g_lb)
+    if (g_lb) {
         register_driver("/dev/console", &usb_log_ops,
                         CONFIG_USB_LOG_BUFFER_SIZE, NULL);
+        register_driver("/dev/usblog", &usb_log_reader_ops, 0444, NULL);
+    }
 }
 
 void usb_putc(int c)
 {
-    if (g_lb)
+    irqstate_t flags;
+
+    if (g_lb) {
+        flags = irqsave();
         log_buffer_write(g_lb, &c, 1);
+        irqrestore(flags);
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+        if (c == '\n')
+            usb_log_ep_kick(g_apbridge_dev);
+#endif
+    }
 }
 
 int usb_get_log(void *buf, int len)
 {
     return log_buffer_readlines(g_lb, buf, len);
 }
+
+#ifdef CONFIG_APBRIDGE_LOG_EP
+/*
+ * The log endpoint gets at most CONFIG_APBRIDGE_LOG_EP_NREQS transfers of
+ * CONFIG_APBRIDGE_LOG_EP_REQ_SIZE bytes, and only while there are lines to
+ * send, so that the host controller keeps most of the bus time for the
+ * Greybus endpoints. The transfers are filled from the low priority work
+ * queue, the only reader of priv->log_reader.
+ */
+static void usb_log_ep_complete(struct usbdev_ep_s *ep,
+                                struct usbdev_req_s *req)
+{
+    irqstate_t flags;
+    struct apbridge_dev_s *priv = ep_to_apbridge(ep);
+
+    switch (req->result) {
+    case OK:                   /* Normal completion */
+        usbtrace(TRACE_CLASSWRCOMPLETE, 0);
+        break;
+
+    case -ESHUTDOWN:           /* Disconnection */
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_WRSHUTDOWN), 0);
+        break;
+
+    default:                   /* Some other error occurred */
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_WRUNEXPECTED),
+                 (uint16_t) - req->result);
+        break;
+    }
+
+    flags = irqsave();
+    put_request(req);
+    priv->log_inflight--;
+    irqrestore(flags);
+
+    /* Some lines may have been written while the transfer was in flight */
+    usb_log_ep_kick(priv);
+}
+
+static void usb_log_ep_worker(void *arg)
+{
+    struct apbridge_dev_s *priv = arg;
+    struct usbdev_req_s *req;
+    irqstate_t flags;
+    size_t len;
+    int ret;
+
+    while (priv->log_enabled &&
+           priv->log_inflight < CONFIG_APBRIDGE_LOG_EP_NREQS) {
+        req = get_request(priv->log_ep, usb_log_ep_complete,
+                          CONFIG_APBRIDGE_LOG_EP_REQ_SIZE, NULL);
+        if (!req)
+            return;
+
+        len = log_buffer_reader_readlines(&priv->log_reader, req->buf,
+                                          CONFIG_APBRIDGE_LOG_EP_REQ_SIZE);
+        if (!len) {
+            put_request(req);
+            return;
+        }
+
+        req->len = len;
+        req->flags = USBDEV_REQFLAGS_NULLPKT;
+
+        flags = irqsave();
+        priv->log_inflight++;
+        irqrestore(flags);
+
+        ret = EP_SUBMIT(priv->log_ep, req);
+        if (ret != OK) {
+            usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_SUBMITFAIL),
+                     (uint16_t) - ret);
+            flags = irqsave();
+            priv->log_inflight--;
+            put_request(req);
+            irqrestore(flags);
+            return;
+        }
+    }
+}
+
+static void usb_log_ep_kick(struct apbridge_dev_s *priv)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    if (priv && priv->log_enabled && work_available(&priv->log_work))
+        work_queue(LPWORK, &priv->log_work, usb_log_ep_worker, priv, 0);
+    irqrestore(flags);
+}
+
+static int usb_log_ep_bind(struct apbridge_dev_s *priv)
+{
+    struct usbdev_ep_s *ep;
+
+    /* Without a log buffer the interface is still there, but stays idle */
+    if (g_lb)
+        log_buffer_reader_init(g_lb, &priv->log_reader);
+
+    ep = DEV_ALLOCEP(priv->usbdev, APBRIDGE_LOG_EPNO, true,
+                     USB_EP_ATTR_XFER_BULK);
+    if (!ep) {
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_EPINTINALLOCFAIL), 0);
+        return -ENODEV;
+    }
+
+    ep->priv = priv;
+    priv->log_ep = ep;
+
+    return request_pool_prealloc(ep, CONFIG_APBRIDGE_LOG_EP_REQ_SIZE,
+                                 CONFIG_APBRIDGE_LOG_EP_NREQS);
+}
+
+static void usb_log_ep_unbind(struct apbridge_dev_s *priv)
+{
+    if (priv->log_ep) {
+        DEV_FREEEP(priv->usbdev, priv->log_ep);
+        priv->log_ep = NULL;
+    }
+}
+
+static int usb_log_ep_enable(struct apbridge_dev_s *priv)
+{
+    struct usb_epdesc_s epdesc;
+    uint16_t mxpacket;
+    int ret;
+
+    if (priv->usbdev->speed == USB_SPEED_HIGH) {
+        mxpacket = APBRIDGE_BULK_MXPACKET;
+    } else {
+        mxpacket = 64;
+    }
+
+    usbclass_mkepdesc(&g_eplogindesc, mxpacket, &epdesc);
+    ret = EP_CONFIGURE(priv->log_ep, &epdesc, false);
+    if (ret < 0) {
+        usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_EPINTINCONFIGFAIL), 0);
+        return ret;
+    }
+
+    /* Send what was logged while the host was away */
+    priv->log_enabled = g_lb != NULL;
+    usb_log_ep_kick(priv);
+
+    return 0;
+}
+
+/*
+ * Disabling the endpoint gives back the transfers in flight, the lines they
+ * held are lost.
+ */
+static void usb_log_ep_disable(struct apbridge_dev_s *priv)
+{
+    priv->log_enabled = false;
+    work_cancel(LPWORK, &priv->log_work);
+    EP_DISABLE(priv->log_ep);
+}
+#endif
 #endif
 
 static int greybus_log_vendor_request_in(struct usbdev_s *dev, uint8_t req,
                                          uint16_t index, uint16_t value,
                                          void *buf, uint16_t len)
 {
-    int ret;
+    int ret = 0;
 
+    /* The deferred syslog messages are formatted here, on demand */
+#if defined(CONFIG_BINLOG)
+    ret = binlog_read(buf, len);
+#endif
 #if defined(CONFIG_APB_USB_LOG)
-    ret = usb_get_log(buf, len);
-#else
-    ret = 0;
+    if (ret <= 0)
+        ret = usb_get_log(buf, len);
 #endif
 
     return ret;
@@ -1371,10 +2370,101 @@ static int ep_mapping_vendor_request_out(struct usbdev_s *dev, uint8_t req,
         return -EBUSY;
     }
 
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    ep_auto_host_mapping(priv, cportid,
+                         ((struct cport_to_ep *)buf)->endpoint_in);
+#endif
+
     map_cport_to_ep(usbdev_to_apbridge(dev), (struct cport_to_ep *)buf);
     return len;
 }
 
+#ifdef CONFIG_APBRIDGE_EP_STATS
+/* Return the traffic counters of each bulk endpoint pair */
+static int ep_stats_vendor_request_in(struct usbdev_s *dev, uint8_t req,
+                                      uint16_t index, uint16_t value,
+                                      void *buf, uint16_t len)
+{
+    int i;
+    irqstate_t flags;
+    struct ep_stats_response *response = buf;
+    struct apbridge_dev_s *priv = usbdev_to_apbridge(dev);
+
+    if (len < sizeof(*response) * APBRIDGE_NBULKS) {
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+    for (i = 0; i < APBRIDGE_NBULKS; i++) {
+        response[i].in_bytes = cpu_to_le32(priv->ep_stats[i].in_bytes);
+        response[i].in_msgs = cpu_to_le32(priv->ep_stats[i].in_msgs);
+        response[i].out_bytes = cpu_to_le32(priv->ep_stats[i].out_bytes);
+        response[i].out_msgs = cpu_to_le32(priv->ep_stats[i].out_msgs);
+    }
+    irqrestore(flags);
+
+    return sizeof(*response) * APBRIDGE_NBULKS;
+}
+#endif
+
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+/* value is 1 to enable the policy, or 0 to disable it */
+static int auto_ep_mapping_vendor_request_out(struct usbdev_s *dev,
+                                              uint8_t req,
+                                              uint16_t index, uint16_t value,
+                                              void *buf, uint16_t len)
+{
+    irqstate_t flags;
+    struct apbridge_dev_s *priv = usbdev_to_apbridge(dev);
+
+    work_cancel(LPWORK, &priv->auto_map_work);
+
+    flags = irqsave();
+    priv->auto_map = !!value;
+    memcpy(priv->cport_in_last, priv->cport_in_bytes,
+           sizeof(uint32_t) * unipro_cport_count());
+    irqrestore(flags);
+
+    return work_queue(LPWORK, &priv->auto_map_work, ep_auto_map_worker, priv,
+                      value ?
+                      MSEC2TICK(CONFIG_APBRIDGE_AUTO_EP_MAPPING_PERIOD_MS) :
+                      0);
+}
+#endif
+
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+/*
+ * Enable aggregation on the multiplexed bulk in endpoint.
+ * value is the maximum size of a transfer, 0 to disable aggregation.
+ */
+static int bulkin_aggregation_vendor_request_out(struct usbdev_s *dev,
+                                                 uint8_t req,
+                                                 uint16_t index,
+                                                 uint16_t value,
+                                                 void *buf, uint16_t len)
+{
+    irqstate_t flags;
+    struct apbridge_dev_s *priv = usbdev_to_apbridge(dev);
+
+    /* A transfer must be able to hold the biggest message */
+    if (value && value < sizeof(struct apbridge_agg_hdr) + APBRIDGE_REQ_SIZE) {
+        return -EINVAL;
+    }
+
+    flags = irqsave();
+    if (!value && !list_is_empty(&priv->agg.pending)) {
+        irqrestore(flags);
+        return -EBUSY;
+    }
+
+    agg_flush(priv);
+    priv->agg.max_len = min(value, CONFIG_APBRIDGE_BULKIN_AGGREGATION_SIZE);
+    irqrestore(flags);
+
+    return 0;
+}
+#endif
+
 #ifdef CONFIG_ARCH_CHIP_DEVICE_CSI
 static int csi_tx_control_vendor_request_out(struct usbdev_s *dev, uint8_t req,
                                              uint16_t index, uint16_t value,
@@ -1573,6 +2663,14 @@ static int usbclass_setup(struct usbdevclass_driver_s *driver,
                             usbclass_setconfig(priv, priv->config);
                             ret = 0;
                         }
+#ifdef CONFIG_APBRIDGE_LOG_EP
+                        /* The log interface has no alternate setting */
+                        if (priv->config == APBRIDGE_CONFIGID &&
+                            index == APBRIDGE_LOG_INTERFACEID &&
+                            value == 0) {
+                            ret = 0;
+                        }
+#endif
                     }
                 }
                 break;
@@ -1582,7 +2680,7 @@ static int usbclass_setup(struct usbdevclass_driver_s *driver,
                     if (ctrl->type ==
                         (USB_DIR_IN | USB_REQ_RECIPIENT_INTERFACE)
                         && priv->config == APBRIDGE_CONFIGIDNONE) {
-                        if (index != APBRIDGE_INTERFACEID) {
+                        if (index >= APBRIDGE_NINTERFACES) {
                             ret = -EDOM;
                         } else {
                             *(uint8_t *) req->buf =
@@ -1705,6 +2803,23 @@ int usbdev_apbinitialize(struct device *dev)
     if (register_vendor_request(APBRIDGE_RWREQUEST_EP_MAPPING, VENDOR_REQ_DATA,
                                 ep_mapping_vendor_request_out))
         goto errout_vendor_req;
+#ifdef CONFIG_APBRIDGE_EP_STATS
+    if (register_vendor_request(APBRIDGE_ROREQUEST_EP_STATS, VENDOR_REQ_IN,
+                                ep_stats_vendor_request_in))
+        goto errout_vendor_req;
+#endif
+#ifdef CONFIG_APBRIDGE_AUTO_EP_MAPPING
+    if (register_vendor_request(APBRIDGE_WOREQUEST_AUTO_EP_MAPPING,
+                                VENDOR_REQ_OUT,
+                                auto_ep_mapping_vendor_request_out))
+        goto errout_vendor_req;
+#endif
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    if (register_vendor_request(APBRIDGE_WOREQUEST_BULKIN_AGGREGATION,
+                                VENDOR_REQ_OUT,
+                                bulkin_aggregation_vendor_request_out))
+        goto errout_vendor_req;
+#endif
 #ifdef CONFIG_ARCH_CHIP_DEVICE_CSI
     if (register_vendor_request(APBRIDGE_RWREQUEST_CSI_TX_CONTROL, VENDOR_REQ_DATA,
                                 csi_tx_control_vendor_request_out))
@@ -1760,7 +2875,11 @@ int usbdev_apbinitialize(struct device *dev)
     }
 
     sem_init(&priv->config_sem, 0, 0);
-    list_init(&priv->msg_queue);
+    apbridge_queue_init(priv);
+#ifdef CONFIG_APBRIDGE_BULKIN_AGGREGATION
+    list_init(&priv->agg.pending);
+    wd_static(&priv->agg.flush_wd);
+#endif
 
     /* Initialize the USB class driver structure */
 
@@ -59,9 +59,13 @@ struct cport_reset_priv {
     atomic_t refcount;
 };
 
+/*
+ * The USB OUT request buffer is sent as is, so the request is only given
+ * back to its endpoint once the UniPro TX is done with it.
+ */
 static int release_buffer(int status, const void *buf, void *priv)
 {
-    return usb_release_buffer(priv, buf);
+    return usb_release_request(priv);
 }
 
 int recv_from_unipro(unsigned int cportid, void *buf, size_t len)
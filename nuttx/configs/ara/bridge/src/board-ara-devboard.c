@@ -140,33 +140,71 @@ static struct device_table bdb_device_table = {
     .device_count = ARRAY_SIZE(devices),
 };
 
-static void bdb_driver_register(void)
-{
 #ifdef CONFIG_ARA_BRIDGE_HAVE_USB4624
-    extern struct device_driver usb4624_driver;
-    device_register_driver(&usb4624_driver);
+extern struct device_driver usb4624_driver;
 #endif
 #ifdef CONFIG_ARA_BRIDGE_HAVE_USB3813
-    extern struct device_driver usb3813_driver;
-    device_register_driver(&usb3813_driver);
+extern struct device_driver usb3813_driver;
 #endif
 #ifdef CONFIG_ARA_BRIDGE_HAVE_POWER_SUPPLY
-    extern struct device_driver power_supply_driver;
-    device_register_driver(&power_supply_driver);
+extern struct device_driver power_supply_driver;
 #endif
 #ifdef CONFIG_ARA_BRIDGE_HAVE_HID_DEVICE
-    extern struct device_driver hid_dev_driver;
-    device_register_driver(&hid_dev_driver);
+extern struct device_driver hid_dev_driver;
 #endif
 #ifdef CONFIG_ARA_BRIDGE_HAVE_LIGHTS
-    extern struct device_driver lights_driver;
-    device_register_driver(&lights_driver);
+extern struct device_driver lights_driver;
 #endif
 #ifdef CONFIG_ARCH_CHIP_DEVICE_SDIO
-    extern struct device_driver sdio_board_driver;
-    device_register_driver(&sdio_board_driver);
+extern struct device_driver sdio_board_driver;
 #endif
 
+/*
+ * Drivers probed at boot. The HSIC hubs are independent of each other and
+ * can be probed in parallel.
+ */
+static const struct device_probe_entry bdb_drivers[] = {
+#ifdef CONFIG_ARA_BRIDGE_HAVE_USB4624
+    { &usb4624_driver, NULL },
+#endif
+#ifdef CONFIG_ARA_BRIDGE_HAVE_USB3813
+    { &usb3813_driver, NULL },
+#endif
+};
+
+/*
+ * Drivers only used through the Greybus CPorts of the manifest. With
+ * CONFIG_DEVICE_DEFERRED_PROBE, they are probed when their CPort driver
+ * opens them, and the ones the manifest does not use once the bridge is up.
+ */
+static struct device_driver *bdb_cport_drivers[] = {
+#ifdef CONFIG_ARA_BRIDGE_HAVE_POWER_SUPPLY
+    &power_supply_driver,
+#endif
+#ifdef CONFIG_ARA_BRIDGE_HAVE_HID_DEVICE
+    &hid_dev_driver,
+#endif
+#ifdef CONFIG_ARA_BRIDGE_HAVE_LIGHTS
+    &lights_driver,
+#endif
+#ifdef CONFIG_ARCH_CHIP_DEVICE_SDIO
+    &sdio_board_driver,
+#endif
+};
+
+static void bdb_driver_register(void)
+{
+    int i;
+
+    device_register_drivers(bdb_drivers, ARRAY_SIZE(bdb_drivers));
+
+    for (i = 0; i < ARRAY_SIZE(bdb_cport_drivers); i++) {
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+        if (!device_defer_driver(bdb_cport_drivers[i]))
+            continue;
+#endif
+        device_register_driver(bdb_cport_drivers[i]);
+    }
 }
 #endif
 
@@ -53,7 +53,8 @@ struct request_pool {
 static LIST_DECLARE(request_pool);
 
 static struct request_pool *get_request_pool(size_t len);
-static void free_request(struct usbdev_ep_s *ep, struct usbdev_req_s *req);
+static void free_request(struct usbdev_ep_s *ep, struct usbdev_req_s *req,
+                         size_t len);
 
 static struct request_pool *request_pool_alloc(size_t len)
 {
@@ -79,7 +80,7 @@ static void request_pool_free(struct request_pool *pool)
 
     list_foreach_safe(&pool->request, iter, next) {
         req_list = list_entry(iter, struct request_list, list);
-        free_request(req_list->ep, req_list->req);
+        free_request(req_list->ep, req_list->req, req_list->len);
         list_del(&req_list->list);
         kmm_free(req_list);
     }
@@ -124,9 +125,13 @@ static struct usbdev_req_s *alloc_request(struct usbdev_ep_s *ep,
 
     req->buf = NULL;
 
-    /* Only allocate request buffer for OUT requests */
-    if (len && ep->eplog % 2 == 0) {
-        req->buf = bufram_page_alloc(bufram_size_to_page_count(len));
+    /*
+     * Bulk in requests are given the UniPro buffers and get a zero length,
+     * any other request gets its own buffer.
+     */
+    if (len) {
+        req->buf = bufram_page_alloc_owner(bufram_size_to_page_count(len),
+                                           BUFRAM_OWNER_USB);
         if (!req->buf) {
             EP_FREEREQ(ep, req);
             return NULL;
@@ -137,14 +142,17 @@ static struct usbdev_req_s *alloc_request(struct usbdev_ep_s *ep,
     return req;
 }
 
-static void free_request(struct usbdev_ep_s *ep, struct usbdev_req_s *req)
+static void free_request(struct usbdev_ep_s *ep, struct usbdev_req_s *req,
+                         size_t len)
 {
     if (!req)
         return;
 
     if (req->buf != NULL) {
-        if (ep->eplog % 2 == 0) /* free only OUT requests */
-            bufram_page_free(req->buf, bufram_size_to_page_count(req->len));
+        if (len) /* the buffer belongs to the request */
+            bufram_page_free_owner(req->buf,
+                                   bufram_size_to_page_count(len),
+                                   BUFRAM_OWNER_USB);
         req->buf = NULL;
         req->len = 0;
     }
@@ -431,7 +439,8 @@ void gadget_descriptor_free(struct gadget_descriptor *g_desc)
  * Add one config descriptor and configs
  * \param g_desc   pointer to the gadget descriptor
  * \param desc     pointer to the config descriptor to add
- * \param usb_desc pointer to an array of config
+ * \param usb_desc pointer to an array of descriptors, each interface
+ *                 followed by its endpoints
  */
 void gadget_add_cfgdesc(struct gadget_descriptor *g_desc,
                         const struct usb_cfgdesc_s *desc,
@@ -465,7 +474,7 @@ static int16_t gadget_config_desc(struct gadget_descriptor *g_desc,
                                   uint16_t id, uint8_t type)
 {
     int i;
-    int neps = 0;
+    int j;
     int ninterfaces;
     struct usb_cfgdesc_s *cfgdesc = (struct usb_cfgdesc_s *)buf;
     struct gadget_config_descriptor *g_cfgdesc;
@@ -476,16 +485,6 @@ static int16_t gadget_config_desc(struct gadget_descriptor *g_desc,
 
     g_cfgdesc = &g_desc->cfg[id];
     ninterfaces = g_cfgdesc->cfg->ninterfaces;
-    /* Get the total number of endpoints */
-    for (i = 0; i < ninterfaces; i++) {
-        neps += ((struct usb_ifdesc_s *)g_cfgdesc->desc[i])->neps;
-    }
-
-    /* This is the total length of the configuration */
-    totallen =
-        USB_SIZEOF_CFGDESC +
-        USB_SIZEOF_IFDESC * ninterfaces +
-        USB_SIZEOF_EPDESC * neps;
 
     /*
      * Configuration descriptor -- Copy the canned descriptor and fill in the
@@ -493,35 +492,44 @@ static int16_t gadget_config_desc(struct gadget_descriptor *g_desc,
      */
     memcpy(cfgdesc, g_cfgdesc->cfg, USB_SIZEOF_CFGDESC);
     buf += USB_SIZEOF_CFGDESC;
-
-    /*  Copy the canned interface descriptor */
-    usb_desc = g_cfgdesc->desc;
-    for (i = 0; i < ninterfaces; i++) {
-        memcpy(buf, *usb_desc, USB_SIZEOF_IFDESC);
-        buf += USB_SIZEOF_IFDESC;
-        usb_desc++;
-    }
+    totallen = USB_SIZEOF_CFGDESC;
 
     /*  Check for switches between high and full speed */
     if (type == USB_DESC_TYPE_OTHERSPEEDCONFIG) {
         hispeed = !hispeed;
     }
 
-    /* Make endpoints configurations */
-    for (i = 0; i < neps; i++) {
-        struct usb_epdesc_s *epdesc = (struct usb_epdesc_s *)*usb_desc;
-        struct usb_epdesc_s *epdesc_buf = (struct usb_epdesc_s *)buf;
-        if (hispeed) {
-            mxpacket = GETUINT16(epdesc->mxpacketsize);
-        } else {
-            mxpacket = 64;
-        }
-        memcpy(epdesc_buf, epdesc, USB_SIZEOF_EPDESC);
+    /*
+     * Each canned interface descriptor is followed by the descriptors of
+     * its endpoints, which is also the order the host expects.
+     */
+    usb_desc = g_cfgdesc->desc;
+    for (i = 0; i < ninterfaces; i++) {
+        const struct usb_ifdesc_s *ifdesc =
+            (const struct usb_ifdesc_s *)*usb_desc;
 
-        epdesc_buf->mxpacketsize[0] = LSBYTE(mxpacket);
-        epdesc_buf->mxpacketsize[1] = MSBYTE(mxpacket);
-        buf += USB_SIZEOF_EPDESC;
+        memcpy(buf, ifdesc, USB_SIZEOF_IFDESC);
+        buf += USB_SIZEOF_IFDESC;
+        totallen += USB_SIZEOF_IFDESC;
         usb_desc++;
+
+        /* Make endpoints configurations */
+        for (j = 0; j < ifdesc->neps; j++) {
+            struct usb_epdesc_s *epdesc = (struct usb_epdesc_s *)*usb_desc;
+            struct usb_epdesc_s *epdesc_buf = (struct usb_epdesc_s *)buf;
+            if (hispeed) {
+                mxpacket = GETUINT16(epdesc->mxpacketsize);
+            } else {
+                mxpacket = 64;
+            }
+            memcpy(epdesc_buf, epdesc, USB_SIZEOF_EPDESC);
+
+            epdesc_buf->mxpacketsize[0] = LSBYTE(mxpacket);
+            epdesc_buf->mxpacketsize[1] = MSBYTE(mxpacket);
+            buf += USB_SIZEOF_EPDESC;
+            totallen += USB_SIZEOF_EPDESC;
+            usb_desc++;
+        }
     }
 
     /* Finally, fill in the total size of the configuration descriptor */
@@ -25,41 +25,53 @@
  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-
 #include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <nuttx/arch.h>
+#include <nuttx/util.h>
+
 #include <arch/tsb/cdsi.h>
 #include <arch/tsb/csi.h>
 
 #define CSI_TX_PRIORITY         60
 #define CSI_TX_STACK_SIZE       2048
 
+/* Number of CDSI transmitters */
+#define CSI_TX_NUM_DEVS         2
+
 /* State of CSI */
 #define CSI_STATE_STOP          0
 #define CSI_STATE_START         1
 
 /* Command of CSI TX */
-#define CSI_CMD_STOP            0
-#define CSI_CMD_START           1
+#define CSI_CMD_NONE            0
+#define CSI_CMD_STOP            1
+#define CSI_CMD_START           2
 
 /**
- * @brief csi tx information
+ * @brief csi tx transmitter state
  */
-struct csi_tx_info {
+struct csi_tx_dev_info {
     /** data from AP */
     struct csi_tx_config cfg;
-    /** csi id */
-    uint8_t csi_id;
-    /** csi commmand */
+    /** pending csi command */
     uint32_t csi_cmd;
     /** csi state */
     uint32_t csi_state;
     /** low level driver */
     struct cdsi_dev *csi_dev;
+};
+
+/**
+ * @brief csi tx information
+ */
+struct csi_tx_info {
+    /** one entry per CDSI transmitter, both can stream concurrently */
+    struct csi_tx_dev_info dev[CSI_TX_NUM_DEVS];
     /** semapher for csi tx operation */
     sem_t csi_sem;
     /** csi tx control thread */
@@ -69,48 +81,130 @@ struct csi_tx_info {
 static struct csi_tx_info *csi_tx_info;
 
 /**
- * @brief Start the CSI Tx for camera stream
+ * @brief Queue a command for a CDSI transmitter
  *
- * @param cfg Pointer to structure of CSI configuration parameters.
+ * @param csi_id The CDSI transmitter
+ * @param state State the transmitter must be in to accept the command
+ * @param cmd The command
+ * @param cfg Configuration for the start command, NULL otherwise
  * @return 0 on success, negative errno on error.
  */
-int csi_tx_srv_start(uint8_t csi_id, struct csi_tx_config *cfg)
+static int csi_tx_srv_queue(uint8_t csi_id, uint32_t state, uint32_t cmd,
+                            struct csi_tx_config *cfg)
 {
-    struct csi_tx_info *info = csi_tx_info;
+    struct csi_tx_dev_info *dev;
+    irqstate_t flags;
 
-    if (info->csi_state != CSI_STATE_STOP)
+    if (!csi_tx_info || csi_id >= CSI_TX_NUM_DEVS)
         return -EINVAL;
 
-    /* Validate and copy parameters to internal space */
-    if (csi_tx_validate_config(cfg))
+    dev = &csi_tx_info->dev[csi_id];
+
+    flags = irqsave();
+    if (dev->csi_state != state || dev->csi_cmd != CSI_CMD_NONE) {
+        irqrestore(flags);
         return -EINVAL;
-    info->cfg = *cfg;
+    }
 
-    /* signal thread to start */
-    info->csi_id = csi_id;
-    info->csi_cmd = CSI_CMD_START;
-    sem_post(&info->csi_sem);
+    if (cfg)
+        dev->cfg = *cfg;
+    dev->csi_cmd = cmd;
+    irqrestore(flags);
+
+    sem_post(&csi_tx_info->csi_sem);
 
     return 0;
 }
 
+/**
+ * @brief Start the CSI Tx for camera stream
+ *
+ * @param csi_id The CDSI transmitter (0 or 1)
+ * @param cfg Pointer to structure of CSI configuration parameters.
+ * @return 0 on success, negative errno on error.
+ */
+int csi_tx_srv_start(uint8_t csi_id, struct csi_tx_config *cfg)
+{
+    /* Validate parameters before copying them to internal space */
+    if (csi_tx_validate_config(cfg))
+        return -EINVAL;
+
+    return csi_tx_srv_queue(csi_id, CSI_STATE_STOP, CSI_CMD_START, cfg);
+}
+
+/**
+ * @brief Start the CSI Tx for a set of concurrent streams
+ *
+ * @param csi_id The CDSI transmitter (0 or 1)
+ * @param streams Streams sent on the link, one virtual channel each
+ * @param num_streams Number of streams
+ * @param max_lanes Number of data lanes wired to the receiver
+ * @param flags Flags for the CSI transmitter configuration
+ * @param cfg Filled with the configuration used, can be NULL
+ * @return 0 on success, negative errno on error.
+ */
+int csi_tx_srv_start_streams(uint8_t csi_id,
+                             const struct csi_tx_stream *streams,
+                             unsigned int num_streams, unsigned int max_lanes,
+                             uint8_t flags, struct csi_tx_config *cfg)
+{
+    struct csi_tx_config stream_cfg;
+    int ret;
+
+    ret = csi_tx_compute_config(streams, num_streams, max_lanes, flags,
+                                &stream_cfg);
+    if (ret)
+        return ret;
+
+    ret = csi_tx_srv_start(csi_id, &stream_cfg);
+    if (!ret && cfg)
+        *cfg = stream_cfg;
+
+    return ret;
+}
+
 /**
  * @brief The CSI stopping task for data streaming
  *
+ * @param csi_id The CDSI transmitter (0 or 1)
  * @return 0 on success, negative errno on error.
  */
 int csi_tx_srv_stop(uint8_t csi_id)
 {
-    struct csi_tx_info *info = csi_tx_info;
+    return csi_tx_srv_queue(csi_id, CSI_STATE_START, CSI_CMD_STOP, NULL);
+}
 
-    if (info->csi_state != CSI_STATE_START)
-        return -EINVAL;
+/**
+ * @brief Execute a command on a CDSI transmitter
+ *
+ * @param csi_id The CDSI transmitter
+ * @param dev The transmitter state
+ * @param cmd The command
+ */
+static void csi_tx_srv_process(uint8_t csi_id, struct csi_tx_dev_info *dev,
+                               uint32_t cmd)
+{
+    if (cmd == CSI_CMD_START) {
+        dev->csi_dev = cdsi_open(csi_id, TSB_CDSI_TX);
+        if (!dev->csi_dev) {
+            lldbg("csi_tx: failed to open CDSI%u\n", csi_id);
+            return;
+        }
 
-    info->csi_id = csi_id;
-    info->csi_cmd = CSI_CMD_STOP;
-    sem_post(&info->csi_sem);
+        if (csi_tx_start(dev->csi_dev, &dev->cfg)) {
+            lldbg("csi_tx: failed to start CDSI%u\n", csi_id);
+            cdsi_close(dev->csi_dev);
+            dev->csi_dev = NULL;
+            return;
+        }
 
-    return 0;
+        dev->csi_state = CSI_STATE_START;
+    } else if (cmd == CSI_CMD_STOP) {
+        csi_tx_stop(dev->csi_dev);
+        cdsi_close(dev->csi_dev);
+        dev->csi_dev = NULL;
+        dev->csi_state = CSI_STATE_STOP;
+    }
 }
 
 /**
@@ -122,19 +216,33 @@ int csi_tx_srv_stop(uint8_t csi_id)
 static void *csi_tx_srv_thread(int argc, char *argv[])
 {
     struct csi_tx_info *info = csi_tx_info;
+    struct csi_tx_dev_info *dev;
+    irqstate_t flags;
+    uint32_t cmd;
+    int i;
 
     while (1) {
         sem_wait(&info->csi_sem);
-        if (info->csi_cmd == CSI_CMD_START) {
-            info->csi_dev = cdsi_open(info->csi_id, TSB_CDSI_TX);
-            if (info->csi_dev) {
-                csi_tx_start(info->csi_dev, &info->cfg);
-                info->csi_state = CSI_STATE_START;
-            }
-        } else {
-            csi_tx_stop(info->csi_dev);
-            cdsi_close(info->csi_dev);
-            info->csi_state = CSI_STATE_STOP;
+
+        for (i = 0; i < CSI_TX_NUM_DEVS; i++) {
+            dev = &info->dev[i];
+
+            flags = irqsave();
+            cmd = dev->csi_cmd;
+            irqrestore(flags);
+
+            if (cmd == CSI_CMD_NONE)
+                continue;
+
+            csi_tx_srv_process(i, dev, cmd);
+
+            /*
+             * Clear the command once processed so that a new one is only
+             * accepted against the updated state.
+             */
+            flags = irqsave();
+            dev->csi_cmd = CSI_CMD_NONE;
+            irqrestore(flags);
         }
     }
 
@@ -150,13 +258,17 @@ int csi_tx_srv_init(void)
 {
     struct csi_tx_info *info;
     int ret;
+    int i;
 
     info = zalloc(sizeof(*info));
     if (info == NULL) {
         return -ENOMEM;
     }
 
-    info->csi_state = CSI_STATE_STOP;
+    for (i = 0; i < CSI_TX_NUM_DEVS; i++) {
+        info->dev[i].csi_state = CSI_STATE_STOP;
+        info->dev[i].csi_cmd = CSI_CMD_NONE;
+    }
 
     ret = sem_init(&info->csi_sem, 0, 0);
     if (ret) {
@@ -178,6 +290,7 @@ int csi_tx_srv_init(void)
     return 0;
 
 err_destroy_sem:
+    csi_tx_info = NULL;
     sem_destroy(&info->csi_sem);
 err_free_mem:
     free(info);
@@ -39,6 +39,13 @@
 #include <nuttx/gpio.h>
 #include <nuttx/clock.h>
 
+#ifdef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <nuttx/input/touchscreen.h>
+#endif
+
 #include <arch/tsb/chip.h>
 #include "clock/clock.h"
 
@@ -73,6 +80,9 @@
 #define DEFAULT_DEBOUNCE_TIME           25  /* 250ms (1 SysTick = 10ms) */
 #define TOUCH_SAMPLE_RATE               20000 /* 20ms */
 
+#define TOUCH_INPUT_RANGE               4096 /* 12-bit touchscreen coordinates */
+#define TOUCH_INPUT_POLL_TIMEOUT        100  /* ms, to check the abort flag */
+
 static struct device *touch_dev = NULL;
 
 /**
@@ -143,6 +153,14 @@ struct touch_info {
 
     /** multitouch data count. for testing */
     int mt_count;
+
+#ifdef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
+    /** reports are sent only while the device is powered on */
+    bool enabled;
+
+    /** contacts known to the host, state 0 for a free slot */
+    struct finger contacts[MAX_VALID_CONTACTS];
+#endif
 };
 
 #define LOGICAL_FINGER_COLLECTION \
@@ -405,6 +423,137 @@ void touch_thread_func(void *context)
     }
 }
 
+#ifdef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
+/**
+ * @brief merge one touchscreen frame into the multitouch report
+ *
+ * The touchscreen driver only returns the contacts that changed, while the
+ * report must carry every contact still down.  Contacts are kept in slots
+ * until their release has been reported once with the tip switch cleared.
+ *
+ * @param info - pointer to structure of touch_info
+ * @param sample - frame read from the touchscreen driver
+ */
+static void touch_input_update(struct touch_info *info,
+                               const struct touch_sample_s *sample)
+{
+    const struct touch_point_s *point;
+    struct finger *contact, *free_contact;
+    int i, j;
+
+    /* free the slots of the releases sent with the previous report */
+    for (j = 0; j < MAX_VALID_CONTACTS; j++) {
+        if (!(info->contacts[j].state & TIP_SWITCH)) {
+            info->contacts[j].state = 0;
+        }
+    }
+
+    for (i = 0; i < sample->npoints; i++) {
+        point = &sample->point[i];
+        contact = NULL;
+        free_contact = NULL;
+
+        for (j = 0; j < MAX_VALID_CONTACTS; j++) {
+            if (info->contacts[j].state &&
+                info->contacts[j].cid == point->id) {
+                contact = &info->contacts[j];
+                break;
+            }
+            if (!info->contacts[j].state && !free_contact) {
+                free_contact = &info->contacts[j];
+            }
+        }
+
+        if (!contact) {
+            if (point->flags & TOUCH_UP || !free_contact ||
+                free_contact - info->contacts >= info->maximum_contacts) {
+                /* release of an unknown contact, or too many fingers */
+                continue;
+            }
+            contact = free_contact;
+            contact->cid = point->id;
+        }
+
+        contact->state = (point->flags & TOUCH_UP) ? IN_RANGE :
+                                                     TIP_SWITCH | IN_RANGE;
+        if (point->flags & TOUCH_POS_VALID) {
+            contact->x = (uint32_t)point->x * TOUCH_DEV_WIDTH /
+                         TOUCH_INPUT_RANGE;
+            contact->y = (uint32_t)point->y * TOUCH_DEV_HEIGHT /
+                         TOUCH_INPUT_RANGE;
+        }
+        if (point->flags & TOUCH_PRESSURE_VALID) {
+            contact->pressure = point->pressure;
+        }
+    }
+
+    /* the host reads the first 'actual' fingers of the report */
+    memset(info->data.points, 0, sizeof(info->data.points));
+    info->data.actual = 0;
+    for (j = 0; j < MAX_VALID_CONTACTS; j++) {
+        if (info->contacts[j].state) {
+            info->data.points[info->data.actual++] = info->contacts[j];
+        }
+    }
+}
+
+/**
+ * @brief touchscreen frame thread function
+ *
+ * Every read of the touchscreen driver returns one frame with all of the
+ * contacts that changed; it is sent to the host as one multitouch report.
+ *
+ * @param context - pointer to structure of device data
+ */
+void touch_input_thread_func(void *context)
+{
+    struct device *dev = context;
+    struct hid_info *info = device_get_private(dev);
+    struct touch_info *tuh_info = NULL;
+    uint8_t buffer[SIZEOF_TOUCH_SAMPLE_S(MAX_VALID_CONTACTS)];
+    struct pollfd fds;
+    ssize_t nbytes;
+
+    tuh_info = touch_get_info(dev, GPIO_TRIGGER);
+    if (!tuh_info) {
+        return;
+    }
+
+    fds.fd = open(CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT_DEV, O_RDONLY);
+    if (fds.fd < 0) {
+        return;
+    }
+    fds.events = POLLIN;
+
+    while (!tuh_info->abort) {
+        fds.revents = 0;
+        if (poll(&fds, 1, TOUCH_INPUT_POLL_TIMEOUT) <= 0) {
+            continue;
+        }
+
+        nbytes = read(fds.fd, buffer, sizeof(buffer));
+        if (nbytes < (ssize_t)SIZEOF_TOUCH_SAMPLE_S(1)) {
+            continue;
+        }
+
+        if (!tuh_info->enabled) {
+            /* the frame is consumed but the host doesn't want it */
+            continue;
+        }
+
+        touch_input_update(tuh_info, (struct touch_sample_s *)buffer);
+
+        if (info->event_callback) {
+            info->event_callback(dev, info->event_data, HID_INPUT_REPORT,
+                                 (uint8_t*)&tuh_info->data,
+                                 sizeof(struct hid_touch_data));
+        }
+    }
+
+    close(fds.fd);
+}
+#endif
+
 /**
  * @brief Get TOUCH Input report data
  *
@@ -572,12 +721,25 @@ int touch_irq_event(int irq, void *context, void *priv)
  */
 static int touch_power_set(struct device *dev, bool on)
 {
+#ifdef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
+    struct touch_info *tuh_info = touch_get_info(dev, GPIO_TRIGGER);
+
+    if (!tuh_info) {
+        return -EIO;
+    }
+
+    tuh_info->enabled = on;
+    if (!on) {
+        memset(tuh_info->contacts, 0, sizeof(tuh_info->contacts));
+    }
+#else
     if (on) {
         /* enable interrupt */
         gpio_irq_unmask(GPIO_TRIGGER);
     } else {
         gpio_irq_mask(GPIO_TRIGGER);
     }
+#endif
 
     return 0;
 }
@@ -654,10 +816,12 @@ static int touch_hw_initialize(struct device *dev, struct hid_info *dev_info)
     int ret = 0;
     struct touch_info *tuh_info = NULL;
 
+#ifndef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
     /* check GPIO pin validly*/
     if (GPIO_TRIGGER >= gpio_line_count()) {
         return -EIO;
     }
+#endif
 
     tuh_info = zalloc(sizeof(*tuh_info));
     if (!tuh_info) {
@@ -681,6 +845,17 @@ static int touch_hw_initialize(struct device *dev, struct hid_info *dev_info)
 
     list_add(&dev_info->device_list, &tuh_info->list);
 
+#ifdef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
+    /* the GPIO is only the lookup key, frames come from the touchscreen */
+    tuh_info->abort = 0;
+    if (pthread_create(&tuh_info->hid_thread, NULL,
+                       (void*)touch_input_thread_func, (void*)dev) != 0) {
+        ret = -EIO;
+        goto err_free_tuh_info;
+    }
+    return ret;
+#endif
+
     /* create thread to send demo report data */
     if (pthread_create(&tuh_info->hid_thread, NULL, (void*)touch_thread_func,
                        (void*)dev) != 0) {
@@ -729,9 +904,11 @@ static int touch_hw_deinitialize(struct device *dev)
         pthread_join(tuh_info->hid_thread, NULL);
     }
 
+#ifndef CONFIG_ARA_BRIDGE_HID_TOUCH_INPUT
     /* uninitialize GPIO pin */
     gpio_irq_mask(GPIO_TRIGGER);
     gpio_deactivate(GPIO_TRIGGER);
+#endif
     list_del(&tuh_info->list);
     free(tuh_info);
 
@@ -52,6 +52,15 @@
 #define TSB_TMR_FREQUENCY               48000000
 #define TIMESYNC_MAX_STROBE_DELAY_US    10000
 
+/*
+ * Drift estimates beyond this are taken as a bad set of strobes rather than
+ * as the oscillator: crystals are specified well within 100ppm.
+ */
+#define TIMESYNC_MAX_DRIFT              200e-6
+
+/* Weight of the newest drift estimate in the running average, as 1/n */
+#define TIMESYNC_DRIFT_WEIGHT           4
+
 /*
  * Define CONFIG_ARCH_TIMESYNC_DEBUG to get printouts locally and a 1 second strobe
  * after completion of the initial synchronization operation
@@ -66,6 +75,16 @@ static double timesync_increment;
 static double timesync_ns_per_clock;
 static bool timesync_offset_down;
 
+/*
+ * Drift of the local oscillator against the SVC, in frame clocks gained per
+ * local frame clock, and the local frame-time it is counted from. It is
+ * estimated from the strobes of each synchronization and averaged across
+ * them, since it is a property of the crystal rather than of the sync.
+ */
+static double timesync_drift;
+static long double timesync_anchor;
+static int timesync_drift_samples;
+
 /* Last ping frame time */
 static uint64_t timesync_last_event_time;
 
@@ -105,18 +124,19 @@ static uint32_t timesync_get_counter(void) {
 }
 
 /**
- * @brief Return a 64 bit frame time expressed in timer clocks.
+ * @brief Return the local frame time, fractional part included.
  *
  * All timers must tick at the rate the AP has mandated 19.2MHz in Ara V1
  * unfortunately this means we end up having to do some floating point maths
  * to divide down the 48MHz local (fixed) clock to the AP supplied clock.
  *
  * Latch lower 32 bits (hardware) and upper 32 bits soft-IRQ tracked
- * to derive a 64 frame-time - expressed in AP refclk clocks.
- *
+ * to derive a 64 frame-time - expressed in AP refclk clocks. The local clock
+ * being faster than the refclk, the remainder of the division is kept as
+ * the fraction of a frame clock.
  */
-uint64_t timesync_get_frame_time(void) {
-    uint64_t hi, tmp;
+static long double timesync_get_local_time(void) {
+    long double hi, tmp;
     uint32_t lod;
 
     while (1) {
@@ -127,14 +147,57 @@ uint64_t timesync_get_frame_time(void) {
             break;
     }
 
-    lod = ((double)lod) / timesync_div;
+    return hi + ((double)lod) / timesync_div;
+}
+
+/**
+ * @brief Convert a local frame time to the SVC frame time
+ *
+ * Applies the offset found at the last synchronization, and interpolates
+ * the drift of the local oscillator since then.
+ */
+static long double timesync_local_to_frame_time(long double local) {
+    long double frame_time;
+
+    frame_time = local + timesync_drift * (local - timesync_anchor);
 
     if (timesync_offset_down)
-        hi -= timesync_frame_time_offset;
+        frame_time -= timesync_frame_time_offset;
     else
-        hi += timesync_frame_time_offset;
+        frame_time += timesync_frame_time_offset;
 
-    return (hi + lod);
+    return frame_time;
+}
+
+/**
+ * @brief Return a 64 bit frame time expressed in timer clocks.
+ */
+uint64_t timesync_get_frame_time(void) {
+    return timesync_local_to_frame_time(timesync_get_local_time());
+}
+
+/**
+ * @brief Return the frame time with a sub-clock resolution
+ *
+ * @param frame_time - the frame time, in frame clocks
+ * @param frac - the fraction of frame clock elapsed since, in 1/2^32 units
+ * @return 0 on success, -ENODEV if the frame time is not synchronized
+ */
+int timesync_get_frame_time_fine(uint64_t *frame_time, uint32_t *frac) {
+    long double now;
+
+    if (!frame_time)
+        return -EINVAL;
+
+    if (timesync_state != TIMESYNC_STATE_ACTIVE)
+        return -ENODEV;
+
+    now = timesync_local_to_frame_time(timesync_get_local_time());
+    *frame_time = now;
+    if (frac)
+        *frac = (now - *frame_time) * 4294967296.0;
+
+    return 0;
 }
 
 /**
@@ -156,7 +219,8 @@ static void timesync_log_frame_time(void) {
     if (timesync_strobe_index < GB_TIMESYNC_MAX_STROBES) {
        if (!timesync_strobe_index)
             tsb_tmr_start_ext(timesync_rollover_timer, TIMESYNC_ROLLOVER_TOTAL, true);
-        timesync_strobe_time[timesync_strobe_index] = timesync_get_frame_time();
+        timesync_strobe_time[timesync_strobe_index] =
+            timesync_get_local_time();
 #ifdef CONFIG_ARCH_TIMESYNC_DEBUG
         timesync_counter_time[timesync_strobe_index] = timesync_get_counter();
 #endif
@@ -210,9 +274,10 @@ static int timesync_debugd_main(int argc, char **argv) {
         if (timesync_state == TIMESYNC_STATE_INVALID)
             break;
 
-        lldbg("frame-time=%llu last-event-time=%llu rx-strobes=%d\n",
+        lldbg("frame-time=%llu last-event-time=%llu rx-strobes=%d "
+              "drift=%dppb\n",
               timesync_get_frame_time(), timesync_last_event_time,
-              timesync_rx_strobes);
+              timesync_rx_strobes, (int)(timesync_drift * 1e9));
     }
     return 0;
 }
@@ -258,6 +323,7 @@ int timesync_enable(uint8_t strobe_count, uint64_t frame_time,
     timesync_div = ((double)TSB_TMR_FREQUENCY) / ((double)refclk);
     timesync_increment = ((double)TIMESYNC_ROLLOVER_TOTAL+1) / timesync_div;
     timesync_frame_time_offset = 0;
+    timesync_anchor = frame_time;
 
     /************************************************************
      * Config TMR3 as a free running timer at the fixed frequency
@@ -301,6 +367,53 @@ static double timesync_diff(double x, double y)
         return y - x;
 }
 
+/**
+ * @brief Estimate the drift of the local oscillator from the strobes
+ *
+ * Least-squares fit of the offset between the SVC and the local frame times
+ * against the local frame time, over the strobes of this synchronization.
+ * The estimate is folded into the running average of the previous ones.
+ */
+static void timesync_estimate_drift(uint64_t *frame_time) {
+    double x, y, mean_x = 0, mean_y = 0, cov = 0, var = 0;
+    double drift;
+    int i, weight;
+
+    if (timesync_strobe_count < 2)
+        return;
+
+    for (i = 0; i < timesync_strobe_count; i++) {
+        mean_x += timesync_strobe_time[i] - timesync_strobe_time[0];
+        mean_y += (double)frame_time[i] - (double)timesync_strobe_time[i];
+    }
+    mean_x /= timesync_strobe_count;
+    mean_y /= timesync_strobe_count;
+
+    for (i = 0; i < timesync_strobe_count; i++) {
+        x = timesync_strobe_time[i] - timesync_strobe_time[0];
+        y = (double)frame_time[i] - (double)timesync_strobe_time[i];
+        cov += (x - mean_x) * (y - mean_y);
+        var += (x - mean_x) * (x - mean_x);
+    }
+
+    if (!var)
+        return;
+
+    drift = cov / var;
+    if (drift > TIMESYNC_MAX_DRIFT || drift < -TIMESYNC_MAX_DRIFT) {
+        dbg_verbose("discard drift estimate %dppb\n", (int)(drift * 1e9));
+        return;
+    }
+
+    if (timesync_drift_samples < TIMESYNC_DRIFT_WEIGHT)
+        timesync_drift_samples++;
+    weight = timesync_drift_samples;
+    timesync_drift += (drift - timesync_drift) / weight;
+
+    dbg_verbose("drift estimate %dppb average %dppb\n",
+                (int)(drift * 1e9), (int)(timesync_drift * 1e9));
+}
+
 /**
  * @brief Align the local frame time to the frame-time provided by SVC
  */
@@ -343,8 +456,10 @@ int timesync_authoritative(uint64_t *frame_time) {
 
             dbg_verbose("strobe %d and %d best match clock diff %lu target %lu\n",
                         i - 1, i, best_match, timesync_strobe_delay_ns);
+            timesync_anchor = timesync_strobe_time[i];
         }
     }
+    timesync_estimate_drift(frame_time);
 #ifdef CONFIG_ARCH_TIMESYNC_DEBUG
     for (i = 1; i < timesync_strobe_index; i++) {
         lldbg("frame-time diff %llu-frame-clocks %llu-%llu\n",
@@ -398,6 +513,8 @@ int timesync_init(void) {
 
     lldbg("Frame-time basic-frequency %dHz\n", TSB_TMR_FREQUENCY);
     timesync_disable();
+    timesync_drift = 0;
+    timesync_drift_samples = 0;
 
 #ifdef CONFIG_ARCH_TIMESYNC_DEBUG
     /* timesync_debug exists for debug and informational purposes only */
@@ -620,6 +620,33 @@ void rcc_switch_ara_pll(void);
 
 #define DMAMAP_SDIO DMAMAP_SDIO_1
 
+/* SPI and I2C DMA (CONFIG_STM32_SPI_DMA, CONFIG_STM32_I2C_DMA).  None of these
+ * streams is shared with SDIO or with each other.
+ *
+ *   SPI1 RX: DMA2 Stream 0    SPI1 TX: DMA2 Stream 5
+ *   SPI2 RX: DMA1 Stream 3    SPI2 TX: DMA1 Stream 4
+ *   I2C1 RX: DMA1 Stream 0    I2C1 TX: DMA1 Stream 6
+ *   I2C2 RX: DMA1 Stream 2    I2C2 TX: DMA1 Stream 7
+ */
+
+#define DMACHAN_SPI1_RX DMAMAP_SPI1_RX_1
+#define DMACHAN_SPI1_TX DMAMAP_SPI1_TX_2
+#define DMACHAN_SPI2_RX DMAMAP_SPI2_RX
+#define DMACHAN_SPI2_TX DMAMAP_SPI2_TX
+#define DMACHAN_I2C1_RX DMAMAP_I2C1_RX_1
+#define DMACHAN_I2C1_TX DMAMAP_I2C1_TX_1
+#define DMACHAN_I2C2_RX DMAMAP_I2C2_RX_1
+#define DMACHAN_I2C2_TX DMAMAP_I2C2_TX
+
+/* ADC DMA (CONFIG_ARA_SVC_ADC_DMA)
+ *
+ *   ADC1: DMA2 Stream 4    ADC2: DMA2 Stream 2    ADC3: DMA2 Stream 1
+ */
+
+#define DMACHAN_ADC1    DMAMAP_ADC1_2
+#define DMACHAN_ADC2    DMAMAP_ADC2_1
+#define DMACHAN_ADC3    DMAMAP_ADC3_2
+
 /************************************************************************************
  * Public Data
  ************************************************************************************/
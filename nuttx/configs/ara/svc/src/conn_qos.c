@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Quality of Service profiles of the UniPro connections
+ *
+ * The AP disables the flow control of the connections carrying isochronous
+ * data, such as the camera ones, which have to be drained at the rate of
+ * the data. When such a connection is created, the ports on both of its
+ * ends are moved to the TC0HIGH sub-class, ahead of the regular TC0 traffic,
+ * with a bandwidth reservation enforced by the switch DRR2 bandwidth
+ * control so that they can't starve the other connections sharing their
+ * links. The ports go back to TC0 when their last such connection is
+ * destroyed.
+ *
+ * The switch sub-class and bandwidth control are per source port, not per
+ * CPort, so the profile of a port is the one of its most demanding
+ * connection.
+ */
+
+#define DBG_COMP ARADBG_SVC
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <ara_debug.h>
+
+#include "tsb_switch.h"
+#include "conn_qos.h"
+
+/* The QoS cycles run at 166 MHz: use a 1 ms bandwidth period */
+#define CONN_QOS_BWPERIOD           (166000)
+#define CONN_QOS_MAX_CONNECTIONS    (16)
+
+struct conn_qos_profile {
+    const char *name;
+    /* Connections whose flags match flags under flags_mask get this profile */
+    uint8_t flags_mask;
+    uint8_t flags;
+    uint8_t subtc;
+    /* Bytes per CONN_QOS_BWPERIOD */
+    uint32_t limit;
+};
+
+static const struct conn_qos_profile conn_qos_profiles[] = {
+    {
+        .name = "isochronous",
+        .flags_mask = CPORT_FLAGS_E2EFC | CPORT_FLAGS_CSD_N,
+        .flags = CPORT_FLAGS_CSD_N,
+        .subtc = SWITCH_TRAFFIC_CLASS_TC0HIGH,
+        .limit = CONFIG_ARA_SVC_CONN_QOS_ISOC_LIMIT,
+    },
+};
+
+struct conn_qos_connection {
+    const struct conn_qos_profile *profile;
+    uint8_t port_id0;
+    uint16_t cport_id0;
+    uint8_t port_id1;
+    uint16_t cport_id1;
+};
+
+static struct {
+    struct tsb_switch *sw;
+    pthread_mutex_t lock;
+    struct conn_qos_connection conns[CONN_QOS_MAX_CONNECTIONS];
+    /* Connections with a profile on each port, and on the whole switch */
+    uint8_t port_users[SWITCH_UNIPORT_MAX];
+    unsigned int users;
+} conn_qos;
+
+static const struct conn_qos_profile *
+conn_qos_find_profile(const struct unipro_connection *c) {
+    unsigned int i;
+
+    /* Leave the connections for which the AP asked for TC1 alone */
+    if (c->tc != SWITCH_TRAFFIC_CLASS_TC0) {
+        return NULL;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(conn_qos_profiles); i++) {
+        if ((c->flags & conn_qos_profiles[i].flags_mask) ==
+            conn_qos_profiles[i].flags) {
+            return &conn_qos_profiles[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int conn_qos_port_get(uint8_t port_id,
+                             const struct conn_qos_profile *profile) {
+    struct tsb_switch *sw = conn_qos.sw;
+    int rc;
+
+    if (conn_qos.port_users[port_id]++) {
+        return 0;
+    }
+
+    rc = switch_qos_set_bwperiod(sw, port_id, profile->subtc,
+                                 CONN_QOS_BWPERIOD);
+    if (!rc) {
+        rc = switch_qos_set_limit(sw, port_id, profile->subtc,
+                                  profile->limit);
+    }
+    if (!rc) {
+        rc = switch_qos_set_subtc(sw, port_id, profile->subtc);
+    }
+    if (rc) {
+        dbg_error("%s: failed to apply QoS profile %s to port %u: %d\n",
+                  __func__, profile->name, port_id, rc);
+        switch_qos_set_subtc(sw, port_id, SWITCH_TRAFFIC_CLASS_TC0);
+        conn_qos.port_users[port_id]--;
+    }
+
+    return rc;
+}
+
+static void conn_qos_port_put(uint8_t port_id) {
+    int rc;
+
+    if (--conn_qos.port_users[port_id]) {
+        return;
+    }
+
+    rc = switch_qos_set_subtc(conn_qos.sw, port_id, SWITCH_TRAFFIC_CLASS_TC0);
+    if (rc) {
+        dbg_error("%s: failed to reset QoS of port %u: %d\n", __func__,
+                  port_id, rc);
+    }
+}
+
+/**
+ * @brief Apply the QoS profile matching a new connection, if any
+ *
+ * @return 0 on success or if the connection has no profile, -errno otherwise
+ */
+int conn_qos_apply(const struct unipro_connection *c) {
+    const struct conn_qos_profile *profile;
+    struct conn_qos_connection *conn = NULL;
+    unsigned int i;
+    int rc;
+
+    profile = conn_qos_find_profile(c);
+    if (!profile) {
+        return 0;
+    }
+
+    if (c->port_id0 >= SWITCH_UNIPORT_MAX ||
+        c->port_id1 >= SWITCH_UNIPORT_MAX) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&conn_qos.lock);
+
+    for (i = 0; i < ARRAY_SIZE(conn_qos.conns); i++) {
+        if (!conn_qos.conns[i].profile) {
+            conn = &conn_qos.conns[i];
+            break;
+        }
+    }
+    if (!conn) {
+        rc = -ENOMEM;
+        goto out;
+    }
+
+    if (!conn_qos.users) {
+        rc = switch_qos_enable_bwctrl(conn_qos.sw, c->port_id0,
+                                      SWITCH_TRAFFIC_CLASS_TC0HIGH);
+        if (rc) {
+            goto out;
+        }
+    }
+
+    rc = conn_qos_port_get(c->port_id0, profile);
+    if (rc) {
+        goto out_bwctrl;
+    }
+
+    rc = conn_qos_port_get(c->port_id1, profile);
+    if (rc) {
+        conn_qos_port_put(c->port_id0);
+        goto out_bwctrl;
+    }
+
+    conn->profile = profile;
+    conn->port_id0 = c->port_id0;
+    conn->cport_id0 = c->cport_id0;
+    conn->port_id1 = c->port_id1;
+    conn->cport_id1 = c->cport_id1;
+    conn_qos.users++;
+
+    dbg_info("QoS profile %s applied to [p=%u,c=%u]<->[p=%u,c=%u]\n",
+             profile->name, c->port_id0, c->cport_id0,
+             c->port_id1, c->cport_id1);
+
+    pthread_mutex_unlock(&conn_qos.lock);
+    return 0;
+
+out_bwctrl:
+    if (!conn_qos.users) {
+        switch_qos_disable_bwctrl(conn_qos.sw, c->port_id0,
+                                  SWITCH_TRAFFIC_CLASS_TC0HIGH);
+    }
+out:
+    pthread_mutex_unlock(&conn_qos.lock);
+    return rc;
+}
+
+/**
+ * @brief Release the QoS profile of a destroyed connection, if it had one
+ */
+void conn_qos_release(const struct unipro_connection *c) {
+    struct conn_qos_connection *conn;
+    unsigned int i;
+
+    pthread_mutex_lock(&conn_qos.lock);
+
+    for (i = 0; i < ARRAY_SIZE(conn_qos.conns); i++) {
+        conn = &conn_qos.conns[i];
+        if (!conn->profile ||
+            conn->port_id0 != c->port_id0 || conn->cport_id0 != c->cport_id0 ||
+            conn->port_id1 != c->port_id1 || conn->cport_id1 != c->cport_id1) {
+            continue;
+        }
+
+        conn_qos_port_put(conn->port_id0);
+        conn_qos_port_put(conn->port_id1);
+        conn->profile = NULL;
+
+        if (!--conn_qos.users) {
+            switch_qos_disable_bwctrl(conn_qos.sw, c->port_id0,
+                                      SWITCH_TRAFFIC_CLASS_TC0HIGH);
+        }
+        break;
+    }
+
+    pthread_mutex_unlock(&conn_qos.lock);
+}
+
+int conn_qos_init(struct tsb_switch *sw) {
+    int rc;
+
+    memset(&conn_qos, 0, sizeof(conn_qos));
+
+    rc = pthread_mutex_init(&conn_qos.lock, NULL);
+    if (!rc) {
+        conn_qos.sw = sw;
+    }
+
+    return rc;
+}
+
+void conn_qos_exit(void) {
+    if (!conn_qos.sw) {
+        return;
+    }
+
+    pthread_mutex_destroy(&conn_qos.lock);
+    conn_qos.sw = NULL;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @brief: Quality of Service profiles of the UniPro connections
+ */
+
+#ifndef  _SVC_CONN_QOS_H_
+#define  _SVC_CONN_QOS_H_
+
+#include <nuttx/unipro/unipro.h>
+
+#include "tsb_switch.h"
+
+#ifdef CONFIG_ARA_SVC_CONN_QOS
+
+int conn_qos_init(struct tsb_switch *sw);
+void conn_qos_exit(void);
+int conn_qos_apply(const struct unipro_connection *c);
+void conn_qos_release(const struct unipro_connection *c);
+
+#else
+
+static inline int conn_qos_init(struct tsb_switch *sw) {
+    return 0;
+}
+
+static inline void conn_qos_exit(void) {
+}
+
+static inline int conn_qos_apply(const struct unipro_connection *c) {
+    return 0;
+}
+
+static inline void conn_qos_release(const struct unipro_connection *c) {
+}
+
+#endif
+
+#endif /* _SVC_CONN_QOS_H_ */
@@ -41,9 +41,12 @@
 
 #include "svc.h"
 #include <ara_debug.h>
+#include "interface.h"
 #include "tsb_switch.h"
 #include "gb_svc.h"
 #include "timesync.h"
+#include "port_stats.h"
+#include "pwr_mon.h"
 
 /*
  * FIXME: use the hardcoded endo id used in the kernel for now
@@ -782,6 +785,92 @@ static uint8_t gb_svc_timesync_wd_pins_fini(struct gb_operation *op) {
     return gb_errno_to_op_result(rc);
 }
 
+#ifdef CONFIG_ARA_SVC_PORT_STATS
+static uint8_t gb_svc_port_stats(struct gb_operation *operation)
+{
+    struct gb_svc_port_stats_request *request;
+    struct gb_svc_port_stats_response *response;
+    struct gb_svc_port_stats_sample *rs;
+    struct port_stats_sample sample;
+    uint32_t errors[SWITCH_PORT_ERR_MAX];
+    unsigned int count, max_count, i;
+    int port_id;
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    port_id = interface_get_portid_by_id(request->intf_id);
+    if (port_id < 0 || port_stats_errors(port_id, errors)) {
+        return GB_OP_INVALID;
+    }
+
+    max_count = (GB_MAX_PAYLOAD_SIZE - sizeof(*response)) / sizeof(*rs);
+    count = MIN(MIN(port_stats_count(), request->max_samples), max_count);
+
+    response = gb_operation_alloc_response(operation, sizeof(*response) +
+                                           count * sizeof(*rs));
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(response->errors); i++) {
+        response->errors[i] = cpu_to_le32(errors[i]);
+    }
+
+    /* Latest sample first */
+    for (i = 0; i < count && !port_stats_get(i, &sample); i++) {
+        rs = &response->samples[i];
+        rs->time_ms = cpu_to_le32(sample.time_ms);
+        rs->link_up = !!(sample.link_status & (1 << port_id));
+        rs->errors = cpu_to_le16(sample.errors[port_id]);
+        rs->quantity = cpu_to_le16(sample.quantity[port_id]);
+        rs->in_wdt = cpu_to_le32(sample.in_wdt);
+        rs->out_wdt = cpu_to_le32(sample.out_wdt);
+    }
+    response->nr_samples = i;
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
+#ifdef CONFIG_ARA_SVC_PWRMON_SAMPLER
+static uint8_t gb_svc_pwrmon_energy(struct gb_operation *operation)
+{
+    struct gb_svc_pwrmon_energy_request *request;
+    struct gb_svc_pwrmon_energy_response *response;
+    uint64_t energy_uj, time_us;
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    if (pwrmon_sampler_energy(request->dev_id, request->rail_id, &energy_uj,
+                              &time_us)) {
+        return GB_OP_INVALID;
+    }
+
+    response = gb_operation_alloc_response(operation, sizeof(*response));
+    if (!response) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    response->energy_uj = cpu_to_le64(energy_uj);
+    response->time_us = cpu_to_le64(time_us);
+    strncpy(response->dev_name, pwrmon_dev_name(request->dev_id),
+            sizeof(response->dev_name) - 1);
+    strncpy(response->rail_name,
+            pwrmon_rail_name(request->dev_id, request->rail_id),
+            sizeof(response->rail_name) - 1);
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
 static struct gb_operation_handler gb_svc_handlers[] = {
     GB_HANDLER(GB_SVC_TYPE_INTF_DEVICE_ID, gb_svc_intf_device_id),
     GB_HANDLER(GB_SVC_TYPE_INTF_EJECT, gb_svc_intf_eject),
@@ -810,6 +899,12 @@ static struct gb_operation_handler gb_svc_handlers[] = {
     GB_HANDLER(GB_SVC_TYPE_PWRMON_SAMPLE_GET, gb_svc_pwrmon_sample_get),
     GB_HANDLER(GB_SVC_TYPE_PWRMON_INTF_SAMPLE_GET, gb_svc_pwrmon_intf_sample_get),
     GB_HANDLER(GB_SVC_TYPE_PWR_DOWN, gb_svc_pwr_down),
+#ifdef CONFIG_ARA_SVC_PWRMON_SAMPLER
+    GB_HANDLER(GB_SVC_TYPE_PWRMON_ENERGY, gb_svc_pwrmon_energy),
+#endif
+#ifdef CONFIG_ARA_SVC_PORT_STATS
+    GB_HANDLER(GB_SVC_TYPE_PORT_STATS, gb_svc_port_stats),
+#endif
 };
 
 struct gb_driver svc_driver = {
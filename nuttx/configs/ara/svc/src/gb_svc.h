@@ -75,6 +75,9 @@
 #define GB_SVC_TYPE_INTF_REFCLK_DISABLE         0x24
 #define GB_SVC_TYPE_INTF_UNIPRO_ENABLE          0x25
 #define GB_SVC_TYPE_INTF_UNIPRO_DISABLE         0x26
+/* Debug operations, outside of the range used by the SVC protocol */
+#define GB_SVC_TYPE_PWRMON_ENERGY               0x7d
+#define GB_SVC_TYPE_PORT_STATS                  0x7e
 
 struct gb_svc_protocol_version_request {
     __u8        major;
@@ -315,6 +318,47 @@ struct gb_svc_timesync_wd_pins_init_request {
 } __packed;
 /* timesync wdm pins response has no payload */
 
+/* port stats request */
+struct gb_svc_port_stats_request {
+    __u8    intf_id;
+    __u8    max_samples;
+} __packed;
+
+struct gb_svc_port_stats_sample {
+    __le32  time_ms;
+    __u8    link_up;
+    __u8    pad;
+    __le16  errors;
+    __le16  quantity;
+    __le16  pad2;
+    __le32  in_wdt;
+    __le32  out_wdt;
+} __packed;
+
+/* port stats response: error indications since boot, then latest samples */
+struct gb_svc_port_stats_response {
+    __le32  errors[7];
+    __u8    nr_samples;
+    struct gb_svc_port_stats_sample samples[0];
+} __packed;
+
+/* power rail energy request */
+struct gb_svc_pwrmon_energy_request {
+    __u8    dev_id;
+    __u8    rail_id;
+} __packed;
+
+/*
+ * power rail energy response: energy drawn since the power rail sampler was
+ * started, and the time it was integrated over
+ */
+struct gb_svc_pwrmon_energy_response {
+    __le64  energy_uj;
+    __le64  time_us;
+    char    dev_name[GB_SVC_PWRMON_RAIL_NAME_BUFSIZE];
+    char    rail_name[GB_SVC_PWRMON_RAIL_NAME_BUFSIZE];
+} __packed;
+
 int gb_svc_protocol_version(void);
 int gb_svc_hello(uint8_t ap_intf_id);
 int gb_svc_intf_hotplug(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint64_t);
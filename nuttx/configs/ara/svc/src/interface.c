@@ -42,6 +42,7 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include <ara_debug.h>
 #include "interface.h"
@@ -62,6 +63,13 @@
 #define LINKUP_WD_DELAY                                     \
         ((LINKUP_WD_DELAY_IN_MS * CLOCKS_PER_SEC) / 1000)
 
+/* Interfaces whose VSYS are turned on together at boot, to bound inrush */
+#ifdef CONFIG_ARA_SVC_POWER_ON_BATCH
+#define POWER_ON_BATCH  CONFIG_ARA_SVC_POWER_ON_BATCH
+#else
+#define POWER_ON_BATCH  1
+#endif
+
 static struct interface **interfaces;
 static unsigned int nr_interfaces;
 static unsigned int nr_spring_interfaces;
@@ -69,6 +77,8 @@ static struct vreg *vlatch_vdd;
 static struct vreg *latch_ilim;
 static pthread_mutex_t latch_ilim_lock = PTHREAD_MUTEX_INITIALIZER;
 static uint8_t mod_sense;
+static atomic_t boot_pending;
+static uint32_t boot_start;
 
 static void interface_power_cycle(void *data);
 static void interface_uninstall_wd_handler(struct interface *iface,
@@ -590,6 +600,24 @@ enum ara_iface_pwr_state interface_get_refclk_state(struct interface *iface)
 }
 
 
+/*
+ * @brief Account for an interface plugged at boot being up, or given up
+ *
+ * Requires caller to hold iface->mutex
+ */
+static void interface_boot_done(struct interface *iface)
+{
+    if (!iface->boot_pending) {
+        return;
+    }
+
+    iface->boot_pending = false;
+    if (!atomic_dec(&boot_pending)) {
+        dbg_info("All interfaces plugged at boot handled after %u ms\n",
+                 TICK2MSEC(clock_systimer() - boot_start));
+    }
+}
+
 /*
  * @brief Interface power control helper, to be used by the DETECT_IN/hotplug
  * mechanism.
@@ -608,6 +636,8 @@ static int interface_power_off(struct interface *iface)
 
     /* Cancel LinkUp and WAKEOUT pulse for the interface */
     iface->linkup_req_sent = false;
+    iface->link_state = ARA_IFACE_LINK_DOWN;
+    interface_boot_done(iface);
     wd_cancel(&iface->linkup_wd);
     rc = interface_cancel_wakeout(iface);
 
@@ -707,21 +737,16 @@ done:
 }
 
 /*
- * Interface power control helper, to be used by the DETECT_IN/hotplug
- * mechanism.
- *
- * Power ON the interface in order to cleanly reboot the interface
- * module(s). Then an initial handshake between the module(s) and the
- * interface can take place.
+ * First half of interface_power_on(): detect the order and turn VSYS on,
+ * leaving the regulator to settle for *hold_time us.
  * Requires calling context to hold iface->mutex
  */
-static int interface_power_on(struct interface *iface)
+static int interface_power_on_vsys(struct interface *iface,
+                                   unsigned int *hold_time)
 {
     int rc;
 
-    if (!iface) {
-        return -EINVAL;
-    }
+    *hold_time = 0;
 
     iface->linkup_req_sent = false;
 
@@ -734,12 +759,30 @@ static int interface_power_on(struct interface *iface)
 
     /* If powered OFF, power it ON now */
     if (!interface_get_vsys_state(iface)) {
-        rc = interface_vsys_enable(iface);
-        if (rc < 0) {
+        rc = vreg_get_nowait(iface->vsys_vreg, hold_time);
+        if (rc) {
+            dbg_error("Failed to enable interface %s: %d\n", iface->name, rc);
+            atomic_init(&iface->power_state, ARA_IFACE_PWR_ERROR);
             return rc;
         }
+        atomic_init(&iface->power_state, ARA_IFACE_PWR_UP);
     }
 
+    iface->link_state = ARA_IFACE_LINK_POWERING;
+
+    return 0;
+}
+
+/*
+ * Second half of interface_power_on(), once VSYS is stable: enable the
+ * reference clock and the switch port, then wake the module up and let
+ * the LinkUp proceed on its own.
+ * Requires calling context to hold iface->mutex
+ */
+static int interface_power_on_link(struct interface *iface)
+{
+    int rc;
+
     if (!interface_get_refclk_state(iface)) {
         rc = interface_refclk_enable(iface);
         if (rc < 0) {
@@ -791,6 +834,8 @@ static int interface_power_on(struct interface *iface)
         goto out_port_irq;
     }
 
+    iface->link_state = ARA_IFACE_LINK_STARTING;
+
     return 0;
 
 out_port_irq:
@@ -801,10 +846,42 @@ out_refclk:
     interface_refclk_disable(iface);
 out_power:
     interface_vsys_disable(iface);
+    iface->link_state = ARA_IFACE_LINK_DOWN;
+    interface_boot_done(iface);
 
     return rc;
 }
 
+/*
+ * Interface power control helper, to be used by the DETECT_IN/hotplug
+ * mechanism.
+ *
+ * Power ON the interface in order to cleanly reboot the interface
+ * module(s). Then an initial handshake between the module(s) and the
+ * interface can take place.
+ * Requires calling context to hold iface->mutex
+ */
+static int interface_power_on(struct interface *iface)
+{
+    unsigned int hold_time;
+    int rc;
+
+    if (!iface) {
+        return -EINVAL;
+    }
+
+    rc = interface_power_on_vsys(iface, &hold_time);
+    if (rc) {
+        return rc;
+    }
+
+    if (hold_time) {
+        up_udelay(hold_time);
+    }
+
+    return interface_power_on_link(iface);
+}
+
 /*
  * interface_power_on_atomic - non-static external helper function
  *                             calls interface_power_on holding iface->mutex
@@ -851,6 +928,18 @@ void interface_cancel_linkup_wd_atomic(struct interface *iface)
     pthread_mutex_unlock_debug(&iface->mutex);
 }
 
+/*
+ * interface_link_up_atomic - non-static external helper function, to be
+ *                            called on LinkUp success; takes iface->mutex
+ */
+void interface_link_up_atomic(struct interface *iface)
+{
+    pthread_mutex_lock_debug(&iface->mutex);
+    iface->link_state = ARA_IFACE_LINK_UP;
+    interface_boot_done(iface);
+    pthread_mutex_unlock_debug(&iface->mutex);
+}
+
 /*
  * interface_power_cycle - workqueue context
  */
@@ -858,14 +947,21 @@ static void interface_power_cycle(void *data)
 {
     struct interface *iface = data;
     uint8_t retries;
+    bool pending;
 
     pthread_mutex_lock_debug(&iface->mutex);
+
+    /* A retry is still part of the boot time bring-up */
+    pending = iface->boot_pending;
+    iface->boot_pending = false;
     interface_power_off(iface);
+    iface->boot_pending = pending;
 
     if (++iface->linkup_retries >= INTERFACE_MAX_LINKUP_TRIES) {
         dbg_error("Could not link-up with '%s' in less than %d ms, aborting after %d tries\n",
                   iface->name, LINKUP_WD_DELAY_IN_MS,
                   INTERFACE_MAX_LINKUP_TRIES);
+        interface_boot_done(iface);
         goto done;
     }
 
@@ -1707,6 +1803,8 @@ int interface_init(struct interface **ints, size_t nr_ints,
                    size_t nr_spring_ints, struct vreg *vlatch,
                    struct vreg *latch_curlim, uint8_t mod_sense_gpio) {
     unsigned int i;
+    unsigned int ramping = 0;
+    unsigned int hold_time, max_hold_time = 0;
     int rc;
     struct interface *ifc;
 
@@ -1716,6 +1814,9 @@ int interface_init(struct interface **ints, size_t nr_ints,
         return -ENODEV;
     }
 
+    boot_start = clock_systimer();
+    atomic_init(&boot_pending, 0);
+
     interfaces = ints;
     nr_interfaces = nr_ints;
     nr_spring_interfaces = nr_spring_ints;
@@ -1732,13 +1833,27 @@ int interface_init(struct interface **ints, size_t nr_ints,
         ifc->detect_in.last_state = WD_ST_INVALID;
         rc = interface_install_wd_handler(ifc, false);
 
-        /* Power on/off the interface based on the DETECT_IN signal state */
+        /*
+         * Power on/off the interface based on the DETECT_IN signal state.
+         *
+         * The VSYS of the plugged interfaces are turned on in batches of
+         * POWER_ON_BATCH, each batch settling at once. The LinkUps are
+         * only started below, once all of them are powered, and then
+         * proceed concurrently.
+         */
         switch (interface_get_hotplug_state(ifc)) {
         case HOTPLUG_ST_PLUGGED:
             /* Port is plugged in, power ON the interface */
-            if (interface_power_on(ifc) < 0) {
+            if (interface_power_on_vsys(ifc, &hold_time) < 0) {
                 dbg_error("Failed to power ON interface %s\n", ifc->name);
+                break;
+            }
+            ifc->boot_pending = true;
+            atomic_inc(&boot_pending);
+            if (hold_time > max_hold_time) {
+                max_hold_time = hold_time;
             }
+            ramping++;
             break;
         case HOTPLUG_ST_UNPLUGGED:
             /* Port unplugged, power OFF the interface */
@@ -1756,6 +1871,28 @@ int interface_init(struct interface **ints, size_t nr_ints,
         if (rc) {
             return rc;
         }
+
+        if (ramping == POWER_ON_BATCH) {
+            usleep(max_hold_time);
+            ramping = 0;
+            max_hold_time = 0;
+        }
+    }
+
+    if (ramping) {
+        usleep(max_hold_time);
+    }
+
+    interface_foreach(ifc, i) {
+        pthread_mutex_lock_debug(&ifc->mutex);
+
+        /* Unless the DETECT_IN handler already took care of it */
+        if (ifc->link_state == ARA_IFACE_LINK_POWERING &&
+            interface_power_on_link(ifc) < 0) {
+            dbg_error("Failed to power ON interface %s\n", ifc->name);
+        }
+
+        pthread_mutex_unlock_debug(&ifc->mutex);
     }
 
     return 0;
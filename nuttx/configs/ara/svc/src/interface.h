@@ -123,6 +123,14 @@ enum ara_iface_state {
     ARA_IFACE_STATE_WD_TIMESYNC,
 };
 
+/* Link bring-up state */
+enum ara_iface_link_state {
+    ARA_IFACE_LINK_DOWN = 0,        /* Powered off, or given up */
+    ARA_IFACE_LINK_POWERING,        /* VSYS settling, see interface_init() */
+    ARA_IFACE_LINK_STARTING,        /* WAKEOUT sent, waiting for the LinkUp */
+    ARA_IFACE_LINK_UP,              /* LinkUp succeeded */
+};
+
 /* Max number of LinkUp retries before the interface is shut down */
 #define INTERFACE_MAX_LINKUP_TRIES  3
 
@@ -151,6 +159,8 @@ struct interface {
     struct work_s eject_work;   /* Module ejection completion work */
     atomic_t dme_powermodeind;
     enum ara_iface_state state;
+    enum ara_iface_link_state link_state;
+    bool boot_pending;          /* Plugged at boot, not up nor given up */
 };
 
 #define interface_foreach(iface, idx)                       \
@@ -215,6 +225,7 @@ uint32_t interface_pm_get_spin(struct interface *iface);
 int interface_set_devid_by_id_atomic(uint8_t intf_id, uint8_t dev_id);
 void interface_set_linkup_retries_atomic(struct interface *iface, uint8_t val);
 void interface_cancel_linkup_wd_atomic(struct interface *iface);
+void interface_link_up_atomic(struct interface *iface);
 /*
  * This is the low level ejection function, called from svc.c.
  * High level code shall call the ejection request function from svc.c.
@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Traffic driven UniPro power mode policy
+ *
+ * Once the AP has set the power mode of a link, the SVC keeps that mode as
+ * the fastest one allowed on the link and moves it between the modes of
+ * link_pm_modes[] according to the traffic the switch forwards from the
+ * port. A link is moved one mode up as soon as its load goes beyond the
+ * upper threshold of its current mode, and one mode down only after its
+ * load stayed under the lower threshold of the mode below for a number of
+ * samples.
+ */
+
+#define DBG_COMP ARADBG_SVC
+
+#include <nuttx/config.h>
+#include <nuttx/clock.h>
+#include <nuttx/wqueue.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <ara_debug.h>
+
+#include "tsb_switch.h"
+#include "link_pm.h"
+
+#define LINK_PM_PERIOD          MSEC2TICK(CONFIG_ARA_SVC_LINK_PM_PERIOD)
+
+struct link_pm_mode_cfg {
+    const char *name;
+    bool hs;
+    uint8_t gear;
+    uint8_t nlanes;
+    /* Lowest data rate of the mode, per lane and direction, in Mbit/s */
+    uint32_t rate;
+};
+
+static const struct link_pm_mode_cfg link_pm_modes[LINK_PM_NR_MODES] = {
+    [LINK_PM_PWM_G1_X1] = {"PWM-G1 x1", false, 1, 1, 3},
+    [LINK_PM_PWM_G4_X1] = {"PWM-G4 x1", false, 4, 1, 24},
+    [LINK_PM_PWM_G4_X2] = {"PWM-G4 x2", false, 4, 2, 24},
+    [LINK_PM_HS_G1_X1]  = {"HS-G1 x1",  true,  1, 1, 1248},
+    [LINK_PM_HS_G1_X2]  = {"HS-G1 x2",  true,  1, 2, 1248},
+    [LINK_PM_HS_G2_X2]  = {"HS-G2 x2",  true,  2, 2, 2496},
+    [LINK_PM_HS_G3_X2]  = {"HS-G3 x2",  true,  3, 2, 4992},
+};
+
+struct link_pm_port {
+    bool managed;
+    enum link_pm_mode mode;
+    enum link_pm_mode max_mode;
+    /* The configuration requested by the AP, which our changes are based on */
+    struct unipro_link_cfg cfg;
+
+    uint32_t last_quantity;
+    unsigned int low_samples;
+
+    uint32_t mode_changes;
+    uint32_t since;
+    uint32_t ticks[LINK_PM_NR_MODES];
+};
+
+static struct {
+    struct tsb_switch *sw;
+    pthread_mutex_t lock;
+    struct work_s work;
+    bool stop;
+    struct link_pm_port ports[SWITCH_UNIPORT_MAX];
+} link_pm;
+
+/* Fold the time spent in the current mode into the statistics */
+static void link_pm_account(struct link_pm_port *p) {
+    uint32_t now = clock_systimer();
+
+    p->ticks[p->mode] += now - p->since;
+    p->since = now;
+}
+
+static uint32_t link_pm_capacity(enum link_pm_mode mode) {
+    return link_pm_modes[mode].rate * link_pm_modes[mode].nlanes;
+}
+
+/*
+ * A mode is allowed if it is not faster than the AP requested, in gear or
+ * lane count. PWM modes are allowed below an HS request.
+ */
+static bool link_pm_mode_allowed(const struct unipro_pwr_cfg *req,
+                                 enum link_pm_mode mode) {
+    const struct link_pm_mode_cfg *m = &link_pm_modes[mode];
+    bool req_hs = req->upro_mode == UNIPRO_FAST_MODE ||
+                  req->upro_mode == UNIPRO_FASTAUTO_MODE;
+
+    if (m->nlanes > req->upro_nlanes) {
+        return false;
+    }
+
+    if (m->hs != req_hs) {
+        return req_hs;
+    }
+
+    return m->gear <= req->upro_gear;
+}
+
+/*
+ * Find the fastest allowed mode, or return -EINVAL when the request is not
+ * something the policy can manage (asymmetric link, hibernation, ...)
+ */
+static int link_pm_max_mode(const struct unipro_link_cfg *cfg) {
+    const struct unipro_pwr_cfg *tx = &cfg->upro_tx_cfg;
+    const struct unipro_pwr_cfg *rx = &cfg->upro_rx_cfg;
+    int mode;
+
+    if (tx->upro_mode != rx->upro_mode || tx->upro_gear != rx->upro_gear ||
+        tx->upro_nlanes != rx->upro_nlanes) {
+        return -EINVAL;
+    }
+
+    switch (tx->upro_mode) {
+    case UNIPRO_FAST_MODE:
+    case UNIPRO_FASTAUTO_MODE:
+    case UNIPRO_SLOW_MODE:
+    case UNIPRO_SLOWAUTO_MODE:
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    for (mode = LINK_PM_NR_MODES - 1; mode >= 0; mode--) {
+        if (link_pm_mode_allowed(tx, mode)) {
+            return mode;
+        }
+    }
+
+    return -EINVAL;
+}
+
+/* Next allowed mode in the given direction, or the current one if none */
+static enum link_pm_mode link_pm_next_mode(struct link_pm_port *p, int dir) {
+    int mode;
+
+    for (mode = p->mode + dir; mode >= 0 && mode <= p->max_mode;
+         mode += dir) {
+        if (link_pm_mode_allowed(&p->cfg.upro_tx_cfg, mode)) {
+            return mode;
+        }
+    }
+
+    return p->mode;
+}
+
+static int link_pm_set_mode(uint8_t port_id, struct link_pm_port *p,
+                            enum link_pm_mode mode) {
+    const struct link_pm_mode_cfg *m = &link_pm_modes[mode];
+    enum unipro_pwr_mode req_mode = p->cfg.upro_tx_cfg.upro_mode;
+    bool auto_variant = req_mode == UNIPRO_FASTAUTO_MODE ||
+                        req_mode == UNIPRO_SLOWAUTO_MODE;
+    struct unipro_link_cfg cfg;
+    int rc;
+
+    memcpy(&cfg, &p->cfg, sizeof(cfg));
+
+    if (m->hs) {
+        const struct unipro_pwr_cfg pcfg =
+            UNIPRO_FAST_PWR_CFG(auto_variant, m->gear, m->nlanes);
+
+        cfg.upro_tx_cfg = pcfg;
+        cfg.flags |= UPRO_LINKF_TX_TERMINATION | UPRO_LINKF_RX_TERMINATION;
+    } else {
+        const struct unipro_pwr_cfg pcfg =
+            UNIPRO_SLOW_PWR_CFG(auto_variant, m->gear, m->nlanes);
+
+        cfg.upro_tx_cfg = pcfg;
+        cfg.flags = UPRO_LINKF_TX_TERMINATION;
+    }
+    cfg.upro_rx_cfg = cfg.upro_tx_cfg;
+
+    rc = switch_configure_link(link_pm.sw, port_id, &cfg, NULL);
+    if (rc) {
+        dbg_error("%s: failed to set port %u to %s: %d\n", __func__,
+                  port_id, m->name, rc);
+        return rc;
+    }
+
+    dbg_verbose("%s: port %u: %s -> %s\n", __func__, port_id,
+                link_pm_modes[p->mode].name, m->name);
+
+    link_pm_account(p);
+    p->mode = mode;
+    p->mode_changes++;
+    p->low_samples = 0;
+
+    return 0;
+}
+
+/* Sample the data the switch forwarded from the port on TC0 and TC1 */
+static int link_pm_sample(uint8_t port_id, uint32_t *quantity) {
+    uint32_t val;
+    int rc;
+
+    rc = switch_qos_attr_get(link_pm.sw, SWITCH_PORT_ID,
+                             AR_BSTAT_QUANTITY(port_id), &val);
+    if (rc) {
+        return rc;
+    }
+
+    *quantity = (val & AR_BSTAT_QUANTITY_RATE00_TC0) +
+                ((val & AR_BSTAT_QUANTITY_RATE00_TC1) >> 16);
+    return 0;
+}
+
+static void link_pm_update(uint8_t port_id, struct link_pm_port *p) {
+    enum link_pm_mode mode;
+    uint32_t quantity;
+    uint32_t load;
+
+    if (link_pm_sample(port_id, &quantity)) {
+        return;
+    }
+
+    /*
+     * The counters are 16-bit byte counters: take the difference with the
+     * previous sample modulo their width, and turn it into Mbit/s.
+     */
+    load = ((quantity - p->last_quantity) & AR_BSTAT_QUANTITY_RATE00_TC0) * 8 /
+           (CONFIG_ARA_SVC_LINK_PM_PERIOD * 1000);
+    p->last_quantity = quantity;
+
+    if (load * 100 >= link_pm_capacity(p->mode) *
+                      CONFIG_ARA_SVC_LINK_PM_UP_THRESHOLD) {
+        mode = link_pm_next_mode(p, 1);
+        if (mode != p->mode) {
+            link_pm_set_mode(port_id, p, mode);
+        }
+        p->low_samples = 0;
+        return;
+    }
+
+    mode = link_pm_next_mode(p, -1);
+    if (mode == p->mode ||
+        load * 100 >= link_pm_capacity(mode) *
+                      CONFIG_ARA_SVC_LINK_PM_DOWN_THRESHOLD) {
+        p->low_samples = 0;
+        return;
+    }
+
+    if (++p->low_samples >= CONFIG_ARA_SVC_LINK_PM_DOWN_SAMPLES) {
+        link_pm_set_mode(port_id, p, mode);
+    }
+}
+
+static bool link_pm_any_managed(void) {
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(link_pm.ports); i++) {
+        if (link_pm.ports[i].managed) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void link_pm_worker(void *data) {
+    uint8_t port_id;
+
+    pthread_mutex_lock(&link_pm.lock);
+
+    for (port_id = 0; port_id < ARRAY_SIZE(link_pm.ports); port_id++) {
+        if (link_pm.ports[port_id].managed) {
+            link_pm_update(port_id, &link_pm.ports[port_id]);
+        }
+    }
+
+    if (!link_pm.stop && link_pm_any_managed()) {
+        work_queue(HPWORK, &link_pm.work, link_pm_worker, NULL,
+                   LINK_PM_PERIOD);
+    }
+
+    pthread_mutex_unlock(&link_pm.lock);
+}
+
+/* Requires link_pm.lock */
+static void link_pm_schedule(void) {
+    if (!link_pm.stop && work_available(&link_pm.work)) {
+        work_queue(HPWORK, &link_pm.work, link_pm_worker, NULL,
+                   LINK_PM_PERIOD);
+    }
+}
+
+/**
+ * @brief Configure the power mode of a link on behalf of the AP
+ *
+ * The requested mode becomes the fastest one the policy will use on the
+ * link. Requests the policy can't manage, e.g. hibernation, take the link
+ * out of the policy.
+ */
+int link_pm_configure(struct tsb_switch *sw, uint8_t port_id,
+                      const struct unipro_link_cfg *cfg) {
+    struct link_pm_port *p;
+    int max_mode;
+    int rc;
+
+    if (port_id >= ARRAY_SIZE(link_pm.ports)) {
+        return switch_configure_link(sw, port_id, cfg, NULL);
+    }
+
+    pthread_mutex_lock(&link_pm.lock);
+
+    p = &link_pm.ports[port_id];
+    if (p->managed) {
+        link_pm_account(p);
+        p->managed = false;
+    }
+
+    rc = switch_configure_link(sw, port_id, cfg, NULL);
+    if (rc) {
+        goto out;
+    }
+
+    max_mode = link_pm_max_mode(cfg);
+    if (max_mode < 0) {
+        dbg_verbose("%s: port %u power mode not managed\n", __func__, port_id);
+        goto out;
+    }
+
+    /* The link is now in the fastest allowed mode */
+    memcpy(&p->cfg, cfg, sizeof(p->cfg));
+    p->max_mode = max_mode;
+    p->mode = max_mode;
+    p->low_samples = 0;
+    p->since = clock_systimer();
+    if (!link_pm_sample(port_id, &p->last_quantity)) {
+        p->managed = true;
+        link_pm_schedule();
+    }
+
+out:
+    pthread_mutex_unlock(&link_pm.lock);
+    return rc;
+}
+
+/**
+ * @brief Stop managing the power mode of a link which went down
+ */
+void link_pm_port_down(uint8_t port_id) {
+    struct link_pm_port *p;
+
+    if (port_id >= ARRAY_SIZE(link_pm.ports)) {
+        return;
+    }
+
+    pthread_mutex_lock(&link_pm.lock);
+
+    p = &link_pm.ports[port_id];
+    if (p->managed) {
+        link_pm_account(p);
+        p->managed = false;
+    }
+
+    pthread_mutex_unlock(&link_pm.lock);
+}
+
+/**
+ * @brief Get the power mode statistics of a link
+ */
+int link_pm_get_stats(uint8_t port_id, struct link_pm_stats *stats) {
+    struct link_pm_port *p;
+    unsigned int i;
+
+    if (port_id >= ARRAY_SIZE(link_pm.ports) || !stats) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&link_pm.lock);
+
+    p = &link_pm.ports[port_id];
+    if (p->managed) {
+        link_pm_account(p);
+    }
+
+    stats->managed = p->managed;
+    stats->mode = p->mode;
+    stats->max_mode = p->max_mode;
+    stats->mode_changes = p->mode_changes;
+    for (i = 0; i < LINK_PM_NR_MODES; i++) {
+        stats->time_ms[i] = TICK2MSEC(p->ticks[i]);
+    }
+
+    pthread_mutex_unlock(&link_pm.lock);
+
+    return 0;
+}
+
+const char *link_pm_mode_name(enum link_pm_mode mode) {
+    return mode < LINK_PM_NR_MODES ? link_pm_modes[mode].name : "unknown";
+}
+
+int link_pm_init(struct tsb_switch *sw) {
+    int rc;
+
+    memset(&link_pm, 0, sizeof(link_pm));
+
+    rc = pthread_mutex_init(&link_pm.lock, NULL);
+    if (!rc) {
+        link_pm.sw = sw;
+    }
+
+    return rc;
+}
+
+void link_pm_exit(void) {
+    if (!link_pm.sw) {
+        return;
+    }
+
+    pthread_mutex_lock(&link_pm.lock);
+    link_pm.stop = true;
+    pthread_mutex_unlock(&link_pm.lock);
+
+    work_cancel(HPWORK, &link_pm.work);
+    pthread_mutex_destroy(&link_pm.lock);
+    link_pm.sw = NULL;
+}
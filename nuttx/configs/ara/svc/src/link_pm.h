@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @brief: Traffic driven UniPro power mode policy
+ */
+
+#ifndef  _SVC_LINK_PM_H_
+#define  _SVC_LINK_PM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <nuttx/unipro/unipro.h>
+
+#include "tsb_switch.h"
+
+/* Power modes the policy moves the links between, slowest first */
+enum link_pm_mode {
+    LINK_PM_PWM_G1_X1,
+    LINK_PM_PWM_G4_X1,
+    LINK_PM_PWM_G4_X2,
+    LINK_PM_HS_G1_X1,
+    LINK_PM_HS_G1_X2,
+    LINK_PM_HS_G2_X2,
+    LINK_PM_HS_G3_X2,
+    LINK_PM_NR_MODES,
+};
+
+struct link_pm_stats {
+    bool managed;
+    enum link_pm_mode mode;
+    enum link_pm_mode max_mode;
+    uint32_t mode_changes;
+    /* Time spent in each power mode, in milliseconds */
+    uint32_t time_ms[LINK_PM_NR_MODES];
+};
+
+#ifdef CONFIG_ARA_SVC_LINK_PM
+
+int link_pm_init(struct tsb_switch *sw);
+void link_pm_exit(void);
+int link_pm_configure(struct tsb_switch *sw, uint8_t port_id,
+                      const struct unipro_link_cfg *cfg);
+void link_pm_port_down(uint8_t port_id);
+int link_pm_get_stats(uint8_t port_id, struct link_pm_stats *stats);
+const char *link_pm_mode_name(enum link_pm_mode mode);
+
+#else
+
+static inline int link_pm_init(struct tsb_switch *sw) {
+    return 0;
+}
+
+static inline void link_pm_exit(void) {
+}
+
+static inline int link_pm_configure(struct tsb_switch *sw, uint8_t port_id,
+                                    const struct unipro_link_cfg *cfg) {
+    return switch_configure_link(sw, port_id, cfg, NULL);
+}
+
+static inline void link_pm_port_down(uint8_t port_id) {
+}
+
+#endif
+
+#endif /* _SVC_LINK_PM_H_ */
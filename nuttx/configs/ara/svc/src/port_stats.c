@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Periodic collection of the switch port statistics
+ *
+ * Every CONFIG_ARA_SVC_PORT_STATS_PERIOD ms, the link status, the QoS
+ * watchdog counts, and the error indications and traffic of each port are
+ * sampled into a ring of the CONFIG_ARA_SVC_PORT_STATS_DEPTH last samples.
+ * They are reported in /proc/svc/ports and with the GB_SVC_TYPE_PORT_STATS
+ * debug operation.
+ */
+
+#define DBG_COMP ARADBG_SVC
+
+#include <nuttx/config.h>
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ara_debug.h>
+
+#include "tsb_switch.h"
+#include "port_stats.h"
+
+#define PORT_STATS_PERIOD       MSEC2TICK(CONFIG_ARA_SVC_PORT_STATS_PERIOD)
+#define PORT_STATS_DEPTH        CONFIG_ARA_SVC_PORT_STATS_DEPTH
+
+#define PORT_STATS_PROCFS_LINELEN   128
+
+static struct {
+    struct tsb_switch *sw;
+    pthread_mutex_t lock;
+    struct work_s work;
+    bool stop;
+
+    /* Ring of samples: head is the next one to write */
+    struct port_stats_sample samples[PORT_STATS_DEPTH];
+    unsigned int head;
+    unsigned int count;
+
+    /* Counters at the previous sample */
+    uint32_t errors[SWITCH_UNIPORT_MAX];
+    uint32_t quantity[SWITCH_UNIPORT_MAX];
+} port_stats;
+
+static uint32_t port_stats_error_sum(uint8_t port_id) {
+    uint32_t sum = 0;
+    unsigned int i;
+
+    for (i = 0; i < SWITCH_PORT_ERR_MAX; i++) {
+        sum += port_stats.sw->port_errors[port_id][i];
+    }
+
+    return sum;
+}
+
+static void port_stats_sample(struct port_stats_sample *s) {
+    struct tsb_switch *sw = port_stats.sw;
+    uint32_t errors, val;
+    uint8_t port_id;
+
+    memset(s, 0, sizeof(*s));
+    s->time_ms = TICK2MSEC(clock_systimer());
+
+    /* A missing value is reported as 0, the sample is still useful */
+    switch_internal_getattr(sw, SW_ATTR_SWSTA, &s->link_status);
+    switch_qos_get_in_wdt_count(sw, &s->in_wdt);
+    switch_qos_get_out_wdt_count(sw, &s->out_wdt);
+
+    for (port_id = 0; port_id < SWITCH_UNIPORT_MAX; port_id++) {
+        errors = port_stats_error_sum(port_id);
+        s->errors[port_id] = errors - port_stats.errors[port_id];
+        port_stats.errors[port_id] = errors;
+
+        if (!(s->link_status & (1 << port_id)) ||
+            switch_qos_attr_get(sw, SWITCH_PORT_ID,
+                                AR_BSTAT_QUANTITY(port_id), &val)) {
+            continue;
+        }
+
+        val = (val & AR_BSTAT_QUANTITY_RATE00_TC0) +
+              ((val & AR_BSTAT_QUANTITY_RATE00_TC1) >> 16);
+        s->quantity[port_id] = val - port_stats.quantity[port_id];
+        port_stats.quantity[port_id] = val;
+    }
+}
+
+static void port_stats_worker(void *data) {
+    struct port_stats_sample sample;
+
+    /* Don't hold the lock during the switch accesses */
+    port_stats_sample(&sample);
+
+    pthread_mutex_lock(&port_stats.lock);
+
+    port_stats.samples[port_stats.head] = sample;
+    port_stats.head = (port_stats.head + 1) % PORT_STATS_DEPTH;
+    if (port_stats.count < PORT_STATS_DEPTH) {
+        port_stats.count++;
+    }
+
+    if (!port_stats.stop) {
+        work_queue(HPWORK, &port_stats.work, port_stats_worker, NULL,
+                   PORT_STATS_PERIOD);
+    }
+
+    pthread_mutex_unlock(&port_stats.lock);
+}
+
+/**
+ * @brief Number of samples available
+ */
+unsigned int port_stats_count(void) {
+    return port_stats.count;
+}
+
+/**
+ * @brief Get a sample
+ *
+ * @param age 0 for the latest sample, 1 for the one before, ...
+ * @return 0 on success, -ENOENT if there is no such sample
+ */
+int port_stats_get(unsigned int age, struct port_stats_sample *sample) {
+    int rc = 0;
+
+    pthread_mutex_lock(&port_stats.lock);
+
+    if (age >= port_stats.count) {
+        rc = -ENOENT;
+    } else {
+        *sample = port_stats.samples[(port_stats.head + PORT_STATS_DEPTH -
+                                      age - 1) % PORT_STATS_DEPTH];
+    }
+
+    pthread_mutex_unlock(&port_stats.lock);
+
+    return rc;
+}
+
+/**
+ * @brief Get the error indications of a port since the SVC started
+ */
+int port_stats_errors(uint8_t port_id, uint32_t errors[SWITCH_PORT_ERR_MAX]) {
+    if (port_id >= SWITCH_UNIPORT_MAX) {
+        return -EINVAL;
+    }
+
+    memcpy(errors, port_stats.sw->port_errors[port_id],
+           sizeof(port_stats.sw->port_errors[port_id]));
+    return 0;
+}
+
+int port_stats_init(struct tsb_switch *sw) {
+    int rc;
+
+    memset(&port_stats, 0, sizeof(port_stats));
+
+    rc = pthread_mutex_init(&port_stats.lock, NULL);
+    if (rc) {
+        return rc;
+    }
+    port_stats.sw = sw;
+
+    return work_queue(HPWORK, &port_stats.work, port_stats_worker, NULL,
+                      PORT_STATS_PERIOD);
+}
+
+void port_stats_exit(void) {
+    if (!port_stats.sw) {
+        return;
+    }
+
+    pthread_mutex_lock(&port_stats.lock);
+    port_stats.stop = true;
+    pthread_mutex_unlock(&port_stats.lock);
+
+    work_cancel(HPWORK, &port_stats.work);
+    pthread_mutex_destroy(&port_stats.lock);
+    port_stats.sw = NULL;
+}
+
+#if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_SVC)
+
+struct port_stats_procfs_file {
+    struct procfs_file_s base;
+    char line[PORT_STATS_PROCFS_LINELEN];
+};
+
+static bool port_stats_procfs_copy(char *line, size_t linesize, char **buffer,
+                                   size_t *remaining, off_t *offset,
+                                   size_t *total) {
+    size_t copysize;
+
+    if (linesize >= PORT_STATS_PROCFS_LINELEN) {
+        linesize = PORT_STATS_PROCFS_LINELEN - 1;
+    }
+
+    copysize = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+    *buffer += copysize;
+    *remaining -= copysize;
+    *total += copysize;
+
+    return *remaining > 0;
+}
+
+static int port_stats_procfs_open(struct file *filep, const char *relpath,
+                                  int oflags, mode_t mode) {
+    struct port_stats_procfs_file *priv;
+
+    if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0) {
+        return -EACCES;
+    }
+
+    if (strcmp(relpath, "svc/ports") != 0) {
+        return -ENOENT;
+    }
+
+    priv = kmm_zalloc(sizeof(*priv));
+    if (!priv) {
+        return -ENOMEM;
+    }
+
+    filep->f_priv = priv;
+    return 0;
+}
+
+static int port_stats_procfs_close(struct file *filep) {
+    DEBUGASSERT(filep->f_priv);
+
+    kmm_free(filep->f_priv);
+    filep->f_priv = NULL;
+    return 0;
+}
+
+static ssize_t port_stats_procfs_read(struct file *filep, char *buffer,
+                                      size_t buflen) {
+    struct port_stats_procfs_file *priv = filep->f_priv;
+    struct port_stats_sample s;
+    uint32_t e[SWITCH_PORT_ERR_MAX];
+    off_t offset = filep->f_pos;
+    size_t remaining = buflen;
+    size_t total = 0;
+    size_t linesize;
+    unsigned int age;
+    uint8_t port_id;
+
+    DEBUGASSERT(priv);
+
+    if (!port_stats.sw) {
+        return 0;
+    }
+
+    linesize = snprintf(priv->line, PORT_STATS_PROCFS_LINELEN,
+                        "PORT    PHY     PA     DL     NL     TL PAINIT "
+                        "  LOST\n");
+    if (!port_stats_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                                &offset, &total)) {
+        goto out;
+    }
+
+    for (port_id = 0; port_id < SWITCH_UNIPORT_MAX; port_id++) {
+        port_stats_errors(port_id, e);
+        linesize = snprintf(priv->line, PORT_STATS_PROCFS_LINELEN,
+                            "%4u %6u %6u %6u %6u %6u %6u %6u\n", port_id,
+                            e[SWITCH_PORT_ERR_PHY], e[SWITCH_PORT_ERR_PA],
+                            e[SWITCH_PORT_ERR_DL], e[SWITCH_PORT_ERR_NL],
+                            e[SWITCH_PORT_ERR_TL], e[SWITCH_PORT_ERR_PA_INIT],
+                            e[SWITCH_PORT_ERR_LINK_LOST]);
+        if (!port_stats_procfs_copy(priv->line, linesize, &buffer,
+                                    &remaining, &offset, &total)) {
+            goto out;
+        }
+    }
+
+    /* Samples, oldest first, listing the ports with a link or errors */
+    for (age = port_stats_count(); age-- > 0; ) {
+        if (port_stats_get(age, &s)) {
+            continue;
+        }
+
+        linesize = snprintf(priv->line, PORT_STATS_PROCFS_LINELEN,
+                            "%u ms: links 0x%04x, in wdt %u, out wdt %u\n",
+                            s.time_ms, s.link_status, s.in_wdt, s.out_wdt);
+        if (!port_stats_procfs_copy(priv->line, linesize, &buffer,
+                                    &remaining, &offset, &total)) {
+            goto out;
+        }
+
+        for (port_id = 0; port_id < SWITCH_UNIPORT_MAX; port_id++) {
+            if (!(s.link_status & (1 << port_id)) && !s.errors[port_id]) {
+                continue;
+            }
+
+            linesize = snprintf(priv->line, PORT_STATS_PROCFS_LINELEN,
+                                "  port %2u: %u errors, %u bytes\n", port_id,
+                                s.errors[port_id], s.quantity[port_id]);
+            if (!port_stats_procfs_copy(priv->line, linesize, &buffer,
+                                        &remaining, &offset, &total)) {
+                goto out;
+            }
+        }
+    }
+
+out:
+    filep->f_pos += total;
+    return total;
+}
+
+static int port_stats_procfs_dup(const struct file *oldp, struct file *newp) {
+    struct port_stats_procfs_file *newpriv;
+
+    DEBUGASSERT(oldp->f_priv);
+
+    newpriv = kmm_zalloc(sizeof(*newpriv));
+    if (!newpriv) {
+        return -ENOMEM;
+    }
+
+    memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+    newp->f_priv = newpriv;
+    return 0;
+}
+
+static int port_stats_procfs_stat(const char *relpath, struct stat *buf) {
+    if (strcmp(relpath, "svc/ports") != 0) {
+        return -ENOENT;
+    }
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+    return 0;
+}
+
+const struct procfs_operations svc_ports_procfsoperations = {
+    .open = port_stats_procfs_open,
+    .close = port_stats_procfs_close,
+    .read = port_stats_procfs_read,
+    .dup = port_stats_procfs_dup,
+    .stat = port_stats_procfs_stat,
+};
+
+#endif
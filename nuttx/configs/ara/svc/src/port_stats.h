@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @brief: Periodic collection of the switch port statistics
+ */
+
+#ifndef  _SVC_PORT_STATS_H_
+#define  _SVC_PORT_STATS_H_
+
+#include <stdint.h>
+
+#include "tsb_switch.h"
+
+struct port_stats_sample {
+    /* clock_systimer() of the sample, in ms */
+    uint32_t time_ms;
+    /* SW_ATTR_SWSTA: bit N set if the link of port N is up */
+    uint32_t link_status;
+    /* QoS watchdog counts */
+    uint32_t in_wdt;
+    uint32_t out_wdt;
+    /* Error indications since the previous sample */
+    uint16_t errors[SWITCH_UNIPORT_MAX];
+    /* Bytes forwarded from the port on TC0 and TC1 since the previous sample */
+    uint16_t quantity[SWITCH_UNIPORT_MAX];
+};
+
+#ifdef CONFIG_ARA_SVC_PORT_STATS
+
+int port_stats_init(struct tsb_switch *sw);
+void port_stats_exit(void);
+unsigned int port_stats_count(void);
+int port_stats_get(unsigned int age, struct port_stats_sample *sample);
+int port_stats_errors(uint8_t port_id, uint32_t errors[SWITCH_PORT_ERR_MAX]);
+
+#else
+
+static inline int port_stats_init(struct tsb_switch *sw) {
+    return 0;
+}
+
+static inline void port_stats_exit(void) {
+}
+
+#endif
+
+#endif /* _SVC_PORT_STATS_H_ */
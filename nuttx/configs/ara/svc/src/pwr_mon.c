@@ -467,3 +467,55 @@ int pwrmon_measure_rail(pwrmon_rail *pwrmon_r, ina230_sample *m)
 
     return ret;
 }
+
+/**
+ * @brief           Enable or disable the conversion ready alert of a given
+ *                  power rail.
+ * @return          0 on success, standard error codes otherwise.
+ * @param[in]       pwrmon_r: power rail device structure
+ * @param[in]       enable: true to assert ALERT when a conversion completes
+ */
+int pwrmon_set_cnvr_alert(pwrmon_rail *pwrmon_r, bool enable)
+{
+    int ret;
+
+    if (!pwrmon_r) {
+        dbg_error("%s(): invalid pwrmon_r!\n", __func__);
+        return -EINVAL;
+    }
+
+    ret = pwrmon_ina230_select(pwrmon_r->dev);
+    if (ret) {
+        dbg_error("%s(): failed to configure i2c mux! (%d)\n",
+                  __func__, ret);
+        return ret;
+    }
+
+    return ina230_set_cnvr_alert(pwrmon_r->ina230_dev, enable);
+}
+
+/**
+ * @brief           Acknowledge the conversion ready alert of a given power
+ *                  rail.
+ * @return          1 if a conversion completed since the last
+ *                  acknowledgement, 0 if not, standard error codes otherwise.
+ * @param[in]       pwrmon_r: power rail device structure
+ */
+int pwrmon_ack_alert(pwrmon_rail *pwrmon_r)
+{
+    int ret;
+
+    if (!pwrmon_r) {
+        dbg_error("%s(): invalid pwrmon_r!\n", __func__);
+        return -EINVAL;
+    }
+
+    ret = pwrmon_ina230_select(pwrmon_r->dev);
+    if (ret) {
+        dbg_error("%s(): failed to configure i2c mux! (%d)\n",
+                  __func__, ret);
+        return ret;
+    }
+
+    return ina230_ack_alert(pwrmon_r->ina230_dev);
+}
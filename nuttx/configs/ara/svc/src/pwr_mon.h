@@ -36,6 +36,7 @@
 #define __PWR_MON_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/types.h>
 #include <nuttx/sensors/ina230.h>
 
@@ -85,8 +86,19 @@ typedef struct pwrmon_boardinfo {
     void (*init_i2c_sel)(struct pwrmon_boardinfo* board);
     /* Select given i2c line. */
     int (*do_i2c_sel)(struct pwrmon_boardinfo* board, uint8_t dev);
+    /* GPIO wired to the INA230 ALERT pins (active low), if any. */
+    uint8_t alert_gpio;
+    bool alert_configured;
 } pwrmon_board_info;
 
+/* Sample collected by the background sampler */
+struct pwrmon_sample {
+    uint32_t time_us;   /* Time of the sampler pass */
+    uint8_t dev;        /* Device ID */
+    uint8_t rail;       /* Power rail ID */
+    ina230_sample m;
+};
+
 /* Exported functions */
 int pwrmon_init(uint32_t current_lsb_uA,
                ina230_conversion_time ct,
@@ -103,5 +115,18 @@ int pwrmon_dev_count(void);
 int pwrmon_dev_rail_count(uint8_t dev);
 void pwrmon_deinit_rail(pwrmon_rail *pwrmon_dev);
 void pwrmon_deinit(void);
+int pwrmon_set_cnvr_alert(pwrmon_rail *pwrmon_r, bool enable);
+int pwrmon_ack_alert(pwrmon_rail *pwrmon_r);
+
+#ifdef CONFIG_ARA_SVC_PWRMON_SAMPLER
+int pwrmon_sampler_start(uint32_t current_lsb_uA,
+                         ina230_conversion_time ct,
+                         ina230_avg_count avg_count);
+void pwrmon_sampler_stop(void);
+int pwrmon_sampler_read(struct pwrmon_sample *samples, unsigned int count);
+uint32_t pwrmon_sampler_overruns(void);
+int pwrmon_sampler_energy(uint8_t dev, uint8_t rail, uint64_t *energy_uJ,
+                          uint64_t *time_us);
+#endif
 
 #endif
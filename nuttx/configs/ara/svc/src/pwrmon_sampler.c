@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Background sampling of all the power rails
+ *
+ * All the INA230 run in continuous mode with the same conversion time and
+ * averaging. Each pass of the sampler reads all the rails, in device order so
+ * that the I2C mux is switched once per device, and stores the samples in a
+ * ring of CONFIG_ARA_SVC_PWRMON_SAMPLER_DEPTH entries for the AP to drain.
+ *
+ * When the board wires the INA230 ALERT pins to a GPIO, the first rail is
+ * programmed to assert ALERT when a conversion completes and the passes are
+ * triggered by that interrupt, so the rails are sampled once per conversion.
+ * Otherwise, the passes run every CONFIG_ARA_SVC_PWRMON_SAMPLER_PERIOD ms.
+ *
+ * The energy drawn from each rail is integrated over the passes, assuming the
+ * power sampled by a pass was drawn since the previous one, so that it can be
+ * related to the traffic of the interfaces over the same period.
+ */
+
+#define DBG_COMP ARADBG_POWER
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/gpio.h>
+#include <nuttx/util.h>
+#include <nuttx/wqueue.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <ara_debug.h>
+#include "ara_board.h"
+#include "pwr_mon.h"
+
+#define PWRMON_SAMPLER_PERIOD   MSEC2TICK(CONFIG_ARA_SVC_PWRMON_SAMPLER_PERIOD)
+#define PWRMON_SAMPLER_DEPTH    CONFIG_ARA_SVC_PWRMON_SAMPLER_DEPTH
+
+struct pwrmon_sampler_rail {
+    pwrmon_rail *r;
+    uint64_t energy_pj;     /* Energy drawn, in pJ (uW x us) */
+    uint64_t time_us;       /* Time the energy was integrated over */
+};
+
+static struct {
+    pthread_mutex_t lock;
+    struct work_s work;
+    bool running;
+    bool stop;
+    uint32_t period;
+
+    /* All the rails, in device order */
+    struct pwrmon_sampler_rail *rails;
+    unsigned int num_rails;
+    uint32_t last_pass_us;
+    bool first_pass;
+
+    /* Rail asserting ALERT at the end of its conversions, if any */
+    pwrmon_rail *alert_rail;
+    uint8_t alert_gpio;
+
+    /* Ring of samples: head is the next one to write */
+    struct pwrmon_sample samples[PWRMON_SAMPLER_DEPTH];
+    unsigned int head;
+    unsigned int count;
+    uint32_t overruns;
+} sampler = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void pwrmon_sampler_push(const struct pwrmon_sample *s)
+{
+    sampler.samples[sampler.head] = *s;
+    sampler.head = (sampler.head + 1) % PWRMON_SAMPLER_DEPTH;
+    if (sampler.count < PWRMON_SAMPLER_DEPTH) {
+        sampler.count++;
+    } else {
+        /* The oldest sample was overwritten */
+        sampler.overruns++;
+    }
+}
+
+static void pwrmon_sampler_worker(void *data)
+{
+    struct pwrmon_sampler_rail *sr;
+    struct pwrmon_sample s;
+    uint32_t elapsed;
+    unsigned int i;
+
+    if (sampler.alert_rail) {
+        /*
+         * Acknowledge first, so that a conversion completing during the pass
+         * triggers the next one. The data registers keep their value until
+         * then.
+         */
+        if (pwrmon_ack_alert(sampler.alert_rail) <= 0) {
+            return;
+        }
+    }
+
+    s.time_us = TICK2USEC(clock_systimer());
+    elapsed = sampler.first_pass ? 0 : s.time_us - sampler.last_pass_us;
+    sampler.last_pass_us = s.time_us;
+    sampler.first_pass = false;
+
+    /* Don't hold the lock during the I2C accesses */
+    for (i = 0; i < sampler.num_rails; i++) {
+        sr = &sampler.rails[i];
+        if (pwrmon_measure_rail(sr->r, &s.m)) {
+            continue;
+        }
+        s.dev = sr->r->dev;
+        s.rail = sr->r->rail;
+
+        pthread_mutex_lock(&sampler.lock);
+        pwrmon_sampler_push(&s);
+        if (s.m.uW > 0) {
+            sr->energy_pj += (uint64_t)s.m.uW * elapsed;
+        }
+        sr->time_us += elapsed;
+        pthread_mutex_unlock(&sampler.lock);
+    }
+
+    if (!sampler.alert_rail) {
+        pthread_mutex_lock(&sampler.lock);
+        if (!sampler.stop) {
+            work_queue(HPWORK, &sampler.work, pwrmon_sampler_worker, NULL,
+                       sampler.period);
+        }
+        pthread_mutex_unlock(&sampler.lock);
+    }
+}
+
+static int pwrmon_sampler_irqhandler(int irq, void *context, void *priv)
+{
+    /* A pass in progress has already acknowledged the alert */
+    if (!sampler.stop && work_available(&sampler.work)) {
+        work_queue(HPWORK, &sampler.work, pwrmon_sampler_worker, NULL, 0);
+    }
+
+    return OK;
+}
+
+static void pwrmon_sampler_free_rails(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < sampler.num_rails; i++) {
+        pwrmon_deinit_rail(sampler.rails[i].r);
+    }
+    free(sampler.rails);
+    sampler.rails = NULL;
+    sampler.num_rails = 0;
+}
+
+static int pwrmon_sampler_init_rails(size_t num_devs)
+{
+    pwrmon_rail *r;
+    unsigned int count = 0;
+    uint8_t dev, rail;
+    int num_rails;
+
+    for (dev = 0; dev < num_devs; dev++) {
+        num_rails = pwrmon_dev_rail_count(dev);
+        if (num_rails > 0) {
+            count += num_rails;
+        }
+    }
+
+    sampler.rails = zalloc(count * sizeof(*sampler.rails));
+    if (!sampler.rails) {
+        return -ENOMEM;
+    }
+
+    for (dev = 0; dev < num_devs; dev++) {
+        num_rails = pwrmon_dev_rail_count(dev);
+        for (rail = 0; num_rails > 0 && rail < num_rails; rail++) {
+            r = pwrmon_init_rail(dev, rail);
+            if (!r) {
+                pwrmon_sampler_free_rails();
+                return -EIO;
+            }
+            sampler.rails[sampler.num_rails++].r = r;
+        }
+    }
+
+    return 0;
+}
+
+static int pwrmon_sampler_enable_alert(pwrmon_board_info *info)
+{
+    int ret;
+
+    sampler.alert_rail = sampler.rails[0].r;
+    sampler.alert_gpio = info->alert_gpio;
+
+    ret = pwrmon_set_cnvr_alert(sampler.alert_rail, true);
+    if (ret) {
+        sampler.alert_rail = NULL;
+        return ret;
+    }
+
+    gpio_activate(sampler.alert_gpio);
+    gpio_direction_in(sampler.alert_gpio);
+    gpio_irq_mask(sampler.alert_gpio);
+    gpio_irq_settriggering(sampler.alert_gpio, IRQ_TYPE_EDGE_FALLING);
+    gpio_irq_attach(sampler.alert_gpio, pwrmon_sampler_irqhandler, NULL);
+    gpio_irq_unmask(sampler.alert_gpio);
+
+    /* Release ALERT in case a conversion completed before the unmask */
+    pwrmon_ack_alert(sampler.alert_rail);
+
+    return 0;
+}
+
+static void pwrmon_sampler_disable_alert(void)
+{
+    if (!sampler.alert_rail) {
+        return;
+    }
+
+    gpio_irq_mask(sampler.alert_gpio);
+    gpio_deactivate(sampler.alert_gpio);
+    pwrmon_set_cnvr_alert(sampler.alert_rail, false);
+    sampler.alert_rail = NULL;
+}
+
+/**
+ * @brief           Start sampling all the power rails in the background.
+ *                  The power measurement library is owned by the sampler
+ *                  until pwrmon_sampler_stop() is called.
+ * @return          0 on success, standard error codes otherwise.
+ * @param[in]       current_lsb_uA: current measurement precision (LSB) in uA
+ * @param[in]       ct: sampling conversion time to be used
+ * @param[in]       avg_count: averaging sample count
+ */
+int pwrmon_sampler_start(uint32_t current_lsb_uA,
+                         ina230_conversion_time ct,
+                         ina230_avg_count avg_count)
+{
+    pwrmon_board_info *info;
+    size_t num_devs;
+    int ret;
+
+    if (sampler.running) {
+        return -EBUSY;
+    }
+
+    ret = pwrmon_init(current_lsb_uA, ct, avg_count, &num_devs);
+    if (ret) {
+        return ret;
+    }
+
+    ret = pwrmon_sampler_init_rails(num_devs);
+    if (ret || !sampler.num_rails) {
+        dbg_error("%s(): failed to init the rails! (%d)\n", __func__, ret);
+        pwrmon_deinit();
+        return ret ? ret : -ENODEV;
+    }
+
+    pthread_mutex_lock(&sampler.lock);
+    sampler.head = 0;
+    sampler.count = 0;
+    sampler.overruns = 0;
+    sampler.first_pass = true;
+    sampler.stop = false;
+    pthread_mutex_unlock(&sampler.lock);
+
+    info = board_get_pwrmon_info();
+    if (info->alert_configured && !pwrmon_sampler_enable_alert(info)) {
+        dbg_info("%s(): %u rails, sampled on conversion ready\n",
+                 __func__, sampler.num_rails);
+    } else {
+        /* Polling faster than the conversions only reads the same values */
+        sampler.period = MAX(PWRMON_SAMPLER_PERIOD,
+                             USEC2TICK(pwrmon_get_sampling_time(
+                                       sampler.rails[0].r)));
+        dbg_info("%s(): %u rails, sampled every %u ticks\n",
+                 __func__, sampler.num_rails, sampler.period);
+        work_queue(HPWORK, &sampler.work, pwrmon_sampler_worker, NULL,
+                   sampler.period);
+    }
+
+    sampler.running = true;
+
+    return 0;
+}
+
+/**
+ * @brief           Stop the background sampling and release the power
+ *                  measurement library. Samples not read yet are kept.
+ */
+void pwrmon_sampler_stop(void)
+{
+    if (!sampler.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&sampler.lock);
+    sampler.stop = true;
+    sampler.running = false;
+    pthread_mutex_unlock(&sampler.lock);
+
+    if (sampler.alert_rail) {
+        gpio_irq_mask(sampler.alert_gpio);
+    }
+    work_cancel(HPWORK, &sampler.work);
+
+    pwrmon_sampler_disable_alert();
+    pwrmon_sampler_free_rails();
+    pwrmon_deinit();
+}
+
+/**
+ * @brief           Read the oldest samples, removing them from the ring.
+ * @return          number of samples read
+ * @param[out]      samples: samples read, oldest first
+ * @param[in]       count: maximum number of samples to read
+ */
+int pwrmon_sampler_read(struct pwrmon_sample *samples, unsigned int count)
+{
+    unsigned int tail;
+    unsigned int i;
+
+    pthread_mutex_lock(&sampler.lock);
+
+    if (count > sampler.count) {
+        count = sampler.count;
+    }
+
+    tail = (sampler.head + PWRMON_SAMPLER_DEPTH - sampler.count) %
+           PWRMON_SAMPLER_DEPTH;
+    for (i = 0; i < count; i++) {
+        samples[i] = sampler.samples[(tail + i) % PWRMON_SAMPLER_DEPTH];
+    }
+    sampler.count -= count;
+
+    pthread_mutex_unlock(&sampler.lock);
+
+    return count;
+}
+
+/**
+ * @brief           Return the number of samples overwritten before being
+ *                  read since the sampler was started.
+ */
+uint32_t pwrmon_sampler_overruns(void)
+{
+    return sampler.overruns;
+}
+
+/**
+ * @brief           Return the energy drawn from a given power rail since the
+ *                  sampler was started.
+ * @return          0 on success, -ENODEV if the rail is not being sampled.
+ * @param[in]       dev: device ID
+ * @param[in]       rail: power rail ID
+ * @param[out]      energy_uJ: energy drawn, in uJ
+ * @param[out]      time_us: time the energy was integrated over, in us
+ */
+int pwrmon_sampler_energy(uint8_t dev, uint8_t rail, uint64_t *energy_uJ,
+                          uint64_t *time_us)
+{
+    struct pwrmon_sampler_rail *sr;
+    unsigned int i;
+    int ret = -ENODEV;
+
+    pthread_mutex_lock(&sampler.lock);
+
+    for (i = 0; sampler.running && i < sampler.num_rails; i++) {
+        sr = &sampler.rails[i];
+        if (sr->r->dev == dev && sr->r->rail == rail) {
+            *energy_uJ = sr->energy_pj / 1000000;
+            *time_us = sr->time_us;
+            ret = 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&sampler.lock);
+
+    return ret;
+}
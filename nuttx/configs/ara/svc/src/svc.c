@@ -31,6 +31,7 @@
 #include <nuttx/config.h>
 #include <nuttx/arch.h>
 #include <nuttx/util.h>
+#include <nuttx/mm/mempool.h>
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/unipro/unipro.h>
 #include <nuttx/power/pm.h>
@@ -53,6 +54,9 @@
 #include "gb_svc.h"
 #include <stm32_pm.h>
 #include "timesync.h"
+#include "link_pm.h"
+#include "conn_qos.h"
+#include "port_stats.h"
 
 #define SVCD_PRIORITY               (40)
 #define SVCD_STACK_SIZE             (2048)
@@ -90,8 +94,27 @@ struct svc_event_eject {
     uint32_t delay;
 };
 
+/*
+ * Event priority classes, highest first. The module mailbox events gate
+ * the connection setup by the AP, so they go before the link events,
+ * which go before the long power sequences of the ejections.
+ */
+enum svc_event_prio {
+    SVC_EVENT_PRIO_MAILBOX,
+    SVC_EVENT_PRIO_LINK,
+    SVC_EVENT_PRIO_POWER,
+    SVC_EVENT_PRIO_MAX,
+};
+
+#ifdef CONFIG_ARA_SVC_EVENT_POOL_SIZE
+#  define SVC_EVENT_POOL_SIZE       CONFIG_ARA_SVC_EVENT_POOL_SIZE
+#else
+#  define SVC_EVENT_POOL_SIZE       16
+#endif
+
 struct svc_event {
     int type;
+    enum svc_event_prio prio;
     struct list_head events;
     union {
         struct svc_event_ready_other ready_other;
@@ -100,7 +123,14 @@ struct svc_event {
     } data;
 };
 
-static struct list_head svc_events;
+static struct list_head svc_events[SVC_EVENT_PRIO_MAX];
+
+/*
+ * Preallocated events, so that no allocation is needed on the event path.
+ * The pool takes events from the heap once exhausted, not to lose any.
+ */
+static struct svc_event svc_event_storage[SVC_EVENT_POOL_SIZE];
+static struct mempool svc_event_pool;
 
 /* List of interfaces to eject */
 struct svc_eject_entry {
@@ -110,22 +140,41 @@ struct svc_eject_entry {
 };
 static struct list_head svc_eject_list;
 
+static enum svc_event_prio svc_event_prio(int type) {
+    switch (type) {
+    case SVC_EVENT_TYPE_READY_OTHER:
+        return SVC_EVENT_PRIO_MAILBOX;
+    case SVC_EVENT_TYPE_HOT_UNPLUG:
+        return SVC_EVENT_PRIO_LINK;
+    default:
+        return SVC_EVENT_PRIO_POWER;
+    }
+}
+
+/* Requires svc->lock */
 static struct svc_event *svc_event_create(int type) {
     struct svc_event *event;
 
-    event = malloc(sizeof(*event));
+    event = mempool_alloc(&svc_event_pool);
     if (!event) {
         return NULL;
     }
 
     event->type = type;
+    event->prio = svc_event_prio(type);
     list_init(&event->events);
     return event;
 }
 
+/* Requires svc->lock */
+static inline void svc_event_queue(struct svc_event *event) {
+    list_add(&svc_events[event->prio], &event->events);
+}
+
+/* Requires svc->lock */
 static inline void svc_event_destroy(struct svc_event *event) {
     list_del(&event->events);
-    free(event);
+    mempool_free(&svc_event_pool, event);
 }
 
 static int event_cb(struct tsb_switch_event *ev);
@@ -270,6 +319,10 @@ static int event_linkup(struct tsb_switch_event *ev) {
              ev->type, ev->linkup.port, interface_get_name(iface),
              ev->linkup.val, linkup_result);
 
+    /* Whatever the outcome, the peer may not be the one cached */
+    switch_dme_cache_invalidate(svc->sw, ev->linkup.port);
+    link_pm_port_down(ev->linkup.port);
+
     switch (ev->linkup.val) {
     case TSB_LINKUP_FAIL:
         interface_cancel_linkup_wd_atomic(iface);
@@ -286,7 +339,8 @@ static int event_linkup(struct tsb_switch_event *ev) {
        break;
     case TSB_LINKUP_SUCCESS:
         interface_cancel_linkup_wd_atomic(iface);
-        /* LinkUp succeeded, do nothing. The mailbox handshake follows */
+        interface_link_up_atomic(iface);
+        /* LinkUp succeeded, do nothing else. The mailbox handshake follows */
         break;
     default:
         dbg_error("%s: Unexpected LinkUp value: %u port: %u\n",
@@ -333,7 +387,7 @@ static int event_mailbox(struct tsb_switch_event *ev) {
             goto out;
         }
         svc_ev->data.ready_other.port = ev->mbox.port;
-        list_add(&svc_events, &svc_ev->events);
+        svc_event_queue(svc_ev);
         break;
     default:
         dbg_error("unexpected mailbox value: %u port: %u",
@@ -377,7 +431,7 @@ int svc_interface_eject_request(struct interface *iface, uint32_t delay)
         svc_ev->data.eject.iface = iface;
         svc_ev->data.eject.action = SVC_EJECT_START;
         svc_ev->data.eject.delay = delay;
-        list_add(&svc_events, &svc_ev->events);
+        svc_event_queue(svc_ev);
         pthread_cond_signal(&svc->cv);
     }
 
@@ -416,7 +470,7 @@ int svc_interface_eject_completion_notify(struct interface *iface)
     } else {
         svc_ev->data.eject.iface = iface;
         svc_ev->data.eject.action = SVC_EJECT_COMPLETED;
-        list_add(&svc_events, &svc_ev->events);
+        svc_event_queue(svc_ev);
         pthread_cond_signal(&svc->cv);
     }
 
@@ -450,7 +504,20 @@ int svc_interface_eject_request_all(uint32_t delay)
 }
 
 static int svc_event_init(void) {
-    list_init(&svc_events);
+    unsigned int i;
+    int rc;
+
+    for (i = 0; i < ARRAY_SIZE(svc_events); i++) {
+        list_init(&svc_events[i]);
+    }
+
+    rc = mempool_init(&svc_event_pool, svc_event_storage,
+                      sizeof(struct svc_event), ARRAY_SIZE(svc_event_storage),
+                      MEMPOOL_GROW);
+    if (rc) {
+        return rc;
+    }
+
     switch_event_register_listener(svc->sw, &evl);
     return 0;
 }
@@ -625,6 +692,14 @@ int svc_connection_create(uint8_t intf1_id, uint16_t cport1_id,
         return rc;
     }
 
+    /* The connection works without its QoS profile, just less smoothly */
+    rc = conn_qos_apply(&c);
+    if (rc) {
+        dbg_error("Failed to apply QoS profile to "
+                  "[p=%u,c=%u]<->[p=%u,c=%u]: %d\n", c.port_id0, c.cport_id0,
+                  c.port_id1, c.cport_id1, rc);
+    }
+
     /*
      * Let's connect the ap side first: SW-1231
      */
@@ -756,6 +831,8 @@ int svc_connection_destroy(uint8_t intf1_id, uint16_t cport1_id,
     c.device_id1    = interface_get_devid_by_id(intf2_id);
     c.cport_id1     = cport2_id;
 
+    conn_qos_release(&c);
+
     return switch_connection_destroy(sw, &c);
 }
 
@@ -1008,7 +1085,7 @@ int svc_intf_set_power_mode(uint8_t intf_id, struct unipro_link_cfg *cfg)
     if (port_id < 0)
         return -EINVAL;
 
-    return switch_configure_link(sw, port_id, cfg, NULL);
+    return link_pm_configure(sw, port_id, cfg);
 }
 
 /**
@@ -1099,6 +1176,8 @@ static int svc_handle_hot_unplug(uint8_t portid) {
 
     dbg_info("Hot_unplug event received for port %u (%s)\n",
              portid, interface_get_name(interface_get_by_portid(portid)));
+    switch_dme_cache_invalidate(svc->sw, portid);
+    link_pm_port_down(portid);
     intf_id = interface_get_id_by_portid(portid);
     if (intf_id < 0) {
         return intf_id;
@@ -1217,7 +1296,7 @@ int svc_hot_unplug(uint8_t portid, bool lock_interface)
             rc = -ENOMEM;
         } else {
             svc_ev->data.hot_unplug.port = portid;
-            list_add(&svc_events, &svc_ev->events);
+            svc_event_queue(svc_ev);
             pthread_cond_signal(&svc->cv);
         }
     }
@@ -1307,15 +1386,30 @@ static int svc_handle_eject(struct interface *iface,
     return rc;
 }
 
+/* Requires svc->lock */
+static struct svc_event *svc_event_next(void) {
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(svc_events); i++) {
+        if (!list_is_empty(&svc_events[i])) {
+            return list_entry(svc_events[i].next, struct svc_event, events);
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * @brief Main event loop processing routine
+ *
+ * Handles the queued events one at a time, highest priority first. svc->lock
+ * is released between two events, so that the events raised meanwhile get
+ * queued and, if more urgent, handled before the rest of the queue.
  */
 static int svc_handle_events(void) {
-    struct list_head *node, *next;
     struct svc_event *event;
 
-    list_foreach_safe(&svc_events, node, next) {
-        event = list_entry(node, struct svc_event, events);
+    while ((event = svc_event_next())) {
         switch (event->type) {
         case SVC_EVENT_TYPE_READY_OTHER:
             svc_handle_module_ready(event->data.ready_other.port);
@@ -1333,6 +1427,13 @@ static int svc_handle_events(void) {
         }
 
         svc_event_destroy(event);
+
+        if (svc->stop) {
+            break;
+        }
+
+        pthread_mutex_unlock(&svc->lock);
+        pthread_mutex_lock(&svc->lock);
     }
 
     return 0;
@@ -1384,6 +1485,24 @@ static int svcd_startup(void) {
     }
     svc->sw = sw;
 
+    rc = link_pm_init(sw);
+    if (rc) {
+        dbg_error("%s: Failed to initialize link power policy\n", __func__);
+        goto error2;
+    }
+
+    rc = conn_qos_init(sw);
+    if (rc) {
+        dbg_error("%s: Failed to initialize connection QoS\n", __func__);
+        goto error2;
+    }
+
+    rc = port_stats_init(sw);
+    if (rc) {
+        dbg_error("%s: Failed to start port statistics\n", __func__);
+        goto error2;
+    }
+
     /* Enable the switch IRQ */
     rc = switch_irq_enable(sw, true);
     if (rc && (rc != -EOPNOTSUPP)) {
@@ -1431,6 +1550,9 @@ static int svcd_startup(void) {
 error3:
     interface_exit();
 error2:
+    port_stats_exit();
+    conn_qos_exit();
+    link_pm_exit();
     switch_exit(sw);
     svc->sw = NULL;
 error1:
@@ -1441,19 +1563,25 @@ error0:
 
 static int svcd_cleanup(void) {
     struct list_head *node, *next;
+    unsigned int i;
 
     gb_deinit();
 
     interface_exit();
 
+    port_stats_exit();
+    conn_qos_exit();
+    link_pm_exit();
     switch_exit(svc->sw);
     svc->sw = NULL;
 
     ara_board_exit();
     svc->board_info = NULL;
 
-    list_foreach_safe(&svc_events, node, next) {
-        svc_event_destroy(list_entry(node, struct svc_event, events));
+    for (i = 0; i < ARRAY_SIZE(svc_events); i++) {
+        list_foreach_safe(&svc_events[i], node, next) {
+            svc_event_destroy(list_entry(node, struct svc_event, events));
+        }
     }
 
     list_foreach_safe(&svc_eject_list, node, next) {
@@ -331,31 +331,123 @@ static int set_valid_entry(struct tsb_switch *sw,
     return sw->ops->__set_valid_entry(sw, table, entry, valid);
 }
 
-int switch_set_valid_device(struct tsb_switch *sw,
-                            uint8_t port_id,
-                            uint8_t device_id,
-                            bool valid) {
-    uint8_t id_mask[sw->rdata->dev_id_mask_size];
+static bool check_valid_entry(struct tsb_switch *sw,
+                              uint8_t *table, int entry);
+
+/*
+ * Routing table shadows
+ *
+ * Require the calling context to hold sw->route_lock
+ */
+
+static void route_shadows_reset(struct tsb_switch *sw) {
+    sw->dev_id_masks_valid = 0;
+    memset(sw->lut, INVALID_PORT, sizeof(sw->lut));
+}
+
+/* Get the shadow of the device ID mask of a port, loading it if needed */
+static uint8_t *route_dev_id_mask(struct tsb_switch *sw, uint8_t port_id) {
+    size_t size = sw->rdata->dev_id_mask_size;
+    uint8_t *mask;
+
+    if (port_id >= SWITCH_PORT_MAX) {
+        return NULL;
+    }
+
+    if (!sw->dev_id_masks) {
+        sw->dev_id_masks = zalloc(SWITCH_PORT_MAX * size);
+        if (!sw->dev_id_masks) {
+            return NULL;
+        }
+    }
+
+    mask = &sw->dev_id_masks[port_id * size];
+    if (!(sw->dev_id_masks_valid & (1 << port_id))) {
+        if (switch_dev_id_mask_get(sw, port_id, mask)) {
+            dbg_error("Failed to get valid device bitmask for port %u\n",
+                      port_id);
+            return NULL;
+        }
+        sw->dev_id_masks_valid |= 1 << port_id;
+    }
+
+    return mask;
+}
+
+/*
+ * Change the shadow of the device ID mask of a port, and flag it in
+ * *dirty if that is a change
+ */
+static int route_dev_id_mask_update(struct tsb_switch *sw,
+                                    uint8_t port_id,
+                                    uint8_t device_id,
+                                    bool valid,
+                                    uint16_t *dirty) {
+    uint8_t *mask;
     int rc;
 
-    rc = switch_dev_id_mask_get(sw, port_id, id_mask);
-    if (rc) {
-        dbg_error("Failed to get valid device bitmask for port %u\n", port_id);
-        return rc;
+    mask = route_dev_id_mask(sw, port_id);
+    if (!mask) {
+        return -EIO;
+    }
+
+    if (check_valid_entry(sw, mask, device_id) == valid) {
+        return 0;
     }
 
-    rc = set_valid_entry(sw, id_mask, device_id, valid);
+    rc = set_valid_entry(sw, mask, device_id, valid);
     if (rc) {
         dbg_error("Failed to set valid device bitmask for port %u\n", port_id);
+        sw->dev_id_masks_valid &= ~(1 << port_id);
         return rc;
     }
 
-    rc = switch_dev_id_mask_set(sw, port_id, id_mask);
+    *dirty |= 1 << port_id;
+    return 0;
+}
+
+/* Write the device ID masks flagged in dirty */
+static int route_dev_id_masks_write(struct tsb_switch *sw, uint16_t dirty) {
+    size_t size = sw->rdata->dev_id_mask_size;
+    uint8_t port_id;
+    int rc;
+
+    for (port_id = 0; port_id < SWITCH_PORT_MAX; port_id++) {
+        if (!(dirty & (1 << port_id))) {
+            continue;
+        }
+
+        rc = switch_dev_id_mask_set(sw, port_id,
+                                    &sw->dev_id_masks[port_id * size]);
+        if (rc) {
+            dbg_error("Failed to set valid device bitmask for port %u\n",
+                      port_id);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+int switch_set_valid_device(struct tsb_switch *sw,
+                            uint8_t port_id,
+                            uint8_t device_id,
+                            bool valid) {
+    uint16_t dirty = 0;
+    int rc;
+
+    pthread_mutex_lock(&sw->route_lock);
+
+    rc = route_dev_id_mask_update(sw, port_id, device_id, valid, &dirty);
+    if (!rc) {
+        rc = route_dev_id_masks_write(sw, dirty);
+    }
     if (rc) {
-        dbg_error("Failed to set valid device bitmask for port %u\n", port_id);
-        return rc;
+        sw->dev_id_masks_valid &= ~dirty;
     }
 
+    pthread_mutex_unlock(&sw->route_lock);
+
     return rc;
 }
 
@@ -405,7 +497,8 @@ int switch_dump_routing_table(struct tsb_switch *sw) {
 int switch_enable_test_traffic(struct tsb_switch *sw,
                                uint8_t src_portid, uint8_t dst_portid,
                                const struct unipro_test_feature_cfg *cfg) {
-    int i, rc;
+    struct switch_ncp_queue q;
+    int i;
     uint16_t src_cportid = cfg->tf_src_cportid;
     uint16_t dst_cportid = cfg->tf_dst_cportid;
     struct pasv {
@@ -525,21 +618,20 @@ int switch_enable_test_traffic(struct tsb_switch *sw,
                  dst_cportid);
     }
 
+    switch_ncp_queue_init(&q, sw);
     for (i = 0; i < ARRAY_SIZE(test_src_enable); i++) {
         struct pasv *s = &test_src_enable[i];
-        rc = switch_dme_peer_set(sw, s->p, s->a, s->s, s->v);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_peer_set(&q, s->p, s->a, s->s, s->v, NULL, NULL);
     }
 
-    return 0;
+    return switch_ncp_queue_flush(&q);
 }
 
 int switch_disable_test_traffic(struct tsb_switch *sw,
                                 uint8_t src_portid, uint8_t dst_portid,
                                 const struct unipro_test_feature_cfg *cfg) {
-    int rc, i;
+    struct switch_ncp_queue q;
+    int i;
     uint16_t src_cportid = cfg->tf_src_cportid;
     uint16_t dst_cportid = cfg->tf_dst_cportid;
     struct pasv {
@@ -590,15 +682,39 @@ int switch_disable_test_traffic(struct tsb_switch *sw,
 
     dbg_info("Disabling UniPro test feature: port=%u,src=%u->port=%u,dst=%u\n",
              src_portid, cfg->tf_src, dst_portid, cfg->tf_dst);
+    switch_ncp_queue_init(&q, sw);
     for (i = 0; i < ARRAY_SIZE(test_src_disable); i++) {
         struct pasv *s = &test_src_disable[i];
-        rc = switch_dme_peer_set(sw, s->p, s->a, s->s, s->v);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_peer_set(&q, s->p, s->a, s->s, s->v, NULL, NULL);
     }
 
-    return 0;
+    return switch_ncp_queue_flush(&q);
+}
+
+/**
+ * @brief Read the counters of a running test feature destination
+ *
+ * @param msg_count messages received since the test traffic was enabled
+ * @param error_code error code of the destination, 0 if no error was
+ *        detected (only meaningful with error detection enabled)
+ */
+int switch_get_test_traffic_stats(struct tsb_switch *sw, uint8_t dst_portid,
+                                  const struct unipro_test_feature_cfg *cfg,
+                                  uint32_t *msg_count, uint32_t *error_code) {
+    int rc;
+
+    if (!sw || dst_portid >= SWITCH_PORT_MAX) {
+        return -EINVAL;
+    }
+
+    rc = switch_dme_peer_get(sw, dst_portid, T_TSTDSTMESSAGECOUNT,
+                             cfg->tf_dst, msg_count);
+    if (rc) {
+        return rc;
+    }
+
+    return switch_dme_peer_get(sw, dst_portid, T_TSTDSTERRORCODE,
+                               cfg->tf_dst, error_code);
 }
 
 int switch_qos_band_reset(struct tsb_switch *sw, uint8_t portid) {
@@ -809,14 +925,31 @@ int switch_qos_peer_implements_tc(struct tsb_switch *sw, uint8_t portid,
                                   uint8_t tc, uint8_t *val) {
     int rc;
     uint32_t attr_val;
+    bool valid;
 
     if (!sw || portid >= SWITCH_UNIPORT_MAX || !val) {
         return -EINVAL;
     }
 
-    rc = switch_qos_attr_get(sw, portid, AR_STATUS_INTERRUPT, &attr_val);
-    if (rc) {
-        return rc;
+    /* The traffic classes of the peer don't change while the link is up */
+    pthread_mutex_lock(&sw->dme_cache_lock);
+    valid = sw->dme_cache[portid].tc_present_valid;
+    attr_val = sw->dme_cache[portid].tc_present;
+    pthread_mutex_unlock(&sw->dme_cache_lock);
+
+    if (!valid) {
+        rc = switch_qos_attr_get(sw, portid, AR_STATUS_INTERRUPT, &attr_val);
+        if (rc) {
+            return rc;
+        }
+
+        attr_val &= AR_STATUS_INTERRUPT_PRESENT_TC0 |
+                    AR_STATUS_INTERRUPT_PRESENT_TC1;
+
+        pthread_mutex_lock(&sw->dme_cache_lock);
+        sw->dme_cache[portid].tc_present = attr_val;
+        sw->dme_cache[portid].tc_present_valid = true;
+        pthread_mutex_unlock(&sw->dme_cache_lock);
     }
 
     switch (tc) {
@@ -1761,58 +1894,207 @@ int switch_if_dev_id_set(struct tsb_switch *sw,
     return 0;
 }
 
+/*
+ * Completion of the LUT set of a source port: undo its deviceid_valid
+ * on failure
+ */
+static void switch_lut_set_done(struct tsb_switch *sw, int rc, void *priv) {
+    uint8_t port_id = (uint8_t)(uintptr_t)priv;
+
+    if (rc) {
+        dbg_error("Failed to set Lut for source port %u, disabling\n",
+                  port_id);
+        switch_dme_peer_set(sw, port_id, N_DEVICEID_VALID,
+                            UNIPRO_SELINDEX_NULL, 0);
+    }
+}
+
+/*
+ * Queue the LUT entry routing device_id from port_id to dest_port_id,
+ * unless the switch already has it. Requires sw->route_lock.
+ */
+static void route_lut_queue(struct switch_ncp_queue *q,
+                            uint8_t port_id,
+                            uint8_t device_id,
+                            uint8_t dest_port_id,
+                            uint16_t *lut_ports) {
+    struct tsb_switch *sw = q->sw;
+
+    if (port_id < SWITCH_PORT_MAX && device_id < SWITCH_LUT_SHADOW_SIZE) {
+        if (sw->lut[port_id][device_id] == dest_port_id) {
+            return;
+        }
+        sw->lut[port_id][device_id] = dest_port_id;
+        *lut_ports |= 1 << port_id;
+    }
+
+    switch_ncp_queue_lut_set(q, port_id, device_id, dest_port_id,
+                             switch_lut_set_done,
+                             (void *)(uintptr_t)port_id);
+}
+
+void switch_route_batch_init(struct switch_route_batch *b,
+                             struct tsb_switch *sw) {
+    b->sw = sw;
+    b->count = 0;
+    b->rc = 0;
+}
+
+static int switch_route_batch_queue(struct switch_route_batch *b,
+                                    uint8_t device_id_0,
+                                    uint8_t port_id_0,
+                                    uint8_t device_id_1,
+                                    uint8_t port_id_1,
+                                    bool valid) {
+    struct switch_route *r;
+
+    if (b->count == SWITCH_ROUTE_BATCH_SIZE) {
+        /* Keep the error for the final commit */
+        b->rc = switch_route_batch_commit(b);
+    }
+
+    r = &b->routes[b->count++];
+    r->device_id_0 = device_id_0;
+    r->port_id_0 = port_id_0;
+    r->device_id_1 = device_id_1;
+    r->port_id_1 = port_id_1;
+    r->valid = valid;
+
+    return b->rc;
+}
+
 /**
- * @brief Setup network routing table
+ * @brief Add a bidirectional route between two ports to a batch
+ */
+int switch_route_batch_add(struct switch_route_batch *b,
+                           uint8_t device_id_0,
+                           uint8_t port_id_0,
+                           uint8_t device_id_1,
+                           uint8_t port_id_1) {
+    return switch_route_batch_queue(b, device_id_0, port_id_0,
+                                    device_id_1, port_id_1, true);
+}
+
+/**
+ * @brief Add the removal of a bidirectional route to a batch
+ */
+int switch_route_batch_remove(struct switch_route_batch *b,
+                              uint8_t device_id_0,
+                              uint8_t port_id_0,
+                              uint8_t device_id_1,
+                              uint8_t port_id_1) {
+    return switch_route_batch_queue(b, device_id_0, port_id_0,
+                                    device_id_1, port_id_1, false);
+}
+
+/**
+ * @brief Apply the routes of a batch
  *
- * Setup of the deviceID Mask tables (if supported) and the Switch LUTs,
- * bidirectionally between the source and destination Switch ports.
+ * The device ID masks are all written first, then the LUT entries of the
+ * new routes and the N_DEVICEID_VALID reset of the removed ones.
+ *
+ * @return 0 on success, the first error of the batch otherwise
  */
-int switch_setup_routing_table(struct tsb_switch *sw,
-                               uint8_t device_id_0,
-                               uint8_t port_id_0,
-                               uint8_t device_id_1,
-                               uint8_t port_id_1) {
+int switch_route_batch_commit(struct switch_route_batch *b) {
+    struct tsb_switch *sw = b->sw;
+    struct switch_ncp_queue q;
+    struct switch_route *r;
+    uint16_t dirty = 0;
+    uint16_t lut_ports = 0;
+    unsigned int i;
+    uint8_t port_id;
+    int rc = 0;
 
-    int rc;
+    pthread_mutex_lock(&sw->route_lock);
 
-    dbg_verbose("Setup routing table [p=%u:d=%u]<->[p=%u:d=%u]\n",
-                device_id_0, port_id_0, device_id_1, port_id_1);
+    for (i = 0; i < b->count && !rc; i++) {
+        r = &b->routes[i];
 
-    // Set valid device bitmask 0->1
-    rc = switch_set_valid_device(sw, port_id_0, device_id_1, true);
-    if (rc) {
-        return rc;
+        dbg_verbose("%s routing table [p=%u:d=%u]<->[p=%u:d=%u]\n",
+                    r->valid ? "Setup" : "Invalidate",
+                    r->port_id_0, r->device_id_0,
+                    r->port_id_1, r->device_id_1);
+
+        // Valid device bitmasks 0->1 and 1->0
+        rc = route_dev_id_mask_update(sw, r->port_id_0, r->device_id_1,
+                                      r->valid, &dirty);
+        if (!rc) {
+            rc = route_dev_id_mask_update(sw, r->port_id_1, r->device_id_0,
+                                          r->valid, &dirty);
+        }
     }
 
-    // Set valid device bitmask 1->0
-    rc = switch_set_valid_device(sw, port_id_1, device_id_0, true);
-    if (rc) {
-        return rc;
+    if (!rc) {
+        rc = route_dev_id_masks_write(sw, dirty);
+    }
+
+    if (!rc) {
+        switch_ncp_queue_init(&q, sw);
+        for (i = 0; i < b->count; i++) {
+            r = &b->routes[i];
+
+            if (r->valid) {
+                // Routing table for devices 0->1 and 1->0
+                route_lut_queue(&q, r->port_id_0, r->device_id_1,
+                                r->port_id_1, &lut_ports);
+                route_lut_queue(&q, r->port_id_1, r->device_id_0,
+                                r->port_id_0, &lut_ports);
+            } else {
+                /* Undo deviceid_valid attributes for both ports */
+                switch_ncp_queue_dme_peer_set(&q, r->port_id_0,
+                                              N_DEVICEID_VALID,
+                                              UNIPRO_SELINDEX_NULL, 0,
+                                              NULL, NULL);
+                switch_ncp_queue_dme_peer_set(&q, r->port_id_1,
+                                              N_DEVICEID_VALID,
+                                              UNIPRO_SELINDEX_NULL, 0,
+                                              NULL, NULL);
+            }
+        }
+
+        rc = switch_ncp_queue_flush(&q);
+        if (rc) {
+            for (port_id = 0; port_id < SWITCH_PORT_MAX; port_id++) {
+                if (lut_ports & (1 << port_id)) {
+                    memset(sw->lut[port_id], INVALID_PORT,
+                           sizeof(sw->lut[port_id]));
+                }
+            }
+        }
     }
 
-    // Setup routing table for devices 0->1
-    rc = switch_lut_set(sw, port_id_0, device_id_1, port_id_1);
     if (rc) {
-        dbg_error("Failed to set Lut for source port %u, disabling\n",
-                  port_id_0);
-        /* Undo deviceid_valid on failure */
-        switch_dme_peer_set(sw, port_id_0, N_DEVICEID_VALID,
-                            UNIPRO_SELINDEX_NULL, 0);
-        return rc;
+        sw->dev_id_masks_valid &= ~dirty;
     }
 
-    // Setup routing table for devices 1->0
-    rc = switch_lut_set(sw, port_id_1, device_id_0, port_id_0);
-    if (rc) {
-        dbg_error("Failed to set Lut for source port %u, disabling\n",
-                  port_id_1);
-        /* Undo deviceid_valid on failure */
-        switch_dme_peer_set(sw, port_id_1, N_DEVICEID_VALID,
-                            UNIPRO_SELINDEX_NULL, 0);
-        return rc;
+    pthread_mutex_unlock(&sw->route_lock);
+
+    if (!rc) {
+        rc = b->rc;
     }
+    b->count = 0;
+    b->rc = 0;
 
-    return 0;
+    return rc;
+}
+
+/**
+ * @brief Setup network routing table
+ *
+ * Setup of the deviceID Mask tables (if supported) and the Switch LUTs,
+ * bidirectionally between the source and destination Switch ports.
+ */
+int switch_setup_routing_table(struct tsb_switch *sw,
+                               uint8_t device_id_0,
+                               uint8_t port_id_0,
+                               uint8_t device_id_1,
+                               uint8_t port_id_1) {
+    struct switch_route_batch b;
+
+    switch_route_batch_init(&b, sw);
+    switch_route_batch_add(&b, device_id_0, port_id_0, device_id_1, port_id_1);
+
+    return switch_route_batch_commit(&b);
 }
 
 /**
@@ -1826,33 +2108,13 @@ int switch_invalidate_routing_table(struct tsb_switch *sw,
                                     uint8_t port_id_0,
                                     uint8_t device_id_1,
                                     uint8_t port_id_1) {
+    struct switch_route_batch b;
 
-    int rc;
-
-    dbg_verbose("Invalidate routing table [p=%u:d=%u]<->[p=%u:d=%u]\n",
-                device_id_0, port_id_0, device_id_1, port_id_1);
+    switch_route_batch_init(&b, sw);
+    switch_route_batch_remove(&b, device_id_0, port_id_0,
+                              device_id_1, port_id_1);
 
-    // Set invalid device bitmask 0->1
-    rc = switch_set_valid_device(sw, port_id_0, device_id_1, false);
-    if (rc) {
-        return rc;
-    }
-
-    // Set invalid device bitmask 1->0
-    rc = switch_set_valid_device(sw, port_id_1, device_id_0, false);
-    if (rc) {
-        return rc;
-    }
-
-    /* Undo deviceid_valid attribute for device 0's port */
-    switch_dme_peer_set(sw, port_id_0, N_DEVICEID_VALID,
-                        UNIPRO_SELINDEX_NULL, 0);
-
-    /* Undo deviceid_valid attribute for device 1's port */
-    switch_dme_peer_set(sw, port_id_1, N_DEVICEID_VALID,
-                        UNIPRO_SELINDEX_NULL, 0);
-
-    return 0;
+    return switch_route_batch_commit(&b);
 }
 
 /**
@@ -2163,66 +2425,59 @@ static int switch_configure_link_tsbdata
         (struct tsb_switch *sw,
          uint8_t port_id,
          const struct tsb_local_l2_timer_cfg *tcfg) {
-    int rc = 0;
+    struct switch_ncp_queue q;
     const unsigned int flags = tcfg->tsb_flags;
+
+    switch_ncp_queue_init(&q, sw);
     if (flags & TSB_LOCALL2F_FC0) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_FC0PROTECTIONTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_fc0_protection_timeout);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_FC0PROTECTIONTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_fc0_protection_timeout,
+                                 NULL, NULL);
     }
     if (flags & TSB_LOCALL2F_TC0) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_TC0REPLAYTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_tc0_replay_timeout);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_TC0REPLAYTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_tc0_replay_timeout,
+                                 NULL, NULL);
     }
     if (flags & TSB_LOCALL2F_AFC0) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_AFC0REQTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_afc0_req_timeout);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_AFC0REQTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_afc0_req_timeout,
+                                 NULL, NULL);
     }
     if (flags & TSB_LOCALL2F_FC1) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_FC1PROTECTIONTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_fc1_protection_timeout);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_FC1PROTECTIONTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_fc1_protection_timeout,
+                                 NULL, NULL);
     }
     if (flags & TSB_LOCALL2F_TC1) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_TC1REPLAYTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_tc1_replay_timeout);
-        if (rc) {
-            return rc;
-        }
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_TC1REPLAYTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_tc1_replay_timeout,
+                                 NULL, NULL);
     }
     if (flags & TSB_LOCALL2F_AFC1) {
-        rc = switch_dme_set(sw,
-                            port_id,
-                            DME_AFC1REQTIMEOUTVAL,
-                            UNIPRO_SELINDEX_NULL,
-                            tcfg->tsb_afc1_req_timeout);
+        switch_ncp_queue_dme_set(&q,
+                                 port_id,
+                                 DME_AFC1REQTIMEOUTVAL,
+                                 UNIPRO_SELINDEX_NULL,
+                                 tcfg->tsb_afc1_req_timeout,
+                                 NULL, NULL);
     }
-    return rc;
+    return switch_ncp_queue_flush(&q);
 }
 
 static int switch_apply_power_mode(struct tsb_switch *sw,
@@ -2571,6 +2826,8 @@ struct tsb_switch *switch_init(struct tsb_switch_data *pdata) {
 
     sw->pdata = pdata;
     sem_init(&sw->sw_irq_lock, 0, 0);
+    pthread_mutex_init(&sw->dme_cache_lock, NULL);
+    pthread_mutex_init(&sw->route_lock, NULL);
     sw->worker_id = 0;
     sw->sw_irq_worker_exit = false;
 
@@ -2643,6 +2900,7 @@ struct tsb_switch *switch_init(struct tsb_switch_data *pdata) {
     // Init port <-> deviceID mapping table
     dev_ids_destroy(sw);
     dev_ids_update(sw, SWITCH_PORT_ID, SWITCH_DEVICE_ID);
+    route_shadows_reset(sw);
 
     /*
      * Set initial SVC deviceId to SWITCH_DEVICE_ID and setup
@@ -2707,6 +2965,7 @@ void switch_exit(struct tsb_switch *sw)
     }
 
     switch_power_off(sw);
+    free(sw->dev_id_masks);
     free(sw);
 }
 
@@ -35,6 +35,7 @@
 #define  _TSB_SWITCH_H_
 
 #include <sched.h>
+#include <pthread.h>
 
 #include <nuttx/list.h>
 #include <nuttx/spi/spi.h>
@@ -374,6 +375,56 @@ struct tsb_link_cfg {
  */
 struct tsb_switch;
 
+/*
+ * NCP command queue
+ *
+ * Set requests, and DME get requests, can be queued and sent to the
+ * switch together: switch
+ * revisions implementing __ncp_transfer_batch write all the queued
+ * requests into the NCP FIFO in a single SPI transaction and collect
+ * their CNFs back to back afterwards, so the switch keeps executing
+ * commands while the SVC polls for the earlier confirmations. Other
+ * revisions get the requests one at a time, as before.
+ *
+ * A queue lives on the caller's stack. It is flushed when full and by
+ * switch_ncp_queue_flush(), which returns the first error of the queue:
+ * a negative errno, or the positive NCP return code of the first
+ * command the switch refused. Each command may also carry a completion
+ * callback, called with its own result once its CNF was received. The
+ * callbacks run after the whole transfer, so they may issue NCP commands
+ * of their own, though not on the queue being flushed. The values read
+ * by get requests are only stored once the queue is flushed.
+ */
+#define SWITCH_NCP_QUEUE_DEPTH      (8)
+#define SWITCH_NCP_QUEUE_REQ_SIZE   (12)
+#define SWITCH_NCP_QUEUE_CNF_SIZE   (8)
+
+typedef void (*switch_ncp_done_t)(struct tsb_switch *sw, int rc, void *priv);
+
+struct switch_ncp_cmd {
+    uint8_t             req[SWITCH_NCP_QUEUE_REQ_SIZE];
+    size_t              req_size;
+    uint8_t             cnf[SWITCH_NCP_QUEUE_CNF_SIZE];
+    size_t              cnf_size;
+    /* Transfer status, set by __ncp_transfer_batch */
+    int                 rc;
+    /* Expected CNF function ID, and where the CNF keeps it and the rc */
+    uint8_t             function_id;
+    uint8_t             function_id_offset;
+    uint8_t             rc_offset;
+    switch_ncp_done_t   done;
+    void                *priv;
+    /* Get requests: where to store the value at the end of the CNF */
+    uint32_t            *value;
+};
+
+struct switch_ncp_queue {
+    struct tsb_switch       *sw;
+    unsigned int            count;
+    int                     rc;
+    struct switch_ncp_cmd   cmds[SWITCH_NCP_QUEUE_DEPTH];
+};
+
 struct tsb_switch_ops {
     int (*init_comm)(struct tsb_switch *);
 
@@ -476,6 +527,10 @@ struct tsb_switch_ops {
     int (*__ncp_transfer)(struct tsb_switch *sw,
                           uint8_t *tx_buf, size_t tx_size,
                           uint8_t *rx_buf, size_t rx_size);
+    /* Optional: send several NCP requests, then read their CNFs */
+    int (*__ncp_transfer_batch)(struct tsb_switch *sw,
+                                struct switch_ncp_cmd *cmds,
+                                unsigned int count);
     int (*__irq_fifo_rx)(struct tsb_switch *sw, unsigned int spi_fifo);
     int (*__set_valid_entry)(struct tsb_switch *sw,
                              uint8_t *table, int entry, bool valid);
@@ -483,6 +538,81 @@ struct tsb_switch_ops {
                                 uint8_t *table, int entry);
 };
 
+/*
+ * DME attribute cache
+ *
+ * The attributes which can't change while a link is up (DDBL1, Ara IDs,
+ * lane counts and gear capabilities) are kept per port once read, so
+ * repeated queries don't go over SPI and UniPro again. The cache of a
+ * port is invalidated with switch_dme_cache_invalidate() on its link
+ * events.
+ */
+#define SWITCH_DME_CACHE_SIZE       (8)
+
+struct switch_dme_cache_entry {
+    uint16_t    attrid;
+    uint16_t    select_index;
+    uint32_t    value;
+    bool        peer;
+};
+
+struct switch_dme_cache {
+    unsigned int                    count;
+    /* Entry to replace next once full */
+    unsigned int                    next;
+    struct switch_dme_cache_entry   entries[SWITCH_DME_CACHE_SIZE];
+    /* Peer traffic class presence, see switch_qos_peer_implements_tc() */
+    bool                            tc_present_valid;
+    uint32_t                        tc_present;
+};
+
+/*
+ * Routing table batches
+ *
+ * Routes added to or removed from a batch are applied together by
+ * switch_route_batch_commit(): the device ID mask of every port involved
+ * is written once with all the changes, and the LUT entries are sent
+ * through an NCP queue. The masks and the LUT entries are shadowed in
+ * the switch handle, so that nothing is written which the switch already
+ * has, and the masks are not read back before each change.
+ *
+ * If a commit fails, the shadows of the ports involved are reloaded from
+ * the switch on their next use.
+ */
+#define SWITCH_ROUTE_BATCH_SIZE     (8)
+/* Device IDs whose LUT entries are shadowed */
+#define SWITCH_LUT_SHADOW_SIZE      (32)
+
+struct switch_route {
+    uint8_t device_id_0;
+    uint8_t port_id_0;
+    uint8_t device_id_1;
+    uint8_t port_id_1;
+    bool    valid;
+};
+
+struct switch_route_batch {
+    struct tsb_switch   *sw;
+    unsigned int        count;
+    int                 rc;
+    struct switch_route routes[SWITCH_ROUTE_BATCH_SIZE];
+};
+
+/*
+ * Error indications counted per port by the IRQ handler. The first ones
+ * follow the order of the port IRQ status bits.
+ */
+enum switch_port_error {
+    SWITCH_PORT_ERR_PHY,
+    SWITCH_PORT_ERR_PA,
+    SWITCH_PORT_ERR_DL,
+    SWITCH_PORT_ERR_NL,
+    SWITCH_PORT_ERR_TL,
+    SWITCH_PORT_ERR_PA_INIT,
+    SWITCH_PORT_ERR_LINK_LOST,
+    SWITCH_PORT_ERR_MAX,
+};
+
 struct tsb_switch {
     void                    *priv;
     struct tsb_switch_ops   *ops;
@@ -495,6 +625,18 @@ struct tsb_switch {
     uint8_t                 dev_ids[SWITCH_PORT_MAX];
 
     struct list_head        listeners;
+
+    pthread_mutex_t         dme_cache_lock;
+    struct switch_dme_cache dme_cache[SWITCH_PORT_MAX];
+
+    /* Routing table shadows, see struct switch_route_batch */
+    pthread_mutex_t         route_lock;
+    uint8_t                 *dev_id_masks;
+    uint16_t                dev_id_masks_valid;
+    uint8_t                 lut[SWITCH_PORT_MAX][SWITCH_LUT_SHADOW_SIZE];
+
+    /* Only written by the IRQ worker */
+    uint32_t                port_errors[SWITCH_PORT_MAX][SWITCH_PORT_ERR_MAX];
 };
 
 /*
@@ -565,6 +707,49 @@ int switch_dev_id_mask_set(struct tsb_switch *sw,
                            uint8_t unipro_portid,
                            uint8_t *mask);
 
+void switch_dme_cache_invalidate(struct tsb_switch *sw, uint8_t portid);
+
+/*
+ * Queued NCP set requests, see struct switch_ncp_queue
+ */
+
+void switch_ncp_queue_init(struct switch_ncp_queue *q, struct tsb_switch *sw);
+
+int switch_ncp_queue_dme_set(struct switch_ncp_queue *q,
+                             uint8_t portid,
+                             uint16_t attrid,
+                             uint16_t select_index,
+                             uint32_t attr_value,
+                             switch_ncp_done_t done, void *priv);
+
+int switch_ncp_queue_dme_peer_set(struct switch_ncp_queue *q,
+                                  uint8_t portid,
+                                  uint16_t attrid,
+                                  uint16_t select_index,
+                                  uint32_t attr_value,
+                                  switch_ncp_done_t done, void *priv);
+
+int switch_ncp_queue_dme_get(struct switch_ncp_queue *q,
+                             uint8_t portid,
+                             uint16_t attrid,
+                             uint16_t select_index,
+                             uint32_t *attr_value,
+                             switch_ncp_done_t done, void *priv);
+
+int switch_ncp_queue_lut_set(struct switch_ncp_queue *q,
+                             uint8_t unipro_portid,
+                             uint8_t addr,
+                             uint8_t dst_portid,
+                             switch_ncp_done_t done, void *priv);
+
+int switch_ncp_queue_qos_attr_set(struct switch_ncp_queue *q,
+                                  uint8_t portid,
+                                  uint8_t attrid,
+                                  uint32_t attr_val,
+                                  switch_ncp_done_t done, void *priv);
+
+int switch_ncp_queue_flush(struct switch_ncp_queue *q);
+
 /*
  * Switch events
  */
@@ -700,6 +885,20 @@ int switch_invalidate_routing_table(struct tsb_switch *sw,
 
 int switch_dump_routing_table(struct tsb_switch *sw);
 
+void switch_route_batch_init(struct switch_route_batch *b,
+                             struct tsb_switch *sw);
+int switch_route_batch_add(struct switch_route_batch *b,
+                           uint8_t device_id_0,
+                           uint8_t port_id_0,
+                           uint8_t device_id_1,
+                           uint8_t port_id_1);
+int switch_route_batch_remove(struct switch_route_batch *b,
+                              uint8_t device_id_0,
+                              uint8_t port_id_0,
+                              uint8_t device_id_1,
+                              uint8_t port_id_1);
+int switch_route_batch_commit(struct switch_route_batch *b);
+
 /**
  * @brief Parameters used by the UniPro Test Feature
  */
@@ -756,6 +955,10 @@ int switch_disable_test_traffic(struct tsb_switch *sw,
                                 uint8_t src_portid, uint8_t dst_portid,
                                 const struct unipro_test_feature_cfg *cfg);
 
+int switch_get_test_traffic_stats(struct tsb_switch *sw, uint8_t dst_portid,
+                                  const struct unipro_test_feature_cfg *cfg,
+                                  uint32_t *msg_count, uint32_t *error_code);
+
 /*
  * Revision (ES2, ES3) specific data for switch management
  */
@@ -333,6 +333,74 @@ done:
     return rc;
 }
 
+/*
+ * Queue all the requests in the NCP FIFO within a single SPI transaction,
+ * then read the CNFs, which the switch returns in the same order. The
+ * switch works on the next requests while the earlier CNFs are polled.
+ */
+static int es3_ncp_transfer_batch(struct tsb_switch *sw,
+                                  struct switch_ncp_cmd *cmds,
+                                  unsigned int count) {
+    struct sw_es3_priv *priv = sw->priv;
+    struct spi_dev_s *spi_dev = sw->spi_dev;
+    size_t out_size = 0;
+    unsigned int i;
+    int rc = 0;
+
+    uint8_t write_trailer[] = {
+        ENDP,
+    };
+
+    pthread_mutex_lock(&priv->ncp_cport.lock);
+
+    _switch_spi_select(sw, true);
+
+    for (i = 0; i < count; i++) {
+        uint8_t write_header[] = {
+            STRW,
+            SWITCH_FIFO_NCP,
+            (cmds[i].req_size & 0xFF00) >> 8,
+            (cmds[i].req_size & 0xFF),
+        };
+
+        SPI_SNDBLOCK(spi_dev, write_header, sizeof write_header);
+        SPI_SNDBLOCK(spi_dev, cmds[i].req, cmds[i].req_size);
+        SPI_SNDBLOCK(spi_dev, write_trailer, sizeof write_trailer);
+        out_size += sizeof write_header + cmds[i].req_size +
+                    sizeof write_trailer;
+
+        dbg_insane("TX Data (%d):\n", cmds[i].req_size);
+        dbg_print_buf(ARADBG_INSANE, cmds[i].req, cmds[i].req_size);
+    }
+
+    _switch_spi_select(sw, false);
+
+    for (i = 0; i < count; i++) {
+        /*
+         * Once a CNF is lost, the ones after it can't be matched with
+         * their request anymore.
+         */
+        if (rc) {
+            cmds[i].rc = rc;
+            continue;
+        }
+
+        /* Only the first read completes the 16-bit frames of the writes */
+        cmds[i].rc = es3_ncp_read(sw, SWITCH_FIFO_NCP, cmds[i].cnf,
+                                  cmds[i].cnf_size, out_size);
+        out_size = 0;
+        if (cmds[i].rc) {
+            dbg_error("%s() read %u/%u failed: rc=%d\n", __func__, i, count,
+                      cmds[i].rc);
+            rc = cmds[i].rc;
+        }
+    }
+
+    pthread_mutex_unlock(&priv->ncp_cport.lock);
+
+    return rc;
+}
+
 /* Status report data size */
 #define SRPT_REPORT_SIZE             (12)
 /* Status report total size: 7 bytes header + data + Switch reply delay */
@@ -1214,6 +1282,7 @@ static struct tsb_switch_ops es3_ops = {
     .__post_init_seq       = es3_post_init_seq,
     .__irq_fifo_rx         = es3_irq_fifo_rx,
     .__ncp_transfer        = es3_ncp_transfer,
+    .__ncp_transfer_batch  = es3_ncp_transfer_batch,
     .__set_valid_entry     = es3_set_valid_entry,
     .__check_valid_entry   = es3_check_valid_entry,
 };
@@ -33,6 +33,7 @@
 #include <nuttx/unipro/unipro.h>
 #include "stm32.h"
 #include <sys/wait.h>
+#include <unistd.h>
 #include <ara_debug.h>
 
 #include <nuttx/power/pm.h>
@@ -219,35 +220,207 @@ int tsb_switch_event_notify(struct tsb_switch *sw,
     return 0;
 }
 
-static void switch_port_irq_reenable(struct tsb_switch *sw, uint8_t port)
-{
+/*
+ * Coalesced port IRQ handling
+ *
+ * The interrupt status of all the pending ports is read in one NCP batch,
+ * then the attributes of all their asserted sources in another one, before
+ * the events are dispatched. The IRQ worker is the only user of these.
+ */
+#define SWITCH_IRQ_BATCH_MAX    (32)
+
+/* Back-to-back handler passes after which the IRQ worker backs off */
+#define SWITCH_IRQ_THROTTLE_PASSES  (8)
+#define SWITCH_IRQ_THROTTLE_US      (1000)
+
+struct switch_irq_source {
+    uint8_t port;
+    uint8_t irq_type;
+    int rc;
     uint32_t attr_value;
+};
+
+static uint32_t irq_port_status[SWITCH_PORT_MAX];
+static uint32_t irq_port_enable[SWITCH_PORT_MAX];
+static int irq_port_rc[SWITCH_PORT_MAX];
+static struct switch_irq_source irq_sources[SWITCH_IRQ_BATCH_MAX];
+
+static void switch_irq_read_done(struct tsb_switch *sw, int rc, void *priv) {
+    *(int *)priv = rc;
+}
+
+static void switch_port_irq_dispatch(struct tsb_switch *sw,
+                                     struct switch_irq_source *src) {
+    uint32_t irq_type = src->irq_type;
+    uint32_t port = src->port;
+    uint32_t attr_value = src->attr_value;
+    int rc;
+
+    if (src->rc) {
+        dbg_error("IRQ: Port %u line %u attr(0x%04x) read failed\n",
+                  port, irq_type, unipro_irq_attr[irq_type]);
+    } else {
+        dbg_insane("IRQ: Port %u line %u asserted, attr(0x%04x)=0x%04x\n",
+                   port, irq_type, unipro_irq_attr[irq_type], attr_value);
+    }
+
+    switch (irq_type) {
+    case IRQ_STATUS_ERRORPHYIND:
+    case IRQ_STATUS_ERRORPAIND:
+    case IRQ_STATUS_ERRORDIND:
+    case IRQ_STATUS_ERRORNIND:
+    case IRQ_STATUS_ERRORTIND:
+    case IRQ_STATUS_PAINITERROR:
+        sw->port_errors[port][irq_type - IRQ_STATUS_ERRORPHYIND +
+                              SWITCH_PORT_ERR_PHY]++;
+        break;
+    case IRQ_STATUS_LINKLOSTIND:
+        sw->port_errors[port][SWITCH_PORT_ERR_LINK_LOST]++;
+        break;
+    case IRQ_STATUS_POWERMODEIND: {
+        struct interface *iface;
+        iface = interface_get_by_portid(port);
+        if (iface) {
+            atomic_init(&iface->dme_powermodeind, attr_value);
+        }
+        break;
+    }
+    case IRQ_STATUS_LINKSTARTUPIND: {
+        struct tsb_switch_event e;
+        e.type = TSB_SWITCH_EVENT_LINKUP_IND;
+        e.linkup.port = port;
+        e.linkup.val = attr_value;
+        rc = tsb_switch_event_notify(sw, &e);
+        if (rc) {
+            dbg_error("IRQ: LinkUpInd event notification failed for port %u: %d\n",
+                      port, rc);
+        }
+        break;
+    }
+    case IRQ_STATUS_LINKSTARTUPCNF: {
+        struct tsb_switch_event e;
+        e.type = TSB_SWITCH_EVENT_LINKUP;
+        e.linkup.port = port;
+        e.linkup.val = attr_value;
+        rc = tsb_switch_event_notify(sw, &e);
+        if (rc) {
+            dbg_error("IRQ: LinkUp event notification failed for port %u: %d\n",
+                      port, rc);
+        }
+        break;
+    }
+    case IRQ_STATUS_MAILBOX: {
+        struct tsb_switch_event e;
+        e.type = TSB_SWITCH_EVENT_MAILBOX;
+        e.mbox.port = port;
+        e.mbox.val = attr_value;
+        rc = tsb_switch_event_notify(sw, &e);
+        if (rc) {
+            dbg_error("IRQ: Mailbox event notification failed for port %u: %d\n",
+                      port, rc);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* Read the attributes of the queued sources, then dispatch their events */
+static void switch_irq_sources_flush(struct switch_ncp_queue *q,
+                                     unsigned int count) {
+    unsigned int i;
+
+    switch_ncp_queue_flush(q);
+
+    for (i = 0; i < count; i++) {
+        switch_port_irq_dispatch(q->sw, &irq_sources[i]);
+    }
+}
+
+static void switch_port_irqs_handle(struct tsb_switch *sw, uint32_t swint) {
+    struct switch_ncp_queue q;
+    struct switch_irq_source *src;
+    bool reenable_hack;
+    unsigned int count = 0;
+    int i, j;
+
+    reenable_hack = sw->rdata->rflags & TSB_SWITCH_RFLAG_REENABLE_PORT_IRQ_HACK;
+
+    /* Interrupt status of the pending ports, and enables of the powered ones */
+    switch_ncp_queue_init(&q, sw);
+    for (i = 0; i < SWITCH_PORT_MAX; i++) {
+        /* Ports which are not read, or fail to read, are left alone */
+        irq_port_enable[i] = ~0U;
+        if (reenable_hack &&
+            interface_get_vsys_state(interface_get_by_portid(i)) ==
+            ARA_IFACE_PWR_UP) {
+            switch_ncp_queue_dme_get(&q, i, TSB_INTERRUPTENABLE, 0x0,
+                                     &irq_port_enable[i], NULL, NULL);
+        }
+
+        irq_port_rc[i] = -ENOENT;
+        if (swint & (1 << i)) {
+            switch_ncp_queue_dme_get(&q, i, TSB_INTERRUPTSTATUS, 0x0,
+                                     &irq_port_status[i], switch_irq_read_done,
+                                     &irq_port_rc[i]);
+        }
+    }
+    switch_ncp_queue_flush(&q);
 
     /*
-     * We got interrupted, but something inside the switch
-     * disabled the interrupt source. This happens if e.g. a port
-     * re-links up.
-     *
-     * Check the interrupt enable attribute, if interrupts are
-     * disabled for the port, re-enable them. Since the interrupt is
-     * latched in the switch it will fire again after enablement.
+     * We got interrupted, but something inside the switch disabled the
+     * interrupt source of a port. This happens if e.g. a port re-links up.
+     * Since the interrupt is latched in the switch it will fire again
+     * after enablement.
      */
-    if (switch_dme_get(sw, port, TSB_INTERRUPTENABLE, 0x0,
-                       &attr_value)) {
-        dbg_error("IRQ: Port %u TSB_INTERRUPTENABLE read failed\n",
-                  port);
-    } else {
-        if (!attr_value) {
-            dbg_insane("IRQ: port %u TSB_INTERRUPTENABLE=%d\n",
-                       port, attr_value);
-            switch_port_irq_enable(sw, port, true);
+    for (i = 0; i < SWITCH_PORT_MAX; i++) {
+        if (!irq_port_enable[i]) {
+            dbg_insane("IRQ: port %u TSB_INTERRUPTENABLE=%d\n", i,
+                       irq_port_enable[i]);
+            switch_port_irq_enable(sw, (uint8_t)i, true);
+        }
+    }
+
+    // Read the attributes associated to the interrupt sources
+    for (i = 0; i < SWITCH_PORT_MAX; i++) {
+        if (!(swint & (1 << i))) {
+            continue;
+        }
+        if (irq_port_rc[i]) {
+            dbg_error("IRQ: TSB_INTERRUPTSTATUS(%d) register read failed\n",
+                      i);
+            continue;
+        }
+        dbg_insane("IRQ: TSB_INTERRUPTSTATUS(%d)=0x%04x\n",
+                   i, irq_port_status[i]);
+
+        for (j = 0; j < SWITCH_IRQ_MAX; j++) {
+            if (!(irq_port_status[i] & (1 << j)) || !unipro_irq_attr[j]) {
+                continue;
+            }
+
+            if (count == SWITCH_IRQ_BATCH_MAX) {
+                switch_irq_sources_flush(&q, count);
+                count = 0;
+            }
+
+            src = &irq_sources[count++];
+            src->port = i;
+            src->irq_type = j;
+            src->rc = 0;
+            src->attr_value = 0;
+            switch_ncp_queue_dme_get(&q, i, unipro_irq_attr[j], 0x0,
+                                     &src->attr_value, switch_irq_read_done,
+                                     &src->rc);
         }
     }
+
+    switch_irq_sources_flush(&q, count);
 }
 
 static int switch_threaded_irq_handler(struct tsb_switch *sw) {
-    uint32_t swint, swins, port_irq_status, attr_value;
-    int i, j, rc;
+    uint32_t swint, swins, attr_value;
 
     if (!sw) {
         dbg_error("%s: no Switch context\n", __func__);
@@ -315,92 +488,7 @@ static int switch_threaded_irq_handler(struct tsb_switch *sw) {
          * SW-1527: Read the interrupt status on a disabled port returns
          * the error 0x23 (DISABLED_TARGET) and generates a new IRQ (!)
          */
-        for (i = 0; i < SWITCH_PORT_MAX; i++) {
-            if (sw->rdata->rflags & TSB_SWITCH_RFLAG_REENABLE_PORT_IRQ_HACK) {
-                if (interface_get_vsys_state(interface_get_by_portid(i)) ==
-                    ARA_IFACE_PWR_UP) {
-                    switch_port_irq_reenable(sw, (uint8_t)i);
-                }
-            }
-
-            // If Unipro interrupt pending, read the interrupt status attribute
-            if (swint & (1 << i)) {
-                if (switch_dme_get(sw, i, TSB_INTERRUPTSTATUS, 0x0,
-                                   &port_irq_status)) {
-                    dbg_error("IRQ: TSB_INTERRUPTSTATUS(%d) register read failed\n",
-                              i);
-                    break;
-                }
-                dbg_insane("IRQ: TSB_INTERRUPTSTATUS(%d)=0x%04x\n",
-                           i, port_irq_status);
-
-                // Read the attributes associated to the interrupt sources
-                for (j = 0; j < SWITCH_IRQ_MAX; j++) {
-                    if ((port_irq_status & (1 << j)) && unipro_irq_attr[j]) {
-                        if (switch_dme_get(sw, i, unipro_irq_attr[j], 0x0,
-                                           &attr_value)) {
-                            dbg_error("IRQ: Port %d line %d attr(0x%04x) read failed\n",
-                                      i, j, unipro_irq_attr[j]);
-                        } else {
-                            dbg_insane("IRQ: Port %d line %d asserted, attr(0x%04x)=0x%04x\n",
-                                       i, j, unipro_irq_attr[j], attr_value);
-                        }
-
-                        uint32_t irq_type = j;
-                        uint32_t port = i;
-                        switch (irq_type) {
-                        case IRQ_STATUS_POWERMODEIND: {
-                            struct interface *iface;
-                            iface = interface_get_by_portid(port);
-                            if (iface) {
-                                atomic_init(&iface->dme_powermodeind,
-                                            attr_value);
-                            }
-                            break;
-                        }
-                        case IRQ_STATUS_LINKSTARTUPIND: {
-                            struct tsb_switch_event e;
-                            e.type = TSB_SWITCH_EVENT_LINKUP_IND;
-                            e.linkup.port = port;
-                            e.linkup.val = attr_value;
-                            rc = tsb_switch_event_notify(sw, &e);
-                            if (rc) {
-                                dbg_error("IRQ: LinkUpInd event notification failed for port %u: %d\n",
-                                          port, rc);
-                            }
-                            break;
-                        }
-                        case IRQ_STATUS_LINKSTARTUPCNF: {
-                            struct tsb_switch_event e;
-                            e.type = TSB_SWITCH_EVENT_LINKUP;
-                            e.linkup.port = port;
-                            e.linkup.val = attr_value;
-                            rc = tsb_switch_event_notify(sw, &e);
-                            if (rc) {
-                                dbg_error("IRQ: LinkUp event notification failed for port %u: %d\n",
-                                          port, rc);
-                            }
-                            break;
-                        }
-                        case IRQ_STATUS_MAILBOX: {
-                            struct tsb_switch_event e;
-                            e.type = TSB_SWITCH_EVENT_MAILBOX;
-                            e.mbox.port = port;
-                            e.mbox.val = attr_value;
-                            rc = tsb_switch_event_notify(sw, &e);
-                            if (rc) {
-                                dbg_error("IRQ: Mailbox event notification failed for port %u: %d\n",
-                                          port, rc);
-                            }
-                            break;
-                        }
-                        default:
-                            break;
-                        }
-                    }
-                }
-            }
-        }
+        switch_port_irqs_handle(sw, swint);
 
     } while (swint);
 
@@ -419,6 +507,8 @@ int switch_post_irq(struct tsb_switch *sw)
 int _switch_irq_pending_worker(int argc, char *argv[])
 {
     struct tsb_switch *sw = (struct tsb_switch *) strtol(argv[1], NULL, 16);
+    unsigned int passes = 0;
+    int sval;
 
     if (!sw) {
         dbg_error("%s: no Switch context\n", __func__);
@@ -431,8 +521,30 @@ int _switch_irq_pending_worker(int argc, char *argv[])
         if (sw->sw_irq_worker_exit)
             break;
 
+        /*
+         * The handler loops until the switch has no pending interrupt
+         * left, so the IRQs which fired in the meantime are served by
+         * this pass already.
+         */
+        while (!sem_trywait(&sw->sw_irq_lock)) {
+            ;
+        }
+
         /* Calls the low level handler to clear the interrupt source */
         switch_threaded_irq_handler(sw);
+
+        /*
+         * Leave some room to the other tasks when the switch keeps
+         * interrupting back to back, e.g. on a flapping link.
+         */
+        if (!sem_getvalue(&sw->sw_irq_lock, &sval) && sval > 0) {
+            if (++passes >= SWITCH_IRQ_THROTTLE_PASSES) {
+                passes = 0;
+                usleep(SWITCH_IRQ_THROTTLE_US);
+            }
+        } else {
+            passes = 0;
+        }
     }
 
     return 0;
@@ -230,6 +230,115 @@ int _switch_internal_set_id(struct tsb_switch *sw,
     return cnf.rc;
 }
 
+/*
+ * DME attribute cache
+ */
+
+static bool dme_cache_attr_immutable(uint16_t attrid) {
+    switch (attrid) {
+    case PA_AVAILTXDATALANES:
+    case PA_AVAILRXDATALANES:
+    case PA_MAXRXPWMGEAR:
+    case PA_MAXRXHSGEAR:
+    case PA_LOCALVERINFO:
+    case T_NUMCPORTS:
+    case DME_DDBL1_REVISION:
+    case DME_DDBL1_LEVEL:
+    case DME_DDBL1_DEVICECLASS:
+    case DME_DDBL1_MANUFACTURERID:
+    case DME_DDBL1_PRODUCTID:
+    case DME_DDBL1_LENGTH:
+    case TSB_ARA_VID:
+    case TSB_ARA_PID:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool dme_cache_lookup(struct tsb_switch *sw,
+                             uint8_t portid,
+                             bool peer,
+                             uint16_t attrid,
+                             uint16_t select_index,
+                             uint32_t *attr_value) {
+    struct switch_dme_cache *cache;
+    struct switch_dme_cache_entry *entry;
+    bool found = false;
+    unsigned int i;
+
+    if (portid >= SWITCH_PORT_MAX || !dme_cache_attr_immutable(attrid)) {
+        return false;
+    }
+
+    cache = &sw->dme_cache[portid];
+
+    pthread_mutex_lock(&sw->dme_cache_lock);
+    for (i = 0; i < cache->count; i++) {
+        entry = &cache->entries[i];
+        if (entry->attrid == attrid && entry->select_index == select_index &&
+            entry->peer == peer) {
+            *attr_value = entry->value;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sw->dme_cache_lock);
+
+    return found;
+}
+
+static void dme_cache_store(struct tsb_switch *sw,
+                            uint8_t portid,
+                            bool peer,
+                            uint16_t attrid,
+                            uint16_t select_index,
+                            uint32_t attr_value) {
+    struct switch_dme_cache *cache;
+    struct switch_dme_cache_entry *entry;
+
+    if (portid >= SWITCH_PORT_MAX || !dme_cache_attr_immutable(attrid)) {
+        return;
+    }
+
+    cache = &sw->dme_cache[portid];
+
+    pthread_mutex_lock(&sw->dme_cache_lock);
+    if (cache->count < SWITCH_DME_CACHE_SIZE) {
+        entry = &cache->entries[cache->count++];
+    } else {
+        entry = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % SWITCH_DME_CACHE_SIZE;
+    }
+    entry->attrid = attrid;
+    entry->select_index = select_index;
+    entry->value = attr_value;
+    entry->peer = peer;
+    pthread_mutex_unlock(&sw->dme_cache_lock);
+}
+
+/**
+ * @brief Forget the cached attributes of a port
+ *
+ * To be called whenever the link of the port goes up or down, or the
+ * module on it is replaced.
+ */
+void switch_dme_cache_invalidate(struct tsb_switch *sw, uint8_t portid) {
+    struct switch_dme_cache *cache;
+
+    if (!sw || portid >= SWITCH_PORT_MAX) {
+        return;
+    }
+
+    cache = &sw->dme_cache[portid];
+
+    pthread_mutex_lock(&sw->dme_cache_lock);
+    cache->count = 0;
+    cache->next = 0;
+    cache->tc_present_valid = false;
+    pthread_mutex_unlock(&sw->dme_cache_lock);
+}
+
 /*
  * DME accessors
  */
@@ -290,6 +399,11 @@ int switch_dme_get(struct tsb_switch *sw,
     dbg_verbose("%s(): portId=%d, attrId=0x%04x, selectIndex=%d\n",
                 __func__, portid, attrid, select_index);
 
+    if (dme_cache_lookup(sw, portid, false, attrid, select_index,
+                         attr_value)) {
+        return 0;
+    }
+
     get_dme_get_req(sw, portid, attrid, select_index,
                     req, &req_size);
     rc = ncp_transfer(sw, req, req_size, (uint8_t*)&cnf, sizeof(struct cnf));
@@ -306,6 +420,10 @@ int switch_dme_get(struct tsb_switch *sw,
     dbg_verbose("%s(): fid=0x%02x, rc=%u, attr(0x%04x)=0x%04x\n",
                 __func__, cnf.function_id, cnf.rc, attrid, *attr_value);
 
+    if (cnf.rc == NCP_RC_SUCCESS) {
+        dme_cache_store(sw, portid, false, attrid, select_index, *attr_value);
+    }
+
     return cnf.rc;
 }
 
@@ -366,6 +484,11 @@ int switch_dme_peer_get(struct tsb_switch *sw,
     dbg_verbose("%s(): portid=%d, attrId=0x%04x, selectIndex=%d\n",
                  __func__, portid, attrid, select_index);
 
+    if (dme_cache_lookup(sw, portid, true, attrid, select_index,
+                         attr_value)) {
+        return 0;
+    }
+
     get_dme_peer_get_req(sw, portid, attrid, select_index, req, &req_size);
     rc = ncp_transfer(sw, req, req_size, (uint8_t*)&cnf, sizeof(struct cnf));
     if (rc) {
@@ -382,6 +505,10 @@ int switch_dme_peer_get(struct tsb_switch *sw,
     dbg_verbose("%s(): fid=0x%02x, rc=%u, attr(0x%04x)=0x%04x\n",
                 __func__, cnf.function_id, cnf.rc, attrid, *attr_value);
 
+    if (cnf.rc == NCP_RC_SUCCESS) {
+        dme_cache_store(sw, portid, true, attrid, select_index, *attr_value);
+    }
+
     return cnf.rc;
 }
 
@@ -841,3 +968,210 @@ int switch_dev_id_mask_set(struct tsb_switch *sw,
     /* Return resultCode */
     return cnf.rc;
 }
+
+/*
+ * NCP command queue
+ */
+
+void switch_ncp_queue_init(struct switch_ncp_queue *q, struct tsb_switch *sw) {
+    q->sw = sw;
+    q->count = 0;
+    q->rc = 0;
+}
+
+/*
+ * Reserve the next command of the queue, flushing it first if full.
+ * The caller fills in the request; its buffer is req, of size *req_size.
+ */
+static struct switch_ncp_cmd *ncp_queue_get(struct switch_ncp_queue *q,
+                                            uint8_t function_id,
+                                            uint8_t function_id_offset,
+                                            uint8_t rc_offset,
+                                            switch_ncp_done_t done,
+                                            void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    if (q->count == SWITCH_NCP_QUEUE_DEPTH) {
+        /* Keep the error for the final flush */
+        q->rc = switch_ncp_queue_flush(q);
+    }
+
+    cmd = &q->cmds[q->count++];
+    cmd->req_size = sizeof(cmd->req);
+    cmd->cnf_size = sizeof(cmd->cnf);
+    cmd->rc = 0;
+    cmd->function_id = function_id;
+    cmd->function_id_offset = function_id_offset;
+    cmd->rc_offset = rc_offset;
+    cmd->done = done;
+    cmd->priv = priv;
+    cmd->value = NULL;
+    memset(cmd->cnf, 0, sizeof(cmd->cnf));
+
+    return cmd;
+}
+
+int switch_ncp_queue_dme_set(struct switch_ncp_queue *q,
+                             uint8_t portid,
+                             uint16_t attrid,
+                             uint16_t select_index,
+                             uint32_t attr_value,
+                             switch_ncp_done_t done, void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    dbg_verbose("%s(): portId=%d, attrId=0x%04x, selectIndex=%d, val=0x%04x\n",
+                __func__, portid, attrid, select_index, attr_value);
+
+    /* CNF: portid, function_id, reserved, rc */
+    cmd = ncp_queue_get(q, NCP_SETCNF, 1, 3, done, priv);
+    get_dme_set_req(q->sw, portid, attrid, select_index, attr_value,
+                    cmd->req, &cmd->req_size);
+
+    return q->rc;
+}
+
+int switch_ncp_queue_dme_get(struct switch_ncp_queue *q,
+                             uint8_t portid,
+                             uint16_t attrid,
+                             uint16_t select_index,
+                             uint32_t *attr_value,
+                             switch_ncp_done_t done, void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    dbg_verbose("%s(): portId=%d, attrId=0x%04x, selectIndex=%d\n",
+                __func__, portid, attrid, select_index);
+
+    /* CNF: portid, function_id, reserved, rc, attr_val */
+    cmd = ncp_queue_get(q, NCP_GETCNF, 1, 3, done, priv);
+    cmd->value = attr_value;
+    get_dme_get_req(q->sw, portid, attrid, select_index,
+                    cmd->req, &cmd->req_size);
+
+    return q->rc;
+}
+
+int switch_ncp_queue_dme_peer_set(struct switch_ncp_queue *q,
+                                  uint8_t portid,
+                                  uint16_t attrid,
+                                  uint16_t select_index,
+                                  uint32_t attr_value,
+                                  switch_ncp_done_t done, void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    dbg_verbose("%s(): portid=%d, attrId=0x%04x, selectIndex=%d, val=0x%04x\n",
+                __func__, portid, attrid, select_index, attr_value);
+
+    /* CNF: portid, function_id, reserved, rc */
+    cmd = ncp_queue_get(q, NCP_PEERSETCNF, 1, 3, done, priv);
+    get_dme_peer_set_req(q->sw, portid, attrid, select_index, attr_value,
+                         cmd->req, &cmd->req_size);
+
+    return q->rc;
+}
+
+int switch_ncp_queue_lut_set(struct switch_ncp_queue *q,
+                             uint8_t unipro_portid,
+                             uint8_t addr,
+                             uint8_t dst_portid,
+                             switch_ncp_done_t done, void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    dbg_verbose("%s(): unipro_portid=%d, lutAddress=%d, destPortId=%d\n",
+                __func__, unipro_portid, addr, dst_portid);
+
+    /* CNF: rc, function_id, and two pad bytes */
+    cmd = ncp_queue_get(q, NCP_LUTSETCNF, 1, 0, done, priv);
+    get_lut_set_req(q->sw, unipro_portid, addr, dst_portid,
+                    cmd->req, &cmd->req_size);
+
+    return q->rc;
+}
+
+int switch_ncp_queue_qos_attr_set(struct switch_ncp_queue *q,
+                                  uint8_t portid,
+                                  uint8_t attrid,
+                                  uint32_t attr_val,
+                                  switch_ncp_done_t done, void *priv) {
+    struct switch_ncp_cmd *cmd;
+
+    dbg_verbose("%s: portid: %u attrid: %u attr_val: %u\n",
+                __func__, portid, attrid, attr_val);
+
+    /*
+     * CNF: portid, function_id, reserved, rc on ES2 but
+     * rc, function_id, portid, reserved on ES3.
+     */
+    switch (q->sw->pdata->rev) {
+    case SWITCH_REV_ES2:
+        cmd = ncp_queue_get(q, NCP_QOSATTRSETCNF, 1, 3, done, priv);
+        break;
+    case SWITCH_REV_ES3:
+        cmd = ncp_queue_get(q, NCP_QOSATTRSETCNF, 1, 0, done, priv);
+        break;
+    default:
+        dbg_error("%s: unsupported switch revision: %u\n",
+                  __func__, q->sw->pdata->rev);
+        return -EINVAL;
+    }
+
+    get_qos_attr_set_req(q->sw, portid, attrid, attr_val,
+                         cmd->req, &cmd->req_size);
+
+    return q->rc;
+}
+
+int switch_ncp_queue_flush(struct switch_ncp_queue *q) {
+    struct tsb_switch *sw = q->sw;
+    struct switch_ncp_cmd *cmd;
+    unsigned int i;
+    int rc;
+
+    if (sw->ops->__ncp_transfer_batch) {
+        if (q->count) {
+            sw->ops->__ncp_transfer_batch(sw, q->cmds, q->count);
+        }
+    } else {
+        for (i = 0; i < q->count; i++) {
+            cmd = &q->cmds[i];
+            cmd->rc = ncp_transfer(sw, cmd->req, cmd->req_size,
+                                   cmd->cnf, cmd->cnf_size);
+        }
+    }
+
+    for (i = 0; i < q->count; i++) {
+        cmd = &q->cmds[i];
+
+        rc = cmd->rc;
+        if (rc) {
+            dbg_error("%s(): NCP request 0x%x failed: rc=%d\n",
+                      __func__, cmd->function_id - 1, rc);
+        } else if (cmd->cnf[cmd->function_id_offset] != cmd->function_id) {
+            dbg_error("%s(): unexpected CNF 0x%x\n",
+                      __func__, cmd->cnf[cmd->function_id_offset]);
+            rc = -EPROTO;
+        } else {
+            rc = cmd->cnf[cmd->rc_offset];
+        }
+
+        if (!rc && cmd->value) {
+            uint32_t val;
+
+            memcpy(&val, &cmd->cnf[4], sizeof(val));
+            *cmd->value = be32_to_cpu(val);
+        }
+
+        if (rc && !q->rc) {
+            q->rc = rc;
+        }
+
+        if (cmd->done) {
+            cmd->done(sw, rc, cmd->priv);
+        }
+    }
+
+    q->count = 0;
+    rc = q->rc;
+    q->rc = 0;
+
+    return rc;
+}
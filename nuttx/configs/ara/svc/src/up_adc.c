@@ -70,10 +70,14 @@
 
 #include <nuttx/config.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <ara_debug.h>
 #include <arch/board/board.h>
 #include <up_adc.h>
 #include <stm32_adc.h>
+#include <stm32_dma.h>
 #include <chip.h>
 #include <up_arch.h>
 
@@ -127,6 +131,37 @@ static const uint32_t adc_gpio[ADC_NCHANNEL][ADC_COUNT] = {
 /* Number of averaging samples (common to all channels) */
 static uint8_t adc_avg_count;
 
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+#define ADC_DMA_SCR     (DMA_SCR_PRIMED | DMA_SCR_MSIZE_16BITS | \
+                         DMA_SCR_PSIZE_16BITS | DMA_SCR_MINC | \
+                         DMA_SCR_CIRC | DMA_SCR_DIR_P2M)
+/* Polling period while waiting for the first average of a new scan */
+#define ADC_DMA_POLL_US 1000
+
+/*
+ * Continuous scan of one ADC. The DMA fills a circular buffer of two halves,
+ * each holding 'rows' conversions of the whole sequence. When a half is full
+ * it is averaged channel by channel into avg[], which is what reads return.
+ */
+struct adc_scan {
+    DMA_HANDLE dma;
+    uint16_t chanmask;              /* Channels in the sequence */
+    uint8_t nchan;                  /* Sequence length, 0 when stopped */
+    uint8_t slot[ADC_NCHANNEL];     /* Position of each channel in sequence */
+    uint16_t rows;                  /* Sequences per half buffer */
+    uint16_t *buf;                  /* 2 * rows * nchan samples */
+    volatile uint16_t avg[ADC_NCHANNEL]; /* Latest averages, by slot */
+    volatile uint32_t blocks;       /* Half buffers averaged since start */
+    volatile bool error;            /* DMA error, scan stopped */
+};
+
+static const uint32_t adc_dmamap[ADC_COUNT] = {
+    DMACHAN_ADC1, DMACHAN_ADC2, DMACHAN_ADC3
+};
+
+static struct adc_scan adc_scans[ADC_COUNT];
+#endif
+
 /**
  * @brief           Set averaging sample count.
  * @param[in]       count: averaging sample count
@@ -389,20 +424,14 @@ static uint16_t adc_get_sampling_cycles(uint32_t base)
 }
 
 /**
- * @brief           Reset the ADC device. Called early to initialize hardware.
+ * @brief           Configure an ADC for single 12-bit conversions and power it
+ *                  up.
  * @param[in]       base: base address of registers unique to this ADC block
  */
-static void adc_reset(uint32_t base)
+static void adc_configure(uint32_t base)
 {
     uint32_t regval;
 
-    dbg_verbose("%s(): resetting ADC...\n", __func__);
-
-    /* Enable ADC reset state */
-    adc_rccreset(base, true);
-    /* Release ADC from reset state */
-    adc_rccreset(base, false);
-
     /* Select 144 sampling cycles (to get good acquisition accuracy). */
     adc_set_sampling_cycles(base, ADC_SMPR_144);
     adc_get_sampling_cycles(base);
@@ -444,10 +473,241 @@ static void adc_reset(uint32_t base)
                 adc_getreg(base, STM32_ADC_SQR3_OFFSET));
     dbg_verbose("CCR:  0x%08x\n",
                 getreg32(STM32_ADC_CCR));
+}
+
+/**
+ * @brief           Reset the ADC device. Called early to initialize hardware.
+ * @param[in]       base: base address of registers unique to this ADC block
+ */
+static void adc_reset(uint32_t base)
+{
+    dbg_verbose("%s(): resetting ADC...\n", __func__);
+
+    /* Enable ADC reset state */
+    adc_rccreset(base, true);
+    /* Release ADC from reset state */
+    adc_rccreset(base, false);
+
+    adc_configure(base);
 
     dbg_verbose("%s(): ADC reset done.\n", __func__);
 }
 
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+/**
+ * @brief           Tell whether any ADC is scanning.
+ * @return          true if at least one ADC has channels in its sequence
+ */
+static bool adc_scan_active(void)
+{
+    int i;
+
+    for (i = 0; i < ADC_COUNT; i++) {
+        if (adc_scans[i].chanmask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief           Average one half of the DMA buffer into scan->avg[].
+ * @param[in]       scan: ADC scan
+ * @param[in]       half: half of the buffer (0 or 1)
+ */
+static void adc_scan_average(struct adc_scan *scan, int half)
+{
+    uint32_t sum[ADC_NCHANNEL] = {0};
+    const uint16_t *sample;
+    unsigned int row, i;
+
+    sample = scan->buf + half * scan->rows * scan->nchan;
+    for (row = 0; row < scan->rows; row++) {
+        for (i = 0; i < scan->nchan; i++) {
+            sum[i] += *sample++;
+        }
+    }
+
+    for (i = 0; i < scan->nchan; i++) {
+        scan->avg[i] = sum[i] / scan->rows;
+    }
+    scan->blocks++;
+}
+
+/**
+ * @brief           DMA half and full transfer callback (interrupt context).
+ */
+static void adc_dma_callback(DMA_HANDLE handle, uint8_t status, void *arg)
+{
+    struct adc_scan *scan = arg;
+
+    if (status & DMA_STATUS_ERROR) {
+        /* Without DMA the ADC overruns and stops converting */
+        scan->error = true;
+        return;
+    }
+
+    if (status & DMA_STATUS_HTIF) {
+        adc_scan_average(scan, 0);
+    }
+    if (status & DMA_STATUS_TCIF) {
+        adc_scan_average(scan, 1);
+    }
+}
+
+/**
+ * @brief           Stop the continuous scan of an ADC, if running.
+ * @param[in]       adc: ADC instance (1..ADC_COUNT)
+ */
+static void adc_scan_stop(uint8_t adc)
+{
+    struct adc_scan *scan = &adc_scans[adc - 1];
+    uint32_t base = adc_get_base(adc);
+    uint32_t regval;
+
+    if (!scan->nchan) {
+        return;
+    }
+
+    regval = adc_getreg(base, STM32_ADC_CR2_OFFSET);
+    regval &= ~(ADC_CR2_CONT | ADC_CR2_DMA | ADC_CR2_DDS);
+    adc_putreg(base, STM32_ADC_CR2_OFFSET, regval);
+    stm32_dmastop(scan->dma);
+
+    regval = adc_getreg(base, STM32_ADC_CR1_OFFSET);
+    regval &= ~ADC_CR1_SCAN;
+    adc_putreg(base, STM32_ADC_CR1_OFFSET, regval);
+    adc_putreg(base, STM32_ADC_SR_OFFSET, 0);
+
+    scan->nchan = 0;
+}
+
+/**
+ * @brief           (Re)start the continuous scan of the channels of an ADC.
+ * @return          0 on success, -ENOMEM otherwise
+ * @param[in]       adc: ADC instance (1..ADC_COUNT)
+ */
+static int adc_scan_start(uint8_t adc)
+{
+    struct adc_scan *scan = &adc_scans[adc - 1];
+    uint32_t base = adc_get_base(adc);
+    uint32_t sqr[3] = {0, 0, 0};
+    uint32_t regval;
+    uint8_t channel, n = 0;
+
+    /* Build the regular sequence: SQ1..SQ6 in SQR3, SQ7..12 in SQR2, ... */
+    for (channel = 0; channel < ADC_NCHANNEL; channel++) {
+        if (!(scan->chanmask & (1 << channel))) {
+            continue;
+        }
+        scan->slot[channel] = n;
+        sqr[2 - n / 6] |= channel << ((n % 6) * 5);
+        n++;
+    }
+    sqr[0] |= (n - 1) << ADC_SQR1_L_SHIFT;
+
+    free(scan->buf);
+    scan->rows = adc_get_averaging();
+    scan->buf = malloc(2 * scan->rows * n * sizeof(uint16_t));
+    if (!scan->buf) {
+        scan->chanmask = 0;
+        return -ENOMEM;
+    }
+
+    if (!scan->dma) {
+        scan->dma = stm32_dmachannel(adc_dmamap[adc - 1]);
+    }
+
+    scan->blocks = 0;
+    scan->error = false;
+    scan->nchan = n;
+
+    adc_putreg(base, STM32_ADC_SQR1_OFFSET, sqr[0]);
+    adc_putreg(base, STM32_ADC_SQR2_OFFSET, sqr[1]);
+    adc_putreg(base, STM32_ADC_SQR3_OFFSET, sqr[2]);
+
+    regval = adc_getreg(base, STM32_ADC_CR1_OFFSET);
+    regval |= ADC_CR1_SCAN;
+    adc_putreg(base, STM32_ADC_CR1_OFFSET, regval);
+
+    stm32_dmasetup(scan->dma, base + STM32_ADC_DR_OFFSET,
+                   (uint32_t) scan->buf, 2 * scan->rows * n, ADC_DMA_SCR);
+    stm32_dmastart(scan->dma, adc_dma_callback, scan, true);
+
+    /* EOC at the end of the sequence, DMA requests for as long as DMA=1 */
+    regval = adc_getreg(base, STM32_ADC_CR2_OFFSET);
+    regval &= ~ADC_CR2_EOCS;
+    regval |= ADC_CR2_ADON | ADC_CR2_CONT | ADC_CR2_DMA | ADC_CR2_DDS;
+    adc_putreg(base, STM32_ADC_CR2_OFFSET, regval);
+    regval |= ADC_CR2_SWSTART;
+    adc_putreg(base, STM32_ADC_CR2_OFFSET, regval);
+
+    dbg_verbose("%s(): ADC#%u scanning %u channels, %u samples per average\n",
+                __func__, adc, n, scan->rows);
+    return 0;
+}
+
+/**
+ * @brief           Remove a channel from the scan of an ADC, and release the
+ *                  DMA and power the ADC down once no channel is left.
+ * @return          0 on success, -ENOMEM otherwise
+ * @param[in]       adc: ADC instance (1..ADC_COUNT)
+ * @param[in]       channel: ADC channel (0..ADC_NCHANNEL-1)
+ */
+static int adc_scan_remove(uint8_t adc, uint8_t channel)
+{
+    struct adc_scan *scan = &adc_scans[adc - 1];
+
+    adc_scan_stop(adc);
+    scan->chanmask &= ~(1 << channel);
+    if (scan->chanmask) {
+        return adc_scan_start(adc);
+    }
+
+    free(scan->buf);
+    scan->buf = NULL;
+    if (scan->dma) {
+        stm32_dmafree(scan->dma);
+        scan->dma = NULL;
+    }
+    adc_enable(adc_get_base(adc), false);
+    return 0;
+}
+
+/**
+ * @brief           Return the latest average of a scanned channel.
+ * @return          0 on success, -EINVAL if the channel is not scanned,
+ *                  -EIO on DMA error
+ * @param[in]       adc: ADC instance (1..ADC_COUNT)
+ * @param[in]       channel: ADC channel (0..ADC_NCHANNEL-1)
+ * @param[out]      data: averaged data
+ */
+static int adc_scan_get_data(uint8_t adc, uint8_t channel, uint32_t *data)
+{
+    struct adc_scan *scan = &adc_scans[adc - 1];
+
+    if (!(scan->chanmask & (1 << channel))) {
+        dbg_error("%s(): ADC#%u channel %u not initialized!\n", __func__,
+                  adc, channel);
+        return -EINVAL;
+    }
+
+    /* Only the first read after a (re)start has to wait */
+    while (!scan->blocks && !scan->error) {
+        usleep(ADC_DMA_POLL_US);
+    }
+    if (scan->error) {
+        dbg_error("%s(): ADC#%u DMA error!\n", __func__, adc);
+        return -EIO;
+    }
+
+    *data = scan->avg[scan->slot[channel]];
+    dbg_verbose("%s(): data=%u (avg count=%u)\n", __func__, *data,
+                scan->rows);
+    return 0;
+}
+#endif
+
 /**
  * @brief           Initialize ADC instance.
  *
@@ -474,10 +734,24 @@ int adc_init(uint8_t adc, uint8_t channel, uint8_t count)
 
     /* Due to Nuttx architecture (static global variables) */
     adc_set_averaging(count);
+
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+    /* The RCC reset is common to all ADCs, do not stop the other scans */
+    if (!adc_scan_active()) {
+        adc_reset(base);
+    } else if (!adc_scans[adc - 1].chanmask) {
+        adc_configure(base);
+    }
+
+    adc_scan_stop(adc);
+    adc_scans[adc - 1].chanmask |= 1 << channel;
+    return adc_scan_start(adc);
+#else
     /* Init ADC */
     adc_reset(base);
 
     return 0;
+#endif
 }
 
 /**
@@ -489,6 +763,9 @@ int adc_init(uint8_t adc, uint8_t channel, uint8_t count)
 int adc_deinit(uint8_t adc, uint8_t channel)
 {
     uint32_t base, gpio;
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+    int ret;
+#endif
 
     CHECK_ARG_ADC_DEV(adc);
     CHECK_ARG_ADC_CHANNEL(channel);
@@ -499,6 +776,15 @@ int adc_deinit(uint8_t adc, uint8_t channel)
     gpio = adc_get_gpio_pin(adc, channel);
     /* Unconfigure GPIO ADC channel pin */
     stm32_unconfiggpio(gpio);
+
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+    ret = adc_scan_remove(adc, channel);
+    /* Other channels or ADCs may still be scanning */
+    if (ret || adc_scan_active()) {
+        return ret;
+    }
+#endif
+
     /* Shutdown ADC */
     adc_rccreset(base, 1);
 
@@ -559,6 +845,11 @@ int adc_get_data(uint8_t adc, uint8_t channel, uint32_t *data)
     CHECK_NULL_ARG(data);
 
     *data = 0;
+
+#ifdef CONFIG_ARA_SVC_ADC_DMA
+    return adc_scan_get_data(adc, channel, data);
+#endif
+
     /* Retrieve ADC registers base address */
     base = adc_get_base(adc);
     /* Retrieve averaging sample count */
@@ -90,8 +90,31 @@ out:
  * @return 0 on success, <0 on error
  */
 int vreg_get(struct vreg *vreg) {
+    unsigned int hold_time;
+    int rc;
+
+    rc = vreg_get_nowait(vreg, &hold_time);
+    if (!rc && hold_time) {
+        up_udelay(hold_time);
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Same as vreg_get(), but leave the hold time of the last control
+ *        GPIO to the caller
+ *
+ * This allows to turn on several regulators and let them settle together.
+ *
+ * @param hold_time time to wait before the regulator is usable, in us
+ * @return 0 on success, <0 on error
+ */
+int vreg_get_nowait(struct vreg *vreg, unsigned int *hold_time) {
     unsigned int i;
 
+    *hold_time = 0;
+
     if (!vreg) {
         return -ENODEV;
     }
@@ -116,7 +139,11 @@ int vreg_get(struct vreg *vreg) {
                        vreg->vregs[i].gpio, !!vreg->vregs[i].active_high,
                        vreg->vregs[i].hold_time);
             gpio_set_value(vreg->vregs[i].gpio, vreg->vregs[i].active_high);
-            up_udelay(vreg->vregs[i].hold_time);
+            if (i < vreg->nr_vregs - 1) {
+                up_udelay(vreg->vregs[i].hold_time);
+            } else {
+                *hold_time = vreg->vregs[i].hold_time;
+            }
         }
 
         /* Update state */
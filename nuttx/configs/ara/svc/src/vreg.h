@@ -64,6 +64,7 @@ struct vreg {
 
 int vreg_config(struct vreg *);
 int vreg_get(struct vreg *);
+int vreg_get_nowait(struct vreg *, unsigned int *hold_time);
 int vreg_put(struct vreg *);
 
 /*
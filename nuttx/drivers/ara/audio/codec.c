@@ -29,8 +29,12 @@
 /* Common Audio Codec code */
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <assert.h>
 #include <nuttx/lib.h>
 #include <nuttx/util.h>
 #include <nuttx/kmalloc.h>
@@ -38,7 +42,7 @@
 #include <nuttx/i2c.h>
 #include <nuttx/ara/codec.h>
 
-uint32_t codec_read(uint32_t reg, uint32_t *value)
+static uint32_t codec_hw_read(uint32_t reg, uint32_t *value)
 {
     struct device *dev = get_codec_dev();
     codec_read_func read_func = NULL;
@@ -55,7 +59,7 @@ uint32_t codec_read(uint32_t reg, uint32_t *value)
     return read_func(reg, value);
 }
 
-uint32_t codec_write(uint32_t reg, uint32_t value)
+static uint32_t codec_hw_write(uint32_t reg, uint32_t value)
 {
     struct device *dev = get_codec_dev();
     codec_write_func write_func = NULL;
@@ -72,6 +76,347 @@ uint32_t codec_write(uint32_t reg, uint32_t value)
     return write_func(reg, value);
 }
 
+#ifdef CONFIG_DRIVERS_ARA_AUDIO_CODEC_CACHE
+
+/* both supported codecs use 8-bit register addresses and 16-bit values */
+#define CODEC_CACHE_NREGS   256
+#define CODEC_CACHE_WORDS   (CODEC_CACHE_NREGS / 32)
+
+/**
+ * register cache shared by the codec drivers
+ *
+ * Registers read or written once are answered from the cache, and writes of
+ * an unchanged value are dropped.  Between codec_cache_defer() and
+ * codec_cache_sync() the writes of the deferring task are queued, in order,
+ * and sent to the codec by the driver's batch function in one transaction.
+ */
+struct codec_cache {
+    /** cache initialized by the codec driver */
+    bool enabled;
+    /** protects the whole structure */
+    sem_t lock;
+    /** cached register values */
+    uint16_t value[CODEC_CACHE_NREGS];
+    /** bitmap of registers holding a valid value */
+    uint32_t valid[CODEC_CACHE_WORDS];
+    /** bitmap of registers never cached nor coalesced */
+    uint32_t volatile_map[CODEC_CACHE_WORDS];
+    /** driver's batch write function, may be NULL */
+    codec_write_batch_func write_batch;
+    /** nesting count of codec_cache_defer() */
+    int defer;
+    /** task deferring the writes */
+    pid_t defer_pid;
+    /** number of queued writes */
+    int npending;
+    /** queued writes, in order */
+    struct codec_reg_write pending[CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH];
+};
+
+static struct codec_cache codec_cache;
+
+static bool codec_cache_test(const uint32_t *map, uint32_t reg)
+{
+    return map[reg / 32] & (1 << (reg % 32));
+}
+
+static bool codec_cache_cacheable(uint32_t reg)
+{
+    return reg < CODEC_CACHE_NREGS &&
+           !codec_cache_test(codec_cache.volatile_map, reg);
+}
+
+static void codec_cache_store(uint32_t reg, uint32_t value)
+{
+    codec_cache.value[reg] = value;
+    codec_cache.valid[reg / 32] |= 1 << (reg % 32);
+}
+
+static void codec_cache_drop(uint32_t reg)
+{
+    codec_cache.valid[reg / 32] &= ~(1 << (reg % 32));
+}
+
+static void codec_cache_lock(void)
+{
+    while (sem_wait(&codec_cache.lock) != OK) {
+        DEBUGASSERT(get_errno() == EINTR);
+    }
+}
+
+static void codec_cache_unlock(void)
+{
+    sem_post(&codec_cache.lock);
+}
+
+static bool codec_cache_deferring(void)
+{
+    return codec_cache.defer > 0 && codec_cache.defer_pid == getpid();
+}
+
+/* send the queued writes to the codec, called with the lock held */
+static int codec_cache_flush(void)
+{
+    int count = codec_cache.npending;
+    uint32_t ret = 0;
+    int i;
+
+    if (!count) {
+        return 0;
+    }
+
+    codec_cache.npending = 0;
+
+    if (codec_cache.write_batch && count > 1) {
+        ret = codec_cache.write_batch(codec_cache.pending, count);
+    } else {
+        for (i = 0; i < count && !ret; i++) {
+            ret = codec_hw_write(codec_cache.pending[i].reg,
+                                 codec_cache.pending[i].value);
+        }
+    }
+
+    if (ret) {
+        /* the hardware state is unknown, read it back next time */
+        for (i = 0; i < count; i++) {
+            if (codec_cache_cacheable(codec_cache.pending[i].reg)) {
+                codec_cache_drop(codec_cache.pending[i].reg);
+            }
+        }
+        return -EIO;
+    }
+
+    return 0;
+}
+
+/* queue one write, called with the lock held */
+static int codec_cache_queue(uint32_t reg, uint32_t value)
+{
+    struct codec_reg_write *write;
+    int ret;
+    int i;
+
+    /*
+     * A register written again is updated in place, unless a volatile
+     * write was queued in between: those (index/data pairs, resets) must
+     * keep their order relative to everything else.
+     */
+    if (codec_cache_cacheable(reg)) {
+        for (i = codec_cache.npending - 1; i >= 0; i--) {
+            write = &codec_cache.pending[i];
+            if (!codec_cache_cacheable(write->reg)) {
+                break;
+            }
+            if (write->reg == reg) {
+                write->value = value;
+                return 0;
+            }
+        }
+    }
+
+    if (codec_cache.npending == CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH) {
+        ret = codec_cache_flush();
+        if (ret) {
+            return ret;
+        }
+    }
+
+    write = &codec_cache.pending[codec_cache.npending++];
+    write->reg = reg;
+    write->value = value;
+
+    return 0;
+}
+
+/**
+ * @brief Enable the register cache
+ *
+ * Called by the codec driver once its register access functions are set.
+ *
+ * @param volatile_regs - registers that must always reach the hardware
+ * @param num_volatile - number of entries of volatile_regs
+ * @param write_batch - driver function writing several registers in one
+ *                      transaction, or NULL
+ * @return 0 on success
+ */
+int codec_cache_init(const uint8_t *volatile_regs, int num_volatile,
+                     codec_write_batch_func write_batch)
+{
+    int i;
+
+    memset(&codec_cache, 0, sizeof(codec_cache));
+    sem_init(&codec_cache.lock, 0, 1);
+
+    for (i = 0; i < num_volatile; i++) {
+        codec_cache.volatile_map[volatile_regs[i] / 32] |=
+            1 << (volatile_regs[i] % 32);
+    }
+
+    codec_cache.write_batch = write_batch;
+    codec_cache.defer_pid = -1;
+    codec_cache.enabled = true;
+
+    return 0;
+}
+
+/**
+ * @brief Disable the register cache
+ */
+void codec_cache_exit(void)
+{
+    if (!codec_cache.enabled) {
+        return;
+    }
+
+    codec_cache.enabled = false;
+    sem_destroy(&codec_cache.lock);
+}
+
+/**
+ * @brief Forget all cached values
+ *
+ * Called after the codec was reset, so registers are read back from the
+ * hardware.
+ */
+void codec_cache_invalidate(void)
+{
+    if (!codec_cache.enabled) {
+        return;
+    }
+
+    codec_cache_lock();
+    memset(codec_cache.valid, 0, sizeof(codec_cache.valid));
+    codec_cache_unlock();
+}
+
+/**
+ * @brief Start queuing the register writes of the calling task
+ *
+ * Calls nest; the queued writes are sent by the outermost
+ * codec_cache_sync().  Writes from other tasks are not deferred.
+ */
+void codec_cache_defer(void)
+{
+    if (!codec_cache.enabled) {
+        return;
+    }
+
+    codec_cache_lock();
+    if (!codec_cache.defer) {
+        codec_cache.defer_pid = getpid();
+    }
+    if (codec_cache.defer_pid == getpid()) {
+        codec_cache.defer++;
+    }
+    codec_cache_unlock();
+}
+
+/**
+ * @brief Send the register writes queued since codec_cache_defer()
+ *
+ * @return 0 on success, -EIO if the codec did not accept the writes
+ */
+int codec_cache_sync(void)
+{
+    int ret = 0;
+
+    if (!codec_cache.enabled) {
+        return 0;
+    }
+
+    codec_cache_lock();
+    if (codec_cache_deferring() && !--codec_cache.defer) {
+        ret = codec_cache_flush();
+        codec_cache.defer_pid = -1;
+    }
+    codec_cache_unlock();
+
+    return ret;
+}
+
+uint32_t codec_read(uint32_t reg, uint32_t *value)
+{
+    uint32_t ret;
+
+    if (!codec_cache.enabled) {
+        return codec_hw_read(reg, value);
+    }
+
+    if (!value) {
+        return -EINVAL;
+    }
+
+    codec_cache_lock();
+    if (codec_cache_cacheable(reg) &&
+        codec_cache_test(codec_cache.valid, reg)) {
+        *value = codec_cache.value[reg];
+        ret = 0;
+    } else {
+        /* the register may depend on the queued writes */
+        ret = codec_cache_flush();
+        if (!ret) {
+            ret = codec_hw_read(reg, value);
+        }
+        if (!ret && codec_cache_cacheable(reg)) {
+            codec_cache_store(reg, *value);
+        }
+    }
+    codec_cache_unlock();
+
+    return ret;
+}
+
+uint32_t codec_write(uint32_t reg, uint32_t value)
+{
+    uint32_t ret;
+
+    if (!codec_cache.enabled) {
+        return codec_hw_write(reg, value);
+    }
+
+    codec_cache_lock();
+    if (codec_cache_cacheable(reg) &&
+        codec_cache_test(codec_cache.valid, reg) &&
+        codec_cache.value[reg] == (uint16_t)value) {
+        codec_cache_unlock();
+        return 0;
+    }
+
+    if (codec_cache_deferring()) {
+        ret = codec_cache_queue(reg, value);
+    } else {
+        ret = codec_cache_flush();
+        if (!ret) {
+            ret = codec_hw_write(reg, value);
+        }
+    }
+
+    if (codec_cache_cacheable(reg)) {
+        if (ret) {
+            codec_cache_drop(reg);
+        } else {
+            codec_cache_store(reg, value);
+        }
+    }
+    codec_cache_unlock();
+
+    return ret;
+}
+
+#else
+
+uint32_t codec_read(uint32_t reg, uint32_t *value)
+{
+    return codec_hw_read(reg, value);
+}
+
+uint32_t codec_write(uint32_t reg, uint32_t value)
+{
+    return codec_hw_write(reg, value);
+}
+
+#endif /* CONFIG_DRIVERS_ARA_AUDIO_CODEC_CACHE */
+
 uint32_t codec_update(uint32_t reg, uint32_t value, uint32_t mask)
 {
     uint32_t data = 0;
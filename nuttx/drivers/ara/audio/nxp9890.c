@@ -217,6 +217,13 @@ struct nxp9890_reg nxp9890_init_regs[] = {
     { NXP9890_DUMMY_POWER_REG, 0x00 }
 };
 
+/**
+ * registers never served from the register cache
+ */
+static const uint8_t nxp9890_volatile_regs[] = {
+    NXP9890_DUMMY_VENDOR_ID_REG,
+};
+
 /**
  * DAI device table
  */
@@ -462,6 +469,59 @@ static uint32_t nxp9890_codec_hw_write(uint32_t reg, uint32_t value)
     return 0;
 }
 
+#ifdef CONFIG_DRIVERS_ARA_AUDIO_CODEC_CACHE
+/**
+ * @brief write several codec registers in one i2c transaction
+ *
+ * Each register is written by its own [DA] + [DATA_HIGH] + [DATA_LOW]
+ * message, separated by repeated starts.
+ *
+ * @param writes - registers and values, in write order
+ * @param count - number of writes
+ * @return 0 on success, negative errno on error
+ */
+static uint32_t nxp9890_codec_hw_write_batch(const struct codec_reg_write *writes,
+                                             int count)
+{
+    struct device *dev = get_codec_dev();
+    struct nxp9890_info *info = NULL;
+    uint8_t cmd[CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH][3];
+    struct device_i2c_request msg[CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH];
+    int i;
+
+    if (!dev || !device_get_private(dev) || !writes ||
+        count <= 0 || count > CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+    if (!info->i2c) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        cmd[i][0] = (uint8_t)writes[i].reg;
+        cmd[i][1] = (uint8_t)((writes[i].value >> 8) & 0xFF);
+        cmd[i][2] = (uint8_t)(writes[i].value & 0xFF);
+
+        msg[i].addr = NXP9890_I2C_ADDR;
+        msg[i].flags = 0;
+        msg[i].buffer = cmd[i];
+        msg[i].length = 3;
+    }
+
+    if (device_i2c_transfer(info->i2c, msg, count)) {
+        return -EIO;
+    }
+
+    dbg_verbose("I2C-W %d registers from %02X\n", count, writes[0].reg);
+
+    return 0;
+}
+#else
+#define nxp9890_codec_hw_write_batch NULL
+#endif
+
 static int get_data_cport(unsigned int bundle_index, unsigned int dai_index,
                           uint16_t *data_cport)
 {
@@ -1458,9 +1518,13 @@ static int nxp9890_codec_open(struct device *dev)
     /* TODO add code initialize the codec hardware */
 
     /* Write out initial general codec register settings */
+    codec_cache_defer();
     for (i = 0; i < info->num_regs; i++) {
         codec_write(info->init_regs[i].reg , info->init_regs[i].val);
     }
+    if (codec_cache_sync()) {
+        return -EIO;
+    }
 
     return ret;
 }
@@ -1510,10 +1574,12 @@ static void nxp9890_codec_close(struct device *dev)
     /* disable all widget */
     widget = info->widgets;
 
+    codec_cache_defer();
     for (i = 0; i < info->num_widgets; i++) {
         nxp9890_disable_widget(dev,widget->widget.id);
         widget++;
     }
+    codec_cache_sync();
 
     /* TODO add code put the codec hardware in a power down state*/
 
@@ -1587,6 +1653,9 @@ static int nxp9890_codec_probe(struct device *dev)
     device_set_private(dev, info);
     codec_dev = dev;
 
+    codec_cache_init(nxp9890_volatile_regs, ARRAY_SIZE(nxp9890_volatile_regs),
+                     nxp9890_codec_hw_write_batch);
+
     /* create control object linklist to link all controls */
     controls = info->controls;
     widgets = info->widgets;
@@ -1657,6 +1726,8 @@ static void nxp9890_codec_remove(struct device *dev)
         info->i2c = NULL;
     }
 
+    codec_cache_exit();
+
     info->codec_read = NULL;
     info->codec_write = NULL;
     info->state = 0;
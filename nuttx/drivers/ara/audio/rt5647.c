@@ -668,6 +668,32 @@ struct rt5647_reg rt5647_init_regs[] = {
 #endif
 };
 
+/**
+ * registers changed by the codec itself or accessed as index/data pairs,
+ * never served from the register cache
+ */
+static const uint8_t rt5647_volatile_regs[] = {
+    RT5647_RESET,
+    RT5647_IN1_CTRL1,
+    RT5647_IN1_CTRL2,
+    RT5647_IN1_CTRL3,
+    RT5647_PR_INDEX,
+    RT5647_PR_DATA,
+    RT5647_ADC_EQ1,
+    RT5647_DAC_EQ1,
+    RT5647_JACK_DET_CTRL_1,
+    RT5647_JACK_DET_CTRL_2,
+    RT5647_JACK_DET_CTRL_3,
+    RT5647_JACK_DET_CTRL_4,
+    RT5647_IRQ_CTRL_1,
+    RT5647_IRQ_CTRL_2,
+    RT5647_IRQ_CTRL_3,
+    RT5647_INLINE_CMD_CTRL1,
+    RT5647_INLINE_CMD_CTRL2,
+    RT5647_INLINE_CMD_CTRL3,
+    RT5647_VENDOR_ID,
+};
+
 /**
  * DAI device table
  */
@@ -1287,6 +1313,63 @@ static uint32_t rt5647_codec_hw_write(uint32_t reg, uint32_t value)
     return 0;
 }
 
+#ifdef CONFIG_DRIVERS_ARA_AUDIO_CODEC_CACHE
+/**
+ * @brief write several codec registers in one i2c transaction
+ *
+ * rt5647 has no register auto-increment, so each register is written by its
+ * own [DA] + [DATA_HIGH] + [DATA_LOW] message, separated by repeated starts.
+ *
+ * @param writes - registers and values, in write order
+ * @param count - number of writes
+ * @return 0 on success, negative errno on error
+ */
+static uint32_t rt5647_codec_hw_write_batch(const struct codec_reg_write *writes,
+                                            int count)
+{
+    struct device *dev = get_codec_dev();
+    struct rt5647_info *info = NULL;
+    uint8_t cmd[CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH][3];
+    struct device_i2c_request msg[CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH];
+    int ret, i;
+
+    if (!dev || !device_get_private(dev) || !writes ||
+        count <= 0 || count > CONFIG_DRIVERS_ARA_AUDIO_CODEC_BATCH) {
+        return -EINVAL;
+    }
+
+    info = device_get_private(dev);
+    if (!info->i2c) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        cmd[i][0] = (uint8_t)writes[i].reg;
+        cmd[i][1] = (uint8_t)((writes[i].value >> 8) & 0xFF);
+        cmd[i][2] = (uint8_t)(writes[i].value & 0xFF);
+
+        msg[i].addr = info->i2c_addr;
+        msg[i].flags = 0;
+        msg[i].buffer = cmd[i];
+        msg[i].length = 3;
+    }
+
+    if ((ret = codec_pm_activity(dev))) {
+        return ret;
+    }
+
+    if (device_i2c_transfer(info->i2c, msg, count)) {
+        return -EIO;
+    }
+
+    dbg_verbose("I2C-W %d registers from %02X\n", count, writes[0].reg);
+
+    return 0;
+}
+#else
+#define rt5647_codec_hw_write_batch NULL
+#endif
+
 /**
  * @brief read data from codec private register
  *
@@ -1912,6 +1995,7 @@ static int rt5647_set_config(struct device *dev, unsigned int dai_idx,
     }
 
     /* write clock setting */
+    codec_cache_defer();
     value = RT5647_SYSCLK_S_PLL | RT5647_PLL_S_MCLK; /* MCLK->PLL->SYSCLK */
     mask = RT5647_SYSCLK_S_MASK | RT5647_PLL_S_MASK;
     codec_update(RT5647_GLOBAL_CLOCK, value, mask);
@@ -1935,6 +2019,10 @@ static int rt5647_set_config(struct device *dev, unsigned int dai_idx,
         codec_write(RT5647_I2S1_CTRL, format);
     }
 
+    if (codec_cache_sync()) {
+        return -EIO;
+    }
+
     /* save config to dai[dai_idx] structure */
     info->dais[dai_idx].clk_role = clk_role;
     memcpy(&info->dais[dai_idx].pcm_config, pcm,
@@ -2481,6 +2569,7 @@ static int rt5647_codec_open(struct device *dev)
 
     /* codec power on sequence */
     codec_write(RT5647_RESET, 0);    /* software reset */
+    codec_cache_invalidate();
 
     codec_update(RT5647_PWR_MGT_3,
                     BIT(RT5647_PWR3_VREF1_EN) | BIT(RT5647_PWR3_MBIAS_EN) |
@@ -2493,11 +2582,15 @@ static int rt5647_codec_open(struct device *dev)
                     BIT(RT5647_PWR3_FASTB1_EN) | BIT(RT5647_PWR3_FASTB2_EN));
 
     /* initialize audio codec */
+    codec_cache_defer();
     for (i = 0; i < info->num_regs; i++) {
         codec_write(info->init_regs[i].reg , info->init_regs[i].val);
     }
 
     codec_update(RT5647_PWR_MGT_3, 0x02, RT5647_PWR3_LDO1_MASK);
+    if (codec_cache_sync()) {
+        return -EIO;
+    }
 
     return ret;
 }
@@ -2547,12 +2640,15 @@ static void rt5647_codec_close(struct device *dev)
     /* disable all widget */
     widget = info->widgets;
 
+    codec_cache_defer();
     for (i = 0; i < info->num_widgets; i++) {
         rt5647_disable_widget(dev,widget->widget.id);
         widget++;
     }
+    codec_cache_sync();
 
     codec_write(RT5647_RESET, 0);    /* software reset */
+    codec_cache_invalidate();
 
     /* clear open state */
     info->state &= ~(CODEC_DEVICE_FLAG_OPEN | CODEC_DEVICE_FLAG_CONFIG);
@@ -2635,6 +2731,9 @@ static int rt5647_codec_probe(struct device *dev)
     device_set_private(dev, info);
     codec_dev = dev;
 
+    codec_cache_init(rt5647_volatile_regs, ARRAY_SIZE(rt5647_volatile_regs),
+                     rt5647_codec_hw_write_batch);
+
     /* create control object linklist to link all controls */
     controls = info->controls;
     widgets = info->widgets;
@@ -2708,6 +2807,8 @@ static void rt5647_codec_remove(struct device *dev)
         info->i2c = NULL;
     }
 
+    codec_cache_exit();
+
     info->codec_read = NULL;
     info->codec_write = NULL;
     info->state = 0;
@@ -70,6 +70,7 @@ struct bchlib_s
   bool  dirty;         /* Data has been written to the buffer */
   bool  readonly;      /* true:  Only read operations are supported */
   FAR uint8_t *buffer; /* One sector buffer */
+  FAR uint8_t *xipbase; /* Memory of the device if mapped, or NULL */
 
 #if defined(CONFIG_BCH_ENCRYPTION)
   uint8_t   key[CONFIG_BCH_ENCRYPTION_KEY_SIZE];   /* Encryption key */
@@ -252,6 +252,16 @@ static int bch_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
       bchlib_semgive(bch);
     }
+  else if (cmd == FIOC_MMAP && bch->xipbase)
+    {
+      FAR uint8_t **ppv = (FAR uint8_t **)((uintptr_t)arg);
+
+      if (ppv)
+        {
+          *ppv = bch->xipbase;
+          ret = OK;
+        }
+    }
 #if defined(CONFIG_BCH_ENCRYPTION)
   else if (cmd == DIOC_SETKEY)
     {
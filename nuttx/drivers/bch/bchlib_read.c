@@ -108,6 +108,19 @@ ssize_t bchlib_read(FAR void *handle, FAR char *buffer, size_t offset, size_t le
       return 0;
     }
 
+  /* A memory mapped device is read directly */
+
+  if (bch->xipbase)
+    {
+      if (offset + len > bch->nsectors * bch->sectsize)
+        {
+          len = bch->nsectors * bch->sectsize - offset;
+        }
+
+      memcpy(buffer, &bch->xipbase[offset], len);
+      return len;
+    }
+
   /* Read the initial partial sector */
 
   bytesread = 0;
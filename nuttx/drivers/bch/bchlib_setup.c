@@ -51,6 +51,7 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
 
 #include "bch_internal.h"
 
@@ -140,6 +141,20 @@ int bchlib_setup(const char *blkdev, bool readonly, FAR void **handle)
   bch->sector   = (size_t)-1;
   bch->readonly = readonly;
 
+#ifndef CONFIG_BCH_ENCRYPTION
+  /* If the device is memory mapped (a RAM disk, for example), accesses are
+   * copied directly from/to its memory instead of going through the sector
+   * buffer and the block driver.
+   */
+
+  if (bch->inode->u.i_bops->ioctl &&
+      bch->inode->u.i_bops->ioctl(bch->inode, BIOC_XIPBASE,
+                                  (unsigned long)((uintptr_t)&bch->xipbase)) < 0)
+    {
+      bch->xipbase = NULL;
+    }
+#endif
+
   /* Allocate the sector I/O buffer */
 
   bch->buffer = (FAR uint8_t *)kmm_malloc(bch->sectsize);
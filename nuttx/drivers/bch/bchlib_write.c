@@ -107,6 +107,19 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, size_t offset, si
       return -EFBIG;
     }
 
+  /* A memory mapped device is written directly */
+
+  if (bch->xipbase)
+    {
+      if (offset + len > bch->nsectors * bch->sectsize)
+        {
+          len = bch->nsectors * bch->sectsize - offset;
+        }
+
+      memcpy(&bch->xipbase[offset], buffer, len);
+      return len;
+    }
+
   /* Write the initial partial sector */
 
   byteswritten = 0;
@@ -31,12 +31,52 @@
 
 #include <errno.h>
 #include <string.h>
+#ifdef CONFIG_DEVICE_PARALLEL_PROBE
+#include <pthread.h>
+#endif
 
 #include <arch/irq.h>
 
+#include <nuttx/boot_timing.h>
 #include <nuttx/device.h>
 #include <nuttx/device_table.h>
 
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+static struct device_driver *deferred_drivers[CONFIG_DEVICE_DEFERRED_MAX];
+
+/**
+ * @brief Take a deferred driver out of the deferred list
+ * @param type Type of the driver, or NULL for any
+ * @param name Name of the driver, or NULL for any
+ * @return The driver, or NULL if there is no such deferred driver
+ */
+static struct device_driver *device_take_deferred(const char *type,
+                                                  const char *name)
+{
+    struct device_driver *driver = NULL;
+    irqstate_t flags;
+    int i;
+
+    flags = irqsave();
+
+    for (i = 0; i < CONFIG_DEVICE_DEFERRED_MAX; i++) {
+        if (!deferred_drivers[i])
+            continue;
+
+        if ((!type || !strcmp(deferred_drivers[i]->type, type)) &&
+            (!name || !strcmp(deferred_drivers[i]->name, name))) {
+            driver = deferred_drivers[i];
+            deferred_drivers[i] = NULL;
+            break;
+        }
+    }
+
+    irqrestore(flags);
+
+    return driver;
+}
+#endif
+
 /**
  * @brief Open specified device
  * @param type Type device belongs to (e.g., GPIO, I2C, I2S, UART)
@@ -46,7 +86,6 @@
 struct device *device_open(char *type, unsigned int id)
 {
     struct device *dev;
-    struct device_table_iter iter = DEVICE_TABLE_ITER_INITIALIZER;
     irqstate_t flags;
     int ret;
 
@@ -55,27 +94,38 @@ struct device *device_open(char *type, unsigned int id)
 
     flags = irqsave();
 
-    device_table_for_each_dev(dev, &iter) {
-        if (!strcmp(dev->type, type) && (dev->id == id)) {
-            if (dev->state != DEVICE_STATE_PROBED)
-                goto err_irqrestore;
+    dev = device_table_lookup(type, id);
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+    if (dev && dev->state == DEVICE_STATE_REMOVED) {
+        struct device_driver *driver;
+
+        /* First open of a device whose driver was deferred: probe it now */
+        driver = device_take_deferred(dev->type, dev->name);
+        if (driver) {
+            irqrestore(flags);
+            device_register_driver(driver);
+            flags = irqsave();
+        }
+    }
+#endif
+    if (dev) {
+        if (dev->state != DEVICE_STATE_PROBED)
+            goto err_irqrestore;
 
-            dev->state = DEVICE_STATE_OPENING;
+        dev->state = DEVICE_STATE_OPENING;
 
-            if (dev->driver->ops->open) {
-                irqrestore(flags);
-                ret = dev->driver->ops->open(dev);
-                flags = irqsave();
+        if (dev->driver->ops->open) {
+            irqrestore(flags);
+            ret = dev->driver->ops->open(dev);
+            flags = irqsave();
 
-                if (ret) {
-                    dev->state = DEVICE_STATE_PROBED;
-                    goto err_irqrestore;
-                }
+            if (ret) {
+                dev->state = DEVICE_STATE_PROBED;
+                goto err_irqrestore;
             }
-
-            dev->state = DEVICE_STATE_OPEN;
-            break;
         }
+
+        dev->state = DEVICE_STATE_OPEN;
     }
 
     irqrestore(flags);
@@ -160,6 +210,7 @@ int device_register_driver(struct device_driver *driver)
             }
 
             dev->state = DEVICE_STATE_PROBED;
+            boot_timing_mark(driver->name);
         }
     }
 
@@ -168,6 +219,162 @@ int device_register_driver(struct device_driver *driver)
     return 0;
 }
 
+#ifdef CONFIG_DEVICE_PARALLEL_PROBE
+static void *device_probe_thread(void *arg)
+{
+    device_register_driver(arg);
+    return NULL;
+}
+
+/**
+ * @brief Register the drivers of a wave, each on its own thread
+ * @param entries Set of drivers
+ * @param wave Mask of the entries to register
+ */
+static void device_register_wave(const struct device_probe_entry *entries,
+                                 uint32_t wave)
+{
+    pthread_t threads[32];
+    uint32_t started = 0;
+    pthread_attr_t attr;
+    int last;
+    int i;
+
+    /* The last driver of the wave is probed by the caller */
+    last = 31 - __builtin_clz(wave);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, CONFIG_DEVICE_PROBE_STACKSIZE);
+
+    for (i = 0; i < last; i++) {
+        if (!(wave & (1 << i)))
+            continue;
+
+        if (!pthread_create(&threads[i], &attr, device_probe_thread,
+                            entries[i].driver))
+            started |= 1 << i;
+        else
+            device_register_driver(entries[i].driver);
+    }
+
+    device_register_driver(entries[last].driver);
+
+    for (i = 0; i < last; i++) {
+        if (started & (1 << i))
+            pthread_join(threads[i], NULL);
+    }
+
+    pthread_attr_destroy(&attr);
+}
+#endif
+
+/**
+ * @brief Register a set of drivers in dependency order
+ * @param entries Address of the set of drivers
+ * @param count Number of drivers in the set
+ * @return 0: Drivers registered
+ *         -errno: Negative errno value indicating reason for failure
+ */
+int device_register_drivers(const struct device_probe_entry *entries,
+                            int count)
+{
+    uint32_t all, done = 0;
+    uint32_t wave;
+    int i, j;
+
+    if (!entries || count < 0 || count > 32)
+        return -EINVAL;
+
+    all = count < 32 ? (1 << count) - 1 : 0xffffffff;
+
+    /*
+     * Each wave is made of the drivers whose predecessor, if it belongs to
+     * the set, has been registered by an earlier wave.
+     */
+    while (done != all) {
+        wave = 0;
+
+        for (i = 0; i < count; i++) {
+            if (done & (1 << i))
+                continue;
+
+            for (j = 0; j < count; j++) {
+                if (entries[j].driver == entries[i].after)
+                    break;
+            }
+
+            if (j == count || (done & (1 << j)))
+                wave |= 1 << i;
+        }
+
+        if (!wave)
+            return -EINVAL;
+
+#ifdef CONFIG_DEVICE_PARALLEL_PROBE
+        device_register_wave(entries, wave);
+#else
+        for (i = 0; i < count; i++) {
+            if (wave & (1 << i))
+                device_register_driver(entries[i].driver);
+        }
+#endif
+
+        done |= wave;
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+/**
+ * @brief Register specified driver without probing its devices
+ * @param driver Address of structure containing driver information
+ * @return 0: Driver deferred
+ *         -errno: Negative errno value indicating reason for failure
+ */
+int device_defer_driver(struct device_driver *driver)
+{
+    irqstate_t flags;
+    int i;
+
+    if (!driver || !driver->type || !driver->name || !driver->ops)
+        return -EINVAL;
+
+    flags = irqsave();
+
+    for (i = 0; i < CONFIG_DEVICE_DEFERRED_MAX; i++) {
+        if (!deferred_drivers[i]) {
+            deferred_drivers[i] = driver;
+            break;
+        }
+    }
+
+    irqrestore(flags);
+
+    return i < CONFIG_DEVICE_DEFERRED_MAX ? 0 : -ENOMEM;
+}
+
+/**
+ * @brief Probe the devices of the drivers still deferred
+ * @return Number of drivers registered
+ */
+int device_probe_deferred(void)
+{
+    struct device_driver *driver;
+    int count = 0;
+
+    while ((driver = device_take_deferred(NULL, NULL))) {
+        device_register_driver(driver);
+        count++;
+    }
+
+    if (count)
+        boot_timing_mark("deferred");
+
+    return count;
+}
+#endif
+
 /**
  * @brief Unregister specified driver
  * @param driver Address of structure used to register the driver
@@ -183,6 +390,17 @@ void device_unregister_driver(struct device_driver *driver)
 
     flags = irqsave();
 
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+    {
+        int i;
+
+        for (i = 0; i < CONFIG_DEVICE_DEFERRED_MAX; i++) {
+            if (deferred_drivers[i] == driver)
+                deferred_drivers[i] = NULL;
+        }
+    }
+#endif
+
     device_table_for_each_dev(dev, &iter) {
         if (dev->driver == driver) {
             if (dev->state != DEVICE_STATE_PROBED)
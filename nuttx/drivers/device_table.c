@@ -30,13 +30,55 @@
  */
 
 #include <errno.h>
+#include <string.h>
 
+#include <nuttx/arch.h>
 #include <nuttx/list.h>
 #include <nuttx/device.h>
 #include <nuttx/device_table.h>
 #include <nuttx/kmalloc.h>
 
+#ifndef CONFIG_DEVICE_TABLE_HASH_SIZE
+#define CONFIG_DEVICE_TABLE_HASH_SIZE 32
+#endif
+
+/* Entry of the (type, id) index, allocated at device table registration */
+struct device_table_entry {
+    struct device *dev;
+    struct device_table_entry *next;
+};
+
 static LIST_DECLARE(device_table_list);
+static struct device_table_entry *device_table_index[CONFIG_DEVICE_TABLE_HASH_SIZE];
+
+static unsigned int device_table_hash(const char *type, unsigned int id)
+{
+    unsigned int hash = id;
+
+    while (*type) {
+        hash = hash * 31 + (unsigned char) *type++;
+    }
+
+    return hash % CONFIG_DEVICE_TABLE_HASH_SIZE;
+}
+
+struct device *device_table_lookup(const char *type, unsigned int id)
+{
+    struct device_table_entry *entry;
+
+    if (!type) {
+        return NULL;
+    }
+
+    entry = device_table_index[device_table_hash(type, id)];
+    for (; entry; entry = entry->next) {
+        if (entry->dev->id == id && !strcmp(entry->dev->type, type)) {
+            return entry->dev;
+        }
+    }
+
+    return NULL;
+}
 
 struct device *device_table_iter_next(struct device_table_iter *iter)
 {
@@ -82,12 +124,42 @@ struct device *device_table_iter_next(struct device_table_iter *iter)
  */
 int device_table_register(struct device_table *table)
 {
+    struct device_table_entry *entries;
+    struct device_table_entry **slot;
+    irqstate_t flags;
+    unsigned int i;
+
     if (!table || !table->device || !table->device_count) {
         return -EINVAL;
     }
 
+    entries = kmm_malloc(table->device_count * sizeof(*entries));
+    if (!entries) {
+        return -ENOMEM;
+    }
+
+    flags = irqsave();
+
     list_init(&table->list);
     list_add(&device_table_list, &table->list);
 
+    /*
+     * Append to the hash chains so that, as with the iterator, the device
+     * registered first wins if several share the same type and id.
+     */
+    for (i = 0; i < table->device_count; i++) {
+        entries[i].dev = &table->device[i];
+        entries[i].next = NULL;
+
+        slot = &device_table_index[device_table_hash(table->device[i].type,
+                                                     table->device[i].id)];
+        while (*slot) {
+            slot = &(*slot)->next;
+        }
+        *slot = &entries[i];
+    }
+
+    irqrestore(flags);
+
     return 0;
 }
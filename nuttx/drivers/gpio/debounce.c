@@ -26,31 +26,158 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
 #include <nuttx/clock.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/gpio/debounce.h>
 
-/* work queue handler for debounce timeout */
-static void debounce_delayed_worker(void *data)
+/*
+ * All the pins waiting for their debounce time to elapse are checked by a
+ * single scan work, run every CONFIG_GPIO_DEBOUNCE_PERIOD_MS at most and
+ * only while some pin is waiting.  The deadlines are rounded up to the
+ * period so that pins bouncing at about the same time are handled in the
+ * same pass.
+ */
+#ifndef CONFIG_GPIO_DEBOUNCE_PERIOD_MS
+#define CONFIG_GPIO_DEBOUNCE_PERIOD_MS  5
+#endif
+
+#define DEBOUNCE_PERIOD_TICKS   MSEC2TICK(CONFIG_GPIO_DEBOUNCE_PERIOD_MS)
+
+static struct debounce_data *g_db_pending;  /* Pins waiting for the scan */
+static struct work_s g_db_work;             /* Shared scan work */
+static uint32_t g_db_scan;                  /* Tick of the queued scan */
+
+static void debounce_scan_worker(void *data);
+
+/* ticks left before the debounce time of db elapses, 0 if elapsed */
+static uint32_t debounce_remaining(struct debounce_data *db, uint32_t now)
 {
-    struct debounce_data *db = data;
+    uint32_t elapsed = now - db->start;
+    uint32_t timeout = MSEC2TICK(db->ms);
 
-    db->isr(db->gpio, db->context, db->priv);
+    return elapsed >= timeout ? 0 : timeout - elapsed;
 }
 
-/* queue debounce timeout handler if not already scheduled */
-static int debounce_delay_check(struct debounce_data *db)
+/* queue the scan for the earliest deadline. Interrupts must be disabled. */
+static void debounce_arm(uint32_t now)
 {
-    /*
-     * If the work is already scheduled, do not schedule another one now.
-     * A new one will be scheduled if more debounce is needed.
-     */
-    if (!work_available(&db->work)) {
-        return 0;
+    struct debounce_data *db;
+    uint32_t delay = UINT32_MAX;
+    uint32_t remaining;
+
+    for (db = g_db_pending; db; db = db->next) {
+        remaining = debounce_remaining(db, now);
+        if (remaining < delay) {
+            delay = remaining;
+        }
+    }
+
+    if (delay == UINT32_MAX) {
+        return;
+    }
+
+    /* Round up to the scan period, to batch the pins */
+    if (DEBOUNCE_PERIOD_TICKS > 1) {
+        delay = (delay + DEBOUNCE_PERIOD_TICKS - 1) / DEBOUNCE_PERIOD_TICKS *
+                DEBOUNCE_PERIOD_TICKS;
+    }
+
+    if (!work_available(&g_db_work)) {
+        /* Keep the queued scan unless this deadline comes first */
+        if ((int32_t)(g_db_scan - (now + delay)) <= 0) {
+            return;
+        }
+        work_cancel(HPWORK, &g_db_work);
+    }
+
+    g_db_scan = now + delay;
+    work_queue(HPWORK, &g_db_work, debounce_scan_worker, NULL, delay);
+}
+
+/* make the scan check db. Interrupts must be disabled. */
+static void debounce_wait(struct debounce_data *db)
+{
+    if (!db->pending) {
+        db->pending = true;
+        db->next = g_db_pending;
+        g_db_pending = db;
+    }
+
+    debounce_arm(clock_systimer());
+}
+
+/* (re)start the debounce time of db. Interrupts must be disabled. */
+static void debounce_start(struct debounce_data *db)
+{
+    db->start = clock_systimer();
+    debounce_wait(db);
+}
+
+/* db got stable, it no longer needs the scan. Interrupts must be disabled. */
+static void debounce_stop(struct debounce_data *db)
+{
+    struct debounce_data **pp;
+
+    if (!db->pending) {
+        return;
+    }
+
+    for (pp = &g_db_pending; *pp; pp = &(*pp)->next) {
+        if (*pp == db) {
+            *pp = db->next;
+            break;
+        }
     }
 
-    /* Schedule the work to run after the debounce timeout */
-    return work_queue(HPWORK, &db->work, debounce_delayed_worker, db,
-                      MSEC2TICK(db->ms));
+    db->pending = false;
+    db->next = NULL;
+}
+
+/*
+ * Scan all the waiting pins and call the interrupt handler of those whose
+ * debounce time elapsed, so that it reads the pin and calls debounce_gpio()
+ * again.
+ */
+static void debounce_scan_worker(void *data)
+{
+    struct debounce_data *db, *due = NULL, **pp;
+    irqstate_t flags;
+    uint32_t now;
+
+    flags = irqsave();
+
+    now = clock_systimer();
+    pp = &g_db_pending;
+    while ((db = *pp)) {
+        if (debounce_remaining(db, now) == 0) {
+            *pp = db->next;
+            db->pending = false;
+            db->next = due;
+            due = db;
+        } else {
+            pp = &db->next;
+        }
+    }
+
+    irqrestore(flags);
+
+    while (due) {
+        db = due;
+        due = db->next;
+        db->next = NULL;
+        db->isr(db->gpio, db->context, db->priv);
+    }
+
+    flags = irqsave();
+    debounce_arm(clock_systimer());
+    irqrestore(flags);
+}
+
+static bool debounce_elapsed(struct debounce_data *db)
+{
+    return debounce_remaining(db, clock_systimer()) == 0;
 }
 
 /*
@@ -58,8 +185,10 @@ static int debounce_delay_check(struct debounce_data *db)
  */
 bool debounce_gpio(struct debounce_data *db, bool active)
 {
-    struct timeval now, diff, timeout_tv = { 0, db->ms * 1000 };
     bool stable = false;
+    irqstate_t flags;
+
+    flags = irqsave();
 
     /*
      * Short pulses are filtered out.
@@ -67,69 +196,63 @@ bool debounce_gpio(struct debounce_data *db, bool active)
     switch (db->db_state) {
     case DB_ST_INVALID:
     default:
-        gettimeofday(&db->debounce_tv, NULL);
         db->db_state = active ?
                        DB_ST_ACTIVE_DEBOUNCE : DB_ST_INACTIVE_DEBOUNCE;
-        debounce_delay_check(db);
+        debounce_start(db);
         break;
     case DB_ST_ACTIVE_DEBOUNCE:
         if (active) {
             /* Signal did not change ... for how long ? */
-            gettimeofday(&now, NULL);
-            timersub(&now, &db->debounce_tv, &diff);
-            if (timercmp(&diff, &timeout_tv, >=)) {
+            if (debounce_elapsed(db)) {
                 /* We have a stable signal */
                 db->db_state = DB_ST_ACTIVE_STABLE;
+                debounce_stop(db);
                 stable = true;
-            } else {
+            } else if (!db->pending) {
                 /* Check for a stable signal after the debounce timeout */
-                debounce_delay_check(db);
+                debounce_wait(db);
             }
         } else {
             /* Signal did change, reset the debounce timer */
-            gettimeofday(&db->debounce_tv, NULL);
             db->db_state = DB_ST_INACTIVE_DEBOUNCE;
-            debounce_delay_check(db);
+            debounce_start(db);
         }
         break;
     case DB_ST_INACTIVE_DEBOUNCE:
         if (!active) {
             /* Signal did not change ... for how long ? */
-            gettimeofday(&now, NULL);
-            timersub(&now, &db->debounce_tv, &diff);
-            if (timercmp(&diff, &timeout_tv, >=)) {
+            if (debounce_elapsed(db)) {
                 /* We have a stable signal */
                 db->db_state = DB_ST_INACTIVE_STABLE;
+                debounce_stop(db);
                 stable = true;
-            } else {
+            } else if (!db->pending) {
                 /* Check for a stable signal after the debounce timeout */
-                debounce_delay_check(db);
+                debounce_wait(db);
             }
         } else {
             /* Signal did change, reset the debounce timer */
-            gettimeofday(&db->debounce_tv, NULL);
             db->db_state = DB_ST_ACTIVE_DEBOUNCE;
-            debounce_delay_check(db);
+            debounce_start(db);
         }
         break;
     case DB_ST_ACTIVE_STABLE:
         if (!active) {
             /* Signal did change, reset the debounce timer */
-            gettimeofday(&db->debounce_tv, NULL);
             db->db_state = DB_ST_INACTIVE_DEBOUNCE;
-            debounce_delay_check(db);
+            debounce_start(db);
         }
         break;
     case DB_ST_INACTIVE_STABLE:
         if (active) {
             /* Signal did change, reset the debounce timer */
-            gettimeofday(&db->debounce_tv, NULL);
             db->db_state = DB_ST_ACTIVE_DEBOUNCE;
-            debounce_delay_check(db);
+            debounce_start(db);
         }
         break;
     }
 
+    irqrestore(flags);
+
     return stable;
 }
-
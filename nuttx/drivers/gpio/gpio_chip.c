@@ -49,6 +49,9 @@ struct gpio_chip_s
 uint8_t g_gpio_line_count = 0;
 LIST_DECLARE(g_gpio_chip);
 
+/* Last chip found by get_gpio_chip(): consecutive accesses often hit it */
+static struct gpio_chip_s *g_gpio_last_chip;
+
 /**
  * @brief Register a driver to the gpio_chip framework
  *
@@ -95,6 +98,8 @@ int unregister_gpio_chip(void *driver_data)
         chip = list_entry(iter, struct gpio_chip_s, list);
         if (chip->driver_data == driver_data) {
             g_gpio_line_count -= chip->ops->line_count(driver_data);
+            if (g_gpio_last_chip == chip)
+                g_gpio_last_chip = NULL;
             list_del(iter);
             free(chip);
         }
@@ -108,16 +113,61 @@ static struct gpio_chip_s *get_gpio_chip(uint8_t *which)
     struct list_head *iter;
     struct gpio_chip_s *chip;
 
+    chip = g_gpio_last_chip;
+    if (chip && chip->base <= *which && *which < chip->end) {
+        *which -= chip->base;
+        return chip;
+    }
+
     list_foreach(&g_gpio_chip, iter) {
         chip = list_entry(iter, struct gpio_chip_s, list);
         if (chip->base <= *which && *which < chip->end) {
             *which -= chip->base;
+            g_gpio_last_chip = chip;
             return chip;
         }
     }
     return NULL;
 }
 
+/**
+ * @brief Get the lines of mask, starting at line base, handled by one chip
+ *
+ * @param base The number of the first GPIO line of mask
+ * @param mask Bitmask of lines, must not be 0
+ * @param which Set to the chip line of the lowest line of mask
+ * @param shift Set to the bit of mask matching that line
+ * @return The chip, NULL if the lowest line of mask has no chip. The lines of
+ * the chip are removed from mask and returned in chip_mask, shifted so that
+ * bit 0 is line which of the chip.
+ */
+static struct gpio_chip_s *get_gpio_chip_mask(uint8_t base, uint32_t *mask,
+                                              uint32_t *chip_mask,
+                                              uint8_t *which, int *shift)
+{
+    struct gpio_chip_s *chip;
+    unsigned int line;
+    unsigned int span;
+
+    *shift = __builtin_ctz(*mask);
+    line = base + *shift;
+    if (line > UINT8_MAX)
+        return NULL;
+
+    *which = line;
+    chip = get_gpio_chip(which);
+    if (!chip)
+        return NULL;
+
+    span = chip->end - line;
+    *chip_mask = *mask >> *shift;
+    if (span < 32)
+        *chip_mask &= (1u << span) - 1;
+    *mask &= ~(*chip_mask << *shift);
+
+    return chip;
+}
+
 int gpio_get_direction(uint8_t which)
 {
     struct gpio_chip_s *chip = get_gpio_chip(&which);
@@ -174,6 +224,76 @@ void gpio_set_value(uint8_t which, uint8_t value)
     chip->ops->set_value(chip->driver_data, which, value);
 }
 
+int gpio_get_values(uint8_t base, uint32_t mask, uint32_t *values)
+{
+    struct gpio_chip_s *chip;
+    uint32_t chip_mask, chip_values, m;
+    uint8_t which;
+    int shift, i, ret;
+
+    DEBUGASSERT(values);
+
+    *values = 0;
+    while (mask) {
+        chip = get_gpio_chip_mask(base, &mask, &chip_mask, &which, &shift);
+        if (!chip)
+            return -EINVAL;
+
+        DEBUGASSERT(chip->ops);
+        if (chip->ops->get_values) {
+            ret = chip->ops->get_values(chip->driver_data, which, chip_mask,
+                                        &chip_values);
+            if (ret)
+                return ret;
+            chip_values &= chip_mask;
+        } else {
+            DEBUGASSERT(chip->ops->get_value);
+            chip_values = 0;
+            for (m = chip_mask; m; m &= m - 1) {
+                i = __builtin_ctz(m);
+                if (chip->ops->get_value(chip->driver_data, which + i))
+                    chip_values |= 1u << i;
+            }
+        }
+        *values |= chip_values << shift;
+    }
+
+    return 0;
+}
+
+int gpio_set_values(uint8_t base, uint32_t mask, uint32_t values)
+{
+    struct gpio_chip_s *chip;
+    uint32_t chip_mask, chip_values, m;
+    uint8_t which;
+    int shift, i, ret;
+
+    while (mask) {
+        chip = get_gpio_chip_mask(base, &mask, &chip_mask, &which, &shift);
+        if (!chip)
+            return -EINVAL;
+
+        chip_values = (values >> shift) & chip_mask;
+
+        DEBUGASSERT(chip->ops);
+        if (chip->ops->set_values) {
+            ret = chip->ops->set_values(chip->driver_data, which, chip_mask,
+                                        chip_values);
+            if (ret)
+                return ret;
+        } else {
+            DEBUGASSERT(chip->ops->set_value);
+            for (m = chip_mask; m; m &= m - 1) {
+                i = __builtin_ctz(m);
+                chip->ops->set_value(chip->driver_data, which + i,
+                                     (chip_values >> i) & 1);
+            }
+        }
+    }
+
+    return 0;
+}
+
 int gpio_set_debounce(uint8_t which, uint16_t delay)
 {
     struct gpio_chip_s *chip = get_gpio_chip(&which);
@@ -45,6 +45,7 @@
 #include <nuttx/gpio_chip.h>
 #include <nuttx/wqueue.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <sys/wait.h>
 
 #define TCA6408_INPUT_REG               0x00
@@ -80,6 +81,9 @@
 
 #define TCA6424_NR_GPIOS                24
 
+/* TCA6424 command byte flag to access consecutive registers */
+#define TCA6424_AUTO_INCREMENT          0x80
+
 #define TCA64XX_NR_GPIO_MAX             TCA6424_NR_GPIOS
 
 /* 1us (datasheet: reset pulse duration (Tw) is 4ns */
@@ -141,6 +145,10 @@ struct tca64xx_platform_data {
     uint32_t mask;
     uint32_t trigger;
     uint32_t level;
+    /* Output Port and Configuration Registers, only written by this driver */
+    uint32_t out;
+    uint32_t config;
+    sem_t lock;
 
     struct list_head list;
     xcpt_t irq_vector[TCA64XX_NR_GPIO_MAX];
@@ -295,27 +303,38 @@ static struct tca64xx_platform_data *get_pdata(uint32_t irq)
     return NULL;
 }
 
-static int i2c_get(void *driver_data, uint8_t regaddr, uint8_t *val)
+/*
+ * Read count consecutive registers in one transaction. The TCA6416 toggles
+ * between the two registers of a pair by itself, the TCA6424 needs the
+ * auto-increment flag.
+ */
+static int i2c_get_regs(void *driver_data, uint8_t regaddr, uint8_t *val,
+                        uint8_t count)
 {
     int ret;
     struct tca64xx_platform_data *tca64xx = driver_data;
     struct i2c_dev_s *dev = tca64xx->dev;
     uint8_t addr = tca64xx->addr;
+    uint8_t cmd = regaddr;
     struct i2c_msg_s msg[] = {
         {
          .addr = addr,
          .flags = 0,
-         .buffer = &regaddr,
+         .buffer = &cmd,
          .length = 1,
         },
         {
          .addr = addr,
          .flags = I2C_M_READ,
          .buffer = val,
-         .length = 1,
+         .length = count,
         },
     };
 
+    if (count > 1 && tca64xx->part == TCA6424_PART) {
+        cmd |= TCA6424_AUTO_INCREMENT;
+    }
+
     if (!dev) {
         return -EINVAL;
     }
@@ -334,32 +353,45 @@ static int i2c_get(void *driver_data, uint8_t regaddr, uint8_t *val)
     return ret;
 }
 
-static int i2c_set(void *driver_data, uint8_t regaddr, uint8_t val)
+static int i2c_get(void *driver_data, uint8_t regaddr, uint8_t *val)
+{
+    return i2c_get_regs(driver_data, regaddr, val, 1);
+}
+
+/* Write count consecutive registers in one transaction */
+static int i2c_set_regs(void *driver_data, uint8_t regaddr,
+                        const uint8_t *val, uint8_t count)
 {
     int ret;
     struct tca64xx_platform_data *tca64xx = driver_data;
     struct i2c_dev_s *dev = tca64xx->dev;
     uint8_t addr = tca64xx->addr;
-    uint8_t cmd[2] = { regaddr, val };
+    uint8_t cmd[1 + TCA64XX_NR_GPIO_MAX / 8];
     struct i2c_msg_s msg[] = {
         {
          .addr = addr,
          .flags = 0,
          .buffer = cmd,
-         .length = 2,
+         .length = 1 + count,
         },
     };
 
-    if (!dev) {
+    if (!dev || count > TCA64XX_NR_GPIO_MAX / 8) {
         return -EINVAL;
     }
 
+    cmd[0] = regaddr;
+    if (count > 1 && tca64xx->part == TCA6424_PART) {
+        cmd[0] |= TCA6424_AUTO_INCREMENT;
+    }
+    memcpy(&cmd[1], val, count);
+
     I2C_SETADDRESS(dev, addr, 7);
 
     ret = I2C_TRANSFER(dev, msg, 1);
     if (ret == OK) {
         lldbg("%s: addr=0x%02hhX, regaddr=0x%02hhX, val=0x%02hhX\n",
-              __func__, addr, regaddr, val);
+              __func__, addr, regaddr, val[0]);
     } else {
         lldbg_error("%s: addr=0x%02hhX, regaddr=0x%02hhX: failed, ret=%d!\n",
               __func__, addr, regaddr, ret);
@@ -368,6 +400,50 @@ static int i2c_set(void *driver_data, uint8_t regaddr, uint8_t val)
     return ret;
 }
 
+static int i2c_set(void *driver_data, uint8_t regaddr, uint8_t val)
+{
+    return i2c_set_regs(driver_data, regaddr, &val, 1);
+}
+
+/*
+ * Write the bytes of a 32-bit register image covering lines first to last
+ * (inclusive) to the registers starting at reg0, the register of line 0.
+ */
+static int tca64xx_write_bytes(struct tca64xx_platform_data *tca64xx,
+                               uint8_t reg0, uint32_t image,
+                               uint8_t first, uint8_t last)
+{
+    uint8_t buf[TCA64XX_NR_GPIO_MAX / 8];
+    int i, n = last / 8 - first / 8 + 1;
+
+    for (i = 0; i < n; i++) {
+        buf[i] = image >> (8 * (first / 8 + i));
+    }
+
+    return i2c_set_regs(tca64xx, reg0 + first / 8, buf, n);
+}
+
+/* Read the registers starting at reg0 into a 32-bit register image */
+static int tca64xx_read_image(struct tca64xx_platform_data *tca64xx,
+                              uint8_t reg0, uint32_t *image)
+{
+    uint8_t buf[TCA64XX_NR_GPIO_MAX / 8];
+    int i, n = get_nr_gpios(tca64xx->part) / 8;
+    int ret;
+
+    ret = i2c_get_regs(tca64xx, reg0, buf, n);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *image = 0;
+    for (i = 0; i < n; i++) {
+        *image |= (uint32_t)buf[i] << (8 * i);
+    }
+
+    return 0;
+}
+
 int tca64xx_reset(void *driver_data, bool en)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
@@ -393,36 +469,71 @@ int tca64xx_reset(void *driver_data, bool en)
 void tca64xx_set(void *driver_data, uint8_t which, uint8_t value)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
-    uint8_t reg, val;
+    uint8_t reg;
+    uint32_t out;
     int ret;
 
     lldbg("%s: addr=0x%02hhX, which=%hhu, val=%hhu\n", __func__,
-          tca64xx->addr, which, val);
+          tca64xx->addr, which, value);
     /* Set output pins default value (before configuring it as output)
      *
      * The Output Port Register (register 1) shows the outgoing logic
      * levels of the pins defined as outputs by the Configuration Register.
+     * Only this driver writes it, so it does not need to be read back.
      */
     reg = get_output_reg(tca64xx->part, which);
     if (reg < 0)
         return;
-    ret = i2c_get(tca64xx, reg, &val);
-    if (ret != 0)
-        return;
-    lldbg("%s: current val=0x%02hhX\n", __func__, val);
+
+    while (sem_wait(&tca64xx->lock) != OK);
     if (value) {
-        val |= (1 << (which % 8));
+        out = tca64xx->out | (1 << which);
     } else {
-        val &= ~(1 << (which % 8));
+        out = tca64xx->out & ~(1 << which);
+    }
+    lldbg("%s: new out=0x%06X\n", __func__, out);
+    ret = i2c_set(tca64xx, reg, out >> (which & 0xF8));
+    if (ret == 0) {
+        tca64xx->out = out;
+    }
+    sem_post(&tca64xx->lock);
+}
+
+static int tca64xx_set_values(void *driver_data, uint8_t which,
+                              uint32_t mask, uint32_t values)
+{
+    struct tca64xx_platform_data *tca64xx = driver_data;
+    uint8_t last;
+    uint32_t out;
+    int ret;
+
+    if (!mask) {
+        return 0;
+    }
+
+    last = which + 31 - __builtin_clz(mask);
+    if (last >= get_nr_gpios(tca64xx->part)) {
+        return -EINVAL;
+    }
+
+    while (sem_wait(&tca64xx->lock) != OK);
+    out = (tca64xx->out & ~(mask << which)) | ((values & mask) << which);
+    lldbg("%s: new out=0x%06X\n", __func__, out);
+    ret = tca64xx_write_bytes(tca64xx, get_output_reg(tca64xx->part, 0), out,
+                              which, last);
+    if (ret == 0) {
+        tca64xx->out = out;
     }
-    lldbg("%s: new val=0x%02hhX\n", __func__, val);
-    ret = i2c_set(tca64xx, reg, val);
+    sem_post(&tca64xx->lock);
+
+    return ret;
 }
 
 void tca64xx_set_direction_in(void *driver_data, uint8_t which)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
-    uint8_t reg, val;
+    uint8_t reg;
+    uint32_t config;
     int ret;
 
     lldbg("%s: addr=0x%02hhX, which=%hhu\n", __func__, tca64xx->addr, which);
@@ -438,20 +549,22 @@ void tca64xx_set_direction_in(void *driver_data, uint8_t which)
     reg = get_config_reg(tca64xx->part, which);
     if (reg < 0)
         return;
-    ret = i2c_get(tca64xx, reg, &val);
-    if (ret != 0) {
-        lldbg_error("%s: current cfg=0x%02X\n", __func__, val);
-        return;
+
+    while (sem_wait(&tca64xx->lock) != OK);
+    config = tca64xx->config | (1 << which);
+    lldbg("%s: new cfg=0x%06X\n", __func__, config);
+    ret = i2c_set(tca64xx, reg, config >> (which & 0xF8));
+    if (ret == 0) {
+        tca64xx->config = config;
     }
-    val |= (1 << (which % 8));
-    lldbg("%s: new cfg=0x%02X\n", __func__, val);
-    ret = i2c_set(tca64xx, reg, val);
+    sem_post(&tca64xx->lock);
 }
 
 void tca64xx_set_direction_out(void *driver_data, uint8_t which, uint8_t value)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
-    uint8_t reg, val;
+    uint8_t reg;
+    uint32_t config;
     int ret;
 
     lldbg("%s: addr=0x%02hhX, which=%hhu\n", __func__, tca64xx->addr, which);
@@ -467,14 +580,15 @@ void tca64xx_set_direction_out(void *driver_data, uint8_t which, uint8_t value)
     if (reg < 0) {
         return;
     }
-    ret = i2c_get(tca64xx, reg, &val);
-    if (ret != 0) {
-        return;
+
+    while (sem_wait(&tca64xx->lock) != OK);
+    config = tca64xx->config & ~(1 << which);
+    lldbg("%s: new cfg=0x%06X\n", __func__, config);
+    ret = i2c_set(tca64xx, reg, config >> (which & 0xF8));
+    if (ret == 0) {
+        tca64xx->config = config;
     }
-    lldbg("%s: current cfg=0x%02X\n", __func__, val);
-    val &= ~(1 << (which % 8));
-    lldbg("%s: new cfg=0x%02X\n", __func__, val);
-    ret = i2c_set(tca64xx, reg, val);
+    sem_post(&tca64xx->lock);
     if (ret != 0) {
         return;
     }
@@ -487,7 +601,6 @@ int tca64xx_get_direction(void *driver_data, uint8_t which)
     struct tca64xx_platform_data *tca64xx = driver_data;
     uint8_t reg;
     uint8_t direction;
-    int ret;
 
     lldbg("addr=0x%02hhX, which=%hhu", tca64xx->addr, which);
     /*
@@ -501,11 +614,7 @@ int tca64xx_get_direction(void *driver_data, uint8_t which)
     if (reg < 0) {
         return reg;
     }
-    ret = i2c_get(tca64xx, reg, &direction);
-    if (ret != 0) {
-        return -EIO;
-    }
-    direction = (direction & (1 << (which % 8))) >> (which % 8);
+    direction = (tca64xx->config >> which) & 1;
 
     return direction;
 }
@@ -646,20 +755,12 @@ static void intstat_update(void *driver_data, uint32_t in, uint32_t mask)
 static void tca64xx_registers_update(void *driver_data)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
-    int i, ret;
-    uint32_t in = 0;
-    uint8_t val, reg;
+    int ret;
+    uint32_t in;
 
-    for (i = 0; i < (get_nr_gpios(tca64xx->part)); i += 8) {
-        reg = get_input_reg(tca64xx->part, i);
-        if (reg < 0) {
-            return;
-        }
-        ret = i2c_get(tca64xx, reg, &val);
-        if (ret != 0) {
-            return;
-        }
-        in |= (val << i);
+    ret = tca64xx_read_image(tca64xx, get_input_reg(tca64xx->part, 0), &in);
+    if (ret != 0) {
+        return;
     }
     lldbg("%s: in=0x%08x\n", __func__, in);
 
@@ -702,6 +803,48 @@ uint8_t tca64xx_get(void *driver_data, uint8_t which)
     return val;
 }
 
+static int tca64xx_get_values(void *driver_data, uint8_t which,
+                              uint32_t mask, uint32_t *values)
+{
+    struct tca64xx_platform_data *tca64xx = driver_data;
+    uint8_t buf[TCA64XX_NR_GPIO_MAX / 8];
+    uint8_t first, last;
+    uint32_t in = 0, inmask = 0;
+    int i, ret;
+
+    if (!mask) {
+        *values = 0;
+        return 0;
+    }
+
+    last = which + 31 - __builtin_clz(mask);
+    if (last >= get_nr_gpios(tca64xx->part)) {
+        return -EINVAL;
+    }
+
+    /* Read all the Input Port Registers covering the lines at once */
+    first = which / 8;
+    last /= 8;
+    ret = i2c_get_regs(tca64xx, get_input_reg(tca64xx->part, which), buf,
+                       last - first + 1);
+    if (ret != 0) {
+        return -EIO;
+    }
+
+    for (i = first; i <= last; i++) {
+        in |= (uint32_t)buf[i - first] << (8 * i);
+        inmask |= (uint32_t)0xFF << (8 * i);
+    }
+    lldbg("%s: in=0x%06X\n", __func__, in);
+
+    /* Update the input status with the bits read from the expander */
+    intstat_update(driver_data, in, inmask);
+
+    *values = (in >> which) & mask;
+
+    return 0;
+}
+
 uint8_t tca64xx_line_count(void *driver_data)
 {
     struct tca64xx_platform_data *tca64xx = driver_data;
@@ -929,6 +1072,8 @@ struct gpio_ops_s tca64xx_gpio_ops = {
     .mask_irq = tca64xx_gpio_mask_irq,
     .unmask_irq = tca64xx_gpio_unmask_irq,
     .clear_interrupt = tca64xx_gpio_clear_interrupt,
+    .get_values = tca64xx_get_values,
+    .set_values = tca64xx_set_values,
 };
 
 static int tca64xx_polling_worker(int argc, char *argv[])
@@ -983,12 +1128,23 @@ int tca64xx_init(void **driver_data, tca64xx_part part, struct i2c_dev_s *dev,
     tca64xx->mask = (1 << nr_gpios) - 1;
     tca64xx->in = 0;
     tca64xx->intstat = 0;
+    sem_init(&tca64xx->lock, 0, 1);
 
     if (reset != TCA64XX_IO_UNUSED)
         tca64xx_reset(tca64xx, 0);
 
     tca64xx_registers_update(tca64xx);
 
+    /* Cache the output and direction registers (power-on default: all 1) */
+    if (tca64xx_read_image(tca64xx, get_output_reg(part, 0),
+                           &tca64xx->out) != 0) {
+        tca64xx->out = (1 << nr_gpios) - 1;
+    }
+    if (tca64xx_read_image(tca64xx, get_config_reg(part, 0),
+                           &tca64xx->config) != 0) {
+        tca64xx->config = (1 << nr_gpios) - 1;
+    }
+
     register_gpio_chip(&tca64xx_gpio_ops, gpio_base, tca64xx);
 
     if (irq != TCA64XX_IO_UNUSED) {
@@ -1066,6 +1222,7 @@ void tca64xx_deinit(void *driver_data)
     unregister_gpio_chip(driver_data);
 
     /* Free driver data */
+    sem_destroy(&tca64xx->lock);
     free(driver_data);
 
     irqrestore(flags);
@@ -47,6 +47,13 @@
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/greybus/debug.h>
 #include <nuttx/unipro/unipro.h>
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+#include <nuttx/hires_tmr.h>
+#include <nuttx/greybus/timesync.h>
+#endif
+#ifdef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
+#include <nuttx/wqueue.h>
+#endif
 
 #include <arch/byteorder.h>
 
@@ -57,6 +64,14 @@
 
 #define GB_AUDIO_TX_RING_BUF_PAD            2
 #define GB_AUDIO_RX_RING_BUF_PAD            2
+/* I2S DMA transfers are done in 32-bit words */
+#define GB_AUDIO_RING_BUF_ALIGNMENT         4
+
+#ifdef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
+#define GB_AUDIO_BUFFER_US                  CONFIG_GREYBUS_AUDIO_LL_BUFFER_US
+#else
+#define GB_AUDIO_BUFFER_US                  GB_AUDIO_SAMPLE_BUFFER_MIN_US
+#endif
 
 #define GB_AUDIO_FLAG_PCM_SET               BIT(0)
 #define GB_AUDIO_FLAG_TX_DATA_SIZE_SET      BIT(1)
@@ -79,6 +94,30 @@ struct gb_audio_info { /* One per audio Bundle */
     struct list_head        list;       /* next gb_audio_info struct */
 };
 
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+/*
+ * Playback jitter buffer. The I2S transmitter only starts once 'target'
+ * entries are queued, and 'target' follows the arrival jitter of the audio
+ * messages measured over each window. The clock drift between the AP and
+ * the I2S clock shows as a fill level drifting away from 'target': it is
+ * compensated by dropping or repeating one sample frame ('unit' bytes)
+ * per message during the next window.
+ */
+struct gb_audio_jb {
+    unsigned int            entries;    /* ring entries */
+    unsigned int            target;     /* entries to keep queued */
+    unsigned int            unit;       /* bytes inserted or dropped */
+    int                     adjust;     /* -1 drop, 1 insert, 0 nothing */
+    bool                    frame_time; /* arrivals timed with timesync */
+    uint32_t                last;       /* last arrival time */
+    uint32_t                period;     /* average arrival interval */
+    uint32_t                max_jitter; /* in the current window */
+    unsigned int            msgs;       /* in the current window */
+    unsigned int            fill_sum;   /* in the current window */
+    unsigned int            underruns;  /* in the current window */
+};
+#endif
+
 struct gb_audio_dai_info {
     uint32_t                flags;
     uint16_t                data_cport;
@@ -92,12 +131,19 @@ struct gb_audio_dai_info {
     unsigned int            sample_freq;
 
     unsigned int            tx_rb_count;
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    struct gb_audio_jb      jb;
+#endif
 
     struct ring_buf         *tx_rb;
     unsigned int            tx_data_size;
     unsigned int            tx_samples_per_msg;
     uint8_t                 *tx_dummy_data;
     sem_t                   tx_stop_sem;
+#ifdef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
+    struct work_s           tx_work;
+    bool                    tx_overrun;
+#endif
 
     struct ring_buf         *rx_rb;
     unsigned int            rx_data_size;
@@ -840,6 +886,55 @@ static uint8_t gb_audio_set_tx_data_size_handler(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+/* (rate / samples_per_msg) * (buffer_amount_us / 1,000,000) */
+static unsigned int gb_audio_ring_entries(struct gb_audio_dai_info *dai,
+                                          unsigned int samples_per_msg,
+                                          unsigned int pad)
+{
+    return ((dai->sample_freq * GB_AUDIO_BUFFER_US) /
+            (samples_per_msg * 1000000)) + pad;
+}
+
+static uint32_t gb_audio_msgs_to_us(struct gb_audio_dai_info *dai,
+                                    unsigned int msgs,
+                                    unsigned int samples_per_msg)
+{
+    return ((uint64_t)msgs * samples_per_msg * 1000000) / dai->sample_freq;
+}
+
+/*
+ * Audio held by this driver on the playback path: the messages queued
+ * before the I2S transmitter is started, which stay queued ahead of the
+ * one being played.
+ */
+static uint32_t gb_audio_tx_driver_delay(struct gb_audio_dai_info *dai)
+{
+    unsigned int msgs;
+
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    if (dai->flags & GB_AUDIO_FLAG_TX_ACTIVE) {
+        msgs = dai->jb.target;
+    } else {
+        msgs = MIN(CONFIG_GREYBUS_AUDIO_JB_MIN_DEPTH,
+                   gb_audio_ring_entries(dai, dai->tx_samples_per_msg,
+                                         GB_AUDIO_TX_RING_BUF_PAD) - 1);
+    }
+#else
+    msgs = 1;
+#endif
+
+    return gb_audio_msgs_to_us(dai, msgs, dai->tx_samples_per_msg);
+}
+
+/*
+ * Audio held by this driver on the capture path: a message is sent once the
+ * I2S receiver has filled it.
+ */
+static uint32_t gb_audio_rx_driver_delay(struct gb_audio_dai_info *dai)
+{
+    return gb_audio_msgs_to_us(dai, 1, dai->rx_samples_per_msg);
+}
+
 static uint8_t gb_audio_get_tx_delay_handler(struct gb_operation *operation)
 {
     struct gb_audio_get_tx_delay_request *request =
@@ -884,14 +979,17 @@ static uint8_t gb_audio_get_tx_delay_handler(struct gb_operation *operation)
         return gb_errno_to_op_result(ret);
     }
 
-    /* TODO: Determine delay from this driver and add in */
-    response->delay = cpu_to_le32(codec_delay + i2s_delay);
+    response->delay = cpu_to_le32(codec_delay + i2s_delay +
+                                  gb_audio_tx_driver_delay(dai));
 
     return GB_OP_SUCCESS;
 }
 
-static void gb_audio_i2s_tx(struct gb_audio_dai_info *dai, uint8_t *data)
+static void gb_audio_i2s_tx(struct gb_audio_dai_info *dai, uint8_t *data,
+                            int adjust)
 {
+    unsigned int len = dai->tx_data_size;
+
     ring_buf_reset(dai->tx_rb);
 
     /*
@@ -899,9 +997,22 @@ static void gb_audio_i2s_tx(struct gb_audio_dai_info *dai, uint8_t *data)
      * susbystem reuses the buffer immediately and the data may
      * not be sent out yet.
      */
-    memcpy(ring_buf_get_tail(dai->tx_rb), data, dai->tx_data_size);
-
-    ring_buf_put(dai->tx_rb, dai->tx_data_size);
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    if (adjust < 0) {
+        len -= dai->jb.unit;
+    }
+    memcpy(ring_buf_get_tail(dai->tx_rb), data, len);
+    if (adjust > 0) {
+        /* Repeat the last sample frame */
+        memcpy(ring_buf_get_tail(dai->tx_rb) + len,
+               data + len - dai->jb.unit, dai->jb.unit);
+        len += dai->jb.unit;
+    }
+#else
+    memcpy(ring_buf_get_tail(dai->tx_rb), data, len);
+#endif
+
+    ring_buf_put(dai->tx_rb, len);
     ring_buf_pass(dai->tx_rb);
 
     dai->tx_rb = ring_buf_get_next(dai->tx_rb);
@@ -909,6 +1020,109 @@ static void gb_audio_i2s_tx(struct gb_audio_dai_info *dai, uint8_t *data)
     dai->tx_rb_count++;
 }
 
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+static void gb_audio_jb_init(struct gb_audio_dai_info *dai,
+                             unsigned int entries)
+{
+    struct gb_audio_jb *jb = &dai->jb;
+
+    memset(jb, 0, sizeof(*jb));
+    jb->entries = entries;
+    jb->target = MIN(CONFIG_GREYBUS_AUDIO_JB_MIN_DEPTH, entries - 1);
+
+    /* I2S transfers are made of 32-bit words */
+    jb->unit = dai->sample_size;
+    while (jb->unit % GB_AUDIO_RING_BUF_ALIGNMENT) {
+        jb->unit += dai->sample_size;
+    }
+    if (jb->unit >= dai->tx_data_size) {
+        jb->unit = 0;
+    }
+}
+
+/*
+ * Use the timesync frame time when it is running, since it is shared with
+ * the AP, and the local timer otherwise. Only differences between two
+ * arrivals are used so the unit does not matter.
+ */
+static uint32_t gb_audio_jb_now(struct gb_audio_jb *jb)
+{
+    bool frame_time = timesync_get_state() == TIMESYNC_STATE_ACTIVE;
+
+    if (frame_time != jb->frame_time) {
+        jb->frame_time = frame_time;
+        jb->last = 0;
+        jb->period = 0;
+    }
+
+    return frame_time ? (uint32_t) timesync_get_frame_time() : hrt_getusec();
+}
+
+static void gb_audio_jb_update(struct gb_audio_jb *jb)
+{
+    unsigned int target = CONFIG_GREYBUS_AUDIO_JB_MIN_DEPTH;
+    unsigned int avg_fill_x16;
+
+    /* Enough entries to cover the worst arrival delay of the window */
+    if (jb->period) {
+        target += (jb->max_jitter + jb->period - 1) / jb->period;
+    }
+
+    if (jb->underruns && jb->target >= target) {
+        target = jb->target + 1;
+    } else if (target < jb->target) {
+        /* Shrink slowly, a burst may come back */
+        target = jb->target - 1;
+    }
+    jb->target = MIN(target, jb->entries - 1);
+
+    avg_fill_x16 = (jb->fill_sum * 16) / jb->msgs;
+    if (!jb->unit) {
+        jb->adjust = 0;
+    } else if (avg_fill_x16 > (jb->target + 1) * 16) {
+        jb->adjust = -1;
+    } else if (avg_fill_x16 + 8 < jb->target * 16) {
+        jb->adjust = 1;
+    } else {
+        jb->adjust = 0;
+    }
+
+    jb->msgs = 0;
+    jb->fill_sum = 0;
+    jb->max_jitter = 0;
+    jb->underruns = 0;
+}
+
+/* Called with interrupts disabled for each audio message received */
+static int gb_audio_jb_arrival(struct gb_audio_dai_info *dai)
+{
+    struct gb_audio_jb *jb = &dai->jb;
+    uint32_t now = gb_audio_jb_now(jb);
+    uint32_t delta, jitter;
+
+    if (jb->last) {
+        delta = now - jb->last;
+        if (!jb->period) {
+            jb->period = delta;
+        } else {
+            jb->period = jb->period - (jb->period >> 3) + (delta >> 3);
+        }
+        jitter = delta > jb->period ? delta - jb->period : 0;
+        jb->max_jitter = MAX(jb->max_jitter, jitter);
+    }
+    jb->last = now;
+
+    if (dai->flags & GB_AUDIO_FLAG_TX_STARTED) {
+        jb->fill_sum += dai->tx_rb_count;
+        if (++jb->msgs >= CONFIG_GREYBUS_AUDIO_JB_WINDOW) {
+            gb_audio_jb_update(jb);
+        }
+    }
+
+    return jb->adjust;
+}
+#endif
+
 /* Callback for low-level i2s transmit operations */
 static void gb_audio_i2s_tx_cb(struct ring_buf *rb,
                                enum device_i2s_event event, void *arg)
@@ -923,7 +1137,10 @@ static void gb_audio_i2s_tx_cb(struct ring_buf *rb,
 
         if (dai->tx_rb_count < 2) {
             if (!(dai->flags & GB_AUDIO_FLAG_TX_STOPPING)) {
-                gb_audio_i2s_tx(dai, dai->tx_dummy_data);
+                gb_audio_i2s_tx(dai, dai->tx_dummy_data, 0);
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+                dai->jb.underruns++;
+#endif
             } else if (!dai->tx_rb_count) {
                 sem_post(&dai->tx_stop_sem);
             }
@@ -985,12 +1202,22 @@ static uint8_t gb_audio_activate_tx_handler(struct gb_operation *operation)
         return GB_OP_PROTOCOL_BAD;
     }
 
-    /* (rate / samples_per_msg) * (buffer_amount_us / 1,000,000) */
-    entries = ((dai->sample_freq * GB_AUDIO_SAMPLE_BUFFER_MIN_US) /
-               (dai->tx_samples_per_msg * 1000000)) + GB_AUDIO_TX_RING_BUF_PAD;
+    entries = gb_audio_ring_entries(dai, dai->tx_samples_per_msg,
+                                    GB_AUDIO_TX_RING_BUF_PAD);
+
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    gb_audio_jb_init(dai, entries);
 
-    dai->tx_rb = ring_buf_alloc_ring(entries, 0, dai->tx_data_size, 0, NULL,
-                                     NULL, NULL);
+    /* Leave room for a repeated sample frame in each entry */
+    dai->tx_rb = ring_buf_alloc_contiguous(entries, 0,
+                                           dai->tx_data_size + dai->jb.unit, 0,
+                                           GB_AUDIO_RING_BUF_ALIGNMENT,
+                                           BUFRAM_OWNER_I2S, NULL, NULL, NULL);
+#else
+    dai->tx_rb = ring_buf_alloc_contiguous(entries, 0, dai->tx_data_size, 0,
+                                           GB_AUDIO_RING_BUF_ALIGNMENT,
+                                           BUFRAM_OWNER_I2S, NULL, NULL, NULL);
+#endif
     if (!dai->tx_rb) {
         return GB_OP_NO_MEMORY;
     }
@@ -1016,7 +1243,7 @@ err_free_dummy_data:
     free(dai->tx_dummy_data);
     dai->tx_dummy_data = NULL;
 err_free_tx_rb:
-    ring_buf_free_ring(dai->tx_rb, NULL, NULL);
+    ring_buf_free_contiguous(dai->tx_rb, NULL, NULL);
     dai->tx_rb = NULL;
 
     return gb_errno_to_op_result(ret);
@@ -1053,6 +1280,11 @@ static uint8_t gb_audio_deactivate_tx_handler(struct gb_operation *operation)
 
     dai->flags |= GB_AUDIO_FLAG_TX_STOPPING;
 
+#ifdef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
+    work_cancel(HPWORK, &dai->tx_work);
+    dai->tx_overrun = false;
+#endif
+
     if (dai->flags & GB_AUDIO_FLAG_TX_STARTED) {
         irqrestore(flags);
         sem_wait(&dai->tx_stop_sem);
@@ -1064,7 +1296,7 @@ static uint8_t gb_audio_deactivate_tx_handler(struct gb_operation *operation)
 
     device_i2s_shutdown_transmitter(dai->i2s_dev);
 
-    ring_buf_free_ring(dai->tx_rb, NULL, NULL);
+    ring_buf_free_contiguous(dai->tx_rb, NULL, NULL);
     dai->tx_rb = NULL;
     free(dai->tx_dummy_data);
     dai->tx_dummy_data = NULL;
@@ -1159,8 +1391,8 @@ static uint8_t gb_audio_get_rx_delay_handler(struct gb_operation *operation)
         return gb_errno_to_op_result(ret);
     }
 
-    /* TODO: Determine delay from this driver and add in */
-    response->delay = cpu_to_le32(codec_delay + i2s_delay);
+    response->delay = cpu_to_le32(codec_delay + i2s_delay +
+                                  gb_audio_rx_driver_delay(dai));
 
     return GB_OP_SUCCESS;
 }
@@ -1304,9 +1536,8 @@ static uint8_t gb_audio_activate_rx_handler(struct gb_operation *operation)
         return GB_OP_PROTOCOL_BAD;
     }
 
-    /* (sample_freq / samples_per_msg) * (buffer_amount_us / 1,000,000) */
-    entries = ((dai->sample_freq * GB_AUDIO_SAMPLE_BUFFER_MIN_US) /
-               (dai->rx_samples_per_msg * 1000000)) + GB_AUDIO_RX_RING_BUF_PAD;
+    entries = gb_audio_ring_entries(dai, dai->rx_samples_per_msg,
+                                    GB_AUDIO_RX_RING_BUF_PAD);
 
     dai->rx_rb = ring_buf_alloc_ring(entries, 0, 0, 0,
                                      gb_audio_rb_alloc_gb_op,
@@ -1692,6 +1923,8 @@ static struct gb_driver gb_audio_mgmt_driver = {
     .exit               = gb_audio_exit,
     .op_handlers        = gb_audio_mgmt_handlers,
     .op_handlers_count  = ARRAY_SIZE(gb_audio_mgmt_handlers),
+    .dedicated_worker   = true,
+    .qos                = GB_QOS_REALTIME,
 };
 
 void gb_audio_mgmt_register(int mgmt_cport, int bundle)
@@ -1699,6 +1932,7 @@ void gb_audio_mgmt_register(int mgmt_cport, int bundle)
     gb_register_driver(mgmt_cport, bundle, &gb_audio_mgmt_driver);
 }
 
+#ifndef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
 static uint8_t gb_audio_send_data_handler(struct gb_operation *operation)
 {
     struct gb_audio_send_data_request *request =
@@ -1735,13 +1969,24 @@ static uint8_t gb_audio_send_data_handler(struct gb_operation *operation)
         return GB_OP_SUCCESS;
     }
 
-    gb_audio_i2s_tx(dai, request->data);
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    gb_audio_i2s_tx(dai, request->data, gb_audio_jb_arrival(dai));
+
+    /* Wait for the jitter buffer to fill up before starting to play */
+    if (!(dai->flags & GB_AUDIO_FLAG_TX_STARTED) &&
+        dai->tx_rb_count < dai->jb.target) {
+        irqrestore(flags);
+        return GB_OP_SUCCESS;
+    }
+#else
+    gb_audio_i2s_tx(dai, request->data, 0);
 
     /*
      * TODO: don't start until there is one buffered.  Even better,
      * don't start until half of the ring buffer is filled up (or add
      * a high watermark macro).  Adjust tx start delay value accordingly.
      */
+#endif
 
     dai->flags |= GB_AUDIO_FLAG_TX_STARTED;
 
@@ -1758,17 +2003,127 @@ static uint8_t gb_audio_send_data_handler(struct gb_operation *operation)
 
     return GB_OP_SUCCESS;
 }
+#else
+/* Start the I2S transmitter, or keep it going, once data has been queued */
+static void gb_audio_tx_worker(void *arg)
+{
+    struct gb_audio_dai_info *dai = arg;
+    irqstate_t flags;
+    bool overrun;
+    int ret;
+
+    flags = irqsave();
+
+    overrun = dai->tx_overrun;
+    dai->tx_overrun = false;
+
+    if (!(dai->flags & GB_AUDIO_FLAG_TX_ACTIVE) ||
+        (dai->flags & GB_AUDIO_FLAG_TX_STOPPING)) {
+        irqrestore(flags);
+        return;
+    }
+
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+    /* Wait for the jitter buffer to fill up before starting to play */
+    if (!(dai->flags & GB_AUDIO_FLAG_TX_STARTED) &&
+        dai->tx_rb_count < dai->jb.target) {
+        irqrestore(flags);
+        goto out;
+    }
+#endif
+
+    dai->flags |= GB_AUDIO_FLAG_TX_STARTED;
+
+    irqrestore(flags);
+
+    ret = device_i2s_start_transmitter(dai->i2s_dev);
+    if (ret) {
+        dai->flags &= ~GB_AUDIO_FLAG_TX_STARTED;
+
+        gb_audio_report_event(dai, GB_AUDIO_STREAMING_EVENT_FAILURE);
+        gb_audio_report_event(dai, GB_AUDIO_STREAMING_EVENT_HALT);
+    }
+
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+out:
+#endif
+    if (overrun) {
+        gb_audio_report_event(dai, GB_AUDIO_STREAMING_EVENT_OVERRUN);
+    }
+}
+
+/*
+ * Called from the UniPro receive path, so the data is copied into the I2S
+ * ring right away and anything that may block is left to the worker. Send
+ * Data requests are unidirectional so there is no response to send.
+ */
+static void gb_audio_send_data_fast_handler(unsigned int cport, void *data)
+{
+    struct gb_operation_hdr *hdr = data;
+    struct gb_audio_send_data_request *request = (void *)(hdr + 1);
+    struct gb_audio_dai_info *dai;
+    irqstate_t flags;
+
+    if (le16_to_cpu(hdr->size) < sizeof(*hdr) + sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return;
+    }
+
+    dai = gb_audio_find_dai(cport);
+    if (!dai) {
+        return;
+    }
+
+    flags = irqsave();
+
+    if (!(dai->flags & GB_AUDIO_FLAG_TX_ACTIVE) ||
+        (dai->flags & GB_AUDIO_FLAG_TX_STOPPING)) {
+        irqrestore(flags);
+        return;
+    }
+
+    if (le16_to_cpu(hdr->size) <
+        sizeof(*hdr) + sizeof(*request) + dai->tx_data_size) {
+        irqrestore(flags);
+        gb_error("dropping short message\n");
+        return;
+    }
+
+    if (!ring_buf_is_producers(dai->tx_rb)) {
+        dai->tx_overrun = true;
+    } else {
+#ifdef CONFIG_GREYBUS_AUDIO_JITTER_BUFFER
+        gb_audio_i2s_tx(dai, request->data, gb_audio_jb_arrival(dai));
+#else
+        gb_audio_i2s_tx(dai, request->data, 0);
+#endif
+    }
+
+    if (work_available(&dai->tx_work)) {
+        work_queue(HPWORK, &dai->tx_work, gb_audio_tx_worker, dai, 0);
+    }
+
+    irqrestore(flags);
+}
+#endif
 
 static struct gb_operation_handler gb_audio_data_handlers[] = {
     GB_HANDLER(GB_AUDIO_TYPE_PROTOCOL_VERSION,
                gb_audio_protocol_version_handler),
+#ifdef CONFIG_GREYBUS_AUDIO_LOW_LATENCY
+    GB_FAST_HANDLER(GB_AUDIO_TYPE_SEND_DATA,
+                    gb_audio_send_data_fast_handler),
+#else
     GB_HANDLER(GB_AUDIO_TYPE_SEND_DATA,
                gb_audio_send_data_handler),
+#endif
 };
 
 static struct gb_driver gb_audio_data_driver = {
     .op_handlers        = gb_audio_data_handlers,
     .op_handlers_count  = ARRAY_SIZE(gb_audio_data_handlers),
+    .dedicated_worker   = true,
+    .qos                = GB_QOS_REALTIME,
 };
 
 void gb_audio_data_register(int data_cport, int bundle)
@@ -182,4 +182,20 @@ struct gb_camera_meta_data_request {
     __u8    data[0];
 } __packed;
 
+/**
+ * Frame statistics at the beginning of the Meta Data block
+ */
+struct gb_camera_frame_stats {
+    /** Frames reported since the streams were configured */
+    __le32  sequence;
+    /** Frames dropped since the streams were configured */
+    __le32  dropped;
+    /** Start of frame in timesync frame time */
+    __le64  frame_time;
+    /** Exposure time in microseconds */
+    __le32  exposure;
+    /** Must be set to zero */
+    __le32  padding;
+} __packed;
+
 #endif /* _GREYBUS_CAMERA_GB_H_ */
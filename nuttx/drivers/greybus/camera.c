@@ -36,6 +36,7 @@
 #include <nuttx/device_camera.h>
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/greybus/debug.h>
+#include <nuttx/greybus/timesync.h>
 #include <apps/greybus-utils/utils.h>
 #include <arch/byteorder.h>
 
@@ -67,10 +68,26 @@ struct gb_camera_info {
     struct device   *dev;
     /** Camera operational model */
     uint8_t         state;
+    /** Frames reported since the streams were configured */
+    uint32_t        sequence;
+    /** Frames dropped since the streams were configured */
+    uint32_t        dropped;
+    /** Last CSI-2 frame number of each stream */
+    uint16_t        frame_number[MAX_STREAMS_NUM];
 };
 
 static struct gb_camera_info *info = NULL;
 
+/**
+ * @brief Reset the frame statistics sent with the meta-data
+ */
+static void gb_camera_reset_stats(void)
+{
+    info->sequence = 0;
+    info->dropped = 0;
+    memset(info->frame_number, 0, sizeof(info->frame_number));
+}
+
 /**
  * @brief Returns the major and minor Greybus Camera Protocol version number
  *
@@ -255,8 +272,10 @@ static uint8_t gb_camera_configure_streams(struct gb_operation *operation)
         info->state = STATE_UNCONFIGURED;
     else if (request->flags & CAMERA_CONF_STREAMS_TEST_ONLY)
         info->state = STATE_UNCONFIGURED;
-    else
+    else {
         info->state = STATE_CONFIGURED;
+        gb_camera_reset_stats();
+    }
 
     /* Create and fill the greybus response. */
     lldbg("Resp: \n");
@@ -372,6 +391,8 @@ static uint8_t gb_camera_capture(struct gb_operation *operation)
         goto err_free_mem;
     }
 
+    info->state = STATE_STREAMING;
+
     free(capt_req);
 
     lldbg("gb_camera_capture() - \n");
@@ -423,6 +444,73 @@ static uint8_t gb_camera_flush(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+/**
+ * @brief Send the meta-data of a captured frame to the AP
+ *
+ * Called by the camera driver for each frame. The frame statistics are sent
+ * ahead of the driver meta-data block in an unidirectional Meta Data request,
+ * so that the AP can pace the frames and detect drops without polling.
+ * Frame drops are counted from the driver reports and from the gaps in the
+ * CSI-2 frame numbers of each stream.
+ *
+ * @param dev Camera device
+ * @param frame Frame information filled by the camera driver
+ * @param arg Camera protocol private information
+ */
+static void gb_camera_frame_cb(struct device *dev,
+                               struct camera_frame_info *frame, void *arg)
+{
+    struct gb_camera_info *cam = arg;
+    struct gb_camera_meta_data_request *request;
+    struct gb_camera_frame_stats *stats;
+    struct gb_operation *operation;
+    uint16_t last;
+
+    if (cam->state != STATE_STREAMING || frame->stream >= MAX_STREAMS_NUM) {
+        return;
+    }
+
+    cam->dropped += frame->dropped;
+
+    /* Frame numbers wrap back to 1 at a sensor specific value */
+    last = cam->frame_number[frame->stream];
+    if (last && frame->frame_number > last) {
+        cam->dropped += frame->frame_number - last - 1;
+    }
+    cam->frame_number[frame->stream] = frame->frame_number;
+
+    cam->sequence++;
+
+    operation = gb_operation_create(cam->cport, GB_CAMERA_TYPE_METADATA,
+                                    sizeof(*request) + sizeof(*stats) +
+                                    frame->data_size);
+    if (!operation) {
+        return;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    request->request_id = cpu_to_le32(frame->request_id);
+    request->frame_number = cpu_to_le16(frame->frame_number);
+    request->stream = frame->stream;
+    request->padding = 0;
+
+    stats = (struct gb_camera_frame_stats *)request->data;
+    stats->sequence = cpu_to_le32(cam->sequence);
+    stats->dropped = cpu_to_le32(cam->dropped);
+    stats->frame_time = cpu_to_le64(frame->frame_time ? frame->frame_time :
+                                    timesync_get_frame_time());
+    stats->exposure = cpu_to_le32(frame->exposure);
+    stats->padding = 0;
+
+    if (frame->data_size) {
+        memcpy(stats + 1, frame->data, frame->data_size);
+    }
+
+    /* The AP detects lost meta-data from the sequence numbers */
+    gb_operation_send_request_nowait(operation, NULL, false);
+    gb_operation_destroy(operation);
+}
+
 /**
  * @brief Greybus Camera Protocol initialize function
  *
@@ -456,6 +544,12 @@ static int gb_camera_init(unsigned int cport, struct gb_bundle *bundle)
 
     info->state = STATE_UNCONFIGURED;
 
+    ret = device_camera_set_frame_callback(info->dev, gb_camera_frame_cb,
+                                           info);
+    if (ret && ret != -ENOSYS) {
+        gb_error("failed to set the frame callback: %d\n", ret);
+    }
+
     lldbg("gb_camera_init - \n");
 
     return 0;
@@ -479,6 +573,7 @@ static void gb_camera_exit(unsigned int cport, struct gb_bundle *bundle)
 {
     DEBUGASSERT(cport == info->cport);
 
+    device_camera_set_frame_callback(info->dev, NULL, NULL);
     device_close(info->dev);
 
     free(info);
@@ -55,6 +55,8 @@
 /* #define GB_CONTROL_TYPE_INTF_POWER_STATE_SET    0x0b */
 /* #define GB_CONTROL_TYPE_BUNDLE_POWER_STATE_SET  0x0c */
 #define GB_CONTROL_TYPE_TIMESYNC_GET_LAST_EVENT 0x0d
+/* Debug operation, outside of the range used by the Control protocol */
+#define GB_CONTROL_TYPE_CPORT_STATS             0x7e
 
 /* version request has no payload */
 struct gb_control_proto_version_response {
@@ -131,5 +133,30 @@ struct gb_control_timesync_get_last_event_response {
     __le64  frame_time;
 } __packed;
 
+/* Control protocol CPort stats request */
+struct gb_control_cport_stats_request {
+    __le16  first_cport_id;
+} __packed;
+
+struct gb_control_cport_stats {
+    __le16  cport_id;
+    __le16  pad;
+    __le32  requests_in;
+    __le32  requests_out;
+    __le32  responses_in;
+    __le32  responses_out;
+    __le32  bytes_in;
+    __le32  bytes_out;
+} __packed;
+
+/*
+ * Control protocol CPort stats response: counters since boot of the
+ * connected CPorts from first_cport_id on, as many as fit in the payload.
+ */
+struct gb_control_cport_stats_response {
+    __u8    nr_cports;
+    struct gb_control_cport_stats cports[0];
+} __packed;
+
 #endif /* __CONTROL_GB_H__ */
 
@@ -68,13 +68,7 @@ static uint8_t gb_control_get_manifest_size(struct gb_operation *operation)
 
 static uint8_t gb_control_get_manifest(struct gb_operation *operation)
 {
-    struct gb_control_get_manifest_response *response;
     struct greybus_manifest_header *mh;
-    int size = get_manifest_size();
-
-    response = gb_operation_alloc_response(operation, size);
-    if (!response)
-        return GB_OP_NO_MEMORY;
 
     mh = get_manifest_blob();
     if (!mh) {
@@ -82,7 +76,9 @@ static uint8_t gb_control_get_manifest(struct gb_operation *operation)
         return GB_OP_INVALID;
     }
 
-    memcpy(response->data, mh, size);
+    /* the manifest blob is constant, send it without copying it */
+    if (gb_operation_set_response_payload(operation, mh, get_manifest_size()))
+        return GB_OP_NO_MEMORY;
 
     return GB_OP_SUCCESS;
 }
@@ -328,6 +324,57 @@ static uint8_t gb_control_timesync_get_last_event(
     return gb_errno_to_op_result(retval);
 }
 
+#ifdef CONFIG_GREYBUS_STATS
+static uint8_t gb_control_cport_stats(struct gb_operation *operation)
+{
+    struct gb_control_cport_stats_request *request;
+    struct gb_control_cport_stats_response *response;
+    struct gb_control_cport_stats *rs;
+    struct gb_cport_stats stats;
+    unsigned int first, cport, count, max_count;
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    first = le16_to_cpu(request->first_cport_id);
+
+    max_count = (GB_MAX_PAYLOAD_SIZE - sizeof(*response)) / sizeof(*rs);
+    count = 0;
+    for (cport = first; cport < gb_cport_count() && count < max_count; cport++)
+        if (gb_cport_driver_name(cport))
+            count++;
+
+    response = gb_operation_alloc_response(operation, sizeof(*response) +
+                                           count * sizeof(*rs));
+    if (!response)
+        return GB_OP_NO_MEMORY;
+
+    rs = response->cports;
+    for (cport = first; rs < &response->cports[count]; cport++) {
+        if (!gb_cport_driver_name(cport))
+            continue;
+
+        memset(&stats, 0, sizeof(stats));
+        gb_cport_get_stats(cport, &stats);
+        rs->cport_id = cpu_to_le16(cport);
+        rs->pad = 0;
+        rs->requests_in = cpu_to_le32(stats.requests_in);
+        rs->requests_out = cpu_to_le32(stats.requests_out);
+        rs->responses_in = cpu_to_le32(stats.responses_in);
+        rs->responses_out = cpu_to_le32(stats.responses_out);
+        rs->bytes_in = cpu_to_le32(stats.bytes_in);
+        rs->bytes_out = cpu_to_le32(stats.bytes_out);
+        rs++;
+    }
+    response->nr_cports = count;
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
 static struct gb_operation_handler gb_control_handlers[] = {
     GB_HANDLER(GB_CONTROL_TYPE_PROTOCOL_VERSION, gb_control_protocol_version),
     GB_HANDLER(GB_CONTROL_TYPE_GET_MANIFEST_SIZE, gb_control_get_manifest_size),
@@ -342,6 +389,9 @@ static struct gb_operation_handler gb_control_handlers[] = {
     GB_HANDLER(GB_CONTROL_TYPE_TIMESYNC_DISABLE, gb_control_timesync_disable),
     GB_HANDLER(GB_CONTROL_TYPE_TIMESYNC_AUTHORITATIVE, gb_control_timesync_authoritative),
     GB_HANDLER(GB_CONTROL_TYPE_TIMESYNC_GET_LAST_EVENT, gb_control_timesync_get_last_event),
+#ifdef CONFIG_GREYBUS_STATS
+    GB_HANDLER(GB_CONTROL_TYPE_CPORT_STATS, gb_control_cport_stats),
+#endif
 };
 
 struct gb_driver control_driver = {
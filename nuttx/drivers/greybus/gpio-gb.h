@@ -45,6 +45,10 @@
 #define GB_GPIO_TYPE_IRQ_MASK           0x0c
 #define GB_GPIO_TYPE_IRQ_UNMASK         0x0d
 #define GB_GPIO_TYPE_IRQ_EVENT          0x0e
+#define GB_GPIO_TYPE_GET_VALUES         0x10
+#define GB_GPIO_TYPE_SET_VALUES         0x11
+#define GB_GPIO_TYPE_IRQ_BATCH          0x12
+#define GB_GPIO_TYPE_IRQ_EVENTS         0x13
 #define GB_GPIO_TYPE_RESPONSE           0x80    /* OR'd with rest */
 
 
@@ -139,5 +143,50 @@ struct gb_gpio_irq_event_request {
 } __packed;
 /* irq event has no response */
 
+struct gb_gpio_get_values_request {
+	__u8	count;
+	__u8	which[0];
+} __packed;
+struct gb_gpio_get_values_response {
+	__u8	value[0];
+} __packed;
+
+struct gb_gpio_line_value {
+	__u8	which;
+	__u8	value;
+} __packed;
+
+struct gb_gpio_set_values_request {
+	__u8	count;
+	struct gb_gpio_line_value lines[0];
+} __packed;
+/* set values response has no payload */
+
+/* a window_ms of 0 goes back to one irq event request per interrupt */
+struct gb_gpio_irq_batch_request {
+	__le16	window_ms;
+} __packed;
+/* irq batch response has no payload */
+
+/* offset_us is the time of the edge from frame_time */
+struct gb_gpio_irq_event_record {
+	__u8	which;
+	__u8	value;
+	__le16	padding;
+	__le32	offset_us;
+} __packed;
+
+#define GB_GPIO_IRQ_EVENTS_OVERFLOW     0x01
+
+/* irq events requests originate on another module and are handled on the AP */
+struct gb_gpio_irq_events_request {
+	__le64	frame_time;
+	__u8	flags;
+	__u8	count;
+	__le16	padding;
+	struct gb_gpio_irq_event_record events[0];
+} __packed;
+/* irq events has no response */
+
 #endif /* __GPIO_GB_H__ */
 
@@ -32,14 +32,42 @@
 #include <nuttx/greybus/debug.h>
 #include "gpio-gb.h"
 
+#include <string.h>
+
+#include <arch/irq.h>
 #include <arch/byteorder.h>
 #include <nuttx/gpio.h>
 
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+#include <nuttx/clock.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/greybus/timesync.h>
+#endif
+
 #define GB_GPIO_VERSION_MAJOR 0
 #define GB_GPIO_VERSION_MINOR 1
 
 static int g_gpio_cport;
 
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+#define GB_GPIO_MAX_LINES   256
+
+struct gb_gpio_irq_batch {
+    struct work_s work;
+    /* batch window in ticks, 0 when batching is off */
+    uint32_t window;
+    /* lines with a level trigger, which stay masked until the AP unmasks */
+    uint32_t level[GB_GPIO_MAX_LINES / 32];
+    uint8_t flags;
+    uint8_t count;
+    /* offset_us holds the hrt_getusec() time of the edge until sent */
+    struct gb_gpio_irq_event_record events[CONFIG_GREYBUS_GPIO_IRQ_BATCH_SIZE];
+};
+
+static struct gb_gpio_irq_batch g_gpio_batch;
+#endif
+
 static uint8_t gb_gpio_protocol_version(struct gb_operation *operation)
 {
     struct gb_gpio_proto_version_response *response;
@@ -253,11 +281,173 @@ static uint8_t gb_gpio_irq_unmask(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+static uint8_t gb_gpio_get_values(struct gb_operation *operation)
+{
+    struct gb_gpio_get_values_response *response;
+    struct gb_gpio_get_values_request *request =
+        gb_operation_get_request_payload(operation);
+    size_t size = gb_operation_get_request_payload_size(operation);
+    uint8_t line_count = gpio_line_count();
+    int i;
+
+    if (size < sizeof(*request) || size < sizeof(*request) + request->count) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    for (i = 0; i < request->count; i++) {
+        if (request->which[i] >= line_count)
+            return GB_OP_INVALID;
+    }
+
+    response = gb_operation_alloc_response(operation, request->count);
+    if (!response)
+        return GB_OP_NO_MEMORY;
+
+    for (i = 0; i < request->count; i++)
+        response->value[i] = gpio_get_value(request->which[i]);
+
+    return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_gpio_set_values(struct gb_operation *operation)
+{
+    struct gb_gpio_set_values_request *request =
+        gb_operation_get_request_payload(operation);
+    size_t size = gb_operation_get_request_payload_size(operation);
+    uint8_t line_count = gpio_line_count();
+    int i;
+
+    if (size < sizeof(*request) ||
+        size < sizeof(*request) + request->count * sizeof(request->lines[0])) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    /* check every line first, so that an invalid request changes none */
+    for (i = 0; i < request->count; i++) {
+        if (request->lines[i].which >= line_count)
+            return GB_OP_INVALID;
+    }
+
+    for (i = 0; i < request->count; i++)
+        gpio_set_value(request->lines[i].which, request->lines[i].value);
+
+    return GB_OP_SUCCESS;
+}
+
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+/*
+ * Send the edges collected since the last batch. The edges coming in while
+ * the request is allocated go in this batch, the later ones in the next.
+ */
+static void gb_gpio_irq_batch_worker(void *arg)
+{
+    struct gb_gpio_irq_events_request *request;
+    struct gb_operation *operation;
+    irqstate_t flags;
+    uint32_t now;
+    int i;
+
+    operation = gb_operation_create(g_gpio_cport, GB_GPIO_TYPE_IRQ_EVENTS,
+                                    sizeof(*request) +
+                                    sizeof(g_gpio_batch.events));
+
+    flags = irqsave();
+    if (!operation) {
+        /* the AP reads the values of the lines when it sees the overflow */
+        g_gpio_batch.flags |= GB_GPIO_IRQ_EVENTS_OVERFLOW;
+        g_gpio_batch.count = 0;
+        irqrestore(flags);
+        return;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    request->frame_time = cpu_to_le64(timesync_get_frame_time());
+    now = hrt_getusec();
+    request->flags = g_gpio_batch.flags;
+    request->count = g_gpio_batch.count;
+    memcpy(request->events, g_gpio_batch.events,
+           g_gpio_batch.count * sizeof(request->events[0]));
+    g_gpio_batch.flags = 0;
+    g_gpio_batch.count = 0;
+    irqrestore(flags);
+
+    request->padding = 0;
+    for (i = 0; i < request->count; i++) {
+        request->events[i].offset_us =
+            cpu_to_le32(now - request->events[i].offset_us);
+    }
+
+    gb_operation_set_request_payload_size(operation, sizeof(*request) +
+                                          request->count *
+                                          sizeof(request->events[0]));
+
+    /* Send unidirectional operation. */
+    gb_operation_send_request_nowait(operation, NULL, false);
+
+    gb_operation_destroy(operation);
+}
+
+static void gb_gpio_irq_record(int irq)
+{
+    struct gb_gpio_irq_event_record *event;
+    irqstate_t flags;
+
+    /* Host is responsible for unmasking. */
+    if (g_gpio_batch.level[irq / 32] & (1 << (irq % 32)))
+        gpio_irq_mask(irq);
+
+    flags = irqsave();
+    if (g_gpio_batch.count < CONFIG_GREYBUS_GPIO_IRQ_BATCH_SIZE) {
+        event = &g_gpio_batch.events[g_gpio_batch.count++];
+        event->which = irq;
+        event->value = gpio_get_value(irq);
+        event->padding = 0;
+        event->offset_us = hrt_getusec();
+    } else {
+        g_gpio_batch.flags |= GB_GPIO_IRQ_EVENTS_OVERFLOW;
+    }
+
+    /* the first edge of a batch opens its window */
+    if (work_available(&g_gpio_batch.work)) {
+        work_queue(HPWORK, &g_gpio_batch.work, gb_gpio_irq_batch_worker,
+                   NULL, g_gpio_batch.window);
+    }
+    irqrestore(flags);
+}
+
+static uint8_t gb_gpio_irq_batch(struct gb_operation *operation)
+{
+    struct gb_gpio_irq_batch_request *request =
+        gb_operation_get_request_payload(operation);
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    /* a pending batch is still sent at the end of its window */
+    g_gpio_batch.window = MSEC2TICK(le16_to_cpu(request->window_ms));
+    if (request->window_ms && !g_gpio_batch.window)
+        g_gpio_batch.window = 1;
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
 int gb_gpio_irq_event(int irq, void *context, void *priv)
 {
     struct gb_gpio_irq_event_request *request;
     struct gb_operation *operation;
 
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+    if (g_gpio_batch.window) {
+        gb_gpio_irq_record(irq);
+        return OK;
+    }
+#endif
+
     operation = gb_operation_create(g_gpio_cport, GB_GPIO_TYPE_IRQ_EVENT,
                                     sizeof(*request));
     if (!operation)
@@ -314,6 +504,13 @@ static uint8_t gb_gpio_irq_type(struct gb_operation *operation)
     ret = gpio_irq_settriggering(request->which, trigger);
     if (ret)
         return GB_OP_INVALID;
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+    if (trigger == IRQ_TYPE_LEVEL_HIGH || trigger == IRQ_TYPE_LEVEL_LOW)
+        g_gpio_batch.level[request->which / 32] |= 1 << (request->which % 32);
+    else
+        g_gpio_batch.level[request->which / 32] &=
+            ~(1 << (request->which % 32));
+#endif
     ret = gpio_irq_attach(request->which, gb_gpio_irq_event, NULL);
     if (ret)
         return GB_OP_UNKNOWN_ERROR;
@@ -335,11 +532,17 @@ static struct gb_operation_handler gb_gpio_handlers[] = {
     GB_HANDLER(GB_GPIO_TYPE_IRQ_TYPE, gb_gpio_irq_type),
     GB_HANDLER(GB_GPIO_TYPE_IRQ_MASK, gb_gpio_irq_mask),
     GB_HANDLER(GB_GPIO_TYPE_IRQ_UNMASK, gb_gpio_irq_unmask),
+    GB_HANDLER(GB_GPIO_TYPE_GET_VALUES, gb_gpio_get_values),
+    GB_HANDLER(GB_GPIO_TYPE_SET_VALUES, gb_gpio_set_values),
+#ifdef CONFIG_GREYBUS_GPIO_IRQ_BATCH
+    GB_HANDLER(GB_GPIO_TYPE_IRQ_BATCH, gb_gpio_irq_batch),
+#endif
 };
 
 struct gb_driver gpio_driver = {
     .op_handlers = (struct gb_operation_handler*) gb_gpio_handlers,
     .op_handlers_count = ARRAY_SIZE(gb_gpio_handlers),
+    .batch_responses = true,
 };
 
 void gb_gpio_register(int cport, int bundle)
@@ -29,12 +29,18 @@
  */
 
 #include <nuttx/config.h>
+#include <nuttx/boot_timing.h>
 #include <nuttx/list.h>
+#include <nuttx/util.h>
 #include <nuttx/unipro/unipro.h>
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/greybus/tape.h>
 #include <nuttx/greybus/debug.h>
 #include <nuttx/wdog.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/mm/mempool.h>
+#include <nuttx/sched_trace.h>
+#include <nuttx/tpool.h>
 #include <loopback-gb.h>
 
 #include <apps/greybus-utils/manifest.h>
@@ -42,42 +48,170 @@
 #include <arch/atomic.h>
 #include <arch/byteorder.h>
 
+#include <sys/time.h>
+
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <sched.h>
+#include <unistd.h>
 
 #define DEFAULT_STACK_SIZE      2048
 #define TIMEOUT_IN_MS           1000
 #define GB_PING_TYPE            0x00
+#define GB_CREDIT_TYPE          0x7e
 
 #define ONE_SEC_IN_MSEC         1000
 #define ONE_MSEC_IN_NSEC        1000000
 
 #define TIMEOUT_WD_DELAY    (TIMEOUT_IN_MS * CLOCKS_PER_SEC) / ONE_SEC_IN_MSEC
 
+/* An operation timing out a little late is harmless: let its watchdog share
+ * the wakeup of a nearby one.
+ */
+#define TIMEOUT_WD_SLACK    (TIMEOUT_WD_DELAY / 10)
+
+#if CONFIG_GREYBUS_RX_RING_SIZE > 0
+#define GB_RX_RING_MASK         (CONFIG_GREYBUS_RX_RING_SIZE - 1)
+
+#if (CONFIG_GREYBUS_RX_RING_SIZE & GB_RX_RING_MASK) != 0
+#error "CONFIG_GREYBUS_RX_RING_SIZE must be a power of two"
+#endif
+#endif
+
+/*
+ * Requests that can't be processed in place are copied out of the UniPro RX
+ * buffer by the DMA, the buffer being released when the copy is done.
+ */
+#if defined(CONFIG_UNIPRO_ZERO_COPY) && defined(CONFIG_ARCH_DMA_MEMCPY)
+#define GB_RX_DMA_COPY
+#endif
+
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+/* payload of the GB_CREDIT_TYPE messages, sent without response */
+struct gb_credit_request {
+    __le16 credits;             /* messages the peer may send in addition */
+    __u8 pad[2];
+};
+#endif
+
+/* Only prevents the compiler from reordering memory accesses across it */
+#define gb_compiler_barrier()   __asm__ __volatile__("" ::: "memory")
+
 struct gb_cport_driver {
     struct gb_driver *driver;
+    bool started;               /* driver initialized and worker running */
     struct list_head tx_fifo;
-    struct list_head rx_fifo;
+#if CONFIG_GREYBUS_RX_RING_SIZE > 0
+    struct gb_operation *rx_ring[CONFIG_GREYBUS_RX_RING_SIZE];
+    volatile unsigned int rx_ring_head; /* only written by the producers */
+    volatile unsigned int rx_ring_tail; /* only written by the worker */
+#endif
+    struct list_head rx_fifo;   /* messages that did not fit in rx_ring */
+#ifdef GB_RX_DMA_COPY
+    unsigned int rx_copies;     /* requests being copied by the DMA */
+#endif
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    struct gb_operation *rx_frag_op;    /* large message being received */
+    size_t rx_frag_offset;              /* bytes of it received so far */
+    size_t rx_frag_left;                /* bytes of it still expected */
+#endif
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+    sem_t tx_credits;                   /* credits granted by the peer */
+    unsigned int rx_credits_owed;       /* processed, not granted back */
+#endif
     sem_t rx_fifo_lock;
+    volatile bool worker_asleep;
+    volatile bool timedout_queued;
     pthread_t thread;
     volatile bool exit_worker;
     struct wdog_s timeout_wd;
     struct gb_operation timedout_operation;
+    struct list_head tx_batch;
+    unsigned int tx_batch_count;
+    size_t tx_queue_limit;      /* 0 when the TX queue is unlimited */
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+    bool shared;                /* serviced by the shared workers */
+    bool scheduled;             /* queued in or serviced by shared workers */
+    struct list_head ready_node;
+    sem_t drain_sem;
+#endif
+#ifdef CONFIG_GREYBUS_STATS
+    struct gb_cport_stats stats;
+#endif
+};
+
+#define GB_TAPE_MAGIC           0x45504154 /* "TAPE" */
+#define GB_TAPE_VERSION         2
+#define GB_TAPE_RECORD_TX       (1 << 0)
+
+#if (CONFIG_GREYBUS_TAPE_RING_SIZE & (CONFIG_GREYBUS_TAPE_RING_SIZE - 1)) != 0
+#error "CONFIG_GREYBUS_TAPE_RING_SIZE must be a power of two"
+#endif
+
+struct gb_tape_file_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
 };
 
 struct gb_tape_record_header {
     uint16_t size;
     uint16_t cport;
+    uint16_t flags;
+    uint16_t reserved;
+    uint32_t timestamp;     /* in us, since the start of the recording */
+};
+
+/*
+ * Messages are recorded into a RAM ring from the RX and TX paths, and the
+ * ring is drained to the tape mechanism by a low priority thread. Producers
+ * are serialized by disabling the interrupts while the drain thread only
+ * moves the tail, so it never blocks them. The indexes are free running and
+ * wrap naturally since the ring size is a power of two.
+ */
+struct gb_tape_ring {
+    char *buffer;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t drops;
+    volatile bool recording;
+    volatile bool exit;
+    sem_t sem;
+    pthread_t thread;
+    struct timespec start;
 };
 
+/*
+ * While a tape is replayed, the messages queued to the CPort workers are
+ * counted so that the replay can wait for all of them to be processed.
+ */
+struct gb_tape_replay {
+    volatile bool active;
+    uint32_t queued;
+    uint32_t processed;
+    bool draining;
+    sem_t drained;
+    struct gb_tape_replay_stats *stats;
+};
+
+/*
+ * Operations waiting for a response are linked in their CPort tx_fifo, which
+ * is ordered by deadline since all of them share the same timeout, and in an
+ * id-indexed hash table used to match the responses.
+ */
+#define GB_INFLIGHT_HASH(id)    ((id) % CONFIG_GREYBUS_INFLIGHT_HASH_SIZE)
+
 static unsigned int cport_count;
 static atomic_t request_id;
-static struct gb_cport_driver *g_cport;
+static struct list_head g_inflight[CONFIG_GREYBUS_INFLIGHT_HASH_SIZE];
+static struct gb_cport_driver *g_cport hot_data;
 static struct gb_bundle **g_bundle;
 static struct gb_transport_backend *transport_backend;
 static struct gb_tape_mechanism *gb_tape;
 static int gb_tape_fd = -EBADFD;
+static struct gb_tape_ring g_tape_ring;
+static struct gb_tape_replay g_tape_replay;
 static struct gb_operation_hdr timedout_hdr = {
     .size = sizeof(timedout_hdr),
     .result = GB_OP_TIMEOUT,
@@ -89,8 +223,272 @@ static struct gb_operation_hdr oom_hdr = {
     .type = GB_TYPE_RESPONSE_FLAG,
 };
 
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+static struct {
+    pthread_t thread[CONFIG_GREYBUS_SHARED_WORKER_COUNT];
+    struct list_head ready_list[GB_QOS_CLASS_COUNT];
+    sem_t ready_sem;
+    volatile bool exit;
+} g_shared_workers;
+#endif
+
+static const int gb_qos_priority[GB_QOS_CLASS_COUNT] = {
+    [GB_QOS_BULK] = CONFIG_GREYBUS_QOS_BULK_PRIORITY,
+    [GB_QOS_INTERACTIVE] = CONFIG_GREYBUS_QOS_INTERACTIVE_PRIORITY,
+    [GB_QOS_REALTIME] = CONFIG_GREYBUS_QOS_REALTIME_PRIORITY,
+};
+
+#ifdef CONFIG_GREYBUS_STATS
+#define gb_stats_inc(cport, field)  (g_cport[cport].stats.field++)
+#define gb_stats_add(cport, field, n) (g_cport[cport].stats.field += (n))
+#else
+#define gb_stats_inc(cport, field)  do { } while (0)
+#define gb_stats_add(cport, field, n) do { } while (0)
+#endif
+
 static void gb_operation_timeout(int argc, uint32_t cport, ...);
 static struct gb_operation *_gb_operation_create(unsigned int cport);
+static int _gb_operation_send_response(struct gb_operation *operation,
+                                       uint8_t result, bool may_batch);
+
+#ifdef CONFIG_GREYBUS_OPERATION_POOL
+/*
+ * When the pool is empty, a new operation is allocated from the heap. It is
+ * given to the pool when released, growing the pool.
+ */
+static struct mempool g_op_pool;
+
+static struct gb_operation *gb_operation_pool_get(void)
+{
+    return mempool_alloc(&g_op_pool);
+}
+
+static void gb_operation_pool_put(struct gb_operation *operation)
+{
+    mempool_free(&g_op_pool, operation);
+}
+
+static int gb_operation_pool_init(void)
+{
+    return mempool_init(&g_op_pool, NULL, sizeof(struct gb_operation),
+                        CONFIG_GREYBUS_OPERATION_POOL_SIZE, MEMPOOL_GROW);
+}
+
+static void gb_operation_pool_deinit(void)
+{
+    mempool_deinit(&g_op_pool);
+}
+
+int gb_operation_pool_get_stats(struct gb_operation_pool_stats *stats)
+{
+    struct mempool_stats pool_stats;
+
+    if (!stats)
+        return -EINVAL;
+
+    mempool_get_stats(&g_op_pool, &pool_stats);
+    stats->size = pool_stats.size;
+    stats->free = pool_stats.free;
+    stats->hits = pool_stats.hits;
+    stats->misses = pool_stats.misses;
+
+    return 0;
+}
+#else
+static struct gb_operation *gb_operation_pool_get(void)
+{
+    return malloc(sizeof(struct gb_operation));
+}
+
+static void gb_operation_pool_put(struct gb_operation *operation)
+{
+    free(operation);
+}
+
+static int gb_operation_pool_init(void)
+{
+    return 0;
+}
+
+static void gb_operation_pool_deinit(void)
+{
+}
+#endif
+
+#ifdef CONFIG_GREYBUS_STATS
+/**
+ * @note This function should be called from an atomic context
+ */
+static void gb_stats_rx_fifo_push(unsigned int cport)
+{
+    struct gb_cport_stats *stats = &g_cport[cport].stats;
+
+    if (++stats->rx_fifo_depth > stats->rx_fifo_hwm)
+        stats->rx_fifo_hwm = stats->rx_fifo_depth;
+}
+
+static void gb_stats_rx_fifo_pop(unsigned int cport)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    g_cport[cport].stats.rx_fifo_depth--;
+    irqrestore(flags);
+}
+
+static unsigned int gb_stats_latency_bucket(uint32_t usec)
+{
+    unsigned int bucket = 0;
+
+    while (usec && bucket < GB_STATS_LATENCY_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void gb_stats_latency(unsigned int cport, uint32_t usec)
+{
+    g_cport[cport].stats.latency[gb_stats_latency_bucket(usec)]++;
+}
+
+unsigned int gb_cport_count(void)
+{
+    return cport_count;
+}
+
+const char *gb_cport_driver_name(unsigned int cport)
+{
+    if (cport >= cport_count || !g_cport[cport].driver)
+        return NULL;
+
+    return gb_driver_name(g_cport[cport].driver);
+}
+
+int gb_cport_get_stats(unsigned int cport, struct gb_cport_stats *stats)
+{
+    irqstate_t flags;
+
+    if (cport >= cport_count || !stats)
+        return -EINVAL;
+
+    flags = irqsave();
+    memcpy(stats, &g_cport[cport].stats, sizeof(*stats));
+    irqrestore(flags);
+
+    return 0;
+}
+
+int gb_cport_reset_stats(unsigned int cport)
+{
+    irqstate_t flags;
+    uint32_t depth;
+
+    if (cport >= cport_count)
+        return -EINVAL;
+
+    flags = irqsave();
+    depth = g_cport[cport].stats.rx_fifo_depth;
+    memset(&g_cport[cport].stats, 0, sizeof(g_cport[cport].stats));
+    g_cport[cport].stats.rx_fifo_depth = depth;
+    g_cport[cport].stats.rx_fifo_hwm = depth;
+    irqrestore(flags);
+
+    return 0;
+}
+#else
+static void gb_stats_rx_fifo_push(unsigned int cport) { }
+static void gb_stats_rx_fifo_pop(unsigned int cport) { }
+static void gb_stats_latency(unsigned int cport, uint32_t usec) { }
+#endif
+
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+static void gb_handler_stats_update(struct gb_operation_handler *handler,
+                                    uint32_t usec)
+{
+    struct gb_handler_stats *stats = &handler->stats;
+    irqstate_t flags;
+
+    flags = irqsave();
+
+    if (!stats->count || usec < stats->min)
+        stats->min = usec;
+    if (usec > stats->max)
+        stats->max = usec;
+    stats->count++;
+    stats->total += usec;
+    stats->latency[gb_stats_latency_bucket(usec)]++;
+
+    irqrestore(flags);
+}
+
+/**
+ * Get the runtime statistics of a request handler
+ *
+ * @param cport CPort of the driver owning the handler
+ * @param index index of the handler in the driver handler table
+ * @param type where to store the operation type of the handler
+ * @param name where to store the name of the handler
+ * @param stats where to copy the handler statistics
+ * @return 0 on success, -ENOENT if index is past the end of the table and
+ *         -EINVAL if the CPort has no driver
+ */
+int gb_cport_get_handler_stats(unsigned int cport, unsigned int index,
+                               uint8_t *type, const char **name,
+                               struct gb_handler_stats *stats)
+{
+    struct gb_operation_handler *handler;
+    struct gb_driver *driver;
+    irqstate_t flags;
+
+    if (cport >= cport_count || !g_cport[cport].driver)
+        return -EINVAL;
+
+    driver = g_cport[cport].driver;
+    if (!driver->op_handlers || index >= driver->op_handlers_count)
+        return -ENOENT;
+
+    handler = &driver->op_handlers[index];
+
+    if (type)
+        *type = handler->type;
+    if (name)
+        *name = gb_handler_name(handler);
+
+    if (stats) {
+        flags = irqsave();
+        memcpy(stats, &handler->stats, sizeof(*stats));
+        irqrestore(flags);
+    }
+
+    return 0;
+}
+
+void gb_reset_handler_stats(void)
+{
+    struct gb_driver *driver;
+    irqstate_t flags;
+    unsigned int cport;
+    int i;
+
+    for (cport = 0; cport < cport_count; cport++) {
+        driver = g_cport[cport].driver;
+        if (!driver || !driver->op_handlers)
+            continue;
+
+        flags = irqsave();
+        for (i = 0; i < driver->op_handlers_count; i++) {
+            memset(&driver->op_handlers[i].stats, 0,
+                   sizeof(driver->op_handlers[i].stats));
+        }
+        irqrestore(flags);
+    }
+}
+#else
+static void gb_handler_stats_update(struct gb_operation_handler *handler,
+                                    uint32_t usec) { }
+#endif
 
 uint8_t gb_errno_to_op_result(int err)
 {
@@ -139,6 +537,93 @@ uint8_t gb_errno_to_op_result(int err)
     }
 }
 
+static void gb_tape_ring_put(const void *data, size_t size)
+{
+    struct gb_tape_ring *ring = &g_tape_ring;
+    uint32_t offset = ring->head & (CONFIG_GREYBUS_TAPE_RING_SIZE - 1);
+    size_t chunk = MIN(size, CONFIG_GREYBUS_TAPE_RING_SIZE - offset);
+
+    memcpy(ring->buffer + offset, data, chunk);
+    memcpy(ring->buffer, (const char *) data + chunk, size - chunk);
+    ring->head += size;
+}
+
+/**
+ * Record a message in the tape ring
+ *
+ * The message is dropped if the ring does not have enough room for it.
+ */
+static void gb_tape_record(unsigned int cport, const void *data, size_t size,
+                           uint16_t flags)
+{
+    struct gb_tape_ring *ring = &g_tape_ring;
+    struct gb_tape_record_header record_hdr;
+    struct timespec now;
+    irqstate_t irq_flags;
+    int semcount;
+
+    if (!ring->recording)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    record_hdr.size = size;
+    record_hdr.cport = cport;
+    record_hdr.flags = flags;
+    record_hdr.reserved = 0;
+    record_hdr.timestamp = (now.tv_sec - ring->start.tv_sec) * 1000000 +
+                           (now.tv_nsec - ring->start.tv_nsec) / 1000;
+
+    irq_flags = irqsave();
+
+    if (!ring->recording) {
+        irqrestore(irq_flags);
+        return;
+    }
+
+    if (CONFIG_GREYBUS_TAPE_RING_SIZE - (ring->head - ring->tail) <
+        sizeof(record_hdr) + size) {
+        ring->drops++;
+        irqrestore(irq_flags);
+        return;
+    }
+
+    gb_tape_ring_put(&record_hdr, sizeof(record_hdr));
+    gb_tape_ring_put(data, size);
+
+    if (!sem_getvalue(&ring->sem, &semcount) && semcount <= 0)
+        sem_post(&ring->sem);
+
+    irqrestore(irq_flags);
+}
+
+static void *gb_tape_drain_worker(void *data)
+{
+    struct gb_tape_ring *ring = &g_tape_ring;
+    uint32_t head;
+    uint32_t offset;
+    size_t chunk;
+
+    while (1) {
+        while (sem_wait(&ring->sem) < 0 && errno == EINTR);
+
+        head = ring->head;
+        while (ring->tail != head) {
+            offset = ring->tail & (CONFIG_GREYBUS_TAPE_RING_SIZE - 1);
+            chunk = MIN(head - ring->tail,
+                        CONFIG_GREYBUS_TAPE_RING_SIZE - offset);
+
+            gb_tape->write(gb_tape_fd, ring->buffer + offset, chunk);
+            ring->tail += chunk;
+        }
+
+        if (ring->exit && ring->tail == ring->head)
+            break;
+    }
+
+    return NULL;
+}
+
 #ifdef CONFIG_GREYBUS_FEATURE_HAVE_TIMESTAMPS
 static void op_mark_send_time(struct gb_operation *operation)
 {
@@ -154,52 +639,186 @@ static void op_mark_send_time(struct gb_operation *operation) { }
 static void op_mark_recv_time(struct gb_operation *operation) { }
 #endif
 
-static int gb_compare_handlers(const void *data1, const void *data2)
+/**
+ * @note This function should be called from an atomic context
+ */
+static void gb_tape_replay_queued(void)
 {
-    const struct gb_operation_handler *handler1 = data1;
-    const struct gb_operation_handler *handler2 = data2;
-    return (int)handler1->type - (int)handler2->type;
+    if (g_tape_replay.active)
+        g_tape_replay.queued++;
 }
 
-static struct gb_operation_handler *find_operation_handler(uint8_t type,
-                                                           unsigned int cport)
+static void gb_tape_replay_processed(void)
 {
-    struct gb_driver *driver = g_cport[cport].driver;
-    int l,r;
+    irqstate_t flags;
 
-    if (type == GB_INVALID_TYPE || !driver->op_handlers) {
-        return NULL;
-    }
+    if (!g_tape_replay.active)
+        return;
 
-    /*
-     * This function is performance sensitive, so let's use an inline binary
-     * search algorithm. The libc version takes pointer to the comparison
-     * function as argument which is then called via full-blown function
-     * calls. The below version doesn't require calling any other function.
-     */
-    l = 0;
-    r = driver->op_handlers_count - 1;
-    while (l <= r) {
-        int m = (l + r) / 2;
-        if (driver->op_handlers[m].type < type)
-            l = m + 1;
-        else if (driver->op_handlers[m].type > type)
-            r = m - 1;
-        else
-            return &driver->op_handlers[m];
+    flags = irqsave();
+    if (++g_tape_replay.processed == g_tape_replay.queued &&
+        g_tape_replay.draining) {
+        g_tape_replay.draining = false;
+        sem_post(&g_tape_replay.drained);
     }
-
-    return NULL;
+    irqrestore(flags);
+}
+
+#ifdef CONFIG_GREYBUS_FEATURE_HAVE_TIMESTAMPS
+/**
+ * Account the time a replayed request took from its reception to its response
+ */
+static void gb_tape_replay_response(struct gb_operation *operation)
+{
+    struct gb_tape_replay_stats *stats = g_tape_replay.stats;
+    struct timespec elapsed;
+    uint32_t usec;
+
+    if (!g_tape_replay.active || !stats)
+        return;
+
+    timespecsub(&operation->send_ts, &operation->recv_ts, &elapsed);
+    usec = elapsed.tv_sec * 1000000 + elapsed.tv_nsec / 1000;
+
+    if (!stats->responses || usec < stats->latency_min)
+        stats->latency_min = usec;
+    if (usec > stats->latency_max)
+        stats->latency_max = usec;
+    stats->latency_total += usec;
+    stats->responses++;
+}
+#else
+static void gb_tape_replay_response(struct gb_operation *operation) { }
+#endif
+
+static int gb_compare_handlers(const void *data1, const void *data2)
+{
+    const struct gb_operation_handler *handler1 = data1;
+    const struct gb_operation_handler *handler2 = data2;
+    return (int)handler1->type - (int)handler2->type;
+}
+
+#ifdef CONFIG_GREYBUS_DIRECT_DISPATCH
+/**
+ * Build the table giving the handler of each request type of a driver
+ *
+ * Drivers are statically allocated and keep the same handlers across
+ * registrations, so the table is built once and never freed.
+ */
+static int gb_build_dispatch_table(struct gb_driver *driver)
+{
+    int i;
+
+    if (driver->dispatch || !driver->op_handlers_count)
+        return 0;
+
+    if (driver->op_handlers_count > UINT8_MAX)
+        return -E2BIG;
+
+    driver->dispatch = zalloc(GB_REQUEST_TYPE_COUNT);
+    if (!driver->dispatch)
+        return -ENOMEM;
+
+    for (i = 0; i < driver->op_handlers_count; i++)
+        driver->dispatch[driver->op_handlers[i].type] = i + 1;
+
+    return 0;
+}
+
+static struct gb_operation_handler *find_operation_handler(uint8_t type,
+                                                           unsigned int cport)
+{
+    struct gb_driver *driver = g_cport[cport].driver;
+    uint8_t index;
+
+    if (type >= GB_REQUEST_TYPE_COUNT || !driver->dispatch)
+        return NULL;
+
+    index = driver->dispatch[type];
+    return index ? &driver->op_handlers[index - 1] : NULL;
+}
+#else
+static int gb_build_dispatch_table(struct gb_driver *driver)
+{
+    return 0;
+}
+
+static struct gb_operation_handler *find_operation_handler(uint8_t type,
+                                                           unsigned int cport)
+{
+    struct gb_driver *driver = g_cport[cport].driver;
+    int l,r;
+
+    if (type == GB_INVALID_TYPE || !driver->op_handlers) {
+        return NULL;
+    }
+
+    /*
+     * This function is performance sensitive, so let's use an inline binary
+     * search algorithm. The libc version takes pointer to the comparison
+     * function as argument which is then called via full-blown function
+     * calls. The below version doesn't require calling any other function.
+     */
+    l = 0;
+    r = driver->op_handlers_count - 1;
+    while (l <= r) {
+        int m = (l + r) / 2;
+        if (driver->op_handlers[m].type < type)
+            l = m + 1;
+        else if (driver->op_handlers[m].type > type)
+            r = m - 1;
+        else
+            return &driver->op_handlers[m];
+    }
+
+    return NULL;
+}
+#endif
+
+/**
+ * Sort the handlers of a driver by type and check that they can be dispatched
+ */
+static int gb_check_handlers(struct gb_driver *driver)
+{
+    int i;
+
+    if (!driver->op_handlers)
+        return 0;
+
+    qsort(driver->op_handlers, driver->op_handlers_count,
+          sizeof(*driver->op_handlers), gb_compare_handlers);
+
+    for (i = 0; i < driver->op_handlers_count; i++) {
+        if (driver->op_handlers[i].type >= GB_INVALID_TYPE) {
+            gb_error("%s: invalid handler type 0x%02x\n",
+                     gb_driver_name(driver), driver->op_handlers[i].type);
+            return -EINVAL;
+        }
+
+        if (i && driver->op_handlers[i].type ==
+                 driver->op_handlers[i - 1].type) {
+            gb_error("%s: duplicate handler for type 0x%02x\n",
+                     gb_driver_name(driver), driver->op_handlers[i].type);
+            return -EINVAL;
+        }
+    }
+
+    return gb_build_dispatch_table(driver);
 }
 
 static void gb_process_request(struct gb_operation_hdr *hdr,
                                struct gb_operation *operation)
 {
     struct gb_operation_handler *op_handler;
+    uint32_t start;
+    uint32_t elapsed;
     uint8_t result;
 
+    gb_stats_inc(operation->cport, requests_in);
+    gb_stats_add(operation->cport, bytes_in, le16_to_cpu(hdr->size));
+
     if (hdr->type == GB_PING_TYPE) {
-        gb_operation_send_response(operation, GB_OP_SUCCESS);
+        _gb_operation_send_response(operation, GB_OP_SUCCESS, true);
         return;
     }
 
@@ -207,18 +826,28 @@ static void gb_process_request(struct gb_operation_hdr *hdr,
     if (!op_handler) {
         gb_error("Cport %u: Invalid operation type %u\n",
                  operation->cport, hdr->type);
-        gb_operation_send_response(operation, GB_OP_INVALID);
+        _gb_operation_send_response(operation, GB_OP_INVALID, true);
         return;
     }
 
     operation->bundle = g_cport[operation->cport].driver->bundle;
 
+    sched_trace(SCHED_TRACE_GB_DISPATCH, operation->cport,
+                SCHED_TRACE_GB_OP(le16_to_cpu(hdr->id), hdr->type, 0));
+
+    start = hrt_getusec();
     result = op_handler->handler(operation);
+    elapsed = hrt_getusec() - start;
+    gb_stats_latency(operation->cport, elapsed);
+    gb_handler_stats_update(op_handler, elapsed);
     gb_debug("%s: %u\n", gb_handler_name(op_handler), result);
 
     if (hdr->id)
-        gb_operation_send_response(operation, result);
+        _gb_operation_send_response(operation, result, true);
     op_mark_send_time(operation);
+
+    if (hdr->id)
+        gb_tape_replay_response(operation);
 }
 
 static bool gb_operation_has_timedout(struct gb_operation *operation)
@@ -232,181 +861,980 @@ static bool gb_operation_has_timedout(struct gb_operation *operation)
                           (TIMEOUT_IN_MS % ONE_SEC_IN_MSEC) * ONE_MSEC_IN_NSEC;
     clock_gettime(CLOCK_MONOTONIC, &current_time);
 
-    if (current_time.tv_sec > timeout_time.tv_sec)
-        return true;
+    if (current_time.tv_sec > timeout_time.tv_sec)
+        return true;
+
+    if (current_time.tv_sec < timeout_time.tv_sec)
+        return false;
+
+    return current_time.tv_nsec > timeout_time.tv_nsec;
+}
+
+/**
+ * Get the number of ticks before the operation times out
+ */
+static int gb_operation_timeout_delay(struct gb_operation *operation)
+{
+    struct timespec current_time;
+    int elapsed_ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+    elapsed_ms = (current_time.tv_sec - operation->time.tv_sec) *
+                 ONE_SEC_IN_MSEC +
+                 (current_time.tv_nsec - operation->time.tv_nsec) /
+                 ONE_MSEC_IN_NSEC;
+    if (elapsed_ms >= TIMEOUT_IN_MS)
+        return 1;
+
+    /* round up to never fire before the deadline */
+    return ((TIMEOUT_IN_MS - elapsed_ms) * CLOCKS_PER_SEC) / ONE_SEC_IN_MSEC
+           + 1;
+}
+
+/**
+ * Update watchdog state
+ *
+ * Cancel cport watchdog if there is no outgoing message waiting for a response,
+ * or program the watchdog to fire at the deadline of the oldest outgoing
+ * message.
+ *
+ * @note This function should be called from an atomic context
+ */
+static void gb_watchdog_update(unsigned int cport)
+{
+    struct gb_operation *op;
+    irqstate_t flags;
+
+    flags = irqsave();
+
+    if (list_is_empty(&g_cport[cport].tx_fifo)) {
+        wd_cancel(&g_cport[cport].timeout_wd);
+    } else {
+        op = list_entry(g_cport[cport].tx_fifo.next, struct gb_operation, list);
+        wd_start(&g_cport[cport].timeout_wd, gb_operation_timeout_delay(op),
+                 gb_operation_timeout, 1, cport);
+    }
+
+    irqrestore(flags);
+}
+
+/**
+ * Track an operation waiting for a response
+ *
+ * @note This function should be called from an atomic context
+ */
+static void gb_inflight_add(struct gb_operation *operation)
+{
+    struct gb_operation_hdr *hdr = operation->request_buffer;
+
+    list_add(&g_cport[operation->cport].tx_fifo, &operation->list);
+    list_add(&g_inflight[GB_INFLIGHT_HASH(le16_to_cpu(hdr->id))],
+             &operation->hash_list);
+}
+
+/**
+ * @note This function should be called from an atomic context
+ */
+static void gb_inflight_del(struct gb_operation *operation)
+{
+    list_del(&operation->list);
+    list_del(&operation->hash_list);
+}
+
+/**
+ * Find the operation waiting for the response with the given id
+ *
+ * @note This function should be called from an atomic context
+ */
+static struct gb_operation *gb_inflight_find(unsigned int cport, __le16 id)
+{
+    struct list_head *head = &g_inflight[GB_INFLIGHT_HASH(le16_to_cpu(id))];
+    struct list_head *iter;
+    struct gb_operation *op;
+    struct gb_operation_hdr *op_hdr;
+
+    list_foreach(head, iter) {
+        op = list_entry(iter, struct gb_operation, hash_list);
+        op_hdr = op->request_buffer;
+
+        if (op->cport == cport && op_hdr->id == id)
+            return op;
+    }
+
+    return NULL;
+}
+
+static void gb_clean_timedout_operation(unsigned int cport)
+{
+    irqstate_t flags;
+    struct gb_operation *op;
+
+    while (1) {
+        flags = irqsave();
+
+        if (list_is_empty(&g_cport[cport].tx_fifo)) {
+            irqrestore(flags);
+            break;
+        }
+
+        /* tx_fifo is ordered by deadline, stop at the first pending one */
+        op = list_entry(g_cport[cport].tx_fifo.next, struct gb_operation,
+                        list);
+        if (!gb_operation_has_timedout(op)) {
+            irqrestore(flags);
+            break;
+        }
+
+        gb_inflight_del(op);
+        gb_stats_inc(cport, timeouts);
+        irqrestore(flags);
+
+        if (op->callback) {
+            op->callback(op);
+        }
+        gb_operation_unref(op);
+    }
+
+    gb_watchdog_update(cport);
+}
+
+static void gb_process_response(struct gb_operation_hdr *hdr,
+                                struct gb_operation *operation)
+{
+    irqstate_t flags;
+    struct gb_operation *op;
+
+    gb_stats_inc(operation->cport, responses_in);
+    gb_stats_add(operation->cport, bytes_in, le16_to_cpu(hdr->size));
+
+    flags = irqsave();
+    op = gb_inflight_find(operation->cport, hdr->id);
+    if (op) {
+        gb_inflight_del(op);
+        gb_watchdog_update(operation->cport);
+    }
+    irqrestore(flags);
+
+    if (!op) {
+        gb_error("CPort %u: cannot find matching request for response %hu. Dropping message.\n",
+                 operation->cport, le16_to_cpu(hdr->id));
+        return;
+    }
+
+    /* attach this response with the original request */
+    gb_operation_ref(operation);
+    op->response = operation;
+    op_mark_recv_time(op);
+    if (op->callback)
+        op->callback(op);
+    gb_operation_unref(op);
+}
+
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+static size_t gb_cport_mtu(unsigned int cport)
+{
+    struct gb_driver *driver = g_cport[cport].driver;
+
+    return driver && driver->large_messages ?
+           CONFIG_GREYBUS_LARGE_MESSAGE_SIZE : GB_MTU;
+}
+
+/*
+ * Send a message, split in GB_MTU fragments when it is larger than that. The
+ * first fragment starts with the operation header, which holds the size of
+ * the whole message, so the receiver knows how many bytes follow.
+ */
+static int gb_transport_send(unsigned int cport, const void *buf, size_t len)
+{
+    const char *data = buf;
+    int retval;
+
+    for (; len > GB_MTU; data += GB_MTU, len -= GB_MTU) {
+        retval = transport_backend->send(cport, data, GB_MTU);
+        if (retval)
+            return retval;
+    }
+
+    return transport_backend->send(cport, data, len);
+}
+
+/*
+ * Same as gb_transport_send(), the callback being called once the last
+ * fragment has been sent.
+ */
+static int gb_transport_send_async(unsigned int cport, const void *buf,
+                                   size_t len,
+                                   unipro_send_completion_t callback,
+                                   void *priv)
+{
+    const char *data = buf;
+    int retval;
+
+    for (; len > GB_MTU; data += GB_MTU, len -= GB_MTU) {
+        retval = transport_backend->send_async(cport, data, GB_MTU,
+                                               NULL, NULL);
+        if (retval)
+            return retval;
+    }
+
+    return transport_backend->send_async(cport, data, len, callback, priv);
+}
+#else
+static size_t gb_cport_mtu(unsigned int cport)
+{
+    return GB_MTU;
+}
+
+static int gb_transport_send(unsigned int cport, const void *buf, size_t len)
+{
+    return transport_backend->send(cport, buf, len);
+}
+
+static int gb_transport_send_async(unsigned int cport, const void *buf,
+                                   size_t len,
+                                   unipro_send_completion_t callback,
+                                   void *priv)
+{
+    return transport_backend->send_async(cport, buf, len, callback, priv);
+}
+#endif
+
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+static bool gb_cport_credit_flow(unsigned int cport)
+{
+    struct gb_driver *driver = g_cport[cport].driver;
+
+    return driver && driver->credit_flow;
+}
+
+/* Let the peer send that many more messages */
+static int gb_credit_grant(unsigned int cport, unsigned int credits)
+{
+    struct {
+        struct gb_operation_hdr hdr;
+        struct gb_credit_request req;
+    } msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.hdr.size = cpu_to_le16(sizeof(msg));
+    msg.hdr.type = GB_CREDIT_TYPE;
+    msg.req.credits = cpu_to_le16(credits);
+
+    return transport_backend->send(cport, &msg, sizeof(msg));
+}
+
+/* Give the peer back the credits of the messages processed so far */
+static void gb_credit_return(unsigned int cport)
+{
+    struct gb_cport_driver *drv = &g_cport[cport];
+    unsigned int credits;
+    irqstate_t flags;
+
+    flags = irqsave();
+    credits = drv->rx_credits_owed;
+    drv->rx_credits_owed = 0;
+    irqrestore(flags);
+
+    if (credits && gb_credit_grant(cport, credits)) {
+        flags = irqsave();
+        drv->rx_credits_owed += credits;
+        irqrestore(flags);
+    }
+}
+
+/*
+ * Take a credit to send a message. When wait is set and no credit is left,
+ * wait up to CONFIG_GREYBUS_CREDIT_TIMEOUT for the peer to grant one, then
+ * send anyway rather than deadlock with a peer waiting for our credits.
+ */
+static int gb_credit_take(unsigned int cport, bool wait)
+{
+    struct timespec abstime;
+
+    if (!gb_cport_credit_flow(cport))
+        return 0;
+
+    if (!sem_trywait(&g_cport[cport].tx_credits))
+        return 0;
+
+    if (!wait)
+        return -EAGAIN;
+
+    /* the peer may be waiting for the credits we owe it */
+    gb_credit_return(cport);
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += CONFIG_GREYBUS_CREDIT_TIMEOUT / ONE_SEC_IN_MSEC;
+    abstime.tv_nsec += (CONFIG_GREYBUS_CREDIT_TIMEOUT % ONE_SEC_IN_MSEC) *
+                       ONE_MSEC_IN_NSEC;
+    if (abstime.tv_nsec >= ONE_SEC_IN_MSEC * ONE_MSEC_IN_NSEC) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= ONE_SEC_IN_MSEC * ONE_MSEC_IN_NSEC;
+    }
+
+    while (sem_timedwait(&g_cport[cport].tx_credits, &abstime) < 0) {
+        if (errno != EINTR) {
+            gb_warning("CP%u: no credit from the peer, sending anyway\n",
+                       cport);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add the credits granted by the peer
+ *
+ * @note This function is called from the RX path
+ */
+static void gb_credit_received(unsigned int cport, const void *data,
+                               size_t size)
+{
+    const struct gb_credit_request *req;
+    unsigned int credits;
+
+    if (size < sizeof(struct gb_operation_hdr) + sizeof(*req))
+        return;
+
+    req = (const void *) ((const char *) data +
+                          sizeof(struct gb_operation_hdr));
+    for (credits = le16_to_cpu(req->credits); credits; credits--)
+        sem_post(&g_cport[cport].tx_credits);
+}
+
+/* Forget the credits of both sides, when the connection changes */
+static void gb_credit_reset(unsigned int cport)
+{
+    while (!sem_trywait(&g_cport[cport].tx_credits));
+    g_cport[cport].rx_credits_owed = 0;
+}
+
+/*
+ * Account a message processed by the CPort worker, giving the credits back
+ * to the peer by batches of half the window.
+ */
+static void gb_credit_processed(unsigned int cport)
+{
+    irqstate_t flags;
+    unsigned int owed;
+
+    if (!gb_cport_credit_flow(cport))
+        return;
+
+    flags = irqsave();
+    owed = ++g_cport[cport].rx_credits_owed;
+    irqrestore(flags);
+
+    if (owed >= MAX(CONFIG_GREYBUS_CREDIT_WINDOW / 2, 1))
+        gb_credit_return(cport);
+}
+#else
+static bool gb_cport_credit_flow(unsigned int cport)
+{
+    return false;
+}
+
+static int gb_credit_take(unsigned int cport, bool wait)
+{
+    return 0;
+}
+#endif
+
+static int gb_operation_send_response_cb(int status, const void *buf,
+                                         void *priv)
+{
+    struct gb_operation *operation = priv;
+
+    if (status)
+        gb_error("Greybus backend failed to send: error %d\n", status);
+
+    gb_operation_unref(operation);
+
+    return 0;
+}
+
+/*
+ * Send a response whose payload is not in the response buffer, see
+ * gb_operation_set_response_payload(). The caller holds a reference on the
+ * operation for the transport, dropped once the payload has been sent.
+ */
+static int gb_operation_send_response_iov(struct gb_operation *operation)
+{
+    struct unipro_iovec iov[2];
+
+    iov[0].base = operation->response_buffer;
+    iov[0].len = sizeof(struct gb_operation_hdr);
+    iov[1].base = operation->response_payload;
+    iov[1].len = operation->response_payload_size;
+
+    return transport_backend->send_async_iov(operation->cport, iov,
+                                             ARRAY_SIZE(iov),
+                                             gb_operation_send_response_cb,
+                                             operation);
+}
+
+/**
+ * Push the batched responses of a CPort to the transport
+ *
+ * The responses are queued all at once, so that the transport can send them
+ * in a single pass.
+ */
+static void gb_flush_batched_responses(unsigned int cportid)
+{
+    struct gb_cport_driver *cport = &g_cport[cportid];
+    struct gb_operation_hdr *resp_hdr;
+    struct gb_operation *op;
+    int retval;
+
+    while (!list_is_empty(&cport->tx_batch)) {
+        op = list_entry(cport->tx_batch.next, struct gb_operation, list);
+        list_del(&op->list);
+        cport->tx_batch_count--;
+
+        resp_hdr = op->response_buffer;
+        gb_credit_take(cportid, true);
+        gb_tape_record(cportid, op->response_buffer,
+                       le16_to_cpu(resp_hdr->size) - op->response_payload_size,
+                       GB_TAPE_RECORD_TX);
+        if (op->response_payload) {
+            retval = gb_operation_send_response_iov(op);
+        } else {
+            retval = gb_transport_send_async(cportid, op->response_buffer,
+                                             le16_to_cpu(resp_hdr->size),
+                                             gb_operation_send_response_cb,
+                                             op);
+        }
+        if (retval) {
+            gb_error("Greybus backend failed to send: error %d\n", retval);
+            gb_operation_unref(op);
+        }
+    }
+}
+
+static bool gb_rx_fifo_is_empty(unsigned int cport)
+{
+#if CONFIG_GREYBUS_RX_RING_SIZE > 0
+    if (g_cport[cport].rx_ring_head != g_cport[cport].rx_ring_tail)
+        return false;
+#endif
+
+    return list_is_empty(&g_cport[cport].rx_fifo);
+}
+
+/**
+ * Dequeue the oldest incoming message of a CPort
+ *
+ * Only the worker of the CPort dequeues messages, so taking them from the
+ * ring does not require disabling the interrupts. The messages in the list
+ * are always more recent than the ones in the ring.
+ */
+static struct gb_operation *gb_rx_fifo_pop(unsigned int cport)
+{
+    struct gb_cport_driver *drv = &g_cport[cport];
+    struct gb_operation *op = NULL;
+    irqstate_t flags;
+#if CONFIG_GREYBUS_RX_RING_SIZE > 0
+    unsigned int tail = drv->rx_ring_tail;
+
+    if (tail != drv->rx_ring_head) {
+        gb_compiler_barrier();
+        op = drv->rx_ring[tail & GB_RX_RING_MASK];
+        gb_compiler_barrier();
+        drv->rx_ring_tail = tail + 1;
+        gb_stats_rx_fifo_pop(cport);
+        return op;
+    }
+#endif
+
+    flags = irqsave();
+    if (!list_is_empty(&drv->rx_fifo)) {
+        op = list_entry(drv->rx_fifo.next, struct gb_operation, list);
+        list_del(&op->list);
+    }
+    irqrestore(flags);
+
+    if (op)
+        gb_stats_rx_fifo_pop(cport);
+
+    return op;
+}
+
+/**
+ * Process the oldest incoming message of a CPort
+ *
+ * @return false if there was no message to process
+ */
+static bool gb_process_rx_message(unsigned int cportid)
+{
+    struct gb_operation *operation;
+    struct gb_operation_hdr *hdr;
+
+    operation = gb_rx_fifo_pop(cportid);
+    if (!operation)
+        return false;
+
+    hdr = operation->request_buffer;
+
+    if (hdr == &timedout_hdr) {
+        g_cport[cportid].timedout_queued = false;
+        gb_clean_timedout_operation(cportid);
+        gb_tape_replay_processed();
+        return true;
+    }
+
+    if (hdr->type & GB_TYPE_RESPONSE_FLAG)
+        gb_process_response(hdr, operation);
+    else
+        gb_process_request(hdr, operation);
+    gb_operation_destroy(operation);
+    gb_tape_replay_processed();
+
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+    gb_credit_processed(cportid);
+#endif
+
+    /* flush the responses once there is no more request to process */
+    if (g_cport[cportid].tx_batch_count &&
+        (gb_rx_fifo_is_empty(cportid) ||
+         g_cport[cportid].tx_batch_count >= CONFIG_GREYBUS_RESPONSE_BATCH_SIZE))
+        gb_flush_batched_responses(cportid);
+
+    return true;
+}
+
+/**
+ * CPort worker
+ *
+ * The worker processes all the pending messages before going to sleep, and
+ * the producers only post the semaphore when the worker is asleep.
+ */
+static void *gb_pending_message_worker(void *data)
+{
+    const int cportid = (int) data;
+    struct gb_cport_driver *cport = &g_cport[cportid];
+    irqstate_t flags;
+    bool sleep;
+
+    while (1) {
+        while (gb_process_rx_message(cportid));
+
+        if (cport->exit_worker && gb_rx_fifo_is_empty(cportid))
+            break;
+
+        flags = irqsave();
+        sleep = gb_rx_fifo_is_empty(cportid);
+        cport->worker_asleep = sleep;
+        irqrestore(flags);
+
+        if (sleep) {
+            while (sem_wait(&cport->rx_fifo_lock) < 0 && errno == EINTR);
+            cport->worker_asleep = false;
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+static void gb_shared_worker_enqueue(struct gb_cport_driver *cport)
+{
+    list_add(&g_shared_workers.ready_list[cport->driver->qos],
+             &cport->ready_node);
+    sem_post(&g_shared_workers.ready_sem);
+}
+
+/**
+ * Pick the next CPort to service, from the highest QoS class first
+ *
+ * @note This function should be called from an atomic context
+ */
+static struct gb_cport_driver *gb_shared_worker_dequeue(void)
+{
+    struct list_head *head;
+    int i;
+
+    for (i = GB_QOS_CLASS_COUNT - 1; i >= 0; i--) {
+        if (list_is_empty(&g_shared_workers.ready_list[i]))
+            continue;
+
+        head = g_shared_workers.ready_list[i].next;
+        list_del(head);
+        return list_entry(head, struct gb_cport_driver, ready_node);
+    }
+
+    return NULL;
+}
+
+/**
+ * Shared worker
+ *
+ * Service the CPorts queued in the ready lists. Only one message is processed
+ * before the CPort is queued back at the end of its ready list so that a busy
+ * CPort does not starve the others of the same QoS class. A CPort stays
+ * scheduled while it is being serviced, which guarantees that it is never
+ * handled by two workers at the same time and that its messages are processed
+ * in order.
+ */
+static void *gb_shared_worker(void *data)
+{
+    struct gb_cport_driver *cport;
+    irqstate_t flags;
+    int retval;
+
+    while (1) {
+        retval = sem_wait(&g_shared_workers.ready_sem);
+        if (retval < 0)
+            continue;
+
+        if (g_shared_workers.exit)
+            break;
+
+        flags = irqsave();
+        cport = gb_shared_worker_dequeue();
+        irqrestore(flags);
+
+        if (!cport)
+            continue;
+
+        gb_process_rx_message(cport - g_cport);
+
+        flags = irqsave();
+        if (!gb_rx_fifo_is_empty(cport - g_cport)) {
+            gb_shared_worker_enqueue(cport);
+        } else {
+            cport->scheduled = false;
+            if (cport->exit_worker)
+                sem_post(&cport->drain_sem);
+        }
+        irqrestore(flags);
+    }
+
+    return NULL;
+}
+
+static int gb_shared_workers_start(void)
+{
+    pthread_attr_t thread_attr;
+    int retval;
+    int i;
+
+    for (i = 0; i < GB_QOS_CLASS_COUNT; i++)
+        list_init(&g_shared_workers.ready_list[i]);
+    sem_init(&g_shared_workers.ready_sem, 0, 0);
+    g_shared_workers.exit = false;
+
+    retval = pthread_attr_init(&thread_attr);
+    if (retval)
+        goto error_attr_init;
+
+    retval = pthread_attr_setstacksize(&thread_attr,
+                                       CONFIG_GREYBUS_SHARED_WORKER_STACK_SIZE);
+    if (retval)
+        goto error_attr_setstacksize;
+
+    for (i = 0; i < CONFIG_GREYBUS_SHARED_WORKER_COUNT; i++) {
+        retval = pthread_create(&g_shared_workers.thread[i], &thread_attr,
+                                gb_shared_worker, NULL);
+        if (retval)
+            goto error_pthread_create;
+    }
+
+    pthread_attr_destroy(&thread_attr);
+
+    return 0;
+
+error_pthread_create:
+    g_shared_workers.exit = true;
+    while (i--) {
+        sem_post(&g_shared_workers.ready_sem);
+        pthread_join(g_shared_workers.thread[i], NULL);
+    }
+error_attr_setstacksize:
+    pthread_attr_destroy(&thread_attr);
+error_attr_init:
+    sem_destroy(&g_shared_workers.ready_sem);
+    gb_error("Can not create Greybus shared workers\n");
+    return -retval;
+}
+
+static void gb_shared_workers_stop(void)
+{
+    int i;
+
+    g_shared_workers.exit = true;
+
+    for (i = 0; i < CONFIG_GREYBUS_SHARED_WORKER_COUNT; i++)
+        sem_post(&g_shared_workers.ready_sem);
 
-    if (current_time.tv_sec < timeout_time.tv_sec)
-        return false;
+    for (i = 0; i < CONFIG_GREYBUS_SHARED_WORKER_COUNT; i++)
+        pthread_join(g_shared_workers.thread[i], NULL);
 
-    return current_time.tv_nsec > timeout_time.tv_nsec;
+    sem_destroy(&g_shared_workers.ready_sem);
 }
 
 /**
- * Update watchdog state
+ * Wake up the worker in charge of a CPort
  *
- * Cancel cport watchdog if there is no outgoing message waiting for a response,
- * or update the watchdog if there is still outgoing messages.
+ * @note This function should be called from an atomic context
+ */
+static void gb_cport_wakeup_worker(unsigned int cport)
+{
+    if (!g_cport[cport].shared) {
+        if (g_cport[cport].worker_asleep) {
+            g_cport[cport].worker_asleep = false;
+            sem_post(&g_cport[cport].rx_fifo_lock);
+        }
+        return;
+    }
+
+    if (g_cport[cport].scheduled)
+        return;
+
+    g_cport[cport].scheduled = true;
+    gb_shared_worker_enqueue(&g_cport[cport]);
+}
+#else
+static void gb_cport_wakeup_worker(unsigned int cport)
+{
+    if (g_cport[cport].worker_asleep) {
+        g_cport[cport].worker_asleep = false;
+        sem_post(&g_cport[cport].rx_fifo_lock);
+    }
+}
+#endif
+
+/**
+ * Queue an incoming message and wake up the CPort worker
  *
- * TODO use fine-grain timeout delay when doing the update
+ * Messages go to the ring, unless it is full or some messages already
+ * overflowed in the list, which keeps them in order.
  *
  * @note This function should be called from an atomic context
  */
-static void gb_watchdog_update(unsigned int cport)
+static void gb_rx_fifo_push(unsigned int cport, struct gb_operation *op)
 {
-    irqstate_t flags;
+    struct gb_cport_driver *drv = &g_cport[cport];
+#if CONFIG_GREYBUS_RX_RING_SIZE > 0
+    unsigned int head = drv->rx_ring_head;
+
+    if (list_is_empty(&drv->rx_fifo) &&
+        head - drv->rx_ring_tail < CONFIG_GREYBUS_RX_RING_SIZE) {
+        drv->rx_ring[head & GB_RX_RING_MASK] = op;
+        gb_compiler_barrier();
+        drv->rx_ring_head = head + 1;
+    } else
+#endif
+    {
+        list_add(&drv->rx_fifo, &op->list);
+    }
 
-    flags = irqsave();
+    gb_stats_rx_fifo_push(cport);
+    gb_tape_replay_queued();
+    gb_cport_wakeup_worker(cport);
+}
 
-    if (list_is_empty(&g_cport[cport].tx_fifo)) {
-        wd_cancel(&g_cport[cport].timeout_wd);
-    } else {
-        wd_start(&g_cport[cport].timeout_wd, TIMEOUT_WD_DELAY,
-                 gb_operation_timeout, 1, cport);
-    }
+#if defined(CONFIG_UNIPRO_ZERO_COPY)
+/**
+ * Check if an incoming message can be processed in place
+ *
+ * Messages are processed directly from the UniPro RX buffer unless the driver
+ * asked for copies, or unless the CPort ran out of RX buffers: holding the
+ * buffer until the message is processed would then pause the CPort RX.
+ */
+static bool gb_rx_can_zero_copy(unsigned int cport)
+{
+    return !g_cport[cport].driver->rx_copy && !unipro_rxbuf_is_exhausted(cport);
+}
 
-    irqrestore(flags);
+static void gb_rx_release_buffer(unsigned int cport, void *data)
+{
+    unipro_rxbuf_free(cport, data);
+}
+#else
+static bool gb_rx_can_zero_copy(unsigned int cport)
+{
+    return false;
 }
 
-static void gb_clean_timedout_operation(unsigned int cport)
+static void gb_rx_release_buffer(unsigned int cport, void *data)
 {
-    irqstate_t flags;
-    struct list_head *iter, *iter_next;
-    struct gb_operation *op;
+}
+#endif
 
-    list_foreach_safe(&g_cport[cport].tx_fifo, iter, iter_next) {
-        op = list_entry(iter, struct gb_operation, list);
+static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
+                                                   size_t size, bool zero_copy)
+{
+    struct gb_operation *op;
 
-        if (!gb_operation_has_timedout(op)) {
-            continue;
-        }
+    if (zero_copy) {
+        op = _gb_operation_create(cport);
+        if (!op)
+            return NULL;
 
-        flags = irqsave();
-        list_del(iter);
-        irqrestore(flags);
+        op->is_unipro_rx_buf = true;
+        op->request_buffer = data;
 
-        if (op->callback) {
-            op->callback(op);
-        }
-        gb_operation_unref(op);
+        return op;
     }
 
-    gb_watchdog_update(cport);
+    op = gb_operation_create(cport, 0, size - sizeof(struct gb_operation_hdr));
+    if (!op)
+        return NULL;
+
+    memcpy(op->request_buffer, data, size);
+
+    return op;
 }
 
-static void gb_process_response(struct gb_operation_hdr *hdr,
-                                struct gb_operation *operation)
+#ifdef GB_RX_DMA_COPY
+static void gb_rx_copy_done(struct dma_memcpy_req *req, int status)
 {
+    struct gb_operation *op = req->priv;
+    unsigned int cport = op->cport;
     irqstate_t flags;
-    struct list_head *iter, *iter_next;
-    struct gb_operation *op;
-    struct gb_operation_hdr *op_hdr;
 
-    list_foreach_safe(&g_cport[operation->cport].tx_fifo, iter, iter_next) {
-        op = list_entry(iter, struct gb_operation, list);
-        op_hdr = op->request_buffer;
+    gb_rx_release_buffer(cport, (void *) req->src);
 
-        if (hdr->id != op_hdr->id)
-            continue;
+    flags = irqsave();
 
-        flags = irqsave();
-        list_del(iter);
-        gb_watchdog_update(operation->cport);
-        irqrestore(flags);
+    g_cport[cport].rx_copies--;
 
-        /* attach this response with the original request */
-        gb_operation_ref(operation);
-        op->response = operation;
-        op_mark_recv_time(op);
-        if (op->callback)
-            op->callback(op);
+    if (status) {
+        irqrestore(flags);
+        gb_stats_inc(cport, rx_drops);
         gb_operation_unref(op);
         return;
     }
 
-    gb_error("CPort %u: cannot find matching request for response %hu. Dropping message.\n",
-             operation->cport, le16_to_cpu(hdr->id));
+    op_mark_recv_time(op);
+    gb_rx_fifo_push(cport, op);
+
+    irqrestore(flags);
 }
 
-static void *gb_pending_message_worker(void *data)
+/**
+ * Queue a request once it has been copied out of the UniPro RX buffer
+ *
+ * The copies complete in order, so the requests of the CPort are still
+ * queued in the order they were received, as long as no request is processed
+ * in place while copies are pending.
+ */
+static int gb_rx_copy_request(unsigned int cport, void *data, size_t size)
 {
-    const int cportid = (int) data;
+    struct gb_operation *op;
     irqstate_t flags;
-    struct gb_operation *operation;
-    struct list_head *head;
-    struct gb_operation_hdr *hdr;
     int retval;
 
-    while (1) {
-        retval = sem_wait(&g_cport[cportid].rx_fifo_lock);
-        if (retval < 0)
-            continue;
+    op = gb_operation_create(cport, 0, size - sizeof(struct gb_operation_hdr));
+    if (!op)
+        return -ENOMEM;
 
-        if (g_cport[cportid].exit_worker &&
-            list_is_empty(&g_cport[cportid].rx_fifo)) {
-            break;
-        }
+    op->rx_copy.dst = op->request_buffer;
+    op->rx_copy.src = data;
+    op->rx_copy.len = size;
+    op->rx_copy.callback = gb_rx_copy_done;
+    op->rx_copy.priv = op;
+
+    flags = irqsave();
+    g_cport[cport].rx_copies++;
+    irqrestore(flags);
 
+    retval = dma_memcpy(&op->rx_copy);
+    if (retval) {
         flags = irqsave();
-        head = g_cport[cportid].rx_fifo.next;
-        list_del(g_cport[cportid].rx_fifo.next);
+        g_cport[cport].rx_copies--;
         irqrestore(flags);
 
-        operation = list_entry(head, struct gb_operation, list);
-        hdr = operation->request_buffer;
+        gb_operation_unref(op);
+    }
+
+    return retval;
+}
+#endif
 
-        if (hdr == &timedout_hdr) {
-            gb_clean_timedout_operation(cportid);
-            continue;
-        }
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+/*
+ * Copy a fragment of a large message into the operation it is reassembled
+ * in, and queue the operation once the message is complete. The fragments
+ * of a message that could not be allocated are dropped.
+ */
+static void gb_rx_fragment(unsigned int cport, const void *data, size_t size)
+{
+    struct gb_cport_driver *drv = &g_cport[cport];
+    struct gb_operation *op = drv->rx_frag_op;
+    irqstate_t flags;
 
-        if (hdr->type & GB_TYPE_RESPONSE_FLAG)
-            gb_process_response(hdr, operation);
-        else
-            gb_process_request(hdr, operation);
-        gb_operation_destroy(operation);
-    }
+    size = MIN(size, drv->rx_frag_left);
+    if (op)
+        memcpy((char *) op->request_buffer + drv->rx_frag_offset, data, size);
 
-    return NULL;
+    drv->rx_frag_offset += size;
+    drv->rx_frag_left -= size;
+    if (drv->rx_frag_left || !op)
+        return;
+
+    drv->rx_frag_op = NULL;
+
+    gb_tape_record(cport, op->request_buffer, drv->rx_frag_offset, 0);
+    op_mark_recv_time(op);
+
+    flags = irqsave();
+    gb_rx_fifo_push(cport, op);
+    irqrestore(flags);
 }
 
-#if defined(CONFIG_UNIPRO_ZERO_COPY)
-static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
-                                                   size_t size)
+/* Start receiving a large message from its first fragment */
+static int gb_rx_fragment_start(unsigned int cport, const void *data,
+                                size_t size, size_t msg_size)
 {
-    struct gb_operation *op;
+    struct gb_cport_driver *drv = &g_cport[cport];
+    int retval = 0;
 
-    op = _gb_operation_create(cport);
-    if (!op)
-        return NULL;
+    drv->rx_frag_op = gb_operation_create(cport, 0, msg_size -
+                                          sizeof(struct gb_operation_hdr));
+    if (!drv->rx_frag_op) {
+        gb_stats_inc(cport, rx_drops);
+        retval = -ENOMEM;
+    }
 
-    op->is_unipro_rx_buf = true;
-    op->request_buffer = data;
+    drv->rx_frag_offset = 0;
+    drv->rx_frag_left = msg_size;
+    gb_rx_fragment(cport, data, size);
 
-    return op;
+    return retval;
 }
-#else
-static struct gb_operation *gb_rx_create_operation(unsigned cport, void *data,
-                                                   size_t size)
+
+static void gb_rx_fragment_abort(unsigned int cport)
 {
+    struct gb_cport_driver *drv = &g_cport[cport];
     struct gb_operation *op;
+    irqstate_t flags;
 
-    op = gb_operation_create(cport, 0, size - sizeof(struct gb_operation_hdr));
-    if (!op)
-        return NULL;
-
-    memcpy(op->request_buffer, data, size);
+    flags = irqsave();
+    op = drv->rx_frag_op;
+    drv->rx_frag_op = NULL;
+    drv->rx_frag_left = 0;
+    irqrestore(flags);
 
-    return op;
+    if (op)
+        gb_operation_unref(op);
 }
 #endif
 
-int greybus_rx_handler(unsigned int cport, void *data, size_t size)
+hot_function static int gb_rx_handler(unsigned int cport, void *data,
+                                      size_t size, bool is_rx_buf)
 {
     irqstate_t flags;
     struct gb_operation *op;
     struct gb_operation_hdr *hdr = data;
     struct gb_operation_handler *op_handler;
     size_t hdr_size;
+    bool zero_copy;
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    int retval;
+#endif
 
     gb_loopback_log_entry(cport);
     if (cport >= cport_count || !data) {
@@ -414,11 +1842,21 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
         return -EINVAL;
     }
 
-    if (!g_cport[cport].driver || !g_cport[cport].driver->op_handlers) {
+    if (!g_cport[cport].driver || !g_cport[cport].driver->op_handlers ||
+        !g_cport[cport].started) {
         gb_error("Cport %u does not have a valid driver registered\n", cport);
         return 0;
     }
 
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    if (g_cport[cport].rx_frag_left) {
+        gb_rx_fragment(cport, data, size);
+        if (is_rx_buf)
+            gb_rx_release_buffer(cport, data);
+        return 0;
+    }
+#endif
+
     if (sizeof(*hdr) > size) {
         gb_error("Dropping garbage request\n");
         return -EINVAL; /* Dropping garbage request */
@@ -426,6 +1864,17 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
 
     hdr_size = le16_to_cpu(hdr->size);
 
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    /* first fragment of a large message */
+    if (size == GB_MTU && hdr_size > size &&
+        hdr_size <= gb_cport_mtu(cport)) {
+        retval = gb_rx_fragment_start(cport, data, size, hdr_size);
+        if (is_rx_buf)
+            gb_rx_release_buffer(cport, data);
+        return retval;
+    }
+#endif
+
     if (hdr_size > size || sizeof(*hdr) > hdr_size) {
         gb_error("Dropping garbage request\n");
         return -EINVAL; /* Dropping garbage request */
@@ -433,77 +1882,236 @@ int greybus_rx_handler(unsigned int cport, void *data, size_t size)
 
     gb_dump(data, size);
 
-    if (gb_tape && gb_tape_fd >= 0) {
-        struct gb_tape_record_header record_hdr = {
-            .size = size,
-            .cport = cport,
-        };
+    sched_trace(SCHED_TRACE_GB_RX, cport,
+                SCHED_TRACE_GB_OP(le16_to_cpu(hdr->id), hdr->type, 0));
 
-        gb_tape->write(gb_tape_fd, &record_hdr, sizeof(record_hdr));
-        gb_tape->write(gb_tape_fd, data, size);
+    gb_tape_record(cport, data, size, 0);
+
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+    if (hdr->type == GB_CREDIT_TYPE && gb_cport_credit_flow(cport)) {
+        gb_credit_received(cport, data, hdr_size);
+        if (is_rx_buf)
+            gb_rx_release_buffer(cport, data);
+        return 0;
     }
+#endif
 
     op_handler = find_operation_handler(hdr->type, cport);
-    if (op_handler && op_handler->fast_handler) {
+    if (op_handler && op_handler->fast_handler &&
+        !gb_cport_credit_flow(cport)) {
         gb_debug("%s\n", gb_handler_name(op_handler));
         op_handler->fast_handler(cport, data);
+        if (is_rx_buf)
+            gb_rx_release_buffer(cport, data);
         return 0;
     }
 
-    op = gb_rx_create_operation(cport, data, hdr_size);
-    if (!op)
+    zero_copy = is_rx_buf && gb_rx_can_zero_copy(cport);
+
+#ifdef GB_RX_DMA_COPY
+    if (is_rx_buf && (!zero_copy || g_cport[cport].rx_copies)) {
+        if (gb_rx_copy_request(cport, data, hdr_size)) {
+            gb_stats_inc(cport, rx_drops);
+            return -ENOMEM;
+        }
+        return 0;
+    }
+#endif
+
+    op = gb_rx_create_operation(cport, data, hdr_size, zero_copy);
+    if (!op) {
+        gb_stats_inc(cport, rx_drops);
         return -ENOMEM;
+    }
+
+    if (is_rx_buf && !zero_copy)
+        gb_rx_release_buffer(cport, data);
 
     op_mark_recv_time(op);
 
     flags = irqsave();
-    list_add(&g_cport[cport].rx_fifo, &op->list);
-    sem_post(&g_cport[cport].rx_fifo_lock);
+    gb_rx_fifo_push(cport, op);
     irqrestore(flags);
 
     return 0;
 }
 
+hot_function int greybus_rx_handler(unsigned int cport, void *data,
+                                    size_t size)
+{
+    boot_timing_mark("greybus");
+    return gb_rx_handler(cport, data, size, true);
+}
+
+/*
+ * Entry point of the transports that do not receive in UniPro RX buffers:
+ * the message is copied, and the buffer is the caller's again on return.
+ */
+int greybus_rx_copy_handler(unsigned int cport, void *data, size_t size)
+{
+    return gb_rx_handler(cport, data, size, false);
+}
+
 static void gb_flush_tx_fifo(unsigned int cport)
 {
     struct list_head *iter, *iter_next;
+    irqstate_t flags;
 
     list_foreach_safe(&g_cport[cport].tx_fifo, iter, iter_next) {
         struct gb_operation *op = list_entry(iter, struct gb_operation, list);
 
-        list_del(iter);
+        flags = irqsave();
+        gb_inflight_del(op);
+        irqrestore(flags);
         gb_operation_unref(op);
     }
 }
 
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+/**
+ * Wait for the shared workers to process all the pending messages of a CPort
+ */
+static void gb_shared_cport_drain(unsigned int cport)
+{
+    irqstate_t flags;
+    bool scheduled;
+
+    flags = irqsave();
+    g_cport[cport].exit_worker = true;
+    scheduled = g_cport[cport].scheduled;
+    irqrestore(flags);
+
+    if (!scheduled)
+        return;
+
+    while (sem_wait(&g_cport[cport].drain_sem) < 0 && errno == EINTR);
+}
+#endif
+
 int gb_unregister_driver(unsigned int cport)
 {
     if (cport >= cport_count || !g_cport[cport].driver || !transport_backend)
         return -EINVAL;
 
-    if (transport_backend->stop_listening)
-        transport_backend->stop_listening(cport);
+    if (transport_backend->stop_listening)
+        transport_backend->stop_listening(cport);
+
+    if (!g_cport[cport].started) {
+        g_cport[cport].driver = NULL;
+        return 0;
+    }
+
+    wd_cancel(&g_cport[cport].timeout_wd);
+
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+    if (g_cport[cport].shared) {
+        gb_shared_cport_drain(cport);
+    } else
+#endif
+    {
+        g_cport[cport].exit_worker = true;
+        sem_post(&g_cport[cport].rx_fifo_lock);
+        tpool_join(g_cport[cport].thread, NULL);
+    }
+
+    gb_flush_tx_fifo(cport);
+    gb_flush_batched_responses(cport);
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    gb_rx_fragment_abort(cport);
+#endif
+
+    if (g_cport[cport].driver->exit)
+        g_cport[cport].driver->exit(cport, g_cport[cport].driver->bundle);
+    g_cport[cport].started = false;
+    g_cport[cport].driver = NULL;
+
+    return 0;
+}
+
+/*
+ * Initialize the driver registered on a CPort and start its worker. With
+ * CONFIG_GREYBUS_LAZY_INIT, this is deferred from the registration to the
+ * time the CPort is connected, so that the CPorts the AP never uses cost
+ * neither a thread nor the buffers and devices of their driver.
+ */
+static int gb_cport_start(unsigned int cport)
+{
+    pthread_attr_t thread_attr;
+    pthread_attr_t *thread_attr_ptr = &thread_attr;
+    struct sched_param param;
+    struct gb_driver *driver = g_cport[cport].driver;
+    int retval;
+
+    if (g_cport[cport].started)
+        return 0;
+
+    if (driver->init) {
+        retval = driver->init(cport, driver->bundle);
+        if (retval) {
+            gb_error("Can not init %s\n", gb_driver_name(driver));
+            return retval;
+        }
+    }
+
+    g_cport[cport].exit_worker = false;
+
+    if (!driver->stack_size)
+        driver->stack_size = DEFAULT_STACK_SIZE;
+
+    if (transport_backend->set_tx_priority) {
+        retval = transport_backend->set_tx_priority(cport, driver->qos);
+        if (retval)
+            gb_warning("Can not set TX priority of CP%u\n", cport);
+    }
+
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+    g_cport[cport].shared = !driver->dedicated_worker &&
+        driver->stack_size <= CONFIG_GREYBUS_SHARED_WORKER_STACK_SIZE;
+    if (g_cport[cport].shared) {
+        g_cport[cport].started = true;
+        return 0;
+    }
+#endif
+
+    retval = pthread_attr_init(&thread_attr);
+    if (retval)
+        goto pthread_attr_init_error;
+
+    retval = pthread_attr_setstacksize(&thread_attr, driver->stack_size);
+    if (retval)
+        goto pthread_attr_setstacksize_error;
 
-    wd_cancel(&g_cport[cport].timeout_wd);
+    param.sched_priority = gb_qos_priority[driver->qos];
+    retval = pthread_attr_setschedparam(&thread_attr, &param);
+    if (retval)
+        goto pthread_attr_setstacksize_error;
 
-    g_cport[cport].exit_worker = true;
-    sem_post(&g_cport[cport].rx_fifo_lock);
-    pthread_join(g_cport[cport].thread, NULL);
+    retval = tpool_create(&g_cport[cport].thread, &thread_attr,
+                          gb_pending_message_worker, (unsigned*) cport);
+    if (retval)
+        goto pthread_create_error;
 
-    gb_flush_tx_fifo(cport);
+    pthread_attr_destroy(&thread_attr);
+    thread_attr_ptr = NULL;
 
-    if (g_cport[cport].driver->exit)
-        g_cport[cport].driver->exit(cport, g_cport[cport].driver->bundle);
-    g_cport[cport].driver = NULL;
+    g_cport[cport].started = true;
 
     return 0;
+
+pthread_create_error:
+pthread_attr_setstacksize_error:
+    if (thread_attr_ptr != NULL)
+        pthread_attr_destroy(&thread_attr);
+pthread_attr_init_error:
+    gb_error("Can not create thread for %s\n: ", gb_driver_name(driver));
+    if (driver->exit)
+        driver->exit(cport, driver->bundle);
+    return retval;
 }
 
 int _gb_register_driver(unsigned int cport, int bundle_id,
                         struct gb_driver *driver)
 {
-    pthread_attr_t thread_attr;
-    pthread_attr_t *thread_attr_ptr = &thread_attr;
     struct gb_bundle *bundle;
     int retval;
 
@@ -530,6 +2138,15 @@ int _gb_register_driver(unsigned int cport, int bundle_id,
         return -EINVAL;
     }
 
+    if (driver->qos >= GB_QOS_CLASS_COUNT) {
+        gb_error("Invalid QoS class %u\n", driver->qos);
+        return -EINVAL;
+    }
+
+    retval = gb_check_handlers(driver);
+    if (retval)
+        return retval;
+
     if (bundle_id >= 0 && bundle_id > manifest_get_max_bundle_id()) {
         gb_error("invalid bundle_id: %d\n", bundle_id);
         return -EINVAL;
@@ -557,58 +2174,62 @@ int _gb_register_driver(unsigned int cport, int bundle_id,
     }
 
     driver->bundle = bundle;
+    g_cport[cport].driver = driver;
 
-    if (driver->init) {
-        retval = driver->init(cport, bundle);
-        if (retval) {
-            gb_error("Can not init %s\n", gb_driver_name(driver));
-            return retval;
-        }
-    }
-
-    if (driver->op_handlers) {
-        qsort(driver->op_handlers, driver->op_handlers_count,
-              sizeof(*driver->op_handlers), gb_compare_handlers);
-    }
-
-    g_cport[cport].exit_worker = false;
+#ifndef CONFIG_GREYBUS_LAZY_INIT
+    retval = gb_cport_start(cport);
+    if (retval)
+        g_cport[cport].driver = NULL;
+#endif
 
-    if (!driver->stack_size)
-        driver->stack_size = DEFAULT_STACK_SIZE;
+    return retval;
+}
 
-    retval = pthread_attr_init(&thread_attr);
-    if (retval)
-        goto pthread_attr_init_error;
+/**
+ * Limit the number of bytes gb_operation_send_request_nowait() may queue
+ *
+ * Once the transport has limit bytes or more queued for the CPort,
+ * gb_operation_send_request_nowait() fails with -EAGAIN. callback is then
+ * called when the queue has drained to half of the limit.
+ *
+ * @param cport CPort to limit
+ * @param limit maximum number of queued bytes, 0 for no limit
+ * @param callback called when TX space becomes available, can be NULL
+ * @param priv argument passed to callback
+ * @return 0 on success, -EINVAL on invalid CPort, -ENOTSUP if the transport
+ *         does not report its TX queue
+ */
+int gb_set_tx_queue_limit(unsigned int cport, size_t limit,
+                          gb_tx_space_callback callback, void *priv)
+{
+    int retval = 0;
 
-    retval = pthread_attr_setstacksize(&thread_attr, driver->stack_size);
-    if (retval)
-        goto pthread_attr_setstacksize_error;
+    DEBUGASSERT(transport_backend);
 
-    retval = pthread_create(&g_cport[cport].thread, &thread_attr,
-                            gb_pending_message_worker, (unsigned*) cport);
-    if (retval)
-        goto pthread_create_error;
+    if (cport >= cport_count)
+        return -EINVAL;
 
-    pthread_attr_destroy(&thread_attr);
-    thread_attr_ptr = NULL;
+    if (limit && !transport_backend->get_tx_queued)
+        return -ENOTSUP;
 
-    g_cport[cport].driver = driver;
+    if (transport_backend->set_tx_space_cb) {
+        retval = transport_backend->set_tx_space_cb(cport, limit / 2,
+                                                    limit ? callback : NULL,
+                                                    priv);
+        if (retval)
+            return retval;
+    } else if (limit && callback) {
+        return -ENOTSUP;
+    }
 
+    g_cport[cport].tx_queue_limit = limit;
     return 0;
-
-pthread_create_error:
-pthread_attr_setstacksize_error:
-    if (thread_attr_ptr != NULL)
-        pthread_attr_destroy(&thread_attr);
-pthread_attr_init_error:
-    gb_error("Can not create thread for %s\n: ", gb_driver_name(driver));
-    if (driver->exit)
-        driver->exit(cport, bundle);
-    return retval;
 }
 
 int gb_listen(unsigned int cport)
 {
+    int retval;
+
     DEBUGASSERT(transport_backend);
     DEBUGASSERT(transport_backend->listen);
 
@@ -622,6 +2243,11 @@ int gb_listen(unsigned int cport)
         return -EINVAL;
     }
 
+    /* the worker has to run before messages come in */
+    retval = gb_cport_start(cport);
+    if (retval)
+        return retval;
+
     return transport_backend->listen(cport);
 }
 
@@ -651,16 +2277,30 @@ static void gb_operation_timeout(int argc, uint32_t cport, ...)
     flags = irqsave();
 
     /* timedout operation could potentially already been queued */
-    if (!list_is_empty(&g_cport[cport].timedout_operation.list)) {
+    if (g_cport[cport].timedout_queued) {
         irqrestore(flags);
         return;
     }
 
-    list_add(&g_cport[cport].rx_fifo, &g_cport[cport].timedout_operation.list);
-    sem_post(&g_cport[cport].rx_fifo_lock);
+    g_cport[cport].timedout_queued = true;
+    gb_rx_fifo_push(cport, &g_cport[cport].timedout_operation);
     irqrestore(flags);
 }
 
+static bool gb_tx_queue_is_full(unsigned int cport, size_t size)
+{
+    size_t limit = g_cport[cport].tx_queue_limit;
+    ssize_t queued;
+
+    if (!limit)
+        return false;
+
+    queued = transport_backend->get_tx_queued(cport);
+
+    /* Always let a message through an empty queue, whatever its size */
+    return queued > 0 && queued + size > limit;
+}
+
 static int gb_operation_send_request_nowait_cb(int status, const void *buf,
                                                void *priv)
 {
@@ -698,6 +2338,14 @@ int gb_operation_send_request_nowait(struct gb_operation *operation,
         return -ENOTSUP;
     }
 
+    if (gb_tx_queue_is_full(operation->cport, le16_to_cpu(hdr->size))) {
+        return -EAGAIN;
+    }
+
+    if (gb_credit_take(operation->cport, false)) {
+        return -EAGAIN;
+    }
+
     hdr->id = 0;
     operation->callback = callback;
 
@@ -705,15 +2353,25 @@ int gb_operation_send_request_nowait(struct gb_operation *operation,
 
     gb_operation_ref(operation);
 
+    gb_tape_record(operation->cport, operation->request_buffer,
+                   le16_to_cpu(hdr->size), GB_TAPE_RECORD_TX);
+
     flags = irqsave();
-    retval = transport_backend->send_async(operation->cport,
-                                           operation->request_buffer,
-                                           le16_to_cpu(hdr->size),
-                                           gb_operation_send_request_nowait_cb,
-                                           operation);
+    retval = gb_transport_send_async(operation->cport,
+                                     operation->request_buffer,
+                                     le16_to_cpu(hdr->size),
+                                     gb_operation_send_request_nowait_cb,
+                                     operation);
     op_mark_send_time(operation);
+    if (!retval) {
+        gb_stats_inc(operation->cport, requests_out);
+        gb_stats_add(operation->cport, bytes_out, le16_to_cpu(hdr->size));
+    }
     irqrestore(flags);
 
+    if (retval)
+        gb_operation_unref(operation);
+
     return retval;
 }
 
@@ -734,6 +2392,8 @@ int gb_operation_send_request(struct gb_operation *operation,
 
     hdr->id = 0;
 
+    gb_credit_take(operation->cport, true);
+
     flags = irqsave();
 
     if (need_response) {
@@ -743,7 +2403,7 @@ int gb_operation_send_request(struct gb_operation *operation,
         clock_gettime(CLOCK_MONOTONIC, &operation->time);
         operation->callback = callback;
         gb_operation_ref(operation);
-        list_add(&g_cport[operation->cport].tx_fifo, &operation->list);
+        gb_inflight_add(operation);
         if (!WDOG_ISACTIVE(&g_cport[operation->cport].timeout_wd)) {
             wd_start(&g_cport[operation->cport].timeout_wd, TIMEOUT_WD_DELAY,
                      gb_operation_timeout, 1, operation->cport);
@@ -751,12 +2411,17 @@ int gb_operation_send_request(struct gb_operation *operation,
     }
 
     gb_dump(operation->request_buffer, hdr->size);
-    retval = transport_backend->send(operation->cport,
-                                     operation->request_buffer,
-                                     le16_to_cpu(hdr->size));
+    gb_tape_record(operation->cport, operation->request_buffer,
+                   le16_to_cpu(hdr->size), GB_TAPE_RECORD_TX);
+    retval = gb_transport_send(operation->cport, operation->request_buffer,
+                               le16_to_cpu(hdr->size));
     op_mark_send_time(operation);
+    if (!retval) {
+        gb_stats_inc(operation->cport, requests_out);
+        gb_stats_add(operation->cport, bytes_out, le16_to_cpu(hdr->size));
+    }
     if (need_response && retval) {
-        list_del(&operation->list);
+        gb_inflight_del(operation);
         gb_watchdog_update(operation->cport);
         gb_operation_unref(operation);
     }
@@ -798,22 +2463,41 @@ static int gb_operation_send_oom_response(struct gb_operation *operation)
     if (g_cport[operation->cport].exit_worker)
         return -ENETDOWN;
 
+    gb_credit_take(operation->cport, true);
+
     flags = irqsave();
 
     oom_hdr.id = req_hdr->id;
     oom_hdr.type = GB_TYPE_RESPONSE_FLAG | req_hdr->type;
 
+    gb_tape_record(operation->cport, &oom_hdr, sizeof(oom_hdr),
+                   GB_TAPE_RECORD_TX);
     retval = transport_backend->send(operation->cport, &oom_hdr,
                                      sizeof(oom_hdr));
+    if (!retval) {
+        gb_stats_inc(operation->cport, oom_responses);
+        gb_stats_inc(operation->cport, responses_out);
+        gb_stats_add(operation->cport, bytes_out, sizeof(oom_hdr));
+    }
 
     irqrestore(flags);
 
     return retval;
 }
 
-int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
+/**
+ * Send the response of an operation
+ *
+ * When may_batch is set and the driver enabled response batching, the
+ * response is queued and will be sent by the CPort worker once it has no
+ * more request to process. This must only be used from the CPort worker.
+ */
+static int _gb_operation_send_response(struct gb_operation *operation,
+                                       uint8_t result, bool may_batch)
 {
+    struct gb_cport_driver *cport;
     struct gb_operation_hdr *resp_hdr;
+    size_t len;
     int retval;
     bool has_allocated_response = false;
 
@@ -838,11 +2522,41 @@ int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
     resp_hdr = operation->response_buffer;
     resp_hdr->result = result;
 
-    gb_dump(operation->response_buffer, resp_hdr->size);
+    sched_trace(SCHED_TRACE_GB_RESPONSE, operation->cport,
+                SCHED_TRACE_GB_OP(le16_to_cpu(resp_hdr->id), resp_hdr->type,
+                                  result));
+
+    /* only the header is in the response buffer if the payload is not */
+    len = le16_to_cpu(resp_hdr->size) - operation->response_payload_size;
+
+    gb_dump(operation->response_buffer, len);
     gb_loopback_log_exit(operation->cport, operation, resp_hdr->size);
-    retval = transport_backend->send(operation->cport,
-                                     operation->response_buffer,
-                                     le16_to_cpu(resp_hdr->size));
+
+    cport = &g_cport[operation->cport];
+    if (may_batch && cport->driver->batch_responses &&
+        transport_backend->send_async) {
+        gb_operation_ref(operation);
+        list_add(&cport->tx_batch, &operation->list);
+        cport->tx_batch_count++;
+        operation->has_responded = true;
+        gb_stats_inc(operation->cport, responses_out);
+        gb_stats_add(operation->cport, bytes_out, le16_to_cpu(resp_hdr->size));
+        return 0;
+    }
+
+    gb_credit_take(operation->cport, true);
+    gb_tape_record(operation->cport, operation->response_buffer, len,
+                   GB_TAPE_RECORD_TX);
+    if (operation->response_payload) {
+        gb_operation_ref(operation);
+        retval = gb_operation_send_response_iov(operation);
+        if (retval)
+            gb_operation_unref(operation);
+    } else {
+        retval = gb_transport_send(operation->cport,
+                                   operation->response_buffer,
+                                   le16_to_cpu(resp_hdr->size));
+    }
     if (retval) {
         gb_error("Greybus backend failed to send: error %d\n", retval);
         if (has_allocated_response) {
@@ -854,9 +2568,16 @@ int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
     }
 
     operation->has_responded = true;
+    gb_stats_inc(operation->cport, responses_out);
+    gb_stats_add(operation->cport, bytes_out, le16_to_cpu(resp_hdr->size));
     return retval;
 }
 
+int gb_operation_send_response(struct gb_operation *operation, uint8_t result)
+{
+    return _gb_operation_send_response(operation, result, false);
+}
+
 void *gb_operation_alloc_response(struct gb_operation *operation, size_t size)
 {
     struct gb_operation_hdr *req_hdr;
@@ -882,6 +2603,43 @@ void *gb_operation_alloc_response(struct gb_operation *operation, size_t size)
     return gb_operation_get_response_payload(operation);
 }
 
+/**
+ * Set the response payload of an operation, without copying it
+ *
+ * When the transport can send scattered buffers, the response buffer only
+ * holds the header and the payload is sent from where it is: it must remain
+ * valid and unchanged until the response has been sent, which suits constant
+ * data such as the manifest. Otherwise, or while messages are taped, the
+ * payload is copied into the response buffer.
+ */
+int gb_operation_set_response_payload(struct gb_operation *operation,
+                                      const void *payload, size_t size)
+{
+    struct gb_operation_hdr *resp_hdr;
+    void *data;
+
+    DEBUGASSERT(operation);
+
+    if (!transport_backend->send_async_iov || g_tape_ring.recording ||
+        size > GB_MAX_PAYLOAD_SIZE) {
+        data = gb_operation_alloc_response(operation, size);
+        if (!data)
+            return -ENOMEM;
+
+        memcpy(data, payload, size);
+        return 0;
+    }
+
+    if (!gb_operation_alloc_response(operation, 0))
+        return -ENOMEM;
+
+    resp_hdr = operation->response_buffer;
+    resp_hdr->size = cpu_to_le16(sizeof(*resp_hdr) + size);
+    operation->response_payload = payload;
+    operation->response_payload_size = size;
+    return 0;
+}
+
 void gb_operation_destroy(struct gb_operation *operation)
 {
     DEBUGASSERT(operation);
@@ -915,7 +2673,7 @@ void gb_operation_unref(struct gb_operation *operation)
     if (operation->response) {
         gb_operation_unref(operation->response);
     }
-    free(operation);
+    gb_operation_pool_put(operation);
 }
 
 static struct gb_operation *_gb_operation_create(unsigned int cport)
@@ -925,7 +2683,7 @@ static struct gb_operation *_gb_operation_create(unsigned int cport)
     if (cport >= cport_count)
         return NULL;
 
-    operation = malloc(sizeof(*operation));
+    operation = gb_operation_pool_get();
     if (!operation)
         return NULL;
 
@@ -933,6 +2691,7 @@ static struct gb_operation *_gb_operation_create(unsigned int cport)
     operation->cport = cport;
 
     list_init(&operation->list);
+    list_init(&operation->hash_list);
     atomic_init(&operation->ref_count, 1);
 
     return operation;
@@ -964,7 +2723,7 @@ struct gb_operation *gb_operation_create(unsigned int cport, uint8_t type,
 
     return operation;
 malloc_error:
-    free(operation);
+    gb_operation_pool_put(operation);
     return NULL;
 }
 
@@ -984,6 +2743,27 @@ size_t gb_operation_get_request_payload_size(struct gb_operation *operation)
     return le16_to_cpu(hdr->size) - sizeof(*hdr);
 }
 
+/*
+ * Change the payload size of the request, for a driver that keeps an
+ * operation created with the largest payload it may send and fills it in
+ * place. It must not be larger than the size the operation was created with.
+ */
+int gb_operation_set_request_payload_size(struct gb_operation *operation,
+                                          size_t size)
+{
+    struct gb_operation_hdr *hdr;
+
+    if (!operation || !operation->request_buffer ||
+        size > gb_cport_mtu(operation->cport) - sizeof(*hdr)) {
+        return -EINVAL;
+    }
+
+    hdr = operation->request_buffer;
+    hdr->size = cpu_to_le16(size + sizeof(*hdr));
+
+    return 0;
+}
+
 uint8_t gb_operation_get_request_result(struct gb_operation *operation)
 {
     struct gb_operation_hdr *hdr;
@@ -1016,6 +2796,7 @@ struct gb_bundle *gb_operation_get_bundle(struct gb_operation *operation)
 int gb_init(struct gb_transport_backend *transport)
 {
     size_t num_bundles = manifest_get_max_bundle_id() + 1;
+    int retval;
     int i;
 
     if (!transport)
@@ -1033,14 +2814,48 @@ int gb_init(struct gb_transport_backend *transport)
         return -ENOMEM;
     }
 
+    retval = gb_operation_pool_init();
+    if (retval) {
+        free(g_cport);
+        free(g_bundle);
+        return retval;
+    }
+
+#ifdef GB_RX_DMA_COPY
+    /* Without the DMA channel, the requests are copied by the CPU */
+    dma_memcpy_init();
+#endif
+
     for (i = 0; i < cport_count; i++) {
         sem_init(&g_cport[i].rx_fifo_lock, 0, 0);
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+        sem_init(&g_cport[i].tx_credits, 0, 0);
+#endif
         list_init(&g_cport[i].rx_fifo);
         list_init(&g_cport[i].tx_fifo);
+        list_init(&g_cport[i].tx_batch);
         wd_static(&g_cport[i].timeout_wd);
+        (void)wd_setslack(&g_cport[i].timeout_wd, TIMEOUT_WD_SLACK);
         g_cport[i].timedout_operation.request_buffer = &timedout_hdr;
         list_init(&g_cport[i].timedout_operation.list);
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+        list_init(&g_cport[i].ready_node);
+        sem_init(&g_cport[i].drain_sem, 0, 0);
+#endif
+    }
+
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+    retval = gb_shared_workers_start();
+    if (retval) {
+        gb_operation_pool_deinit();
+        free(g_cport);
+        free(g_bundle);
+        return retval;
     }
+#endif
+
+    for (i = 0; i < CONFIG_GREYBUS_INFLIGHT_HASH_SIZE; i++)
+        list_init(&g_inflight[i]);
 
     atomic_init(&request_id, (uint32_t) 0);
 
@@ -1062,9 +2877,20 @@ void gb_deinit(void)
 
         wd_delete(&g_cport[i].timeout_wd);
         sem_destroy(&g_cport[i].rx_fifo_lock);
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+        sem_destroy(&g_cport[i].tx_credits);
+#endif
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+        sem_destroy(&g_cport[i].drain_sem);
+#endif
     }
 
+#ifdef CONFIG_GREYBUS_SHARED_WORKERS
+    gb_shared_workers_stop();
+#endif
+
     free(g_cport);
+    gb_operation_pool_deinit();
 
     if (transport_backend->exit)
         transport_backend->exit();
@@ -1087,6 +2913,15 @@ int gb_tape_register_mechanism(struct gb_tape_mechanism *mechanism)
 
 int gb_tape_communication(const char *pathname)
 {
+    struct gb_tape_ring *ring = &g_tape_ring;
+    struct gb_tape_file_header file_hdr = {
+        .magic = GB_TAPE_MAGIC,
+        .version = GB_TAPE_VERSION,
+    };
+    struct sched_param param;
+    pthread_attr_t attr;
+    int retval;
+
     if (!gb_tape)
         return -EINVAL;
 
@@ -1097,29 +2932,125 @@ int gb_tape_communication(const char *pathname)
     if (gb_tape_fd < 0)
         return gb_tape_fd;
 
+    if (gb_tape->write(gb_tape_fd, &file_hdr, sizeof(file_hdr)) !=
+        sizeof(file_hdr)) {
+        retval = -EIO;
+        goto error_write_header;
+    }
+
+    ring->buffer = malloc(CONFIG_GREYBUS_TAPE_RING_SIZE);
+    if (!ring->buffer) {
+        retval = -ENOMEM;
+        goto error_write_header;
+    }
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->drops = 0;
+    ring->exit = false;
+    sem_init(&ring->sem, 0, 0);
+    clock_gettime(CLOCK_MONOTONIC, &ring->start);
+
+    retval = pthread_attr_init(&attr);
+    if (retval)
+        goto error_thread;
+
+    param.sched_priority = CONFIG_GREYBUS_TAPE_THREAD_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    retval = pthread_create(&ring->thread, &attr, gb_tape_drain_worker, NULL);
+    pthread_attr_destroy(&attr);
+    if (retval)
+        goto error_thread;
+
+    ring->recording = true;
+
     return 0;
+
+error_thread:
+    sem_destroy(&ring->sem);
+    free(ring->buffer);
+    ring->buffer = NULL;
+error_write_header:
+    gb_tape->close(gb_tape_fd);
+    gb_tape_fd = -EBADFD;
+    return retval > 0 ? -retval : retval;
 }
 
 int gb_tape_stop(void)
 {
+    struct gb_tape_ring *ring = &g_tape_ring;
+    irqstate_t flags;
+
     if (!gb_tape || gb_tape_fd < 0)
         return -EINVAL;
 
+    flags = irqsave();
+    ring->recording = false;
+    irqrestore(flags);
+
+    ring->exit = true;
+    sem_post(&ring->sem);
+    pthread_join(ring->thread, NULL);
+
+    if (ring->drops)
+        lowsyslog("gb-tape: %u messages dropped\n", ring->drops);
+
+    sem_destroy(&ring->sem);
+    free(ring->buffer);
+    ring->buffer = NULL;
+
     gb_tape->close(gb_tape_fd);
     gb_tape_fd = -EBADFD;
 
     return 0;
 }
 
-int gb_tape_replay(const char *pathname)
+/**
+ * Wait for the CPort workers to process all the replayed messages
+ */
+static void gb_tape_replay_drain(void)
+{
+    irqstate_t flags;
+    bool wait;
+
+    flags = irqsave();
+    wait = g_tape_replay.processed != g_tape_replay.queued;
+    g_tape_replay.draining = wait;
+    irqrestore(flags);
+
+    if (wait)
+        while (sem_wait(&g_tape_replay.drained) < 0 && errno == EINTR);
+}
+
+/**
+ * Replay the incoming messages of a tape
+ *
+ * The messages are injected with their original pacing divided by speed, or
+ * back to back if speed is GB_TAPE_REPLAY_FAST. The replay returns once the
+ * CPort workers have processed all the messages, so that the duration
+ * reported in stats measures the throughput of the Greybus stack.
+ *
+ * @param pathname tape to replay
+ * @param speed pacing factor, GB_TAPE_REPLAY_FAST to disable the pacing
+ * @param stats where to store the replay statistics, may be NULL
+ * @return 0 on success, a negative errno otherwise
+ */
+int gb_tape_replay(const char *pathname, unsigned int speed,
+                   struct gb_tape_replay_stats *stats)
 {
+    struct gb_tape_file_header file_hdr;
     struct gb_tape_record_header hdr;
+    uint32_t first_timestamp = 0;
+    uint32_t start = 0;
+    bool started = false;
+    int32_t delay;
     char *buffer;
     ssize_t nread;
     int retval = 0;
     int fd;
 
-    if (!pathname || !gb_tape)
+    if (!pathname || !gb_tape || g_tape_replay.active)
         return -EINVAL;
 
     lowsyslog("greybus: replaying '%s'...\n", pathname);
@@ -1128,12 +3059,34 @@ int gb_tape_replay(const char *pathname)
     if (fd < 0)
         return fd;
 
+    nread = gb_tape->read(fd, &file_hdr, sizeof(file_hdr));
+    if (nread != sizeof(file_hdr) || file_hdr.magic != GB_TAPE_MAGIC ||
+        file_hdr.version != GB_TAPE_VERSION) {
+        gb_error("gb-tape: unsupported tape format, aborting...\n");
+        retval = -EINVAL;
+        goto error_buffer_alloc;
+    }
+
     buffer = malloc(CPORT_BUF_SIZE);
     if (!buffer) {
         retval = -ENOMEM;
         goto error_buffer_alloc;
     }
 
+    if (stats)
+        memset(stats, 0, sizeof(*stats));
+
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+    gb_reset_handler_stats();
+#endif
+
+    sem_init(&g_tape_replay.drained, 0, 0);
+    g_tape_replay.queued = 0;
+    g_tape_replay.processed = 0;
+    g_tape_replay.draining = false;
+    g_tape_replay.stats = stats;
+    g_tape_replay.active = true;
+
     while (1) {
         nread = gb_tape->read(fd, &hdr, sizeof(hdr));
         if (!nread)
@@ -1145,6 +3098,12 @@ int gb_tape_replay(const char *pathname)
             break;
         }
 
+        if (hdr.size > CPORT_BUF_SIZE) {
+            gb_error("gb-tape: invalid record size, aborting...\n");
+            retval = -EIO;
+            break;
+        }
+
         nread = gb_tape->read(fd, buffer, hdr.size);
         if (hdr.size != nread) {
             gb_error("gb-tape: invalid byte count read, aborting...\n");
@@ -1152,9 +3111,42 @@ int gb_tape_replay(const char *pathname)
             break;
         }
 
-        greybus_rx_handler(hdr.cport, buffer, nread);
+        /* outgoing messages are only recorded for analysis */
+        if (hdr.flags & GB_TAPE_RECORD_TX)
+            continue;
+
+        if (!started) {
+            first_timestamp = hdr.timestamp;
+            start = hrt_getusec();
+            started = true;
+        }
+
+        /*
+         * Pace against the start of the replay rather than the previous
+         * message, so that the time spent injecting does not add up.
+         */
+        if (speed != GB_TAPE_REPLAY_FAST) {
+            delay = start + (hdr.timestamp - first_timestamp) / speed -
+                    hrt_getusec();
+            if (delay > 0)
+                usleep(delay);
+        }
+
+        if (!gb_rx_handler(hdr.cport, buffer, nread, false) && stats) {
+            stats->messages++;
+            stats->bytes += nread;
+        }
     }
 
+    gb_tape_replay_drain();
+
+    if (stats && started)
+        stats->duration = hrt_getusec() - start;
+
+    g_tape_replay.active = false;
+    g_tape_replay.stats = NULL;
+    sem_destroy(&g_tape_replay.drained);
+
     free(buffer);
 
 error_buffer_alloc:
@@ -1165,6 +3157,8 @@ error_buffer_alloc:
 
 int gb_notify(unsigned cport, enum gb_event event)
 {
+    int retval;
+
     if (cport >= cport_count)
         return -EINVAL;
 
@@ -1173,11 +3167,28 @@ int gb_notify(unsigned cport, enum gb_event event)
 
     switch (event) {
     case GB_EVT_CONNECTED:
+        retval = gb_cport_start(cport);
+        if (retval)
+            return retval;
+
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+        if (gb_cport_credit_flow(cport)) {
+            gb_credit_reset(cport);
+            gb_credit_grant(cport, CONFIG_GREYBUS_CREDIT_WINDOW);
+        }
+#endif
+
         if (g_cport[cport].driver->connected)
             g_cport[cport].driver->connected(cport);
         break;
 
     case GB_EVT_DISCONNECTED:
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+        gb_rx_fragment_abort(cport);
+#endif
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+        gb_credit_reset(cport);
+#endif
         if (g_cport[cport].driver->disconnected)
             g_cport[cport].driver->disconnected(cport);
         break;
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Memory loopback Greybus transport
+ *
+ * CPorts are connected in pairs, and a message sent on a CPort is received
+ * right away on its peer, without any link in between. This lets the
+ * Greybus core and the protocol drivers be exercised and benchmarked
+ * against each other on a single board.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nuttx/unipro/unipro.h>
+#include <nuttx/greybus/debug.h>
+#include <nuttx/greybus/greybus.h>
+
+#define GB_MEMLOOP_NO_PEER  (~0U)
+
+static unsigned int *gb_memloop_peer;
+static unsigned int gb_memloop_cport_count;
+
+static void gb_memloop_backend_init(void)
+{
+    unsigned int i;
+
+    gb_memloop_cport_count = unipro_cport_count();
+    gb_memloop_peer = malloc(sizeof(*gb_memloop_peer) *
+                             gb_memloop_cport_count);
+    if (!gb_memloop_peer) {
+        gb_error("memloop: cannot allocate the CPort table\n");
+        gb_memloop_cport_count = 0;
+        return;
+    }
+
+    for (i = 0; i < gb_memloop_cport_count; i++)
+        gb_memloop_peer[i] = GB_MEMLOOP_NO_PEER;
+}
+
+static void gb_memloop_backend_exit(void)
+{
+    free(gb_memloop_peer);
+    gb_memloop_peer = NULL;
+    gb_memloop_cport_count = 0;
+}
+
+static int gb_memloop_listen(unsigned int cport)
+{
+    return cport < gb_memloop_cport_count ? 0 : -EINVAL;
+}
+
+static int gb_memloop_stop_listening(unsigned int cport)
+{
+    return 0;
+}
+
+static int gb_memloop_send(unsigned int cport, const void *buf, size_t len)
+{
+    unsigned int peer;
+
+    if (cport >= gb_memloop_cport_count)
+        return -EINVAL;
+
+    peer = gb_memloop_peer[cport];
+    if (peer == GB_MEMLOOP_NO_PEER)
+        return -ENOTCONN;
+
+    /* the receiver copies the message, buf is ours again on return */
+    return greybus_rx_copy_handler(peer, (void *) buf, len);
+}
+
+static int gb_memloop_send_async(unsigned int cport, const void *buf,
+                                 size_t len,
+                                 unipro_send_completion_t callback,
+                                 void *priv)
+{
+    int retval;
+
+    retval = gb_memloop_send(cport, buf, len);
+    if (!retval && callback)
+        callback(0, buf, priv);
+
+    return retval;
+}
+
+static int gb_memloop_send_async_iov(unsigned int cport,
+                                     const struct unipro_iovec *iov,
+                                     unsigned int iovcnt,
+                                     unipro_send_completion_t callback,
+                                     void *priv)
+{
+    size_t len = 0;
+    char *buf;
+    char *data;
+    int retval;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+        len += iov[i].len;
+
+    buf = malloc(len);
+    if (!buf)
+        return -ENOMEM;
+
+    for (data = buf, i = 0; i < iovcnt; data += iov[i++].len)
+        memcpy(data, iov[i].base, iov[i].len);
+
+    retval = gb_memloop_send(cport, buf, len);
+    free(buf);
+
+    if (!retval && callback)
+        callback(0, iov[0].base, priv);
+
+    return retval;
+}
+
+static struct gb_transport_backend gb_memloop_backend = {
+    .init = gb_memloop_backend_init,
+    .exit = gb_memloop_backend_exit,
+    .listen = gb_memloop_listen,
+    .stop_listening = gb_memloop_stop_listening,
+    .send = gb_memloop_send,
+    .send_async = gb_memloop_send_async,
+    .send_async_iov = gb_memloop_send_async_iov,
+    .alloc_buf = malloc,
+    .free_buf = free,
+};
+
+/**
+ * Connect two CPorts of the memory loopback transport
+ *
+ * What is sent on one CPort is received on the other one. The drivers of
+ * both CPorts still have to be notified of the connection with gb_notify().
+ */
+int gb_memloop_connect(unsigned int cport1, unsigned int cport2)
+{
+    if (cport1 >= gb_memloop_cport_count || cport2 >= gb_memloop_cport_count)
+        return -EINVAL;
+
+    if (gb_memloop_peer[cport1] != GB_MEMLOOP_NO_PEER ||
+        gb_memloop_peer[cport2] != GB_MEMLOOP_NO_PEER)
+        return -EBUSY;
+
+    gb_memloop_peer[cport1] = cport2;
+    gb_memloop_peer[cport2] = cport1;
+    return 0;
+}
+
+int gb_memloop_disconnect(unsigned int cport)
+{
+    unsigned int peer;
+
+    if (cport >= gb_memloop_cport_count)
+        return -EINVAL;
+
+    peer = gb_memloop_peer[cport];
+    if (peer == GB_MEMLOOP_NO_PEER)
+        return -ENOTCONN;
+
+    gb_memloop_peer[cport] = GB_MEMLOOP_NO_PEER;
+    gb_memloop_peer[peer] = GB_MEMLOOP_NO_PEER;
+    return 0;
+}
+
+int gb_memloop_init(void)
+{
+    gb_debug("Greybus: register memory loopback backend\n");
+    return gb_init(&gb_memloop_backend);
+}
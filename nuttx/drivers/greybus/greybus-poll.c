@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2015 Google, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Bridge-side execution of periodic sensor polls.
+ *
+ * A protocol hands over a poll program: a callback running the transfers
+ * of one sample, the number of bytes it reads and a period. A thread runs
+ * the program on absolute deadlines and batches the samples in
+ * unidirectional report requests, so that the AP is woken up once per
+ * report instead of once per sample.
+ */
+
+#include <errno.h>
+#include <debug.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/greybus/greybus.h>
+#include <nuttx/greybus/debug.h>
+#include <nuttx/greybus/timesync.h>
+
+#include <arch/byteorder.h>
+
+#include "greybus-poll.h"
+
+struct gb_poll {
+    unsigned int cport;
+    /** Operation type of the reports */
+    uint8_t type;
+    uint32_t period_us;
+    /** Samples per report */
+    uint16_t samples;
+    size_t sample_size;
+    gb_poll_sample_t sample;
+    void *priv;
+
+    pthread_t thread;
+    /** Posted to stop the thread */
+    sem_t stop;
+    bool exit;
+};
+
+/**
+ * @brief Size of the payload of a report request
+ *
+ * @param samples Samples per report
+ * @param sample_size Bytes read by the program for each sample
+ * @return Payload size in bytes
+ */
+size_t gb_poll_report_size(uint16_t samples, size_t sample_size)
+{
+    return sizeof(struct gb_poll_report_request) +
+           samples * (sizeof(struct gb_poll_sample) + sample_size);
+}
+
+static void gb_poll_add_usec(struct timespec *ts, uint32_t usec)
+{
+    ts->tv_sec += usec / USEC_PER_SEC;
+    ts->tv_nsec += (usec % USEC_PER_SEC) * NSEC_PER_USEC;
+    if (ts->tv_nsec >= NSEC_PER_SEC) {
+        ts->tv_sec++;
+        ts->tv_nsec -= NSEC_PER_SEC;
+    }
+}
+
+static uint32_t gb_poll_elapsed_usec(const struct timespec *from,
+                                     const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * USEC_PER_SEC +
+           (to->tv_nsec - from->tv_nsec) / NSEC_PER_USEC;
+}
+
+static void *gb_poll_thread(void *data)
+{
+    struct gb_poll *poll = data;
+    struct gb_operation *operation = NULL;
+    struct gb_poll_report_request *report = NULL;
+    struct gb_poll_sample *sample = NULL;
+    struct timespec deadline, now, first;
+    uint32_t sequence = 0;
+    uint16_t count = 0;
+    int ret;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    while (!poll->exit) {
+        if (!operation) {
+            operation = gb_operation_create(poll->cport, poll->type,
+                            gb_poll_report_size(poll->samples,
+                                                poll->sample_size));
+            if (operation) {
+                report = gb_operation_get_request_payload(operation);
+                report->sequence = cpu_to_le32(sequence);
+                report->padding = 0;
+                sample = (struct gb_poll_sample *)(report + 1);
+                count = 0;
+            }
+        }
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (operation) {
+            if (!count) {
+                first = now;
+                report->frame_time = cpu_to_le64(timesync_get_frame_time());
+            }
+
+            ret = poll->sample(poll->priv, (uint8_t *)(sample + 1));
+            sample->offset = cpu_to_le32(gb_poll_elapsed_usec(&first, &now));
+            sample->status = gb_errno_to_op_result(ret);
+            memset(sample->padding, 0, sizeof(sample->padding));
+
+            sample = (struct gb_poll_sample *)((uint8_t *)(sample + 1) +
+                                               poll->sample_size);
+            count++;
+        }
+        sequence++;
+
+        if (operation && count == poll->samples) {
+            report->count = cpu_to_le16(count);
+
+            /* the AP detects lost reports from the sequence numbers */
+            gb_operation_send_request_nowait(operation, NULL, false);
+            gb_operation_destroy(operation);
+            operation = NULL;
+        }
+
+        /*
+         * Deadlines are absolute so that the time spent on the bus does
+         * not accumulate. A late sample moves the schedule instead of
+         * running a burst of samples.
+         */
+        gb_poll_add_usec(&deadline, poll->period_us);
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (now.tv_sec > deadline.tv_sec ||
+            (now.tv_sec == deadline.tv_sec &&
+             now.tv_nsec > deadline.tv_nsec)) {
+            deadline = now;
+        }
+
+        while (sem_timedwait(&poll->stop, &deadline) && errno == EINTR);
+    }
+
+    if (operation) {
+        gb_operation_destroy(operation);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start running a poll program
+ *
+ * @param cport CPort the reports are sent on
+ * @param type Operation type of the reports
+ * @param period_us Period of the samples, at least one system tick
+ * @param samples Samples per report
+ * @param sample_size Bytes read by the program for each sample
+ * @param sample Callback running the transfers of one sample
+ * @param priv Private data of the callback
+ * @return Poll handle on success, NULL on failure
+ */
+struct gb_poll *gb_poll_start(unsigned int cport, uint8_t type,
+                              uint32_t period_us, uint16_t samples,
+                              size_t sample_size, gb_poll_sample_t sample,
+                              void *priv)
+{
+    struct gb_poll *poll;
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    if (period_us < USEC_PER_TICK || !samples || !sample ||
+        gb_poll_report_size(samples, sample_size) > GB_MAX_PAYLOAD_SIZE) {
+        return NULL;
+    }
+
+    poll = zalloc(sizeof(*poll));
+    if (!poll) {
+        return NULL;
+    }
+
+    poll->cport = cport;
+    poll->type = type;
+    poll->period_us = period_us;
+    poll->samples = samples;
+    poll->sample_size = sample_size;
+    poll->sample = sample;
+    poll->priv = priv;
+    sem_init(&poll->stop, 0, 0);
+
+    ret = pthread_attr_init(&attr);
+    if (ret) {
+        goto error_thread;
+    }
+
+    param.sched_priority = CONFIG_GREYBUS_POLL_THREAD_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    ret = pthread_create(&poll->thread, &attr, gb_poll_thread, poll);
+    pthread_attr_destroy(&attr);
+    if (ret) {
+        goto error_thread;
+    }
+
+    return poll;
+
+error_thread:
+    gb_error("failed to start the poll thread: %d\n", ret);
+    sem_destroy(&poll->stop);
+    free(poll);
+    return NULL;
+}
+
+/**
+ * @brief Stop a poll program
+ *
+ * Samples not sent yet are dropped. The callback is not called anymore
+ * once this function returns.
+ *
+ * @param poll Poll handle returned by gb_poll_start()
+ */
+void gb_poll_stop(struct gb_poll *poll)
+{
+    if (!poll) {
+        return;
+    }
+
+    poll->exit = true;
+    sem_post(&poll->stop);
+    pthread_join(poll->thread, NULL);
+
+    sem_destroy(&poll->stop);
+    free(poll);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015 Google, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _GREYBUS_POLL_H_
+#define _GREYBUS_POLL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <nuttx/greybus/types.h>
+
+/**
+ * Poll Report Request header, sent by the module
+ *
+ * Followed by count samples, each one made of a struct gb_poll_sample and
+ * of the bytes read by the poll program.
+ */
+struct gb_poll_report_request {
+    /** Sequence number of the first sample since the program started */
+    __le32  sequence;
+    /** Number of samples in the report */
+    __le16  count;
+    /** Must be set to zero */
+    __le16  padding;
+    /** Timesync frame time of the first sample */
+    __le64  frame_time;
+} __packed;
+
+/**
+ * Poll sample header
+ */
+struct gb_poll_sample {
+    /** Microseconds between the first sample of the report and this one */
+    __le32  offset;
+    /** Greybus operation result of the transfers of the sample */
+    __u8    status;
+    /** Must be set to zero */
+    __u8    padding[3];
+} __packed;
+
+/**
+ * Run the transfers of one sample
+ *
+ * @param priv Protocol private data given to gb_poll_start()
+ * @param buf Buffer receiving the bytes read by the program
+ * @return 0 on success, negative errno on failure
+ */
+typedef int (*gb_poll_sample_t)(void *priv, uint8_t *buf);
+
+struct gb_poll;
+
+struct gb_poll *gb_poll_start(unsigned int cport, uint8_t type,
+                              uint32_t period_us, uint16_t samples,
+                              size_t sample_size, gb_poll_sample_t sample,
+                              void *priv);
+void gb_poll_stop(struct gb_poll *poll);
+size_t gb_poll_report_size(uint16_t samples, size_t sample_size);
+
+#endif /* _GREYBUS_POLL_H_ */
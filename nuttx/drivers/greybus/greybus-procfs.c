@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/greybus/greybus.h>
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define GB_PROCFS_LINELEN   256
+
+struct gb_procfs_file {
+    struct procfs_file_s base;
+    char line[GB_PROCFS_LINELEN];
+};
+
+/**
+ * Copy a formatted line at the current file offset
+ *
+ * @return false once the user buffer is full
+ */
+static bool gb_procfs_copy(char *line, size_t linesize, char **buffer,
+                           size_t *remaining, off_t *offset, size_t *total)
+{
+    size_t copysize;
+
+    copysize = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+    *buffer += copysize;
+    *remaining -= copysize;
+    *total += copysize;
+
+    return *remaining > 0;
+}
+
+/**
+ * Format a latency histogram, bucket n ends at 2^n us
+ */
+static size_t gb_procfs_latency(char *line, const uint32_t *latency)
+{
+    size_t linesize;
+    int i;
+
+    linesize = snprintf(line, GB_PROCFS_LINELEN, "      latency:");
+    for (i = 0; i < GB_STATS_LATENCY_BUCKETS; i++) {
+        linesize += snprintf(line + linesize, GB_PROCFS_LINELEN - linesize,
+                             " %u", latency[i]);
+    }
+    linesize += snprintf(line + linesize, GB_PROCFS_LINELEN - linesize, "\n");
+
+    return linesize;
+}
+
+static int gb_cports_open(struct file *filep, const char *relpath, int oflags,
+                          mode_t mode)
+{
+    struct gb_procfs_file *priv;
+
+    if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+        return -EACCES;
+
+    if (strcmp(relpath, "greybus/cports") != 0)
+        return -ENOENT;
+
+    priv = kmm_zalloc(sizeof(*priv));
+    if (!priv)
+        return -ENOMEM;
+
+    filep->f_priv = priv;
+    return 0;
+}
+
+static int gb_procfs_close(struct file *filep)
+{
+    DEBUGASSERT(filep->f_priv);
+
+    kmm_free(filep->f_priv);
+    filep->f_priv = NULL;
+    return 0;
+}
+
+static ssize_t gb_cports_read(struct file *filep, char *buffer, size_t buflen)
+{
+    struct gb_procfs_file *priv = filep->f_priv;
+    struct gb_cport_stats stats;
+    const char *name;
+    off_t offset = filep->f_pos;
+    size_t remaining = buflen;
+    size_t total = 0;
+    size_t linesize;
+    unsigned int cport;
+
+    DEBUGASSERT(priv);
+
+    linesize = snprintf(priv->line, GB_PROCFS_LINELEN,
+                        "CPORT  REQ_IN REQ_OUT  RSP_IN RSP_OUT TIMEOUT "
+                        "    OOM   DROPS  FIFO_HWM   BYTES_IN  BYTES_OUT "
+                        "DRIVER\n");
+    if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining, &offset,
+                        &total))
+        goto out;
+
+    for (cport = 0; cport < gb_cport_count(); cport++) {
+        name = gb_cport_driver_name(cport);
+        if (!name || gb_cport_get_stats(cport, &stats))
+            continue;
+
+        linesize = snprintf(priv->line, GB_PROCFS_LINELEN,
+                            "%5u %7u %7u %7u %7u %7u %7u %7u %9u %10u %10u "
+                            "%s\n",
+                            cport, stats.requests_in, stats.requests_out,
+                            stats.responses_in, stats.responses_out,
+                            stats.timeouts, stats.oom_responses,
+                            stats.rx_drops, stats.rx_fifo_hwm,
+                            stats.bytes_in, stats.bytes_out, name);
+        if (linesize >= GB_PROCFS_LINELEN)
+            linesize = GB_PROCFS_LINELEN - 1;
+        if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+            goto out;
+
+        linesize = gb_procfs_latency(priv->line, stats.latency);
+        if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+            goto out;
+    }
+
+out:
+    filep->f_pos += total;
+    return total;
+}
+
+static int gb_procfs_dup(const struct file *oldp, struct file *newp)
+{
+    struct gb_procfs_file *newpriv;
+
+    DEBUGASSERT(oldp->f_priv);
+
+    newpriv = kmm_zalloc(sizeof(*newpriv));
+    if (!newpriv)
+        return -ENOMEM;
+
+    memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+    newp->f_priv = newpriv;
+    return 0;
+}
+
+static int gb_cports_stat(const char *relpath, struct stat *buf)
+{
+    if (strcmp(relpath, "greybus/cports") != 0)
+        return -ENOENT;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+    return 0;
+}
+
+const struct procfs_operations gb_cports_procfsoperations = {
+    .open = gb_cports_open,
+    .close = gb_procfs_close,
+    .read = gb_cports_read,
+    .dup = gb_procfs_dup,
+    .stat = gb_cports_stat,
+};
+
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+/*
+ * /proc/greybus/handlers lists the runtime of every request handler. Writing
+ * anything to it resets the statistics.
+ */
+static int gb_handlers_open(struct file *filep, const char *relpath,
+                            int oflags, mode_t mode)
+{
+    struct gb_procfs_file *priv;
+
+    if (strcmp(relpath, "greybus/handlers") != 0)
+        return -ENOENT;
+
+    priv = kmm_zalloc(sizeof(*priv));
+    if (!priv)
+        return -ENOMEM;
+
+    filep->f_priv = priv;
+    return 0;
+}
+
+static ssize_t gb_handlers_read(struct file *filep, char *buffer,
+                                size_t buflen)
+{
+    struct gb_procfs_file *priv = filep->f_priv;
+    struct gb_handler_stats stats;
+    const char *name;
+    off_t offset = filep->f_pos;
+    size_t remaining = buflen;
+    size_t total = 0;
+    size_t linesize;
+    unsigned int cport;
+    unsigned int i;
+    uint8_t type;
+
+    DEBUGASSERT(priv);
+
+    linesize = snprintf(priv->line, GB_PROCFS_LINELEN,
+                        "CPORT TYPE    COUNT      MIN      AVG      MAX "
+                        "HANDLER\n");
+    if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining, &offset,
+                        &total))
+        goto out;
+
+    for (cport = 0; cport < gb_cport_count(); cport++) {
+        for (i = 0; !gb_cport_get_handler_stats(cport, i, &type, &name,
+                                                &stats); i++) {
+            if (!stats.count)
+                continue;
+
+            linesize = snprintf(priv->line, GB_PROCFS_LINELEN,
+                                "%5u 0x%02x %8u %8u %8u %8u %s\n",
+                                cport, type, stats.count, stats.min,
+                                (uint32_t) (stats.total / stats.count),
+                                stats.max, name);
+            if (linesize >= GB_PROCFS_LINELEN)
+                linesize = GB_PROCFS_LINELEN - 1;
+            if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                                &offset, &total))
+                goto out;
+
+            linesize = gb_procfs_latency(priv->line, stats.latency);
+            if (!gb_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                                &offset, &total))
+                goto out;
+        }
+    }
+
+out:
+    filep->f_pos += total;
+    return total;
+}
+
+static ssize_t gb_handlers_write(struct file *filep, const char *buffer,
+                                 size_t buflen)
+{
+    gb_reset_handler_stats();
+    return buflen;
+}
+
+static int gb_handlers_stat(const char *relpath, struct stat *buf)
+{
+    if (strcmp(relpath, "greybus/handlers") != 0)
+        return -ENOENT;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR | S_IWUSR;
+    return 0;
+}
+
+const struct procfs_operations gb_handlers_procfsoperations = {
+    .open = gb_handlers_open,
+    .close = gb_procfs_close,
+    .read = gb_handlers_read,
+    .write = gb_handlers_write,
+    .dup = gb_procfs_dup,
+    .stat = gb_handlers_stat,
+};
+#endif
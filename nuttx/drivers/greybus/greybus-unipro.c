@@ -62,10 +62,14 @@ struct gb_transport_backend gb_unipro_backend = {
     .init = unipro_init,
     .send = unipro_send,
     .send_async = unipro_send_async,
+    .send_async_iov = unipro_send_async_iov,
     .listen = gb_unipro_listen,
     .stop_listening = gb_unipro_stop_listening,
     .alloc_buf = bufram_alloc,
     .free_buf = bufram_free,
+    .set_tx_priority = unipro_set_tx_priority,
+    .get_tx_queued = unipro_get_tx_queued_bytes,
+    .set_tx_space_cb = unipro_set_tx_space_cb,
 };
 
 int gb_unipro_init(void)
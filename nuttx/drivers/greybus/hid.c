@@ -30,10 +30,15 @@
 #include <debug.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <queue.h>
 
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
 #include <nuttx/device.h>
 #include <nuttx/device_hid.h>
+#include <nuttx/mm/mempool.h>
+#include <nuttx/tpool.h>
 #include <nuttx/greybus/greybus.h>
 #include <apps/greybus-utils/utils.h>
 
@@ -47,6 +52,20 @@
 /* Reserved operations for IRQ event input report buffer. */
 #define MAX_REPORT_OPERATIONS 5
 
+/* Report descriptor items */
+#define HID_ITEM_LONG           0xfe
+#define HID_ITEM_SIZE_MASK      0x03
+#define HID_ITEM_TAG_TYPE_MASK  0xfc
+#define HID_ITEM_REPORT_ID      0x84    /* Global item, tag 8 */
+
+/* Shortest time between two IRQ events, in ticks */
+#if CONFIG_GREYBUS_HID_REPORT_RATE > 0
+#define HID_REPORT_PERIOD \
+        USEC2TICK(1000000 / CONFIG_GREYBUS_HID_REPORT_RATE)
+#else
+#define HID_REPORT_PERIOD       0
+#endif
+
 /**
  * The structure for an operation queue.
  */
@@ -71,8 +90,11 @@ struct gb_hid_info {
     /** HID device of report descriptor length */
     uint16_t report_desc_len;
 
-    /** available operation queue */
-    sq_queue_t free_queue;
+    /** available operation nodes */
+    struct mempool free_pool;
+
+    /** storage of the operation nodes */
+    struct op_node *nodes;
 
     /** received report data operation queue */
     sq_queue_t data_queue;
@@ -97,6 +119,15 @@ struct gb_hid_info {
 
     /** inform the thread should be terminated */
     int thread_stop;
+
+    /** input reports start with their report ID */
+    bool report_ids;
+
+    /** an IRQ event is being sent */
+    int sending;
+
+    /** time of the last IRQ event, in ticks */
+    uint32_t last_send;
 };
 
 /**
@@ -115,28 +146,6 @@ static void node_requeue(sq_queue_t *queue, struct op_node *node)
     irqrestore(flags);
 }
 
-/**
- * @brief Get a node from the queue.
- *
- * @param queue The target queue.
- * @return A pointer to the node, NULL for no node to get.
- */
-static struct op_node *node_dequeue(sq_queue_t *queue)
-{
-    struct op_node *node = NULL;
-    irqstate_t flags = irqsave();
-
-    if (sq_empty(queue)) {
-        irqrestore(flags);
-        return NULL;
-    }
-
-    node = (struct op_node *)sq_remfirst(queue);
-    irqrestore(flags);
-
-    return node;
-}
-
 /**
  * @brief Get this firmware supported HID protocol version.
  *
@@ -406,14 +415,132 @@ static uint8_t gb_hid_set_report(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+/**
+ * @brief Check whether the device numbers its reports
+ *
+ * When the report descriptor has a Report ID item, every report starts with
+ * its ID, which tells the reports coalesced together apart.
+ *
+ * @param dev Pointer to structure of device data.
+ * @return true if the input reports start with a report ID.
+ */
+static bool hid_uses_report_ids(struct device *dev)
+{
+    struct hid_descriptor hid_desc;
+    uint8_t *desc;
+    bool found = false;
+    int i, size;
+
+    if (device_hid_get_descriptor(dev, &hid_desc)) {
+        return false;
+    }
+
+    desc = malloc(hid_desc.report_desc_length);
+    if (!desc) {
+        return false;
+    }
+
+    if (!device_hid_get_report_descriptor(dev, desc)) {
+        for (i = 0; i < hid_desc.report_desc_length; i += size + 1) {
+            if (desc[i] == HID_ITEM_LONG) {
+                /* data size and long item tag, then the data */
+                size = i + 1 < hid_desc.report_desc_length ?
+                       desc[i + 1] + 2 : 0;
+                continue;
+            }
+
+            if ((desc[i] & HID_ITEM_TAG_TYPE_MASK) == HID_ITEM_REPORT_ID) {
+                found = true;
+                break;
+            }
+
+            size = desc[i] & HID_ITEM_SIZE_MASK;
+            if (size == 3) {
+                size = 4;
+            }
+        }
+    }
+
+    free(desc);
+
+    return found;
+}
+
+/**
+ * @brief Replace a queued report by a newer one with the same ID
+ *
+ * Only the latest state matters to the AP for reports that haven't been
+ * sent yet, so a report of a device producing them faster than they are
+ * sent overwrites the queued one instead of taking another node.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @param hid_info Pointer to struct gb_hid_info.
+ * @param report Pointer to a received data buffer.
+ * @param len Returned buffer lenght.
+ * @return 1 if the report was merged into a queued one, 0 otherwise.
+ */
+static int hid_coalesce_report(struct gb_hid_info *hid_info, uint8_t *report,
+                               uint16_t len)
+{
+#ifdef CONFIG_GREYBUS_HID_COALESCE
+    struct op_node *node;
+
+    for (node = (struct op_node *)sq_peek(&hid_info->data_queue); node;
+         node = (struct op_node *)sq_next(&node->entry)) {
+        if (!hid_info->report_ids || node->buffer[0] == report[0]) {
+            memcpy(node->buffer, report, len);
+            return 1;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief Check whether an IRQ event may be sent now
+ *
+ * @param hid_info Pointer to struct gb_hid_info.
+ * @return true if the report rate allows another IRQ event.
+ */
+static bool hid_rate_ok(struct gb_hid_info *hid_info)
+{
+    return (int32_t)(clock_systimer() - hid_info->last_send) >=
+           (int32_t)HID_REPORT_PERIOD;
+}
+
+/**
+ * @brief Send the IRQ event of a node
+ *
+ * @param hid_info Pointer to struct gb_hid_info.
+ * @param node The node holding the report.
+ * @return None.
+ */
+static void hid_send_report(struct gb_hid_info *hid_info, struct op_node *node)
+{
+    int ret;
+
+    ret = gb_operation_send_request(node->operation, NULL, false);
+    if (ret) {
+        gb_info("IRQ Event operation failed (%x)!\n", ret);
+    }
+
+    hid_info->last_send = clock_systimer();
+}
+
 /**
  * @brief Callback for data receiving
  *
  * This callback provide a function call for HID device driver to notify
  * protocol when device driver received a data stream.
- * It put the current operation node to data queue and set free operation
- * node for next receiving activte. Finally, active the report_proc_thread to
- * process IRQ Event request protocol.
+ *
+ * When called from a thread with nothing queued and the report rate allows
+ * it, the report is sent right away from its node, saving the latency of
+ * the thread. Otherwise, unless it can be coalesced with a queued report of
+ * the same ID, it put the current operation node to data queue and set free
+ * operation node for next receiving activte. Finally, active the
+ * report_proc_thread to process IRQ Event request protocol.
  *
  * @param dev Pointer to structure of device data.
  * @param data Pointer to struct gb_hid_info.
@@ -428,10 +555,34 @@ static int hid_event_callback_routine(struct device *dev, void *data,
 {
     struct gb_hid_info *hid_info;
     struct op_node *node;
+    irqstate_t flags;
 
     DEBUGASSERT(data);
     hid_info = data;
 
+    if (hid_info->report_buf_size == len) {
+        flags = irqsave();
+
+        if (hid_coalesce_report(hid_info, report, len)) {
+            irqrestore(flags);
+            return 0;
+        }
+
+        if (hid_info->report_node && !up_interrupt_context() &&
+            !hid_info->sending && sq_empty(&hid_info->data_queue) &&
+            hid_rate_ok(hid_info)) {
+            hid_info->sending = 1;
+            irqrestore(flags);
+
+            memcpy(hid_info->report_node->buffer, report, len);
+            hid_send_report(hid_info, hid_info->report_node);
+            hid_info->sending = 0;
+            return 0;
+        }
+
+        irqrestore(flags);
+    }
+
     if (!hid_info->report_node) {
         /**
          * active report_proc_thread to send operation for node free
@@ -448,7 +599,7 @@ static int hid_event_callback_routine(struct device *dev, void *data,
 
     node_requeue(&hid_info->data_queue, hid_info->report_node);
 
-    node = node_dequeue(&hid_info->free_queue);
+    node = mempool_alloc(&hid_info->free_pool);
     if (!node) {
         hid_info->node_request = 1;
         /**
@@ -478,7 +629,8 @@ static void *report_proc_thread(void *data)
 {
     struct gb_hid_info *hid_info = data;
     struct op_node *node = NULL;
-    int ret;
+    irqstate_t flags;
+    int32_t wait;
 
     while (1) {
         sem_wait(&hid_info->active_sem);
@@ -487,18 +639,27 @@ static void *report_proc_thread(void *data)
             break;
         }
 
-        node = node_dequeue(&hid_info->data_queue);
+        /* Leave the reports coming in meanwhile to the coalescing */
+        wait = hid_info->last_send + HID_REPORT_PERIOD - clock_systimer();
+        if (wait > 0) {
+            usleep(TICK2USEC(wait));
+        }
+
+        flags = irqsave();
+        node = (struct op_node *)sq_remfirst(&hid_info->data_queue);
         if (node) {
-            ret = gb_operation_send_request(node->operation, NULL, false);
-            if (ret) {
-                gb_info("IRQ Event operation failed (%x)!\n",
-                         ret);
-            }
-            node_requeue(&hid_info->free_queue, node);
+            hid_info->sending = 1;
+        }
+        irqrestore(flags);
+
+        if (node) {
+            hid_send_report(hid_info, node);
+            hid_info->sending = 0;
+            mempool_free(&hid_info->free_pool, node);
         }
 
         if (hid_info->node_request) {
-            node = node_dequeue(&hid_info->free_queue);
+            node = mempool_alloc(&hid_info->free_pool);
             hid_info->report_node = node;
             hid_info->node_request = 0;
         }
@@ -508,68 +669,82 @@ static void *report_proc_thread(void *data)
 }
 
 /**
- * @brief Free operations
+ * @brief Free operations of receiver buffers
  *
- * This funciton destroy operations and node memory.
+ * This funciton destroy operations and node memory, whether the nodes are
+ * free, queued or in receiving.
  *
- * @param queue Target queue.
+ * @param hid_info The HID protocol information.
  * @return None.
  */
-static void hid_free_op(sq_queue_t *queue)
+static void hid_free_op(struct gb_hid_info *hid_info)
 {
-    struct op_node *node = NULL;
+    int i;
 
-    node = node_dequeue(queue);
-    while (node) {
-        gb_operation_destroy(node->operation);
-        free(node);
-        node = node_dequeue(queue);
+    if (!hid_info->nodes) {
+        return;
     }
+
+    for (i = 0; i < hid_info->entries; i++) {
+        if (hid_info->nodes[i].operation) {
+            gb_operation_destroy(hid_info->nodes[i].operation);
+        }
+    }
+
+    mempool_deinit(&hid_info->free_pool);
+    free(hid_info->nodes);
+    hid_info->nodes = NULL;
+    sq_init(&hid_info->data_queue);
 }
 
 /**
  * @brief Allocate operations for receiver buffers
  *
  * This function is allocating operation and use them as receiving buffers.
+ * The nodes are set up once and handed out by a pool, which keeps them as
+ * they are but for their queue entry.
  *
- * @param max_nodes Maximum nodes.
- * @param buf_size Buffer size in operation.
- * @param queue Target queue.
+ * @param hid_info The HID protocol information.
  * @return 0 for success, -errno for failures.
  */
-static int hid_alloc_op(int cport, int max_nodes,
-                        int buf_size, sq_queue_t *queue)
+static int hid_alloc_op(struct gb_hid_info *hid_info)
 {
-    struct gb_operation *operation = NULL;
     struct gb_hid_input_report_request *request = NULL;
     struct op_node *node = NULL;
-    int i = 0;
+    int ret;
+    int i;
 
-    for (i = 0; i < max_nodes; i++) {
-        operation = gb_operation_create(cport,
-                                        GB_HID_TYPE_IRQ_EVENT, buf_size);
-        if (!operation) {
-            goto err_free_op;
-        }
+    hid_info->nodes = zalloc(sizeof(*hid_info->nodes) * hid_info->entries);
+    if (!hid_info->nodes) {
+        return -ENOMEM;
+    }
 
-        node = zalloc(sizeof(struct op_node));
-        if (!node) {
-            gb_operation_destroy(operation);
+    for (i = 0; i < hid_info->entries; i++) {
+        node = &hid_info->nodes[i];
+        node->operation = gb_operation_create(hid_info->cport,
+                                              GB_HID_TYPE_IRQ_EVENT,
+                                              hid_info->report_buf_size);
+        if (!node->operation) {
+            ret = -ENOMEM;
             goto err_free_op;
         }
-        node->operation = operation;
 
-        request = gb_operation_get_request_payload(operation);
+        request = gb_operation_get_request_payload(node->operation);
         node->buffer = request->report;
-        node_requeue(queue, node);
+    }
+
+    ret = mempool_init(&hid_info->free_pool, hid_info->nodes, sizeof(*node),
+                       hid_info->entries, 0);
+    if (ret) {
+        goto err_free_op;
     }
 
     return 0;
 
 err_free_op:
-    hid_free_op(queue);
+    hid_free_op(hid_info);
 
-    return -ENOMEM;
+    return ret;
 }
 
 /**
@@ -587,13 +762,11 @@ static int hid_receiver_callback_init(struct gb_hid_info *hid_info)
 {
     int ret;
 
-    sq_init(&hid_info->free_queue);
     sq_init(&hid_info->data_queue);
 
     hid_info->entries = MAX_REPORT_OPERATIONS;
 
-    ret = hid_alloc_op(hid_info->cport, hid_info->entries,
-                       hid_info->report_buf_size, &hid_info->free_queue);
+    ret = hid_alloc_op(hid_info);
     if (ret) {
         return ret;
     }
@@ -603,8 +776,8 @@ static int hid_receiver_callback_init(struct gb_hid_info *hid_info)
         goto err_free_data_op;
     }
 
-    ret = pthread_create(&hid_info->pthread_handler, NULL, report_proc_thread,
-                         hid_info);
+    ret = tpool_create(&hid_info->pthread_handler, NULL, report_proc_thread,
+                       hid_info);
     if (ret) {
         goto err_destroy_active_sem;
     }
@@ -614,7 +787,7 @@ static int hid_receiver_callback_init(struct gb_hid_info *hid_info)
 err_destroy_active_sem:
     sem_destroy(&hid_info->active_sem);
 err_free_data_op:
-    hid_free_op(&hid_info->free_queue);
+    hid_free_op(hid_info);
 
     return -ret;
 }
@@ -633,13 +806,12 @@ static void hid_receiver_callback_deinit(struct gb_hid_info *hid_info)
     if (hid_info->pthread_handler != (pthread_t)0) {
         hid_info->thread_stop = 1;
         sem_post(&hid_info->active_sem);
-        pthread_join(hid_info->pthread_handler, NULL);
+        tpool_join(hid_info->pthread_handler, NULL);
     }
 
     sem_destroy(&hid_info->active_sem);
 
-    hid_free_op(&hid_info->data_queue);
-    hid_free_op(&hid_info->free_queue);
+    hid_free_op(hid_info);
 }
 
 /**
@@ -676,6 +848,8 @@ static int gb_hid_init(unsigned int cport, struct gb_bundle *bundle)
     }
 
     hid_info->report_buf_size = ret;
+    hid_info->report_ids = hid_uses_report_ids(bundle->dev);
+    hid_info->last_send = clock_systimer() - HID_REPORT_PERIOD;
 
     ret = hid_receiver_callback_init(hid_info);
     if (ret) {
@@ -683,7 +857,7 @@ static int gb_hid_init(unsigned int cport, struct gb_bundle *bundle)
     }
 
     /* Get first node pointer */
-    hid_info->report_node = node_dequeue(&hid_info->free_queue);
+    hid_info->report_node = mempool_alloc(&hid_info->free_pool);
     hid_info->node_request = 0;
 
     ret = device_hid_register_callback(bundle->dev, hid_info,
@@ -751,6 +925,8 @@ static struct gb_driver gb_hid_driver = {
     .exit = gb_hid_exit,
     .op_handlers = gb_hid_handlers,
     .op_handlers_count = ARRAY_SIZE(gb_hid_handlers),
+    .dedicated_worker = true,
+    .qos = GB_QOS_INTERACTIVE,
 };
 
 /**
@@ -37,6 +37,9 @@
 #define GB_I2C_PROTOCOL_VERSION             0x01
 #define GB_I2C_PROTOCOL_FUNCTIONALITY       0x02
 #define GB_I2C_PROTOCOL_TRANSFER            0x05
+#define GB_I2C_PROTOCOL_POLL_START          0x10
+#define GB_I2C_PROTOCOL_POLL_STOP           0x11
+#define GB_I2C_PROTOCOL_POLL_REPORT         0x12
 
 #define GB_I2C_FUNC_I2C                     0x00000001
 #define GB_I2C_FUNC_10BIT_ADDR              0x00000002
@@ -87,5 +90,16 @@ struct gb_i2c_transfer_rsp {
 	__u8	data[0];
 } __packed;
 
+/* the transfer is run every period_us, reports carry samples samples */
+struct gb_i2c_poll_start_req {
+	__le32	period_us;
+	__le16	samples;
+	__le16	padding;
+	struct gb_i2c_transfer_req transfer;
+} __packed;
+
+/* poll stop request has no payload */
+/* poll report request is a struct gb_poll_report_request */
+
 #endif /* _GREYBUS_I2C_H_ */
 
@@ -28,7 +28,9 @@
 
 #include <errno.h>
 #include <debug.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <arch/byteorder.h>
 #include <nuttx/device.h>
@@ -37,6 +39,9 @@
 #include <nuttx/greybus/debug.h>
 
 #include "i2c-gb.h"
+#ifdef CONFIG_GREYBUS_POLL
+#include "greybus-poll.h"
+#endif
 
 static uint8_t gb_i2c_protocol_version(struct gb_operation *operation)
 {
@@ -60,6 +65,7 @@ static uint8_t gb_i2c_protocol_functionality(struct gb_operation *operation)
         return GB_OP_NO_MEMORY;
 
     response->functionality = cpu_to_le32(GB_I2C_FUNC_I2C |
+                                          GB_I2C_FUNC_NOSTART |
                                           GB_I2C_FUNC_SMBUS_READ_BYTE |
                                           GB_I2C_FUNC_SMBUS_WRITE_BYTE |
                                           GB_I2C_FUNC_SMBUS_READ_BYTE_DATA |
@@ -72,46 +78,99 @@ static uint8_t gb_i2c_protocol_functionality(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
-static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
+/*
+ * Check a transfer request of req_size bytes and return the number of bytes
+ * it reads, or a negative errno if the request is short.
+ */
+static int gb_i2c_check_transfer(struct gb_i2c_transfer_req *request,
+                                 size_t req_size)
 {
+    struct gb_i2c_transfer_desc *desc;
+    size_t write_size = 0;
     int i, op_count;
-    uint32_t size = 0;
-    int ret;
-    uint8_t *write_data;
-    bool read_op;
+    int size = 0;
+
+    if (req_size < sizeof(*request))
+        return -EINVAL;
+
+    op_count = le16_to_cpu(request->op_count);
+
+    if (req_size < sizeof(*request) + op_count * sizeof(request->desc[0]))
+        return -EINVAL;
+
+    for (i = 0; i < op_count; i++) {
+        desc = &request->desc[i];
+
+        if (le16_to_cpu(desc->flags) & GB_I2C_M_RD)
+            size += le16_to_cpu(desc->size);
+        else
+            write_size += le16_to_cpu(desc->size);
+    }
+
+    if (req_size < sizeof(*request) + op_count * sizeof(request->desc[0]) +
+                   write_size)
+        return -EINVAL;
+
+    return size;
+}
+
+/*
+ * Fill the I2C requests of a transfer request, the data read going to
+ * read_buf and the data written coming from the request.
+ */
+static void gb_i2c_fill_requests(struct gb_i2c_transfer_req *request,
+                                 struct device_i2c_request *requests,
+                                 uint8_t *read_buf)
+{
+    int i, op_count = le16_to_cpu(request->op_count);
+    uint8_t *write_data = (uint8_t *)&request->desc[op_count];
+    struct gb_i2c_transfer_desc *desc;
     int read_count = 0;
 
+    for (i = 0; i < op_count; i++) {
+        desc = &request->desc[i];
+
+        requests[i].flags = 0;
+        if (le16_to_cpu(desc->flags) & GB_I2C_M_NOSTART)
+            requests[i].flags |= I2C_FLAG_NORESTART;
+        requests[i].addr = le16_to_cpu(desc->addr);
+        requests[i].length = le16_to_cpu(desc->size);
+
+        if (le16_to_cpu(desc->flags) & GB_I2C_M_RD) {
+            requests[i].flags |= GB_I2C_M_RD;
+            requests[i].buffer = &read_buf[read_count];
+            read_count += le16_to_cpu(desc->size);
+        } else {
+            requests[i].buffer = write_data;
+            write_data += le16_to_cpu(desc->size);
+        }
+    }
+}
+
+static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
+{
+    int op_count;
+    int size;
+    int ret;
+
     struct gb_bundle *bundle = gb_operation_get_bundle(operation);
     DEBUGASSERT(bundle);
 
     struct device_i2c_request *requests;
 
-    struct gb_i2c_transfer_desc *desc;
     struct gb_i2c_transfer_req *request;
     struct gb_i2c_transfer_rsp *response;
     const size_t req_size = gb_operation_get_request_payload_size(operation);
 
-    if (req_size < sizeof(*request)) {
-        gb_error("dropping short message\n");
-        return GB_OP_INVALID;
-    }
-
     request = gb_operation_get_request_payload(operation);
-    op_count = le16_to_cpu(request->op_count);
-    write_data = (uint8_t *)&request->desc[op_count];
 
-    if (req_size < sizeof(*request) + op_count * sizeof(request->desc[0])) {
+    size = gb_i2c_check_transfer(request, req_size);
+    if (size < 0) {
         gb_error("dropping short message\n");
         return GB_OP_INVALID;
     }
 
-    for (i = 0; i < op_count; i++) {
-        desc = &request->desc[i];
-        read_op = (le16_to_cpu(desc->flags) & GB_I2C_M_RD) ? true : false;
-
-        if (read_op)
-            size += le16_to_cpu(desc->size);
-    }
+    op_count = le16_to_cpu(request->op_count);
 
     response = gb_operation_alloc_response(operation, size);
     if (!response) {
@@ -123,23 +182,7 @@ static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
         return GB_OP_NO_MEMORY;
     }
 
-    for (i = 0; i < op_count; i++) {
-        desc = &request->desc[i];
-        read_op = (le16_to_cpu(desc->flags) & GB_I2C_M_RD) ? true : false;
-
-        requests[i].flags = 0;
-        requests[i].addr = le16_to_cpu(desc->addr);
-        requests[i].length = le16_to_cpu(desc->size);
-
-        if (read_op) {
-            requests[i].flags |= GB_I2C_M_RD;
-            requests[i].buffer = &response->data[read_count];
-            read_count += le16_to_cpu(desc->size);
-        } else {
-            requests[i].buffer = write_data;
-            write_data += le16_to_cpu(desc->size);
-        }
-    }
+    gb_i2c_fill_requests(request, requests, response->data);
 
     ret = device_i2c_transfer(bundle->dev, requests, op_count);
 
@@ -148,6 +191,119 @@ static uint8_t gb_i2c_protocol_transfer(struct gb_operation *operation)
     return gb_errno_to_op_result(ret);
 }
 
+#ifdef CONFIG_GREYBUS_POLL
+/* Poll program of a bundle */
+struct gb_i2c_poll {
+    struct device *dev;
+    struct gb_poll *poll;
+    struct device_i2c_request *requests;
+    int op_count;
+    /* bytes read by one sample */
+    int read_size;
+    uint8_t *read_buf;
+};
+
+static int gb_i2c_poll_sample(void *priv, uint8_t *buf)
+{
+    struct gb_i2c_poll *prog = priv;
+    int ret;
+
+    ret = device_i2c_transfer(prog->dev, prog->requests, prog->op_count);
+    if (!ret)
+        memcpy(buf, prog->read_buf, prog->read_size);
+    else
+        memset(buf, 0, prog->read_size);
+
+    return ret;
+}
+
+static void gb_i2c_poll_free(struct gb_bundle *bundle)
+{
+    struct gb_i2c_poll *prog = bundle->priv;
+
+    if (!prog)
+        return;
+
+    gb_poll_stop(prog->poll);
+    free(prog);
+    bundle->priv = NULL;
+}
+
+static uint8_t gb_i2c_protocol_poll_start(struct gb_operation *operation)
+{
+    struct gb_i2c_poll_start_req *request;
+    struct gb_i2c_transfer_req *transfer;
+    struct gb_i2c_poll *prog;
+    size_t req_size = gb_operation_get_request_payload_size(operation);
+    size_t transfer_size;
+    int op_count, size;
+
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    if (req_size < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    transfer_size = req_size - offsetof(struct gb_i2c_poll_start_req,
+                                        transfer);
+
+    size = gb_i2c_check_transfer(&request->transfer, transfer_size);
+    op_count = le16_to_cpu(request->transfer.op_count);
+    if (size < 0 || !op_count) {
+        gb_error("invalid poll program\n");
+        return GB_OP_INVALID;
+    }
+
+    /* a new program replaces the running one */
+    gb_i2c_poll_free(bundle);
+
+    /*
+     * The program keeps its own copy of the transfer request, the I2C
+     * requests and a buffer for the bytes of the current sample.
+     */
+    prog = zalloc(sizeof(*prog) + op_count * sizeof(prog->requests[0]) +
+                  transfer_size + size);
+    if (!prog)
+        return GB_OP_NO_MEMORY;
+
+    prog->dev = bundle->dev;
+    prog->op_count = op_count;
+    prog->read_size = size;
+    prog->requests = (struct device_i2c_request *)(prog + 1);
+    transfer = (struct gb_i2c_transfer_req *)&prog->requests[op_count];
+    memcpy(transfer, &request->transfer, transfer_size);
+    prog->read_buf = (uint8_t *)transfer + transfer_size;
+
+    gb_i2c_fill_requests(transfer, prog->requests, prog->read_buf);
+
+    prog->poll = gb_poll_start(operation->cport, GB_I2C_PROTOCOL_POLL_REPORT,
+                               le32_to_cpu(request->period_us),
+                               le16_to_cpu(request->samples), size,
+                               gb_i2c_poll_sample, prog);
+    if (!prog->poll) {
+        free(prog);
+        return GB_OP_INVALID;
+    }
+
+    bundle->priv = prog;
+
+    return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_i2c_protocol_poll_stop(struct gb_operation *operation)
+{
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    gb_i2c_poll_free(bundle);
+
+    return GB_OP_SUCCESS;
+}
+#endif
+
 static int gb_i2c_init(unsigned int cport, struct gb_bundle *bundle)
 {
     DEBUGASSERT(bundle);
@@ -165,6 +321,10 @@ static void gb_i2c_exit(unsigned int cport, struct gb_bundle *bundle)
 {
     DEBUGASSERT(bundle);
 
+#ifdef CONFIG_GREYBUS_POLL
+    gb_i2c_poll_free(bundle);
+#endif
+
     if (bundle->dev) {
         device_close(bundle->dev);
     }
@@ -174,6 +334,10 @@ static struct gb_operation_handler gb_i2c_handlers[] = {
     GB_HANDLER(GB_I2C_PROTOCOL_VERSION, gb_i2c_protocol_version),
     GB_HANDLER(GB_I2C_PROTOCOL_FUNCTIONALITY, gb_i2c_protocol_functionality),
     GB_HANDLER(GB_I2C_PROTOCOL_TRANSFER, gb_i2c_protocol_transfer),
+#ifdef CONFIG_GREYBUS_POLL
+    GB_HANDLER(GB_I2C_PROTOCOL_POLL_START, gb_i2c_protocol_poll_start),
+    GB_HANDLER(GB_I2C_PROTOCOL_POLL_STOP, gb_i2c_protocol_poll_stop),
+#endif
 };
 
 static struct gb_driver gb_i2c_driver = {
@@ -49,6 +49,11 @@
 #define GB_LIGHTS_TYPE_SET_FLASH_STROBE         0x0C
 #define GB_LIGHTS_TYPE_SET_FLASH_TIMEOUT        0x0D
 #define GB_LIGHTS_TYPE_GET_FLASH_FAULT          0x0E
+#define GB_LIGHTS_TYPE_UPDATE_CHANNELS          0x10
+
+/* Greybus Lights update flags */
+#define GB_LIGHTS_UPDATE_BRIGHTNESS             0x01
+#define GB_LIGHTS_UPDATE_COLOR                  0x02
 
 /**
  * Lights Protocol version response payload, version request has no payload
@@ -259,5 +264,30 @@ struct gb_lights_get_flash_fault_response {
     __le32  fault;
 } __packed;
 
+/**
+ * Lights Protocol settings of one channel in an update channels request
+ */
+struct gb_lights_channel_update {
+    /** light identification number */
+    __u8    light_id;
+    /** channel identification number */
+    __u8    channel_id;
+    /** GB_LIGHTS_UPDATE_* settings to apply */
+    __u8    flags;
+    /** brightness to be set, with GB_LIGHTS_UPDATE_BRIGHTNESS */
+    __u8    brightness;
+    /** channel color code to be set, with GB_LIGHTS_UPDATE_COLOR */
+    __le32  color;
+} __packed;
+
+/**
+ * Lights Protocol update channels request payload, response have no payload
+ */
+struct gb_lights_update_channels_request {
+    /** number of channels to update */
+    __u8    count;
+    struct gb_lights_channel_update channels[0];
+} __packed;
+
 #endif /* _GREYBUS_LIGHTS_H_ */
 
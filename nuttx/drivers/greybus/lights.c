@@ -402,6 +402,108 @@ static uint8_t gb_lights_set_color(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+/**
+ * @brief Set several channels one at a time
+ *
+ * Fallback for the lights drivers without an update channels operation.
+ *
+ * @param dev pointer to structure of device data
+ * @param updates settings to apply
+ * @param count number of entries in updates
+ * @return 0 on success, negative errno on error
+ */
+static int gb_lights_update_each(struct device *dev,
+                                 const struct lights_channel_update *updates,
+                                 uint8_t count)
+{
+    int ret = 0;
+    int i;
+
+    for (i = 0; i < count && !ret; i++) {
+        if (updates[i].flags & LIGHTS_UPDATE_COLOR) {
+            ret = device_lights_set_color(dev, updates[i].light_id,
+                                          updates[i].channel_id,
+                                          updates[i].color);
+        }
+
+        if (!ret && (updates[i].flags & LIGHTS_UPDATE_BRIGHTNESS)) {
+            ret = device_lights_set_brightness(dev, updates[i].light_id,
+                                               updates[i].channel_id,
+                                               updates[i].brightness);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Set brightness and color to several channels
+ *
+ * This operation allows the AP Module to set several channels, of one or
+ * more lights, in one message, so that animating a RGB light neither costs
+ * a round trip per channel nor shows the channels changing one after the
+ * other when the lights device driver can apply them together
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_lights_update_channels(struct gb_operation *operation)
+{
+    struct gb_lights_update_channels_request *request;
+    struct lights_channel_update *updates;
+    struct gb_bundle *bundle;
+    size_t size;
+    int ret;
+    int i;
+
+    bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    size = gb_operation_get_request_payload_size(operation);
+    request = gb_operation_get_request_payload(operation);
+
+    if (size < sizeof(*request) ||
+        size < sizeof(*request) +
+               request->count * sizeof(request->channels[0])) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    if (!request->count) {
+        return GB_OP_SUCCESS;
+    }
+
+    updates = malloc(request->count * sizeof(*updates));
+    if (!updates) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    for (i = 0; i < request->count; i++) {
+        updates[i].light_id = request->channels[i].light_id;
+        updates[i].channel_id = request->channels[i].channel_id;
+        updates[i].flags =
+            (request->channels[i].flags & GB_LIGHTS_UPDATE_BRIGHTNESS ?
+             LIGHTS_UPDATE_BRIGHTNESS : 0) |
+            (request->channels[i].flags & GB_LIGHTS_UPDATE_COLOR ?
+             LIGHTS_UPDATE_COLOR : 0);
+        updates[i].brightness = request->channels[i].brightness;
+        updates[i].color = le32_to_cpu(request->channels[i].color);
+    }
+
+    ret = device_lights_update_channels(bundle->dev, updates, request->count);
+    if (ret == -ENOSYS) {
+        ret = gb_lights_update_each(bundle->dev, updates, request->count);
+    }
+
+    free(updates);
+
+    if (ret) {
+        return gb_errno_to_op_result(ret);
+    }
+
+    return GB_OP_SUCCESS;
+}
+
 /**
  * @brief Set fade to specific channel
  *
@@ -677,6 +779,7 @@ static struct gb_operation_handler gb_lights_handlers[] = {
     GB_HANDLER(GB_LIGHTS_TYPE_SET_FLASH_STROBE, gb_lights_set_flash_strobe),
     GB_HANDLER(GB_LIGHTS_TYPE_SET_FLASH_TIMEOUT, gb_lights_set_flash_timeout),
     GB_HANDLER(GB_LIGHTS_TYPE_GET_FLASH_FAULT, gb_lights_get_flash_fault),
+    GB_HANDLER(GB_LIGHTS_TYPE_UPDATE_CHANNELS, gb_lights_update_channels),
 };
 
 static struct gb_driver gb_lights_driver = {
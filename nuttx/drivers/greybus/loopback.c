@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <semaphore.h>
 #include <sys/time.h>
 
 #include "loopback-gb.h"
@@ -41,19 +42,49 @@
 #include <nuttx/time.h>
 #include <nuttx/util.h>
 #include <arch/byteorder.h>
+#include <arch/atomic.h>
 
 #define GB_LOOPBACK_VERSION_MAJOR 0
 #define GB_LOOPBACK_VERSION_MINOR 1
 
+/*
+ * Latency histogram: values below 2 * HIST_SUB usec have their own bucket,
+ * larger ones share each power of two between HIST_SUB buckets, which keeps
+ * the error of the percentiles under 1 / HIST_SUB. Latencies are clamped
+ * to 2^HIST_MAX_BIT usec.
+ */
+#define HIST_SUB_BITS   3
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_MAX_BIT    24
+#define HIST_BUCKETS    ((HIST_MAX_BIT - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/*
+ * The statistics are updated on every message, without a lock so that the
+ * measure does not weigh on what is measured. The responses of a cport are
+ * handled by a single thread, which is the only writer of stats and
+ * latency_hist; the counters also updated on send or timeout are atomic.
+ * Readers merge them into a statistics copy, possibly a message behind.
+ */
 struct gb_loopback {
     struct list_head list;
-    pthread_mutex_t lock;
     int cport;
+    atomic_t inflight;
+    atomic_t recv;
+    atomic_t recv_err;
     struct gb_timestamp ts;
     struct gb_loopback_statistics stats;
+    unsigned latency_hist[HIST_BUCKETS];
 };
 
 struct list_head gb_loopback_list = LIST_INIT(gb_loopback_list);
+
+/* Loopback instances indexed by cport, for the message path */
+static struct gb_loopback **gb_loopback_cports;
+static unsigned int gb_loopback_cport_count;
+
+/* Set while gb_loopback_wait_completion() sleeps */
+static atomic_t gb_loopback_waiting;
+static sem_t gb_loopback_done_sem;
 static pthread_mutex_t gb_loopback_list_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static void loopback_list_lock(void)
@@ -66,16 +97,6 @@ static void loopback_list_unlock(void)
     pthread_mutex_unlock(&gb_loopback_list_mutex);
 }
 
-static void loopback_lock(struct gb_loopback *loopback)
-{
-    pthread_mutex_lock(&loopback->lock);
-}
-
-static void loopback_unlock(struct gb_loopback *loopback)
-{
-    pthread_mutex_unlock(&loopback->lock);
-}
-
 /**
  * @brief Iterate through all registered cports and call a function
  * @param cb callback function to be called for each cport
@@ -102,16 +123,59 @@ int gb_loopback_get_cports(gb_loopback_cport_cb cb, void *data)
 
 static struct gb_loopback *loopback_from_cport(int cport)
 {
-    struct gb_loopback *loopback;
-    struct list_head *iter;
+    if (cport < 0 || cport >= gb_loopback_cport_count)
+        return NULL;
 
-    list_foreach(&gb_loopback_list, iter) {
-        loopback = list_entry(iter, struct gb_loopback, list);
-        if (loopback->cport == cport) {
-            return loopback;
-        }
+    return gb_loopback_cports[cport];
+}
+
+static unsigned hist_bucket(unsigned usec)
+{
+    unsigned shift = 0;
+
+    if (usec >= 1 << HIST_MAX_BIT)
+        usec = (1 << HIST_MAX_BIT) - 1;
+
+    while ((usec >> shift) >= 2 * HIST_SUB)
+        shift++;
+
+    return shift * HIST_SUB + (usec >> shift);
+}
+
+/* Highest latency falling in a bucket */
+static unsigned hist_value(unsigned bucket)
+{
+    unsigned shift;
+
+    if (bucket < 2 * HIST_SUB)
+        return bucket;
+
+    shift = bucket / HIST_SUB - 1;
+    return ((bucket - shift * HIST_SUB) << shift) + (1 << shift) - 1;
+}
+
+/*
+ * The histogram keeps changing while it is read, but its buckets only grow:
+ * the second pass reaches at least the count of the first one.
+ */
+static unsigned hist_percentile(struct gb_loopback *loopback, unsigned count,
+                                unsigned pct)
+{
+    unsigned target;
+    unsigned sum = 0;
+    int i;
+
+    if (!count)
+        return 0;
+
+    target = (count * pct + 99) / 100;
+    for (i = 0; i < HIST_BUCKETS - 1; i++) {
+        sum += loopback->latency_hist[i];
+        if (sum >= target)
+            break;
     }
-    return NULL;
+
+    return hist_value(i);
 }
 
 /**
@@ -123,15 +187,26 @@ static struct gb_loopback *loopback_from_cport(int cport)
 int gb_loopback_get_stats(int cport, struct gb_loopback_statistics *stats)
 {
     struct gb_loopback *loopback;
+    unsigned count = 0;
+    int i;
 
     loopback = loopback_from_cport(cport);
     if (!loopback) {
         return -EINVAL;
     }
 
-    loopback_lock(loopback);
     memcpy(stats, &loopback->stats, sizeof(struct gb_loopback_statistics));
-    loopback_unlock(loopback);
+    stats->recv = atomic_get(&loopback->recv);
+    stats->recv_err = atomic_get(&loopback->recv_err);
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+        count += loopback->latency_hist[i];
+    stats->latency_p50 = MIN(hist_percentile(loopback, count, 50),
+                             stats->latency_peak);
+    stats->latency_p90 = MIN(hist_percentile(loopback, count, 90),
+                             stats->latency_peak);
+    stats->latency_p99 = MIN(hist_percentile(loopback, count, 99),
+                             stats->latency_peak);
 
     return 0;
 }
@@ -140,22 +215,72 @@ static void loopback_error_notify(int cport)
 {
     struct gb_loopback *loopback = loopback_from_cport(cport);
 
-    if (loopback != NULL) {
-        loopback_lock(loopback);
-        loopback->stats.recv_err++;
-        loopback_unlock(loopback);
-    }
+    if (loopback != NULL)
+        atomic_inc(&loopback->recv_err);
 }
 
 static void loopback_recv_inc(int cport)
 {
     struct gb_loopback *loopback = loopback_from_cport(cport);
 
-    if (loopback != NULL) {
-        loopback_lock(loopback);
-        loopback->stats.recv++;
-        loopback_unlock(loopback);
-    }
+    if (loopback != NULL)
+        atomic_inc(&loopback->recv);
+}
+
+static void loopback_inflight_add(int cport, int count)
+{
+    struct gb_loopback *loopback = loopback_from_cport(cport);
+
+    if (loopback != NULL)
+        atomic_add(&loopback->inflight, count);
+}
+
+/* Called once a request is answered or has timed out */
+static void loopback_done(int cport)
+{
+    loopback_inflight_add(cport, -1);
+
+    /* only wake up the sender when it waits, to keep this path cheap */
+    if (atomic_get(&gb_loopback_waiting) &&
+        atomic_cmpxchg(&gb_loopback_waiting, 1, 0) == 1)
+        sem_post(&gb_loopback_done_sem);
+}
+
+/**
+ * @brief Get the number of requests waiting for their response on a cport
+ * @param cport cport number
+ * @return number of requests in flight, 0 for invalid cports
+ */
+int gb_loopback_inflight(int cport)
+{
+    struct gb_loopback *loopback = loopback_from_cport(cport);
+
+    return loopback != NULL ? (int)atomic_get(&loopback->inflight) : 0;
+}
+
+/**
+ * @brief Wait for a request of any cport to complete
+ *
+ * The caller checks again what it waits for when this returns, since a
+ * request completing between that check and this call is not seen.
+ *
+ * @param timeout longest time to wait, in usec
+ */
+void gb_loopback_wait_completion(useconds_t timeout)
+{
+    struct timespec abstime;
+    struct timespec delay;
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    usec_to_timespec(timeout, &delay);
+    timespecadd(&abstime, &delay, &abstime);
+
+    atomic_init(&gb_loopback_waiting, 1);
+    sem_timedwait(&gb_loopback_done_sem, &abstime);
+    atomic_init(&gb_loopback_waiting, 0);
+
+    /* drop a post that came after the timeout */
+    sem_trywait(&gb_loopback_done_sem);
 }
 
 /**
@@ -167,9 +292,10 @@ void gb_loopback_reset(int cport)
     struct gb_loopback *loopback = loopback_from_cport(cport);
 
     if (loopback != NULL) {
-        loopback_lock(loopback);
         memset(&loopback->stats, 0, sizeof(struct gb_loopback_statistics));
-        loopback_unlock(loopback);
+        memset(loopback->latency_hist, 0, sizeof(loopback->latency_hist));
+        atomic_init(&loopback->recv, 0);
+        atomic_init(&loopback->recv_err, 0);
     }
 }
 
@@ -243,6 +369,9 @@ static void update_loopback_stats(struct gb_operation *operation, int xfer)
     UPDATE_MAX(stats->latency_max, stats->latency_avg);
     UPDATE_MAX(stats->throughput_max, stats->throughput_avg);
     UPDATE_MAX(stats->reqs_per_sec_max, stats->reqs_per_sec_avg);
+    UPDATE_MAX(stats->latency_peak, total);
+
+    loopback->latency_hist[hist_bucket(total)]++;
 
 #undef UPDATE_AVG
 #undef UPDATE_MIN
@@ -268,6 +397,7 @@ static void gb_loopback_ping_sink_resp_cb(struct gb_operation *operation)
         loopback_recv_inc(operation->cport);
         update_loopback_stats(operation, 0 /* not xfer */);
     }
+    loopback_done(operation->cport);
 }
 
 static void gb_loopback_transfer_resp_cb(struct gb_operation *operation)
@@ -275,6 +405,13 @@ static void gb_loopback_transfer_resp_cb(struct gb_operation *operation)
     struct gb_loopback_transfer_response *response;
     struct gb_loopback_transfer_request *request;
 
+    /* no response when the request has timed out */
+    if (!operation->response) {
+        loopback_error_notify(operation->cport);
+        loopback_done(operation->cport);
+        return;
+    }
+
     request = gb_operation_get_request_payload(operation);
     response = gb_operation_get_request_payload(operation->response);
 
@@ -285,6 +422,7 @@ static void gb_loopback_transfer_resp_cb(struct gb_operation *operation)
         loopback_recv_inc(operation->cport);
         update_loopback_stats(operation, 1 /* xfer */);
     }
+    loopback_done(operation->cport);
 }
 
 /**
@@ -314,6 +452,9 @@ int gb_loopback_send_req(int cport, size_t size, uint8_t type)
     if (!operation)
         return -ENOMEM;
 
+    /* the response may come before the send returns */
+    loopback_inflight_add(cport, 1);
+
     switch(type) {
     case GB_LOOPBACK_TYPE_PING:
         status = gb_operation_send_request(operation,
@@ -346,8 +487,10 @@ int gb_loopback_send_req(int cport, size_t size, uint8_t type)
         break;
     }
 
-    if (status != OK)
+    if (status != OK) {
+        loopback_inflight_add(cport, -1);
         retval = ERROR;
+    }
 
     gb_operation_destroy(operation);
     return retval;
@@ -440,17 +583,32 @@ void gb_loopback_log_exit(unsigned int cport, struct gb_operation *operation, si
 
 void gb_loopback_register(int cport, int bundle)
 {
-    struct gb_loopback *loopback = zalloc(sizeof(*loopback));
+    struct gb_loopback *loopback;
     irqstate_t flags;
 
-    if (loopback) {
+    /* cports are registered before any message goes through them */
+    if (!gb_loopback_cports) {
+        gb_loopback_cports = zalloc(gb_cport_count() *
+                                    sizeof(*gb_loopback_cports));
+        if (!gb_loopback_cports)
+            goto out;
+        gb_loopback_cport_count = gb_cport_count();
+        sem_init(&gb_loopback_done_sem, 0, 0);
+    }
+
+    loopback = zalloc(sizeof(*loopback));
+    if (loopback && cport < gb_loopback_cport_count) {
         loopback->cport = cport;
-        pthread_mutex_init(&loopback->lock, NULL);
         loopback->ts.tag = true;
         flags = irqsave();
         list_add(&gb_loopback_list, &loopback->list);
+        gb_loopback_cports[cport] = loopback;
         irqrestore(flags);
+    } else {
+        free(loopback);
     }
+
+out:
     gb_timestamp_init();
     gb_register_driver(cport, bundle, &loopback_driver);
 }
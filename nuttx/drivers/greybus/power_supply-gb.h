@@ -41,6 +41,9 @@
 #define GB_POWER_SUPPLY_TYPE_SET_PROPERTY         0x06
 #define GB_POWER_SUPPLY_TYPE_EVENT                0x07
 
+/* Greybus power supply events */
+#define GB_POWER_SUPPLY_UPDATE                    0x01
+
 struct gb_power_supply_version_response {
     __u8 major;
     __u8 minor;
@@ -30,8 +30,12 @@
 #include <debug.h>
 #include <stdlib.h>
 #include <string.h>
+#include <semaphore.h>
 
+#include <arch/irq.h>
 #include <arch/byteorder.h>
+#include <nuttx/clock.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/greybus/greybus.h>
 #include <apps/greybus-utils/utils.h>
 
@@ -44,30 +48,83 @@
 
 #define DESC_LEN 32
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+#define CACHE_PERIOD MSEC2TICK(CONFIG_GREYBUS_POWER_SUPPLY_CACHE_PERIOD)
+
+/* One bit per supply in the pending events mask */
+#define CACHE_MAX_SUPPLIES 32
+
+/**
+ * Properties whose changes are pushed to the AP. The others (voltage,
+ * current, temperature...) move at every sample and are only refreshed.
+ */
+static const uint8_t notify_props[] = {
+    0x00, /* STATUS */
+    0x02, /* HEALTH */
+    0x03, /* PRESENT */
+    0x04, /* ONLINE */
+    0x2a, /* CAPACITY */
+    0x2d, /* CAPACITY_LEVEL */
+};
+
+/**
+ * Cached value of a power supply property.
+ */
+struct gb_power_supply_prop {
+    uint8_t property;
+    uint8_t is_writeable;
+    /** False until read successfully from the device */
+    bool valid;
+    uint32_t value;
+};
+
+/**
+ * Cached description and properties of a power supply.
+ */
+struct gb_power_supply_cache {
+    struct power_supply_description description;
+    struct gb_power_supply_prop *props;
+};
+#endif
+
 /**
  * Power supply protocol private information.
  */
 struct gb_power_supply_info {
     /** CPort from greybus */
     unsigned int cport;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    /** Power supply device */
+    struct device *dev;
+    /** Serializes the cache and the device accesses */
+    sem_t lock;
+    /** Periodic refresh */
+    struct work_s work;
+    /** Refresh on device events */
+    struct work_s event_work;
+    /** Supplies which reported an event since the last refresh */
+    uint32_t events;
+    /** Set when the protocol is torn down */
+    bool stopping;
+    /** Number of cached supplies, 0 if the cache is not available */
+    uint8_t supplies_count;
+    struct gb_power_supply_cache *supplies;
+#endif
 };
 
 /**
- * @brief Event callback function for power supply device driver.
+ * @brief Send a power supply event to the AP.
  *
- * @param data pointer to gb_power_supply_info
+ * @param info pointer to gb_power_supply_info
  * @param psy_id Power supply identification number.
  * @param event Event type.
  * @return 0 on success, negative errno on error.
  */
-static int event_callback(void *data, uint8_t psy_id, uint8_t event)
+static int gb_power_supply_send_event(struct gb_power_supply_info *info,
+                                      uint8_t psy_id, uint8_t event)
 {
     struct gb_operation *operation;
     struct gb_power_supply_event_request *request;
-    struct gb_power_supply_info *info;
-
-    DEBUGASSERT(data);
-    info = data;
 
     operation = gb_operation_create(info->cport, GB_POWER_SUPPLY_TYPE_EVENT,
                                     sizeof(*request));
@@ -85,6 +142,276 @@ static int event_callback(void *data, uint8_t psy_id, uint8_t event)
     return 0;
 }
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+static bool gb_power_supply_notifies(uint8_t property)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(notify_props); i++) {
+        if (notify_props[i] == property)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Find the cached value of a property.
+ *
+ * @param info pointer to gb_power_supply_info
+ * @param psy_id Power supply identification number.
+ * @param property Property identifier.
+ * @return the cached property, NULL if the property is not cached.
+ */
+static struct gb_power_supply_prop *
+gb_power_supply_cache_find(struct gb_power_supply_info *info, uint8_t psy_id,
+                           uint8_t property)
+{
+    struct gb_power_supply_cache *psy;
+    int i;
+
+    if (psy_id >= info->supplies_count)
+        return NULL;
+
+    psy = &info->supplies[psy_id];
+    for (i = 0; i < psy->description.properties_count; i++) {
+        if (psy->props[i].property == property)
+            return &psy->props[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Read back all the properties of a supply.
+ *
+ * Must be called with info->lock held.
+ *
+ * @param info pointer to gb_power_supply_info
+ * @param psy_id Power supply identification number.
+ * @return true if a notified property changed, false otherwise.
+ */
+static bool gb_power_supply_cache_update(struct gb_power_supply_info *info,
+                                         uint8_t psy_id)
+{
+    struct gb_power_supply_cache *psy = &info->supplies[psy_id];
+    struct gb_power_supply_prop *prop;
+    bool changed = false;
+    uint32_t value;
+    int i;
+
+    for (i = 0; i < psy->description.properties_count; i++) {
+        prop = &psy->props[i];
+
+        /* a failed read is retried by the next request of the AP */
+        if (device_power_supply_get_property(info->dev, psy_id,
+                                             prop->property, &value)) {
+            prop->valid = false;
+            continue;
+        }
+
+        if (prop->valid && prop->value != value &&
+            gb_power_supply_notifies(prop->property)) {
+            changed = true;
+        }
+
+        prop->value = value;
+        prop->valid = true;
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Refresh the cache and notify the AP of the changes.
+ *
+ * Must be called with info->lock held.
+ *
+ * @param info pointer to gb_power_supply_info
+ */
+static void gb_power_supply_cache_refresh(struct gb_power_supply_info *info)
+{
+    irqstate_t flags;
+    uint32_t events;
+    int i;
+
+    flags = irqsave();
+    events = info->events;
+    info->events = 0;
+    irqrestore(flags);
+
+    for (i = 0; i < info->supplies_count; i++) {
+        if (gb_power_supply_cache_update(info, i))
+            events |= 1 << i;
+    }
+
+    for (i = 0; i < info->supplies_count; i++) {
+        if (events & (1 << i))
+            gb_power_supply_send_event(info, i, GB_POWER_SUPPLY_UPDATE);
+    }
+}
+
+static void gb_power_supply_cache_worker(void *data)
+{
+    struct gb_power_supply_info *info = data;
+
+    sem_wait(&info->lock);
+    if (!info->stopping) {
+        gb_power_supply_cache_refresh(info);
+        work_queue(HPWORK, &info->work, gb_power_supply_cache_worker, info,
+                   CACHE_PERIOD);
+    }
+    sem_post(&info->lock);
+}
+
+static void gb_power_supply_event_worker(void *data)
+{
+    struct gb_power_supply_info *info = data;
+
+    sem_wait(&info->lock);
+    if (!info->stopping)
+        gb_power_supply_cache_refresh(info);
+    sem_post(&info->lock);
+}
+
+/**
+ * @brief Fill the cache with the descriptions and properties of all supplies.
+ *
+ * On failure the cache stays empty and the requests go to the device.
+ *
+ * @param info pointer to gb_power_supply_info
+ * @return 0 on success, negative errno on error.
+ */
+static int gb_power_supply_cache_init(struct gb_power_supply_info *info)
+{
+    struct gb_power_supply_cache *supplies;
+    struct power_supply_props_desc *descriptors;
+    struct gb_power_supply_cache *psy;
+    uint8_t supplies_count;
+    int i, j, ret;
+
+    ret = device_power_supply_get_supplies(info->dev, &supplies_count);
+    if (ret)
+        return ret;
+
+    if (supplies_count > CACHE_MAX_SUPPLIES)
+        return -E2BIG;
+
+    supplies = zalloc(supplies_count * sizeof(*supplies));
+    if (!supplies)
+        return -ENOMEM;
+
+    for (i = 0; i < supplies_count; i++) {
+        psy = &supplies[i];
+
+        ret = device_power_supply_get_description(info->dev, i,
+                                                  &psy->description);
+        if (ret)
+            goto err_free_supplies;
+
+        ret = device_power_supply_get_properties_count(info->dev, i,
+                                           &psy->description.properties_count);
+        if (ret)
+            goto err_free_supplies;
+
+        psy->props = zalloc(psy->description.properties_count *
+                            sizeof(*psy->props));
+        descriptors = malloc(psy->description.properties_count *
+                             sizeof(*descriptors));
+        if (!psy->props || !descriptors) {
+            free(descriptors);
+            ret = -ENOMEM;
+            goto err_free_supplies;
+        }
+
+        ret = device_power_supply_get_prop_descriptors(info->dev, i,
+                                                       descriptors);
+        if (ret) {
+            free(descriptors);
+            goto err_free_supplies;
+        }
+
+        for (j = 0; j < psy->description.properties_count; j++) {
+            psy->props[j].property = descriptors[j].property;
+            psy->props[j].is_writeable = descriptors[j].is_writeable;
+        }
+
+        free(descriptors);
+    }
+
+    info->supplies = supplies;
+    info->supplies_count = supplies_count;
+
+    for (i = 0; i < supplies_count; i++)
+        gb_power_supply_cache_update(info, i);
+
+    return 0;
+
+err_free_supplies:
+    for (i = 0; i < supplies_count; i++)
+        free(supplies[i].props);
+    free(supplies);
+
+    return ret;
+}
+
+static void gb_power_supply_cache_exit(struct gb_power_supply_info *info)
+{
+    int i;
+
+    sem_wait(&info->lock);
+    info->stopping = true;
+    work_cancel(HPWORK, &info->work);
+    work_cancel(HPWORK, &info->event_work);
+    sem_post(&info->lock);
+
+    for (i = 0; i < info->supplies_count; i++)
+        free(info->supplies[i].props);
+    free(info->supplies);
+
+    sem_destroy(&info->lock);
+}
+#endif
+
+/**
+ * @brief Event callback function for power supply device driver.
+ *
+ * With the cache, the properties of the supply are read back before the
+ * event is sent to the AP, so that its requests are answered with fresh
+ * values.
+ *
+ * @param data pointer to gb_power_supply_info
+ * @param psy_id Power supply identification number.
+ * @param event Event type.
+ * @return 0 on success, negative errno on error.
+ */
+static int event_callback(void *data, uint8_t psy_id, uint8_t event)
+{
+    struct gb_power_supply_info *info;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    irqstate_t flags;
+#endif
+
+    DEBUGASSERT(data);
+    info = data;
+
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    if (psy_id < info->supplies_count) {
+        flags = irqsave();
+        info->events |= 1 << psy_id;
+        if (work_available(&info->event_work)) {
+            work_queue(HPWORK, &info->event_work,
+                       gb_power_supply_event_worker, info, 0);
+        }
+        irqrestore(flags);
+
+        return 0;
+    }
+#endif
+
+    return gb_power_supply_send_event(info, psy_id, event);
+}
+
 /**
  * @brief Protocol get version function.
  *
@@ -122,6 +449,9 @@ static uint8_t gb_power_supply_get_supplies(struct gb_operation *operation)
 {
     struct gb_power_supply_get_supplies_response *response;
     struct gb_bundle *bundle;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    struct gb_power_supply_info *info;
+#endif
     int ret = 0;
     uint8_t supplies_count = 0;
 
@@ -133,6 +463,14 @@ static uint8_t gb_power_supply_get_supplies(struct gb_operation *operation)
         return GB_OP_NO_MEMORY;
     }
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info = bundle->priv;
+    if (info->supplies_count) {
+        response->supplies_count = info->supplies_count;
+        return GB_OP_SUCCESS;
+    }
+#endif
+
     ret = device_power_supply_get_supplies(bundle->dev, &supplies_count);
 
     response->supplies_count = supplies_count;
@@ -155,6 +493,9 @@ static uint8_t gb_power_supply_get_description(struct gb_operation *operation)
     struct gb_power_supply_get_description_response *response;
     struct gb_bundle *bundle;
     struct power_supply_description description;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    struct gb_power_supply_info *info;
+#endif
     int ret = 0;
 
     bundle = gb_operation_get_bundle(operation);
@@ -167,10 +508,19 @@ static uint8_t gb_power_supply_get_description(struct gb_operation *operation)
         return GB_OP_INVALID;
     }
 
-    ret = device_power_supply_get_description(bundle->dev,
-                                              request->psy_id, &description);
-    if (ret) {
-        return gb_errno_to_op_result(ret);
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info = bundle->priv;
+    if (request->psy_id < info->supplies_count) {
+        description = info->supplies[request->psy_id].description;
+    } else
+#endif
+    {
+        ret = device_power_supply_get_description(bundle->dev,
+                                                  request->psy_id,
+                                                  &description);
+        if (ret) {
+            return gb_errno_to_op_result(ret);
+        }
     }
 
     response = gb_operation_alloc_response(operation, sizeof(*response));
@@ -204,6 +554,10 @@ static uint8_t gb_power_supply_get_prop_descriptors(struct gb_operation *
     struct gb_power_supply_get_property_descriptors_response *response;
     struct gb_bundle *bundle;
     struct power_supply_props_desc *descriptors;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    struct gb_power_supply_info *info;
+    struct gb_power_supply_cache *psy;
+#endif
     int i = 0, ret = 0;
     uint8_t properties_count = 0;
 
@@ -217,6 +571,28 @@ static uint8_t gb_power_supply_get_prop_descriptors(struct gb_operation *
         return GB_OP_INVALID;
     }
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info = bundle->priv;
+    if (request->psy_id < info->supplies_count) {
+        psy = &info->supplies[request->psy_id];
+        properties_count = psy->description.properties_count;
+
+        response = gb_operation_alloc_response(operation,
+                  sizeof(*response) + properties_count * sizeof(*descriptors));
+        if (!response) {
+            return GB_OP_NO_MEMORY;
+        }
+
+        response->properties_count = properties_count;
+        for (i = 0; i < properties_count; i++) {
+            response->props[i].property = psy->props[i].property;
+            response->props[i].is_writeable = psy->props[i].is_writeable;
+        }
+
+        return GB_OP_SUCCESS;
+    }
+#endif
+
     ret = device_power_supply_get_properties_count(bundle->dev, request->psy_id,
                                                    &properties_count);
     if (ret) {
@@ -267,6 +643,10 @@ static uint8_t gb_power_supply_get_property(struct gb_operation *operation)
     struct gb_power_supply_get_property_request *request;
     struct gb_power_supply_get_property_response *response;
     struct gb_bundle *bundle;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    struct gb_power_supply_info *info;
+    struct gb_power_supply_prop *prop;
+#endif
     int ret = 0;
     uint32_t prop_val = 0;
     uint8_t property = 0;
@@ -282,8 +662,27 @@ static uint8_t gb_power_supply_get_property(struct gb_operation *operation)
     }
 
     property = request->property;
+
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info = bundle->priv;
+
+    sem_wait(&info->lock);
+    prop = gb_power_supply_cache_find(info, request->psy_id, property);
+    if (prop && prop->valid) {
+        prop_val = prop->value;
+    } else {
+        ret = device_power_supply_get_property(bundle->dev, request->psy_id,
+                                               property, &prop_val);
+        if (!ret && prop) {
+            prop->value = prop_val;
+            prop->valid = true;
+        }
+    }
+    sem_post(&info->lock);
+#else
     ret = device_power_supply_get_property(bundle->dev, request->psy_id,
                                            property, &prop_val);
+#endif
     if (ret) {
         return gb_errno_to_op_result(ret);
     }
@@ -312,6 +711,10 @@ static uint8_t gb_power_supply_set_property(struct gb_operation *operation)
 {
     struct gb_power_supply_set_property_request *request;
     struct gb_bundle *bundle;
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    struct gb_power_supply_info *info;
+    struct gb_power_supply_prop *prop;
+#endif
     int ret = 0;
     uint32_t prop_val = 0;
     uint8_t property = 0;
@@ -328,8 +731,23 @@ static uint8_t gb_power_supply_set_property(struct gb_operation *operation)
 
     property = request->property;
     prop_val = le32_to_cpu(request->prop_val);
+
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info = bundle->priv;
+
+    sem_wait(&info->lock);
     ret = device_power_supply_set_property(bundle->dev, request->psy_id,
                                            property, prop_val);
+    prop = gb_power_supply_cache_find(info, request->psy_id, property);
+    if (!ret && prop) {
+        prop->value = prop_val;
+        prop->valid = true;
+    }
+    sem_post(&info->lock);
+#else
+    ret = device_power_supply_set_property(bundle->dev, request->psy_id,
+                                           property, prop_val);
+#endif
     if (ret) {
         return gb_errno_to_op_result(ret);
     }
@@ -367,15 +785,37 @@ static int gb_power_supply_init(unsigned int cport, struct gb_bundle *bundle)
         goto err_free_info;
     }
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    info->dev = bundle->dev;
+    sem_init(&info->lock, 0, 1);
+
+    ret = gb_power_supply_cache_init(info);
+    if (ret) {
+        gb_info("power supply properties not cached: %d\n", ret);
+    }
+#endif
+
+    bundle->priv = info;
+
     ret = device_power_supply_attach_callback(bundle->dev, event_callback,
                                               info);
     if (ret) {
         goto err_close_device;
     }
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    if (info->supplies_count) {
+        work_queue(HPWORK, &info->work, gb_power_supply_cache_worker, info,
+                   CACHE_PERIOD);
+    }
+#endif
+
     return 0;
 
 err_close_device:
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    gb_power_supply_cache_exit(info);
+#endif
     device_close(bundle->dev);
 
 err_free_info:
@@ -404,6 +844,10 @@ static void gb_power_supply_exit(unsigned int cport, struct gb_bundle *bundle)
 
     device_power_supply_attach_callback(bundle->dev, NULL, NULL);
 
+#ifdef CONFIG_GREYBUS_POWER_SUPPLY_CACHE
+    gb_power_supply_cache_exit(info);
+#endif
+
     device_close(bundle->dev);
 
     free(info);
@@ -39,6 +39,14 @@
 #define GB_PWM_PROTOCOL_POLARITY        0x06
 #define GB_PWM_PROTOCOL_ENABLE          0x07
 #define GB_PWM_PROTOCOL_DISABLE         0x08
+#define GB_PWM_PROTOCOL_UPDATE          0x10
+
+/** Update flags */
+#define GB_PWM_UPDATE_CONFIG            0x01
+#define GB_PWM_UPDATE_POLARITY          0x02
+#define GB_PWM_UPDATE_INVERTED          0x04
+#define GB_PWM_UPDATE_ENABLE            0x08
+#define GB_PWM_UPDATE_DISABLE           0x10
 
 struct gb_pwm_version_request {
     /** Offered PWM Protocol major version. */
@@ -121,5 +129,28 @@ struct gb_pwm_disable_request {
     __u8    which;
 } __packed;
 
+/**
+ * Settings of one generator in an update request.
+ */
+struct gb_pwm_update {
+    /** Controller-relative PWM generator number */
+    __u8    which;
+    /** GB_PWM_UPDATE_* settings to apply */
+    __u8    flags;
+    /** Active time (in nanoseconds), with GB_PWM_UPDATE_CONFIG. */
+    __le32  duty;
+    /** Period (in nanoseconds), with GB_PWM_UPDATE_CONFIG. */
+    __le32  period;
+} __packed;
+
+/**
+ * Update response has no payload.
+ */
+struct gb_pwm_update_request {
+    /** Number of generators to update */
+    __u8    count;
+    struct gb_pwm_update updates[0];
+} __packed;
+
 #endif /* _GREYBUS_PWM_H_ */
 
@@ -427,6 +427,133 @@ static uint8_t gb_pwm_protocol_disable(struct gb_operation *operation)
     return GB_OP_SUCCESS;
 }
 
+/**
+ * @brief Apply an update one setting at a time.
+ *
+ * Fallback for the controllers without an update operation, which can
+ * neither reject the update as a whole nor latch the settings together.
+ *
+ * @param dev Pointer to the PWM device controller.
+ * @param updates Settings to apply.
+ * @param count Number of entries in updates.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+static int gb_pwm_update_each(struct device *dev,
+                              const struct pwm_update *updates,
+                              uint16_t count)
+{
+    int ret = 0;
+    int i;
+
+    for (i = 0; i < count && !ret; i++) {
+        if (updates[i].flags & PWM_UPDATE_DISABLE) {
+            ret = device_pwm_disable(dev, updates[i].which);
+        }
+
+        if (!ret && (updates[i].flags & PWM_UPDATE_CONFIG)) {
+            ret = device_pwm_config(dev, updates[i].which, updates[i].duty,
+                                    updates[i].period);
+        }
+
+        if (!ret && (updates[i].flags & PWM_UPDATE_POLARITY)) {
+            ret = device_pwm_set_polarity(dev, updates[i].which,
+                                          updates[i].flags &
+                                          PWM_UPDATE_INVERTED);
+        }
+
+        if (!ret && (updates[i].flags & PWM_UPDATE_ENABLE)) {
+            ret = device_pwm_enable(dev, updates[i].which);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Apply the settings of several generators in one operation.
+ *
+ * This function will parse the gb_pwm_update_request to get the settings
+ * of each generator, and then calls PWM controller driver to apply them all
+ * at once, so that animating several channels neither costs a round trip per
+ * setting nor shows the channels switching one after the other.
+ *
+ * @param operation Pointer to structure of gb_operation.
+ *
+ * @return GB_OP_SUCCESS on success, error code on failure.
+ */
+static uint8_t gb_pwm_protocol_update(struct gb_operation *operation)
+{
+    struct gb_pwm_info *pwm_info;
+    struct gb_pwm_update_request *request;
+    struct pwm_update *updates;
+    struct gb_bundle *bundle;
+    size_t size;
+    uint8_t flags;
+    int ret;
+    int i;
+
+    size = gb_operation_get_request_payload_size(operation);
+    request = gb_operation_get_request_payload(operation);
+
+    if (size < sizeof(*request) ||
+        size < sizeof(*request) +
+               request->count * sizeof(request->updates[0])) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    pwm_info = bundle->priv;
+
+    if (!pwm_info || !bundle->dev) {
+        return GB_OP_UNKNOWN_ERROR;
+    }
+
+    if (!request->count) {
+        return GB_OP_SUCCESS;
+    }
+
+    updates = malloc(request->count * sizeof(*updates));
+    if (!updates) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    for (i = 0; i < request->count; i++) {
+        if (request->updates[i].which >= pwm_info->num_pwms) {
+            free(updates);
+            return GB_OP_INVALID;
+        }
+
+        flags = request->updates[i].flags;
+        updates[i].which = request->updates[i].which;
+        updates[i].flags =
+            (flags & GB_PWM_UPDATE_CONFIG ? PWM_UPDATE_CONFIG : 0) |
+            (flags & GB_PWM_UPDATE_POLARITY ? PWM_UPDATE_POLARITY : 0) |
+            (flags & GB_PWM_UPDATE_INVERTED ? PWM_UPDATE_INVERTED : 0) |
+            (flags & GB_PWM_UPDATE_ENABLE ? PWM_UPDATE_ENABLE : 0) |
+            (flags & GB_PWM_UPDATE_DISABLE ? PWM_UPDATE_DISABLE : 0);
+        updates[i].duty = le32_to_cpu(request->updates[i].duty);
+        updates[i].period = le32_to_cpu(request->updates[i].period);
+    }
+
+    ret = device_pwm_update(bundle->dev, updates, request->count);
+    if (ret == -ENOSYS) {
+        ret = gb_pwm_update_each(bundle->dev, updates, request->count);
+    }
+
+    free(updates);
+
+    if (ret) {
+        gb_info("%s(): %x error in ops\n", __func__, ret);
+        return ret == -EINVAL ? GB_OP_INVALID : GB_OP_UNKNOWN_ERROR;
+    }
+
+    return GB_OP_SUCCESS;
+}
+
 /**
  * @brief Initial the PWM protocol code and open device driver.
  *
@@ -506,6 +633,7 @@ static struct gb_operation_handler gb_pwm_handlers[] = {
     GB_HANDLER(GB_PWM_PROTOCOL_POLARITY, gb_pwm_protocol_polarity),
     GB_HANDLER(GB_PWM_PROTOCOL_ENABLE, gb_pwm_protocol_enable),
     GB_HANDLER(GB_PWM_PROTOCOL_DISABLE, gb_pwm_protocol_disable),
+    GB_HANDLER(GB_PWM_PROTOCOL_UPDATE, gb_pwm_protocol_update),
 };
 
 
@@ -518,6 +646,7 @@ static struct gb_driver gb_pwm_driver = {
     .exit = gb_pwm_exit,
     .op_handlers = gb_pwm_handlers,
     .op_handlers_count = ARRAY_SIZE(gb_pwm_handlers),
+    .batch_responses = true,
 };
 
 
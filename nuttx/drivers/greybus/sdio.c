@@ -30,14 +30,20 @@
 #include <string.h>
 #include <errno.h>
 #include <debug.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <nuttx/config.h>
 #include <nuttx/device.h>
 #include <nuttx/device_sdio.h>
 #include <nuttx/greybus/greybus.h>
+#include <nuttx/list.h>
+#include <nuttx/tpool.h>
+#include <nuttx/util.h>
 #include <apps/greybus-utils/utils.h>
 
 #include <arch/byteorder.h>
+#include <arch/irq.h>
 
 #include "sdio-gb.h"
 
@@ -48,12 +54,53 @@
 #define MAX_BLOCK_SIZE_1        1024
 #define MAX_BLOCK_SIZE_2        2048
 
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+#define GB_SDIO_WRITE_BUF_SIZE  (GB_MAX_PAYLOAD_SIZE - \
+                                 sizeof(struct gb_sdio_transfer_request))
+
+/**
+ * Pre-posted buffer holding the data of a pipelined write transfer.
+ */
+struct gb_sdio_write_buf {
+    /** Entry in the free or pending list */
+    struct list_head list;
+    /** Number of blocks to write */
+    uint16_t blocks;
+    /** Size of the blocks */
+    uint16_t blksz;
+    /** Data to write */
+    uint8_t data[GB_SDIO_WRITE_BUF_SIZE];
+};
+#endif
+
 /**
  * SDIO protocol private information.
  */
 struct gb_sdio_info {
     /** CPort from greybus */
     unsigned int    cport;
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    /** SDIO host controller device */
+    struct device   *dev;
+    /** Write buffers */
+    struct gb_sdio_write_buf *bufs;
+    /** Buffers available for the next write transfer */
+    struct list_head free_bufs;
+    /** Buffers waiting to be written to the card */
+    struct list_head pending_bufs;
+    /** Counts the free buffers */
+    sem_t           free_sem;
+    /** Counts the pending buffers */
+    sem_t           pending_sem;
+    /** Data of the current data command still to be transferred */
+    uint32_t        data_left;
+    /** First error of the pipelined writes */
+    int             write_err;
+    /** Write thread exit flag */
+    bool            thread_stop;
+    /** Write thread handle */
+    pthread_t       write_thread;
+#endif
 };
 
 /**
@@ -77,6 +124,251 @@ static uint16_t scale_max_sd_block_length(uint16_t value)
     return MAX_BLOCK_SIZE_2;
 }
 
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+/**
+ * @brief Wait for the pipelined writes to complete
+ *
+ * @param info Pointer to gb_sdio_info.
+ * @return The first error of the writes since the last flush, 0 if none.
+ */
+static int gb_sdio_pipeline_flush(struct gb_sdio_info *info)
+{
+    int ret;
+    int i;
+
+    /* All the buffers are back once every write has completed */
+    for (i = 0; i < CONFIG_GREYBUS_SDIO_WRITE_BUFS; i++) {
+        while (sem_wait(&info->free_sem) != OK);
+    }
+
+    for (i = 0; i < CONFIG_GREYBUS_SDIO_WRITE_BUFS; i++) {
+        sem_post(&info->free_sem);
+    }
+
+    ret = info->write_err;
+    info->write_err = 0;
+
+    return ret;
+}
+
+/**
+ * @brief Queue the data of a write transfer to the card
+ *
+ * The data is copied to a pre-posted buffer so that the request can be
+ * answered while it is being written. The last chunk of a data command waits
+ * for all the writes of the command to complete.
+ *
+ * @param info Pointer to gb_sdio_info.
+ * @param transfer Pointer to structure of transfer.
+ * @return 0 on success, negative errno on error.
+ */
+static int gb_sdio_queue_write(struct gb_sdio_info *info,
+                               struct sdio_transfer *transfer)
+{
+    struct gb_sdio_write_buf *buf;
+    uint32_t len = transfer->blocks * transfer->blksz;
+    irqstate_t flags;
+
+    if (len > GB_SDIO_WRITE_BUF_SIZE) {
+        return -EINVAL;
+    }
+
+    while (sem_wait(&info->free_sem) != OK) {
+        if (errno != EINTR) {
+            return -errno;
+        }
+    }
+
+    flags = irqsave();
+    buf = list_entry(info->free_bufs.next, struct gb_sdio_write_buf, list);
+    list_del(&buf->list);
+    irqrestore(flags);
+
+    buf->blocks = transfer->blocks;
+    buf->blksz = transfer->blksz;
+    memcpy(buf->data, transfer->data, len);
+
+    flags = irqsave();
+    list_add(&info->pending_bufs, &buf->list);
+    irqrestore(flags);
+
+    sem_post(&info->pending_sem);
+
+    /* Let the AP send the next chunk while this one is written */
+    if (len < info->data_left) {
+        info->data_left -= len;
+        return 0;
+    }
+
+    info->data_left = 0;
+
+    return gb_sdio_pipeline_flush(info);
+}
+
+/**
+ * @brief Pipelined write thread
+ *
+ * Writes the queued buffers to the card, in order, and puts them back in the
+ * free list.
+ *
+ * @param data Pointer to gb_sdio_info.
+ * @return None.
+ */
+static void *gb_sdio_write_thread(void *data)
+{
+    struct gb_sdio_info *info = data;
+    struct gb_sdio_write_buf *buf;
+    struct sdio_transfer transfer;
+    irqstate_t flags;
+    int ret;
+
+    while (1) {
+        sem_wait(&info->pending_sem);
+        if (info->thread_stop) {
+            break;
+        }
+
+        flags = irqsave();
+        if (list_is_empty(&info->pending_bufs)) {
+            irqrestore(flags);
+            continue;
+        }
+        buf = list_entry(info->pending_bufs.next, struct gb_sdio_write_buf,
+                         list);
+        list_del(&buf->list);
+        irqrestore(flags);
+
+        transfer.blocks = buf->blocks;
+        transfer.blksz = buf->blksz;
+        transfer.data = buf->data;
+        transfer.dma = NULL;
+        transfer.callback = NULL;
+        ret = device_sdio_write(info->dev, &transfer);
+        if (ret && !info->write_err) {
+            info->write_err = ret;
+        }
+
+        flags = irqsave();
+        list_add(&info->free_bufs, &buf->list);
+        irqrestore(flags);
+
+        sem_post(&info->free_sem);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Allocate the write buffers and start the write thread
+ *
+ * @param info Pointer to gb_sdio_info.
+ * @return 0 on success, negative errno on error.
+ */
+static int gb_sdio_pipeline_init(struct gb_sdio_info *info)
+{
+    int ret;
+    int i;
+
+    info->bufs = zalloc(CONFIG_GREYBUS_SDIO_WRITE_BUFS * sizeof(*info->bufs));
+    if (!info->bufs) {
+        return -ENOMEM;
+    }
+
+    list_init(&info->free_bufs);
+    list_init(&info->pending_bufs);
+    for (i = 0; i < CONFIG_GREYBUS_SDIO_WRITE_BUFS; i++) {
+        list_add(&info->free_bufs, &info->bufs[i].list);
+    }
+
+    sem_init(&info->free_sem, 0, CONFIG_GREYBUS_SDIO_WRITE_BUFS);
+    sem_init(&info->pending_sem, 0, 0);
+
+    info->thread_stop = false;
+    ret = tpool_create(&info->write_thread, NULL, gb_sdio_write_thread,
+                       info);
+    if (ret) {
+        sem_destroy(&info->pending_sem);
+        sem_destroy(&info->free_sem);
+        free(info->bufs);
+        return -ret;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Stop the write thread and free the write buffers
+ *
+ * @param info Pointer to gb_sdio_info.
+ * @return None.
+ */
+static void gb_sdio_pipeline_exit(struct gb_sdio_info *info)
+{
+    gb_sdio_pipeline_flush(info);
+
+    info->thread_stop = true;
+    sem_post(&info->pending_sem);
+    tpool_join(info->write_thread, NULL);
+
+    sem_destroy(&info->pending_sem);
+    sem_destroy(&info->free_sem);
+    free(info->bufs);
+}
+#endif
+
+/**
+ * @brief Fit the block size and count limits to the Greybus messages
+ *
+ * The AP splits a data command in transfer requests of whole blocks, each
+ * carrying at most a message payload worth of data. A block must fit in one
+ * message, and the block count is rounded down to a multiple of the number of
+ * blocks a message holds, so that every message of the largest command is
+ * full instead of ending with a short one.
+ *
+ * The block size the AP uses is at most 512 bytes for SD memory cards and,
+ * by default, for SDIO functions, so it is the one the count is tuned for.
+ *
+ * @param cap Pointer to the host controller capabilities, updated.
+ * @return 0 on success, negative errno on error.
+ */
+static int gb_sdio_fit_caps(struct sdio_cap *cap)
+{
+    uint32_t data_max;
+    uint32_t max_req_size;
+    uint16_t max_blk_size;
+    uint16_t blksz;
+    uint32_t blocks_per_msg;
+    uint32_t count;
+
+    data_max = GB_MAX_PAYLOAD_SIZE -
+               MAX(sizeof(struct gb_sdio_transfer_request),
+                   sizeof(struct gb_sdio_transfer_response));
+
+    max_blk_size = scale_max_sd_block_length(data_max);
+    if (!max_blk_size || !cap->max_blk_size || !cap->max_blk_count) {
+        return -EINVAL;
+    }
+
+    cap->max_blk_size = MIN(cap->max_blk_size, max_blk_size);
+
+    blksz = MIN(cap->max_blk_size, MAX_BLOCK_SIZE_0);
+    blocks_per_msg = data_max / blksz;
+
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    max_req_size = MAX(CONFIG_GREYBUS_SDIO_MAX_REQ_SIZE, data_max);
+#else
+    max_req_size = cap->max_blk_count * blksz;
+#endif
+
+    count = MIN(max_req_size / blksz, cap->max_blk_count);
+    if (count > blocks_per_msg) {
+        count -= count % blocks_per_msg;
+    }
+    cap->max_blk_count = count;
+
+    return 0;
+}
+
 /**
  * @brief Event callback function for SDIO host controller driver
  *
@@ -146,7 +438,6 @@ static uint8_t gb_sdio_protocol_get_capabilities(struct gb_operation *operation)
     struct gb_sdio_get_capabilities_response *response;
     struct gb_bundle *bundle;
     struct sdio_cap cap;
-    uint16_t max_data_size;
     int ret;
 
     bundle = gb_operation_get_bundle(operation);
@@ -162,22 +453,9 @@ static uint8_t gb_sdio_protocol_get_capabilities(struct gb_operation *operation)
         return GB_OP_NO_MEMORY;
     }
 
-    /*
-     * The host Greybus uses max_blk_count * max_blk_size to request data,
-     * we must restrict the size under max protocol response package size.
-     */
-    max_data_size = GB_MAX_PAYLOAD_SIZE -
-                    sizeof(struct gb_sdio_transfer_response);
-    max_data_size = scale_max_sd_block_length(max_data_size);
-    if (!max_data_size) {
-        return GB_OP_INVALID;
-    }
-    if (cap.max_blk_count * cap.max_blk_size > max_data_size ) {
-        if (cap.max_blk_size > max_data_size) {
-            cap.max_blk_size = max_data_size;
-        } else {
-            cap.max_blk_count = max_data_size / cap.max_blk_size;
-        }
+    ret = gb_sdio_fit_caps(&cap);
+    if (ret) {
+        return gb_errno_to_op_result(ret);
     }
 
     response->caps = cpu_to_le32(cap.caps);
@@ -243,6 +521,9 @@ static uint8_t gb_sdio_protocol_command(struct gb_operation *operation)
 {
     struct gb_sdio_command_request *request;
     struct gb_sdio_command_response *response;
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    struct gb_sdio_info *info;
+#endif
     struct gb_bundle *bundle;
     struct sdio_cmd cmd;
     uint32_t resp[4];
@@ -265,6 +546,18 @@ static uint8_t gb_sdio_protocol_command(struct gb_operation *operation)
     cmd.data_blocks = le16_to_cpu(request->data_blocks);
     cmd.data_blksz = le16_to_cpu(request->data_blksz);
     cmd.resp = resp;
+
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    /*
+     * The data of the previous command must be on the card before the next
+     * command goes out. A write error there was already reported with the
+     * last chunk.
+     */
+    info = bundle->priv;
+    gb_sdio_pipeline_flush(info);
+    info->data_left = cmd.data_blocks * cmd.data_blksz;
+#endif
+
     ret = device_sdio_send_cmd(bundle->dev, &cmd);
     if (ret && ret != -ETIMEDOUT) {
         /*
@@ -340,11 +633,17 @@ static uint8_t gb_sdio_protocol_transfer(struct gb_operation *operation)
     transfer.callback = NULL; /* NO non-blocking transfer */
 
     if (request->data_flags & GB_SDIO_DATA_WRITE) {
-        if (!request->data) {
+        if (!request->data ||
+            gb_operation_get_request_payload_size(operation) <
+            sizeof(*request) + transfer.blocks * transfer.blksz) {
             return GB_OP_INVALID;
         }
         transfer.data = request->data;
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+        ret = gb_sdio_queue_write(bundle->priv, &transfer);
+#else
         ret = device_sdio_write(bundle->dev, &transfer);
+#endif
         if (ret) {
             return gb_errno_to_op_result(ret);
         }
@@ -410,8 +709,22 @@ static int gb_sdio_init(unsigned int cport, struct gb_bundle *bundle)
         goto err_close_device;
     }
 
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    info->dev = bundle->dev;
+    ret = gb_sdio_pipeline_init(info);
+    if (ret) {
+        goto err_detach_callback;
+    }
+#endif
+
+    bundle->priv = info;
+
     return 0;
 
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+err_detach_callback:
+    device_sdio_attach_callback(bundle->dev, NULL, NULL);
+#endif
 err_close_device:
     device_close(bundle->dev);
 err_free_info:
@@ -438,6 +751,10 @@ static void gb_sdio_exit(unsigned int cport, struct gb_bundle *bundle)
 
     DEBUGASSERT(cport == info->cport);
 
+#ifdef CONFIG_GREYBUS_SDIO_PIPELINE
+    gb_sdio_pipeline_exit(info);
+#endif
+
     device_sdio_attach_callback(bundle->dev, NULL, NULL);
 
     device_close(bundle->dev);
@@ -36,6 +36,9 @@
 #define GB_SPI_TYPE_MASTER_CONFIG   0x02    /* Get config for SPI master */
 #define GB_SPI_TYPE_DEVICE_CONFIG   0x03    /* Get config for SPI device */
 #define GB_SPI_PROTOCOL_TRANSFER    0x04    /* Transfer */
+#define GB_SPI_PROTOCOL_POLL_START  0x10    /* Start a poll program */
+#define GB_SPI_PROTOCOL_POLL_STOP   0x11    /* Stop the poll program */
+#define GB_SPI_PROTOCOL_POLL_REPORT 0x12    /* Poll samples, from module */
 
 /* SPI Protocol Mode Bit Masks */
 #define GB_SPI_MODE_CPHA        0x01    /* clock phase */
@@ -138,6 +141,23 @@ struct gb_spi_transfer_request {
     struct gb_spi_transfer_desc  transfers[0];
 } __packed;
 
+/**
+ * SPI Protocol Poll Start Request
+ *
+ * The poll stop request has no payload. Poll reports are made of a
+ * struct gb_poll_report_request.
+ */
+struct gb_spi_poll_start_request {
+    /** Period of the transfer in microseconds */
+    __le32  period_us;
+    /** Samples carried by each poll report */
+    __le16  samples;
+    /** Must be set to zero */
+    __le16  padding;
+    /** Transfer run for each sample */
+    struct gb_spi_transfer_request transfer;
+} __packed;
+
 /**
  * SPI Protocol Transfer Response
  */
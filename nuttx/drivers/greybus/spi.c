@@ -28,6 +28,7 @@
 
 #include <errno.h>
 #include <debug.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -40,6 +41,9 @@
 #include <arch/byteorder.h>
 
 #include "spi-gb.h"
+#ifdef CONFIG_GREYBUS_POLL
+#include "greybus-poll.h"
+#endif
 
 #define GB_SPI_VERSION_MAJOR 0
 #define GB_SPI_VERSION_MINOR 1
@@ -153,48 +157,153 @@ static uint8_t gb_spi_protocol_device_config(struct gb_operation *operation)
 }
 
 /**
- * @brief Performs a SPI transaction as one or more SPI transfers, defined
- *        in the supplied array.
+ * @brief Fill the SPI transfers of a transfer request
  *
- * @param operation pointer to structure of Greybus operation message
- * @return GB_OP_SUCCESS on success, error code on failure
+ * @param request Greybus SPI transfer request
+ * @param xfers SPI transfers to fill, one per transfer descriptor
+ * @param read_buf buffer for the read data
  */
-static uint8_t gb_spi_protocol_transfer(struct gb_operation *operation)
+static void gb_spi_fill_xfers(struct gb_spi_transfer_request *request,
+                              struct device_spi_batch_transfer *xfers,
+                              uint8_t *read_buf)
 {
     struct gb_spi_transfer_desc *desc;
-    struct gb_spi_transfer_request *request;
-    struct gb_spi_transfer_response *response;
-    struct device_spi_transfer transfer;
-    struct device_spi_device_config config;
-    uint32_t size = 0, freq = 0;
-    uint8_t *write_data, *read_buf;
+    int i, op_count = le16_to_cpu(request->count);
+    uint8_t *write_data = (uint8_t *)&request->transfers[op_count];
+
+    for (i = 0; i < op_count; i++) {
+        desc = &request->transfers[i];
+
+        xfers[i].transfer.txbuffer = write_data;
+        /* If rdwr without GB_SPI_XFER_READ flag, not need to pass read buffer */
+        if (desc->rdwr & GB_SPI_XFER_READ) {
+            xfers[i].transfer.rxbuffer = read_buf;
+            read_buf += le32_to_cpu(desc->len);
+        } else {
+            xfers[i].transfer.rxbuffer = NULL;
+        }
+        xfers[i].transfer.nwords = le32_to_cpu(desc->len);
+        /* move to next gb_spi_transfer data buffer */
+        write_data += le32_to_cpu(desc->len);
+
+        xfers[i].config.max_speed_hz = le32_to_cpu(desc->speed_hz);
+        xfers[i].config.mode = request->mode;
+        xfers[i].config.bpw = desc->bits_per_word;
+
+        xfers[i].delay_usecs = le16_to_cpu(desc->delay_usecs);
+        xfers[i].cs_change = desc->cs_change;
+    }
+}
+
+/**
+ * @brief Run a sequence of SPI transfers
+ *
+ * The whole sequence is handed to the controller when it can run it,
+ * otherwise the transfers are issued one by one.
+ *
+ * @param dev SPI device
+ * @param xfers SPI transfers
+ * @param op_count number of transfers
+ * @param chip_select chip-select pin of the slave device
+ * @return 0 on success, negative errno on error
+ */
+static int gb_spi_run_xfers(struct device *dev,
+                            struct device_spi_batch_transfer *xfers,
+                            int op_count, uint8_t chip_select)
+{
     bool selected = false;
-    int i, op_count;
-    int ret = 0, errcode = GB_OP_SUCCESS;
-    size_t request_size;
-    size_t expected_size;
+    int i, ret, err;
 
-    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
-    DEBUGASSERT(bundle);
+    /* lock SPI bus */
+    ret = device_spi_lock(dev);
+    if (ret) {
+        return ret;
+    }
+
+    ret = device_spi_exchange_batch(dev, xfers, op_count, chip_select);
+    if (ret != -ENOSYS) {
+        goto spi_unlock;
+    }
+    ret = 0;
+
+    for (i = 0; i < op_count; i++) {
+        /* assert chip-select pin */
+        if (!selected) {
+            ret = device_spi_select(dev, chip_select);
+            if (ret) {
+                break;
+            }
+            selected = true;
+        }
+
+        /* start SPI transfer */
+        ret = device_spi_exchange(dev, &xfers[i].transfer, chip_select,
+                                  &xfers[i].config);
+        if (ret) {
+            break;
+        }
+
+        if (xfers[i].delay_usecs > 0) {
+            usleep(xfers[i].delay_usecs);
+        }
+
+        /* if cs_change enable, change the chip-select pin signal */
+        if (xfers[i].cs_change) {
+            /* force deassert chip-select pin */
+            ret = device_spi_deselect(dev, chip_select);
+            if (ret) {
+                break;
+            }
+            selected = false;
+        }
+    }
+
+    if (selected) {
+        /* deassert chip-select pin */
+        err = device_spi_deselect(dev, chip_select);
+        if (err) {
+            ret = err;
+        }
+    }
+
+spi_unlock:
+    /* unlock SPI bus*/
+    err = device_spi_unlock(dev);
+    if (err) {
+        ret = err;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Check a transfer request
+ *
+ * @param request Greybus SPI transfer request
+ * @param request_size size of the request in bytes
+ * @return number of bytes read by the request, negative errno if the
+ * request is short
+ */
+static int gb_spi_check_transfer(struct gb_spi_transfer_request *request,
+                                 size_t request_size)
+{
+    struct gb_spi_transfer_desc *desc;
+    size_t expected_size;
+    int i, op_count;
+    int size = 0;
 
-    request_size = gb_operation_get_request_payload_size(operation);
     if (request_size < sizeof(*request)) {
-        gb_error("dropping short message\n");
-        return GB_OP_INVALID;
+        return -EINVAL;
     }
 
-    request = gb_operation_get_request_payload(operation);
     op_count = le16_to_cpu(request->count);
 
     expected_size = sizeof(*request) +
                     op_count * sizeof(request->transfers[0]);
     if (request_size < expected_size) {
-        gb_error("dropping short message\n");
-        return GB_OP_INVALID;
+        return -EINVAL;
     }
 
-    write_data = (uint8_t *)&request->transfers[op_count];
-
     for (i = 0; i < op_count; i++) {
         desc = &request->transfers[i];
         if (desc->rdwr & GB_SPI_XFER_READ) {
@@ -202,103 +311,218 @@ static uint8_t gb_spi_protocol_transfer(struct gb_operation *operation)
         }
     }
 
+    return size;
+}
+
+/**
+ * @brief Performs a SPI transaction as one or more SPI transfers, defined
+ *        in the supplied array.
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_transfer(struct gb_operation *operation)
+{
+    struct gb_spi_transfer_request *request;
+    struct gb_spi_transfer_response *response;
+    struct device_spi_batch_transfer *xfers;
+    int size, op_count;
+    int ret;
+
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    request = gb_operation_get_request_payload(operation);
+
+    size = gb_spi_check_transfer(request,
+                        gb_operation_get_request_payload_size(operation));
+    if (size < 0) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    op_count = le16_to_cpu(request->count);
+
     response = gb_operation_alloc_response(operation, size);
     if (!response) {
         return GB_OP_NO_MEMORY;
     }
-    read_buf = response->data;
 
-    /* lock SPI bus */
-    ret = device_spi_lock(bundle->dev);
+    if (!op_count) {
+        return GB_OP_SUCCESS;
+    }
+
+    xfers = malloc(op_count * sizeof(*xfers));
+    if (!xfers) {
+        return GB_OP_NO_MEMORY;
+    }
+
+    gb_spi_fill_xfers(request, xfers, response->data);
+
+    ret = gb_spi_run_xfers(bundle->dev, xfers, op_count,
+                           request->chip_select);
+
+    free(xfers);
+
     if (ret) {
+        /* get error code */
         return (ret == -EINVAL)? GB_OP_INVALID : GB_OP_UNKNOWN_ERROR;
     }
+    return GB_OP_SUCCESS;
+}
 
-    /* parse all transfer request from AP host side */
-    for (i = 0; i < op_count; i++) {
-        desc = &request->transfers[i];
-        freq = le32_to_cpu(desc->speed_hz);
+#ifdef CONFIG_GREYBUS_POLL
+/**
+ * Poll program of a bundle
+ */
+struct gb_spi_poll {
+    /** SPI device */
+    struct device *dev;
+    /** Poll handle */
+    struct gb_poll *poll;
+    /** SPI transfers of one sample */
+    struct device_spi_batch_transfer *xfers;
+    /** Number of SPI transfers */
+    int op_count;
+    /** chip-select pin of the slave device */
+    uint8_t chip_select;
+    /** Bytes read by one sample */
+    int read_size;
+    /** Bytes read by the current sample */
+    uint8_t *read_buf;
+};
 
-        /* assert chip-select pin */
-        if (!selected) {
-            ret = device_spi_select(bundle->dev, request->chip_select);
-            if (ret) {
-                goto spi_err;
-            }
-            selected = true;
-        }
+/**
+ * @brief Run the transfers of one poll sample
+ *
+ * @param priv poll program
+ * @param buf buffer receiving the bytes read
+ * @return 0 on success, negative errno on error
+ */
+static int gb_spi_poll_sample(void *priv, uint8_t *buf)
+{
+    struct gb_spi_poll *prog = priv;
+    int ret;
+
+    ret = gb_spi_run_xfers(prog->dev, prog->xfers, prog->op_count,
+                           prog->chip_select);
+    if (!ret) {
+        memcpy(buf, prog->read_buf, prog->read_size);
+    } else {
+        memset(buf, 0, prog->read_size);
+    }
 
-        /* setup SPI transfer */
-        memset(&transfer, 0, sizeof(struct device_spi_transfer));
-        transfer.txbuffer = write_data;
-        /* If rdwr without GB_SPI_XFER_READ flag, not need to pass read buffer */
-        if (desc->rdwr & GB_SPI_XFER_READ) {
-            transfer.rxbuffer = read_buf;
-        } else {
-            transfer.rxbuffer = NULL;
-        }
+    return ret;
+}
 
-        transfer.nwords = le32_to_cpu(desc->len);
+/**
+ * @brief Stop and free the poll program of a bundle
+ *
+ * @param bundle Greybus bundle handle
+ */
+static void gb_spi_poll_free(struct gb_bundle *bundle)
+{
+    struct gb_spi_poll *prog = bundle->priv;
 
-        /* set SPI configuration */
-        config.max_speed_hz = freq;
-        config.mode = request->mode;
-        config.bpw = desc->bits_per_word;
+    if (!prog) {
+        return;
+    }
 
-        /* start SPI transfer */
-        ret = device_spi_exchange(bundle->dev, &transfer, request->chip_select,
-                                  &config);
-        if (ret) {
-            goto spi_err;
-        }
-        /* move to next gb_spi_transfer data buffer */
-        write_data += le32_to_cpu(desc->len);
+    gb_poll_stop(prog->poll);
+    free(prog);
+    bundle->priv = NULL;
+}
 
-        /* If rdwr without GB_SPI_XFER_READ flag, not need to resize
-         * read buffer
-         */
-        if (desc->rdwr & GB_SPI_XFER_READ) {
-            read_buf += le32_to_cpu(desc->len);
-        }
+/**
+ * @brief Start running a transfer request periodically
+ *
+ * The samples are sent back in Poll Report requests. A new program
+ * replaces the running one.
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_poll_start(struct gb_operation *operation)
+{
+    struct gb_spi_poll_start_request *request;
+    struct gb_spi_transfer_request *transfer;
+    struct gb_spi_poll *prog;
+    size_t request_size = gb_operation_get_request_payload_size(operation);
+    size_t transfer_size;
+    int op_count, size;
 
-        if (le16_to_cpu(desc->delay_usecs) > 0) {
-            usleep(le16_to_cpu(desc->delay_usecs));
-        }
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
 
-        /* if cs_change enable, change the chip-select pin signal */
-        if (desc->cs_change) {
-            /* force deassert chip-select pin */
-            ret = device_spi_deselect(bundle->dev, request->chip_select);
-            if (ret) {
-                goto spi_err;
-            }
-            selected = false;
-        }
+    if (request_size < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
     }
 
-spi_err:
-    errcode = ret;
+    request = gb_operation_get_request_payload(operation);
+    transfer_size = request_size -
+                    offsetof(struct gb_spi_poll_start_request, transfer);
 
-    if (selected) {
-        /* deassert chip-select pin */
-        ret = device_spi_deselect(bundle->dev, request->chip_select);
-        if (ret) {
-            errcode = ret;
-        }
+    size = gb_spi_check_transfer(&request->transfer, transfer_size);
+    op_count = le16_to_cpu(request->transfer.count);
+    if (size < 0 || !op_count) {
+        gb_error("invalid poll program\n");
+        return GB_OP_INVALID;
     }
 
-    /* unlock SPI bus*/
-    ret = device_spi_unlock(bundle->dev);
-    if (ret) {
-        errcode = ret;
+    gb_spi_poll_free(bundle);
+
+    /*
+     * The program keeps its own copy of the transfer request, the SPI
+     * transfers and a buffer for the bytes of the current sample.
+     */
+    prog = zalloc(sizeof(*prog) + op_count * sizeof(prog->xfers[0]) +
+                  transfer_size + size);
+    if (!prog) {
+        return GB_OP_NO_MEMORY;
     }
 
-    if (errcode) {
-        /* get error code */
-        errcode = (errcode == -EINVAL)? GB_OP_INVALID : GB_OP_UNKNOWN_ERROR;
+    prog->dev = bundle->dev;
+    prog->op_count = op_count;
+    prog->chip_select = request->transfer.chip_select;
+    prog->read_size = size;
+    prog->xfers = (struct device_spi_batch_transfer *)(prog + 1);
+    transfer = (struct gb_spi_transfer_request *)&prog->xfers[op_count];
+    memcpy(transfer, &request->transfer, transfer_size);
+    prog->read_buf = (uint8_t *)transfer + transfer_size;
+
+    gb_spi_fill_xfers(transfer, prog->xfers, prog->read_buf);
+
+    prog->poll = gb_poll_start(operation->cport, GB_SPI_PROTOCOL_POLL_REPORT,
+                               le32_to_cpu(request->period_us),
+                               le16_to_cpu(request->samples), size,
+                               gb_spi_poll_sample, prog);
+    if (!prog->poll) {
+        free(prog);
+        return GB_OP_INVALID;
     }
-    return errcode;
+
+    bundle->priv = prog;
+
+    return GB_OP_SUCCESS;
+}
+
+/**
+ * @brief Stop the poll program
+ *
+ * @param operation pointer to structure of Greybus operation message
+ * @return GB_OP_SUCCESS on success, error code on failure
+ */
+static uint8_t gb_spi_protocol_poll_stop(struct gb_operation *operation)
+{
+    struct gb_bundle *bundle = gb_operation_get_bundle(operation);
+    DEBUGASSERT(bundle);
+
+    gb_spi_poll_free(bundle);
+
+    return GB_OP_SUCCESS;
 }
+#endif
 
 /**
  * @brief Greybus SPI protocol initialize function
@@ -324,6 +548,10 @@ static int gb_spi_init(unsigned int cport, struct gb_bundle *bundle)
  */
 static void gb_spi_exit(unsigned int cport, struct gb_bundle *bundle)
 {
+#ifdef CONFIG_GREYBUS_POLL
+    gb_spi_poll_free(bundle);
+#endif
+
     if (bundle->dev) {
         device_close(bundle->dev);
         bundle->dev = NULL;
@@ -338,6 +566,10 @@ static struct gb_operation_handler gb_spi_handlers[] = {
     GB_HANDLER(GB_SPI_TYPE_MASTER_CONFIG, gb_spi_protocol_master_config),
     GB_HANDLER(GB_SPI_TYPE_DEVICE_CONFIG, gb_spi_protocol_device_config),
     GB_HANDLER(GB_SPI_PROTOCOL_TRANSFER, gb_spi_protocol_transfer),
+#ifdef CONFIG_GREYBUS_POLL
+    GB_HANDLER(GB_SPI_PROTOCOL_POLL_START, gb_spi_protocol_poll_start),
+    GB_HANDLER(GB_SPI_PROTOCOL_POLL_STOP, gb_spi_protocol_poll_stop),
+#endif
 };
 
 static struct gb_driver gb_spi_driver = {
@@ -32,9 +32,13 @@
 #include <queue.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/device.h>
 #include <nuttx/device_uart.h>
+#include <nuttx/mm/mempool.h>
+#include <nuttx/tpool.h>
 #include <nuttx/util.h>
 #include <nuttx/config.h>
 #include <nuttx/greybus/types.h>
@@ -53,12 +57,18 @@
 #define MAX_RX_BUF_NUMBER       5
 #define MAX_RX_BUF_SIZE         256
 
+/* Inter-burst gaps are capped so the averages over idle periods don't wrap */
+#define RX_GAP_CAP(info)        (4 * (info)->rx_max_latency + 1)
+
 /* The id of error in protocol operating. */
 #define GB_UART_EVENT_PROTOCOL_ERROR    1
 #define GB_UART_EVENT_DEVICE_ERROR      2
 
 /**
  * The buffer node structure.
+ *
+ * The driver receives straight into the payload of a receive data request
+ * kept with the node, which is sent as is once the data is in.
  */
 struct buf_node {
     /** queue entry */
@@ -67,8 +77,10 @@ struct buf_node {
     uint16_t            data_size;
     /** flags of receiver data */
     uint8_t             data_flags;
-    /** buffer of receiver data */
-    uint8_t             buffer[];
+    /** receive data operation owning the buffer */
+    struct gb_operation *operation;
+    /** buffer of receiver data, the data of the request */
+    uint8_t             *buffer;
 };
 
 /**
@@ -91,8 +103,10 @@ struct gb_uart_info {
     /** status change thread handle */
     pthread_t           status_thread;
     /* data receiving */
-    /** available buffer queue */
-    sq_queue_t          free_queue;
+    /** available buffer nodes */
+    struct mempool      free_pool;
+    /** storage of the buffer nodes */
+    struct buf_node     *nodes;
     /** received data buffer queue */
     sq_queue_t          data_queue;
     /** buffer node in receiving */
@@ -109,6 +123,25 @@ struct gb_uart_info {
     pthread_t           rx_thread;
     /** inform the thread should be terminated */
     int                 thread_stop;
+    /* receive batching */
+    /** the node in receiving holds data waiting for more */
+    int                 rx_hold;
+    /** the thread asks the callback to send the held data */
+    int                 rx_flush;
+    /** time the first data of the held node came in, in ticks */
+    uint32_t            rx_start;
+    /** time the held node is sent at the latest, in ticks */
+    uint32_t            rx_deadline;
+    /** time of the last receive completion, in ticks */
+    uint32_t            rx_last;
+    /** average time between receive completions, in ticks */
+    uint32_t            rx_gap;
+    /** average receive throughput, in 1/16 bytes per tick */
+    uint32_t            rx_rate;
+    /** shortest time data is held for, in ticks */
+    uint32_t            rx_min_latency;
+    /** longest time data is held for, in ticks */
+    uint32_t            rx_max_latency;
 };
 
 /**
@@ -178,51 +211,81 @@ static void uart_report_error(int error, const char *func_name)
 /**
  * @brief Free buffers
  *
- * This funciton frees buffers and nodes memory.
+ * This funciton frees buffers and nodes memory, whether the nodes are free,
+ * queued or in receiving.
  *
- * @param queue Target queue.
+ * @param info The UART protocol information.
  * @return None.
  */
-static void uart_free_buf(sq_queue_t *queue)
+static void uart_free_buf(struct gb_uart_info *info)
 {
-    struct buf_node *node = NULL;
+    int i;
 
-    node = get_node_from(queue);
-    while (node) {
-        free(node);
-        node = get_node_from(queue);
+    if (!info->nodes) {
+        return;
     }
+
+    for (i = 0; i < info->entries; i++) {
+        if (info->nodes[i].operation) {
+            gb_operation_destroy(info->nodes[i].operation);
+        }
+    }
+
+    mempool_deinit(&info->free_pool);
+    free(info->nodes);
+    info->nodes = NULL;
+    sq_init(&info->data_queue);
 }
 
 /**
  * @brief Allocate receiver buffers
  *
- * This function is allocating receiving buffers.
+ * This function is allocating receiving buffers, each one being the payload
+ * of a receive data operation. The nodes are set up once and handed out by
+ * a pool, which keeps them as they are but for their queue entry.
  *
- * @param max_nodes Maximum nodes.
- * @param buf_size Buffer size in operation.
- * @param queue Target queue.
+ * @param info The UART protocol information.
  * @return 0 for success, errno for failures.
  */
-static int uart_alloc_buf(int max_nodes, int buf_size, sq_queue_t *queue)
+static int uart_alloc_buf(struct gb_uart_info *info)
 {
-    struct buf_node *node = NULL;
-    int i = 0;
+    struct gb_uart_receive_data_request *request;
+    struct buf_node *node;
+    int ret;
+    int i;
 
-    for (i = 0; i < max_nodes; i++) {
-        node = malloc(sizeof(*node) + buf_size);
-        if (!node) {
-            /*
-             * It may have some buffers already be allocated, caller should
-             * free them.
-             */
-            return ENOMEM;
-            /* Keeping consistency with Nuttx APIs, so returns positive num */
+    info->nodes = zalloc(sizeof(*info->nodes) * info->entries);
+    if (!info->nodes) {
+        return ENOMEM;
+        /* Keeping consistency with Nuttx APIs, so returns positive num */
+    }
+
+    for (i = 0; i < info->entries; i++) {
+        node = &info->nodes[i];
+        node->operation = gb_operation_create(info->cport,
+                                              GB_UART_PROTOCOL_RECEIVE_DATA,
+                                              sizeof(*request) +
+                                              info->rx_buf_size);
+        if (!node->operation) {
+            ret = ENOMEM;
+            goto err_free_buf;
         }
-        put_node_back(queue, node);
+
+        request = gb_operation_get_request_payload(node->operation);
+        node->buffer = request->data;
+    }
+
+    ret = -mempool_init(&info->free_pool, info->nodes, sizeof(*node),
+                        info->entries, 0);
+    if (ret) {
+        goto err_free_buf;
     }
 
     return 0;
+
+err_free_buf:
+    uart_free_buf(info);
+    return ret;
 }
 
 /**
@@ -269,6 +332,65 @@ static void uart_ls_callback(void *data, uint8_t ls)
     sem_post(&info->status_sem);
 }
 
+/**
+ * @brief Decide whether to keep filling the node in receiving
+ *
+ * The driver completes a receive when the line goes idle, which for bulk
+ * traffic coming in bursts gives many small messages. Fewer, fuller messages
+ * are sent by receiving the next bursts into the rest of the same buffer.
+ *
+ * The data is held while another burst is expected soon, that is when the
+ * average time between bursts is within the maximum latency, and at most
+ * for the time the recent throughput needs to fill the buffer, bounded by
+ * the minimum and maximum latencies. Sparse traffic, like an interactive
+ * console, is sent after the minimum latency, right away by default.
+ *
+ * @param info Pointer to struct gb_uart_info.
+ * @param node The node in receiving.
+ * @param length Length of the data the last receive added.
+ * @return 1 to keep receiving into the node, 0 to send it.
+ */
+static int uart_rx_hold(struct gb_uart_info *info, struct buf_node *node,
+                        int length)
+{
+    uint32_t now = clock_systimer();
+    uint32_t gap = now - info->rx_last;
+    uint32_t space = info->rx_buf_size - node->data_size;
+    uint32_t hold;
+
+    if (gap > RX_GAP_CAP(info)) {
+        gap = RX_GAP_CAP(info);
+    }
+
+    info->rx_last = now;
+    info->rx_gap = (3 * info->rx_gap + gap) / 4;
+    info->rx_rate = (3 * info->rx_rate + (length << 4) / (gap + 1)) / 4;
+
+    if (info->rx_flush || node->data_flags || !space) {
+        return 0;
+    }
+
+    if (node->data_size == length) {
+        info->rx_start = now;
+    }
+
+    if (info->rx_gap > info->rx_max_latency) {
+        hold = info->rx_min_latency;
+    } else {
+        hold = info->rx_rate ? (space << 4) / info->rx_rate :
+                               info->rx_max_latency;
+        if (hold < info->rx_min_latency) {
+            hold = info->rx_min_latency;
+        } else if (hold > info->rx_max_latency) {
+            hold = info->rx_max_latency;
+        }
+    }
+
+    info->rx_deadline = info->rx_start + hold;
+
+    return (int32_t)(now - info->rx_deadline) < 0;
+}
+
 /**
  * @brief Callback for data receiving
  *
@@ -277,7 +399,8 @@ static void uart_ls_callback(void *data, uint8_t ls)
  *
  * This function Must be called from interrupt context.
  *
- * It put the current buffer to received queue and gets another buffer to
+ * It adds the data to the current buffer and, unless uart_rx_hold() keeps
+ * it for more, puts the buffer to received queue and gets another buffer to
  * continue receiving. Then notifies rx thread to process.
  *
  * @param dev Pointer to the UART device controller
@@ -297,8 +420,9 @@ static void uart_rx_callback(struct device *dev, void *data, uint8_t *buffer,
 
     DEBUGASSERT(data);
     info = data;
+    node = info->rx_node;
 
-    info->rx_node->data_size = length;
+    node->data_size += length;
 
     if (error & LSR_OE) {
         flags |= GB_UART_RECV_FLAG_OVERRUN;
@@ -312,26 +436,41 @@ static void uart_rx_callback(struct device *dev, void *data, uint8_t *buffer,
     if (error & LSR_BI) {
         flags |= GB_UART_RECV_FLAG_BREAK;
     }
-    info->rx_node->data_flags = flags;
+    node->data_flags |= flags;
+
+    if (!node->data_size) {
+        /* Nothing came in before a flush, keep the same buffer */
+        info->rx_flush = 0;
+    } else if (uart_rx_hold(info, node, length)) {
+        if (!info->rx_hold) {
+            /* let the rx thread time the held data out */
+            info->rx_hold = 1;
+            sem_post(&info->rx_sem);
+        }
+    } else {
+        info->rx_hold = 0;
+        info->rx_flush = 0;
 
-    put_node_back(&info->data_queue, info->rx_node);
-    /* notify rx thread to process this data*/
-    sem_post(&info->rx_sem);
+        put_node_back(&info->data_queue, node);
+        /* notify rx thread to process this data*/
+        sem_post(&info->rx_sem);
 
-    node = get_node_from(&info->free_queue);
+        node = mempool_alloc(&info->free_pool);
 
-    if (!node) {
-        /*
-         * there is no free buffer, inform the rx thread to engage another uart
-         * receiver.
-         */
-        info->require_node = 1;
-        return;
+        if (!node) {
+            /*
+             * there is no free buffer, inform the rx thread to engage another
+             * uart receiver.
+             */
+            info->require_node = 1;
+            return;
+        }
+
+        info->rx_node = node;
     }
 
-    info->rx_node = node;
-    ret = device_uart_start_receiver(dev, node->buffer,
-                                     info->rx_buf_size,
+    ret = device_uart_start_receiver(dev, node->buffer + node->data_size,
+                                     info->rx_buf_size - node->data_size,
                                      NULL, NULL, uart_rx_callback);
     if (ret) {
         uart_report_error(GB_UART_EVENT_PROTOCOL_ERROR, __func__);
@@ -407,6 +546,56 @@ static void *uart_status_thread(void *data)
     return NULL;
 }
 
+/**
+ * @brief Wait for received data, or for the held data to time out
+ *
+ * When the deadline of the held node passes, the receiver is stopped, which
+ * completes the receive with what is in the buffer and makes the callback
+ * send it.
+ *
+ * @param info Pointer to struct gb_uart_info.
+ * @param dev Pointer to the UART device controller.
+ * @return None.
+ */
+static void uart_rx_wait(struct gb_uart_info *info, struct device *dev)
+{
+    struct timespec abstime;
+    irqstate_t flags;
+    int32_t remaining;
+    uint64_t nsec;
+
+    flags = irqsave();
+    remaining = info->rx_hold ?
+                (int32_t)(info->rx_deadline - clock_systimer()) : -1;
+    irqrestore(flags);
+
+    if (!info->rx_hold) {
+        sem_wait(&info->rx_sem);
+        return;
+    }
+
+    if (remaining > 0) {
+        clock_gettime(CLOCK_REALTIME, &abstime);
+        nsec = abstime.tv_nsec + (uint64_t)TICK2USEC(remaining) * 1000;
+        abstime.tv_sec += nsec / 1000000000;
+        abstime.tv_nsec = nsec % 1000000000;
+
+        if (!sem_timedwait(&info->rx_sem, &abstime) || errno != ETIMEDOUT) {
+            return;
+        }
+    }
+
+    flags = irqsave();
+    if (info->rx_hold) {
+        info->rx_flush = 1;
+    }
+    irqrestore(flags);
+
+    if (info->rx_flush) {
+        device_uart_stop_receiver(dev);
+    }
+}
+
 /**
  * @brief Data receiving process thread
  *
@@ -420,7 +609,6 @@ static void *uart_status_thread(void *data)
  */
 static void *uart_rx_thread(void *data)
 {
-    struct gb_operation *operation = NULL;
     struct gb_uart_receive_data_request *request = NULL;
     struct buf_node *node = NULL;
     struct gb_bundle *bundle = data;
@@ -429,7 +617,7 @@ static void *uart_rx_thread(void *data)
     int ret;
 
     while (1) {
-        sem_wait(&info->rx_sem);
+        uart_rx_wait(info, dev);
 
         if (info->thread_stop) {
             break;
@@ -437,31 +625,27 @@ static void *uart_rx_thread(void *data)
 
         node = get_node_from(&info->data_queue);
         if (node) {
-            operation = gb_operation_create(info->cport,
-                                           GB_UART_PROTOCOL_RECEIVE_DATA,
-                                           sizeof(*request) + node->data_size);
-            if (!operation) {
+            /* The data is already in the request, only trim it */
+            request = gb_operation_get_request_payload(node->operation);
+            request->size = cpu_to_le16(node->data_size);
+            request->flags = node->data_flags;
+            gb_operation_set_request_payload_size(node->operation,
+                                        sizeof(*request) + node->data_size);
+
+            ret = gb_operation_send_request(node->operation, NULL, false);
+            if (ret) {
                 uart_report_error(GB_UART_EVENT_PROTOCOL_ERROR, __func__);
-            } else {
-                request = gb_operation_get_request_payload(operation);
-                request->size = cpu_to_le16(node->data_size);
-                request->flags = node->data_flags;
-                memcpy(request->data, node->buffer, node->data_size);
-
-                ret = gb_operation_send_request(operation, NULL, false);
-                if (ret) {
-                    uart_report_error(GB_UART_EVENT_PROTOCOL_ERROR, __func__);
-                }
-                gb_operation_destroy(operation);
             }
-            put_node_back(&info->free_queue, node);
+            node->data_size = 0;
+            node->data_flags = 0;
+            mempool_free(&info->free_pool, node);
         }
 
         /*
          * In case there is no free node in callback.
          */
         if (info->require_node) {
-            node = get_node_from(&info->free_queue);
+            node = mempool_alloc(&info->free_pool);
             info->rx_node = node;
             ret = device_uart_start_receiver(dev, node->buffer,
                                              info->rx_buf_size, NULL,
@@ -490,7 +674,7 @@ static void uart_status_cb_deinit(struct gb_uart_info *info)
     if (info->status_thread != (pthread_t)0) {
         info->thread_stop = 1;
         sem_post(&info->status_sem);
-        pthread_join(info->status_thread, NULL);
+        tpool_join(info->status_thread, NULL);
     }
 
     sem_destroy(&info->status_sem);
@@ -526,7 +710,7 @@ static int uart_status_cb_init(struct gb_uart_info *info)
         goto err_destroy_ms_ls_op;
     }
 
-    ret = pthread_create(&info->status_thread, NULL, uart_status_thread, info);
+    ret = tpool_create(&info->status_thread, NULL, uart_status_thread, info);
     if (ret) {
         goto err_destroy_status_sem;
     }
@@ -555,13 +739,12 @@ static void uart_receiver_cb_deinit(struct gb_uart_info *info)
     if (info->rx_thread != (pthread_t)0) {
         info->thread_stop = 1;
         sem_post(&info->rx_sem);
-        pthread_join(info->rx_thread, NULL);
+        tpool_join(info->rx_thread, NULL);
     }
 
     sem_destroy(&info->rx_sem);
 
-    uart_free_buf(&info->data_queue);
-    uart_free_buf(&info->free_queue);
+    uart_free_buf(info);
 }
 
 /**
@@ -580,13 +763,16 @@ static int uart_receiver_cb_init(struct gb_bundle *bundle)
     struct gb_uart_info *info = bundle->priv;
     int ret;
 
-    sq_init(&info->free_queue);
     sq_init(&info->data_queue);
 
     info->entries = MAX_RX_BUF_NUMBER;
     info->rx_buf_size = MAX_RX_BUF_SIZE;
 
-    ret = uart_alloc_buf(info->entries, info->rx_buf_size, &info->free_queue);
+    info->rx_min_latency = MSEC2TICK(CONFIG_GREYBUS_UART_RX_MIN_LATENCY);
+    info->rx_max_latency = MSEC2TICK(CONFIG_GREYBUS_UART_RX_MAX_LATENCY);
+    info->rx_gap = RX_GAP_CAP(info);
+
+    ret = uart_alloc_buf(info);
     if (ret) {
         goto err_free_data_buf;
     }
@@ -596,7 +782,7 @@ static int uart_receiver_cb_init(struct gb_bundle *bundle)
         goto err_free_data_buf;
     }
 
-    ret = pthread_create(&info->rx_thread, NULL, uart_rx_thread, bundle);
+    ret = tpool_create(&info->rx_thread, NULL, uart_rx_thread, bundle);
     if (ret) {
         goto err_destroy_rx_sem;
     }
@@ -606,7 +792,7 @@ static int uart_receiver_cb_init(struct gb_bundle *bundle)
 err_destroy_rx_sem:
     sem_destroy(&info->rx_sem);
 err_free_data_buf:
-    uart_free_buf(&info->free_queue);
+    uart_free_buf(info);
 
     return ret;
 }
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __VENDOR_DEBUG_GB_H__
+#define __VENDOR_DEBUG_GB_H__
+
+#include <nuttx/greybus/types.h>
+
+/* Greybus vendor debug request types */
+#define GB_VENDOR_DEBUG_TYPE_INVALID            GB_INVALID_TYPE
+#define GB_VENDOR_DEBUG_TYPE_PROTOCOL_VERSION   0x01
+#define GB_VENDOR_DEBUG_TYPE_SNAPSHOT           0x02
+#define GB_VENDOR_DEBUG_TYPE_RESET              0x03
+
+/* snapshot request flags */
+#define GB_VENDOR_DEBUG_SNAPSHOT_RESET          0x01
+
+/* snapshot response sections holding counters */
+#define GB_VENDOR_DEBUG_HAVE_CPORTS             0x0001
+#define GB_VENDOR_DEBUG_HAVE_CPULOAD            0x0002
+#define GB_VENDOR_DEBUG_HAVE_HEAP               0x0004
+#define GB_VENDOR_DEBUG_HAVE_BUFRAM             0x0008
+#define GB_VENDOR_DEBUG_HAVE_UNIPRO_RX          0x0010
+#define GB_VENDOR_DEBUG_HAVE_UNIPRO_TX_DMA      0x0020
+#define GB_VENDOR_DEBUG_HAVE_DMA                0x0040
+
+/* version request has no payload */
+struct gb_vendor_debug_proto_version_response {
+    __u8    major;
+    __u8    minor;
+} __packed;
+
+/*
+ * Snapshot request: the CPorts are reported from first_cport_id on, as many
+ * as fit in the response. With GB_VENDOR_DEBUG_SNAPSHOT_RESET, the counters
+ * are reset once read: those of the CPorts in the response, and the other
+ * ones if first_cport_id is 0.
+ */
+struct gb_vendor_debug_snapshot_request {
+    __le16  first_cport_id;
+    __u8    flags;
+    __u8    pad;
+} __packed;
+
+struct gb_vendor_debug_cport_stats {
+    __le16  cport_id;
+    __le16  pad;
+    __le32  requests_in;
+    __le32  requests_out;
+    __le32  responses_in;
+    __le32  responses_out;
+    __le32  bytes_in;
+    __le32  bytes_out;
+    __le32  timeouts;
+    __le32  oom_responses;
+    __le32  rx_drops;
+    __le32  rx_fifo_hwm;
+} __packed;
+
+/*
+ * Snapshot response. Counters are cumulated since the last reset, period_ms
+ * ago, except cpu_load which is averaged by the scheduler over the last
+ * seconds, and the heap and bufram usage which are sampled. Divide busy_us
+ * by period_ms to get the utilization of the UniPro TX DMA and the GDMAC.
+ * Sections the firmware doesn't count are cleared in valid and read as 0.
+ */
+struct gb_vendor_debug_snapshot_response {
+    __le32  uptime_ms;
+    __le32  period_ms;
+    __le16  valid;                  /* GB_VENDOR_DEBUG_HAVE_* */
+    __le16  cpu_load;               /* per mille */
+
+    __le32  heap_size;
+    __le32  heap_used;
+    __le32  heap_largest_free;
+
+    __le32  bufram_free;
+    __le32  bufram_largest_free;
+    __le32  bufram_used;
+    __le32  bufram_peak_used;
+    __le32  bufram_failures;
+
+    __le32  unipro_rx_irqs;
+    __le32  unipro_rx_msgs;
+    __le32  unipro_tx_dma_xfers;
+    __le32  unipro_tx_dma_bytes;
+    __le32  unipro_tx_dma_busy_us;
+
+    __le32  dma_xfers;              /* all the GDMAC channels */
+    __le32  dma_bytes;
+    __le32  dma_busy_us;
+    __le32  dma_errors;
+
+    __u8    nr_cports;
+    __u8    pad[3];
+    struct gb_vendor_debug_cport_stats cports[0];
+} __packed;
+
+/* reset request and response have no payload */
+
+#endif /* __VENDOR_DEBUG_GB_H__ */
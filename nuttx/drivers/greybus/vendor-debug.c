@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Vendor debug protocol: lets the AP collect the performance counters of
+ * the bridge in a single binary snapshot, and reset them, so that they can
+ * be tracked on deployed modules without a console.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nuttx/util.h>
+#include <nuttx/clock.h>
+#include <nuttx/greybus/greybus.h>
+#include <nuttx/greybus/debug.h>
+#include <nuttx/unipro/unipro.h>
+#include <arch/byteorder.h>
+
+#ifdef CONFIG_MM_BUFRAM_ALLOCATOR
+#include <nuttx/bufram.h>
+#endif
+
+#ifdef CONFIG_ARCH_DMA_STATS
+#include "tsb_dma.h"
+#endif
+
+#include "vendor-debug-gb.h"
+
+/* Version of the Greybus vendor debug protocol we support */
+#define GB_VENDOR_DEBUG_VERSION_MAJOR   0x00
+#define GB_VENDOR_DEBUG_VERSION_MINOR   0x01
+
+/* system time of the last reset */
+static uint32_t gb_vendor_debug_reset_ticks;
+
+static uint8_t gb_vendor_debug_protocol_version(struct gb_operation *operation)
+{
+    struct gb_vendor_debug_proto_version_response *response;
+
+    response = gb_operation_alloc_response(operation, sizeof(*response));
+    if (!response)
+        return GB_OP_NO_MEMORY;
+
+    response->major = GB_VENDOR_DEBUG_VERSION_MAJOR;
+    response->minor = GB_VENDOR_DEBUG_VERSION_MINOR;
+    return GB_OP_SUCCESS;
+}
+
+static uint16_t gb_vendor_debug_get_system(
+        struct gb_vendor_debug_snapshot_response *response)
+{
+    uint16_t valid = 0;
+    struct mallinfo info;
+#ifdef CONFIG_SCHED_CPULOAD
+    struct cpuload_s idle;
+#endif
+#ifdef CONFIG_MM_BUFRAM_ALLOCATOR
+    struct bufram_stats bufram;
+#endif
+
+#ifdef CONFIG_SCHED_CPULOAD
+    /* the load is what the IDLE thread didn't get */
+    if (!clock_cpuload(0, &idle) && idle.total) {
+        response->cpu_load =
+            cpu_to_le16(1000 - (uint32_t)(((uint64_t)idle.active * 1000) /
+                                          idle.total));
+        valid |= GB_VENDOR_DEBUG_HAVE_CPULOAD;
+    }
+#endif
+
+#ifdef CONFIG_CAN_PASS_STRUCTS
+    info = mallinfo();
+#else
+    (void)mallinfo(&info);
+#endif
+    response->heap_size = cpu_to_le32(info.arena);
+    response->heap_used = cpu_to_le32(info.uordblks);
+    response->heap_largest_free = cpu_to_le32(info.mxordblk);
+    valid |= GB_VENDOR_DEBUG_HAVE_HEAP;
+
+#ifdef CONFIG_MM_BUFRAM_ALLOCATOR
+    bufram_get_stats(&bufram);
+    response->bufram_free = cpu_to_le32(bufram.free_size);
+    response->bufram_largest_free = cpu_to_le32(bufram.largest_free);
+#ifdef CONFIG_MM_BUFRAM_STATS
+    response->bufram_used = cpu_to_le32(bufram.used_size);
+    response->bufram_peak_used = cpu_to_le32(bufram.peak_used);
+    response->bufram_failures = cpu_to_le32(bufram.failures);
+#endif
+    valid |= GB_VENDOR_DEBUG_HAVE_BUFRAM;
+#endif
+
+    return valid;
+}
+
+static uint16_t gb_vendor_debug_get_transfers(
+        struct gb_vendor_debug_snapshot_response *response)
+{
+    uint16_t valid = 0;
+#ifdef CONFIG_ARCH_CHIP_TSB
+    struct unipro_rx_stats rx;
+#endif
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+    struct unipro_tx_dma_stats tx;
+    uint32_t tx_xfers = 0, tx_bytes = 0, tx_busy_us = 0;
+#endif
+#ifdef CONFIG_ARCH_DMA_STATS
+    struct tsb_dma_chan_stats dma;
+    uint32_t dma_xfers = 0, dma_bytes = 0, dma_busy_us = 0, dma_errors = 0;
+    int ret;
+#endif
+#if defined(CONFIG_ARCH_UNIPROTX_USE_DMA) || defined(CONFIG_ARCH_DMA_STATS)
+    unsigned int chan;
+#endif
+
+#ifdef CONFIG_ARCH_CHIP_TSB
+    unipro_get_rx_stats(&rx);
+    response->unipro_rx_irqs = cpu_to_le32(rx.eom_irqs);
+    response->unipro_rx_msgs = cpu_to_le32(rx.eom_msgs);
+    valid |= GB_VENDOR_DEBUG_HAVE_UNIPRO_RX;
+#endif
+
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+    for (chan = 0; !unipro_tx_dma_get_stats(chan, &tx); chan++) {
+        tx_xfers += tx.xfers;
+        tx_bytes += tx.bytes;
+        tx_busy_us += tx.busy_usec;
+    }
+    response->unipro_tx_dma_xfers = cpu_to_le32(tx_xfers);
+    response->unipro_tx_dma_bytes = cpu_to_le32(tx_bytes);
+    response->unipro_tx_dma_busy_us = cpu_to_le32(tx_busy_us);
+    valid |= GB_VENDOR_DEBUG_HAVE_UNIPRO_TX_DMA;
+#endif
+
+#ifdef CONFIG_ARCH_DMA_STATS
+    for (chan = 0; ; chan++) {
+        ret = tsb_dma_get_chan_stats(chan, &dma);
+        if (ret == -ENOENT)
+            continue;
+        if (ret)
+            break;
+
+        dma_xfers += dma.completed;
+        dma_bytes += dma.bytes;
+        dma_busy_us += dma.busy_usec;
+        dma_errors += dma.errors;
+    }
+    response->dma_xfers = cpu_to_le32(dma_xfers);
+    response->dma_bytes = cpu_to_le32(dma_bytes);
+    response->dma_busy_us = cpu_to_le32(dma_busy_us);
+    response->dma_errors = cpu_to_le32(dma_errors);
+    valid |= GB_VENDOR_DEBUG_HAVE_DMA;
+#endif
+
+    return valid;
+}
+
+static void gb_vendor_debug_reset_system(void)
+{
+#ifdef CONFIG_MM_BUFRAM_STATS
+    bufram_reset_stats();
+#endif
+#ifdef CONFIG_ARCH_CHIP_TSB
+    unipro_reset_rx_stats();
+#endif
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+    unipro_tx_dma_reset_stats();
+#endif
+#ifdef CONFIG_ARCH_DMA_STATS
+    tsb_dma_reset_stats();
+#endif
+
+    gb_vendor_debug_reset_ticks = clock_systimer();
+}
+
+static uint8_t gb_vendor_debug_snapshot(struct gb_operation *operation)
+{
+    struct gb_vendor_debug_snapshot_request *request;
+    struct gb_vendor_debug_snapshot_response *response;
+    struct gb_vendor_debug_cport_stats *rs;
+    struct gb_cport_stats stats;
+    unsigned int first, cport, count, max_count;
+    uint32_t now;
+    uint16_t valid;
+    bool reset;
+
+    if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    request = gb_operation_get_request_payload(operation);
+    first = le16_to_cpu(request->first_cport_id);
+    reset = request->flags & GB_VENDOR_DEBUG_SNAPSHOT_RESET;
+
+    max_count = (GB_MAX_PAYLOAD_SIZE - sizeof(*response)) / sizeof(*rs);
+    count = 0;
+    for (cport = first; cport < gb_cport_count() && count < max_count; cport++)
+        if (gb_cport_driver_name(cport))
+            count++;
+
+    /* counters missing from this firmware read as 0 */
+    response = gb_operation_alloc_response(operation, sizeof(*response) +
+                                           count * sizeof(*rs));
+    if (!response)
+        return GB_OP_NO_MEMORY;
+
+    memset(response, 0, sizeof(*response));
+
+    now = clock_systimer();
+    response->uptime_ms = cpu_to_le32(TICK2MSEC(now));
+    response->period_ms =
+        cpu_to_le32(TICK2MSEC(now - gb_vendor_debug_reset_ticks));
+
+    valid = GB_VENDOR_DEBUG_HAVE_CPORTS;
+    valid |= gb_vendor_debug_get_system(response);
+    valid |= gb_vendor_debug_get_transfers(response);
+    response->valid = cpu_to_le16(valid);
+
+    rs = response->cports;
+    for (cport = first; rs < &response->cports[count]; cport++) {
+        if (!gb_cport_driver_name(cport))
+            continue;
+
+        memset(&stats, 0, sizeof(stats));
+        gb_cport_get_stats(cport, &stats);
+        if (reset)
+            gb_cport_reset_stats(cport);
+
+        rs->cport_id = cpu_to_le16(cport);
+        rs->pad = 0;
+        rs->requests_in = cpu_to_le32(stats.requests_in);
+        rs->requests_out = cpu_to_le32(stats.requests_out);
+        rs->responses_in = cpu_to_le32(stats.responses_in);
+        rs->responses_out = cpu_to_le32(stats.responses_out);
+        rs->bytes_in = cpu_to_le32(stats.bytes_in);
+        rs->bytes_out = cpu_to_le32(stats.bytes_out);
+        rs->timeouts = cpu_to_le32(stats.timeouts);
+        rs->oom_responses = cpu_to_le32(stats.oom_responses);
+        rs->rx_drops = cpu_to_le32(stats.rx_drops);
+        rs->rx_fifo_hwm = cpu_to_le32(stats.rx_fifo_hwm);
+        rs++;
+    }
+    response->nr_cports = count;
+
+    if (reset && first == 0)
+        gb_vendor_debug_reset_system();
+
+    return GB_OP_SUCCESS;
+}
+
+static uint8_t gb_vendor_debug_reset(struct gb_operation *operation)
+{
+    unsigned int cport;
+
+    for (cport = 0; cport < gb_cport_count(); cport++)
+        gb_cport_reset_stats(cport);
+
+    gb_vendor_debug_reset_system();
+
+    return GB_OP_SUCCESS;
+}
+
+static int gb_vendor_debug_init(unsigned int cport, struct gb_bundle *bundle)
+{
+    gb_vendor_debug_reset_ticks = clock_systimer();
+    return 0;
+}
+
+static struct gb_operation_handler gb_vendor_debug_handlers[] = {
+    GB_HANDLER(GB_VENDOR_DEBUG_TYPE_PROTOCOL_VERSION,
+               gb_vendor_debug_protocol_version),
+    GB_HANDLER(GB_VENDOR_DEBUG_TYPE_SNAPSHOT, gb_vendor_debug_snapshot),
+    GB_HANDLER(GB_VENDOR_DEBUG_TYPE_RESET, gb_vendor_debug_reset),
+};
+
+static struct gb_driver gb_vendor_debug_driver = {
+    .init = gb_vendor_debug_init,
+    .op_handlers = gb_vendor_debug_handlers,
+    .op_handlers_count = ARRAY_SIZE(gb_vendor_debug_handlers),
+};
+
+void gb_vendor_debug_register(int cport, int bundle)
+{
+    gb_register_driver(cport, bundle, &gb_vendor_debug_driver);
+}
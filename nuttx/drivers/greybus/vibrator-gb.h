@@ -37,6 +37,11 @@
 #define GB_VIBRATOR_TYPE_PROTOCOL_VERSION    0x01
 #define GB_VIBRATOR_TYPE_VIBRATOR_ON         0x02
 #define GB_VIBRATOR_TYPE_VIBRATOR_OFF        0x03
+/* Not part of the protocol specification */
+#define GB_VIBRATOR_TYPE_PATTERN             0x7e
+
+/* pattern repeat count for endless playback */
+#define GB_VIBRATOR_PATTERN_FOREVER          0xffff
 
 /* version request has no payload */
 struct gb_vibrator_proto_version_response {
@@ -48,4 +53,18 @@ struct gb_vibrator_on_request {
     __le16 timeout_ms;
 } __packed;
 
+struct gb_vibrator_pattern_step {
+    __u8   level;       /* 0 (off) to 255 (full strength) */
+    __u8   pad;
+    __le16 duration_ms;
+} __packed;
+
+/* a pattern with no step stops the playback */
+struct gb_vibrator_pattern_request {
+    __le16 repeat;      /* times played after the first one */
+    __u8   count;
+    __u8   pad;
+    struct gb_vibrator_pattern_step steps[0];
+} __packed;
+
 #endif /* __VIBRATOR_GB_H__ */
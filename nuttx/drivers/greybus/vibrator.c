@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <debug.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <nuttx/greybus/greybus.h>
 #include <nuttx/greybus/debug.h>
@@ -37,6 +38,14 @@
 #include <nuttx/gpio.h>
 #include <arch/byteorder.h>
 
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+#include <semaphore.h>
+#include <nuttx/clock.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/hires_tmr.h>
+#include <nuttx/device_pwm.h>
+#endif
+
 #include "vibrator-gb.h"
 
 
@@ -47,6 +56,124 @@
 /* Pick a GPIO line exposed on APBridge2 via the schematics */
 #define GB_VIBRATOR_DUMMY_GPIO       0x00
 
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+#define GB_VIBRATOR_PWM              CONFIG_GREYBUS_VIBRATOR_PWM
+#define GB_VIBRATOR_PWM_PERIOD       CONFIG_GREYBUS_VIBRATOR_PWM_PERIOD
+#define GB_VIBRATOR_PATTERN_STEPS    CONFIG_GREYBUS_VIBRATOR_PATTERN_STEPS
+
+struct gb_vibrator_step {
+    uint8_t level;
+    uint16_t duration_ms;
+};
+
+/*
+ * The steps are scheduled against the start of the pattern rather than the
+ * previous step, so that the work queue latency does not accumulate.
+ */
+static struct {
+    sem_t lock;
+    struct work_s work;
+    /* PWM controller, NULL to drive the GPIO */
+    struct device *pwm;
+    struct gb_vibrator_step steps[GB_VIBRATOR_PATTERN_STEPS];
+    uint8_t count;
+    uint8_t index;
+    uint16_t repeat;
+    /* bumped by every new pattern, to retire the stale workers */
+    uint32_t generation;
+    uint32_t start_us;
+    uint32_t deadline_ms;
+} g_vibrator;
+
+static void gb_vibrator_set_level(uint8_t level)
+{
+    struct pwm_update update;
+
+    if (!g_vibrator.pwm) {
+        gpio_set_value(GB_VIBRATOR_DUMMY_GPIO, !!level);
+        return;
+    }
+
+    /* applied at the end of the current PWM period, without glitch */
+    update.which = GB_VIBRATOR_PWM;
+    if (level) {
+        update.flags = PWM_UPDATE_CONFIG | PWM_UPDATE_ENABLE;
+        update.duty = (uint64_t)GB_VIBRATOR_PWM_PERIOD * level / 255;
+        update.period = GB_VIBRATOR_PWM_PERIOD;
+    } else {
+        update.flags = PWM_UPDATE_DISABLE;
+    }
+
+    device_pwm_update(g_vibrator.pwm, &update, 1);
+}
+
+static void gb_vibrator_pattern_worker(void *arg)
+{
+    uint32_t elapsed_ms;
+    uint32_t delay = 0;
+
+    sem_wait(&g_vibrator.lock);
+
+    if ((uint32_t)arg != g_vibrator.generation || !g_vibrator.count)
+        goto out;
+
+    if (g_vibrator.index == g_vibrator.count) {
+        if (!g_vibrator.repeat) {
+            gb_vibrator_set_level(0);
+            g_vibrator.count = 0;
+            goto out;
+        }
+
+        if (g_vibrator.repeat != GB_VIBRATOR_PATTERN_FOREVER)
+            g_vibrator.repeat--;
+
+        /* keep the elapsed time far from the timer wrap */
+        g_vibrator.start_us += g_vibrator.deadline_ms * 1000;
+        g_vibrator.deadline_ms = 0;
+        g_vibrator.index = 0;
+    }
+
+    gb_vibrator_set_level(g_vibrator.steps[g_vibrator.index].level);
+    g_vibrator.deadline_ms += g_vibrator.steps[g_vibrator.index].duration_ms;
+    g_vibrator.index++;
+
+    elapsed_ms = (hrt_getusec() - g_vibrator.start_us) / 1000;
+    if (g_vibrator.deadline_ms > elapsed_ms)
+        delay = MSEC2TICK(g_vibrator.deadline_ms - elapsed_ms);
+
+    work_queue(HPWORK, &g_vibrator.work, gb_vibrator_pattern_worker, arg,
+               delay);
+
+out:
+    sem_post(&g_vibrator.lock);
+}
+
+/*
+ * Replace the pattern being played, if any. Called with g_vibrator.lock
+ * held.
+ */
+static void gb_vibrator_pattern_play(const struct gb_vibrator_step *steps,
+                                     uint8_t count, uint16_t repeat)
+{
+    work_cancel(HPWORK, &g_vibrator.work);
+    g_vibrator.generation++;
+
+    memcpy(g_vibrator.steps, steps, count * sizeof(*steps));
+    g_vibrator.count = count;
+    g_vibrator.index = 0;
+    g_vibrator.repeat = repeat;
+    g_vibrator.start_us = hrt_getusec();
+    g_vibrator.deadline_ms = 0;
+
+    if (count) {
+        work_queue(HPWORK, &g_vibrator.work, gb_vibrator_pattern_worker,
+                   (void *)g_vibrator.generation, 0);
+    } else {
+        gb_vibrator_set_level(0);
+    }
+}
+#endif
+
 static uint8_t gb_vibrator_protocol_version(struct gb_operation *operation)
 {
     struct gb_vibrator_proto_version_response *response;
@@ -65,40 +192,133 @@ static uint8_t gb_vibrator_vibrator_on(struct gb_operation *operation)
 {
     struct gb_vibrator_on_request *request =
             gb_operation_get_request_payload(operation);
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+    struct gb_vibrator_step step;
+#endif
 
     if (gb_operation_get_request_payload_size(operation) < sizeof(*request)) {
         gb_error("dropping short message\n");
         return GB_OP_INVALID;
     }
 
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+    /* a single step pattern, which does not hold the CPort until it ends */
+    step.level = 255;
+    step.duration_ms = le16_to_cpu(request->timeout_ms);
+
+    sem_wait(&g_vibrator.lock);
+    gb_vibrator_pattern_play(&step, 1, 0);
+    sem_post(&g_vibrator.lock);
+#else
     gpio_activate(GB_VIBRATOR_DUMMY_GPIO);
     gpio_set_value(GB_VIBRATOR_DUMMY_GPIO, 1);
 
     usleep(le16_to_cpu(request->timeout_ms));
 
     gpio_deactivate(GB_VIBRATOR_DUMMY_GPIO);
+#endif
 
     return GB_OP_SUCCESS;
 }
 
 static uint8_t gb_vibrator_vibrator_off(struct gb_operation *operation)
 {
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+    sem_wait(&g_vibrator.lock);
+    gb_vibrator_pattern_play(NULL, 0, 0);
+    sem_post(&g_vibrator.lock);
+#else
     // Deactivate the GPIO line, somehow.
 
     gpio_activate(GB_VIBRATOR_DUMMY_GPIO);
     gpio_set_value(GB_VIBRATOR_DUMMY_GPIO, 0);
     gpio_deactivate(GB_VIBRATOR_DUMMY_GPIO);
+#endif
+
+    return GB_OP_SUCCESS;
+}
+
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+static uint8_t gb_vibrator_pattern(struct gb_operation *operation)
+{
+    struct gb_vibrator_pattern_request *request =
+            gb_operation_get_request_payload(operation);
+    struct gb_vibrator_step steps[GB_VIBRATOR_PATTERN_STEPS];
+    size_t size = gb_operation_get_request_payload_size(operation);
+    int i;
+
+    if (size < sizeof(*request) ||
+        size < sizeof(*request) + request->count * sizeof(request->steps[0])) {
+        gb_error("dropping short message\n");
+        return GB_OP_INVALID;
+    }
+
+    if (request->count > GB_VIBRATOR_PATTERN_STEPS)
+        return GB_OP_INVALID;
+
+    for (i = 0; i < request->count; i++) {
+        steps[i].level = request->steps[i].level;
+        steps[i].duration_ms = le16_to_cpu(request->steps[i].duration_ms);
+    }
+
+    sem_wait(&g_vibrator.lock);
+    gb_vibrator_pattern_play(steps, request->count,
+                             le16_to_cpu(request->repeat));
+    sem_post(&g_vibrator.lock);
 
     return GB_OP_SUCCESS;
 }
 
+static int gb_vibrator_init(unsigned int cport, struct gb_bundle *bundle)
+{
+    sem_init(&g_vibrator.lock, 0, 1);
+
+    g_vibrator.pwm = device_open(DEVICE_TYPE_PWM_HW, 0);
+    if (g_vibrator.pwm &&
+        device_pwm_activate(g_vibrator.pwm, GB_VIBRATOR_PWM)) {
+        device_close(g_vibrator.pwm);
+        g_vibrator.pwm = NULL;
+    }
+
+    /* the GPIO stays active while the patterns can use it */
+    if (!g_vibrator.pwm)
+        gpio_activate(GB_VIBRATOR_DUMMY_GPIO);
+
+    return 0;
+}
+
+static void gb_vibrator_exit(unsigned int cport, struct gb_bundle *bundle)
+{
+    sem_wait(&g_vibrator.lock);
+    gb_vibrator_pattern_play(NULL, 0, 0);
+    sem_post(&g_vibrator.lock);
+
+    if (g_vibrator.pwm) {
+        device_pwm_deactivate(g_vibrator.pwm, GB_VIBRATOR_PWM);
+        device_close(g_vibrator.pwm);
+        g_vibrator.pwm = NULL;
+    } else {
+        gpio_deactivate(GB_VIBRATOR_DUMMY_GPIO);
+    }
+
+    sem_destroy(&g_vibrator.lock);
+}
+#endif
+
 static struct gb_operation_handler gb_vibrator_handlers[] = {
     GB_HANDLER(GB_VIBRATOR_TYPE_PROTOCOL_VERSION, gb_vibrator_protocol_version),
     GB_HANDLER(GB_VIBRATOR_TYPE_VIBRATOR_ON, gb_vibrator_vibrator_on),
     GB_HANDLER(GB_VIBRATOR_TYPE_VIBRATOR_OFF, gb_vibrator_vibrator_off),
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+    GB_HANDLER(GB_VIBRATOR_TYPE_PATTERN, gb_vibrator_pattern),
+#endif
 };
 
 static struct gb_driver gb_vibrator_driver = {
+#ifdef CONFIG_GREYBUS_VIBRATOR_PATTERN
+    .init = gb_vibrator_init,
+    .exit = gb_vibrator_exit,
+#endif
     .op_handlers = gb_vibrator_handlers,
     .op_handlers_count = ARRAY_SIZE(gb_vibrator_handlers),
 };
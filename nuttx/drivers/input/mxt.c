@@ -95,6 +95,12 @@
   (((uint16_t)(((FAR uint8_t*)(p))[1]) << 8) | \
     (uint16_t)(((FAR uint8_t*)(p))[0]))
 
+/* Size of the message buffer: The T44 message count followed by up to
+ * CONFIG_MXT_MSGBURST messages.
+ */
+
+#define MXT_MSGBUF_SIZE  (1 + CONFIG_MXT_MSGBURST * sizeof(struct mxt_msg_s))
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -191,6 +197,8 @@ struct mxt_dev_s
 #ifdef CONFIG_MXT_BUTTONS
   uint8_t t19id;                   /* T19 button report ID */
 #endif
+  uint16_t t5addr;                 /* T5 message processor address */
+  uint16_t t44addr;                /* T44 message count address (0: no burst) */
 
   volatile bool event;             /* True: An unreported event is buffered */
   sem_t devsem;                    /* Manages exclusive access to this structure */
@@ -201,6 +209,10 @@ struct mxt_dev_s
   struct mxt_info_s info;          /* Configuration info read from device */
   struct work_s work;              /* Supports the interrupt handling "bottom half" */
 
+  /* Messages read by the worker: The T44 count byte, then the messages */
+
+  uint8_t msgbuf[MXT_MSGBUF_SIZE];
+
   /* The following is a list if poll structures of threads waiting for
    * driver events. The 'struct pollfd' reference for each open is also
    * retained in the f_priv field of the 'struct file'.
@@ -227,6 +239,7 @@ static FAR struct mxt_object_s *mxt_object(FAR struct mxt_dev_s *priv,
               uint8_t type);
 static int mxt_getmessage(FAR struct mxt_dev_s *priv,
               FAR struct mxt_msg_s *msg);
+static int mxt_getmessages(FAR struct mxt_dev_s *priv);
 static int mxt_putobject(FAR struct mxt_dev_s *priv, uint8_t type,
               uint8_t offset, uint8_t value);
 #if 0 /* Not used */
@@ -252,6 +265,8 @@ static void mxt_button_event(FAR struct mxt_dev_s *priv,
 #endif
 static void mxt_touch_event(FAR struct mxt_dev_s *priv,
               FAR struct mxt_msg_s *msg, int ndx);
+static bool mxt_message(FAR struct mxt_dev_s *priv,
+              FAR struct mxt_msg_s *msg);
 static void mxt_worker(FAR void *arg);
 static int  mxt_interrupt(FAR const struct mxt_lower_s *lower,
               FAR void *arg);
@@ -487,6 +502,74 @@ static int mxt_getmessage(FAR struct mxt_dev_s *priv,
                     sizeof(struct mxt_msg_s));
 }
 
+/****************************************************************************
+ * Name: mxt_getmessages
+ *
+ * Description:
+ *   Read the pending messages into priv->msgbuf and return their number.
+ *
+ *   If the T44 message count immediately precedes T5, the count and the
+ *   first message are read in one transfer, then all of the other pending
+ *   messages (up to CONFIG_MXT_MSGBURST) in a second one.  Otherwise, one
+ *   message is read per call.
+ *
+ ****************************************************************************/
+
+static int mxt_getmessages(FAR struct mxt_dev_s *priv)
+{
+  FAR struct mxt_msg_s *msg = (FAR struct mxt_msg_s *)&priv->msgbuf[1];
+  int nmsgs;
+  int ret;
+
+  if (priv->t44addr == 0)
+    {
+      ret = mxt_getreg(priv, priv->t5addr, (FAR uint8_t *)msg,
+                       sizeof(struct mxt_msg_s));
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      return msg->id == 0xff ? 0 : 1;
+    }
+
+  /* Read the message count and the first message */
+
+  ret = mxt_getreg(priv, priv->t44addr, priv->msgbuf,
+                   1 + sizeof(struct mxt_msg_s));
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  nmsgs = priv->msgbuf[0];
+  if (nmsgs == 0)
+    {
+      return 0;
+    }
+
+  /* Any messages beyond the buffer are left for the next call */
+
+  if (nmsgs > CONFIG_MXT_MSGBURST)
+    {
+      nmsgs = CONFIG_MXT_MSGBURST;
+    }
+
+  /* Then the rest of the messages in one burst */
+
+  if (nmsgs > 1)
+    {
+      ret = mxt_getreg(priv, priv->t5addr, (FAR uint8_t *)&msg[1],
+                       (nmsgs - 1) * sizeof(struct mxt_msg_s));
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return nmsgs;
+}
+
 /****************************************************************************
  * Name: mxt_putobject
  ****************************************************************************/
@@ -942,12 +1025,73 @@ static void mxt_touch_event(FAR struct mxt_dev_s *priv,
         }
     }
 
-  /* Indicate the availability of new sample data for this ID and notify
-   * any waiters that new maXTouch data is available
+  /* Indicate the availability of new sample data for this ID.  The waiters
+   * are notified by the worker once all of the messages of the frame have
+   * been processed, so that the frame is reported as a whole.
    */
 
   priv->event = true;
-  mxt_notify(priv);
+}
+
+/****************************************************************************
+ * Name: mxt_message
+ *
+ * Description:
+ *   Handle one message from the maXTouch.  Returns false if the message was
+ *   ignored.
+ *
+ ****************************************************************************/
+
+static bool mxt_message(FAR struct mxt_dev_s *priv,
+                        FAR struct mxt_msg_s *msg)
+{
+  uint8_t id = msg->id;
+
+#ifdef MXT_SUPPORT_T6
+  /* Check for T6 */
+
+  if (id == priv->t6id)
+    {
+      uint32_t chksum;
+      int status;
+
+      status = msg->body[0];
+      chksum = (uint32_t)msg->body[1] |
+              ((uint32_t)msg->body[2] << 8) |
+              ((uint32_t)msg->body[3] << 16);
+
+      ivdbg("T6: status: %02x checksum: %06lx\n",
+            status, (unsigned long)chksum);
+
+      return true;
+    }
+#endif
+
+  /* Check for T9 */
+
+  if (id >= priv->t9idmin && id <= priv->t9idmax)
+    {
+      mxt_touch_event(priv, msg, id - priv->t9idmin);
+      return true;
+    }
+
+#ifdef CONFIG_MXT_BUTTONS
+  /* Check for T19 */
+
+  if (id == priv->t19id)
+    {
+      mxt_button_event(priv, msg);
+      return true;
+    }
+#endif
+
+  /* Any other message IDs are ignored (after complaining a little). */
+
+  ivdbg("Ignored: id=%u message={%02x %02x %02x %02x %02x %02x %02x}\n",
+        id, msg->body[0], msg->body[1], msg->body[2], msg->body[3],
+        msg->body[4], msg->body[5], msg->body[6]);
+
+  return false;
 }
 
 /****************************************************************************
@@ -958,10 +1102,11 @@ static void mxt_worker(FAR void *arg)
 {
   FAR struct mxt_dev_s *priv = (FAR struct mxt_dev_s *)arg;
   FAR const struct mxt_lower_s *lower;
-  struct mxt_msg_s msg;
-  uint8_t id;
+  FAR struct mxt_msg_s *msg;
+  int nmsgs;
   int retries;
   int ret;
+  int i;
 
   ASSERT(priv != NULL);
 
@@ -981,77 +1126,44 @@ static void mxt_worker(FAR void *arg)
     }
   while (ret < 0);
 
-  /* Loop, processing each message from the maXTouch */
+  /* Loop, processing the messages from the maXTouch until there are no
+   * more pending (or until too many unexpected messages were seen).
+   */
 
   retries = 0;
   do
     {
-      /* Retrieve the next message from the maXTouch */
-
-      ret = mxt_getmessage(priv, &msg);
-      if (ret < 0)
-        {
-          idbg("ERROR: mxt_getmessage failed: %d\n", ret);
-          goto errout_with_semaphore;
-        }
-
-      id = msg.id;
-
-#ifdef MXT_SUPPORT_T6
-      /* Check for T6 */
-
-      if (id == priv->t6id)
-        {
-          uint32_t chksum;
-          int status;
-
-          status = msg.body[0];
-          chksum = (uint32_t)msg.body[1] |
-                  ((uint32_t)msg.body[2] << 8) |
-                  ((uint32_t)msg.body[3] << 16);
+      /* Retrieve the pending messages from the maXTouch */
 
-          ivdbg("T6: status: %02x checksum: %06lx\n",
-                status, (unsigned long)chksum);
-
-          retries = 0;
-        }
-      else
-#endif
-
-      /* Check for T9 */
-
-      if (id >= priv->t9idmin && id <= priv->t9idmax)
+      nmsgs = mxt_getmessages(priv);
+      if (nmsgs < 0)
         {
-          mxt_touch_event(priv, &msg, id - priv->t9idmin);
-          retries = 0;
+          idbg("ERROR: mxt_getmessages failed: %d\n", nmsgs);
+          break;
         }
 
-#ifdef CONFIG_MXT_BUTTONS
-      /* Check for T19 */
-
-      else if (msg.id == priv->t19id)
+      msg = (FAR struct mxt_msg_s *)&priv->msgbuf[1];
+      for (i = 0; i < nmsgs; i++, msg++)
         {
-          mxt_button_event(priv, &msg);
-          retries = 0;
+          if (mxt_message(priv, msg))
+            {
+              retries = 0;
+            }
+          else
+            {
+              retries++;
+            }
         }
-#endif
-
-      /* 0xff marks the end of the messages; any other message IDs are ignored
-       * (after complaining a little).
-       */
+    }
+  while (nmsgs > 0 && retries < 16);
 
-      else if (msg.id != 0xff)
-        {
-          ivdbg("Ignored: id=%u message={%02x %02x %02x %02x %02x %02x %02x}\n",
-                msg.id, msg.body[0], msg.body[1], msg.body[2], msg.body[3],
-                msg.body[4], msg.body[5], msg.body[6]);
+  /* Notify any waiters that a new frame of maXTouch data is available */
 
-          retries++;
-        }
+  if (priv->event)
+    {
+      mxt_notify(priv);
     }
-  while (id != 0xff && retries < 16);
 
-errout_with_semaphore:
   /* Release our lock on the MXT device */
 
   sem_post(&priv->devsem);
@@ -1652,6 +1764,8 @@ static int mxt_getinfo(struct mxt_dev_s *priv)
 static int mxt_getobjtab(FAR struct mxt_dev_s *priv)
 {
   FAR struct mxt_object_s *object;
+  uint16_t t44addr = 0;
+  uint8_t t5size = 0;
   size_t tabsize;
   uint8_t idmin;
   uint8_t idmax;
@@ -1695,6 +1809,15 @@ static int mxt_getobjtab(FAR struct mxt_dev_s *priv)
 
       switch (object->type)
         {
+        case MXT_GEN_MESSAGE_T5:
+          priv->t5addr = MXT_GETUINT16(object->addr);
+          t5size       = object->size;
+          break;
+
+        case MXT_SPT_MESSAGECOUNT_T44:
+          t44addr = MXT_GETUINT16(object->addr);
+          break;
+
 #ifdef MXT_SUPPORT_T6
         case MXT_GEN_COMMAND_T6:
           priv->t6id = idmin;
@@ -1716,6 +1839,18 @@ static int mxt_getobjtab(FAR struct mxt_dev_s *priv)
         }
     }
 
+  /* Burst reads need the T44 count byte right before T5 and messages of
+   * the size we read (the T5 size includes a trailing checksum byte).
+   */
+
+  priv->t44addr = 0;
+  if (CONFIG_MXT_MSGBURST > 1 && t44addr != 0 &&
+      t44addr + 1 == priv->t5addr && t5size == sizeof(struct mxt_msg_s))
+    {
+      priv->t44addr = t44addr;
+    }
+
+  ivdbg("Burst reads: %s\n", priv->t44addr != 0 ? "yes" : "no");
   return OK;
 }
 
@@ -58,6 +58,7 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -97,6 +98,7 @@ static ssize_t loop_write(FAR struct inode *inode, const unsigned char *buffer,
                         size_t start_sector, unsigned int nsectors);
 #endif
 static int     loop_geometry(FAR struct inode *inode, struct geometry *geometry);
+static int     loop_ioctl(FAR struct inode *inode, int cmd, unsigned long arg);
 
 /****************************************************************************
  * Private Data
@@ -113,7 +115,7 @@ static const struct block_operations g_bops =
   NULL,          /* write    */
 #endif
   loop_geometry, /* geometry */
-  NULL           /* ioctl    */
+  loop_ioctl     /* ioctl    */
 };
 
 /****************************************************************************
@@ -333,6 +335,37 @@ static int loop_geometry(FAR struct inode *inode, struct geometry *geometry)
   return -EINVAL;
 }
 
+/****************************************************************************
+ * Name: loop_ioctl
+ *
+ * Description: Map the device to memory when the exported file is itself
+ *   memory mapped (a XIP ROMFS file or a BCH driver over a RAM disk, for
+ *   example), so that BCH and the file systems can access it directly.
+ *
+ ****************************************************************************/
+
+static int loop_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
+{
+  FAR struct loop_struct_s *dev;
+  FAR uint8_t **ppv = (FAR uint8_t **)((uintptr_t)arg);
+  FAR uint8_t *base;
+
+  DEBUGASSERT(inode && inode->i_private);
+  if (cmd == BIOC_XIPBASE && ppv)
+    {
+      dev = (FAR struct loop_struct_s *)inode->i_private;
+      if (ioctl(dev->fd, FIOC_MMAP, (unsigned long)((uintptr_t)&base)) < 0)
+        {
+          return -get_errno();
+        }
+
+      *ppv = base + dev->offset;
+      return OK;
+    }
+
+  return -ENOTTY;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -46,10 +46,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <semaphore.h>
+#include <assert.h>
 #include <debug.h>
 #include <errno.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/mtd/mtd.h>
@@ -63,6 +67,40 @@
 #  define FTL_HAVE_RWBUFFER 1
 #endif
 
+/* Erase-ahead configuration */
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+#  ifndef CONFIG_FS_WRITABLE
+#    error "CONFIG_FTL_ERASEAHEAD requires CONFIG_FS_WRITABLE"
+#  endif
+#  ifndef CONFIG_SCHED_WORKQUEUE
+#    error "CONFIG_FTL_ERASEAHEAD requires CONFIG_SCHED_WORKQUEUE"
+#  endif
+
+#  ifndef CONFIG_FTL_NSPARES
+#    define CONFIG_FTL_NSPARES 4
+#  endif
+
+#  ifndef CONFIG_FTL_ERASEDELAY
+#    define CONFIG_FTL_ERASEDELAY 500
+#  endif
+
+/* In erase-ahead mode, the last R/W block of each physical erase block
+ * holds a header that tells which logical erase block it contains.  The
+ * block with the highest sequence number wins.
+ */
+
+#  define FTL_MAGIC          0x314c5446 /* "FTL1" */
+#  define FTL_UNMAPPED       0xffff
+
+/* Physical erase block states */
+
+#  define FTL_PBLOCK_MAPPED  0  /* Holds the current copy of a logical block */
+#  define FTL_PBLOCK_CLEAN   1  /* Erased and ready to be written */
+#  define FTL_PBLOCK_DIRTY   2  /* Stale or unknown, must be erased */
+#  define FTL_PBLOCK_BAD     3  /* Erase failed, never used again */
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -78,8 +116,32 @@ struct ftl_struct_s
 #ifdef CONFIG_FS_WRITABLE
   FAR uint8_t          *eblock;  /* One, in-memory erase block */
 #endif
+#ifdef CONFIG_FTL_ERASEAHEAD
+  sem_t                 exclsem; /* Serializes remapping and background erase */
+  struct work_s         work;    /* Background erase work */
+  FAR uint16_t         *lmap;    /* Logical to physical erase block map */
+  FAR uint8_t          *pstate;  /* State of each physical erase block */
+  uint16_t              nlblocks; /* Number of logical erase blocks */
+  uint16_t              dblkper; /* Data R/W blocks per erase block */
+  uint16_t              nclean;  /* Number of pre-erased physical blocks */
+  uint16_t              ndirty;  /* Number of physical blocks to be erased */
+  uint16_t              nextclean; /* Where to look for the next clean block */
+  uint32_t              seqno;   /* Sequence number of the last block written */
+#endif
 };
 
+#ifdef CONFIG_FTL_ERASEAHEAD
+/* Header in the last R/W block of each written physical erase block */
+
+struct ftl_header_s
+{
+  uint32_t              magic;   /* FTL_MAGIC */
+  uint32_t              seqno;   /* Write sequence number */
+  uint16_t              lblock;  /* Logical erase block stored here */
+  uint16_t              check;   /* ~lblock */
+};
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -154,6 +216,7 @@ static int ftl_close(FAR struct inode *inode)
  *
  ****************************************************************************/
 
+#ifndef CONFIG_FTL_ERASEAHEAD
 static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
                           off_t startblock, size_t nblocks)
 {
@@ -171,6 +234,7 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 
   return nread;
 }
+#endif
 
 /****************************************************************************
  * Name: ftl_read
@@ -203,7 +267,7 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
  *
  ****************************************************************************/
 
-#ifdef CONFIG_FS_WRITABLE
+#if defined(CONFIG_FS_WRITABLE) && !defined(CONFIG_FTL_ERASEAHEAD)
 static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                          off_t startblock, size_t nblocks)
 {
@@ -373,6 +437,420 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
 }
 #endif
 
+/****************************************************************************
+ * Name: ftl_semtake
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static void ftl_semtake(FAR struct ftl_struct_s *dev)
+{
+  while (sem_wait(&dev->exclsem) != 0)
+    {
+      ASSERT(get_errno() == EINTR);
+    }
+}
+
+#define ftl_semgive(d) sem_post(&(d)->exclsem)
+#endif
+
+/****************************************************************************
+ * Name: ftl_pblock_erase
+ *
+ * Description:
+ *   Erase one dirty physical erase block and return it to the clean pool.
+ *
+ * Assumptions:
+ *   The caller holds exclsem.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static int ftl_pblock_erase(FAR struct ftl_struct_s *dev, uint16_t pblock)
+{
+  int ret;
+
+  DEBUGASSERT(dev->pstate[pblock] == FTL_PBLOCK_DIRTY);
+
+  dev->ndirty--;
+  ret = MTD_ERASE(dev->mtd, pblock, 1);
+  if (ret < 0)
+    {
+      fdbg("Erase block=%d failed: %d\n", pblock, ret);
+      dev->pstate[pblock] = FTL_PBLOCK_BAD;
+      return ret;
+    }
+
+  dev->pstate[pblock] = FTL_PBLOCK_CLEAN;
+  dev->nclean++;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_pblock_alloc
+ *
+ * Description:
+ *   Take a physical erase block from the pre-erased pool.  Clean blocks
+ *   are handed out round-robin so that the writes spread over the whole
+ *   device.  If the background erase has not kept up, erase a dirty block
+ *   now.
+ *
+ * Assumptions:
+ *   The caller holds exclsem.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static int ftl_pblock_alloc(FAR struct ftl_struct_s *dev)
+{
+  uint16_t pblock;
+  uint16_t i;
+
+  for (i = 0; i < dev->geo.neraseblocks; i++)
+    {
+      pblock = dev->nextclean;
+      if (++dev->nextclean >= dev->geo.neraseblocks)
+        {
+          dev->nextclean = 0;
+        }
+
+      if (dev->nclean > 0)
+        {
+          if (dev->pstate[pblock] != FTL_PBLOCK_CLEAN)
+            {
+              continue;
+            }
+        }
+      else if (dev->pstate[pblock] != FTL_PBLOCK_DIRTY ||
+               ftl_pblock_erase(dev, pblock) < 0)
+        {
+          continue;
+        }
+
+      dev->pstate[pblock] = FTL_PBLOCK_MAPPED;
+      dev->nclean--;
+      return pblock;
+    }
+
+  return -ENOSPC;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_erasework
+ *
+ * Description:
+ *   Background erase.  Runs on the low priority work queue once writes
+ *   have been idle for CONFIG_FTL_ERASEDELAY milliseconds and erases one
+ *   dirty block at a time so that a writer never waits for more than one
+ *   erase.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static void ftl_erasework(FAR void *arg)
+{
+  FAR struct ftl_struct_s *dev = (FAR struct ftl_struct_s *)arg;
+  uint16_t pblock;
+
+  ftl_semtake(dev);
+  for (pblock = 0; pblock < dev->geo.neraseblocks; pblock++)
+    {
+      if (dev->pstate[pblock] == FTL_PBLOCK_DIRTY)
+        {
+          (void)ftl_pblock_erase(dev, pblock);
+          break;
+        }
+    }
+
+  if (dev->ndirty > 0)
+    {
+      (void)work_queue(LPWORK, &dev->work, ftl_erasework, dev, 0);
+    }
+
+  ftl_semgive(dev);
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_scan
+ *
+ * Description:
+ *   Rebuild the logical to physical map from the block headers.  Anything
+ *   that is not the newest copy of a logical block is queued for erase.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static int ftl_scan(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_header_s *hdr;
+  FAR uint32_t *seqno;
+  uint16_t pblock;
+  uint16_t lblock;
+  uint16_t prev;
+  ssize_t nread;
+
+  seqno = (FAR uint32_t *)kmm_malloc(dev->nlblocks * sizeof(uint32_t));
+  if (!seqno)
+    {
+      return -ENOMEM;
+    }
+
+  memset(dev->lmap, 0xff, dev->nlblocks * sizeof(uint16_t));
+  hdr = (FAR struct ftl_header_s *)dev->eblock;
+
+  for (pblock = 0; pblock < dev->geo.neraseblocks; pblock++)
+    {
+      dev->pstate[pblock] = FTL_PBLOCK_DIRTY;
+      dev->ndirty++;
+
+      nread = MTD_BREAD(dev->mtd, pblock * dev->blkper + dev->dblkper, 1,
+                        dev->eblock);
+      if (nread != 1 || hdr->magic != FTL_MAGIC ||
+          hdr->lblock >= dev->nlblocks ||
+          hdr->check != (uint16_t)~hdr->lblock)
+        {
+          continue;
+        }
+
+      lblock = hdr->lblock;
+      prev   = dev->lmap[lblock];
+      if (prev != FTL_UNMAPPED)
+        {
+          if ((int32_t)(hdr->seqno - seqno[lblock]) < 0)
+            {
+              continue;
+            }
+
+          /* This copy is newer.  The older one goes back to be erased */
+
+          dev->pstate[prev] = FTL_PBLOCK_DIRTY;
+          dev->ndirty++;
+        }
+
+      dev->lmap[lblock]   = pblock;
+      dev->pstate[pblock] = FTL_PBLOCK_MAPPED;
+      dev->ndirty--;
+      seqno[lblock]       = hdr->seqno;
+
+      if ((int32_t)(hdr->seqno - dev->seqno) > 0)
+        {
+          dev->seqno = hdr->seqno;
+        }
+    }
+
+  kmm_free(seqno);
+
+  fvdbg("Mapped: %d dirty: %d\n",
+        dev->geo.neraseblocks - dev->ndirty, dev->ndirty);
+
+  /* Start pre-erasing right away */
+
+  if (dev->ndirty > 0)
+    {
+      (void)work_queue(LPWORK, &dev->work, ftl_erasework, dev, 0);
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_reload
+ *
+ * Description:  Read the specified numer of sectors through the logical to
+ *   physical erase block map.  Sectors of logical blocks that were never
+ *   written read as erased.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
+                          off_t startblock, size_t nblocks)
+{
+  struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
+  uint16_t lblock;
+  uint16_t pblock;
+  off_t    offset;
+  size_t   remaining;
+  size_t   nxfr;
+  ssize_t  nread;
+
+  ftl_semtake(dev);
+  for (remaining = nblocks; remaining > 0; remaining -= nxfr)
+    {
+      lblock = startblock / dev->dblkper;
+      offset = startblock % dev->dblkper;
+      nxfr   = dev->dblkper - offset;
+      if (nxfr > remaining)
+        {
+          nxfr = remaining;
+        }
+
+      if (lblock >= dev->nlblocks)
+        {
+          ftl_semgive(dev);
+          return -EINVAL;
+        }
+
+      pblock = dev->lmap[lblock];
+      if (pblock == FTL_UNMAPPED)
+        {
+          memset(buffer, 0xff, nxfr * dev->geo.blocksize);
+        }
+      else
+        {
+          nread = MTD_BREAD(dev->mtd, pblock * dev->blkper + offset, nxfr,
+                            buffer);
+          if (nread != nxfr)
+            {
+              fdbg("Read %d blocks starting at block %d failed: %d\n",
+                   nxfr, pblock * dev->blkper + offset, nread);
+              ftl_semgive(dev);
+              return -EIO;
+            }
+        }
+
+      startblock += nxfr;
+      buffer     += nxfr * dev->geo.blocksize;
+    }
+
+  ftl_semgive(dev);
+  return nblocks;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_flush
+ *
+ * Description: Write the specified number of sectors.  Each logical erase
+ *   block touched is written, merged with its old contents if needed, into
+ *   a pre-erased physical block; the old copy is then released for a
+ *   background erase.  No erase is in the write path unless the pool of
+ *   pre-erased blocks has run dry.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_ERASEAHEAD
+static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
+                         off_t startblock, size_t nblocks)
+{
+  struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
+  FAR struct ftl_header_s *hdr;
+  uint16_t lblock;
+  uint16_t oldblock;
+  off_t    offset;
+  size_t   remaining;
+  size_t   nxfr;
+  ssize_t  nxfrd;
+  int      newblock;
+  int      ret = OK;
+
+  /* Don't let the background erase compete with the writes */
+
+  (void)work_cancel(LPWORK, &dev->work);
+  ftl_semtake(dev);
+
+  hdr = (FAR struct ftl_header_s *)
+        (dev->eblock + dev->dblkper * dev->geo.blocksize);
+
+  for (remaining = nblocks; remaining > 0; remaining -= nxfr)
+    {
+      lblock = startblock / dev->dblkper;
+      offset = startblock % dev->dblkper;
+      nxfr   = dev->dblkper - offset;
+      if (nxfr > remaining)
+        {
+          nxfr = remaining;
+        }
+
+      if (lblock >= dev->nlblocks)
+        {
+          ret = -EINVAL;
+          break;
+        }
+
+      /* Merge with the old contents unless the whole block is replaced */
+
+      oldblock = dev->lmap[lblock];
+      if (nxfr < dev->dblkper)
+        {
+          if (oldblock == FTL_UNMAPPED)
+            {
+              memset(dev->eblock, 0xff, dev->dblkper * dev->geo.blocksize);
+            }
+          else
+            {
+              nxfrd = MTD_BREAD(dev->mtd, oldblock * dev->blkper,
+                                dev->dblkper, dev->eblock);
+              if (nxfrd != dev->dblkper)
+                {
+                  fdbg("Read erase block %d failed: %d\n", oldblock, nxfrd);
+                  ret = -EIO;
+                  break;
+                }
+            }
+        }
+
+      memcpy(dev->eblock + offset * dev->geo.blocksize, buffer,
+             nxfr * dev->geo.blocksize);
+
+      /* The header goes last so that a block only counts once all of its
+       * data is on the media.
+       */
+
+      memset(hdr, 0xff, dev->geo.blocksize);
+      hdr->magic  = FTL_MAGIC;
+      hdr->seqno  = ++dev->seqno;
+      hdr->lblock = lblock;
+      hdr->check  = ~lblock;
+
+      newblock = ftl_pblock_alloc(dev);
+      if (newblock < 0)
+        {
+          fdbg("No erased block available: %d\n", newblock);
+          ret = newblock;
+          break;
+        }
+
+      fvdbg("Logical block %d: %d -> %d\n", lblock, oldblock, newblock);
+
+      nxfrd = MTD_BWRITE(dev->mtd, newblock * dev->blkper, dev->blkper,
+                         dev->eblock);
+      if (nxfrd != dev->blkper)
+        {
+          fdbg("Write erase block %d failed: %d\n", newblock, nxfrd);
+          dev->pstate[newblock] = FTL_PBLOCK_DIRTY;
+          dev->ndirty++;
+          ret = -EIO;
+          break;
+        }
+
+      dev->lmap[lblock] = newblock;
+      if (oldblock != FTL_UNMAPPED)
+        {
+          dev->pstate[oldblock] = FTL_PBLOCK_DIRTY;
+          dev->ndirty++;
+        }
+
+      startblock += nxfr;
+      buffer     += nxfr * dev->geo.blocksize;
+    }
+
+  /* Pre-erase the released blocks once the writes go quiet */
+
+  if (dev->ndirty > 0)
+    {
+      (void)work_queue(LPWORK, &dev->work, ftl_erasework, dev,
+                       MSEC2TICK(CONFIG_FTL_ERASEDELAY));
+    }
+
+  ftl_semgive(dev);
+  return ret < 0 ? ret : nblocks;
+}
+#endif
+
 /****************************************************************************
  * Name: ftl_write
  *
@@ -422,7 +900,11 @@ static int ftl_geometry(FAR struct inode *inode, struct geometry *geometry)
 #else
       geometry->geo_writeenabled  = false;
 #endif
+#ifdef CONFIG_FTL_ERASEAHEAD
+      geometry->geo_nsectors      = dev->nlblocks * dev->dblkper;
+#else
       geometry->geo_nsectors      = dev->geo.neraseblocks * dev->blkper;
+#endif
       geometry->geo_sectorsize    = dev->geo.blocksize;
 
       fvdbg("available: true mediachanged: false writeenabled: %s\n",
@@ -562,20 +1044,83 @@ int ftl_initialize(int minor, FAR struct mtd_dev_s *mtd)
       dev->blkper = dev->geo.erasesize / dev->geo.blocksize;
       DEBUGASSERT(dev->blkper * dev->geo.blocksize == dev->geo.erasesize);
 
+#ifdef CONFIG_FTL_ERASEAHEAD
+      /* Set up the logical to physical erase block map.  CONFIG_FTL_NSPARES
+       * erase blocks are held back for the pre-erased pool and one R/W
+       * block of each erase block holds its header.
+       */
+
+      DEBUGASSERT(dev->blkper > 1 &&
+                  dev->geo.blocksize >= sizeof(struct ftl_header_s));
+
+      if (dev->geo.neraseblocks <= CONFIG_FTL_NSPARES ||
+          dev->geo.neraseblocks >= FTL_UNMAPPED)
+        {
+          fdbg("Unsupported number of erase blocks: %d\n",
+               dev->geo.neraseblocks);
+          kmm_free(dev->eblock);
+          kmm_free(dev);
+          return -EINVAL;
+        }
+
+      dev->dblkper   = dev->blkper - 1;
+      dev->nlblocks  = dev->geo.neraseblocks - CONFIG_FTL_NSPARES;
+      dev->nclean    = 0;
+      dev->ndirty    = 0;
+      dev->nextclean = 0;
+      dev->seqno     = 0;
+      dev->work.worker = NULL;
+      sem_init(&dev->exclsem, 0, 1);
+
+      dev->lmap   = (FAR uint16_t *)kmm_malloc(dev->nlblocks * sizeof(uint16_t));
+      dev->pstate = (FAR uint8_t *)kmm_malloc(dev->geo.neraseblocks);
+      ret = -ENOMEM;
+      if (dev->lmap && dev->pstate)
+        {
+          ret = ftl_scan(dev);
+        }
+
+      if (ret < 0)
+        {
+          fdbg("Failed to build the erase block map: %d\n", ret);
+          kmm_free(dev->lmap);
+          kmm_free(dev->pstate);
+          kmm_free(dev->eblock);
+          kmm_free(dev);
+          return ret;
+        }
+#endif
+
       /* Configure read-ahead/write buffering */
 
 #ifdef FTL_HAVE_RWBUFFER
+      /* Unused buffers and tuning fields must be zero */
+
+      memset(&dev->rwb, 0, sizeof(struct rwbuffer_s));
+
       dev->rwb.blocksize   = dev->geo.blocksize;
+#ifdef CONFIG_FTL_ERASEAHEAD
+      dev->rwb.nblocks     = dev->nlblocks * dev->dblkper;
+#else
       dev->rwb.nblocks     = dev->geo.neraseblocks * dev->blkper;
+#endif
       dev->rwb.dev         = (FAR void *)dev;
 
 #if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_FTL_WRITEBUFFER)
+#ifdef CONFIG_FTL_ERASEAHEAD
+      dev->rwb.wrmaxblocks = dev->dblkper;
+#else
       dev->rwb.wrmaxblocks = dev->blkper;
+#endif
       dev->rwb.wrflush     = ftl_flush;
 #endif
 
 #ifdef CONFIG_FTL_READAHEAD
+#ifdef CONFIG_FTL_ERASEAHEAD
+      dev->rwb.rhmaxblocks = dev->dblkper;
+#else
       dev->rwb.rhmaxblocks = dev->blkper;
+#endif
       dev->rwb.rhreload    = ftl_reload;
 #endif
 
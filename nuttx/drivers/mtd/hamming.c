@@ -52,6 +52,37 @@
 
 #include <nuttx/mtd/hamming.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Parity of a nibble, looked up in a 16-bit constant */
+
+#define hamming_parity4(n)  ((0x6996 >> ((n) & 0x0f)) & 1)
+
+/* The byte lanes of a 32-bit word whose byte offset has index bit 0 (bytes
+ * 1 and 3) or index bit 1 (bytes 2 and 3) set.
+ */
+
+#ifdef CONFIG_ENDIAN_BIG
+#  define HAMMING_LANES_BIT0 0x00ff00ff
+#  define HAMMING_LANES_BIT1 0x0000ffff
+#else
+#  define HAMMING_LANES_BIT0 0xff00ff00
+#  define HAMMING_LANES_BIT1 0xffff0000
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Number of bits set in each nibble */
+
+static const uint8_t g_nibblebits[16] =
+{
+  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -70,20 +101,25 @@
  *
  ****************************************************************************/
 
-static unsigned int hamming_bitsinbyte(uint8_t byte)
+static inline unsigned int hamming_bitsinbyte(uint8_t byte)
 {
-  unsigned int count = 0;
+  return g_nibblebits[byte & 0x0f] + g_nibblebits[byte >> 4];
+}
 
-  while (byte != 0)
-    {
-      if ((byte & 1) != 0)
-        {
-          count++;
-        }
-      byte >>= 1;
-    }
+/****************************************************************************
+ * Name: hamming_parity32
+ *
+ * Description:
+ *   Returns the parity (1 if odd) of the bits of a 32-bit word.
+ *
+ ****************************************************************************/
 
-  return count;
+static inline unsigned int hamming_parity32(uint32_t word)
+{
+  word ^= word >> 16;
+  word ^= word >> 8;
+  word ^= word >> 4;
+  return hamming_parity4(word);
 }
 
 /****************************************************************************
@@ -124,74 +160,105 @@ static uint8_t hamming_bitsincode256(FAR uint8_t *code)
 
 static void hamming_compute256(FAR const uint8_t *data, FAR uint8_t *code)
 {
-  uint8_t colsum = 0;
-  uint8_t evenline = 0;
+  uint8_t colsum;
+  uint8_t evenline;
   uint8_t oddline = 0;
-  uint8_t evencol = 0;
-  uint8_t oddcol = 0;
+  uint8_t evencol;
+  uint8_t oddcol;
   int i;
-
-  /* Xor all bytes together to get the column sum;
-   * At the same time, calculate the even and odd line codes
+  int j;
+
+  /* Parity groups are formed by forcing a particular index bit to 0
+   * (even) or 1 (odd).
+   * Example on one byte:
+   *
+   * bits (dec)  7   6   5   4   3   2   1   0
+   *      (bin) 111 110 101 100 011 010 001 000
+   *                            '---'---'---'----------.
+   *                                                   |
+   * groups P4' ooooooooooooooo eeeeeeeeeeeeeee P4     |
+   *        P2' ooooooo eeeeeee ooooooo eeeeeee P2     |
+   *        P1' ooo eee ooo eee ooo eee ooo eee P1     |
+   *                                                   |
+   * We can see that:                                  |
+   *  - P4  -> bit 2 of index is 0 --------------------'
+   *  - P4' -> bit 2 of index is 1.
+   *  - P2  -> bit 1 of index if 0.
+   *  - etc...
+   *
+   * So bit n of the odd line code (P1' P2' P4' ... P128') is the parity of
+   * all of the bytes whose index has bit n set.  Each even Px is the odd
+   * Px' flipped by the parity of the whole block, which is the parity of
+   * the column sum.
+   *
+   * That lets the block be processed a 32-bit word at a time:  Index bits
+   * 2-7 are the word index and select which words are folded into which
+   * parity; index bits 0-1 select byte lanes within the folded words.
    */
 
-  for (i = 0; i < 256; i++)
+  if (((uintptr_t)data & 3) == 0)
     {
-      colsum ^= data[i];
+      FAR const uint32_t *words = (FAR const uint32_t *)data;
+      uint32_t total = 0;
+      uint32_t lines[6] =
+      {
+        0, 0, 0, 0, 0, 0
+      };
+
+      for (i = 0; i < 64; i++)
+        {
+          uint32_t word = words[i];
 
-      /* If the xor sum of the byte is 0, then this byte has no incidence on
-       * the computed code; so check if the sum is 1.
-       */
+          total ^= word;
+          for (j = 0; j < 6; j++)
+            {
+              if ((i & (1 << j)) != 0)
+                {
+                  lines[j] ^= word;
+                }
+            }
+        }
 
-      if ((hamming_bitsinbyte(data[i]) & 1) == 1)
+      oddline  = hamming_parity32(total & HAMMING_LANES_BIT0);
+      oddline |= hamming_parity32(total & HAMMING_LANES_BIT1) << 1;
+      for (j = 0; j < 6; j++)
         {
-          /* Parity groups are formed by forcing a particular index bit to 0
-           * (even) or 1 (odd).
-           * Example on one byte:
-           *
-           * bits (dec)  7   6   5   4   3   2   1   0
-           *      (bin) 111 110 101 100 011 010 001 000
-           *                            '---'---'---'----------.
-           *                                                   |
-           * groups P4' ooooooooooooooo eeeeeeeeeeeeeee P4     |
-           *        P2' ooooooo eeeeeee ooooooo eeeeeee P2     |
-           *        P1' ooo eee ooo eee ooo eee ooo eee P1     |
-           *                                                   |
-           * We can see that:                                  |
-           *  - P4  -> bit 2 of index is 0 --------------------'
-           *  - P4' -> bit 2 of index is 1.
-           *  - P2  -> bit 1 of index if 0.
-           *  - etc...
-           * We deduce that a bit position has an impact on all even Px if
-           * the log2(x)nth bit of its index is 0
-           *     ex: log2(4) = 2, bit2 of the index must be 0 (-> 0 1 2 3)
-           * and on all odd Px' if the log2(x)nth bit of its index is 1
-           *     ex: log2(2) = 1, bit1 of the index must be 1 (-> 0 1 4 5)
-           *
-           * As such, we calculate all the possible Px and Px' values at the
-           * same time in two variables, evenline and oddline, such as
-           *     evenline bits: P128  P64  P32  P16  P8  P4  P2  P1
-           *     oddline  bits: P128' P64' P32' P16' P8' P4' P2' P1'
-           */
-
-          evenline ^= (255 - i);
-          oddline ^= i;
+          oddline |= hamming_parity32(lines[j]) << (j + 2);
         }
-    }
 
-  /* At this point, we have the line parities, and the column sum. First, We
-   * must caculate the parity group values on the column sum.
-   */
-
-  for (i = 0; i < 8; i++)
+      total ^= total >> 16;
+      colsum = (uint8_t)(total ^ (total >> 8));
+    }
+  else
     {
-      if (colsum & 1)
+      /* Unaligned data:  same thing, one byte at a time */
+
+      colsum = 0;
+      for (i = 0; i < 256; i++)
         {
-          evencol ^= (7 - i);
-          oddcol ^= i;
+          colsum ^= data[i];
+          if (hamming_parity4(data[i] ^ (data[i] >> 4)))
+            {
+              oddline ^= i;
+            }
         }
+    }
+
+  /* Now the parity groups of the column sum, the same way */
 
-      colsum >>= 1;
+  oddcol  = hamming_parity4((colsum & 0xaa) ^ ((colsum & 0xaa) >> 4));
+  oddcol |= hamming_parity4((colsum & 0xcc) ^ ((colsum & 0xcc) >> 4)) << 1;
+  oddcol |= hamming_parity4(colsum >> 4) << 2;
+
+  if (hamming_parity4(colsum ^ (colsum >> 4)))
+    {
+      evenline = ~oddline;
+      evencol  = oddcol ^ 7;
+    }
+  else
+    {
+      evenline = oddline;
+      evencol  = oddcol;
     }
 
   /* Now, we must interleave the parity values, to obtain the following layout:
@@ -419,7 +486,7 @@ int hamming_verify256x(FAR uint8_t *data, size_t size, FAR const uint8_t *code)
 {
   ssize_t remaining = (ssize_t)size;
   int result = HAMMING_SUCCESS;
-  int ret;
+  int ret = HAMMING_SUCCESS;
 
   DEBUGASSERT((size & 0xff) == 0);
 
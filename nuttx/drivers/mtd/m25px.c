@@ -69,6 +69,14 @@
 #  define CONFIG_M25P_SPIMODE SPIDEV_MODE0
 #endif
 
+/* SPI Frequency.  READ (0x03) is limited to a lower clock than FAST_READ (0x0b),
+ * which is used unless CONFIG_M25P_SLOWREAD is selected.
+ */
+
+#ifndef CONFIG_M25P_SPIFREQUENCY
+#  define CONFIG_M25P_SPIFREQUENCY 20000000
+#endif
+
 /* Various manufacturers may have produced the parts.  0x20 is the manufacturer ID
  * for the STMicro MP25x serial FLASH.  If, for example, you are using the a Macronix
  * International MX25 serial FLASH, the correct manufacturer ID would be 0xc2.
@@ -272,7 +280,7 @@ static void m25p_lock(FAR struct spi_dev_s *dev)
 
   SPI_SETMODE(dev, CONFIG_M25P_SPIMODE);
   SPI_SETBITS(dev, 8);
-  (void)SPI_SETFREQUENCY(dev, 20000000);
+  (void)SPI_SETFREQUENCY(dev, CONFIG_M25P_SPIFREQUENCY);
 }
 
 /************************************************************************************
@@ -808,7 +816,11 @@ static ssize_t m25p_read(FAR struct mtd_dev_s *dev, off_t offset, size_t nbytes,
 
   /* Send "Read from Memory " instruction */
 
+#ifdef CONFIG_M25P_SLOWREAD
   (void)SPI_SEND(priv->dev, M25P_READ);
+#else
+  (void)SPI_SEND(priv->dev, M25P_FAST_READ);
+#endif
 
   /* Send the page offset high byte first. */
 
@@ -816,6 +828,12 @@ static ssize_t m25p_read(FAR struct mtd_dev_s *dev, off_t offset, size_t nbytes,
   (void)SPI_SEND(priv->dev, (offset >> 8) & 0xff);
   (void)SPI_SEND(priv->dev, offset & 0xff);
 
+  /* Send a dummy byte */
+
+#ifndef CONFIG_M25P_SLOWREAD
+  (void)SPI_SEND(priv->dev, M25P_DUMMY);
+#endif
+
   /* Then read all of the requested bytes */
 
   SPI_RECVBLOCK(priv->dev, buffer, nbytes);
@@ -960,7 +978,21 @@ static int m25p_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg)
         }
         break;
 
+#if defined(CONFIG_M25P_XIPBASE) && CONFIG_M25P_XIPBASE != 0
       case MTDIOC_XIPBASE:
+        {
+          FAR void **ppv = (FAR void**)((uintptr_t)arg);
+          if (ppv)
+            {
+              /* Return the address where the SPI controller maps the FLASH */
+
+              *ppv = (FAR void*)CONFIG_M25P_XIPBASE;
+              ret  = OK;
+            }
+        }
+        break;
+
+#endif
       default:
         ret = -ENOTTY; /* Bad command */
         break;
@@ -54,6 +54,8 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <crc32.h>
+
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/mtd/mtd.h>
@@ -76,10 +78,41 @@
 
 #define NAND_BLOCKSTATUS_BAD 0xba
 
+/* Bad block table */
+
+#ifdef CONFIG_MTD_NAND_BBT
+#  define nand_bbtisbad(n,b) (((n)->bbt[(b) >> 3] & (1 << ((b) & 7))) != 0)
+#  define nand_bbtsetbad(n,b) ((n)->bbt[(b) >> 3] |= (1 << ((b) & 7)))
+#endif
+
+/* The saved bad block table lives in the last block of the device, which
+ * is then hidden from the MTD interface.
+ */
+
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+#  define NAND_BBT_MAGIC     0x5442424e /* "NBBT" */
+#  define NAND_RESERVED      1
+#else
+#  define NAND_RESERVED      0
+#endif
+
+#define nand_devblocks(m)    (nandmodel_getdevblocks(m) - NAND_RESERVED)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+/* This header precedes the bitmap in the saved bad block table */
+
+struct nand_bbthdr_s
+{
+  uint32_t magic;                /* NAND_BBT_MAGIC */
+  uint32_t nblocks;              /* Number of blocks in the table */
+  uint32_t crc;                  /* CRC32 of the bitmap */
+};
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -91,13 +124,31 @@ static int      nand_lock(FAR struct nand_dev_s *nand);
 /* Bad block checking */
 
 #ifdef CONFIG_MTD_NAND_BLOCKCHECK
+static int     nand_readmarkers(FAR struct nand_dev_s *nand, off_t block);
+#ifdef CONFIG_MTD_NAND_BBT
 static int     nand_checkblock(FAR struct nand_dev_s *nand, off_t block);
-static int     nand_devscan(FAR struct nand_dev_s *nand);
+#else
+#  define      nand_checkblock(n,b) nand_readmarkers(n,b)
+#endif
 #else
 #  define      nand_checkblock(n,b) (GOODBLOCK)
+#endif
+
+#if defined(CONFIG_MTD_NAND_BBT) || (defined(CONFIG_MTD_NAND_BLOCKCHECK) && \
+    defined(CONFIG_DEBUG_VERBOSE) && defined(CONFIG_DEBUG_FS))
+static int     nand_devscan(FAR struct nand_dev_s *nand);
+#else
 #  define      nand_devscan(n) (0)
 #endif
 
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+static int     nand_bbtload(FAR struct nand_dev_s *nand, FAR uint8_t *bbt,
+                 off_t nblocks);
+static int     nand_bbtsave(FAR struct nand_dev_s *nand);
+#else
+#  define      nand_bbtsave(n) (0)
+#endif
+
 /* Misc. NAND helpers */
 
 static uint32_t nand_chipid(struct nand_raw_s *raw);
@@ -161,10 +212,10 @@ static int nand_lock(FAR struct nand_dev_s *nand)
 }
 
 /****************************************************************************
- * Name: nand_checkblock
+ * Name: nand_readmarkers
  *
  * Description:
- *   Read and check for a bad block.
+ *   Read and check the bad block markers of a block.
  *
  * Input Parameters:
  *   nand  - Pointer to a struct nand_dev_s instance.
@@ -178,7 +229,7 @@ static int nand_lock(FAR struct nand_dev_s *nand)
  ****************************************************************************/
 
 #ifdef CONFIG_MTD_NAND_BLOCKCHECK
-static int nand_checkblock(FAR struct nand_dev_s *nand, off_t block)
+static int nand_readmarkers(FAR struct nand_dev_s *nand, off_t block)
 {
   uint8_t spare[CONFIG_MTD_NAND_MAXPAGESPARESIZE];
   FAR const struct nand_scheme_s *scheme;
@@ -231,33 +282,204 @@ static int nand_checkblock(FAR struct nand_dev_s *nand, off_t block)
 }
 #endif /* CONFIG_MTD_NAND_BLOCKCHECK */
 
+/****************************************************************************
+ * Name: nand_checkblock
+ *
+ * Description:
+ *   Check for a bad block using the in-memory bad block table.  Until the
+ *   table has been built, fall back to reading the markers.
+ *
+ * Input Parameters:
+ *   nand  - Pointer to a struct nand_dev_s instance.
+ *   block - Number of block to check.
+ *
+ * Returned Value:
+ *   Returns BADBLOCK if the given block of a nandflash device is bad;
+ *   returns GOODBLOCK if the block is good; or returns negated errno
+ *   value on any failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_NAND_BBT
+static int nand_checkblock(FAR struct nand_dev_s *nand, off_t block)
+{
+  if (nand->bbt == NULL)
+    {
+      return nand_readmarkers(nand, block);
+    }
+
+  return nand_bbtisbad(nand, block) ? BADBLOCK : GOODBLOCK;
+}
+#endif
+
+/****************************************************************************
+ * Name: nand_bbtload
+ *
+ * Description:
+ *   Read the saved bad block table from the reserved last block.
+ *
+ * Input Parameters:
+ *   nand    - Pointer to a struct nand_dev_s instance.
+ *   bbt     - Table to be filled in.
+ *   nblocks - Number of blocks in the device.
+ *
+ * Returned Value:
+ *   OK if a valid table was read; a negated errno value otherwise.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+static int nand_bbtload(FAR struct nand_dev_s *nand, FAR uint8_t *bbt,
+                        off_t nblocks)
+{
+  FAR struct nand_model_s *model = &nand->raw->model;
+  FAR struct nand_bbthdr_s *hdr;
+  FAR uint8_t *buffer;
+  unsigned int npages;
+  unsigned int page;
+  uint16_t pagesize;
+  size_t nbytes;
+  int ret;
+
+  pagesize = nandmodel_getpagesize(model);
+  nbytes   = (nblocks + 7) >> 3;
+  npages   = (sizeof(struct nand_bbthdr_s) + nbytes + pagesize - 1) / pagesize;
+  if (npages > nandmodel_pagesperblock(model))
+    {
+      return -EFBIG;
+    }
+
+  buffer = (FAR uint8_t *)kmm_malloc(npages * pagesize);
+  if (!buffer)
+    {
+      return -ENOMEM;
+    }
+
+  for (page = 0; page < npages; page++)
+    {
+      ret = nand_readpage(nand, nblocks - 1, page, buffer + page * pagesize);
+      if (ret < 0)
+        {
+          goto errout_with_buffer;
+        }
+    }
+
+  hdr = (FAR struct nand_bbthdr_s *)buffer;
+  if (hdr->magic != NAND_BBT_MAGIC || hdr->nblocks != nblocks ||
+      hdr->crc != crc32(buffer + sizeof(struct nand_bbthdr_s), nbytes))
+    {
+      ret = -EINVAL;
+      goto errout_with_buffer;
+    }
+
+  memcpy(bbt, buffer + sizeof(struct nand_bbthdr_s), nbytes);
+  ret = OK;
+
+errout_with_buffer:
+  kmm_free(buffer);
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: nand_bbtsave
+ *
+ * Description:
+ *   Write the in-memory bad block table to the reserved last block.
+ *
+ * Input Parameters:
+ *   nand - Pointer to a struct nand_dev_s instance.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+static int nand_bbtsave(FAR struct nand_dev_s *nand)
+{
+  FAR struct nand_model_s *model = &nand->raw->model;
+  FAR struct nand_bbthdr_s *hdr;
+  FAR uint8_t *buffer;
+  unsigned int npages;
+  unsigned int page;
+  uint16_t pagesize;
+  off_t nblocks;
+  off_t block;
+  size_t nbytes;
+  int ret;
+
+  nblocks  = nandmodel_getdevblocks(model);
+  block    = nblocks - 1;
+  pagesize = nandmodel_getpagesize(model);
+  nbytes   = (nblocks + 7) >> 3;
+  npages   = (sizeof(struct nand_bbthdr_s) + nbytes + pagesize - 1) / pagesize;
+
+  if (nand_bbtisbad(nand, block) || npages > nandmodel_pagesperblock(model))
+    {
+      return -ENOSPC;
+    }
+
+  buffer = (FAR uint8_t *)kmm_malloc(npages * pagesize);
+  if (!buffer)
+    {
+      return -ENOMEM;
+    }
+
+  memset(buffer, 0xff, npages * pagesize);
+  memcpy(buffer + sizeof(struct nand_bbthdr_s), nand->bbt, nbytes);
+
+  hdr          = (FAR struct nand_bbthdr_s *)buffer;
+  hdr->magic   = NAND_BBT_MAGIC;
+  hdr->nblocks = nblocks;
+  hdr->crc     = crc32(nand->bbt, nbytes);
+
+  ret = NAND_ERASEBLOCK(nand->raw, block);
+  for (page = 0; ret >= 0 && page < npages; page++)
+    {
+      ret = nand_writepage(nand, block, page, buffer + page * pagesize);
+    }
+
+  if (ret < 0)
+    {
+      fdbg("ERROR: Failed to save the bad block table: %d\n", ret);
+    }
+
+  kmm_free(buffer);
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: nand_devscan
  *
  * Description:
  *   Scans the device to retrieve or create block status information.
  *
- *   Currently, this functin does nothing but scan the NAND and eat up time.
- *   This is a goot thing to do if you are debugging NAND, but otherwise,
- *   just a waste of time.  This logic could, however, be integrated into
- *   some bad block checking logic at sometime in the future.
+ *   With CONFIG_MTD_NAND_BBT, the result is kept in the in-memory bad
+ *   block table (which is loaded from FLASH instead if a valid saved copy
+ *   exists).  Otherwise this does nothing but scan the NAND and eat up
+ *   time, which is a good thing to do only if you are debugging NAND.
  *
  * Input Parameters:
  *   nand - Pointer to a struct nand_dev_s instance.
  *
  * Returned Value:
- *   OK (always)
+ *   OK on success; -ENOMEM if the table could not be allocated.
  *
  ****************************************************************************/
 
-//#ifdef CONFIG_MTD_NAND_BLOCKCHECK
-#if defined(CONFIG_MTD_NAND_BLOCKCHECK) && defined(CONFIG_DEBUG_VERBOSE) && defined(CONFIG_DEBUG_FS)
+#if defined(CONFIG_MTD_NAND_BBT) || (defined(CONFIG_MTD_NAND_BLOCKCHECK) && \
+    defined(CONFIG_DEBUG_VERBOSE) && defined(CONFIG_DEBUG_FS))
 static int nand_devscan(FAR struct nand_dev_s *nand)
 {
   FAR struct nand_raw_s *raw;
   FAR struct nand_model_s *model;
   off_t nblocks;
   off_t block;
+#ifdef CONFIG_MTD_NAND_BBT
+  FAR uint8_t *bbt;
+#endif
 #if defined(CONFIG_DEBUG_VERBOSE) && defined(CONFIG_DEBUG_FS)
   off_t good;
   unsigned int ngood;
@@ -273,6 +495,27 @@ static int nand_devscan(FAR struct nand_dev_s *nand)
 
   nblocks = nandmodel_getdevblocks(model);
 
+#ifdef CONFIG_MTD_NAND_BBT
+  bbt = (FAR uint8_t *)kmm_zalloc((nblocks + 7) >> 3);
+  if (!bbt)
+    {
+      fdbg("ERROR: Failed to allocate the bad block table\n");
+      return -ENOMEM;
+    }
+
+#ifdef CONFIG_MTD_NAND_BBTSAVE
+  /* Use the saved table if there is one */
+
+  if (nand_readmarkers(nand, nblocks - 1) == GOODBLOCK &&
+      nand_bbtload(nand, bbt, nblocks) == OK)
+    {
+      fvdbg("Loaded the saved bad block table\n");
+      nand->bbt = bbt;
+      return OK;
+    }
+#endif
+#endif
+
   /* Initialize block statuses */
 
   fvdbg("Retrieving bad block information. nblocks=%d\n", nblocks);
@@ -287,9 +530,15 @@ static int nand_devscan(FAR struct nand_dev_s *nand)
     {
       /* Read spare of first page */
 
-      ret = nand_checkblock(nand, block);
+      ret = nand_readmarkers(nand, block);
       if (ret != GOODBLOCK)
         {
+#ifdef CONFIG_MTD_NAND_BBT
+          /* Blocks that cannot even be checked are not used either */
+
+          bbt[block >> 3] |= (1 << (block & 7));
+#endif
+
 #if defined(CONFIG_DEBUG_VERBOSE) && defined(CONFIG_DEBUG_FS)
           if (ngood > 0)
             {
@@ -327,6 +576,13 @@ static int nand_devscan(FAR struct nand_dev_s *nand)
     }
 #endif
 
+#ifdef CONFIG_MTD_NAND_BBT
+  /* From now on, block checks come from the table */
+
+  nand->bbt = bbt;
+  (void)nand_bbtsave(nand);
+#endif
+
   return OK;
 }
 #endif /* CONFIG_MTD_NAND_BLOCKCHECK */
@@ -434,6 +690,16 @@ static int nand_eraseblock(FAR struct nand_dev_s *nand, off_t block,
         {
           fdbg("ERROR: Failed bo marke block %ld as BAD\n", (long)block);
         }
+
+#ifdef CONFIG_MTD_NAND_BBT
+      /* Keep the bad block table up to date, in FLASH too */
+
+      if (nand->bbt != NULL)
+        {
+          nand_bbtsetbad(nand, block);
+          (void)nand_bbtsave(nand);
+        }
+#endif
     }
 
   return ret;
@@ -564,6 +830,13 @@ static int nand_erase(struct mtd_dev_s *dev, off_t startblock,
 
   fvdbg("startblock: %08lx nblocks: %d\n", (long)startblock, (int)nblocks);
 
+  /* Don't let the erase reach the reserved blocks */
+
+  if (startblock + nblocks > nand_devblocks(&nand->raw->model))
+    {
+      return -ESPIPE;
+    }
+
   /* Lock access to the NAND until we complete the erase */
 
   nand_lock(nand);
@@ -623,7 +896,7 @@ static ssize_t nand_bread(struct mtd_dev_s *dev, off_t startpage,
 
   pagesperblock = nandmodel_pagesperblock(model);
   pagesize      = nandmodel_getpagesize(model);
-  maxblock      = nandmodel_getdevblocks(model);
+  maxblock      = nand_devblocks(model);
 
   /* Get the block and page offset associated with the startpage */
 
@@ -640,7 +913,7 @@ static ssize_t nand_bread(struct mtd_dev_s *dev, off_t startpage,
     {
       /* Check for attempt to read beyond the end of NAND */
 
-      if (block > maxblock)
+      if (block >= maxblock)
         {
           fdbg("ERROR: Read beyond the end of FLASH, block=%ld\n",
                (long)block);
@@ -719,7 +992,7 @@ static ssize_t nand_bwrite(struct mtd_dev_s *dev, off_t startpage,
 
   pagesperblock = nandmodel_pagesperblock(model);
   pagesize      = nandmodel_getpagesize(model);
-  maxblock      = nandmodel_getdevblocks(model);
+  maxblock      = nand_devblocks(model);
 
   /* Get the block and page offset associated with the startpage */
 
@@ -736,7 +1009,7 @@ static ssize_t nand_bwrite(struct mtd_dev_s *dev, off_t startpage,
     {
       /* Check for attempt to write beyond the end of NAND */
 
-      if (block > maxblock)
+      if (block >= maxblock)
         {
           fdbg("ERROR: Write beyond the end of FLASH, block=%ld\n",
                (long)block);
@@ -811,7 +1084,7 @@ static int nand_ioctl(struct mtd_dev_s *dev, int cmd, unsigned long arg)
 
               geo->blocksize    = model->pagesize;
               geo->erasesize    = nandmodel_getbyteblocksize(model);
-              geo->neraseblocks = nandmodel_getdevblocks(model);
+              geo->neraseblocks = nand_devblocks(model);
               ret               = OK;
           }
         }
@@ -821,7 +1094,7 @@ static int nand_ioctl(struct mtd_dev_s *dev, int cmd, unsigned long arg)
         {
           /* Erase the entire device */
 
-          ret = nand_erase(dev, 0, nandmodel_getdevblocks(model));
+          ret = nand_erase(dev, 0, nand_devblocks(model));
         }
         break;
 
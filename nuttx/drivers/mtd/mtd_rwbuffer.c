@@ -78,6 +78,10 @@
 #  define CONFIG_MTD_NRDBLOCKS 4
 #endif
 
+#ifndef CONFIG_MTD_RDMINBLOCKS
+#  define CONFIG_MTD_RDMINBLOCKS 1
+#endif
+
 /************************************************************************************
  * Private Types
  ************************************************************************************/
@@ -303,6 +307,19 @@ static int mtd_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg)
         }
         break;
 
+#ifdef CONFIG_DRVR_RWBSTATS
+      case MTDIOC_RWBSTATS:
+        {
+          FAR struct rwb_stats_s *stats = (FAR struct rwb_stats_s *)((uintptr_t)arg);
+          if (stats)
+            {
+              rwb_getstats(&priv->rwb, stats, false);
+              ret = OK;
+            }
+        }
+        break;
+#endif
+
       case MTDIOC_XIPBASE:
       default:
         ret = -ENOTTY; /* Bad command */
@@ -387,10 +404,12 @@ FAR struct mtd_dev_s *mtd_rwb_initialize(FAR struct mtd_dev_s *mtd)
       /* Buffer setup */
 
 #ifdef CONFIG_DRVR_WRITEBUFFER
-      priv->rwb.wrmaxblocks = CONFIG_MTD_NWRBLOCKS;
+      priv->rwb.wrmaxblocks   = CONFIG_MTD_NWRBLOCKS;
+      priv->rwb.wralignblocks = priv->spb;
 #endif
 #ifdef CONFIG_DRVR_READAHEAD
-      priv->rwb.rhmaxblocks = CONFIG_MTD_NRDBLOCKS;
+      priv->rwb.rhmaxblocks   = CONFIG_MTD_NRDBLOCKS;
+      priv->rwb.rhminblocks   = CONFIG_MTD_RDMINBLOCKS;
 #endif
 
       /* Callouts */
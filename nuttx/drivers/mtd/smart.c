@@ -119,10 +119,26 @@
 #define offsetof(type, member) ( (size_t) &( ( (type *) 0)->member))
 #endif
 
+#if defined(CONFIG_MTD_SMART_MINIMIZE_RAM) && \
+    !defined(CONFIG_MTD_SMART_SECTORCACHE_SIZE)
+#  define CONFIG_MTD_SMART_SECTORCACHE_SIZE 64
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+/* One recently used logical to physical sector mapping */
+
+struct smart_cache_s
+{
+  uint16_t              logical;          /* Logical sector (0xFFFF = unused) */
+  uint16_t              physical;         /* Physical sector it is mapped to */
+  uint32_t              lastuse;          /* Value of cacheclock at last use */
+};
+#endif
+
 struct smart_struct_s
 {
   FAR struct mtd_dev_s *mtd;              /* Contained MTD interface */
@@ -133,9 +149,19 @@ struct smart_struct_s
   uint16_t              sectorsPerBlk;    /* Number of sectors per erase block */
   uint16_t              sectorsize;       /* Sector size on device */
   uint16_t              totalsectors;     /* Total number of sectors on device */
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  FAR uint8_t          *sMap;             /* Bitmap of allocated logical sectors */
+  uint32_t              cacheclock;       /* Incremented on each sCache access */
+  struct smart_cache_s  sCache[CONFIG_MTD_SMART_SECTORCACHE_SIZE];
+#else
   FAR uint16_t         *sMap;             /* Virtual to physical sector map */
+#endif
   FAR uint8_t          *releasecount;     /* Count of released sectors per erase block */
   FAR uint8_t          *freecount;        /* Count of free sectors per erase block */
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  FAR uint16_t         *erasecount;       /* Count of erases per erase block */
+  uint32_t              blockerases;      /* Total erases since the device scan */
+#endif
   FAR char             *rwbuffer;         /* Our sector read/write buffer */
   char                  partname[SMART_PARTNAME_SIZE]; /* Optional partition name */
   uint8_t               formatversion;    /* Format version on the device */
@@ -293,6 +319,29 @@ static ssize_t smart_read(FAR struct inode *inode, unsigned char *buffer,
   return smart_reload(dev, buffer, start_sector, nsectors);
 }
 
+/****************************************************************************
+ * Name: smart_erase
+ *
+ * Description: Erase one erase block, accounting for it in the wear
+ *              statistics.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_WRITABLE
+static int smart_erase(FAR struct smart_struct_s *dev, off_t block)
+{
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  dev->blockerases++;
+  if (block < dev->neraseblocks && dev->erasecount[block] != 0xFFFF)
+    {
+      dev->erasecount[block]++;
+    }
+#endif
+
+  return MTD_ERASE(dev->mtd, block, 1);
+}
+#endif /* CONFIG_FS_WRITABLE */
+
 /****************************************************************************
  * Name: smart_write
  *
@@ -361,7 +410,7 @@ static ssize_t smart_write(FAR struct inode *inode, const unsigned char *buffer,
           /* Erase the erase block */
 
           eraseblock = alignedblock / mtdBlksPerErase;
-          ret = MTD_ERASE(dev->mtd, eraseblock, 1);
+          ret = smart_erase(dev, eraseblock);
           if (ret < 0)
             {
               fdbg("Erase block=%d failed: %d\n", eraseblock, ret);
@@ -475,6 +524,8 @@ static int smart_setsectorsize(struct smart_struct_s *dev, uint16_t size)
 {
   uint32_t  erasesize;
   uint32_t  totalsectors;
+  size_t    mapsize;
+  size_t    wearsize;
 
   /* Validate the size isn't zero so we don't divide by zero below */
 
@@ -512,14 +563,27 @@ static int smart_setsectorsize(struct smart_struct_s *dev, uint16_t size)
     }
 
   /* Allocate a virtual to physical sector map buffer.  Also allocate
-   * the storage space for releasecount and freecounts.
+   * the storage space for the erase counts, releasecount and freecounts.
+   * With CONFIG_MTD_SMART_MINIMIZE_RAM, the map is only a bitmap of the
+   * allocated logical sectors (kept a multiple of 16 bits in size so that
+   * the erase counts that follow it are aligned).
    */
 
   totalsectors = dev->neraseblocks * dev->sectorsPerBlk;
   dev->totalsectors = (uint16_t) totalsectors;
 
-  dev->sMap = (uint16_t *) kmm_malloc(totalsectors * sizeof(uint16_t) +
-              (dev->neraseblocks << 1));
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  mapsize = ((totalsectors + 15) >> 4) * sizeof(uint16_t);
+#else
+  mapsize = totalsectors * sizeof(uint16_t);
+#endif
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  wearsize = dev->neraseblocks * sizeof(uint16_t);
+#else
+  wearsize = 0;
+#endif
+
+  dev->sMap = kmm_malloc(mapsize + wearsize + (dev->neraseblocks << 1));
   if (!dev->sMap)
     {
       fdbg("Error allocating SMART virtual map buffer\n");
@@ -527,7 +591,13 @@ static int smart_setsectorsize(struct smart_struct_s *dev, uint16_t size)
       return -EINVAL;
     }
 
-  dev->releasecount = (uint8_t *) dev->sMap + (totalsectors * sizeof(uint16_t));
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  dev->erasecount = (uint16_t *) ((uint8_t *) dev->sMap + mapsize);
+  dev->blockerases = 0;
+  memset(dev->erasecount, 0, wearsize);
+#endif
+
+  dev->releasecount = (uint8_t *) dev->sMap + mapsize + wearsize;
   dev->freecount = dev->releasecount + dev->neraseblocks;
 
   /* Allocate a read/write buffer */
@@ -614,6 +684,211 @@ errout:
   return ret;
 }
 
+/****************************************************************************
+ * Name: smart_findsector
+ *
+ * Description: Finds the physical sector currently holding a logical
+ *              sector by reading the sector headers on the device.  This
+ *              is how mappings missing from the cache are recovered when
+ *              CONFIG_MTD_SMART_MINIMIZE_RAM is selected.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+static uint16_t smart_findsector(FAR struct smart_struct_s *dev,
+                                 uint16_t logical)
+{
+  struct smart_sect_header_s header;
+  uint16_t  sector;
+  uint16_t  hdrlogical;
+  size_t    readaddress;
+  int       ret;
+
+  for (sector = 0; sector < dev->totalsectors; sector++)
+    {
+      readaddress = sector * dev->mtdBlksPerSector * dev->geo.blocksize;
+      ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
+                     (uint8_t *) &header);
+      if (ret != sizeof(struct smart_sect_header_s))
+        {
+          break;
+        }
+
+      hdrlogical = *((uint16_t *) header.logicalsector);
+#if CONFIG_SMARTFS_ERASEDSTATE == 0x00
+      if (hdrlogical == 0)
+        {
+          hdrlogical = -1;
+        }
+#endif
+
+      /* Only a committed, not released sector holds the logical sector */
+
+      if (hdrlogical == logical &&
+          (header.status & SMART_STATUS_COMMITTED) !=
+              (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_COMMITTED) &&
+          (header.status & SMART_STATUS_RELEASED) ==
+              (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_RELEASED))
+        {
+          return sector;
+        }
+    }
+
+  fdbg("Logical sector %d not found on the device\n", logical);
+  return 0xFFFF;
+}
+
+/****************************************************************************
+ * Name: smart_cacheslot
+ *
+ * Description: Returns the sector cache slot holding a logical sector or,
+ *              if the logical sector is not cached, the least recently used
+ *              slot.
+ *
+ ****************************************************************************/
+
+static FAR struct smart_cache_s *smart_cacheslot(FAR struct smart_struct_s *dev,
+                                                 uint16_t logical)
+{
+  FAR struct smart_cache_s *victim = &dev->sCache[0];
+  int x;
+
+  for (x = 0; x < CONFIG_MTD_SMART_SECTORCACHE_SIZE; x++)
+    {
+      if (dev->sCache[x].logical == logical)
+        {
+          return &dev->sCache[x];
+        }
+
+      if (dev->sCache[x].lastuse < victim->lastuse)
+        {
+          victim = &dev->sCache[x];
+        }
+    }
+
+  return victim;
+}
+#endif /* CONFIG_MTD_SMART_MINIMIZE_RAM */
+
+/****************************************************************************
+ * Name: smart_resetmap
+ *
+ * Description: Marks every logical sector as not allocated.
+ *
+ ****************************************************************************/
+
+static void smart_resetmap(FAR struct smart_struct_s *dev)
+{
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  int x;
+
+  memset(dev->sMap, 0, (dev->totalsectors + 7) >> 3);
+  for (x = 0; x < CONFIG_MTD_SMART_SECTORCACHE_SIZE; x++)
+    {
+      dev->sCache[x].logical = 0xFFFF;
+      dev->sCache[x].lastuse = 0;
+    }
+
+  dev->cacheclock = 0;
+#else
+  memset(dev->sMap, 0xFF, dev->totalsectors * sizeof(uint16_t));
+#endif
+}
+
+/****************************************************************************
+ * Name: smart_mapped
+ *
+ * Description: Tests if a logical sector is allocated.  This never needs
+ *              to access the device.
+ *
+ ****************************************************************************/
+
+static bool smart_mapped(FAR struct smart_struct_s *dev, uint16_t logical)
+{
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  return (dev->sMap[logical >> 3] & (1 << (logical & 7))) != 0;
+#else
+  return dev->sMap[logical] != 0xFFFF;
+#endif
+}
+
+/****************************************************************************
+ * Name: smart_getmap
+ *
+ * Description: Returns the physical sector a logical sector is mapped to,
+ *              or 0xFFFF if the logical sector is not allocated.
+ *
+ ****************************************************************************/
+
+static uint16_t smart_getmap(FAR struct smart_struct_s *dev, uint16_t logical)
+{
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  FAR struct smart_cache_s *slot;
+
+  if (!smart_mapped(dev, logical))
+    {
+      return 0xFFFF;
+    }
+
+  slot = smart_cacheslot(dev, logical);
+  if (slot->logical != logical)
+    {
+      /* Cache miss.  Recover the mapping from the device */
+
+      slot->physical = smart_findsector(dev, logical);
+      if (slot->physical == 0xFFFF)
+        {
+          slot->logical = 0xFFFF;
+          slot->lastuse = 0;
+          return 0xFFFF;
+        }
+
+      slot->logical = logical;
+    }
+
+  slot->lastuse = ++dev->cacheclock;
+  return slot->physical;
+#else
+  return dev->sMap[logical];
+#endif
+}
+
+/****************************************************************************
+ * Name: smart_setmap
+ *
+ * Description: Maps a logical sector to a physical sector, or unmaps it
+ *              if physical is 0xFFFF.
+ *
+ ****************************************************************************/
+
+static void smart_setmap(FAR struct smart_struct_s *dev, uint16_t logical,
+                         uint16_t physical)
+{
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  FAR struct smart_cache_s *slot;
+
+  slot = smart_cacheslot(dev, logical);
+  if (physical == 0xFFFF)
+    {
+      dev->sMap[logical >> 3] &= ~(1 << (logical & 7));
+      if (slot->logical == logical)
+        {
+          slot->logical = 0xFFFF;
+          slot->lastuse = 0;
+        }
+    }
+  else
+    {
+      dev->sMap[logical >> 3] |= 1 << (logical & 7);
+      slot->logical  = logical;
+      slot->physical = physical;
+      slot->lastuse  = ++dev->cacheclock;
+    }
+#else
+  dev->sMap[logical] = physical;
+#endif
+}
+
 /****************************************************************************
  * Name: smart_scan
  *
@@ -687,10 +962,7 @@ static int smart_scan(struct smart_struct_s *dev)
 
   /* Initialize the sector map */
 
-  for (sector = 0; sector < totalsectors; sector++)
-    {
-      dev->sMap[sector] = -1;
-    }
+  smart_resetmap(dev);
 
   /* Now scan the MTD device */
 
@@ -847,20 +1119,22 @@ static int smart_scan(struct smart_struct_s *dev)
 
       /* Test for duplicate logical sectors on the device */
 
-      if (dev->sMap[logicalsector] != 0xFFFF)
+      if (smart_mapped(dev, logicalsector))
         {
           /* Uh-oh, we found more than 1 physical sector claiming to be
            * the * same logical sector.  Use the sequence number information
            * to resolve who wins.
            */
 
+          uint16_t winner;
           uint16_t loser;
 
           seq2 = *((uint16_t *) header.seq);
 
           /* We must re-read the 1st physical sector to get it's seq number */
 
-          readaddress = dev->sMap[logicalsector]  * dev->mtdBlksPerSector * dev->geo.blocksize;
+          winner = smart_getmap(dev, logicalsector);
+          readaddress = winner * dev->mtdBlksPerSector * dev->geo.blocksize;
           ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
                   (uint8_t *) &header);
           if (ret != sizeof(struct smart_sect_header_s))
@@ -876,15 +1150,15 @@ static int smart_scan(struct smart_struct_s *dev)
             {
               /* Seq 2 is the winner ... we assume it wrapped */
 
-              loser = dev->sMap[logicalsector];
-              dev->sMap[logicalsector] = sector;
+              loser = winner;
+              smart_setmap(dev, logicalsector, sector);
             }
           else if (seq2 > seq1)
             {
               /* Seq 2 is bigger, so it's the winner */
 
-              loser = dev->sMap[logicalsector];
-              dev->sMap[logicalsector] = sector;
+              loser = winner;
+              smart_setmap(dev, logicalsector, sector);
             }
           else
             {
@@ -915,11 +1189,18 @@ static int smart_scan(struct smart_struct_s *dev)
               fdbg("Error %d releasing duplicate sector\n", -ret);
               goto err_out;
             }
+
+          /* The original mapping stands if this sector lost */
+
+          if (loser == sector)
+            {
+              continue;
+            }
         }
 
       /* Update the logical to physical sector map */
 
-      dev->sMap[logicalsector] = sector;
+      smart_setmap(dev, logicalsector, sector);
     }
 
   fdbg("SMART Scan\n");
@@ -1026,7 +1307,6 @@ static inline int smart_llformat(struct smart_struct_s *dev, unsigned long arg)
 {
   struct    smart_sect_header_s  *sectorheader;
   size_t    wrcount;
-  size_t    totalsectors;
   int       x;
   int       ret;
   uint8_t   sectsize;
@@ -1041,6 +1321,18 @@ static inline int smart_llformat(struct smart_struct_s *dev, unsigned long arg)
       return ret;
     }
 
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  for (x = 0; x < dev->neraseblocks; x++)
+    {
+      if (dev->erasecount[x] != 0xFFFF)
+        {
+          dev->erasecount[x]++;
+        }
+    }
+
+  dev->blockerases += dev->neraseblocks;
+#endif
+
   /* Now construct a logical sector zero header to write to the device.
    * We fill it with zero so when we add sector aging, all the sector
    * ages will already be initialized to zero without needing special
@@ -1117,15 +1409,10 @@ static inline int smart_llformat(struct smart_struct_s *dev, unsigned long arg)
 
   /* Now initialize the logical to physical sector map */
 
-  dev->sMap[0] = 0;     /* Logical sector zero = physical sector 0 */
-
-  totalsectors = dev->neraseblocks * dev->sectorsPerBlk;
-  for (x = 1; x < totalsectors; x++)
-    {
-      /* Mark all other logical sectors as non-existant */
+  /* Mark all other logical sectors as non-existant */
 
-      dev->sMap[x] = -1;
-    }
+  smart_resetmap(dev);
+  smart_setmap(dev, 0, 0);  /* Logical sector zero = physical sector 0 */
 
 #ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
 
@@ -1396,13 +1683,13 @@ static int smart_garbagecollect(struct smart_struct_s *dev)
 
               /* Update the variables */
 
-              dev->sMap[*((uint16_t *) header->logicalsector)] = newsector;
+              smart_setmap(dev, *((uint16_t *) header->logicalsector), newsector);
               dev->freecount[newsector / dev->sectorsPerBlk]--;
             }
 
           /* Now erase the erase block */
 
-          MTD_ERASE(dev->mtd, collectblock, 1);
+          smart_erase(dev, collectblock);
 
           dev->freesectors += dev->releasecount[collectblock];
           dev->freecount[collectblock] = dev->sectorsPerBlk;
@@ -1486,7 +1773,7 @@ static inline int smart_writesector(struct smart_struct_s *dev, unsigned long ar
       goto errout;
     }
 
-  physsector = dev->sMap[req->logsector];
+  physsector = smart_getmap(dev, req->logsector);
   if (physsector == 0xFFFF)
     {
       fdbg("Logical sector %d not allocated\n", req->logsector);
@@ -1602,13 +1889,13 @@ static inline int smart_writesector(struct smart_struct_s *dev, unsigned long ar
       /* Update releasecount for released sector and freecount for the
        * newly allocated physical sector. */
 
-      dev->releasecount[dev->sMap[req->logsector] / dev->sectorsPerBlk]++;
+      dev->releasecount[mtdblock / dev->mtdBlksPerSector / dev->sectorsPerBlk]++;
       dev->freecount[physsector / dev->sectorsPerBlk]--;
       dev->freesectors--;
 
       /* Update the sector map */
 
-      dev->sMap[req->logsector] = physsector;
+      smart_setmap(dev, req->logsector, physsector);
 
       /* Since we performed a relocation, do garbage collection to
        * ensure we don't fill up our flash with released blocks.
@@ -1664,7 +1951,7 @@ static inline int smart_readsector(struct smart_struct_s *dev, unsigned long arg
       goto errout;
     }
 
-  physsector = dev->sMap[req->logsector];
+  physsector = smart_getmap(dev, req->logsector);
   if (physsector == 0xFFFF)
     {
       fdbg("Logical sector %d not allocated\n", req->logsector);
@@ -1764,7 +2051,7 @@ static inline int smart_allocsector(struct smart_struct_s *dev, unsigned long re
     {
       /* Validate the sector is not already allocated */
 
-      if (dev->sMap[requested] == (uint16_t) -1)
+      if (!smart_mapped(dev, requested))
         {
           logsector = requested;
         }
@@ -1778,7 +2065,7 @@ static inline int smart_allocsector(struct smart_struct_s *dev, unsigned long re
 
       for (x = SMART_FIRST_ALLOC_SECTOR; x < dev->totalsectors; x++)
         {
-          if (dev->sMap[x] == (uint16_t) -1)
+          if (!smart_mapped(dev, x))
             {
               /* Unused logical sector found.  Use this one */
 
@@ -1853,7 +2140,7 @@ static inline int smart_allocsector(struct smart_struct_s *dev, unsigned long re
 
   /* Map the sector and update the free sector counts */
 
-  dev->sMap[logsector] = physicalsector;
+  smart_setmap(dev, logsector, physicalsector);
   dev->freecount[physicalsector / dev->sectorsPerBlk]--;
   dev->freesectors--;
 
@@ -1889,7 +2176,7 @@ static inline int smart_freesector(struct smart_struct_s *dev, unsigned long
     {
       /* Validate the sector is actually allocated */
 
-      if (dev->sMap[logicalsector] == (uint16_t) -1)
+      if (!smart_mapped(dev, logicalsector))
         {
           fdbg("Invalid release - sector %d not allocated\n", logicalsector);
           ret = -EINVAL;
@@ -1899,7 +2186,7 @@ static inline int smart_freesector(struct smart_struct_s *dev, unsigned long
 
   /* Okay to release the sector.  Read the sector header info */
 
-  physsector = dev->sMap[logicalsector];
+  physsector = smart_getmap(dev, logicalsector);
   readaddr = physsector * dev->mtdBlksPerSector * dev->geo.blocksize;
   ret = MTD_READ(dev->mtd, readaddr, sizeof(struct smart_sect_header_s),
                  (uint8_t *) &header);
@@ -1944,7 +2231,7 @@ static inline int smart_freesector(struct smart_struct_s *dev, unsigned long
 
   /* Unmap this logical sector */
 
-  dev->sMap[logicalsector] = (uint16_t) -1;
+  smart_setmap(dev, logicalsector, 0xFFFF);
 
   /* If this block has only released blocks, then erase it */
 
@@ -1952,7 +2239,7 @@ static inline int smart_freesector(struct smart_struct_s *dev, unsigned long
     {
       /* Erase the block */
 
-      MTD_ERASE(dev->mtd, block, 1);
+      smart_erase(dev, block);
 
       dev->freesectors += dev->releasecount[block];
       dev->releasecount[block] = 0;
@@ -2080,12 +2367,16 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
       procfs_data->namelen = dev->namesize;
       procfs_data->formatversion = dev->formatversion;
       procfs_data->unusedsectors = 0;
-      procfs_data->blockerases = 0;
       procfs_data->sectorsperblk = dev->sectorsPerBlk;
+      procfs_data->formatsector = smart_getmap(dev, 0);
+      procfs_data->dirsector = smart_getmap(dev, 3);
 
-#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
-      procfs_data->formatsector = dev->sMap[0];
-      procfs_data->dirsector = dev->sMap[3];
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+      procfs_data->blockerases = dev->blockerases;
+      procfs_data->wearcounts = dev->erasecount;
+      procfs_data->nwearblocks = dev->neraseblocks;
+#else
+      procfs_data->blockerases = 0;
 #endif
 
 #ifdef CONFIG_MTD_SMART_SECTOR_ERASE_DEBUG
@@ -74,7 +74,9 @@
 #  define CONFIG_SST25XX_SPIMODE SPIDEV_MODE0
 #endif
 
-/* SPI Frequency.  May be up to 25MHz. */
+/* SPI Frequency.  May be up to 25MHz with READ (0x03); FAST_READ (0x0b), which is
+ * used unless CONFIG_SST25XX_SLOWREAD is selected, allows higher clocks.
+ */
 
 #ifndef CONFIG_SST25XX_SPIFREQUENCY
 #  define CONFIG_SST25XX_SPIFREQUENCY 20000000
@@ -771,7 +773,11 @@ static ssize_t sst25xx_read(FAR struct mtd_dev_s *dev, off_t offset, size_t nbyt
 
   /* Send "Read from Memory " instruction */
 
+#ifdef CONFIG_SST25XX_SLOWREAD
   (void)SPI_SEND(priv->dev, SST25_READ);
+#else
+  (void)SPI_SEND(priv->dev, SST25_FAST_READ);
+#endif
 
   /* Send the page offset high byte first. */
 
@@ -779,6 +785,12 @@ static ssize_t sst25xx_read(FAR struct mtd_dev_s *dev, off_t offset, size_t nbyt
   (void)SPI_SEND(priv->dev, (offset >> 8) & 0xff);
   (void)SPI_SEND(priv->dev, offset & 0xff);
 
+  /* Send a dummy byte */
+
+#ifndef CONFIG_SST25XX_SLOWREAD
+  (void)SPI_SEND(priv->dev, SST25_DUMMY);
+#endif
+
   /* Then read all of the requested bytes */
 
   SPI_RECVBLOCK(priv->dev, buffer, nbytes);
@@ -1097,7 +1097,21 @@ static int w25_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg)
         }
         break;
 
+#if defined(CONFIG_W25_XIPBASE) && CONFIG_W25_XIPBASE != 0
       case MTDIOC_XIPBASE:
+        {
+          FAR void **ppv = (FAR void**)((uintptr_t)arg);
+          if (ppv)
+            {
+              /* Return the address where the SPI controller maps the FLASH */
+
+              *ppv = (FAR void*)CONFIG_W25_XIPBASE;
+              ret  = OK;
+            }
+        }
+        break;
+
+#endif
       default:
         ret = -ENOTTY; /* Bad command */
         break;
@@ -77,6 +77,10 @@ static const struct file_operations fifo_fops =
 #ifndef CONFIG_DISABLE_POLL
   , pipecommon_poll /* poll */
 #endif
+#ifdef CONFIG_FS_VECTORIO
+  , 0               /* readv */
+  , pipecommon_writev /* writev */
+#endif
 };
 
 /****************************************************************************
@@ -88,7 +92,7 @@ static const struct file_operations fifo_fops =
  ****************************************************************************/
 
 /****************************************************************************
- * Name: mkfifo
+ * Name: mkfifo2
  *
  * Description:
  *   mkfifo() makes a FIFO device driver file with name 'pathname.'  Unlike
@@ -109,6 +113,8 @@ static const struct file_operations fifo_fops =
  *   pathname - The full path to the FIFO instance to attach to or to create
  *     (if not already created).
  *   mode - Ignored for now
+ *   bufsize - The size of the FIFO buffer, at most CONFIG_DEV_PIPE_MAXSIZE.
+ *     The FIFO holds up to bufsize - 1 bytes.
  *
  * Return:
  *   0 is returned on success; otherwise, -1 is returned with errno set
@@ -116,14 +122,19 @@ static const struct file_operations fifo_fops =
  *
  ****************************************************************************/
 
-int mkfifo(FAR const char *pathname, mode_t mode)
+int mkfifo2(FAR const char *pathname, mode_t mode, size_t bufsize)
 {
   struct pipe_dev_s *dev;
   int ret;
 
+  if (bufsize < 2 || bufsize > CONFIG_DEV_PIPE_MAXSIZE)
+    {
+      return -EINVAL;
+    }
+
   /* Allocate and initialize a new device structure instance */
 
-  dev = pipecommon_allocdev();
+  dev = pipecommon_allocdev(bufsize);
   if (!dev)
     {
       return -ENOMEM;
@@ -138,4 +149,17 @@ int mkfifo(FAR const char *pathname, mode_t mode)
   return ret;
 }
 
+/****************************************************************************
+ * Name: mkfifo
+ *
+ * Description:
+ *   As mkfifo2(), with a buffer of CONFIG_DEV_PIPE_SIZE bytes.
+ *
+ ****************************************************************************/
+
+int mkfifo(FAR const char *pathname, mode_t mode)
+{
+  return mkfifo2(pathname, mode, CONFIG_DEV_PIPE_SIZE);
+}
+
 #endif /* CONFIG_DEV_PIPE_SIZE > 0 */
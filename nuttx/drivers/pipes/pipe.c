@@ -86,11 +86,18 @@ static const struct file_operations pipe_fops =
 #ifndef CONFIG_DISABLE_POLL
   , pipecommon_poll  /* poll */
 #endif
+#ifdef CONFIG_FS_VECTORIO
+  , 0                /* readv */
+  , pipecommon_writev /* writev */
+#endif
 };
 
 static sem_t  g_pipesem       = SEM_INITIALIZER(1);
 static uint32_t g_pipeset     = 0;
-static uint32_t g_pipecreated = 0;
+
+/* The pipe devices that have been registered, which are reused */
+
+static FAR struct pipe_dev_s *g_pipedev[MAX_PIPES];
 
 /****************************************************************************
  * Private Functions
@@ -168,16 +175,17 @@ static int pipe_close(FAR struct file *filep)
  ****************************************************************************/
 
 /****************************************************************************
- * Name: pipe
+ * Name: pipe2
  *
  * Description:
- *   pipe() creates a pair of file descriptors, pointing to a pipe inode, and
- *   places them in the array pointed to by 'fd'. fd[0] is for reading,
- *   fd[1] is for writing.
+ *   pipe2() creates a pair of file descriptors, pointing to a pipe inode,
+ *   and places them in the array pointed to by 'fd'. fd[0] is for reading,
+ *   fd[1] is for writing.  The pipe buffers up to bufsize - 1 bytes.
  *
  * Inputs:
  *   fd[2] - The user provided array in which to catch the pipe file
  *   descriptors
+ *   bufsize - The size of the pipe buffer, at most CONFIG_DEV_PIPE_MAXSIZE
  *
  * Return:
  *   0 is returned on success; otherwise, -1 is returned with errno set
@@ -185,7 +193,7 @@ static int pipe_close(FAR struct file *filep)
  *
  ****************************************************************************/
 
-int pipe(int fd[2])
+int pipe2(int fd[2], size_t bufsize)
 {
   struct pipe_dev_s *dev = NULL;
   char devname[16];
@@ -193,6 +201,12 @@ int pipe(int fd[2])
   int err;
   int ret;
 
+  if (bufsize < 2 || bufsize > CONFIG_DEV_PIPE_MAXSIZE)
+    {
+      err = EINVAL;
+      goto errout;
+    }
+
   /* Get exclusive access to the pipe allocation data */
 
   ret = sem_wait(&g_pipesem);
@@ -219,11 +233,19 @@ int pipe(int fd[2])
 
   /* Check if the pipe device has already been created */
 
-  if ((g_pipecreated & (1 << pipeno)) == 0)
+  if (g_pipedev[pipeno] != NULL)
+    {
+      /* Yes.. it has no open references, so its buffer is allocated with
+       * the new size when it is opened below.
+       */
+
+      g_pipedev[pipeno]->d_bufsize = bufsize;
+    }
+  else
     {
       /* No.. Allocate and initialize a new device structure instance */
 
-      dev = pipecommon_allocdev();
+      dev = pipecommon_allocdev(bufsize);
       if (!dev)
         {
           (void)sem_post(&g_pipesem);
@@ -245,7 +267,7 @@ int pipe(int fd[2])
 
       /* Remember that we created this device */
 
-       g_pipecreated |= (1 << pipeno);
+      g_pipedev[pipeno] = dev;
     }
 
   (void)sem_post(&g_pipesem);
@@ -255,7 +277,7 @@ int pipe(int fd[2])
   fd[1] = open(devname, O_WRONLY);
   if (fd[1] < 0)
     {
-      err = -fd[1];
+      err = get_errno();
       goto errout_with_driver;
     }
 
@@ -264,7 +286,7 @@ int pipe(int fd[2])
   fd[0] = open(devname, O_RDONLY);
   if (fd[0] < 0)
     {
-      err = -fd[0];
+      err = get_errno();
       goto errout_with_wrfd;
     }
 
@@ -274,6 +296,8 @@ errout_with_wrfd:
   close(fd[1]);
 errout_with_driver:
   unregister_driver(devname);
+  dev = g_pipedev[pipeno];
+  g_pipedev[pipeno] = NULL;
 errout_with_dev:
   pipecommon_freedev(dev);
 errout_with_pipe:
@@ -283,4 +307,27 @@ errout:
   return ERROR;
 }
 
+/****************************************************************************
+ * Name: pipe
+ *
+ * Description:
+ *   pipe() creates a pair of file descriptors, pointing to a pipe inode, and
+ *   places them in the array pointed to by 'fd'. fd[0] is for reading,
+ *   fd[1] is for writing.  The pipe buffer is CONFIG_DEV_PIPE_SIZE bytes.
+ *
+ * Inputs:
+ *   fd[2] - The user provided array in which to catch the pipe file
+ *   descriptors
+ *
+ * Return:
+ *   0 is returned on success; otherwise, -1 is returned with errno set
+ *   appropriately.
+ *
+ ****************************************************************************/
+
+int pipe(int fd[2])
+{
+  return pipe2(fd, CONFIG_DEV_PIPE_SIZE);
+}
+
 #endif /* CONFIG_DEV_PIPE_SIZE > 0 */
@@ -76,6 +76,13 @@
 #  define pipe_dumpbuffer(m,a,n)
 #endif
 
+/* The reader and the writer publish their index only after the data it
+ * covers has been copied.  On a uniprocessor, keeping the compiler from
+ * reordering the copy and the index update is enough.
+ */
+
+#define pipe_barrier() __asm__ __volatile__("" ::: "memory")
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -110,6 +117,20 @@ static void pipecommon_semtake(sem_t *sem)
     }
 }
 
+/****************************************************************************
+ * Name: pipecommon_wakeall
+ ****************************************************************************/
+
+static void pipecommon_wakeall(FAR sem_t *sem)
+{
+  int sval;
+
+  while (sem_getvalue(sem, &sval) == 0 && sval < 0)
+    {
+      sem_post(sem);
+    }
+}
+
 /****************************************************************************
  * Name: pipecommon_pollnotify
  ****************************************************************************/
@@ -145,7 +166,7 @@ static void pipecommon_pollnotify(FAR struct pipe_dev_s *dev, pollevent_t events
  * Name: pipecommon_allocdev
  ****************************************************************************/
 
-FAR struct pipe_dev_s *pipecommon_allocdev(void)
+FAR struct pipe_dev_s *pipecommon_allocdev(size_t bufsize)
 {
  struct pipe_dev_s *dev;
 
@@ -158,8 +179,11 @@ FAR struct pipe_dev_s *pipecommon_allocdev(void)
 
       memset(dev, 0, sizeof(struct pipe_dev_s));
       sem_init(&dev->d_bfsem, 0, 1);
+      sem_init(&dev->d_rdlock, 0, 1);
+      sem_init(&dev->d_wrlock, 0, 1);
       sem_init(&dev->d_rdsem, 0, 0);
       sem_init(&dev->d_wrsem, 0, 0);
+      dev->d_bufsize = bufsize;
     }
 
   return dev;
@@ -172,6 +196,8 @@ FAR struct pipe_dev_s *pipecommon_allocdev(void)
 void pipecommon_freedev(FAR struct pipe_dev_s *dev)
 {
    sem_destroy(&dev->d_bfsem);
+   sem_destroy(&dev->d_rdlock);
+   sem_destroy(&dev->d_wrlock);
    sem_destroy(&dev->d_rdsem);
    sem_destroy(&dev->d_wrsem);
    kmm_free(dev);
@@ -212,7 +238,7 @@ int pipecommon_open(FAR struct file *filep)
 
   if (dev->d_refs == 0)
     {
-      dev->d_buffer = (uint8_t*)kmm_malloc(CONFIG_DEV_PIPE_SIZE);
+      dev->d_buffer = (uint8_t*)kmm_malloc(dev->d_bufsize);
       if (!dev->d_buffer)
         {
           (void)sem_post(&dev->d_bfsem);
@@ -350,6 +376,13 @@ int pipecommon_close(FAR struct file *filep)
 
 /****************************************************************************
  * Name: pipecommon_read
+ *
+ * Description:
+ *   Readers only hold d_rdlock, so they never wait for a writer that is
+ *   copying data in.  The scheduler is locked from the check for an empty
+ *   pipe until the wait on d_rdsem, so that a writer cannot add data in
+ *   between and miss this reader.
+ *
  ****************************************************************************/
 
 ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
@@ -360,7 +393,9 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
   FAR uint8_t       *start  = (uint8_t*)buffer;
 #endif
   ssize_t            nread  = 0;
-  int                sval;
+  size_t             chunk;
+  size_t             wrndx;
+  size_t             rdndx;
   int                ret;
 
   /* Some sanity checking */
@@ -371,22 +406,24 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
     }
 #endif
 
-  /* Make sure that we have exclusive access to the device structure */
+  /* Make sure that we have exclusive access among the readers */
 
-  if (sem_wait(&dev->d_bfsem) < 0)
+  if (sem_wait(&dev->d_rdlock) < 0)
     {
       return ERROR;
     }
 
   /* If the pipe is empty, then wait for something to be written to it */
 
+  sched_lock();
   while (dev->d_wrndx == dev->d_rdndx)
     {
       /* If O_NONBLOCK was set, then return EGAIN */
 
       if (filep->f_oflags & O_NONBLOCK)
         {
-          sem_post(&dev->d_bfsem);
+          sched_unlock();
+          sem_post(&dev->d_rdlock);
           return -EAGAIN;
         }
 
@@ -394,54 +431,162 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
 
       if (dev->d_nwriters <= 0)
         {
-          sem_post(&dev->d_bfsem);
+          sched_unlock();
+          sem_post(&dev->d_rdlock);
           return 0;
         }
 
       /* Otherwise, wait for something to be written to the pipe */
 
-      sched_lock();
-      sem_post(&dev->d_bfsem);
+      sem_post(&dev->d_rdlock);
       ret = sem_wait(&dev->d_rdsem);
-      sched_unlock();
-
-      if (ret < 0  || sem_wait(&dev->d_bfsem) < 0)
+      if (ret < 0  || sem_wait(&dev->d_rdlock) < 0)
         {
+          sched_unlock();
           return ERROR;
         }
     }
 
-  /* Then return whatever is available in the pipe (which is at least one byte) */
+  sched_unlock();
+
+  /* Then return whatever is available in the pipe (which is at least one
+   * byte).  The writer may add more meanwhile, but only after wrndx.
+   */
+
+  wrndx = dev->d_wrndx;
+  rdndx = dev->d_rdndx;
 
-  nread = 0;
-  while (nread < len && dev->d_wrndx != dev->d_rdndx)
+  while (nread < len && rdndx != wrndx)
     {
-      *buffer++ = dev->d_buffer[dev->d_rdndx];
-      if (++dev->d_rdndx >= CONFIG_DEV_PIPE_SIZE)
+      chunk = (wrndx > rdndx ? wrndx : dev->d_bufsize) - rdndx;
+      if (chunk > len - nread)
         {
-          dev->d_rdndx = 0;
+          chunk = len - nread;
+        }
+
+      memcpy(buffer, &dev->d_buffer[rdndx], chunk);
+      buffer += chunk;
+      nread  += chunk;
+      rdndx  += chunk;
+      if (rdndx >= dev->d_bufsize)
+        {
+          rdndx = 0;
         }
-      nread++;
     }
 
-  /* Notify all waiting writers that bytes have been removed from the buffer */
+  /* Give the space back to the writer only now that it has been read */
 
-  while (sem_getvalue(&dev->d_wrsem, &sval) == 0 && sval < 0)
-    {
-      sem_post(&dev->d_wrsem);
-    }
+  pipe_barrier();
+  dev->d_rdndx = rdndx;
 
-  /* Notify all poll/select waiters that they can write to the FIFO */
+  /* Notify all waiting writers that bytes have been removed from the
+   * buffer, and all poll/select waiters that they can write to the FIFO.
+   */
 
+  sched_lock();
+  pipecommon_wakeall(&dev->d_wrsem);
   pipecommon_pollnotify(dev, POLLOUT);
+  sched_unlock();
 
-  sem_post(&dev->d_bfsem);
+  sem_post(&dev->d_rdlock);
   pipe_dumpbuffer("From PIPE:", start, nread);
   return nread;
 }
 
+/****************************************************************************
+ * Name: pipecommon_copyin
+ *
+ * Description:
+ *   Copy as much of buffer as fits into the pipe and publish it to the
+ *   readers.  One slot of the circular buffer is always left empty.  Must
+ *   be called with d_wrlock held.  Returns the number of bytes copied.
+ *
+ ****************************************************************************/
+
+static size_t pipecommon_copyin(FAR struct pipe_dev_s *dev,
+                                FAR const uint8_t *buffer, size_t len)
+{
+  size_t ncopied = 0;
+  size_t chunk;
+  size_t wrndx;
+  size_t rdndx;
+
+  wrndx = dev->d_wrndx;
+  rdndx = dev->d_rdndx;
+
+  while (ncopied < len)
+    {
+      if (rdndx > wrndx)
+        {
+          chunk = rdndx - wrndx - 1;
+        }
+      else
+        {
+          chunk = dev->d_bufsize - wrndx - (rdndx == 0 ? 1 : 0);
+        }
+
+      if (chunk == 0)
+        {
+          break;
+        }
+
+      if (chunk > len - ncopied)
+        {
+          chunk = len - ncopied;
+        }
+
+      memcpy(&dev->d_buffer[wrndx], buffer, chunk);
+      buffer  += chunk;
+      ncopied += chunk;
+      wrndx   += chunk;
+      if (wrndx >= dev->d_bufsize)
+        {
+          wrndx = 0;
+        }
+    }
+
+  if (ncopied > 0)
+    {
+      /* Publish the data, then notify all of the waiting readers and
+       * poll/select waiters that more data is available.
+       */
+
+      pipe_barrier();
+      dev->d_wrndx = wrndx;
+
+      sched_lock();
+      pipecommon_wakeall(&dev->d_rdsem);
+      pipecommon_pollnotify(dev, POLLIN);
+      sched_unlock();
+    }
+
+  return ncopied;
+}
+
+/****************************************************************************
+ * Name: pipecommon_isfull
+ ****************************************************************************/
+
+static inline bool pipecommon_isfull(FAR struct pipe_dev_s *dev)
+{
+  size_t nxtwrndx = dev->d_wrndx + 1;
+
+  if (nxtwrndx >= dev->d_bufsize)
+    {
+      nxtwrndx = 0;
+    }
+
+  return nxtwrndx == dev->d_rdndx;
+}
+
 /****************************************************************************
  * Name: pipecommon_write
+ *
+ * Description:
+ *   Writers only hold d_wrlock, so they never wait for a reader that is
+ *   copying data out.  As for the readers, the scheduler is locked from the
+ *   check for a full pipe until the wait on d_wrsem.
+ *
  ****************************************************************************/
 
 ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer, size_t len)
@@ -449,9 +594,6 @@ ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer, size_t
   struct inode      *inode    = filep->f_inode;
   struct pipe_dev_s *dev      = inode->i_private;
   ssize_t            nwritten = 0;
-  ssize_t            last;
-  int                nxtwrndx;
-  int                sval;
 
   /* Some sanity checking */
 
@@ -478,93 +620,183 @@ ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer, size_t
 
   DEBUGASSERT(up_interrupt_context() == false)
 
-  /* Make sure that we have exclusive access to the device structure */
+  /* Make sure that we have exclusive access among the writers */
 
-  if (sem_wait(&dev->d_bfsem) < 0)
+  if (sem_wait(&dev->d_wrlock) < 0)
     {
       return ERROR;
     }
 
   /* Loop until all of the bytes have been written */
 
-  last = 0;
   for (;;)
     {
-      /* Calculate the write index AFTER the next byte is written */
+      nwritten += pipecommon_copyin(dev, (FAR const uint8_t *)buffer + nwritten,
+                                    len - nwritten);
+      if (nwritten >= len)
+        {
+          sem_post(&dev->d_wrlock);
+          return len;
+        }
 
-      nxtwrndx = dev->d_wrndx + 1;
-      if (nxtwrndx >= CONFIG_DEV_PIPE_SIZE)
+      /* There is not enough room.  If O_NONBLOCK was set, then return
+       * partial bytes written or EGAIN
+       */
+
+      if (filep->f_oflags & O_NONBLOCK)
         {
-          nxtwrndx = 0;
+          if (nwritten == 0)
+            {
+              nwritten = -EAGAIN;
+            }
+
+          sem_post(&dev->d_wrlock);
+          return nwritten;
         }
 
-      /* Would the next write overflow the circular buffer? */
+      /* There is more to be written.. wait for data to be removed from the pipe */
 
-      if (nxtwrndx != dev->d_rdndx)
+      sched_lock();
+      sem_post(&dev->d_wrlock);
+      if (pipecommon_isfull(dev))
         {
-          /* No... copy the byte */
+          pipecommon_semtake(&dev->d_wrsem);
+        }
 
-          dev->d_buffer[dev->d_wrndx] = *buffer++;
-          dev->d_wrndx = nxtwrndx;
+      sched_unlock();
+      pipecommon_semtake(&dev->d_wrlock);
+    }
+}
 
-          /* Is the write complete? */
+/****************************************************************************
+ * Name: pipecommon_writev
+ *
+ * Description:
+ *   Gather write.  If the whole list fits in the free space of the pipe, it
+ *   is copied under one hold of d_wrlock with a single wake-up of the
+ *   readers, so that a reader never sees part of it.  Otherwise each buffer
+ *   is written in turn, as writev() would do without this method.
+ *
+ ****************************************************************************/
 
-          if (++nwritten >= len)
-            {
-              /* Yes.. Notify all of the waiting readers that more data is available */
+#ifdef CONFIG_FS_VECTORIO
+ssize_t pipecommon_writev(FAR struct file *filep, FAR const struct iovec *iov,
+                          int iovcnt)
+{
+  struct inode      *inode    = filep->f_inode;
+  struct pipe_dev_s *dev      = inode->i_private;
+  FAR const uint8_t *src;
+  ssize_t            nwritten = 0;
+  ssize_t            ret;
+  size_t             total    = 0;
+  size_t             avail;
+  size_t             chunk;
+  size_t             remaining;
+  size_t             wrndx;
+  int                i;
 
-              while (sem_getvalue(&dev->d_rdsem, &sval) == 0 && sval < 0)
-                {
-                  sem_post(&dev->d_rdsem);
-                }
+#if CONFIG_DEBUG
+  if (!dev)
+    {
+      return -ENODEV;
+    }
+#endif
 
-              /* Notify all poll/select waiters that they can write to the FIFO */
+  DEBUGASSERT(up_interrupt_context() == false)
 
-              pipecommon_pollnotify(dev, POLLIN);
+  for (i = 0; i < iovcnt; i++)
+    {
+      total += iov[i].iov_len;
+    }
+
+  if (sem_wait(&dev->d_wrlock) < 0)
+    {
+      return ERROR;
+    }
 
-              /* Return the number of bytes written */
+  /* One slot of the circular buffer is always left empty.  A reader can
+   * only make more room meanwhile.
+   */
 
-              sem_post(&dev->d_bfsem);
-              return len;
-            }
-        }
-      else
+  wrndx = dev->d_wrndx;
+  avail = (dev->d_rdndx + dev->d_bufsize - wrndx - 1) % dev->d_bufsize;
+
+  if (total <= avail)
+    {
+      for (i = 0; i < iovcnt; i++)
         {
-          /* There is not enough room for the next byte.  Was anything written in this pass? */
+          pipe_dumpbuffer("To PIPE:", (uint8_t*)iov[i].iov_base,
+                          iov[i].iov_len);
+
+          src       = (FAR const uint8_t *)iov[i].iov_base;
+          remaining = iov[i].iov_len;
 
-          if (last < nwritten)
+          while (remaining > 0)
             {
-              /* Yes.. Notify all of the waiting readers that more data is available */
+              /* Copy up to the end of the circular buffer, then wrap */
 
-              while (sem_getvalue(&dev->d_rdsem, &sval) == 0 && sval < 0)
+              chunk = dev->d_bufsize - wrndx;
+              if (chunk > remaining)
                 {
-                  sem_post(&dev->d_rdsem);
+                  chunk = remaining;
                 }
-            }
-          last = nwritten;
-
-          /* If O_NONBLOCK was set, then return partial bytes written or EGAIN */
 
-          if (filep->f_oflags & O_NONBLOCK)
-            {
-              if (nwritten == 0)
+              memcpy(&dev->d_buffer[wrndx], src, chunk);
+              src       += chunk;
+              remaining -= chunk;
+              wrndx     += chunk;
+              if (wrndx >= dev->d_bufsize)
                 {
-                  nwritten = -EAGAIN;
+                  wrndx = 0;
                 }
-              sem_post(&dev->d_bfsem);
-              return nwritten;
             }
+        }
 
-          /* There is more to be written.. wait for data to be removed from the pipe */
+      if (total > 0)
+        {
+          /* Publish the data and notify all of the waiting readers */
+
+          pipe_barrier();
+          dev->d_wrndx = wrndx;
 
           sched_lock();
-          sem_post(&dev->d_bfsem);
-          pipecommon_semtake(&dev->d_wrsem);
+          pipecommon_wakeall(&dev->d_rdsem);
+          pipecommon_pollnotify(dev, POLLIN);
           sched_unlock();
-          pipecommon_semtake(&dev->d_bfsem);
         }
+
+      sem_post(&dev->d_wrlock);
+      return total;
     }
+
+  sem_post(&dev->d_wrlock);
+
+  /* Not enough room: fall back to one write per buffer */
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len == 0)
+        {
+          continue;
+        }
+
+      ret = pipecommon_write(filep, (FAR const char *)iov[i].iov_base,
+                             iov[i].iov_len);
+      if (ret < 0)
+        {
+          return nwritten > 0 ? nwritten : ret;
+        }
+
+      nwritten += ret;
+      if ((size_t)ret < iov[i].iov_len)
+        {
+          break;
+        }
+    }
+
+  return nwritten;
 }
+#endif
 
 /****************************************************************************
  * Name: pipecommon_poll
@@ -630,13 +862,13 @@ int pipecommon_poll(FAR struct file *filep, FAR struct pollfd *fds,
         }
       else
         {
-          nbytes = (CONFIG_DEV_PIPE_SIZE-1) + dev->d_wrndx - dev->d_rdndx;
+          nbytes = dev->d_bufsize + dev->d_wrndx - dev->d_rdndx;
         }
 
       /* Notify the POLLOUT event if the pipe is not full */
 
       eventset = 0;
-      if (nbytes < (CONFIG_DEV_PIPE_SIZE-1))
+      if (nbytes < (dev->d_bufsize - 1))
         {
           eventset |= POLLOUT;
         }
@@ -47,10 +47,24 @@
 #include <stdbool.h>
 #include <poll.h>
 
+#ifdef CONFIG_FS_VECTORIO
+#  include <sys/uio.h>
+#endif
+
 #ifndef CONFIG_DEV_PIPE_SIZE
 #  define CONFIG_DEV_PIPE_SIZE 1024
 #endif
 
+/* Largest buffer that may be requested with pipe2() or mkfifo2() */
+
+#ifndef CONFIG_DEV_PIPE_MAXSIZE
+#  if CONFIG_DEV_PIPE_SIZE > 65535
+#    define CONFIG_DEV_PIPE_MAXSIZE CONFIG_DEV_PIPE_SIZE
+#  else
+#    define CONFIG_DEV_PIPE_MAXSIZE 65535
+#  endif
+#endif
+
 #if CONFIG_DEV_PIPE_SIZE > 0
 
 /****************************************************************************
@@ -71,11 +85,11 @@
  * Public Types
  ****************************************************************************/
 
-/* Make the buffer index as small as possible for the configured pipe size */
+/* Make the buffer index as small as possible for the largest pipe size */
 
-#if CONFIG_DEV_PIPE_SIZE > 65535
+#if CONFIG_DEV_PIPE_MAXSIZE > 65535
 typedef uint32_t pipe_ndx_t;  /* 32-bit index */
-#elif CONFIG_DEV_PIPE_SIZE > 255
+#elif CONFIG_DEV_PIPE_MAXSIZE > 255
 typedef uint16_t pipe_ndx_t;  /* 16-bit index */
 #else
 typedef uint8_t pipe_ndx_t;   /*  8-bit index */
@@ -84,15 +98,23 @@ typedef uint8_t pipe_ndx_t;   /*  8-bit index */
 /* This structure represents the state of one pipe.  A reference to this
  * structure is retained in the i_private field of the inode whenthe pipe/fifo
  * device is registered.
+ *
+ * The circular buffer has a single producer and a single consumer: d_wrndx
+ * is only changed by the writer holding d_wrlock and d_rdndx only by the
+ * reader holding d_rdlock, so a reader and a writer never wait for each
+ * other except when the pipe is empty or full.
  */
 
 struct pipe_dev_s
 {
-  sem_t      d_bfsem;       /* Used to serialize access to d_buffer and indices */
+  sem_t      d_bfsem;       /* Serializes open, close and poll setup */
+  sem_t      d_rdlock;      /* Serializes readers */
+  sem_t      d_wrlock;      /* Serializes writers */
   sem_t      d_rdsem;       /* Empty buffer - Reader waits for data write */
   sem_t      d_wrsem;       /* Full buffer - Writer waits for data read */
-  pipe_ndx_t d_wrndx;       /* Index in d_buffer to save next byte written */
-  pipe_ndx_t d_rdndx;       /* Index in d_buffer to return the next byte read */
+  volatile pipe_ndx_t d_wrndx; /* Index in d_buffer to save next byte written */
+  volatile pipe_ndx_t d_rdndx; /* Index in d_buffer to return the next byte read */
+  pipe_ndx_t d_bufsize;     /* Size of d_buffer, allocated on first open */
   uint8_t    d_refs;        /* References counts on pipe (limited to 255) */
   uint8_t    d_nwriters;    /* Number of reference counts for write access */
   uint8_t    d_pipeno;      /* Pipe minor number */
@@ -119,12 +141,16 @@ extern "C" {
 #  define EXTERN extern
 #endif
 
-EXTERN FAR struct pipe_dev_s *pipecommon_allocdev(void);
+EXTERN FAR struct pipe_dev_s *pipecommon_allocdev(size_t bufsize);
 EXTERN void    pipecommon_freedev(FAR struct pipe_dev_s *dev);
 EXTERN int     pipecommon_open(FAR struct file *filep);
 EXTERN int     pipecommon_close(FAR struct file *filep);
 EXTERN ssize_t pipecommon_read(FAR struct file *, FAR char *, size_t);
 EXTERN ssize_t pipecommon_write(FAR struct file *, FAR const char *, size_t);
+#ifdef CONFIG_FS_VECTORIO
+EXTERN ssize_t pipecommon_writev(FAR struct file *filep,
+                                 FAR const struct iovec *iov, int iovcnt);
+#endif
 #ifndef CONFIG_DISABLE_POLL
 EXTERN int     pipecommon_poll(FAR struct file *filep, FAR struct pollfd *fds,
                                bool setup);
@@ -39,9 +39,15 @@
 
 #include <nuttx/config.h>
 
+#include <syslog.h>
+
 #include <nuttx/power/pm.h>
 #include <arch/irq.h>
 
+#ifdef CONFIG_PM_CALLBACK_TIMING
+#  include <nuttx/hires_tmr.h>
+#endif
+
 #include "pm_internal.h"
 
 #ifdef CONFIG_PM
@@ -108,7 +114,19 @@ static int pm_prepall(enum pm_state_e newstate)
         {
           /* Yes.. prepare the driver */
 
+#ifdef CONFIG_PM_CALLBACK_TIMING
+          uint32_t start = hrt_getusec();
+
           ret = cb->prepare(cb, newstate);
+
+          cb->prepare_us = hrt_getusec() - start;
+          if (cb->prepare_us > cb->prepare_max_us)
+            {
+              cb->prepare_max_us = cb->prepare_us;
+            }
+#else
+          ret = cb->prepare(cb, newstate);
+#endif
         }
     }
 
@@ -147,7 +165,19 @@ static inline void pm_changeall(enum pm_state_e newstate)
         {
           /* Yes.. notify the driver */
 
+#ifdef CONFIG_PM_CALLBACK_TIMING
+          uint32_t start = hrt_getusec();
+
           cb->notify(cb, newstate);
+
+          cb->notify_us = hrt_getusec() - start;
+          if (cb->notify_us > cb->notify_max_us)
+            {
+              cb->notify_max_us = cb->notify_us;
+            }
+#else
+          cb->notify(cb, newstate);
+#endif
         }
     }
 }
@@ -224,4 +254,33 @@ int pm_changestate(enum pm_state_e newstate)
   return ret;
 }
 
+/****************************************************************************
+ * Name: pm_dumptiming
+ *
+ * Description:
+ *   Log the time spent in the prepare() and notify() callbacks of every
+ *   registered driver during the last state changes.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PM_CALLBACK_TIMING
+void pm_dumptiming(void)
+{
+  FAR sq_entry_t *entry;
+
+  syslog("PM callbacks (us):  prepare last/max  notify last/max\n");
+
+  for (entry = sq_peek(&g_pmglobals.registry); entry; entry = sq_next(entry))
+    {
+      FAR struct pm_callback_s *cb = (FAR struct pm_callback_s *)entry;
+
+      syslog("  %p  %8lu %8lu  %8lu %8lu\n", cb->priv,
+             (unsigned long)cb->prepare_us,
+             (unsigned long)cb->prepare_max_us,
+             (unsigned long)cb->notify_us,
+             (unsigned long)cb->notify_max_us);
+    }
+}
+#endif
+
 #endif /* CONFIG_PM */
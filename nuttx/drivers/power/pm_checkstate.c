@@ -108,6 +108,7 @@
 
 enum pm_state_e pm_checkstate(void)
 {
+  enum pm_state_e state;
   uint32_t now;
   irqstate_t flags;
 
@@ -147,7 +148,6 @@ enum pm_state_e pm_checkstate(void)
 
        (void)pm_update(accum);
     }
-  irqrestore(flags);
 
   /* Return the recommended state.  Assuming that we are called from the
    * IDLE thread at the lowest priority level, any updates scheduled on the
@@ -155,7 +155,16 @@ enum pm_state_e pm_checkstate(void)
    * state should be current:
    */
 
-  return g_pmglobals.recommended;
+  state = g_pmglobals.recommended;
+
+#ifdef CONFIG_PM_PREDICT
+  /* But do not go deeper than the predicted idle time pays for */
+
+  state = pm_predict_state(state, now);
+#endif
+
+  irqrestore(flags);
+  return state;
 }
 
 #endif /* CONFIG_PM */
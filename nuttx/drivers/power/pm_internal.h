@@ -70,6 +70,26 @@
 
 #define TIME_SLICE_TICKS ((CONFIG_PM_SLICEMS * CLOCKS_PER_SEC) /  1000)
 
+/* Predictive governor */
+
+#ifdef CONFIG_PM_PREDICT
+#  ifndef CONFIG_PM_PREDICT_NDOMAINS
+#    define CONFIG_PM_PREDICT_NDOMAINS 8
+#  endif
+
+#  ifndef CONFIG_PM_PREDICT_BURSTGAP_MS
+#    define CONFIG_PM_PREDICT_BURSTGAP_MS 20
+#  endif
+
+#  ifndef CONFIG_PM_PREDICT_STANDBY_BREAKEVEN_MS
+#    define CONFIG_PM_PREDICT_STANDBY_BREAKEVEN_MS 50
+#  endif
+
+#  ifndef CONFIG_PM_PREDICT_SLEEP_BREAKEVEN_MS
+#    define CONFIG_PM_PREDICT_SLEEP_BREAKEVEN_MS 500
+#  endif
+#endif
+
 /* Function-like macros *****************************************************/
 /****************************************************************************
  * Name: pm_lock
@@ -95,6 +115,21 @@
 /****************************************************************************
  * Public Types
  ****************************************************************************/
+#ifdef CONFIG_PM_PREDICT
+/* This structure holds what the predictive governor learnt about the bursts
+ * of activity of one activity domain.  All times are in system clock ticks.
+ */
+
+struct pm_domain_s
+{
+  uint32_t start;     /* Time of the first activity of the last burst */
+  uint32_t last;      /* Time of the last activity of the last burst */
+  uint32_t interval;  /* Average interval between the starts of bursts */
+  uint8_t  nbursts;   /* Number of bursts seen, saturates at 2 */
+};
+
+#endif
+
 /* This structure encapsulates all of the global data used by the PM module */
 
 struct pm_global_s
@@ -154,6 +189,14 @@ struct pm_global_s
    */
 
   sq_queue_t registry;
+
+#ifdef CONFIG_PM_PREDICT
+  /* What the predictive governor learnt about each activity domain.  Only
+   * accessed with interrupts disabled.
+   */
+
+  struct pm_domain_s domain[CONFIG_PM_PREDICT_NDOMAINS];
+#endif
 };
 
 /****************************************************************************
@@ -201,6 +244,49 @@ EXTERN struct pm_global_s g_pmglobals;
 
 EXTERN void pm_update(int16_t accum);
 
+/****************************************************************************
+ * Name: pm_predict_activity
+ *
+ * Description:
+ *   Record activity in an activity domain and update the average interval
+ *   between its bursts of activity when this activity starts a new burst.
+ *
+ * Input Parameters:
+ *   domain - The activity domain.
+ *   now    - The current system time, in ticks.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PM_PREDICT
+EXTERN void pm_predict_activity(int domain, uint32_t now);
+#endif
+
+/****************************************************************************
+ * Name: pm_predict_state
+ *
+ * Description:
+ *   Limit a recommended state to the deepest state whose break-even time is
+ *   shorter than the time until the next burst of activity is predicted.
+ *
+ * Input Parameters:
+ *   state - The state recommended by the activity thresholds.
+ *   now   - The current system time, in ticks.
+ *
+ * Returned Value:
+ *   The state that should be entered.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PM_PREDICT
+EXTERN enum pm_state_e pm_predict_state(enum pm_state_e state, uint32_t now);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
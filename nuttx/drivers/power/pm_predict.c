@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <assert.h>
+
+#include <nuttx/power/pm.h>
+#include <nuttx/clock.h>
+#include <arch/irq.h>
+
+#include "pm_internal.h"
+
+#ifdef CONFIG_PM_PREDICT
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BURSTGAP_TICKS         MSEC2TICK(CONFIG_PM_PREDICT_BURSTGAP_MS)
+#define STANDBY_BREAKEVEN_TICKS \
+  MSEC2TICK(CONFIG_PM_PREDICT_STANDBY_BREAKEVEN_MS)
+#define SLEEP_BREAKEVEN_TICKS  MSEC2TICK(CONFIG_PM_PREDICT_SLEEP_BREAKEVEN_MS)
+
+/* Weight of the new interval in the average, as a shift: 1/4 */
+
+#define PREDICT_SHIFT          2
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pm_predict_idle
+ *
+ * Description:
+ *   Return the time until the next burst of activity of any domain is
+ *   expected.
+ *
+ *   A domain that is in the middle of a burst expects more activity right
+ *   now.  A domain whose next burst is overdue by more than one interval
+ *   is considered to have gone quiet and does not take part in the
+ *   prediction any more until it is active again.
+ *
+ * Input Parameters:
+ *   now - The current system time, in ticks.
+ *
+ * Returned Value:
+ *   The predicted idle time in ticks, UINT32_MAX if nothing is expected.
+ *
+ ****************************************************************************/
+
+static uint32_t pm_predict_idle(uint32_t now)
+{
+  FAR struct pm_domain_s *dom;
+  uint32_t idle = UINT32_MAX;
+  uint32_t elapsed;
+  int i;
+
+  for (i = 0; i < CONFIG_PM_PREDICT_NDOMAINS; i++)
+    {
+      dom = &g_pmglobals.domain[i];
+      if (dom->nbursts == 0)
+        {
+          continue;
+        }
+
+      /* Is a burst in progress? */
+
+      if (now - dom->last < BURSTGAP_TICKS)
+        {
+          return 0;
+        }
+
+      /* No interval is known until the second burst */
+
+      if (dom->nbursts < 2)
+        {
+          continue;
+        }
+
+      elapsed = now - dom->start;
+      if (elapsed < dom->interval)
+        {
+          if (dom->interval - elapsed < idle)
+            {
+              idle = dom->interval - elapsed;
+            }
+        }
+      else if (elapsed - dom->interval < dom->interval)
+        {
+          /* Overdue: the burst may come at any time now */
+
+          return 0;
+        }
+    }
+
+  return idle;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: pm_domain_activity
+ *
+ * Description:
+ *   Same as pm_activity() but also records the activity in the given
+ *   activity domain.
+ *
+ * Input Parameters:
+ *   domain   - Activity domain, range 0 to CONFIG_PM_PREDICT_NDOMAINS - 1.
+ *   priority - Activity priority, as for pm_activity().
+ *
+ * Returned Value:
+ *   None.
+ *
+ * Assumptions:
+ *   This function may be called from an interrupt handler.
+ *
+ ****************************************************************************/
+
+void pm_domain_activity(int domain, int priority)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(domain >= 0 && domain < CONFIG_PM_PREDICT_NDOMAINS);
+
+  if (domain >= 0 && domain < CONFIG_PM_PREDICT_NDOMAINS)
+    {
+      flags = irqsave();
+      pm_predict_activity(domain, clock_systimer());
+      irqrestore(flags);
+    }
+
+  pm_activity(priority);
+}
+
+/****************************************************************************
+ * Name: pm_predict_activity
+ *
+ * Description:
+ *   Record activity in an activity domain and update the average interval
+ *   between its bursts of activity when this activity starts a new burst.
+ *
+ * Input Parameters:
+ *   domain - The activity domain.
+ *   now    - The current system time, in ticks.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+void pm_predict_activity(int domain, uint32_t now)
+{
+  FAR struct pm_domain_s *dom = &g_pmglobals.domain[domain];
+  uint32_t sample;
+
+  if (dom->nbursts == 0)
+    {
+      dom->start   = now;
+      dom->nbursts = 1;
+    }
+  else if (now - dom->last >= BURSTGAP_TICKS)
+    {
+      /* This activity starts a new burst.  Fold the interval since the start
+       * of the previous burst into the average.
+       */
+
+      sample = now - dom->start;
+      if (dom->nbursts < 2)
+        {
+          dom->interval = sample;
+          dom->nbursts  = 2;
+        }
+      else
+        {
+          dom->interval = dom->interval - (dom->interval >> PREDICT_SHIFT) +
+                          (sample >> PREDICT_SHIFT);
+        }
+
+      dom->start = now;
+    }
+
+  dom->last = now;
+}
+
+/****************************************************************************
+ * Name: pm_predict_state
+ *
+ * Description:
+ *   Limit a recommended state to the deepest state whose break-even time is
+ *   shorter than the time until the next burst of activity is predicted.
+ *
+ * Input Parameters:
+ *   state - The state recommended by the activity thresholds.
+ *   now   - The current system time, in ticks.
+ *
+ * Returned Value:
+ *   The state that should be entered.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+enum pm_state_e pm_predict_state(enum pm_state_e state, uint32_t now)
+{
+  uint32_t idle;
+
+  if (state < PM_STANDBY)
+    {
+      return state;
+    }
+
+  idle = pm_predict_idle(now);
+
+  if (state >= PM_SLEEP && idle < SLEEP_BREAKEVEN_TICKS)
+    {
+      state = PM_STANDBY;
+    }
+
+  if (state == PM_STANDBY && idle < STANDBY_BREAKEVEN_TICKS)
+    {
+      state = PM_IDLE;
+    }
+
+  return state;
+}
+
+#endif /* CONFIG_PM_PREDICT */
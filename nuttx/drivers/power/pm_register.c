@@ -98,6 +98,13 @@ int pm_register(FAR struct pm_callback_s *callbacks)
 
   DEBUGASSERT(callbacks);
 
+#ifdef CONFIG_PM_CALLBACK_TIMING
+  callbacks->prepare_us     = 0;
+  callbacks->prepare_max_us = 0;
+  callbacks->notify_us      = 0;
+  callbacks->notify_max_us  = 0;
+#endif
+
   /* Add the new entry to the end of the list of registered callbacks */
 
   ret = pm_lock();
@@ -50,6 +50,7 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <arch/irq.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/wqueue.h>
 #include <nuttx/rwbuffer.h>
@@ -70,6 +71,16 @@
 #  define CONFIG_DRVR_WRDELAY 350
 #endif
 
+/* Statistics ***************************************************************/
+
+#ifdef CONFIG_DRVR_RWBSTATS
+#  define rwb_count(r,f)    ((r)->stats.f++)
+#  define rwb_add(r,f,n)    ((r)->stats.f += (n))
+#else
+#  define rwb_count(r,f)
+#  define rwb_add(r,f,n)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -157,11 +168,9 @@ static inline void rwb_resetwrbuffer(struct rwbuffer_s *rwb)
  ****************************************************************************/
 
 #ifdef CONFIG_DRVR_WRITEBUFFER
-static void rwb_wrflush(struct rwbuffer_s *rwb)
+static int rwb_wrflush(struct rwbuffer_s *rwb)
 {
-  int ret;
-
-  fvdbg("Timeout!\n");
+  int ret = OK;
 
   if (rwb->wrnblocks > 0)
     {
@@ -177,11 +186,80 @@ static void rwb_wrflush(struct rwbuffer_s *rwb)
       if (ret != rwb->wrnblocks)
         {
           fdbg("ERROR: Error flushing write buffer: %d\n", ret);
+          ret = ret < 0 ? ret : -EIO;
+        }
+      else
+        {
+          rwb_add(rwb, wrflushblocks, rwb->wrnblocks);
+          ret = OK;
         }
 
       rwb_resetwrbuffer(rwb);
     }
 
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: rwb_wrflushhead
+ *
+ * Description:
+ *   Make room in the write buffer.  If wralignblocks is set, flush only
+ *   the blocks up to the last alignment boundary in the buffer and move
+ *   the partial erase block that follows it to the beginning of the
+ *   buffer.  Otherwise, or if there is no boundary inside the buffer,
+ *   flush everything.
+ *
+ * Assumptions:
+ *   The caller holds the wrsem semaphore.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_DRVR_WRITEBUFFER
+static int rwb_wrflushhead(struct rwbuffer_s *rwb)
+{
+  off_t  boundary;
+  size_t nflush;
+  size_t nkeep;
+  int    ret;
+
+  if (rwb->wralignblocks == 0 || rwb->wralignblocks >= rwb->wrmaxblocks)
+    {
+      return rwb_wrflush(rwb);
+    }
+
+  boundary = rwb->wrblockstart + rwb->wrnblocks;
+  boundary -= boundary % rwb->wralignblocks;
+  if (boundary <= rwb->wrblockstart)
+    {
+      return rwb_wrflush(rwb);
+    }
+
+  nflush = boundary - rwb->wrblockstart;
+  nkeep  = rwb->wrnblocks - nflush;
+
+  fvdbg("Flushing: blockstart=0x%08lx nblocks=%d keeping=%d\n",
+        (long)rwb->wrblockstart, nflush, nkeep);
+
+  ret = rwb->wrflush(rwb->dev, rwb->wrbuffer, rwb->wrblockstart, nflush);
+  if (ret != nflush)
+    {
+      fdbg("ERROR: Error flushing write buffer: %d\n", ret);
+      rwb_resetwrbuffer(rwb);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  rwb_add(rwb, wrflushblocks, nflush);
+
+  /* Keep the tail.  wrexpectedblock does not change. */
+
+  memmove(rwb->wrbuffer, rwb->wrbuffer + nflush * rwb->blocksize,
+          nkeep * rwb->blocksize);
+
+  rwb->wrblockstart = boundary;
+  rwb->wrnblocks    = nkeep;
+  return OK;
 }
 #endif
 
@@ -189,6 +267,7 @@ static void rwb_wrflush(struct rwbuffer_s *rwb)
  * Name: rwb_wrtimeout
  ****************************************************************************/
 
+#ifdef CONFIG_DRVR_WRITEBUFFER
 static void rwb_wrtimeout(FAR void *arg)
 {
   /* The following assumes that the size of a pointer is 4-bytes or less */
@@ -202,7 +281,12 @@ static void rwb_wrtimeout(FAR void *arg)
    */
 
   rwb_semtake(&rwb->wrsem);
-  rwb_wrflush(rwb);
+  if (rwb->wrnblocks > 0)
+    {
+      rwb_count(rwb, wrfltimeout);
+      (void)rwb_wrflush(rwb);
+    }
+
   rwb_semgive(&rwb->wrsem);
 }
 
@@ -228,6 +312,7 @@ static inline void rwb_wrcanceltimeout(struct rwbuffer_s *rwb)
 {
   (void)work_cancel(LPWORK, &rwb->work);
 }
+#endif
 
 /****************************************************************************
  * Name: rwb_writebuffer
@@ -246,25 +331,37 @@ static ssize_t rwb_writebuffer(FAR struct rwbuffer_s *rwb,
 
   /* First: Should we flush out our cache? We would do that if (1) we already
    * buffering blocks and the next block writing is not in the same sequence,
-   * or (2) the number of blocks would exceed our allocated buffer capacity
+   * or (2) the number of blocks would exceed our allocated buffer capacity.
+   * In the second case, only the erase-block aligned head of the buffer is
+   * written if that leaves enough room.
    */
 
-  if (((startblock != rwb->wrexpectedblock) && (rwb->wrnblocks)) ||
-      ((rwb->wrnblocks + nblocks) > rwb->wrmaxblocks))
+  if (rwb->wrnblocks > 0 && startblock != rwb->wrexpectedblock)
     {
       fvdbg("writebuffer miss, expected: %08x, given: %08x\n",
             rwb->wrexpectedblock, startblock);
 
-      /* Flush the write buffer */
-
-      ret = rwb->wrflush(rwb, rwb->wrbuffer, rwb->wrblockstart, rwb->wrnblocks);
-      if (ret < 0)
+      rwb_count(rwb, wrflseq);
+      ret = rwb_wrflush(rwb);
+    }
+  else if ((rwb->wrnblocks + nblocks) > rwb->wrmaxblocks)
+    {
+      rwb_count(rwb, wrflfull);
+      ret = rwb_wrflushhead(rwb);
+      if (ret >= 0 && (rwb->wrnblocks + nblocks) > rwb->wrmaxblocks)
         {
-          fdbg("ERROR: Error writing multiple from cache: %d\n", -ret);
-          return ret;
+          ret = rwb_wrflush(rwb);
         }
+    }
+  else
+    {
+      ret = OK;
+    }
 
-      rwb_resetwrbuffer(rwb);
+  if (ret < 0)
+    {
+      fdbg("ERROR: Error writing multiple from cache: %d\n", -ret);
+      return ret;
     }
 
   /* writebuffer is empty? Then initialize it */
@@ -285,6 +382,7 @@ static ssize_t rwb_writebuffer(FAR struct rwbuffer_s *rwb,
 
   rwb->wrnblocks      += nblocks;
   rwb->wrexpectedblock = rwb->wrblockstart + rwb->wrnblocks;
+  rwb_add(rwb, wrblocks, nblocks);
   rwb_wrstarttimeout(rwb);
   return nblocks;
 }
@@ -343,7 +441,8 @@ rwb_bufferread(struct rwbuffer_s *rwb,  off_t startblock,
  ****************************************************************************/
 
 #ifdef CONFIG_DRVR_READAHEAD
-static int rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock)
+static int rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock,
+                        size_t nneeded, bool sequential)
 {
   off_t  endblock;
   size_t nblocks;
@@ -356,11 +455,40 @@ static int rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock)
       return -ESPIPE;
     }
 
+  /* Size the read-ahead window.  A sequential stream grows it, anything
+   * else starts over from the minimum, but never read less than what the
+   * caller is waiting for.
+   */
+
+  if (rwb->rhminblocks > 0)
+    {
+      if (sequential)
+        {
+          nblocks = (size_t)rwb->rhwindow << 1;
+        }
+      else
+        {
+          nblocks = rwb->rhminblocks;
+        }
+
+      if (nblocks < nneeded)
+        {
+          nblocks = nneeded;
+        }
+
+      if (nblocks > rwb->rhmaxblocks)
+        {
+          nblocks = rwb->rhmaxblocks;
+        }
+
+      rwb->rhwindow = nblocks;
+    }
+
   /* Get the block number +1 of the last block that will fit in the
    * read-ahead buffer
    */
 
-  endblock = startblock + rwb->rhmaxblocks;
+  endblock = startblock + rwb->rhwindow;
 
   /* Make sure that we don't read past the end of the device */
 
@@ -385,6 +513,9 @@ static int rwb_rhreload(struct rwbuffer_s *rwb, off_t startblock)
       rwb->rhnblocks    = nblocks;
       rwb->rhblockstart = startblock;
 
+      rwb_count(rwb, rhreloads);
+      rwb_add(rwb, rhblocks, nblocks);
+
       /* The return value is not the number of blocks we asked to be loaded. */
 
       return nblocks;
@@ -643,6 +774,9 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
   DEBUGASSERT(rwb->wrflush!= NULL);
   rwb->wrbuffer = NULL;
 #endif
+#ifdef CONFIG_DRVR_RWBSTATS
+  memset(&rwb->stats, 0, sizeof(struct rwb_stats_s));
+#endif
 #ifdef CONFIG_DRVR_READAHEAD
   DEBUGASSERT(rwb->rhreload != NULL);
   rwb->rhbuffer = NULL;
@@ -691,6 +825,14 @@ int rwb_initialize(FAR struct rwbuffer_s *rwb)
       /* Initialize read-ahead buffer parameters */
 
       rwb_resetrhbuffer(rwb);
+      rwb->rhnextblock = (off_t)-1;
+
+      if (rwb->rhminblocks > rwb->rhmaxblocks)
+        {
+          rwb->rhminblocks = rwb->rhmaxblocks;
+        }
+
+      rwb->rhwindow = rwb->rhminblocks > 0 ? rwb->rhminblocks : rwb->rhmaxblocks;
 
       /* Allocate the read-ahead buffer */
 
@@ -750,7 +892,6 @@ void rwb_uninitialize(FAR struct rwbuffer_s *rwb)
 int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
              FAR uint8_t *rdbuffer)
 {
-  uint32_t remaining;
   int ret = OK;
 
   fvdbg("startblock=%ld nblocks=%ld rdbuffer=%p\n",
@@ -770,21 +911,37 @@ int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
        */
 
       rwb_semtake(&rwb->wrsem);
-      if (rwb_overlap(rwb->wrblockstart, rwb->wrnblocks, startblock, nblocks))
+      if (rwb->wrnblocks > 0 &&
+          rwb_overlap(rwb->wrblockstart, rwb->wrnblocks, startblock, nblocks))
         {
-          rwb_wrflush(rwb);
+          rwb_count(rwb, wrflread);
+          ret = rwb_wrflush(rwb);
         }
 
       rwb_semgive(&rwb->wrsem);
+      if (ret < 0)
+        {
+          return ret;
+        }
     }
 #endif
 
 #ifdef CONFIG_DRVR_READAHEAD
   if (rwb->rhmaxblocks > 0)
     {
+      uint32_t remaining;
+      bool sequential;
+      bool reloaded = false;
+
       /* Loop until we have read all of the requested blocks */
 
       rwb_semtake(&rwb->rhsem);
+
+      /* Reads that pick up where the last one ended are a stream */
+
+      sequential       = (startblock == rwb->rhnextblock);
+      rwb->rhnextblock = startblock + nblocks;
+
       for (remaining = nblocks; remaining > 0;)
         {
           /* Is there anything in the read-ahead buffer? */
@@ -809,6 +966,15 @@ int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
                   rwb_bufferread(rwb, startblock, rdblocks, &rdbuffer);
                   startblock += rdblocks;
                   remaining  -= rdblocks;
+
+                  if (reloaded)
+                    {
+                      rwb_add(rwb, rhmisses, rdblocks);
+                    }
+                  else
+                    {
+                      rwb_add(rwb, rhhits, rdblocks);
+                    }
                 }
             }
 
@@ -818,12 +984,16 @@ int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
 
           if (remaining > 0)
             {
-              ret = rwb_rhreload(rwb, startblock);
+              ret = rwb_rhreload(rwb, startblock, remaining, sequential);
               if (ret < 0)
                 {
                   fdbg("ERROR: Failed to fill the read-ahead buffer: %d\n", ret);
+                  rwb->rhnextblock = (off_t)-1;
+                  rwb_semgive(&rwb->rhsem);
                   return ret;
                 }
+
+              reloaded = true;
             }
         }
 
@@ -833,20 +1003,15 @@ int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
        */
 
       rwb_semgive(&rwb->rhsem);
-      ret = nblocks;
-    }
-  else
-#else
-    {
-      /* No read-ahead buffering, (re)load the data directly into
-       * the user buffer.
-       */
-
-      ret = rwb->rhreload(rwb->dev, startblock, nblocks, rdbuffer);
+      return nblocks;
     }
 #endif
 
-  return ret;
+  /* No read-ahead buffering, (re)load the data directly into the user
+   * buffer.
+   */
+
+  return rwb->rhreload(rwb->dev, rdbuffer, startblock, nblocks);
 }
 
 /****************************************************************************
@@ -856,8 +1021,6 @@ int rwb_read(FAR struct rwbuffer_s *rwb, off_t startblock, uint32_t nblocks,
 int rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
               size_t nblocks, FAR const uint8_t *wrbuffer)
 {
-  int ret = OK;
-
 #ifdef CONFIG_DRVR_READAHEAD
   if (rwb->rhmaxblocks > 0)
     {
@@ -880,21 +1043,31 @@ int rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
 #ifdef CONFIG_DRVR_WRITEBUFFER
   if (rwb->wrmaxblocks > 0)
     {
+      int ret = OK;
+
       fvdbg("startblock=%d wrbuffer=%p\n", startblock, wrbuffer);
 
+      rwb_semtake(&rwb->wrsem);
+
       /* Use the block cache unless the buffer size is bigger than block cache */
 
       if (nblocks > rwb->wrmaxblocks)
         {
           /* First flush the cache */
 
-          rwb_semtake(&rwb->wrsem);
-          rwb_wrflush(rwb);
-          rwb_semgive(&rwb->wrsem);
+          if (rwb->wrnblocks > 0)
+            {
+              rwb_wrcanceltimeout(rwb);
+              rwb_count(rwb, wrfldirect);
+              ret = rwb_wrflush(rwb);
+            }
 
           /* Then transfer the data directly to the media */
 
-          ret = rwb->wrflush(rwb->dev, wrbuffer, startblock, nblocks);
+          if (ret >= 0)
+            {
+              ret = rwb->wrflush(rwb->dev, wrbuffer, startblock, nblocks);
+            }
         }
       else
         {
@@ -903,24 +1076,22 @@ int rwb_write(FAR struct rwbuffer_s *rwb, off_t startblock,
           ret = rwb_writebuffer(rwb, startblock, nblocks, wrbuffer);
         }
 
+      rwb_semgive(&rwb->wrsem);
+
       /* On success, return the number of blocks that we were requested to
        * write.  This is for compatibility with the normal return of a block
        * driver write method
        */
-    }
-  else
-#else
-    {
-      /* No write buffer.. just pass the write operation through via the
-       * flush callback.
-       */
 
-      ret = rwb->wrflush(rwb->dev, wrbuffer, startblock, nblocks);
+      return ret;
     }
-
 #endif
 
-  return ret;
+  /* No write buffer.. just pass the write operation through via the flush
+   * callback.
+   */
+
+  return rwb->wrflush(rwb->dev, wrbuffer, startblock, nblocks);
 }
 
 /****************************************************************************
@@ -970,7 +1141,7 @@ int rwb_mediaremoved(FAR struct rwbuffer_s *rwb)
 #endif
 
 #ifdef CONFIG_DRVR_READAHEAD
-  if (rhmaxblocks > 0)
+  if (rwb->rhmaxblocks > 0)
     {
       rwb_semtake(&rwb->rhsem);
       rwb_resetrhbuffer(rwb);
@@ -1018,5 +1189,37 @@ int rwb_invalidate(FAR struct rwbuffer_s *rwb,
 }
 #endif
 
+/****************************************************************************
+ * Name: rwb_getstats
+ *
+ * Description:
+ *   Return a snapshot of the buffering statistics, optionally clearing
+ *   them.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_DRVR_RWBSTATS
+void rwb_getstats(FAR struct rwbuffer_s *rwb, FAR struct rwb_stats_s *stats,
+                  bool reset)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(rwb != NULL && stats != NULL);
+
+  /* The counters are updated under two different semaphores (and from the
+   * worker thread), so just take a consistent copy with interrupts off.
+   */
+
+  flags = irqsave();
+  memcpy(stats, &rwb->stats, sizeof(struct rwb_stats_s));
+  if (reset)
+    {
+      memset(&rwb->stats, 0, sizeof(struct rwb_stats_s));
+    }
+
+  irqrestore(flags);
+}
+#endif
+
 #endif /* CONFIG_DRVR_WRITEBUFFER || CONFIG_DRVR_READAHEAD */
 
@@ -47,6 +47,7 @@
 #define INA230_POWER                0x03
 #define INA230_CURRENT              0x04
 #define INA230_CALIBRATION          0x05
+#define INA230_MASK_ENABLE          0x06
 
 /* CONFIG register bitfields */
 #define INA230_CONFIG_POWER_MODE_MASK       ((uint16_t) 0x0007)
@@ -60,6 +61,10 @@
 #define INA230_CONFIG_RST_MASK              ((uint16_t) 0x8000)
 #define INA230_CONFIG_RST_SHIFT             ((uint8_t) 15)
 
+/* MASK/ENABLE register bitfields */
+#define INA230_MASK_ENABLE_CVRF             ((uint16_t) 0x0008)
+#define INA230_MASK_ENABLE_CNVR             ((uint16_t) 0x0400)
+
 #define INA230_CALIBRATION_VALUE_MAX        ((uint16_t) 0x7FFF)
 #define INA230_CALIBRATION_MULT             5120000 /* 0.00512 / uA / mohm */
 #define INA230_VOLTAGE_LSB                  ((int32_t) 1250) /* 1.25mV */
@@ -485,6 +490,53 @@ int ina230_get_data(ina230_device *dev, ina230_sample *m)
     return ret;
 }
 
+/**
+ * @brief           Assert the ALERT pin when a conversion completes.
+ * @warning         The ALERT pin is deasserted by ina230_ack_alert().
+ *                  All the other alert functions are disabled.
+ * @return          0 on success, standard error codes otherwise
+ * @param[in]       dev: INA230 device
+ * @param[in]       enable: true to enable the conversion ready alert,
+ *                  false to disable all alerts
+ */
+int ina230_set_cnvr_alert(ina230_device *dev, bool enable)
+{
+    if (!dev) {
+        return -EINVAL;
+    }
+
+    dbg_verbose("%s(): addr=0x%02hhX, enable=%d\n",
+                __func__, dev->addr, enable);
+    return ina230_i2c_set(dev->i2c_dev, dev->addr, INA230_MASK_ENABLE,
+                          enable ? INA230_MASK_ENABLE_CNVR : 0);
+}
+
+/**
+ * @brief           Acknowledge the conversion ready alert, deasserting the
+ *                  ALERT pin.
+ * @return          1 if a conversion completed since the last
+ *                  acknowledgement, 0 if not, standard error codes otherwise
+ * @param[in]       dev: INA230 device
+ */
+int ina230_ack_alert(ina230_device *dev)
+{
+    uint16_t mask_enable;
+    int ret;
+
+    if (!dev) {
+        return -EINVAL;
+    }
+
+    /* Reading MASK/ENABLE clears CVRF and the ALERT pin */
+    ret = ina230_i2c_get(dev->i2c_dev, dev->addr,
+                         INA230_MASK_ENABLE, &mask_enable);
+    if (ret) {
+        return -EIO;
+    }
+
+    return !!(mask_enable & INA230_MASK_ENABLE_CVRF);
+}
+
 /**
  * @brief           Denitialize INA230 device.
  * @return          0 on success, standard error codes otherwise
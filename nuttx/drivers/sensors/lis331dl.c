@@ -48,6 +48,14 @@
 #include <nuttx/kmalloc.h>
 #include <nuttx/sensors/lis331dl.h>
 
+#ifdef CONFIG_LIS331DL_STREAM
+#  include <semaphore.h>
+#  include <nuttx/arch.h>
+#  include <nuttx/gpio.h>
+#  include <nuttx/hires_tmr.h>
+#  include <nuttx/wqueue.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -67,6 +75,7 @@
 
 #define ST_LIS331DL_CTRL_REG2       0x21
 #define ST_LIS331DL_CTRL_REG3       0x22
+#define ST_LIS331DL_CR3_I1CFG_DRDY  0x04    /* Data ready on INT1 */
 
 #define ST_LIS331DL_HP_FILTER_RESET 0x23
 
@@ -96,6 +105,17 @@ struct lis331dl_dev_s
   uint8_t                  cr1;
   uint8_t                  cr2;
   uint8_t                  cr3;
+#ifdef CONFIG_LIS331DL_STREAM
+  bool                     streaming;
+  bool                     waiting;  /* A reader waits on waitsem */
+  uint8_t                  gpio;     /* GPIO connected to INT1 */
+  uint32_t                 irq_usec; /* Time of the last data ready interrupt */
+  uint16_t                 head;     /* Next sample written */
+  uint16_t                 count;    /* Samples in the ring */
+  sem_t                    waitsem;
+  struct work_s            work;
+  struct lis331dl_sample_s ring[CONFIG_LIS331DL_STREAM_NSAMPLES];
+#endif
 };
 
 /****************************************************************************
@@ -210,6 +230,71 @@ static int lis331dl_readregs(FAR struct lis331dl_dev_s *dev)
   return OK;
 }
 
+#ifdef CONFIG_LIS331DL_STREAM
+/****************************************************************************
+ * Name: lis331dl_worker
+ *
+ * Description:
+ *   Read the status and the three outputs in one burst and queue the sample.
+ *   Reading the outputs clears the data ready signal: if it is still high,
+ *   a new sample came meanwhile and no edge will announce it, so read again.
+ *
+ ****************************************************************************/
+
+static void lis331dl_worker(FAR void *arg)
+{
+  FAR struct lis331dl_dev_s *dev = arg;
+  FAR struct lis331dl_sample_s *sample;
+  uint8_t regs[7];
+  irqstate_t flags;
+
+  do
+    {
+      if (lis331dl_access(dev, ST_LIS331DL_STATUS_REG, regs, 7) != 7 ||
+          !(regs[0] & ST_LIS331DL_SR_ZYXDA))
+        {
+          break;
+        }
+
+      flags = irqsave();
+
+      sample       = &dev->ring[dev->head];
+      sample->usec = dev->irq_usec;
+      sample->a.x  = regs[2];
+      sample->a.y  = regs[4];
+      sample->a.z  = regs[6];
+
+      dev->head = (dev->head + 1) % CONFIG_LIS331DL_STREAM_NSAMPLES;
+      if (dev->count < CONFIG_LIS331DL_STREAM_NSAMPLES)
+        {
+          dev->count++;
+        }
+
+      if (dev->waiting)
+        {
+          dev->waiting = false;
+          sem_post(&dev->waitsem);
+        }
+
+      irqrestore(flags);
+    }
+  while (dev->streaming && gpio_get_value(dev->gpio));
+}
+
+static int lis331dl_interrupt(int irq, FAR void *context, FAR void *priv)
+{
+  FAR struct lis331dl_dev_s *dev = priv;
+
+  dev->irq_usec = hrt_getusec();
+  if (work_available(&dev->work))
+    {
+      work_queue(HPWORK, &dev->work, lis331dl_worker, dev, 0);
+    }
+
+  return OK;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -279,6 +364,9 @@ int lis331dl_deinit(FAR struct lis331dl_dev_s * dev)
 {
   ASSERT(dev);
 
+#ifdef CONFIG_LIS331DL_STREAM
+  lis331dl_stopstream(dev);
+#endif
   lis331dl_powerdown(dev);
   kmm_free(dev);
 
@@ -373,3 +461,136 @@ lis331dl_getreadings(FAR struct lis331dl_dev_s * dev)
 
   return NULL;
 }
+
+#ifdef CONFIG_LIS331DL_STREAM
+int lis331dl_startstream(FAR struct lis331dl_dev_s * dev, uint8_t gpio)
+{
+  uint8_t cr3 = ST_LIS331DL_CR3_I1CFG_DRDY;
+
+  ASSERT(dev);
+
+  if (dev->streaming)
+    {
+      errno = EBUSY;
+      return ERROR;
+    }
+
+  sem_init(&dev->waitsem, 0, 0);
+  dev->gpio    = gpio;
+  dev->head    = 0;
+  dev->count   = 0;
+  dev->waiting = false;
+
+  gpio_activate(gpio);
+  gpio_direction_in(gpio);
+  gpio_irq_mask(gpio);
+  gpio_irq_settriggering(gpio, IRQ_TYPE_EDGE_RISING);
+  gpio_irq_attach(gpio, lis331dl_interrupt, dev);
+
+  if (lis331dl_access(dev, ST_LIS331DL_CTRL_REG3, &cr3, -1) != 1)
+    {
+      gpio_irq_attach(gpio, NULL, NULL);
+      gpio_deactivate(gpio);
+      sem_destroy(&dev->waitsem);
+      return ERROR;
+    }
+
+  dev->cr3       = cr3;
+  dev->streaming = true;
+  gpio_irq_clear(gpio);
+  gpio_irq_unmask(gpio);
+
+  /* A sample may already be pending, with the signal high and no edge to
+   * come until it is read.
+   */
+
+  work_queue(HPWORK, &dev->work, lis331dl_worker, dev, 0);
+  return OK;
+}
+
+int lis331dl_stopstream(FAR struct lis331dl_dev_s * dev)
+{
+  uint8_t cr3 = 0;
+  irqstate_t flags;
+
+  ASSERT(dev);
+
+  if (!dev->streaming)
+    {
+      return OK;
+    }
+
+  gpio_irq_mask(dev->gpio);
+  gpio_irq_attach(dev->gpio, NULL, NULL);
+  gpio_deactivate(dev->gpio);
+  work_cancel(HPWORK, &dev->work);
+
+  flags = irqsave();
+  dev->streaming = false;
+  if (dev->waiting)
+    {
+      dev->waiting = false;
+      sem_post(&dev->waitsem);
+    }
+
+  irqrestore(flags);
+
+  if (lis331dl_access(dev, ST_LIS331DL_CTRL_REG3, &cr3, -1) == 1)
+    {
+      dev->cr3 = cr3;
+    }
+
+  sem_destroy(&dev->waitsem);
+  return OK;
+}
+
+ssize_t lis331dl_readsamples(FAR struct lis331dl_dev_s * dev,
+                             FAR struct lis331dl_sample_s * samples,
+                             size_t nsamples)
+{
+  irqstate_t flags;
+  size_t tail;
+  size_t i;
+
+  ASSERT(dev && samples);
+
+  flags = irqsave();
+
+  while (dev->count == 0)
+    {
+      if (!dev->streaming)
+        {
+          irqrestore(flags);
+          errno = EINVAL;
+          return ERROR;
+        }
+
+      dev->waiting = true;
+      if (sem_wait(&dev->waitsem) < 0)
+        {
+          dev->waiting = false;
+          irqrestore(flags);
+          return ERROR;
+        }
+    }
+
+  if (nsamples > dev->count)
+    {
+      nsamples = dev->count;
+    }
+
+  tail = (dev->head + CONFIG_LIS331DL_STREAM_NSAMPLES - dev->count) %
+         CONFIG_LIS331DL_STREAM_NSAMPLES;
+
+  for (i = 0; i < nsamples; i++)
+    {
+      samples[i] = dev->ring[tail];
+      tail = (tail + 1) % CONFIG_LIS331DL_STREAM_NSAMPLES;
+    }
+
+  dev->count -= nsamples;
+  irqrestore(flags);
+
+  return nsamples;
+}
+#endif
@@ -1206,6 +1206,10 @@ static int uart_open(FAR struct file *filep)
       dev->recv.head = 0;
       dev->recv.tail = 0;
 
+      /* Circular DMA reception starts over at the beginning of the buffer */
+
+      uart_dmarxstart(dev);
+
       /* Initialise termios state */
 
 #ifdef CONFIG_SERIAL_TERMIOS
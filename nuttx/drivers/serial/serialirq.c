@@ -208,3 +208,59 @@ void uart_recvchars(FAR uart_dev_t *dev)
       uart_datareceived(dev);
     }
 }
+
+/************************************************************************************
+ * Name: uart_recvdma
+ *
+ * Description:
+ *   This function is called from the UART interrupt handler of a lower half that
+ *   receives with circular DMA into recv.buffer.  The data is already in place, so
+ *   only the head index is moved up to the DMA position.  If the DMA caught up with
+ *   data that was not read yet, that data was overwritten and only the newest is
+ *   kept.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_SERIAL_DMARX
+void uart_recvdma(FAR uart_dev_t *dev, int16_t head)
+{
+  FAR struct uart_buffer_s *rxbuf = &dev->recv;
+  int nbytes;
+  int nfree;
+
+  /* How many bytes did the DMA write since the last call? */
+
+  nbytes = head - rxbuf->head;
+  if (nbytes < 0)
+    {
+      nbytes += rxbuf->size;
+    }
+
+  if (nbytes == 0)
+    {
+      return;
+    }
+
+  /* How much room was there?  One slot is always left empty */
+
+  nfree = rxbuf->tail - rxbuf->head - 1;
+  if (nfree < 0)
+    {
+      nfree += rxbuf->size;
+    }
+
+  rxbuf->head = head;
+  if (nbytes > nfree)
+    {
+      /* Overrun: drop the overwritten data by moving the tail just past the
+       * head.
+       */
+
+      rxbuf->tail = (head + 1 >= rxbuf->size) ? 0 : head + 1;
+    }
+
+  /* Inform any waiters there there is new incoming data available. */
+
+  uart_datareceived(dev);
+}
+#endif
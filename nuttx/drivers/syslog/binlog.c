@@ -0,0 +1,897 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/arch.h>
+#include <nuttx/syslog/syslog.h>
+#include <nuttx/syslog/binlog.h>
+
+#include <arch/irq.h>
+
+#ifdef CONFIG_BINLOG
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_BINLOG_BUFSIZE
+#  define CONFIG_BINLOG_BUFSIZE 2048
+#endif
+
+#ifndef CONFIG_BINLOG_MAXSTRING
+#  define CONFIG_BINLOG_MAXSTRING 32
+#endif
+
+#ifndef CONFIG_BINLOG_MAXRECORD
+#  define CONFIG_BINLOG_MAXRECORD 128
+#endif
+
+#ifndef CONFIG_BINLOG_LINESIZE
+#  define CONFIG_BINLOG_LINESIZE 256
+#endif
+
+#if CONFIG_BINLOG_MAXRECORD > CONFIG_BINLOG_BUFSIZE
+#  error CONFIG_BINLOG_MAXRECORD must not exceed CONFIG_BINLOG_BUFSIZE
+#endif
+
+#if CONFIG_BINLOG_MAXRECORD > 65535
+#  error CONFIG_BINLOG_MAXRECORD does not fit in the record header
+#endif
+
+/* Longest conversion specification that is re-formatted on read */
+
+#define BINLOG_SPECLEN 16
+
+/* Format one argument with zero, one or two '*' width/precision values */
+
+#define binlog_format(b,n,s,nstar,star,v) \
+  ((nstar) == 0 ? snprintf(b, n, s, v) : \
+   (nstar) == 1 ? snprintf(b, n, s, (star)[0], v) : \
+                  snprintf(b, n, s, (star)[0], (star)[1], v))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Type of the argument consumed by a conversion specification */
+
+enum binlog_arg_e
+{
+  BINLOG_ARG_NONE = 0,             /* No argument (%%, unknown conversion) */
+  BINLOG_ARG_INT,                  /* int and smaller integers, %c */
+  BINLOG_ARG_LONG,                 /* long */
+  BINLOG_ARG_LLONG,                /* long long, intmax_t */
+  BINLOG_ARG_DOUBLE,               /* double */
+  BINLOG_ARG_PTR,                  /* %p and %n */
+  BINLOG_ARG_STR                   /* %s, the string is copied */
+};
+
+struct binlog_spec_s
+{
+  uint8_t type;                    /* See enum binlog_arg_e */
+  uint8_t nstar;                   /* Number of '*' int arguments */
+};
+
+/* Each record starts with this header, followed by the packed arguments */
+
+struct binlog_hdr_s
+{
+  uint16_t size;                   /* Size of the record, header included */
+  FAR const char *fmt;             /* Format string, never copied */
+};
+
+struct binlog_dev_s
+{
+  volatile size_t bl_head;         /* Offset where the next record goes */
+  volatile size_t bl_tail;         /* Offset of the oldest record */
+  volatile size_t bl_count;        /* Number of bytes used */
+  volatile uint32_t bl_seq;        /* Incremented when the oldest record
+                                    * is removed */
+  uint8_t bl_buffer[CONFIG_BINLOG_BUFSIZE];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static ssize_t binlog_devread(FAR struct file *filep, FAR char *buffer,
+                              size_t buflen);
+static ssize_t binlog_devwrite(FAR struct file *filep,
+                               FAR const char *buffer, size_t buflen);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct file_operations g_binlogfops =
+{
+  0,               /* open */
+  0,               /* close */
+  binlog_devread,  /* read */
+  binlog_devwrite, /* write */
+  0,               /* seek */
+  0                /* ioctl */
+#ifndef CONFIG_DISABLE_POLL
+  , 0              /* poll */
+#endif
+};
+
+static struct binlog_dev_s g_binlog;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: binlog_parse
+ *
+ * Description:
+ *   Parse one conversion specification.  fmt points just after the '%'.
+ *   Returns a pointer just after the conversion character.
+ *
+ ****************************************************************************/
+
+static FAR const char *binlog_parse(FAR const char *fmt,
+                                    FAR struct binlog_spec_s *spec)
+{
+  int nlong = 0;
+
+  spec->type  = BINLOG_ARG_NONE;
+  spec->nstar = 0;
+
+  /* Flags */
+
+  while (*fmt != '\0' && strchr("-+ #0", *fmt) != NULL)
+    {
+      fmt++;
+    }
+
+  /* Field width and precision */
+
+  if (*fmt == '*')
+    {
+      spec->nstar++;
+      fmt++;
+    }
+  else
+    {
+      while (isdigit(*fmt))
+        {
+          fmt++;
+        }
+    }
+
+  if (*fmt == '.')
+    {
+      fmt++;
+      if (*fmt == '*')
+        {
+          spec->nstar++;
+          fmt++;
+        }
+      else
+        {
+          while (isdigit(*fmt))
+            {
+              fmt++;
+            }
+        }
+    }
+
+  /* Length modifier */
+
+  switch (*fmt)
+    {
+      case 'h':
+        fmt++;
+        if (*fmt == 'h')
+          {
+            fmt++;
+          }
+        break;
+
+      case 'l':
+        fmt++;
+        nlong = 1;
+        if (*fmt == 'l')
+          {
+            fmt++;
+            nlong = 2;
+          }
+        break;
+
+      case 'z':
+      case 't':
+        fmt++;
+        nlong = sizeof(size_t) == sizeof(long) ? 1 : 0;
+        break;
+
+      case 'j':
+      case 'q':
+      case 'L':
+        fmt++;
+        nlong = 2;
+        break;
+
+      default:
+        break;
+    }
+
+  /* Conversion */
+
+  switch (*fmt)
+    {
+      case 'd':
+      case 'i':
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'c':
+        spec->type = nlong == 2 ? BINLOG_ARG_LLONG :
+                     nlong == 1 ? BINLOG_ARG_LONG : BINLOG_ARG_INT;
+        break;
+
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        spec->type = BINLOG_ARG_DOUBLE;
+        break;
+
+      case 'p':
+      case 'n':
+        spec->type = BINLOG_ARG_PTR;
+        break;
+
+      case 's':
+        spec->type = BINLOG_ARG_STR;
+        break;
+
+      case '\0':
+        return fmt;
+
+      default:
+        break;
+    }
+
+  return fmt + 1;
+}
+
+/****************************************************************************
+ * Name: binlog_putarg
+ *
+ * Description:
+ *   Append an argument to the record being built.  Returns false if it
+ *   does not fit.
+ *
+ ****************************************************************************/
+
+static bool binlog_putarg(FAR uint8_t *record, FAR size_t *size,
+                          FAR const void *arg, size_t len)
+{
+  if (*size + len > CONFIG_BINLOG_MAXRECORD)
+    {
+      return false;
+    }
+
+  memcpy(record + *size, arg, len);
+  *size += len;
+  return true;
+}
+
+/****************************************************************************
+ * Name: binlog_getarg
+ *
+ * Description:
+ *   Fetch the next argument from a record.  Returns false if the record
+ *   was truncated before it.
+ *
+ ****************************************************************************/
+
+static bool binlog_getarg(FAR const uint8_t *record, size_t size,
+                          FAR size_t *offset, FAR void *arg, size_t len)
+{
+  if (*offset + len > size)
+    {
+      return false;
+    }
+
+  memcpy(arg, record + *offset, len);
+  *offset += len;
+  return true;
+}
+
+/****************************************************************************
+ * Name: binlog_copyin and binlog_copyout
+ *
+ * Description:
+ *   Copy to/from the circular buffer.  Interrupts must be disabled.
+ *
+ ****************************************************************************/
+
+static void binlog_copyin(FAR const uint8_t *src, size_t len)
+{
+  FAR struct binlog_dev_s *priv = &g_binlog;
+  size_t chunk = CONFIG_BINLOG_BUFSIZE - priv->bl_head;
+
+  if (chunk > len)
+    {
+      chunk = len;
+    }
+
+  memcpy(&priv->bl_buffer[priv->bl_head], src, chunk);
+  memcpy(priv->bl_buffer, src + chunk, len - chunk);
+
+  priv->bl_head   = (priv->bl_head + len) % CONFIG_BINLOG_BUFSIZE;
+  priv->bl_count += len;
+}
+
+static void binlog_copyout(size_t offset, FAR void *dest, size_t len)
+{
+  FAR struct binlog_dev_s *priv = &g_binlog;
+  size_t chunk = CONFIG_BINLOG_BUFSIZE - offset;
+
+  if (chunk > len)
+    {
+      chunk = len;
+    }
+
+  memcpy(dest, &priv->bl_buffer[offset], chunk);
+  memcpy((FAR uint8_t *)dest + chunk, priv->bl_buffer, len - chunk);
+}
+
+/****************************************************************************
+ * Name: binlog_drop
+ *
+ * Description:
+ *   Remove the oldest record.  Interrupts must be disabled.
+ *
+ ****************************************************************************/
+
+static void binlog_drop(void)
+{
+  FAR struct binlog_dev_s *priv = &g_binlog;
+  struct binlog_hdr_s hdr;
+
+  binlog_copyout(priv->bl_tail, &hdr, sizeof(hdr));
+
+  priv->bl_tail   = (priv->bl_tail + hdr.size) % CONFIG_BINLOG_BUFSIZE;
+  priv->bl_count -= hdr.size;
+  priv->bl_seq++;
+}
+
+/****************************************************************************
+ * Name: binlog_render
+ *
+ * Description:
+ *   Format one record into line.  Rendering stops at the first argument
+ *   that was not saved.  Returns the length of the text, which is always
+ *   NUL terminated.
+ *
+ ****************************************************************************/
+
+static size_t binlog_render(FAR const uint8_t *record, FAR char *line,
+                            size_t linesize)
+{
+  struct binlog_hdr_s hdr;
+  struct binlog_spec_s spec;
+  FAR const char *fmt;
+  FAR const char *start;
+  char specbuf[BINLOG_SPECLEN];
+  size_t offset = sizeof(hdr);
+  size_t len = 0;
+  size_t avail;
+  int star[2];
+  int ret;
+  int i;
+
+  memcpy(&hdr, record, sizeof(hdr));
+  fmt = hdr.fmt;
+
+  while (*fmt != '\0' && len < linesize - 1)
+    {
+      if (*fmt != '%')
+        {
+          line[len++] = *fmt++;
+          continue;
+        }
+
+      start = fmt;
+      fmt = binlog_parse(fmt + 1, &spec);
+
+      if (spec.type == BINLOG_ARG_NONE)
+        {
+          if (fmt[-1] == '%')
+            {
+              line[len++] = '%';
+            }
+
+          continue;
+        }
+
+      for (i = 0; i < spec.nstar; i++)
+        {
+          if (!binlog_getarg(record, hdr.size, &offset, &star[i],
+                             sizeof(int)))
+            {
+              goto done;
+            }
+        }
+
+      if (fmt - start >= BINLOG_SPECLEN)
+        {
+          goto done;
+        }
+
+      memcpy(specbuf, start, fmt - start);
+      specbuf[fmt - start] = '\0';
+
+      avail = linesize - len;
+      ret   = 0;
+
+      switch (spec.type)
+        {
+          case BINLOG_ARG_INT:
+            {
+              int value;
+
+              if (!binlog_getarg(record, hdr.size, &offset, &value,
+                                 sizeof(value)))
+                {
+                  goto done;
+                }
+
+              ret = binlog_format(&line[len], avail, specbuf, spec.nstar,
+                                  star, value);
+            }
+            break;
+
+          case BINLOG_ARG_LONG:
+            {
+              long value;
+
+              if (!binlog_getarg(record, hdr.size, &offset, &value,
+                                 sizeof(value)))
+                {
+                  goto done;
+                }
+
+              ret = binlog_format(&line[len], avail, specbuf, spec.nstar,
+                                  star, value);
+            }
+            break;
+
+          case BINLOG_ARG_LLONG:
+            {
+              long long value;
+
+              if (!binlog_getarg(record, hdr.size, &offset, &value,
+                                 sizeof(value)))
+                {
+                  goto done;
+                }
+
+              ret = binlog_format(&line[len], avail, specbuf, spec.nstar,
+                                  star, value);
+            }
+            break;
+
+          case BINLOG_ARG_DOUBLE:
+            {
+              double value;
+
+              if (!binlog_getarg(record, hdr.size, &offset, &value,
+                                 sizeof(value)))
+                {
+                  goto done;
+                }
+
+              ret = binlog_format(&line[len], avail, specbuf, spec.nstar,
+                                  star, value);
+            }
+            break;
+
+          case BINLOG_ARG_PTR:
+            {
+              FAR void *value;
+
+              if (!binlog_getarg(record, hdr.size, &offset, &value,
+                                 sizeof(value)))
+                {
+                  goto done;
+                }
+
+              /* %n has nothing to print and its pointer is long gone */
+
+              if (fmt[-1] != 'n')
+                {
+                  ret = binlog_format(&line[len], avail, specbuf,
+                                      spec.nstar, star, value);
+                }
+            }
+            break;
+
+          case BINLOG_ARG_STR:
+            {
+              FAR const char *value = (FAR const char *)&record[offset];
+
+              if (offset >= hdr.size ||
+                  memchr(value, '\0', hdr.size - offset) == NULL)
+                {
+                  goto done;
+                }
+
+              offset += strlen(value) + 1;
+              ret = binlog_format(&line[len], avail, specbuf, spec.nstar,
+                                  star, value);
+            }
+            break;
+
+          default:
+            break;
+        }
+
+      if (ret > 0)
+        {
+          len += (size_t)ret < avail ? (size_t)ret : avail - 1;
+        }
+    }
+
+done:
+  line[len] = '\0';
+  return len;
+}
+
+/****************************************************************************
+ * Name: binlog_printf
+ ****************************************************************************/
+
+static int binlog_printf(FAR const char *fmt, ...)
+{
+  va_list ap;
+  int ret;
+
+  va_start(ap, fmt);
+  ret = binlog_vprintf(fmt, ap);
+  va_end(ap);
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: binlog_devread
+ ****************************************************************************/
+
+static ssize_t binlog_devread(FAR struct file *filep, FAR char *buffer,
+                              size_t buflen)
+{
+  return binlog_read(buffer, buflen);
+}
+
+/****************************************************************************
+ * Name: binlog_devwrite
+ *
+ * Description:
+ *   Text written to the device is transient, so it is saved as a series
+ *   of "%s" records.
+ *
+ ****************************************************************************/
+
+static ssize_t binlog_devwrite(FAR struct file *filep,
+                               FAR const char *buffer, size_t buflen)
+{
+  char chunk[CONFIG_BINLOG_MAXSTRING + 1];
+  size_t remaining = buflen;
+  size_t len;
+
+  while (remaining > 0)
+    {
+      len = remaining < CONFIG_BINLOG_MAXSTRING ?
+            remaining : CONFIG_BINLOG_MAXSTRING;
+
+      memcpy(chunk, buffer, len);
+      chunk[len] = '\0';
+      (void)binlog_printf("%s", chunk);
+
+      buffer    += len;
+      remaining -= len;
+    }
+
+  return buflen;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: binlog_vprintf
+ *
+ * Description:
+ *   Save a message in the binary log.  Only the format string pointer and
+ *   the arguments are stored; the message is formatted when it is read.
+ *
+ ****************************************************************************/
+
+int binlog_vprintf(FAR const char *fmt, va_list ap)
+{
+  uint8_t record[CONFIG_BINLOG_MAXRECORD];
+  struct binlog_hdr_s hdr;
+  struct binlog_spec_s spec;
+  FAR const char *ptr = fmt;
+  size_t size = sizeof(hdr);
+  irqstate_t flags;
+  int i;
+
+  /* Walk the conversions and pack the arguments after the header.  If they
+   * do not all fit, the record is cut short and the message is rendered
+   * up to the first missing argument.
+   */
+
+  while (*ptr != '\0')
+    {
+      if (*ptr++ != '%')
+        {
+          continue;
+        }
+
+      ptr = binlog_parse(ptr, &spec);
+
+      for (i = 0; i < spec.nstar; i++)
+        {
+          int star = va_arg(ap, int);
+
+          if (!binlog_putarg(record, &size, &star, sizeof(star)))
+            {
+              goto full;
+            }
+        }
+
+      switch (spec.type)
+        {
+          case BINLOG_ARG_INT:
+            {
+              int value = va_arg(ap, int);
+
+              if (!binlog_putarg(record, &size, &value, sizeof(value)))
+                {
+                  goto full;
+                }
+            }
+            break;
+
+          case BINLOG_ARG_LONG:
+            {
+              long value = va_arg(ap, long);
+
+              if (!binlog_putarg(record, &size, &value, sizeof(value)))
+                {
+                  goto full;
+                }
+            }
+            break;
+
+          case BINLOG_ARG_LLONG:
+            {
+              long long value = va_arg(ap, long long);
+
+              if (!binlog_putarg(record, &size, &value, sizeof(value)))
+                {
+                  goto full;
+                }
+            }
+            break;
+
+          case BINLOG_ARG_DOUBLE:
+            {
+              double value = va_arg(ap, double);
+
+              if (!binlog_putarg(record, &size, &value, sizeof(value)))
+                {
+                  goto full;
+                }
+            }
+            break;
+
+          case BINLOG_ARG_PTR:
+            {
+              FAR void *value = va_arg(ap, FAR void *);
+
+              if (!binlog_putarg(record, &size, &value, sizeof(value)))
+                {
+                  goto full;
+                }
+            }
+            break;
+
+          case BINLOG_ARG_STR:
+            {
+              FAR const char *value = va_arg(ap, FAR const char *);
+              size_t len;
+
+              if (value == NULL)
+                {
+                  value = "(null)";
+                }
+
+              len = strnlen(value, CONFIG_BINLOG_MAXSTRING);
+              if (size + len + 1 > CONFIG_BINLOG_MAXRECORD)
+                {
+                  goto full;
+                }
+
+              memcpy(&record[size], value, len);
+              record[size + len] = '\0';
+              size += len + 1;
+            }
+            break;
+
+          default:
+            break;
+        }
+    }
+
+full:
+  hdr.size = size;
+  hdr.fmt  = fmt;
+  memcpy(record, &hdr, sizeof(hdr));
+
+  /* Make room by discarding the oldest records, then save this one */
+
+  flags = irqsave();
+  while (CONFIG_BINLOG_BUFSIZE - g_binlog.bl_count < size)
+    {
+      binlog_drop();
+    }
+
+  binlog_copyin(record, size);
+  irqrestore(flags);
+
+  return size;
+}
+
+/****************************************************************************
+ * Name: binlog_read
+ *
+ * Description:
+ *   Format and remove messages from the binary log.  Only whole messages
+ *   are returned unless a single message does not fit in the buffer.
+ *   Safe to call from interrupt handlers: a record is copied out with
+ *   interrupts disabled, rendered with interrupts enabled and consumed
+ *   only if it was not overwritten in the meantime.
+ *
+ ****************************************************************************/
+
+ssize_t binlog_read(FAR char *buffer, size_t buflen)
+{
+  FAR struct binlog_dev_s *priv = &g_binlog;
+  uint8_t record[CONFIG_BINLOG_MAXRECORD];
+  char line[CONFIG_BINLOG_LINESIZE];
+  struct binlog_hdr_s hdr;
+  irqstate_t flags;
+  uint32_t seq;
+  size_t nread = 0;
+  size_t len;
+
+  while (nread < buflen)
+    {
+      flags = irqsave();
+      if (priv->bl_count == 0)
+        {
+          irqrestore(flags);
+          break;
+        }
+
+      binlog_copyout(priv->bl_tail, &hdr, sizeof(hdr));
+      binlog_copyout(priv->bl_tail, record, hdr.size);
+      seq = priv->bl_seq;
+      irqrestore(flags);
+
+      len = binlog_render(record, line, sizeof(line));
+      if (len > buflen - nread)
+        {
+          /* Leave it for the next read unless it can never fit */
+
+          if (nread > 0)
+            {
+              break;
+            }
+
+          len = buflen;
+        }
+
+      flags = irqsave();
+      if (priv->bl_seq == seq)
+        {
+          binlog_drop();
+          irqrestore(flags);
+
+          memcpy(&buffer[nread], line, len);
+          nread += len;
+        }
+      else
+        {
+          /* Overwritten while rendering, start over with the oldest one */
+
+          irqrestore(flags);
+        }
+    }
+
+  return nread;
+}
+
+/****************************************************************************
+ * Name: binlog_sysloginit
+ *
+ * Description:
+ *   Register the binary log character driver at CONFIG_SYSLOG_DEVPATH.
+ *
+ ****************************************************************************/
+
+int binlog_sysloginit(void)
+{
+  return register_driver(CONFIG_SYSLOG_DEVPATH, &g_binlogfops, 0666,
+                         &g_binlog);
+}
+
+/****************************************************************************
+ * Name: syslog_putc
+ *
+ * Description:
+ *   Single characters are saved as "%c" records.  syslog() and lowsyslog()
+ *   do not come here with CONFIG_BINLOG, see binlog_vprintf().
+ *
+ ****************************************************************************/
+
+int syslog_putc(int ch)
+{
+  (void)binlog_printf("%c", ch);
+  return ch;
+}
+
+#endif /* CONFIG_BINLOG */
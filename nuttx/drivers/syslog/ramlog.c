@@ -41,6 +41,7 @@
 
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 #include <stdio.h>
 #include <stdint.h>
@@ -110,6 +111,10 @@ static ssize_t ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch);
 
 static ssize_t ramlog_read(FAR struct file *, FAR char *, size_t);
 static ssize_t ramlog_write(FAR struct file *, FAR const char *, size_t);
+#ifdef CONFIG_FS_VECTORIO
+static ssize_t ramlog_writev(FAR struct file *filep,
+                             FAR const struct iovec *iov, int iovcnt);
+#endif
 #ifndef CONFIG_DISABLE_POLL
 static int     ramlog_poll(FAR struct file *filep, FAR struct pollfd *fds,
                            bool setup);
@@ -130,6 +135,10 @@ static const struct file_operations g_ramlogfops =
 #ifndef CONFIG_DISABLE_POLL
   , ramlog_poll  /* poll */
 #endif
+#ifdef CONFIG_FS_VECTORIO
+  , 0            /* readv */
+  , ramlog_writev /* writev */
+#endif
 };
 
 /* This is the pre-allocated buffer used for the console RAM log and/or
@@ -411,22 +420,22 @@ errout_without_sem:
 }
 
 /****************************************************************************
- * Name: ramlog_write
+ * Name: ramlog_addbuf
+ *
+ * Description:
+ *   Append a buffer to the RAM log.  Returns the number of bytes of
+ *   'buffer' that were consumed; fewer than 'len' means that the log is
+ *   full and the rest was dropped.
+ *
  ****************************************************************************/
 
-static ssize_t ramlog_write(FAR struct file *filep, FAR const char *buffer, size_t len)
+static size_t ramlog_addbuf(FAR struct ramlog_dev_s *priv,
+                            FAR const char *buffer, size_t len)
 {
-  struct inode *inode = filep->f_inode;
-  struct ramlog_dev_s *priv;
-  ssize_t nwritten;
+  size_t nwritten;
   char ch;
   int ret;
 
-  /* Some sanity checking */
-
-  DEBUGASSERT(inode && inode->i_private);
-  priv = inode->i_private;
-
  /* Loop until all of the bytes have been written.  This function may be
   * called from an interrupt handler!  Semaphores cannot be used!
   *
@@ -481,35 +490,67 @@ static ssize_t ramlog_write(FAR struct file *filep, FAR const char *buffer, size
         }
     }
 
-  /* Was anything written? */
+  return nwritten;
+}
+
+/****************************************************************************
+ * Name: ramlog_notify
+ *
+ * Description:
+ *   Wake up readers and poll/select waiters after data was added.
+ *
+ ****************************************************************************/
 
 #if !defined(CONFIG_RAMLOG_NONBLOCKING) || !defined(CONFIG_DISABLE_POLL)
-  if (nwritten > 0)
-    {
-      irqstate_t flags;
+static void ramlog_notify(FAR struct ramlog_dev_s *priv)
+{
+  irqstate_t flags;
 #ifndef CONFIG_RAMLOG_NONBLOCKING
-      int i;
+  int i;
 #endif
 
-      /* Are there threads waiting for read data? */
+  /* Are there threads waiting for read data? */
 
-      flags = irqsave();
+  flags = irqsave();
 #ifndef CONFIG_RAMLOG_NONBLOCKING
-      for (i = 0; i < priv->rl_nwaiters; i++)
-        {
-          /* Yes.. Notify all of the waiting readers that more data is available */
+  for (i = 0; i < priv->rl_nwaiters; i++)
+    {
+      /* Yes.. Notify all of the waiting readers that more data is available */
 
-          sem_post(&priv->rl_waitsem);
-        }
+      sem_post(&priv->rl_waitsem);
+    }
 #endif
 
-      /* Notify all poll/select waiters that they can write to the FIFO */
+  /* Notify all poll/select waiters that they can write to the FIFO */
 
-      ramlog_pollnotify(priv, POLLIN);
-      irqrestore(flags);
-    }
+  ramlog_pollnotify(priv, POLLIN);
+  irqrestore(flags);
+}
+#else
+#  define ramlog_notify(p)
 #endif
 
+/****************************************************************************
+ * Name: ramlog_write
+ ****************************************************************************/
+
+static ssize_t ramlog_write(FAR struct file *filep, FAR const char *buffer, size_t len)
+{
+  struct inode *inode = filep->f_inode;
+  struct ramlog_dev_s *priv;
+
+  /* Some sanity checking */
+
+  DEBUGASSERT(inode && inode->i_private);
+  priv = inode->i_private;
+
+  /* Was anything written? */
+
+  if (ramlog_addbuf(priv, buffer, len) > 0)
+    {
+      ramlog_notify(priv);
+    }
+
   /* We always have to return the number of bytes requested and NOT the
    * number of bytes that were actually written.  Otherwise, callers
    * will think that this is a short write and probably retry (causing
@@ -518,6 +559,53 @@ static ssize_t ramlog_write(FAR struct file *filep, FAR const char *buffer, size
   return len;
 }
 
+/****************************************************************************
+ * Name: ramlog_writev
+ *
+ * Description:
+ *   Append a whole gather list and then wake up readers once, rather than
+ *   once per buffer.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_VECTORIO
+static ssize_t ramlog_writev(FAR struct file *filep,
+                             FAR const struct iovec *iov, int iovcnt)
+{
+  struct inode *inode = filep->f_inode;
+  struct ramlog_dev_s *priv;
+  size_t nwritten = 0;
+  size_t len = 0;
+  bool full = false;
+  int i;
+
+  DEBUGASSERT(inode && inode->i_private);
+  priv = inode->i_private;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      len += iov[i].iov_len;
+
+      /* Once the log is full, the rest is dropped as in ramlog_write() */
+
+      if (!full)
+        {
+          size_t n = ramlog_addbuf(priv, (FAR const char *)iov[i].iov_base,
+                                   iov[i].iov_len);
+          nwritten += n;
+          full      = (n < iov[i].iov_len);
+        }
+    }
+
+  if (nwritten > 0)
+    {
+      ramlog_notify(priv);
+    }
+
+  return len;
+}
+#endif
+
 /****************************************************************************
  * Name: ramlog_poll
  ****************************************************************************/
@@ -53,6 +53,8 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/wdog.h>
 #include <nuttx/serial/serial.h>
 
 #include <nuttx/usb/usb.h>
@@ -72,6 +74,14 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Milliseconds that a short packet of TX data may be held back, waiting
+ * for more data to send with it.  Zero sends data as soon as it is written.
+ */
+
+#ifndef CONFIG_CDCACM_TXDELAY
+#  define CONFIG_CDCACM_TXDELAY 0
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -97,6 +107,13 @@ struct cdcacm_dev_s
   uint8_t minor;                       /* The device minor number */
   bool    rxenabled;                   /* true: UART RX "interrupts" enabled */
   int16_t rxhead;                      /* Working head; used when rx int disabled */
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+  int16_t txpos;                       /* End of the TX data submitted in place */
+#endif
+#if CONFIG_CDCACM_TXDELAY > 0
+  bool    txflush;                     /* true: Send short packets now */
+  struct wdog_s txwdog;                /* Bounds the delay of a short packet */
+#endif
 
   uint8_t                  ctrlline;   /* Buffered control line state */
   struct cdc_linecoding_s  linecoding; /* Buffered line status */
@@ -114,9 +131,11 @@ struct cdcacm_dev_s
    */
 
   struct cdcacm_req_s wrreqs[CONFIG_CDCACM_NWRREQS];
-  struct cdcacm_req_s rdreqs[CONFIG_CDCACM_NWRREQS];
+  struct cdcacm_req_s rdreqs[CONFIG_CDCACM_NRDREQS];
 
-  /* Serial I/O buffers */
+  /* Serial I/O buffers.  With CONFIG_CDCACM_TXZEROCOPY, the write requests
+   * point into txbuffer, so the USB controller must be able to access it.
+   */
 
   char rxbuffer[CONFIG_CDCACM_RXBUFSIZE];
   char txbuffer[CONFIG_CDCACM_TXBUFSIZE];
@@ -145,8 +164,11 @@ struct cdcacm_alloc_s
 /* Transfer helpers *********************************************************/
 
 static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv,
-                 uint8_t *reqbuf, uint16_t reqlen);
+                 FAR struct usbdev_req_s *req, uint16_t reqlen);
 static int     cdcacm_sndpacket(FAR struct cdcacm_dev_s *priv);
+#if CONFIG_CDCACM_TXDELAY > 0
+static void    cdcacm_txtimeout(int argc, uint32_t arg, ...);
+#endif
 static inline int cdcacm_recvpacket(FAR struct cdcacm_dev_s *priv,
                  uint8_t *reqbuf, uint16_t reqlen);
 
@@ -251,14 +273,46 @@ static const struct uart_ops_s g_uartops =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: cdcacm_txpending
+ *
+ * Description:
+ *   Return the number of bytes in the TX buffer that have not yet been put
+ *   in a write request.
+ *
+ ****************************************************************************/
+
+#if CONFIG_CDCACM_TXDELAY > 0
+static int cdcacm_txpending(FAR struct cdcacm_dev_s *priv)
+{
+  FAR struct uart_buffer_s *xmit = &priv->serdev.xmit;
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+  int count = xmit->head - priv->txpos;
+#else
+  int count = xmit->head - xmit->tail;
+#endif
+
+  if (count < 0)
+    {
+      count += xmit->size;
+    }
+
+  return count;
+}
+#endif
+
 /****************************************************************************
  * Name: cdcacm_fillrequest
  *
  * Description:
- *   If there is data to send it is copied to the given buffer.  Called
+ *   If there is data to send it is copied to the request buffer.  Called
  *   either to initiate the first write operation, or from the completion
  *   interrupt handler service consecutive write operations.
  *
+ *   With CONFIG_CDCACM_TXZEROCOPY, nothing is copied: the request is pointed
+ *   at the data in the TX buffer, up to the end of the buffer.  The data is
+ *   released to the serial driver only when the request completes.
+ *
  * NOTE: The USB serial driver does not use the serial drivers
  *   uart_xmitchars() API.  That logic is essentially duplicated here because
  *   unlike UART hardware, we need to be able to handle writes not byte-by-byte,
@@ -267,11 +321,65 @@ static const struct uart_ops_s g_uartops =
  *
  ****************************************************************************/
 
-static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv, uint8_t *reqbuf,
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv,
+                                   FAR struct usbdev_req_s *req,
+                                   uint16_t reqlen)
+{
+  FAR uart_dev_t *serdev = &priv->serdev;
+  FAR struct uart_buffer_s *xmit = &serdev->xmit;
+  irqstate_t flags;
+  int nbytes;
+
+  flags = irqsave();
+
+  /* Take the contiguous data that follows what is already in flight */
+
+  if (xmit->head >= priv->txpos)
+    {
+      nbytes = xmit->head - priv->txpos;
+    }
+  else
+    {
+      nbytes = xmit->size - priv->txpos;
+    }
+
+  if (nbytes > reqlen)
+    {
+      nbytes = reqlen;
+    }
+
+  if (nbytes > 0)
+    {
+      req->buf     = (FAR uint8_t *)&xmit->buffer[priv->txpos];
+      priv->txpos += nbytes;
+      if (priv->txpos >= xmit->size)
+        {
+          priv->txpos = 0;
+        }
+    }
+
+  /* When all of the characters have been submitted, disable the "TX
+   * interrupt".  Space is given back to the serial driver in
+   * cdcacm_wrcomplete().
+   */
+
+  if (xmit->head == priv->txpos)
+    {
+      uart_disabletxint(serdev);
+    }
+
+  irqrestore(flags);
+  return (uint16_t)nbytes;
+}
+#else
+static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv,
+                                   FAR struct usbdev_req_s *req,
                                    uint16_t reqlen)
 {
   FAR uart_dev_t *serdev = &priv->serdev;
   FAR struct uart_buffer_s *xmit = &serdev->xmit;
+  FAR uint8_t *reqbuf = req->buf;
   irqstate_t flags;
   uint16_t nbytes = 0;
 
@@ -315,6 +423,7 @@ static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv, uint8_t *reqbu
   irqrestore(flags);
   return nbytes;
 }
+#endif
 
 /****************************************************************************
  * Name: cdcacm_sndpacket
@@ -325,6 +434,11 @@ static uint16_t cdcacm_fillrequest(FAR struct cdcacm_dev_s *priv, uint8_t *reqbu
  *   until either (1) there are no further packets available, or (2) there is
  *   no further data to send.
  *
+ *   With CONFIG_CDCACM_TXDELAY, less than a max packet of data is held back
+ *   so that small writes go out together.  While other requests are in
+ *   flight, their completion sends it along with whatever was written
+ *   meanwhile; otherwise a timer sends it after at most the delay.
+ *
  ****************************************************************************/
 
 static int cdcacm_sndpacket(FAR struct cdcacm_dev_s *priv)
@@ -366,6 +480,26 @@ static int cdcacm_sndpacket(FAR struct cdcacm_dev_s *priv)
 
   while (!sq_empty(&priv->reqlist))
     {
+#if CONFIG_CDCACM_TXDELAY > 0
+      /* Hold back a short packet, unless the timer expired or the writer
+       * would have to wait for space anyway.
+       */
+
+      len = cdcacm_txpending(priv);
+      if (len > 0 && len < ep->maxpacket && !priv->txflush &&
+          len < priv->serdev.xmit.size - 1)
+        {
+          if (priv->nwrq >= CONFIG_CDCACM_NWRREQS &&
+              !WDOG_ISACTIVE(&priv->txwdog))
+            {
+              (void)wd_start(&priv->txwdog, MSEC2TICK(CONFIG_CDCACM_TXDELAY),
+                             cdcacm_txtimeout, 1, (uint32_t)priv);
+            }
+
+          break;
+        }
+#endif
+
       /* Peek at the request in the container at the head of the list */
 
       reqcontainer = (FAR struct cdcacm_req_s *)sq_peek(&priv->reqlist);
@@ -373,7 +507,7 @@ static int cdcacm_sndpacket(FAR struct cdcacm_dev_s *priv)
 
       /* Fill the request with serial TX data */
 
-      len = cdcacm_fillrequest(priv, req->buf, reqlen);
+      len = cdcacm_fillrequest(priv, req, reqlen);
       if (len > 0)
         {
           /* Remove the empty container from the request list */
@@ -399,10 +533,36 @@ static int cdcacm_sndpacket(FAR struct cdcacm_dev_s *priv)
         }
     }
 
+#if CONFIG_CDCACM_TXDELAY > 0
+  priv->txflush = false;
+#endif
+
   irqrestore(flags);
   return ret;
 }
 
+/****************************************************************************
+ * Name: cdcacm_txtimeout
+ *
+ * Description:
+ *   Send the TX data that was held back for CONFIG_CDCACM_TXDELAY
+ *   milliseconds.  Called from the timer interrupt.
+ *
+ ****************************************************************************/
+
+#if CONFIG_CDCACM_TXDELAY > 0
+static void cdcacm_txtimeout(int argc, uint32_t arg, ...)
+{
+  FAR struct cdcacm_dev_s *priv = (FAR struct cdcacm_dev_s *)arg;
+
+  if (priv->config != CDCACM_CONFIGIDNONE)
+    {
+      priv->txflush = true;
+      cdcacm_sndpacket(priv);
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: cdcacm_recvpacket
  *
@@ -573,6 +733,12 @@ static void cdcacm_freereq(FAR struct usbdev_ep_s *ep,
 
 static void cdcacm_resetconfig(FAR struct cdcacm_dev_s *priv)
 {
+#if CONFIG_CDCACM_TXDELAY > 0
+  /* Held back TX data has nowhere to go */
+
+  (void)wd_cancel(&priv->txwdog);
+
+#endif
   /* Are we configured? */
 
   if (priv->config != CDCACM_CONFIGIDNONE)
@@ -887,6 +1053,28 @@ static void cdcacm_wrcomplete(FAR struct usbdev_ep_s *ep,
   flags = irqsave();
   sq_addlast((sq_entry_t*)reqcontainer, &priv->reqlist);
   priv->nwrq++;
+
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+  /* The data was sent from the TX buffer in place; now the serial driver
+   * may reuse that space.  After a disconnection, the buffer has already
+   * been emptied.
+   */
+
+  if (req->result != -ESHUTDOWN)
+    {
+      FAR struct uart_buffer_s *xmit = &priv->serdev.xmit;
+
+      xmit->tail += req->len;
+      if (xmit->tail >= xmit->size)
+        {
+          xmit->tail -= xmit->size;
+        }
+
+      uart_datasent(&priv->serdev);
+    }
+
+  req->buf = NULL;
+#endif
   irqrestore(flags);
 
   /* Send the next packet unless this was some unusual termination
@@ -1054,7 +1242,15 @@ static int cdcacm_bind(FAR struct usbdevclass_driver_s *driver,
   for (i = 0; i < CONFIG_CDCACM_NWRREQS; i++)
     {
       reqcontainer      = &priv->wrreqs[i];
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+      /* The requests point into the TX buffer and need no buffer of their
+       * own.
+       */
+
+      reqcontainer->req = EP_ALLOCREQ(priv->epbulkin);
+#else
       reqcontainer->req = cdcacm_allocreq(priv->epbulkin, reqlen);
+#endif
       if (reqcontainer->req == NULL)
         {
           usbtrace(TRACE_CLSERROR(USBSER_TRACEERR_WRALLOCREQ), -ENOMEM);
@@ -1213,6 +1409,9 @@ static void cdcacm_unbind(FAR struct usbdevclass_driver_s *driver,
 
   priv->serdev.xmit.head = 0;
   priv->serdev.xmit.tail = 0;
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+  priv->txpos = 0;
+#endif
 }
 
 /****************************************************************************
@@ -1642,6 +1841,9 @@ static void cdcacm_disconnect(FAR struct usbdevclass_driver_s *driver,
 
   priv->serdev.xmit.head = 0;
   priv->serdev.xmit.tail = 0;
+#ifdef CONFIG_CDCACM_TXZEROCOPY
+  priv->txpos = 0;
+#endif
   priv->rxhead = 0;
   irqrestore(flags);
 
@@ -140,7 +140,7 @@
 #  define DEV1_STRIDBASE      CONFIG_CDCACM_STRBASE
 #  define DEV1_NSTRIDS        CDCACM_NSTRIDS
 #  define DEV1_CFGDESCSIZE    SIZEOF_CDCACM_CFGDESC
-#elif defined(CONFIG_CDCACM_COMPOSITE)
+#elif defined(CONFIG_USBMSC_COMPOSITE)
 #  define DEV1_IS_USBMSC     1
 #  define DEV1_MKCFGDESC      usbmsc_mkcfgdesc
 #  define DEV1_MKSTRDESC      usbmsc_mkstrdesc
@@ -150,7 +150,7 @@
 #  define DEV1_CONFIGID       USBMSC_CONFIGID
 #  define DEV1_FIRSTINTERFACE CONFIG_USBMSC_IFNOBASE
 #  define DEV1_NINTERFACES    USBMSC_NINTERFACES
-#  define DEV1_STRIDBASE      CONFIG_USBMSC_IFNOBASE
+#  define DEV1_STRIDBASE      CONFIG_USBMSC_STRBASE
 #  define DEV1_NSTRIDS        USBMSC_NSTRIDS
 #  define DEV1_CFGDESCSIZE    SIZEOF_USBMSC_CFGDESC
 #else
@@ -174,7 +174,7 @@
 #  define DEV2_STRIDBASE      CONFIG_CDCACM_STRBASE
 #  define DEV2_NSTRIDS        CDCACM_NSTRIDS
 #  define DEV2_CFGDESCSIZE    SIZEOF_CDCACM_CFGDESC
-#elif defined(CONFIG_CDCACM_COMPOSITE) && !defined(DEV1_IS_USBMSC)
+#elif defined(CONFIG_USBMSC_COMPOSITE) && !defined(DEV1_IS_USBMSC)
 #  define DEV2_IS_USBMSC     1
 #  define DEV2_MKCFGDESC      usbmsc_mkcfgdesc
 #  define DEV2_MKSTRDESC      usbmsc_mkstrdesc
@@ -1341,6 +1341,9 @@ int usbmsc_configure(unsigned int nluns, void **handle)
   sem_init(&priv->thsynch, 0, 0);
   sem_init(&priv->thlock, 0, 1);
   sem_init(&priv->thwaitsem, 0, 0);
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  sem_init(&priv->iosem, 0, 0);
+#endif
   sq_init(&priv->wrreqlist);
 
   priv->nluns = nluns;
@@ -1406,6 +1409,7 @@ int usbmsc_bindlun(FAR void *handle, FAR const char *drvrpath,
   FAR struct usbmsc_lun_s *lun;
   FAR struct inode *inode;
   struct geometry geo;
+  uint32_t iosize;
   int ret;
 
 #ifdef CONFIG_DEBUG
@@ -1481,27 +1485,28 @@ int usbmsc_bindlun(FAR void *handle, FAR const char *drvrpath,
 
   memset(lun, 0, sizeof(struct usbmsc_lun_s *));
 
-  /* Allocate an I/O buffer big enough to hold one hardware sector.  SCSI commands
-   * are processed one at a time so all LUNs may share a single I/O buffer.  The
-   * I/O buffer will be allocated so that is it as large as the largest block
-   * device sector size
+  /* Allocate an I/O buffer big enough to hold CONFIG_USBMSC_IOSECTORS hardware
+   * sectors.  SCSI commands are processed one at a time so all LUNs may share a
+   * single I/O buffer.  The I/O buffer will be allocated so that is it as large
+   * as the largest block device sector size allows.
    */
 
+  iosize = (uint32_t)geo.geo_sectorsize * CONFIG_USBMSC_IOSECTORS;
   if (!priv->iobuffer)
     {
-      priv->iobuffer = (uint8_t*)kmm_malloc(geo.geo_sectorsize);
+      priv->iobuffer = (uint8_t*)kmm_malloc(iosize);
       if (!priv->iobuffer)
         {
           usbtrace(TRACE_CLSERROR(USBMSC_TRACEERR_ALLOCIOBUFFER), geo.geo_sectorsize);
           return -ENOMEM;
         }
 
-      priv->iosize = geo.geo_sectorsize;
+      priv->iosize = iosize;
     }
-  else if (priv->iosize < geo.geo_sectorsize)
+  else if (priv->iosize < iosize)
     {
       void *tmp;
-      tmp = (uint8_t*)kmm_realloc(priv->iobuffer, geo.geo_sectorsize);
+      tmp = (uint8_t*)kmm_realloc(priv->iobuffer, iosize);
       if (!tmp)
         {
           usbtrace(TRACE_CLSERROR(USBMSC_TRACEERR_REALLOCIOBUFFER), geo.geo_sectorsize);
@@ -1509,9 +1514,28 @@ int usbmsc_bindlun(FAR void *handle, FAR const char *drvrpath,
         }
 
       priv->iobuffer = (uint8_t*)tmp;
-      priv->iosize   = geo.geo_sectorsize;
+      priv->iosize   = iosize;
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+      /* The second buffer is resized below */
+
+      (void)usbmsc_scsi_iowait(priv);
+      kmm_free(priv->iobuffer2);
+      priv->iobuffer2 = NULL;
+#endif
     }
 
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  /* The second buffer is swapped with the I/O buffer, so it must be the same
+   * size.  Without it, transfers are just not overlapped.
+   */
+
+  if (!priv->iobuffer2)
+    {
+      priv->iobuffer2 = (uint8_t*)kmm_malloc(priv->iosize);
+    }
+#endif
+
   lun->inode       = inode;
   lun->startsector = startsector;
   lun->nsectors    = nsectors;
@@ -1587,6 +1611,7 @@ int usbmsc_unbindlun(FAR void *handle, unsigned int lunno)
    {
       /* Close the block driver */
 
+     (void)usbmsc_scsi_iowait(priv);
      usbmsc_lununinitialize(lun);
      ret = OK;
    }
@@ -1813,6 +1838,7 @@ void usbmsc_uninitialize(FAR void *handle)
 
   /* Uninitialize and release the LUNs */
 
+  (void)usbmsc_scsi_iowait(priv);
   for (i = 0; i < priv->nluns; ++i)
     {
       usbmsc_lununinitialize(&priv->luntab[i]);
@@ -1827,6 +1853,15 @@ void usbmsc_uninitialize(FAR void *handle)
       kmm_free(priv->iobuffer);
     }
 
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  if (priv->iobuffer2)
+    {
+      kmm_free(priv->iobuffer2);
+    }
+
+  sem_destroy(&priv->iosem);
+#endif
+
   /* Uninitialize and release the driver structure */
 
   sem_destroy(&priv->thsynch);
@@ -51,6 +51,7 @@
 #include <semaphore.h>
 
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/blkio.h>
 #include <nuttx/usb/storage.h>
 #include <nuttx/usb/usbdev.h>
 
@@ -96,6 +97,12 @@
 #  define CONFIG_USBMSC_NRDREQS 4
 #endif
 
+/* Number of sectors moved to or from the block driver at a time */
+
+#ifndef CONFIG_USBMSC_IOSECTORS
+#  define CONFIG_USBMSC_IOSECTORS 1
+#endif
+
 /* Logical endpoint numbers / max packet sizes */
 
 #ifndef CONFIG_USBMSC_EPBULKOUT
@@ -491,9 +498,10 @@ struct usbmsc_dev_s
   uint8_t           cbwdir:2;         /* Direction from CBW. See USBMSC_FLAGS_DIR* definitions */
   uint8_t           cdblen;           /* Length of cdb[] from CBW */
   uint8_t           cbwlun;           /* LUN from the CBW */
-  uint16_t          nsectbytes;       /* Bytes buffered in iobuffer[] */
   uint16_t          nreqbytes;        /* Bytes buffered in head write requests */
-  uint16_t          iosize;           /* Size of iobuffer[] */
+  uint32_t          nsectbytes;       /* Read: bytes left in iobuffer[], write: bytes buffered */
+  uint32_t          iolen;            /* Bytes of iobuffer[] used by this block transfer */
+  uint32_t          iosize;           /* Size of iobuffer[] */
   uint32_t          cbwlen;           /* Length of data from CBW */
   uint32_t          cbwtag;           /* Tag from the CBW */
   union
@@ -505,6 +513,17 @@ struct usbmsc_dev_s
   uint32_t          residue;          /* Untransferred amount reported in the CSW */
   uint8_t          *iobuffer;         /* Buffer for data transfers */
 
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  /* Block transfer of the other half of a SCSI read or write, overlapped
+   * with the USB transfer of iobuffer[]
+   */
+
+  uint8_t          *iobuffer2;        /* Second buffer, same size as iobuffer[] */
+  struct blkio_req_s ioreq;           /* Read-ahead into / write-behind from iobuffer2[] */
+  sem_t             iosem;            /* Posted when ioreq completes */
+  bool              iopending;        /* ioreq was submitted, not yet waited for */
+#endif
+
   /* Write request list */
 
   struct sq_queue_s wrreqlist;        /* List of empty write request containers */
@@ -593,6 +612,22 @@ void usbmsc_scsi_lock(FAR struct usbmsc_dev_s *priv);
 
 void usbmsc_scsi_signal(FAR struct usbmsc_dev_s *priv);
 
+/************************************************************************************
+ * Name: usbmsc_scsi_iowait
+ *
+ * Description:
+ *   Wait for any outstanding read-ahead or write-behind to complete, so that its
+ *   buffer and block driver may be released.  Returns the result of the transfer
+ *   (sectors or a negated errno), or OK if nothing was outstanding.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+ssize_t usbmsc_scsi_iowait(FAR struct usbmsc_dev_s *priv);
+#else
+#  define usbmsc_scsi_iowait(priv) (OK)
+#endif
+
 /************************************************************************************
  * Name: usbmsc_synch_signal
  *
@@ -2064,6 +2064,172 @@ static int usbmsc_cmdparsestate(FAR struct usbmsc_dev_s *priv)
   return ret;
 }
 
+/****************************************************************************
+ * Name: usbmsc_iocomplete
+ *
+ * Description:
+ *   Read-ahead or write-behind completion, called on the work queue thread
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+static void usbmsc_iocomplete(FAR struct blkio_req_s *req)
+{
+  FAR struct usbmsc_dev_s *priv = (FAR struct usbmsc_dev_s *)req->br_arg;
+  sem_post(&priv->iosem);
+}
+#endif
+
+/****************************************************************************
+ * Name: usbmsc_readsectors
+ *
+ * Description:
+ *   Read nsectors starting at priv->sector into the I/O buffer, from the
+ *   second buffer if they were read ahead, and then start reading the next
+ *   block transfer of the command into the second buffer.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+static ssize_t usbmsc_readsectors(FAR struct usbmsc_dev_s *priv,
+                                  uint32_t nsectors)
+{
+  FAR struct usbmsc_lun_s *lun = priv->lun;
+  FAR struct blkio_req_s *req = &priv->ioreq;
+  FAR uint8_t *tmp;
+  uint32_t remaining;
+  ssize_t nread;
+
+  if (priv->iopending && !req->br_write && req->br_inode == lun->inode &&
+      req->br_start == priv->sector && req->br_nsectors == nsectors)
+    {
+      /* Take the sectors that were read ahead */
+
+      nread = usbmsc_scsi_iowait(priv);
+
+      tmp             = priv->iobuffer;
+      priv->iobuffer  = priv->iobuffer2;
+      priv->iobuffer2 = tmp;
+    }
+  else
+    {
+      /* Discard any stale read-ahead from a previous command */
+
+      (void)usbmsc_scsi_iowait(priv);
+      nread = USBMSC_DRVR_READ(lun, priv->iobuffer, priv->sector, nsectors);
+    }
+
+  remaining = priv->u.xfrlen - nsectors;
+  if (nread >= 0 && remaining > 0 && priv->iobuffer2)
+    {
+      req->br_inode    = lun->inode;
+      req->br_buffer   = priv->iobuffer2;
+      req->br_start    = priv->sector + nsectors;
+      req->br_nsectors = MIN(remaining, priv->iosize / lun->sectorsize);
+      req->br_write    = false;
+      req->br_callback = usbmsc_iocomplete;
+      req->br_arg      = priv;
+
+      priv->iopending  = (blkio_submit(req) == OK);
+    }
+
+  return nread;
+}
+#else
+#  define usbmsc_readsectors(priv,n) \
+     USBMSC_DRVR_READ((priv)->lun, (priv)->iobuffer, (priv)->sector, n)
+#endif
+
+/****************************************************************************
+ * Name: usbmsc_writedone
+ *
+ * Description:
+ *   Wait for the write-behind, if any, and report a failure in the sense
+ *   data.  The residue was already reduced when the write was started, so
+ *   it is given back.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+static ssize_t usbmsc_writedone(FAR struct usbmsc_dev_s *priv)
+{
+  FAR struct usbmsc_lun_s *lun = priv->lun;
+  FAR struct blkio_req_s *req = &priv->ioreq;
+  ssize_t nwritten;
+
+  nwritten = usbmsc_scsi_iowait(priv);
+  if (nwritten < 0)
+    {
+      lun->sd        = SCSI_KCQME_WRITEFAULTAUTOREALLOCFAILED;
+      lun->sdinfo    = req->br_start;
+      priv->residue += req->br_nsectors * lun->sectorsize;
+    }
+
+  return nwritten;
+}
+#endif
+
+/****************************************************************************
+ * Name: usbmsc_writesectors
+ *
+ * Description:
+ *   Write nsectors from the I/O buffer to priv->sector.  With double
+ *   buffering, the write is started in the background and the I/O buffer
+ *   is swapped with the free second buffer so that the next block transfer
+ *   can be received while this one is written.  Sets the sense data on
+ *   failure, which may be from the previous write.
+ *
+ ****************************************************************************/
+
+static ssize_t usbmsc_writesectors(FAR struct usbmsc_dev_s *priv,
+                                   uint32_t nsectors)
+{
+  FAR struct usbmsc_lun_s *lun = priv->lun;
+  ssize_t nwritten;
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  FAR struct blkio_req_s *req = &priv->ioreq;
+  FAR uint8_t *tmp;
+
+  /* The previous write must finish before its buffer can be reused */
+
+  nwritten = usbmsc_writedone(priv);
+  if (nwritten < 0)
+    {
+      return nwritten;
+    }
+
+  if (priv->iobuffer2)
+    {
+      req->br_inode    = lun->inode;
+      req->br_buffer   = priv->iobuffer;
+      req->br_start    = priv->sector;
+      req->br_nsectors = nsectors;
+      req->br_write    = true;
+      req->br_callback = usbmsc_iocomplete;
+      req->br_arg      = priv;
+
+      if (blkio_submit(req) == OK)
+        {
+          priv->iopending = true;
+
+          tmp             = priv->iobuffer;
+          priv->iobuffer  = priv->iobuffer2;
+          priv->iobuffer2 = tmp;
+          return nsectors;
+        }
+    }
+#endif
+
+  nwritten = USBMSC_DRVR_WRITE(lun, priv->iobuffer, priv->sector, nsectors);
+  if (nwritten < 0)
+    {
+      lun->sd     = SCSI_KCQME_WRITEFAULTAUTOREALLOCFAILED;
+      lun->sdinfo = priv->sector;
+    }
+
+  return nwritten;
+}
+
 /****************************************************************************
  * Name: usbmsc_cmdreadstate
  *
@@ -2083,7 +2249,7 @@ static int usbmsc_cmdparsestate(FAR struct usbmsc_dev_s *priv)
  * State variables:
  *   xfrlen     - holds the number of sectors read to be read.
  *   sector     - holds the sector number of the next sector to be read
- *   nsectbytes - holds the number of bytes buffered for the current sector
+ *   nsectbytes - holds the number of bytes buffered for the current transfer
  *   nreqbytes  - holds the number of bytes currently buffered in the request
  *                at the head of the wrreqlist.
  *
@@ -2095,6 +2261,7 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
   FAR struct usbmsc_req_s *privreq;
   FAR struct usbdev_req_s *req;
   irqstate_t flags;
+  uint32_t nsectors;
   ssize_t nread;
   uint8_t *src;
   uint8_t *dest;
@@ -2114,9 +2281,10 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
 
       if (priv->nsectbytes <= 0)
         {
-          /* Yes.. read the next sector */
+          /* Yes.. read the next sectors, as many as fit in the buffer */
 
-          nread = USBMSC_DRVR_READ(lun, priv->iobuffer, priv->sector, 1);
+          nsectors = MIN(priv->u.xfrlen, priv->iosize / lun->sectorsize);
+          nread    = usbmsc_readsectors(priv, nsectors);
           if (nread < 0)
             {
               usbtrace(TRACE_CLSERROR(USBMSC_TRACEERR_CMDREADREADFAIL), -nread);
@@ -2125,9 +2293,10 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
               break;
             }
 
-          priv->nsectbytes = lun->sectorsize;
-          priv->u.xfrlen--;
-          priv->sector++;
+          priv->iolen       = nsectors * lun->sectorsize;
+          priv->nsectbytes  = priv->iolen;
+          priv->u.xfrlen   -= nsectors;
+          priv->sector     += nsectors;
         }
 
       /* Check if there is a request in the wrreqlist that we will be able to
@@ -2155,7 +2324,7 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
        * all of the data available in the sector buffer.
        */
 
-      src    = &priv->iobuffer[lun->sectorsize - priv->nsectbytes];
+      src    = &priv->iobuffer[priv->iolen - priv->nsectbytes];
       dest   = &req->buf[priv->nreqbytes];
 
       nbytes = MIN(CONFIG_USBMSC_BULKINREQLEN - priv->nreqbytes, priv->nsectbytes);
@@ -2206,6 +2375,10 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
         }
     }
 
+  /* A read-ahead is still outstanding if the command ended early */
+
+  (void)usbmsc_scsi_iowait(priv);
+
   usbtrace(TRACE_CLASSSTATE(USBMSC_CLASSSTATE_CMDREADCMDFINISH), priv->u.xfrlen);
   priv->thstate  = USBMSC_STATE_CMDFINISH;
   return OK;
@@ -2230,7 +2403,7 @@ static int usbmsc_cmdreadstate(FAR struct usbmsc_dev_s *priv)
  * State variables:
  *   xfrlen     - holds the number of sectors read to be written.
  *   sector     - holds the sector number of the next sector to write
- *   nsectbytes - holds the number of bytes buffered for the current sector
+ *   nsectbytes - holds the number of bytes buffered for the current transfer
  *   nreqbytes  - holds the number of untransferred bytes currently in the
  *                request at the head of the rdreqlist.
  *
@@ -2241,6 +2414,7 @@ static int usbmsc_cmdwritestate(FAR struct usbmsc_dev_s *priv)
   FAR struct usbmsc_lun_s *lun = priv->lun;
   FAR struct usbmsc_req_s *privreq;
   FAR struct usbdev_req_s *req;
+  uint32_t nsectors;
   ssize_t nwritten;
   uint16_t xfrd;
   uint8_t *src;
@@ -2248,6 +2422,15 @@ static int usbmsc_cmdwritestate(FAR struct usbmsc_dev_s *priv)
   int nbytes;
   int ret;
 
+  /* A read-ahead left over from an aborted read could become stale */
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  if (!priv->ioreq.br_write)
+    {
+      (void)usbmsc_scsi_iowait(priv);
+    }
+#endif
+
   /* Loop transferring data until either (1) all of the data has been
    * transferred, or (2) we have written all of the data in the available
    * read requests.
@@ -2286,12 +2469,22 @@ static int usbmsc_cmdwritestate(FAR struct usbmsc_dev_s *priv)
 
       while (priv->nreqbytes > 0 && priv->u.xfrlen > 0)
         {
+          /* Starting to fill the I/O buffer?  Then decide how many sectors
+           * will go to the block driver in one transfer.
+           */
+
+          if (priv->nsectbytes == 0)
+            {
+              nsectors    = MIN(priv->u.xfrlen, priv->iosize / lun->sectorsize);
+              priv->iolen = nsectors * lun->sectorsize;
+            }
+
           /* Copy the data received in the read request into the sector I/O buffer */
 
           src  = &req->buf[xfrd - priv->nreqbytes];
           dest = &priv->iobuffer[priv->nsectbytes];
 
-          nbytes = MIN(lun->sectorsize - priv->nsectbytes, priv->nreqbytes);
+          nbytes = MIN(priv->iolen - priv->nsectbytes, priv->nreqbytes);
 
           /* Copy the data from the sector buffer to the USB request and update counts */
 
@@ -2301,23 +2494,22 @@ static int usbmsc_cmdwritestate(FAR struct usbmsc_dev_s *priv)
 
           /* Is the I/O buffer full? */
 
-          if (priv->nsectbytes >= lun->sectorsize)
+          if (priv->nsectbytes >= priv->iolen)
             {
-              /* Yes.. Write the next sector */
+              /* Yes.. Write the buffered sectors */
 
-              nwritten = USBMSC_DRVR_WRITE(lun, priv->iobuffer, priv->sector, 1);
+              nsectors = priv->iolen / lun->sectorsize;
+              nwritten = usbmsc_writesectors(priv, nsectors);
               if (nwritten < 0)
                 {
                   usbtrace(TRACE_CLSERROR(USBMSC_TRACEERR_CMDWRITEWRITEFAIL), -nwritten);
-                  lun->sd     = SCSI_KCQME_WRITEFAULTAUTOREALLOCFAILED;
-                  lun->sdinfo = priv->sector;
                   goto errout;
                 }
 
-              priv->nsectbytes = 0;
-              priv->residue   -= lun->sectorsize;
-              priv->u.xfrlen--;
-              priv->sector++;
+              priv->nsectbytes  = 0;
+              priv->residue    -= priv->iolen;
+              priv->u.xfrlen   -= nsectors;
+              priv->sector     += nsectors;
             }
         }
 
@@ -2346,6 +2538,12 @@ static int usbmsc_cmdwritestate(FAR struct usbmsc_dev_s *priv)
     }
 
 errout:
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+  /* The status may not be sent until the last write is on the media */
+
+  (void)usbmsc_writedone(priv);
+#endif
+
   usbtrace(TRACE_CLASSSTATE(USBMSC_CLASSSTATE_CMDWRITECMDFINISH), priv->u.xfrlen);
   priv->thstate  = USBMSC_STATE_CMDFINISH;
   return OK;
@@ -2819,6 +3017,34 @@ void usbmsc_scsi_signal(FAR struct usbmsc_dev_s *priv)
   irqrestore(flags);
 }
 
+/****************************************************************************
+ * Name: usbmsc_scsi_iowait
+ *
+ * Description:
+ *   Wait for any outstanding read-ahead or write-behind to complete, so
+ *   that its buffer and block driver may be released.  Returns the result
+ *   of the transfer, or OK if none was outstanding.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_USBMSC_DOUBLEBUFFER
+ssize_t usbmsc_scsi_iowait(FAR struct usbmsc_dev_s *priv)
+{
+  if (!priv->iopending)
+    {
+      return OK;
+    }
+
+  while (sem_wait(&priv->iosem) != 0)
+    {
+      DEBUGASSERT(get_errno() == EINTR);
+    }
+
+  priv->iopending = false;
+  return priv->ioreq.br_result;
+}
+#endif
+
 /****************************************************************************
  * Name: usbmsc_scsi_lock
  *
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/blkio.h>
+#include <nuttx/wqueue.h>
+
+#include <arch/irq.h>
+
+#include "fs_internal.h"
+
+#ifdef CONFIG_FS_BLKIO
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: blkio_worker
+ *
+ * Description:
+ *   Perform one request on the work queue thread
+ *
+ ****************************************************************************/
+
+static void blkio_worker(FAR void *arg)
+{
+  FAR struct blkio_req_s *req = (FAR struct blkio_req_s *)arg;
+  FAR const struct block_operations *ops = req->br_inode->u.i_bops;
+
+  if (req->br_write)
+    {
+      req->br_result = ops->write(req->br_inode, req->br_buffer,
+                                  req->br_start, req->br_nsectors);
+    }
+  else
+    {
+      req->br_result = ops->read(req->br_inode, req->br_buffer,
+                                 req->br_start, req->br_nsectors);
+    }
+
+  req->br_callback(req);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: blkio_submit
+ ****************************************************************************/
+
+int blkio_submit(FAR struct blkio_req_s *req)
+{
+  FAR struct inode *inode;
+
+  DEBUGASSERT(req && req->br_callback);
+
+  inode = req->br_inode;
+  if (!inode || !INODE_IS_BLOCK(inode) || !inode->u.i_bops)
+    {
+      return -ENODEV;
+    }
+
+  if ((req->br_write && !inode->u.i_bops->write) ||
+      (!req->br_write && !inode->u.i_bops->read))
+    {
+      return -EACCES;
+    }
+
+  return work_queue(LPWORK, &req->br_work, blkio_worker, req, 0);
+}
+
+/****************************************************************************
+ * Name: blkio_cancel
+ ****************************************************************************/
+
+int blkio_cancel(FAR struct blkio_req_s *req)
+{
+  irqstate_t flags;
+  int ret = -EBUSY;
+
+  /* The work queue clears 'worker' when it dequeues the work */
+
+  flags = irqsave();
+  if (req->br_work.worker != NULL)
+    {
+      ret = work_cancel(LPWORK, &req->br_work);
+    }
+
+  irqrestore(flags);
+  return ret;
+}
+
+#endif /* CONFIG_FS_BLKIO */
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/epoll.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <semaphore.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+
+#include <arch/irq.h>
+
+#include "fs_internal.h"
+
+#if CONFIG_NFILE_DESCRIPTORS > 0 && !defined(CONFIG_DISABLE_POLL)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Errors and hang-ups are always reported, as with poll() */
+
+#define EPOLL_ALWAYS   (POLLERR | POLLHUP)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One descriptor of the interest list.  The pollfd is handed to the
+ * driver's poll method, which keeps a pointer to it, so entries never move:
+ * a free entry has ee_pfd.fd < 0.
+ */
+
+struct epoll_entry_s
+{
+  struct pollfd ee_pfd;     /* Registered with the driver while armed */
+  epoll_data_t  ee_data;    /* Returned with the events */
+  uint32_t      ee_flags;   /* EPOLLET and EPOLLONESHOT */
+  bool          ee_armed;   /* ee_pfd is set up with the driver */
+};
+
+struct epoll_head_s
+{
+  sem_t         eh_exclsem; /* Serializes epoll_ctl and the event scan */
+  sem_t         eh_sem;     /* Posted by drivers when an event occurs */
+  int           eh_size;    /* Number of entries in eh_ent[] */
+  struct epoll_entry_s eh_ent[1];
+};
+
+#define SIZEOF_EPOLL_HEAD(n) \
+  (sizeof(struct epoll_head_s) + ((n) - 1) * sizeof(struct epoll_entry_s))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: epoll_semtake
+ ****************************************************************************/
+
+static void epoll_semtake(FAR sem_t *sem)
+{
+  while (sem_wait(sem) != 0)
+    {
+      ASSERT(get_errno() == EINTR);
+    }
+}
+
+/****************************************************************************
+ * Name: epoll_find
+ ****************************************************************************/
+
+static FAR struct epoll_entry_s *epoll_find(FAR struct epoll_head_s *eph,
+                                            int fd)
+{
+  int i;
+
+  for (i = 0; i < eph->eh_size; i++)
+    {
+      if (eph->eh_ent[i].ee_pfd.fd == fd)
+        {
+          return &eph->eh_ent[i];
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: epoll_arm and epoll_disarm
+ *
+ * Description:
+ *   Register the entry with (or unregister it from) the driver's poll
+ *   method.  epoll_arm() returns OK or a negated errno value.
+ *
+ ****************************************************************************/
+
+static int epoll_arm(FAR struct epoll_head_s *eph,
+                     FAR struct epoll_entry_s *ent)
+{
+  int ret;
+
+  ent->ee_pfd.sem     = &eph->eh_sem;
+  ent->ee_pfd.revents = 0;
+  ent->ee_pfd.priv    = NULL;
+
+  ret = poll_fdsetup(ent->ee_pfd.fd, &ent->ee_pfd, true);
+  ent->ee_armed = (ret >= 0);
+  return ret < 0 ? ret : OK;
+}
+
+static void epoll_disarm(FAR struct epoll_entry_s *ent)
+{
+  if (ent->ee_armed)
+    {
+      (void)poll_fdsetup(ent->ee_pfd.fd, &ent->ee_pfd, false);
+      ent->ee_armed = false;
+    }
+}
+
+/****************************************************************************
+ * Name: epoll_collect
+ *
+ * Description:
+ *   Return the pending events of up to 'maxevents' descriptors and re-arm
+ *   them.  Re-arming a level-triggered descriptor tears down and sets up
+ *   its poll again, so that a driver that is still ready reports it again
+ *   on the next wait.  Only descriptors with events are touched.
+ *
+ ****************************************************************************/
+
+static int epoll_collect(FAR struct epoll_head_s *eph,
+                         FAR struct epoll_event *evs, int maxevents)
+{
+  FAR struct epoll_entry_s *ent;
+  irqstate_t flags;
+  pollevent_t revents;
+  int count = 0;
+  int i;
+
+  for (i = 0; i < eph->eh_size && count < maxevents; i++)
+    {
+      ent = &eph->eh_ent[i];
+      if (ent->ee_pfd.fd < 0 || !ent->ee_armed)
+        {
+          continue;
+        }
+
+      /* Drivers may set revents from interrupt handlers */
+
+      flags = irqsave();
+      revents = ent->ee_pfd.revents;
+      ent->ee_pfd.revents = 0;
+      irqrestore(flags);
+
+      if (revents == 0)
+        {
+          continue;
+        }
+
+      evs[count].events = revents;
+      evs[count].data   = ent->ee_data;
+      count++;
+
+      if ((ent->ee_flags & EPOLLONESHOT) != 0)
+        {
+          epoll_disarm(ent);
+        }
+      else if ((ent->ee_flags & EPOLLET) == 0)
+        {
+          /* If this fails, the descriptor stays disarmed until the next
+           * EPOLL_CTL_MOD.
+           */
+
+          epoll_disarm(ent);
+          (void)epoll_arm(eph, ent);
+        }
+    }
+
+  return count;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: epoll_create
+ ****************************************************************************/
+
+int epoll_create(int size)
+{
+  FAR struct epoll_head_s *eph;
+  int i;
+
+  if (size <= 0)
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  eph = (FAR struct epoll_head_s *)kmm_zalloc(SIZEOF_EPOLL_HEAD(size));
+  if (!eph)
+    {
+      set_errno(ENOMEM);
+      return ERROR;
+    }
+
+  sem_init(&eph->eh_exclsem, 0, 1);
+  sem_init(&eph->eh_sem, 0, 0);
+  eph->eh_size = size;
+
+  for (i = 0; i < size; i++)
+    {
+      eph->eh_ent[i].ee_pfd.fd = -1;
+    }
+
+  return (int)(uintptr_t)eph;
+}
+
+/****************************************************************************
+ * Name: epoll_close
+ ****************************************************************************/
+
+void epoll_close(int epfd)
+{
+  FAR struct epoll_head_s *eph = (FAR struct epoll_head_s *)(uintptr_t)epfd;
+  int i;
+
+  DEBUGASSERT(eph);
+
+  for (i = 0; i < eph->eh_size; i++)
+    {
+      if (eph->eh_ent[i].ee_pfd.fd >= 0)
+        {
+          epoll_disarm(&eph->eh_ent[i]);
+        }
+    }
+
+  sem_destroy(&eph->eh_sem);
+  sem_destroy(&eph->eh_exclsem);
+  kmm_free(eph);
+}
+
+/****************************************************************************
+ * Name: epoll_ctl
+ ****************************************************************************/
+
+int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
+{
+  FAR struct epoll_head_s *eph = (FAR struct epoll_head_s *)(uintptr_t)epfd;
+  FAR struct epoll_entry_s *ent;
+  int ret = OK;
+
+  DEBUGASSERT(eph);
+
+  if (fd < 0 || (op != EPOLL_CTL_DEL && !ev))
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  epoll_semtake(&eph->eh_exclsem);
+  ent = epoll_find(eph, fd);
+
+  switch (op)
+    {
+      case EPOLL_CTL_ADD:
+        if (ent)
+          {
+            ret = -EEXIST;
+            break;
+          }
+
+        ent = epoll_find(eph, -1);
+        if (!ent)
+          {
+            ret = -ENOSPC;
+            break;
+          }
+
+        ent->ee_pfd.fd     = fd;
+        ent->ee_pfd.events = (pollevent_t)ev->events | EPOLL_ALWAYS;
+        ent->ee_data       = ev->data;
+        ent->ee_flags      = ev->events & (EPOLLET | EPOLLONESHOT);
+
+        ret = epoll_arm(eph, ent);
+        if (ret < 0)
+          {
+            ent->ee_pfd.fd = -1;
+          }
+        break;
+
+      case EPOLL_CTL_MOD:
+        if (!ent)
+          {
+            ret = -ENOENT;
+            break;
+          }
+
+        epoll_disarm(ent);
+        ent->ee_pfd.events = (pollevent_t)ev->events | EPOLL_ALWAYS;
+        ent->ee_data       = ev->data;
+        ent->ee_flags      = ev->events & (EPOLLET | EPOLLONESHOT);
+
+        ret = epoll_arm(eph, ent);
+        break;
+
+      case EPOLL_CTL_DEL:
+        if (!ent)
+          {
+            ret = -ENOENT;
+            break;
+          }
+
+        epoll_disarm(ent);
+        ent->ee_pfd.fd = -1;
+        break;
+
+      default:
+        ret = -EINVAL;
+        break;
+    }
+
+  sem_post(&eph->eh_exclsem);
+
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: epoll_wait
+ ****************************************************************************/
+
+int epoll_wait(int epfd, FAR struct epoll_event *evs, int maxevents,
+               int timeout)
+{
+  FAR struct epoll_head_s *eph = (FAR struct epoll_head_s *)(uintptr_t)epfd;
+  struct timespec abstime;
+  irqstate_t flags;
+  int count;
+  int ret;
+
+  DEBUGASSERT(eph);
+
+  if (!evs || maxevents <= 0)
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  if (timeout > 0)
+    {
+      time_t   sec  = timeout / MSEC_PER_SEC;
+      uint32_t nsec = (timeout - MSEC_PER_SEC * sec) * NSEC_PER_MSEC;
+
+      (void)clock_gettime(CLOCK_REALTIME, &abstime);
+
+      abstime.tv_sec  += sec;
+      abstime.tv_nsec += nsec;
+      if (abstime.tv_nsec >= NSEC_PER_SEC)
+        {
+          abstime.tv_sec++;
+          abstime.tv_nsec -= NSEC_PER_SEC;
+        }
+    }
+
+  for (;;)
+    {
+      /* Look for events first:  events may be left over from a previous
+       * call that returned maxevents, with eh_sem already taken.  Stale
+       * counts on eh_sem just cause another pass.
+       */
+
+      epoll_semtake(&eph->eh_exclsem);
+      count = epoll_collect(eph, evs, maxevents);
+      sem_post(&eph->eh_exclsem);
+
+      if (count > 0 || timeout == 0)
+        {
+          return count;
+        }
+
+      if (timeout > 0)
+        {
+          flags = irqsave();
+          ret = sem_timedwait(&eph->eh_sem, &abstime);
+          irqrestore(flags);
+        }
+      else
+        {
+          ret = sem_wait(&eph->eh_sem);
+        }
+
+      if (ret < 0)
+        {
+          if (get_errno() != ETIMEDOUT)
+            {
+              return ERROR;
+            }
+
+          /* Timed out:  one last look */
+
+          timeout = 0;
+        }
+    }
+}
+
+#endif /* CONFIG_NFILE_DESCRIPTORS > 0 && !CONFIG_DISABLE_POLL */
@@ -76,8 +76,8 @@ static inline int file_vfcntl(int fd, int cmd, va_list ap)
 
   /* Was this file opened ? */
 
-  filep = &list->fl_files[fd];
-  if (!filep->f_inode)
+  filep = files_fdfile(list, fd);
+  if (!filep || !filep->f_inode)
     {
       err = EBADF;
       goto errout;
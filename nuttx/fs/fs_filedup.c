@@ -53,10 +53,6 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define DUP_ISOPEN(fd, list) \
-  ((unsigned int)fd < CONFIG_NFILE_DESCRIPTORS && \
-   list->fl_files[fd].f_inode != NULL)
-
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -80,6 +76,7 @@
 int file_dup(int fd, int minfd)
 {
   FAR struct filelist *list;
+  FAR struct file *filep;
   int fd2;
 
   /* Get the thread-specific file list */
@@ -89,7 +86,8 @@ int file_dup(int fd, int minfd)
 
   /* Verify that fd is a valid, open file descriptor */
 
-  if (!DUP_ISOPEN(fd, list))
+  filep = files_fdfile(list, fd);
+  if (!filep || !filep->f_inode)
     {
       set_errno(EBADF);
       return ERROR;
@@ -97,18 +95,16 @@ int file_dup(int fd, int minfd)
 
   /* Increment the reference count on the contained inode */
 
-  inode_addref(list->fl_files[fd].f_inode);
+  inode_addref(filep->f_inode);
 
   /* Then allocate a new file descriptor for the inode */
 
-  fd2 = files_allocate(list->fl_files[fd].f_inode,
-                       list->fl_files[fd].f_oflags,
-                       list->fl_files[fd].f_pos,
+  fd2 = files_allocate(filep->f_inode, filep->f_oflags, filep->f_pos,
                        minfd);
   if (fd2 < 0)
     {
       set_errno(EMFILE);
-      inode_release(list->fl_files[fd].f_inode);
+      inode_release(filep->f_inode);
       return ERROR;
     }
 
@@ -51,10 +51,6 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define DUP_ISOPEN(fd, list) \
-  ((unsigned int)fd < CONFIG_NFILE_DESCRIPTORS && \
-   list->fl_files[fd].f_inode != NULL)
-
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -81,6 +77,7 @@ int dup2(int fd1, int fd2)
 #endif
 {
   FAR struct filelist *list;
+  FAR struct file *filep1;
 
   /* Get the thread-specific file list */
 
@@ -93,7 +90,8 @@ int dup2(int fd1, int fd2)
 
   /* Verify that fd is a valid, open file descriptor */
 
-  if (!DUP_ISOPEN(fd1, list))
+  filep1 = files_fdfile(list, fd1);
+  if (!filep1 || !filep1->f_inode)
     {
       set_errno(EBADF);
       return ERROR;
@@ -114,7 +112,7 @@ int dup2(int fd1, int fd2)
       return ERROR;
     }
 
-  return files_dup(&list->fl_files[fd1], &list->fl_files[fd2]);
+  return files_dup(filep1, list, fd2);
 }
 
 #endif /* CONFIG_NFILE_DESCRIPTORS > 0 */
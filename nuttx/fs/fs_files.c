@@ -55,6 +55,18 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Keep the bitmap of the descriptors in use up to date */
+
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+#  define _files_setinuse(list, fd) \
+     ((list)->fl_inuse[(fd) >> 5] |= (uint32_t)1 << ((fd) & 31))
+#  define _files_clrinuse(list, fd) \
+     ((list)->fl_inuse[(fd) >> 5] &= ~((uint32_t)1 << ((fd) & 31)))
+#else
+#  define _files_setinuse(list, fd)
+#  define _files_clrinuse(list, fd)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -95,6 +107,97 @@ static void _files_semtake(FAR struct filelist *list)
 
 #define _files_semgive(list) sem_post(&list->fl_sem)
 
+/****************************************************************************
+ * Name: _files_getfile
+ *
+ * Description:
+ *   Return the file structure of 'fd', allocating its block if no other
+ *   descriptor of the block was used before.
+ *
+ * Assumuptions:
+ *   Caller holds the list semaphore.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+static FAR struct file *_files_getfile(FAR struct filelist *list, int fd)
+{
+  FAR struct file *block;
+  int ndx;
+
+  if ((unsigned int)fd >= CONFIG_NFILE_DESCRIPTORS)
+    {
+      return NULL;
+    }
+
+  ndx   = fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK;
+  block = list->fl_blocks[ndx];
+  if (!block)
+    {
+      /* The block is cleared before it is published: readers look the
+       * files up without the semaphore.
+       */
+
+      block = (FAR struct file *)
+        kmm_zalloc(CONFIG_NFILE_DESCRIPTORS_PER_BLOCK * sizeof(struct file));
+      if (!block)
+        {
+          return NULL;
+        }
+
+      list->fl_blocks[ndx] = block;
+    }
+
+  return &block[fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+}
+#else
+#  define _files_getfile(list, fd) files_fdfile(list, fd)
+#endif
+
+/****************************************************************************
+ * Name: _files_findfree
+ *
+ * Description:
+ *   Return the lowest descriptor not in use greater than or equal to
+ *   'minfd', or ERROR if there is none.
+ *
+ * Assumuptions:
+ *   Caller holds the list semaphore.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+static int _files_findfree(FAR struct filelist *list, int minfd)
+{
+  uint32_t bits;
+  int word;
+  int fd;
+
+  if ((unsigned int)minfd >= CONFIG_NFILE_DESCRIPTORS)
+    {
+      return ERROR;
+    }
+
+  word = minfd >> 5;
+  bits = ~list->fl_inuse[word] & (0xffffffff << (minfd & 31));
+
+  while (bits == 0)
+    {
+      if (++word >= FILELIST_NWORDS)
+        {
+          return ERROR;
+        }
+
+      bits = ~list->fl_inuse[word];
+    }
+
+  /* The bits past the last descriptor are never set */
+
+  fd = (word << 5) + __builtin_ctz(bits);
+  return fd < CONFIG_NFILE_DESCRIPTORS ? fd : ERROR;
+}
+#endif
+
 /****************************************************************************
  * Name: _files_close
  *
@@ -180,6 +283,10 @@ void files_initlist(FAR struct filelist *list)
 
 void files_releaselist(FAR struct filelist *list)
 {
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+  FAR struct file *block;
+  int j;
+#endif
   int i;
 
   DEBUGASSERT(list);
@@ -189,10 +296,29 @@ void files_releaselist(FAR struct filelist *list)
    * there should not be any references in this context.
    */
 
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+  for (i = 0; i < FILELIST_NBLOCKS; i++)
+    {
+      block = list->fl_blocks[i];
+      if (block)
+        {
+          for (j = 0; j < CONFIG_NFILE_DESCRIPTORS_PER_BLOCK; j++)
+            {
+              (void)_files_close(&block[j]);
+            }
+
+          list->fl_blocks[i] = NULL;
+          kmm_free(block);
+        }
+    }
+
+  memset(list->fl_inuse, 0, sizeof(list->fl_inuse));
+#else
   for (i = 0; i < CONFIG_NFILE_DESCRIPTORS; i++)
     {
       (void)_files_close(&list->fl_files[i]);
     }
+#endif
 
   /* Destroy the semaphore */
 
@@ -203,29 +329,33 @@ void files_releaselist(FAR struct filelist *list)
  * Name: files_dup
  *
  * Description:
- *   Assign an inode to a specific files structure.  This is the heart of
- *   dup2.
+ *   Assign the inode of filep1 to the file descriptor fd2 of a list.  This
+ *   is the heart of dup2.
  *
  ****************************************************************************/
 
-int files_dup(FAR struct file *filep1, FAR struct file *filep2)
+int files_dup(FAR struct file *filep1, FAR struct filelist *list, int fd2)
 {
-  FAR struct filelist *list;
+  FAR struct file *filep2;
   FAR struct inode *inode;
   int err;
   int ret;
 
-  if (!filep1 || !filep1->f_inode || !filep2)
+  if (!filep1 || !filep1->f_inode || !list)
     {
       err = EBADF;
       goto errout;
     }
 
-  list = sched_getfiles();
-  DEBUGASSERT(list);
-
   _files_semtake(list);
 
+  filep2 = _files_getfile(list, fd2);
+  if (!filep2)
+    {
+      err = (unsigned int)fd2 < CONFIG_NFILE_DESCRIPTORS ? ENOMEM : EBADF;
+      goto errout_with_sem;
+    }
+
   /* If there is already an inode contained in the new file structure,
    * close the file and release the inode.
    */
@@ -278,6 +408,7 @@ int files_dup(FAR struct file *filep1, FAR struct file *filep2)
         }
     }
 
+  _files_setinuse(list, fd2);
   _files_semgive(list);
   return OK;
 
@@ -290,7 +421,10 @@ errout_with_inode:
   filep2->f_inode  = NULL;
 
 errout_with_ret:
+  _files_clrinuse(list, fd2);
   err              = -ret;
+
+errout_with_sem:
   _files_semgive(list);
 
 errout:
@@ -310,12 +444,34 @@ errout:
 int files_allocate(FAR struct inode *inode, int oflags, off_t pos, int minfd)
 {
   FAR struct filelist *list;
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+  FAR struct file *filep;
+#endif
   int i;
 
   list = sched_getfiles();
   DEBUGASSERT(list);
 
   _files_semtake(list);
+
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+  /* The bitmap gives the first free descriptor, whose block may have to be
+   * allocated.
+   */
+
+  i = _files_findfree(list, minfd);
+  filep = i >= 0 ? _files_getfile(list, i) : NULL;
+  if (filep)
+    {
+      filep->f_oflags = oflags;
+      filep->f_pos    = pos;
+      filep->f_inode  = inode;
+      filep->f_priv   = NULL;
+      _files_setinuse(list, i);
+      _files_semgive(list);
+      return i;
+    }
+#else
   for (i = minfd; i < CONFIG_NFILE_DESCRIPTORS; i++)
     {
       if (!list->fl_files[i].f_inode)
@@ -328,6 +484,7 @@ int files_allocate(FAR struct inode *inode, int oflags, off_t pos, int minfd)
            return i;
         }
     }
+#endif
 
   _files_semgive(list);
   return ERROR;
@@ -347,6 +504,7 @@ int files_allocate(FAR struct inode *inode, int oflags, off_t pos, int minfd)
 int files_close(int fd)
 {
   FAR struct filelist *list;
+  FAR struct file     *filep;
   int                  ret;
 
   /* Get the thread-specific file list */
@@ -356,7 +514,8 @@ int files_close(int fd)
 
   /* If the file was properly opened, there should be an inode assigned */
 
-  if (fd < 0 || fd >= CONFIG_NFILE_DESCRIPTORS || !list->fl_files[fd].f_inode)
+  filep = files_fdfile(list, fd);
+  if (!filep || !filep->f_inode)
    {
      return -EBADF;
    }
@@ -364,7 +523,8 @@ int files_close(int fd)
   /* Perform the protected close operation */
 
   _files_semtake(list);
-  ret = _files_close(&list->fl_files[fd]);
+  ret = _files_close(filep);
+  _files_clrinuse(list, fd);
   _files_semgive(list);
   return ret;
 }
@@ -381,16 +541,44 @@ int files_close(int fd)
 void files_release(int fd)
 {
   FAR struct filelist *list;
+  FAR struct file *filep;
 
   list = sched_getfiles();
   DEBUGASSERT(list);
 
-  if (fd >=0 && fd < CONFIG_NFILE_DESCRIPTORS)
+  filep = files_fdfile(list, fd);
+  if (filep)
     {
       _files_semtake(list);
-      list->fl_files[fd].f_oflags  = 0;
-      list->fl_files[fd].f_pos     = 0;
-      list->fl_files[fd].f_inode = NULL;
+      filep->f_oflags  = 0;
+      filep->f_pos     = 0;
+      filep->f_inode = NULL;
+      _files_clrinuse(list, fd);
       _files_semgive(list);
     }
 }
+
+/****************************************************************************
+ * Name: files_fdfile
+ *
+ * Description:
+ *   Return the file structure of the file descriptor 'fd' in 'list', or
+ *   NULL if 'fd' is out of range or its block was never allocated.  The
+ *   lookup takes no lock: blocks are only freed with the list.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+FAR struct file *files_fdfile(FAR struct filelist *list, int fd)
+{
+  FAR struct file *block;
+
+  if ((unsigned int)fd >= CONFIG_NFILE_DESCRIPTORS)
+    {
+      return NULL;
+    }
+
+  block = list->fl_blocks[fd / CONFIG_NFILE_DESCRIPTORS_PER_BLOCK];
+  return block ? &block[fd % CONFIG_NFILE_DESCRIPTORS_PER_BLOCK] : NULL;
+}
+#endif
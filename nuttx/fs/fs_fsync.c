@@ -99,8 +99,8 @@ int fsync(int fd)
 
   /* Was this file opened for write access? */
 
-  filep = &list->fl_files[fd];
-  if ((filep->f_oflags & O_WROK) == 0)
+  filep = files_fdfile(list, fd);
+  if (!filep || (filep->f_oflags & O_WROK) == 0)
     {
       ret = EBADF;
       goto errout;
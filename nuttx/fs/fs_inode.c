@@ -41,6 +41,7 @@
 
 #include <assert.h>
 #include <semaphore.h>
+#include <string.h>
 #include <errno.h>
 
 #include <nuttx/kmalloc.h>
@@ -72,12 +73,29 @@ struct inode_sem_s
   int16_t count;   /* Number of counts held */
 };
 
+/* One remembered path lookup */
+
+#ifdef CONFIG_FS_INODECACHE
+struct inode_cache_s
+{
+  uint32_t          hash;    /* Hash of the path, zero if the entry is unused */
+  FAR struct inode *node;    /* The inode found at the path */
+  uint8_t           reloff;  /* Offset of the relative path within the path */
+  char              path[CONFIG_FS_INODECACHE_PATHLEN + 1];
+};
+#endif
+
 /****************************************************************************
  * Private Variables
  ****************************************************************************/
 
 static struct inode_sem_s g_inode_sem;
 
+#ifdef CONFIG_FS_INODECACHE
+static struct inode_cache_s g_inode_cache[CONFIG_FS_INODECACHE_NENTRIES];
+static uint8_t g_inode_cachenext;  /* Next g_inode_cache entry to replace */
+#endif
+
 /****************************************************************************
  * Public Variables
  ****************************************************************************/
@@ -165,6 +183,35 @@ static int _inode_compare(FAR const char *fname,
     }
 }
 
+/****************************************************************************
+ * Name: _inode_hash
+ *
+ * Description:
+ *   Hash a path for the inode lookup cache.  Returns zero if the path is
+ *   too long to be cached.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODECACHE
+static uint32_t _inode_hash(FAR const char *path)
+{
+  uint32_t hash = 5381;
+  int len;
+
+  for (len = 0; path[len] != '\0'; len++)
+    {
+      if (len >= CONFIG_FS_INODECACHE_PATHLEN)
+        {
+          return 0;
+        }
+
+      hash = (hash << 5) + hash + (uint8_t)path[len];
+    }
+
+  return hash != 0 ? hash : 1;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -386,6 +433,105 @@ FAR struct inode *inode_search(FAR const char **path,
   return node;
 }
 
+/****************************************************************************
+ * Name: inode_cachefind
+ *
+ * Description:
+ *   Return the inode remembered for 'path' by inode_cacheadd(), or NULL if
+ *   there is none.  On success, 'relpath' is set as inode_search() would.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODECACHE
+FAR struct inode *inode_cachefind(FAR const char *path,
+                                  FAR const char **relpath)
+{
+  uint32_t hash = _inode_hash(path);
+  int i;
+
+  if (hash == 0)
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < CONFIG_FS_INODECACHE_NENTRIES; i++)
+    {
+      if (g_inode_cache[i].hash == hash &&
+          strcmp(g_inode_cache[i].path, path) == 0)
+        {
+          if (relpath)
+            {
+              *relpath = path + g_inode_cache[i].reloff;
+            }
+
+          return g_inode_cache[i].node;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: inode_cacheadd
+ *
+ * Description:
+ *   Remember that inode_search() found 'node' for 'path', with 'relpath'
+ *   pointing into 'path'.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore
+ *
+ ****************************************************************************/
+
+void inode_cacheadd(FAR const char *path, FAR struct inode *node,
+                    FAR const char *relpath)
+{
+  FAR struct inode_cache_s *entry;
+  uint32_t hash = _inode_hash(path);
+
+  if (hash == 0)
+    {
+      return;
+    }
+
+  entry = &g_inode_cache[g_inode_cachenext];
+  if (++g_inode_cachenext >= CONFIG_FS_INODECACHE_NENTRIES)
+    {
+      g_inode_cachenext = 0;
+    }
+
+  entry->hash   = hash;
+  entry->node   = node;
+  entry->reloff = relpath - path;
+  strcpy(entry->path, path);
+}
+
+/****************************************************************************
+ * Name: inode_cacheinval
+ *
+ * Description:
+ *   Forget all remembered lookups.  Called whenever the shape of the inode
+ *   tree changes.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore
+ *
+ ****************************************************************************/
+
+void inode_cacheinval(void)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_INODECACHE_NENTRIES; i++)
+    {
+      g_inode_cache[i].hash = 0;
+    }
+}
+#endif /* CONFIG_FS_INODECACHE */
+
 /****************************************************************************
  * Name: inode_free
  *
@@ -75,6 +75,8 @@
 
 FAR struct inode *inode_find(FAR const char *path, FAR const char **relpath)
 {
+  FAR const char   *search = path;
+  FAR const char   *name;
   FAR struct inode *node;
 
   if (!*path || path[0] != '/')
@@ -87,10 +89,24 @@ FAR struct inode *inode_find(FAR const char *path, FAR const char **relpath)
    */
 
   inode_semtake();
-  node = inode_search(&path, (FAR struct inode**)NULL, (FAR struct inode**)NULL, relpath);
+  node = inode_cachefind(path, &name);
+  if (!node)
+    {
+      node = inode_search(&search, (FAR struct inode**)NULL,
+                          (FAR struct inode**)NULL, &name);
+      if (node)
+        {
+          inode_cacheadd(path, node, name);
+        }
+    }
+
   if (node)
     {
       node->i_crefs++;
+      if (relpath)
+        {
+          *relpath = name;
+        }
     }
 
   inode_semgive();
@@ -124,6 +124,10 @@ FAR struct inode *inode_unlink(FAR const char *path)
         }
 
       node->i_peer = NULL;
+
+      /* Lookups may have found this node or one below it */
+
+      inode_cacheinval();
     }
 
   return node;
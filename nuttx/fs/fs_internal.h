@@ -148,6 +148,32 @@ FAR struct inode *inode_search(FAR const char **path,
                                FAR struct inode **parent,
                                FAR const char **relpath);
 
+/****************************************************************************
+ * Name: inode_cachefind, inode_cacheadd, and inode_cacheinval
+ *
+ * Description:
+ *   Remember recent inode_search() results by path, so that repeated
+ *   lookups of the same path do not walk the inode tree.  The cache must be
+ *   invalidated whenever an inode is inserted into or unlinked from the
+ *   tree.
+ *
+ * Assumptions:
+ *   The caller holds the tree_sem
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODECACHE
+FAR struct inode *inode_cachefind(FAR const char *path,
+                                  FAR const char **relpath);
+void inode_cacheadd(FAR const char *path, FAR struct inode *node,
+                    FAR const char *relpath);
+void inode_cacheinval(void);
+#else
+#  define inode_cachefind(p,r)   ((FAR struct inode *)NULL)
+#  define inode_cacheadd(p,n,r)
+#  define inode_cacheinval()
+#endif
+
 /****************************************************************************
  * Name: inode_free
  *
@@ -338,6 +364,21 @@ void files_release(int fd);
 int find_blockdriver(FAR const char *pathname, int mountflags,
                      FAR struct inode **ppinode);
 
+/* fs_poll.c ****************************************************************/
+/****************************************************************************
+ * Name: poll_fdsetup
+ *
+ * Description:
+ *   Set up (or tear down) the poll of one file or socket descriptor.  Also
+ *   used by epoll to keep descriptors registered between waits.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0 && !defined(CONFIG_DISABLE_POLL)
+struct pollfd;
+int poll_fdsetup(int fd, FAR struct pollfd *fds, bool setup);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -116,8 +116,8 @@ int ioctl(int fd, int req, unsigned long arg)
 
   /* Is a driver registered? Does it support the ioctl method? */
 
-  filep = &list->fl_files[fd];
-  inode = filep->f_inode;
+  filep = files_fdfile(list, fd);
+  inode = filep ? filep->f_inode : NULL;
 
   if (inode && inode->u.i_ops && inode->u.i_ops->ioctl)
     {
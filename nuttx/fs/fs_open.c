@@ -178,13 +178,13 @@ int open(const char *path, int oflags, ...)
 #ifndef CONFIG_DISABLE_MOUNTPOINT
       if (INODE_IS_MOUNTPT(inode))
         {
-          ret = inode->u.i_mops->open((FAR struct file*)&list->fl_files[fd],
+          ret = inode->u.i_mops->open(files_fdfile(list, fd),
                                       relpath, oflags, mode);
         }
       else
 #endif
         {
-          ret = inode->u.i_ops->open((FAR struct file*)&list->fl_files[fd]);
+          ret = inode->u.i_ops->open(files_fdfile(list, fd));
         }
     }
 
@@ -95,7 +95,7 @@ static void poll_semtake(FAR sem_t *sem)
  ****************************************************************************/
 
 #if CONFIG_NFILE_DESCRIPTORS > 0
-static int poll_fdsetup(int fd, FAR struct pollfd *fds, bool setup)
+int poll_fdsetup(int fd, FAR struct pollfd *fds, bool setup)
 {
   FAR struct filelist *list;
   FAR struct file     *filep;
@@ -129,8 +129,8 @@ static int poll_fdsetup(int fd, FAR struct pollfd *fds, bool setup)
    * If not, return -ENOSYS
    */
 
-  filep = &list->fl_files[fd];
-  inode = filep->f_inode;
+  filep = files_fdfile(list, fd);
+  inode = filep ? filep->f_inode : NULL;
 
   if (inode && inode->u.i_ops && inode->u.i_ops->poll)
     {
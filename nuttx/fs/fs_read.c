@@ -143,6 +143,7 @@ ssize_t read(int fd, FAR void *buf, size_t nbytes)
 {
 #if CONFIG_NFILE_DESCRIPTORS > 0
   FAR struct filelist *list;
+  FAR struct file *filep;
 #endif
 
   /* Did we get a valid file descriptor? */
@@ -175,9 +176,16 @@ ssize_t read(int fd, FAR void *buf, size_t nbytes)
       list = sched_getfiles();
       DEBUGASSERT(list);
 
+      filep = files_fdfile(list, fd);
+      if (!filep)
+        {
+          set_errno(EBADF);
+          return ERROR;
+        }
+
       /* Then let file_read do all of the work */
 
-      return file_read(&list->fl_files[fd], buf, nbytes);
+      return file_read(filep, buf, nbytes);
     }
 #endif
 }
@@ -127,6 +127,7 @@ ssize_t sendfile(int outfd, int infd, off_t *offset, size_t count)
       (unsigned int)infd < CONFIG_NFILE_DESCRIPTORS)
     {
       FAR struct filelist *list;
+      FAR struct file *filep;
 
       /* This appears to be a file-to-socket transfer.  Get the thread-
        * specific file list.
@@ -135,9 +136,16 @@ ssize_t sendfile(int outfd, int infd, off_t *offset, size_t count)
       list = sched_getfiles();
       DEBUGASSERT(list);
 
+      filep = files_fdfile(list, infd);
+      if (!filep)
+        {
+          set_errno(EBADF);
+          return ERROR;
+        }
+
       /* Then let net_sendfile do the work. */
 
-      return net_sendfile(outfd, &list->fl_files[infd], offset, count);
+      return net_sendfile(outfd, filep, offset, count);
     }
   else
 #endif
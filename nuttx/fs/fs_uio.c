@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "fs_internal.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: uio_check
+ *
+ * Description:
+ *   Validate a scatter/gather list.  Returns OK or a negated errno value.
+ *
+ ****************************************************************************/
+
+static int uio_check(FAR const struct iovec *iov, int iovcnt)
+{
+  size_t total = 0;
+  int i;
+
+  if (iov == NULL || iovcnt <= 0 || iovcnt > IOV_MAX)
+    {
+      return -EINVAL;
+    }
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len > SSIZE_MAX - total)
+        {
+          return -EINVAL;
+        }
+
+      total += iov[i].iov_len;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: uio_sockxfer
+ *
+ * Description:
+ *   Socket descriptors have no vectored methods: transfer one buffer at a
+ *   time with read() or write(), stopping at the first short transfer.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NSOCKET_DESCRIPTORS > 0
+static ssize_t uio_sockxfer(int fd, FAR const struct iovec *iov, int iovcnt,
+                            bool wr)
+{
+  ssize_t total = 0;
+  ssize_t nxfrd;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len == 0)
+        {
+          continue;
+        }
+
+      nxfrd = wr ? write(fd, iov[i].iov_base, iov[i].iov_len) :
+                   read(fd, iov[i].iov_base, iov[i].iov_len);
+      if (nxfrd < 0)
+        {
+          return total > 0 ? total : ERROR;
+        }
+
+      total += nxfrd;
+      if ((size_t)nxfrd < iov[i].iov_len)
+        {
+          break;
+        }
+    }
+
+  return total;
+}
+#endif
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+
+/****************************************************************************
+ * Name: uio_xfer
+ *
+ * Description:
+ *   Common logic of file_readv() and file_writev().  Returns the number of
+ *   bytes transferred or a negated errno value.
+ *
+ ****************************************************************************/
+
+static ssize_t uio_xfer(FAR struct file *filep, FAR const struct iovec *iov,
+                        int iovcnt, bool wr)
+{
+  FAR struct inode *inode;
+  FAR const struct file_operations *ops;
+  ssize_t total = 0;
+  ssize_t nxfrd;
+  int ret;
+  int i;
+
+  DEBUGASSERT(filep);
+
+  ret = uio_check(iov, iovcnt);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Was this file opened for the requested access? */
+
+  if ((filep->f_oflags & (wr ? O_WROK : O_RDOK)) == 0)
+    {
+      return wr ? -EBADF : -EACCES;
+    }
+
+  inode = filep->f_inode;
+  if (!inode || !inode->u.i_ops)
+    {
+      return -EBADF;
+    }
+
+  ops = inode->u.i_ops;
+
+#ifdef CONFIG_FS_VECTORIO
+  /* The vectored methods come after the part of struct file_operations
+   * shared with struct mountpt_operations, so only a driver may have them.
+   */
+
+  if (!INODE_IS_MOUNTPT(inode))
+    {
+      if (wr && ops->writev)
+        {
+          return ops->writev(filep, iov, iovcnt);
+        }
+      else if (!wr && ops->readv)
+        {
+          return ops->readv(filep, iov, iovcnt);
+        }
+    }
+#endif
+
+  /* Otherwise, transfer one buffer at a time.  As for the mountpoint case
+   * in read() and write(), this depends on the read and write methods
+   * being identical in signature and position in both vtables.
+   */
+
+  if ((wr && !ops->write) || (!wr && !ops->read))
+    {
+      return -EBADF;
+    }
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len == 0)
+        {
+          continue;
+        }
+
+      nxfrd = wr ? ops->write(filep, (FAR const char *)iov[i].iov_base,
+                              iov[i].iov_len) :
+                   ops->read(filep, (FAR char *)iov[i].iov_base,
+                             iov[i].iov_len);
+      if (nxfrd < 0)
+        {
+          /* Report what was already transferred, if anything; the error
+           * will be seen again on the next call.
+           */
+
+          return total > 0 ? total : nxfrd;
+        }
+
+      total += nxfrd;
+      if ((size_t)nxfrd < iov[i].iov_len)
+        {
+          break;
+        }
+    }
+
+  return total;
+}
+
+/****************************************************************************
+ * Name: uio_filep
+ *
+ * Description:
+ *   Map a file descriptor to its file structure, NULL if it was never
+ *   used.
+ *
+ ****************************************************************************/
+
+static FAR struct file *uio_filep(int fd)
+{
+  FAR struct filelist *list;
+
+  list = sched_getfiles();
+  DEBUGASSERT(list);
+
+  return files_fdfile(list, fd);
+}
+
+/****************************************************************************
+ * Name: uio_pxfer
+ *
+ * Description:
+ *   Common logic of preadv() and pwritev():  transfer at 'offset' and then
+ *   restore the file position.
+ *
+ ****************************************************************************/
+
+static ssize_t uio_pxfer(int fd, FAR const struct iovec *iov, int iovcnt,
+                         off_t offset, bool wr)
+{
+  FAR struct file *filep;
+  ssize_t ret;
+  off_t savepos;
+
+  if ((unsigned int)fd >= CONFIG_NFILE_DESCRIPTORS)
+    {
+      set_errno(ESPIPE);
+      return ERROR;
+    }
+
+  if (offset < 0)
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  filep = uio_filep(fd);
+  if (!filep)
+    {
+      set_errno(EBADF);
+      return ERROR;
+    }
+
+  /* file_seek() sets errno on failure */
+
+  savepos = file_seek(filep, 0, SEEK_CUR);
+  if (savepos < 0 || file_seek(filep, offset, SEEK_SET) < 0)
+    {
+      return ERROR;
+    }
+
+  ret = uio_xfer(filep, iov, iovcnt, wr);
+
+  /* Restore the file position even if the transfer failed */
+
+  (void)file_seek(filep, savepos, SEEK_SET);
+
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      return ERROR;
+    }
+
+  return ret;
+}
+
+#endif /* CONFIG_NFILE_DESCRIPTORS > 0 */
+
+/****************************************************************************
+ * Name: uio_vxfer
+ *
+ * Description:
+ *   Common logic of readv() and writev()
+ *
+ ****************************************************************************/
+
+static ssize_t uio_vxfer(int fd, FAR const struct iovec *iov, int iovcnt,
+                         bool wr)
+{
+#if CONFIG_NFILE_DESCRIPTORS > 0
+  FAR struct file *filep;
+#endif
+  ssize_t ret;
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+  if ((unsigned int)fd < CONFIG_NFILE_DESCRIPTORS)
+    {
+      filep = uio_filep(fd);
+      ret = filep ? uio_xfer(filep, iov, iovcnt, wr) : -EBADF;
+      if (ret < 0)
+        {
+          set_errno(-ret);
+          return ERROR;
+        }
+
+      return ret;
+    }
+#endif
+
+  ret = uio_check(iov, iovcnt);
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      return ERROR;
+    }
+
+#if CONFIG_NSOCKET_DESCRIPTORS > 0
+  return uio_sockxfer(fd, iov, iovcnt, wr);
+#else
+  set_errno(EBADF);
+  return ERROR;
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+
+/****************************************************************************
+ * Name: file_readv
+ *
+ * Description:
+ *   Equivalent to readv() except that it accepts a struct file instance
+ *   instead of a file descriptor.
+ *
+ * Return:
+ *   The number of bytes read on success; -1 on failure with errno set
+ *   appropriately.
+ *
+ ****************************************************************************/
+
+ssize_t file_readv(FAR struct file *filep, FAR const struct iovec *iov,
+                   int iovcnt)
+{
+  ssize_t ret = uio_xfer(filep, iov, iovcnt, false);
+
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      return ERROR;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: file_writev
+ *
+ * Description:
+ *   Equivalent to writev() except that it accepts a struct file instance
+ *   instead of a file descriptor.
+ *
+ * Return:
+ *   The number of bytes written on success; -1 on failure with errno set
+ *   appropriately.
+ *
+ ****************************************************************************/
+
+ssize_t file_writev(FAR struct file *filep, FAR const struct iovec *iov,
+                    int iovcnt)
+{
+  ssize_t ret = uio_xfer(filep, iov, iovcnt, true);
+
+  if (ret < 0)
+    {
+      set_errno(-ret);
+      return ERROR;
+    }
+
+  return ret;
+}
+
+#endif /* CONFIG_NFILE_DESCRIPTORS > 0 */
+
+/****************************************************************************
+ * Name: readv
+ *
+ * Description:
+ *   The standard, POSIX readv interface.  See sys/uio.h.
+ *
+ ****************************************************************************/
+
+ssize_t readv(int fd, FAR const struct iovec *iov, int iovcnt)
+{
+  return uio_vxfer(fd, iov, iovcnt, false);
+}
+
+/****************************************************************************
+ * Name: writev
+ *
+ * Description:
+ *   The standard, POSIX writev interface.  See sys/uio.h.
+ *
+ ****************************************************************************/
+
+ssize_t writev(int fd, FAR const struct iovec *iov, int iovcnt)
+{
+  return uio_vxfer(fd, iov, iovcnt, true);
+}
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+
+/****************************************************************************
+ * Name: preadv
+ *
+ * Description:
+ *   Read into a scatter list at a given file offset.  See sys/uio.h.
+ *
+ ****************************************************************************/
+
+ssize_t preadv(int fd, FAR const struct iovec *iov, int iovcnt, off_t offset)
+{
+  return uio_pxfer(fd, iov, iovcnt, offset, false);
+}
+
+/****************************************************************************
+ * Name: pwritev
+ *
+ * Description:
+ *   Write from a gather list at a given file offset.  See sys/uio.h.
+ *
+ ****************************************************************************/
+
+ssize_t pwritev(int fd, FAR const struct iovec *iov, int iovcnt, off_t offset)
+{
+  return uio_pxfer(fd, iov, iovcnt, offset, true);
+}
+
+#endif /* CONFIG_NFILE_DESCRIPTORS > 0 */
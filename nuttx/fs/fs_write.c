@@ -81,8 +81,8 @@ static inline ssize_t file_write(int fd, FAR const void *buf, size_t nbytes)
 
   /* Was this file opened for write access? */
 
-  filep = &list->fl_files[fd];
-  if ((filep->f_oflags & O_WROK) == 0)
+  filep = files_fdfile(list, fd);
+  if (!filep || (filep->f_oflags & O_WROK) == 0)
     {
       err = EBADF;
       goto errout;
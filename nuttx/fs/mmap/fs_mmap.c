@@ -70,7 +70,9 @@
  *        only file system that meets this requirement.
  *     b. The underlying block driver supports the BIOC_XIPBASE ioctl
  *        command that maps the underlying media to a randomly accessible
- *        address. At  present, only the RAM/ROM disk driver does this.
+ *        address. At  present, the RAM/ROM disk driver does this, as does
+ *        the FTL layer over memory-mapped SPI FLASH (CONFIG_M25P_XIPBASE
+ *        or CONFIG_W25_XIPBASE).
  *
  *   2. If CONFIG_FS_RAMMAP is defined in the configuration, then mmap() will
  *      support simulation of memory mapped files by copying files whole
@@ -81,7 +81,9 @@
  *        only file system that meets this requirement.
  *     b. The underlying block driver supports the BIOC_XIPBASE ioctl
  *        command that maps the underlying media to a randomly accessible
- *        address. At  present, only the RAM/ROM disk driver does this.
+ *        address. At  present, the RAM/ROM disk driver does this, as does
+ *        the FTL layer over memory-mapped SPI FLASH (CONFIG_M25P_XIPBASE
+ *        or CONFIG_W25_XIPBASE).
  *
  *     munmap() is still not required in this first case.  In this first
  *     The mapped address is a static address in the MCUs address space
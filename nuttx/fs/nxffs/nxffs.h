@@ -51,6 +51,9 @@
 
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/fs/nxffs.h>
+#ifdef CONFIG_NXFFS_BGPACK
+#  include <nuttx/wqueue.h>
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -139,6 +142,22 @@
  *    mount operations.
  */
 
+/* Background packing needs the low priority work queue */
+
+#ifndef CONFIG_SCHED_LPWORK
+#  undef CONFIG_NXFFS_BGPACK
+#endif
+
+#ifndef CONFIG_NXFFS_BGPACK_WATERMARK
+#  define CONFIG_NXFFS_BGPACK_WATERMARK 25
+#endif
+
+/* Number of I/O blocks in the volume cache */
+
+#ifndef CONFIG_NXFFS_CACHE_NBLOCKS
+#  define CONFIG_NXFFS_CACHE_NBLOCKS 1
+#endif
+
 /* Values for logical block state.  Basically, there are only two, perhaps
  * three, states:
  *
@@ -283,6 +302,27 @@ struct nxffs_wrfile_s
   uint32_t                  crc;        /* Accumulated data block CRC */
 };
 
+/* This structure describes one I/O block of the volume cache */
+
+struct nxffs_cslot_s
+{
+  off_t                     block;     /* Block number in the slot, or -1 */
+  uint32_t                  lastuse;   /* Volume cclock at the last access */
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  bool                      dirty;     /* Not yet written to FLASH */
+#endif
+};
+
+#ifdef CONFIG_NXFFS_INDEX
+/* This structure describes one valid inode in the in-memory inode index */
+
+struct nxffs_index_s
+{
+  off_t                     hoffset;   /* FLASH offset to the inode header */
+  uint32_t                  hash;      /* CRC32 of the inode name */
+};
+#endif
+
 /* This structure represents the overall state of on NXFFS instance. */
 
 struct nxffs_volume_s
@@ -297,10 +337,31 @@ struct nxffs_volume_s
   off_t                     froffset;  /* Offset to the first free byte */
   off_t                     nblocks;   /* Number of R/W blocks on volume */
   off_t                     ioblock;   /* Current block number being accessed */
-  off_t                     cblock;    /* Starting block number in cache */
+  off_t                     cblock;    /* Block number in cache */
   FAR struct nxffs_ofile_s *ofiles;    /* A singly-linked list of open files */
-  FAR uint8_t              *cache;     /* On cached erase block for general I/O */
+  FAR uint8_t              *cache;     /* The cached I/O block, in cbuffer */
   FAR uint8_t              *pack;      /* A full erase block to support packing */
+
+  /* The I/O blocks kept in the cache, replaced least recently used first */
+
+  FAR uint8_t              *cbuffer;   /* CONFIG_NXFFS_CACHE_NBLOCKS I/O blocks */
+  uint32_t                  cclock;    /* Incremented on each cache access */
+  uint8_t                   cslot;     /* Slot of cblock */
+  struct nxffs_cslot_s      cslots[CONFIG_NXFFS_CACHE_NBLOCKS];
+
+#ifdef CONFIG_NXFFS_BGPACK
+  struct work_s             pwork;     /* Background pack */
+  bool                      reclaim;   /* Files were deleted since the last pack */
+#endif
+
+#ifdef CONFIG_NXFFS_INDEX
+  /* The valid inodes, in FLASH order, if ivalid */
+
+  FAR struct nxffs_index_s *index;
+  int                       nindex;    /* Number of inodes in index */
+  int                       maxindex;  /* Number of inodes index can hold */
+  bool                      ivalid;    /* The index holds all valid inodes */
+#endif
 };
 
 /* This structure describes the state of the blocks on the NXFFS volume */
@@ -469,6 +530,24 @@ void nxffs_wrle32(uint8_t *dest, uint32_t val);
 
 size_t nxffs_erased(FAR const uint8_t *buffer, size_t buflen);
 
+/****************************************************************************
+ * Name: nxffs_initcache
+ *
+ * Description:
+ *   Allocate the volume cache memory and mark all of it unused.
+ *
+ * Input Parameters:
+ *   volume - Describes the current volume
+ *
+ * Returned Value:
+ *   Zero on success, -ENOMEM if the memory could not be allocated.
+ *
+ * Defined in nxffs_cache.c
+ *
+ ****************************************************************************/
+
+int nxffs_initcache(FAR struct nxffs_volume_s *volume);
+
 /****************************************************************************
  * Name: nxffs_rdcache
  *
@@ -507,6 +586,45 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block);
 
 int nxffs_wrcache(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_flushcache
+ *
+ * Description:
+ *   Write the block left in the volume cache by nxffs_wrcache(), if any.
+ *   This does nothing unless CONFIG_NXFFS_WRITEBEHIND is selected.
+ *
+ * Input Parameters:
+ *   volume - Describes the current volume
+ *
+ * Returned Value:
+ *   Negated errnos are returned only in the case of MTD reported failures.
+ *
+ * Defined in nxffs_cache.c
+ *
+ ****************************************************************************/
+
+int nxffs_flushcache(FAR struct nxffs_volume_s *volume);
+
+/****************************************************************************
+ * Name: nxffs_invalcache
+ *
+ * Description:
+ *   Drop a range of blocks from the volume cache, after they were erased
+ *   or written behind the back of the cache.  Blocks not yet written are
+ *   lost: the caller must flush the cache first if they matter.
+ *
+ * Input Parameters:
+ *   volume  - Describes the current volume
+ *   block   - The first logical block to drop
+ *   nblocks - The number of logical blocks to drop
+ *
+ * Defined in nxffs_cache.c
+ *
+ ****************************************************************************/
+
+void nxffs_invalcache(FAR struct nxffs_volume_s *volume, off_t block,
+                      off_t nblocks);
+
 /****************************************************************************
  * Name: nxffs_ioseek
  *
@@ -639,6 +757,55 @@ int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
 int nxffs_findinode(FAR struct nxffs_volume_s *volume, FAR const char *name,
                     FAR struct nxffs_entry_s *entry);
 
+/****************************************************************************
+ * Name: nxffs_resetindex, nxffs_invalindex, nxffs_addindex, nxffs_delindex
+ *
+ * Description:
+ *   Maintain the in-memory index of the valid inodes, which spares
+ *   nxffs_findinode() the scan of the volume.  nxffs_resetindex() empties
+ *   the index before the inodes found by a scan are added to it,
+ *   nxffs_invalindex() discards it after the inodes were moved: it is
+ *   rebuilt by the next lookup.  Inodes must be added in FLASH order.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_findindex
+ *
+ * Description:
+ *   Look an inode up in the inode index, rebuilding the index first if it
+ *   was discarded.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *   name   - The name of the inode to find
+ *   entry  - The location to return information about the inode.
+ *
+ * Returned Value:
+ *   Zero if the inode was found, -ENOENT if there is no such inode, or
+ *   -EAGAIN if the index could not be used: the volume must be scanned.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INDEX
+void nxffs_resetindex(FAR struct nxffs_volume_s *volume);
+void nxffs_invalindex(FAR struct nxffs_volume_s *volume);
+void nxffs_addindex(FAR struct nxffs_volume_s *volume,
+                    FAR const struct nxffs_entry_s *entry);
+void nxffs_delindex(FAR struct nxffs_volume_s *volume, off_t hoffset);
+int nxffs_findindex(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                    FAR struct nxffs_entry_s *entry);
+#else
+#  define nxffs_resetindex(v)
+#  define nxffs_invalindex(v)
+#  define nxffs_addindex(v,e)
+#  define nxffs_delindex(v,o)
+#endif
+
 /****************************************************************************
  * Name: nxffs_inodeend
  *
@@ -1059,6 +1226,28 @@ int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name);
 
 int nxffs_pack(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_bgpack
+ *
+ * Description:
+ *   Schedule a pack of the volume on the low priority work queue if the
+ *   free FLASH fell below CONFIG_NXFFS_BGPACK_WATERMARK percent and files
+ *   were deleted since the last pack, so that a writer rarely has to pack
+ *   the volume itself.  Called with the volume exclsem held.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Defined in nxffs_pack.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_BGPACK
+void nxffs_bgpack(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_bgpack(v)
+#endif
+
 /****************************************************************************
  * Standard mountpoint operation methods
  *
@@ -1067,7 +1256,7 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume);
  *
  * - nxffs_open() and nxffs_close() are defined in nxffs_open.c
  * - nxffs_read() is defined in nxffs_read.c
- * - nxffs_write() is defined in nxffs_write.c
+ * - nxffs_write() and nxffs_sync() are defined in nxffs_write.c
  * - nxffs_ioctl() is defined in nxffs_ioctl.c
  * - nxffs_dup() is defined in nxffs_open.c
  * - nxffs_opendir(), nxffs_readdir(), and nxffs_rewindir() are defined in
@@ -1090,6 +1279,7 @@ int nxffs_close(FAR struct file *filep);
 ssize_t nxffs_read(FAR struct file *filep, FAR char *buffer, size_t buflen);
 ssize_t nxffs_write(FAR struct file *filep, FAR const char *buffer,
                     size_t buflen);
+int nxffs_sync(FAR struct file *filep);
 int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg);
 int nxffs_dup(FAR const struct file *oldp, FAR struct file *newp);
 int nxffs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
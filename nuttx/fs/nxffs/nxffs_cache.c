@@ -45,6 +45,7 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/kmalloc.h>
 #include <nuttx/mtd/mtd.h>
 
 #include "nxffs.h"
@@ -53,6 +54,10 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* The I/O block buffer of a cache slot */
+
+#define NXFFS_CSLOT_BUFFER(v,n) (&(v)->cbuffer[(n) * (v)->geo.blocksize])
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -65,15 +70,96 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxffs_wrslot
+ *
+ * Description:
+ *   Write the block held by one cache slot to FLASH.
+ *
+ ****************************************************************************/
+
+static int nxffs_wrslot(FAR struct nxffs_volume_s *volume, int slot)
+{
+  FAR struct nxffs_cslot_s *cslot = &volume->cslots[slot];
+  size_t nxfrd;
+
+  nxfrd = MTD_BWRITE(volume->mtd, cslot->block, 1,
+                     NXFFS_CSLOT_BUFFER(volume, slot));
+  if (nxfrd != 1)
+    {
+      fdbg("ERROR: Write block %d failed: %d\n", cslot->block, nxfrd);
+      return -EIO;
+    }
+
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  cslot->dirty = false;
+#endif
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_selslot
+ *
+ * Description:
+ *   Make a cache slot the current one, the one volume->cache refers to.
+ *
+ ****************************************************************************/
+
+static void nxffs_selslot(FAR struct nxffs_volume_s *volume, int slot)
+{
+  volume->cslot   = slot;
+  volume->cblock  = volume->cslots[slot].block;
+  volume->cache   = NXFFS_CSLOT_BUFFER(volume, slot);
+  volume->cslots[slot].lastuse = ++volume->cclock;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxffs_initcache
+ *
+ * Description:
+ *   Allocate the volume cache memory and mark all of it unused.
+ *
+ * Input Parameters:
+ *   volume - Describes the current volume
+ *
+ * Returned Value:
+ *   Zero on success, -ENOMEM if the memory could not be allocated.
+ *
+ ****************************************************************************/
+
+int nxffs_initcache(FAR struct nxffs_volume_s *volume)
+{
+  int slot;
+
+  volume->cbuffer = (FAR uint8_t *)
+    kmm_malloc(CONFIG_NXFFS_CACHE_NBLOCKS * volume->geo.blocksize);
+  if (!volume->cbuffer)
+    {
+      return -ENOMEM;
+    }
+
+  for (slot = 0; slot < CONFIG_NXFFS_CACHE_NBLOCKS; slot++)
+    {
+      volume->cslots[slot].block = (off_t)-1;
+    }
+
+  volume->cslot  = 0;
+  volume->cblock = (off_t)-1;
+  volume->cache  = volume->cbuffer;
+  return OK;
+}
+
 /****************************************************************************
  * Name: nxffs_rdcache
  *
  * Description:
- *   Read one I/O block into the volume block cache memory.
+ *   Read one I/O block into the volume block cache memory.  The block
+ *   replaces the least recently used one in the cache, unless it is already
+ *   there.
  *
  * Input Parameters:
  *   volume - Describes the current volume
@@ -87,26 +173,71 @@
 
 int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block)
 {
+  FAR struct nxffs_cslot_s *cslot;
   size_t nxfrd;
+  int victim;
+  int slot;
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  int ret;
+#endif
 
   /* Check if the requested data is already in the cache */
 
-  if (block != volume->cblock)
+  if (block == volume->cblock)
+    {
+      return OK;
+    }
+
+  victim = 0;
+  for (slot = 0; slot < CONFIG_NXFFS_CACHE_NBLOCKS; slot++)
     {
-      /* Read the specified blocks into cache */
+      cslot = &volume->cslots[slot];
+      if (cslot->block == block)
+        {
+          nxffs_selslot(volume, slot);
+          return OK;
+        }
 
-      nxfrd = MTD_BREAD(volume->mtd, block, 1, volume->cache);
-      if (nxfrd != 1)
+      if (cslot->lastuse < volume->cslots[victim].lastuse)
         {
-          fdbg("ERROR: Read block %d failed: %d\n", block, nxfrd);
-          return -EIO;
+          victim = slot;
         }
+    }
 
-      /* Remember what is in the cache */
+  /* No.. replace the least recently used block, writing it first if it
+   * was left behind by nxffs_wrcache().
+   */
+
+  cslot = &volume->cslots[victim];
 
-      volume->cblock  = block;
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  if (cslot->dirty)
+    {
+      ret = nxffs_wrslot(volume, victim);
+      if (ret < 0)
+        {
+          return ret;
+        }
     }
+#endif
+
+  /* Read the specified blocks into cache */
 
+  cslot->block = block;
+  nxfrd = MTD_BREAD(volume->mtd, block, 1, NXFFS_CSLOT_BUFFER(volume, victim));
+  if (nxfrd != 1)
+    {
+      fdbg("ERROR: Read block %d failed: %d\n", block, nxfrd);
+
+      /* Forget the garbage left in the slot */
+
+      nxffs_invalcache(volume, block, 1);
+      return -EIO;
+    }
+
+  /* Remember what is in the cache */
+
+  nxffs_selslot(volume, victim);
   return OK;
 }
 
@@ -116,6 +247,12 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block)
  * Description:
  *   Write one or more logical blocks from the volume cache memory.
  *
+ *   With CONFIG_NXFFS_WRITEBEHIND, the block is only marked to be written
+ *   later, so that the successive writes to the block being filled cost one
+ *   FLASH write.  Only one block is left behind at a time: the blocks reach
+ *   the FLASH in the order they were written, which is what the recovery
+ *   of NXFFS after a power loss relies on.
+ *
  * Input Parameters:
  *   volume - Describes the current volume
  *
@@ -126,22 +263,109 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block)
 
 int nxffs_wrcache(FAR struct nxffs_volume_s *volume)
 {
-  size_t nxfrd;
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  int ret;
+  int slot;
 
-  /* Write the current block from the cache */
+  /* Write any other block left behind first */
 
-  nxfrd = MTD_BWRITE(volume->mtd, volume->cblock, 1, volume->cache);
-  if (nxfrd != 1)
+  for (slot = 0; slot < CONFIG_NXFFS_CACHE_NBLOCKS; slot++)
     {
-      fdbg("ERROR: Write block %d failed: %d\n", volume->cblock, nxfrd);
-      return -EIO;
+      if (slot != volume->cslot && volume->cslots[slot].dirty)
+        {
+          ret = nxffs_wrslot(volume, slot);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
     }
 
-  /* Write was successful */
+  volume->cslots[volume->cslot].dirty = true;
+  return OK;
+#else
+  /* Write the current block from the cache */
+
+  return nxffs_wrslot(volume, volume->cslot);
+#endif
+}
+
+/****************************************************************************
+ * Name: nxffs_flushcache
+ *
+ * Description:
+ *   Write the block left in the volume cache by nxffs_wrcache(), if any.
+ *   This does nothing unless CONFIG_NXFFS_WRITEBEHIND is selected.
+ *
+ * Input Parameters:
+ *   volume - Describes the current volume
+ *
+ * Returned Value:
+ *   Negated errnos are returned only in the case of MTD reported failures.
+ *
+ ****************************************************************************/
+
+int nxffs_flushcache(FAR struct nxffs_volume_s *volume)
+{
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+  int ret;
+  int slot;
+
+  for (slot = 0; slot < CONFIG_NXFFS_CACHE_NBLOCKS; slot++)
+    {
+      if (volume->cslots[slot].dirty)
+        {
+          ret = nxffs_wrslot(volume, slot);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+#endif
 
   return OK;
 }
 
+/****************************************************************************
+ * Name: nxffs_invalcache
+ *
+ * Description:
+ *   Drop a range of blocks from the volume cache, after they were erased
+ *   or written behind the back of the cache.  Blocks not yet written are
+ *   lost: the caller must flush the cache first if they matter.
+ *
+ * Input Parameters:
+ *   volume  - Describes the current volume
+ *   block   - The first logical block to drop
+ *   nblocks - The number of logical blocks to drop
+ *
+ ****************************************************************************/
+
+void nxffs_invalcache(FAR struct nxffs_volume_s *volume, off_t block,
+                      off_t nblocks)
+{
+  FAR struct nxffs_cslot_s *cslot;
+  int slot;
+
+  for (slot = 0; slot < CONFIG_NXFFS_CACHE_NBLOCKS; slot++)
+    {
+      cslot = &volume->cslots[slot];
+      if (cslot->block >= block && cslot->block < block + nblocks)
+        {
+          cslot->block   = (off_t)-1;
+          cslot->lastuse = 0;
+#ifdef CONFIG_NXFFS_WRITEBEHIND
+          cslot->dirty   = false;
+#endif
+          if (slot == volume->cslot)
+            {
+              volume->cblock = (off_t)-1;
+            }
+        }
+    }
+}
+
 /****************************************************************************
  * Name: nxffs_ioseek
  *
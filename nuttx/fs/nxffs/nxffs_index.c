@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <crc32.h>
+
+#include <nuttx/kmalloc.h>
+
+#include "nxffs.h"
+
+#ifdef CONFIG_NXFFS_INDEX
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The index grows by this many inodes at a time */
+
+#define NXFFS_INDEX_GROWTH 8
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_namehash
+ ****************************************************************************/
+
+static uint32_t nxffs_namehash(FAR const char *name)
+{
+  return crc32((FAR const uint8_t *)name, strlen(name));
+}
+
+/****************************************************************************
+ * Name: nxffs_buildindex
+ *
+ * Description:
+ *   Index all of the valid inodes, in the order they appear on FLASH.
+ *
+ ****************************************************************************/
+
+static int nxffs_buildindex(FAR struct nxffs_volume_s *volume)
+{
+  struct nxffs_entry_s entry;
+  off_t offset;
+  int ret;
+
+  nxffs_resetindex(volume);
+
+  offset = volume->inoffset;
+  while ((ret = nxffs_nextentry(volume, offset, &entry)) == OK)
+    {
+      nxffs_addindex(volume, &entry);
+      offset = nxffs_inodeend(volume, &entry);
+      nxffs_freeentry(&entry);
+    }
+
+  /* -ENOENT is the end of the inodes */
+
+  if (ret != -ENOENT)
+    {
+      nxffs_invalindex(volume);
+      return ret;
+    }
+
+  return volume->ivalid ? OK : -ENOMEM;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_resetindex
+ ****************************************************************************/
+
+void nxffs_resetindex(FAR struct nxffs_volume_s *volume)
+{
+  volume->nindex = 0;
+  volume->ivalid = true;
+}
+
+/****************************************************************************
+ * Name: nxffs_invalindex
+ ****************************************************************************/
+
+void nxffs_invalindex(FAR struct nxffs_volume_s *volume)
+{
+  volume->ivalid = false;
+}
+
+/****************************************************************************
+ * Name: nxffs_addindex
+ ****************************************************************************/
+
+void nxffs_addindex(FAR struct nxffs_volume_s *volume,
+                    FAR const struct nxffs_entry_s *entry)
+{
+  FAR struct nxffs_index_s *index;
+
+  if (!volume->ivalid)
+    {
+      return;
+    }
+
+  if (volume->nindex >= volume->maxindex)
+    {
+      index = (FAR struct nxffs_index_s *)
+        kmm_realloc(volume->index, (volume->maxindex + NXFFS_INDEX_GROWTH) *
+                    sizeof(struct nxffs_index_s));
+      if (!index)
+        {
+          /* The next lookup will try again */
+
+          fdbg("ERROR: Failed to grow the inode index\n");
+          volume->ivalid = false;
+          return;
+        }
+
+      volume->index     = index;
+      volume->maxindex += NXFFS_INDEX_GROWTH;
+    }
+
+  index          = &volume->index[volume->nindex++];
+  index->hoffset = entry->hoffset;
+  index->hash    = nxffs_namehash(entry->name);
+}
+
+/****************************************************************************
+ * Name: nxffs_delindex
+ ****************************************************************************/
+
+void nxffs_delindex(FAR struct nxffs_volume_s *volume, off_t hoffset)
+{
+  int i;
+
+  if (!volume->ivalid)
+    {
+      return;
+    }
+
+  for (i = 0; i < volume->nindex; i++)
+    {
+      if (volume->index[i].hoffset == hoffset)
+        {
+          /* Keep the FLASH order */
+
+          memmove(&volume->index[i], &volume->index[i + 1],
+                  (volume->nindex - i - 1) * sizeof(struct nxffs_index_s));
+          volume->nindex--;
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nxffs_findindex
+ ****************************************************************************/
+
+int nxffs_findindex(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                    FAR struct nxffs_entry_s *entry)
+{
+  uint32_t hash;
+  int ret;
+  int i;
+
+  if (!volume->ivalid)
+    {
+      ret = nxffs_buildindex(volume);
+      if (ret < 0)
+        {
+          return -EAGAIN;
+        }
+    }
+
+  hash = nxffs_namehash(name);
+  for (i = 0; i < volume->nindex; i++)
+    {
+      if (volume->index[i].hash != hash)
+        {
+          continue;
+        }
+
+      /* The inode header must be found right where it was indexed */
+
+      ret = nxffs_nextentry(volume, volume->index[i].hoffset, entry);
+      if (ret < 0 || entry->hoffset != volume->index[i].hoffset)
+        {
+          fdbg("ERROR: Stale index entry at %d\n", volume->index[i].hoffset);
+          if (ret == OK)
+            {
+              nxffs_freeentry(entry);
+            }
+
+          nxffs_invalindex(volume);
+          return -EAGAIN;
+        }
+
+      if (strcmp(name, entry->name) == 0)
+        {
+          return OK;
+        }
+
+      /* A hash collision */
+
+      nxffs_freeentry(entry);
+    }
+
+  return -ENOENT;
+}
+
+#endif /* CONFIG_NXFFS_INDEX */
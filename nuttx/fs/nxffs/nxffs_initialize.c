@@ -83,7 +83,7 @@ const struct mountpt_operations nxffs_operations =
   NULL,              /* seek -- Use f_pos in struct file */
   nxffs_ioctl,       /* ioctl */
 
-  NULL,              /* sync -- No buffered data */
+  nxffs_sync,        /* sync */
   nxffs_dup,         /* dup */
 
   nxffs_opendir,     /* opendir */
@@ -185,10 +185,15 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
   /* Initialize the NXFFS volume structure */
 
   volume->mtd    = mtd;
-  volume->cblock = (off_t)-1;
   sem_init(&volume->exclsem, 0, 1);
   sem_init(&volume->wrsem, 0, 1);
 
+#ifdef CONFIG_NXFFS_BGPACK
+  /* Files may have been deleted before the volume was mounted */
+
+  volume->reclaim = true;
+#endif
+
   /* Get the volume geometry. (casting to uintptr_t first eliminates
    * complaints on some architectures where the sizeof long is different
    * from the size of a pointer).
@@ -201,13 +206,12 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
       goto errout_with_volume;
     }
 
-  /* Allocate one I/O block buffer to general files system access */
+  /* Allocate the I/O block buffers for general files system access */
 
-  volume->cache = (FAR uint8_t *)kmm_malloc(volume->geo.blocksize);
-  if (!volume->cache)
+  ret = nxffs_initcache(volume);
+  if (ret < 0)
     {
-      fdbg("ERROR: Failed to allocate an erase block buffer\n");
-      ret = -ENOMEM;
+      fdbg("ERROR: Failed to allocate the block cache\n");
       goto errout_with_volume;
     }
 
@@ -315,7 +319,7 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
 errout_with_buffer:
   kmm_free(volume->pack);
 errout_with_cache:
-  kmm_free(volume->cache);
+  kmm_free(volume->cbuffer);
 errout_with_volume:
 #ifndef CONFIG_NXFFS_PREALLOCATED
   kmm_free(volume);
@@ -357,6 +361,10 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
   int nerased;
   int ret;
 
+  /* The inodes found on the way are indexed */
+
+  nxffs_resetindex(volume);
+
   /* Get the offset to the first valid block on the FLASH */
 
   block = 0;
@@ -402,6 +410,7 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
 
       /* Discard this entry and set the next offset. */
 
+      nxffs_addindex(volume, &entry);
       offset = nxffs_inodeend(volume, &entry);
       nxffs_freeentry(&entry);
     }
@@ -414,11 +423,19 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
         {
           /* Discard the entry and guess the next offset. */
 
+          nxffs_addindex(volume, &entry);
           offset = nxffs_inodeend(volume, &entry);
           nxffs_freeentry(&entry);
         }
 
       fvdbg("Last inode before offset %d\n", offset);
+
+      /* Anything but the end of the inodes leaves the index incomplete */
+
+      if (ret != -ENOENT)
+        {
+          nxffs_invalindex(volume);
+        }
     }
 
   /* No inodes were found after this offset.  Now search for a block of
@@ -555,6 +572,14 @@ int nxffs_unbind(FAR void *handle, FAR struct inode **blkdriver)
 #ifndef CONFIG_NXFFS_PREALLOCATED
 #  error "No design to support dynamic allocation of volumes"
 #else
-  return g_volume.ofiles ? -EBUSY : OK;
+  if (g_volume.ofiles)
+    {
+      return -EBUSY;
+    }
+
+#ifdef CONFIG_NXFFS_BGPACK
+  (void)work_cancel(LPWORK, &g_volume.pwork);
+#endif
+  return OK;
 #endif
 }
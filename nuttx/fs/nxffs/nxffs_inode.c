@@ -390,6 +390,16 @@ int nxffs_findinode(FAR struct nxffs_volume_s *volume, FAR const char *name,
   off_t offset;
   int ret;
 
+#ifdef CONFIG_NXFFS_INDEX
+  /* Look the inode up in the index, scanning only if it cannot be used */
+
+  ret = nxffs_findindex(volume, name, entry);
+  if (ret != -EAGAIN)
+    {
+      return ret;
+    }
+#endif
+
   /* Start with the first valid inode that was discovered when the volume
    * was created (or modified after the last file system re-packing).
    */
@@ -914,9 +914,15 @@ static inline int nxffs_wrclose(FAR struct nxffs_volume_s *volume,
         }
     }
 
-  /* Write the inode header to FLASH */
+  /* Write the inode header to FLASH, and anything left in the cache with
+   * it: the file is complete.
+   */
 
   ret = nxffs_wrinode(volume, &wrfile->ofile.entry);
+  if (ret == OK)
+    {
+      ret = nxffs_flushcache(volume);
+    }
 
   /* The volume is now available for other writers */
 
@@ -1183,6 +1189,7 @@ int nxffs_close(FAR struct file *filep)
       if ((ofile->oflags & O_WROK) != 0)
         {
           ret = nxffs_wrclose(volume, (FAR struct nxffs_wrfile_s *)ofile);
+          nxffs_bgpack(volume);
         }
 
       /* Release all resouces held by the open file */
@@ -1284,6 +1291,10 @@ int nxffs_wrinode(FAR struct nxffs_volume_s *volume,
       fdbg("ERROR: Failed to write inode header block %d: %d\n",
            volume->ioblock, -ret);
     }
+  else
+    {
+      nxffs_addindex(volume, entry);
+    }
 
   /* The volume is now available for other writers */
 
@@ -48,6 +48,7 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/wqueue.h>
 
 #include "nxffs.h"
 
@@ -1247,6 +1248,53 @@ static inline int nxffs_packwriter(FAR struct nxffs_volume_s *volume,
   return -ENOSYS;
 }
 
+/****************************************************************************
+ * Name: nxffs_bgworker
+ *
+ * Description:
+ *   Pack the volume from the low priority work queue.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_BGPACK
+static void nxffs_bgworker(FAR void *arg)
+{
+  FAR struct nxffs_volume_s *volume = (FAR struct nxffs_volume_s *)arg;
+  int ret;
+
+  /* Leave the volume alone while a file is being written: its close will
+   * try again.  The order is that of nxffs_wropen().
+   */
+
+  if (sem_trywait(&volume->wrsem) != OK)
+    {
+      return;
+    }
+
+  while (sem_wait(&volume->exclsem) != OK)
+    {
+      DEBUGASSERT(get_errno() == EINTR);
+    }
+
+  fvdbg("Background pack, froffset: %d\n", volume->froffset);
+
+  ret = nxffs_pack(volume);
+  if (ret < 0)
+    {
+      fdbg("ERROR: Background pack failed: %d\n", -ret);
+    }
+
+  /* Whatever is still not free cannot be reclaimed until more files are
+   * deleted.
+   */
+
+  volume->reclaim = false;
+
+  sem_post(&volume->exclsem);
+  sem_post(&volume->wrsem);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1278,6 +1326,20 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume)
   int i;
   int ret = OK;
 
+  /* The erase blocks are rewritten directly: nothing may be left behind
+   * in the cache.
+   */
+
+  ret = nxffs_flushcache(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* The inodes move: the index is rebuilt by the next lookup */
+
+  nxffs_invalindex(volume);
+
   /* Get the offset to the first valid inode entry */
 
   wrfile = NULL;
@@ -1592,6 +1654,10 @@ start_pack:
       /* Write the packed I/O block to FLASH */
 
       ret = MTD_BWRITE(volume->mtd, pack.block0, volume->blkper, volume->pack);
+
+      /* Whatever the cache held of the erase block is stale now */
+
+      nxffs_invalcache(volume, pack.block0, volume->blkper);
       if (ret < 0)
         {
           fdbg("ERROR: Failed to write erase block %d [%d]: %d\n",
@@ -1605,3 +1671,31 @@ errout_with_pack:
   nxffs_freeentry(&pack.dest.entry);
   return ret;
 }
+
+/****************************************************************************
+ * Name: nxffs_bgpack
+ *
+ * Description:
+ *   Schedule a pack of the volume on the low priority work queue if the
+ *   free FLASH fell below CONFIG_NXFFS_BGPACK_WATERMARK percent and files
+ *   were deleted since the last pack, so that a writer rarely has to pack
+ *   the volume itself.  Called with the volume exclsem held.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_BGPACK
+void nxffs_bgpack(FAR struct nxffs_volume_s *volume)
+{
+  off_t size = volume->nblocks * volume->geo.blocksize;
+
+  if (volume->reclaim && work_available(&volume->pwork) &&
+      (size - volume->froffset) * 100 <
+        size * CONFIG_NXFFS_BGPACK_WATERMARK)
+    {
+      (void)work_queue(LPWORK, &volume->pwork, nxffs_bgworker, volume, 0);
+    }
+}
+#endif
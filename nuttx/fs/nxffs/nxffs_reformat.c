@@ -290,6 +290,11 @@ int nxffs_reformat(FAR struct nxffs_volume_s *volume)
 {
   int ret;
 
+  /* Nothing cached survives, not even what was left to be written */
+
+  nxffs_invalcache(volume, 0, volume->nblocks);
+  nxffs_invalindex(volume);
+
   /* Erase and reformat the entire volume */
 
   ret = nxffs_format(volume);
@@ -145,6 +145,13 @@ int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name)
       fdbg("ERROR: Failed to write block %d: %d\n",
            volume->ioblock, ret);
     }
+  else
+    {
+      nxffs_delindex(volume, entry.hoffset);
+#ifdef CONFIG_NXFFS_BGPACK
+      volume->reclaim = true;
+#endif
+    }
 
 errout_with_entry:
   nxffs_freeentry(&entry);
@@ -182,6 +189,10 @@ int nxffs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   /* Then remove the NXFFS inode */
 
   ret = nxffs_rminode(volume, relpath);
+  if (ret == OK)
+    {
+      nxffs_bgpack(volume);
+    }
 
   sem_post(&volume->exclsem);
 errout:
@@ -551,6 +551,44 @@ errout:
   return ret;
 }
 
+/****************************************************************************
+ * Name: nxffs_sync
+ *
+ * Description:
+ *   This is an implementation of the NuttX standard file system sync
+ *   method: write the data left in the volume cache, if any.  The data
+ *   appended since the last data block header is only found again after a
+ *   power loss once the file is closed.
+ *
+ ****************************************************************************/
+
+int nxffs_sync(FAR struct file *filep)
+{
+  FAR struct nxffs_volume_s *volume;
+  int ret;
+
+  /* Sanity checks */
+
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
+
+  /* Recover the volume state from the open file */
+
+  volume = (FAR struct nxffs_volume_s *)filep->f_inode->i_private;
+  DEBUGASSERT(volume != NULL);
+
+  ret = sem_wait(&volume->exclsem);
+  if (ret != OK)
+    {
+      ret = -get_errno();
+      fdbg("ERROR: sem_wait failed: %d\n", ret);
+      return ret;
+    }
+
+  ret = nxffs_flushcache(volume);
+  sem_post(&volume->exclsem);
+  return ret;
+}
+
 /****************************************************************************
  * Name: nxffs_wrreserve
  *
@@ -79,6 +79,14 @@ extern const struct procfs_operations proc_operations;
 extern const struct procfs_operations cpuload_operations;
 extern const struct procfs_operations uptime_operations;
 
+#if defined(CONFIG_STACK_USAGE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_STACKS)
+extern const struct procfs_operations stacks_operations;
+#endif
+
+#if defined(CONFIG_BOOT_TIMING) && !defined(CONFIG_FS_PROCFS_EXCLUDE_BOOT)
+extern const struct procfs_operations boot_operations;
+#endif
+
 /* This is not good.  These are implemented in drivers/mtd.  Having to
  * deal with them here is not a good coupling.
  */
@@ -96,6 +104,31 @@ extern const struct procfs_operations smartfs_procfsoperations;
 extern const struct procfs_operations ccm_procfsoperations;
 #endif
 
+#if defined(CONFIG_GREYBUS_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_GREYBUS)
+extern const struct procfs_operations gb_cports_procfsoperations;
+#endif
+
+#if defined(CONFIG_GREYBUS_HANDLER_STATS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_GREYBUS)
+extern const struct procfs_operations gb_handlers_procfsoperations;
+#endif
+
+#if defined(CONFIG_MM_BUFRAM_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_BUFRAM)
+extern const struct procfs_operations bufram_procfsoperations;
+#endif
+
+#if defined(CONFIG_MM_PROFILE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_HEAP)
+extern const struct procfs_operations heap_procfsoperations;
+#endif
+
+#if defined(CONFIG_ARA_SVC_PORT_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_SVC)
+extern const struct procfs_operations svc_ports_procfsoperations;
+#endif
+
+#if defined(CONFIG_ARCH_DMA_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_DMA)
+extern const struct procfs_operations dma_procfsoperations;
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -129,9 +162,42 @@ static const struct procfs_entry_s g_procfsentries[] =
   { "uptime",           &uptime_operations },
 #endif
 
+#if defined(CONFIG_STACK_USAGE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_STACKS)
+  { "stacks",           &stacks_operations },
+#endif
+
+#if defined(CONFIG_BOOT_TIMING) && !defined(CONFIG_FS_PROCFS_EXCLUDE_BOOT)
+  { "boot",             &boot_operations },
+#endif
+
 #if defined(CONFIG_STM32_CCM_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_CCM)
   { "ccm",             &ccm_procfsoperations },
 #endif
+
+#if defined(CONFIG_GREYBUS_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_GREYBUS)
+  { "greybus/cports",   &gb_cports_procfsoperations },
+#endif
+
+#if defined(CONFIG_GREYBUS_HANDLER_STATS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_GREYBUS)
+  { "greybus/handlers", &gb_handlers_procfsoperations },
+#endif
+
+#if defined(CONFIG_MM_BUFRAM_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_BUFRAM)
+  { "bufram",           &bufram_procfsoperations },
+#endif
+
+#if defined(CONFIG_MM_PROFILE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_HEAP)
+  { "heap",             &heap_procfsoperations },
+#endif
+
+#if defined(CONFIG_ARA_SVC_PORT_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_SVC)
+  { "svc/ports",        &svc_ports_procfsoperations },
+#endif
+
+#if defined(CONFIG_ARCH_DMA_STATS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_DMA)
+  { "dma",              &dma_procfsoperations },
+#endif
 };
 
 static const uint8_t g_procfsentrycount = sizeof(g_procfsentries) /
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/boot_timing.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS)
+#if defined(CONFIG_BOOT_TIMING) && !defined(CONFIG_FS_PROCFS_EXCLUDE_BOOT)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BOOT_LINELEN 64
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct boot_file_s
+{
+  struct procfs_file_s base;
+  int nmarks;
+  struct boot_mark_s marks[CONFIG_BOOT_TIMING_NMARKS];
+  char line[BOOT_LINELEN];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: boot_open
+ ****************************************************************************/
+
+static int boot_open(FAR struct file *filep, FAR const char *relpath,
+                     int oflags, mode_t mode)
+{
+  FAR struct boot_file_s *priv;
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      return -EACCES;
+    }
+
+  if (strcmp(relpath, "boot") != 0)
+    {
+      return -ENOENT;
+    }
+
+  priv = kmm_zalloc(sizeof(*priv));
+  if (!priv)
+    {
+      return -ENOMEM;
+    }
+
+  priv->nmarks = boot_timing_get(priv->marks, CONFIG_BOOT_TIMING_NMARKS);
+
+  filep->f_priv = priv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: boot_close
+ ****************************************************************************/
+
+static int boot_close(FAR struct file *filep)
+{
+  DEBUGASSERT(filep->f_priv);
+
+  kmm_free(filep->f_priv);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: boot_read
+ *
+ * Description:
+ *   Format the report: for each boot stage, in the order they completed,
+ *   the time since start-up and the time spent since the previous stage,
+ *   both in microseconds.
+ *
+ ****************************************************************************/
+
+static ssize_t boot_read(FAR struct file *filep, FAR char *buffer,
+                         size_t buflen)
+{
+  FAR struct boot_file_s *priv = filep->f_priv;
+  off_t offset = filep->f_pos;
+  size_t remaining = buflen;
+  size_t total = 0;
+  size_t linesize;
+  size_t copysize;
+  uint32_t prev = 0;
+  int i;
+
+  DEBUGASSERT(priv);
+
+  for (i = -1; i < priv->nmarks && remaining > 0; i++)
+    {
+      if (i < 0)
+        {
+          linesize = snprintf(priv->line, BOOT_LINELEN,
+                              "      USEC    DELTA STAGE\n");
+        }
+      else
+        {
+          linesize = snprintf(priv->line, BOOT_LINELEN,
+                              "%10u %8u %s\n", priv->marks[i].usec,
+                              priv->marks[i].usec - prev,
+                              priv->marks[i].stage);
+          prev = priv->marks[i].usec;
+        }
+
+      if (linesize >= BOOT_LINELEN)
+        {
+          linesize = BOOT_LINELEN - 1;
+        }
+
+      copysize   = procfs_memcpy(priv->line, linesize, buffer, remaining,
+                                 &offset);
+      buffer    += copysize;
+      remaining -= copysize;
+      total     += copysize;
+    }
+
+  filep->f_pos += total;
+  return total;
+}
+
+/****************************************************************************
+ * Name: boot_dup
+ ****************************************************************************/
+
+static int boot_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct boot_file_s *newpriv;
+
+  DEBUGASSERT(oldp->f_priv);
+
+  newpriv = kmm_malloc(sizeof(*newpriv));
+  if (!newpriv)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+  newp->f_priv = newpriv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: boot_stat
+ ****************************************************************************/
+
+static int boot_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  if (strcmp(relpath, "boot") != 0)
+    {
+      return -ENOENT;
+    }
+
+  memset(buf, 0, sizeof(*buf));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+const struct procfs_operations boot_operations =
+{
+  .open  = boot_open,
+  .close = boot_close,
+  .read  = boot_read,
+  .dup   = boot_dup,
+  .stat  = boot_stat,
+};
+
+#endif /* CONFIG_BOOT_TIMING && !CONFIG_FS_PROCFS_EXCLUDE_BOOT */
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS */
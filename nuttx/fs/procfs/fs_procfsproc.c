@@ -60,7 +60,7 @@
 #include <nuttx/fs/procfs.h>
 #include <nuttx/fs/dirent.h>
 
-#ifdef CONFIG_SCHED_CPULOAD
+#if defined(CONFIG_SCHED_CPULOAD) || defined(CONFIG_SCHED_CPUACCT)
 #  include <nuttx/clock.h>
 #endif
 
@@ -94,6 +94,9 @@ enum proc_node_e
   PROC_LOADAVG,                       /* Average CPU utilization */
 #endif
   PROC_STACK,                         /* Task stack info */
+#ifdef CONFIG_SCHED_CPUACCT
+  PROC_CPUACCT,                       /* Task CPU accounting */
+#endif
   PROC_GROUP,                         /* Group directory */
   PROC_GROUP_STATUS,                  /* Task group status */
   PROC_GROUP_FD                       /* Group file descriptors */
@@ -151,6 +154,11 @@ static ssize_t proc_loadavg(FAR struct proc_file_s *procfile,
 static ssize_t proc_stack(FAR struct proc_file_s *procfile,
                  FAR struct tcb_s *tcb, FAR char *buffer, size_t buflen,
                  off_t offset);
+#ifdef CONFIG_SCHED_CPUACCT
+static ssize_t proc_cpuacct(FAR struct proc_file_s *procfile,
+                 FAR struct tcb_s *tcb, FAR char *buffer, size_t buflen,
+                 off_t offset);
+#endif
 static ssize_t proc_groupstatus(FAR struct proc_file_s *procfile,
                  FAR struct tcb_s *tcb, FAR char *buffer, size_t buflen,
                  off_t offset);
@@ -235,6 +243,13 @@ static const struct proc_node_s g_stack =
   "stack",        "stack",   (uint8_t)PROC_STACK,        DTYPE_FILE        /* Task stack info */
 };
 
+#ifdef CONFIG_SCHED_CPUACCT
+static const struct proc_node_s g_cpuacct =
+{
+  "stat",         "stat",    (uint8_t)PROC_CPUACCT,      DTYPE_FILE        /* Task CPU accounting */
+};
+#endif
+
 static const struct proc_node_s g_group =
 {
   "group",        "group",   (uint8_t)PROC_GROUP,        DTYPE_DIRECTORY   /* Group directory */
@@ -260,6 +275,9 @@ static FAR const struct proc_node_s * const g_nodeinfo[] =
   &g_loadavg,      /* Average CPU utilization */
 #endif
   &g_stack,        /* Task stack info */
+#ifdef CONFIG_SCHED_CPUACCT
+  &g_cpuacct,      /* Task CPU accounting */
+#endif
   &g_group,        /* Group directory */
   &g_groupstatus,  /* Task group status */
   &g_groupfd       /* Group file descriptors */
@@ -276,6 +294,9 @@ static const struct proc_node_s * const g_level0info[] =
   &g_loadavg,      /* Average CPU utilization */
 #endif
   &g_stack,        /* Task stack info */
+#ifdef CONFIG_SCHED_CPUACCT
+  &g_cpuacct,      /* Task CPU accounting */
+#endif
   &g_group,        /* Group directory */
 };
 #define PROC_NLEVEL0NODES (sizeof(g_level0info)/sizeof(FAR const struct proc_node_s * const))
@@ -631,13 +652,13 @@ static ssize_t proc_stack(FAR struct proc_file_s *procfile,
   buffer    += copysize;
   remaining -= copysize;
 
-#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
   if (totalsize >= buflen)
     {
       return totalsize;
     }
 
-  /* Show the stack size */
+  /* Show the stack high-water mark */
 
   linesize   = snprintf(procfile->line, STATUS_LINELEN, "%-12s%ld\n",
                         "StackUsed:", (long)up_check_tcbstack(tcb));
@@ -651,6 +672,82 @@ static ssize_t proc_stack(FAR struct proc_file_s *procfile,
   return totalsize;
 }
 
+/****************************************************************************
+ * Name: proc_cpuacct
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_CPUACCT
+static ssize_t proc_cpuacct(FAR struct proc_file_s *procfile,
+                            FAR struct tcb_s *tcb, FAR char *buffer,
+                            size_t buflen, off_t offset)
+{
+  struct cpuacct_s acct;
+  size_t remaining;
+  size_t linesize;
+  size_t copysize;
+  size_t totalsize;
+
+  (void)sched_cpuacct(tcb->pid, &acct);
+
+  remaining = buflen;
+  totalsize = 0;
+
+  /* Show the run time and the interrupt time, in seconds to the
+   * microsecond.
+   */
+
+  linesize   = snprintf(procfile->line, STATUS_LINELEN, "%-12s%lu.%06lu\n",
+                        "RunTime:", (unsigned long)(acct.run_usec / USEC_PER_SEC),
+                        (unsigned long)(acct.run_usec % USEC_PER_SEC));
+  copysize   = procfs_memcpy(procfile->line, linesize, buffer, remaining, &offset);
+
+  totalsize += copysize;
+  buffer    += copysize;
+  remaining -= copysize;
+
+  if (totalsize >= buflen)
+    {
+      return totalsize;
+    }
+
+  linesize   = snprintf(procfile->line, STATUS_LINELEN, "%-12s%lu.%06lu\n",
+                        "IrqTime:", (unsigned long)(acct.irq_usec / USEC_PER_SEC),
+                        (unsigned long)(acct.irq_usec % USEC_PER_SEC));
+  copysize   = procfs_memcpy(procfile->line, linesize, buffer, remaining, &offset);
+
+  totalsize += copysize;
+  buffer    += copysize;
+  remaining -= copysize;
+
+  if (totalsize >= buflen)
+    {
+      return totalsize;
+    }
+
+  /* Show the context switches away from the task */
+
+  linesize   = snprintf(procfile->line, STATUS_LINELEN, "%-12s%lu\n",
+                        "Voluntary:", (unsigned long)acct.nvcsw);
+  copysize   = procfs_memcpy(procfile->line, linesize, buffer, remaining, &offset);
+
+  totalsize += copysize;
+  buffer    += copysize;
+  remaining -= copysize;
+
+  if (totalsize >= buflen)
+    {
+      return totalsize;
+    }
+
+  linesize   = snprintf(procfile->line, STATUS_LINELEN, "%-12s%lu\n",
+                        "Preempted:", (unsigned long)acct.nivcsw);
+  copysize   = procfs_memcpy(procfile->line, linesize, buffer, remaining, &offset);
+
+  totalsize += copysize;
+  return totalsize;
+}
+#endif
+
 /****************************************************************************
  * Name: proc_groupstatus
  ****************************************************************************/
@@ -825,11 +922,12 @@ static ssize_t proc_groupfd(FAR struct proc_file_s *procfile,
 
   /* Examine each open file descriptor */
 
-  for (i = 0, file = group->tg_filelist.fl_files; i < CONFIG_NFILE_DESCRIPTORS; i++, file++)
+  for (i = 0; i < CONFIG_NFILE_DESCRIPTORS; i++)
     {
       /* Is there an inode associated with the file descriptor? */
 
-      if (file->f_inode)
+      file = files_fdfile(&group->tg_filelist, i);
+      if (file && file->f_inode)
         {
           linesize   = snprintf(procfile->line, STATUS_LINELEN, "%3d %8ld %04x\n",
                                 i, (long)file->f_pos, file->f_oflags);
@@ -1068,6 +1166,12 @@ static ssize_t proc_read(FAR struct file *filep, FAR char *buffer,
       ret = proc_stack(procfile, tcb, buffer, buflen, filep->f_pos);
       break;
 
+#ifdef CONFIG_SCHED_CPUACCT
+    case PROC_CPUACCT: /* Task CPU accounting */
+      ret = proc_cpuacct(procfile, tcb, buffer, buflen, filep->f_pos);
+      break;
+#endif
+
     case PROC_GROUP_STATUS: /* Task group status */
       ret = proc_groupstatus(procfile, tcb, buffer, buflen, filep->f_pos);
       break;
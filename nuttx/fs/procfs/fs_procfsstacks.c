@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/sched.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS)
+#if defined(CONFIG_STACK_USAGE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_STACKS)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define STACKS_LINELEN 64
+
+/* Suggested size: the high-water mark plus the margin, rounded up to the
+ * 8 bytes of the stack alignment.
+ */
+
+#define STACKS_SUGGEST(used) \
+  ((((used) * (100 + CONFIG_STACK_USAGE_MARGIN) / 100) + 7) & ~7)
+
+#if CONFIG_TASK_NAME_SIZE > 0
+#  define STACKS_NAMELEN CONFIG_TASK_NAME_SIZE
+#else
+#  define STACKS_NAMELEN 1
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct stacks_entry_s
+{
+  pid_t pid;
+  char type;
+  size_t size;
+  size_t used;
+  char name[STACKS_NAMELEN];
+};
+
+/* The stacks are measured when the file is opened, so that the report does
+ * not change between its reads.
+ */
+
+struct stacks_file_s
+{
+  struct procfs_file_s base;
+  int nentries;
+  struct stacks_entry_s entries[CONFIG_MAX_TASKS];
+  char line[STACKS_LINELEN];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: stacks_measure
+ *
+ * Description:
+ *   sched_foreach() callback recording the stack of one thread.  It runs
+ *   with the interrupts disabled, which keeps the stack from being freed
+ *   while it is scanned.
+ *
+ ****************************************************************************/
+
+static void stacks_measure(FAR struct tcb_s *tcb, FAR void *arg)
+{
+  FAR struct stacks_file_s *priv = arg;
+  FAR struct stacks_entry_s *entry;
+
+  if (priv->nentries >= CONFIG_MAX_TASKS)
+    {
+      return;
+    }
+
+  entry       = &priv->entries[priv->nentries++];
+  entry->pid  = tcb->pid;
+  entry->size = tcb->adj_stack_size;
+  entry->used = up_check_tcbstack(tcb);
+
+  switch (tcb->flags & TCB_FLAG_TTYPE_MASK)
+    {
+      case TCB_FLAG_TTYPE_KERNEL:
+        entry->type = 'K';
+        break;
+
+      case TCB_FLAG_TTYPE_PTHREAD:
+        entry->type = 'P';
+        break;
+
+      default:
+        entry->type = 'T';
+        break;
+    }
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  strncpy(entry->name, tcb->name, STACKS_NAMELEN - 1);
+#endif
+}
+
+/****************************************************************************
+ * Name: stacks_copy
+ *
+ * Description:
+ *   Copy the part of a line of the report which lies past the file offset.
+ *   Returns false once the user buffer is full.
+ *
+ ****************************************************************************/
+
+static bool stacks_copy(FAR char *line, size_t linesize,
+                        FAR char **buffer, FAR size_t *remaining,
+                        FAR off_t *offset, FAR size_t *total)
+{
+  size_t copysize;
+
+  if (linesize >= STACKS_LINELEN)
+    {
+      linesize = STACKS_LINELEN - 1;
+    }
+
+  copysize    = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+  *buffer    += copysize;
+  *remaining -= copysize;
+  *total     += copysize;
+
+  return *remaining > 0;
+}
+
+/****************************************************************************
+ * Name: stacks_open
+ ****************************************************************************/
+
+static int stacks_open(FAR struct file *filep, FAR const char *relpath,
+                       int oflags, mode_t mode)
+{
+  FAR struct stacks_file_s *priv;
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      return -EACCES;
+    }
+
+  if (strcmp(relpath, "stacks") != 0)
+    {
+      return -ENOENT;
+    }
+
+  priv = kmm_zalloc(sizeof(*priv));
+  if (!priv)
+    {
+      return -ENOMEM;
+    }
+
+  sched_foreach(stacks_measure, priv);
+
+  filep->f_priv = priv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: stacks_close
+ ****************************************************************************/
+
+static int stacks_close(FAR struct file *filep)
+{
+  DEBUGASSERT(filep->f_priv);
+
+  kmm_free(filep->f_priv);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: stacks_read
+ *
+ * Description:
+ *   Format the report: for each thread, its type (Task, Pthread or Kernel
+ *   thread), stack size, high-water mark and suggested stack size.
+ *
+ ****************************************************************************/
+
+static ssize_t stacks_read(FAR struct file *filep, FAR char *buffer,
+                           size_t buflen)
+{
+  FAR struct stacks_file_s *priv = filep->f_priv;
+  FAR struct stacks_entry_s *entry;
+  off_t offset = filep->f_pos;
+  size_t remaining = buflen;
+  size_t total = 0;
+  size_t linesize;
+  int i;
+
+  DEBUGASSERT(priv);
+
+  linesize = snprintf(priv->line, STACKS_LINELEN,
+                      "  PID T   SIZE   USED SUGGEST NAME\n");
+  if (!stacks_copy(priv->line, linesize, &buffer, &remaining, &offset,
+                   &total))
+    {
+      goto out;
+    }
+
+  for (i = 0; i < priv->nentries; i++)
+    {
+      entry = &priv->entries[i];
+
+      /* A stack used up to its end has most likely overflowed: there is
+       * nothing to suggest from it.
+       */
+
+      if (entry->used >= entry->size)
+        {
+          linesize = snprintf(priv->line, STACKS_LINELEN,
+                              "%5d %c %6u %6u    FULL %s\n", entry->pid,
+                              entry->type, entry->size, entry->used,
+                              entry->name);
+        }
+      else
+        {
+          linesize = snprintf(priv->line, STACKS_LINELEN,
+                              "%5d %c %6u %6u %7u %s\n", entry->pid,
+                              entry->type, entry->size, entry->used,
+                              STACKS_SUGGEST(entry->used), entry->name);
+        }
+
+      if (!stacks_copy(priv->line, linesize, &buffer, &remaining, &offset,
+                       &total))
+        {
+          goto out;
+        }
+    }
+
+#if CONFIG_ARCH_INTERRUPTSTACK > 3
+  linesize = snprintf(priv->line, STACKS_LINELEN,
+                      "    - I %6u %6u %7u irq\n",
+                      CONFIG_ARCH_INTERRUPTSTACK & ~3, up_check_intstack(),
+                      STACKS_SUGGEST(up_check_intstack()));
+  (void)stacks_copy(priv->line, linesize, &buffer, &remaining, &offset,
+                    &total);
+#endif
+
+out:
+  filep->f_pos += total;
+  return total;
+}
+
+/****************************************************************************
+ * Name: stacks_dup
+ ****************************************************************************/
+
+static int stacks_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct stacks_file_s *newpriv;
+
+  DEBUGASSERT(oldp->f_priv);
+
+  newpriv = kmm_malloc(sizeof(*newpriv));
+  if (!newpriv)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+  newp->f_priv = newpriv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: stacks_stat
+ ****************************************************************************/
+
+static int stacks_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  if (strcmp(relpath, "stacks") != 0)
+    {
+      return -ENOENT;
+    }
+
+  memset(buf, 0, sizeof(*buf));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+const struct procfs_operations stacks_operations =
+{
+  .open  = stacks_open,
+  .close = stacks_close,
+  .read  = stacks_read,
+  .dup   = stacks_dup,
+  .stat  = stacks_stat,
+};
+
+#endif /* CONFIG_STACK_USAGE && !CONFIG_FS_PROCFS_EXCLUDE_STACKS */
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS */
@@ -345,6 +345,7 @@ static ssize_t romfs_read(FAR struct file *filep, FAR char *buffer,
   off_t                       sector;
   FAR uint8_t                *userbuffer = (FAR uint8_t*)buffer;
   int                         sectorndx;
+  unsigned int                cachendx;
   int                         ret;
 
   fvdbg("Read %d bytes from offset %d\n", buflen, filep->f_pos);
@@ -437,6 +438,11 @@ static ssize_t romfs_read(FAR struct file *filep, FAR char *buffer,
               goto errout_with_semaphore;
             }
 
+          /* The buffer may begin with an earlier sector */
+
+          cachendx = (sector - rf->rf_cachesector) * rm->rm_hwsectorsize +
+                     sectorndx;
+
           /* Copy the partial sector into the user buffer */
 
           bytesread = rm->rm_hwsectorsize - sectorndx;
@@ -454,7 +460,7 @@ static ssize_t romfs_read(FAR struct file *filep, FAR char *buffer,
             }
 
           fvdbg("Return %d bytes from sector offset %d\n", bytesread, sectorndx);
-          memcpy(userbuffer, &rf->rf_buffer[sectorndx], bytesread);
+          memcpy(userbuffer, &rf->rf_buffer[cachendx], bytesread);
         }
 
       /* Set up for the next sector read */
@@ -119,6 +119,12 @@
 #define SEC_NSECTORS(r,o)    ((o) / (r)->rm_hwsectorsize)
 #define SEC_ALIGN(r,o)       ((o) & ~SEC_NDXMASK(r))
 
+/* Number of sectors read ahead into a file buffer */
+
+#ifndef CONFIG_FS_ROMFS_READAHEAD
+#  define CONFIG_FS_ROMFS_READAHEAD 1
+#endif
+
 /* Maximum numbr of links that will be followed before we decide that there
  * is a problem.
  */
@@ -161,7 +167,9 @@ struct romfs_file_s
   struct romfs_file_s *rf_next;     /* Retained in a singly linked list */
   uint32_t rf_startoffset;          /* Offset to the start of the file data */
   uint32_t rf_size;                 /* Size of the file in bytes */
-  uint32_t rf_cachesector;          /* Current sector in the rf_buffer */
+  uint32_t rf_cachesector;          /* First sector in the rf_buffer */
+  uint16_t rf_nbufsectors;          /* Capacity of the rf_buffer in sectors */
+  uint16_t rf_ncached;              /* Number of sectors in the rf_buffer */
   uint8_t *rf_buffer;               /* File sector buffer, allocated if rm_xipbase==0 */
 };
 
@@ -451,18 +451,21 @@ int romfs_hwread(struct romfs_mountpt_s *rm, uint8_t *buffer, uint32_t sector,
 int romfs_filecacheread(struct romfs_mountpt_s *rm, struct romfs_file_s *rf,
                         uint32_t sector)
 {
+  uint32_t lastsector;
+  uint32_t nsectors;
   int ret;
 
   fvdbg("sector: %d cached: %d sectorsize: %d XIP base: %p buffer: %p\n",
         sector, rf->rf_cachesector, rm->rm_hwsectorsize,
         rm->rm_xipbase, rf->rf_buffer);
 
-  /* rf->rf_cachesector holds the current sector that is buffer in or referenced
-   * by rf->rf_buffer. If the requested sector is the same as this sector,
-   * then we do nothing.
+  /* rf->rf_cachesector holds the first of the rf->rf_ncached sectors that
+   * are buffered in or referenced by rf->rf_buffer. If the requested sector
+   * is one of these, then we do nothing.
    */
 
-  if (rf->rf_cachesector != sector)
+  if (sector < rf->rf_cachesector ||
+      sector >= rf->rf_cachesector + rf->rf_ncached)
     {
       /* Check the access mode */
 
@@ -474,13 +477,30 @@ int romfs_filecacheread(struct romfs_mountpt_s *rm, struct romfs_file_s *rf,
 
           rf->rf_buffer = rm->rm_xipbase + sector * rm->rm_hwsectorsize;
           fvdbg("XIP buffer: %p\n", rf->rf_buffer);
+          nsectors = 1;
         }
       else
         {
-          /* In non-XIP mode, we will have to read the new sector.*/
+          /* In non-XIP mode, we will have to read the new sector and, as
+           * far as the buffer allows, the sectors that follow it up to the
+           * end of the file.
+           */
+
+          lastsector = SEC_NSECTORS(rm, rf->rf_startoffset + rf->rf_size - 1);
+          if (lastsector >= rm->rm_hwnsectors)
+            {
+              lastsector = rm->rm_hwnsectors - 1;
+            }
+
+          nsectors = rf->rf_nbufsectors;
+          if (sector + nsectors > lastsector + 1)
+            {
+              nsectors = sector <= lastsector ? lastsector + 1 - sector : 1;
+            }
 
           fvdbg("Calling romfs_hwread\n");
-          ret = romfs_hwread(rm, rf->rf_buffer, sector, 1);
+          rf->rf_ncached = 0;
+          ret = romfs_hwread(rm, rf->rf_buffer, sector, nsectors);
           if (ret < 0)
             {
               fdbg("romfs_hwread failed: %d\n", ret);
@@ -488,9 +508,10 @@ int romfs_filecacheread(struct romfs_mountpt_s *rm, struct romfs_file_s *rf,
             }
         }
 
-      /* Update the cached sector number */
+      /* Update the cached sector numbers */
 
       rf->rf_cachesector = sector;
+      rf->rf_ncached     = nsectors;
     }
 
   return OK;
@@ -629,6 +650,8 @@ int romfs_fsconfigure(struct romfs_mountpt_s *rm)
 
 int romfs_fileconfigure(struct romfs_mountpt_s *rm, struct romfs_file_s *rf)
 {
+  uint32_t nsectors;
+
   /* Check if XIP access mode is supported.  If so, then we do not need
    * to allocate anything.
    */
@@ -638,6 +661,7 @@ int romfs_fileconfigure(struct romfs_mountpt_s *rm, struct romfs_file_s *rf)
       /* We'll put a valid address in rf_buffer just in case. */
 
       rf->rf_cachesector = 0;
+      rf->rf_ncached     = 1;
       rf->rf_buffer      = rm->rm_xipbase;
     }
   else
@@ -645,10 +669,27 @@ int romfs_fileconfigure(struct romfs_mountpt_s *rm, struct romfs_file_s *rf)
       /* Nothing in the cache buffer */
 
       rf->rf_cachesector = (uint32_t)-1;
+      rf->rf_ncached     = 0;
+
+      /* Create a file buffer to support partial sector accesses.  It holds
+       * up to CONFIG_FS_ROMFS_READAHEAD sectors, but no more than the file
+       * spans.
+       */
 
-      /* Create a file buffer to support partial sector accesses */
+      nsectors = SEC_NSECTORS(rm, rf->rf_startoffset + rf->rf_size +
+                              SEC_NDXMASK(rm)) -
+                 SEC_NSECTORS(rm, rf->rf_startoffset);
+      if (nsectors > CONFIG_FS_ROMFS_READAHEAD)
+        {
+          nsectors = CONFIG_FS_ROMFS_READAHEAD;
+        }
+      else if (nsectors < 1)
+        {
+          nsectors = 1;
+        }
 
-      rf->rf_buffer = (uint8_t*)kmm_malloc(rm->rm_hwsectorsize);
+      rf->rf_nbufsectors = nsectors;
+      rf->rf_buffer = (uint8_t*)kmm_malloc(nsectors * rm->rm_hwsectorsize);
       if (!rf->rf_buffer)
         {
           return -ENOMEM;
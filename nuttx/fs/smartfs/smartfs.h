@@ -201,6 +201,10 @@
 #define   CONFIG_SMARTFS_DIRDEPTH 8
 #endif
 
+#ifndef CONFIG_SMARTFS_DIRCACHE_SIZE
+#define   CONFIG_SMARTFS_DIRCACHE_SIZE 0
+#endif
+
 #define SMARTFS_ERASEDSTATE_16BIT (uint16_t) ((CONFIG_SMARTFS_ERASEDSTATE << 8) | \
                                     CONFIG_SMARTFS_ERASEDSTATE)
 
@@ -280,6 +284,19 @@ struct smartfs_ofile_s
                                           * causes the sector to change. */
 };
 
+/* This structure caches the result of looking up a directory by name in its
+ * parent directory.  An entry is unused if its name is empty.
+ */
+
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+struct smartfs_dircache_s
+{
+  uint16_t          parent;       /* First sector of the parent directory */
+  uint16_t          sector;       /* First sector of the directory */
+  char              name[CONFIG_SMARTFS_MAXNAMLEN + 1];
+};
+#endif
+
 /* This structure represents the overall mountpoint state.  An instance of this
  * structure is retained as inode private data on each mountpoint that is
  * mounted with a smartfs filesystem.
@@ -298,6 +315,10 @@ struct smartfs_mountpt_s
   char                       *fs_rwbuffer;  /* Read/Write working buffer */
   char                       *fs_workbuffer;/* Working buffer */
   uint8_t                     fs_rootsector;/* Root directory sector num */
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+  uint8_t                     fs_dirnext;   /* Next fs_dircache entry to replace */
+  struct smartfs_dircache_s   fs_dircache[CONFIG_SMARTFS_DIRCACHE_SIZE];
+#endif
 };
 
 /****************************************************************************
@@ -342,6 +363,12 @@ int smartfs_countdirentries(struct smartfs_mountpt_s *fs,
 int smartfs_truncatefile(struct smartfs_mountpt_s *fs,
         struct smartfs_entry_s *entry);
 
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+void smartfs_invaldircache(struct smartfs_mountpt_s *fs);
+#else
+#  define smartfs_invaldircache(fs)
+#endif
+
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_SMARTFS)
 struct smartfs_mountpt_s* smartfs_get_first_mount(void);
 #endif
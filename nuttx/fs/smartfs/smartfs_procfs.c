@@ -71,6 +71,10 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Number of buckets in the "wear" erase count distribution */
+
+#define SMARTFS_WEAR_NBUCKETS   8
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -142,6 +146,10 @@ static size_t   smartfs_mem_read(FAR struct file *filep, FAR char *buffer,
 static size_t   smartfs_erasemap_read(FAR struct file *filep, FAR char *buffer,
                   size_t buflen);
 #endif
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+static size_t   smartfs_wear_read(FAR struct file *filep, FAR char *buffer,
+                  size_t buflen);
+#endif
 #ifdef CONFIG_SMARTFS_FILE_SECTOR_DEBUG
 static size_t   smartfs_files_read(FAR struct file *filep, FAR char *buffer,
                   size_t buflen);
@@ -159,7 +167,10 @@ static const struct smartfs_procfs_entry_s g_direntry[] =
 #ifdef CONFIG_MTD_SMART_ALLOC_DEBUG
   { "mem",      smartfs_mem_read, DTYPE_FILE },
 #endif
-  { "status",   smartfs_status_read, DTYPE_FILE }
+  { "status",   smartfs_status_read, DTYPE_FILE },
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  { "wear",     smartfs_wear_read, DTYPE_FILE },
+#endif
 };
 
 static const uint8_t g_direntrycount = sizeof(g_direntry) /
@@ -933,6 +944,118 @@ static size_t   smartfs_erasemap_read(FAR struct file *filep, FAR char *buffer,
 }
 #endif
 
+/****************************************************************************
+ * Name: smartfs_wear_read
+ *
+ * Description: Performs the read operation for the "wear" dir entry.
+ *              Reports the spread of the erase counts of the erase blocks
+ *              and how they are distributed between the least and the most
+ *              erased block.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+static size_t   smartfs_wear_read(FAR struct file *filep, FAR char *buffer,
+                  size_t buflen)
+{
+  struct mtd_smart_procfs_data_s procfs_data;
+  FAR struct smartfs_file_s *priv;
+  uint16_t  hist[SMARTFS_WEAR_NBUCKETS];
+  uint32_t  total;
+  uint32_t  range;
+  uint16_t  minerases;
+  uint16_t  maxerases;
+  uint16_t  x;
+  int       ret;
+  int       bucket;
+  size_t    len;
+
+  priv = (FAR struct smartfs_file_s *) filep->f_priv;
+
+  /* Initialize the read length to zero and test if we are at the
+   * end of the file (i.e. already read the data.
+   */
+
+  len = 0;
+  if (priv->offset == 0)
+    {
+      /* Get the ProcFS data from the block driver */
+
+      ret = priv->level1.mount->fs_blkdriver->u.i_bops->ioctl(
+          priv->level1.mount->fs_blkdriver, BIOC_GETPROCFSD,
+          (unsigned long) &procfs_data);
+
+      if (ret == OK && procfs_data.nwearblocks > 0)
+        {
+          /* Find the least and most erased blocks */
+
+          minerases = 0xFFFF;
+          maxerases = 0;
+          total = 0;
+          for (x = 0; x < procfs_data.nwearblocks; x++)
+            {
+              if (procfs_data.wearcounts[x] < minerases)
+                {
+                  minerases = procfs_data.wearcounts[x];
+                }
+
+              if (procfs_data.wearcounts[x] > maxerases)
+                {
+                  maxerases = procfs_data.wearcounts[x];
+                }
+
+              total += procfs_data.wearcounts[x];
+            }
+
+          /* Sort the blocks into equal buckets between those two */
+
+          memset(hist, 0, sizeof(hist));
+          range = maxerases - minerases + 1;
+          for (x = 0; x < procfs_data.nwearblocks; x++)
+            {
+              bucket = (procfs_data.wearcounts[x] - minerases) *
+                       SMARTFS_WEAR_NBUCKETS / range;
+              hist[bucket]++;
+            }
+
+          len = snprintf(buffer, buflen, "Block Erases:      %d\nErase Blocks:      %d\n"
+                                         "Min Erases:        %d\nMax Erases:        %d\n"
+                                         "Avg Erases:        %d\n",
+                  procfs_data.blockerases, procfs_data.nwearblocks,
+                  minerases, maxerases, total / procfs_data.nwearblocks);
+
+          for (bucket = 0; bucket < SMARTFS_WEAR_NBUCKETS && len < buflen;
+               bucket++)
+            {
+              /* Buckets are empty and unprintable when range < NBUCKETS */
+
+              if (range * (bucket + 1) / SMARTFS_WEAR_NBUCKETS ==
+                  range * bucket / SMARTFS_WEAR_NBUCKETS)
+                {
+                  continue;
+                }
+
+              len += snprintf(&buffer[len], buflen - len, "  %5d-%-5d %d\n",
+                  minerases + range * bucket / SMARTFS_WEAR_NBUCKETS,
+                  minerases + range * (bucket + 1) / SMARTFS_WEAR_NBUCKETS - 1,
+                  hist[bucket]);
+            }
+
+          if (len > buflen)
+            {
+              len = buflen;
+            }
+        }
+
+      /* Indicate we have already provided all the data */
+
+      priv->offset = 0xFF;
+    }
+
+  return len;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1846,7 +1846,11 @@ int smartfs_rename(struct inode *mountpt, const char *oldrelpath,
           goto errout_with_semaphore;
         }
 
-      /* Now mark the old entry as inactive */
+      /* Now mark the old entry as inactive.  If it was a directory, a
+       * cached lookup of it is no longer valid.
+       */
+
+      smartfs_invaldircache(fs);
 
       readwrite.logsector = oldentry.dsector;
       readwrite.offset = 0;
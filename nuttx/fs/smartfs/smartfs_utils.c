@@ -85,6 +85,71 @@ static struct smartfs_mountpt_s* g_mounthead = NULL;
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: smartfs_finddircache
+ *
+ * Description: Looks up a directory named by the NUL terminated name in
+ *              the directory starting at the parent sector.  Returns the
+ *              first sector of the directory, or 0xFFFF if not cached.
+ *
+ ****************************************************************************/
+
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+static uint16_t smartfs_finddircache(struct smartfs_mountpt_s *fs,
+        uint16_t parent, const char *name)
+{
+  int x;
+
+  if (strlen(name) > CONFIG_SMARTFS_MAXNAMLEN)
+    {
+      return 0xFFFF;
+    }
+
+  for (x = 0; x < CONFIG_SMARTFS_DIRCACHE_SIZE; x++)
+    {
+      if (fs->fs_dircache[x].name[0] != '\0' &&
+          fs->fs_dircache[x].parent == parent &&
+          strncmp(fs->fs_dircache[x].name, name,
+                  fs->fs_llformat.namesize) == 0)
+        {
+          return fs->fs_dircache[x].sector;
+        }
+    }
+
+  return 0xFFFF;
+}
+
+/****************************************************************************
+ * Name: smartfs_adddircache
+ *
+ * Description: Remembers the directory found by looking up name in the
+ *              directory starting at the parent sector, replacing the
+ *              entries in round-robin order.
+ *
+ ****************************************************************************/
+
+static void smartfs_adddircache(struct smartfs_mountpt_s *fs,
+        uint16_t parent, const char *name, uint16_t sector)
+{
+  struct smartfs_dircache_s *slot;
+
+  if (strlen(name) > CONFIG_SMARTFS_MAXNAMLEN)
+    {
+      return;
+    }
+
+  slot = &fs->fs_dircache[fs->fs_dirnext];
+  if (++fs->fs_dirnext >= CONFIG_SMARTFS_DIRCACHE_SIZE)
+    {
+      fs->fs_dirnext = 0;
+    }
+
+  slot->parent = parent;
+  slot->sector = sector;
+  strcpy(slot->name, name);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -506,6 +571,30 @@ int smartfs_finddirentry(struct smartfs_mountpt_s *fs,
         }
       else
         {
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+          /* An intermediate directory may have been looked up before */
+
+          dirsector = 0xFFFF;
+          if (*ptr == '/')
+            {
+              dirsector = smartfs_finddircache(fs, dirstack[depth],
+                                               fs->fs_workbuffer);
+            }
+
+          if (dirsector != 0xFFFF)
+            {
+              if (depth >= CONFIG_SMARTFS_DIRDEPTH - 1)
+                {
+                  ret = -ENAMETOOLONG;
+                  goto errout;
+                }
+
+              dirstack[++depth] = dirsector;
+              segment = ptr + 1;
+              continue;
+            }
+#endif
+
           /* Search for the entry in the current directory */
 
           dirsector = dirstack[depth];
@@ -653,6 +742,11 @@ int smartfs_finddirentry(struct smartfs_mountpt_s *fs,
                               goto errout;
                             }
 
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+                          smartfs_adddircache(fs, dirstack[depth],
+                                              fs->fs_workbuffer,
+                                              entry->firstsector);
+#endif
                           dirstack[++depth] = entry->firstsector;
                           segment = ptr + 1;
                           break;
@@ -960,6 +1054,10 @@ int smartfs_deleteentry(struct smartfs_mountpt_s *fs,
   struct smartfs_chain_header_s  *header;
   struct smart_read_write_s       readwrite;
 
+  /* A deleted directory must no longer be found through the cache */
+
+  smartfs_invaldircache(fs);
+
   /* Okay, delete the file.  Loop through each sector and release them
 
    * TODO:  We really should walk the list backward to avoid lost
@@ -1305,6 +1403,26 @@ errout:
   return ret;
 }
 
+/****************************************************************************
+ * Name: smartfs_invaldircache
+ *
+ * Description: Forgets all cached directory lookups.  This must be called
+ *              whenever a directory entry is removed or renamed.
+ *
+ ****************************************************************************/
+
+#if CONFIG_SMARTFS_DIRCACHE_SIZE > 0
+void smartfs_invaldircache(struct smartfs_mountpt_s *fs)
+{
+  int x;
+
+  for (x = 0; x < CONFIG_SMARTFS_DIRCACHE_SIZE; x++)
+    {
+      fs->fs_dircache[x].name[0] = '\0';
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: smartfs_get_first_mount
  *
@@ -40,6 +40,10 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <sys/types.h>
 #include <stdint.h>
 
 /**************************************************************************
@@ -181,6 +185,20 @@
 #  define ub16divub16(a,b) ub16toub32(a)/(ub32_t)(b)
 #endif
 
+/* Q15 and Q31 fractional values in [-1, 1) *******************************/
+
+#define q15MAX          0x7fff                  /* Max value of q15_t */
+#define q15MIN          (-0x7fff - 1)           /* Min value of q15_t */
+#define q31MAX          0x7fffffff              /* Max value of q31_t */
+#define q31MIN          (-0x7fffffff - 1)       /* Min value of q31_t */
+
+#define q15tof(q)       (((float)(q))/32768.0)  /* Conversion to float */
+#define ftoq15(f)       (q15_t)((f)*32768.0)    /* Conversion from float */
+#define q31tof(q)       (((float)(q))/2147483648.0)
+#define ftoq31(f)       (q31_t)((f)*2147483648.0)
+#define q15toq31(q)     (((q31_t)(q)) << 16)    /* Q15 to Q31 */
+#define q31toq15(q)     (q15_t)((q) >> 16)      /* Q31 to Q15 (truncating) */
+
 /**************************************************************************
  * Public Types
  **************************************************************************/
@@ -194,6 +212,57 @@ typedef int64_t  b32_t;
 typedef uint64_t ub32_t;
 #endif
 
+typedef int16_t  q15_t;
+typedef int32_t  q31_t;
+
+#ifdef CONFIG_HAVE_LONG_LONG
+/* FIR filter instance.  The state buffer holds 2 * ntaps samples: every
+ * input sample is stored twice so that the last ntaps samples are always
+ * contiguous, newest first, and can be fed to the dot product as is.
+ */
+
+struct q15fir_s
+{
+  FAR const q15_t *coeffs;  /* ntaps coefficients, h[0] first */
+  FAR q15_t *state;         /* 2 * ntaps samples */
+  uint16_t ntaps;           /* Number of taps */
+  uint16_t pos;             /* Position of the newest sample in state */
+};
+
+struct q31fir_s
+{
+  FAR const q31_t *coeffs;  /* ntaps coefficients, h[0] first */
+  FAR q31_t *state;         /* 2 * ntaps samples */
+  uint16_t ntaps;           /* Number of taps */
+  uint16_t pos;             /* Position of the newest sample in state */
+};
+
+/* Cascade of direct form I biquads.  Each stage computes
+ *
+ *   y[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] + a1 * y[n-1] + a2 * y[n-2]
+ *
+ * Note the sign of a1 and a2: they are the negated denominator
+ * coefficients.  The coefficients are stored as { b0, b1, b2, a1, a2 } for
+ * each stage, scaled down by 2^postshift so that they fit in [-1, 1).
+ */
+
+struct q15biquad_s
+{
+  FAR const q15_t *coeffs;  /* 5 coefficients per stage */
+  FAR q15_t *state;         /* x[n-1], x[n-2], y[n-1], y[n-2] per stage */
+  uint8_t nstages;          /* Number of cascaded stages */
+  uint8_t postshift;        /* Coefficient scaling */
+};
+
+struct q31biquad_s
+{
+  FAR const q31_t *coeffs;  /* 5 coefficients per stage */
+  FAR q31_t *state;         /* x[n-1], x[n-2], y[n-1], y[n-2] per stage */
+  uint8_t nstages;          /* Number of cascaded stages */
+  uint8_t postshift;        /* Coefficient scaling */
+};
+#endif
+
 /**************************************************************************
  * Global Functions
  **************************************************************************/
@@ -219,6 +288,42 @@ EXTERN b16_t b16sin(b16_t rad);
 EXTERN b16_t b16cos(b16_t rad);
 EXTERN b16_t b16atan2(b16_t y, b16_t x);
 
+/* Q15/Q31 DSP routines.  On Cortex-M4 the multiply-accumulate loops use
+ * the DSP extension (SMLAD/SMLALD), other architectures use plain C.
+ */
+
+#ifdef CONFIG_HAVE_LONG_LONG
+EXTERN int64_t q15dot(FAR const q15_t *a, FAR const q15_t *b, size_t n);
+EXTERN int64_t q31dot(FAR const q31_t *a, FAR const q31_t *b, size_t n);
+
+EXTERN q15_t q15rms(FAR const q15_t *x, size_t n);
+EXTERN q31_t q31rms(FAR const q31_t *x, size_t n);
+EXTERN q15_t q15sqrt(q15_t x);
+EXTERN q31_t q31sqrt(q31_t x);
+EXTERN q15_t q15recip(q15_t x, FAR int *shift);
+EXTERN q31_t q31recip(q31_t x, FAR int *shift);
+
+EXTERN void q15fir_init(FAR struct q15fir_s *fir, FAR const q15_t *coeffs,
+                        FAR q15_t *state, uint16_t ntaps);
+EXTERN void q15fir(FAR struct q15fir_s *fir, FAR const q15_t *in,
+                   FAR q15_t *out, size_t n);
+EXTERN void q31fir_init(FAR struct q31fir_s *fir, FAR const q31_t *coeffs,
+                        FAR q31_t *state, uint16_t ntaps);
+EXTERN void q31fir(FAR struct q31fir_s *fir, FAR const q31_t *in,
+                   FAR q31_t *out, size_t n);
+
+EXTERN void q15biquad_init(FAR struct q15biquad_s *bq,
+                           FAR const q15_t *coeffs, FAR q15_t *state,
+                           uint8_t nstages, uint8_t postshift);
+EXTERN void q15biquad(FAR struct q15biquad_s *bq, FAR const q15_t *in,
+                      FAR q15_t *out, size_t n);
+EXTERN void q31biquad_init(FAR struct q31biquad_s *bq,
+                           FAR const q31_t *coeffs, FAR q31_t *state,
+                           uint8_t nstages, uint8_t postshift);
+EXTERN void q31biquad(FAR struct q31biquad_s *bq, FAR const q31_t *in,
+                      FAR q31_t *out, size_t n);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -181,6 +181,10 @@
 #define _POSIX_SEM_NSEMS_MAX  INT_MAX
 #define _POSIX_SEM_VALUE_MAX  0x7fff
 
+/* Required for vectored I/O (readv, writev) */
+
+#define _XOPEN_IOV_MAX        16
+
 /* Actual limits.  These values may be increased from the POSIX minimum
  * values above or made indeterminate
  */
@@ -224,4 +228,8 @@
 #define SEM_NSEMS_MAX  _POSIX_SEM_NSEMS_MAX
 #define SEM_VALUE_MAX  _POSIX_SEM_VALUE_MAX
 
+/* Required for vectored I/O (readv, writev) */
+
+#define IOV_MAX        _XOPEN_IOV_MAX
+
 #endif /* __INCLUDE_LIMITS_H */
@@ -135,6 +135,56 @@ uint32_t codec_read(uint32_t reg, uint32_t *value);
 uint32_t codec_write(uint32_t reg, uint32_t value);
 uint32_t codec_update(uint32_t reg, uint32_t value, uint32_t mask);
 
+/**
+ * one register write of a batch
+ */
+struct codec_reg_write {
+    /** register address */
+    uint32_t reg;
+    /** register value */
+    uint32_t value;
+};
+
+/**
+ * write a batch of registers to the hardware in one bus transaction,
+ * in the given order
+ */
+typedef uint32_t (*codec_write_batch_func)(const struct codec_reg_write *writes,
+                                           int count);
+
+#ifdef CONFIG_DRIVERS_ARA_AUDIO_CODEC_CACHE
+int codec_cache_init(const uint8_t *volatile_regs, int num_volatile,
+                     codec_write_batch_func write_batch);
+void codec_cache_exit(void);
+void codec_cache_invalidate(void);
+void codec_cache_defer(void);
+int codec_cache_sync(void);
+#else
+static inline int codec_cache_init(const uint8_t *volatile_regs,
+                                   int num_volatile,
+                                   codec_write_batch_func write_batch)
+{
+    return 0;
+}
+
+static inline void codec_cache_exit(void)
+{
+}
+
+static inline void codec_cache_invalidate(void)
+{
+}
+
+static inline void codec_cache_defer(void)
+{
+}
+
+static inline int codec_cache_sync(void)
+{
+    return 0;
+}
+#endif
+
 /* codec_xxx_get()/codec_xxx_set() for audio control */
 int codec_dummy_get(struct audio_control *control,
                     struct gb_audio_ctl_elem_value *value);
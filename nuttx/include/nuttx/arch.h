@@ -1327,6 +1327,20 @@ void up_disable_irq(int irq);
 int up_prioritize_irq(int irq, int priority);
 #endif
 
+/****************************************************************************
+ * Name: up_nextpending_irq
+ *
+ * Description:
+ *   Return the lowest numbered IRQ, at or above irq, that is pending at the
+ *   interrupt controller, or -1 if there is none.  This lets the critical
+ *   section monitor tell which interrupts were delayed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+int up_nextpending_irq(int irq);
+#endif
+
 /****************************************************************************
  * Tickless OS Support.
  *
@@ -1867,7 +1881,7 @@ void irq_dispatch(int irq, FAR void *context);
  *
  ****************************************************************************/
 
-#if defined(CONFIG_DEBUG) && defined(CONFIG_DEBUG_STACK)
+#ifdef CONFIG_STACK_USAGE
 struct tcb_s;
 size_t  up_check_tcbstack(FAR struct tcb_s *tcb);
 ssize_t up_check_tcbstack_remain(FAR struct tcb_s *tcb);
@@ -1879,6 +1893,26 @@ size_t  up_check_intstack_remain(void);
 #endif
 #endif
 
+/****************************************************************************
+ * Name: up_boot_timestamp
+ *
+ * Description:
+ *   Return the time elapsed since reset in microseconds.  This must work
+ *   from the very first instruction of the C start-up code, before the
+ *   timers and the interrupts are set up.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned value:
+ *   Microseconds since reset.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_ARCH_HAVE_BOOT_TIMESTAMP
+uint32_t up_boot_timestamp(void);
+#endif
+
 /****************************************************************************
  * Board-specific button interfaces exported by the board-specific logic
  ****************************************************************************/
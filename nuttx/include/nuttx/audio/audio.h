@@ -103,6 +103,23 @@
  * AUDIOIOC_STOP - Stop Audio streaming
  *
  *   ioctl argument:  None
+ *
+ * AUDIOIOC_RINGSETUP - Allocate a ring of buffers shared with the application
+ *
+ *   ioctl argument:  Pointer to the audio_ring_desc_s structure describing
+ *                    the ring and receiving its address.
+ *
+ * AUDIOIOC_RINGKICK - Hand the buffers written to the ring to the lower half
+ *
+ *   ioctl argument:  None
+ *
+ * AUDIOIOC_RINGWAIT - Wait until a buffer of the ring can be written
+ *
+ *   ioctl argument:  None
+ *
+ * AUDIOIOC_RINGRELEASE - Free the ring and its buffers
+ *
+ *   ioctl argument:  None
  */
 
 #define AUDIOIOC_GETCAPS            _AUDIOIOC(1)
@@ -121,6 +138,10 @@
 #define AUDIOIOC_REGISTERMQ         _AUDIOIOC(14)
 #define AUDIOIOC_UNREGISTERMQ       _AUDIOIOC(15)
 #define AUDIOIOC_HWRESET            _AUDIOIOC(16)
+#define AUDIOIOC_RINGSETUP          _AUDIOIOC(17)
+#define AUDIOIOC_RINGKICK           _AUDIOIOC(18)
+#define AUDIOIOC_RINGWAIT           _AUDIOIOC(19)
+#define AUDIOIOC_RINGRELEASE        _AUDIOIOC(20)
 
 /* Audio Device Types *******************************************************/
 /* The NuttX audio interface support different types of audio devices for
@@ -293,6 +314,7 @@
 #define AUDIO_APB_OUTPUT_PROCESS    (1 << 1)
 #define AUDIO_APB_DEQUEUED          (1 << 2)
 #define AUDIO_APB_FINAL             (1 << 3) /* Last buffer in the stream */
+#define AUDIO_APB_RING              (1 << 4) /* Buffer of a shared ring */
 
 /****************************************************************************
  * Public Types
@@ -430,6 +452,42 @@ struct audio_buf_desc_s
   } u;
 };
 
+/* Buffer ring shared between the upper-half driver and the application,
+ * set up with AUDIOIOC_RINGSETUP.  The application fills apb[head %
+ * nbuffers], setting its nbytes, and then increments head: there is no
+ * ioctl or message per buffer.  The upper half hands the written buffers
+ * to the lower half as earlier ones are played, and increments tail as
+ * they are played.  A buffer can be written while head - tail < nbuffers.
+ *
+ * Buffers are only handed over as others complete: when the application
+ * finds queued == tail after incrementing head, nothing is outstanding and
+ * it must issue AUDIOIOC_RINGKICK.  The same is done to prime the ring
+ * before AUDIOIOC_START.
+ */
+
+#ifdef CONFIG_AUDIO_RING
+struct audio_ring_s
+{
+  uint16_t            nbuffers;           /* Number of buffers in the ring */
+  volatile uint32_t   head;               /* Buffers written by the application */
+  volatile uint32_t   queued;             /* Buffers handed to the lower half */
+  volatile uint32_t   tail;               /* Buffers played */
+  FAR struct ap_buffer_s *apb[CONFIG_AUDIO_RING_MAXBUFFERS];
+};
+
+/* Structure passed with AUDIOIOC_RINGSETUP */
+
+struct audio_ring_desc_s
+{
+#ifdef CONFIG_AUDIO_MULTI_SESSION
+  FAR void            *session;           /* Associated channel */
+#endif
+  uint16_t            nbuffers;           /* Number of buffers to allocate */
+  uint16_t            numbytes;           /* Size of each buffer */
+  FAR struct audio_ring_s **ppRing;       /* Pointer to receive the ring */
+};
+#endif
+
 /* Typedef for lower-level to upper-level callback for buffer dequeuing */
 
 #ifdef CONFIG_AUDIO_MULTI_SESSION
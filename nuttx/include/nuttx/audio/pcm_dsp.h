@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * @file pcm_dsp.h
+ * @brief PCM sample conversion, gain and mixing kernels
+ *
+ * All the functions work on little-endian signed samples. 24-bit samples
+ * are packed on 3 bytes. Results are saturated instead of wrapping around.
+ * Gains are unsigned Q16.16 values: PCM_DSP_GAIN_UNITY leaves the samples
+ * unchanged.
+ *
+ * On cores with the DSP extension (Cortex-M4), two 16-bit samples are
+ * processed per instruction. Other cores use the saturation instructions
+ * of ARMv7-M or plain C.
+ */
+
+#ifndef __INCLUDE_NUTTX_AUDIO_PCM_DSP_H
+#define __INCLUDE_NUTTX_AUDIO_PCM_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PCM_DSP_GAIN_UNITY  0x10000
+
+void pcm_s16_to_s32(int32_t *dst, const int16_t *src, size_t samples);
+void pcm_s32_to_s16(int16_t *dst, const int32_t *src, size_t samples);
+void pcm_s24_to_s32(int32_t *dst, const uint8_t *src, size_t samples);
+void pcm_s32_to_s24(uint8_t *dst, const int32_t *src, size_t samples);
+void pcm_s16_to_s24(uint8_t *dst, const int16_t *src, size_t samples);
+void pcm_s24_to_s16(int16_t *dst, const uint8_t *src, size_t samples);
+
+void pcm_interleave_s16(int16_t *dst, const int16_t *left,
+                        const int16_t *right, size_t frames);
+void pcm_deinterleave_s16(int16_t *left, int16_t *right, const int16_t *src,
+                          size_t frames);
+
+void pcm_gain_s16(int16_t *buf, size_t samples, uint32_t gain);
+void pcm_gain_s32(int32_t *buf, size_t samples, uint32_t gain);
+
+void pcm_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b,
+                 size_t samples);
+void pcm_mix_s32(int32_t *dst, const int32_t *a, const int32_t *b,
+                 size_t samples);
+
+#endif /* __INCLUDE_NUTTX_AUDIO_PCM_DSP_H */
@@ -152,6 +152,44 @@ FAR const struct symtab_s *
 symtab_findorderedbyname(FAR const struct symtab_s *symtab,
                          FAR const char *name, int nsyms);
 
+/****************************************************************************
+ * Name: symtab_hashinit
+ *
+ * Description:
+ *   Build the hash index used by symtab_findbyhash() for this symbol table.
+ *   Only one table is indexed at a time; calling this is optional, the
+ *   index is otherwise built by the first lookup.
+ *
+ * Returned Value:
+ *   0 (OK) on success; a negated errno value if the table cannot be
+ *   indexed, in which case symtab_findbyhash() searches it linearly.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYMTAB_HASH
+int symtab_hashinit(FAR const struct symtab_s *symtab, int nsyms);
+#endif
+
+/****************************************************************************
+ * Name: symtab_findbyhash
+ *
+ * Description:
+ *   Find the symbol in the symbol table with the matching name.
+ *   This version uses a hash index over the table, built on first use, so
+ *   access time does not depend on nsyms nor on the table order.
+ *
+ * Returned Value:
+ *   A reference to the symbol table entry if an entry with the matching
+ *   name is found; NULL is returned if the entry is not found.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYMTAB_HASH
+FAR const struct symtab_s *
+symtab_findbyhash(FAR const struct symtab_s *symtab,
+                  FAR const char *name, int nsyms);
+#endif
+
 /****************************************************************************
  * Name: symtab_findbyvalue
  *
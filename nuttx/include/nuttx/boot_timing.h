@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_BOOT_TIMING_H
+#define __INCLUDE_NUTTX_BOOT_TIMING_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* A boot stage and the time, in microseconds since start-up, at which it
+ * was first reached.
+ */
+
+struct boot_mark_s
+{
+  FAR const char *stage;
+  uint32_t usec;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+#ifdef CONFIG_BOOT_TIMING
+
+/****************************************************************************
+ * Name: boot_timing_mark
+ *
+ * Description:
+ *   Record that the boot reached 'stage'.  Only the first time a stage is
+ *   reached is recorded, so that marks may be left in code which also runs
+ *   after the boot.  The stage name is not copied and must be static.
+ *
+ *   This may be called from interrupt handlers, and before the OS is
+ *   started, once .bss has been cleared.
+ *
+ ****************************************************************************/
+
+void boot_timing_mark(FAR const char *stage);
+
+/****************************************************************************
+ * Name: boot_timing_get
+ *
+ * Description:
+ *   Copy up to 'nmarks' of the recorded marks, in the order they were
+ *   reached, to 'marks'.
+ *
+ * Returned Value:
+ *   The number of marks copied.
+ *
+ ****************************************************************************/
+
+int boot_timing_get(FAR struct boot_mark_s *marks, int nmarks);
+
+#else
+#  define boot_timing_mark(stage)
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_BOOT_TIMING_H */
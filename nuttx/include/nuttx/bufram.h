@@ -31,9 +31,41 @@
 #ifndef __NUTTX_MM_BUFRAM_H__
 #define __NUTTX_MM_BUFRAM_H__
 
+#include <nuttx/config.h>
+
 #include <stddef.h>
+#include <stdint.h>
 
 #define BUFRAM_PAGE_SIZE    128
+#define BUFRAM_ORDER_COUNT  32
+
+struct bufram_stats {
+    size_t free_blocks[BUFRAM_ORDER_COUNT]; /* free blocks of 2^order bytes */
+    size_t free_size;       /* total free bytes */
+    size_t largest_free;    /* size of the largest free block */
+    unsigned fragmentation; /* free bytes not in the largest block, in % */
+#ifdef CONFIG_MM_BUFRAM_STATS
+    size_t used_size;       /* bytes currently allocated */
+    size_t peak_used;       /* highest value reached by used_size */
+    uint32_t failures;      /* allocations that could not be served */
+#endif
+};
+
+/* Subsystems that allocate bufram pages, used to account for their usage */
+enum bufram_owner {
+    BUFRAM_OWNER_OTHER,
+    BUFRAM_OWNER_CPORT,
+    BUFRAM_OWNER_USB,
+    BUFRAM_OWNER_I2S,
+    BUFRAM_OWNER_COUNT,
+};
+
+struct bufram_owner_stats {
+    size_t pages;           /* pages currently held */
+    size_t peak_pages;      /* highest value reached by pages */
+    uint32_t allocs;        /* successful allocations */
+    uint32_t failures;      /* failed allocations */
+};
 
 void bufram_init(void);
 void bufram_register_region(uintptr_t base, unsigned order);
@@ -44,7 +76,21 @@ void bufram_free(void *ptr);
 void *bufram_page_alloc(size_t page_count);
 void bufram_page_free(void *ptr, size_t page_count);
 
+void *bufram_page_alloc_owner(size_t page_count, enum bufram_owner owner);
+void bufram_page_free_owner(void *ptr, size_t page_count,
+                            enum bufram_owner owner);
+
 size_t bufram_size_to_page_count(size_t size);
 
+void bufram_get_stats(struct bufram_stats *stats);
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+const char *bufram_owner_name(enum bufram_owner owner);
+int bufram_get_owner_stats(enum bufram_owner owner,
+                           struct bufram_owner_stats *stats);
+/* Restart the peaks from the current usage and clear the counters */
+void bufram_reset_stats(void);
+#endif
+
 #endif /* __NUTTX_MM_BUFRAM_H__ */
 
@@ -115,6 +115,32 @@
 # define inline_function __attribute__ ((always_inline))
 # define noinline_function __attribute__ ((noinline))
 
+/* The noinit_data attribute places data in the .noinit section, which is
+ * not cleared at boot like .bss, when the linker script provides it.  It
+ * is meant for large buffers that are initialized before use anyway.
+ */
+
+# ifdef CONFIG_ARCH_NOINIT
+#  define noinit_data __attribute__ ((section(".noinit")))
+# else
+#  define noinit_data
+# endif
+
+/* The hot_function and hot_data attributes place the code and data of the
+ * hot paths (interrupt dispatch, context switch, UniPro and Greybus message
+ * handling) in the .ramfunc and .hotdata sections, which the linker script
+ * of the board locates in its fastest memory.  Hot functions are copied to
+ * SRAM at boot on parts that execute from FLASH.
+ */
+
+# ifdef CONFIG_ARCH_HOTPATH
+#  define hot_function __attribute__ ((section(".ramfunc"),long_call))
+#  define hot_data __attribute__ ((section(".hotdata")))
+# else
+#  define hot_function
+#  define hot_data
+# endif
+
 /* GCC has does not use storage classes to qualify addressing */
 
 # define FAR
@@ -261,6 +287,9 @@
 
 # define inline_function
 # define noinline_function
+# define noinit_data
+# define hot_function
+# define hot_data
 
 /* The reentrant attribute informs SDCC that the function
  * must be reentrant.  In this case, SDCC will store input
@@ -363,6 +392,9 @@
 # define naked_function
 # define inline_function
 # define noinline_function
+# define noinit_data
+# define hot_function
+# define hot_data
 
 /* REVISIT: */
 
@@ -453,6 +485,9 @@
 # define naked_function
 # define inline_function
 # define noinline_function
+# define noinit_data
+# define hot_function
+# define hot_data
 
 # define FAR
 # define NEAR
@@ -138,6 +138,14 @@ struct device_driver {
     void *priv;
 };
 
+/** Entry of a set of drivers registered with device_register_drivers() */
+struct device_probe_entry {
+    /** Device driver to register */
+    struct device_driver *driver;
+    /** Driver of the same set that must be probed first, or NULL */
+    struct device_driver *after;
+};
+
 /** Device structure */
 struct device {
     /** Device's type */
@@ -189,6 +197,39 @@ int device_register_driver(struct device_driver *driver);
  */
 void device_unregister_driver(struct device_driver *driver);
 
+/**
+ * @brief Register a set of device drivers, honoring their probe order
+ *
+ * Each driver is registered once the driver it comes after is. With
+ * CONFIG_DEVICE_PARALLEL_PROBE, the drivers which are ready at the same
+ * time are probed on separate threads.
+ *
+ * @param entries The drivers to register (at most 32)
+ * @param count The number of entries
+ * @return 0 on success, -EINVAL if the probe order has a cycle
+ */
+int device_register_drivers(const struct device_probe_entry *entries,
+                            int count);
+
+#ifdef CONFIG_DEVICE_DEFERRED_PROBE
+/**
+ * @brief Register a device driver without probing its devices yet
+ *
+ * The devices of the driver are probed when one of them is first opened,
+ * or by device_probe_deferred().
+ *
+ * @param driver The device driver to register
+ * @return 0 on success, -ENOMEM if too many drivers are deferred
+ */
+int device_defer_driver(struct device_driver *driver);
+
+/**
+ * @brief Probe the devices of all the deferred drivers not probed yet
+ * @return The number of drivers registered
+ */
+int device_probe_deferred(void);
+#endif
+
 /**
  * @brief Get a device's resource by type and number
  * @param dev The device containing the requested resource
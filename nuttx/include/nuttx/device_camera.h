@@ -147,6 +147,35 @@ struct metadata_info {
     uint8_t     *data;
 };
 
+/**
+ * Per-frame information reported by the camera driver
+ */
+struct camera_frame_info {
+    /** The ID of the capture request the frame belongs to */
+    uint32_t    request_id;
+    /** CSI-2 frame number, 0 if not used */
+    uint16_t    frame_number;
+    /** The stream number */
+    uint8_t     stream;
+    /** Frames dropped by the driver since the previous report */
+    uint8_t     dropped;
+    /** Start of frame in timesync frame time, 0 to use the reporting time */
+    uint64_t    frame_time;
+    /** Exposure time in microseconds */
+    uint32_t    exposure;
+    /** Driver specific meta-data block */
+    const uint8_t *data;
+    /** Size of the meta-data block in bytes */
+    size_t      data_size;
+};
+
+/**
+ * Frame callback, called from thread context once per captured frame
+ */
+typedef void (*camera_frame_callback)(struct device *dev,
+                                      struct camera_frame_info *frame,
+                                      void *arg);
+
 /**
  * Camera device driver operations
  */
@@ -165,6 +194,9 @@ struct device_camera_type_ops {
     int (*capture)(struct device *dev, struct capture_info *capt_info);
     /** stop capture */
     int (*flush)(struct device *dev, uint32_t *request_id);
+    /** Set the callback reporting the captured frames */
+    int (*set_frame_callback)(struct device *dev,
+                              camera_frame_callback callback, void *arg);
 };
 
 /**
@@ -265,4 +297,28 @@ static inline int device_camera_flush(struct device *dev, uint32_t *request_id)
     return -ENOSYS;
 }
 
+/**
+ * @brief Set the callback reporting the captured frames
+ *
+ * @param dev Pointer to structure of device data
+ * @param callback Function called for each captured frame, NULL to remove it
+ * @param arg Argument passed to the callback
+ * @return 0 on success, negative errno on error
+ */
+static inline int device_camera_set_frame_callback(struct device *dev,
+                                        camera_frame_callback callback,
+                                        void *arg)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+    if (DEVICE_DRIVER_GET_OPS(dev, camera)->set_frame_callback) {
+        return DEVICE_DRIVER_GET_OPS(dev, camera)->set_frame_callback(dev,
+                                                                callback, arg);
+    }
+    return -ENOSYS;
+}
+
 #endif
@@ -93,6 +93,15 @@
 #define DEVICE_DMA_CALLBACK_EVENT_ERROR     BIT(3)
 #define DEVICE_DMA_CALLBACK_EVENT_RECOVERED BIT(4)
 
+/* Channel flags
+ * DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK - Run the COMPLETE callback of the ops
+ *                                     directly from the DMA interrupt
+ *                                     instead of from the DMA driver thread.
+ *                                     The callback must not block, nor
+ *                                     allocate or free memory.
+ */
+#define DEVICE_DMA_CHAN_FLAG_IRQ_CALLBACK   BIT(0)
+
 /* Alignments for the source and destination address */
 #define DEVICE_DMA_ALIGNMENT_8              BIT(0)
 #define DEVICE_DMA_ALIGNMENT_16             BIT(1)
@@ -158,6 +167,7 @@ struct device_dma_params {
     unsigned int transfer_size;
     unsigned int burst_len;
     unsigned int swap;
+    unsigned int flags; /* DEVICE_DMA_CHAN_FLAG_* */
 };
 
 struct device_dma_type_ops {
@@ -169,11 +179,18 @@ struct device_dma_type_ops {
     int (*op_alloc)(struct device *dev, unsigned int sg_count,
             unsigned int extra, struct device_dma_op **opp);
     int (*op_free)(struct device *dev, struct device_dma_op *op);
+    int (*op_pool_create)(struct device *dev, void *chan, unsigned int count,
+            unsigned int sg_count, unsigned int extra,
+            const struct device_dma_op *template);
+    int (*op_pool_alloc)(struct device *dev, void *chan,
+            struct device_dma_op **opp);
     int (*op_is_complete)(struct device *dev, struct device_dma_op *op);
     int (*op_get_error)(struct device *dev, struct device_dma_op *op,
             enum device_dma_error *error);
     int (*enqueue)(struct device *dev, void *chan, struct device_dma_op *op);
     int (*dequeue)(struct device *dev, void *chan, struct device_dma_op *op);
+    int (*op_get_transferred)(struct device *dev, void *chan,
+            struct device_dma_op *op, size_t *count);
 };
 
 /**
@@ -305,6 +322,69 @@ static inline int device_dma_op_free(struct device *dev,
     return -ENOSYS;
 }
 
+/**
+ * @brief Preallocate the operation structures of a DMA channel
+ *
+ * Each operation of the pool is a copy of the template, which is checked
+ * against the channel parameters once here rather than on every enqueue.
+ * The client then only updates the addresses and lengths (keeping the
+ * alignment the channel requires), sg_count (up to the pool's sg_count)
+ * and callback_arg before enqueuing an operation, and can enqueue it
+ * again once it completed. device_dma_op_free() gives an operation back to
+ * its pool; it can be called from a DMA callback. The pool is released
+ * along with the channel.
+ *
+ * @param dev DMA device
+ * @param chan DMA channel cookie
+ * @param count number of operations in the pool
+ * @param sg_count number of scatter-gather entries of each operation
+ * @param extra bytes of client data after the entries of each operation
+ * @param template operation the pool is initialized from
+ * @return 0: Success
+ *         -errno: Cause of failure
+ */
+static inline int device_dma_op_pool_create(struct device *dev, void *chan,
+        unsigned int count, unsigned int sg_count, unsigned int extra,
+        const struct device_dma_op *template)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev))
+        return -ENODEV;
+
+    if (DEVICE_DRIVER_GET_OPS(dev, dma)->op_pool_create)
+        return DEVICE_DRIVER_GET_OPS(dev, dma)->op_pool_create(dev, chan,
+                count, sg_count, extra, template);
+
+    return -ENOSYS;
+}
+
+/**
+ * @brief Take an operation structure from the pool of a DMA channel
+ *
+ * Does not allocate memory, so it can be called from a DMA callback.
+ *
+ * @param dev DMA device
+ * @param chan DMA channel cookie
+ * @param opp Pointer to pointer of dma_op structure being taken
+ * @return 0: Success
+ *         -ENOMEM: The pool is empty
+ *         -errno: Cause of failure
+ */
+static inline int device_dma_op_pool_alloc(struct device *dev, void *chan,
+        struct device_dma_op **opp)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev))
+        return -ENODEV;
+
+    if (DEVICE_DRIVER_GET_OPS(dev, dma)->op_pool_alloc)
+        return DEVICE_DRIVER_GET_OPS(dev, dma)->op_pool_alloc(dev, chan, opp);
+
+    return -ENOSYS;
+}
+
 /**
  * @brief Check if DMA operation is complete
  * @param dev DMA device
@@ -399,4 +479,34 @@ static inline int device_dma_dequeue(struct device *dev, void *chan,
     return -ENOSYS;
 }
 
+/**
+ * @brief Get the number of bytes an operation has moved so far
+ *
+ * This allows a client to stop a transfer of unknown length, such as a
+ * receive from a peripheral ended by an idle line, and find out how much of
+ * the destination has been written. It must be called before dequeuing a
+ * running operation.
+ *
+ * @param dev DMA device the operation is queued on
+ * @param chan DMA channel cookie
+ * @param op device_dma_op structure being checked
+ * @param count the number of bytes written to the destination
+ * @return 0: Count is valid
+ *         -errno: Cause of failure
+ */
+static inline int device_dma_op_get_transferred(struct device *dev,
+        void *chan, struct device_dma_op *op, size_t *count)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev))
+        return -ENODEV;
+
+    if (DEVICE_DRIVER_GET_OPS(dev, dma)->op_get_transferred)
+        return DEVICE_DRIVER_GET_OPS(dev, dma)->op_get_transferred(dev, chan,
+                                                                   op, count);
+
+    return -ENOSYS;
+}
+
 #endif /* __INCLUDE_NUTTX_DEVICE_DMA_H */
@@ -161,6 +161,27 @@ struct light_info {
     struct channel_info *channels;
 };
 
+/** Apply the brightness of a channel update */
+#define LIGHTS_UPDATE_BRIGHTNESS    BIT(0)
+/** Apply the color of a channel update */
+#define LIGHTS_UPDATE_COLOR         BIT(1)
+
+/**
+ * Lights channel settings, part of an update
+ */
+struct lights_channel_update {
+    /** the ID of specific light */
+    uint8_t     light_id;
+    /** the ID of specific channel */
+    uint8_t     channel_id;
+    /** LIGHTS_UPDATE_* settings to apply */
+    uint8_t     flags;
+    /** brightness to be set, with LIGHTS_UPDATE_BRIGHTNESS */
+    uint8_t     brightness;
+    /** color to be set, with LIGHTS_UPDATE_COLOR */
+    uint32_t    color;
+};
+
 /**
  * @brief Lights event callback function
  *
@@ -217,6 +238,10 @@ struct device_lights_type_ops {
     /** Get flash light fault */
     int (*get_flash_fault)(struct device *dev, uint8_t light_id,
                            uint8_t channel_id, uint32_t *fault);
+    /** Set several channels at once, all or none of them */
+    int (*update_channels)(struct device *dev,
+                           const struct lights_channel_update *updates,
+                           uint8_t count);
 };
 
 /**
@@ -382,6 +407,34 @@ static inline int device_lights_set_blink(struct device *dev,
     return -ENOSYS;
 }
 
+/**
+ * @brief Lights update channels wrap function
+ *
+ * The driver applies all the settings together, so that the channels of a
+ * light never show a mix of old and new settings, or none of them on error.
+ *
+ * @param dev pointer to structure of device data
+ * @param updates settings to apply
+ * @param count number of entries in updates
+ * @return 0 on success, negative errno on error
+ */
+static inline int device_lights_update_channels(struct device *dev,
+                                const struct lights_channel_update *updates,
+                                uint8_t count)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+    if (DEVICE_DRIVER_GET_OPS(dev, lights)->update_channels) {
+        return DEVICE_DRIVER_GET_OPS(dev, lights)->update_channels(dev,
+                                                                   updates,
+                                                                   count);
+    }
+    return -ENOSYS;
+}
+
 /**
  * @brief Lights set color wrap function
  *
@@ -66,6 +66,44 @@ enum pwm_mode {
  */
 typedef void (*pwm_event_callback)(uint32_t mask_int, uint32_t mask_err);
 
+/**
+ * @brief PWM stream completion callback function
+ *
+ * Called once the last duty cycle of a stream has been loaded, or when the
+ * stream was stopped or failed. The generator keeps running with the last
+ * duty cycle loaded.
+ *
+ * @param dev Pointer to the PWM device controller
+ * @param which PWM generator device number
+ * @param status 0 once the stream is done, negative errno otherwise
+ * @param arg Argument given with the stream
+ */
+typedef void (*pwm_stream_callback)(struct device *dev, uint16_t which,
+                                    int status, void *arg);
+
+/** Apply duty and period */
+#define PWM_UPDATE_CONFIG       BIT(0)
+/** Apply the polarity given by PWM_UPDATE_INVERTED */
+#define PWM_UPDATE_POLARITY     BIT(1)
+/** Inverted polarity, with PWM_UPDATE_POLARITY */
+#define PWM_UPDATE_INVERTED     BIT(2)
+/** Start the pulse-width output */
+#define PWM_UPDATE_ENABLE       BIT(3)
+/** Stop the pulse-width output */
+#define PWM_UPDATE_DISABLE      BIT(4)
+
+/** Settings of one PWM generator, part of an update */
+struct pwm_update {
+    /** PWM generator device number */
+    uint16_t which;
+    /** PWM_UPDATE_* settings to apply */
+    uint8_t flags;
+    /** Duty cycle in nanoseconds, with PWM_UPDATE_CONFIG */
+    uint32_t duty;
+    /** Period in nanoseconds, with PWM_UPDATE_CONFIG */
+    uint32_t period;
+};
+
 /** PWM device driver operations */
 struct device_pwm_type_ops {
     /** Get the number of supported PWM generators
@@ -132,6 +170,44 @@ struct device_pwm_type_ops {
      * @return 0 on success, negative errno on failure
      */
     int (*sync_output)(struct device *dev, bool enable);
+    /** Apply the settings of several PWM generators at once
+     *
+     * Either all the settings are applied or, on error, none is. Running
+     * generators switch to their new settings at the end of their current
+     * period, so that the output never mixes old and new settings.
+     *
+     * @param dev Pointer to the PWM device controller
+     * @param updates Settings to apply
+     * @param count Number of entries in updates
+     * @return 0 on success, negative errno on failure
+     */
+    int (*update)(struct device *dev, const struct pwm_update *updates,
+                  uint16_t count);
+    /** Load a sequence of duty cycles into a PWM generator, one per period
+     *
+     * The generator is started with the first duty cycle, then the next
+     * ones are loaded by the hardware at every period boundary, without the
+     * CPU. The duty cycles are copied, the buffer can be reused as soon as
+     * the function returns.
+     *
+     * @param dev Pointer to the PWM device controller
+     * @param which PWM generator device number
+     * @param duty Duty cycles in nanoseconds
+     * @param count Number of entries in duty
+     * @param period Period of PWM generator in nanoseconds
+     * @param callback Called when the stream ends, may be NULL
+     * @param arg Argument of callback
+     * @return 0 on success, negative errno on failure
+     */
+    int (*stream)(struct device *dev, uint16_t which, const uint32_t *duty,
+                  uint32_t count, uint32_t period,
+                  pwm_stream_callback callback, void *arg);
+    /** Stop the stream of a PWM generator, keeping its current duty cycle
+     * @param dev Pointer to the PWM device controller
+     * @param which PWM generator device number
+     * @return 0 on success, negative errno on failure
+     */
+    int (*stream_stop)(struct device *dev, uint16_t which);
     /** Register callback function to be notified when one of the selected
      * interrupt events occurs
      * @param dev Pointer to the PWM device controller
@@ -339,6 +415,78 @@ static inline int device_pwm_sync_output(struct device *dev, bool enable)
     return DEVICE_DRIVER_GET_OPS(dev, pwm)->sync_output(dev, enable);
 }
 
+/** Apply the settings of several PWM generators at once
+ * @param dev Pointer to the PWM device controller
+ * @param updates Settings to apply
+ * @param count Number of entries in updates
+ * @return 0 on success, negative errno on failure
+ */
+static inline int device_pwm_update(struct device *dev,
+                                    const struct pwm_update *updates,
+                                    uint16_t count)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+
+    if (!DEVICE_DRIVER_GET_OPS(dev, pwm)->update) {
+        return -ENOSYS;
+    }
+
+    return DEVICE_DRIVER_GET_OPS(dev, pwm)->update(dev, updates, count);
+}
+
+/** Load a sequence of duty cycles into a PWM generator, one per period
+ * @param dev Pointer to the PWM device controller
+ * @param which PWM generator device number
+ * @param duty Duty cycles in nanoseconds
+ * @param count Number of entries in duty
+ * @param period Period of PWM generator in nanoseconds
+ * @param callback Called when the stream ends, may be NULL
+ * @param arg Argument of callback
+ * @return 0 on success, negative errno on failure
+ */
+static inline int device_pwm_stream(struct device *dev, uint16_t which,
+                                    const uint32_t *duty, uint32_t count,
+                                    uint32_t period,
+                                    pwm_stream_callback callback, void *arg)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+
+    if (!DEVICE_DRIVER_GET_OPS(dev, pwm)->stream) {
+        return -ENOSYS;
+    }
+
+    return DEVICE_DRIVER_GET_OPS(dev, pwm)->stream(dev, which, duty, count,
+                                                   period, callback, arg);
+}
+
+/** Stop the stream of a PWM generator, keeping its current duty cycle
+ * @param dev Pointer to the PWM device controller
+ * @param which PWM generator device number
+ * @return 0 on success, negative errno on failure
+ */
+static inline int device_pwm_stream_stop(struct device *dev, uint16_t which)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+
+    if (!DEVICE_DRIVER_GET_OPS(dev, pwm)->stream_stop) {
+        return -ENOSYS;
+    }
+
+    return DEVICE_DRIVER_GET_OPS(dev, pwm)->stream_stop(dev, which);
+}
+
 /** Register callback function to be notified when one of the selected
  * interrupt events occurs
  * @param dev Pointer to the PWM device controller
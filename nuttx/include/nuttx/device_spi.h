@@ -38,6 +38,7 @@
 
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <nuttx/device.h>
 #include <nuttx/device_spi_board.h>
@@ -98,6 +99,18 @@ struct device_spi_device_config {
     enum device_spi_type device_type;
 };
 
+/** One SPI transfer of a batch */
+struct device_spi_batch_transfer {
+    /** Data buffers of the transfer */
+    struct device_spi_transfer transfer;
+    /** Configuration of the chip for the transfer */
+    struct device_spi_device_config config;
+    /** Delay after the transfer (in usec) */
+    uint16_t delay_usecs;
+    /** Deassert the chip-select after the transfer */
+    bool cs_change;
+};
+
 /** SPI device driver operations */
 struct device_spi_type_ops {
     /** Lock the SPI bus (for exclusive access)
@@ -133,6 +146,16 @@ struct device_spi_type_ops {
      */
     int (*exchange)(struct device *dev, struct device_spi_transfer *transfer,
                     uint8_t devid, struct device_spi_device_config *config);
+    /** Perform a sequence of SPI transmissions in one go
+     * @param dev Pointer to the SPI master
+     * @param xfers Array of transfers
+     * @param count Number of transfers
+     * @param devid the specific chip number
+     * @return 0 on success, negative errno on failure
+     */
+    int (*exchange_batch)(struct device *dev,
+                          struct device_spi_batch_transfer *xfers,
+                          unsigned int count, uint8_t devid);
     /** Get the SPI master configuration
      * @param dev Pointer to the SPI master
      * @param master_cfg Pointer to a variable whose value is to be filled out
@@ -249,6 +272,35 @@ static inline int device_spi_exchange(struct device *dev,
     return -ENOSYS;
 }
 
+/** Perform a sequence of SPI transmissions in one go
+ *
+ * The chip-select is asserted before the first transfer and deasserted after
+ * the last one, as well as after every transfer with cs_change set. The delay
+ * of each transfer is waited for before the next one starts.
+ *
+ * @param dev Pointer to the SPI master
+ * @param xfers Array of transfers
+ * @param count Number of transfers
+ * @param devid the specific chip number
+ * @return 0 on success, -ENOSYS if the driver can't batch transfers, negative
+ * errno on failure
+ */
+static inline int device_spi_exchange_batch(struct device *dev,
+                                    struct device_spi_batch_transfer *xfers,
+                                    unsigned int count, uint8_t devid)
+{
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+    if (DEVICE_DRIVER_GET_OPS(dev, spi)->exchange_batch) {
+        return DEVICE_DRIVER_GET_OPS(dev, spi)->exchange_batch(dev, xfers,
+                                                               count, devid);
+    }
+    return -ENOSYS;
+}
+
 /** Get the SPI master configuration
  * @param dev Pointer to the SPI master
  * @param master_cfg Pointer to a variable whose value is to be filled out with
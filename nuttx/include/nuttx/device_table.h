@@ -68,6 +68,18 @@ struct device_table_iter {
  */
 int device_table_register(struct device_table *table);
 
+/**
+ * @brief Find a registered device by type and identifier
+ *
+ * Constant-time lookup in an index built when the device tables are
+ * registered.
+ *
+ * @param type The type of the device
+ * @param id The identifier of the device
+ * @return The device, or NULL if no registered device matches
+ */
+struct device *device_table_lookup(const char *type, unsigned int id);
+
 /**
  * @brief Get the next device from a device table iterator
  * @param iter The device table iterator
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_DMA_MEMCPY_H
+#define __INCLUDE_NUTTX_DMA_MEMCPY_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include <nuttx/list.h>
+
+struct dma_memcpy_req;
+
+/*
+ * Called when the copy is done, in the context of the DMA interrupt when
+ * the copy was offloaded. It must not block.
+ */
+typedef void (*dma_memcpy_callback)(struct dma_memcpy_req *req, int status);
+
+struct dma_memcpy_req {
+    void *dst;
+    const void *src;
+    size_t len;
+    dma_memcpy_callback callback;
+    void *priv;
+
+    /* private to the copy service */
+    struct list_head list;
+};
+
+#ifdef CONFIG_ARCH_DMA_MEMCPY
+/**
+ * @brief Get the DMA channel used by dma_memcpy()
+ *
+ * Until it is called, or when it failed, all copies are made by the CPU.
+ *
+ * @return 0: Success
+ *         -errno: Cause of failure
+ */
+int dma_memcpy_init(void);
+
+/**
+ * @brief Copy a buffer, with the DMA controller if it is large enough
+ *
+ * Copies shorter than CONFIG_ARCH_DMA_MEMCPY_THRESHOLD are made by the CPU
+ * before dma_memcpy() returns, unless previous copies are still pending:
+ * the callbacks are always called in the order the copies were requested.
+ * The request must stay valid until its callback is called. It can be
+ * called from an interrupt handler.
+ *
+ * @param req the copy to make
+ * @return 0: Success, the callback is or will be called
+ *         -errno: Cause of failure, the callback won't be called
+ */
+int dma_memcpy(struct dma_memcpy_req *req);
+#else
+static inline int dma_memcpy_init(void)
+{
+    return 0;
+}
+
+static inline int dma_memcpy(struct dma_memcpy_req *req)
+{
+    memcpy(req->dst, req->src, req->len);
+    req->callback(req, 0);
+    return 0;
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_DMA_MEMCPY_H */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_FS_BLKIO_H
+#define __INCLUDE_NUTTX_FS_BLKIO_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+#include <nuttx/wqueue.h>
+
+#ifdef CONFIG_FS_BLKIO
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* An asynchronous block transfer.  The caller owns the structure and the
+ * buffer until the completion callback has been called.  Requests are
+ * performed one at a time, in the order submitted, on the low-priority
+ * work queue, so a submitter may keep several outstanding and overlap its
+ * own processing with the block driver transfers.
+ */
+
+struct blkio_req_s;
+typedef CODE void (*blkio_callback_t)(FAR struct blkio_req_s *req);
+
+struct blkio_req_s
+{
+  /* Set by the submitter */
+
+  FAR struct inode *br_inode;       /* Open block driver */
+  FAR uint8_t      *br_buffer;      /* Data to write or buffer to read into */
+  size_t            br_start;       /* First sector */
+  unsigned int      br_nsectors;    /* Number of sectors */
+  bool              br_write;       /* true: write, false: read */
+  blkio_callback_t  br_callback;    /* Called on the worker thread when done */
+  FAR void         *br_arg;         /* For use by the submitter */
+
+  /* Set on completion */
+
+  ssize_t           br_result;      /* Sectors transferred or negated errno */
+
+  /* Internal */
+
+  struct work_s     br_work;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: blkio_submit
+ *
+ * Description:
+ *   Queue an asynchronous block transfer.  br_callback is called with
+ *   br_result set once the block driver's read or write method returns.
+ *
+ * Returned Value:
+ *   OK if the request was queued; a negated errno value otherwise, in
+ *   which case the callback will not be called.
+ *
+ ****************************************************************************/
+
+int blkio_submit(FAR struct blkio_req_s *req);
+
+/****************************************************************************
+ * Name: blkio_cancel
+ *
+ * Description:
+ *   Remove a request that has not been started yet.  A request that is
+ *   already being performed cannot be cancelled; its callback will still
+ *   be called.
+ *
+ * Returned Value:
+ *   OK if the request was removed; -EBUSY if it was already started or
+ *   completed.
+ *
+ ****************************************************************************/
+
+int blkio_cancel(FAR struct blkio_req_s *req);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_FS_BLKIO */
+#endif /* __INCLUDE_NUTTX_FS_BLKIO_H */
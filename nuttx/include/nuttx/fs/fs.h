@@ -66,6 +66,7 @@
 
 struct file;
 struct pollfd;
+struct iovec;
 
 struct file_operations
 {
@@ -88,6 +89,15 @@ struct file_operations
 #endif
 
   /* The two structures need not be common after this point */
+
+#ifdef CONFIG_FS_VECTORIO
+  /* Optional scatter/gather methods.  If NULL, readv() and writev() fall
+   * back to calling read or write once per buffer.
+   */
+
+  ssize_t (*readv)(FAR struct file *filep, FAR const struct iovec *iov, int iovcnt);
+  ssize_t (*writev)(FAR struct file *filep, FAR const struct iovec *iov, int iovcnt);
+#endif
 };
 
 /* This structure provides information about the state of a block driver */
@@ -234,13 +244,29 @@ struct file
   void             *f_priv;   /* Per file driver private data */
 };
 
-/* This defines a list of files indexed by the file descriptor */
+/* This defines a list of files indexed by the file descriptor.  With
+ * CONFIG_NFILE_DESCRIPTORS_PER_BLOCK, the files are allocated by blocks on
+ * first use and are never moved, so that a struct file pointer stays valid
+ * while the list grows.
+ */
 
 #if CONFIG_NFILE_DESCRIPTORS > 0
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+#  define FILELIST_NBLOCKS \
+     ((CONFIG_NFILE_DESCRIPTORS + CONFIG_NFILE_DESCRIPTORS_PER_BLOCK - 1) / \
+      CONFIG_NFILE_DESCRIPTORS_PER_BLOCK)
+#  define FILELIST_NWORDS ((CONFIG_NFILE_DESCRIPTORS + 31) >> 5)
+#endif
+
 struct filelist
 {
   sem_t   fl_sem;             /* Manage access to the file list */
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+  uint32_t fl_inuse[FILELIST_NWORDS];           /* One bit per open descriptor */
+  FAR struct file *fl_blocks[FILELIST_NBLOCKS]; /* NULL until first used */
+#else
   struct file fl_files[CONFIG_NFILE_DESCRIPTORS];
+#endif
 };
 #endif
 
@@ -476,13 +502,33 @@ void files_releaselist(FAR struct filelist *list);
  * Name: files_dup
  *
  * Description:
- *   Assign an inode to a specific files structure.  This is the heart of
- *   dup2.
+ *   Assign the inode of filep1 to the file descriptor fd2 of a list.  This
+ *   is the heart of dup2.
  *
  ****************************************************************************/
 
 #if CONFIG_NFILE_DESCRIPTORS > 0
-int files_dup(FAR struct file *filep1, FAR struct file *filep2);
+int files_dup(FAR struct file *filep1, FAR struct filelist *list, int fd2);
+#endif
+
+/****************************************************************************
+ * Name: files_fdfile
+ *
+ * Description:
+ *   Return the file structure of the file descriptor 'fd' in 'list', or
+ *   NULL if 'fd' is out of range or was never used.  A non-NULL file may
+ *   still be closed (f_inode == NULL).
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+#if CONFIG_NFILE_DESCRIPTORS_PER_BLOCK > 0
+FAR struct file *files_fdfile(FAR struct filelist *list, int fd);
+#else
+#  define files_fdfile(list, fd) \
+     ((unsigned int)(fd) < CONFIG_NFILE_DESCRIPTORS ? \
+      &(list)->fl_files[fd] : NULL)
+#endif
 #endif
 
 /* fs_filedup.c *************************************************************/
@@ -642,15 +688,32 @@ ssize_t file_read(FAR struct file *filep, FAR void *buf, size_t nbytes);
  *
  * Description:
  *   Equivalent to the standard lseek() function except that is accepts a
- *   struct file instance instead of a file descriptor.  Currently used
- *   only by net_sendfile()
+ *   struct file instance instead of a file descriptor.  Used by
+ *   net_sendfile() and by preadv() and pwritev().
  *
  ****************************************************************************/
 
-#if CONFIG_NFILE_DESCRIPTORS > 0 && defined(CONFIG_NET_SENDFILE)
+#if CONFIG_NFILE_DESCRIPTORS > 0
 off_t file_seek(FAR struct file *filep, off_t offset, int whence);
 #endif
 
+/* fs/fs_uio.c **************************************************************/
+/****************************************************************************
+ * Name: file_readv and file_writev
+ *
+ * Description:
+ *   Equivalent to the standard readv() and writev() functions except that
+ *   they accept a struct file instance instead of a file descriptor.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+ssize_t file_readv(FAR struct file *filep, FAR const struct iovec *iov,
+                   int iovcnt);
+ssize_t file_writev(FAR struct file *filep, FAR const struct iovec *iov,
+                    int iovcnt);
+#endif
+
 /* drivers/dev_null.c *******************************************************/
 /****************************************************************************
  * Name: devnull_register
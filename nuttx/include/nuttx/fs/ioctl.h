@@ -221,6 +221,10 @@
                                            *      of device memory */
 #define MTDIOC_BULKERASE  _MTDIOC(0x0003) /* IN:  None
                                            * OUT: None */
+#define MTDIOC_RWBSTATS   _MTDIOC(0x0004) /* IN:  Pointer to write-able struct
+                                           *      rwb_stats_s (see rwbuffer.h)
+                                           * OUT: Buffering statistics of an
+                                           *      mtd_rwbuffer layer */
 
 /* NuttX ARP driver ioctl definitions (see netinet/arp.h) *******************/
 
@@ -117,6 +117,32 @@ uint8_t gpio_get_value(uint8_t which);
  */
 void gpio_set_value(uint8_t which, uint8_t value);
 
+/**
+ * @brief Get the values of several GPIO lines at once
+ *
+ * Lines handled by the same GPIO chip are read together, e.g. in a single
+ * I2C transaction for an expander.
+ *
+ * @param base The number of the first GPIO line
+ * @param mask The lines to read: bit n is GPIO line base + n
+ * @param values The values read: bit n is the value of GPIO line base + n,
+ * bits not in mask are 0
+ * @return 0 on success, !=0 on failure
+ */
+int gpio_get_values(uint8_t base, uint32_t mask, uint32_t *values);
+
+/**
+ * @brief Set the values of several GPIO lines at once
+ *
+ * Lines handled by the same GPIO chip are written together.
+ *
+ * @param base The number of the first GPIO line
+ * @param mask The lines to write: bit n is GPIO line base + n
+ * @param values The values to write: bit n is the value of GPIO line base + n
+ * @return 0 on success, !=0 on failure
+ */
+int gpio_set_values(uint8_t base, uint32_t mask, uint32_t values);
+
 /**
  * @brief Set the debouncing delay of a GPIO line
  * @param which The number of the GPIO line
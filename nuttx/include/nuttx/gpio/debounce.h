@@ -32,8 +32,7 @@
 #include <nuttx/irq.h>
 #include <nuttx/wqueue.h>
 #include <stdbool.h>
-#include <sys/time.h>
-#include <time.h>
+#include <stdint.h>
 
 /* debounce state machine */
 enum debounce_state {
@@ -52,8 +51,9 @@ struct debounce_data {
     void *context;                      /* ISR context */
     void *priv;                         /* Stored private data */
     enum debounce_state db_state;       /* Debounce state */
-    struct timeval debounce_tv;         /* Last time of signal debounce check */
-    struct work_s work;                 /* Work queue for delayed state check */
+    uint32_t start;                     /* Tick of the last signal change */
+    bool pending;                       /* Waiting for the shared scan */
+    struct debounce_data *next;         /* Next pin waiting for the scan */
 };
 
 bool debounce_gpio(struct debounce_data *db, bool active);
@@ -53,6 +53,11 @@ struct gpio_ops_s
                     enum gpio_pull_type pull_type);
     enum gpio_pull_type (*get_pull)(void *driver_data, uint8_t which);
     int (*set_debounce)(void *driver_data, uint8_t which, uint16_t delay);
+    /* Optional: bit n of mask and values is line which + n of the chip */
+    int (*get_values)(void *driver_data, uint8_t which, uint32_t mask,
+                      uint32_t *values);
+    int (*set_values)(void *driver_data, uint8_t which, uint32_t mask,
+                      uint32_t values);
 };
 
 int register_gpio_chip(struct gpio_ops_s *ops, int base, void *driver_data);
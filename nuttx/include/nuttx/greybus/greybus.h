@@ -38,24 +38,44 @@
 #include <nuttx/list.h>
 #include <nuttx/util.h>
 #include <nuttx/unipro/unipro.h>
+#include <nuttx/dma_memcpy.h>
 #include <nuttx/greybus/types.h>
 
 #define GB_MTU                  2048
 #define GB_MAX_PAYLOAD_SIZE     (GB_MTU - sizeof(struct gb_operation_hdr))
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+#define GB_LARGE_MAX_PAYLOAD_SIZE \
+    (CONFIG_GREYBUS_LARGE_MESSAGE_SIZE - sizeof(struct gb_operation_hdr))
+#endif
 #define GB_TIMESYNC_MAX_STROBES 0x04
 
 #define GB_INVALID_TYPE         0x7f
+#define GB_REQUEST_TYPE_COUNT   0x80
 
 enum gb_event {
     GB_EVT_CONNECTED,
     GB_EVT_DISCONNECTED,
 };
 
+/*
+ * QoS classes of service a driver can request for its CPort. The class
+ * selects the priority of the CPort worker and the order in which the
+ * transport services the CPort TX queues. Higher values win.
+ */
+enum gb_qos_class {
+    GB_QOS_BULK,
+    GB_QOS_INTERACTIVE,
+    GB_QOS_REALTIME,
+
+    GB_QOS_CLASS_COUNT,
+};
+
 struct gb_operation;
 
 typedef void (*gb_operation_callback)(struct gb_operation *operation);
 typedef uint8_t (*gb_operation_handler_t)(struct gb_operation *operation);
 typedef void (*gb_operation_fast_handler_t)(unsigned int cport, void *data);
+typedef void (*gb_tx_space_callback)(unsigned int cport, void *priv);
 
 #if !defined(CONFIG_GREYBUS_DEBUG)
 #define GB_HANDLER(t, h) \
@@ -85,6 +105,36 @@ typedef void (*gb_operation_fast_handler_t)(unsigned int cport, void *data);
     }
 #endif
 
+#ifdef CONFIG_GREYBUS_STATS
+/* bucket n counts handlers that ran in [2^(n-1), 2^n) us, bucket 0 in 0 us */
+#define GB_STATS_LATENCY_BUCKETS    16
+
+struct gb_cport_stats {
+    uint32_t requests_in;       /* requests received */
+    uint32_t requests_out;      /* requests sent */
+    uint32_t responses_in;      /* responses received */
+    uint32_t responses_out;     /* responses sent, OOM responses included */
+    uint32_t timeouts;          /* requests that did not get a response */
+    uint32_t oom_responses;     /* GB_OP_NO_MEMORY responses sent */
+    uint32_t rx_drops;          /* messages dropped for lack of memory */
+    uint32_t rx_fifo_depth;     /* messages waiting for the CPort worker */
+    uint32_t rx_fifo_hwm;       /* highest rx_fifo_depth seen */
+    uint32_t bytes_in;          /* bytes received, headers included */
+    uint32_t bytes_out;         /* bytes sent, headers included */
+    uint32_t latency[GB_STATS_LATENCY_BUCKETS]; /* request handler runtime */
+};
+#endif
+
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+struct gb_handler_stats {
+    uint32_t count;             /* number of calls */
+    uint32_t min;               /* shortest runtime, in us */
+    uint32_t max;               /* longest runtime, in us */
+    uint64_t total;             /* cumulated runtime, in us */
+    uint32_t latency[GB_STATS_LATENCY_BUCKETS];
+};
+#endif
+
 struct gb_operation_handler {
     uint8_t type;
     gb_operation_handler_t handler;
@@ -92,6 +142,9 @@ struct gb_operation_handler {
 #ifdef CONFIG_GREYBUS_DEBUG
     const char *name;
 #endif
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+    struct gb_handler_stats stats;
+#endif
 };
 
 struct gb_transport_backend {
@@ -102,8 +155,15 @@ struct gb_transport_backend {
     int (*send)(unsigned int cport, const void *buf, size_t len);
     int (*send_async)(unsigned int cportid, const void *buf, size_t len,
                       unipro_send_completion_t callback, void *priv);
+    int (*send_async_iov)(unsigned int cportid,
+                          const struct unipro_iovec *iov, unsigned int iovcnt,
+                          unipro_send_completion_t callback, void *priv);
     void *(*alloc_buf)(size_t size);
     void (*free_buf)(void *ptr);
+    int (*set_tx_priority)(unsigned int cport, unsigned int priority);
+    ssize_t (*get_tx_queued)(unsigned int cport);
+    int (*set_tx_space_cb)(unsigned int cport, size_t threshold,
+                           gb_tx_space_callback callback, void *priv);
 };
 
 struct gb_bundle {
@@ -122,22 +182,41 @@ struct gb_operation {
     void *response_buffer;
     bool is_unipro_rx_buf;
 
+    /* response payload sent in place, see gb_operation_set_response_payload */
+    const void *response_payload;
+    size_t response_payload_size;
+
     gb_operation_callback callback;
     sem_t sync_sem;
 
     void *priv_data;
     struct list_head list;
+    struct list_head hash_list;
 
     struct gb_operation *response;
 
     struct gb_bundle *bundle;
 
+#if defined(CONFIG_UNIPRO_ZERO_COPY) && defined(CONFIG_ARCH_DMA_MEMCPY)
+    /* copy of the request out of the UniPro RX buffer */
+    struct dma_memcpy_req rx_copy;
+#endif
+
 #ifdef CONFIG_GREYBUS_FEATURE_HAVE_TIMESTAMPS
     struct timespec send_ts;
     struct timespec recv_ts;
 #endif
 };
 
+#ifdef CONFIG_GREYBUS_OPERATION_POOL
+struct gb_operation_pool_stats {
+    unsigned int size;      /* operations owned by the pool */
+    unsigned int free;      /* operations currently available in the pool */
+    unsigned int hits;      /* allocations served by the pool */
+    unsigned int misses;    /* allocations that had to grow the pool */
+};
+#endif
+
 struct gb_driver {
     /*
      * This is the callback in which all the initialization of driver-specific
@@ -159,9 +238,50 @@ struct gb_driver {
 
     size_t stack_size;
     size_t op_handlers_count;
+    /*
+     * When CONFIG_GREYBUS_SHARED_WORKERS is enabled, CPorts are serviced by
+     * a pool of shared workers. Latency critical drivers can set this flag
+     * to keep a dedicated worker thread per CPort.
+     */
+    bool dedicated_worker;
+    /*
+     * Incoming messages are processed in place, from the UniPro RX buffers,
+     * when the transport supports it. Drivers can set this flag to always
+     * receive a copy of the messages instead.
+     */
+    bool rx_copy;
+    /*
+     * Batch the responses of the requests processed back to back by the
+     * CPort worker and push them to the transport all at once, instead of
+     * waiting for each response to be sent. Only the responses sent by the
+     * core, from the handler return value, are batched.
+     */
+    bool batch_responses;
+#ifdef CONFIG_GREYBUS_LARGE_MESSAGES
+    /*
+     * Messages of up to GB_LARGE_MAX_PAYLOAD_SIZE bytes of payload are sent
+     * and received on the CPort, split in GB_MTU fragments on the link. The
+     * peer must support it as well.
+     */
+    bool large_messages;
+#endif
+#ifdef CONFIG_GREYBUS_CREDIT_FLOW
+    /*
+     * Only send a message when the peer granted a credit for it, and grant
+     * the peer credits as the received messages are processed. The fast
+     * handlers are not used on such a CPort. The peer must support it too.
+     */
+    bool credit_flow;
+#endif
+    /* QoS class of the CPort, defaults to GB_QOS_BULK */
+    enum gb_qos_class qos;
     const char *name;
 
     struct gb_bundle *bundle;
+#ifdef CONFIG_GREYBUS_DIRECT_DISPATCH
+    /* op_handlers index + 1 of each request type, built at registration */
+    uint8_t *dispatch;
+#endif
 };
 
 struct gb_operation_hdr {
@@ -223,6 +343,11 @@ static inline const char *gb_handler_name(struct gb_operation_handler *handler)
 int gb_init(struct gb_transport_backend *transport);
 void gb_deinit(void);
 int gb_unipro_init(void);
+#ifdef CONFIG_GREYBUS_MEMLOOP
+int gb_memloop_init(void);
+int gb_memloop_connect(unsigned int cport1, unsigned int cport2);
+int gb_memloop_disconnect(unsigned int cport);
+#endif
 int _gb_register_driver(unsigned int cport, int bundle_id,
                         struct gb_driver *driver);
 int gb_unregister_driver(unsigned int cport);
@@ -240,9 +365,13 @@ static inline int gb_register_named_driver(unsigned int cport, int bundle,
 int gb_listen(unsigned int cport);
 int gb_stop_listening(unsigned int cport);
 int gb_notify(unsigned cport, enum gb_event event);
+int gb_set_tx_queue_limit(unsigned int cport, size_t limit,
+                          gb_tx_space_callback callback, void *priv);
 
 void gb_operation_destroy(struct gb_operation *operation);
 void *gb_operation_alloc_response(struct gb_operation *operation, size_t size);
+int gb_operation_set_response_payload(struct gb_operation *operation,
+                                      const void *payload, size_t size);
 int gb_operation_send_response(struct gb_operation *operation, uint8_t result);
 int gb_operation_send_request_nowait(struct gb_operation *operation,
                                      gb_operation_callback callback,
@@ -255,10 +384,28 @@ struct gb_operation *gb_operation_create(unsigned int cport, uint8_t type,
                                          uint32_t req_size);
 void gb_operation_ref(struct gb_operation *operation);
 void gb_operation_unref(struct gb_operation *operation);
+#ifdef CONFIG_GREYBUS_OPERATION_POOL
+int gb_operation_pool_get_stats(struct gb_operation_pool_stats *stats);
+#endif
+#ifdef CONFIG_GREYBUS_STATS
+unsigned int gb_cport_count(void);
+const char *gb_cport_driver_name(unsigned int cport);
+int gb_cport_get_stats(unsigned int cport, struct gb_cport_stats *stats);
+int gb_cport_reset_stats(unsigned int cport);
+#endif
+#ifdef CONFIG_GREYBUS_HANDLER_STATS
+int gb_cport_get_handler_stats(unsigned int cport, unsigned int index,
+                               uint8_t *type, const char **name,
+                               struct gb_handler_stats *stats);
+void gb_reset_handler_stats(void);
+#endif
 size_t gb_operation_get_request_payload_size(struct gb_operation *operation);
+int gb_operation_set_request_payload_size(struct gb_operation *operation,
+                                          size_t size);
 uint8_t gb_operation_get_request_result(struct gb_operation *operation);
 struct gb_bundle *gb_operation_get_bundle(struct gb_operation *operation);
 int greybus_rx_handler(unsigned int, void*, size_t);
+int greybus_rx_copy_handler(unsigned int cport, void *data, size_t size);
 
 int gb_i2c_set_dev(struct i2c_dev_s *dev);
 struct  i2c_dev_s *gb_i2c_get_dev(void);
@@ -29,7 +29,9 @@
 #ifndef __CONFIGS_ARA_BRIDGE_INCLUDE_TIMESTAMPS_H
 #define  __CONFIGS_ARA_BRIDGE_INCLUDE_TIMESTAMPS_H
 
+#include <errno.h>
 #include <nuttx/time.h>
+#include <nuttx/greybus/timesync.h>
 
 #define GREYBUS_FW_TIMESTAMP_APBRIDGE 0x01
 #define GREYBUS_FW_TIMESTAMP_GPBRDIGE 0x02
@@ -47,4 +49,21 @@ void gb_timestamp_tag_exit_time(struct gb_timestamp *ts,
 void gb_timestamp_log(struct gb_timestamp *ts, unsigned int cportid,
                       void *payload, size_t len, int id);
 void gb_timestamp_init(void);
+
+/*
+ * Frame time interpolated between the TimeSync strobes: frame clocks, and
+ * the fraction of a frame clock elapsed since, in 1/2^32 units.
+ */
+struct gb_frame_timestamp {
+    uint64_t frame_time;
+    uint32_t frac;
+};
+
+static inline int gb_timestamp_get_frame_time(struct gb_frame_timestamp *ts)
+{
+    if (!ts)
+        return -EINVAL;
+
+    return timesync_get_frame_time_fine(&ts->frame_time, &ts->frac);
+}
 #endif
@@ -80,6 +80,12 @@ struct gb_loopback_statistics {
     unsigned reqs_per_sec_min;
     unsigned reqs_per_sec_max;
     unsigned reqs_per_sec_avg;
+
+    /* latency distribution of the individual requests, in usec */
+    unsigned latency_p50;
+    unsigned latency_p90;
+    unsigned latency_p99;
+    unsigned latency_peak;
 };
 
 typedef int (*gb_loopback_cport_cb)(int, void *);
@@ -89,5 +95,7 @@ int gb_loopback_send_req(int cport, size_t size, uint8_t type);
 int gb_loopback_get_stats(int cport, struct gb_loopback_statistics *stats);
 void gb_loopback_reset(int cport);
 int gb_loopback_cport_valid(int cport);
+int gb_loopback_inflight(int cport);
+void gb_loopback_wait_completion(useconds_t timeout);
 
 #endif
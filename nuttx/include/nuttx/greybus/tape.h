@@ -32,6 +32,11 @@
 #define __GREYBUS_TAPE_H__
 
 #include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* gb_tape_replay() speed to inject the messages back to back */
+#define GB_TAPE_REPLAY_FAST     0
 
 enum {
     GB_TAPE_RDONLY,
@@ -46,12 +51,23 @@ struct gb_tape_mechanism {
     ssize_t (*read)(int fd, void *data, size_t size);
 };
 
+struct gb_tape_replay_stats {
+    uint32_t messages;          /* messages injected */
+    uint32_t bytes;             /* bytes injected, headers included */
+    uint32_t duration;          /* in us, until all messages were processed */
+    uint32_t responses;         /* requests whose response latency is known */
+    uint32_t latency_min;       /* in us, from reception to response */
+    uint32_t latency_max;
+    uint64_t latency_total;
+};
+
 int gb_tape_register_mechanism(struct gb_tape_mechanism *mechanism);
 int gb_tape_arm_semihosting_register(void);
 
 int gb_tape_communication(const char *pathname);
 int gb_tape_stop(void);
-int gb_tape_replay(const char *pathname);
+int gb_tape_replay(const char *pathname, unsigned int speed,
+                   struct gb_tape_replay_stats *stats);
 
 #endif /* __GREYBUS_TAPE_H__ */
 
@@ -52,6 +52,7 @@ void timesync_exit(void);
 
 /* This returns the frame-time */
 uint64_t timesync_get_frame_time(void);
+int timesync_get_frame_time_fine(uint64_t *frame_time, uint32_t *frac);
 int timesync_get_state(void);
 
 #endif	/* _TIMESYNC_H_ */
@@ -29,6 +29,7 @@
 #ifndef __ARCH_ARM_INCLUDE_HIRES_TMR_H
 #define __ARCH_ARM_INCLUDE_HIRES_TMR_H
 
+#include <stdint.h>
 #include <time.h>
 
 /*
@@ -42,6 +43,14 @@
 extern void hrt_gettimespec(struct timespec *ts);
 extern uint32_t hrt_getusec(void);
 extern void hrt_clear_rollover(void);
+
+/*
+ * Return the nanoseconds since the last reboot of the CPU. Unlike
+ * hrt_getusec(), which wraps every 71 minutes, this is monotonic: the
+ * difference of two readings is a duration, with no rollover to handle.
+ * Interrupt context safe and lockless.
+ */
+extern uint64_t hrt_getnsec(void);
 #else
 static inline void hrt_gettimespec(struct timespec *ts)
 {
@@ -52,6 +61,10 @@ static inline uint32_t hrt_getusec(void)
 {
     return 0;
 }
+static inline uint64_t hrt_getnsec(void)
+{
+    return 0;
+}
 #endif /* CONFIG_HAVE_HIRES_TIMER */
 
 #endif /* __ARCH_ARM_INCLUDE_HIRES_TMR_H */
@@ -59,6 +59,12 @@
 #  define CONFIG_MXT_NPOLLWAITERS 2
 #endif
 
+/* Maximum number of messages read in one I2C transfer */
+
+#ifndef CONFIG_MXT_MSGBURST
+#  define CONFIG_MXT_MSGBURST 8
+#endif
+
 /* Thresholding
  *
  * New touch positions will only be reported when the X or Y data
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_IRQMON_H
+#define __INCLUDE_NUTTX_IRQMON_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Latency histogram buckets: bucket n counts the waits of less than 2^n
+ * microseconds, the last one all longer waits.
+ */
+
+#define IRQMON_NBUCKETS 8
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One of the longest windows with the interrupts masked by irqsave() */
+
+struct irqmon_window_s
+{
+  uint32_t  usec;               /* Duration */
+  uintptr_t savepc;             /* irqsave() that masked the interrupts */
+  uintptr_t restorepc;          /* irqrestore() that unmasked them */
+  pid_t     pid;                /* Task that masked them */
+};
+
+/* Per IRQ statistics */
+
+struct irqmon_irq_s
+{
+  uint32_t count;               /* Number of times the handler ran */
+  uint32_t maxusec;             /* Longest run of the handler */
+
+  /* Count of the masked windows and of the other handlers that the IRQ was
+   * left pending behind, by duration.
+   */
+
+  uint16_t latency[IRQMON_NBUCKETS];
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: irqmon_maskstart and irqmon_maskend
+ *
+ * Description:
+ *   Called by irqsave() right after it masks the interrupts, and by
+ *   irqrestore() right before it unmasks them, with the PC of the caller.
+ *   Nested critical sections and interrupt handlers do not call them.
+ *
+ ****************************************************************************/
+
+void irqmon_maskstart(uintptr_t pc);
+void irqmon_maskend(uintptr_t pc);
+
+/****************************************************************************
+ * Name: irqmon_irqenter and irqmon_irqleave
+ *
+ * Description:
+ *   Called by irq_dispatch() around the interrupt handlers.
+ *
+ ****************************************************************************/
+
+void irqmon_irqenter(int irq);
+void irqmon_irqleave(int irq);
+
+/****************************************************************************
+ * Name: irqmon_reset
+ *
+ * Description:
+ *   Clear all statistics.
+ *
+ ****************************************************************************/
+
+void irqmon_reset(void);
+
+/****************************************************************************
+ * Name: irqmon_windows
+ *
+ * Description:
+ *   Copy the longest masked windows, longest first.
+ *
+ * Returned Value:
+ *   The number of windows copied.
+ *
+ ****************************************************************************/
+
+int irqmon_windows(FAR struct irqmon_window_s *windows, int nwindows);
+
+/****************************************************************************
+ * Name: irqmon_irq
+ *
+ * Description:
+ *   Copy the statistics of an IRQ.
+ *
+ * Returned Value:
+ *   OK, or -EINVAL if irq is out of range.
+ *
+ ****************************************************************************/
+
+int irqmon_irq(int irq, FAR struct irqmon_irq_s *info);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_SCHED_IRQMONITOR */
+#endif /* __INCLUDE_NUTTX_IRQMON_H */
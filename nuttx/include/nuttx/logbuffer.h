@@ -30,18 +30,42 @@
 #define _LOG_BUFFER_H_
 
 #include <sys/types.h>
+#include <stdint.h>
 
+struct log_buffer;
+
+/*
+ * Each consumer of a log buffer has its own cursor, so that reading the log
+ * from one place does not take data away from another.  pos and lost count
+ * bytes since the log buffer was allocated.
+ */
+struct log_buffer_reader
+{
+    struct log_buffer *lb;
+    uint32_t pos;               /* Bytes consumed by this reader */
+    uint32_t lost;              /* Bytes overwritten before they were read */
+};
+
+/*
+ * Single writer, multiple readers ring.  Writers must be serialized by the
+ * caller; readers take no lock and detect being overrun by the writer.
+ */
 struct log_buffer
 {
     char *data;
-    char *in;
-    char *out;
-    char *end;
+    size_t size;
+    volatile uint32_t claimed;  /* Bytes the writer has started to write */
+    volatile uint32_t head;     /* Bytes completely written */
+    struct log_buffer_reader reader; /* Used by log_buffer_readlines() */
 };
 
 struct log_buffer *log_buffer_alloc(size_t size);
 size_t log_buffer_write(struct log_buffer *lb, const void *data, size_t len);
 size_t log_buffer_readlines(struct log_buffer *lb, void *data, size_t len);
 
-#endif
+void log_buffer_reader_init(struct log_buffer *lb,
+                            struct log_buffer_reader *rd);
+size_t log_buffer_reader_readlines(struct log_buffer_reader *rd, void *data,
+                                   size_t len);
 
+#endif
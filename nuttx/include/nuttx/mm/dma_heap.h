@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NUTTX_MM_DMA_HEAP_H__
+#define __NUTTX_MM_DMA_HEAP_H__
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+
+#include <nuttx/kmalloc.h>
+
+struct mallinfo;
+
+/*
+ * Alignment in bytes required by a DMA controller, given the
+ * DEVICE_DMA_ALIGNMENT_* bits of its capabilities. These are in bits, and
+ * the least restrictive alignment the controller supports is taken. The
+ * strictest one is taken when the controller reports none.
+ */
+static inline size_t dma_caps_alignment(unsigned int addr_alignment)
+{
+    if (!addr_alignment)
+        return 8;
+
+    return 1 << __builtin_ctz(addr_alignment);
+}
+
+#ifdef CONFIG_MM_DMA_HEAP
+
+void dma_heap_initialize(void);
+void dma_heap_addregion(void *start, size_t size);
+
+void *dma_alloc(size_t size, size_t align);
+void dma_free(void *ptr);
+
+int dma_heap_mallinfo(struct mallinfo *info);
+
+#else
+
+/* Without a DMA heap, the DMA buffers come from the kernel heap */
+static inline void *dma_alloc(size_t size, size_t align)
+{
+    return kmm_memalign(align, size);
+}
+
+static inline void dma_free(void *ptr)
+{
+    kmm_free(ptr);
+}
+
+#endif /* CONFIG_MM_DMA_HEAP */
+
+#endif /* __NUTTX_MM_DMA_HEAP_H__ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NUTTX_MM_MEMPOOL_H__
+#define __NUTTX_MM_MEMPOOL_H__
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+
+/* Allocate a block from the heap when the pool is empty */
+#define MEMPOOL_GROW        (1 << 0)
+
+/* Size taken in the storage by each block of block_size bytes */
+#define MEMPOOL_BLOCK_SIZE(block_size) \
+    (((block_size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/*
+ * A pool of fixed-size blocks, allocated and freed in constant time with
+ * interrupts disabled, so from interrupt context as well.
+ *
+ * The storage of the blocks is given by the user, or allocated from the heap
+ * when the pool is initialized. A pool created with MEMPOOL_GROW takes a
+ * block from the heap when it is empty; that block is then kept in the pool.
+ *
+ * A free block only has its first word overwritten, to link it in the pool,
+ * so that blocks set up once, like receive buffer nodes, keep their setup
+ * across allocations as long as they do not need their first word.
+ */
+struct mempool {
+    void *free_list;        /* first free block */
+    void *storage;          /* blocks the pool was initialized with */
+    size_t block_size;      /* size of a block, MEMPOOL_BLOCK_SIZE() */
+    unsigned int count;     /* blocks in the storage */
+    unsigned int flags;
+#ifdef CONFIG_MM_MEMPOOL_STATS
+    unsigned int size;      /* blocks owned by the pool */
+    unsigned int free;      /* blocks currently available */
+    unsigned int peak;      /* highest number of blocks in use */
+    unsigned int hits;      /* allocations served by the pool */
+    unsigned int misses;    /* allocations that had to grow the pool */
+    unsigned int failures;  /* allocations that could not be served */
+#endif
+};
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+struct mempool_stats {
+    unsigned int size;
+    unsigned int free;
+    unsigned int peak;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int failures;
+};
+#endif
+
+int mempool_init(struct mempool *pool, void *storage, size_t block_size,
+                 unsigned int count, unsigned int flags);
+void mempool_deinit(struct mempool *pool);
+
+struct mempool *mempool_create(size_t block_size, unsigned int count,
+                               unsigned int flags);
+void mempool_destroy(struct mempool *pool);
+
+void *mempool_alloc(struct mempool *pool);
+void mempool_free(struct mempool *pool, void *block);
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+void mempool_get_stats(struct mempool *pool, struct mempool_stats *stats);
+#endif
+
+#endif /* __NUTTX_MM_MEMPOOL_H__ */
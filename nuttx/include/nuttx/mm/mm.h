@@ -165,7 +165,16 @@
 
 #define MM_MIN_CHUNK     (1 << MM_MIN_SHIFT)
 #define MM_MAX_CHUNK     (1 << MM_MAX_SHIFT)
-#define MM_NNODES        (MM_MAX_SHIFT - MM_MIN_SHIFT + 1)
+
+/* The free nodes are sorted in two levels of lists: one level per power of
+ * two of the chunk size, each split in 1 << MM_SL_SHIFT lists of even size
+ * ranges.  Chunks of MM_MAX_CHUNK bytes and more all go in the last list.
+ */
+
+#define MM_SL_SHIFT      2
+#define MM_NSL           (1 << MM_SL_SHIFT)
+#define MM_NFL           (MM_MAX_SHIFT - MM_MIN_SHIFT + 1)
+#define MM_NNODES        (MM_NFL << MM_SL_SHIFT)
 
 #define MM_GRAN_MASK     (MM_MIN_CHUNK-1)
 #define MM_ALIGN_UP(a)   (((a) + MM_GRAN_MASK) & ~MM_GRAN_MASK)
@@ -244,6 +253,45 @@ struct mm_freenode_s
 #define CHECK_FREENODE_SIZE \
   DEBUGASSERT(sizeof(struct mm_freenode_s) == SIZEOF_MM_FREENODE)
 
+#ifdef CONFIG_MM_PROFILE
+/* With the heap profiling, the last word of each allocated chunk holds the
+ * index of the caller entry the chunk is accounted to.
+ */
+
+#  define MM_TAGSIZE      sizeof(uint32_t)
+
+struct mm_caller_s
+{
+  FAR void *mc_caller;            /* Return address of the allocation */
+  size_t    mc_inuse;             /* Bytes held, overhead included */
+  uint32_t  mc_nchunks;           /* Chunks held */
+};
+
+struct mm_profile_s
+{
+  size_t    mp_inuse;             /* Bytes allocated, overhead included */
+  size_t    mp_peak;              /* Largest mp_inuse seen */
+  uint32_t  mp_peaktime;          /* System timer when mp_peak was seen */
+  uint32_t  mp_allocs[MM_NFL];    /* Allocations, per power of two */
+  uint32_t  mp_live[MM_NFL];      /* Chunks allocated, per power of two */
+  struct mm_caller_s mp_callers[CONFIG_MM_PROFILE_NCALLERS];
+};
+#else
+#  define MM_TAGSIZE      0
+#endif
+
+#ifdef CONFIG_MM_CACHE
+/* Caches of freed small chunks, one size class per MM_MIN_CHUNK bytes */
+
+#define MM_CACHE_NCLASSES (CONFIG_MM_CACHE_MAXSIZE >> MM_MIN_SHIFT)
+
+struct mm_cache_s
+{
+  uint8_t mc_count[MM_CACHE_NCLASSES];
+  FAR void *mc_chunks[MM_CACHE_NCLASSES][CONFIG_MM_CACHE_DEPTH];
+};
+#endif
+
 /* This describes one heap (possibly with multiple regions) */
 
 struct mm_heap_s
@@ -277,6 +325,23 @@ struct mm_heap_s
    */
 
   struct mm_freenode_s mm_nodelist[MM_NNODES];
+
+  /* Bitmaps of the non-empty lists: one bit per power of two in mm_flmap,
+   * and one bit per list of that power of two in mm_slmap.
+   */
+
+  uint32_t mm_flmap;
+  uint8_t  mm_slmap[MM_NFL];
+
+#ifdef CONFIG_MM_CACHE
+  /* Freed small chunks, kept allocated for reuse, per priority band */
+
+  struct mm_cache_s mm_cache[CONFIG_MM_CACHE_BANDS];
+#endif
+
+#ifdef CONFIG_MM_PROFILE
+  struct mm_profile_s mm_profile;
+#endif
 };
 
 /****************************************************************************
@@ -380,6 +445,35 @@ FAR void *kmm_malloc(size_t size);
 /* Functions contained in mm_free.c *****************************************/
 
 void mm_free(FAR struct mm_heap_s *heap, FAR void *mem);
+void mm_freechunk(FAR struct mm_heap_s *heap, FAR void *mem);
+
+/* Functions contained in mm_profile.c **************************************/
+
+#ifdef CONFIG_MM_PROFILE
+void mm_profile_initialize(FAR struct mm_heap_s *heap);
+void mm_profile_alloc(FAR struct mm_heap_s *heap,
+                      FAR struct mm_allocnode_s *node, FAR void *caller);
+void mm_profile_free(FAR struct mm_heap_s *heap,
+                     FAR struct mm_allocnode_s *node);
+FAR void *mm_profile_caller(FAR struct mm_heap_s *heap,
+                            FAR struct mm_allocnode_s *node);
+void mm_profile_setcaller(FAR struct mm_heap_s *heap, FAR void *mem,
+                          FAR void *caller);
+void mm_profile(FAR struct mm_heap_s *heap, FAR struct mm_profile_s *info);
+
+/* Functions contained in umm_profile.c *************************************/
+
+void umm_profile(FAR struct mm_profile_s *info);
+#endif
+
+/* Functions contained in mm_cache.c ****************************************/
+
+#ifdef CONFIG_MM_CACHE
+void mm_cache_initialize(FAR struct mm_heap_s *heap);
+FAR void *mm_cache_alloc(FAR struct mm_heap_s *heap, size_t size);
+bool mm_cache_free(FAR struct mm_heap_s *heap, FAR void *mem);
+int mm_cache_flush(FAR struct mm_heap_s *heap);
+#endif
 
 /* Functions contained in kmm_free.c ****************************************/
 
@@ -392,6 +486,18 @@ void kmm_free(FAR void *mem);
 FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
                      size_t size);
 
+/* Functions contained in mm_resize.c ***************************************/
+
+int mm_tryexpand(FAR struct mm_heap_s *heap, FAR void *mem, size_t size);
+void mm_shrinktofit(FAR struct mm_heap_s *heap, FAR void *mem, size_t size);
+
+/* Functions contained in umm_resize.c **************************************/
+
+#if !defined(CONFIG_BUILD_PROTECTED) || !defined(__KERNEL__)
+int umm_tryexpand(FAR void *mem, size_t size);
+void umm_shrinktofit(FAR void *mem, size_t size);
+#endif
+
 /* Functions contained in kmm_realloc.c *************************************/
 
 #ifdef CONFIG_MM_KERNEL_HEAP
@@ -503,10 +609,18 @@ int kmm_mallinfo(struct mallinfo *info);
 void mm_shrinkchunk(FAR struct mm_heap_s *heap,
                     FAR struct mm_allocnode_s *node, size_t size);
 
+/* Functions contained in mm_expandchunk.c *********************************/
+
+bool mm_expandchunk(FAR struct mm_heap_s *heap,
+                    FAR struct mm_allocnode_s *node, size_t size);
+
 /* Functions contained in mm_addfreechunk.c *********************************/
 
 void mm_addfreechunk(FAR struct mm_heap_s *heap,
                      FAR struct mm_freenode_s *node);
+void mm_delfreechunk(FAR struct mm_heap_s *heap,
+                     FAR struct mm_freenode_s *node);
+int mm_nextndx(FAR struct mm_heap_s *heap, int ndx);
 
 /* Functions contained in mm_size2ndx.c.c ***********************************/
 
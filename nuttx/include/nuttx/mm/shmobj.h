@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NUTTX_MM_SHMOBJ_H__
+#define __NUTTX_MM_SHMOBJ_H__
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+
+/*
+ * Shared memory objects for the flat build, where all the tasks share the
+ * address space: a named buffer is created by one task and attached by
+ * others, which then all access the same memory, without copies.
+ *
+ * An object is reference counted. The creator holds the first reference,
+ * and each shmobj_open() or shmobj_get() takes one more. The buffer is
+ * freed, and its name released, when the last reference is put. Any task
+ * holding a reference may pass the object on to another one, in a message
+ * for instance, after taking a reference for it with shmobj_get().
+ *
+ * The buffers come from a granule allocator of their own or from bufram,
+ * depending on the configuration, so bulk data does not fragment the heap.
+ * The access to the data itself is not synchronized.
+ */
+struct shmobj;
+
+int shmobj_initialize(void);
+
+struct shmobj *shmobj_create(const char *name, size_t size);
+struct shmobj *shmobj_open(const char *name);
+
+void shmobj_get(struct shmobj *obj);
+void shmobj_put(struct shmobj *obj);
+
+void *shmobj_data(struct shmobj *obj);
+size_t shmobj_size(struct shmobj *obj);
+
+#endif /* __NUTTX_MM_SHMOBJ_H__ */
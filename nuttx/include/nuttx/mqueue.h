@@ -79,6 +79,10 @@ struct msgq_s
   uint16_t     maxmsgsize;    /* Max size of message in message queue */
 #endif
   bool         unlinked;      /* true if the msg queue has been unlinked */
+#ifdef CONFIG_MQ_PREALLOC
+  sq_queue_t   msgfree;       /* Free messages of msgpool */
+  FAR void    *msgpool;       /* Messages allocated with the queue */
+#endif
 #ifndef CONFIG_DISABLE_SIGNALS
   FAR struct mq_des *ntmqdes; /* Notification: Owning mqdes (NULL if none) */
   pid_t        ntpid;         /* Notification: Receiving Task's PID */
@@ -73,6 +73,9 @@ struct nand_dev_s
   struct mtd_dev_s mtd;       /* Externally visible part of the driver */
   FAR struct nand_raw_s *raw; /* Retained reference to the lower half */
   sem_t exclsem;              /* For exclusive access to the NAND FLASH */
+#ifdef CONFIG_MTD_NAND_BBT
+  FAR uint8_t *bbt;           /* Bad block table, one bit per block (1=bad) */
+#endif
 };
 
 /****************************************************************************
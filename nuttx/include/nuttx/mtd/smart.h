@@ -87,6 +87,10 @@ struct mtd_smart_procfs_data_s
   FAR const uint8_t*  erasecounts;      /* Array of erase counts per erase block */
   size_t              neraseblocks;     /* Number of erase blocks */
 #endif
+#ifdef CONFIG_MTD_SMART_WEAR_STATS
+  FAR const uint16_t* wearcounts;       /* Array of erases per erase block */
+  uint16_t            nwearblocks;      /* Number of entries in wearcounts */
+#endif
 #ifdef CONFIG_MTD_SMART_ALLOC_DEBUG
   FAR const struct smart_alloc_s  *allocs; /* Array of allocations */ 
   uint16_t            alloccount;       /* Number of items in the array */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_MUTEX_H
+#define __INCLUDE_NUTTX_MUTEX_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <errno.h>
+#include <semaphore.h>
+
+#ifdef CONFIG_MUTEX
+#  include <arch/atomic.h>
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifdef CONFIG_MUTEX
+/* A mutex is taken and released with a single exclusive access on its owner
+ * word when nobody else wants it.  Only contended operations disable
+ * interrupts, block on the semaphore and apply priority inheritance.
+ */
+
+typedef struct mutex_s
+{
+  atomic_t owner;           /* Owner pid + 1, 0 if free, MUTEX_WAITERS flag */
+  sem_t    sem;             /* Contended lockers block here */
+  uint8_t  holdprio;        /* Owner priority before a boost, 0 if none */
+} mutex_t;
+#else
+/* Without atomic operations a mutex is a binary semaphore */
+
+typedef sem_t mutex_t;
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+#ifdef CONFIG_MUTEX
+
+/****************************************************************************
+ * Name: mutex_init
+ *
+ * Description:
+ *   Initialize an unlocked mutex.
+ *
+ ****************************************************************************/
+
+int mutex_init(FAR mutex_t *mutex);
+
+/****************************************************************************
+ * Name: mutex_destroy
+ *
+ * Description:
+ *   Release the resources of an unlocked mutex.
+ *
+ ****************************************************************************/
+
+int mutex_destroy(FAR mutex_t *mutex);
+
+/****************************************************************************
+ * Name: mutex_lock
+ *
+ * Description:
+ *   Lock the mutex, waiting for it as long as necessary.  Signals do not
+ *   interrupt the wait.  With CONFIG_PRIORITY_INHERITANCE, the owner runs
+ *   at the priority of the highest priority waiter until it unlocks.
+ *
+ * Returned Value:
+ *   OK, or -EDEADLK if the caller already owns the mutex.
+ *
+ ****************************************************************************/
+
+int mutex_lock(FAR mutex_t *mutex);
+
+/****************************************************************************
+ * Name: mutex_trylock
+ *
+ * Description:
+ *   Lock the mutex if it is free.
+ *
+ * Returned Value:
+ *   OK, or -EBUSY if the mutex is owned.
+ *
+ ****************************************************************************/
+
+int mutex_trylock(FAR mutex_t *mutex);
+
+/****************************************************************************
+ * Name: mutex_unlock
+ *
+ * Description:
+ *   Unlock a mutex owned by the caller and wake the highest priority
+ *   waiter, if any.
+ *
+ * Returned Value:
+ *   OK, or -EPERM if the caller does not own the mutex.
+ *
+ ****************************************************************************/
+
+int mutex_unlock(FAR mutex_t *mutex);
+
+#else
+
+static inline int mutex_init(FAR mutex_t *mutex)
+{
+  return sem_init(mutex, 0, 1) == OK ? OK : -get_errno();
+}
+
+static inline int mutex_destroy(FAR mutex_t *mutex)
+{
+  return sem_destroy(mutex) == OK ? OK : -get_errno();
+}
+
+static inline int mutex_lock(FAR mutex_t *mutex)
+{
+  while (sem_wait(mutex) != OK)
+    {
+      if (get_errno() != EINTR)
+        {
+          return -get_errno();
+        }
+    }
+
+  return OK;
+}
+
+static inline int mutex_trylock(FAR mutex_t *mutex)
+{
+  return sem_trywait(mutex) == OK ? OK : -EBUSY;
+}
+
+static inline int mutex_unlock(FAR mutex_t *mutex)
+{
+  return sem_post(mutex) == OK ? OK : -get_errno();
+}
+
+#endif /* CONFIG_MUTEX */
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_MUTEX_H */
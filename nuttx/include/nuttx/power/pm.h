@@ -320,6 +320,17 @@ struct pm_callback_s
   pm_notify_cb notify;
 
   void *priv; /* Private data. */
+
+#ifdef CONFIG_PM_CALLBACK_TIMING
+  /* Duration of the last and of the longest call to each callback, in
+   * microseconds.  Maintained by pm_changestate().
+   */
+
+  uint32_t prepare_us;
+  uint32_t prepare_max_us;
+  uint32_t notify_us;
+  uint32_t notify_max_us;
+#endif
 };
 
 /****************************************************************************
@@ -404,6 +415,34 @@ EXTERN int pm_register(FAR struct pm_callback_s *callbacks);
 
 EXTERN void pm_activity(int priority);
 
+/****************************************************************************
+ * Name: pm_domain_activity
+ *
+ * Description:
+ *   Same as pm_activity() but also records the activity in the given
+ *   activity domain.  The predictive governor learns the interval between
+ *   the bursts of activity of each domain and pm_checkstate() will not
+ *   recommend a state whose break-even time is longer than the time until
+ *   the next burst is expected.
+ *
+ * Input Parameters:
+ *   domain   - Activity domain, range 0 to CONFIG_PM_PREDICT_NDOMAINS - 1.
+ *   priority - Activity priority, as for pm_activity().
+ *
+ * Returned Value:
+ *   None.
+ *
+ * Assumptions:
+ *   This function may be called from an interrupt handler.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PM_PREDICT
+EXTERN void pm_domain_activity(int domain, int priority);
+#else
+#  define pm_domain_activity(domain, prio) pm_activity(prio)
+#endif
+
 /****************************************************************************
  * Name: pm_checkstate
  *
@@ -466,6 +505,19 @@ EXTERN enum pm_state_e pm_checkstate(void);
 
 EXTERN int pm_changestate(enum pm_state_e newstate);
 
+/****************************************************************************
+ * Name: pm_dumptiming
+ *
+ * Description:
+ *   Log the time spent in the prepare() and notify() callbacks of every
+ *   registered driver during the last state changes.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PM_CALLBACK_TIMING
+EXTERN void pm_dumptiming(void);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -486,6 +538,7 @@ EXTERN int pm_changestate(enum pm_state_e newstate);
 #  define pm_initialize()
 #  define pm_register(cb)       (0)
 #  define pm_activity(prio)
+#  define pm_domain_activity(domain, prio)
 #  define pm_checkstate()       (0)
 #  define pm_changestate(state)
 
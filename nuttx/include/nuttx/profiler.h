@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_PROFILER_H
+#define __INCLUDE_NUTTX_PROFILER_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One histogram entry: the number of samples that interrupted 'pid' at 'pc' */
+
+struct profiler_sample_s
+{
+  uint32_t pc;
+  uint32_t count;
+  uint16_t pid;
+  uint16_t reserved;
+};
+
+typedef void (*profiler_foreach_t)(FAR const struct profiler_sample_s *sample,
+                                   FAR void *arg);
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+#ifdef CONFIG_ARCH_PROFILER
+
+/****************************************************************************
+ * Name: profiler_start
+ *
+ * Description:
+ *   Empty the histogram and start sampling the interrupted program counter
+ *   and task CONFIG_ARCH_PROFILER_RATE times per second.
+ *
+ ****************************************************************************/
+
+int profiler_start(void);
+
+/****************************************************************************
+ * Name: profiler_stop
+ *
+ * Description:
+ *   Stop sampling.  The histogram is kept until the next start.
+ *
+ ****************************************************************************/
+
+void profiler_stop(void);
+
+/****************************************************************************
+ * Name: profiler_foreach
+ *
+ * Description:
+ *   Pass each entry of the histogram to 'handler', in no particular order.
+ *
+ * Returned Value:
+ *   The number of samples dropped because the histogram was full, or
+ *   -EBUSY if sampling is still started.
+ *
+ ****************************************************************************/
+
+int profiler_foreach(profiler_foreach_t handler, FAR void *arg);
+
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_PROFILER_H */
@@ -56,6 +56,8 @@
 #ifndef __INCLUDE_NUTTX_RING_BUF_H
 #define __INCLUDE_NUTTX_RING_BUF_H
 
+#include <nuttx/bufram.h>
+
 enum ring_buf_owner {
     RING_BUF_OWNER_INVALID,
     RING_BUF_OWNER_PRODUCER,
@@ -290,5 +292,20 @@ struct ring_buf *ring_buf_alloc_ring(unsigned int entries,
 void ring_buf_free_ring(struct ring_buf *first_rb,
                         void (*free_callback)(struct ring_buf *rb, void *arg),
                                               void *arg);
+struct ring_buf *ring_buf_alloc_contiguous(unsigned int entries,
+                                    unsigned int headroom,
+                                    unsigned int data_len,
+                                    unsigned int tailroom,
+                                    unsigned int align,
+                                    enum bufram_owner owner,
+                                    int (*alloc_callback)(struct ring_buf *rb,
+                                                          void *arg),
+                                    void (*free_callback)(struct ring_buf *rb,
+                                                          void *arg),
+                                    void *arg);
+void ring_buf_free_contiguous(struct ring_buf *rb,
+                              void (*free_callback)(struct ring_buf *rb,
+                                                    void *arg),
+                              void *arg);
 
 #endif /* __INCLUDE_NUTTX_RING_BUF_H */
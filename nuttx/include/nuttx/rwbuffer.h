@@ -44,6 +44,7 @@
 
 #include <sys/types.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <semaphore.h>
 #include <nuttx/wqueue.h>
 
@@ -67,6 +68,28 @@ typedef ssize_t (*rwbreload_t)(FAR void *dev, FAR uint8_t *buffer,
 typedef ssize_t (*rwbflush_t)(FAR void *dev, FAR const uint8_t *buffer,
                               off_t startblock, size_t nblocks);
 
+/* Buffering statistics.  Block counts are in units of the device block
+ * size.  The read-ahead hit ratio is rhhits / (rhhits + rhmisses); the
+ * wrfl* counters break down why the write buffer was flushed.
+ */
+
+#ifdef CONFIG_DRVR_RWBSTATS
+struct rwb_stats_s
+{
+  uint32_t      rhhits;          /* Blocks found in the read-ahead buffer */
+  uint32_t      rhmisses;        /* Blocks that required a reload */
+  uint32_t      rhreloads;       /* Number of read-ahead buffer reloads */
+  uint32_t      rhblocks;        /* Blocks read by those reloads */
+  uint32_t      wrblocks;        /* Blocks accepted into the write buffer */
+  uint32_t      wrflushblocks;   /* Blocks written by buffer flushes */
+  uint32_t      wrfltimeout;     /* Flushes: no activity for CONFIG_DRVR_WRDELAY */
+  uint32_t      wrflseq;         /* Flushes: non-sequential write */
+  uint32_t      wrflfull;        /* Flushes: buffer capacity exceeded */
+  uint32_t      wrflread;        /* Flushes: read overlapped the buffer */
+  uint32_t      wrfldirect;      /* Flushes: write too large to buffer */
+};
+#endif
+
 /* This structure holds the state of the buffers.  In typical usage,
  * an instance of this structure is declared within each block driver
  * status structure like:
@@ -116,6 +139,26 @@ struct rwbuffer_s
   uint16_t      rhmaxblocks;     /* The number of blocks to buffer in memory */
 #endif
 
+  /* Optional tuning; leave zero for the fixed behavior.
+   *
+   * wralignblocks.  When the write buffer overflows, only the blocks up
+   *   to the last multiple of wralignblocks (normally the erase block
+   *   size) are flushed; the partial erase block at the end is kept so
+   *   that it can be completed by the writes that follow.  Ignored unless
+   *   smaller than wrmaxblocks.
+   * rhminblocks.  Initial read-ahead window.  Each reload that continues
+   *   a sequential stream doubles the window up to rhmaxblocks; a random
+   *   access drops it back to rhminblocks.  Zero always reads
+   *   rhmaxblocks.
+   */
+
+#ifdef CONFIG_DRVR_WRITEBUFFER
+  uint16_t      wralignblocks;   /* Flush alignment in blocks */
+#endif
+#ifdef CONFIG_DRVR_READAHEAD
+  uint16_t      rhminblocks;     /* Initial read-ahead window in blocks */
+#endif
+
   /* Callback functions.
    *
    * wrflush.  This callback is normally used to flush the contents of
@@ -150,7 +193,13 @@ struct rwbuffer_s
   sem_t         rhsem;           /* Enforces exclusive access to the write buffer */
   uint8_t      *rhbuffer;        /* Allocated read-ahead buffer */
   uint16_t      rhnblocks;       /* Number of blocks in read-ahead buffer */
+  uint16_t      rhwindow;        /* Number of blocks to load on the next reload */
   off_t         rhblockstart;    /* First block in read-ahead buffer */
+  off_t         rhnextblock;     /* Block following the last one read */
+#endif
+
+#ifdef CONFIG_DRVR_RWBSTATS
+  struct rwb_stats_s stats;      /* Buffering statistics */
 #endif
 };
 
@@ -202,6 +251,13 @@ int rwb_invalidate(FAR struct rwbuffer_s *rwb,
                    off_t startblock, size_t blockcount);
 #endif
 
+/* Statistics */
+
+#ifdef CONFIG_DRVR_RWBSTATS
+void rwb_getstats(FAR struct rwbuffer_s *rwb, FAR struct rwb_stats_s *stats,
+                  bool reset);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
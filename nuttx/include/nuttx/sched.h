@@ -52,6 +52,7 @@
 #include <time.h>
 
 #include <nuttx/irq.h>
+#include <nuttx/wdog.h>
 #include <nuttx/mm/shm.h>
 #include <nuttx/fs/fs.h>
 
@@ -487,6 +488,16 @@ struct tcb_s
   int      timeslice;                    /* RR timeslice interval remaining     */
 #endif
   FAR struct wdog_s *waitdog;            /* All timed waits used this wdog      */
+  struct wdog_s waittimer;               /* The wdog of the timed waits         */
+
+  /* CPU Accounting Fields ******************************************************/
+
+#ifdef CONFIG_SCHED_CPUACCT
+  uint64_t run_usec;                     /* Time running, interrupts excluded   */
+  uint64_t irq_usec;                     /* Time in interrupts taken meanwhile  */
+  uint32_t nvcsw;                        /* Voluntary context switches          */
+  uint32_t nivcsw;                       /* Involuntary context switches        */
+#endif
 
   /* Stack-Related Fields *******************************************************/
 
@@ -602,6 +613,18 @@ struct pthread_tcb_s
 
 typedef void (*sched_foreach_t)(FAR struct tcb_s *tcb, FAR void *arg);
 
+/* This structure is used to report the CPU accounting of a thread */
+
+#ifdef CONFIG_SCHED_CPUACCT
+struct cpuacct_s
+{
+  uint64_t run_usec;                     /* Time running, interrupts excluded   */
+  uint64_t irq_usec;                     /* Time in interrupts taken meanwhile  */
+  uint32_t nvcsw;                        /* Voluntary context switches          */
+  uint32_t nivcsw;                       /* Involuntary context switches        */
+};
+#endif
+
 #endif /* __ASSEMBLY__ */
 
 /********************************************************************************
@@ -640,6 +663,14 @@ void sched_foreach(sched_foreach_t handler, FAR void *arg);
 
 FAR struct tcb_s *sched_gettcb(pid_t pid);
 
+/* Return the CPU accounting of a thread, including the time it has been
+ * running for, if it is running.  Returns -ESRCH if the pid is not valid.
+ */
+
+#ifdef CONFIG_SCHED_CPUACCT
+int sched_cpuacct(pid_t pid, FAR struct cpuacct_s *acct);
+#endif
+
 /* File system helpers **********************************************************/
 /* These functions all extract lists from the group structure assocated with the
  * currently executing task.
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_SCHED_TRACE_H
+#define __INCLUDE_NUTTX_SCHED_TRACE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Event types.  The meaning of the two arguments depends on the type. */
+
+#define SCHED_TRACE_SWITCH        0 /* arg1: pid switched to */
+#define SCHED_TRACE_IRQ_ENTER     1 /* arg1: irq */
+#define SCHED_TRACE_IRQ_LEAVE     2 /* arg1: irq, arg2: pid resumed */
+#define SCHED_TRACE_SEM_WAIT      3 /* arg1: pid, arg2: semaphore */
+#define SCHED_TRACE_SEM_WAKE      4 /* arg1: pid, arg2: semaphore */
+#define SCHED_TRACE_GB_RX         5 /* arg1: cport, arg2: SCHED_TRACE_GB_OP() */
+#define SCHED_TRACE_GB_DISPATCH   6 /* arg1: cport, arg2: SCHED_TRACE_GB_OP() */
+#define SCHED_TRACE_GB_RESPONSE   7 /* arg1: cport, arg2: SCHED_TRACE_GB_OP() */
+
+/* Greybus operation id, type and result packed in the second argument */
+
+#define SCHED_TRACE_GB_OP(id, type, result) \
+  (((uint32_t)(id) << 16) | ((uint32_t)(type) << 8) | (uint8_t)(result))
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct sched_trace_event_s
+{
+  uint32_t usec;                /* hrt_getusec() at the event */
+  uint32_t arg2;
+  uint16_t arg1;
+  uint8_t  type;                /* SCHED_TRACE_* */
+  uint8_t  reserved;
+};
+
+typedef void (*sched_trace_foreach_t)
+  (FAR const struct sched_trace_event_s *event, FAR void *arg);
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+#ifdef CONFIG_SCHED_TRACE
+
+/****************************************************************************
+ * Name: sched_trace
+ *
+ * Description:
+ *   Record an event in the trace ring, if tracing is started.  Once the
+ *   ring is full, the oldest events are overwritten.  This may be called
+ *   from interrupt handlers.
+ *
+ ****************************************************************************/
+
+void sched_trace(uint8_t type, uint16_t arg1, uint32_t arg2);
+
+/****************************************************************************
+ * Name: sched_trace_start
+ *
+ * Description:
+ *   Empty the trace ring and start recording.
+ *
+ ****************************************************************************/
+
+void sched_trace_start(void);
+
+/****************************************************************************
+ * Name: sched_trace_stop
+ *
+ * Description:
+ *   Stop recording.  The ring is kept until the next start.
+ *
+ ****************************************************************************/
+
+void sched_trace_stop(void);
+
+/****************************************************************************
+ * Name: sched_trace_foreach
+ *
+ * Description:
+ *   Pass each event of the trace ring, oldest first, to 'handler'.
+ *
+ * Returned Value:
+ *   The number of events lost because the ring wrapped, or -EBUSY if
+ *   tracing is still started.
+ *
+ ****************************************************************************/
+
+int sched_trace_foreach(sched_trace_foreach_t handler, FAR void *arg);
+
+#else
+#  define sched_trace(type, arg1, arg2)
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_SCHED_TRACE_H */
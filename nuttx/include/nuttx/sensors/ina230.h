@@ -36,6 +36,7 @@
 #define __INA_230_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <nuttx/i2c.h>
 
 #define INA230_MAX_DEVS     8       /* ina230 supports 8 i2c addresses */
@@ -104,6 +105,8 @@ uint32_t ina230_get_sampling_time(ina230_conversion_time ct,
                                  ina230_avg_count avg_count,
                                  ina230_power_mode mode);
 int ina230_get_data(ina230_device *dev, ina230_sample *m);
+int ina230_set_cnvr_alert(ina230_device *dev, bool enable);
+int ina230_ack_alert(ina230_device *dev);
 int ina230_deinit(ina230_device *dev);
 
 #endif
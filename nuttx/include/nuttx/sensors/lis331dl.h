@@ -42,7 +42,10 @@
 #ifndef __INCLUDE_NUTTX_SENSORS_LIS331DL_H
 #define __INCLUDE_NUTTX_SENSORS_LIS331DL_H
 
+#include <nuttx/config.h>
 #include <nuttx/i2c.h>
+#include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /************************************************************************************
@@ -70,6 +73,11 @@ struct lis331dl_vector_s {
     int8_t  x, y, z;
 };
 
+struct lis331dl_sample_s {
+    uint32_t usec;                  /* hrt_getusec() at the data ready interrupt */
+    struct lis331dl_vector_s a;
+};
+
 
 /************************************************************************************
  * Public Function Prototypes
@@ -132,6 +140,36 @@ EXTERN int lis331dl_getsamplerate(struct lis331dl_dev_s * dev);
  */
 EXTERN const struct lis331dl_vector_s * lis331dl_getreadings(struct lis331dl_dev_s * dev);
 
+#ifdef CONFIG_LIS331DL_STREAM
+/** Start streaming the samples
+ *
+ * The data ready signal of the LIS331DL is routed to its INT1 pin, which must be
+ * connected to the given GPIO. Each sample is read when the signal rises.
+ *
+ * \param dev Device to LIS331DL device structure
+ * \param gpio GPIO connected to the INT1 pin
+ * \return OK on success or errno is set
+ **/
+EXTERN int lis331dl_startstream(struct lis331dl_dev_s * dev, uint8_t gpio);
+
+/** Stop streaming the samples, the buffered samples are dropped */
+EXTERN int lis331dl_stopstream(struct lis331dl_dev_s * dev);
+
+/** Read the buffered samples
+ *
+ * Wait for a sample if none is buffered, then return as many as available.
+ *
+ * \param dev Device to LIS331DL device structure
+ * \param samples Where to copy the samples, oldest first
+ * \param nsamples Room in samples
+ * \return Number of samples copied, or ERROR with errno set (EINTR, EINVAL if
+ *   not streaming)
+ **/
+EXTERN ssize_t lis331dl_readsamples(struct lis331dl_dev_s * dev,
+                                    struct lis331dl_sample_s * samples,
+                                    size_t nsamples);
+#endif
+
 
 #undef EXTERN
 #if defined(__cplusplus)
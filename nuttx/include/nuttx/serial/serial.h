@@ -83,6 +83,13 @@
   (dev->ops->rxflowcontrol && dev->ops->rxflowcontrol(dev))
 #endif
 
+#ifdef CONFIG_SERIAL_DMARX
+#define uart_dmarxstart(dev) \
+  do { if (dev->ops->dmarxstart) dev->ops->dmarxstart(dev); } while (0)
+#else
+#define uart_dmarxstart(dev)
+#endif
+
 /************************************************************************************
  * Public Types
  ************************************************************************************/
@@ -191,6 +198,17 @@ struct uart_ops_s
    */
 
   CODE bool (*txempty)(FAR struct uart_dev_s *dev);
+
+#ifdef CONFIG_SERIAL_DMARX
+  /* Optional.  (Re)start circular DMA reception into recv.buffer at index 0.
+   * Called when the port is opened, after the buffer indices are reset.  The
+   * lower half then reports the DMA position with uart_recvdma() from its
+   * half-transfer, transfer-complete and line idle interrupts, which rxint()
+   * enables and disables.  NULL for ports that receive with uart_recvchars().
+   */
+
+  CODE void (*dmarxstart)(FAR struct uart_dev_s *dev);
+#endif
 };
 
 /* This is the device structure used by the driver.  The caller of
@@ -307,6 +325,23 @@ void uart_xmitchars(FAR uart_dev_t *dev);
 
 void uart_recvchars(FAR uart_dev_t *dev);
 
+/************************************************************************************
+ * Name: uart_recvdma
+ *
+ * Description:
+ *   This function is called from the UART interrupt handler of a lower half that
+ *   receives with circular DMA into recv.buffer.  'head' is the index in the buffer
+ *   where the DMA will write the next byte.  It must be called at least on every
+ *   half-transfer and transfer-complete interrupt, so that the DMA never gets a
+ *   whole buffer ahead of the last call, and on line idle so that the tail of a
+ *   burst is not held back.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_SERIAL_DMARX
+void uart_recvdma(FAR uart_dev_t *dev, int16_t head);
+#endif
+
 /************************************************************************************
  * Name: uart_datareceived
  *
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_SYSLOG_BINLOG_H
+#define __INCLUDE_NUTTX_SYSLOG_BINLOG_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdarg.h>
+
+#ifdef CONFIG_BINLOG
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSLOG_DEVPATH
+#  define CONFIG_SYSLOG_DEVPATH "/dev/binlog"
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifndef __ASSEMBLY__
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: binlog_vprintf
+ *
+ * Description:
+ *   Save a message in the binary log.  Only the format string pointer and
+ *   the arguments are stored; the message is formatted when it is read.
+ *   The format string must therefore stay valid for the life of the
+ *   system.  May be called from interrupt handlers.
+ *
+ * Returned Value:
+ *   The number of bytes saved in the log.
+ *
+ ****************************************************************************/
+
+EXTERN int binlog_vprintf(FAR const char *fmt, va_list ap);
+
+/****************************************************************************
+ * Name: binlog_read
+ *
+ * Description:
+ *   Format and remove messages from the binary log.  Only whole messages
+ *   are returned unless a single message does not fit in the buffer, in
+ *   which case it is truncated.
+ *
+ * Returned Value:
+ *   The number of bytes written to buffer, zero if the log is empty.
+ *
+ ****************************************************************************/
+
+EXTERN ssize_t binlog_read(FAR char *buffer, size_t buflen);
+
+/****************************************************************************
+ * Name: binlog_sysloginit
+ *
+ * Description:
+ *   Register the binary log character driver at CONFIG_SYSLOG_DEVPATH.
+ *
+ ****************************************************************************/
+
+EXTERN int binlog_sysloginit(void);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLY__ */
+#endif /* CONFIG_BINLOG */
+#endif /* __INCLUDE_NUTTX_SYSLOG_BINLOG_H */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_NUTTX_TPOOL_H
+#define __INCLUDE_NUTTX_TPOOL_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <pthread.h>
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+#ifdef CONFIG_SCHED_TPOOL
+
+/****************************************************************************
+ * Name: tpool_initialize
+ *
+ * Description:
+ *   Start the threads of the pool.  Called once by os_bringup().
+ *
+ ****************************************************************************/
+
+void tpool_initialize(void);
+
+/****************************************************************************
+ * Name: tpool_create
+ *
+ * Description:
+ *   Run 'entry' on an idle thread of the pool, the one with the smallest
+ *   stack at least as large as the stack size of 'attr'.  The thread gets
+ *   the priority of 'attr'.  If no such thread is idle, a new pthread is
+ *   created instead.
+ *
+ *   'entry' runs on a kernel thread: it must return instead of calling
+ *   pthread_exit(), and must not be cancelled or detached.
+ *
+ * Input Parameters:
+ *   Those of pthread_create()
+ *
+ * Returned Value:
+ *   0 on success, an errno value otherwise.
+ *
+ ****************************************************************************/
+
+int tpool_create(FAR pthread_t *thread, FAR const pthread_attr_t *attr,
+                 pthread_startroutine_t entry, pthread_addr_t arg);
+
+/****************************************************************************
+ * Name: tpool_join
+ *
+ * Description:
+ *   Wait for a thread started by tpool_create() to return, and give it back
+ *   to the pool.
+ *
+ * Input Parameters:
+ *   Those of pthread_join()
+ *
+ * Returned Value:
+ *   0 on success, an errno value otherwise.
+ *
+ ****************************************************************************/
+
+int tpool_join(pthread_t thread, FAR pthread_addr_t *value);
+
+#else
+#  define tpool_create(thread, attr, entry, arg) \
+     pthread_create(thread, attr, entry, arg)
+#  define tpool_join(thread, value) pthread_join(thread, value)
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_NUTTX_TPOOL_H */
@@ -33,11 +33,18 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
 
 #define CPORT_BUF_SIZE              (2048)
 
 #define INFINITE_MAX_INFLIGHT_BUFCOUNT      0
 
+#define UNIPRO_TX_PRIORITY_MAX      2
+#define UNIPRO_IOV_MAX              2
+#define UNIPRO_TX_WEIGHT_DEFAULT    1
+#define UNIPRO_TX_WEIGHT_MAX        16
+
 enum unipro_event {
     UNIPRO_EVT_MAILBOX,
     UNIPRO_EVT_LUP_DONE,
@@ -47,6 +54,23 @@ typedef int (*unipro_send_completion_t)(int status, const void *buf,
                                         void *priv);
 typedef void (*cport_reset_completion_cb_t)(unsigned int cportid, void *data);
 typedef void (*unipro_event_handler_t)(enum unipro_event evt);
+typedef void (*unipro_tx_space_cb_t)(unsigned int cportid, void *priv);
+
+struct unipro_iovec {
+    const void *base;
+    size_t len;
+};
+
+struct unipro_tx_dma_stats {
+    uint32_t xfers;             /* transfers completed */
+    uint32_t bytes;             /* bytes transferred */
+    uint32_t busy_usec;         /* time spent transferring, in us */
+};
+
+struct unipro_rx_stats {
+    uint32_t eom_irqs;          /* RX EOM interrupts taken */
+    uint32_t eom_msgs;          /* RX messages handled */
+};
 
 struct unipro_driver {
     const char name[32];
@@ -64,13 +88,30 @@ void unipro_info(void);
 int unipro_send(unsigned int cportid, const void *buf, size_t len);
 int unipro_send_async(unsigned int cportid, const void *buf, size_t len,
                       unipro_send_completion_t callback, void *priv);
+int unipro_send_async_iov(unsigned int cportid, const struct unipro_iovec *iov,
+                          unsigned int iovcnt,
+                          unipro_send_completion_t callback, void *priv);
 int unipro_reset_cport(unsigned int cportid, cport_reset_completion_cb_t cb,
                        void *priv);
+int unipro_set_tx_priority(unsigned int cportid, unsigned int priority);
+int unipro_set_tx_weight(unsigned int cportid, unsigned int weight);
+void unipro_get_rx_stats(struct unipro_rx_stats *stats);
+void unipro_reset_rx_stats(void);
+ssize_t unipro_get_tx_queued_bytes(unsigned int cportid);
+int unipro_set_tx_space_cb(unsigned int cportid, size_t threshold,
+                           unipro_tx_space_cb_t callback, void *priv);
+#ifdef CONFIG_ARCH_UNIPROTX_USE_DMA
+int unipro_tx_dma_get_stats(unsigned int channel,
+                            struct unipro_tx_dma_stats *stats);
+void unipro_tx_dma_reset_stats(void);
+void unipro_set_tx_memcpy_threshold(size_t threshold);
+#endif
 
 int unipro_set_max_inflight_rxbuf_count(unsigned int cportid,
                                         size_t max_inflight_buf);
 void *unipro_rxbuf_alloc(unsigned int cportid);
 void unipro_rxbuf_free(unsigned int cportid, void *ptr);
+bool unipro_rxbuf_is_exhausted(unsigned int cportid);
 
 /*
  * UniPro attributes
@@ -114,6 +114,8 @@ struct device_usb_hcd_type_ops {
     int (*start)(struct device *dev);
     void (*stop)(struct device *dev);
     int (*urb_enqueue)(struct device *dev, struct urb *urb);
+    int (*urb_enqueue_batch)(struct device *dev, struct urb **urbs,
+                             size_t count);
     int (*urb_dequeue)(struct device *dev, struct urb *urb);
     int (*hub_control)(struct device *dev, uint16_t typeReq, uint16_t wValue,
                        uint16_t wIndex, char *buf, uint16_t wLength);
@@ -208,6 +210,51 @@ static inline int device_usb_hcd_urb_enqueue(struct device *dev,
     return -ENOSYS;
 }
 
+/**
+ * Send several urbs at once
+ *
+ * URBs are enqueued in order, and enqueuing stops at the first failure.
+ * HCDs not supporting batches get the URBs one by one.
+ *
+ * @param dev HCD device
+ * @param urbs URBs to send
+ * @param count number of URBs
+ * @return number of URBs enqueued, or the error of the first URB if none
+ *         could be enqueued
+ */
+static inline int device_usb_hcd_urb_enqueue_batch(struct device *dev,
+                                                   struct urb **urbs,
+                                                   size_t count)
+{
+    size_t i;
+    int retval = 0;
+
+    DEVICE_DRIVER_ASSERT_OPS(dev);
+
+    if (!device_is_open(dev)) {
+        return -ENODEV;
+    }
+
+    if (DEVICE_DRIVER_GET_OPS(dev, usb_hcd)->urb_enqueue_batch) {
+        return DEVICE_DRIVER_GET_OPS(dev, usb_hcd)->urb_enqueue_batch(dev,
+                                                                  urbs, count);
+    }
+
+    if (!DEVICE_DRIVER_GET_OPS(dev, usb_hcd)->urb_enqueue) {
+        return -ENOSYS;
+    }
+
+    for (i = 0; i < count; i++) {
+        retval = DEVICE_DRIVER_GET_OPS(dev, usb_hcd)->urb_enqueue(dev,
+                                                                  urbs[i]);
+        if (retval) {
+            break;
+        }
+    }
+
+    return i ? i : retval;
+}
+
 /**
  * Dequeue URBs
  *
@@ -42,8 +42,11 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
 #include <stdint.h>
-#include <sched.h>
+#include <queue.h>
+
+#include <nuttx/compiler.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -89,8 +92,13 @@
 
 /* Initialization of statically allocated timers ****************************/
 
-#define wd_static(w) \
+#ifdef CONFIG_WDOG_SLACK
+#  define wd_static(w) \
+  do { (w)->next = NULL; (w)->flags = WDOGF_STATIC; (w)->slack = 0; } while (0)
+#else
+#  define wd_static(w) \
   do { (w)->next = NULL; (w)->flags = WDOGF_STATIC; } while (0)
+#endif
 
 #ifdef CONFIG_PIC
 #  define WDOG_INITIAILIZER { NULL, NULL, NULL, 0, WDOGF_STATIC, 0 }
@@ -139,6 +147,13 @@ struct wdog_s
   uint8_t            flags;      /* See WDOGF_* definitions above */
   uint8_t            argc;       /* The number of parameters to pass */
   uint32_t           parm[CONFIG_MAX_WDOGPARMS];
+#ifdef CONFIG_WDOG_WHEEL
+  uint32_t           expires;    /* Tick at which the delay expires */
+  FAR sq_queue_t    *slot;       /* Timing wheel slot holding the watchdog */
+#endif
+#ifdef CONFIG_WDOG_SLACK
+  uint16_t           slack;      /* Ticks by which the expiration may be late */
+#endif
 };
 
 /* Watchdog 'handle' */
@@ -166,6 +181,11 @@ int     wd_delete(WDOG_ID wdog);
 int     wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry, int argc, ...);
 int     wd_cancel(WDOG_ID wdog);
 int     wd_gettime(WDOG_ID wdog);
+#ifdef CONFIG_WDOG_SLACK
+int     wd_setslack(WDOG_ID wdog, int slack);
+#else
+#  define wd_setslack(w,s) (OK)
+#endif
 
 #undef EXTERN
 #ifdef __cplusplus
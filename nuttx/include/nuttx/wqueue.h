@@ -71,6 +71,9 @@
  *   work in units of microseconds.  Default: 50*1000 (50 MS).
  * CONFIG_SCHED_WORKSTACKSIZE - The stack size allocated for the worker
  *   thread.  Default: CONFIG_IDLETHREAD_STACKSIZE.
+ * CONFIG_SCHED_HPNTHREADS - The number of threads serving the high priority
+ *   work queue, so that a slow work item does not hold up the work queued
+ *   behind it.  Default: 1
  * CONFIG_SIG_SIGWORK - The signal number that will be used to wake-up
  *   the worker thread.  Default: 17
  *
@@ -85,6 +88,11 @@
  *  checks for work in units of microseconds.  Default: 50*1000 (50 MS).
  * CONFIG_SCHED_LPWORKSTACKSIZE - The stack size allocated for the lower
  *   priority worker thread.  Default: CONFIG_IDLETHREAD_STACKSIZE.
+ * CONFIG_SCHED_LPNTHREADS - The number of threads serving the lower
+ *   priority work queue.  Default: 1
+ *
+ * CONFIG_SCHED_WORKITEM_PRIORITY - Let work be queued with a priority of
+ *   its own with work_queue_priority().
  */
 
 /* Is this a protected build (CONFIG_BUILD_PROTECTED=y) */
@@ -167,6 +175,10 @@
 #    define CONFIG_SCHED_WORKSTACKSIZE CONFIG_IDLETHREAD_STACKSIZE
 #  endif
 
+#  ifndef CONFIG_SCHED_HPNTHREADS
+#    define CONFIG_SCHED_HPNTHREADS 1
+#  endif
+
 /* Low priority kernel work queue configuration *****************************/
 
 #ifdef CONFIG_SCHED_LPWORK
@@ -183,6 +195,10 @@
 #    define CONFIG_SCHED_LPWORKSTACKSIZE CONFIG_IDLETHREAD_STACKSIZE
 #  endif
 
+#  ifndef CONFIG_SCHED_LPNTHREADS
+#    define CONFIG_SCHED_LPNTHREADS 1
+#  endif
+
 /* The high priority worker thread should be higher priority than the low
  * priority worker thread.
  */
@@ -228,6 +244,7 @@
 #    define NWORKERS 1
 #    define USRWORK 0
 #  endif
+#  define WORK_MAXTHREADS 1
 #else
 
   /* In a flat build (CONFIG_BUILD_PROTECTED=n) or during the kernel phase of
@@ -261,10 +278,25 @@
 
 #  if !defined(CONFIG_BUILD_PROTECTED) && !defined(CONFIG_BUILD_KERNEL)
 #    define USRWORK LPWORK
+#  endif
+
+  /* The largest number of threads serving one work queue */
+
+#  if defined(CONFIG_SCHED_LPWORK) && \
+      CONFIG_SCHED_LPNTHREADS > CONFIG_SCHED_HPNTHREADS
+#    define WORK_MAXTHREADS CONFIG_SCHED_LPNTHREADS
+#  elif defined(CONFIG_SCHED_HPWORK)
+#    define WORK_MAXTHREADS CONFIG_SCHED_HPNTHREADS
+#  else
+#    define WORK_MAXTHREADS 1
 #  endif
 
 #endif /* CONFIG_BUILD_PROTECTED && !__KERNEL__ */
 
+#if WORK_MAXTHREADS > 8
+#  error "No more than 8 threads may serve a work queue"
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -278,8 +310,13 @@
 
 struct wqueue_s
 {
-  pid_t             pid; /* The task ID of the worker thread */
-  struct dq_queue_s q;   /* The queue of pending work */
+  pid_t             pid[WORK_MAXTHREADS]; /* The task IDs of the worker threads */
+  struct dq_queue_s q;        /* The queue of pending work */
+  uint8_t           nthreads; /* The number of worker threads */
+  uint8_t           idle;     /* Bit set of the worker threads waiting for work */
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  uint8_t           prio;     /* The priority of the worker threads */
+#endif
 };
 
 /* Defines the work callback */
@@ -298,6 +335,9 @@ struct work_s
   FAR void *arg;         /* Callback argument */
   uint32_t  qtime;       /* Time work queued */
   uint32_t  delay;       /* Delay until work performed */
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  uint8_t   prio;        /* Priority the work is performed at */
+#endif
 };
 
 /****************************************************************************
@@ -363,7 +403,8 @@ EXTERN struct wqueue_s g_work[NWORKERS];
  *   not be accessed by application logic.
  *
  * Input parameters:
- *   argc, argv (not used)
+ *   argc, argv - work_hpthread and work_lpthread get the index of the
+ *     thread among those serving the queue in argv[1]
  *
  * Returned Value:
  *   Does not return
@@ -433,6 +474,30 @@ int work_usrstart(void);
 int work_queue(int qid, FAR struct work_s *work, worker_t worker,
                FAR void *arg, uint32_t delay);
 
+/****************************************************************************
+ * Name: work_queue_priority
+ *
+ * Description:
+ *   Queue work like work_queue(), but to be performed at the given
+ *   priority instead of the priority of the worker threads.  The work
+ *   is queued ahead of any work of lower priority, and the worker thread
+ *   that performs it runs at that priority while it does.
+ *
+ * Input parameters:
+ *   qid, work, worker, arg, delay - As for work_queue()
+ *   prio   - The priority to perform the work at, or zero for the
+ *            priority of the worker threads
+ *
+ * Returned Value:
+ *   Zero on success, a negated errno on failure
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+int work_queue_priority(int qid, FAR struct work_s *work, worker_t worker,
+                        FAR void *arg, uint32_t delay, uint8_t prio);
+#endif
+
 /****************************************************************************
  * Name: work_cancel
  *
@@ -458,7 +523,9 @@ int work_cancel(int qid, FAR struct work_s *work);
  * Description:
  *   Signal the worker thread to process the work queue now.  This function
  *   is used internally by the work logic but could also be used by the
- *   user to force an immediate re-assessment of pending work.
+ *   user to force an immediate re-assessment of pending work.  If several
+ *   threads serve the queue, an idle one is woken up, if any: busy ones
+ *   check the queue when they are done anyway.
  *
  * Input parameters:
  *   qid    - The work queue ID
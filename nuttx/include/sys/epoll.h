@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_SYS_EPOLL_H
+#define __INCLUDE_SYS_EPOLL_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <poll.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* epoll_ctl() operations */
+
+#define EPOLL_CTL_ADD  1   /* Add a descriptor to the interest list */
+#define EPOLL_CTL_DEL  2   /* Remove a descriptor from the interest list */
+#define EPOLL_CTL_MOD  3   /* Change the events of a registered descriptor */
+
+/* Event flags.  The low bits are the poll() events; the high bits select
+ * how the descriptor is re-armed after an event is reported:
+ *
+ *   EPOLLET
+ *     Edge triggered.  The descriptor is reported again only when the
+ *     driver signals a new event, not just because it is still ready.
+ *   EPOLLONESHOT
+ *     The descriptor is disabled after one event is reported, until it is
+ *     re-enabled with EPOLL_CTL_MOD.
+ */
+
+#define EPOLLIN        POLLIN
+#define EPOLLPRI       POLLPRI
+#define EPOLLOUT       POLLOUT
+#define EPOLLRDNORM    POLLRDNORM
+#define EPOLLRDBAND    POLLRDBAND
+#define EPOLLWRNORM    POLLWRNORM
+#define EPOLLWRBAND    POLLWRBAND
+#define EPOLLERR       POLLERR
+#define EPOLLHUP       POLLHUP
+
+#define EPOLLONESHOT   (1u << 30)
+#define EPOLLET        (1u << 31)
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+typedef union epoll_data
+{
+  FAR void *ptr;
+  int       fd;
+  uint32_t  u32;
+} epoll_data_t;
+
+struct epoll_event
+{
+  uint32_t     events;  /* Requested events / reported events */
+  epoll_data_t data;    /* Returned unchanged with the events */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: epoll_create
+ *
+ * Description:
+ *   Create an interest list for up to 'size' descriptors.  Unlike Linux,
+ *   'size' is a hard limit and the returned handle is not a file
+ *   descriptor:  it must be released with epoll_close(), not close().
+ *
+ * Returned Value:
+ *   A handle on success; -1 on failure with errno set to EINVAL or ENOMEM.
+ *
+ ****************************************************************************/
+
+int epoll_create(int size);
+
+/****************************************************************************
+ * Name: epoll_close
+ *
+ * Description:
+ *   Unregister all descriptors and free an interest list.
+ *
+ ****************************************************************************/
+
+void epoll_close(int epfd);
+
+/****************************************************************************
+ * Name: epoll_ctl
+ *
+ * Description:
+ *   Add, modify or remove a descriptor of the interest list.  Descriptors
+ *   stay registered with their driver's poll method until removed, so
+ *   epoll_wait() does not set up and tear down every descriptor.
+ *
+ * Returned Value:
+ *   0 on success; -1 on failure with errno set:
+ *
+ *   EEXIST - EPOLL_CTL_ADD of a descriptor already in the list
+ *   ENOENT - EPOLL_CTL_MOD or EPOLL_CTL_DEL of a descriptor not in the list
+ *   ENOSPC - The list is full
+ *   EINVAL - Bad operation or missing event
+ *   Others as returned by poll() when the driver poll setup fails
+ *
+ ****************************************************************************/
+
+int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev);
+
+/****************************************************************************
+ * Name: epoll_wait
+ *
+ * Description:
+ *   Wait up to 'timeout' milliseconds (forever if negative) for events on
+ *   the interest list and return up to 'maxevents' of them in 'evs'.
+ *
+ * Returned Value:
+ *   The number of events returned, 0 on timeout, or -1 on failure with
+ *   errno set to EINVAL or EINTR.
+ *
+ ****************************************************************************/
+
+int epoll_wait(int epfd, FAR struct epoll_event *evs, int maxevents,
+               int timeout);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __INCLUDE_SYS_EPOLL_H */
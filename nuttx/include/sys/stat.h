@@ -124,6 +124,7 @@ extern "C"
 
 int mkdir(FAR const char *pathname, mode_t mode);
 int mkfifo(FAR const char *pathname, mode_t mode);
+int mkfifo2(FAR const char *pathname, mode_t mode, size_t bufsize);
 int stat(const char *path, FAR struct stat *buf);
 int fstat(int fd, FAR struct stat *buf);
 
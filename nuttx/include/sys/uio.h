@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INCLUDE_SYS_UIO_H
+#define __INCLUDE_SYS_UIO_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+
+/****************************************************************************
+ * Public Type Definitions
+ ****************************************************************************/
+
+/* One element of a scatter/gather list */
+
+struct iovec
+{
+  FAR void *iov_base;  /* Base address of the buffer */
+  size_t    iov_len;   /* Size of the buffer in bytes */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C" {
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: readv, writev
+ *
+ * Description:
+ *   Equivalent to read() and write() except that the data are scattered
+ *   into (or gathered from) the 'iovcnt' buffers described by 'iov', in
+ *   order.  Each buffer is filled before proceeding to the next.  The
+ *   transfer is performed as a single operation when the driver provides
+ *   vectored methods; otherwise it is equivalent to a sequence of read()
+ *   or write() calls that stops at the first short transfer.
+ *
+ * Returned Value:
+ *   The total number of bytes transferred on success.  On failure, -1 is
+ *   returned and errno is set as by read() or write(), or to EINVAL if
+ *   'iovcnt' is not in the range 1..IOV_MAX or the total length exceeds
+ *   SSIZE_MAX.
+ *
+ ****************************************************************************/
+
+ssize_t readv(int fd, FAR const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, FAR const struct iovec *iov, int iovcnt);
+
+/****************************************************************************
+ * Name: preadv, pwritev
+ *
+ * Description:
+ *   Equivalent to readv() and writev() but starting at 'offset' in the
+ *   file.  The file position is not changed.  Only seekable files are
+ *   supported.
+ *
+ ****************************************************************************/
+
+ssize_t preadv(int fd, FAR const struct iovec *iov, int iovcnt, off_t offset);
+ssize_t pwritev(int fd, FAR const struct iovec *iov, int iovcnt, off_t offset);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __INCLUDE_SYS_UIO_H */
@@ -157,6 +157,7 @@ FAR void *sbrk(intptr_t incr);
 /* Special devices */
 
 int     pipe(int fd[2]);
+int     pipe2(int fd[2], size_t bufsize);
 
 /* Working directory operations */
 
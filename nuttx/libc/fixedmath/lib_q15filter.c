@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <fixedmath.h>
+
+#ifdef CONFIG_HAVE_LONG_LONG
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline q15_t q15_sat(int64_t acc)
+{
+  if (acc > q15MAX)
+    {
+      return q15MAX;
+    }
+  else if (acc < q15MIN)
+    {
+      return q15MIN;
+    }
+
+  return (q15_t)acc;
+}
+
+#ifdef CONFIG_ARCH_CORTEXM4
+/* Two consecutive samples as one word, the first one in the low half */
+
+static inline uint32_t q15_read2(FAR const q15_t *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t q15_pack(q15_t lo, q15_t hi)
+{
+  return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+/* acc += lo(x) * lo(y) + hi(x) * hi(y) */
+
+static inline int64_t q15_smlald(uint32_t x, uint32_t y, int64_t acc)
+{
+  __asm__ ("smlald %Q0, %R0, %1, %2" : "+r" (acc) : "r" (x), "r" (y));
+  return acc;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: q15dot
+ *
+ * Description:
+ *   Dot product of two Q15 vectors.  The result is the raw 64-bit
+ *   accumulator of the Q30 products, it cannot overflow.
+ *
+ ****************************************************************************/
+
+int64_t q15dot(FAR const q15_t *a, FAR const q15_t *b, size_t n)
+{
+  int64_t acc = 0;
+
+#ifdef CONFIG_ARCH_CORTEXM4
+  for (; n >= 4; n -= 4, a += 4, b += 4)
+    {
+      acc = q15_smlald(q15_read2(a), q15_read2(b), acc);
+      acc = q15_smlald(q15_read2(a + 2), q15_read2(b + 2), acc);
+    }
+
+  for (; n >= 2; n -= 2, a += 2, b += 2)
+    {
+      acc = q15_smlald(q15_read2(a), q15_read2(b), acc);
+    }
+#endif
+
+  while (n-- > 0)
+    {
+      acc += (int32_t)*a++ * *b++;
+    }
+
+  return acc;
+}
+
+/****************************************************************************
+ * Name: q15fir_init
+ *
+ * Description:
+ *   Initialize a FIR filter.  state must hold 2 * ntaps samples; it is
+ *   cleared here.
+ *
+ ****************************************************************************/
+
+void q15fir_init(FAR struct q15fir_s *fir, FAR const q15_t *coeffs,
+                 FAR q15_t *state, uint16_t ntaps)
+{
+  fir->coeffs = coeffs;
+  fir->state  = state;
+  fir->ntaps  = ntaps;
+  fir->pos    = 0;
+
+  memset(state, 0, 2 * ntaps * sizeof(q15_t));
+}
+
+/****************************************************************************
+ * Name: q15fir
+ *
+ * Description:
+ *   Filter n samples.  in and out may be the same buffer.
+ *
+ ****************************************************************************/
+
+void q15fir(FAR struct q15fir_s *fir, FAR const q15_t *in,
+            FAR q15_t *out, size_t n)
+{
+  FAR q15_t *state = fir->state;
+  uint16_t ntaps = fir->ntaps;
+  uint16_t pos = fir->pos;
+  int64_t acc;
+
+  while (n-- > 0)
+    {
+      pos = (pos == 0 ? ntaps : pos) - 1;
+      state[pos] = state[pos + ntaps] = *in++;
+
+      acc = q15dot(fir->coeffs, &state[pos], ntaps);
+      *out++ = q15_sat((acc + 0x4000) >> 15);
+    }
+
+  fir->pos = pos;
+}
+
+/****************************************************************************
+ * Name: q15biquad_init
+ *
+ * Description:
+ *   Initialize a biquad cascade.  state must hold 4 * nstages samples; it
+ *   is cleared here.  postshift may not exceed 15.
+ *
+ ****************************************************************************/
+
+void q15biquad_init(FAR struct q15biquad_s *bq, FAR const q15_t *coeffs,
+                    FAR q15_t *state, uint8_t nstages, uint8_t postshift)
+{
+  bq->coeffs    = coeffs;
+  bq->state     = state;
+  bq->nstages   = nstages;
+  bq->postshift = postshift;
+
+  memset(state, 0, 4 * nstages * sizeof(q15_t));
+}
+
+/****************************************************************************
+ * Name: q15biquad
+ *
+ * Description:
+ *   Filter n samples through all the stages.  in and out may be the same
+ *   buffer.  The accumulator is 64-bit, only the output of each stage is
+ *   saturated.
+ *
+ ****************************************************************************/
+
+void q15biquad(FAR struct q15biquad_s *bq, FAR const q15_t *in,
+               FAR q15_t *out, size_t n)
+{
+  FAR const q15_t *c = bq->coeffs;
+  FAR q15_t *s = bq->state;
+  FAR const q15_t *src = in;
+  int shift = 15 - bq->postshift;
+  int64_t acc;
+  q15_t x1;
+  q15_t x2;
+  q15_t y1;
+  q15_t y2;
+  q15_t x0;
+  size_t i;
+  int stage;
+
+  for (stage = 0; stage < bq->nstages; stage++, c += 5, s += 4)
+    {
+      x1 = s[0];
+      x2 = s[1];
+      y1 = s[2];
+      y2 = s[3];
+
+      for (i = 0; i < n; i++)
+        {
+          x0 = src[i];
+
+#ifdef CONFIG_ARCH_CORTEXM4
+          acc = q15_smlald(q15_read2(&c[0]), q15_pack(x0, x1), 0);
+          acc = q15_smlald(q15_pack(c[2], c[3]), q15_pack(x2, y1), acc);
+          acc += (int32_t)c[4] * y2;
+#else
+          acc  = (int32_t)c[0] * x0;
+          acc += (int32_t)c[1] * x1;
+          acc += (int32_t)c[2] * x2;
+          acc += (int32_t)c[3] * y1;
+          acc += (int32_t)c[4] * y2;
+#endif
+
+          x2 = x1;
+          x1 = x0;
+          y2 = y1;
+          y1 = q15_sat((acc + ((1 << shift) >> 1)) >> shift);
+
+          out[i] = y1;
+        }
+
+      s[0] = x1;
+      s[1] = x2;
+      s[2] = y1;
+      s[3] = y2;
+
+      /* The next stage filters the output of this one */
+
+      src = out;
+    }
+}
+
+#endif /* CONFIG_HAVE_LONG_LONG */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <fixedmath.h>
+
+#ifdef CONFIG_HAVE_LONG_LONG
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline q31_t q31_sat(int64_t acc)
+{
+  if (acc > q31MAX)
+    {
+      return q31MAX;
+    }
+  else if (acc < q31MIN)
+    {
+      return q31MIN;
+    }
+
+  return (q31_t)acc;
+}
+
+/* Q62 product scaled down to Q60, leaving enough guard bits to sum the
+ * five terms of a biquad.
+ */
+
+static inline int64_t q31_mul60(q31_t a, q31_t b)
+{
+  return ((int64_t)a * b) >> 2;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: q31dot
+ *
+ * Description:
+ *   Dot product of two Q31 vectors.  Each Q62 product is truncated to Q48
+ *   before accumulation, the result is the raw 64-bit accumulator (16
+ *   guard bits).
+ *
+ ****************************************************************************/
+
+int64_t q31dot(FAR const q31_t *a, FAR const q31_t *b, size_t n)
+{
+  int64_t acc = 0;
+
+  for (; n >= 4; n -= 4, a += 4, b += 4)
+    {
+      acc += ((int64_t)a[0] * b[0]) >> 14;
+      acc += ((int64_t)a[1] * b[1]) >> 14;
+      acc += ((int64_t)a[2] * b[2]) >> 14;
+      acc += ((int64_t)a[3] * b[3]) >> 14;
+    }
+
+  while (n-- > 0)
+    {
+      acc += ((int64_t)*a++ * *b++) >> 14;
+    }
+
+  return acc;
+}
+
+/****************************************************************************
+ * Name: q31fir_init
+ *
+ * Description:
+ *   Initialize a FIR filter.  state must hold 2 * ntaps samples; it is
+ *   cleared here.
+ *
+ ****************************************************************************/
+
+void q31fir_init(FAR struct q31fir_s *fir, FAR const q31_t *coeffs,
+                 FAR q31_t *state, uint16_t ntaps)
+{
+  fir->coeffs = coeffs;
+  fir->state  = state;
+  fir->ntaps  = ntaps;
+  fir->pos    = 0;
+
+  memset(state, 0, 2 * ntaps * sizeof(q31_t));
+}
+
+/****************************************************************************
+ * Name: q31fir
+ *
+ * Description:
+ *   Filter n samples.  in and out may be the same buffer.
+ *
+ ****************************************************************************/
+
+void q31fir(FAR struct q31fir_s *fir, FAR const q31_t *in,
+            FAR q31_t *out, size_t n)
+{
+  FAR q31_t *state = fir->state;
+  uint16_t ntaps = fir->ntaps;
+  uint16_t pos = fir->pos;
+  int64_t acc;
+
+  while (n-- > 0)
+    {
+      pos = (pos == 0 ? ntaps : pos) - 1;
+      state[pos] = state[pos + ntaps] = *in++;
+
+      acc = q31dot(fir->coeffs, &state[pos], ntaps);
+      *out++ = q31_sat((acc + 0x10000) >> 17);
+    }
+
+  fir->pos = pos;
+}
+
+/****************************************************************************
+ * Name: q31biquad_init
+ *
+ * Description:
+ *   Initialize a biquad cascade.  state must hold 4 * nstages samples; it
+ *   is cleared here.  postshift may not exceed 29.
+ *
+ ****************************************************************************/
+
+void q31biquad_init(FAR struct q31biquad_s *bq, FAR const q31_t *coeffs,
+                    FAR q31_t *state, uint8_t nstages, uint8_t postshift)
+{
+  bq->coeffs    = coeffs;
+  bq->state     = state;
+  bq->nstages   = nstages;
+  bq->postshift = postshift;
+
+  memset(state, 0, 4 * nstages * sizeof(q31_t));
+}
+
+/****************************************************************************
+ * Name: q31biquad
+ *
+ * Description:
+ *   Filter n samples through all the stages.  in and out may be the same
+ *   buffer.  The products are accumulated in Q60, only the output of each
+ *   stage is saturated.
+ *
+ ****************************************************************************/
+
+void q31biquad(FAR struct q31biquad_s *bq, FAR const q31_t *in,
+               FAR q31_t *out, size_t n)
+{
+  FAR const q31_t *c = bq->coeffs;
+  FAR q31_t *s = bq->state;
+  FAR const q31_t *src = in;
+  int shift = 29 - bq->postshift;
+  int64_t acc;
+  q31_t x1;
+  q31_t x2;
+  q31_t y1;
+  q31_t y2;
+  q31_t x0;
+  size_t i;
+  int stage;
+
+  for (stage = 0; stage < bq->nstages; stage++, c += 5, s += 4)
+    {
+      x1 = s[0];
+      x2 = s[1];
+      y1 = s[2];
+      y2 = s[3];
+
+      for (i = 0; i < n; i++)
+        {
+          x0 = src[i];
+
+          acc  = q31_mul60(c[0], x0);
+          acc += q31_mul60(c[1], x1);
+          acc += q31_mul60(c[2], x2);
+          acc += q31_mul60(c[3], y1);
+          acc += q31_mul60(c[4], y2);
+
+          x2 = x1;
+          x1 = x0;
+          y2 = y1;
+          y1 = q31_sat((acc + (((int64_t)1 << shift) >> 1)) >> shift);
+
+          out[i] = y1;
+        }
+
+      s[0] = x1;
+      s[1] = x2;
+      s[2] = y1;
+      s[3] = y2;
+
+      /* The next stage filters the output of this one */
+
+      src = out;
+    }
+}
+
+#endif /* CONFIG_HAVE_LONG_LONG */
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <fixedmath.h>
+
+#ifdef CONFIG_HAVE_LONG_LONG
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Initial estimate of 1/m over [0.5, 1]: 48/17 - 32/17 * m, in Q30 */
+
+#define QRECIP_K0      3031741621ll
+#define QRECIP_K1      2021161081ll
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: qsqrt64
+ *
+ * Description:
+ *   Integer square root, one result bit per iteration.
+ *
+ ****************************************************************************/
+
+static uint32_t qsqrt64(uint64_t x)
+{
+  uint64_t bit = (uint64_t)1 << 62;
+  uint64_t res = 0;
+
+  while (bit > x)
+    {
+      bit >>= 2;
+    }
+
+  while (bit != 0)
+    {
+      if (x >= res + bit)
+        {
+          x  -= res + bit;
+          res = (res >> 1) + bit;
+        }
+      else
+        {
+          res >>= 1;
+        }
+
+      bit >>= 2;
+    }
+
+  return (uint32_t)res;
+}
+
+/****************************************************************************
+ * Name: qnormalize
+ *
+ * Description:
+ *   Shift a non-zero value left into [2^30, 2^31), returning the number of
+ *   bit positions it was shifted by.
+ *
+ ****************************************************************************/
+
+static int qnormalize(FAR uint32_t *u)
+{
+  uint32_t v = *u;
+  int n = 0;
+
+  if (v >= 0x80000000)
+    {
+      *u = v >> 1;
+      return -1;
+    }
+
+  while (v < 0x00400000)
+    {
+      v <<= 8;
+      n  += 8;
+    }
+
+  while (v < 0x40000000)
+    {
+      v <<= 1;
+      n++;
+    }
+
+  *u = v;
+  return n;
+}
+
+/****************************************************************************
+ * Name: qrecip
+ *
+ * Description:
+ *   1 / (2 * m) in Q31 for m in [0.5, 1) given in Q31.  A linear estimate
+ *   refined by three Newton-Raphson steps, which is enough for full Q31
+ *   precision and avoids a 64-bit division.
+ *
+ ****************************************************************************/
+
+static uint32_t qrecip(uint32_t m)
+{
+  int64_t y;
+  int64_t t;
+  int i;
+
+  /* y is 1/m in Q30 */
+
+  y = QRECIP_K0 - ((QRECIP_K1 * m) >> 31);
+  for (i = 0; i < 3; i++)
+    {
+      t = (y * m) >> 31;
+      y = (y * (((int64_t)1 << 31) - t)) >> 30;
+    }
+
+  return y > q31MAX ? q31MAX : (uint32_t)y;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: q15sqrt
+ *
+ * Description:
+ *   Square root of a Q15 value.  Negative values return 0.
+ *
+ ****************************************************************************/
+
+q15_t q15sqrt(q15_t x)
+{
+  uint32_t r;
+
+  if (x <= 0)
+    {
+      return 0;
+    }
+
+  r = qsqrt64((uint64_t)x << 15);
+  return r > q15MAX ? q15MAX : (q15_t)r;
+}
+
+/****************************************************************************
+ * Name: q31sqrt
+ *
+ * Description:
+ *   Square root of a Q31 value.  Negative values return 0.
+ *
+ ****************************************************************************/
+
+q31_t q31sqrt(q31_t x)
+{
+  uint32_t r;
+
+  if (x <= 0)
+    {
+      return 0;
+    }
+
+  r = qsqrt64((uint64_t)x << 31);
+  return r > q31MAX ? q31MAX : (q31_t)r;
+}
+
+/****************************************************************************
+ * Name: q15recip
+ *
+ * Description:
+ *   Reciprocal of a Q15 value, which does not fit in Q15 itself: the
+ *   result r and *shift are such that 1/x = r * 2^*shift.  x = 0 returns
+ *   the reciprocal of the smallest non-zero value, 1 * 2^15.
+ *
+ ****************************************************************************/
+
+q15_t q15recip(q15_t x, FAR int *shift)
+{
+  uint32_t u;
+  uint32_t r;
+  int n;
+
+  if (x == 0)
+    {
+      *shift = 15;
+      return q15MAX;
+    }
+
+  u = x < 0 ? -(int32_t)x : x;
+  n = qnormalize(&u);
+
+  r = (qrecip(u) + 0x8000) >> 16;
+  if (r > q15MAX)
+    {
+      r = q15MAX;
+    }
+
+  *shift = n - 15;
+  return x < 0 ? -(q15_t)r : (q15_t)r;
+}
+
+/****************************************************************************
+ * Name: q31recip
+ *
+ * Description:
+ *   Reciprocal of a Q31 value: the result r and *shift are such that
+ *   1/x = r * 2^*shift.  x = 0 returns 1 * 2^31.
+ *
+ ****************************************************************************/
+
+q31_t q31recip(q31_t x, FAR int *shift)
+{
+  uint32_t u;
+  uint32_t r;
+  int n;
+
+  if (x == 0)
+    {
+      *shift = 31;
+      return q31MAX;
+    }
+
+  u = x < 0 ? -(uint32_t)x : (uint32_t)x;
+  n = qnormalize(&u);
+  r = qrecip(u);
+
+  *shift = n + 1;
+  return x < 0 ? -(q31_t)r : (q31_t)r;
+}
+
+/****************************************************************************
+ * Name: q15rms
+ *
+ * Description:
+ *   Root mean square of n Q15 samples.
+ *
+ ****************************************************************************/
+
+q15_t q15rms(FAR const q15_t *x, size_t n)
+{
+  uint64_t mean;
+  uint32_t r;
+
+  if (n == 0)
+    {
+      return 0;
+    }
+
+  /* The mean of the Q30 squares has its square root in Q15 */
+
+  mean = (uint64_t)q15dot(x, x, n) / n;
+  r    = qsqrt64(mean);
+  return r > q15MAX ? q15MAX : (q15_t)r;
+}
+
+/****************************************************************************
+ * Name: q31rms
+ *
+ * Description:
+ *   Root mean square of n Q31 samples.
+ *
+ ****************************************************************************/
+
+q31_t q31rms(FAR const q31_t *x, size_t n)
+{
+  uint64_t mean;
+  uint32_t r;
+
+  if (n == 0)
+    {
+      return 0;
+    }
+
+  /* The mean of the squares is at most 1.0 in Q48, scale it to Q62 so
+   * that its square root comes out in Q31.
+   */
+
+  mean = (uint64_t)q31dot(x, x, n) / n;
+  r    = qsqrt64(mean << 14);
+  return r > q31MAX ? q31MAX : (q31_t)r;
+}
+
+#endif /* CONFIG_HAVE_LONG_LONG */
@@ -31,8 +31,16 @@
 
 #include <nuttx/logbuffer.h>
 
-#define LOG_BUFFER_SIZE(s) \
-    (sizeof(struct log_buffer) + s)
+/*
+ * Order the data copies against the cursor updates.  The ring is only
+ * shared between contexts of a single core, so a compiler barrier is
+ * enough.
+ */
+#define log_buffer_barrier() \
+    __asm__ __volatile__("" ::: "memory")
+
+#define min(x,y) ({ \
+        (x) < (y) ? (x) : (y); })
 
 /**
  @brief Allocate a log_buffer
@@ -47,52 +55,17 @@ struct log_buffer *log_buffer_alloc(size_t size)
     if (!lb)
         return NULL;
     lb->data = ((char *)lb) + sizeof(struct log_buffer);
-    lb->in = lb->data;
-    lb->out = lb->data;
-    lb->end = lb->data + size;
+    lb->size = size;
+    lb->claimed = 0;
+    lb->head = 0;
+    log_buffer_reader_init(lb, &lb->reader);
     return lb;
 }
 
-#define min(x,y) ({ \
-        (x) < (y) ? (x) : (y); })
-
-static void *log_buffer_memrchr(char *start, char *end, size_t len)
-{
-    int i = 0;
-    char *p = start;
-    char *c = start;
-    while(c < end && i < len) {
-        if (*c == '\n')
-            p = c + 1;
-        c++;
-        i++;
-    }
-    if (i == len && p == start)
-        return p + len;
-    return p;
-}
-
-static size_t log_buffer_get_lines_len(struct log_buffer *lb, size_t size)
-{
-    char *p, *p1;
-
-    if (lb->out < lb->in) {
-        p = log_buffer_memrchr(lb->out, lb->in, size);
-        return p - lb->out;
-    } else if (lb->out > lb->in) {
-        p = log_buffer_memrchr(lb->out, lb->end, size);
-        size -= lb->end - lb->out;
-        p1 = log_buffer_memrchr(lb->data, lb->in, size);
-        if (p1 != lb->data)
-            return lb->end - lb->out + p1 - lb->data;
-        else
-            return p - lb->out;
-    }
-    return 0;
-}
-
 /**
  @brief Write data in log buffer
+ Unread data is overwritten when the buffer is full; readers that fall
+ behind notice it and skip ahead.
  @param lb The log buffer to write to
  @param data Data to write
  @param len number of bytes to write
@@ -100,55 +73,120 @@ static size_t log_buffer_get_lines_len(struct log_buffer *lb, size_t size)
  */
 size_t log_buffer_write(struct log_buffer *lb, const void *data, size_t len)
 {
-    size_t remain = 0;
-
-    if ((lb->in + len) > lb->end) {
-        remain = len - (lb->end - lb->in);
-        len -= remain;
+    uint32_t head = lb->head;
+    size_t count = len;
+    size_t off;
+    size_t chunk;
+
+    /* Only the last size bytes can survive */
+    if (len > lb->size) {
+        data = (const char *)data + len - lb->size;
+        len = lb->size;
     }
-    memcpy(lb->in, data, len);
-    lb->in += len;
 
-    if (lb->in == lb->end)
-        lb->in = lb->data;
+    /* Tell the readers which bytes are about to be overwritten */
+    lb->claimed = head + len;
+    log_buffer_barrier();
+
+    off = head % lb->size;
+    chunk = min(len, lb->size - off);
+    memcpy(lb->data + off, data, chunk);
+    memcpy(lb->data, (const char *)data + chunk, len - chunk);
 
-    memcpy(lb->in, ((char *)data) + len, remain);
-    lb->in += remain;
+    log_buffer_barrier();
+    lb->head = head + len;
 
-    return len;
+    return count;
 }
 
 /**
- @brief Read lines from log buffer
+ @brief Initialize a reader
+ The reader starts with the oldest data still in the log buffer.
+ @param lb The log buffer to read from
+ @param rd The reader to initialize
+ */
+void log_buffer_reader_init(struct log_buffer *lb,
+                            struct log_buffer_reader *rd)
+{
+    uint32_t head = lb->head;
+
+    rd->lb = lb;
+    rd->pos = head < lb->size ? 0 : head - lb->size;
+    rd->lost = 0;
+}
+
+/**
+ @brief Read lines from log buffer with a reader
  This function can return one or more lines (ie string terminated \n).
  The only execption is when a lines is longer than buffer size.
  The function doesn't append \0 at then end strings.
- @param lb The log buffer to read from
+ Data overwritten before the reader got to it is skipped and accounted
+ in rd->lost.
+ @param rd The reader
  @param data buffer to receive data from log buffer
  @param len number of bytes to read
  @return number of bytes read
  */
-size_t log_buffer_readlines(struct log_buffer *lb, void *data, size_t len)
+size_t log_buffer_reader_readlines(struct log_buffer_reader *rd, void *data,
+                                   size_t len)
 {
-    size_t remain = 0;
-    if (len > log_buffer_get_lines_len(lb, len))
-        len = log_buffer_get_lines_len(lb, len);
-    if ((lb->out + len) > lb->end) {
-        remain = len - (lb->end - lb->out);
-        len = lb->end - lb->out;
+    struct log_buffer *lb = rd->lb;
+    char *buf = data;
+    uint32_t head;
+    uint32_t claimed;
+    size_t count;
+    size_t off;
+    size_t chunk;
+
+    for (;;) {
+        head = lb->head;
+        log_buffer_barrier();
+
+        if (head - rd->pos > lb->size) {
+            rd->lost += head - lb->size - rd->pos;
+            rd->pos = head - lb->size;
+        }
+
+        count = min((size_t)(head - rd->pos), len);
+        off = rd->pos % lb->size;
+        chunk = min(count, lb->size - off);
+        memcpy(buf, lb->data + off, chunk);
+        memcpy(buf + chunk, lb->data, count - chunk);
+
+        /*
+         * If the writer has claimed any of the bytes just copied, they may
+         * be torn: skip them and try again.
+         */
+        log_buffer_barrier();
+        claimed = lb->claimed;
+        if (claimed - rd->pos <= lb->size)
+            break;
+
+        rd->lost += claimed - lb->size - rd->pos;
+        rd->pos = claimed - lb->size;
     }
-    memcpy(data, lb->out, len);
-    lb->out += len;
 
-    if (lb->out == lb->end)
-        lb->out = lb->data;
-
-    if (remain) {
-        memcpy((char *)data + len, lb->out, remain);
-        lb->out += remain;
-        len += remain;
-    }
+    /* Only return whole lines, unless a line does not fit in data */
+    chunk = count;
+    while (chunk > 0 && buf[chunk - 1] != '\n')
+        chunk--;
+    if (chunk == 0 && count == len)
+        chunk = count;
 
-    return len;
+    rd->pos += chunk;
+    return chunk;
 }
 
+/**
+ @brief Read lines from log buffer
+ Same as log_buffer_reader_readlines() with the reader embedded in the log
+ buffer.
+ @param lb The log buffer to read from
+ @param data buffer to receive data from log buffer
+ @param len number of bytes to read
+ @return number of bytes read
+ */
+size_t log_buffer_readlines(struct log_buffer *lb, void *data, size_t len)
+{
+    return log_buffer_reader_readlines(&lb->reader, data, len);
+}
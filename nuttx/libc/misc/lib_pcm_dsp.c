@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <nuttx/audio/pcm_dsp.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#  define PCM_DSP_SIMD
+#endif
+
+static inline uint32_t pcm_load32(const void *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void pcm_store32(void *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline int32_t pcm_sat16(int32_t x)
+{
+#if defined(__ARM_FEATURE_SAT)
+    __asm__ ("ssat %0, #16, %1" : "=r" (x) : "r" (x));
+    return x;
+#else
+    if (x > INT16_MAX)
+        return INT16_MAX;
+    if (x < INT16_MIN)
+        return INT16_MIN;
+    return x;
+#endif
+}
+
+static inline int32_t pcm_sat32(int64_t x)
+{
+    if (x > INT32_MAX)
+        return INT32_MAX;
+    if (x < INT32_MIN)
+        return INT32_MIN;
+    return x;
+}
+
+/* Pack the low halfword of lo with the low halfword of hi */
+static inline uint32_t pcm_pack16(uint32_t lo, uint32_t hi)
+{
+#ifdef PCM_DSP_SIMD
+    uint32_t r;
+
+    __asm__ ("pkhbt %0, %1, %2, lsl #16" : "=r" (r) : "r" (lo), "r" (hi));
+    return r;
+#else
+    return (lo & 0xffff) | (hi << 16);
+#endif
+}
+
+/* Pack the high halfword of lo with the high halfword of hi */
+static inline uint32_t pcm_pack16_hi(uint32_t lo, uint32_t hi)
+{
+#ifdef PCM_DSP_SIMD
+    uint32_t r;
+
+    __asm__ ("pkhtb %0, %1, %2, asr #16" : "=r" (r) : "r" (hi), "r" (lo));
+    return r;
+#else
+    return (lo >> 16) | (hi & 0xffff0000);
+#endif
+}
+
+void pcm_s16_to_s32(int32_t *dst, const int16_t *src, size_t samples)
+{
+    uint32_t w;
+
+    for (; samples >= 2; samples -= 2) {
+        w = pcm_load32(src);
+        *dst++ = (int32_t)(w << 16);
+        *dst++ = (int32_t)(w & 0xffff0000);
+        src += 2;
+    }
+
+    if (samples)
+        *dst = (int32_t)*src << 16;
+}
+
+void pcm_s32_to_s16(int16_t *dst, const int32_t *src, size_t samples)
+{
+    for (; samples >= 2; samples -= 2) {
+        pcm_store32(dst, pcm_pack16_hi(src[0], src[1]));
+        src += 2;
+        dst += 2;
+    }
+
+    if (samples)
+        *dst = *src >> 16;
+}
+
+void pcm_s24_to_s32(int32_t *dst, const uint8_t *src, size_t samples)
+{
+    while (samples--) {
+        *dst++ = (int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 |
+                           (uint32_t)src[2] << 24);
+        src += 3;
+    }
+}
+
+void pcm_s32_to_s24(uint8_t *dst, const int32_t *src, size_t samples)
+{
+    uint32_t s;
+
+    while (samples--) {
+        s = *src++;
+        *dst++ = s >> 8;
+        *dst++ = s >> 16;
+        *dst++ = s >> 24;
+    }
+}
+
+void pcm_s16_to_s24(uint8_t *dst, const int16_t *src, size_t samples)
+{
+    uint16_t s;
+
+    while (samples--) {
+        s = *src++;
+        *dst++ = 0;
+        *dst++ = s;
+        *dst++ = s >> 8;
+    }
+}
+
+void pcm_s24_to_s16(int16_t *dst, const uint8_t *src, size_t samples)
+{
+    while (samples--) {
+        *dst++ = (int16_t)(src[1] | src[2] << 8);
+        src += 3;
+    }
+}
+
+void pcm_interleave_s16(int16_t *dst, const int16_t *left,
+                        const int16_t *right, size_t frames)
+{
+    uint32_t l, r;
+
+    for (; frames >= 2; frames -= 2) {
+        l = pcm_load32(left);
+        r = pcm_load32(right);
+        pcm_store32(dst, pcm_pack16(l, r));
+        pcm_store32(dst + 2, pcm_pack16_hi(l, r));
+        left += 2;
+        right += 2;
+        dst += 4;
+    }
+
+    if (frames) {
+        *dst++ = *left;
+        *dst = *right;
+    }
+}
+
+void pcm_deinterleave_s16(int16_t *left, int16_t *right, const int16_t *src,
+                          size_t frames)
+{
+    uint32_t f0, f1;
+
+    for (; frames >= 2; frames -= 2) {
+        f0 = pcm_load32(src);
+        f1 = pcm_load32(src + 2);
+        pcm_store32(left, pcm_pack16(f0, f1));
+        pcm_store32(right, pcm_pack16_hi(f0, f1));
+        src += 4;
+        left += 2;
+        right += 2;
+    }
+
+    if (frames) {
+        *left = *src++;
+        *right = *src;
+    }
+}
+
+void pcm_gain_s16(int16_t *buf, size_t samples, uint32_t gain)
+{
+#ifdef PCM_DSP_SIMD
+    uint32_t w;
+    int32_t lo, hi;
+
+    /* smulw* takes a signed gain */
+    if (gain > INT32_MAX)
+        gain = INT32_MAX;
+
+    for (; samples >= 2; samples -= 2) {
+        w = pcm_load32(buf);
+        __asm__ ("smulwb %0, %1, %2" : "=r" (lo) : "r" (gain), "r" (w));
+        __asm__ ("smulwt %0, %1, %2" : "=r" (hi) : "r" (gain), "r" (w));
+        pcm_store32(buf, pcm_pack16(pcm_sat16(lo), pcm_sat16(hi)));
+        buf += 2;
+    }
+#endif
+
+    while (samples--) {
+        *buf = pcm_sat16(((int64_t)*buf * gain) >> 16);
+        buf++;
+    }
+}
+
+void pcm_gain_s32(int32_t *buf, size_t samples, uint32_t gain)
+{
+    while (samples--) {
+        *buf = pcm_sat32(((int64_t)*buf * gain) >> 16);
+        buf++;
+    }
+}
+
+void pcm_mix_s16(int16_t *dst, const int16_t *a, const int16_t *b,
+                 size_t samples)
+{
+#ifdef PCM_DSP_SIMD
+    uint32_t r;
+
+    for (; samples >= 2; samples -= 2) {
+        __asm__ ("qadd16 %0, %1, %2"
+                 : "=r" (r) : "r" (pcm_load32(a)), "r" (pcm_load32(b)));
+        pcm_store32(dst, r);
+        a += 2;
+        b += 2;
+        dst += 2;
+    }
+#endif
+
+    while (samples--) {
+        *dst++ = pcm_sat16((int32_t)*a++ + *b++);
+    }
+}
+
+void pcm_mix_s32(int32_t *dst, const int32_t *a, const int32_t *b,
+                 size_t samples)
+{
+    while (samples--) {
+#ifdef PCM_DSP_SIMD
+        int32_t r;
+
+        __asm__ ("qadd %0, %1, %2" : "=r" (r) : "r" (*a++), "r" (*b++));
+        *dst++ = r;
+#else
+        *dst++ = pcm_sat32((int64_t)*a++ + *b++);
+#endif
+    }
+}
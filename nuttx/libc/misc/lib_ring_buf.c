@@ -29,6 +29,8 @@
  * @brief Ring Buffer Package
  */
 
+#include <string.h>
+
 #include <nuttx/kmalloc.h>
 #include <nuttx/ring_buf.h>
 
@@ -197,3 +199,161 @@ void ring_buf_free_ring(struct ring_buf *rb,
         rb = next_rb;
     } while (rb != first_rb);
 }
+
+/*
+ * Header of a ring allocated by ring_buf_alloc_contiguous(). The block
+ * holds this header, the ring buffer entries and then the buffer of each
+ * entry, every buffer starting on an 'align' boundary.
+ */
+struct ring_buf_block {
+    size_t size;
+    enum bufram_owner owner;
+};
+
+#define RING_BUF_ALIGN(x, a)    (((x) + (a) - 1) & ~((a) - 1))
+
+static void *ring_buf_block_alloc(size_t size, unsigned int align,
+                                  enum bufram_owner owner)
+{
+#ifdef CONFIG_MM_BUFRAM_ALLOCATOR
+    /* bufram pages are aligned on BUFRAM_PAGE_SIZE */
+    if (align > BUFRAM_PAGE_SIZE)
+        return NULL;
+
+    return bufram_page_alloc_owner(bufram_size_to_page_count(size), owner);
+#else
+    return kmm_memalign(align, size);
+#endif
+}
+
+static void ring_buf_block_free(struct ring_buf_block *block)
+{
+#ifdef CONFIG_MM_BUFRAM_ALLOCATOR
+    bufram_page_free_owner(block, bufram_size_to_page_count(block->size),
+                           block->owner);
+#else
+    kmm_free(block);
+#endif
+}
+
+/**
+ * Allocate a ring of ring buffer entries like ring_buf_alloc_ring() but
+ * in a single block, from bufram when it is available, so the memory used
+ * by the ring is known up front and the buffers are safe for DMA.
+ *
+ * @brief Allocate a ring of ring buffer entries in a single block
+ * @param entries Number of ring buffer entries in the ring
+ * @param headroom Number of bytes to reserve before the data area in each
+ *                 ring buffer entry
+ * @param data_len Number of bytes of of data in each ring buffer entry
+ * @param tailroom Number of bytes to reserve after the data area in each
+ *                 ring buffer entry
+ * @param align Alignment of the buffer of each entry, a power of two
+ * @param owner bufram owner the block is accounted to
+ * @param alloc_callback Callback routine called after each ring buffer entry
+ *                       is initialized
+ * @param free_callback Callback routine called before each ring buffer entry
+ *                      is freed (on error)
+ * @param arg Argument to pass to alloc_callback() and free_callback()
+ * @return Address of the first ring buffer entry in the ring or NULL on
+ *         failure
+ */
+struct ring_buf *ring_buf_alloc_contiguous(unsigned int entries,
+                                    unsigned int headroom,
+                                    unsigned int data_len,
+                                    unsigned int tailroom,
+                                    unsigned int align,
+                                    enum bufram_owner owner,
+                                    int (*alloc_callback)(struct ring_buf *rb,
+                                                          void *arg),
+                                    void (*free_callback)(struct ring_buf *rb,
+                                                          void *arg),
+                                    void *arg)
+{
+    struct ring_buf_block *block;
+    struct ring_buf *rbs;
+    size_t entries_size, buf_len, size;
+    unsigned int i;
+    int ret;
+
+    if (!entries)
+        return NULL;
+
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+    if (align & (align - 1))
+        return NULL;
+
+    entries_size = RING_BUF_ALIGN(sizeof(*block) + entries * sizeof(*rbs),
+                                  align);
+    buf_len = RING_BUF_ALIGN(headroom + data_len + tailroom, align);
+    size = entries_size + entries * buf_len;
+
+    block = ring_buf_block_alloc(size, align, owner);
+    if (!block)
+        return NULL;
+
+    memset(block, 0, size);
+    block->size = size;
+    block->owner = owner;
+
+    rbs = (struct ring_buf *)(block + 1);
+
+    for (i = 0; i < entries; i++) {
+        rbs[i].next = &rbs[(i + 1) % entries];
+        ring_buf_set_owner(&rbs[i], RING_BUF_OWNER_PRODUCER);
+        ring_buf_init(&rbs[i], (void *)block + entries_size + i * buf_len,
+                      headroom, data_len);
+
+        if (alloc_callback) {
+            ret = alloc_callback(&rbs[i], arg);
+            if (ret)
+                break;
+        }
+    }
+
+    if (i < entries) {
+        while (i-- > 0) {
+            if (free_callback)
+                free_callback(&rbs[i], arg);
+        }
+
+        ring_buf_block_free(block);
+        return NULL;
+    }
+
+    return rbs;
+}
+
+/**
+ * @brief Free a ring allocated by ring_buf_alloc_contiguous()
+ * @param rb Address of any ring buffer entry in the ring being freed
+ * @param free_callback Callback routine called before each ring buffer entry
+ *                      is freed
+ * @param arg Argument to pass to free_callback()
+ */
+void ring_buf_free_contiguous(struct ring_buf *rb,
+                              void (*free_callback)(struct ring_buf *rb,
+                                                    void *arg),
+                              void *arg)
+{
+    struct ring_buf *start_rb, *first_rb;
+
+    if (!rb)
+        return;
+
+    /* The entries are in an array, the lowest address is the first one */
+    start_rb = rb;
+    first_rb = rb;
+    do {
+        if (rb < first_rb)
+            first_rb = rb;
+
+        if (free_callback)
+            free_callback(rb, arg);
+
+        rb = ring_buf_get_next(rb);
+    } while (rb != start_rb);
+
+    ring_buf_block_free((struct ring_buf_block *)first_rb - 1);
+}
@@ -40,11 +40,15 @@
 #include <nuttx/config.h>
 
 #include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 
+#include <nuttx/fs/ioctl.h>
+
 #include "lib_internal.h"
 
 #if CONFIG_NSOCKET_DESCRIPTORS > 0 || CONFIG_NFILE_DESCRIPTORS > 0
@@ -65,6 +69,100 @@
  * Private Functions
  ************************************************************************/
 
+/************************************************************************
+ * Name: lib_sendmapped
+ *
+ * Description:
+ *   If the source file is directly addressable (its file system supports
+ *   FIOC_MMAP, as ROMFS does on XIP media), hand the file data to the
+ *   destination's write method in place, with no intermediate buffer.
+ *   The source position is advanced as read() would have done.
+ *
+ * Returned Value:
+ *   The number of bytes transferred or ERROR, as for sendfile().
+ *   '*mapped' is set to false if the source cannot be mapped; the caller
+ *   must then fall back to the copy loop.
+ *
+ ************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0
+static ssize_t lib_sendmapped(int outfd, int infd, size_t count,
+                              FAR bool *mapped)
+{
+  FAR const uint8_t *base;
+  ssize_t nbyteswritten;
+  size_t  ntransferred;
+  off_t   pos;
+  off_t   end;
+
+  *mapped = false;
+
+  if ((unsigned int)infd >= CONFIG_NFILE_DESCRIPTORS ||
+      ioctl(infd, FIOC_MMAP, (unsigned long)((uintptr_t)&base)) < 0)
+    {
+      return 0;
+    }
+
+  /* Bound the transfer by the end of the file */
+
+  pos = lseek(infd, 0, SEEK_CUR);
+  if (pos == (off_t)-1)
+    {
+      return 0;
+    }
+
+  end = lseek(infd, 0, SEEK_END);
+  if (end == (off_t)-1 || lseek(infd, pos, SEEK_SET) == (off_t)-1)
+    {
+      return 0;
+    }
+
+  *mapped = true;
+
+  if (end <= pos)
+    {
+      return 0;
+    }
+
+  if (count > (size_t)(end - pos))
+    {
+      count = (size_t)(end - pos);
+    }
+
+  for (ntransferred = 0; ntransferred < count; )
+    {
+      nbyteswritten = write(outfd, base + pos + ntransferred,
+                            count - ntransferred);
+      if (nbyteswritten < 0)
+        {
+          /* EINTR is not an error if something was transferred (but will
+           * still stop the copy).
+           */
+
+#ifndef CONFIG_DISABLE_SIGNALS
+          if (errno != EINTR || ntransferred == 0)
+#endif
+            {
+              return ERROR;
+            }
+
+          break;
+        }
+
+      ntransferred += nbyteswritten;
+    }
+
+  /* Leave the source position after the last byte sent */
+
+  if (lseek(infd, pos + ntransferred, SEEK_SET) == (off_t)-1)
+    {
+      return ERROR;
+    }
+
+  return ntransferred;
+}
+#endif
+
 /************************************************************************
  * Public Functions
  ************************************************************************/
@@ -126,6 +224,9 @@ ssize_t sendfile(int outfd, int infd, off_t *offset, size_t count)
   ssize_t nbyteswritten;
   size_t  ntransferred;
   bool endxfr;
+#if CONFIG_NFILE_DESCRIPTORS > 0
+  bool mapped;
+#endif
 
   /* Get the current file position. */
 
@@ -147,6 +248,16 @@ ssize_t sendfile(int outfd, int infd, off_t *offset, size_t count)
         }
     }
 
+#if CONFIG_NFILE_DESCRIPTORS > 0
+  /* Send directly from the source media if it can be mapped */
+
+  ntransferred = lib_sendmapped(outfd, infd, count, &mapped);
+  if (mapped)
+    {
+      goto update_offset;
+    }
+#endif
+
   /* Allocate an I/O buffer */
 
   iobuffer = (FAR void *)lib_malloc(CONFIG_LIB_SENDFILE_BUFSIZE);
@@ -269,6 +380,10 @@ ssize_t sendfile(int outfd, int infd, off_t *offset, size_t count)
 
   lib_free(iobuffer);
 
+#if CONFIG_NFILE_DESCRIPTORS > 0
+update_offset:
+#endif
+
   /* Return the current file position */
 
   if (offset)
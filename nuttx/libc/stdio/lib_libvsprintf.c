@@ -216,6 +216,11 @@ static void postjustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
 
 static const char g_nullstring[] = "(null)";
 
+#ifndef CONFIG_NOPRINTF_FIELDWIDTH
+static const char g_spaces[] = "                ";
+static const char g_zeros[]  = "0000000000000000";
+#endif
+
 /****************************************************************************
  * Private Variables
  ****************************************************************************/
@@ -289,53 +294,48 @@ static int getpsize(uint8_t flags, FAR void *p)
 #endif /* CONFIG_PTR_IS_NOT_INT */
 
 /****************************************************************************
- * Name: utodec
+ * Name: utobase
+ *
+ * Description:
+ *   Convert n to ASCII in the given base into a local buffer, least
+ *   significant digit first, and output all digits at once.
+ *
  ****************************************************************************/
 
-static void utodec(FAR struct lib_outstream_s *obj, unsigned int n)
+static void utobase(FAR struct lib_outstream_s *obj, unsigned int n,
+                    unsigned int base, uint8_t a)
 {
-  unsigned int remainder = n % 10;
-  unsigned int dividend  = n / 10;
+  char buf[8 * sizeof(unsigned int)];
+  FAR char *ptr = &buf[sizeof(buf)];
 
-  if (dividend)
+  do
     {
-      utodec(obj, dividend);
+      unsigned int digit = n % base;
+
+      *--ptr = digit < 10 ? digit + '0' : digit - 10 + a;
+      n /= base;
     }
+  while (n != 0);
 
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  obj->puts(obj, ptr, &buf[sizeof(buf)] - ptr);
 }
 
 /****************************************************************************
- * Name: utohex
+ * Name: utodec
  ****************************************************************************/
 
-static void utohex(FAR struct lib_outstream_s *obj, unsigned int n, uint8_t a)
+static void utodec(FAR struct lib_outstream_s *obj, unsigned int n)
 {
-  bool    nonzero = false;
-  uint8_t bits;
-
-  for (bits = 8*sizeof(unsigned int); bits > 0; bits -= 4)
-    {
-      uint8_t nibble = (uint8_t)((n >> (bits - 4)) & 0xf);
-      if (nibble || nonzero)
-        {
-          nonzero = true;
+  utobase(obj, n, 10, 'a');
+}
 
-          if (nibble < 10)
-            {
-              obj->put(obj, nibble + '0');
-            }
-          else
-            {
-              obj->put(obj, nibble + a - 10);
-            }
-        }
-    }
+/****************************************************************************
+ * Name: utohex
+ ****************************************************************************/
 
-  if (!nonzero)
-    {
-      obj->put(obj, '0');
-    }
+static void utohex(FAR struct lib_outstream_s *obj, unsigned int n, uint8_t a)
+{
+  utobase(obj, n, 16, a);
 }
 
 /****************************************************************************
@@ -344,15 +344,7 @@ static void utohex(FAR struct lib_outstream_s *obj, unsigned int n, uint8_t a)
 
 static void utooct(FAR struct lib_outstream_s *obj, unsigned int n)
 {
-  unsigned int remainder = n & 0x7;
-  unsigned int dividend = n >> 3;
-
-  if (dividend)
-    {
-      utooct(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  utobase(obj, n, 8, 'a');
 }
 
 /****************************************************************************
@@ -361,15 +353,7 @@ static void utooct(FAR struct lib_outstream_s *obj, unsigned int n)
 
 static void utobin(FAR struct lib_outstream_s *obj, unsigned int n)
 {
-  unsigned int remainder = n & 1;
-  unsigned int dividend = n >> 1;
-
-  if (dividend)
-    {
-      utobin(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  utobase(obj, n, 2, 'a');
 }
 
 /****************************************************************************
@@ -431,8 +415,7 @@ static void utoascii(FAR struct lib_outstream_s *obj, uint8_t fmt, uint8_t flags
             {
               /* Prefix the number with "0x" */
 
-              obj->put(obj, '0');
-              obj->put(obj, 'x');
+              obj->puts(obj, "0x", 2);
             }
 
           /* Convert the unsigned value to a string. */
@@ -557,53 +540,48 @@ static int getdblsize(uint8_t fmt, int trunc, uint8_t flags, double n)
 
 #ifdef CONFIG_LONG_IS_NOT_INT
 /****************************************************************************
- * Name: lutodec
+ * Name: lutobase
+ *
+ * Description:
+ *   Convert n to ASCII in the given base into a local buffer, least
+ *   significant digit first, and output all digits at once.
+ *
  ****************************************************************************/
 
-static void lutodec(FAR struct lib_outstream_s *obj, unsigned long n)
+static void lutobase(FAR struct lib_outstream_s *obj, unsigned long n,
+                     unsigned int base, uint8_t a)
 {
-  unsigned int  remainder = n % 10;
-  unsigned long dividend  = n / 10;
+  char buf[8 * sizeof(unsigned long)];
+  FAR char *ptr = &buf[sizeof(buf)];
 
-  if (dividend)
+  do
     {
-      lutodec(obj, dividend);
+      unsigned int digit = n % base;
+
+      *--ptr = digit < 10 ? digit + '0' : digit - 10 + a;
+      n /= base;
     }
+  while (n != 0);
 
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  obj->puts(obj, ptr, &buf[sizeof(buf)] - ptr);
 }
 
 /****************************************************************************
- * Name: lutohex
+ * Name: lutodec
  ****************************************************************************/
 
-static void lutohex(FAR struct lib_outstream_s *obj, unsigned long n, uint8_t a)
+static void lutodec(FAR struct lib_outstream_s *obj, unsigned long n)
 {
-  bool    nonzero = false;
-  uint8_t bits;
-
-  for (bits = 8*sizeof(unsigned long); bits > 0; bits -= 4)
-    {
-      uint8_t nibble = (uint8_t)((n >> (bits - 4)) & 0xf);
-      if (nibble || nonzero)
-        {
-          nonzero = true;
+  lutobase(obj, n, 10, 'a');
+}
 
-          if (nibble < 10)
-            {
-              obj->put(obj, nibble + '0');
-            }
-          else
-            {
-              obj->put(obj, nibble + a - 10);
-            }
-        }
-    }
+/****************************************************************************
+ * Name: lutohex
+ ****************************************************************************/
 
-  if (!nonzero)
-    {
-      obj->put(obj, '0');
-    }
+static void lutohex(FAR struct lib_outstream_s *obj, unsigned long n, uint8_t a)
+{
+  lutobase(obj, n, 16, a);
 }
 
 /****************************************************************************
@@ -612,15 +590,7 @@ static void lutohex(FAR struct lib_outstream_s *obj, unsigned long n, uint8_t a)
 
 static void lutooct(FAR struct lib_outstream_s *obj, unsigned long n)
 {
-  unsigned int  remainder = n & 0x7;
-  unsigned long dividend  = n >> 3;
-
-  if (dividend)
-    {
-      lutooct(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  lutobase(obj, n, 8, 'a');
 }
 
 /****************************************************************************
@@ -629,15 +599,7 @@ static void lutooct(FAR struct lib_outstream_s *obj, unsigned long n)
 
 static void lutobin(FAR struct lib_outstream_s *obj, unsigned long n)
 {
-  unsigned int  remainder = n & 1;
-  unsigned long dividend  = n >> 1;
-
-  if (dividend)
-    {
-      lutobin(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  lutobase(obj, n, 2, 'a');
 }
 
 /****************************************************************************
@@ -696,8 +658,7 @@ static void lutoascii(FAR struct lib_outstream_s *obj, uint8_t fmt, uint8_t flag
             {
               /* Prefix the number with "0x" */
 
-              obj->put(obj, '0');
-              obj->put(obj, 'x');
+              obj->puts(obj, "0x", 2);
             }
 
           /* Convert the unsigned value to a string. */
@@ -807,53 +768,48 @@ static int getlusize(uint8_t fmt, uint8_t flags, unsigned long ln)
 
 #ifdef CONFIG_HAVE_LONG_LONG
 /****************************************************************************
- * Name: llutodec
+ * Name: llutobase
+ *
+ * Description:
+ *   Convert n to ASCII in the given base into a local buffer, least
+ *   significant digit first, and output all digits at once.
+ *
  ****************************************************************************/
 
-static void llutodec(FAR struct lib_outstream_s *obj, unsigned long long n)
+static void llutobase(FAR struct lib_outstream_s *obj, unsigned long long n,
+                      unsigned int base, uint8_t a)
 {
-  unsigned int remainder = n % 10;
-  unsigned long long dividend = n / 10;
+  char buf[8 * sizeof(unsigned long long)];
+  FAR char *ptr = &buf[sizeof(buf)];
 
-  if (dividend)
+  do
     {
-      llutodec(obj, dividend);
+      unsigned int digit = n % base;
+
+      *--ptr = digit < 10 ? digit + '0' : digit - 10 + a;
+      n /= base;
     }
+  while (n != 0);
 
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  obj->puts(obj, ptr, &buf[sizeof(buf)] - ptr);
 }
 
 /****************************************************************************
- * Name: llutohex
+ * Name: llutodec
  ****************************************************************************/
 
-static void llutohex(FAR struct lib_outstream_s *obj, unsigned long long n, uint8_t a)
+static void llutodec(FAR struct lib_outstream_s *obj, unsigned long long n)
 {
-  bool    nonzero = false;
-  uint8_t bits;
-
-  for (bits = 8*sizeof(unsigned long long); bits > 0; bits -= 4)
-    {
-      uint8_t nibble = (uint8_t)((n >> (bits - 4)) & 0xf);
-      if (nibble || nonzero)
-        {
-          nonzero = true;
+  llutobase(obj, n, 10, 'a');
+}
 
-          if (nibble < 10)
-            {
-              obj->put(obj, (nibble + '0'));
-            }
-          else
-            {
-              obj->put(obj, (nibble + a - 10));
-            }
-        }
-    }
+/****************************************************************************
+ * Name: llutohex
+ ****************************************************************************/
 
-  if (!nonzero)
-    {
-      obj->put(obj, '0');
-    }
+static void llutohex(FAR struct lib_outstream_s *obj, unsigned long long n, uint8_t a)
+{
+  llutobase(obj, n, 16, a);
 }
 
 /****************************************************************************
@@ -862,15 +818,7 @@ static void llutohex(FAR struct lib_outstream_s *obj, unsigned long long n, uint
 
 static void llutooct(FAR struct lib_outstream_s *obj, unsigned long long n)
 {
-  unsigned int remainder = n & 0x7;
-  unsigned long long dividend = n >> 3;
-
-  if (dividend)
-    {
-      llutooct(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  llutobase(obj, n, 8, 'a');
 }
 
 /****************************************************************************
@@ -879,15 +827,7 @@ static void llutooct(FAR struct lib_outstream_s *obj, unsigned long long n)
 
 static void llutobin(FAR struct lib_outstream_s *obj, unsigned long long n)
 {
-  unsigned int remainder = n & 1;
-  unsigned long long dividend = n >> 1;
-
-  if (dividend)
-    {
-      llutobin(obj, dividend);
-    }
-
-  obj->put(obj, (remainder + (unsigned int)'0'));
+  llutobase(obj, n, 2, 'a');
 }
 
 /****************************************************************************
@@ -946,8 +886,7 @@ static void llutoascii(FAR struct lib_outstream_s *obj, uint8_t fmt, uint8_t fla
             {
               /* Prefix the number with "0x" */
 
-              obj->put(obj, '0');
-              obj->put(obj, 'x');
+              obj->puts(obj, "0x", 2);
             }
 
           /* Convert the unsigned value to a string. */
@@ -1056,6 +995,28 @@ static int getllusize(uint8_t fmt, uint8_t flags, unsigned long long lln)
 #endif /* CONFIG_NOPRINTF_FIELDWIDTH */
 #endif /* CONFIG_HAVE_LONG_LONG */
 
+/****************************************************************************
+ * Name: padding
+ *
+ * Description:
+ *   Output n characters from pad (g_spaces or g_zeros), in chunks.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_NOPRINTF_FIELDWIDTH
+static void padding(FAR struct lib_outstream_s *obj, FAR const char *pad,
+                    int n)
+{
+  while (n > 0)
+    {
+      int chunk = n < sizeof(g_spaces) - 1 ? n : sizeof(g_spaces) - 1;
+
+      obj->puts(obj, pad, chunk);
+      n -= chunk;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: prejustify
  ****************************************************************************/
@@ -1064,8 +1025,6 @@ static int getllusize(uint8_t fmt, uint8_t flags, unsigned long long lln)
 static void prejustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
                        uint8_t flags, int fieldwidth, int valwidth)
 {
-  int i;
-
   switch (fmt)
     {
       default:
@@ -1075,10 +1034,7 @@ static void prejustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
             valwidth++;
           }
 
-        for (i = fieldwidth - valwidth; i > 0; i--)
-          {
-            obj->put(obj, ' ');
-          }
+        padding(obj, g_spaces, fieldwidth - valwidth);
 
         if (IS_NEGATE(flags))
           {
@@ -1102,10 +1058,7 @@ static void prejustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
             valwidth++;
           }
 
-        for (i = fieldwidth - valwidth; i > 0; i--)
-          {
-            obj->put(obj, '0');
-          }
+        padding(obj, g_zeros, fieldwidth - valwidth);
         break;
 
       case FMT_LJUST:
@@ -1130,8 +1083,6 @@ static void prejustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
 static void postjustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
                         uint8_t flags, int fieldwidth, int valwidth)
 {
-  int i;
-
   /* Apply field justification to the integer value. */
 
   switch (fmt)
@@ -1147,10 +1098,7 @@ static void postjustify(FAR struct lib_outstream_s *obj, uint8_t fmt,
             valwidth++;
           }
 
-        for (i = fieldwidth - valwidth; i > 0; i--)
-          {
-            obj->put(obj, ' ');
-          }
+        padding(obj, g_spaces, fieldwidth - valwidth);
         break;
     }
 }
@@ -1185,9 +1133,29 @@ int lib_vsprintf(FAR struct lib_outstream_s *obj, FAR const char *src, va_list a
 
       if (FMT_CHAR != '%')
         {
+#ifndef CONFIG_ARCH_ROMGETC
+           /* Output the whole run of regular characters at once.  It ends
+            * before the next format specifier or, with line buffering, on
+            * a newline so that it gets flushed below.
+            */
+
+           FAR const char *start = src;
+
+           while (src[1] != '\0' && src[1] != '%'
+#ifdef CONFIG_STDIO_LINEBUFFER
+                  && *src != '\n'
+#endif
+                 )
+             {
+               src++;
+             }
+
+           obj->puts(obj, start, src - start + 1);
+#else
            /* Output the character */
 
            obj->put(obj, FMT_CHAR);
+#endif
 
            /* Flush the buffer if a newline is encountered */
 
@@ -1379,11 +1347,11 @@ int lib_vsprintf(FAR struct lib_outstream_s *obj, FAR const char *src, va_list a
 #endif
           /* Concatenate the string into the output */
 
-          while (*ptmp)
-            {
-              obj->put(obj, *ptmp);
-              ptmp++;
-            }
+#ifndef CONFIG_NOPRINTF_FIELDWIDTH
+          obj->puts(obj, ptmp, swidth);
+#else
+          obj->puts(obj, ptmp, strlen(ptmp));
+#endif
 
           /* Perform left-justification operations. */
 
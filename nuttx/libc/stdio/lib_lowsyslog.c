@@ -39,6 +39,7 @@
 
 #include <nuttx/config.h>
 #include <nuttx/arch.h>
+#include <nuttx/syslog/binlog.h>
 #include <stdio.h>
 #include <debug.h>
 #include <semaphore.h>
@@ -93,6 +94,11 @@
 #if defined(CONFIG_ARCH_LOWPUTC) || defined(CONFIG_SYSLOG)
 int lowvsyslog(FAR const char *fmt, va_list ap)
 {
+#ifdef CONFIG_BINLOG
+    /* Save the format and arguments, formatting is deferred to the reader */
+
+    return binlog_vprintf(fmt, ap);
+#else
     struct lib_outstream_s stream;
 
     /* Wrap the stdout in a stream object and let lib_vsprintf do the work. */
@@ -127,6 +133,7 @@ int lowvsyslog(FAR const char *fmt, va_list ap)
     }
     return ret;
 #endif
+#endif /* CONFIG_BINLOG */
 }
 
 /****************************************************************************
@@ -38,6 +38,7 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <nuttx/syslog/binlog.h>
 
 #include <stdio.h>
 #include <syslog.h>
@@ -93,7 +94,13 @@
 
 int vsyslog(FAR const char *fmt, va_list ap)
 {
-#if defined(CONFIG_SYSLOG)
+#if defined(CONFIG_BINLOG)
+
+  /* Save the format and arguments, formatting is deferred to the reader */
+
+  return binlog_vprintf(fmt, ap);
+
+#elif defined(CONFIG_SYSLOG)
 
   struct lib_outstream_s stream;
 
@@ -90,6 +90,19 @@ static void syslogstream_putc(FAR struct lib_outstream_s *this, int ch)
   while (errno == -EINTR);
 }
 
+/****************************************************************************
+ * Name: syslogstream_puts
+ ****************************************************************************/
+
+static void syslogstream_puts(FAR struct lib_outstream_s *this,
+                              FAR const char *buf, int len)
+{
+  while (len-- > 0)
+    {
+      syslogstream_putc(this, *buf++);
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -112,6 +125,7 @@ static void syslogstream_putc(FAR struct lib_outstream_s *this, int ch)
 void lib_syslogstream(FAR struct lib_outstream_s *stream)
 {
   stream->put   = syslogstream_putc;
+  stream->puts  = syslogstream_puts;
 #ifdef CONFIG_STDIO_LINEBUFFER
   stream->flush = lib_noflush;
 #endif
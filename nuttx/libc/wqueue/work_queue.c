@@ -104,10 +104,18 @@
  *
  ****************************************************************************/
 
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+int work_queue_priority(int qid, FAR struct work_s *work, worker_t worker,
+                        FAR void *arg, uint32_t delay, uint8_t prio)
+#else
 int work_queue(int qid, FAR struct work_s *work, worker_t worker,
                FAR void *arg, uint32_t delay)
+#endif
 {
   FAR struct wqueue_s *wqueue = &g_work[qid];
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  FAR struct work_s *prev;
+#endif
   irqstate_t flags;
 
   DEBUGASSERT(work != NULL && (unsigned)qid < NWORKERS);
@@ -117,6 +125,9 @@ int work_queue(int qid, FAR struct work_s *work, worker_t worker,
   work->worker = worker;           /* Work callback */
   work->arg    = arg;              /* Callback argument */
   work->delay  = delay;            /* Delay until work performed */
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  work->prio   = prio > 0 ? prio : wqueue->prio;
+#endif
 
   /* Now, time-tag that entry and put it in the work queue.  This must be
    * done with interrupts disabled.  This permits this function to be called
@@ -126,11 +137,38 @@ int work_queue(int qid, FAR struct work_s *work, worker_t worker,
   flags        = irqsave();
   work->qtime  = clock_systimer(); /* Time work queued */
 
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  /* Queue the work behind any work of the same or higher priority */
+
+  for (prev = (FAR struct work_s *)wqueue->q.tail;
+       prev && prev->prio < work->prio;
+       prev = (FAR struct work_s *)prev->dq.blink);
+
+  if (prev)
+    {
+      dq_addafter((FAR dq_entry_t *)prev, (FAR dq_entry_t *)work,
+                  &wqueue->q);
+    }
+  else
+    {
+      dq_addfirst((FAR dq_entry_t *)work, &wqueue->q);
+    }
+#else
   dq_addlast((FAR dq_entry_t *)work, &wqueue->q);
-  kill(wqueue->pid, SIGWORK);      /* Wake up the worker thread */
+#endif
+
+  (void)work_signal(qid);          /* Wake up a worker thread */
 
   irqrestore(flags);
   return OK;
 }
 
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+int work_queue(int qid, FAR struct work_s *work, worker_t worker,
+               FAR void *arg, uint32_t delay)
+{
+  return work_queue_priority(qid, work, worker, arg, delay, 0);
+}
+#endif
+
 #endif /* CONFIG_SCHED_WORKQUEUE */
@@ -42,6 +42,7 @@
 #include <signal.h>
 #include <assert.h>
 
+#include <nuttx/arch.h>
 #include <nuttx/wqueue.h>
 
 #ifdef CONFIG_SCHED_WORKQUEUE
@@ -87,8 +88,30 @@
 
 int work_signal(int qid)
 {
+  FAR struct wqueue_s *wqueue = &g_work[qid];
+  irqstate_t flags;
+  pid_t pid;
+  int i;
+
   DEBUGASSERT((unsigned)qid < NWORKERS);
-  return kill(g_work[qid].pid, SIGWORK);
+
+  /* Wake up the first idle worker thread, or the first thread if they are
+   * all busy: a pending signal only makes its next wait return at once.
+   */
+
+  flags = irqsave();
+  pid   = wqueue->pid[0];
+  for (i = 0; i < wqueue->nthreads; i++)
+    {
+      if ((wqueue->idle & (1 << i)) != 0)
+        {
+          pid = wqueue->pid[i];
+          break;
+        }
+    }
+
+  irqrestore(flags);
+  return kill(pid, SIGWORK);
 }
 
 #endif /* CONFIG_SCHED_WORKQUEUE */
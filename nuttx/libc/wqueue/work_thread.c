@@ -40,7 +40,9 @@
 #include <nuttx/config.h>
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <sched.h>
 #include <queue.h>
 #include <assert.h>
 #include <errno.h>
@@ -111,12 +113,16 @@ struct wqueue_s g_work[NWORKERS];
  *
  ****************************************************************************/
 
-static void work_process(FAR struct wqueue_s *wqueue)
+static void work_process(FAR struct wqueue_s *wqueue, int index)
 {
   volatile FAR struct work_s *work;
   worker_t  worker;
   irqstate_t flags;
   FAR void *arg;
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  struct sched_param param;
+  uint8_t prio;
+#endif
   uint32_t elapsed;
   uint32_t remaining;
   uint32_t next;
@@ -158,6 +164,9 @@ static void work_process(FAR struct wqueue_s *wqueue)
               /* Extract the work argument (before re-enabling interrupts) */
 
               arg = work->arg;
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+              prio = work->prio;
+#endif
 
               /* Mark the work as no longer being queued */
 
@@ -168,8 +177,27 @@ static void work_process(FAR struct wqueue_s *wqueue)
                */
 
               irqrestore(flags);
+
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+              /* Perform the work at its own priority, if it has one */
+
+              if (prio != wqueue->prio)
+                {
+                  param.sched_priority = prio;
+                  (void)sched_setparam(0, &param);
+                }
+
               worker(arg);
 
+              if (prio != wqueue->prio)
+                {
+                  param.sched_priority = wqueue->prio;
+                  (void)sched_setparam(0, &param);
+                }
+#else
+              worker(arg);
+#endif
+
               /* Now, unfortunately, since we re-enabled interrupts we don't
                * know the state of the work list and we will have to start
                * back at the head of the list.
@@ -208,13 +236,32 @@ static void work_process(FAR struct wqueue_s *wqueue)
     }
 
   /* Wait awhile to check the work list.  We will wait here until either
-   * the time elapses or until we are awakened by a signal.
+   * the time elapses or until we are awakened by a signal.  Work queued
+   * meanwhile wakes up an idle thread first.
    */
 
+  wqueue->idle |= (1 << index);
   usleep(next * USEC_PER_TICK);
+  wqueue->idle &= ~(1 << index);
   irqrestore(flags);
 }
 
+/****************************************************************************
+ * Name: work_index
+ *
+ * Description:
+ *   Return the index of a kernel worker thread among the threads serving
+ *   its work queue, passed in argv[1].
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_HPWORK
+static inline int work_index(int argc, char *argv[])
+{
+  return argc > 1 ? atoi(argv[1]) : 0;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -253,6 +300,8 @@ static void work_process(FAR struct wqueue_s *wqueue)
 
 int work_hpthread(int argc, char *argv[])
 {
+  int index = work_index(argc, argv);
+
   /* Loop forever */
 
   for (;;)
@@ -272,7 +321,7 @@ int work_hpthread(int argc, char *argv[])
        * we process items in the work list.
        */
 
-      work_process(&g_work[HPWORK]);
+      work_process(&g_work[HPWORK], index);
     }
 
   return OK; /* To keep some compilers happy */
@@ -282,6 +331,8 @@ int work_hpthread(int argc, char *argv[])
 
 int work_lpthread(int argc, char *argv[])
 {
+  int index = work_index(argc, argv);
+
   /* Loop forever */
 
   for (;;)
@@ -299,7 +350,7 @@ int work_lpthread(int argc, char *argv[])
        * we process items in the work list.
        */
 
-      work_process(&g_work[LPWORK]);
+      work_process(&g_work[LPWORK], index);
     }
 
   return OK; /* To keep some compilers happy */
@@ -320,7 +371,7 @@ int work_usrthread(int argc, char *argv[])
        * we process items in the work list.
        */
 
-      work_process(&g_work[USRWORK]);
+      work_process(&g_work[USRWORK], 0);
     }
 
   return OK; /* To keep some compilers happy */
@@ -93,14 +93,18 @@ int work_usrstart(void)
 
   svdbg("Starting user-mode worker thread\n");
 
-  g_usrwork[USRWORK].pid = task_create("usrwork",
-                                       CONFIG_SCHED_USRWORKPRIORITY,
-                                       CONFIG_SCHED_USRWORKSTACKSIZE,
-                                       (main_t)work_usrthread,
-                                       (FAR char * const *)NULL);
-
-  DEBUGASSERT(g_usrwork[USRWORK].pid > 0);
-  if (g_usrwork[USRWORK].pid < 0)
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  g_usrwork[USRWORK].prio = CONFIG_SCHED_USRWORKPRIORITY;
+#endif
+
+  g_usrwork[USRWORK].pid[0] = task_create("usrwork",
+                                          CONFIG_SCHED_USRWORKPRIORITY,
+                                          CONFIG_SCHED_USRWORKSTACKSIZE,
+                                          (main_t)work_usrthread,
+                                          (FAR char * const *)NULL);
+
+  DEBUGASSERT(g_usrwork[USRWORK].pid[0] > 0);
+  if (g_usrwork[USRWORK].pid[0] < 0)
     {
       int errcode = errno;
       DEBUGASSERT(errcode > 0);
@@ -109,7 +113,8 @@ int work_usrstart(void)
       return -errcode;
     }
 
-  return g_usrwork[USRWORK].pid;
+  g_usrwork[USRWORK].nthreads = 1;
+  return g_usrwork[USRWORK].pid[0];
 }
 
 #endif /* CONFIG_BUILD_PROTECTED && !__KERNEL__ CONFIG_SCHED_WORKQUEUE && CONFIG_SCHED_USRWORK */
@@ -29,9 +29,11 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <nuttx/config.h>
 #include <nuttx/list.h>
@@ -41,9 +43,16 @@
 
 #include <arch/chip/chip.h>
 
-#define MM_BUCKET_MAX           31
+#define MM_BUCKET_MAX           (BUFRAM_ORDER_COUNT - 1)
 #define MM_CANARY               0xfab0fab0
 
+/*
+ * Every block carries a 16 bytes control header and is at least one byte
+ * larger than it, so no block is ever smaller than 2^MM_MIN_ORDER bytes.
+ */
+#define MM_MIN_ORDER            5
+#define MM_BITMAP_BITS          (BUFRAM_SIZE >> MM_MIN_ORDER)
+
 #ifdef CONFIG_MM_BUFRAM_DEBUG
 #define mm_warn(message...) lowsyslog(message)
 #else
@@ -51,6 +60,24 @@
 #endif
 
 static struct list_head mm_bucket[MM_BUCKET_MAX + 1];
+static size_t mm_bucket_count[MM_BUCKET_MAX + 1];
+
+/* One bit per minimum sized block, set when a free block starts there */
+static uint32_t mm_free_map[(MM_BITMAP_BITS + 31) / 32];
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+static size_t mm_used_size;
+static size_t mm_peak_used;
+static uint32_t mm_failures;
+static struct bufram_owner_stats mm_owner_stats[BUFRAM_OWNER_COUNT];
+
+static const char *const mm_owner_names[BUFRAM_OWNER_COUNT] = {
+    [BUFRAM_OWNER_OTHER] = "other",
+    [BUFRAM_OWNER_CPORT] = "cport",
+    [BUFRAM_OWNER_USB] = "usb",
+    [BUFRAM_OWNER_I2S] = "i2s",
+};
+#endif
 
 struct mm_buffer {
     uint32_t canary;
@@ -84,6 +111,43 @@ static size_t order_to_size(int order)
     return 1 << order;
 }
 
+static inline bool is_in_bufram(void *ptr)
+{
+    uintptr_t addr = (uintptr_t) ptr;
+
+    return addr >= BUFRAM_BASE && addr < BUFRAM_BASE + BUFRAM_SIZE;
+}
+
+static inline unsigned int buffer_to_index(struct mm_buffer *buffer)
+{
+    return ((uintptr_t) buffer - BUFRAM_BASE) >> MM_MIN_ORDER;
+}
+
+static inline bool is_buffer_free(struct mm_buffer *buffer)
+{
+    unsigned int index = buffer_to_index(buffer);
+
+    return mm_free_map[index / 32] & (1 << (index % 32));
+}
+
+static void bucket_add(struct mm_buffer *buffer)
+{
+    unsigned int index = buffer_to_index(buffer);
+
+    mm_free_map[index / 32] |= 1 << (index % 32);
+    mm_bucket_count[buffer->bucket]++;
+    list_add(&mm_bucket[buffer->bucket], &buffer->list);
+}
+
+static void bucket_del(struct mm_buffer *buffer)
+{
+    unsigned int index = buffer_to_index(buffer);
+
+    mm_free_map[index / 32] &= ~(1 << (index % 32));
+    mm_bucket_count[buffer->bucket]--;
+    list_del(&buffer->list);
+}
+
 void bufram_register_region(uintptr_t base, unsigned order)
 {
     struct mm_buffer *buffer;
@@ -95,15 +159,19 @@ void bufram_register_region(uintptr_t base, unsigned order)
 #endif
     list_init(&buffer->list);
 
-    list_add(&mm_bucket[buffer->bucket], &buffer->list);
+    bucket_add(buffer);
 }
 
 void bufram_init(void)
 {
     int i;
 
-    for (i = 0; i < ARRAY_SIZE(mm_bucket); i++)
+    for (i = 0; i < ARRAY_SIZE(mm_bucket); i++) {
         list_init(&mm_bucket[i]);
+        mm_bucket_count[i] = 0;
+    }
+
+    memset(mm_free_map, 0, sizeof(mm_free_map));
 }
 
 static inline void *get_buffer_payload(struct mm_buffer *buffer)
@@ -146,7 +214,7 @@ static int fill_bucket(int order)
         DEBUGASSERT(buffer1);
     }
 
-    list_del(&buffer1->list);
+    bucket_del(buffer1);
 
     buffer2 = (struct mm_buffer*) ((char*) buffer1 + order_to_size(order));
     list_init(&buffer2->list);
@@ -158,49 +226,44 @@ static int fill_bucket(int order)
     buffer2->canary = buffer1->canary = MM_CANARY;
 #endif
 
-    list_add(&mm_bucket[order], &buffer1->list);
-    list_add(&mm_bucket[order], &buffer2->list);
+    bucket_add(buffer1);
+    bucket_add(buffer2);
 
     return 0;
 }
 
 static void defragment(struct mm_buffer *buffer)
 {
-    struct list_head *iter;
     struct mm_buffer *buffer_low;
     struct mm_buffer *buffer_high;
     struct mm_buffer *buffer2;
-    struct mm_buffer *buffer3;
 
-    if (list_is_empty(&mm_bucket[buffer->bucket])) {
-        mm_warn("mm: trying to defragment empty bucket");
-        return;
-    }
-
-    if (((unsigned long) buffer) & (1 << buffer->bucket)) {
-        buffer_low = buffer2 = (struct mm_buffer*)
-            ((char*) buffer - order_to_size(buffer->bucket));
-        buffer_high = buffer;
-    } else {
-        buffer_low = buffer;
-        buffer_high = buffer2 = (struct mm_buffer*)
-            ((char*) buffer + order_to_size(buffer->bucket));
-    }
-
-    list_foreach(&mm_bucket[buffer->bucket], iter) {
-        buffer3 = list_entry(iter, struct mm_buffer, list);
-        if (buffer3 != buffer2)
-            continue;
-
-        list_del(&buffer_low->list);
-        list_del(&buffer_high->list);
+    while (buffer->bucket < MM_BUCKET_MAX) {
+        if (((unsigned long) buffer) & (1 << buffer->bucket)) {
+            buffer_low = buffer2 = (struct mm_buffer*)
+                ((char*) buffer - order_to_size(buffer->bucket));
+            buffer_high = buffer;
+        } else {
+            buffer_low = buffer;
+            buffer_high = buffer2 = (struct mm_buffer*)
+                ((char*) buffer + order_to_size(buffer->bucket));
+        }
+
+        /*
+         * The buddy header is only meaningful if a free block starts there,
+         * and it can only be merged if it was not split any further.
+         */
+        if (!is_in_bufram(buffer2) || !is_buffer_free(buffer2) ||
+            buffer2->bucket != buffer->bucket)
+            return;
+
+        bucket_del(buffer_low);
+        bucket_del(buffer_high);
 
         buffer_low->bucket++;
-        list_add(&mm_bucket[buffer_low->bucket], &buffer_low->list);
+        bucket_add(buffer_low);
 
-        defragment(buffer_low);
-
-        return;
+        buffer = buffer_low;
     }
 }
 
@@ -246,12 +309,22 @@ void *bufram_alloc(size_t size)
     if (!buffer)
         goto error;
 
-    list_del(&buffer->list);
+    bucket_del(buffer);
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+    mm_used_size += order_to_size(order);
+    if (mm_used_size > mm_peak_used)
+        mm_peak_used = mm_used_size;
+#endif
+
     irqrestore(flags);
 
     return get_buffer_payload(buffer);
 
 error:
+#ifdef CONFIG_MM_BUFRAM_STATS
+    mm_failures++;
+#endif
     irqrestore(flags);
     return NULL;
 }
@@ -279,12 +352,66 @@ void bufram_free(void *ptr)
 
     flags = irqsave();
 
-    list_add(&mm_bucket[buffer->bucket], &buffer->list);
+#ifdef CONFIG_MM_BUFRAM_STATS
+    mm_used_size -= order_to_size(buffer->bucket);
+#endif
+
+    bucket_add(buffer);
     defragment(buffer);
 
     irqrestore(flags);
 }
 
+void *bufram_page_alloc_owner(size_t page_count, enum bufram_owner owner)
+{
+    void *buffer;
+#ifdef CONFIG_MM_BUFRAM_STATS
+    struct bufram_owner_stats *stats;
+    irqstate_t flags;
+#endif
+
+    buffer = bufram_page_alloc(page_count);
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+    if (owner >= BUFRAM_OWNER_COUNT)
+        owner = BUFRAM_OWNER_OTHER;
+
+    stats = &mm_owner_stats[owner];
+
+    flags = irqsave();
+    if (buffer) {
+        stats->allocs++;
+        stats->pages += page_count;
+        if (stats->pages > stats->peak_pages)
+            stats->peak_pages = stats->pages;
+    } else {
+        stats->failures++;
+    }
+    irqrestore(flags);
+#endif
+
+    return buffer;
+}
+
+void bufram_page_free_owner(void *ptr, size_t page_count,
+                            enum bufram_owner owner)
+{
+#ifdef CONFIG_MM_BUFRAM_STATS
+    irqstate_t flags;
+
+    if (owner >= BUFRAM_OWNER_COUNT)
+        owner = BUFRAM_OWNER_OTHER;
+
+    if (ptr) {
+        flags = irqsave();
+        mm_owner_stats[owner].pages -= page_count;
+        irqrestore(flags);
+    }
+#endif
+
+    bufram_page_free(ptr, page_count);
+}
+
 void *bufram_page_alloc(size_t page_count)
 {
     char *buffer;
@@ -316,3 +443,73 @@ void bufram_page_free(void *ptr, size_t page_count)
 
     bufram_free(get_buffer_payload(buffer));
 }
+
+void bufram_get_stats(struct bufram_stats *stats)
+{
+    irqstate_t flags;
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    flags = irqsave();
+    for (i = 0; i <= MM_BUCKET_MAX; i++) {
+        stats->free_blocks[i] = mm_bucket_count[i];
+        stats->free_size += mm_bucket_count[i] * order_to_size(i);
+        if (mm_bucket_count[i])
+            stats->largest_free = order_to_size(i);
+    }
+
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+    stats->used_size = mm_used_size;
+    stats->peak_used = mm_peak_used;
+    stats->failures = mm_failures;
+#endif
+    irqrestore(flags);
+
+    if (stats->free_size) {
+        stats->fragmentation = 100 - (stats->largest_free * 100) /
+                                     stats->free_size;
+    }
+}
+
+#ifdef CONFIG_MM_BUFRAM_STATS
+const char *bufram_owner_name(enum bufram_owner owner)
+{
+    if (owner >= BUFRAM_OWNER_COUNT)
+        return NULL;
+
+    return mm_owner_names[owner];
+}
+
+int bufram_get_owner_stats(enum bufram_owner owner,
+                           struct bufram_owner_stats *stats)
+{
+    irqstate_t flags;
+
+    if (owner >= BUFRAM_OWNER_COUNT)
+        return -EINVAL;
+
+    flags = irqsave();
+    *stats = mm_owner_stats[owner];
+    irqrestore(flags);
+
+    return 0;
+}
+
+void bufram_reset_stats(void)
+{
+    irqstate_t flags;
+    int i;
+
+    flags = irqsave();
+    mm_peak_used = mm_used_size;
+    mm_failures = 0;
+    for (i = 0; i < BUFRAM_OWNER_COUNT; i++) {
+        mm_owner_stats[i].peak_pages = mm_owner_stats[i].pages;
+        mm_owner_stats[i].allocs = 0;
+        mm_owner_stats[i].failures = 0;
+    }
+    irqrestore(flags);
+}
+#endif
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/bufram.h>
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define BUFRAM_PROCFS_LINELEN   128
+
+struct bufram_procfs_file {
+    struct procfs_file_s base;
+    char line[BUFRAM_PROCFS_LINELEN];
+};
+
+static bool bufram_procfs_copy(char *line, size_t linesize, char **buffer,
+                               size_t *remaining, off_t *offset,
+                               size_t *total)
+{
+    size_t copysize;
+
+    if (linesize >= BUFRAM_PROCFS_LINELEN)
+        linesize = BUFRAM_PROCFS_LINELEN - 1;
+
+    copysize = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+    *buffer += copysize;
+    *remaining -= copysize;
+    *total += copysize;
+
+    return *remaining > 0;
+}
+
+static int bufram_procfs_open(struct file *filep, const char *relpath,
+                              int oflags, mode_t mode)
+{
+    struct bufram_procfs_file *priv;
+
+    if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+        return -EACCES;
+
+    if (strcmp(relpath, "bufram") != 0)
+        return -ENOENT;
+
+    priv = kmm_zalloc(sizeof(*priv));
+    if (!priv)
+        return -ENOMEM;
+
+    filep->f_priv = priv;
+    return 0;
+}
+
+static int bufram_procfs_close(struct file *filep)
+{
+    DEBUGASSERT(filep->f_priv);
+
+    kmm_free(filep->f_priv);
+    filep->f_priv = NULL;
+    return 0;
+}
+
+static ssize_t bufram_procfs_read(struct file *filep, char *buffer,
+                                  size_t buflen)
+{
+    struct bufram_procfs_file *priv = filep->f_priv;
+    struct bufram_owner_stats owner_stats;
+    struct bufram_stats stats;
+    off_t offset = filep->f_pos;
+    size_t remaining = buflen;
+    size_t total = 0;
+    size_t linesize;
+    int owner;
+
+    DEBUGASSERT(priv);
+
+    bufram_get_stats(&stats);
+
+    linesize = snprintf(priv->line, BUFRAM_PROCFS_LINELEN,
+                        "used: %u bytes, peak: %u bytes, failures: %u\n",
+                        stats.used_size, stats.peak_used, stats.failures);
+    if (!bufram_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+        goto out;
+
+    linesize = snprintf(priv->line, BUFRAM_PROCFS_LINELEN,
+                        "free: %u bytes, largest: %u bytes, "
+                        "fragmentation: %u%%\n", stats.free_size,
+                        stats.largest_free, stats.fragmentation);
+    if (!bufram_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+        goto out;
+
+    linesize = snprintf(priv->line, BUFRAM_PROCFS_LINELEN,
+                        "OWNER  PAGES   PEAK     ALLOCS   FAILS\n");
+    if (!bufram_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+        goto out;
+
+    for (owner = 0; owner < BUFRAM_OWNER_COUNT; owner++) {
+        if (bufram_get_owner_stats(owner, &owner_stats))
+            continue;
+
+        linesize = snprintf(priv->line, BUFRAM_PROCFS_LINELEN,
+                            "%-5s %6u %6u %10u %7u\n",
+                            bufram_owner_name(owner), owner_stats.pages,
+                            owner_stats.peak_pages, owner_stats.allocs,
+                            owner_stats.failures);
+        if (!bufram_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                                &offset, &total))
+            goto out;
+    }
+
+out:
+    filep->f_pos += total;
+    return total;
+}
+
+static int bufram_procfs_dup(const struct file *oldp, struct file *newp)
+{
+    struct bufram_procfs_file *newpriv;
+
+    DEBUGASSERT(oldp->f_priv);
+
+    newpriv = kmm_zalloc(sizeof(*newpriv));
+    if (!newpriv)
+        return -ENOMEM;
+
+    memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+    newp->f_priv = newpriv;
+    return 0;
+}
+
+static int bufram_procfs_stat(const char *relpath, struct stat *buf)
+{
+    if (strcmp(relpath, "bufram") != 0)
+        return -ENOENT;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+    return 0;
+}
+
+const struct procfs_operations bufram_procfsoperations = {
+    .open = bufram_procfs_open,
+    .close = bufram_procfs_close,
+    .read = bufram_procfs_read,
+    .dup = bufram_procfs_dup,
+    .stat = bufram_procfs_stat,
+};
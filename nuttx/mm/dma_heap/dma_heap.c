@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <nuttx/compiler.h>
+#include <nuttx/mm/mm.h>
+#include <nuttx/mm/dma_heap.h>
+
+#if CONFIG_MM_DMA_HEAP_BASE == 0
+/*
+ * No fixed region given: carve the DMA heap out of .bss, or .noinit. It then
+ * never overlaps the main heap.
+ */
+static uint8_t dma_heap_storage[CONFIG_MM_DMA_HEAP_SIZE] noinit_data
+    __attribute__((aligned(MM_MIN_CHUNK)));
+
+#define DMA_HEAP_START ((void *) dma_heap_storage)
+#else
+/* The board must keep this region out of the main heap */
+#define DMA_HEAP_START ((void *) CONFIG_MM_DMA_HEAP_BASE)
+#endif
+
+static struct mm_heap_s dma_heap;
+
+/**
+ * @brief Set up the DMA heap over its configured region.
+ *
+ * Called once at boot, with the other heaps.
+ */
+void dma_heap_initialize(void)
+{
+    mm_initialize(&dma_heap, DMA_HEAP_START, CONFIG_MM_DMA_HEAP_SIZE);
+}
+
+/**
+ * @brief Give more DMA-capable memory to the DMA heap.
+ *
+ * @param start Start of the region.
+ * @param size Size of the region in bytes.
+ */
+void dma_heap_addregion(void *start, size_t size)
+{
+    mm_addregion(&dma_heap, start, size);
+}
+
+/**
+ * @brief Allocate a DMA buffer.
+ *
+ * @param size Size of the buffer in bytes.
+ * @param align Alignment of the buffer in bytes, a power of two, as given
+ *              by dma_caps_alignment(). 0 if the controller has none.
+ * @return The buffer, or NULL if the DMA heap is exhausted.
+ */
+void *dma_alloc(size_t size, size_t align)
+{
+    /* Any chunk is aligned on SIZEOF_MM_ALLOCNODE */
+    if (align <= SIZEOF_MM_ALLOCNODE)
+        return mm_malloc(&dma_heap, size);
+
+    /*
+     * mm_memalign() hands the alignments of up to MM_MIN_CHUNK to
+     * mm_malloc(), which does not guarantee more than SIZEOF_MM_ALLOCNODE.
+     */
+    if (align <= MM_MIN_CHUNK)
+        align = MM_MIN_CHUNK << 1;
+
+    return mm_memalign(&dma_heap, align, size);
+}
+
+/**
+ * @brief Free a buffer allocated by dma_alloc().
+ *
+ * @param ptr The buffer, or NULL.
+ */
+void dma_free(void *ptr)
+{
+    if (ptr)
+        mm_free(&dma_heap, ptr);
+}
+
+/**
+ * @brief Get the usage of the DMA heap.
+ *
+ * @param info Filled with the usage of the DMA heap.
+ * @return 0 on success.
+ */
+int dma_heap_mallinfo(struct mallinfo *info)
+{
+    return mm_mallinfo(&dma_heap, info);
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/mm/mempool.h>
+
+#include <arch/irq.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* The pool allocated its storage and frees it when deinitialized */
+#define MEMPOOL_OWN_STORAGE 0x80000000u
+
+static bool mempool_in_storage(struct mempool *pool, void *block)
+{
+    uintptr_t start = (uintptr_t) pool->storage;
+    uintptr_t end = start + pool->block_size * pool->count;
+
+    return (uintptr_t) block >= start && (uintptr_t) block < end;
+}
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+/* Requires interrupts disabled */
+static void mempool_update_peak(struct mempool *pool)
+{
+    if (pool->size - pool->free > pool->peak)
+        pool->peak = pool->size - pool->free;
+}
+#endif
+
+int mempool_init(struct mempool *pool, void *storage, size_t block_size,
+                 unsigned int count, unsigned int flags)
+{
+    uint8_t *block;
+    unsigned int i;
+
+    if (!pool || !block_size)
+        return -EINVAL;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->block_size = MEMPOOL_BLOCK_SIZE(block_size);
+    pool->count = count;
+    pool->flags = flags & ~MEMPOOL_OWN_STORAGE;
+
+    if (!storage && count) {
+        storage = kmm_malloc(pool->block_size * count);
+        if (!storage)
+            return -ENOMEM;
+        pool->flags |= MEMPOOL_OWN_STORAGE;
+    }
+    pool->storage = storage;
+
+    /* Link the blocks in address order, the first one at the head */
+    block = storage;
+    for (i = count; i > 0; i--) {
+        *(void **) (block + (i - 1) * pool->block_size) = pool->free_list;
+        pool->free_list = block + (i - 1) * pool->block_size;
+    }
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+    pool->size = count;
+    pool->free = count;
+#endif
+
+    return 0;
+}
+
+/*
+ * The blocks still in use are not released: those taken from the heap are
+ * lost, and those of a storage given by the user remain the user's.
+ */
+void mempool_deinit(struct mempool *pool)
+{
+    void *block;
+    void *next;
+
+    if (!pool)
+        return;
+
+    for (block = pool->free_list; block; block = next) {
+        next = *(void **) block;
+        if (!mempool_in_storage(pool, block))
+            kmm_free(block);
+    }
+
+    if (pool->flags & MEMPOOL_OWN_STORAGE)
+        kmm_free(pool->storage);
+
+    memset(pool, 0, sizeof(*pool));
+}
+
+struct mempool *mempool_create(size_t block_size, unsigned int count,
+                               unsigned int flags)
+{
+    struct mempool *pool;
+
+    pool = kmm_malloc(sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    if (mempool_init(pool, NULL, block_size, count, flags)) {
+        kmm_free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void mempool_destroy(struct mempool *pool)
+{
+    if (!pool)
+        return;
+
+    mempool_deinit(pool);
+    kmm_free(pool);
+}
+
+void *mempool_alloc(struct mempool *pool)
+{
+    irqstate_t flags;
+    void *block;
+
+    DEBUGASSERT(pool);
+
+    flags = irqsave();
+    block = pool->free_list;
+    if (block) {
+        pool->free_list = *(void **) block;
+#ifdef CONFIG_MM_MEMPOOL_STATS
+        pool->free--;
+        pool->hits++;
+        mempool_update_peak(pool);
+#endif
+    }
+    irqrestore(flags);
+
+    if (!block && (pool->flags & MEMPOOL_GROW)) {
+        block = kmm_malloc(pool->block_size);
+#ifdef CONFIG_MM_MEMPOOL_STATS
+        if (block) {
+            flags = irqsave();
+            pool->size++;
+            pool->misses++;
+            mempool_update_peak(pool);
+            irqrestore(flags);
+        }
+#endif
+    }
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+    if (!block) {
+        flags = irqsave();
+        pool->failures++;
+        irqrestore(flags);
+    }
+#endif
+
+    return block;
+}
+
+void mempool_free(struct mempool *pool, void *block)
+{
+    irqstate_t flags;
+
+    DEBUGASSERT(pool);
+
+    if (!block)
+        return;
+
+    flags = irqsave();
+    *(void **) block = pool->free_list;
+    pool->free_list = block;
+#ifdef CONFIG_MM_MEMPOOL_STATS
+    pool->free++;
+#endif
+    irqrestore(flags);
+}
+
+#ifdef CONFIG_MM_MEMPOOL_STATS
+void mempool_get_stats(struct mempool *pool, struct mempool_stats *stats)
+{
+    irqstate_t flags;
+
+    DEBUGASSERT(pool && stats);
+
+    flags = irqsave();
+    stats->size = pool->size;
+    stats->free = pool->free;
+    stats->peak = pool->peak;
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+    stats->failures = pool->failures;
+    irqrestore(flags);
+}
+#endif
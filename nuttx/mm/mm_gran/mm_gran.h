@@ -95,6 +95,8 @@ struct gran_s
   sem_t      exclsem;   /* For exclusive access to the GAT */
 #endif
   uintptr_t  heapstart; /* The aligned start of the granule heap */
+  uint16_t   hint;      /* GAT entry where the next search starts */
+  uint8_t    nofit;     /* Granules found not to fit since the last free */
   uint32_t   gat[1];    /* Start of the granule allocation table */
 };
 
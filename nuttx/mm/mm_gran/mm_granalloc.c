@@ -55,12 +55,81 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: gran_gat_entry
+ *
+ * Description:
+ *   Return a GAT entry with the granules past the end of the heap, if any,
+ *   marked as allocated.  Entries past the end of the GAT are all allocated.
+ *
+ ****************************************************************************/
+
+static inline uint32_t gran_gat_entry(FAR struct gran_s *priv, int gatidx)
+{
+  unsigned int granidx = gatidx << 5;
+  uint32_t entry;
+
+  if (granidx >= priv->ngranules)
+    {
+      return 0xffffffff;
+    }
+
+  entry = priv->gat[gatidx];
+  if (priv->ngranules - granidx < 32)
+    {
+      entry |= 0xffffffff << (priv->ngranules - granidx);
+    }
+
+  return entry;
+}
+
+/****************************************************************************
+ * Name: gran_find_run
+ *
+ * Description:
+ *   Find the first run of 'ngranules' free granules starting within the
+ *   'curr' GAT entry, 'next' being the entry that follows it.  All the
+ *   candidate positions are tested at once: a bit of 'runs' remains set if
+ *   as many free granules start there as the bits merged into it so far,
+ *   and the number of merged bits doubles at each step.
+ *
+ * Returned Value:
+ *   The bit index of the run in 'curr', or -1 if there is none.
+ *
+ ****************************************************************************/
+
+static inline int gran_find_run(uint32_t curr, uint32_t next,
+                                unsigned int ngranules)
+{
+  uint64_t runs = ~(((uint64_t)next << 32) | curr);
+  unsigned int len = 1;
+  unsigned int step;
+
+  while (len < ngranules && (uint32_t)runs != 0)
+    {
+      step  = len < ngranules - len ? len : ngranules - len;
+      runs &= runs >> step;
+      len  += step;
+    }
+
+  if ((uint32_t)runs == 0)
+    {
+      return -1;
+    }
+
+  return __builtin_ctz((uint32_t)runs);
+}
+
 /****************************************************************************
  * Name: gran_common_alloc
  *
  * Description:
  *   Allocate memory from the granule heap.
  *
+ *   The search is next-fit: it starts at the GAT entry where the previous
+ *   allocation ended and wraps around.  A request at least as large as one
+ *   which found no room since the last release fails without searching.
+ *
  * Input Parameters:
  *   priv - The granule heap state structure.
  *   size - The size of the memory region to allocate.
@@ -73,181 +142,86 @@
 static inline FAR void *gran_common_alloc(FAR struct gran_s *priv, size_t size)
 {
   unsigned int ngranules;
+  unsigned int granno;
   size_t       tmpmask;
   uintptr_t    alloc;
   uint32_t     curr;
   uint32_t     next;
-  uint32_t     mask;
-  int          granidx;
+  int          ngat;
   int          gatidx;
   int          bitidx;
-  int          shift;
+  int          i;
 
   DEBUGASSERT(priv && size <= 32 * (1 << priv->log2gran));
 
   if (priv && size > 0)
     {
-      /* Get exclusive access to the GAT */
-
-      gran_enter_critical(priv);
-
       /* How many contiguous granules we we need to find? */
 
       tmpmask   = (1 << priv->log2gran) - 1;
       ngranules = (size + tmpmask) >> priv->log2gran;
-
-      /* Then create mask for that number of granules */
-
       DEBUGASSERT(ngranules <= 32);
-      mask = 0xffffffff >> (32 - ngranules);
 
-      /* Now search the granule allocation table for that number of contiguous */
+      /* Get exclusive access to the GAT */
 
-      alloc = priv->heapstart;
+      gran_enter_critical(priv);
 
-      for (granidx = 0; granidx < priv->ngranules; granidx += 32)
+      if (priv->nofit != 0 && ngranules >= priv->nofit)
         {
-          /* Get the GAT index associated with the granule table entry */
-
-          gatidx = granidx >> 5;
-          curr = priv->gat[gatidx];
-
-          /* Handle the case where there are no free granules in the entry */
+          gran_leave_critical(priv);
+          return NULL;
+        }
 
-          if (curr == 0xffffffff)
-            {
-              alloc += (32 << priv->log2gran);
-              continue;
-            }
+      /* Now search the granule allocation table for that number of
+       * contiguous free granules, one GAT entry at a time.
+       */
 
-          /* Get the next entry from the GAT to support a 64 bit shift */
+      ngat   = SIZEOF_GAT(priv->ngranules);
+      gatidx = priv->hint < ngat ? priv->hint : 0;
 
-          if (granidx < priv->ngranules)
-            {
-              next = priv->gat[gatidx + 1];
-            }
+      for (i = 0; i < ngat; i++)
+        {
+          curr = gran_gat_entry(priv, gatidx);
 
-          /* Use all ones when are at the last entry in the GAT (meaning
-           * nothing can be allocated.
-           */
+          /* Skip the entries with no free granule */
 
-          else
+          if (curr != 0xffffffff)
             {
-              next = 0xffffffff;
-            }
-
-          /* Search through the allocations in the 'curr' GAT entry
-           * to see if we can satisfy the allocation starting in that
-           * entry.
-           *
-           * This loop continues until either all of the bits have been
-           * examined (bitidx >= 32), or until there are insufficient
-           * granules left to satisfy the allocation.
-           */
-
-          for (bitidx = 0;
-               bitidx < 32 && (granidx + bitidx + ngranules) <= priv->ngranules;
-              )
-            {
-              /* Break out if there are no further free bits in 'curr'.
-               * All of the zero bits might have gotten shifted out.
-               */
-
-              if (curr == 0xffffffff)
-                {
-                  break;
-                }
-
-              /* Check for the first zero bit in the lower or upper 16-bits.
-               * From the test above, we know that at least one of the 32-
-               * bits in 'curr' is zero.
-               */
+              /* The next entry supports the runs that cross into it */
 
-              else if ((curr & 0x0000ffff) == 0x0000ffff)
+              next   = gran_gat_entry(priv, gatidx + 1);
+              bitidx = gran_find_run(curr, next, ngranules);
+              if (bitidx >= 0)
                 {
-                  /* Not in the lower 16 bits.  The first free bit must be
-                   * in the upper 16 bits.
-                   */
-
-                  shift = 16;
-                }
-
-              /* We know that the first free bit is now within the lower 16
-               * bits of 'curr'.  Is it in the upper or lower byte?
-               */
-
-              else if ((curr & 0x0000ff) == 0x000000ff)
-                {
-                  /* Not in the lower 8 bits.  The first free bit must be in
-                   * the upper 8 bits.
-                   */
-
-                  shift = 8;
-                }
-
-              /* We know that the first free bit is now within the lower 4
-               * bits of 'curr'.  Is it in the upper or lower nibble?
-               */
+                  /* Mark these granules allocated */
 
-              else if ((curr & 0x00000f) == 0x0000000f)
-                {
-                  /* Not in the lower 4 bits.  The first free bit must be in
-                   * the upper 4 bits.
-                   */
-
-                  shift = 4;
-                }
-
-              /* We know that the first free bit is now within the lower 4 bits
-               * of 'curr'.  Is it in the upper or lower pair?
-               */
-
-              else if ((curr & 0x000003) == 0x00000003)
-                {
-                  /* Not in the lower 2 bits.  The first free bit must be in
-                   * the upper 2 bits.
-                   */
+                  granno = (gatidx << 5) + bitidx;
+                  alloc  = priv->heapstart + (granno << priv->log2gran);
+                  gran_mark_allocated(priv, alloc, ngranules);
 
-                  shift = 2;
-                }
+                  /* The next search starts where this allocation ends */
 
-              /* We know that the first free bit is now within the lower 4 bits
-               * of 'curr'.  Check if we have the allocation at this bit position.
-               */
-
-              else if ((curr & mask) == 0)
-                {
-                  /* Yes.. mark these granules allocated */
-
-                  gran_mark_allocated(priv, alloc, ngranules);
+                  priv->hint = (granno + ngranules) >> 5;
 
                   /* And return the allocation address */
 
                   gran_leave_critical(priv);
                   return (FAR void *)alloc;
                 }
+            }
 
-              /* The free allocation does not start at this position */
-
-              else
-                {
-                  shift = 1;
-                }
-
-              /* Set up for the next time through the loop.  Perform a 64
-               * bit shift to move to the next gran position andi ncrement
-               * to the next candidate allocation address.
-               */
-
-              alloc  += (shift << priv->log2gran);
-              curr    = (curr >> shift) | (next << (32 - shift));
-              next  >>= shift;
-              bitidx += shift;
+          if (++gatidx >= ngat)
+            {
+              gatidx = 0;
             }
         }
+
+      /* Nothing this large fits until some granules are released */
+
+      priv->nofit = ngranules;
+      gran_leave_critical(priv);
     }
 
-  gran_leave_critical(priv);
   return NULL;
 }
 
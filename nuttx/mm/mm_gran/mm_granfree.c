@@ -133,6 +133,9 @@ static inline void gran_common_free(FAR struct gran_s *priv,
       priv->gat[gatidx] &= ~gatmask;
     }
 
+  /* Any size may fit again */
+
+  priv->nofit = 0;
   gran_leave_critical(priv);
 }
 
@@ -39,6 +39,8 @@
 
 #include <nuttx/config.h>
 
+#include <assert.h>
+
 #include <nuttx/mm/mm.h>
 
 /****************************************************************************
@@ -89,4 +91,85 @@ void mm_addfreechunk(FAR struct mm_heap_s *heap, FAR struct mm_freenode_s *node)
 
       next->blink = node;
     }
+
+  /* The list is not empty anymore */
+
+  heap->mm_flmap |= 1 << (ndx >> MM_SL_SHIFT);
+  heap->mm_slmap[ndx >> MM_SL_SHIFT] |= 1 << (ndx & (MM_NSL - 1));
+}
+
+/****************************************************************************
+ * Name: mm_delfreechunk
+ *
+ * Description:
+ *   Remove a free chunk from its nodelist.  The chunk size must not have
+ *   changed since it was added.
+ *
+ ****************************************************************************/
+
+void mm_delfreechunk(FAR struct mm_heap_s *heap, FAR struct mm_freenode_s *node)
+{
+  FAR struct mm_freenode_s *head;
+  int ndx = mm_size2ndx(node->size);
+
+  /* There must be a predecessor, but there may not be a successor node. */
+
+  DEBUGASSERT(node->blink);
+  node->blink->flink = node->flink;
+  if (node->flink)
+    {
+      node->flink->blink = node->blink;
+    }
+
+  /* The list is empty if the next list head, or nothing, follows its own */
+
+  head = heap->mm_nodelist[ndx].flink;
+  if (!head || !head->size)
+    {
+      heap->mm_slmap[ndx >> MM_SL_SHIFT] &= ~(1 << (ndx & (MM_NSL - 1)));
+      if (!heap->mm_slmap[ndx >> MM_SL_SHIFT])
+        {
+          heap->mm_flmap &= ~(1 << (ndx >> MM_SL_SHIFT));
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: mm_nextndx
+ *
+ * Description:
+ *   Return the index of the first non-empty nodelist at or above 'ndx', or
+ *   -1 if there is none.
+ *
+ ****************************************************************************/
+
+int mm_nextndx(FAR struct mm_heap_s *heap, int ndx)
+{
+  uint32_t map;
+  int fl;
+
+  if (ndx >= MM_NNODES)
+    {
+      return -1;
+    }
+
+  /* Look in the lists of the same power of two first */
+
+  fl  = ndx >> MM_SL_SHIFT;
+  map = heap->mm_slmap[fl] & (0xff << (ndx & (MM_NSL - 1)));
+  if (!map)
+    {
+      /* Then in the first larger power of two with a non-empty list */
+
+      map = heap->mm_flmap & ~((2 << fl) - 1);
+      if (!map)
+        {
+          return -1;
+        }
+
+      fl  = __builtin_ffs(map) - 1;
+      map = heap->mm_slmap[fl];
+    }
+
+  return (fl << MM_SL_SHIFT) + __builtin_ffs(map) - 1;
 }
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <nuttx/sched.h>
+#include <nuttx/mm/mm.h>
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_cache_band
+ *
+ * Description:
+ *   Return the caches of the priority band of the calling task.
+ *
+ ****************************************************************************/
+
+static FAR struct mm_cache_s *mm_cache_band(FAR struct mm_heap_s *heap)
+{
+  FAR struct tcb_s *tcb = sched_self();
+  int band;
+
+  band = tcb->sched_priority * CONFIG_MM_CACHE_BANDS /
+         (SCHED_PRIORITY_MAX + 1);
+
+  return &heap->mm_cache[band];
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_cache_initialize
+ *
+ * Description:
+ *   Empty the small chunk caches of a heap.
+ *
+ ****************************************************************************/
+
+void mm_cache_initialize(FAR struct mm_heap_s *heap)
+{
+  memset(heap->mm_cache, 0, sizeof(heap->mm_cache));
+}
+
+/****************************************************************************
+ * Name: mm_cache_alloc
+ *
+ * Description:
+ *   Take a chunk of exactly 'size' bytes, allocation overhead included,
+ *   from the caches of the calling task's band.  Returns NULL if there is
+ *   none.
+ *
+ ****************************************************************************/
+
+FAR void *mm_cache_alloc(FAR struct mm_heap_s *heap, size_t size)
+{
+  FAR struct mm_cache_s *cache;
+  FAR void *mem = NULL;
+  int class;
+
+  if (size > CONFIG_MM_CACHE_MAXSIZE)
+    {
+      return NULL;
+    }
+
+  class = (size >> MM_MIN_SHIFT) - 1;
+  cache = mm_cache_band(heap);
+
+  mm_takesemaphore(heap);
+  if (cache->mc_count[class] > 0)
+    {
+      mem = cache->mc_chunks[class][--cache->mc_count[class]];
+    }
+
+  mm_givesemaphore(heap);
+
+  return mem;
+}
+
+/****************************************************************************
+ * Name: mm_cache_free
+ *
+ * Description:
+ *   Keep a chunk being freed in the caches of the calling task's band.
+ *   Returns false if the chunk is too large or the cache is full, in which
+ *   case the chunk has to go back to the heap.
+ *
+ ****************************************************************************/
+
+bool mm_cache_free(FAR struct mm_heap_s *heap, FAR void *mem)
+{
+  FAR struct mm_allocnode_s *node;
+  FAR struct mm_cache_s *cache;
+  bool cached = false;
+  int class;
+
+  node = (FAR struct mm_allocnode_s *)((char *)mem - SIZEOF_MM_ALLOCNODE);
+  if (node->size > CONFIG_MM_CACHE_MAXSIZE)
+    {
+      return false;
+    }
+
+  class = (node->size >> MM_MIN_SHIFT) - 1;
+  cache = mm_cache_band(heap);
+
+  mm_takesemaphore(heap);
+  if (cache->mc_count[class] < CONFIG_MM_CACHE_DEPTH)
+    {
+      cache->mc_chunks[class][cache->mc_count[class]++] = mem;
+      cached = true;
+    }
+
+  mm_givesemaphore(heap);
+
+  return cached;
+}
+
+/****************************************************************************
+ * Name: mm_cache_flush
+ *
+ * Description:
+ *   Give all the cached chunks of all the bands back to the heap.  Returns
+ *   the number of chunks released.
+ *
+ ****************************************************************************/
+
+int mm_cache_flush(FAR struct mm_heap_s *heap)
+{
+  FAR struct mm_cache_s *cache;
+  int released = 0;
+  int band;
+  int class;
+
+  mm_takesemaphore(heap);
+
+  for (band = 0; band < CONFIG_MM_CACHE_BANDS; band++)
+    {
+      cache = &heap->mm_cache[band];
+      for (class = 0; class < MM_CACHE_NCLASSES; class++)
+        {
+          while (cache->mc_count[class] > 0)
+            {
+              mm_freechunk(heap,
+                           cache->mc_chunks[class][--cache->mc_count[class]]);
+              released++;
+            }
+        }
+    }
+
+  mm_givesemaphore(heap);
+
+  return released;
+}
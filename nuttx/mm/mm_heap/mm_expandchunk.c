@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+
+#include <nuttx/mm/mm.h>
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_expandchunk
+ *
+ * Description:
+ *   Grow the chunk specified by the node structure to the specified size
+ *   by taking the space from the free chunk that follows it.  The chunk
+ *   never moves.  This is the counterpart of mm_shrinkchunk, used by
+ *   realloc and by mm_tryexpand.
+ *
+ *   NOTES:
+ *     (1) size is the whole chunk size (payload and header)
+ *     (2) the caller must hold the MM semaphore.
+ *
+ * Returned Value:
+ *   true if the chunk was grown; false, with nothing changed, if the next
+ *   chunk is allocated or too small.
+ *
+ ****************************************************************************/
+
+bool mm_expandchunk(FAR struct mm_heap_s *heap,
+                    FAR struct mm_allocnode_s *node, size_t size)
+{
+  FAR struct mm_freenode_s *next;
+  FAR struct mm_allocnode_s *andbeyond;
+  size_t remaining;
+
+  /* Get a reference to the next node and check that it is free and large
+   * enough.
+   */
+
+  next = (FAR struct mm_freenode_s *)((FAR char *)node + node->size);
+  if ((next->preceding & MM_ALLOC_BIT) != 0 ||
+      node->size + next->size < size)
+    {
+      return false;
+    }
+
+  /* Get the chunk following the next node (which could be the tail chunk)
+   * and remove the next node from its free list.
+   */
+
+  andbeyond = (FAR struct mm_allocnode_s *)((FAR char *)next + next->size);
+  mm_delfreechunk(heap, next);
+
+  remaining = node->size + next->size - size;
+  if (remaining >= SIZEOF_MM_FREENODE)
+    {
+      FAR struct mm_freenode_s *newnode;
+
+      /* Return what we do not need from the next chunk to the free list */
+
+      newnode              = (FAR struct mm_freenode_s *)((FAR char *)node + size);
+      newnode->size        = remaining;
+      newnode->preceding   = size;
+      node->size           = size;
+      andbeyond->preceding = remaining | (andbeyond->preceding & MM_ALLOC_BIT);
+
+      mm_addfreechunk(heap, newnode);
+    }
+  else
+    {
+      /* The remainder is too small to be a chunk of its own: take it all */
+
+      node->size          += next->size;
+      andbeyond->preceding = node->size | (andbeyond->preceding & MM_ALLOC_BIT);
+    }
+
+  return true;
+}
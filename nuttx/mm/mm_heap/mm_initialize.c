@@ -198,12 +198,27 @@ void mm_initialize(FAR struct mm_heap_s *heap, FAR void *heapstart,
       heap->mm_nodelist[i].blink   = &heap->mm_nodelist[i-1];
     }
 
+  heap->mm_flmap = 0;
+  memset(heap->mm_slmap, 0, sizeof(heap->mm_slmap));
+
   /* Initialize the malloc semaphore to one (to support one-at-
    * a-time access to private data sets).
    */
 
   mm_seminitialize(heap);
 
+#ifdef CONFIG_MM_CACHE
+  /* No chunk is cached yet */
+
+  mm_cache_initialize(heap);
+#endif
+
+#ifdef CONFIG_MM_PROFILE
+  /* Nothing is allocated yet */
+
+  mm_profile_initialize(heap);
+#endif
+
   /* Add the initial region of memory to the heap */
 
   mm_addregion(heap, heapstart, heapsize);
@@ -96,43 +96,63 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
       return NULL;
     }
 
-  /* Adjust the size to account for (1) the size of the allocated node and
-   * (2) to make sure that it is an even multiple of our granule size.
+  /* Adjust the size to account for (1) the size of the allocated node,
+   * (2) the caller tag of the heap profiling, if any, and (3) to make sure
+   * that it is an even multiple of our granule size.
    */
 
-  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE);
+  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE + MM_TAGSIZE);
+
+#ifdef CONFIG_MM_CACHE
+  /* Small chunks freed recently may be reused straight away */
+
+  ret = mm_cache_alloc(heap, size);
+  if (ret)
+    {
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, (FAR struct mm_allocnode_s *)
+                       ((FAR char *)ret - SIZEOF_MM_ALLOCNODE),
+                       __builtin_return_address(0));
+#endif
+      return ret;
+    }
+#endif
 
   /* We need to hold the MM semaphore while we muck with the nodelist. */
 
   mm_takesemaphore(heap);
 
-  /* Get the location in the node list to start the search. Special case
-   * really big allocations
+  /* Get the nodelist of the requested size.  Its chunks are sorted by
+   * size, so if its first one is not large enough, look for the first
+   * non-empty list of larger chunks: any of their chunks will do.  Only
+   * if there is none, fall back to searching the list itself.
    */
 
-  if (size >= MM_MAX_CHUNK)
-    {
-      ndx = MM_NNODES-1;
-    }
-  else
+  ndx  = mm_size2ndx(size);
+  node = heap->mm_nodelist[ndx].flink;
+  if (!node || node->size < size)
     {
-      /* Convert the request size into a nodelist index */
+      int bigger = mm_nextndx(heap, ndx + 1);
 
-      ndx = mm_size2ndx(size);
+      if (bigger >= 0)
+        {
+          node = heap->mm_nodelist[bigger].flink;
+        }
+      else
+        {
+          for (node = heap->mm_nodelist[ndx].flink;
+               node && node->size && node->size < size;
+               node = node->flink);
+
+          if (node && !node->size)
+            {
+              node = NULL;
+            }
+        }
     }
 
-  /* Search for a large enough chunk in the list of nodes. This list is
-   * ordered by size, but will have occasional zero sized nodes as we visit
-   * other mm_nodelist[] entries.
-   */
-
-  for (node = heap->mm_nodelist[ndx].flink;
-       node && node->size < size;
-       node = node->flink);
-
-  /* If we found a node with non-zero size, then this is one to use. Since
-   * the list is ordered, we know that is must be best fitting chunk
-   * available.
+  /* If we found a node with non-zero size, then this is one to use. It is
+   * the smallest chunk of the smallest non-empty list that fits.
    */
 
   if (node)
@@ -141,16 +161,9 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
       FAR struct mm_freenode_s *next;
       size_t remaining;
 
-      /* Remove the node.  There must be a predecessor, but there may not be
-       * a successor node.
-       */
+      /* Remove the node from its free list */
 
-      DEBUGASSERT(node->blink);
-      node->blink->flink = node->flink;
-      if (node->flink)
-        {
-          node->flink->blink = node->blink;
-        }
+      mm_delfreechunk(heap, node);
 
       /* Check if we have to split the free node into one of the allocated
        * size and another smaller freenode.  In some cases, the remaining
@@ -191,10 +204,30 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
 
       node->preceding |= MM_ALLOC_BIT;
       ret = (void*)((char*)node + SIZEOF_MM_ALLOCNODE);
+
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, (FAR struct mm_allocnode_s *)node,
+                       __builtin_return_address(0));
+#endif
     }
 
   mm_givesemaphore(heap);
 
+#ifdef CONFIG_MM_CACHE
+  /* The cached chunks may be what the heap is missing to satisfy the
+   * request: give them back and try again.
+   */
+
+  if (!ret && mm_cache_flush(heap) > 0)
+    {
+      ret = mm_malloc(heap, size - SIZEOF_MM_ALLOCNODE - MM_TAGSIZE);
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_setcaller(heap, ret, __builtin_return_address(0));
+#endif
+      return ret;
+    }
+#endif
+
   /* If CONFIG_DEBUG_MM is defined, then output the result of the allocation
    * to the SYSLOG.
    */
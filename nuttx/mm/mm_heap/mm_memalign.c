@@ -121,6 +121,14 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
 
   node = (FAR struct mm_allocnode_s*)(rawchunk - SIZEOF_MM_ALLOCNODE);
 
+#ifdef CONFIG_MM_PROFILE
+  /* The raw chunk is about to be reshaped: account the aligned chunk
+   * instead once done.
+   */
+
+  mm_profile_free(heap, node);
+#endif
+
   /* Find the aligned subregion */
 
   alignedchunk = (rawchunk + mask) & ~mask;
@@ -206,9 +214,14 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
        * malloc-compatible sizes that we have.
        */
 
-      mm_shrinkchunk(heap, node, size + SIZEOF_MM_ALLOCNODE);
+      mm_shrinkchunk(heap, node,
+                     MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE + MM_TAGSIZE));
     }
 
+#ifdef CONFIG_MM_PROFILE
+  mm_profile_alloc(heap, node, __builtin_return_address(0));
+#endif
+
   mm_givesemaphore(heap);
   return (FAR void*)alignedchunk;
 }
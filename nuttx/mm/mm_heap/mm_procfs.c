@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/mm/mm.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define HEAP_PROCFS_LINELEN 80
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The profile is taken when the file is opened, so that it does not change
+ * between the reads of a same report.
+ */
+
+struct heap_procfs_file_s
+{
+  struct procfs_file_s base;
+  struct mallinfo info;
+  struct mm_profile_s prof;
+  char line[HEAP_PROCFS_LINELEN];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: heap_procfs_copy
+ *
+ * Description:
+ *   Copy the part of a line of the report which lies past the file offset.
+ *   Returns false once the user buffer is full.
+ *
+ ****************************************************************************/
+
+static bool heap_procfs_copy(FAR char *line, size_t linesize,
+                             FAR char **buffer, FAR size_t *remaining,
+                             FAR off_t *offset, FAR size_t *total)
+{
+  size_t copysize;
+
+  if (linesize >= HEAP_PROCFS_LINELEN)
+    {
+      linesize = HEAP_PROCFS_LINELEN - 1;
+    }
+
+  copysize    = procfs_memcpy(line, linesize, *buffer, *remaining, offset);
+  *buffer    += copysize;
+  *remaining -= copysize;
+  *total     += copysize;
+
+  return *remaining > 0;
+}
+
+/****************************************************************************
+ * Name: heap_procfs_open
+ *
+ * Description:
+ *   Take a snapshot of the heap profile for the report.
+ *
+ ****************************************************************************/
+
+static int heap_procfs_open(FAR struct file *filep, FAR const char *relpath,
+                            int oflags, mode_t mode)
+{
+  FAR struct heap_procfs_file_s *priv;
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      return -EACCES;
+    }
+
+  if (strcmp(relpath, "heap") != 0)
+    {
+      return -ENOENT;
+    }
+
+  priv = kmm_zalloc(sizeof(*priv));
+  if (!priv)
+    {
+      return -ENOMEM;
+    }
+
+  umm_profile(&priv->prof);
+#ifdef CONFIG_CAN_PASS_STRUCTS
+  priv->info = mallinfo();
+#else
+  (void)mallinfo(&priv->info);
+#endif
+
+  filep->f_priv = priv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: heap_procfs_close
+ *
+ * Description:
+ *   Release the snapshot.
+ *
+ ****************************************************************************/
+
+static int heap_procfs_close(FAR struct file *filep)
+{
+  DEBUGASSERT(filep->f_priv);
+
+  kmm_free(filep->f_priv);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: heap_procfs_read
+ *
+ * Description:
+ *   Format the report: usage, fragmentation, allocations per chunk
+ *   size and live bytes per caller.
+ *
+ ****************************************************************************/
+
+static ssize_t heap_procfs_read(FAR struct file *filep, FAR char *buffer,
+                                size_t buflen)
+{
+  FAR struct heap_procfs_file_s *priv = filep->f_priv;
+  FAR struct mm_profile_s *prof;
+  FAR struct mallinfo *info;
+  off_t offset = filep->f_pos;
+  size_t remaining = buflen;
+  size_t total = 0;
+  size_t linesize;
+  int frag = 0;
+  int i;
+
+  DEBUGASSERT(priv);
+
+  prof = &priv->prof;
+  info = &priv->info;
+
+  /* The fragmentation is the part of the free memory which cannot be
+   * allocated at once.
+   */
+
+  if (info->fordblks > 0)
+    {
+      frag = 100 - (info->mxordblk * 100) / info->fordblks;
+    }
+
+  linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                      "used: %u bytes, peak: %u bytes at %u ticks\n",
+                      prof->mp_inuse, prof->mp_peak, prof->mp_peaktime);
+  if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                        &offset, &total))
+    {
+      goto out;
+    }
+
+  linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                      "free: %u bytes, largest: %u bytes, "
+                      "fragmentation: %d%%\n",
+                      info->fordblks, info->mxordblk, frag);
+  if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                        &offset, &total))
+    {
+      goto out;
+    }
+
+  linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                      "CHUNK        ALLOCS    LIVE\n");
+  if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                        &offset, &total))
+    {
+      goto out;
+    }
+
+  for (i = 0; i < MM_NFL; i++)
+    {
+      if (prof->mp_allocs[i] == 0)
+        {
+          continue;
+        }
+
+      linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                          ">=%-8u %8u %7u\n", 1 << (i + MM_MIN_SHIFT),
+                          prof->mp_allocs[i], prof->mp_live[i]);
+      if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+        {
+          goto out;
+        }
+    }
+
+  linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                      "CALLER        BYTES  CHUNKS\n");
+  if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                        &offset, &total))
+    {
+      goto out;
+    }
+
+  for (i = 0; i < CONFIG_MM_PROFILE_NCALLERS; i++)
+    {
+      if (prof->mp_callers[i].mc_nchunks == 0)
+        {
+          continue;
+        }
+
+      linesize = snprintf(priv->line, HEAP_PROCFS_LINELEN,
+                          "%p %9u %7u\n", prof->mp_callers[i].mc_caller,
+                          prof->mp_callers[i].mc_inuse,
+                          prof->mp_callers[i].mc_nchunks);
+      if (!heap_procfs_copy(priv->line, linesize, &buffer, &remaining,
+                            &offset, &total))
+        {
+          goto out;
+        }
+    }
+
+out:
+  filep->f_pos += total;
+  return total;
+}
+
+/****************************************************************************
+ * Name: heap_procfs_dup
+ *
+ * Description:
+ *   Duplicate the open file, snapshot included.
+ *
+ ****************************************************************************/
+
+static int heap_procfs_dup(FAR const struct file *oldp,
+                           FAR struct file *newp)
+{
+  FAR struct heap_procfs_file_s *newpriv;
+
+  DEBUGASSERT(oldp->f_priv);
+
+  newpriv = kmm_zalloc(sizeof(*newpriv));
+  if (!newpriv)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(newpriv, oldp->f_priv, sizeof(*newpriv));
+  newp->f_priv = newpriv;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: heap_procfs_stat
+ *
+ * Description:
+ *   Return the status of the heap entry.
+ *
+ ****************************************************************************/
+
+static int heap_procfs_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  if (strcmp(relpath, "heap") != 0)
+    {
+      return -ENOENT;
+    }
+
+  memset(buf, 0, sizeof(*buf));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+const struct procfs_operations heap_procfsoperations =
+{
+  .open  = heap_procfs_open,
+  .close = heap_procfs_close,
+  .read  = heap_procfs_read,
+  .dup   = heap_procfs_dup,
+  .stat  = heap_procfs_stat,
+};
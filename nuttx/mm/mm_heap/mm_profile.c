@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/mm/mm.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The last caller entry accounts for all the callers past the others */
+
+#define MM_PROFILE_OTHERS (CONFIG_MM_PROFILE_NCALLERS - 1)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_profile_tag
+ *
+ * Description:
+ *   Return the location of the caller tag of an allocated chunk: its last
+ *   word, which mm_malloc() reserved room for.
+ *
+ ****************************************************************************/
+
+static inline FAR uint32_t *mm_profile_tag(FAR struct mm_allocnode_s *node)
+{
+  return (FAR uint32_t *)((FAR char *)node + node->size - MM_TAGSIZE);
+}
+
+/****************************************************************************
+ * Name: mm_profile_slot
+ *
+ * Description:
+ *   Return the index of the caller entry of 'caller', claiming an unused
+ *   one if it has none.  Entries are only reused once they hold no chunk,
+ *   so that the chunks tagged with an entry always belong to its caller.
+ *
+ ****************************************************************************/
+
+static uint32_t mm_profile_slot(FAR struct mm_profile_s *prof,
+                                FAR void *caller)
+{
+  int unused = -1;
+  int i;
+
+  for (i = 0; i < MM_PROFILE_OTHERS; i++)
+    {
+      if (prof->mp_callers[i].mc_caller == caller)
+        {
+          return i;
+        }
+
+      if (unused < 0 && prof->mp_callers[i].mc_nchunks == 0)
+        {
+          unused = i;
+        }
+    }
+
+  if (unused < 0)
+    {
+      return MM_PROFILE_OTHERS;
+    }
+
+  prof->mp_callers[unused].mc_caller = caller;
+  return unused;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_profile_initialize
+ *
+ * Description:
+ *   Clear the profile of a heap.
+ *
+ ****************************************************************************/
+
+void mm_profile_initialize(FAR struct mm_heap_s *heap)
+{
+  memset(&heap->mm_profile, 0, sizeof(heap->mm_profile));
+}
+
+/****************************************************************************
+ * Name: mm_profile_alloc
+ *
+ * Description:
+ *   Account a chunk just allocated to 'caller', and tag it with its entry.
+ *
+ ****************************************************************************/
+
+void mm_profile_alloc(FAR struct mm_heap_s *heap,
+                      FAR struct mm_allocnode_s *node, FAR void *caller)
+{
+  FAR struct mm_profile_s *prof = &heap->mm_profile;
+  FAR struct mm_caller_s *entry;
+  uint32_t slot;
+  int fl;
+
+  mm_takesemaphore(heap);
+
+  slot  = mm_profile_slot(prof, caller);
+  entry = &prof->mp_callers[slot];
+  entry->mc_inuse += node->size;
+  entry->mc_nchunks++;
+  *mm_profile_tag(node) = slot;
+
+  fl = mm_size2ndx(node->size) >> MM_SL_SHIFT;
+  prof->mp_allocs[fl]++;
+  prof->mp_live[fl]++;
+
+  prof->mp_inuse += node->size;
+  if (prof->mp_inuse > prof->mp_peak)
+    {
+      prof->mp_peak     = prof->mp_inuse;
+      prof->mp_peaktime = clock_systimer();
+    }
+
+  mm_givesemaphore(heap);
+}
+
+/****************************************************************************
+ * Name: mm_profile_free
+ *
+ * Description:
+ *   Remove a chunk about to be freed, or reshaped, from the profile.
+ *
+ ****************************************************************************/
+
+void mm_profile_free(FAR struct mm_heap_s *heap,
+                     FAR struct mm_allocnode_s *node)
+{
+  FAR struct mm_profile_s *prof = &heap->mm_profile;
+  FAR struct mm_caller_s *entry;
+  uint32_t slot;
+
+  mm_takesemaphore(heap);
+
+  slot = *mm_profile_tag(node);
+  if (slot >= CONFIG_MM_PROFILE_NCALLERS)
+    {
+      /* Overwritten by its user: there is no way to tell whose it was */
+
+      slot = MM_PROFILE_OTHERS;
+    }
+
+  entry = &prof->mp_callers[slot];
+  if (entry->mc_nchunks > 0 && entry->mc_inuse >= node->size)
+    {
+      entry->mc_inuse -= node->size;
+      entry->mc_nchunks--;
+    }
+
+  prof->mp_live[mm_size2ndx(node->size) >> MM_SL_SHIFT]--;
+  prof->mp_inuse -= node->size;
+
+  mm_givesemaphore(heap);
+}
+
+/****************************************************************************
+ * Name: mm_profile_caller
+ *
+ * Description:
+ *   Return the caller an allocated chunk is accounted to.
+ *
+ ****************************************************************************/
+
+FAR void *mm_profile_caller(FAR struct mm_heap_s *heap,
+                            FAR struct mm_allocnode_s *node)
+{
+  uint32_t slot = *mm_profile_tag(node);
+
+  if (slot >= CONFIG_MM_PROFILE_NCALLERS)
+    {
+      return NULL;
+    }
+
+  return heap->mm_profile.mp_callers[slot].mc_caller;
+}
+
+/****************************************************************************
+ * Name: mm_profile_setcaller
+ *
+ * Description:
+ *   Account an allocated chunk to another caller.  The allocation wrappers
+ *   use it to account the chunk to their own caller rather than to them.
+ *
+ ****************************************************************************/
+
+void mm_profile_setcaller(FAR struct mm_heap_s *heap, FAR void *mem,
+                          FAR void *caller)
+{
+  FAR struct mm_allocnode_s *node;
+  FAR struct mm_profile_s *prof = &heap->mm_profile;
+  FAR struct mm_caller_s *entry;
+  uint32_t slot;
+
+  if (!mem)
+    {
+      return;
+    }
+
+  node = (FAR struct mm_allocnode_s *)((FAR char *)mem - SIZEOF_MM_ALLOCNODE);
+
+  mm_takesemaphore(heap);
+
+  slot = *mm_profile_tag(node);
+  if (slot < CONFIG_MM_PROFILE_NCALLERS &&
+      prof->mp_callers[slot].mc_caller != caller)
+    {
+      entry = &prof->mp_callers[slot];
+      if (entry->mc_nchunks > 0 && entry->mc_inuse >= node->size)
+        {
+          entry->mc_inuse -= node->size;
+          entry->mc_nchunks--;
+        }
+
+      slot  = mm_profile_slot(prof, caller);
+      entry = &prof->mp_callers[slot];
+      entry->mc_inuse += node->size;
+      entry->mc_nchunks++;
+      *mm_profile_tag(node) = slot;
+    }
+
+  mm_givesemaphore(heap);
+}
+
+/****************************************************************************
+ * Name: mm_profile
+ *
+ * Description:
+ *   Return a snapshot of the profile of a heap.
+ *
+ ****************************************************************************/
+
+void mm_profile(FAR struct mm_heap_s *heap, FAR struct mm_profile_s *info)
+{
+  mm_takesemaphore(heap);
+  memcpy(info, &heap->mm_profile, sizeof(*info));
+  mm_givesemaphore(heap);
+}
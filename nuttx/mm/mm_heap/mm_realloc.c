@@ -71,9 +71,13 @@
  *  If the request is for more space and the current allocation can be
  *  extended, it will be extended by:
  *
- *     (1) Taking the additional space from the following free chunk, or
- *     (2) Taking the additional space from the preceding free chunk.
- *     (3) Or both
+ *     (1) Taking the additional space from the following free chunk, in
+ *         place, or
+ *     (2) Taking all of the following free chunk, if any, and the rest
+ *         from the preceding free chunk, moving the data down.
+ *
+ *  With CONFIG_MM_REALLOC_HEADROOM, (1) takes up to half the old size
+ *  more than requested when the following free chunk has it.
  *
  *  If the request is for more space but the current chunk cannot be
  *  extended, then malloc a new buffer, copy the data into the new buffer,
@@ -91,6 +95,12 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
   size_t prevsize = 0;
   size_t nextsize = 0;
   FAR void *newmem;
+#ifdef CONFIG_MM_REALLOC_HEADROOM
+  size_t headroom;
+#endif
+#ifdef CONFIG_MM_PROFILE
+  FAR void *caller;
+#endif
 
   /* If oldmem is NULL, then realloc is equivalent to malloc */
 
@@ -107,11 +117,12 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       return NULL;
     }
 
-  /* Adjust the size to account for (1) the size of the allocated node and
-   * (2) to make sure that it is an even multiple of our granule size.
+  /* Adjust the size to account for (1) the size of the allocated node,
+   * (2) the caller tag of the heap profiling, if any, and (3) to make sure
+   * that it is an even multiple of our granule size.
    */
 
-  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE);
+  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE + MM_TAGSIZE);
 
   /* Map the memory chunk into an allocated node structure */
 
@@ -121,6 +132,12 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
   mm_takesemaphore(heap);
 
+#ifdef CONFIG_MM_PROFILE
+  /* The chunk remains accounted to whoever allocated it first */
+
+  caller = mm_profile_caller(heap, oldnode);
+#endif
+
   /* Check if this is a request to reduce the size of the allocation. */
 
   oldsize = oldnode->size;
@@ -132,7 +149,13 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
       if (size < oldsize)
         {
+#ifdef CONFIG_MM_PROFILE
+          mm_profile_free(heap, oldnode);
+#endif
           mm_shrinkchunk(heap, oldnode, size);
+#ifdef CONFIG_MM_PROFILE
+          mm_profile_alloc(heap, oldnode, caller);
+#endif
         }
 
       /* Then return the original address */
@@ -141,9 +164,44 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       return oldmem;
     }
 
-  /* This is a request to increase the size of the allocation,  Get the
-   * available sizes before and after the oldnode so that we can make the
-   * best decision
+  /* This is a request to increase the size of the allocation.  The free
+   * chunk that follows it is the first choice: if it is large enough, the
+   * chunk grows in place and nothing needs to be copied.
+   */
+
+#ifdef CONFIG_MM_PROFILE
+  mm_profile_free(heap, oldnode);
+#endif
+
+  newmem = NULL;
+
+#ifdef CONFIG_MM_REALLOC_HEADROOM
+  /* Take some headroom for the next growth, if the next chunk has it */
+
+  headroom = MM_ALIGN_UP(oldsize + (oldsize >> 1));
+  if (headroom > size && mm_expandchunk(heap, oldnode, headroom))
+    {
+      newmem = oldmem;
+    }
+#endif
+
+  if (newmem == NULL && mm_expandchunk(heap, oldnode, size))
+    {
+      newmem = oldmem;
+    }
+
+  if (newmem != NULL)
+    {
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, oldnode, caller);
+#endif
+      mm_givesemaphore(heap);
+      return newmem;
+    }
+
+  /* Otherwise get the available sizes before and after the oldnode.  The
+   * chunk can still be extended if all of the next chunk, if free, plus
+   * the end of the previous chunk are enough.
    */
 
   next = (FAR struct mm_freenode_s *)((FAR char*)oldnode + oldnode->size);
@@ -158,204 +216,90 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       prevsize = prev->size;
     }
 
-  /* Now, check if we can extend the current allocation or not */
-
-  if (nextsize + prevsize + oldsize >= size)
+  if (prevsize > 0 && nextsize + prevsize + oldsize >= size)
     {
-      size_t needed   = size - oldsize;
-      size_t takeprev = 0;
-      size_t takenext = 0;
+      FAR struct mm_allocnode_s *newnode;
+      size_t takeprev = size - oldsize - nextsize;
 
-      /* Check if we can extend into the previous chunk and if the
-       * previous chunk is smaller than the next chunk.
-       */
+      /* Remove the previous node from its free list */
 
-      if (prevsize > 0 && (nextsize >= prevsize || nextsize <= 0))
-        {
-          /* Can we get everything we need from the previous chunk? */
-
-          if (needed > prevsize)
-            {
-              /* No, take the whole previous chunk and get the
-               * rest that we need from the next chunk.
-               */
-
-              takeprev = prevsize;
-              takenext = needed - prevsize;
-            }
-          else
-            {
-              /* Yes, take what we need from the previous chunk */
-
-              takeprev = needed;
-              takenext = 0;
-            }
-
-          needed = 0;
-        }
+      mm_delfreechunk(heap, prev);
 
-      /* Check if we can extend into the next chunk and if we still need
-       * more memory.
-       */
+      /* Extend the node into the previous free chunk */
 
-      if (nextsize > 0 && needed)
-        {
-          /* Can we get everything we need from the next chunk? */
-
-          if (needed > nextsize)
-            {
-              /* No, take the whole next chunk and get the rest that we
-               * need from the previous chunk.
-               */
-
-              takeprev = needed - nextsize;
-              takenext = nextsize;
-            }
-          else
-            {
-              /* Yes, take what we need from the previous chunk */
-
-              takeprev = 0;
-              takenext = needed;
-            }
-        }
+      newnode = (FAR struct mm_allocnode_s *)((FAR char*)oldnode - takeprev);
 
-      /* Extend into the previous free chunk */
+      /* Did we consume the entire preceding chunk? */
 
-      newmem = oldmem;
-      if (takeprev)
+      if (takeprev < prevsize)
         {
-          FAR struct mm_allocnode_s *newnode;
-
-          /* Remove the previous node.  There must be a predecessor, but
-           * there may not be a successor node.
+          /* No.. just take what we need from the previous chunk and put
+           * it back into the free list
            */
 
-          DEBUGASSERT(prev->blink);
-          prev->blink->flink = prev->flink;
-          if (prev->flink)
-            {
-              prev->flink->blink = prev->blink;
-            }
-
-          /* Extend the node into the previous free chunk */
-
-          newnode = (FAR struct mm_allocnode_s *)((FAR char*)oldnode - takeprev);
-
-          /* Did we consume the entire preceding chunk? */
-
-          if (takeprev < prevsize)
-            {
-              /* No.. just take what we need from the previous chunk and put
-               * it back into the free list
-               */
-
-              prev->size        -= takeprev;
-              newnode->size      = oldsize + takeprev;
-              newnode->preceding = prev->size | MM_ALLOC_BIT;
-              next->preceding    = newnode->size | (next->preceding & MM_ALLOC_BIT);
+          prev->size        -= takeprev;
+          newnode->size      = oldsize + takeprev;
+          newnode->preceding = prev->size | MM_ALLOC_BIT;
+          next->preceding    = newnode->size | (next->preceding & MM_ALLOC_BIT);
 
-              /* Return the previous free node to the nodelist (with the new size) */
+          /* Return the previous free node to the nodelist (with the new size) */
 
-              mm_addfreechunk(heap, prev);
-
-             /* Now we want to return newnode */
-
-              oldnode = newnode;
-            }
-          else
-            {
-              /* Yes.. update its size (newnode->preceding is already set) */
-
-              newnode->size      += oldsize;
-              newnode->preceding |= MM_ALLOC_BIT;
-              next->preceding     = newnode->size | (next->preceding & MM_ALLOC_BIT);
-            }
-
-          oldnode = newnode;
-          oldsize = newnode->size;
-
-          /* Now we have to move the user contents 'down' in memory.  memcpy should
-           * should be save for this.
-           */
-
-          newmem = (FAR void*)((FAR char*)newnode + SIZEOF_MM_ALLOCNODE);
-          memcpy(newmem, oldmem, oldsize - SIZEOF_MM_ALLOCNODE);
+          mm_addfreechunk(heap, prev);
         }
-
-      /* Extend into the next free chunk */
-
-      if (takenext)
+      else
         {
-          FAR struct mm_freenode_s *newnode;
-          FAR struct mm_allocnode_s *andbeyond;
-
-          /* Get the chunk following the next node (which could be the tail
-           * chunk)
-           */
-
-          andbeyond = (FAR struct mm_allocnode_s*)((char*)next + nextsize);
-
-          /* Remove the next node.  There must be a predecessor, but there
-           * may not be a successor node.
-           */
-
-          DEBUGASSERT(next->blink);
-          next->blink->flink = next->flink;
-          if (next->flink)
-            {
-              next->flink->blink = next->blink;
-            }
-
-          /* Extend the node into the next chunk */
-
-          oldnode->size = oldsize + takenext;
-          newnode       = (FAR struct mm_freenode_s *)((char*)oldnode + oldnode->size);
+          /* Yes.. update its size (newnode->preceding is already set) */
 
-          /* Did we consume the entire preceding chunk? */
-
-          if (takenext < nextsize)
-            {
-              /* No, take what we need from the next chunk and return it to
-               * the free nodelist.
-               */
+          newnode->size      += oldsize;
+          newnode->preceding |= MM_ALLOC_BIT;
+          next->preceding     = newnode->size | (next->preceding & MM_ALLOC_BIT);
+        }
 
-              newnode->size        = nextsize - takenext;
-              newnode->preceding   = oldnode->size;
-              andbeyond->preceding = newnode->size | (andbeyond->preceding & MM_ALLOC_BIT);
+      /* Now we have to move the user contents 'down' in memory.  The old
+       * and new locations may overlap.
+       */
 
-              /* Add the new free node to the nodelist (with the new size) */
+      newmem = (FAR void*)((FAR char*)newnode + SIZEOF_MM_ALLOCNODE);
+      memmove(newmem, oldmem, oldsize - SIZEOF_MM_ALLOCNODE - MM_TAGSIZE);
 
-              mm_addfreechunk(heap, newnode);
-            }
-          else
-            {
-              /* Yes, just update some pointers. */
+      /* And take all of the next free chunk, if any */
 
-              andbeyond->preceding = oldnode->size | (andbeyond->preceding & MM_ALLOC_BIT);
-            }
+      if (nextsize > 0)
+        {
+          (void)mm_expandchunk(heap, newnode, newnode->size + nextsize);
         }
 
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, newnode, caller);
+#endif
+
       mm_givesemaphore(heap);
       return newmem;
     }
 
-  /* The current chunk cannot be extended.  Just allocate a new chunk and copy */
+  /* The current chunk cannot be extended.  Just allocate a new chunk and
+   * copy.
+   */
 
-  else
-    {
-      /* Allocate a new block.  On failure, realloc must return NULL but
-       * leave the original memory in place.
-       */
+#ifdef CONFIG_MM_PROFILE
+  mm_profile_alloc(heap, oldnode, caller);
+#endif
 
-      mm_givesemaphore(heap);
-      newmem = (FAR void*)mm_malloc(heap, size);
-      if (newmem)
-        {
-          memcpy(newmem, oldmem, oldsize);
-          mm_free(heap, oldmem);
-        }
+  mm_givesemaphore(heap);
 
-      return newmem;
+  /* Allocate a new block.  On failure, realloc must return NULL but leave
+   * the original memory in place.
+   */
+
+  newmem = (FAR void*)mm_malloc(heap, size - SIZEOF_MM_ALLOCNODE - MM_TAGSIZE);
+  if (newmem)
+    {
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_setcaller(heap, newmem, caller);
+#endif
+      memcpy(newmem, oldmem, oldsize - SIZEOF_MM_ALLOCNODE - MM_TAGSIZE);
+      mm_free(heap, oldmem);
     }
+
+  return newmem;
 }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+
+#include <nuttx/mm/mm.h>
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_tryexpand
+ *
+ * Description:
+ *   Grow the allocation at 'mem' so that it holds at least 'size' bytes,
+ *   but only if that can be done in place, from the free chunk that
+ *   follows it.  Unlike realloc, the memory never moves and nothing is
+ *   copied, so the caller may keep using pointers into the buffer.
+ *
+ * Returned Value:
+ *   OK if the allocation now holds at least 'size' bytes; -ENOMEM, with
+ *   the allocation unchanged, if it cannot grow in place.
+ *
+ ****************************************************************************/
+
+int mm_tryexpand(FAR struct mm_heap_s *heap, FAR void *mem, size_t size)
+{
+  FAR struct mm_allocnode_s *node;
+  int ret = OK;
+#ifdef CONFIG_MM_PROFILE
+  FAR void *caller;
+#endif
+
+  if (mem == NULL)
+    {
+      return -EINVAL;
+    }
+
+  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE + MM_TAGSIZE);
+  node = (FAR struct mm_allocnode_s *)((FAR char *)mem - SIZEOF_MM_ALLOCNODE);
+
+  mm_takesemaphore(heap);
+  if (size > node->size)
+    {
+#ifdef CONFIG_MM_PROFILE
+      caller = mm_profile_caller(heap, node);
+      mm_profile_free(heap, node);
+#endif
+      if (!mm_expandchunk(heap, node, size))
+        {
+          ret = -ENOMEM;
+        }
+
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, node, caller);
+#endif
+    }
+
+  mm_givesemaphore(heap);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: mm_shrinktofit
+ *
+ * Description:
+ *   Give back the end of the allocation at 'mem' that lies beyond its
+ *   first 'size' bytes.  The memory never moves.  This is meant for
+ *   buffers that were allocated, or grown, for a worst case and whose
+ *   final size is now known.
+ *
+ ****************************************************************************/
+
+void mm_shrinktofit(FAR struct mm_heap_s *heap, FAR void *mem, size_t size)
+{
+  FAR struct mm_allocnode_s *node;
+#ifdef CONFIG_MM_PROFILE
+  FAR void *caller;
+#endif
+
+  if (mem == NULL)
+    {
+      return;
+    }
+
+  size = MM_ALIGN_UP(size + SIZEOF_MM_ALLOCNODE + MM_TAGSIZE);
+  node = (FAR struct mm_allocnode_s *)((FAR char *)mem - SIZEOF_MM_ALLOCNODE);
+
+  mm_takesemaphore(heap);
+  if (size < node->size)
+    {
+#ifdef CONFIG_MM_PROFILE
+      caller = mm_profile_caller(heap, node);
+      mm_profile_free(heap, node);
+#endif
+      mm_shrinkchunk(heap, node, size);
+#ifdef CONFIG_MM_PROFILE
+      mm_profile_alloc(heap, node, caller);
+#endif
+    }
+
+  mm_givesemaphore(heap);
+}
@@ -59,19 +59,20 @@
 
 int mm_size2ndx(size_t size)
 {
-  int ndx = 0;
+  int shift;
+  int sl;
 
   if (size >= MM_MAX_CHUNK)
     {
        return MM_NNODES-1;
     }
 
-  size >>= MM_MIN_SHIFT;
-  while (size > 1)
-    {
-      ndx++;
-      size >>= 1;
-    }
+  /* First level: the power of two of the size.  Second level: which of
+   * the even ranges of that power of two the size falls in.
+   */
+
+  shift = 31 - __builtin_clz((unsigned int)size | MM_MIN_CHUNK);
+  sl    = (size >> (shift - MM_SL_SHIFT)) & (MM_NSL - 1);
 
-  return ndx;
+  return ((shift - MM_MIN_SHIFT) << MM_SL_SHIFT) + sl;
 }
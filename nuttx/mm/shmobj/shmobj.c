@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <nuttx/config.h>
+
+#include <nuttx/compiler.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/list.h>
+#include <nuttx/mm/shmobj.h>
+
+#ifdef CONFIG_MM_SHMOBJ_GRAN
+#include <nuttx/mm/gran.h>
+#else
+#include <nuttx/bufram.h>
+#endif
+
+#include <arch/irq.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+struct shmobj {
+    struct list_head list;
+    unsigned int refs;
+    size_t size;
+    void *data;
+    char name[CONFIG_MM_SHMOBJ_NAMELEN];
+};
+
+/* Objects that can be opened by name, accessed with interrupts disabled */
+static LIST_DECLARE(shmobj_list);
+
+#ifdef CONFIG_MM_SHMOBJ_GRAN
+static uint8_t shmobj_heap[CONFIG_MM_SHMOBJ_HEAPSIZE] noinit_data
+    __attribute__((aligned(1 << CONFIG_MM_SHMOBJ_LOG2GRAN)));
+static GRAN_HANDLE shmobj_gran;
+
+static void *shmobj_data_alloc(size_t size)
+{
+    return gran_alloc(shmobj_gran, size);
+}
+
+static void shmobj_data_free(void *data, size_t size)
+{
+    gran_free(shmobj_gran, data, size);
+}
+#else
+static void *shmobj_data_alloc(size_t size)
+{
+    return bufram_alloc(size);
+}
+
+static void shmobj_data_free(void *data, size_t size)
+{
+    bufram_free(data);
+}
+#endif
+
+/* Requires interrupts disabled */
+static struct shmobj *shmobj_lookup(const char *name)
+{
+    struct list_head *iter;
+    struct shmobj *obj;
+
+    list_foreach(&shmobj_list, iter) {
+        obj = list_entry(iter, struct shmobj, list);
+        if (!strncmp(obj->name, name, sizeof(obj->name)))
+            return obj;
+    }
+
+    return NULL;
+}
+
+int shmobj_initialize(void)
+{
+#ifdef CONFIG_MM_SHMOBJ_GRAN
+    shmobj_gran = gran_initialize(shmobj_heap, sizeof(shmobj_heap),
+                                  CONFIG_MM_SHMOBJ_LOG2GRAN,
+                                  CONFIG_MM_SHMOBJ_LOG2GRAN);
+    if (!shmobj_gran)
+        return -ENOMEM;
+#endif
+
+    return 0;
+}
+
+/*
+ * Create an object of the given name with a buffer of size bytes. The
+ * caller holds its first reference. Returns NULL if the name is already
+ * used or if there is not enough memory.
+ */
+struct shmobj *shmobj_create(const char *name, size_t size)
+{
+    struct shmobj *obj;
+    irqstate_t flags;
+
+    if (!name || !size || strlen(name) >= CONFIG_MM_SHMOBJ_NAMELEN)
+        return NULL;
+
+    obj = kmm_zalloc(sizeof(*obj));
+    if (!obj)
+        return NULL;
+
+    obj->data = shmobj_data_alloc(size);
+    if (!obj->data) {
+        kmm_free(obj);
+        return NULL;
+    }
+
+    obj->size = size;
+    obj->refs = 1;
+    strcpy(obj->name, name);
+
+    flags = irqsave();
+    if (shmobj_lookup(name)) {
+        irqrestore(flags);
+        shmobj_data_free(obj->data, size);
+        kmm_free(obj);
+        return NULL;
+    }
+    list_add(&shmobj_list, &obj->list);
+    irqrestore(flags);
+
+    return obj;
+}
+
+/*
+ * Attach to the object of the given name, taking a reference on it.
+ * Returns NULL if there is no such object.
+ */
+struct shmobj *shmobj_open(const char *name)
+{
+    struct shmobj *obj;
+    irqstate_t flags;
+
+    if (!name)
+        return NULL;
+
+    flags = irqsave();
+    obj = shmobj_lookup(name);
+    if (obj)
+        obj->refs++;
+    irqrestore(flags);
+
+    return obj;
+}
+
+void shmobj_get(struct shmobj *obj)
+{
+    irqstate_t flags;
+
+    flags = irqsave();
+    obj->refs++;
+    irqrestore(flags);
+}
+
+/* Put a reference; the last one frees the object and its buffer */
+void shmobj_put(struct shmobj *obj)
+{
+    irqstate_t flags;
+
+    if (!obj)
+        return;
+
+    flags = irqsave();
+    if (--obj->refs) {
+        irqrestore(flags);
+        return;
+    }
+    list_del(&obj->list);
+    irqrestore(flags);
+
+    shmobj_data_free(obj->data, obj->size);
+    kmm_free(obj);
+}
+
+void *shmobj_data(struct shmobj *obj)
+{
+    return obj->data;
+}
+
+size_t shmobj_size(struct shmobj *obj)
+{
+    return obj->size;
+}
@@ -80,7 +80,15 @@
 
 FAR void *calloc(size_t n, size_t elem_size)
 {
-  return mm_calloc(USR_HEAP, n, elem_size);
+  FAR void *mem = mm_calloc(USR_HEAP, n, elem_size);
+
+#ifdef CONFIG_MM_PROFILE
+  /* Account the chunk to our caller rather than to us */
+
+  mm_profile_setcaller(USR_HEAP, mem, __builtin_return_address(0));
+#endif
+
+  return mem;
 }
 
 #endif /* !CONFIG_BUILD_PROTECTED || !__KERNEL__ */
@@ -134,7 +134,15 @@ FAR void *malloc(size_t size)
 
   return mem;
 #else
-  return mm_malloc(USR_HEAP, size);
+  FAR void *mem = mm_malloc(USR_HEAP, size);
+
+#ifdef CONFIG_MM_PROFILE
+  /* Account the chunk to our caller rather than to us */
+
+  mm_profile_setcaller(USR_HEAP, mem, __builtin_return_address(0));
+#endif
+
+  return mem;
 #endif
 }
 
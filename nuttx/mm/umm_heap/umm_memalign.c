@@ -89,7 +89,15 @@
 
 FAR void *memalign(size_t alignment, size_t size)
 {
-  return mm_memalign(USR_HEAP, alignment, size);
+  FAR void *mem = mm_memalign(USR_HEAP, alignment, size);
+
+#ifdef CONFIG_MM_PROFILE
+  /* Account the chunk to our caller rather than to us */
+
+  mm_profile_setcaller(USR_HEAP, mem, __builtin_return_address(0));
+#endif
+
+  return mem;
 }
 
 #endif /* !CONFIG_BUILD_PROTECTED || !__KERNEL__ */
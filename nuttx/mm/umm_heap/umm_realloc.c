@@ -91,7 +91,20 @@
 
 FAR void *realloc(FAR void *oldmem, size_t size)
 {
-  return mm_realloc(USR_HEAP, oldmem, size);
+  FAR void *mem = mm_realloc(USR_HEAP, oldmem, size);
+
+#ifdef CONFIG_MM_PROFILE
+  /* A chunk resized remains accounted to whoever allocated it, but a new
+   * one is accounted to our caller rather than to us.
+   */
+
+  if (!oldmem)
+    {
+      mm_profile_setcaller(USR_HEAP, mem, __builtin_return_address(0));
+    }
+#endif
+
+  return mem;
 }
 
 #endif /* !CONFIG_BUILD_PROTECTED || !__KERNEL__ */
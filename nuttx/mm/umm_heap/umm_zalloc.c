@@ -101,7 +101,15 @@ FAR void *zalloc(size_t size)
 #else
   /* Use mm_zalloc() becuase it implements the clear */
 
-  return mm_zalloc(USR_HEAP, size);
+  FAR void *alloc = mm_zalloc(USR_HEAP, size);
+
+#ifdef CONFIG_MM_PROFILE
+  /* Account the chunk to our caller rather than to us */
+
+  mm_profile_setcaller(USR_HEAP, alloc, __builtin_return_address(0));
+#endif
+
+  return alloc;
 #endif
 }
 
@@ -39,6 +39,8 @@
 
 #include <nuttx/config.h>
 #include <nuttx/rtc.h>
+#include <nuttx/time.h>
+#include <nuttx/hires_tmr.h>
 
 #include <stdint.h>
 #include <time.h>
@@ -118,7 +120,15 @@ int clock_gettime(clockid_t clock_id, struct timespec *tp)
        * reset.
        */
 
+#ifdef CONFIG_ARCH_HAVE_HIRES_TIMER
+      /* The high resolution timer has sub-tick precision and, unlike
+       * clock_systimespec(), never goes through the RTC.
+       */
+
+      nsec_to_timespec(hrt_getnsec(), tp);
+#else
       ret = clock_systimespec(tp);
+#endif
     }
   else
 #endif
@@ -89,8 +89,9 @@ static inline void sched_dupfiles(FAR struct task_tcb_s *tcb)
   /* The parent task is the one at the head of the ready-to-run list */
 
   FAR struct tcb_s *rtcb = (FAR struct tcb_s*)g_readytorun.head;
-  FAR struct file *parent;
-  FAR struct file *child;
+  FAR struct filelist *parent;
+  FAR struct filelist *child;
+  FAR struct file *filep;
   int i;
 
   DEBUGASSERT(tcb && tcb->cmn.group && rtcb->group);
@@ -103,8 +104,8 @@ static inline void sched_dupfiles(FAR struct task_tcb_s *tcb)
 
    /* Get pointers to the parent and child task file lists */
 
-  parent = rtcb->group->tg_filelist.fl_files;
-  child  = tcb->cmn.group->tg_filelist.fl_files;
+  parent = &rtcb->group->tg_filelist;
+  child  = &tcb->cmn.group->tg_filelist;
 
   /* Check each file in the parent file list */
 
@@ -115,11 +116,12 @@ static inline void sched_dupfiles(FAR struct task_tcb_s *tcb)
        * i-node structure.
        */
 
-      if (parent[i].f_inode)
+      filep = files_fdfile(parent, i);
+      if (filep && filep->f_inode)
         {
           /* Yes... duplicate it for the child */
 
-          (void)files_dup(&parent[i], &child[i]);
+          (void)files_dup(filep, child, i);
         }
     }
 }
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/boot_timing.h>
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct boot_mark_s g_boot_marks[CONFIG_BOOT_TIMING_NMARKS];
+static int g_boot_nmarks;
+
+/* Set once the table is full or the timestamp wrapped: the marks recorded
+ * after that would be misleading.
+ */
+
+static bool g_boot_done;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: boot_timing_mark
+ ****************************************************************************/
+
+void boot_timing_mark(FAR const char *stage)
+{
+  irqstate_t flags;
+  uint32_t usec;
+  int i;
+
+  if (g_boot_done)
+    {
+      return;
+    }
+
+  usec  = up_boot_timestamp();
+  flags = irqsave();
+
+  for (i = 0; i < g_boot_nmarks; i++)
+    {
+      if (strcmp(g_boot_marks[i].stage, stage) == 0)
+        {
+          goto out;
+        }
+    }
+
+  if (g_boot_nmarks >= CONFIG_BOOT_TIMING_NMARKS ||
+      (g_boot_nmarks > 0 && usec < g_boot_marks[g_boot_nmarks - 1].usec))
+    {
+      g_boot_done = true;
+      goto out;
+    }
+
+  g_boot_marks[g_boot_nmarks].stage = stage;
+  g_boot_marks[g_boot_nmarks].usec  = usec;
+  g_boot_nmarks++;
+
+out:
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: boot_timing_get
+ ****************************************************************************/
+
+int boot_timing_get(FAR struct boot_mark_s *marks, int nmarks)
+{
+  irqstate_t flags;
+
+  flags = irqsave();
+
+  if (nmarks > g_boot_nmarks)
+    {
+      nmarks = g_boot_nmarks;
+    }
+
+  memcpy(marks, g_boot_marks, nmarks * sizeof(struct boot_mark_s));
+
+  irqrestore(flags);
+  return nmarks;
+}
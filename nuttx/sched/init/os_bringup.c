@@ -49,8 +49,10 @@
 
 #include <nuttx/arch.h>
 #include <nuttx/init.h>
+#include <nuttx/boot_timing.h>
 #include <nuttx/wqueue.h>
 #include <nuttx/kthread.h>
+#include <nuttx/tpool.h>
 #include <nuttx/userspace.h>
 #include <nuttx/binfmt/binfmt.h>
 
@@ -193,6 +195,58 @@ static inline void os_pgworker(void)
 
 #endif /* CONFIG_PAGING */
 
+/****************************************************************************
+ * Name: os_workthreads
+ *
+ * Description:
+ *   Start the threads serving one kernel work queue.  Each gets its index
+ *   among them as argument.
+ *
+ * Input Parameters:
+ *   wqueue    - The work queue
+ *   name      - The name of the threads
+ *   priority  - The priority of the threads
+ *   stacksize - The stack size of each thread
+ *   entry     - The thread entry point
+ *   nthreads  - The number of threads
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_HPWORK
+static void os_workthreads(FAR struct wqueue_s *wqueue, FAR const char *name,
+                           int priority, int stacksize, main_t entry,
+                           int nthreads)
+{
+  char index[2];
+  FAR char *argv[2];
+  int i;
+
+  argv[0] = index;
+  argv[1] = NULL;
+
+#ifdef CONFIG_SCHED_WORKITEM_PRIORITY
+  wqueue->prio = priority;
+#endif
+
+  for (i = 0; i < nthreads; i++)
+    {
+      index[0] = '0' + i;
+      index[1] = '\0';
+
+      wqueue->pid[i] = kernel_thread(name, priority, stacksize, entry,
+                                     (FAR char * const *)argv);
+      DEBUGASSERT(wqueue->pid[i] > 0);
+
+      /* Only wake up the threads that have a valid ID */
+
+      wqueue->nthreads = i + 1;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: os_workqueues
  *
@@ -221,11 +275,9 @@ static inline void os_workqueues(void)
   svdbg("Starting kernel worker thread\n");
 #endif
 
-  g_work[HPWORK].pid = kernel_thread(HPWORKNAME, CONFIG_SCHED_WORKPRIORITY,
-                                     CONFIG_SCHED_WORKSTACKSIZE,
-                                     (main_t)work_hpthread,
-                                     (FAR char * const *)NULL);
-  DEBUGASSERT(g_work[HPWORK].pid > 0);
+  os_workthreads(&g_work[HPWORK], HPWORKNAME, CONFIG_SCHED_WORKPRIORITY,
+                 CONFIG_SCHED_WORKSTACKSIZE, (main_t)work_hpthread,
+                 CONFIG_SCHED_HPNTHREADS);
 
   /* Start a lower priority worker thread for other, non-critical continuation
    * tasks
@@ -235,11 +287,9 @@ static inline void os_workqueues(void)
 
   svdbg("Starting low-priority kernel worker thread\n");
 
-  g_work[LPWORK].pid = kernel_thread(LPWORKNAME, CONFIG_SCHED_LPWORKPRIORITY,
-                                     CONFIG_SCHED_LPWORKSTACKSIZE,
-                                     (main_t)work_lpthread,
-                                     (FAR char * const *)NULL);
-  DEBUGASSERT(g_work[LPWORK].pid > 0);
+  os_workthreads(&g_work[LPWORK], LPWORKNAME, CONFIG_SCHED_LPWORKPRIORITY,
+                 CONFIG_SCHED_LPWORKSTACKSIZE, (main_t)work_lpthread,
+                 CONFIG_SCHED_LPNTHREADS);
 
 #endif /* CONFIG_SCHED_LPWORK */
 #endif /* CONFIG_SCHED_HPWORK */
@@ -285,6 +335,7 @@ static inline void os_do_appstart(void)
    */
 
   board_initialize();
+  boot_timing_mark("board");
 #endif
 
   /* Start the application initialization task.  In a flat build, this is
@@ -320,6 +371,7 @@ static inline void os_do_appstart(void)
    */
 
   board_initialize();
+  boot_timing_mark("board");
 #endif
 
   /* Start the application initialization program from a program in a
@@ -471,6 +523,12 @@ int os_bringup(void)
 
   os_workqueues();
 
+#ifdef CONFIG_SCHED_TPOOL
+  /* Start the threads that drivers borrow instead of creating their own */
+
+  tpool_initialize();
+#endif
+
   /* Once the operating system has been initialized, the system must be
    * started by spawning the user initialization thread of execution.  This
    * will be the first user-mode thread.
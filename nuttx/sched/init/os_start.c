@@ -77,8 +77,11 @@
 #include  <nuttx/lib.h>
 #include  <nuttx/mm/mm.h>
 #include  <nuttx/mm/shm.h>
+#include  <nuttx/mm/dma_heap.h>
+#include  <nuttx/mm/shmobj.h>
 #include  <nuttx/kmalloc.h>
 #include  <nuttx/init.h>
+#include  <nuttx/boot_timing.h>
 
 #include  "sched/sched.h"
 #include  "signal/signal.h"
@@ -124,7 +127,7 @@
  * IDLE task.
  */
 
-volatile dq_queue_t g_readytorun;
+volatile dq_queue_t g_readytorun hot_data;
 
 /* This is the list of all tasks that are ready-to-run, but cannot be placed
  * in the g_readytorun list because:  (1) They are higher priority than the
@@ -354,7 +357,7 @@ void os_start(void)
 
   /* Then add the idle task's TCB to the head of the ready to run list */
 
-  dq_addfirst((FAR dq_entry_t*)&g_idletcb, (FAR dq_queue_t*)&g_readytorun);
+  (void)sched_rtr_add(&g_idletcb.cmn);
 
   /* Initialize the processor-specific portion of the TCB */
 
@@ -406,6 +409,20 @@ void os_start(void)
     up_allocate_pgheap(&heap_start, &heap_size);
     mm_pginitialize(heap_start, heap_size);
 #endif
+
+#ifdef CONFIG_MM_DMA_HEAP
+    /* Set up the heap of the buffers accessed by the DMA controllers */
+
+    dma_heap_initialize();
+#endif
+
+#ifdef CONFIG_MM_SHMOBJ
+    /* Set up the storage of the shared memory objects */
+
+    (void)shmobj_initialize();
+#endif
+
+    boot_timing_mark("heap");
   }
 
 #if defined(CONFIG_SCHED_HAVE_PARENT) && defined(CONFIG_SCHED_CHILD_STATUS)
@@ -512,6 +529,7 @@ void os_start(void)
    */
 
   up_initialize();
+  boot_timing_mark("up_initialize");
 
 #ifdef CONFIG_MM_SHM
   /* Initialize shared memory support */
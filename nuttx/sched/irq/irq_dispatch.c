@@ -70,12 +70,11 @@
 #include <debug.h>
 #include <nuttx/arch.h>
 #include <nuttx/irq.h>
+#include <nuttx/irqmon.h>
+#include <nuttx/sched_trace.h>
 
 #include "irq/irq.h"
-
-#if defined(CONFIG_USEC_MEASURE_PERF)
 #include "sched/sched.h"
-#endif
 
 /****************************************************************************
  * Definitions
@@ -120,6 +119,13 @@ void irq_dispatch(int irq, FAR void *context)
   sched_track_irq_start(irq);
 #endif
 
+  sched_trace(SCHED_TRACE_IRQ_ENTER, irq, 0);
+  sched_cpuacct_irqenter();
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+  irqmon_irqenter(irq);
+#endif
+
   /* Perform some sanity checks */
 
 #if NR_IRQS > 0
@@ -139,6 +145,18 @@ void irq_dispatch(int irq, FAR void *context)
 
   vector(irq, context, g_irqpriv[irq]);
 
+#ifdef CONFIG_SCHED_IRQMONITOR
+  irqmon_irqleave(irq);
+#endif
+
+  /* The handler may have readied a higher priority task: the one resumed
+   * on return is recorded with the exit.
+   */
+
+  sched_trace(SCHED_TRACE_IRQ_LEAVE, irq,
+              ((FAR struct tcb_s *)g_readytorun.head)->pid);
+  sched_cpuacct_irqleave();
+
 #if defined(CONFIG_USEC_MEASURE_PERF)
   /* stop tracking current interrupt and go back to tracking current tcb */
   sched_track_irq_stop();
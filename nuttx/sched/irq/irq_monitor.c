@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/irqmon.h>
+#include <nuttx/hires_tmr.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_IRQMONITOR
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The window being measured, if g_mask_pid is not -1 */
+
+static uint32_t g_mask_start;
+static uintptr_t g_mask_pc;
+static pid_t g_mask_pid = -1;
+
+/* The handler being measured */
+
+static uint32_t g_irq_start;
+
+/* Longest windows first */
+
+static struct irqmon_window_s g_windows[CONFIG_SCHED_IRQMONITOR_NWINDOWS];
+
+static struct irqmon_irq_s g_irqs[NR_IRQS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: irqmon_pending
+ *
+ * Description:
+ *   Account the interrupts left pending behind a masked window or a
+ *   handler that lasted usec.
+ *
+ ****************************************************************************/
+
+static void irqmon_pending(uint32_t usec)
+{
+  FAR uint16_t *counter;
+  int bucket;
+  int irq;
+
+  bucket = usec == 0 ? 0 : 32 - __builtin_clz(usec);
+  if (bucket >= IRQMON_NBUCKETS)
+    {
+      bucket = IRQMON_NBUCKETS - 1;
+    }
+
+  for (irq = up_nextpending_irq(0); irq >= 0;
+       irq = up_nextpending_irq(irq + 1))
+    {
+      counter = &g_irqs[irq].latency[bucket];
+      if (*counter < UINT16_MAX)
+        {
+          (*counter)++;
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: irqmon_maskstart
+ ****************************************************************************/
+
+void irqmon_maskstart(uintptr_t pc)
+{
+  /* The handlers are measured as a whole by irqmon_irqleave() */
+
+  if (up_interrupt_context())
+    {
+      return;
+    }
+
+  /* A window left open by a task that blocked in its critical section is
+   * dropped: the interrupts were unmasked by the context switch.
+   */
+
+  g_mask_start = hrt_getusec();
+  g_mask_pc    = pc;
+  g_mask_pid   = ((FAR struct tcb_s *)g_readytorun.head)->pid;
+}
+
+/****************************************************************************
+ * Name: irqmon_maskend
+ ****************************************************************************/
+
+void irqmon_maskend(uintptr_t pc)
+{
+  FAR struct irqmon_window_s *window;
+  uint32_t usec;
+  int i;
+
+  if (up_interrupt_context() ||
+      g_mask_pid != ((FAR struct tcb_s *)g_readytorun.head)->pid)
+    {
+      return;
+    }
+
+  usec = hrt_getusec() - g_mask_start;
+  g_mask_pid = -1;
+
+  irqmon_pending(usec);
+
+  /* Insert the window in the list of the longest ones */
+
+  i = CONFIG_SCHED_IRQMONITOR_NWINDOWS - 1;
+  if (usec <= g_windows[i].usec)
+    {
+      return;
+    }
+
+  for (; i > 0 && g_windows[i - 1].usec < usec; i--)
+    {
+      g_windows[i] = g_windows[i - 1];
+    }
+
+  window            = &g_windows[i];
+  window->usec      = usec;
+  window->savepc    = g_mask_pc;
+  window->restorepc = pc;
+  window->pid       = ((FAR struct tcb_s *)g_readytorun.head)->pid;
+}
+
+/****************************************************************************
+ * Name: irqmon_irqenter
+ ****************************************************************************/
+
+void irqmon_irqenter(int irq)
+{
+  g_irq_start = hrt_getusec();
+}
+
+/****************************************************************************
+ * Name: irqmon_irqleave
+ ****************************************************************************/
+
+void irqmon_irqleave(int irq)
+{
+  uint32_t usec = hrt_getusec() - g_irq_start;
+
+  if ((unsigned)irq < NR_IRQS)
+    {
+      g_irqs[irq].count++;
+      if (usec > g_irqs[irq].maxusec)
+        {
+          g_irqs[irq].maxusec = usec;
+        }
+    }
+
+  irqmon_pending(usec);
+}
+
+/****************************************************************************
+ * Name: irqmon_reset
+ ****************************************************************************/
+
+void irqmon_reset(void)
+{
+  irqstate_t flags = irqsave();
+
+  memset(g_windows, 0, sizeof(g_windows));
+  memset(g_irqs, 0, sizeof(g_irqs));
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: irqmon_windows
+ ****************************************************************************/
+
+int irqmon_windows(FAR struct irqmon_window_s *windows, int nwindows)
+{
+  irqstate_t flags;
+  int i;
+
+  flags = irqsave();
+  for (i = 0; i < nwindows && i < CONFIG_SCHED_IRQMONITOR_NWINDOWS &&
+              g_windows[i].usec > 0; i++)
+    {
+      windows[i] = g_windows[i];
+    }
+
+  irqrestore(flags);
+  return i;
+}
+
+/****************************************************************************
+ * Name: irqmon_irq
+ ****************************************************************************/
+
+int irqmon_irq(int irq, FAR struct irqmon_irq_s *info)
+{
+  irqstate_t flags;
+
+  if ((unsigned)irq >= NR_IRQS)
+    {
+      return -EINVAL;
+    }
+
+  flags = irqsave();
+  *info = g_irqs[irq];
+  irqrestore(flags);
+  return OK;
+}
+
+#endif /* CONFIG_SCHED_IRQMONITOR */
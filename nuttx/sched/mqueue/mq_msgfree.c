@@ -79,6 +79,7 @@
  *   allocated dynamically it will be deallocated.
  *
  * Inputs:
+ *   msgq  - message queue the message was allocated for
  *   mqmsg - message to free
  *
  * Return Value:
@@ -86,7 +87,7 @@
  *
  ************************************************************************/
 
-void mq_msgfree(FAR mqmsg_t *mqmsg)
+void mq_msgfree(FAR msgq_t *msgq, FAR mqmsg_t *mqmsg)
 {
   irqstate_t saved_state;
 
@@ -120,6 +121,19 @@ void mq_msgfree(FAR mqmsg_t *mqmsg)
       irqrestore(saved_state);
     }
 
+#ifdef CONFIG_MQ_PREALLOC
+  /* If this message was allocated with its queue, then put it back in
+   * the free list of the queue.
+   */
+
+  else if (mqmsg->type == MQ_ALLOC_QUEUE)
+    {
+      saved_state = irqsave();
+      sq_addlast((FAR sq_entry_t*)mqmsg, &msgq->msgfree);
+      irqrestore(saved_state);
+    }
+#endif
+
   /* Otherwise, deallocate it.  Note:  interrupt handlers
    * will never deallocate messages because they will not
    * received them.
@@ -98,10 +98,19 @@ void mq_msgqfree(FAR msgq_t *msgq)
       /* Deallocate the message structure. */
 
       next = curr->next;
-      mq_msgfree(curr);
+      mq_msgfree(msgq, curr);
       curr = next;
     }
 
+#ifdef CONFIG_MQ_PREALLOC
+  /* Deallocate the messages allocated with the queue */
+
+  if (msgq->msgpool)
+    {
+      sched_kfree(msgq->msgpool);
+    }
+#endif
+
   /* Then deallocate the message queue itself */
 
   sched_kfree(msgq);
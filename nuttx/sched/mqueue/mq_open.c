@@ -74,6 +74,39 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: mq_msgpoolalloc
+ *
+ * Description:
+ *   Allocate the maxmsgs messages of a new message queue, each sized for
+ *   maxmsgsize bytes.  If this fails, the queue uses the shared messages.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MQ_PREALLOC
+static void mq_msgpoolalloc(FAR msgq_t *msgq)
+{
+  FAR mqmsg_t *mqmsg;
+  size_t msgsize = MQ_MSG_SIZE(msgq->maxmsgsize);
+  int i;
+
+  sq_init(&msgq->msgfree);
+  msgq->msgpool = kmm_malloc(msgsize * msgq->maxmsgs);
+  if (!msgq->msgpool)
+    {
+      sdbg("No pool for %d messages\n", msgq->maxmsgs);
+      return;
+    }
+
+  for (i = 0; i < msgq->maxmsgs; i++)
+    {
+      mqmsg = (FAR mqmsg_t *)((FAR uint8_t *)msgq->msgpool + i * msgsize);
+      mqmsg->type = MQ_ALLOC_QUEUE;
+      sq_addlast((FAR sq_entry_t *)mqmsg, &msgq->msgfree);
+    }
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -193,6 +226,9 @@ mqd_t mq_open(const char *mq_name, int oflags, ...)
                           msgq->maxmsgsize = MQ_MAX_BYTES;
                         }
 
+#ifdef CONFIG_MQ_PREALLOC
+                      mq_msgpoolalloc(msgq);
+#endif
                       msgq->nconnect = 1;
 #ifndef CONFIG_DISABLE_SIGNALS
                       msgq->ntpid    = INVALID_PROCESS_ID;
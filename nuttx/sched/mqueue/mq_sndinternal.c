@@ -151,8 +151,11 @@ int mq_verifysend(mqd_t mqdes, const void *msg, size_t msglen, int prio)
  *   the g_msgfreeirq list.  If this is unsuccessful, the calling interrupt
  *   handler will be notified.
  *
+ *   With CONFIG_MQ_PREALLOC, the messages allocated with the queue are
+ *   used first.
+ *
  * Inputs:
- *   None
+ *   msgq - The message queue the message is sent to
  *
  * Return Value:
  *   A reference to the allocated msg structure.  On a failure to allocate,
@@ -160,11 +163,22 @@ int mq_verifysend(mqd_t mqdes, const void *msg, size_t msglen, int prio)
  *
  ****************************************************************************/
 
-FAR mqmsg_t *mq_msgalloc(void)
+FAR mqmsg_t *mq_msgalloc(FAR msgq_t *msgq)
 {
   FAR mqmsg_t *mqmsg;
   irqstate_t   saved_state;
 
+#ifdef CONFIG_MQ_PREALLOC
+  saved_state = irqsave();
+  mqmsg = (FAR mqmsg_t*)sq_remfirst(&msgq->msgfree);
+  irqrestore(saved_state);
+
+  if (mqmsg)
+    {
+      return mqmsg;
+    }
+#endif
+
   /* If we were called from an interrupt handler, then try to get the message
    * from generally available list of messages. If this fails, then try the
    * list of messages reserved for interrupt handlers
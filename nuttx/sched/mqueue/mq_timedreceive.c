@@ -204,17 +204,11 @@ ssize_t mq_timedreceive(mqd_t mqdes, void *msg, size_t msglen,
       return ERROR;
     }
 
-  /* Create a watchdog.  We will not actually need this watchdog
-   * unless the queue is not empty, but we will reserve it up front
-   * before we enter the following critical section.
+  /* Use the watchdog embedded in the TCB.  We will not actually need
+   * this watchdog unless the queue is not empty.
    */
 
-  rtcb->waitdog = wd_create();
-  if (!rtcb->waitdog)
-    {
-      set_errno(EINVAL);
-      return ERROR;
-    }
+  rtcb->waitdog = &rtcb->waittimer;
 
   /* Get the next mesage from the message queue.  We will disable
    * pre-emption until we have completed the message received.  This
@@ -261,7 +255,6 @@ ssize_t mq_timedreceive(mqd_t mqdes, void *msg, size_t msglen,
           set_errno(result);
           irqrestore(saved_state);
           sched_unlock();
-          wd_delete(rtcb->waitdog);
           rtcb->waitdog = NULL;
           return ERROR;
         }
@@ -299,7 +292,6 @@ ssize_t mq_timedreceive(mqd_t mqdes, void *msg, size_t msglen,
     }
 
   sched_unlock();
-  wd_delete(rtcb->waitdog);
   rtcb->waitdog = NULL;
   return ret;
 }
@@ -210,17 +210,11 @@ int mq_timedsend(mqd_t mqdes, const char *msg, size_t msglen, int prio,
 
   msgq = mqdes->msgq;
 
-  /* Create a watchdog.  We will not actually need this watchdog
-   * unless the queue is full, but we will reserve it up front
-   * before we enter the following critical section.
+  /* Use the watchdog embedded in the TCB.  We will not actually need
+   * this watchdog unless the queue is full.
    */
 
-  rtcb->waitdog = wd_create();
-  if (!rtcb->waitdog)
-    {
-      set_errno(EINVAL);
-      return ERROR;
-    }
+  rtcb->waitdog = &rtcb->waittimer;
 
   /* Allocate a message structure:
    * - If we are called from an interrupt handler, or
@@ -235,7 +229,7 @@ int mq_timedsend(mqd_t mqdes, const char *msg, size_t msglen, int prio,
       /* Allocate the message */
 
       irqrestore(saved_state);
-      mqmsg = mq_msgalloc();
+      mqmsg = mq_msgalloc(msgq);
     }
   else
     {
@@ -297,7 +291,7 @@ int mq_timedsend(mqd_t mqdes, const char *msg, size_t msglen, int prio,
 
       if (ret == OK)
         {
-          mqmsg = mq_msgalloc();
+          mqmsg = mq_msgalloc(msgq);
         }
     }
 
@@ -314,7 +308,6 @@ int mq_timedsend(mqd_t mqdes, const char *msg, size_t msglen, int prio,
     }
 
   sched_unlock();
-  wd_delete(rtcb->waitdog);
   rtcb->waitdog = NULL;
   return ret;
 }
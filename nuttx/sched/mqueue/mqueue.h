@@ -45,6 +45,7 @@
 
 #include <sys/types.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <limits.h>
 #include <mqueue.h>
@@ -83,7 +84,8 @@ enum mqalloc_e
 {
   MQ_ALLOC_FIXED = 0,  /* pre-allocated; never freed */
   MQ_ALLOC_DYN,        /* dynamically allocated; free when unused */
-  MQ_ALLOC_IRQ         /* Preallocated, reserved for interrupt handling */
+  MQ_ALLOC_IRQ,        /* Preallocated, reserved for interrupt handling */
+  MQ_ALLOC_QUEUE       /* Preallocated with its queue (CONFIG_MQ_PREALLOC) */
 };
 
 typedef enum mqalloc_e mqalloc_t;
@@ -105,6 +107,12 @@ struct mqmsg
 
 typedef struct mqmsg mqmsg_t;
 
+/* Size of a message with a payload of n bytes, aligned for the next one */
+
+#define MQ_MSG_SIZE(n) \
+  ((offsetof(mqmsg_t, mail) + (n) + sizeof(FAR void *) - 1) & \
+   ~(sizeof(FAR void *) - 1))
+
 /****************************************************************************
  * Global Variables
  ****************************************************************************/
@@ -151,7 +159,7 @@ void mq_desblockalloc(void);
 
 mqd_t mq_descreate(FAR struct tcb_s* mtcb, FAR msgq_t* msgq, int oflags);
 FAR msgq_t  *mq_findnamed(const char *mq_name);
-void mq_msgfree(FAR mqmsg_t *mqmsg);
+void mq_msgfree(FAR msgq_t *msgq, FAR mqmsg_t *mqmsg);
 void mq_msgqfree(FAR msgq_t *msgq);
 
 /* mq_waitirq.c ************************************************************/
@@ -167,7 +175,7 @@ ssize_t mq_doreceive(mqd_t mqdes, mqmsg_t *mqmsg, void *ubuffer, int *prio);
 /* mq_sndinternal.c ********************************************************/
 
 int mq_verifysend(mqd_t mqdes, const void *msg, size_t msglen, int prio);
-FAR mqmsg_t *mq_msgalloc(void);
+FAR mqmsg_t *mq_msgalloc(FAR msgq_t *msgq);
 int mq_waitsend(mqd_t mqdes);
 int mq_dosend(mqd_t mqdes, FAR mqmsg_t *mqmsg, const void *msg,
               size_t msglen, int prio);
@@ -217,139 +217,133 @@ int pthread_cond_timedwait(FAR pthread_cond_t *cond, FAR pthread_mutex_t *mutex,
 
   else
     {
-      /* Create a watchdog */
+      /* Use the watchdog embedded in the TCB */
 
-      rtcb->waitdog = wd_create();
-      if (!rtcb->waitdog)
+      rtcb->waitdog = &rtcb->waittimer;
+
+      sdbg("Give up mutex...\n");
+
+      /* We must disable pre-emption and interrupts here so that
+       * the time stays valid until the wait begins.   This adds
+       * complexity because we assure that interrupts and
+       * pre-emption are re-enabled correctly.
+       */
+
+      sched_lock();
+      int_state = irqsave();
+
+      /* Convert the timespec to clock ticks.  We must disable pre-emption
+       * here so that this time stays valid until the wait begins.
+       */
+
+      ret = clock_abstime2ticks(CLOCK_REALTIME, abstime, &ticks);
+      if (ret)
         {
-          ret = EINVAL;
+          /* Restore interrupts  (pre-emption will be enabled when
+           * we fall through the if/then/else
+           */
+
+          irqrestore(int_state);
         }
       else
         {
-          sdbg("Give up mutex...\n");
-
-          /* We must disable pre-emption and interrupts here so that
-           * the time stays valid until the wait begins.   This adds
-           * complexity because we assure that interrupts and
-           * pre-emption are re-enabled correctly.
+          /* Check the absolute time to wait.  If it is now or in the past, then
+           * just return with the timedout condition.
            */
 
-          sched_lock();
-          int_state = irqsave();
-
-          /* Convert the timespec to clock ticks.  We must disable pre-emption
-           * here so that this time stays valid until the wait begins.
-           */
-
-          ret = clock_abstime2ticks(CLOCK_REALTIME, abstime, &ticks);
-          if (ret)
+          if (ticks <= 0)
             {
-              /* Restore interrupts  (pre-emption will be enabled when
-               * we fall through the if/then/else
+              /* Restore interrupts and indicate that we have already timed out.
+               * (pre-emption will be enabled when we fall through the
+               * if/then/else
                */
 
               irqrestore(int_state);
+              ret = ETIMEDOUT;
             }
           else
             {
-              /* Check the absolute time to wait.  If it is now or in the past, then
-               * just return with the timedout condition.
-               */
+              /* Give up the mutex */
 
-              if (ticks <= 0)
+              mutex->pid = 0;
+              ret = pthread_givesemaphore((sem_t*)&mutex->sem);
+              if (ret)
                 {
-                  /* Restore interrupts and indicate that we have already timed out.
-                   * (pre-emption will be enabled when we fall through the
-                   * if/then/else
+                  /* Restore interrupts  (pre-emption will be enabled when
+                   * we fall through the if/then/else)
                    */
 
                   irqrestore(int_state);
-                  ret = ETIMEDOUT;
                 }
               else
                 {
-                  /* Give up the mutex */
-
-                  mutex->pid = 0;
-                  ret = pthread_givesemaphore((sem_t*)&mutex->sem);
-                  if (ret)
-                    {
-                      /* Restore interrupts  (pre-emption will be enabled when
-                       * we fall through the if/then/else)
-                       */
+                  /* Start the watchdog */
 
-                      irqrestore(int_state);
-                    }
-                  else
-                    {
-                      /* Start the watchdog */
+                  wd_start(rtcb->waitdog, ticks, (wdentry_t)pthread_condtimedout,
+                           2, (uint32_t)mypid, (uint32_t)SIGCONDTIMEDOUT);
 
-                      wd_start(rtcb->waitdog, ticks, (wdentry_t)pthread_condtimedout,
-                               2, (uint32_t)mypid, (uint32_t)SIGCONDTIMEDOUT);
+                  /* Take the condition semaphore.  Do not restore interrupts
+                   * until we return from the wait.  This is necessary to
+                   * make sure that the watchdog timer and the condition wait
+                   * are started atomically.
+                   */
 
-                      /* Take the condition semaphore.  Do not restore interrupts
-                       * until we return from the wait.  This is necessary to
-                       * make sure that the watchdog timer and the condition wait
-                       * are started atomically.
-                       */
+                  status = sem_wait((sem_t*)&cond->sem);
 
-                      status = sem_wait((sem_t*)&cond->sem);
+                  /* Did we get the condition semaphore. */
 
-                      /* Did we get the condition semaphore. */
+                  if (status != OK)
+                    {
+                      /* NO.. Handle the special case where the semaphore wait was
+                       * awakened by the receipt of a signal -- presumably the
+                       * signal posted by pthread_condtimedout().
+                       */
 
-                      if (status != OK)
+                      if (get_errno() == EINTR)
                         {
-                          /* NO.. Handle the special case where the semaphore wait was
-                           * awakened by the receipt of a signal -- presumably the
-                           * signal posted by pthread_condtimedout().
-                           */
-
-                          if (get_errno() == EINTR)
-                            {
-                              sdbg("Timedout!\n");
-                              ret = ETIMEDOUT;
-                            }
-                          else
-                            {
-                              ret = EINVAL;
-                            }
+                          sdbg("Timedout!\n");
+                          ret = ETIMEDOUT;
+                        }
+                      else
+                        {
+                          ret = EINVAL;
                         }
-
-                      /* The interrupts stay disabled until after we sample the errno.
-                       * This is because when debug is enabled and the console is used
-                       * for debug output, then the errno can be altered by interrupt
-                       * handling! (bad)
-                       */
-
-                      irqrestore(int_state);
                     }
 
-                  /* Reacquire the mutex (retaining the ret). */
+                  /* The interrupts stay disabled until after we sample the errno.
+                   * This is because when debug is enabled and the console is used
+                   * for debug output, then the errno can be altered by interrupt
+                   * handling! (bad)
+                   */
 
-                  sdbg("Re-locking...\n");
-                  status = pthread_takesemaphore((sem_t*)&mutex->sem);
-                  if (!status)
-                    {
-                      mutex->pid = mypid;
-                    }
-                  else if (!ret)
-                    {
-                      ret = status;
-                    }
+                  irqrestore(int_state);
                 }
 
-              /* Re-enable pre-emption (It is expected that interrupts
-               * have already been re-enabled in the above logic)
-               */
+              /* Reacquire the mutex (retaining the ret). */
 
-              sched_unlock();
+              sdbg("Re-locking...\n");
+              status = pthread_takesemaphore((sem_t*)&mutex->sem);
+              if (!status)
+                {
+                  mutex->pid = mypid;
+                }
+              else if (!ret)
+                {
+                  ret = status;
+                }
             }
 
-          /* We no longer need the watchdog */
+          /* Re-enable pre-emption (It is expected that interrupts
+           * have already been re-enabled in the above logic)
+           */
 
-          wd_delete(rtcb->waitdog);
-          rtcb->waitdog = NULL;
+          sched_unlock();
         }
+
+      /* We no longer need the watchdog */
+
+      wd_cancel(rtcb->waitdog);
+      rtcb->waitdog = NULL;
     }
 
   sdbg("Returning %d\n", ret);
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/kthread.h>
+#include <nuttx/tpool.h>
+
+#ifdef CONFIG_SCHED_TPOOL
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TPOOL_NTHREADS \
+  (CONFIG_SCHED_TPOOL_NSMALL + CONFIG_SCHED_TPOOL_NLARGE)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct tpool_thread_s
+{
+  pid_t pid;                    /* Pool thread, 0 if it failed to start */
+  size_t stacksize;             /* Size of its stack */
+  bool busy;                    /* Lent by tpool_create() */
+  sem_t start;                  /* Posted to run 'entry' */
+  sem_t done;                   /* Posted when 'entry' returned */
+  pthread_startroutine_t entry;
+  pthread_addr_t arg;
+  pthread_addr_t value;         /* Returned by 'entry' */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The small stack threads first, so that the first fit is the best fit */
+
+static struct tpool_thread_s g_tpool[TPOOL_NTHREADS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void tpool_semtake(FAR sem_t *sem)
+{
+  while (sem_wait(sem) < 0)
+    {
+      DEBUGASSERT(get_errno() == EINTR);
+    }
+}
+
+static int tpool_thread(int argc, FAR char *argv[])
+{
+  FAR struct tpool_thread_s *thread = &g_tpool[atoi(argv[1])];
+
+  for (;;)
+    {
+      tpool_semtake(&thread->start);
+      thread->value = thread->entry(thread->arg);
+      sem_post(&thread->done);
+    }
+
+  return 0;
+}
+
+static FAR struct tpool_thread_s *tpool_find(pthread_t pid)
+{
+  int i;
+
+  for (i = 0; i < TPOOL_NTHREADS; i++)
+    {
+      if (g_tpool[i].pid == pid && g_tpool[i].busy)
+        {
+          return &g_tpool[i];
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tpool_initialize
+ ****************************************************************************/
+
+void tpool_initialize(void)
+{
+  FAR struct tpool_thread_s *thread;
+  FAR char *argv[2];
+  char index[4];
+  int i;
+
+  argv[0] = index;
+  argv[1] = NULL;
+
+  for (i = 0; i < TPOOL_NTHREADS; i++)
+    {
+      thread = &g_tpool[i];
+      thread->stacksize = i < CONFIG_SCHED_TPOOL_NSMALL ?
+                          CONFIG_SCHED_TPOOL_SMALL_STACKSIZE :
+                          CONFIG_SCHED_TPOOL_LARGE_STACKSIZE;
+      sem_init(&thread->start, 0, 0);
+      sem_init(&thread->done, 0, 0);
+
+      snprintf(index, sizeof(index), "%d", i);
+      thread->pid = kernel_thread("tpool", PTHREAD_DEFAULT_PRIORITY,
+                                  thread->stacksize, tpool_thread,
+                                  (FAR char * const *)argv);
+      if (thread->pid < 0)
+        {
+          sdbg("tpool: cannot start thread %d: %d\n", i, thread->pid);
+          thread->pid = 0;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: tpool_create
+ ****************************************************************************/
+
+int tpool_create(FAR pthread_t *pid, FAR const pthread_attr_t *attr,
+                 pthread_startroutine_t entry, pthread_addr_t arg)
+{
+  FAR struct tpool_thread_s *thread = NULL;
+  struct sched_param param;
+  size_t stacksize = PTHREAD_STACK_DEFAULT;
+  int i;
+
+  param.sched_priority = PTHREAD_DEFAULT_PRIORITY;
+  if (attr)
+    {
+      stacksize = attr->stacksize;
+      if (attr->inheritsched == PTHREAD_INHERIT_SCHED)
+        {
+          sched_getparam(0, &param);
+        }
+      else
+        {
+          param.sched_priority = attr->priority;
+        }
+    }
+
+  sched_lock();
+  for (i = 0; i < TPOOL_NTHREADS; i++)
+    {
+      if (g_tpool[i].pid && !g_tpool[i].busy &&
+          g_tpool[i].stacksize >= stacksize)
+        {
+          thread = &g_tpool[i];
+          thread->busy = true;
+          break;
+        }
+    }
+
+  sched_unlock();
+
+  if (!thread)
+    {
+      return pthread_create(pid, attr, entry, arg);
+    }
+
+  thread->entry = entry;
+  thread->arg   = arg;
+  sched_setparam(thread->pid, &param);
+
+  *pid = thread->pid;
+  sem_post(&thread->start);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tpool_join
+ ****************************************************************************/
+
+int tpool_join(pthread_t pid, FAR pthread_addr_t *value)
+{
+  FAR struct tpool_thread_s *thread;
+
+  thread = tpool_find(pid);
+  if (!thread)
+    {
+      return pthread_join(pid, value);
+    }
+
+  tpool_semtake(&thread->done);
+  if (value)
+    {
+      *value = thread->value;
+    }
+
+  thread->busy = false;
+  return OK;
+}
+
+#endif /* CONFIG_SCHED_TPOOL */
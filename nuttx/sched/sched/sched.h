@@ -77,6 +77,7 @@
 #include <sched.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/sched_trace.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -256,6 +257,19 @@ bool sched_addreadytorun(FAR struct tcb_s *rtrtcb);
 bool sched_removereadytorun(FAR struct tcb_s *rtrtcb);
 bool sched_addprioritized(FAR struct tcb_s *newTcb, DSEG dq_queue_t *list);
 bool sched_mergepending(void);
+
+/* Insertion in and removal from g_readytorun */
+
+#ifdef CONFIG_SCHED_READYBITMAP
+bool sched_rtr_add(FAR struct tcb_s *tcb);
+void sched_rtr_remove(FAR struct tcb_s *tcb);
+#else
+#  define sched_rtr_add(tcb) \
+     sched_addprioritized(tcb, (FAR dq_queue_t *)&g_readytorun)
+#  define sched_rtr_remove(tcb) \
+     dq_rem((FAR dq_entry_t *)(tcb), (FAR dq_queue_t *)&g_readytorun)
+#endif
+
 void sched_addblocked(FAR struct tcb_s *btcb, tstate_t task_state);
 void sched_removeblocked(FAR struct tcb_s *btcb);
 int  sched_setpriority(FAR struct tcb_s *tcb, int sched_priority);
@@ -295,6 +309,16 @@ void sched_track_pre_exit(struct tcb_s* dead_tcb);
 void sched_track_post_exit(struct tcb_s* new_tcb);
 #endif
 
+#ifdef CONFIG_SCHED_CPUACCT
+void sched_cpuacct_switch(FAR struct tcb_s *tcb, bool voluntary);
+void sched_cpuacct_irqenter(void);
+void sched_cpuacct_irqleave(void);
+#else
+#  define sched_cpuacct_switch(t,v)
+#  define sched_cpuacct_irqenter()
+#  define sched_cpuacct_irqleave()
+#endif
+
 bool sched_verifytcb(FAR struct tcb_s *tcb);
 int  sched_releasetcb(FAR struct tcb_s *tcb, uint8_t ttype);
 
@@ -121,7 +121,7 @@ bool sched_addreadytorun(FAR struct tcb_s *btcb)
 
   /* Otherwise, add the new task to the ready-to-run task list */
 
-  else if (sched_addprioritized(btcb, (FAR dq_queue_t*)&g_readytorun))
+  else if (sched_rtr_add(btcb))
     {
       /* Inform the instrumentation logic that we are switching tasks */
 
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/sched.h>
+#include <nuttx/hires_tmr.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_CPUACCT
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Time at which the running task, or the outermost interrupt, started
+ * being accounted.
+ */
+
+static uint32_t g_cpuacct_start;
+
+/* Interrupt nesting level, and the task the outermost interrupt was taken
+ * from.
+ */
+
+static uint8_t g_cpuacct_nest;
+static pid_t g_cpuacct_irqpid;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sched_cpuacct_elapsed
+ *
+ * Description:
+ *   Return the time since the accounting start and restart it.
+ *
+ ****************************************************************************/
+
+static inline uint32_t sched_cpuacct_elapsed(void)
+{
+  uint32_t now = hrt_getusec();
+  uint32_t elapsed = now - g_cpuacct_start;
+
+  g_cpuacct_start = now;
+  return elapsed;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sched_cpuacct_switch
+ *
+ * Description:
+ *   Called when the running task, tcb, is about to be switched out.  It is
+ *   charged the time it has run for and its context switch is counted.
+ *   The new head of the ready-to-run list is accounted from now.  In an
+ *   interrupt handler, the time was charged when the interrupt was taken.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void sched_cpuacct_switch(FAR struct tcb_s *tcb, bool voluntary)
+{
+  if (g_cpuacct_nest == 0)
+    {
+      tcb->run_usec += sched_cpuacct_elapsed();
+    }
+
+  if (voluntary)
+    {
+      tcb->nvcsw++;
+    }
+  else
+    {
+      tcb->nivcsw++;
+    }
+}
+
+/****************************************************************************
+ * Name: sched_cpuacct_irqenter
+ *
+ * Description:
+ *   Called when an interrupt is taken: the running task is charged the
+ *   time it has run for, and the interrupt is accounted from now.
+ *
+ ****************************************************************************/
+
+void sched_cpuacct_irqenter(void)
+{
+  FAR struct tcb_s *rtcb;
+
+  if (g_cpuacct_nest++ == 0)
+    {
+      rtcb = (FAR struct tcb_s *)g_readytorun.head;
+      rtcb->run_usec  += sched_cpuacct_elapsed();
+      g_cpuacct_irqpid = rtcb->pid;
+    }
+}
+
+/****************************************************************************
+ * Name: sched_cpuacct_irqleave
+ *
+ * Description:
+ *   Called when an interrupt returns: its time is charged to the task it
+ *   was taken from, and the task it returns to is accounted from now.
+ *
+ ****************************************************************************/
+
+void sched_cpuacct_irqleave(void)
+{
+  FAR struct tcb_s *tcb;
+  uint32_t elapsed;
+
+  if (--g_cpuacct_nest == 0)
+    {
+      elapsed = sched_cpuacct_elapsed();
+
+      /* The task may have been deleted by the interrupt handler */
+
+      tcb = sched_gettcb(g_cpuacct_irqpid);
+      if (tcb)
+        {
+          tcb->irq_usec += elapsed;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: sched_cpuacct
+ *
+ * Description:
+ *   Return the CPU accounting of a thread.
+ *
+ * Parameters:
+ *   pid  - The task ID of the thread of interest
+ *   acct - The location to return the CPU accounting
+ *
+ * Return Value:
+ *   OK on success, -ESRCH if pid is not a valid thread.
+ *
+ ****************************************************************************/
+
+int sched_cpuacct(pid_t pid, FAR struct cpuacct_s *acct)
+{
+  FAR struct tcb_s *tcb;
+  irqstate_t flags;
+  int ret = -ESRCH;
+
+  flags = irqsave();
+
+  tcb = sched_gettcb(pid);
+  if (tcb)
+    {
+      acct->run_usec = tcb->run_usec;
+      acct->irq_usec = tcb->irq_usec;
+      acct->nvcsw    = tcb->nvcsw;
+      acct->nivcsw   = tcb->nivcsw;
+
+      /* Add the time the running task has been running for */
+
+      if (tcb == (FAR struct tcb_s *)g_readytorun.head && g_cpuacct_nest == 0)
+        {
+          acct->run_usec += hrt_getusec() - g_cpuacct_start;
+        }
+
+      ret = OK;
+    }
+
+  irqrestore(flags);
+  return ret;
+}
+
+#endif /* CONFIG_SCHED_CPUACCT */
@@ -59,11 +59,11 @@
 /* Software switch to enable/disable Performance Tracking */
 static bool perf_active;
 
-/* Keep track of the perf time start */
-static uint32_t perf_start;
+/* Keep track of the perf time start, in nSec */
+static uint64_t perf_start;
 
-/* Keep track of the perf time stop */
-static uint32_t perf_stop;
+/* Keep track of the perf time stop, in nSec */
+static uint64_t perf_stop;
 
 /* Keep track of the point time was recorded.
  * Its intended this variable is updated only when get_perf_diff_from_last
@@ -111,22 +111,10 @@ static bool curr_irq;
  * Return Value:
  *   uSec since last perftracking session was started
  *
- * Assumptions/Limitations:
- *    timer rolls over every (1.19 hours)
- *
  ************************************************************************/
 inline uint32_t get_perf_time(void)
 {
-    uint32_t usec = hrt_getusec();
-
-    if(usec > perf_start) {
-        usec -= perf_start;
-    }
-    else {
-        usec += (0xffffffff - perf_start);
-    }
-
-    return usec;
+    return (uint32_t)((hrt_getnsec() - perf_start) / NSEC_PER_USEC);
 }
 
 
@@ -233,7 +221,7 @@ void start_perf_track(void)
 
     perf_stop = 0;
 
-    perf_start = hrt_getusec();
+    perf_start = hrt_getnsec();
 
     curr_hash_index = PIDHASH(((struct tcb_s*)g_readytorun.head)->pid);
 
@@ -272,7 +260,7 @@ int stop_perf_track(void)
     }
     else {
 
-    	perf_stop = hrt_getusec();
+    	perf_stop = hrt_getnsec();
 
         perf_active = false;
     }
@@ -302,12 +290,7 @@ uint32_t get_total_perf_time(void)
     uint32_t total_time = 0;
 
     if(!perf_active) {
-	    if(perf_stop > perf_start) {
-	    	total_time = perf_stop - perf_start;
-	    }
-	    else {
-	    	total_time = (0xffffffff - perf_start) + perf_stop;
-	    }
+	    total_time = (uint32_t)((perf_stop - perf_start) / NSEC_PER_USEC);
     }
     else {
     	total_time = get_perf_time();
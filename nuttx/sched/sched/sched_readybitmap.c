@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <queue.h>
+#include <assert.h>
+
+#include "sched/sched.h"
+
+#ifdef CONFIG_SCHED_READYBITMAP
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RTR_NPRIORITIES  (SCHED_PRIORITY_MAX + 1)
+#define RTR_NWORDS       ((RTR_NPRIORITIES + 31) >> 5)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* g_readytorun stays the one list sorted by decreasing priority, FIFO within
+ * a priority, that the rest of the kernel walks.  On the side, one bit per
+ * priority tells which priorities have a ready task, and g_rtr_last[] holds
+ * the last task of each priority in g_readytorun: a new task goes right
+ * after the last task of its priority or, if none, of the lowest higher
+ * priority.  Both are found without walking the list.
+ */
+
+static uint32_t g_rtr_bitmap[RTR_NWORDS];
+static FAR struct tcb_s *g_rtr_last[RTR_NPRIORITIES];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sched_rtr_higher
+ *
+ * Description:
+ *   Return the lowest priority above 'priority' with a ready task, or -1
+ *   if there is none.  __builtin_ctz() is a RBIT and a CLZ on Cortex-M3/4.
+ *
+ ****************************************************************************/
+
+static int sched_rtr_higher(int priority)
+{
+  uint32_t bits;
+  int word;
+
+  priority++;
+  if (priority >= RTR_NPRIORITIES)
+    {
+      return -1;
+    }
+
+  word = priority >> 5;
+  bits = g_rtr_bitmap[word] & (0xffffffff << (priority & 31));
+
+  while (bits == 0)
+    {
+      if (++word >= RTR_NWORDS)
+        {
+          return -1;
+        }
+
+      bits = g_rtr_bitmap[word];
+    }
+
+  return (word << 5) + __builtin_ctz(bits);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sched_rtr_add
+ *
+ * Description:
+ *   Insert a TCB in g_readytorun at its priority, after the TCBs of the
+ *   same priority: the same place as sched_addprioritized() would pick,
+ *   in constant time.
+ *
+ * Return Value:
+ *   true if the TCB was inserted at the head of the list.
+ *
+ * Assumptions:
+ *   Interrupts are disabled and the TCB is in no list.
+ *
+ ****************************************************************************/
+
+bool sched_rtr_add(FAR struct tcb_s *tcb)
+{
+  FAR struct tcb_s *prev;
+  FAR struct tcb_s *next;
+  int priority = tcb->sched_priority;
+  int higher;
+
+  prev = g_rtr_last[priority];
+  if (prev == NULL)
+    {
+      higher = sched_rtr_higher(priority);
+      prev   = higher < 0 ? NULL : g_rtr_last[higher];
+
+      g_rtr_bitmap[priority >> 5] |= (uint32_t)1 << (priority & 31);
+    }
+
+  g_rtr_last[priority] = tcb;
+
+  if (prev == NULL)
+    {
+      next = (FAR struct tcb_s *)g_readytorun.head;
+      g_readytorun.head = (FAR dq_entry_t *)tcb;
+    }
+  else
+    {
+      next = prev->flink;
+      prev->flink = tcb;
+    }
+
+  tcb->blink = prev;
+  tcb->flink = next;
+
+  if (next == NULL)
+    {
+      g_readytorun.tail = (FAR dq_entry_t *)tcb;
+    }
+  else
+    {
+      next->blink = tcb;
+    }
+
+  return prev == NULL;
+}
+
+/****************************************************************************
+ * Name: sched_rtr_remove
+ *
+ * Description:
+ *   Remove a TCB from g_readytorun.  Its priority must not have changed
+ *   since it was added.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void sched_rtr_remove(FAR struct tcb_s *tcb)
+{
+  FAR struct tcb_s *prev = tcb->blink;
+  int priority = tcb->sched_priority;
+
+  if (g_rtr_last[priority] == tcb)
+    {
+      if (prev != NULL && prev->sched_priority == priority)
+        {
+          g_rtr_last[priority] = prev;
+        }
+      else
+        {
+          g_rtr_last[priority] = NULL;
+          g_rtr_bitmap[priority >> 5] &= ~((uint32_t)1 << (priority & 31));
+        }
+    }
+
+  dq_rem((FAR dq_entry_t *)tcb, (FAR dq_queue_t *)&g_readytorun);
+}
+
+#endif /* CONFIG_SCHED_READYBITMAP */
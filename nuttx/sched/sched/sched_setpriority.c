@@ -149,9 +149,19 @@ int sched_setpriority(FAR struct tcb_s *tcb, int sched_priority)
 
         else
           {
+#ifdef CONFIG_SCHED_READYBITMAP
+            /* The task stays at the head, but the last task of each
+             * priority must be kept track of.
+             */
+
+            sched_rtr_remove(tcb);
+            tcb->sched_priority = (uint8_t)sched_priority;
+            (void)sched_rtr_add(tcb);
+#else
             /* Change the task priority */
 
             tcb->sched_priority = (uint8_t)sched_priority;
+#endif
           }
         break;
 
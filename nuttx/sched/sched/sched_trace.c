@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/sched_trace.h>
+
+#ifdef CONFIG_SCHED_TRACE_ITM
+#  include <arch/arm/itm.h>
+#else
+#  include <nuttx/hires_tmr.h>
+#endif
+
+#ifdef CONFIG_SCHED_TRACE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SCHED_TRACE_NTYPES  (SCHED_TRACE_GB_RESPONSE + 1)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifndef CONFIG_SCHED_TRACE_ITM
+static struct sched_trace_event_s g_trace_ring[CONFIG_SCHED_TRACE_NEVENTS];
+
+/* Number of events recorded since the start, including the overwritten
+ * ones.
+ */
+
+static uint32_t g_trace_count;
+#else
+static bool g_trace_itm_ready;
+#endif
+
+static bool g_trace_active;
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_TRACE_ITM
+/****************************************************************************
+ * Name: sched_trace
+ *
+ * Description:
+ *   The two packets of an event are written with the interrupts disabled,
+ *   so that the decoder finds them next to each other on their port.
+ *
+ ****************************************************************************/
+
+void sched_trace(uint8_t type, uint16_t arg1, uint32_t arg2)
+{
+  irqstate_t flags;
+
+  if (!g_trace_active)
+    {
+      return;
+    }
+
+  flags = irqsave();
+  itm_trace16(CONFIG_SCHED_TRACE_ITM_PORT + type, arg1);
+  itm_trace32(CONFIG_SCHED_TRACE_ITM_PORT + type, arg2);
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: sched_trace_start
+ ****************************************************************************/
+
+void sched_trace_start(void)
+{
+  int type;
+
+  if (!g_trace_itm_ready)
+    {
+      itm_trace_init();
+      for (type = 0; type < SCHED_TRACE_NTYPES; type++)
+        {
+          itm_enable_port(CONFIG_SCHED_TRACE_ITM_PORT + type);
+        }
+
+      g_trace_itm_ready = true;
+    }
+
+  g_trace_active = true;
+}
+
+/****************************************************************************
+ * Name: sched_trace_stop
+ ****************************************************************************/
+
+void sched_trace_stop(void)
+{
+  g_trace_active = false;
+}
+
+/****************************************************************************
+ * Name: sched_trace_foreach
+ *
+ * Description:
+ *   The events went out over SWO, nothing is kept.
+ *
+ ****************************************************************************/
+
+int sched_trace_foreach(sched_trace_foreach_t handler, FAR void *arg)
+{
+  return g_trace_active ? -EBUSY : 0;
+}
+
+#else /* CONFIG_SCHED_TRACE_ITM */
+/****************************************************************************
+ * Name: sched_trace
+ ****************************************************************************/
+
+void sched_trace(uint8_t type, uint16_t arg1, uint32_t arg2)
+{
+  FAR struct sched_trace_event_s *event;
+  irqstate_t flags;
+
+  if (!g_trace_active)
+    {
+      return;
+    }
+
+  flags = irqsave();
+
+  event = &g_trace_ring[g_trace_count % CONFIG_SCHED_TRACE_NEVENTS];
+  event->usec = hrt_getusec();
+  event->arg2 = arg2;
+  event->arg1 = arg1;
+  event->type = type;
+  g_trace_count++;
+
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: sched_trace_start
+ ****************************************************************************/
+
+void sched_trace_start(void)
+{
+  irqstate_t flags;
+
+  flags = irqsave();
+  g_trace_count  = 0;
+  g_trace_active = true;
+  irqrestore(flags);
+}
+
+/****************************************************************************
+ * Name: sched_trace_stop
+ ****************************************************************************/
+
+void sched_trace_stop(void)
+{
+  g_trace_active = false;
+}
+
+/****************************************************************************
+ * Name: sched_trace_foreach
+ ****************************************************************************/
+
+int sched_trace_foreach(sched_trace_foreach_t handler, FAR void *arg)
+{
+  uint32_t first = 0;
+  uint32_t i;
+
+  if (g_trace_active)
+    {
+      return -EBUSY;
+    }
+
+  if (g_trace_count > CONFIG_SCHED_TRACE_NEVENTS)
+    {
+      first = g_trace_count - CONFIG_SCHED_TRACE_NEVENTS;
+    }
+
+  for (i = first; i < g_trace_count; i++)
+    {
+      handler(&g_trace_ring[i % CONFIG_SCHED_TRACE_NEVENTS], arg);
+    }
+
+  return first;
+}
+
+#endif /* CONFIG_SCHED_TRACE_ITM */
+#endif /* CONFIG_SCHED_TRACE */
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/mutex.h>
+#include <nuttx/sched_trace.h>
+
+#include "sched/sched.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The owner word holds the owner pid + 1, so that 0 means free even for the
+ * idle task, and a flag telling the owner to take the slow path on unlock.
+ */
+
+#define MUTEX_WAITERS       0x80000000
+#define MUTEX_OWNERMASK     0x0000ffff
+#define MUTEX_OWNER(pid)    ((uint32_t)(pid) + 1)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mutex_topwaiter
+ *
+ * Description:
+ *   Return the highest priority task waiting for the mutex, if any.  The
+ *   list of tasks waiting for semaphores is sorted by priority.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+static FAR struct tcb_s *mutex_topwaiter(FAR mutex_t *mutex)
+{
+  FAR struct tcb_s *stcb;
+
+  for (stcb = (FAR struct tcb_s *)g_waitingforsemaphore.head;
+       stcb && stcb->waitsem != &mutex->sem;
+       stcb = stcb->flink);
+
+  return stcb;
+}
+
+/****************************************************************************
+ * Name: mutex_boost
+ *
+ * Description:
+ *   Raise the owner of the mutex to the given priority, remembering the
+ *   priority to restore at unlock on the first boost.  The restoration
+ *   assumes that the boosts from other mutexes and semaphores held by the
+ *   owner are released in the reverse order.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+static void mutex_boost(FAR mutex_t *mutex, FAR struct tcb_s *htcb,
+                        uint8_t priority)
+{
+  if (htcb != NULL && htcb->sched_priority < priority)
+    {
+      if (mutex->holdprio == 0)
+        {
+          mutex->holdprio = htcb->sched_priority;
+        }
+
+      (void)sched_setpriority(htcb, priority);
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: mutex_wait
+ *
+ * Description:
+ *   Block the running task on the semaphore of the mutex until an unlock
+ *   or a signal wakes it up.  This is the blocking part of sem_wait()
+ *   without the semaphore holder bookkeeping: the mutex tracks its single
+ *   owner itself, and the holder list would otherwise boost tasks that
+ *   were merely woken.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+static void mutex_wait(FAR mutex_t *mutex)
+{
+  FAR struct tcb_s *rtcb = (FAR struct tcb_s *)g_readytorun.head;
+
+  ASSERT(rtcb->waitsem == NULL);
+
+  mutex->sem.semcount--;
+  rtcb->waitsem = &mutex->sem;
+
+  sched_trace(SCHED_TRACE_SEM_WAIT, rtcb->pid, (uintptr_t)&mutex->sem);
+  up_block_task(rtcb, TSTATE_WAIT_SEM);
+  sched_trace(SCHED_TRACE_SEM_WAKE, rtcb->pid, (uintptr_t)&mutex->sem);
+}
+
+/****************************************************************************
+ * Name: mutex_lockslow
+ *
+ * Description:
+ *   Lock a mutex that was found owned.  Interrupts stay disabled while the
+ *   owner word is examined, so plain accesses are enough against the other
+ *   tasks on this uniprocessor.  An exclusive access interrupted by this
+ *   path fails its store and retries.
+ *
+ ****************************************************************************/
+
+static int mutex_lockslow(FAR mutex_t *mutex, uint32_t me, bool wait)
+{
+#ifdef CONFIG_PRIORITY_INHERITANCE
+  FAR struct tcb_s *rtcb = (FAR struct tcb_s *)g_readytorun.head;
+  FAR struct tcb_s *stcb;
+#endif
+  irqstate_t flags;
+  uint32_t owner;
+  int ret = OK;
+
+  flags = irqsave();
+
+  for (; ; )
+    {
+      owner = atomic_get(&mutex->owner);
+      if ((owner & MUTEX_OWNERMASK) == 0)
+        {
+          /* Released since we looked, or we were woken up: take it, and
+           * keep the unlock on the slow path if others still wait.
+           */
+
+          if (mutex->sem.semcount < 0)
+            {
+              atomic_init(&mutex->owner, me | MUTEX_WAITERS);
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+              /* Inherit the priority of the remaining waiters */
+
+              stcb = mutex_topwaiter(mutex);
+              if (stcb != NULL)
+                {
+                  mutex_boost(mutex, rtcb, stcb->sched_priority);
+                }
+#endif
+            }
+          else
+            {
+              atomic_init(&mutex->owner, me);
+            }
+
+          break;
+        }
+
+      if ((owner & MUTEX_OWNERMASK) == me)
+        {
+          ret = -EDEADLK;
+          break;
+        }
+
+      if (!wait)
+        {
+          ret = -EBUSY;
+          break;
+        }
+
+      atomic_init(&mutex->owner, owner | MUTEX_WAITERS);
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+      /* The owner cannot go away while interrupts are disabled, and it
+       * blocks the scheduler from here until our wait starts.
+       */
+
+      sched_lock();
+      mutex_boost(mutex, sched_gettcb((owner & MUTEX_OWNERMASK) - 1),
+                  rtcb->sched_priority);
+      mutex_wait(mutex);
+      sched_unlock();
+#else
+      mutex_wait(mutex);
+#endif
+
+      /* Woken by an unlock or by a signal, try again */
+    }
+
+  irqrestore(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mutex_init
+ *
+ * Description:
+ *   Initialize an unlocked mutex.
+ *
+ ****************************************************************************/
+
+int mutex_init(FAR mutex_t *mutex)
+{
+  DEBUGASSERT(mutex != NULL);
+
+  atomic_init(&mutex->owner, 0);
+  mutex->holdprio = 0;
+  return sem_init(&mutex->sem, 0, 0) == OK ? OK : -get_errno();
+}
+
+/****************************************************************************
+ * Name: mutex_destroy
+ *
+ * Description:
+ *   Release the resources of an unlocked mutex.
+ *
+ ****************************************************************************/
+
+int mutex_destroy(FAR mutex_t *mutex)
+{
+  DEBUGASSERT(mutex != NULL && atomic_get(&mutex->owner) == 0);
+
+  return sem_destroy(&mutex->sem) == OK ? OK : -get_errno();
+}
+
+/****************************************************************************
+ * Name: mutex_lock
+ *
+ * Description:
+ *   Lock the mutex, waiting for it as long as necessary.
+ *
+ ****************************************************************************/
+
+int mutex_lock(FAR mutex_t *mutex)
+{
+  uint32_t me = MUTEX_OWNER(getpid());
+
+  DEBUGASSERT(mutex != NULL && !up_interrupt_context());
+
+  if (atomic_cmpxchg(&mutex->owner, 0, me) == 0)
+    {
+      return OK;
+    }
+
+  return mutex_lockslow(mutex, me, true);
+}
+
+/****************************************************************************
+ * Name: mutex_trylock
+ *
+ * Description:
+ *   Lock the mutex if it is free.
+ *
+ ****************************************************************************/
+
+int mutex_trylock(FAR mutex_t *mutex)
+{
+  uint32_t me = MUTEX_OWNER(getpid());
+  int ret;
+
+  DEBUGASSERT(mutex != NULL && !up_interrupt_context());
+
+  if (atomic_cmpxchg(&mutex->owner, 0, me) == 0)
+    {
+      return OK;
+    }
+
+  ret = mutex_lockslow(mutex, me, false);
+  return ret == -EDEADLK ? -EBUSY : ret;
+}
+
+/****************************************************************************
+ * Name: mutex_unlock
+ *
+ * Description:
+ *   Unlock a mutex owned by the caller and wake the highest priority
+ *   waiter, if any.
+ *
+ ****************************************************************************/
+
+int mutex_unlock(FAR mutex_t *mutex)
+{
+  uint32_t me = MUTEX_OWNER(getpid());
+#ifdef CONFIG_PRIORITY_INHERITANCE
+  FAR struct tcb_s *rtcb;
+  uint8_t holdprio;
+#endif
+  irqstate_t flags;
+
+  DEBUGASSERT(mutex != NULL && !up_interrupt_context());
+
+  if (atomic_cmpxchg(&mutex->owner, me, 0) == me)
+    {
+      return OK;
+    }
+
+  /* Somebody waits, or the caller is not the owner */
+
+  flags = irqsave();
+
+  if ((atomic_get(&mutex->owner) & MUTEX_OWNERMASK) != me)
+    {
+      irqrestore(flags);
+      return -EPERM;
+    }
+
+  atomic_init(&mutex->owner, 0);
+
+  /* Do not let the woken waiter run before our priority is restored */
+
+  sched_lock();
+
+  if (mutex->sem.semcount < 0)
+    {
+      (void)sem_post(&mutex->sem);
+    }
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+  holdprio = mutex->holdprio;
+  if (holdprio != 0)
+    {
+      rtcb = (FAR struct tcb_s *)g_readytorun.head;
+      mutex->holdprio = 0;
+      (void)sched_setpriority(rtcb, holdprio);
+    }
+#endif
+
+  sched_unlock();
+  irqrestore(flags);
+  return OK;
+}
@@ -106,6 +106,15 @@ int sem_post(FAR sem_t *sem)
   irqstate_t saved_state;
   int ret = ERROR;
 
+#ifdef CONFIG_SEM_FASTPATH
+  /* Give the count without entering the critical section if nobody waits */
+
+  if (sem && sem_fastgive(sem))
+    {
+      return OK;
+    }
+#endif
+
   /* Make sure we were supplied with a valid semaphore. */
 
   if (sem)
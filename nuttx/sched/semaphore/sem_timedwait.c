@@ -184,18 +184,6 @@ int sem_timedwait(FAR sem_t *sem, FAR const struct timespec *abstime)
     }
 #endif
 
-  /* Create a watchdog.  We will not actually need this watchdog
-   * unless the semaphore is unavailable, but we will reserve it up
-   * front before we enter the following critical section.
-   */
-
-  rtcb->waitdog = wd_create();
-  if (!rtcb->waitdog)
-    {
-      err = ENOMEM;
-      goto errout;
-    }
-
   /* We will disable interrupts until we have completed the semaphore
    * wait.  We need to do this (as opposed to just disabling pre-emption)
    * because there could be interrupt handlers that are asynchronoulsy
@@ -214,8 +202,6 @@ int sem_timedwait(FAR sem_t *sem, FAR const struct timespec *abstime)
       /* We got it! */
 
       irqrestore(flags);
-      wd_delete(rtcb->waitdog);
-      rtcb->waitdog = NULL;
       return OK;
     }
 
@@ -250,9 +236,10 @@ int sem_timedwait(FAR sem_t *sem, FAR const struct timespec *abstime)
       goto errout_disabled;
     }
 
-  /* Start the watchdog */
+  /* Start the watchdog embedded in the TCB: no watchdog is allocated */
 
   err = OK;
+  rtcb->waitdog = &rtcb->waittimer;
   wd_start(rtcb->waitdog, ticks, (wdentry_t)sem_timeout, 1, getpid());
 
   /* Now perform the blocking wait */
@@ -262,12 +249,11 @@ int sem_timedwait(FAR sem_t *sem, FAR const struct timespec *abstime)
   /* Stop the watchdog timer */
 
   wd_cancel(rtcb->waitdog);
+  rtcb->waitdog = NULL;
 
-  /* We can now restore interrupts and delete the watchdog */
+  /* We can now restore interrupts */
 
   irqrestore(flags);
-  wd_delete(rtcb->waitdog);
-  rtcb->waitdog = NULL;
 
   /* We are either returning success or an error detected by sem_wait()
    * or the timeout detected by sem_timeout().  The 'errno' value has
@@ -281,10 +267,10 @@ int sem_timedwait(FAR sem_t *sem, FAR const struct timespec *abstime)
 
 errout_disabled:
   irqrestore(flags);
-  wd_delete(rtcb->waitdog);
-  rtcb->waitdog = NULL;
 
+#ifdef CONFIG_DEBUG
 errout:
+#endif
   set_errno(err);
   return ERROR;
 }
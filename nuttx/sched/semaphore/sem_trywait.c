@@ -104,6 +104,15 @@ int sem_trywait(FAR sem_t *sem)
 
   DEBUGASSERT(up_interrupt_context() == false)
 
+#ifdef CONFIG_SEM_FASTPATH
+  /* Take an available count without entering the critical section */
+
+  if (sem && sem_fasttake(sem))
+    {
+      return OK;
+    }
+#endif
+
   /* Assume any errors reported are due to invalid arguments. */
 
   set_errno(EINVAL);
@@ -104,6 +104,15 @@ int sem_wait(FAR sem_t *sem)
 
   DEBUGASSERT(up_interrupt_context() == false)
 
+#ifdef CONFIG_SEM_FASTPATH
+  /* Take an available count without entering the critical section */
+
+  if (sem && sem_fasttake(sem))
+    {
+      return OK;
+    }
+#endif
+
   /* Assume any errors reported are due to invalid arguments. */
 
   set_errno(EINVAL);
@@ -169,7 +178,9 @@ int sem_wait(FAR sem_t *sem)
           /* Add the TCB to the prioritized semaphore wait queue */
 
           set_errno(0);
+          sched_trace(SCHED_TRACE_SEM_WAIT, rtcb->pid, (uintptr_t)sem);
           up_block_task(rtcb, TSTATE_WAIT_SEM);
+          sched_trace(SCHED_TRACE_SEM_WAKE, rtcb->pid, (uintptr_t)sem);
 
           /* When we resume at this point, either (1) the semaphore has been
            * assigned to this thread of execution, or (2) the semaphore wait
@@ -45,10 +45,15 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 #include <semaphore.h>
 #include <sched.h>
 #include <queue.h>
 
+#ifdef CONFIG_SEM_FASTPATH
+#  include <arch/atomic.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -123,6 +128,75 @@ void sem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem);
 #  define sem_canceled(stcb, sem)
 #endif
 
+/****************************************************************************
+ * Name: sem_fasttake
+ *
+ * Description:
+ *   Take a count with an exclusive access if one is available, without
+ *   disabling interrupts.  Any interrupt or context switch in between
+ *   clears the exclusive monitor, so the slow paths, which update the
+ *   count with interrupts disabled, cannot be overwritten.
+ *
+ * Returned Value:
+ *   true if the count was taken, false if the caller must take the slow
+ *   path and possibly block.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SEM_FASTPATH
+static inline bool sem_fasttake(FAR sem_t *sem)
+{
+  FAR volatile int16_t *semcount = (FAR volatile int16_t *)&sem->semcount;
+  int16_t count = *semcount;
+  int16_t prev;
+
+  while (count > 0)
+    {
+      prev = atomic_cmpxchg16(semcount, count, count - 1);
+      if (prev == count)
+        {
+          return true;
+        }
+
+      count = prev;
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: sem_fastgive
+ *
+ * Description:
+ *   Give a count back with an exclusive access if no task waits for it.
+ *
+ * Returned Value:
+ *   true if the count was given, false if the caller must take the slow
+ *   path and wake up a waiter.
+ *
+ ****************************************************************************/
+
+static inline bool sem_fastgive(FAR sem_t *sem)
+{
+  FAR volatile int16_t *semcount = (FAR volatile int16_t *)&sem->semcount;
+  int16_t count = *semcount;
+  int16_t prev;
+
+  while (count >= 0 && count < SEM_VALUE_MAX)
+    {
+      prev = atomic_cmpxchg16(semcount, count, count + 1);
+      if (prev == count)
+        {
+          return true;
+        }
+
+      count = prev;
+    }
+
+  return false;
+}
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
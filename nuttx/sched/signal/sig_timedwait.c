@@ -257,39 +257,28 @@ int sigtimedwait(FAR const sigset_t *set, FAR struct siginfo *info,
           waitticks = MSEC2TICK(waitmsec);
 #endif
 
-          /* Create a watchdog */
-
-          rtcb->waitdog = wd_create();
-          DEBUGASSERT(rtcb->waitdog);
-
-          if (rtcb->waitdog)
-            {
-              /* This little bit of nonsense is necessary for some
-               * processors where sizeof(pointer) < sizeof(uint32_t).
-               * see wdog.h.
-               */
-
-              wdparm_t wdparm;
-              wdparm.pvarg = (FAR void *)rtcb;
+          /* This little bit of nonsense is necessary for some
+           * processors where sizeof(pointer) < sizeof(uint32_t).
+           * see wdog.h.
+           */
 
-              /* Start the watchdog */
+          wdparm_t wdparm;
+          wdparm.pvarg = (FAR void *)rtcb;
 
-              wd_start(rtcb->waitdog, waitticks, (wdentry_t)sig_timeout, 1,
-                       wdparm.dwarg);
+          /* Start the watchdog embedded in the TCB */
 
-              /* Now wait for either the signal or the watchdog */
+          rtcb->waitdog = &rtcb->waittimer;
+          wd_start(rtcb->waitdog, waitticks, (wdentry_t)sig_timeout, 1,
+                   wdparm.dwarg);
 
-              up_block_task(rtcb, TSTATE_WAIT_SIG);
+          /* Now wait for either the signal or the watchdog */
 
-              /* We no longer need the watchdog */
+          up_block_task(rtcb, TSTATE_WAIT_SIG);
 
-              wd_delete(rtcb->waitdog);
-              rtcb->waitdog = NULL;
-            }
+          /* We no longer need the watchdog */
 
-          /* REVISIT: And do what if there are no watchdog timers?  The wait
-           * will fail and we will return something bogus.
-           */
+          wd_cancel(rtcb->waitdog);
+          rtcb->waitdog = NULL;
         }
 
       /* No timeout, just wait */
@@ -357,6 +357,12 @@ static int thread_schedsetup(FAR struct tcb_s *tcb, int priority,
 
       task_saveparent(tcb, ttype);
 
+      /* The watchdog of the timed waits is part of the TCB so that these
+       * waits never have to allocate one.
+       */
+
+      wd_static(&tcb->waittimer);
+
       /* exec(), pthread_create(), task_create(), and vfork() all
        * inherit the signal mask of the parent thread.
        */
@@ -108,6 +108,9 @@ int wd_cancel(WDOG_ID wdog)
 
   if (wdog && WDOG_ISACTIVE(wdog))
     {
+#ifdef CONFIG_WDOG_WHEEL
+      wd_wheel_remove(wdog);
+#else
       /* Search the g_wdactivelist for the target FCB.  We can't use sq_rem
        * to do this because there are additional operations that need to be
        * done.
@@ -158,9 +161,11 @@ int wd_cancel(WDOG_ID wdog)
           sched_timer_reassess();
         }
 
+      wdog->next = NULL;
+#endif
+
       /* Mark the watchdog inactive */
 
-      wdog->next = NULL;
       WDOG_CLRACTIVE(wdog);
 
       /* Return success */
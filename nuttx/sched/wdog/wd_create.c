@@ -126,6 +126,9 @@ WDOG_ID wd_create (void)
 
           wdog->next = NULL;
           wdog->flags = 0;
+#ifdef CONFIG_WDOG_SLACK
+          wdog->slack = 0;
+#endif
         }
     }
 
@@ -149,6 +152,9 @@ WDOG_ID wd_create (void)
 
           wdog->next  = NULL;
           wdog->flags = WDOGF_ALLOCED;
+#ifdef CONFIG_WDOG_SLACK
+          wdog->slack = 0;
+#endif
         }
     }
 
@@ -42,6 +42,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sched.h>
 #include <assert.h>
@@ -96,6 +97,56 @@ typedef void (*wdentry4_t)(int argc, uint32_t arg1, uint32_t arg2,
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
+
+/****************************************************************************
+ * Name: wd_execute
+ *
+ * Description:
+ *   Call the function of an expired watchdog.
+ *
+ ****************************************************************************/
+
+static inline void wd_execute(FAR struct wdog_s *wdog)
+{
+  up_setpicbase(wdog->picbase);
+  switch (wdog->argc)
+    {
+      default:
+        DEBUGPANIC();
+        break;
+
+      case 0:
+        (*((wdentry0_t)(wdog->func)))(0);
+        break;
+
+#if CONFIG_MAX_WDOGPARMS > 0
+      case 1:
+        (*((wdentry1_t)(wdog->func)))(1, wdog->parm[0]);
+        break;
+#endif
+#if CONFIG_MAX_WDOGPARMS > 1
+      case 2:
+        (*((wdentry2_t)(wdog->func)))(2,
+                        wdog->parm[0], wdog->parm[1]);
+        break;
+#endif
+#if CONFIG_MAX_WDOGPARMS > 2
+      case 3:
+        (*((wdentry3_t)(wdog->func)))(3,
+                        wdog->parm[0], wdog->parm[1],
+                        wdog->parm[2]);
+        break;
+#endif
+#if CONFIG_MAX_WDOGPARMS > 3
+      case 4:
+        (*((wdentry4_t)(wdog->func)))(4,
+                        wdog->parm[0], wdog->parm[1],
+                        wdog->parm[2] ,wdog->parm[3]);
+        break;
+#endif
+    }
+}
+
 /****************************************************************************
  * Name: wd_expiration
  *
@@ -113,6 +164,7 @@ typedef void (*wdentry4_t)(int argc, uint32_t arg1, uint32_t arg2,
  *
  ****************************************************************************/
 
+#ifndef CONFIG_WDOG_WHEEL
 static inline void wd_expiration(void)
 {
   FAR struct wdog_s *wdog;
@@ -147,46 +199,52 @@ static inline void wd_expiration(void)
 
           /* Execute the watchdog function */
 
-          up_setpicbase(wdog->picbase);
-          switch (wdog->argc)
-            {
-              default:
-                DEBUGPANIC();
-                break;
+          wd_execute(wdog);
+        }
+    }
+}
+#endif
 
-              case 0:
-                (*((wdentry0_t)(wdog->func)))(0);
-                break;
+/****************************************************************************
+ * Name: wd_nextdelay
+ *
+ * Description:
+ *   Return the delay to program for the next timer interrupt: the earliest
+ *   time at which some watchdog runs out of slack.  Every watchdog due by
+ *   then expires in that same interrupt.  The walk stops at the first
+ *   watchdog due after that time, as none after it can lower it.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return Value:
+ *   The delay in ticks, zero if there is no active watchdog.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
 
-#if CONFIG_MAX_WDOGPARMS > 0
-              case 1:
-                (*((wdentry1_t)(wdog->func)))(1, wdog->parm[0]);
-                break;
-#endif
-#if CONFIG_MAX_WDOGPARMS > 1
-              case 2:
-                (*((wdentry2_t)(wdog->func)))(2,
-                                wdog->parm[0], wdog->parm[1]);
-                break;
-#endif
-#if CONFIG_MAX_WDOGPARMS > 2
-              case 3:
-                (*((wdentry3_t)(wdog->func)))(3,
-                                wdog->parm[0], wdog->parm[1],
-                                wdog->parm[2]);
-                break;
-#endif
-#if CONFIG_MAX_WDOGPARMS > 3
-              case 4:
-                (*((wdentry4_t)(wdog->func)))(4,
-                                wdog->parm[0], wdog->parm[1],
-                                wdog->parm[2] ,wdog->parm[3]);
-                break;
-#endif
-            }
+#ifdef CONFIG_WDOG_SLACK
+static unsigned int wd_nextdelay(void)
+{
+  FAR struct wdog_s *wdog;
+  int delay = INT_MAX;
+  int now = 0;
+
+  for (wdog = (FAR struct wdog_s *)g_wdactivelist.head;
+       wdog && (now += wdog->lag) < delay;
+       wdog = wdog->next)
+    {
+      if (now + wdog->slack < delay)
+        {
+          delay = now + wdog->slack;
         }
     }
+
+  return delay == INT_MAX ? 0 : delay;
 }
+#endif
 
 /****************************************************************************
  * Public Functions
@@ -228,10 +286,12 @@ static inline void wd_expiration(void)
 int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
 {
   va_list ap;
+#ifndef CONFIG_WDOG_WHEEL
   FAR struct wdog_s *curr;
   FAR struct wdog_s *prev;
   FAR struct wdog_s *next;
   int32_t now;
+#endif
   irqstate_t state;
   int i;
 
@@ -285,6 +345,11 @@ int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
       delay--;
     }
 
+#ifdef CONFIG_WDOG_WHEEL
+  /* The wheel slot follows from the expiration tick: no list walk */
+
+  wd_wheel_add(wdog, delay);
+#else
 #ifdef CONFIG_SCHED_TICKLESS
   /* Cancel the interval timer that drives the timing events.  This will cause
    * wd_timer to be called which update the delay value for the first time
@@ -383,6 +448,7 @@ int wd_start(WDOG_ID wdog, int delay, wdentry_t wdentry,  int argc, ...)
   /* Put the lag into the watchdog structure and mark it as active. */
 
   wdog->lag = delay;
+#endif
   WDOG_SETACTIVE(wdog);
 
 #ifdef CONFIG_SCHED_TICKLESS
@@ -437,10 +503,11 @@ unsigned int wd_timer(int ticks)
 
       wdog = (FAR struct wdog_s *)g_wdactivelist.head;
 
-#ifndef CONFIG_SCHED_TICKLESS_ALARM
+#if !defined(CONFIG_SCHED_TICKLESS_ALARM) && !defined(CONFIG_WDOG_SLACK)
       /* There is logic to handle the case where ticks is greater than
        * the watchdog lag, but if the scheduling is working properly
-       * that should never happen.
+       * that should never happen.  With slack, the interval may well run
+       * past several watchdogs.
        */
 
       DEBUGASSERT(ticks <= wdog->lag);
@@ -452,7 +519,7 @@ unsigned int wd_timer(int ticks)
       /* There are.  Decrement the lag counter */
 
       wdog->lag -= decr;
-      ticks     -= ticks;
+      ticks     -= decr;
 
       /* Check if the watchdog at the head of the list is ready to run */
 
@@ -461,8 +528,32 @@ unsigned int wd_timer(int ticks)
 
   /* Return the delay for the next watchdog to expire */
 
+#ifdef CONFIG_WDOG_SLACK
+  return wd_nextdelay();
+#else
   return g_wdactivelist.head ?
          ((FAR struct wdog_s *)g_wdactivelist.head)->lag : 0;
+#endif
+}
+
+#elif defined(CONFIG_WDOG_WHEEL)
+void wd_timer(void)
+{
+  FAR struct wdog_s *wdog;
+  FAR struct wdog_s *next;
+
+  /* Run the watchdogs expiring at this tick.  They are already out of the
+   * wheel, so they may be restarted from their function.
+   */
+
+  for (wdog = wd_wheel_tick(); wdog; wdog = next)
+    {
+      next = wdog->next;
+      wdog->next = NULL;
+
+      WDOG_CLRACTIVE(wdog);
+      wd_execute(wdog);
+    }
 }
 
 #else
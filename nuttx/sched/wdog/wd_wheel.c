@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <queue.h>
+#include <assert.h>
+
+#include <nuttx/wdog.h>
+
+#include "wdog/wdog.h"
+
+#ifdef CONFIG_WDOG_WHEEL
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Three levels of 64 slots.  Level n slots are 64^n ticks wide: a watchdog
+ * expiring in less than 64 ticks is in the level 0 slot of its expiration
+ * tick, one expiring in less than 64^2 ticks in the level 1 slot of its
+ * expiration tick / 64, and so on.  Every 64^n ticks, the current slot of
+ * level n is cascaded down to the lower levels.
+ */
+
+#define WHEEL_BITS     6
+#define WHEEL_SLOTS    (1 << WHEEL_BITS)
+#define WHEEL_MASK     (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS   3
+
+#define WHEEL_SPAN(l)  ((uint32_t)1 << (WHEEL_BITS * ((l) + 1)))
+#define WHEEL_INDEX(tick, l) (((tick) >> (WHEEL_BITS * (l))) & WHEEL_MASK)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static sq_queue_t g_wdwheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/* The current tick.  It only serves to place the watchdogs in the wheel. */
+
+static uint32_t g_wdnow;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: wd_wheel_insert
+ *
+ * Description:
+ *   Put a watchdog in the slot of the lowest level that covers its
+ *   expiration.  Beyond the span of the wheel, the watchdog goes to the
+ *   level 2 slot which is cascaded last, and is placed again then.
+ *
+ ****************************************************************************/
+
+static void wd_wheel_insert(FAR struct wdog_s *wdog)
+{
+  uint32_t delta = wdog->expires - g_wdnow;
+  FAR sq_queue_t *slot;
+  int level;
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    {
+      if (delta < WHEEL_SPAN(level))
+        {
+          break;
+        }
+    }
+
+  if (delta < WHEEL_SPAN(level))
+    {
+      slot = &g_wdwheel[level][WHEEL_INDEX(wdog->expires, level)];
+    }
+  else
+    {
+      slot = &g_wdwheel[level][WHEEL_INDEX(g_wdnow, level)];
+    }
+
+  sq_addlast((FAR sq_entry_t *)wdog, slot);
+  wdog->slot = slot;
+}
+
+/****************************************************************************
+ * Name: wd_wheel_cascade
+ *
+ * Description:
+ *   Place again the watchdogs of a slot, which now expire closer than the
+ *   span of the slot's level.
+ *
+ ****************************************************************************/
+
+static void wd_wheel_cascade(FAR sq_queue_t *slot)
+{
+  FAR struct wdog_s *wdog;
+  FAR struct wdog_s *next;
+
+  wdog = (FAR struct wdog_s *)slot->head;
+  sq_init(slot);
+
+  for (; wdog; wdog = next)
+    {
+      next = wdog->next;
+      wdog->next = NULL;
+      wd_wheel_insert(wdog);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: wd_wheel_add
+ *
+ * Description:
+ *   Add a watchdog expiring in 'delay' ticks to the wheel.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void wd_wheel_add(FAR struct wdog_s *wdog, int delay)
+{
+  DEBUGASSERT(delay > 0);
+
+  wdog->expires = g_wdnow + delay;
+  wd_wheel_insert(wdog);
+}
+
+/****************************************************************************
+ * Name: wd_wheel_remove
+ *
+ * Description:
+ *   Remove an active watchdog from the wheel.  Only the watchdogs of the
+ *   same slot are walked.
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void wd_wheel_remove(FAR struct wdog_s *wdog)
+{
+  DEBUGASSERT(wdog->slot != NULL);
+
+  sq_rem((FAR sq_entry_t *)wdog, wdog->slot);
+  wdog->slot = NULL;
+  wdog->next = NULL;
+}
+
+/****************************************************************************
+ * Name: wd_wheel_remaining
+ *
+ * Description:
+ *   Return the ticks remaining before an active watchdog expires.
+ *
+ ****************************************************************************/
+
+int wd_wheel_remaining(FAR struct wdog_s *wdog)
+{
+  return (int)(wdog->expires - g_wdnow);
+}
+
+/****************************************************************************
+ * Name: wd_wheel_tick
+ *
+ * Description:
+ *   Advance the wheel by one tick.
+ *
+ * Return Value:
+ *   The list, linked by 'next', of the watchdogs expiring at this tick,
+ *   which are no longer in the wheel.
+ *
+ * Assumptions:
+ *   Called from the timer interrupt with interrupts disabled.
+ *
+ ****************************************************************************/
+
+FAR struct wdog_s *wd_wheel_tick(void)
+{
+  FAR struct wdog_s *expired;
+  FAR struct wdog_s *wdog;
+  FAR sq_queue_t *slot;
+  int level;
+
+  g_wdnow++;
+
+  /* Cascade from the highest level which starts a new slot at this tick,
+   * down to level 1, so that a watchdog can move down several levels.
+   */
+
+  for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+      if (WHEEL_INDEX(g_wdnow, level - 1) != 0)
+        {
+          break;
+        }
+    }
+
+  for (level--; level > 0; level--)
+    {
+      wd_wheel_cascade(&g_wdwheel[level][WHEEL_INDEX(g_wdnow, level)]);
+    }
+
+  /* Everything in the current level 0 slot expires now */
+
+  slot    = &g_wdwheel[0][WHEEL_INDEX(g_wdnow, 0)];
+  expired = (FAR struct wdog_s *)slot->head;
+  sq_init(slot);
+
+  for (wdog = expired; wdog; wdog = wdog->next)
+    {
+      DEBUGASSERT(wdog->expires == g_wdnow);
+      wdog->slot = NULL;
+    }
+
+  return expired;
+}
+
+#endif /* CONFIG_WDOG_WHEEL */
@@ -144,6 +144,26 @@ unsigned int wd_timer(int ticks);
 void wd_timer(void);
 #endif
 
+/****************************************************************************
+ * Name: wd_wheel_*
+ *
+ * Description:
+ *   The timing wheel holding the active watchdogs with CONFIG_WDOG_WHEEL,
+ *   instead of g_wdactivelist.  wd_wheel_tick() advances the wheel by one
+ *   tick and returns the list of the watchdogs which expired.
+ *
+ * Assumptions:
+ *   Called with interrupts disabled.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_WDOG_WHEEL
+void wd_wheel_add(FAR struct wdog_s *wdog, int delay);
+void wd_wheel_remove(FAR struct wdog_s *wdog);
+int  wd_wheel_remaining(FAR struct wdog_s *wdog);
+FAR struct wdog_s *wd_wheel_tick(void);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
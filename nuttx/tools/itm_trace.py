@@ -0,0 +1,202 @@
+#!/usr/bin/env python
+############################################################################
+# tools/itm_trace.py
+#
+# Copyright (c) 2016 Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 1. Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+# this list of conditions and the following disclaimer in the documentation
+# and/or other materials provided with the distribution.
+# 3. Neither the name of the copyright holder nor the names of its
+# contributors may be used to endorse or promote products derived from this
+# software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+# THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+############################################################################
+
+"""Decode the SWO stream written by CONFIG_SCHED_TRACE_ITM into the text
+format of the NSH "trace -dump" command, which sched_trace.py converts.
+
+usage: itm_trace.py [--cpu-freq HZ] [--port N] [--tasks <console-log>]
+                    <swo.bin> [<output.txt>]
+
+The SWO capture must be the raw ITM packet stream (TPIU formatter bypassed),
+as saved by OpenOCD "tpiu config ... -output <file>" or by the probe tools.
+Each event is a 16-bit packet (arg1) followed by a 32-bit packet (arg2) on
+port CONFIG_SCHED_TRACE_ITM_PORT + type, and is dated by the local timestamp
+packet that follows it.  Timestamps count CPU cycles and are converted to
+microseconds with --cpu-freq.
+
+The task names are not streamed: run "trace -start", "trace -stop" and then
+"trace -dump" on the console, and pass the console log with --tasks to copy
+its "T" lines.
+"""
+
+import argparse
+import re
+import sys
+
+NTYPES = 8  # Must match include/nuttx/sched_trace.h
+
+TASK_RE = re.compile(r'\bT (\d+) (.*)$')
+
+
+class ItmDecoder(object):
+    def __init__(self, base_port):
+        self.base_port = base_port
+        self.cycles = 0
+        self.pending = []       # events waiting for their timestamp
+        self.arg1 = {}          # port -> arg1 waiting for its arg2
+        self.events = []
+        self.lost = 0
+        self.overflows = 0
+
+    def _payload(self, data, i, count):
+        value = 0
+        for n in range(count):
+            value |= data[i + n] << (8 * n)
+        return value
+
+    def _continued(self, data, i):
+        """Return the 7-bit continued payload at i and the next index"""
+        value, shift = 0, 0
+        while i < len(data):
+            b = data[i]
+            value |= (b & 0x7f) << shift
+            shift += 7
+            i += 1
+            if not b & 0x80:
+                break
+        return value, i
+
+    def _timestamp(self, delta):
+        self.cycles += delta
+        for event in self.pending:
+            event[0] = self.cycles
+        self.pending = []
+
+    def _software(self, port, size, value):
+        etype = port - self.base_port
+        if etype < 0 or etype >= NTYPES:
+            return
+
+        if size == 2:
+            if port in self.arg1:
+                self.lost += 1
+            self.arg1[port] = value
+        elif size == 4:
+            if port not in self.arg1:
+                self.lost += 1
+                return
+            event = [self.cycles, etype, self.arg1.pop(port), value]
+            self.events.append(event)
+            self.pending.append(event)
+
+    def decode(self, data):
+        i = 0
+        while i < len(data):
+            b = data[i]
+            i += 1
+
+            if b & 0x03:
+                size = (1, 2, 4)[(b & 0x03) - 1]
+                if i + size > len(data):
+                    break
+                if not b & 0x04:
+                    self._software(b >> 3, size,
+                                   self._payload(data, i, size))
+                i += size
+            elif b == 0x00:
+                # Synchronization: zeros up to the final 0x80
+                while i < len(data) and data[i] == 0x00:
+                    i += 1
+                if i < len(data) and data[i] == 0x80:
+                    i += 1
+            elif b == 0x70:
+                self.overflows += 1
+            elif (b & 0x0f) == 0x00:
+                if b & 0x80:
+                    delta, i = self._continued(data, i)
+                else:
+                    delta = (b >> 4) & 0x07
+                self._timestamp(delta)
+            elif (b & 0x0b) == 0x08 or b in (0x94, 0xb4):
+                # Extension and global timestamp packets
+                if b & 0x80:
+                    _, i = self._continued(data, i)
+
+        self._timestamp(0)
+
+
+def read_tasks(path):
+    tasks = []
+    inside = False
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip('\r\n')
+            if '# sched_trace begin' in line:
+                tasks, inside = [], True
+            elif '# sched_trace end' in line:
+                inside = False
+            elif inside:
+                m = TASK_RE.search(line)
+                if m:
+                    tasks.append('T %s %s' % (m.group(1), m.group(2).strip()))
+    return tasks
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode an ITM trace captured over SWO')
+    parser.add_argument('--cpu-freq', type=int, default=48000000,
+                        help='CPU clock in Hz (default: 48000000)')
+    parser.add_argument('--port', type=int, default=8,
+                        help='CONFIG_SCHED_TRACE_ITM_PORT (default: 8)')
+    parser.add_argument('--tasks', metavar='LOG',
+                        help='console log holding a "trace -dump"')
+    parser.add_argument('input')
+    parser.add_argument('output', nargs='?')
+    args = parser.parse_args()
+
+    with open(args.input, 'rb') as f:
+        data = bytearray(f.read())
+
+    decoder = ItmDecoder(args.port)
+    decoder.decode(data)
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    out.write('# sched_trace begin\n')
+    if args.tasks:
+        for line in read_tasks(args.tasks):
+            out.write(line + '\n')
+    for cycles, etype, arg1, arg2 in decoder.events:
+        out.write('E %u %u %u %08x\n' %
+                  (cycles * 1000000 // args.cpu_freq, etype, arg1, arg2))
+    out.write('# sched_trace end, %u events, %u lost\n' %
+              (len(decoder.events), decoder.lost))
+    if out is not sys.stdout:
+        out.close()
+
+    if decoder.overflows:
+        sys.stderr.write('warning: %u ITM overflows, events are missing\n' %
+                         decoder.overflows)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+############################################################################
+# tools/profile.py
+#
+# Copyright (c) 2016 Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 1. Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+# this list of conditions and the following disclaimer in the documentation
+# and/or other materials provided with the distribution.
+# 3. Neither the name of the copyright holder nor the names of its
+# contributors may be used to endorse or promote products derived from this
+# software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+# THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+############################################################################
+
+"""Symbolize the output of the NSH "prof -dump" command against the ELF
+image and print a flat profile: the share of the samples spent in each
+function, overall and per task.
+
+usage: profile.py [--nm <nm>] [--tasks] <elf> <console-log>
+
+The console log may hold other output: only the "T" and "S" lines between
+"# profile begin" and "# profile end" are used. The symbols are read with
+arm-none-eabi-nm unless --nm gives another one.
+"""
+
+import bisect
+import collections
+import re
+import subprocess
+import sys
+
+TASK_RE = re.compile(r'\bT (\d+) (.*)$')
+SAMPLE_RE = re.compile(r'\bS ([0-9a-fA-F]{8}) (\d+) (\d+)\b')
+
+
+def parse(lines):
+    tasks = {}
+    samples = []
+    inside = False
+
+    for line in lines:
+        line = line.rstrip('\r\n')
+        if '# profile begin' in line:
+            tasks, samples, inside = {}, [], True
+            continue
+        if '# profile end' in line:
+            inside = False
+            continue
+        if not inside:
+            continue
+
+        m = SAMPLE_RE.search(line)
+        if m:
+            samples.append((int(m.group(1), 16), int(m.group(2)),
+                            int(m.group(3))))
+            continue
+
+        m = TASK_RE.search(line)
+        if m:
+            tasks[int(m.group(1))] = m.group(2).strip()
+
+    return tasks, samples
+
+
+def load_symbols(nm, elf):
+    """Return the sorted start addresses and names of the functions"""
+    out = subprocess.check_output([nm, '-n', '--defined-only', elf])
+    symbols = []
+
+    for line in out.decode().splitlines():
+        fields = line.split()
+        if len(fields) != 3 or fields[1] not in 'TtWw':
+            continue
+        # Thumb functions have the low bit of their address set
+        symbols.append((int(fields[0], 16) & ~1, fields[2]))
+
+    symbols.sort()
+    return [s[0] for s in symbols], [s[1] for s in symbols]
+
+
+def symbolize(addrs, names, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0:
+        return '0x%08x' % pc
+    return names[i]
+
+
+def print_profile(title, counts, total):
+    print(title)
+    print('%8s %7s  %s' % ('SAMPLES', '%', 'FUNCTION'))
+    for name, count in counts.most_common():
+        print('%8d %6.2f%%  %s' % (count, 100.0 * count / total, name))
+    print('')
+
+
+def main(argv):
+    args = argv[1:]
+    nm = 'arm-none-eabi-nm'
+    per_task = False
+
+    while args and args[0].startswith('--'):
+        if args[0] == '--nm' and len(args) > 1:
+            nm = args[1]
+            args = args[2:]
+        elif args[0] == '--tasks':
+            per_task = True
+            args = args[1:]
+        else:
+            break
+
+    if len(args) != 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(args[1]) as f:
+        tasks, samples = parse(f)
+
+    if not samples:
+        sys.stderr.write('no profile found in %s\n' % args[1])
+        return 1
+
+    addrs, names = load_symbols(nm, args[0])
+
+    functions = collections.Counter()
+    by_task = collections.defaultdict(collections.Counter)
+    for pc, pid, count in samples:
+        name = symbolize(addrs, names, pc)
+        functions[name] += count
+        by_task[pid][name] += count
+
+    total = sum(functions.values())
+    print_profile('%d samples' % total, functions, total)
+
+    if per_task:
+        for pid, counts in sorted(by_task.items(),
+                                  key=lambda t: -sum(t[1].values())):
+            task_total = sum(counts.values())
+            print_profile('%s (%d): %d samples, %.2f%%' %
+                          (tasks.get(pid, 'pid'), pid, task_total,
+                           100.0 * task_total / total), counts, task_total)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
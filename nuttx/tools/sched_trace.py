@@ -0,0 +1,209 @@
+#!/usr/bin/env python
+############################################################################
+# tools/sched_trace.py
+#
+# Copyright (c) 2016 Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 1. Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+# this list of conditions and the following disclaimer in the documentation
+# and/or other materials provided with the distribution.
+# 3. Neither the name of the copyright holder nor the names of its
+# contributors may be used to endorse or promote products derived from this
+# software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+# THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+############################################################################
+
+"""Convert the output of the NSH "trace -dump" command into the Chrome trace
+event format (JSON), which chrome://tracing and Perfetto display as a
+timeline.
+
+usage: sched_trace.py <console-log> [<output.json>]
+
+The console log may hold other output: only the "T" and "E" lines between
+"# sched_trace begin" and "# sched_trace end" are used.
+
+The timeline has three processes:
+  - "cpu": what runs, task or interrupt handler, one slice at a time.
+  - "tasks": one track per task, with its semaphore waits.
+  - "greybus": one track per cport, with each operation from its reception
+    to its dispatch, and from its dispatch to its response.
+"""
+
+import json
+import re
+import sys
+
+# Must match include/nuttx/sched_trace.h
+SWITCH, IRQ_ENTER, IRQ_LEAVE, SEM_WAIT, SEM_WAKE, GB_RX, GB_DISPATCH, \
+    GB_RESPONSE = range(8)
+
+PID_CPU, PID_TASKS, PID_GREYBUS = 1, 2, 3
+
+TASK_RE = re.compile(r'\bT (\d+) (.*)$')
+EVENT_RE = re.compile(r'\bE (\d+) (\d+) (\d+) ([0-9a-fA-F]{8})\b')
+
+
+def parse(lines):
+    tasks = {}
+    events = []
+    inside = False
+
+    for line in lines:
+        line = line.rstrip('\r\n')
+        if '# sched_trace begin' in line:
+            tasks, events, inside = {}, [], True
+            continue
+        if '# sched_trace end' in line:
+            inside = False
+            continue
+        if not inside:
+            continue
+
+        m = EVENT_RE.search(line)
+        if m:
+            events.append((int(m.group(1)), int(m.group(2)),
+                           int(m.group(3)), int(m.group(4), 16)))
+            continue
+
+        m = TASK_RE.search(line)
+        if m:
+            tasks[int(m.group(1))] = m.group(2).strip()
+
+    return tasks, events
+
+
+def unwrap(events):
+    """hrt_getusec() wraps every 71 minutes: make the timestamps monotonic"""
+    base = 0
+    prev = None
+    out = []
+
+    for usec, etype, arg1, arg2 in events:
+        if prev is not None and usec < prev:
+            base += 1 << 32
+        prev = usec
+        out.append((base + usec, etype, arg1, arg2))
+
+    return out
+
+
+def slice_event(name, pid, tid, start, end, args=None):
+    event = {'name': name, 'ph': 'X', 'pid': pid, 'tid': tid,
+             'ts': start, 'dur': max(end - start, 0)}
+    if args:
+        event['args'] = args
+    return event
+
+
+def convert(tasks, events):
+    def task_name(pid):
+        return '%s (%d)' % (tasks.get(pid, 'pid'), pid)
+
+    out = []
+    running = None          # (pid, since)
+    irqs = {}               # irq -> entry time
+    sem_waits = {}          # pid -> (sem, since)
+    gb_rx = {}              # (cport, id, type) -> reception time
+    gb_dispatch = {}        # (cport, id) -> (type, dispatch time)
+
+    def run(pid, usec):
+        if running and running[0] != pid:
+            out.append(slice_event(task_name(running[0]), PID_CPU, 0,
+                                   running[1], usec))
+        if not running or running[0] != pid:
+            return (pid, usec)
+        return running
+
+    for usec, etype, arg1, arg2 in events:
+        if etype == SWITCH:
+            running = run(arg1, usec)
+        elif etype == IRQ_ENTER:
+            irqs[arg1] = usec
+        elif etype == IRQ_LEAVE:
+            if arg1 in irqs:
+                out.append(slice_event('irq %d' % arg1, PID_CPU, 0,
+                                       irqs.pop(arg1), usec))
+            running = run(arg2, usec)
+        elif etype == SEM_WAIT:
+            sem_waits[arg1] = (arg2, usec)
+        elif etype == SEM_WAKE:
+            if arg1 in sem_waits:
+                sem, since = sem_waits.pop(arg1)
+                out.append(slice_event('sem 0x%08x' % sem, PID_TASKS, arg1,
+                                       since, usec))
+        elif etype in (GB_RX, GB_DISPATCH, GB_RESPONSE):
+            opid = arg2 >> 16
+            optype = (arg2 >> 8) & 0x7f
+            if etype == GB_RX:
+                gb_rx[(arg1, opid, optype)] = usec
+            elif etype == GB_DISPATCH:
+                since = gb_rx.pop((arg1, opid, optype), None)
+                if since is not None:
+                    out.append(slice_event('queued 0x%02x' % optype,
+                                           PID_GREYBUS, arg1, since, usec,
+                                           {'id': opid}))
+                gb_dispatch[(arg1, opid)] = (optype, usec)
+            elif (arg1, opid) in gb_dispatch:
+                optype, since = gb_dispatch.pop((arg1, opid))
+                out.append(slice_event('op 0x%02x' % optype, PID_GREYBUS,
+                                       arg1, since, usec,
+                                       {'id': opid, 'result': arg2 & 0xff}))
+
+    if running and events:
+        out.append(slice_event(task_name(running[0]), PID_CPU, 0,
+                               running[1], events[-1][0]))
+
+    # Name the processes and the tracks
+    meta = [('cpu', PID_CPU), ('tasks', PID_TASKS), ('greybus', PID_GREYBUS)]
+    for name, pid in meta:
+        out.append({'name': 'process_name', 'ph': 'M', 'pid': pid,
+                    'args': {'name': name}})
+    for pid in tasks:
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID_TASKS,
+                    'tid': pid, 'args': {'name': task_name(pid)}})
+    for cport in set(e['tid'] for e in out if e.get('pid') == PID_GREYBUS
+                     and e['ph'] == 'X'):
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID_GREYBUS,
+                    'tid': cport, 'args': {'name': 'cport %d' % cport}})
+
+    return {'traceEvents': out}
+
+
+def main(argv):
+    if len(argv) < 2 or len(argv) > 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(argv[1]) as f:
+        tasks, events = parse(f)
+
+    trace = convert(tasks, unwrap(events))
+
+    if len(argv) == 3:
+        with open(argv[2], 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))